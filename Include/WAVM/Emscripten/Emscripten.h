@@ -39,5 +39,29 @@ namespace WAVM { namespace Emscripten {
 
 	WAVM_API void joinAllThreads(Process& process);
 
+	// Threads created by WebAssembly code run on a pool of host threads that are reused after the
+	// threads exit. If every host thread in the pool is busy and the pool has reached its maximum
+	// size, pthread_create fails with EAGAIN.
+	static constexpr Uptr defaultMaxThreadPoolSize = 256;
+	WAVM_API void setMaxThreadPoolSize(Process& process, Uptr maxWorkerThreads);
+
+	struct ThreadPoolStats
+	{
+		// The number of host threads in the pool, and how many of them are running a thread.
+		Uptr numWorkerThreads;
+		Uptr numBusyWorkerThreads;
+		Uptr maxWorkerThreads;
+
+		// The number of threads created by WebAssembly code, how many of them ran on an idle host
+		// thread instead of a new one, and how many reused the context of an exited thread.
+		U64 numThreadsCreated;
+		U64 numThreadsOnIdleWorkers;
+		U64 numRecycledContexts;
+
+		// The number of pthread_create calls that failed because the pool was full.
+		U64 numThreadsRejected;
+	};
+	WAVM_API ThreadPoolStats getThreadPoolStats(Process& process);
+
 	WAVM_API I32 catchExit(std::function<I32()>&& thunk);
 }}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+
+namespace WAVM { namespace IR {
+	struct Module;
+
+	// A module in a link group, and the name that later modules in the group import it by.
+	struct LinkGroupModule
+	{
+		std::string name;
+		const Module* module;
+
+		// If false, the module's exports are only used to resolve the imports of later modules in
+		// the group, and aren't exported by the linked module. This allows definitions that are
+		// only used within the group to be eliminated as dead code.
+		bool exportsAreVisible = true;
+	};
+
+	// Links a group of modules into a single module, which can be compiled with cross-module
+	// inlining and dead code elimination. Each import of a module in the group whose module name
+	// is the name of an earlier module in the group is bound to that module's export, and calls
+	// to imported functions become direct calls. The other imports are imports of the linked
+	// module, in the order they occur in the group's modules.
+	//
+	// The linked module behaves like instantiating the group's modules in order, except that:
+	//   - The active data and elem segments of all the modules are applied before the start
+	//     function of any module is called. The start functions are called in order.
+	//   - The linked module has no custom sections, including the names section.
+	//
+	// outModule must be empty, and its FeatureSpec must allow the combined module: e.g. it must
+	// allow multiple memories if more than one module in the group defines a memory. If the
+	// modules can't be linked, returns false and describes the problem in outError.
+	WAVM_API bool linkModules(const std::vector<LinkGroupModule>& modules,
+							  Module& outModule,
+							  std::string& outError);
+}}
@@ -98,7 +98,10 @@ namespace WAVM { namespace IR {
 		IndexedFunctionType type;
 		std::vector<ValueType> nonParameterLocalTypes;
 		std::vector<U8> code;
-		std::vector<std::vector<Uptr>> branchTables;
+
+		// The target depths of all the function's br_table operators, which each reference a
+		// range of them with BranchTableImm.
+		std::vector<U32> branchTableTargetDepths;
 	};
 
 	// A table definition
@@ -163,6 +166,34 @@ namespace WAVM { namespace IR {
 		}
 	};
 
+	// The bytes of a data segment. The bytes are either owned by the DataSegmentBytes, or are in
+	// memory that is kept alive by a shared owner: e.g. the buffer that a module was loaded from.
+	struct DataSegmentBytes
+	{
+		DataSegmentBytes() {}
+		DataSegmentBytes(std::vector<U8>&& inBytes)
+		: ownedBytes(std::move(inBytes)), begin(ownedBytes.data()), numBytes(ownedBytes.size())
+		{
+		}
+		DataSegmentBytes(const U8* inBegin, Uptr inNumBytes, std::shared_ptr<const void> inOwner)
+		: owner(std::move(inOwner)), begin(inBegin), numBytes(inNumBytes)
+		{
+		}
+
+		// The bytes may point into ownedBytes, so don't allow copying.
+		DataSegmentBytes(const DataSegmentBytes&) = delete;
+		DataSegmentBytes& operator=(const DataSegmentBytes&) = delete;
+
+		const U8* data() const { return begin; }
+		Uptr size() const { return numBytes; }
+
+	private:
+		std::vector<U8> ownedBytes;
+		std::shared_ptr<const void> owner;
+		const U8* begin = nullptr;
+		Uptr numBytes = 0;
+	};
+
 	// A data segment: a literal sequence of bytes that is copied into a Runtime::Memory when
 	// instantiating a module
 	struct DataSegment
@@ -170,7 +201,7 @@ namespace WAVM { namespace IR {
 		bool isActive;
 		Uptr memoryIndex;
 		InitializerExpression baseOffset;
-		std::shared_ptr<std::vector<U8>> data;
+		std::shared_ptr<DataSegmentBytes> data;
 	};
 
 	// An element expression: a literal reference used to initialize a table element.
@@ -38,9 +38,12 @@ namespace WAVM { namespace IR {
 		{
 			std::string result = " " + std::to_string(imm.defaultTargetDepth);
 			const char* prefix = " [";
-			WAVM_ASSERT(imm.branchTableIndex < functionDef.branchTables.size());
-			for(auto depth : functionDef.branchTables[imm.branchTableIndex])
+			WAVM_ASSERT(imm.firstTargetDepthIndex + imm.numTargetDepths
+						<= functionDef.branchTableTargetDepths.size());
+			for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
 			{
+				const U32 depth
+					= functionDef.branchTableTargetDepths[imm.firstTargetDepthIndex + targetIndex];
 				result += prefix + std::to_string(depth);
 				prefix = ",";
 			}
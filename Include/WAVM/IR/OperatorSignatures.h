@@ -301,6 +301,13 @@ namespace WAVM { namespace IR {
 			return OpSignature({}, {indexType, elementType, indexType});
 		}
 
+		inline OpSignature discard(const Module& module, const MemoryImm& imm)
+		{
+			const ValueType indexType
+				= asValueType(module.memories.getType(imm.memoryIndex).indexType);
+			return OpSignature({}, {indexType, indexType});
+		}
+
 		inline OpSignature notify(const Module& module, const BaseLoadOrStoreImm& imm)
 		{
 			const ValueType indexType
@@ -24,6 +24,8 @@
 	visitOp(0x000f, return_            , "return"                           , NoImm                     , POLYMORPHIC               , mvp                    )   \
 	visitOp(0x0010, call               , "call"                             , FunctionImm               , POLYMORPHIC               , mvp                    )   \
 	visitOp(0x0011, call_indirect      , "call_indirect"                    , CallIndirectImm           , POLYMORPHIC               , mvp                    )   \
+	visitOp(0x0012, return_call        , "return_call"                      , FunctionImm               , POLYMORPHIC               , tailCalls              )   \
+	visitOp(0x0013, return_call_indirect, "return_call_indirect"            , CallIndirectImm           , POLYMORPHIC               , tailCalls              )   \
 /* Stack manipulation                                                                                                                                         */ \
 	visitOp(0x001a, drop               , "drop"                             , NoImm                     , POLYMORPHIC               , mvp                    )   \
 /* Variables                                                                                                                                                  */ \
@@ -83,6 +85,8 @@
 	visitOp(0xfc0c, table_init                , "table.init"                , ElemSegmentAndTableImm              , init                      , bulkMemoryOperations   )   \
 	visitOp(0xfc0e, table_copy                , "table.copy"                , TableCopyImm                        , copy                      , bulkMemoryOperations   )   \
 	visitOp(0xfc10, table_size                , "table.size"                , TableImm                            , size                      , referenceTypes         )   \
+/* Memory control operators                                                                                                                                             */ \
+	visitOp(0xfc12, memory_discard            , "memory.discard"            , MemoryImm                           , discard                   , memoryControl          )   \
 /* v128 load/store                                                                                                                                                      */ \
 	visitOp(0xfd00, v128_load                 , "v128.load"                 , LoadOrStoreImm<4>                   , load_v128                 , simd                   )   \
 	visitOp(0xfd01, v128_load8x8_s            , "v128.load8x8_s"            , LoadOrStoreImm<3>                   , load_v128                 , simd                   )   \
@@ -597,6 +601,27 @@
 	visitOp(0xfdfd, i32x4_trunc_sat_f64x2_u_zero  , "i32x4.trunc_sat_f64x2_u_zero"  , NoImm                     , v128_to_v128              , simd                   )   \
 	visitOp(0xfdfe, f64x2_convert_low_i32x4_s     , "f64x2.convert_low_i32x4_s"     , NoImm                     , v128_to_v128              , simd                   )   \
 	visitOp(0xfdff, f64x2_convert_low_i32x4_u     , "f64x2.convert_low_i32x4_u"     , NoImm                     , v128_to_v128              , simd                   )   \
+/* Relaxed SIMD (0xfd 0x100-0x113, stored with the 0xf9 prefix)                                                                                                       */ \
+	visitOp(0xf900, i8x16_relaxed_swizzle         , "i8x16.relaxed_swizzle"         , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf901, i32x4_relaxed_trunc_f32x4_s   , "i32x4.relaxed_trunc_f32x4_s"   , NoImm                     , v128_to_v128              , relaxedSIMD            )   \
+	visitOp(0xf902, i32x4_relaxed_trunc_f32x4_u   , "i32x4.relaxed_trunc_f32x4_u"   , NoImm                     , v128_to_v128              , relaxedSIMD            )   \
+	visitOp(0xf903, i32x4_relaxed_trunc_f64x2_s_zero, "i32x4.relaxed_trunc_f64x2_s_zero", NoImm                     , v128_to_v128              , relaxedSIMD            )   \
+	visitOp(0xf904, i32x4_relaxed_trunc_f64x2_u_zero, "i32x4.relaxed_trunc_f64x2_u_zero", NoImm                     , v128_to_v128              , relaxedSIMD            )   \
+	visitOp(0xf905, f32x4_relaxed_madd            , "f32x4.relaxed_madd"            , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf906, f32x4_relaxed_nmadd           , "f32x4.relaxed_nmadd"           , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf907, f64x2_relaxed_madd            , "f64x2.relaxed_madd"            , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf908, f64x2_relaxed_nmadd           , "f64x2.relaxed_nmadd"           , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf909, i8x16_relaxed_laneselect      , "i8x16.relaxed_laneselect"      , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf90a, i16x8_relaxed_laneselect      , "i16x8.relaxed_laneselect"      , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf90b, i32x4_relaxed_laneselect      , "i32x4.relaxed_laneselect"      , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf90c, i64x2_relaxed_laneselect      , "i64x2.relaxed_laneselect"      , NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
+	visitOp(0xf90d, f32x4_relaxed_min             , "f32x4.relaxed_min"             , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf90e, f32x4_relaxed_max             , "f32x4.relaxed_max"             , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf90f, f64x2_relaxed_min             , "f64x2.relaxed_min"             , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf910, f64x2_relaxed_max             , "f64x2.relaxed_max"             , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf911, i16x8_relaxed_q15mulr_s       , "i16x8.relaxed_q15mulr_s"       , NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf912, i16x8_relaxed_dot_i8x16_i7x16_s, "i16x8.relaxed_dot_i8x16_i7x16_s", NoImm                     , v128_v128_to_v128         , relaxedSIMD            )   \
+	visitOp(0xf913, i32x4_relaxed_dot_i8x16_i7x16_add_s, "i32x4.relaxed_dot_i8x16_i7x16_add_s", NoImm                     , v128_v128_v128_to_v128    , relaxedSIMD            )   \
 /* Atomic fence                                                                                                                                                       */ \
 	visitOp(0xfe03, atomic_fence                  , "atomic.fence"                  , AtomicFenceImm            , none_to_none              , atomics                )
 
@@ -60,8 +60,10 @@ namespace WAVM { namespace IR {
 	{
 		Uptr defaultTargetDepth;
 
-		// An index into the FunctionDef's branchTables array.
-		Uptr branchTableIndex;
+		// The range of the FunctionDef's branchTableTargetDepths array that holds the target
+		// depths for each table index.
+		Uptr firstTargetDepthIndex;
+		Uptr numTargetDepths;
 	};
 
 	template<typename Value> struct LiteralImm
@@ -181,20 +183,186 @@ namespace WAVM { namespace IR {
 
 	static constexpr U64 maxSingleByteOpcode = 0xdf;
 
-	template<typename Imm> struct OpcodeAndImm
+	// Opcodes are encoded in 16 bits as a prefix byte and an 8-bit index, but the relaxed SIMD
+	// opcodes are 0xfd-prefixed indices 0x100-0x1ff. They are encoded with the otherwise unused
+	// 0xf9 prefix and the low 8 bits of the index.
+	static constexpr U8 relaxedSIMDOpcodePrefix = 0xf9;
+
+	// The encoding of each type of immediate in FunctionDef::code, which follows the operator's
+	// opcode without any padding. By default, an immediate is encoded as its bytes in memory, but
+	// the immediates that contain indices or depths encode each as a U32 instead of a Uptr, so the
+	// code of a function isn't much larger than its WebAssembly binary encoding.
+	template<typename Imm> struct ImmEncoding
 	{
-		Opcode opcode;
-		Imm imm;
+		static constexpr Uptr numBytes = sizeof(Imm);
+		static void encode(U8* bytes, const Imm& imm) { memcpy(bytes, &imm, sizeof(Imm)); }
+		static void decode(const U8* bytes, Imm& imm) { memcpy(&imm, bytes, sizeof(Imm)); }
 	};
 
-	// Specialize for the empty immediate struct so they don't take an extra byte of space.
-	template<> struct OpcodeAndImm<NoImm>
+	template<> struct ImmEncoding<NoImm>
+	{
+		static constexpr Uptr numBytes = 0;
+		static void encode(U8*, const NoImm&) {}
+		static void decode(const U8*, NoImm&) {}
+	};
+
+	WAVM_FORCEINLINE void encodeU32Index(U8* bytes, Uptr index)
+	{
+		WAVM_ASSERT(index <= UINT32_MAX);
+		const U32 index32 = U32(index);
+		memcpy(bytes, &index32, sizeof(U32));
+	}
+	WAVM_FORCEINLINE Uptr decodeU32Index(const U8* bytes)
+	{
+		U32 index32;
+		memcpy(&index32, bytes, sizeof(U32));
+		return Uptr(index32);
+	}
+
+	// The encoding of immediates that are made up of only indices and depths.
+	template<typename Imm> struct IndexImmEncoding
 	{
-		union
+		static constexpr Uptr numIndices = sizeof(Imm) / sizeof(Uptr);
+		static_assert(sizeof(Imm) == numIndices * sizeof(Uptr), "Imm must contain only Uptrs");
+
+		static constexpr Uptr numBytes = numIndices * sizeof(U32);
+		static void encode(U8* bytes, const Imm& imm)
 		{
-			Opcode opcode;
-			NoImm imm;
-		};
+			Uptr indices[numIndices];
+			memcpy(indices, &imm, sizeof(Imm));
+			for(Uptr index = 0; index < numIndices; ++index)
+			{ encodeU32Index(bytes + index * sizeof(U32), indices[index]); }
+		}
+		static void decode(const U8* bytes, Imm& imm)
+		{
+			Uptr indices[numIndices];
+			for(Uptr index = 0; index < numIndices; ++index)
+			{ indices[index] = decodeU32Index(bytes + index * sizeof(U32)); }
+			memcpy(&imm, indices, sizeof(Imm));
+		}
+	};
+
+	template<> struct ImmEncoding<MemoryImm> : IndexImmEncoding<MemoryImm>
+	{
+	};
+	template<> struct ImmEncoding<MemoryCopyImm> : IndexImmEncoding<MemoryCopyImm>
+	{
+	};
+	template<> struct ImmEncoding<TableImm> : IndexImmEncoding<TableImm>
+	{
+	};
+	template<> struct ImmEncoding<TableCopyImm> : IndexImmEncoding<TableCopyImm>
+	{
+	};
+	template<> struct ImmEncoding<BranchImm> : IndexImmEncoding<BranchImm>
+	{
+	};
+	template<> struct ImmEncoding<BranchTableImm> : IndexImmEncoding<BranchTableImm>
+	{
+	};
+	template<bool isGlobal>
+	struct ImmEncoding<GetOrSetVariableImm<isGlobal>>
+	: IndexImmEncoding<GetOrSetVariableImm<isGlobal>>
+	{
+	};
+	template<> struct ImmEncoding<FunctionImm> : IndexImmEncoding<FunctionImm>
+	{
+	};
+	template<> struct ImmEncoding<FunctionRefImm> : IndexImmEncoding<FunctionRefImm>
+	{
+	};
+	template<> struct ImmEncoding<CallIndirectImm> : IndexImmEncoding<CallIndirectImm>
+	{
+	};
+	template<> struct ImmEncoding<ExceptionTypeImm> : IndexImmEncoding<ExceptionTypeImm>
+	{
+	};
+	template<> struct ImmEncoding<RethrowImm> : IndexImmEncoding<RethrowImm>
+	{
+	};
+	template<> struct ImmEncoding<DataSegmentAndMemImm> : IndexImmEncoding<DataSegmentAndMemImm>
+	{
+	};
+	template<> struct ImmEncoding<DataSegmentImm> : IndexImmEncoding<DataSegmentImm>
+	{
+	};
+	template<>
+	struct ImmEncoding<ElemSegmentAndTableImm> : IndexImmEncoding<ElemSegmentAndTableImm>
+	{
+	};
+	template<> struct ImmEncoding<ElemSegmentImm> : IndexImmEncoding<ElemSegmentImm>
+	{
+	};
+
+	// Block types are encoded as their format followed by their result type or type index.
+	template<> struct ImmEncoding<ControlStructureImm>
+	{
+		static constexpr Uptr numBytes = 1 + sizeof(U32);
+		static void encode(U8* bytes, const ControlStructureImm& imm)
+		{
+			bytes[0] = U8(imm.type.format);
+			encodeU32Index(bytes + 1,
+						   imm.type.format == IndexedBlockType::functionType
+							   ? imm.type.index
+							   : Uptr(imm.type.resultType));
+		}
+		static void decode(const U8* bytes, ControlStructureImm& imm)
+		{
+			imm.type.format = IndexedBlockType::Format(bytes[0]);
+			const Uptr indexOrResultType = decodeU32Index(bytes + 1);
+			if(imm.type.format == IndexedBlockType::functionType)
+			{ imm.type.index = indexOrResultType; }
+			else
+			{
+				imm.type.resultType = ValueType(indexOrResultType);
+			}
+		}
+	};
+
+	// Memory accesses are encoded as their offset, memory index, alignment, and for the lane
+	// accesses, the lane index.
+	struct LoadOrStoreImmEncoding
+	{
+		static constexpr Uptr numBytes = sizeof(U64) + sizeof(U32) + 1;
+		static void encode(U8* bytes, const BaseLoadOrStoreImm& imm)
+		{
+			memcpy(bytes, &imm.offset, sizeof(U64));
+			encodeU32Index(bytes + sizeof(U64), imm.memoryIndex);
+			bytes[sizeof(U64) + sizeof(U32)] = imm.alignmentLog2;
+		}
+		static void decode(const U8* bytes, BaseLoadOrStoreImm& imm)
+		{
+			memcpy(&imm.offset, bytes, sizeof(U64));
+			imm.memoryIndex = decodeU32Index(bytes + sizeof(U64));
+			imm.alignmentLog2 = bytes[sizeof(U64) + sizeof(U32)];
+		}
+	};
+
+	template<Uptr naturalAlignmentLog2>
+	struct ImmEncoding<LoadOrStoreImm<naturalAlignmentLog2>>
+	: LoadOrStoreImmEncoding
+	{
+	};
+	template<Uptr naturalAlignmentLog2>
+	struct ImmEncoding<AtomicLoadOrStoreImm<naturalAlignmentLog2>>
+	: LoadOrStoreImmEncoding
+	{
+	};
+	template<Uptr naturalAlignmentLog2, Uptr numLanes>
+	struct ImmEncoding<LoadOrStoreLaneImm<naturalAlignmentLog2, numLanes>>
+	{
+		using Imm = LoadOrStoreLaneImm<naturalAlignmentLog2, numLanes>;
+		static constexpr Uptr numBytes = LoadOrStoreImmEncoding::numBytes + 1;
+		static void encode(U8* bytes, const Imm& imm)
+		{
+			LoadOrStoreImmEncoding::encode(bytes, imm);
+			bytes[LoadOrStoreImmEncoding::numBytes] = imm.laneIndex;
+		}
+		static void decode(const U8* bytes, Imm& imm)
+		{
+			LoadOrStoreImmEncoding::decode(bytes, imm);
+			imm.laneIndex = bytes[LoadOrStoreImmEncoding::numBytes];
+		}
 	};
 
 	// Decodes an operator from an input stream and dispatches by opcode.
@@ -216,11 +384,11 @@ namespace WAVM { namespace IR {
 			{
 #define VISIT_OPCODE(opcode, name, nameString, Imm, ...)                                           \
 	case Opcode::name: {                                                                           \
-		WAVM_ASSERT(nextByte + sizeof(OpcodeAndImm<Imm>) <= end);                                  \
-		OpcodeAndImm<Imm> encodedOperator;                                                         \
-		memcpy(&encodedOperator, nextByte, sizeof(OpcodeAndImm<Imm>));                             \
-		nextByte += sizeof(OpcodeAndImm<Imm>);                                                     \
-		return visitor.name(encodedOperator.imm);                                                  \
+		WAVM_ASSERT(nextByte + sizeof(Opcode) + ImmEncoding<Imm>::numBytes <= end);                \
+		Imm imm;                                                                                   \
+		ImmEncoding<Imm>::decode(nextByte + sizeof(Opcode), imm);                                  \
+		nextByte += sizeof(Opcode) + ImmEncoding<Imm>::numBytes;                                   \
+		return visitor.name(imm);                                                                  \
 	}
 				WAVM_ENUM_OPERATORS(VISIT_OPCODE)
 #undef VISIT_OPCODE
@@ -251,12 +419,10 @@ namespace WAVM { namespace IR {
 #define VISIT_OPCODE(_, name, nameString, Imm, ...)                                                \
 	void name(Imm imm = {})                                                                        \
 	{                                                                                              \
-		OpcodeAndImm<Imm> encodedOperator;                                                         \
-		encodedOperator.opcode = Opcode::name;                                                     \
-		encodedOperator.imm = imm;                                                                 \
-		memcpy((OpcodeAndImm<Imm>*)byteStream.advance(sizeof(OpcodeAndImm<Imm>)),                  \
-			   &encodedOperator,                                                                   \
-			   sizeof(OpcodeAndImm<Imm>));                                                         \
+		const Opcode opcode = Opcode::name;                                                        \
+		U8* bytes = byteStream.advance(sizeof(Opcode) + ImmEncoding<Imm>::numBytes);               \
+		memcpy(bytes, &opcode, sizeof(Opcode));                                                    \
+		ImmEncoding<Imm>::encode(bytes + sizeof(Opcode), imm);                                     \
 	}
 		WAVM_ENUM_OPERATORS(VISIT_OPCODE)
 #undef VISIT_OPCODE
@@ -10,4 +10,35 @@ namespace WAVM { namespace IR {
 	struct Module;
 
 	WAVM_API void generateValidModule(IR::Module& module, RandomStream& randomStream);
+
+	// The shape of a module generated by generateSyntheticModule.
+	struct SyntheticModuleConfig
+	{
+		// The same seed and config always generate the same module.
+		U64 seed = 0;
+
+		Uptr numFunctions = 1000;
+		Uptr numOperationsPerFunction = 100;
+
+		// The functions are divided into this many levels, and each function only calls functions
+		// in the next level, so the call graph is acyclic. The number of calls made by invoking a
+		// root function grows exponentially with the depth.
+		Uptr callGraphDepth = 8;
+
+		// The fraction of the operations in each function that are direct calls, call_indirects,
+		// memory loads or stores, and SIMD arithmetic. The rest are scalar i32 arithmetic.
+		F64 callDensity = 0.02;
+		F64 callIndirectDensity = 0.01;
+		F64 memoryAccessDensity = 0.2;
+		F64 simdDensity = 0.0;
+
+		// The number of bytes in the memory's active data segments.
+		Uptr numDataSegmentBytes = 0;
+	};
+
+	// Generates a valid module with the given shape, for measuring compile, object cache, and
+	// instantiation performance on modules larger than we have real examples of. Every function
+	// has the type (i32)->i32, and the functions at the root of the call graph are exported as
+	// func<index>.
+	WAVM_API void generateSyntheticModule(IR::Module& module, const SyntheticModuleConfig& config);
 }}
@@ -313,6 +313,11 @@ namespace WAVM { namespace IR {
 		Uptr getHash() const { return impl->hash; }
 		Encoding getEncoding() const { return Encoding{reinterpret_cast<Uptr>(impl)}; }
 
+		// Returns a small integer that uniquely identifies the function type. IDs are allocated
+		// densely in the order that the types are first created, so they may be used as indices
+		// into tables of per-type data.
+		Uptr getId() const { return impl->id; }
+
 		friend bool operator==(const FunctionType& left, const FunctionType& right)
 		{
 			return left.impl == right.impl;
@@ -327,11 +332,15 @@ namespace WAVM { namespace IR {
 		struct Impl
 		{
 			Uptr hash;
+			Uptr id;
 			TypeTuple results;
 			TypeTuple params;
 			CallingConvention callingConvention;
 
-			Impl(TypeTuple inResults, TypeTuple inParams, CallingConvention inCallingConvention);
+			Impl(Uptr inId,
+				 TypeTuple inResults,
+				 TypeTuple inParams,
+				 CallingConvention inCallingConvention);
 		};
 
 		const Impl* impl;
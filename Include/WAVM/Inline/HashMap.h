@@ -19,7 +19,7 @@ namespace WAVM {
 
 	template<typename Key, typename Value> struct HashMapIterator
 	{
-		template<typename, typename, typename> friend struct HashMap;
+		template<typename, typename, typename, typename> friend struct HashMap;
 
 		typedef HashMapPair<Key, Value> Pair;
 
@@ -39,7 +39,12 @@ namespace WAVM {
 						const HashTableBucket<Pair>* inEndBucket);
 	};
 
-	template<typename Key, typename Value, typename KeyHashPolicy = DefaultHashPolicy<Key>>
+	// TableImplPolicy selects the hash table implementation: RobinHoodHashTableImplPolicy or
+	// SwissHashTableImplPolicy.
+	template<typename Key,
+			 typename Value,
+			 typename KeyHashPolicy = DefaultHashPolicy<Key>,
+			 typename TableImplPolicy = RobinHoodHashTableImplPolicy<>>
 	struct HashMap
 	{
 		typedef HashMapPair<Key, Value> Pair;
@@ -116,7 +121,7 @@ namespace WAVM {
 			}
 		};
 
-		HashTable<Key, Pair, HashTablePolicy> table;
+		typename TableImplPolicy::template Table<Key, Pair, HashTablePolicy> table;
 	};
 
 // The implementation is defined in a separate file.
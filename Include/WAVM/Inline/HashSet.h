@@ -9,7 +9,7 @@
 namespace WAVM {
 	template<typename Element> struct HashSetIterator
 	{
-		template<typename, typename> friend struct HashSet;
+		template<typename, typename, typename> friend struct HashSet;
 
 		bool operator!=(const HashSetIterator& other);
 		bool operator==(const HashSetIterator& other);
@@ -28,7 +28,11 @@ namespace WAVM {
 						const HashTableBucket<Element>* inEndBucket);
 	};
 
-	template<typename Element, typename ElementHashPolicy = DefaultHashPolicy<Element>>
+	// TableImplPolicy selects the hash table implementation: RobinHoodHashTableImplPolicy or
+	// SwissHashTableImplPolicy.
+	template<typename Element,
+			 typename ElementHashPolicy = DefaultHashPolicy<Element>,
+			 typename TableImplPolicy = RobinHoodHashTableImplPolicy<>>
 	struct HashSet
 	{
 		HashSet(Uptr reserveNumElements = 0);
@@ -90,7 +94,7 @@ namespace WAVM {
 			}
 		};
 
-		HashTable<Element, Element, HashTablePolicy> table;
+		typename TableImplPolicy::template Table<Element, Element, HashTablePolicy> table;
 	};
 
 // The implementation is defined in a separate file.
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <string.h>
 #include "Assert.h"
 #include "BasicTypes.h"
 #include "Impl/OptionalStorage.h"
 #include "WAVM/Platform/Intrinsic.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define WAVM_SWISS_HASH_TABLE_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define WAVM_SWISS_HASH_TABLE_NEON 1
+#endif
+
 namespace WAVM {
 	struct DefaultHashTableAllocPolicy
 	{
@@ -150,6 +159,171 @@ namespace WAVM {
 		void moveFrom(HashTable&& movee) noexcept;
 	};
 
+	// A group of consecutive control bytes in a SwissHashTable that are probed together. The
+	// match functions return a mask with a bit set for each matching control byte: the index of
+	// the byte is the index of the set bit shifted right by slotShift.
+	struct SwissHashTableGroup
+	{
+		static constexpr U8 emptyControl = 0x80;
+		static constexpr U8 deletedControl = 0xfe;
+
+#if WAVM_SWISS_HASH_TABLE_SSE2
+		static constexpr Uptr numBytes = 16;
+		static constexpr Uptr slotShift = 0;
+
+		SwissHashTableGroup(const U8* controlBytes)
+		: controls(_mm_loadu_si128((const __m128i*)controlBytes))
+		{
+		}
+
+		U64 match(U8 control) const
+		{
+			return U64(U32(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(char(control))))));
+		}
+		U64 matchEmpty() const { return match(emptyControl); }
+		U64 matchEmptyOrDeleted() const { return U64(U32(_mm_movemask_epi8(controls))); }
+
+	private:
+		__m128i controls;
+#elif WAVM_SWISS_HASH_TABLE_NEON
+		static constexpr Uptr numBytes = 16;
+		static constexpr Uptr slotShift = 2;
+
+		SwissHashTableGroup(const U8* controlBytes) : controls(vld1q_u8(controlBytes)) {}
+
+		U64 match(U8 control) const { return toMask(vceqq_u8(controls, vdupq_n_u8(control))); }
+		U64 matchEmpty() const { return match(emptyControl); }
+		U64 matchEmptyOrDeleted() const
+		{
+			return toMask(vcltq_s8(vreinterpretq_s8_u8(controls), vdupq_n_s8(0)));
+		}
+
+	private:
+		uint8x16_t controls;
+
+		// Narrows each byte of a comparison result to a nibble, and keeps one bit of each nibble.
+		static U64 toMask(uint8x16_t comparison)
+		{
+			const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4);
+			return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+		}
+#else
+		// Without SIMD, probe 8 control bytes at a time in a U64.
+		static constexpr Uptr numBytes = 8;
+		static constexpr Uptr slotShift = 3;
+
+		SwissHashTableGroup(const U8* controlBytes) { memcpy(&controls, controlBytes, 8); }
+
+		// This may also match a byte following a matching byte, so the caller must check the
+		// matched elements.
+		U64 match(U8 control) const
+		{
+			const U64 x = controls ^ (lsbs * control);
+			return (x - lsbs) & ~x & msbs;
+		}
+
+		// Empty controls are the only controls with the high bit set and bit 1 clear.
+		U64 matchEmpty() const { return controls & ~(controls << 6) & msbs; }
+		U64 matchEmptyOrDeleted() const { return controls & msbs; }
+
+	private:
+		static constexpr U64 lsbs = 0x0101010101010101ull;
+		static constexpr U64 msbs = 0x8080808080808080ull;
+		U64 controls;
+#endif
+	};
+
+	// An alternative implementation of the HashTable interface, used by HashMap and HashSet when
+	// they are instantiated with SwissHashTableImplPolicy.
+	//
+	//   The buckets are the same as HashTable's, but each bucket also has a control byte in a
+	// separate array: either emptyControl, deletedControl, or the low 7 bits of the occupying
+	// element's hash. A search starts at the group of control bytes indexed by the remaining bits
+	// of the hash, and compares the whole group to the key's control byte with SIMD instructions.
+	// Only the buckets whose control bytes match are compared to the key, and the search ends at
+	// the first group that contains an empty bucket.
+	//
+	//   Removing an element leaves a deleted control byte, so searches continue past it. Deleted
+	// buckets are reused by insertions, and are removed when the table is resized or rehashed.
+	//
+	//   The control byte array has numBytes-1 extra bytes at its end that mirror the control
+	// bytes at its start, so a group can be loaded at any bucket index without wrapping around.
+	//
+	//   Compared to the Robin Hood table, insertion and removal never move other elements, and
+	// searches stay short at high occupancy, at the cost of an extra byte per bucket.
+	template<typename Key,
+			 typename Element,
+			 typename HashTablePolicy,
+			 typename AllocPolicy = DefaultHashTableAllocPolicy>
+	struct SwissHashTable
+	{
+		typedef HashTableBucket<Element> Bucket;
+		typedef SwissHashTableGroup Group;
+
+		SwissHashTable(Uptr estimatedNumElements = 0);
+		SwissHashTable(const SwissHashTable& copy);
+		SwissHashTable(SwissHashTable&& movee) noexcept;
+		~SwissHashTable();
+
+		SwissHashTable& operator=(const SwissHashTable& copyee);
+		SwissHashTable& operator=(SwissHashTable&& movee) noexcept;
+
+		void clear();
+
+		void resize(Uptr newNumBuckets);
+
+		bool remove(Uptr hash, const Key& key);
+
+		const Bucket* getBucketForRead(Uptr hash, const Key& key) const;
+		Bucket* getBucketForModify(Uptr hash, const Key& key);
+		Bucket& getBucketForAdd(Uptr hash, const Key& key);
+
+		Uptr size() const { return numElements; }
+		Uptr numBuckets() const { return hashToBucketIndexMask + 1; }
+
+		Bucket* getBuckets() const { return buckets; }
+
+		// Compute some statistics about the space usage of this hash table. The probe count of an
+		// element is the number of groups that are searched to find it.
+		void analyzeSpaceUsage(Uptr& outTotalMemoryBytes,
+							   Uptr& outMaxProbeCount,
+							   F32& outOccupancy,
+							   F32& outAverageProbeCount) const;
+
+	private:
+		Bucket* buckets;
+		U8* controlBytes;
+		Uptr numElements;
+		Uptr numDeletedBuckets;
+		Uptr hashToBucketIndexMask;
+
+		static U8 getHashControl(Uptr hash) { return U8(hash & 0x7f); }
+		Uptr getFirstGroupIndex(Uptr hash) const { return (hash >> 7) & hashToBucketIndexMask; }
+
+		void setControl(Uptr bucketIndex, U8 control);
+		Uptr findBucketIndex(Uptr hashAndOccupancy, const Key& key) const;
+		Uptr findEmptyOrDeletedBucketIndex(Uptr hash) const;
+
+		void destruct();
+		void copyFrom(const SwissHashTable& copy);
+		void moveFrom(SwissHashTable&& movee) noexcept;
+	};
+
+	// Selects the hash table implementation used by HashMap and HashSet.
+	template<typename AllocPolicy = DefaultHashTableAllocPolicy>
+	struct RobinHoodHashTableImplPolicy
+	{
+		template<typename Key, typename Element, typename HashTablePolicy>
+		using Table = HashTable<Key, Element, HashTablePolicy, AllocPolicy>;
+	};
+	template<typename AllocPolicy = DefaultHashTableAllocPolicy> struct SwissHashTableImplPolicy
+	{
+		template<typename Key, typename Element, typename HashTablePolicy>
+		using Table = SwissHashTable<Key, Element, HashTablePolicy, AllocPolicy>;
+	};
+
 // The implementation is defined in a separate file.
 #include "Impl/HashTableImpl.h"
+#include "Impl/SwissHashTableImpl.h"
 }
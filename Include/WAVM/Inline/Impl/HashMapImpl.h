@@ -3,8 +3,9 @@
 
 // Use these macros to compress the boilerplate template declarations in a non-inline member
 // function definition for HashMap.
-#define HASHMAP_PARAMETERS typename Key, typename Value, typename KeyHashPolicy
-#define HASHMAP_ARGUMENTS Key, Value, KeyHashPolicy
+#define HASHMAP_PARAMETERS                                                                         \
+	typename Key, typename Value, typename KeyHashPolicy, typename TableImplPolicy
+#define HASHMAP_ARGUMENTS Key, Value, KeyHashPolicy, TableImplPolicy
 
 template<HASHMAP_PARAMETERS>
 HashMap<HASHMAP_ARGUMENTS>::HashMap(Uptr reserveNumPairs) : table(reserveNumPairs)
@@ -1,6 +1,11 @@
 // IWYU pragma: private, include "WAVM/Inline/HashSet.h"
 // You should only include this file indirectly by including HashMap.h.
 
+// Use these macros to compress the boilerplate template declarations in a non-inline member
+// function definition for HashSet.
+#define HASHSET_PARAMETERS typename Element, typename ElementHashPolicy, typename TableImplPolicy
+#define HASHSET_ARGUMENTS Element, ElementHashPolicy, TableImplPolicy
+
 template<typename Element> bool HashSetIterator<Element>::operator!=(const HashSetIterator& other)
 {
 	return bucket != other.bucket;
@@ -43,13 +48,13 @@ HashSetIterator<Element>::HashSetIterator(const HashTableBucket<Element>* inBuck
 {
 }
 
-template<typename Element, typename ElementHashPolicy>
-HashSet<Element, ElementHashPolicy>::HashSet(Uptr reserveNumElements) : table(reserveNumElements)
+template<HASHSET_PARAMETERS>
+HashSet<HASHSET_ARGUMENTS>::HashSet(Uptr reserveNumElements) : table(reserveNumElements)
 {
 }
 
-template<typename Element, typename ElementHashPolicy>
-HashSet<Element, ElementHashPolicy>::HashSet(const std::initializer_list<Element>& initializerList)
+template<HASHSET_PARAMETERS>
+HashSet<HASHSET_ARGUMENTS>::HashSet(const std::initializer_list<Element>& initializerList)
 : table(initializerList.size())
 {
 	for(const Element& element : initializerList)
@@ -59,8 +64,8 @@ HashSet<Element, ElementHashPolicy>::HashSet(const std::initializer_list<Element
 	}
 }
 
-template<typename Element, typename ElementHashPolicy>
-bool HashSet<Element, ElementHashPolicy>::add(const Element& element)
+template<HASHSET_PARAMETERS>
+bool HashSet<HASHSET_ARGUMENTS>::add(const Element& element)
 {
 	const Uptr hash = ElementHashPolicy::getKeyHash(element);
 	HashTableBucket<Element>& bucket = table.getBucketForAdd(hash, element);
@@ -73,8 +78,8 @@ bool HashSet<Element, ElementHashPolicy>::add(const Element& element)
 	}
 }
 
-template<typename Element, typename ElementHashPolicy>
-void HashSet<Element, ElementHashPolicy>::addOrFail(const Element& element)
+template<HASHSET_PARAMETERS>
+void HashSet<HASHSET_ARGUMENTS>::addOrFail(const Element& element)
 {
 	const Uptr hash = ElementHashPolicy::getKeyHash(element);
 	HashTableBucket<Element>& bucket = table.getBucketForAdd(hash, element);
@@ -83,21 +88,21 @@ void HashSet<Element, ElementHashPolicy>::addOrFail(const Element& element)
 	bucket.storage.construct(element);
 }
 
-template<typename Element, typename ElementHashPolicy>
-bool HashSet<Element, ElementHashPolicy>::remove(const Element& element)
+template<HASHSET_PARAMETERS>
+bool HashSet<HASHSET_ARGUMENTS>::remove(const Element& element)
 {
 	return table.remove(ElementHashPolicy::getKeyHash(element), element);
 }
 
-template<typename Element, typename ElementHashPolicy>
-void HashSet<Element, ElementHashPolicy>::removeOrFail(const Element& element)
+template<HASHSET_PARAMETERS>
+void HashSet<HASHSET_ARGUMENTS>::removeOrFail(const Element& element)
 {
 	const bool removed = table.remove(ElementHashPolicy::getKeyHash(element), element);
 	WAVM_ASSERT(removed);
 }
 
-template<typename Element, typename ElementHashPolicy>
-const Element& HashSet<Element, ElementHashPolicy>::operator[](const Element& element) const
+template<HASHSET_PARAMETERS>
+const Element& HashSet<HASHSET_ARGUMENTS>::operator[](const Element& element) const
 {
 	const Uptr hash = ElementHashPolicy::getKeyHash(element);
 	const HashTableBucket<Element>* bucket = table.getBucketForRead(hash, element);
@@ -112,8 +117,8 @@ const Element& HashSet<Element, ElementHashPolicy>::operator[](const Element& el
 	return bucket->storage.get();
 }
 
-template<typename Element, typename ElementHashPolicy>
-bool HashSet<Element, ElementHashPolicy>::contains(const Element& element) const
+template<HASHSET_PARAMETERS>
+bool HashSet<HASHSET_ARGUMENTS>::contains(const Element& element) const
 {
 	const Uptr hash = ElementHashPolicy::getKeyHash(element);
 	const HashTableBucket<Element>* bucket = table.getBucketForRead(hash, element);
@@ -122,8 +127,8 @@ bool HashSet<Element, ElementHashPolicy>::contains(const Element& element) const
 	return bucket != nullptr;
 }
 
-template<typename Element, typename ElementHashPolicy>
-const Element* HashSet<Element, ElementHashPolicy>::get(const Element& element) const
+template<HASHSET_PARAMETERS>
+const Element* HashSet<HASHSET_ARGUMENTS>::get(const Element& element) const
 {
 	const Uptr hash = ElementHashPolicy::getKeyHash(element);
 	const HashTableBucket<Element>* bucket = table.getBucketForRead(hash, element);
@@ -135,14 +140,14 @@ const Element* HashSet<Element, ElementHashPolicy>::get(const Element& element)
 	}
 }
 
-template<typename Element, typename ElementHashPolicy>
-void HashSet<Element, ElementHashPolicy>::clear()
+template<HASHSET_PARAMETERS>
+void HashSet<HASHSET_ARGUMENTS>::clear()
 {
 	table.clear();
 }
 
-template<typename Element, typename ElementHashPolicy>
-HashSetIterator<Element> HashSet<Element, ElementHashPolicy>::begin() const
+template<HASHSET_PARAMETERS>
+HashSetIterator<Element> HashSet<HASHSET_ARGUMENTS>::begin() const
 {
 	// Find the first occupied bucket.
 	HashTableBucket<Element>* beginBucket = table.getBuckets();
@@ -151,21 +156,21 @@ HashSetIterator<Element> HashSet<Element, ElementHashPolicy>::begin() const
 	return HashSetIterator<Element>(beginBucket, endBucket);
 }
 
-template<typename Element, typename ElementHashPolicy>
-HashSetIterator<Element> HashSet<Element, ElementHashPolicy>::end() const
+template<HASHSET_PARAMETERS>
+HashSetIterator<Element> HashSet<HASHSET_ARGUMENTS>::end() const
 {
 	return HashSetIterator<Element>(table.getBuckets() + table.numBuckets(),
 									table.getBuckets() + table.numBuckets());
 }
 
-template<typename Element, typename ElementHashPolicy>
-Uptr HashSet<Element, ElementHashPolicy>::size() const
+template<HASHSET_PARAMETERS>
+Uptr HashSet<HASHSET_ARGUMENTS>::size() const
 {
 	return table.size();
 }
 
-template<typename Element, typename ElementHashPolicy>
-void HashSet<Element, ElementHashPolicy>::analyzeSpaceUsage(Uptr& outTotalMemoryBytes,
+template<HASHSET_PARAMETERS>
+void HashSet<HASHSET_ARGUMENTS>::analyzeSpaceUsage(Uptr& outTotalMemoryBytes,
 															Uptr& outMaxProbeCount,
 															F32& outOccupancy,
 															F32& outAverageProbeCount) const
@@ -173,3 +178,6 @@ void HashSet<Element, ElementHashPolicy>::analyzeSpaceUsage(Uptr& outTotalMemory
 	return table.analyzeSpaceUsage(
 		outTotalMemoryBytes, outMaxProbeCount, outOccupancy, outAverageProbeCount);
 }
+
+#undef HASHSET_PARAMETERS
+#undef HASHSET_ARGUMENTS
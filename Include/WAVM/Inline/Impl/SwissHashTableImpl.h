@@ -0,0 +1,365 @@
+// IWYU pragma: private, include "WAVM/Inline/HashTable.h"
+// You should only include this file indirectly by including HashMap.h.
+
+// Use these macros to compress the boilerplate template declarations in a non-inline member
+// function definition for SwissHashTable.
+#define SWISSHASHTABLE_PARAMETERS                                                                  \
+	typename Key, typename Element, typename HashTablePolicy, typename AllocPolicy
+#define SWISSHASHTABLE_ARGUMENTS Key, Element, HashTablePolicy, AllocPolicy
+
+template<SWISSHASHTABLE_PARAMETERS>
+void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::setControl(Uptr bucketIndex, U8 control)
+{
+	controlBytes[bucketIndex] = control;
+
+	// Update the copies of the control byte that follow the last bucket. If the table has fewer
+	// buckets than a group, there may be more than one copy.
+	for(Uptr copyIndex = bucketIndex + numBuckets(); copyIndex < numBuckets() + Group::numBytes - 1;
+		copyIndex += numBuckets())
+	{ controlBytes[copyIndex] = control; }
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+Uptr SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::findBucketIndex(Uptr hashAndOccupancy,
+															   const Key& key) const
+{
+	if(!buckets) { return UINTPTR_MAX; }
+
+	const U8 hashControl = getHashControl(hashAndOccupancy);
+	Uptr groupIndex = getFirstGroupIndex(hashAndOccupancy);
+	Uptr stride = 0;
+	while(true)
+	{
+		const Group group(controlBytes + groupIndex);
+
+		// Check the buckets in the group whose control byte matches the key's.
+		for(U64 matches = group.match(hashControl); matches; matches &= matches - 1)
+		{
+			const Uptr bucketIndex
+				= (groupIndex + (countTrailingZeroes(matches) >> Group::slotShift))
+				  & hashToBucketIndexMask;
+			const Bucket& bucket = buckets[bucketIndex];
+			if(bucket.hashAndOccupancy == hashAndOccupancy
+			   && HashTablePolicy::areKeysEqual(HashTablePolicy::getKey(bucket.storage.get()), key))
+			{ return bucketIndex; }
+		}
+
+		// If the group contains an empty bucket, the key would have been inserted there, so the
+		// table doesn't contain the key.
+		if(group.matchEmpty()) { return UINTPTR_MAX; }
+
+		// Otherwise, continue to the next group in the probe sequence. Adding an increasing
+		// multiple of the group size visits every group in a power-of-two sized table.
+		stride += Group::numBytes;
+		groupIndex = (groupIndex + stride) & hashToBucketIndexMask;
+		WAVM_ASSERT(stride <= numBuckets() + Group::numBytes);
+	};
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+Uptr SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::findEmptyOrDeletedBucketIndex(Uptr hash) const
+{
+	WAVM_ASSERT(buckets);
+
+	Uptr groupIndex = getFirstGroupIndex(hash);
+	Uptr stride = 0;
+	while(true)
+	{
+		const U64 matches = Group(controlBytes + groupIndex).matchEmptyOrDeleted();
+		if(matches)
+		{
+			return (groupIndex + (countTrailingZeroes(matches) >> Group::slotShift))
+				   & hashToBucketIndexMask;
+		}
+
+		stride += Group::numBytes;
+		groupIndex = (groupIndex + stride) & hashToBucketIndexMask;
+		WAVM_ASSERT(stride <= numBuckets() + Group::numBytes);
+	};
+}
+
+template<SWISSHASHTABLE_PARAMETERS> void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::clear()
+{
+	destruct();
+	buckets = nullptr;
+	controlBytes = nullptr;
+	numElements = 0;
+	numDeletedBuckets = 0;
+	hashToBucketIndexMask = UINTPTR_MAX;
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::resize(Uptr newNumBuckets)
+{
+	WAVM_ASSERT(!(newNumBuckets & (newNumBuckets - 1)));
+
+	const Uptr oldNumBuckets = numBuckets();
+	Bucket* oldBuckets = buckets;
+	U8* oldControlBytes = controlBytes;
+
+	if(!newNumBuckets)
+	{
+		WAVM_ASSERT(!numElements);
+		buckets = nullptr;
+		controlBytes = nullptr;
+	}
+	else
+	{
+		// Allocate the new buckets, and initialize their control bytes to empty.
+		buckets = new Bucket[newNumBuckets]();
+		controlBytes = new U8[newNumBuckets + Group::numBytes - 1];
+		memset(controlBytes, Group::emptyControl, newNumBuckets + Group::numBytes - 1);
+	}
+
+	hashToBucketIndexMask = newNumBuckets - 1;
+	numDeletedBuckets = 0;
+
+	if(oldBuckets)
+	{
+		// Iterate over the old buckets, and reinsert their contents in the new buckets.
+		for(Uptr bucketIndex = 0; numElements && bucketIndex < oldNumBuckets; ++bucketIndex)
+		{
+			Bucket& oldBucket = oldBuckets[bucketIndex];
+			if(oldBucket.hashAndOccupancy)
+			{
+				// Move the element from the old bucket to the new.
+				const Uptr newBucketIndex
+					= findEmptyOrDeletedBucketIndex(oldBucket.hashAndOccupancy);
+				Bucket& newBucket = buckets[newBucketIndex];
+				setControl(newBucketIndex, getHashControl(oldBucket.hashAndOccupancy));
+				newBucket.storage.construct(std::move(oldBucket.storage.get()));
+				newBucket.hashAndOccupancy = oldBucket.hashAndOccupancy;
+				oldBucket.storage.destruct();
+				oldBucket.hashAndOccupancy = 0;
+			}
+		}
+
+		// Free the old buckets.
+		delete[] oldBuckets;
+		delete[] oldControlBytes;
+	}
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+bool SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::remove(Uptr hash, const Key& key)
+{
+	// Find the bucket (if any) holding the key.
+	const Uptr bucketIndex = findBucketIndex(hash | Bucket::isOccupiedMask, key);
+	if(bucketIndex == UINTPTR_MAX) { return false; }
+	else
+	{
+		// Remove the element in the bucket, and mark the bucket as deleted so searches for the
+		// elements after it in the probe sequence don't stop at it.
+		Bucket& bucket = buckets[bucketIndex];
+		bucket.storage.destruct();
+		bucket.hashAndOccupancy = 0;
+		setControl(bucketIndex, Group::deletedControl);
+		++numDeletedBuckets;
+
+		// Decrease the number of elements and resize the table if the occupancy is too low.
+		--numElements;
+		const Uptr maxDesiredBuckets = AllocPolicy::getMaxDesiredBuckets(numElements);
+		if(numBuckets() > maxDesiredBuckets) { resize(maxDesiredBuckets); }
+
+		return true;
+	}
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+const HashTableBucket<Element>* SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::getBucketForRead(
+	Uptr hash,
+	const Key& key) const
+{
+	const Uptr bucketIndex = findBucketIndex(hash | Bucket::isOccupiedMask, key);
+	return bucketIndex == UINTPTR_MAX ? nullptr : &buckets[bucketIndex];
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+HashTableBucket<Element>* SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::getBucketForModify(
+	Uptr hash,
+	const Key& key)
+{
+	return const_cast<Bucket*>(getBucketForRead(hash, key));
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+HashTableBucket<Element>& SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::getBucketForAdd(
+	Uptr hash,
+	const Key& key)
+{
+	// If the table already contains the key, return its bucket.
+	const Uptr hashAndOccupancy = hash | Bucket::isOccupiedMask;
+	const Uptr existingBucketIndex = findBucketIndex(hashAndOccupancy, key);
+	if(existingBucketIndex != UINTPTR_MAX) { return buckets[existingBucketIndex]; }
+
+	// Make sure there's enough space to add a new key to the table. Deleted buckets count as
+	// occupied, since they don't end a search. If removing the deleted buckets would make enough
+	// space, the table is rehashed without growing it.
+	if(numBuckets() < AllocPolicy::getMinDesiredBuckets(numElements + numDeletedBuckets + 1))
+	{
+		const Uptr minDesiredBuckets = AllocPolicy::getMinDesiredBuckets(numElements + 1);
+		resize(numBuckets() < minDesiredBuckets ? minDesiredBuckets : numBuckets());
+	}
+
+	// Find the first empty or deleted bucket in the key's probe sequence. The caller is expected
+	// to fill the bucket once this function returns.
+	const Uptr bucketIndex = findEmptyOrDeletedBucketIndex(hashAndOccupancy);
+	if(controlBytes[bucketIndex] == Group::deletedControl) { --numDeletedBuckets; }
+	setControl(bucketIndex, getHashControl(hashAndOccupancy));
+	++numElements;
+
+	WAVM_ASSERT(!buckets[bucketIndex].hashAndOccupancy);
+	return buckets[bucketIndex];
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::analyzeSpaceUsage(Uptr& outTotalMemoryBytes,
+																 Uptr& outMaxProbeCount,
+																 F32& outOccupancy,
+																 F32& outAverageProbeCount) const
+{
+	outTotalMemoryBytes = sizeof(*this);
+	if(buckets)
+	{ outTotalMemoryBytes += (sizeof(Bucket) + 1) * numBuckets() + Group::numBytes - 1; }
+	outOccupancy = size() / F32(numBuckets());
+
+	outMaxProbeCount = 0;
+	outAverageProbeCount = 0.0f;
+	for(Uptr bucketIndex = 0; buckets && bucketIndex < numBuckets(); ++bucketIndex)
+	{
+		const Uptr hashAndOccupancy = buckets[bucketIndex].hashAndOccupancy;
+		if(!hashAndOccupancy) { continue; }
+
+		// Count the groups in the element's probe sequence up to the one that contains it.
+		Uptr groupIndex = getFirstGroupIndex(hashAndOccupancy);
+		Uptr stride = 0;
+		Uptr probeCount = 1;
+		while(((bucketIndex - groupIndex) & hashToBucketIndexMask) >= Group::numBytes)
+		{
+			stride += Group::numBytes;
+			groupIndex = (groupIndex + stride) & hashToBucketIndexMask;
+			++probeCount;
+		};
+
+		outMaxProbeCount = probeCount > outMaxProbeCount ? probeCount : outMaxProbeCount;
+		outAverageProbeCount += probeCount / F32(size());
+	}
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::SwissHashTable(Uptr estimatedNumElements)
+: buckets(nullptr)
+, controlBytes(nullptr)
+, numElements(0)
+, numDeletedBuckets(0)
+, hashToBucketIndexMask(UINTPTR_MAX)
+{
+	const Uptr numBuckets = AllocPolicy::getMinDesiredBuckets(estimatedNumElements);
+	if(numBuckets) { resize(numBuckets); }
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::SwissHashTable(const SwissHashTable& copy)
+{
+	copyFrom(copy);
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::SwissHashTable(SwissHashTable&& movee) noexcept
+{
+	moveFrom(std::move(movee));
+}
+
+template<SWISSHASHTABLE_PARAMETERS> SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::~SwissHashTable()
+{
+	destruct();
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+SwissHashTable<SWISSHASHTABLE_ARGUMENTS>& SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::operator=(
+	const SwissHashTable<SWISSHASHTABLE_ARGUMENTS>& copyee)
+{
+	// Do nothing if copying from this.
+	if(this != &copyee)
+	{
+		destruct();
+		copyFrom(copyee);
+	}
+	return *this;
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+SwissHashTable<SWISSHASHTABLE_ARGUMENTS>& SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::operator=(
+	SwissHashTable<SWISSHASHTABLE_ARGUMENTS>&& movee) noexcept
+{
+	// Do nothing if moving from this.
+	if(this != &movee)
+	{
+		destruct();
+		moveFrom(std::move(movee));
+	}
+	return *this;
+}
+
+template<SWISSHASHTABLE_PARAMETERS> void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::destruct()
+{
+	if(buckets)
+	{
+		for(Uptr bucketIndex = 0; bucketIndex < numBuckets(); ++bucketIndex)
+		{
+			if(buckets[bucketIndex].hashAndOccupancy) { buckets[bucketIndex].storage.destruct(); }
+		}
+
+		delete[] buckets;
+		delete[] controlBytes;
+		buckets = nullptr;
+		controlBytes = nullptr;
+	}
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::copyFrom(const SwissHashTable& copy)
+{
+	numElements = copy.numElements;
+	numDeletedBuckets = copy.numDeletedBuckets;
+	hashToBucketIndexMask = copy.hashToBucketIndexMask;
+
+	if(!copy.buckets)
+	{
+		buckets = nullptr;
+		controlBytes = nullptr;
+	}
+	else
+	{
+		const Uptr numControlBytes = copy.numBuckets() + Group::numBytes - 1;
+		controlBytes = new U8[numControlBytes];
+		memcpy(controlBytes, copy.controlBytes, numControlBytes);
+
+		buckets = new Bucket[copy.numBuckets()];
+		for(Uptr bucketIndex = 0; bucketIndex < numBuckets(); ++bucketIndex)
+		{
+			buckets[bucketIndex].hashAndOccupancy = copy.buckets[bucketIndex].hashAndOccupancy;
+			if(buckets[bucketIndex].hashAndOccupancy)
+			{ buckets[bucketIndex].storage.construct(copy.buckets[bucketIndex].storage.get()); }
+		}
+	}
+}
+
+template<SWISSHASHTABLE_PARAMETERS>
+void SwissHashTable<SWISSHASHTABLE_ARGUMENTS>::moveFrom(SwissHashTable&& movee) noexcept
+{
+	numElements = movee.numElements;
+	numDeletedBuckets = movee.numDeletedBuckets;
+	hashToBucketIndexMask = movee.hashToBucketIndexMask;
+	buckets = movee.buckets;
+	controlBytes = movee.controlBytes;
+
+	movee.numElements = 0;
+	movee.numDeletedBuckets = 0;
+	movee.hashToBucketIndexMask = UINTPTR_MAX;
+	movee.buckets = nullptr;
+	movee.controlBytes = nullptr;
+}
+
+#undef SWISSHASHTABLE_PARAMETERS
+#undef SWISSHASHTABLE_ARGUMENTS
@@ -1,104 +1,117 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
-#include "WAVM/Inline/HashMap.h"
 
 namespace WAVM {
 	// A map that's somewhere between an array and a HashMap.
-	// It's keyed by a range of integers, but sparsely maps those integers to elements.
+	// It's keyed by a range of integers, but sparsely maps those integers to elements. The elements
+	// are stored in an array of slots indexed by (index - minIndex), and the unallocated slots are
+	// linked into a free list, so adding and removing elements take O(1) time, and iterating over
+	// the elements walks the slot array in index order.
+	// Freed indices are reused immediately, most recently freed first, so an index must not be used
+	// to refer to an element after the element is removed.
 	template<typename Index, typename Element> struct IndexMap
 	{
-		IndexMap(Index inMinIndex, Index inMaxIndex)
-		: lastIndex(inMinIndex - 1), minIndex(inMinIndex), maxIndex(inMaxIndex)
+		IndexMap(Index inMinIndex, Index inMaxIndex) : minIndex(inMinIndex), maxIndex(inMaxIndex)
 		{
 			WAVM_ASSERT(maxIndex >= minIndex);
 		}
 
-		// Allocates an index, and adds the element to the map. Indices are allocated sequentially,
-		// starting at minIndex, and wrapping back to minIndex after maxIndex. After the allocator
-		// has wrapped back to previously allocated indices, indices are probed sequentially until
-		// an unallocated one is found. Because of this, it takes O(N) time to add an element. If an
-		// index couldn't be allocated, returns false. Otherwise, returns true and the index the
-		// element was allocated at is written to the outIndex argument.
+		// Allocates an index, and adds the element to the map. The most recently freed index is
+		// reused if there is one, and otherwise the index after the highest index allocated so
+		// far. If all indices in the map's range are allocated, returns failIndex. Otherwise,
+		// returns the index the element was allocated at.
 		template<typename... Args> Index add(Index failIndex, Args&&... args)
 		{
-			// If all possible indices are allocated, return failure.
-			if(map.size() >= Uptr(maxIndex - minIndex + 1)) { return failIndex; }
-
-			// Starting from the index after the last index to be allocated, check indices
-			// sequentially until one is found that isn't allocated.
-			do
+			Uptr slotIndex = firstFreeSlotIndex;
+			if(slotIndex == invalidSlotIndex)
 			{
-				++lastIndex;
-				if(lastIndex > maxIndex) { lastIndex = minIndex; }
-			} while(map.contains(lastIndex));
+				// If all possible indices are allocated, return failure.
+				if(slots.size() >= getNumIndices()) { return failIndex; }
 
-			// Add the element to the map with the given index.
-			WAVM_ASSERT(lastIndex >= minIndex);
-			WAVM_ASSERT(lastIndex <= maxIndex);
-			map.addOrFail(lastIndex, std::forward<Args>(args)...);
+				slotIndex = slots.size();
+				slots.emplace_back();
+			}
+			else
+			{
+				unlinkFreeSlot(slotIndex);
+			}
 
-			return lastIndex;
+			allocateSlot(slotIndex, std::forward<Args>(args)...);
+			return Index(minIndex + slotIndex);
 		}
 
 		// Inserts an element at a specific index. If the index is already allocated, asserts.
+		// Inserting past the highest index allocated so far adds a free slot for each index in
+		// between, so it takes time and memory proportional to the distance between them. Callers
+		// only insert at small indices, e.g. the WASI stdio and preopened fds.
 		template<typename... Args> void insertOrFail(Index index, Args&&... args)
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			map.addOrFail(index, std::forward<Args>(args)...);
+			const Uptr slotIndex = getSlotIndex(index);
+
+			// Add free slots up to the inserted index.
+			while(slots.size() <= slotIndex)
+			{
+				slots.emplace_back();
+				linkFreeSlot(slots.size() - 1);
+			}
+
+			WAVM_ERROR_UNLESS(!slots[slotIndex].isAllocated);
+			unlinkFreeSlot(slotIndex);
+			allocateSlot(slotIndex, std::forward<Args>(args)...);
 		}
 
 		// Removes an element by index. If there wasn't an allocated at the specified index,
 		// asserts.
 		void removeOrFail(Index index)
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			map.removeOrFail(index);
+			const Uptr slotIndex = getSlotIndex(index);
+			WAVM_ERROR_UNLESS(slotIndex < slots.size() && slots[slotIndex].isAllocated);
+
+			// Release the element's resources now, rather than when the slot is reused.
+			Slot& slot = slots[slotIndex];
+			slot.element = Element();
+			slot.isAllocated = false;
+			linkFreeSlot(slotIndex);
+			--numElements;
 		}
 
 		// Returns whether the specified index is allocated.
 		bool contains(Index index) const
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			return map.contains(index);
+			const Uptr slotIndex = getSlotIndex(index);
+			return slotIndex < slots.size() && slots[slotIndex].isAllocated;
 		}
 
 		// Returns the element bound to the specified index. Behavior is undefined if the index
 		// isn't allocated.
 		const Element& operator[](Index index) const
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			return map[index];
+			WAVM_ASSERT(contains(index));
+			return slots[getSlotIndex(index)].element;
 		}
 		Element& operator[](Index index)
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			WAVM_ASSERT(map.contains(index));
-			return map.getOrAdd(index);
+			WAVM_ASSERT(contains(index));
+			return slots[getSlotIndex(index)].element;
 		}
 
 		// Returns a pointer to the element bound to the specified index, or null if the index isn't
 		// allocated.
 		const Element* get(Index index) const
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			return map.get(index);
+			return contains(index) ? &slots[getSlotIndex(index)].element : nullptr;
 		}
 		Element* get(Index index)
 		{
-			WAVM_ASSERT(index >= minIndex);
-			WAVM_ASSERT(index <= maxIndex);
-			return map.get(index);
+			return contains(index) ? &slots[getSlotIndex(index)].element : nullptr;
 		}
 
 		// Returns the number of allocated index/element pairs.
-		Uptr size() const { return map.size(); }
+		Uptr size() const { return numElements; }
 
 		Index getMinIndex() const { return minIndex; }
 		Index getMaxIndex() const { return maxIndex; }
@@ -107,29 +120,107 @@ namespace WAVM {
 		{
 			template<typename, typename> friend struct IndexMap;
 
-			bool operator!=(const Iterator& other) { return mapIt != other.mapIt; }
-			bool operator==(const Iterator& other) { return mapIt == other.mapIt; }
-			operator bool() const { return bool(mapIt); }
-			void operator++() { ++mapIt; }
+			bool operator!=(const Iterator& other) { return slotIndex != other.slotIndex; }
+			bool operator==(const Iterator& other) { return slotIndex == other.slotIndex; }
+			operator bool() const { return slotIndex < map->slots.size(); }
+			void operator++()
+			{
+				++slotIndex;
+				skipFreeSlots();
+			}
 
-			Index getIndex() const { return mapIt->key; }
+			Index getIndex() const { return Index(map->minIndex + slotIndex); }
 
-			const Element& operator*() const { return mapIt->value; }
-			const Element* operator->() const { return &mapIt->value; }
+			const Element& operator*() const { return map->slots[slotIndex].element; }
+			const Element* operator->() const { return &map->slots[slotIndex].element; }
 
 		private:
-			HashMapIterator<Index, Element> mapIt;
+			const IndexMap* map;
+			Uptr slotIndex;
+
+			Iterator(const IndexMap* inMap, Uptr inSlotIndex) : map(inMap), slotIndex(inSlotIndex)
+			{
+				skipFreeSlots();
+			}
 
-			Iterator(HashMapIterator<Index, Element>&& inMapIt) : mapIt(inMapIt) {}
+			void skipFreeSlots()
+			{
+				while(slotIndex < map->slots.size() && !map->slots[slotIndex].isAllocated)
+				{ ++slotIndex; }
+			}
 		};
 
-		Iterator begin() const { return Iterator(map.begin()); }
-		Iterator end() const { return Iterator(map.end()); }
+		Iterator begin() const { return Iterator(this, 0); }
+		Iterator end() const { return Iterator(this, slots.size()); }
 
 	private:
-		Index lastIndex;
+		static constexpr Uptr invalidSlotIndex = UINTPTR_MAX;
+
+		struct Slot
+		{
+			Element element;
+
+			// While the slot is free, the previous and next slots in the free list.
+			Uptr prevFreeSlotIndex = invalidSlotIndex;
+			Uptr nextFreeSlotIndex = invalidSlotIndex;
+
+			bool isAllocated = false;
+		};
+
 		Index minIndex;
 		Index maxIndex;
-		HashMap<Index, Element> map;
+		std::vector<Slot> slots;
+		Uptr firstFreeSlotIndex = invalidSlotIndex;
+		Uptr numElements = 0;
+
+		Uptr getNumIndices() const
+		{
+			const Uptr maxSlotIndex = Uptr(maxIndex - minIndex);
+			return maxSlotIndex == UINTPTR_MAX ? UINTPTR_MAX : maxSlotIndex + 1;
+		}
+
+		Uptr getSlotIndex(Index index) const
+		{
+			WAVM_ASSERT(index >= minIndex);
+			WAVM_ASSERT(index <= maxIndex);
+			return Uptr(index - minIndex);
+		}
+
+		template<typename... Args> void allocateSlot(Uptr slotIndex, Args&&... args)
+		{
+			Slot& slot = slots[slotIndex];
+			slot.element = Element(std::forward<Args>(args)...);
+			slot.isAllocated = true;
+			++numElements;
+		}
+
+		// Adds a free slot to the front of the free list, so it is the next slot to be reused.
+		void linkFreeSlot(Uptr slotIndex)
+		{
+			Slot& slot = slots[slotIndex];
+			slot.prevFreeSlotIndex = invalidSlotIndex;
+			slot.nextFreeSlotIndex = firstFreeSlotIndex;
+			if(firstFreeSlotIndex != invalidSlotIndex)
+			{ slots[firstFreeSlotIndex].prevFreeSlotIndex = slotIndex; }
+			firstFreeSlotIndex = slotIndex;
+		}
+
+		void unlinkFreeSlot(Uptr slotIndex)
+		{
+			Slot& slot = slots[slotIndex];
+			if(slot.prevFreeSlotIndex == invalidSlotIndex)
+			{
+				WAVM_ASSERT(firstFreeSlotIndex == slotIndex);
+				firstFreeSlotIndex = slot.nextFreeSlotIndex;
+			}
+			else
+			{
+				slots[slot.prevFreeSlotIndex].nextFreeSlotIndex = slot.nextFreeSlotIndex;
+			}
+			if(slot.nextFreeSlotIndex != invalidSlotIndex)
+			{ slots[slot.nextFreeSlotIndex].prevFreeSlotIndex = slot.prevFreeSlotIndex; }
+			slot.prevFreeSlotIndex = invalidSlotIndex;
+			slot.nextFreeSlotIndex = invalidSlotIndex;
+		}
 	};
 }
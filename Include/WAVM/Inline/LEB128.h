@@ -1,7 +1,15 @@
 #pragma once
 
+#include <string.h>
+#include <vector>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Serialization.h"
+#include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Intrinsic.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 
 namespace WAVM { namespace Serialization {
 	// LEB128 variable-length integer serialization.
@@ -34,11 +42,13 @@ namespace WAVM { namespace Serialization {
 		};
 	}
 
+	// Decodes a LEB128 value a byte at a time. This handles the values that serializeVarInt can't
+	// decode from a single 8-byte load, and throws the exceptions for malformed values.
 	template<typename Value, Uptr maxBits>
-	WAVM_FORCEINLINE void serializeVarInt(InputStream& stream,
-										  Value& value,
-										  Value minValue,
-										  Value maxValue)
+	WAVM_FORCENOINLINE void serializeVarIntByBytes(InputStream& stream,
+												   Value& value,
+												   Value minValue,
+												   Value maxValue)
 	{
 		// First, read the variable number of input bytes into a fixed size buffer.
 		static constexpr Uptr maxBytes = (maxBits + 6) / 7;
@@ -99,6 +109,85 @@ namespace WAVM { namespace Serialization {
 		}
 	}
 
+	template<typename Value, Uptr maxBits>
+	WAVM_FORCEINLINE void serializeVarInt(InputStream& stream,
+										  Value& value,
+										  Value minValue,
+										  Value maxValue)
+	{
+		static constexpr Uptr maxBytes = (maxBits + 6) / 7;
+		static constexpr Uptr numUsedBitsInLastByte = maxBits - (maxBytes - 1) * 7;
+		static constexpr U8 lastByteUsedMask = U8(1 << numUsedBitsInLastByte) - U8(1);
+
+		// If there are at least 8 bytes buffered, load them at once, and decode the value without a
+		// loop over its bytes if it ends within them and is well-formed and in range. Otherwise,
+		// decode it a byte at a time. The fast path assumes the first byte is the least significant
+		// byte of the loaded word, so big-endian hosts always use the byte loop.
+#if WAVM_LITTLE_ENDIAN
+		if(const U8* bufferedBytes = stream.peekBuffered(8))
+		{
+			U64 word;
+			memcpy(&word, bufferedBytes, sizeof(word));
+
+			// The value ends at the first byte with its high bit clear. Most values are a single
+			// byte, so check for that before finding the last byte of a longer value.
+			Uptr numBytes = 1;
+			U64 bits = word & 0x7f;
+			U8 lastByte = U8(bits);
+			if(word & 0x80)
+			{
+				const U64 lastByteMask = ~word & 0x8080808080808080ull;
+				numBytes = Uptr(countTrailingZeroes(lastByteMask) / 8 + 1);
+
+				// Clear the bytes following the value, then concatenate the 7-bit groups of the
+				// value's bytes. If the value doesn't end in the 8 bytes, numBytes is 9, so the
+				// shifts are masked to keep them in range, and the value is rejected below.
+				bits = word & (~U64(0) >> (((8 - numBytes) & 7) * 8));
+				lastByte = U8(bits >> (((numBytes - 1) & 7) * 8));
+#if defined(__BMI2__)
+				bits = _pext_u64(bits, 0x7f7f7f7f7f7f7f7full);
+#else
+				bits &= 0x7f7f7f7f7f7f7f7full;
+				bits = (bits & 0x007f007f007f007full) | ((bits & 0x7f007f007f007f00ull) >> 1);
+				bits = (bits & 0x00003fff00003fffull) | ((bits & 0x3fff00003fff0000ull) >> 2);
+				bits = (bits & 0x000000000fffffffull) | ((bits & 0x0fffffff00000000ull) >> 4);
+#endif
+			}
+
+			if(numBytes <= maxBytes && numBytes <= 8)
+			{
+
+				// Sign extend the output integer to the full size of Value.
+				Value decodedValue = Value(bits);
+				const I8 signExtendShift = I8(sizeof(Value) * 8) - I8(numBytes * 7);
+				if(std::is_signed<Value>::value && signExtendShift > 0)
+				{ decodedValue = Value(decodedValue << signExtendShift) >> signExtendShift; }
+
+				// If the value has the maximum number of bytes, the unused bits in its last byte
+				// must be zero, or for signed values, copies of the last used bit.
+				bool isWellFormed = true;
+				if(numBytes == maxBytes)
+				{
+					const bool isLastUsedBitSet = (lastByte >> (numUsedBitsInLastByte - 1)) & 1;
+					const U8 expectedUnusedBits = std::is_signed<Value>::value && isLastUsedBitSet
+													  ? U8(~lastByteUsedMask & 0x7f)
+													  : 0;
+					isWellFormed = (lastByte & ~lastByteUsedMask) == expectedUnusedBits;
+				}
+
+				if(isWellFormed && decodedValue >= minValue && decodedValue <= maxValue)
+				{
+					stream.advance(numBytes);
+					value = decodedValue;
+					return;
+				}
+			}
+		}
+#endif
+
+		serializeVarIntByBytes<Value, maxBits>(stream, value, minValue, maxValue);
+	}
+
 	// Helpers for various common LEB128 parameters.
 	template<typename Stream, typename Value> void serializeVarUInt1(Stream& stream, Value& value)
 	{
@@ -132,4 +221,25 @@ namespace WAVM { namespace Serialization {
 	{
 		serializeVarInt<Value, 64>(stream, value, INT64_MIN, INT64_MAX);
 	}
+
+	// Serializes an array of LEB128 values that are each at most 32 bits. When deserializing, each
+	// element takes at least one byte, so the array is sized once from the number of elements
+	// instead of grown an element at a time, after checking the stream has enough bytes for it.
+	template<typename Value, typename Allocator>
+	void serializeVarUInt32Array(InputStream& stream, std::vector<Value, Allocator>& vector)
+	{
+		Uptr size = 0;
+		serializeVarUInt32(stream, size);
+		if(size > stream.capacity())
+		{ throw FatalSerializationException("expected data but found end of stream"); }
+		vector.resize(size);
+		for(Value& element : vector) { serializeVarUInt32(stream, element); }
+	}
+	template<typename Value, typename Allocator>
+	void serializeVarUInt32Array(OutputStream& stream, std::vector<Value, Allocator>& vector)
+	{
+		Uptr size = vector.size();
+		serializeVarUInt32(stream, size);
+		for(Value& element : vector) { serializeVarUInt32(stream, element); }
+	}
 }}
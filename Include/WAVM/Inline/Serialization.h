@@ -26,6 +26,13 @@ namespace WAVM { namespace Serialization {
 
 		Uptr capacity() const { return SIZE_MAX; }
 
+		// Writes bytes to the stream. Streams that write to a sink may override this to write
+		// large arrays of bytes to the sink without copying them to the stream's buffer.
+		virtual void writeBytes(const U8* bytes, Uptr numBytes)
+		{
+			memcpy(advance(numBytes), bytes, numBytes);
+		}
+
 		// Advances the stream cursor by numBytes, and returns a pointer to the previous stream
 		// cursor.
 		inline U8* advance(Uptr numBytes)
@@ -60,6 +67,23 @@ namespace WAVM { namespace Serialization {
 			return std::move(bytes);
 		}
 
+		// Copies the output to an array that is exactly as large as it, and resets the stream to
+		// write to the start of its buffer. This allows a stream to be reused for many small
+		// outputs without reallocating its buffer as it grows for each of them.
+		std::vector<U8> copyBytesAndReset()
+		{
+			std::vector<U8> result(bytes.data(), next ? next : bytes.data());
+			reset();
+			return result;
+		}
+
+		// Discards the output, and resets the stream to write to the start of its buffer.
+		void reset()
+		{
+			next = bytes.data();
+			end = bytes.data() + bytes.size();
+		}
+
 	private:
 		std::vector<U8> bytes;
 
@@ -104,6 +128,14 @@ namespace WAVM { namespace Serialization {
 			return next;
 		}
 
+		// Returns a pointer to the current stream cursor if there are at least numBytes following
+		// it in the current buffer, or nullptr if there aren't. Unlike peek, doesn't try to get
+		// more data.
+		inline const U8* peekBuffered(Uptr numBytes) const
+		{
+			return next && Uptr(end - next) >= numBytes ? next : nullptr;
+		}
+
 	protected:
 		const U8* next;
 		const U8* end;
@@ -131,9 +163,16 @@ namespace WAVM { namespace Serialization {
 	};
 
 	// Serialize raw byte sequences.
+	// Writes of at least this many bytes go through OutputStream::writeBytes.
+	static constexpr Uptr minDirectWriteBytes = 4096;
+
 	WAVM_FORCEINLINE void serializeBytes(OutputStream& stream, const U8* bytes, Uptr numBytes)
 	{
-		if(numBytes) { memcpy(stream.advance(numBytes), bytes, numBytes); }
+		if(numBytes >= minDirectWriteBytes) { stream.writeBytes(bytes, numBytes); }
+		else if(numBytes)
+		{
+			memcpy(stream.advance(numBytes), bytes, numBytes);
+		}
 	}
 	WAVM_FORCEINLINE void serializeBytes(InputStream& stream, U8* bytes, Uptr numBytes)
 	{
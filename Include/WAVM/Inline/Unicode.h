@@ -1,7 +1,17 @@
 #pragma once
 
+#include <string.h>
 #include "BasicTypes.h"
 #include "WAVM/Inline/Assert.h"
+#include "WAVM/Platform/Intrinsic.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define WAVM_UNICODE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define WAVM_UNICODE_NEON 1
+#endif
 
 namespace WAVM { namespace Unicode {
 	template<typename String> void encodeUTF8CodePoint(U32 codePoint, String& outString)
@@ -139,10 +149,49 @@ namespace WAVM { namespace Unicode {
 		}
 	}
 
+	static constexpr Uptr numASCIIBlockBytes = 16;
+
+	// Returns the number of ASCII characters at the start of a block of numASCIIBlockBytes bytes.
+	inline Uptr countLeadingASCIIChars(const U8* block)
+	{
+#if WAVM_UNICODE_SSE2
+		const U32 nonASCIIMask = U32(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)block)));
+		return nonASCIIMask ? countTrailingZeroes(nonASCIIMask) : numASCIIBlockBytes;
+#else
+#if WAVM_UNICODE_NEON
+		if(vmaxvq_u8(vld1q_u8(block)) < 0x80) { return numASCIIBlockBytes; }
+#endif
+		// Find the first byte with its high bit set, 8 bytes at a time.
+		U64 words[2];
+		memcpy(words, block, sizeof(words));
+		for(Uptr wordIndex = 0; wordIndex < 2; ++wordIndex)
+		{
+			const U64 nonASCIIBits = words[wordIndex] & 0x8080808080808080ull;
+			if(nonASCIIBits)
+			{ return wordIndex * 8 + Uptr(countTrailingZeroes(nonASCIIBits) / 8); }
+		}
+		return numASCIIBlockBytes;
+#endif
+	}
+
+	// Returns a pointer to the first character of the string that isn't part of a valid UTF-8
+	// sequence, or endChar if the whole string is valid.
 	inline const U8* validateUTF8String(const U8* nextChar, const U8* endChar)
 	{
-		U32 codePoint;
-		while(nextChar != endChar && decodeUTF8CodePoint(nextChar, endChar, codePoint)) {};
+		// Most strings are mostly or entirely ASCII, so skip blocks of ASCII characters with a
+		// vector comparison, and only decode the non-ASCII code points.
+		while(nextChar != endChar)
+		{
+			if(Uptr(endChar - nextChar) >= numASCIIBlockBytes)
+			{
+				const Uptr numASCIIChars = countLeadingASCIIChars(nextChar);
+				nextChar += numASCIIChars;
+				if(numASCIIChars == numASCIIBlockBytes) { continue; }
+			}
+
+			U32 codePoint;
+			if(!decodeUTF8CodePoint(nextChar, endChar, codePoint)) { break; }
+		}
 		return nextChar;
 	}
 
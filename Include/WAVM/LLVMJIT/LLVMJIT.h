@@ -1,9 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
 #include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
@@ -21,6 +23,7 @@ namespace WAVM { namespace Runtime {
 	struct ExceptionType;
 	struct Function;
 	struct Instance;
+	struct ObjectCacheInterface;
 }}
 
 namespace WAVM { namespace LLVMJIT {
@@ -28,6 +31,9 @@ namespace WAVM { namespace LLVMJIT {
 	struct TargetSpec
 	{
 		std::string triple;
+
+		// The LLVM name of the CPU, optionally followed by a comma-separated list of LLVM features
+		// to enable or disable, e.g. "generic,+lse".
 		std::string cpu;
 	};
 
@@ -58,18 +64,264 @@ namespace WAVM { namespace LLVMJIT {
 
 	WAVM_API Version getVersion();
 
+	// The tiers of code that compileModule can generate.
+	enum class CompileTier
+	{
+		// Code that is generated with as few optimizations as possible, to minimize compile time.
+		baseline,
+
+		// Code that is generated with all optimizations.
+		optimized,
+	};
+
+	// How much DWARF debug info compileModule emits for the generated code.
+	enum class DebugInfoLevel
+	{
+		// No debug info: traps and call stacks only identify the function, not the WebAssembly
+		// operator. This is the fastest to compile, and produces the smallest object code.
+		none,
+
+		// A line table that maps each machine instruction to the index of the WebAssembly operator
+		// it was generated from, which is all the runtime needs to attribute traps to operators.
+		lineTables,
+
+		// The line table, plus a description of each function's parameter types for debuggers.
+		full,
+	};
+
+	// Execution counts recorded by code compiled with CompileOptions::instrumentProfile. For each
+	// function definition, the first count is the number of times the function was entered, and
+	// it is followed by a pair of counts for each if and br_if in the function, in the order they
+	// occur in the function's code: the number of times the branch condition was true, and the
+	// number of times it was false.
+	struct ModuleProfile
+	{
+		std::vector<std::vector<U64>> functionDefCounts;
+	};
+
+	// Serializes a profile to a versioned binary format that is stable across WAVM versions that
+	// emit the same counters.
+	WAVM_API std::vector<U8> serializeProfile(const ModuleProfile& profile);
+
+	// Deserializes a profile written by serializeProfile. Returns false if the bytes are not a
+	// valid profile.
+	WAVM_API bool deserializeProfile(const std::vector<U8>& bytes, ModuleProfile& outProfile);
+
+	// Properties of an instance's imports that compileModule may compile into the code as constants.
+	// Object code compiled with a specialization may only be loaded for instances whose imports
+	// match it.
+	struct ModuleSpecialization
+	{
+		// For each global import, the imported global's value if it's an immutable number or
+		// vector, or a value of type none if its value isn't specialized.
+		std::vector<IR::Value> globalImportValues;
+
+		// For each memory import, the type of the imported memory, which may have a larger minimum
+		// size or smaller maximum size than the module's import type. A memory whose minimum and
+		// maximum sizes are equal has a constant size.
+		std::vector<IR::MemoryType> memoryImportTypes;
+
+		// For each function import, the LLVM IR of a body that calls to the import are inlined
+		// from, or an empty string. See Intrinsics::Function for the form of the IR.
+		std::vector<std::string> functionImportInlineLLVMIR;
+
+		// For each function import, whether it's the thunk of a pure intrinsic (see
+		// Intrinsics::Function), whose native function the code calls directly instead. The
+		// native function is bound by FunctionBinding::pureNativeCode.
+		std::vector<bool> pureNativeFunctionImports;
+	};
+
+	// Options that control how compileModule translates a module to object code.
+	struct CompileOptions
+	{
+		CompileTier tier = CompileTier::optimized;
+
+		// The optimization level of code generated by the optimized tier, from 0 to 3:
+		// 0 optimizes as little as the baseline tier, 1 runs a short list of function passes,
+		// and 2 and 3 run LLVM's standard -O2 and -O3 pipelines, including inlining and loop
+		// vectorization.
+		Uptr optimizationLevel = 1;
+
+		// If non-zero, and the tier is baseline, the generated code counts the calls to each
+		// function definition, and asks the runtime to recompile a function with the optimized
+		// tier once it has been called this many times. Once the optimized code is stored in the
+		// function's Runtime::FunctionTierUpState, the function forwards its calls to it.
+		Uptr tierUpCallThreshold = 0;
+
+		// If non-null, only these function definitions are compiled, to replace the code of the
+		// function definitions of an existing instance. The code calls the other function
+		// definitions, and refers to all of the module's function definitions, through the
+		// function bindings that loadModule is given for them after the function imports.
+		std::shared_ptr<const std::vector<Uptr>> tierUpFunctionDefIndices;
+
+		// The number of partitions to split the module's function definitions into. Each
+		// partition is emitted and compiled to a separate object on its own thread, and the
+		// resulting objects are bundled together to be loaded as a single module.
+		// 0 picks a number of partitions based on the module size and the number of hardware
+		// threads, and 1 compiles the whole module to a single object on the calling thread.
+		Uptr numPartitions = 0;
+
+		// If non-zero, the maximum number of bytes of WebAssembly code in each partition. Modules
+		// with more code than numPartitions partitions of this size are split into more
+		// partitions, which are compiled a few at a time on at most numPartitions threads, so the
+		// memory used to compile the module depends on this rather than the module's size.
+		// A function definition that is larger than this gets a partition of its own.
+		Uptr maxPartitionCodeBytes = Uptr(8) * 1024 * 1024;
+
+		// Function definitions with at most this many operators are inlined into their callers in
+		// the same partition by the optimized tier. Functions listed in the module's
+		// "wavm.noinline" custom section are never inlined.
+		Uptr inlineThreshold = 24;
+
+		// If true, the generated code counts how many times each function is entered and each
+		// conditional branch goes each way. The counts are accessible through
+		// Runtime::FunctionMutableData::profileCounters once the module is loaded.
+		bool instrumentProfile = false;
+
+		// If true, the generated code counts the calls to each function definition. If
+		// measureFunctionCycles is also true, it also adds up the CPU timestamp counter cycles
+		// spent in the calls, including their callees. Calls that exit by a trap or exception
+		// aren't counted. The counts are read by Runtime::getFunctionStats. This is cheaper than
+		// instrumentProfile, since it only adds code at function entry and exit.
+		bool countFunctionCalls = false;
+		bool measureFunctionCycles = false;
+
+		// If true, the generated code checks whether the compartment's epoch has reached the
+		// context's epoch deadline at each function entry and loop iteration, so the host can
+		// interrupt it with Runtime::incrementEpoch or Runtime::interruptContext. Each check is two
+		// loads and a compare.
+		bool checkEpochDeadline = false;
+
+		// If true, the generated code charges each straight-line run of operators one unit of the
+		// context's fuel per operator when the run starts, and calls into the runtime when the fuel
+		// is exhausted. See Runtime::setContextFuel.
+		bool meterFuel = false;
+
+		// If true, the generated code compares the stack pointer against the context's stack
+		// limit at each function entry, and traps with a stack overflow if it's below it. This
+		// detects stack overflow without relying on hitting the stack's guard page.
+		bool checkStackLimit = false;
+
+		// If true, float operators may produce NaNs with nondeterministic payloads and signs, as
+		// the relaxed SIMD proposal allows, and min and max may return either operand if they are
+		// zeros with different signs. This lets min and max compile to the target's native
+		// instructions, and lets LLVM optimize float arithmetic, including vectorizing it.
+		bool relaxedNaN = false;
+
+		// If true, the global that the module's toolchain uses as the stack pointer of its stack in
+		// linear memory is kept in a local variable while a function runs, instead of being loaded
+		// and stored through the context for every global.get and global.set. It's identified by
+		// the name __stack_pointer, or by the prologue that allocates a stack frame from it. The
+		// variable is written back to the context before calls and returns, so a trap that isn't
+		// raised by a call may discard the function's writes to the global.
+		bool cacheStackPointer = false;
+
+		// If true, all the conditional traps in a function that call the same trap intrinsic share
+		// one call to it, so each trap site is only a compare and branch. This makes the code
+		// smaller, but a trap's call stack may report the location of another trap site of the
+		// same kind in the function.
+		bool shareTrapBlocks = false;
+
+		// How much debug info is emitted for the generated code. Less debug info makes the LLVM IR
+		// smaller, so it compiles faster and produces smaller object code.
+		DebugInfoLevel debugInfoLevel = DebugInfoLevel::lineTables;
+
+		// If true, function definitions that can't be reached from the module's exports, start
+		// function, elem segments, or global initializers are compiled as stubs that trap. This
+		// saves compile time and code size for modules that contain many dead functions.
+		bool eliminateDeadFunctions = false;
+
+		// If true, the function bodies are validated in the same pass that emits them, and
+		// compileModule throws an IR::ValidationException if one is invalid. This is for modules
+		// loaded by WASM::loadBinaryModuleWithoutValidatingCode.
+		bool validateFunctionBodies = false;
+
+		// If non-null, the execution counts in this profile are given to LLVM as function entry
+		// counts and branch weights.
+		std::shared_ptr<const ModuleProfile> profile;
+
+		// If non-null, the generated code uses the imported global values and memory types in the
+		// specialization as constants, so it may only be loaded for instances whose imports match
+		// it. Either vector may be empty to not specialize that kind of import.
+		std::shared_ptr<const ModuleSpecialization> specialization;
+
+		// If non-null, the object code for each partition of the function definitions is looked
+		// up in this cache before the partition is compiled, so recompiling a module that only
+		// changed in a few functions only compiles the partitions that contain them. The
+		// partitions end after functions chosen by hashing their code, so changing a function
+		// doesn't move the boundaries of the partitions that don't contain it, and numPartitions
+		// is ignored. A partition is cached by its functions and the parts of the module and the
+		// options that affect their code. Modules compiled with a specialization don't use the
+		// cache.
+		std::shared_ptr<Runtime::ObjectCacheInterface> partitionObjectCache;
+
+		// If non-null, compileModule checks this flag before emitting each function definition,
+		// and before optimizing and generating machine code for each partition, and throws a
+		// CompileCancelledException once it is set. It doesn't affect the generated code.
+		std::shared_ptr<const std::atomic<bool>> cancelFlag;
+	};
+
+	// Thrown by compileModule if the CompileOptions::cancelFlag is set while it compiles.
+	struct CompileCancelledException
+	{
+	};
+
+	// The time compileModule spent in each phase of compiling a module. The phases are timed on
+	// each partition's thread and summed, so for a partitioned module they may add up to more than
+	// the total time.
+	struct CompileTimeReport
+	{
+		U64 totalNanoseconds = 0;
+		U64 emitIRNanoseconds = 0;
+		U64 optimizeNanoseconds = 0;
+		U64 codegenNanoseconds = 0;
+
+		// The time spent emitting the LLVM IR for each function definition, plus the time spent in
+		// function passes on it. Module, call graph, and code generation passes aren't included.
+		std::vector<U64> functionDefNanoseconds;
+
+		// The time spent in each LLVM optimization and code generation pass, summed over all the
+		// times the pass ran, and not including the passes nested in it.
+		struct PassTime
+		{
+			std::string name;
+			U64 nanoseconds;
+		};
+		std::vector<PassTime> passTimes;
+	};
+
 	// Compile a module to object code with the host target spec.
 	// Cannot fail if validateTarget(targetSpec, irModule.featureSpec) == valid.
+	// If outTimeReport is non-null, the time spent compiling the module is added to it. Timing the
+	// passes of LLVM's legacy pass manager turns on LLVM's global pass timers while the module is
+	// compiled, so modules compiled on other threads at the same time may add to the pass times.
 	WAVM_API std::vector<U8> compileModule(const IR::Module& irModule,
-										   const TargetSpec& targetSpec);
+										   const TargetSpec& targetSpec,
+										   const CompileOptions& options = CompileOptions(),
+										   CompileTimeReport* outTimeReport = nullptr);
 
 	WAVM_API std::string emitLLVMIR(const IR::Module& irModule,
 									const TargetSpec& targetSpec,
-									bool optimize);
+									bool optimize,
+									const CompileOptions& options = CompileOptions());
 
 	WAVM_API std::string disassembleObject(const TargetSpec& targetSpec,
 										   const std::vector<U8>& objectBytes);
 
+	// Object code that was compiled for a target CPU.
+	struct TargetObjectCode
+	{
+		std::string cpu;
+		const U8* bytes;
+		Uptr numBytes;
+	};
+
+	// Chooses which of several compilations of a module to run on the host: of the object code
+	// for the host architecture with a target CPU whose features are all supported by the host CPU,
+	// the one with the target CPU that has the most features. Returns the index of the chosen
+	// object code, or UINTPTR_MAX if none of the object code can run on the host.
+	WAVM_API Uptr findBestHostObjectCode(const std::vector<TargetObjectCode>& objectCodes);
+
 	// An opaque type that can be used to reference a loaded JIT module.
 	struct Module;
 
@@ -85,6 +337,10 @@ namespace WAVM { namespace LLVMJIT {
 	struct FunctionBinding
 	{
 		const void* code;
+
+		// For imports of pure intrinsics, the native function that object code compiled with
+		// ModuleSpecialization::pureNativeFunctionImports calls.
+		const void* pureNativeCode = nullptr;
 	};
 
 	struct TableBinding
@@ -112,10 +368,24 @@ namespace WAVM { namespace LLVMJIT {
 		Uptr id;
 	};
 
+	// Returns the indices of the types that compileModule generates invoke thunks for: the types of
+	// the module's exported function definitions, in increasing order and without duplicates.
+	WAVM_API std::vector<Uptr> getModuleInvokeThunkTypeIndices(const IR::Module& irModule);
+
 	// Loads a module from object code, and binds its undefined symbols to the provided bindings.
+	// The object code is only read while loading the module, so the caller may release it once
+	// loadModule returns. invokeThunkMutableDatas is indexed by type index, and holds a
+	// FunctionMutableData for each type returned by getModuleInvokeThunkTypeIndices, and null for
+	// the other types. If the object code defines the invoke thunk for the type, loadModule sets
+	// the FunctionMutableData's function to it; otherwise, the function is left null, and the
+	// caller must free the FunctionMutableData. If the object code was compiled with
+	// CompileOptions::tierUpFunctionDefIndices, functionImports also has a binding for each of the
+	// module's function definitions after the function imports, and functionDefMutableDatas may
+	// be null for the function definitions that weren't compiled.
 	WAVM_API std::shared_ptr<Module> loadModule(
-		const std::vector<U8>& objectFileBytes,
-		HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
+		const U8* objectFileBytes,
+		Uptr numObjectFileBytes,
+		const HashMap<std::string, FunctionBinding>& wavmIntrinsicsExportMap,
 		std::vector<IR::FunctionType>&& types,
 		std::vector<FunctionBinding>&& functionImports,
 		std::vector<TableBinding>&& tables,
@@ -125,8 +395,29 @@ namespace WAVM { namespace LLVMJIT {
 		InstanceBinding instance,
 		Uptr tableReferenceBias,
 		const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas,
+		const std::vector<Runtime::FunctionMutableData*>& invokeThunkMutableDatas,
 		std::string&& debugName);
 
+	// The bytes of the pages that a loaded module's code and data were loaded into. They are
+	// committed for as long as the module is loaded.
+	struct ModuleMemoryUsage
+	{
+		Uptr numCodeBytes = 0;
+		Uptr numReadOnlyBytes = 0;
+		Uptr numReadWriteBytes = 0;
+
+		// How many of the bytes are resident in physical memory, if it was sampled.
+		Uptr numResidentBytes = 0;
+	};
+	WAVM_API ModuleMemoryUsage getModuleMemoryUsage(const Module* module, bool sampleResidency);
+
+	// Sets whether modules loaded after the call register their code with GDB's JIT interface, so
+	// GDB can show their functions and source lines. Registering and deregistering a module takes
+	// a global lock and gets slower as more modules are registered, and GDB keeps a copy of each
+	// registered object, so it is only enabled by default in debug builds.
+	WAVM_API void setGDBRegistrationEnabled(bool enabled);
+	WAVM_API bool getGDBRegistrationEnabled();
+
 	struct InstructionSource
 	{
 		Runtime::Function* function;
@@ -137,6 +428,22 @@ namespace WAVM { namespace LLVMJIT {
 	// contains the given address, returns an InstructionSourceInfo with function==nullptr.
 	WAVM_API bool getInstructionSourceByAddress(Uptr address, InstructionSource& outSource);
 
-	// Generates an invoke thunk for a specific function type.
-	WAVM_API Runtime::InvokeThunkPointer getInvokeThunk(IR::FunctionType functionType);
+	// Generates an invoke thunk for a specific function type. If objectCache is non-null, the
+	// thunk's object code is looked up in it by the function type before compiling the thunk.
+	WAVM_API Runtime::InvokeThunkPointer getInvokeThunk(
+		IR::FunctionType functionType,
+		Runtime::ObjectCacheInterface* objectCache = nullptr);
+
+	// Generates a trampoline for a specific function type, which compiled code can call like a
+	// WebAssembly function of the type. It calls interpretFunction with the arguments in an array
+	// of UntaggedValues, and returns the results that interpretFunction writes to the same array.
+	// The trampoline takes the Runtime::Function to pass to interpretFunction as a nest parameter,
+	// which LLVM passes in a register that isn't used for other parameters (r10 on x86-64, x18 on
+	// AArch64), so all the functions of the type can share it: each function's code loads its
+	// address into the register and jumps to the trampoline. interpretFunction must be the same
+	// for every call.
+	WAVM_API const void* getInterpreterTrampoline(
+		IR::FunctionType functionType,
+		Runtime::InvokeThunkPointer interpretFunction,
+		Runtime::ObjectCacheInterface* objectCache = nullptr);
 }}
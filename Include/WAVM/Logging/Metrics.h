@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Intrinsic.h"
+
+// A registry of named counters, gauges, and histograms that describe what WAVM is doing, so it can
+// be monitored without parsing the metrics log. Looking up a metric by name takes a lock, so hot
+// code should look it up once and keep the reference: metrics are never freed. Updating a metric
+// is a relaxed atomic add.
+namespace WAVM { namespace Metrics {
+
+	// A count of events or quantities that only increases.
+	struct Counter
+	{
+		void add(U64 delta = 1) { value.fetch_add(delta, std::memory_order_relaxed); }
+		U64 get() const { return value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<U64> value{0};
+	};
+
+	// A quantity that may increase and decrease, such as a number of bytes in use.
+	struct Gauge
+	{
+		void add(U64 delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+		void subtract(U64 delta) { value.fetch_sub(delta, std::memory_order_relaxed); }
+		U64 get() const { return value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<U64> value{0};
+	};
+
+	// A distribution of recorded values, such as latencies in nanoseconds. Values are counted in
+	// buckets by their bit width: bucket 0 counts zeroes, and bucket N counts values in
+	// [2^(N-1), 2^N).
+	struct Histogram
+	{
+		static constexpr Uptr numBuckets = 65;
+
+		void record(U64 value)
+		{
+			const Uptr bucketIndex = 64 - Uptr(countLeadingZeroes(value));
+			bucketCounts[bucketIndex].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		U64 getCount() const { return count.load(std::memory_order_relaxed); }
+		U64 getSum() const { return sum.load(std::memory_order_relaxed); }
+		U64 getBucketCount(Uptr bucketIndex) const
+		{
+			return bucketCounts[bucketIndex].load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<U64> bucketCounts[numBuckets] = {};
+		std::atomic<U64> count{0};
+		std::atomic<U64> sum{0};
+	};
+
+	// Returns the metric with the given name, creating it if it doesn't exist. The name may end
+	// with Prometheus-style labels, e.g. wavm_traps_total{type="outOfBoundsMemoryAccess"}. The
+	// description is only used when the metric is created. A name may only be used for one type
+	// of metric.
+	WAVM_API Counter& getCounter(const char* name, const char* description);
+	WAVM_API Gauge& getGauge(const char* name, const char* description);
+	WAVM_API Histogram& getHistogram(const char* name, const char* description);
+
+	enum class MetricType
+	{
+		counter,
+		gauge,
+		histogram,
+	};
+
+	// A copy of a metric's value at the time it was read by getMetrics.
+	struct MetricValue
+	{
+		std::string name;
+		std::string description;
+		MetricType type;
+
+		// The counter or gauge value, or the number of values recorded by the histogram.
+		U64 count;
+
+		// For histograms: the sum of the recorded values, and the count of each bucket.
+		U64 sum;
+		std::vector<U64> bucketCounts;
+	};
+
+	// Reads all the metrics, in the order they were created.
+	WAVM_API std::vector<MetricValue> getMetrics();
+
+	// Formats all the metrics in the Prometheus text exposition format.
+	WAVM_API std::string getPrometheusText();
+}}
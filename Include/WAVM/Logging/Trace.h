@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+// Records timestamped spans of time spent in compile and runtime phases, so they can be viewed on
+// a timeline. Events are recorded into per-thread ring buffers without taking a lock, and written
+// to the trace sink in batches. Setting the WAVM_TRACE environment variable to a filename records
+// a Chrome trace JSON file, which can be viewed in chrome://tracing or Perfetto.
+namespace WAVM { namespace Trace {
+
+	// A span of time that a thread spent doing something.
+	struct Event
+	{
+		static constexpr Uptr maxNameChars = 63;
+
+		const char* category;
+		char name[maxNameChars + 1];
+		U64 beginNanoseconds;
+		U64 endNanoseconds;
+		U64 threadIndex;
+	};
+
+	// Receives batches of recorded events. Calls to write are serialized.
+	struct Sink
+	{
+		virtual ~Sink() {}
+		virtual void write(const Event* events, Uptr numEvents) = 0;
+	};
+
+	// Creates a sink that writes events to a Chrome trace JSON file. Returns null if the file
+	// couldn't be created. The file is completed when the sink is destroyed.
+	WAVM_API std::shared_ptr<Sink> createChromeTraceFileSink(const char* filename);
+
+	// Sets the sink that events are written to, after flushing the events recorded for the
+	// previous sink. A null sink disables tracing.
+	WAVM_API void setSink(std::shared_ptr<Sink> sink);
+
+	// Writes all events recorded by any thread to the sink.
+	WAVM_API void flush();
+
+	WAVM_API bool isEnabled();
+
+	// Returns the monotonic clock time in nanoseconds that events are timestamped with.
+	WAVM_API U64 getTimestamp();
+
+	// Records an event. The category must be a string literal, but the name is copied, and
+	// truncated to Event::maxNameChars.
+	WAVM_API void recordEvent(const char* category,
+							  const char* name,
+							  U64 beginNanoseconds,
+							  U64 endNanoseconds);
+
+	// Records an event for the lifetime of the scope, if tracing was enabled when it began. The
+	// name must remain valid until the scope ends.
+	struct Scope
+	{
+		Scope(const char* inCategory, const char* inName)
+		: category(inCategory), name(inName), beginNanoseconds(isEnabled() ? getTimestamp() : 0)
+		{
+		}
+
+		~Scope()
+		{
+			if(beginNanoseconds)
+			{ recordEvent(category, name, beginNanoseconds, getTimestamp()); }
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* category;
+		const char* name;
+		U64 beginNanoseconds;
+	};
+}}
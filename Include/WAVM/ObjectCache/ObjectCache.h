@@ -1,6 +1,9 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 #include "WAVM/Inline/BasicTypes.h"
 
 namespace WAVM { namespace Runtime {
@@ -23,4 +26,92 @@ namespace WAVM { namespace ObjectCache {
 							 Uptr maxBytes,
 							 U64 codeKey,
 							 std::shared_ptr<Runtime::ObjectCacheInterface>& outObjectCache);
+
+	// Sets whether an object cache compresses the object code it adds to its database, so the
+	// database holds more modules at the cost of decompressing them when they are read. Objects
+	// that were added before the setting changed can still be read. Defaults to false.
+	// objectCache must have been opened by ObjectCache::open.
+	WAVM_API void setCompressObjects(
+		const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+		bool compressObjects);
+
+	// A content-addressed blob store shared by many hosts (e.g. an HTTP, S3, or Redis store), that
+	// an object cache uses as a second tier behind its database. The keys identify the code
+	// generation version and the module, so a key's value never changes once it is put. get may be
+	// called on several threads at once.
+	struct RemoteObjectStore
+	{
+		virtual ~RemoteObjectStore() {}
+
+		// Returns false if the store doesn't contain the key, or couldn't be reached.
+		virtual bool get(const std::string& key, std::vector<U8>& outBytes) = 0;
+
+		// Called on a background thread for each object the cache compiles.
+		virtual void put(const std::string& key, const std::vector<U8>& bytes) = 0;
+	};
+
+	// Makes an object cache look up object code that isn't in its database in the remote store
+	// before compiling it, and put the object code it compiles in the remote store. The objects in
+	// the remote store are checked against a hash stored with them, and objects that fail the
+	// check are compiled. objectCache must have been opened by ObjectCache::open.
+	WAVM_API void setRemoteObjectStore(
+		const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+		std::shared_ptr<RemoteObjectStore>&& remoteStore);
+
+	// Sets the maximum number of bytes of object code that is kept in memory by all object caches
+	// in the process, in front of their databases. Defaults to 64MB.
+	WAVM_API void setMaxMemoryBytes(Uptr maxBytes);
+
+	// A module to compile into an object cache with precompileAsync.
+	struct PrecompileModule
+	{
+		std::string name;
+		std::vector<U8> wasmBytes;
+
+		// Modules with a higher priority are compiled before modules with a lower priority.
+		I32 priority = 0;
+	};
+
+	// Compiles WASM bytes to object code. Returns false if the module couldn't be compiled.
+	typedef std::function<bool(const U8* wasmBytes, Uptr numWASMBytes, std::vector<U8>& outObject)>
+		PrecompileFunction;
+
+	struct PrecompileResult
+	{
+		// The index of the module in the vector passed to precompileAsync.
+		Uptr moduleIndex;
+
+		// If the cache already contained the module's object code, it isn't compiled again.
+		bool wasAlreadyCached;
+		bool succeeded;
+
+		F64 compileMilliseconds;
+	};
+
+	struct PrecompileProgress
+	{
+		Uptr numModules = 0;
+		Uptr numCompiled = 0;
+		Uptr numAlreadyCached = 0;
+		Uptr numFailed = 0;
+	};
+
+	struct PrecompileJob;
+
+	// Starts compiling modules into an object cache on background threads, skipping modules that
+	// the cache already contains object code for. At most maxConcurrentCompiles modules are
+	// compiled at once. objectCache must have been opened by ObjectCache::open.
+	// onModuleFinished is called on the compiling thread after each module is compiled or skipped.
+	WAVM_API std::shared_ptr<PrecompileJob> precompileAsync(
+		const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+		std::vector<PrecompileModule>&& modules,
+		PrecompileFunction&& precompileFunction,
+		Uptr maxConcurrentCompiles,
+		std::function<void(const PrecompileResult&)>&& onModuleFinished = nullptr);
+
+	WAVM_API PrecompileProgress getPrecompileProgress(const std::shared_ptr<PrecompileJob>& job);
+
+	// Waits for all the modules in a precompile job to finish, and returns the final progress.
+	// Destroying the last reference to a job also waits for it to finish.
+	WAVM_API PrecompileProgress waitForPrecompile(const std::shared_ptr<PrecompileJob>& job);
 }}
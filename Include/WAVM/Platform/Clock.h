@@ -15,9 +15,18 @@ namespace WAVM { namespace Platform {
 		monotonic,
 
 		// The amount of CPU time used by this process.
-		processCPUTime
+		processCPUTime,
+
+		// The amount of CPU time used by the calling thread.
+		threadCPUTime
 	};
 
 	WAVM_API Time getClockTime(Clock clock);
 	WAVM_API Time getClockResolution(Clock clock);
+
+	// Like getClockTime and getClockResolution, but for a coarser version of the clock that is
+	// cheaper to read if the platform has one, e.g. a time the kernel updates at each scheduler
+	// tick. If the platform doesn't have a coarse version of the clock, these use the precise one.
+	WAVM_API Time getCoarseClockTime(Clock clock);
+	WAVM_API Time getCoarseClockResolution(Clock clock);
 }}
@@ -66,6 +66,15 @@
 #define WAVM_DEBUG 1
 #endif
 
+// Define WAVM_LITTLE_ENDIAN to 0 or 1 depending on whether the host stores the least significant
+// byte of an integer first. MSVC doesn't define __BYTE_ORDER__, but only targets little-endian
+// hosts.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#define WAVM_LITTLE_ENDIAN 0
+#else
+#define WAVM_LITTLE_ENDIAN 1
+#endif
+
 // Define a macro to align a struct that is valid in C99: don't use C++ alignas or C11 _Alignas.
 #if defined(__GNUC__)
 #define WAVM_ALIGNED_STRUCT(alignment, def) def __attribute__((aligned(alignment)));
@@ -58,4 +58,44 @@ namespace WAVM { namespace Platform {
 
 	WAVM_API void registerVirtualAllocation(Uptr numBytes);
 	WAVM_API void deregisterVirtualAllocation(Uptr numBytes);
+
+	//
+	// Perf maps
+	//
+
+	// The format of the file that describes JIT code to the Linux perf profiler, so it can
+	// attribute samples in the code to functions.
+	enum class PerfMapFormat
+	{
+		none,
+
+		// /tmp/perf-<pid>.map: the address range and name of each function.
+		map,
+
+		// /tmp/jit-<pid>.dump: the jitdump format, which also describes the code and the source
+		// line of each instruction. It is only supported on Linux, and must be merged into profiles
+		// recorded with "perf record -k mono" by "perf inject --jit".
+		jitdump,
+	};
+
+	// Creates the perf map file for the process. Returns false if the host doesn't support the
+	// format, or the file couldn't be created. Only JIT code that is loaded after the perf map is
+	// enabled is described by it.
+	WAVM_API bool enablePerfMap(PerfMapFormat format);
+	WAVM_API PerfMapFormat getPerfMapFormat();
+
+	struct PerfMapLine
+	{
+		Uptr codeOffset;
+		U32 line;
+	};
+
+	// Describes a loaded JIT function in the perf map file. The lines map offsets in the code to
+	// lines of the source file, and are only used by the jitdump format.
+	WAVM_API void addPerfMapFunction(const char* name,
+									 const U8* code,
+									 Uptr numCodeBytes,
+									 const char* sourceFileName,
+									 const PerfMapLine* lines,
+									 Uptr numLines);
 }}
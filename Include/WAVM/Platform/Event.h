@@ -63,6 +63,12 @@ namespace WAVM { namespace Platform {
 		} pthreadCond;
 #else
 #error unsupported platform
+#endif
+
+#ifndef WIN32
+		// Whether the event was signaled since the last wait returned, so a signal that happens
+		// before a wait starts isn't lost.
+		bool isSignaled;
 #endif
 	};
 }}
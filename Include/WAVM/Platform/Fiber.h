@@ -0,0 +1,48 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	// A fiber is an execution context with its own stack, that runs on the thread that switches to
+	// it until it switches back. A fiber must only be switched to on the thread that created it.
+	struct Fiber;
+
+	// Creates a fiber that calls entry(argument) on a new stack with numStackBytes (or a default
+	// size if numStackBytes is 0) the first time it is switched to. The stack has a guard page, so
+	// overflowing it is reported as a stack overflow signal. Exceptions must not propagate out of
+	// the entry function.
+	WAVM_API Fiber* createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument);
+
+	// Destroys a fiber that isn't running. If the fiber's entry function hasn't returned, the
+	// fiber's stack is freed without unwinding it.
+	WAVM_API void destroyFiber(Fiber* fiber);
+
+	// The number of stacks of destroyed fibers that are kept for reuse by createFiber, unless more
+	// were reserved by reserveFiberStacks.
+	static constexpr Uptr defaultMaxPooledFiberStacks = 64;
+
+	// Allocates numStacks fiber stacks with numStackBytes (or the default size if numStackBytes is
+	// 0), which createFiber reuses for fibers with the same stack size instead of allocating new
+	// stacks. The stacks of destroyed fibers are returned to the pool. Has no effect on platforms
+	// that can't reuse fiber stacks.
+	WAVM_API void reserveFiberStacks(Uptr numStacks, Uptr numStackBytes = 0);
+
+	// Runs a fiber until it calls switchFromFiber, or its entry function returns. Returns true if
+	// the entry function returned, after which the fiber must not be switched to again. If
+	// isSuspendable is false, the caller can't handle the fiber switching back before it returns,
+	// so operations on the fiber that would switch back to wait for I/O block the thread instead.
+	WAVM_API bool switchToFiber(Fiber* fiber, bool isSuspendable);
+
+	// Switches from the fiber that is running on the calling thread back to the switchToFiber call
+	// that is running it. Returns when the fiber is switched to again.
+	WAVM_API void switchFromFiber();
+
+	// Returns the fiber that is running on the calling thread, or null if the thread isn't running
+	// a fiber.
+	WAVM_API Fiber* getCurrentFiber();
+
+	// Returns true if the calling thread is running a fiber that was switched to as suspendable, so
+	// it may switch back to its resumer while it waits for an operation to complete.
+	WAVM_API bool isCurrentFiberSuspendable();
+}}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Platform/Defines.h"
@@ -15,6 +16,10 @@ namespace WAVM { namespace Platform {
 	};
 
 	WAVM_API VFS::VFD* getStdFD(StdDevice device);
+
+	// Creates a VFD that takes ownership of an open host file descriptor (or HANDLE on Windows),
+	// such as a socket accepted by the embedder. Closing the VFD closes the host handle.
+	WAVM_API VFS::VFD* openHostHandle(Uptr handle);
 	WAVM_API std::string getCurrentWorkingDirectory();
 
 	struct HostFS : VFS::FileSystem
@@ -24,4 +29,54 @@ namespace WAVM { namespace Platform {
 		virtual ~HostFS() override {}
 	};
 	WAVM_API HostFS& getHostFS();
+
+	// Returns a host file system whose files are read, written, and synced through an io_uring
+	// owned by the calling thread, or null if the host doesn't support io_uring. When a suspendable
+	// fiber reads, writes, or syncs one of its files, it switches from the fiber until the
+	// operation completes, so the thread can run other fibers. The operations of the fibers on a
+	// thread are submitted to the kernel together the next time one of the fibers is switched to,
+	// or the thread calls pollIOURing. Operations that aren't on a suspendable fiber block the
+	// thread until they complete.
+	WAVM_API HostFS* getIOURingHostFS();
+
+	// Submits the calling thread's queued io_uring operations to the kernel, and records the
+	// results of any completed operations, so the fibers waiting for them can continue when they
+	// are switched to. If waitForCompletion is true, waits for at least one operation to complete
+	// first. Returns the number of the thread's operations that haven't completed.
+	WAVM_API Uptr pollIOURing(bool waitForCompletion);
+
+	// Returns a host file system whose files are read and written with overlapped I/O that
+	// completes on an I/O completion port owned by the calling thread, or null if the host isn't
+	// Windows. When a suspendable fiber reads or writes one of its files, it switches from the
+	// fiber until the operation completes, so the thread can run other fibers. The completions of
+	// the fibers' operations are dequeued the next time one of the fibers is switched to, or the
+	// thread calls pollIOCP. A file's operations only use the completion port of the first thread
+	// that reads or writes it from a suspendable fiber; on other threads, or when they aren't on a
+	// suspendable fiber, they block until they complete.
+	WAVM_API HostFS* getIOCPHostFS();
+
+	// Dequeues the completions of the calling thread's overlapped I/O operations, so the fibers
+	// waiting for them can continue when they are switched to. If waitForCompletion is true,
+	// waits for at least one operation to complete first. Returns the number of the thread's
+	// operations that haven't completed.
+	WAVM_API Uptr pollIOCP(bool waitForCompletion);
+
+	// Opens a host directory as a file system whose paths are resolved beneath an open handle for
+	// the directory, so neither ".." nor symbolic links can resolve to a file outside it. Returns
+	// null if the directory can't be opened, or if the host doesn't support such file systems (or
+	// io_uring, if useIOURing is true).
+	WAVM_API std::shared_ptr<VFS::FileSystem> openHostSandboxFS(const std::string& rootPath,
+																bool useIOURing = false);
+
+	// A read-only mapping of a host file's contents into memory. The mapped pages are backed by
+	// the file in the page cache, so they are shared with other processes that map the file.
+	struct MappedFile
+	{
+		const U8* bytes = nullptr;
+		Uptr numBytes = 0;
+	};
+
+	// Maps the contents of a host file into memory. The file must not be modified while mapped.
+	WAVM_API VFS::Result mapFile(const std::string& path, MappedFile& outMappedFile);
+	WAVM_API void unmapFile(const MappedFile& mappedFile);
 }}
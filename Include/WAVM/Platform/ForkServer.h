@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+
+namespace WAVM { namespace Platform {
+	// A job that a client sends to a fork server: the arguments and environment variables to run
+	// the program with. The job's process also uses the client's standard input, output, and
+	// error.
+	struct ForkServerJob
+	{
+		std::vector<std::string> args;
+		std::vector<std::string> envs;
+	};
+
+	// Listens for jobs on a local socket at socketPath, replacing any file at the path. For each
+	// job, forks a child process that replaces its standard input, output, and error with the
+	// client's, calls runJob, sends the exit code that runJob returns to the client, and exits.
+	// The calling process must not have any other threads, since only the calling thread is
+	// copied to the child processes. Only returns if the socket can't be listened on, or if fork
+	// servers aren't supported on the host.
+	WAVM_API void serveForkServerJobs(const std::string& socketPath,
+									  const std::function<I32(ForkServerJob&&)>& runJob);
+
+	// Sends a job to a fork server listening on socketPath with the calling process's standard
+	// input, output, and error, and waits for the job to finish. Returns false if the server
+	// couldn't be reached, or the job's process exited without sending an exit code.
+	WAVM_API bool runForkServerJob(const std::string& socketPath,
+								   const ForkServerJob& job,
+								   I32& outExitCode);
+
+	// A child process forked from the calling process, which calls a handler for each request it
+	// is sent, and sends the handler's response back. The process exits when it is destroyed.
+	struct HelperProcess;
+
+	// Forks a helper process that handles requests with handleRequest. Only the calling thread is
+	// copied to the child process, so it should be called before the process creates any other
+	// threads, which might hold locks that stay locked in the child. Returns null if the process
+	// couldn't be forked, or if helper processes aren't supported on the host.
+	WAVM_API HelperProcess* forkHelperProcess(
+		const std::function<std::vector<U8>(std::vector<U8>&&)>& handleRequest);
+
+	// Closes the connection to a helper process, and waits for it to exit.
+	WAVM_API void destroyHelperProcess(HelperProcess* helperProcess);
+
+	// Sends a request to a helper process, and waits for its response. Returns false if the
+	// process exited before it responded. Only one thread may call it for a process at a time.
+	WAVM_API bool callHelperProcess(HelperProcess* helperProcess,
+									const std::vector<U8>& request,
+									std::vector<U8>& outResponse);
+}}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Defines.h"
+
+namespace WAVM { namespace Platform {
+	// Returns true if the OS supports waiting on a 32-bit value in memory with futexWait, and
+	// waking the waiting threads with futexWake.
+	WAVM_API bool isFutexSupported();
+
+	enum class FutexWaitResult
+	{
+		woken,
+		notEqual,
+		timedOut
+	};
+
+	// If *address equals expectedValue, waits until another thread calls futexWake on the same
+	// address, or waitDuration has elapsed. The comparison and the start of the wait are atomic
+	// with respect to futexWake. address must be 4-byte aligned, and must be a valid address.
+	// Must only be called if isFutexSupported returns true.
+	WAVM_API FutexWaitResult futexWait(const U32* address, U32 expectedValue, Time waitDuration);
+
+	// Wakes up to numToWake threads that are waiting on the given address in futexWait, and
+	// returns the number of threads that were woken.
+	// Must only be called if isFutexSupported returns true.
+	WAVM_API Uptr futexWake(const U32* address, Uptr numToWake);
+}}
@@ -156,6 +156,21 @@ namespace WAVM {
 					 : "memory");
 #else
 		for(Uptr index = 0; index < numBytes; ++index) { dest[index] = value; }
+#endif
+	}
+
+	// Tells the CPU that the calling thread is in a spin-wait loop, so it can reduce the loop's
+	// power consumption and its impact on other hardware threads on the same core.
+	inline void spinLoopHint()
+	{
+#if defined(_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+		_mm_pause();
+#elif defined(_WIN32) && defined(_M_ARM64)
+		__yield();
+#elif defined(__i386__) || defined(__x86_64__)
+		asm volatile("pause" ::: "memory");
+#elif defined(__aarch64__)
+		asm volatile("yield" ::: "memory");
 #endif
 	}
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Platform/Defines.h"
 
@@ -20,6 +21,30 @@ namespace WAVM { namespace Platform {
 	// Returns the number of bytes in the smallest virtual page.
 	inline Uptr getBytesPerPage() { return Uptr(1) << getBytesPerPageLog2(); }
 
+	// Returns the base 2 logarithm of the number of bytes in a huge page, or 0 if the platform
+	// can't back committed pages with huge pages.
+	WAVM_API Uptr getBytesPerHugePageLog2();
+
+	// Sets whether commitVirtualPages should ask the OS to back committed pages with huge pages.
+	// This is disabled by default, and has no effect if getBytesPerHugePageLog2() returns 0.
+	// Huge pages are only used for the parts of an allocation that cover a whole, aligned huge
+	// page, so allocations should be aligned with getHugePageAlignmentLog2().
+	WAVM_API void setHugePagesEnabled(bool enable);
+	WAVM_API bool getHugePagesEnabled();
+
+	// Returns the alignment that allocations of the given number of pages should use to make the
+	// most of huge pages: the huge page size if huge pages are enabled and the allocation is at
+	// least one huge page, otherwise the page size.
+	inline Uptr getHugePageAlignmentLog2(Uptr numPages)
+	{
+		const Uptr pageSizeLog2 = getBytesPerPageLog2();
+		const Uptr hugePageSizeLog2 = getBytesPerHugePageLog2();
+		if(getHugePagesEnabled() && hugePageSizeLog2 > pageSizeLog2
+		   && numPages >= (Uptr(1) << (hugePageSizeLog2 - pageSizeLog2)))
+		{ return hugePageSizeLog2; }
+		return pageSizeLog2;
+	}
+
 	// Allocates virtual addresses without commiting physical pages to them.
 	// Returns the base virtual address of the allocated addresses, or nullptr if the virtual
 	// address space has been exhausted.
@@ -48,6 +73,23 @@ namespace WAVM { namespace Platform {
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	WAVM_API void decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages);
 
+	// Releases the physical memory that was committed to the specified read-write virtual pages,
+	// which stay committed and read as zero afterwards. The pages must not be mapped to a snapshot
+	// or a file. baseVirtualAddress must be a multiple of the preferred page size.
+	WAVM_API void discardVirtualPages(U8* baseVirtualAddress, Uptr numPages);
+
+	// Allocates physical memory for the specified committed read-write virtual pages, as if they
+	// had been written, so the first access to them doesn't fault. The pages must not be mapped to
+	// a snapshot or a file. baseVirtualAddress must be a multiple of the preferred page size.
+	// Returns false if the platform doesn't support it, or the pages couldn't be populated.
+	WAVM_API bool populateVirtualPages(U8* baseVirtualAddress, Uptr numPages);
+
+	// Moves the contents of the specified committed virtual pages to the same number of pages at
+	// destVirtualAddress, which must have been allocated by allocateVirtualPages, without copying
+	// them. The source pages stay allocated, but their contents are lost. Returns false if the
+	// pages couldn't be moved, in which case neither range of pages is changed.
+	WAVM_API bool moveVirtualPages(U8* destVirtualAddress, U8* sourceVirtualAddress, Uptr numPages);
+
 	// Frees virtual addresses. baseVirtualAddress must also be the address returned by
 	// allocateVirtualPages.
 	WAVM_API void freeVirtualPages(U8* baseVirtualAddress, Uptr numPages);
@@ -59,6 +101,104 @@ namespace WAVM { namespace Platform {
 										  Uptr numPages,
 										  Uptr alignmentLog2);
 
+	// A copy of the contents of a range of virtual pages that can be mapped copy-on-write into
+	// other ranges of virtual pages.
+	struct PageSnapshot;
+
+	// Copies the contents of the specified virtual pages to a new snapshot, and remaps the pages
+	// copy-on-write to the snapshot. The pages must be committed with read-write access.
+	// Returns null if the platform doesn't support snapshots, or the snapshot couldn't be created.
+	WAVM_API PageSnapshot* createPageSnapshot(U8* baseVirtualAddress, Uptr numPages);
+
+	// Frees a snapshot. Any pages that are still mapped to the snapshot keep their contents.
+	WAVM_API void destroyPageSnapshot(PageSnapshot* snapshot);
+
+	// Returns the number of pages in a snapshot.
+	WAVM_API Uptr getPageSnapshotNumPages(const PageSnapshot* snapshot);
+
+	// Maps a snapshot copy-on-write to the specified virtual pages, which must have been allocated
+	// by allocateVirtualPages. The contents of the snapshot are only copied to the pages when they
+	// are first written. Returns false if the snapshot couldn't be mapped.
+	WAVM_API bool mapPageSnapshot(const PageSnapshot* snapshot, U8* baseVirtualAddress);
+
+	// Returns true if any of the pages that were mapped to the snapshot at the specified address,
+	// either by mapPageSnapshot or createPageSnapshot, may have been written since. Decommitting
+	// the pages is not detected, so callers must track that themselves.
+	WAVM_API bool mayPageSnapshotMappingHaveChanged(const PageSnapshot* snapshot,
+													U8* baseVirtualAddress);
+
+	// Restores the pages that were mapped to the snapshot at the specified address, either by
+	// mapPageSnapshot or createPageSnapshot, to the snapshot's contents, by discarding the copies
+	// of the pages that have been written since. Only the written pages are discarded if the
+	// platform can tell which they are. Returns the number of pages that were discarded.
+	WAVM_API Uptr resetPageSnapshotMapping(const PageSnapshot* snapshot, U8* baseVirtualAddress);
+
+	// A mapping of a snapshot to a range of virtual pages that copies each page from the snapshot
+	// when it is first accessed.
+	struct LazyPageMapping;
+
+	// Maps a snapshot to the specified virtual pages, which must be committed with read-write
+	// access, by copying each page from the snapshot to private memory when it is first accessed.
+	// The pages in prefetchPageIndices are copied before this returns. Unlike mapPageSnapshot,
+	// copying a page doesn't wait for it to be written, but pages that are never accessed use no
+	// memory at all. The pages' previous contents are lost. mayPageSnapshotMappingHaveChanged
+	// treats the copied pages as written. Returns null if the platform doesn't support it, in
+	// which case the pages are unchanged.
+	WAVM_API LazyPageMapping* mapPageSnapshotLazily(const PageSnapshot* snapshot,
+													U8* baseVirtualAddress,
+													const std::vector<Uptr>& prefetchPageIndices);
+
+	// Stops copying pages to a lazy mapping. Pages that haven't been accessed yet read as zero
+	// afterwards, so this should only be called once the pages are no longer used.
+	WAVM_API void destroyLazyPageMapping(LazyPageMapping* mapping);
+
+	// Returns the indices of the pages that have been copied to a lazy mapping: the prefetched
+	// pages, followed by the other pages in the order they were first accessed.
+	WAVM_API std::vector<Uptr> getLazyPageMappingCopiedPages(LazyPageMapping* mapping);
+
+	// Maps a range of a host file (a file descriptor on POSIX) to the specified virtual pages,
+	// replacing their contents. fileOffset must be a multiple of the page size. The pages share
+	// the file's page cache until they are written: if copyOnWrite is true, writes copy the
+	// written pages to private memory, and otherwise the pages are read-only. Returns false if the
+	// file couldn't be mapped, in which case the pages are left committed with read-write access,
+	// but their contents are lost.
+	WAVM_API bool mapFileVirtualPages(U8* baseVirtualAddress,
+									  Uptr numPages,
+									  Uptr hostHandle,
+									  U64 fileOffset,
+									  bool copyOnWrite);
+
+	// Asks the OS to back the specified virtual pages with physical memory on the given NUMA node
+	// when it can, or with the calling thread's default policy if node is UINTPTR_MAX. Only affects
+	// the pages that are backed after the call, and decommitting or remapping the pages resets it.
+	// Returns false if the platform doesn't support it, or the node doesn't exist.
+	WAVM_API bool setVirtualPagesNUMANode(U8* baseVirtualAddress, Uptr numPages, Uptr node);
+
+	// Allocates a memory protection key, which tags virtual pages so that a thread's access to them
+	// can be changed by writing its protection key rights, without a system call. Returns -1 if
+	// the OS or CPU doesn't support protection keys, or they have all been allocated. The calling
+	// thread, and threads created by it afterwards, may access pages tagged with the key.
+	WAVM_API I32 allocateMemoryProtectionKey();
+	WAVM_API void freeMemoryProtectionKey(I32 key);
+
+	// Sets the access to the specified virtual pages, and tags them with a protection key. Pages
+	// that are decommitted or remapped are tagged with the default key 0 again.
+	WAVM_API bool setVirtualPagesProtectionKey(U8* baseVirtualAddress,
+											   Uptr numPages,
+											   MemoryAccess access,
+											   I32 key);
+
+	// Reads and writes the calling thread's protection key rights. For each key k, bit 2k disables
+	// access to the pages tagged with it, and bit 2k+1 disables writes to them. May only be called
+	// after allocateMemoryProtectionKey has succeeded.
+	WAVM_API U32 getProtectionKeyRights();
+	WAVM_API void setProtectionKeyRights(U32 rights);
+
 	// Gets memory usage information for this process.
 	WAVM_API Uptr getPeakMemoryUsageBytes();
+
+	// Returns how many of the specified virtual pages are resident in physical memory. The pages
+	// must be reserved, but needn't be committed. This inspects each page, so is much slower than
+	// counting committed pages, and is meant for sampling.
+	WAVM_API Uptr getNumResidentVirtualPages(U8* baseVirtualAddress, Uptr numPages);
 }}
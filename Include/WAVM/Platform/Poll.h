@@ -0,0 +1,52 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Defines.h"
+#include "WAVM/VFS/VFS.h"
+
+namespace WAVM { namespace Platform {
+	// A set of VFDs and timers that a thread can wait on until at least one of them is ready. It is
+	// backed by epoll on Linux and kqueue on MacOS. On Windows, VFDs are always ready, and waiting
+	// sleeps until the earliest timer.
+	struct Poller;
+
+	enum class PollEventType : U8
+	{
+		timer,
+		read,
+		write,
+	};
+
+	struct PollEvent
+	{
+		Uptr userData;
+		PollEventType type;
+
+		// The error that prevented the VFD from being polled, or success.
+		VFS::Result result;
+
+		// For read and write events: whether the other end of a pipe or socket was closed, and the
+		// number of bytes that may be read without blocking (0 if unknown).
+		bool hangup;
+		U64 numBytesAvailable;
+	};
+
+	WAVM_API Poller* createPoller();
+	WAVM_API void destroyPoller(Poller* poller);
+
+	// Adds a VFD to the poller, reporting a read or write event with userData when the VFD is
+	// readable or writable. A VFD may be added more than once. VFDs that the host can't wait on,
+	// like regular files, are always ready.
+	WAVM_API void addPollerVFD(Poller* poller, VFS::VFD* vfd, PollEventType type, Uptr userData);
+
+	// Adds a timer to the poller, reporting a timer event with userData once the clock reaches
+	// deadline. Returns false if the host can't wait on the clock.
+	WAVM_API bool addPollerTimer(Poller* poller, Clock clock, Time deadline, Uptr userData);
+
+	// Blocks the calling thread until at least one of the poller's VFDs or timers is ready, then
+	// writes up to maxEvents of the ready events to outEvents, and returns the number written.
+	// The thread doesn't use any CPU time while it waits.
+	WAVM_API Uptr waitPoller(Poller* poller, PollEvent* outEvents, Uptr maxEvents);
+}}
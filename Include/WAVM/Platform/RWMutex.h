@@ -92,6 +92,86 @@ namespace WAVM { namespace Platform {
 #endif
 #endif
 	};
+
+	// A reader-writer mutex for locks that are rarely locked exclusively. While the mutex is
+	// reader-biased, a shared lock only writes a slot that belongs to the locking thread, instead
+	// of the cache line of the underlying RWMutex that is shared by all the threads that lock it.
+	// In return, an exclusive lock must revoke the bias and wait for the threads that hold a shared
+	// lock through their slots. The bias is restored by a later shared lock, but not until the
+	// mutex has spent long enough unbiased to bound the time spent revoking it (see "BRAVO -
+	// Biased Locking for Reader-Writer Locks", Dice and Kogan 2019).
+	//
+	// A shared lock must be unlocked by the thread that locked it. Only a limited number of
+	// threads get slots; the others always lock the underlying RWMutex.
+	struct ReaderBiasedRWMutex
+	{
+		typedef RWMutex::LockShareability LockShareability;
+		static constexpr LockShareability exclusive = RWMutex::exclusive;
+		static constexpr LockShareability shareable = RWMutex::shareable;
+
+		ReaderBiasedRWMutex() {}
+
+		// Don't allow copying or moving a ReaderBiasedRWMutex.
+		ReaderBiasedRWMutex(const ReaderBiasedRWMutex&) = delete;
+		ReaderBiasedRWMutex(ReaderBiasedRWMutex&&) = delete;
+		void operator=(const ReaderBiasedRWMutex&) = delete;
+		void operator=(ReaderBiasedRWMutex&&) = delete;
+
+		WAVM_API void lock(LockShareability shareability);
+		WAVM_API void unlock(LockShareability shareability);
+
+#if WAVM_ENABLE_ASSERTS
+		bool isExclusivelyLockedByCurrentThread()
+		{
+			return mutex.isExclusivelyLockedByCurrentThread();
+		}
+#endif
+
+		// Scoped lock: automatically unlocks when destructed.
+		struct Lock
+		{
+			Lock() : mutex(nullptr) {}
+			Lock(ReaderBiasedRWMutex& inMutex, LockShareability inShareability)
+			: mutex(&inMutex), shareability(inShareability)
+			{
+				mutex->lock(shareability);
+			}
+			~Lock() { unlock(); }
+
+			void unlock()
+			{
+				if(mutex)
+				{
+					mutex->unlock(shareability);
+					mutex = nullptr;
+				}
+			}
+
+		private:
+			ReaderBiasedRWMutex* mutex;
+			LockShareability shareability;
+		};
+
+		struct ExclusiveLock : Lock
+		{
+			ExclusiveLock() {}
+			ExclusiveLock(ReaderBiasedRWMutex& inMutex) : Lock(inMutex, exclusive) {}
+		};
+
+		struct ShareableLock : Lock
+		{
+			ShareableLock() {}
+			ShareableLock(ReaderBiasedRWMutex& inMutex) : Lock(inMutex, shareable) {}
+		};
+
+	private:
+		RWMutex mutex;
+
+		// Whether shared locks may use the threads' slots, and the monotonic clock time in
+		// nanoseconds before which a shared lock won't restore the bias.
+		std::atomic<bool> isReaderBiased{true};
+		std::atomic<U64> inhibitBiasUntilNS{0};
+	};
 }}
 
 #if WAVM_ENABLE_ASSERTS
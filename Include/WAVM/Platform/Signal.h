@@ -30,6 +30,31 @@ namespace WAVM { namespace Platform {
 							   bool (*filter)(void*, Signal, CallStack&&),
 							   void* argument);
 
+	// A signal filter that is installed once on a thread, and then shared by calls to
+	// catchSignalsInScope on the thread, so each call only needs to save the state to return to if
+	// a signal is caught. Scopes must be exited on the thread that entered them, in the reverse
+	// order that they were entered.
+	struct SignalScope;
+
+	WAVM_API SignalScope* enterSignalScope(bool (*filter)(void*, Signal, CallStack&&),
+										   void* filterArgument);
+	WAVM_API void exitSignalScope(SignalScope* scope);
+
+	// Calls thunk(argument), and if a signal that the scope's filter accepts occurs during the
+	// call, returns true instead of continuing the thunk. The calling thread must be the thread
+	// that entered the scope. If another signal context was established inside the scope, e.g. by
+	// catchSignals or on a fiber, falls back to catching signals with catchSignals.
+	WAVM_API bool catchSignalsInScope(SignalScope* scope, void (*thunk)(void*), void* argument);
+
+	// Starts interrupting the process's threads about samplesPerSecond times per second of CPU
+	// time they use, and calling sampleHandler with the address of the interrupted instruction.
+	// sampleHandler is called from a signal handler, so it may only do async-signal-safe things.
+	// Returns false if the host doesn't support sampling, or sampling was already started.
+	WAVM_API bool startSampling(U32 samplesPerSecond, void (*sampleHandler)(Uptr ip));
+
+	// Stops sampling, and waits for any calls to the sample handler to return.
+	WAVM_API void stopSampling();
+
 	WAVM_API void registerEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes);
 	WAVM_API void deregisterEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes);
 }}
@@ -11,5 +11,21 @@ namespace WAVM { namespace Platform {
 
 	WAVM_API Uptr getNumberOfHardwareThreads();
 
+	// Gets the range of addresses of the stack the calling thread is running on: the stack of the
+	// fiber it's running, or otherwise its own stack, excluding any part used to handle signals.
+	WAVM_API void getCurrentStack(U8*& outMinAddr, U8*& outMaxAddr);
+
+	// Returns the number of NUMA nodes, or 1 if the platform doesn't support NUMA.
+	WAVM_API Uptr getNumNUMANodes();
+
+	// Restricts the calling thread to run on the CPUs of the given NUMA node, and makes the memory
+	// it allocates prefer the node. Returns false if the platform doesn't support it, or the node
+	// doesn't exist.
+	WAVM_API bool bindCurrentThreadToNUMANode(Uptr node);
+
+	// Lowers the calling thread's scheduling priority, so it only runs when other threads would
+	// leave a CPU idle. Does nothing if the platform doesn't support it.
+	WAVM_API void setCurrentThreadBackgroundPriority();
+
 	WAVM_API void yieldToAnotherThread();
 }}
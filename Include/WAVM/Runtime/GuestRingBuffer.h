@@ -0,0 +1,191 @@
+#pragma once
+
+// The layout of a ring buffer of variable-size messages in a linear memory, and the functions that
+// guest code compiled to WebAssembly uses to write and read it. This header is C, so guest code can
+// include it, and the host includes it for the layout: see WAVM/Runtime/RingBuffer.h.
+//
+// A ring buffer has a single producer and a single consumer, either of which may be the host or
+// the guest. It starts with a header, which is followed by the message data. Messages are stored
+// as a 32-bit number of bytes followed by the bytes, padded to a multiple of 4 bytes. A message
+// that doesn't fit before the end of the data is preceded by a skip marker, and stored at the
+// start of the data. The read and write indices count the bytes that have been read and written,
+// and wrap around at 2^32. A side that blocks waiting for the other sets its waiting flag and
+// waits on the other side's index with memory.atomic.wait32, and the other side notifies it after
+// updating the index.
+
+#include <stdint.h>
+
+#define WAVM_RING_BUFFER_ALIGNMENT 64
+#define WAVM_RING_BUFFER_SKIP_MARKER 0xffffffffu
+#define WAVM_RING_BUFFER_MIN_DATA_BYTES 64u
+#define WAVM_RING_BUFFER_MAX_DATA_BYTES 0x80000000u
+
+// The indices read and written by each side are in separate cache lines.
+typedef struct wavm_ring_buffer_header
+{
+	// The number of bytes of message data that follow the header: a power of two between
+	// WAVM_RING_BUFFER_MIN_DATA_BYTES and WAVM_RING_BUFFER_MAX_DATA_BYTES.
+	uint32_t num_data_bytes;
+	uint8_t padding0[WAVM_RING_BUFFER_ALIGNMENT - 4];
+
+	uint32_t write_index;
+	uint32_t consumer_waiting;
+	uint8_t padding1[WAVM_RING_BUFFER_ALIGNMENT - 8];
+
+	uint32_t read_index;
+	uint32_t producer_waiting;
+	uint8_t padding2[WAVM_RING_BUFFER_ALIGNMENT - 8];
+} wavm_ring_buffer_header;
+
+#define WAVM_RING_BUFFER_HEADER_BYTES (WAVM_RING_BUFFER_ALIGNMENT * 3)
+
+// The number of bytes a message takes in the data, including its size.
+static inline uint32_t wavm_ring_buffer_record_bytes(uint32_t num_message_bytes)
+{
+	return 4 + ((num_message_bytes + 3) & ~3u);
+}
+
+// The largest message that fits in a ring buffer with the given amount of data. Any message up to
+// this size can be written once the buffer is empty, even if it must skip to the start of the data.
+static inline uint32_t wavm_ring_buffer_max_message_bytes(uint32_t num_data_bytes)
+{
+	return num_data_bytes / 2 - 4;
+}
+
+#if defined(__wasm__)
+
+#include <string.h>
+
+// Initializes an empty ring buffer at a WAVM_RING_BUFFER_ALIGNMENT-aligned address, with
+// num_data_bytes of message data following the header.
+static inline void wavm_ring_buffer_init(wavm_ring_buffer_header* ring, uint32_t num_data_bytes)
+{
+	memset(ring, 0, sizeof(*ring));
+	__atomic_store_n(&ring->num_data_bytes, num_data_bytes, __ATOMIC_SEQ_CST);
+}
+
+static inline uint8_t* wavm_ring_buffer_data(wavm_ring_buffer_header* ring)
+{
+	return (uint8_t*)ring + WAVM_RING_BUFFER_HEADER_BYTES;
+}
+
+// Writes a message without blocking. Returns 1 if the message was written, or 0 if there isn't
+// enough free space for it. The consumer doesn't see the message until wavm_ring_buffer_publish is
+// called, so a batch of messages can be published with one notification. *in_out_write_index is
+// the index after the messages written so far, which starts at ring->write_index.
+static inline int wavm_ring_buffer_try_write(wavm_ring_buffer_header* ring,
+											 const void* message,
+											 uint32_t num_message_bytes,
+											 uint32_t* in_out_write_index)
+{
+	const uint32_t num_data_bytes = ring->num_data_bytes;
+	if(num_message_bytes > wavm_ring_buffer_max_message_bytes(num_data_bytes)) { return 0; }
+
+	const uint32_t read_index = __atomic_load_n(&ring->read_index, __ATOMIC_ACQUIRE);
+	uint32_t write_index = *in_out_write_index;
+	uint32_t position = write_index & (num_data_bytes - 1);
+	const uint32_t num_contiguous_bytes = num_data_bytes - position;
+	const uint32_t num_record_bytes = wavm_ring_buffer_record_bytes(num_message_bytes);
+	const uint32_t num_needed_bytes = num_record_bytes <= num_contiguous_bytes
+										  ? num_record_bytes
+										  : num_contiguous_bytes + num_record_bytes;
+	if(num_data_bytes - (write_index - read_index) < num_needed_bytes) { return 0; }
+
+	uint8_t* data = wavm_ring_buffer_data(ring);
+	if(num_record_bytes > num_contiguous_bytes)
+	{
+		*(uint32_t*)(data + position) = WAVM_RING_BUFFER_SKIP_MARKER;
+		write_index += num_contiguous_bytes;
+		position = 0;
+	}
+	*(uint32_t*)(data + position) = num_message_bytes;
+	memcpy(data + position + 4, message, num_message_bytes);
+	*in_out_write_index = write_index + num_record_bytes;
+	return 1;
+}
+
+// Publishes the messages written since the last call, and wakes the consumer if it's waiting.
+static inline void wavm_ring_buffer_publish(wavm_ring_buffer_header* ring, uint32_t write_index)
+{
+	__atomic_store_n(&ring->write_index, write_index, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&ring->consumer_waiting, __ATOMIC_SEQ_CST))
+	{
+		__atomic_store_n(&ring->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+		__builtin_wasm_memory_atomic_notify((int*)&ring->write_index, UINT32_MAX);
+	}
+}
+
+// Calls visit_message for each published message, up to max_messages of them, then frees their
+// space and wakes the producer if it's waiting. Returns the number of messages visited.
+static inline uint32_t wavm_ring_buffer_read(wavm_ring_buffer_header* ring,
+											 void (*visit_message)(void* context,
+																   const void* message,
+																   uint32_t num_message_bytes),
+											 void* context,
+											 uint32_t max_messages)
+{
+	const uint32_t num_data_bytes = ring->num_data_bytes;
+	const uint32_t write_index = __atomic_load_n(&ring->write_index, __ATOMIC_SEQ_CST);
+	uint32_t read_index = ring->read_index;
+	const uint8_t* data = wavm_ring_buffer_data(ring);
+
+	uint32_t num_messages = 0;
+	while(read_index != write_index && num_messages < max_messages)
+	{
+		const uint32_t position = read_index & (num_data_bytes - 1);
+		const uint32_t num_message_bytes = *(const uint32_t*)(data + position);
+		if(num_message_bytes == WAVM_RING_BUFFER_SKIP_MARKER)
+		{
+			read_index += num_data_bytes - position;
+			continue;
+		}
+		visit_message(context, data + position + 4, num_message_bytes);
+		read_index += wavm_ring_buffer_record_bytes(num_message_bytes);
+		++num_messages;
+	}
+
+	__atomic_store_n(&ring->read_index, read_index, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&ring->producer_waiting, __ATOMIC_SEQ_CST))
+	{
+		__atomic_store_n(&ring->producer_waiting, 0, __ATOMIC_SEQ_CST);
+		__builtin_wasm_memory_atomic_notify((int*)&ring->read_index, UINT32_MAX);
+	}
+	return num_messages;
+}
+
+// Blocks the consumer until there is a published message to read, or the timeout in nanoseconds
+// elapses. A negative timeout waits forever. Returns 1 if there is a message to read.
+static inline int wavm_ring_buffer_wait_for_messages(wavm_ring_buffer_header* ring,
+													 int64_t timeout_nanoseconds)
+{
+	const uint32_t read_index = ring->read_index;
+	uint32_t write_index = __atomic_load_n(&ring->write_index, __ATOMIC_SEQ_CST);
+	if(write_index == read_index)
+	{
+		__atomic_store_n(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+		write_index = __atomic_load_n(&ring->write_index, __ATOMIC_SEQ_CST);
+		if(write_index == read_index)
+		{
+			__builtin_wasm_memory_atomic_wait32(
+				(int*)&ring->write_index, (int)write_index, timeout_nanoseconds);
+			write_index = __atomic_load_n(&ring->write_index, __ATOMIC_SEQ_CST);
+		}
+	}
+	return write_index != read_index;
+}
+
+// Blocks the producer until the consumer reads some messages, or the timeout in nanoseconds
+// elapses. A negative timeout waits forever.
+static inline void wavm_ring_buffer_wait_for_space(wavm_ring_buffer_header* ring,
+												   uint32_t observed_read_index,
+												   int64_t timeout_nanoseconds)
+{
+	__atomic_store_n(&ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&ring->read_index, __ATOMIC_SEQ_CST) == observed_read_index)
+	{
+		__builtin_wasm_memory_atomic_wait32(
+			(int*)&ring->read_index, (int)observed_read_index, timeout_nanoseconds);
+	}
+}
+
+#endif
@@ -30,21 +30,36 @@ namespace WAVM { namespace Intrinsics {
 		std::string&& debugName);
 
 	// An intrinsic function.
+	// An intrinsic function may also have an inline body: the text of an LLVM IR module that
+	// defines a single function with the intrinsic's parameter types, returning its result or void,
+	// without the ContextRuntimeData parameter. The module may only declare LLVM intrinsics.
+	// Instances of modules that specialize their instances (see
+	// Runtime::setGlobalSpecializeInstances) inline the body into calls to the intrinsic.
+	// Other calls use the native function, so the two must behave the same.
+	// An intrinsic function with the C calling convention is pure: its native function takes no
+	// ContextRuntimeData parameter, and its result only depends on its arguments. It must not
+	// access memory other than its own stack, throw exceptions, or trap. Instances of modules that
+	// specialize their instances call the native function directly instead of the intrinsic's
+	// thunk, and the calls may be combined, hoisted out of loops, or removed if unused.
 	struct Function
 	{
 		WAVM_API Function(Intrinsics::Module* moduleRef,
 						  const char* inName,
 						  void* inNativeFunction,
-						  IR::FunctionType type);
+						  IR::FunctionType type,
+						  const char* inInlineLLVMIR = nullptr);
 
 		const char* getName() const { return name; }
 		IR::FunctionType getType() const { return type; }
 		void* getNativeFunction() const { return nativeFunction; }
+		const char* getInlineLLVMIR() const { return inlineLLVMIR; }
+		bool isPure() const { return type.callingConvention() == IR::CallingConvention::c; }
 
 	private:
 		const char* name;
 		IR::FunctionType type;
 		void* nativeFunction;
+		const char* inlineLLVMIR;
 	};
 
 	// The base class of Intrinsic globals.
@@ -132,6 +147,13 @@ namespace WAVM { namespace Intrinsics {
 								IR::TypeTuple({IR::inferValueType<Args>()...}),
 								WAVM::IR::CallingConvention::intrinsicWithContextSwitch);
 	}
+	template<typename R, typename... Args>
+	IR::FunctionType inferPureIntrinsicFunctionType(R (*)(Args...))
+	{
+		return IR::FunctionType(IR::inferResultType<R>(),
+								IR::TypeTuple({IR::inferValueType<Args>()...}),
+								WAVM::IR::CallingConvention::c);
+	}
 }}
 
 #define WAVM_DEFINE_INTRINSIC_MODULE(name)                                                         \
@@ -155,6 +177,17 @@ namespace WAVM { namespace Intrinsics {
 		WAVM::Intrinsics::inferIntrinsicFunctionType(&cName));                                     \
 	static Result cName(WAVM::Runtime::ContextRuntimeData* contextRuntimeData, ##__VA_ARGS__)
 
+#define WAVM_DEFINE_INTRINSIC_FUNCTION_WITH_INLINE_IR(                                             \
+	module, nameString, inlineIR, Result, cName, ...)                                              \
+	static Result cName(WAVM::Runtime::ContextRuntimeData* contextRuntimeData, ##__VA_ARGS__);     \
+	static WAVM::Intrinsics::Function cName##Intrinsic(                                            \
+		getIntrinsicModule_##module(),                                                             \
+		nameString,                                                                                \
+		(void*)&cName,                                                                             \
+		WAVM::Intrinsics::inferIntrinsicFunctionType(&cName),                                      \
+		inlineIR);                                                                                 \
+	static Result cName(WAVM::Runtime::ContextRuntimeData* contextRuntimeData, ##__VA_ARGS__)
+
 #define WAVM_DEFINE_INTRINSIC_FUNCTION_WITH_CONTEXT_SWITCH(module, nameString, Result, cName, ...) \
 	static WAVM::Intrinsics::ResultInContextRuntimeData<Result>* cName(                            \
 		WAVM::Runtime::ContextRuntimeData* contextRuntimeData, ##__VA_ARGS__);                     \
@@ -166,6 +199,15 @@ namespace WAVM { namespace Intrinsics {
 	static WAVM::Intrinsics::ResultInContextRuntimeData<Result>* cName(                            \
 		WAVM::Runtime::ContextRuntimeData* contextRuntimeData, ##__VA_ARGS__)
 
+#define WAVM_DEFINE_PURE_INTRINSIC_FUNCTION(module, nameString, Result, cName, ...)                \
+	static Result cName(__VA_ARGS__);                                                              \
+	static WAVM::Intrinsics::Function cName##Intrinsic(                                            \
+		getIntrinsicModule_##module(),                                                             \
+		nameString,                                                                                \
+		(void*)&cName,                                                                             \
+		WAVM::Intrinsics::inferPureIntrinsicFunctionType(&cName));                                 \
+	static Result cName(__VA_ARGS__)
+
 #define WAVM_DEFINE_UNIMPLEMENTED_INTRINSIC_FUNCTION(module, nameString, Result, cName, ...)       \
 	WAVM_DEFINE_INTRINSIC_FUNCTION(module, nameString, Result, cName, __VA_ARGS__)                 \
 	{                                                                                              \
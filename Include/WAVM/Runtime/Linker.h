@@ -19,6 +19,14 @@ namespace WAVM { namespace Runtime {
 							 IR::ExternType type,
 							 Object*& outObject)
 			= 0;
+
+		// Must be called when the objects the resolver returns for an import change, so link
+		// plans computed with the resolver are recomputed.
+		void invalidateLinkPlans() { ++linkPlanEpoch; }
+		U64 getLinkPlanEpoch() const { return linkPlanEpoch; }
+
+	private:
+		U64 linkPlanEpoch = 0;
 	};
 
 	// A resolver that always returns failure.
@@ -86,4 +94,19 @@ namespace WAVM { namespace Runtime {
 	};
 
 	WAVM_API LinkResult linkModule(const IR::Module& module, Resolver& resolver);
+
+	// The objects a resolver returned for a module's imports, which can be replayed to link the
+	// module again without resolving each import by name. A plan holds GC roots for the objects,
+	// so it must be destroyed before their compartment is collected.
+	struct LinkPlan
+	{
+		const Resolver* resolver = nullptr;
+		U64 resolverLinkPlanEpoch = 0;
+		std::vector<GCPointer<Object>> resolvedImports;
+	};
+
+	// Links a module like above, but if plan was computed for the module with the same resolver,
+	// and the resolver hasn't invalidated its link plans since, returns the objects in the plan.
+	// Otherwise, links the module with the resolver, and updates the plan if linking succeeded.
+	WAVM_API LinkResult linkModule(const IR::Module& module, Resolver& resolver, LinkPlan& plan);
 }}
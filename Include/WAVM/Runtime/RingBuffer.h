@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Runtime/GuestRingBuffer.h"
+#include "WAVM/Runtime/Runtime.h"
+
+namespace WAVM { namespace Runtime {
+	// A message to write to a MemoryRingBuffer.
+	struct RingBufferMessage
+	{
+		const void* data;
+		U32 numBytes;
+	};
+
+	// The host side of a ring buffer of variable-size messages in a memory, which lets the host
+	// and a guest exchange batches of messages without a call per message. The layout is defined
+	// by WAVM/Runtime/GuestRingBuffer.h, which also has the functions that guest code uses to
+	// write and read the same ring buffers. Each ring buffer has a single producer and a single
+	// consumer. The memory should be shared if the guest accesses the ring buffer from other
+	// threads.
+	//
+	// The header is validated when the MemoryRingBuffer is created, and the guest can't make the
+	// host access anything outside the ring buffer by corrupting its indices or messages: that
+	// throws an outOfBoundsMemoryAccess exception from the next read or write. The ring buffer's
+	// address in the host's address space is looked up by each operation, since growing a 64-bit
+	// memory may move it.
+	struct MemoryRingBuffer
+	{
+		// Initializes an empty ring buffer at an address in the memory. The address must be a
+		// multiple of WAVM_RING_BUFFER_ALIGNMENT, and numDataBytes must be a power of two between
+		// WAVM_RING_BUFFER_MIN_DATA_BYTES and WAVM_RING_BUFFER_MAX_DATA_BYTES. Throws an
+		// outOfBoundsMemoryAccess exception if the ring buffer isn't within the memory's bounds.
+		WAVM_API static void init(Memory* memory, Uptr address, U32 numDataBytes);
+
+		// Opens the ring buffer at an address in the memory. Throws an outOfBoundsMemoryAccess
+		// exception if its header isn't valid or it isn't within the memory's bounds.
+		WAVM_API MemoryRingBuffer(Memory* memory, Uptr address);
+
+		// The largest message that can be written to the ring buffer.
+		U32 getMaxMessageBytes() const { return wavm_ring_buffer_max_message_bytes(numDataBytes); }
+
+		// Writes as many of the messages as there is free space for, in order, and wakes the
+		// consumer once if it's waiting. Returns the number of messages written.
+		WAVM_API Uptr tryWrite(const RingBufferMessage* messages, Uptr numMessages);
+
+		// Writes all the messages, blocking while the ring buffer is full until the consumer reads
+		// some of them or the timeout in nanoseconds elapses. A negative timeout waits forever.
+		// Returns the number of messages written.
+		WAVM_API Uptr write(const RingBufferMessage* messages,
+							Uptr numMessages,
+							I64 timeoutNanoseconds = -1);
+
+		// Calls visitMessage for each message that has been written, up to maxMessages of them,
+		// then frees their space and wakes the producer if it's waiting. The message bytes passed
+		// to visitMessage are in the memory, and may only be used until visitMessage returns.
+		// Returns the number of messages read.
+		WAVM_API Uptr read(const std::function<void(const U8* data, U32 numBytes)>& visitMessage,
+						   Uptr maxMessages = UINTPTR_MAX);
+
+		// Blocks until there is a message to read, or the timeout in nanoseconds elapses. A
+		// negative timeout waits forever. Returns true if there is a message to read.
+		WAVM_API bool waitForMessages(I64 timeoutNanoseconds = -1);
+
+	private:
+		Memory* memory;
+		Uptr address;
+		U32 numDataBytes;
+
+		// Returns the address of the ring buffer's header in the memory's current reservation.
+		U8* getHeader() const;
+	};
+}}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <string.h>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/IR/Types.h"
@@ -18,6 +22,10 @@ namespace WAVM {
 	namespace WASM {
 		struct LoadError;
 	}
+	namespace LLVMJIT {
+		struct CompileOptions;
+		struct ModuleProfile;
+	}
 };
 
 // Declare the different kinds of objects. They are only declared as incomplete struct types here,
@@ -147,14 +155,48 @@ namespace WAVM { namespace Runtime {
 	// Decrements the object's counter of root referencers.
 	WAVM_API void removeGCRoot(const Object* object) noexcept;
 
-	// Frees any unreferenced objects owned by a compartment.
+	// Frees any unreferenced objects owned by a compartment. Other threads may keep using the
+	// compartment while it's collected: the compartment is only locked while the collector takes
+	// a snapshot of its objects, and while it frees the objects that were unreferenced when the
+	// snapshot was taken.
 	WAVM_API void collectCompartmentGarbage(Compartment* compartment);
 
+	// Frees unreferenced objects that were added to a compartment since its last garbage
+	// collection. It only scans those objects, the tables written since the last collection, and
+	// the compartment's reference globals, so it is much cheaper than collectCompartmentGarbage
+	// for a compartment with many long-lived objects, but it doesn't free older objects.
+	WAVM_API void collectYoungCompartmentGarbage(Compartment* compartment);
+
 	// Clears the given GC root reference to a compartment, and collects garbage for it. Returns
 	// true if the entire compartment was freed by the operation, or false if there are remaining
 	// root references that can reach it.
 	WAVM_API bool tryCollectCompartment(GCPointer<Compartment>&& compartment);
 
+	// Configures the background garbage collection of a compartment.
+	struct BackgroundGCConfig
+	{
+		// How many instances, memories and tables may be created in the compartment since its
+		// last garbage collection before the background collector collects it.
+		Uptr numObjectsPerCollection = 256;
+
+		// How many background collections only collect the young objects for each collection of
+		// all the compartment's objects. If it's 0, every background collection is a full
+		// collection.
+		Uptr numYoungCollectionsPerFullCollection = 7;
+	};
+
+	// Makes a low-priority background thread collect the compartment's garbage whenever enough
+	// objects have been created in it since its last collection, so the threads that use the
+	// compartment don't need to call collectCompartmentGarbage. The background collector holds a
+	// root reference to the compartment while it collects it. Calling it for a compartment that
+	// is already collected in the background changes its configuration.
+	WAVM_API void enableBackgroundGC(Compartment* compartment,
+									 const BackgroundGCConfig& config = BackgroundGCConfig());
+
+	// Stops collecting the compartment's garbage in the background, and waits for any background
+	// collection of it to finish. tryCollectCompartment calls it implicitly.
+	WAVM_API void disableBackgroundGC(Compartment* compartment);
+
 	//
 	// Exception types
 	//
@@ -182,7 +224,9 @@ namespace WAVM { namespace Runtime {
 	visit(outOfMemory);                                                                            \
 	visit(misalignedAtomicMemoryAccess, WAVM::IR::ValueType::i64);                                 \
 	visit(waitOnUnsharedMemory, WAVM::IR::ValueType::externref);                                   \
-	visit(invalidArgument);
+	visit(invalidArgument);                                                                        \
+	visit(interrupted);                                                                            \
+	visit(outOfFuel);
 
 	// Information about a runtime exception.
 	namespace ExceptionTypes {
@@ -202,6 +246,13 @@ namespace WAVM { namespace Runtime {
 	// Returns the parameter types for an exception type instance.
 	WAVM_API IR::TypeTuple getExceptionTypeParameters(const ExceptionType* type);
 
+	// Sets whether exceptions of the given type capture the call stack they're thrown from, which
+	// is on by default. Capturing the call stack is most of the cost of throwing an exception, so
+	// it should be turned off for exception types that are used for control flow.
+	// Exceptions created from signals (e.g. out-of-bounds memory accesses) still capture the call
+	// stack when the signal occurs, but it is discarded if their exception type doesn't capture.
+	WAVM_API void setExceptionTypeCapturesCallStack(ExceptionType* type, bool capturesCallStack);
+
 	//
 	// Resource quotas
 	//
@@ -222,6 +273,61 @@ namespace WAVM { namespace Runtime {
 	WAVM_API Uptr getResourceQuotaCurrentMemoryPages(ResourceQuotaConstRefParam);
 	WAVM_API void setResourceQuotaMaxMemoryPages(ResourceQuotaRefParam, Uptr maxMemoryPages);
 
+	// Lets each thread that grows tables or memories charged to the quota reserve the quota in
+	// chunks of the given size, which reduces contention when many threads grow them at once.
+	// Quota that is reserved but not yet used isn't included in the current value, but may keep
+	// other threads from allocating quota until it is reclaimed. The default, 0, disables it.
+	WAVM_API void setResourceQuotaTableElemsReservationChunk(ResourceQuotaRefParam,
+															 Uptr numTableElems);
+	WAVM_API void setResourceQuotaMemoryPagesReservationChunk(ResourceQuotaRefParam,
+															  Uptr numMemoryPages);
+
+	// The fuel that contexts charged to the quota may consume. The current fuel includes fuel that
+	// has been given to the contexts but not yet consumed, which is returned to the quota when the
+	// context is destroyed or charged to another quota. See setContextResourceQuota.
+	WAVM_API U64 getResourceQuotaMaxFuel(ResourceQuotaConstRefParam);
+	WAVM_API U64 getResourceQuotaCurrentFuel(ResourceQuotaConstRefParam);
+	WAVM_API void setResourceQuotaMaxFuel(ResourceQuotaRefParam, U64 maxFuel);
+
+	// Sets how much fuel a context charged to the quota takes from it each time it runs out.
+	// Smaller amounts make the quota's current fuel more precise, but make contexts call into the
+	// runtime more often.
+	WAVM_API void setResourceQuotaFuelRefillAmount(ResourceQuotaRefParam, U64 fuelRefillAmount);
+
+	// Whether memories created with the quota prefault their pages: see setMemoryPrefault. The
+	// default is false.
+	WAVM_API bool getResourceQuotaPrefaultMemories(ResourceQuotaConstRefParam);
+	WAVM_API void setResourceQuotaPrefaultMemories(ResourceQuotaRefParam, bool prefaultMemories);
+
+	//
+	// Memory pools
+	//
+
+	// A memory pool reserves the address space for a fixed number of 32-bit memories up front, and
+	// reuses it for memories created in compartments that use the pool. When a pooled memory is
+	// freed, its pages are decommitted and its slot in the pool is reused by the next memory,
+	// instead of unmapping and remapping its address space.
+	struct MemoryPool;
+	typedef std::shared_ptr<MemoryPool> MemoryPoolRef;
+	typedef const std::shared_ptr<MemoryPool>& MemoryPoolRefParam;
+
+	// Creates a memory pool with the given number of slots. Returns null if the address space for
+	// the slots could not be reserved.
+	//
+	// If useProtectionKeys is true and the host supports memory protection keys (Linux on x86-64),
+	// the slots are divided into stripes that are each tagged with a different key, and each
+	// compartment that uses the pool is assigned a stripe. Invoking a function in the compartment
+	// denies the thread access to the other stripes, so a memory's slot only needs to be large
+	// enough for its pages, instead of its whole 8GB reserved address space. This reduces the
+	// address space reserved for each memory by up to 15x, but limits pooled memories to the size
+	// of a slot. Outside of invoking functions, only the thread that created the pool and threads
+	// it created afterward may access its memories. A compartment's pool can't be changed once it
+	// has memories.
+	WAVM_API MemoryPoolRef createMemoryPool(Uptr numSlots, bool useProtectionKeys = false);
+
+	WAVM_API Uptr getMemoryPoolNumSlots(MemoryPoolRefParam);
+	WAVM_API Uptr getMemoryPoolNumFreeSlots(MemoryPoolRefParam);
+
 	//
 	// Exceptions
 	//
@@ -268,6 +374,26 @@ namespace WAVM { namespace Runtime {
 	// Calls a thunk and ensures that any signals that occur within the thunk will be thrown as
 	// runtime exceptions.
 	WAVM_API void unwindSignalsAsExceptions(const std::function<void()>& thunk);
+	WAVM_API void unwindSignalsAsExceptions(void (*thunk)(void*), void* argument);
+
+	// While an ExecutionScope exists on a thread, unwindSignalsAsExceptions (and so the invoke
+	// functions) on that thread share signal catching state that the scope set up once, instead of
+	// setting it up for each call. This reduces the cost of making many short calls into
+	// WebAssembly code. Scopes may be nested, and must be destroyed on the thread that created
+	// them, in the reverse order that they were created.
+	struct ExecutionScope
+	{
+		WAVM_API ExecutionScope();
+		WAVM_API ~ExecutionScope();
+
+		ExecutionScope(const ExecutionScope&) = delete;
+		ExecutionScope(ExecutionScope&&) = delete;
+		void operator=(const ExecutionScope&) = delete;
+		void operator=(ExecutionScope&&) = delete;
+
+	private:
+		struct ExecutionScopeState* state;
+	};
 
 	// Describes the source of an instruction; may be either WASM or native code.
 	struct InstructionSource
@@ -316,9 +442,190 @@ namespace WAVM { namespace Runtime {
 								 const IR::UntaggedValue arguments[] = nullptr,
 								 IR::UntaggedValue results[] = nullptr);
 
+	// Checks that a function can be invoked with the given signature, and returns the thunk that
+	// invokeFunctionWithThunk uses to invoke it. Returns null if the signature doesn't match the
+	// function's type.
+	WAVM_API const void* getInvokeThunk(const Function* function, IR::FunctionType invokeSig);
+
+	// Invokes a Function like invokeFunction, but with an invoke thunk returned by getInvokeThunk
+	// for it instead of checking the signature on each call.
+	WAVM_API void invokeFunctionWithThunk(Context* context,
+										  const Function* function,
+										  const void* invokeThunk,
+										  const IR::UntaggedValue arguments[],
+										  IR::UntaggedValue results[]);
+
+	// Invokes a Function numInvokes times: invoke i reads its arguments from
+	// arguments[i * numParams], and writes its results to results[i * numResults]. The signature
+	// is checked, and runtime exceptions caught, once for the whole batch. If an invoke throws a
+	// runtime exception, the batch stops, and the exception is written to outException if it is
+	// non-null (the caller must then call destroyException), and otherwise destroyed.
+	// Returns the number of invokes that completed, which is the index of the invoke that threw
+	// if it's less than numInvokes.
+	WAVM_API Uptr invokeFunctionBatch(Context* context,
+									  const Function* function,
+									  IR::FunctionType invokeSig,
+									  Uptr numInvokes,
+									  const IR::UntaggedValue arguments[],
+									  IR::UntaggedValue results[],
+									  Exception** outException = nullptr);
+
+	// A Function that was checked once to have the type Result(Args...), so it can be called
+	// without invokeFunction's per-call signature check, thunk lookup, and argument arrays in the
+	// caller. Result may be void or a single value type.
+	template<typename Signature> struct TypedFunction;
+	template<typename Result, typename... Args> struct TypedFunction<Result(Args...)>
+	{
+		TypedFunction() {}
+
+		// Binds the TypedFunction to a function. Returns false and leaves it unbound if the
+		// function's type doesn't match Result(Args...).
+		bool bind(const Function* inFunction)
+		{
+			const std::initializer_list<IR::ValueType> params = {IR::inferValueType<Args>()...};
+			const IR::FunctionType signature(IR::inferResultType<Result>(), IR::TypeTuple(params));
+			invokeThunk = inFunction ? getInvokeThunk(inFunction, signature) : nullptr;
+			function = invokeThunk ? inFunction : nullptr;
+			return function != nullptr;
+		}
+
+		const Function* getFunction() const { return function; }
+
+		Result operator()(Context* context, Args... args) const
+		{
+			WAVM_ASSERT(function);
+			IR::UntaggedValue arguments[sizeof...(Args) ? sizeof...(Args) : 1]
+				= {IR::UntaggedValue(args)...};
+			IR::UntaggedValue results[1];
+			invokeFunctionWithThunk(context, function, invokeThunk, arguments, results);
+			return getResult<Result>(results[0]);
+		}
+
+	private:
+		const Function* function = nullptr;
+		const void* invokeThunk = nullptr;
+
+		template<typename Value>
+		static typename std::enable_if<!std::is_void<Value>::value, Value>::type getResult(
+			const IR::UntaggedValue& untaggedValue)
+		{
+			Value value;
+			memcpy(&value, untaggedValue.bytes, sizeof(Value));
+			return value;
+		}
+		template<typename Value>
+		static typename std::enable_if<std::is_void<Value>::value>::type getResult(
+			const IR::UntaggedValue&)
+		{
+		}
+	};
+
 	// Returns the type of a Function.
 	WAVM_API IR::FunctionType getFunctionType(const Function* function);
 
+	//
+	// Fibers
+	//
+
+	// A Fiber invokes a Function on its own stack, so a host function that it calls can suspend it
+	// and return control to the code that resumed it, which can resume it again later. A Fiber
+	// must only be resumed on the thread that created it. While a fiber is suspended, the objects
+	// referenced by its stack aren't GC roots, other than its context and function.
+	struct Fiber;
+
+	// Creates a Fiber that invokes a Function with the given arguments when it is first resumed.
+	// The arguments are copied. If the provided function type does not match the actual type of
+	// the function, then an invokeSignatureMismatch exception is thrown. If numStackBytes is 0,
+	// the fiber's stack has a default size.
+	WAVM_API Fiber* createFiber(Context* context,
+								const Function* function,
+								IR::FunctionType invokeSig = IR::FunctionType(),
+								const IR::UntaggedValue arguments[] = nullptr,
+								Uptr numStackBytes = 0);
+
+	// Destroys a Fiber that isn't running. If the fiber is suspended, its stack is freed without
+	// unwinding it, so the destructors of the C++ objects on it aren't called.
+	WAVM_API void destroyFiber(Fiber* fiber);
+
+	// Runs a Fiber until its function returns, or it is suspended. Returns true if the function
+	// returned, and writes its results to the given results array. If the function throws an
+	// exception, it is rethrown by resumeFiber. Must not be called again after the function has
+	// returned or thrown. The fiber is also suspended while it waits for asynchronous file I/O.
+	WAVM_API bool resumeFiber(Fiber* fiber, IR::UntaggedValue results[] = nullptr);
+
+	// Suspends the Fiber that is running on the calling thread, returning from the resumeFiber
+	// call that is running it. Returns when the fiber is resumed. Must only be called by a host
+	// function that is called by a Fiber.
+	WAVM_API void suspendFiber();
+
+	// Returns the Fiber that is running on the calling thread, or null if there isn't one.
+	WAVM_API Fiber* getCurrentFiber();
+
+	// Invokes a Function like invokeFunction, but on a fiber stack with numStackBytes (or a
+	// default size if numStackBytes is 0) instead of the calling thread's stack. The stacks are
+	// pooled, so threads with small stacks can run WebAssembly code that needs a large stack
+	// without allocating one for each call. Platform::reserveFiberStacks can allocate the stacks
+	// ahead of time. The function must not suspend the fiber, and file I/O it does blocks the
+	// thread instead of suspending it.
+	WAVM_API void invokeFunctionOnFiberStack(Context* context,
+											 const Function* function,
+											 IR::FunctionType invokeSig = IR::FunctionType(),
+											 const IR::UntaggedValue arguments[] = nullptr,
+											 IR::UntaggedValue results[] = nullptr,
+											 Uptr numStackBytes = 0);
+
+	//
+	// Executors
+	//
+
+	// An Executor invokes Functions in a compartment on a pool of worker threads. Each worker has
+	// its own queue of tasks, and a worker that runs out of tasks steals them from the other
+	// workers' queues. Each worker creates a Context when it starts, and reuses it and its signal
+	// catching state for all the tasks it runs, so tasks that run on the same worker share the
+	// values of the context's mutable globals.
+	struct Executor;
+
+	struct ExecutorConfig
+	{
+		// The number of worker threads. If 0, there is a worker for each hardware thread.
+		Uptr numWorkerThreads = 0;
+
+		// The size of each worker thread's stack, which WebAssembly code runs on.
+		Uptr numStackBytes = 8 * 1024 * 1024;
+	};
+
+	// The outcome of a task run by an Executor. If the function threw a runtime exception,
+	// exception is non-null, and the caller must call destroyException; otherwise results holds
+	// the function's results.
+	struct ExecutorResult
+	{
+		std::vector<IR::UntaggedValue> results;
+		Exception* exception = nullptr;
+	};
+
+	// Creates an Executor with worker threads that run on the compartment's NUMA node, if it has
+	// one. The Executor must be destroyed before the compartment is collected.
+	WAVM_API Executor* createExecutor(Compartment* compartment,
+									  const ExecutorConfig& config = ExecutorConfig());
+
+	// Waits for the tasks submitted to an Executor to finish, and then destroys it.
+	WAVM_API void destroyExecutor(Executor* executor);
+
+	// Queues a task that invokes a Function in the Executor's compartment with the given
+	// arguments, and returns a future for its result. The arguments are copied. If the provided
+	// function type does not match the actual type of the function, then an
+	// invokeSignatureMismatch exception is thrown. A task may submit other tasks, but must not
+	// wait for their results.
+	WAVM_API std::future<ExecutorResult> submitToExecutor(Executor* executor,
+														  const Function* function,
+														  IR::FunctionType invokeSig
+														  = IR::FunctionType(),
+														  const IR::UntaggedValue arguments[]
+														  = nullptr);
+
+	// Returns the number of worker threads that an Executor has.
+	WAVM_API Uptr getExecutorNumWorkerThreads(const Executor* executor);
+
 	//
 	// Tables
 	//
@@ -360,7 +667,9 @@ namespace WAVM { namespace Runtime {
 								  std::string&& debugName,
 								  ResourceQuotaRefParam resourceQuota = ResourceQuotaRef());
 
-	// Gets the base address of the memory's data.
+	// Gets the base address of the memory's data. Growing an unshared 64-bit memory whose maximum
+	// size is larger than memory64NumInitialReservedBytes may move it to a new address, so the
+	// address shouldn't be used after the memory may have grown.
 	WAVM_API U8* getMemoryBaseAddress(Memory* memory);
 
 	// Gets the current size of the memory in pages.
@@ -372,9 +681,39 @@ namespace WAVM { namespace Runtime {
 	// Grows or shrinks the size of a memory by numPages. Returns the previous size of the memory.
 	WAVM_API GrowResult growMemory(Memory* memory, Uptr numPages, Uptr* outOldNumPages = nullptr);
 
+	// Sets whether growing a memory populates the new pages with physical memory, so the first
+	// access to each of them doesn't page fault. Growing it by less than
+	// memoryBackgroundPrefaultBytes populates the pages before growMemory returns; larger grows
+	// return immediately, and the pages are populated by a background thread, so accesses to pages
+	// it hasn't reached yet still fault. Memories created with a quota that prefaults memories also prefault their initial
+	// pages, and clones of a memory inherit the setting. Has no effect if the platform can't
+	// populate pages: it requires Linux 5.14.
+	static constexpr Uptr memoryBackgroundPrefaultBytes = Uptr(32) * 1024 * 1024;
+	WAVM_API void setMemoryPrefault(Memory* memory, bool prefault);
+
 	// Unmaps a range of memory pages within the memory's address-space.
 	WAVM_API void unmapMemoryPages(Memory* memory, Uptr pageIndex, Uptr numPages);
 
+	// Maps a range of a host file (a file descriptor on POSIX) into a memory, replacing the
+	// contents of the platform pages that contain the bytes [offset, offset + numBytes). offset and
+	// fileOffset must be multiples of the platform page size, and the range must be inside the
+	// memory's current size. If copyOnWrite is false, the pages are read-only, and writing them
+	// traps. Otherwise, the pages are copied to the memory when they are first written. Returns
+	// false if the range is invalid or the file couldn't be mapped.
+	WAVM_API bool mapFileToMemory(Memory* memory,
+								  Uptr offset,
+								  Uptr numBytes,
+								  Uptr hostHandle,
+								  U64 fileOffset,
+								  bool copyOnWrite);
+
+	// Replaces the platform pages that contain the bytes [offset, offset + numBytes) of a memory
+	// with zeroed read-write pages, such as to unmap a file mapped by mapFileToMemory, or to
+	// release the physical memory committed to pages that the memory's user no longer needs.
+	// offset must be a multiple of the platform page size, and the range must be inside the
+	// memory's current size. Returns false if the range is invalid.
+	WAVM_API bool resetMemoryPages(Memory* memory, Uptr offset, Uptr numBytes);
+
 	// Validates that an offset range is wholly inside a Memory's virtual address range.
 	// Note that this returns an address range that may fault on access, though it's guaranteed not
 	// to be mapped by anything other than the given Memory.
@@ -394,9 +733,94 @@ namespace WAVM { namespace Runtime {
 	// to it.
 	template<typename Value> Value* memoryArrayPtr(Memory* memory, Uptr offset, Uptr numElements)
 	{
-		return (Value*)getValidatedMemoryOffsetRange(memory, offset, numElements * sizeof(Value));
+		// If the number of bytes overflows, validate a range that can't be in bounds.
+		const Uptr numBytes
+			= numElements > UINTPTR_MAX / sizeof(Value) ? UINTPTR_MAX : numElements * sizeof(Value);
+		return (Value*)getValidatedMemoryOffsetRange(memory, offset, numBytes);
 	}
 
+	// A typed view of contiguous elements in a memory's committed pages, which lets host code read
+	// and write guest data in place. The range is validated once when the span is created, and the
+	// span doesn't follow the memory if it changes: growMemory and memory.grow invalidate all spans
+	// of the memory, since growing an unshared 64-bit memory may move it to a new address (see
+	// getMemoryBaseAddress), and resetInstance may shrink it. The old address of a moved memory
+	// may stay mapped, so using an invalidated span may silently read or write the wrong pages.
+	// Host functions may use spans until they return or call back into the guest, and must create
+	// new spans after the memory may have grown. Accessing the span may still fault if its
+	// pages are unmapped by unmapMemoryPages, so accesses should be inside catchRuntimeExceptions
+	// or unwindSignalsAsExceptions, like accesses through memoryArrayPtr.
+	template<typename Value> struct MemorySpan
+	{
+		MemorySpan() : elements(nullptr), numElements(0) {}
+
+		// Validates numElements elements at the given offset in the memory, and throws an
+		// outOfBoundsMemoryAccess exception if they aren't all in bounds.
+		MemorySpan(Memory* memory, Uptr offset, Uptr inNumElements)
+		: elements(memoryArrayPtr<Value>(memory, offset, inNumElements)), numElements(inNumElements)
+		{
+		}
+
+		// Creates a span of elements that have already been validated to be in bounds.
+		MemorySpan(Value* inElements, Uptr inNumElements)
+		: elements(inElements), numElements(inNumElements)
+		{
+		}
+
+		Value* data() const { return elements; }
+		Uptr size() const { return numElements; }
+		Uptr numBytes() const { return numElements * sizeof(Value); }
+		bool empty() const { return numElements == 0; }
+
+		Value* begin() const { return elements; }
+		Value* end() const { return elements + numElements; }
+
+		Value& operator[](Uptr index) const
+		{
+			WAVM_ASSERT(index < numElements);
+			return elements[index];
+		}
+
+		// Returns a span of numSubElements elements starting at subOffset within this span.
+		MemorySpan subspan(Uptr subOffset, Uptr numSubElements) const
+		{
+			WAVM_ASSERT(subOffset <= numElements && numSubElements <= numElements - subOffset);
+			return MemorySpan(elements + subOffset, numSubElements);
+		}
+
+	private:
+		Value* elements;
+		Uptr numElements;
+	};
+
+	// The address and size of one buffer of a scatter/gather list in a memory, like a WASI iovec.
+	struct MemoryIOV
+	{
+		Uptr offset;
+		Uptr numBytes;
+	};
+
+	// Validates each buffer of a scatter/gather list in a memory, and writes a span for it to
+	// outSpans, which must have room for numIOVs spans. Throws an outOfBoundsMemoryAccess exception
+	// if any of the buffers aren't in bounds. Returns the total number of bytes in the buffers.
+	WAVM_API U64 getMemoryIOVSpans(Memory* memory,
+								   const MemoryIOV* iovs,
+								   Uptr numIOVs,
+								   MemorySpan<U8>* outSpans);
+
+	// Copies up to numBytes from the spans, in order, to outData, and returns the number of bytes
+	// copied. Faults while reading the spans are thrown as runtime exceptions.
+	WAVM_API Uptr gatherFromMemorySpans(const MemorySpan<U8>* spans,
+										Uptr numSpans,
+										U8* outData,
+										Uptr numBytes);
+
+	// Copies up to numBytes from data to the spans, in order, and returns the number of bytes
+	// copied. Faults while writing the spans are thrown as runtime exceptions.
+	WAVM_API Uptr scatterToMemorySpans(const MemorySpan<U8>* spans,
+									   Uptr numSpans,
+									   const U8* data,
+									   Uptr numBytes);
+
 	//
 	// Globals
 	//
@@ -436,6 +860,8 @@ namespace WAVM { namespace Runtime {
 	// If true is returned, the load succeeded, and outModule contains the loaded module.
 	// If false is returned, the load failed. If outError != nullptr, *outError will contain the
 	// error that caused the load to fail.
+	// If the global object cache has recorded that the module passed validation with the same
+	// feature spec, its code is decoded without validating it again.
 	WAVM_API bool loadBinaryModule(const U8* wasmBytes,
 								   Uptr numWASMBytes,
 								   ModuleRef& outModule,
@@ -447,7 +873,13 @@ namespace WAVM { namespace Runtime {
 	WAVM_API ModuleRef loadPrecompiledModule(const IR::Module& irModule,
 											 const std::vector<U8>& objectCode);
 
-	// Accesses the IR for a compiled module.
+	// Loads a previously compiled module like above, but takes ownership of the IR module and
+	// object code instead of copying them.
+	WAVM_API ModuleRef loadPrecompiledModule(IR::Module&& irModule, std::vector<U8>&& objectCode);
+
+	// Accesses the IR for a compiled module. If setGlobalReleaseFunctionBodies was enabled when
+	// the module was created, the code and branch tables of its function definitions are empty
+	// once the module has been compiled.
 	WAVM_API const IR::Module& getModuleIR(ModuleConstRefParam module);
 
 	// Extracts the compiled object code for a module. This may be used as an input to
@@ -472,6 +904,9 @@ namespace WAVM { namespace Runtime {
 	WAVM_API Function* getStartFunction(const Instance* instance);
 
 	// Gets the default table/memory for a Instance.
+	// The compiled code may assume that the elements of a table the module doesn't export are
+	// only changed by the module's own code, so writing to such a table through this pointer
+	// won't necessarily change the function called by call_indirect.
 	WAVM_API Memory* getDefaultMemory(const Instance* instance);
 	WAVM_API Table* getDefaultTable(const Instance* instance);
 
@@ -503,15 +938,221 @@ namespace WAVM { namespace Runtime {
 	// IR::Module::exports array.
 	WAVM_API const std::vector<Object*>& getInstanceExports(const Instance* instance);
 
+	// If the instance tiers up its hot functions (see setGlobalCompileOptions), waits until the
+	// functions that reached LLVMJIT::CompileOptions::tierUpCallThreshold calls before this was
+	// called have been compiled with the optimized tier, and their calls are forwarded to the
+	// optimized code.
+	WAVM_API void waitForInstanceTierUp(const Instance* instance);
+
+	// A handle to one of a module's exports, resolved once from the module by getModuleExportIndex
+	// or getTypedModuleExportIndex, that gets the object exported by any instance of the module
+	// without looking it up by name or checking its type. index is the export's index in
+	// IR::Module::exports, or UINTPTR_MAX if the export wasn't found.
+	template<typename ObjectType> struct ExportIndex
+	{
+		Uptr index = UINTPTR_MAX;
+
+		bool isValid() const { return index != UINTPTR_MAX; }
+	};
+
+	// Resolves a module's export by name.
+	WAVM_API ExportIndex<Object> getModuleExportIndex(ModuleConstRefParam module,
+													  const std::string& name);
+
+	// Resolves a module's export by name and type. The type is checked against the type that the
+	// module declares for the export, which the objects exported by all its instances match. If the
+	// module exports an object with the given name, but the type doesn't match, returns an invalid
+	// ExportIndex.
+	WAVM_API ExportIndex<Object> getTypedModuleExportIndex(ModuleConstRefParam module,
+														   const std::string& name,
+														   const IR::ExternType& type);
+	WAVM_API ExportIndex<Function> getTypedModuleExportIndex(ModuleConstRefParam module,
+															 const std::string& name,
+															 const IR::FunctionType& type);
+	WAVM_API ExportIndex<Table> getTypedModuleExportIndex(ModuleConstRefParam module,
+														  const std::string& name,
+														  const IR::TableType& type);
+	WAVM_API ExportIndex<Memory> getTypedModuleExportIndex(ModuleConstRefParam module,
+														   const std::string& name,
+														   const IR::MemoryType& type);
+	WAVM_API ExportIndex<Global> getTypedModuleExportIndex(ModuleConstRefParam module,
+														   const std::string& name,
+														   const IR::GlobalType& type);
+	WAVM_API ExportIndex<ExceptionType> getTypedModuleExportIndex(ModuleConstRefParam module,
+																  const std::string& name,
+																  const IR::ExceptionType& type);
+
+	// Gets the object exported by an instance for an ExportIndex that was resolved from the
+	// instance's module. Returns nullptr if the ExportIndex isn't valid.
+	WAVM_API Object* getInstanceExport(const Instance* instance, ExportIndex<Object> exportIndex);
+	WAVM_API Function* getInstanceExport(const Instance* instance,
+										 ExportIndex<Function> exportIndex);
+	WAVM_API Table* getInstanceExport(const Instance* instance, ExportIndex<Table> exportIndex);
+	WAVM_API Memory* getInstanceExport(const Instance* instance, ExportIndex<Memory> exportIndex);
+	WAVM_API Global* getInstanceExport(const Instance* instance, ExportIndex<Global> exportIndex);
+	WAVM_API ExceptionType* getInstanceExport(const Instance* instance,
+											  ExportIndex<ExceptionType> exportIndex);
+
+	// Creates a module that is equivalent to the given instance's module, but starts in the
+	// instance's current state: its memories, tables, and the values of its mutable globals in the
+	// given context are captured in the new module's definitions and active segments, and it has
+	// no start function. This allows running a module's start function and initialization code
+	// once, and instantiating the snapshot instead of repeating them. Fails if the instance
+	// imports memories, tables, or mutable globals, or references objects other than its own
+	// functions from its tables or globals.
+	WAVM_API bool snapshotInstance(const Instance* instance,
+								   const Context* context,
+								   const IR::Module& irModule,
+								   IR::Module& outIRModule);
+
+	// Captures the current state of an instance, so resetInstance can restore it: the contents
+	// and sizes of its memories and tables, which of its passive segments have been dropped, and
+	// the values of its mutable globals in the given context. Calling this after the instance's
+	// start function allows reusing the instance for many requests, instead of instantiating the
+	// module for each of them. Memories are mapped copy-on-write to a snapshot of their pages
+	// where the platform supports it, so resetting them only restores the pages that were
+	// written since. Imported memories, tables, and globals are captured and reset too, so they
+	// shouldn't be shared with instances that aren't reset with this one. Fails if a memory has
+	// pages that were unmapped or mapped to files, in which case the instance can't be reset
+	// until a later call succeeds. The captured state isn't cloned with the compartment.
+	WAVM_API bool captureInstanceResetState(Instance* instance, const Context* context);
+
+	// Restores an instance to the state captured by captureInstanceResetState, writing the values
+	// of its mutable globals to the given context. Memories and tables that grew since are shrunk
+	// back to their captured sizes. No code may be running in the instance's compartment.
+	WAVM_API void resetInstance(Instance* instance, Context* context);
+
+	// Gets the execution counts of an instance's function definitions. The counts are only
+	// non-empty if the instance's module was compiled with CompileOptions::instrumentProfile.
+	WAVM_API void getInstanceProfile(const Instance* instance, LLVMJIT::ModuleProfile& outProfile);
+
+	struct FunctionStats
+	{
+		Function* function;
+		U64 numCalls;
+		U64 numCycles;
+	};
+
+	// Gets the call counts of an instance's function definitions. The counts are only non-empty if
+	// the instance's module was compiled with CompileOptions::countFunctionCalls, and the cycle
+	// counts are only non-zero if it was also compiled with CompileOptions::measureFunctionCycles.
+	WAVM_API void getFunctionStats(const Instance* instance, std::vector<FunctionStats>& outStats);
+
+	//
+	// Sampling profiler
+	//
+
+	// Samples the instructions that the process's threads are executing at a fixed frequency, and
+	// attributes the samples to WebAssembly functions and operators. Unlike the instrumented
+	// profile, it doesn't need the module to be compiled differently.
+	struct Profiler;
+
+	// Starts sampling about samplesPerSecond times per second of CPU time. Samples beyond
+	// maxSamples are dropped. Returns null if the host doesn't support sampling, or another
+	// profiler is running.
+	WAVM_API Profiler* startProfiler(U32 samplesPerSecond, Uptr maxSamples = Uptr(1) << 20);
+
+	// Stops the profiler, deletes it, and returns its samples in the folded stack format used by
+	// flame graph tools: a line for each sampled operator of the form "<function>;<op> <count>".
+	// Samples are attributed when the profiler is stopped, so it must be stopped before the
+	// modules that might have been sampled are freed.
+	WAVM_API std::string stopProfiler(Profiler* profiler);
+
 	//
 	// Compartments
 	//
 
-	WAVM_API Compartment* createCompartment(std::string&& debugName = "");
+	// Limits on the number of tables and contexts in a compartment, which determine how much
+	// address space the compartment reserves for its runtime data. 0 means the default limit, and
+	// the default limits reserve 2GB. Limits above the defaults are reduced to the defaults.
+	// A compartment with lower limits is compact: it reserves and commits only the address space
+	// it needs for its runtime data up front, which uses a single mapping and makes creating
+	// contexts cheaper. Its runtime data is still aligned to 2GB, so the compiled code can find it
+	// from a context by masking the context's address.
+	//
+	// maxMutableGlobals limits the number of mutable globals in the compartment, which determines
+	// the size of each context's runtime data: the default limit uses 16KB per context, while a
+	// compartment with a few mutable globals needs only a few hundred bytes per context, so many
+	// contexts share each page. The default limit on contexts is as many as fit in 2GB, so a lower
+	// maxMutableGlobals doesn't make the compartment compact.
+	struct CompartmentLayout
+	{
+		Uptr maxTables = 0;
+		Uptr maxContexts = 0;
+		Uptr maxMutableGlobals = 0;
+
+		// If not UINTPTR_MAX, the NUMA node that the compartment's runtime data and memories
+		// prefer to be backed by, and that the guest threads that Emscripten and ThreadTest create
+		// for it are bound to. See Platform::setVirtualPagesNUMANode.
+		Uptr numaNode = UINTPTR_MAX;
+	};
 
+	WAVM_API Compartment* createCompartment(std::string&& debugName = "",
+											const CompartmentLayout& layout = CompartmentLayout());
+	WAVM_API CompartmentLayout getCompartmentLayout(const Compartment* compartment);
+
+	// Clones a compartment and all the objects in it. Where the platform supports it, the pages of
+	// unshared memories are shared copy-on-write between the original and the clone instead of
+	// being copied, so unshared memories must not be written by other threads during the clone.
 	WAVM_API Compartment* cloneCompartment(const Compartment* compartment,
 										   std::string&& debugName = "");
 
+	// Sets the memory pool that 32-bit memories created in the compartment are allocated from.
+	// If the pool is null or has no free slots, memories reserve their own address space. Clones
+	// of the compartment use the same pool.
+	WAVM_API void setCompartmentMemoryPool(Compartment* compartment, MemoryPoolRefParam memoryPool);
+
+	// Sets whether clones of the compartment copy each page of an unshared memory when the clone
+	// first accesses it, instead of sharing the pages copy-on-write. This makes cloning a large
+	// memory cheaper, and pages that the clone never accesses use no memory, but the first access
+	// to each page blocks while it's copied. Falls back to copy-on-write if the platform doesn't
+	// support it: on Linux, it requires permission to handle kernel faults with userfaultfd. Clones
+	// of the compartment use the same setting.
+	WAVM_API void setCompartmentLazyMemoryClones(Compartment* compartment, bool lazyMemoryClones);
+
+	// Sets the pages that lazy clones of a memory copy while cloning it, in units of
+	// Platform::getBytesPerPage(). The clones of the memory inherit its prefetched pages.
+	WAVM_API void setMemoryClonePrefetchPages(Memory* memory, std::vector<Uptr>&& pageIndices);
+
+	// If the memory is a lazy clone, returns the pages that have been copied to it, in units of
+	// Platform::getBytesPerPage(): the prefetched pages, then the other pages in the order they
+	// were first accessed. This is a working set to pass to setMemoryClonePrefetchPages.
+	WAVM_API std::vector<Uptr> getMemoryCopiedClonePages(const Memory* memory);
+
+	// Sets how long a memory.atomic.wait on one of the compartment's memories spins checking
+	// whether the value changed before blocking the thread. 0 disables spinning. A wait never
+	// spins longer than its timeout. Clones of the compartment use the same spin duration.
+	static constexpr U64 defaultAtomicWaitSpinNanoseconds = 4000;
+	WAVM_API void setCompartmentAtomicWaitSpinDuration(Compartment* compartment, U64 nanoseconds);
+
+	struct AtomicWaitStats
+	{
+		// The number of memory.atomic.wait operations that found the expected value.
+		U64 numWaits;
+
+		// The number of those waits that spun before blocking.
+		U64 numSpinningWaits;
+
+		// The number of spinning waits that saw the value change while spinning, and so didn't
+		// need to block the thread.
+		U64 numWaitsEndedBySpinning;
+	};
+	WAVM_API AtomicWaitStats getCompartmentAtomicWaitStats(const Compartment* compartment);
+
+	// Waits on a 32-bit value in a memory like memory.atomic.wait32, for intrinsics that block
+	// threads. Unlike memory.atomic.wait32, the memory doesn't need to be shared. If the value at
+	// address equals expectedValue, blocks the thread until atomicNotify wakes it or the timeout
+	// elapses. A negative timeout waits forever. Returns 0 if the thread was woken, 1 if the value
+	// didn't equal expectedValue, and 2 if the wait timed out.
+	WAVM_API U32 atomicWait32(Memory* memory,
+							  Uptr address,
+							  U32 expectedValue,
+							  I64 timeoutNanoseconds);
+
+	// Wakes up to numToWake threads waiting on an address in a memory, like memory.atomic.notify.
+	// UINT32_MAX wakes all waiting threads. Returns the number of threads woken.
+	WAVM_API U32 atomicNotify(Memory* memory, Uptr address, U32 numToWake);
+
 	WAVM_API Object* remapToClonedCompartment(const Object* object,
 											  const Compartment* newCompartment);
 	WAVM_API Function* remapToClonedCompartment(const Function* function,
@@ -530,6 +1171,22 @@ namespace WAVM { namespace Runtime {
 
 	WAVM_API bool isInCompartment(const Object* object, const Compartment* compartment);
 
+	// The virtual memory used by an object. Committed bytes are counted as pages are committed
+	// and decommitted, so reading them is cheap, and the wavm_committed_bytes gauge sums them for
+	// all objects by kind. Resident bytes are only counted if residency is sampled, which inspects
+	// each of the object's pages (with mincore on POSIX), so it is much slower.
+	struct MemoryUsage
+	{
+		Uptr numCommittedBytes = 0;
+		Uptr numResidentBytes = 0;
+	};
+
+	// Returns the virtual memory used by a memory, table, instance, or compartment. An instance
+	// uses the pages its code and data were loaded into, which it shares with its clones. A
+	// compartment uses its runtime data, and the virtual memory used by its memories, tables, and
+	// instances. Other kinds of objects don't use virtual memory of their own.
+	WAVM_API MemoryUsage getObjectMemoryUsage(const Object* object, bool sampleResidency = false);
+
 	//
 	// Contexts
 	//
@@ -546,6 +1203,97 @@ namespace WAVM { namespace Runtime {
 	// Creates a new context, initializing its mutable global state from the given context.
 	WAVM_API Context* cloneContext(const Context* context, Compartment* newCompartment);
 
+	// Reinitializes the context's mutable global state from the compartment's initial values, so
+	// the context can be reused as if it had just been created.
+	WAVM_API void resetContext(Context* context);
+
+	// Resets a batch of contexts from the same compartment like resetContext, locking the
+	// compartment once.
+	WAVM_API void resetContexts(Context* const* contexts, Uptr numContexts);
+
+	// Code compiled with LLVMJIT::CompileOptions::checkEpochDeadline checks whether the
+	// compartment's epoch has reached the running context's epoch deadline when it enters a
+	// function or loop. If it has, the context's epoch deadline callback is called. If there is no
+	// callback, or it returns false, an interrupted exception is thrown. Otherwise, the code keeps
+	// running: the callback may yield by calling suspendFiber, and should move the deadline past
+	// the compartment's epoch to avoid being called again at the next check.
+	// A new context's deadline is UINT64_MAX, so it is never reached.
+	typedef bool (*EpochDeadlineCallback)(Context* context, void* userData);
+
+	// Advances the compartment's epoch by one, and returns the new epoch. May be called from any
+	// thread, e.g. by a timer or watchdog.
+	WAVM_API U64 incrementEpoch(Compartment* compartment);
+	WAVM_API U64 getEpoch(const Compartment* compartment);
+
+	// Sets the epoch at which code running in the context calls its epoch deadline callback. May
+	// be called from any thread.
+	WAVM_API void setEpochDeadline(Context* context, U64 deadline);
+	WAVM_API U64 getEpochDeadline(const Context* context);
+
+	// Makes code running in the context call its epoch deadline callback at the next check, by
+	// setting its epoch deadline to zero. May be called from any thread.
+	WAVM_API void interruptContext(Context* context);
+
+	// Sets the context's epoch deadline callback. Must not be called while the context is running
+	// code.
+	WAVM_API void setEpochDeadlineCallback(Context* context,
+										   EpochDeadlineCallback callback,
+										   void* userData = nullptr);
+
+	// Code compiled with LLVMJIT::CompileOptions::meterFuel consumes the running context's fuel.
+	// When the fuel goes negative, the context takes more from its resource quota, if it has one.
+	// If the quota is exhausted, or the context doesn't have one, the context's fuel exhausted
+	// callback is called. If there is no callback, or it returns false, the context's fuel is set
+	// to zero, and an outOfFuel exception is thrown. Otherwise, the code keeps running: the
+	// callback may yield by calling suspendFiber, and should give the context more fuel.
+	// A new context has INT64_MAX fuel and no resource quota.
+	typedef bool (*FuelExhaustedCallback)(Context* context, void* userData);
+
+	// Gets or sets the context's fuel. Must not be called while the context is running code,
+	// other than by its fuel exhausted callback.
+	WAVM_API I64 getContextFuel(const Context* context);
+	WAVM_API void setContextFuel(Context* context, I64 fuel);
+
+	// Sets the resource quota that the context takes fuel from. The context's unconsumed fuel is
+	// returned to its old quota, and it starts with no fuel if the new quota is non-null, or
+	// INT64_MAX fuel if it is null. Must not be called while the context is running code.
+	WAVM_API void setContextResourceQuota(Context* context, ResourceQuotaRefParam resourceQuota);
+
+	// Sets the context's fuel exhausted callback. Must not be called while the context is running
+	// code.
+	WAVM_API void setFuelExhaustedCallback(Context* context,
+										   FuelExhaustedCallback callback,
+										   void* userData = nullptr);
+
+	// The times that a context's invokes have accounted since setContextTimeAccounting enabled
+	// it, e.g. for a scheduler to find the contexts that use the most CPU time. An invoke is a
+	// call of invokeFunction, invokeFunctionWithThunk, or invokeFunctionBatch, or a resumeFiber of
+	// a fiber created for the context. The wall time and the invoking thread's CPU time are
+	// accounted from when the invoke starts to when it returns, including the time spent in
+	// intrinsics and host functions the code calls, such as WASI syscalls. The time spent in a
+	// nested invoke of another context is accounted to that context instead, and a nested invoke
+	// of the same context on the same thread isn't accounted again. A fiber's time is accounted
+	// for each resumeFiber, so it doesn't matter which thread resumes it.
+	struct ContextTimes
+	{
+		// The number of invokes that were accounted.
+		U64 numInvokes;
+
+		U64 wallNanoseconds;
+		U64 cpuNanoseconds;
+
+		// The part of the wall time that the context's threads were blocked in
+		// memory.atomic.wait.
+		U64 atomicWaitNanoseconds;
+	};
+	WAVM_API ContextTimes getContextTimes(const Context* context);
+
+	// Enables or disables accounting a context's times. A new context doesn't account them, since
+	// reading the thread's CPU time makes each invoke slower. Enabling accounting for a context
+	// that doesn't account its times resets them to zero. May be called from any thread, and
+	// takes effect for the invokes that start after it returns.
+	WAVM_API void setContextTimeAccounting(Context* context, bool accountTimes);
+
 	//
 	// Foreign objects
 	//
@@ -559,15 +1307,171 @@ namespace WAVM { namespace Runtime {
 	// Object caching
 	//
 
+	struct ObjectCacheStats
+	{
+		U64 numMemoryHits = 0;
+		U64 numDatabaseHits = 0;
+		U64 numRemoteHits = 0;
+		U64 numMisses = 0;
+		U64 numEvictions = 0;
+
+		// The time spent in getCachedObject. The time for misses includes compiling the module.
+		U64 totalHitNanoseconds = 0;
+		U64 maxHitNanoseconds = 0;
+		U64 totalMissNanoseconds = 0;
+		U64 maxMissNanoseconds = 0;
+	};
+
+	// A hash of the bytes that identify a module in an object cache. The cache computes it the
+	// first time it is passed to one of the cache's methods, so a caller that looks up the same
+	// bytes more than once, such as to check whether a module was validated and then to get its
+	// object code, can pass the same hash to each call and only hash the bytes once.
+	struct ObjectCacheKeyHash
+	{
+		bool isComputed = false;
+		U8 bytes[16];
+	};
+
 	struct ObjectCacheInterface
 	{
 		virtual ~ObjectCacheInterface() {}
 
-		virtual std::vector<U8> getCachedObject(const U8* wasmBytes,
-												Uptr numWASMBytes,
-												std::function<std::vector<U8>()>&& compileThunk)
+		virtual ObjectCacheStats getStats() { return ObjectCacheStats(); }
+
+		// Returns the object code for a module, calling compileThunk to compile it if it isn't
+		// cached. The returned buffer may be shared with other callers, so it must not be modified.
+		virtual std::shared_ptr<const std::vector<U8>> getCachedObject(
+			const U8* wasmBytes,
+			Uptr numWASMBytes,
+			ObjectCacheKeyHash& keyHash,
+			std::function<std::vector<U8>()>&& compileThunk)
 			= 0;
+		std::shared_ptr<const std::vector<U8>> getCachedObject(
+			const U8* wasmBytes,
+			Uptr numWASMBytes,
+			std::function<std::vector<U8>()>&& compileThunk)
+		{
+			ObjectCacheKeyHash keyHash;
+			return getCachedObject(wasmBytes, numWASMBytes, keyHash, std::move(compileThunk));
+		}
+
+		// Returns whether the cache has recorded that a module passed validation with a feature
+		// spec, in which case loadBinaryModule doesn't validate its code again. A cache that
+		// records this must be trusted as much as the object code it returns.
+		virtual bool isValidatedModule(const U8* wasmBytes,
+									   Uptr numWASMBytes,
+									   ObjectCacheKeyHash& keyHash,
+									   const IR::FeatureSpec& featureSpec)
+		{
+			return false;
+		}
+
+		// Records that a module passed validation with a feature spec.
+		virtual void addValidatedModule(const U8* wasmBytes,
+										Uptr numWASMBytes,
+										ObjectCacheKeyHash& keyHash,
+										const IR::FeatureSpec& featureSpec)
+		{
+		}
 	};
 
 	WAVM_API void setGlobalObjectCache(std::shared_ptr<ObjectCacheInterface>&& objectCache);
+
+	//
+	// Compile options
+	//
+
+	// Sets the options that compileModule and loadBinaryModule use to compile modules.
+	// If the options select the baseline tier and a non-zero tierUpCallThreshold, or the module is
+	// interpreted (see setGlobalInterpretModules), each instance of a module counts the calls to
+	// its function definitions, and recompiles a function with the optimized tier on a background
+	// thread once it has been called that many times. The
+	// function's calls are then forwarded to the optimized code, including calls through tables
+	// and references created before it was tiered up. A call that is running when its function is
+	// tiered up finishes in the baseline code. Destroying the instance cancels its compile.
+	WAVM_API void setGlobalCompileOptions(const LLVMJIT::CompileOptions& compileOptions);
+
+	// Starts numProcesses helper processes, forked from the calling process, that modules are
+	// compiled in instead of the calling process. LLVM's allocations while compiling a module then
+	// don't grow or fragment the calling process's heap, and at most numProcesses modules are
+	// compiled at once. Modules compiled with a specialization or a partition object cache, or that
+	// a helper process fails to compile, are compiled in the calling process. Only the calling
+	// thread is copied to the helper processes, so this should be called before the process
+	// creates any other threads. Returns false if no processes could be started, which is always
+	// the case on Windows.
+	WAVM_API bool startCompileProcesses(Uptr numProcesses);
+
+	// Sets whether compileModule and loadBinaryModule defer compiling a module until it is first
+	// instantiated, or its object code is requested with getObjectCode.
+	WAVM_API void setGlobalLazyCompilation(bool lazyCompilation);
+
+	// Sets whether modules created by compileModule, loadBinaryModule, and loadPrecompiledModule
+	// release the code of their function definitions once their final object code is compiled or
+	// loaded. The IR returned by getModuleIR can't be disassembled or compiled again when this is
+	// enabled, but it still describes the module's types, imports, exports, and segments.
+	WAVM_API void setGlobalReleaseFunctionBodies(bool releaseFunctionBodies);
+
+	// Sets whether modules created by compileModule and loadBinaryModule are recompiled for each
+	// instance's imports: the values of immutable number and vector global imports are compiled
+	// in as constants, and the code assumes the size limits of the imported memories instead of
+	// the module's import types, so a fixed-size memory has a constant size. Calls to imported
+	// intrinsics that have inline bodies are inlined. Instances with the same import values share
+	// their object code, which is also stored in the global object cache. Such modules keep their
+	// function bodies, regardless of setGlobalReleaseFunctionBodies.
+	WAVM_API void setGlobalSpecializeInstances(bool specializeInstances);
+
+	// Sets whether modules created by compileModule and loadBinaryModule are executed by an
+	// interpreter instead of compiled code, so they can be instantiated without waiting for them
+	// to be compiled. Modules that use a feature the interpreter doesn't support, such as SIMD,
+	// atomics, or exception handling, are still compiled. Interpreted and compiled functions may
+	// call each other, directly or through tables. If the compile options set by
+	// setGlobalCompileOptions have a non-zero tierUpCallThreshold, each interpreted instance
+	// counts the calls to its function definitions, and recompiles its hot functions with the
+	// optimized tier like an instance compiled with the baseline tier does.
+	WAVM_API void setGlobalInterpretModules(bool interpretModules);
+
+	//
+	// Asynchronous compiles
+	//
+
+	// Modules may be compiled asynchronously on a pool of compile threads that WAVM manages. Queued
+	// compiles are started in order of their priority, and then in the order they were queued.
+	enum class CompilePriority : U8
+	{
+		background,
+		normal,
+		interactive,
+	};
+
+	struct CompileJob;
+	typedef std::shared_ptr<CompileJob> CompileHandle;
+
+	// Queues a compile of a copy of irModule with the given options, and returns a handle to it.
+	// The object code is looked up in the global object cache like compileModule does; modules
+	// compiled with options that differ from the global compile options are cached separately from
+	// those compiled with the global options. The module is compiled even if lazy compilation is
+	// enabled, unless it is interpreted. If onComplete is non-null, it is called once the compile
+	// finishes with the module, or with null if the compile was cancelled or threw an exception.
+	// It is called on a compile thread, or on the thread that cancels a compile that hadn't
+	// started yet, and must not throw.
+	WAVM_API CompileHandle compileModuleAsync(const IR::Module& irModule,
+											  const LLVMJIT::CompileOptions& compileOptions,
+											  CompilePriority priority = CompilePriority::normal,
+											  std::function<void(ModuleRef)>&& onComplete
+											  = nullptr);
+
+	// Cancels a compile. A compile that hasn't started yet is removed from the queue, and a running
+	// compile stops before it emits the next function definition or starts the next phase of
+	// compiling a partition. Does nothing if the compile already finished.
+	WAVM_API void cancelCompile(const CompileHandle& compile);
+
+	// Waits for a compile to finish, and returns the module, or null if the compile was cancelled.
+	// If the compile threw an exception, such as an IR::ValidationException for a module compiled
+	// with LLVMJIT::CompileOptions::validateFunctionBodies, it is rethrown.
+	WAVM_API ModuleRef waitForCompile(const CompileHandle& compile);
+
+	// Sets the maximum number of compile threads. If 0, which is the default, there may be a
+	// compile thread for each hardware thread. The threads are started as compiles are queued, and
+	// threads that were already started keep running if the maximum is reduced.
+	WAVM_API void setNumCompileThreads(Uptr numThreads);
 }}
@@ -5,7 +5,7 @@
 //
 
 #include <atomic>
-#include <map>
+#include <string>
 #include "WAVM/IR/Types.h"
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/BasicTypes.h"
@@ -20,6 +20,8 @@ namespace WAVM { namespace Runtime {
 	struct Compartment;
 	struct Context;
 	struct ExceptionType;
+	struct InstanceTierUp;
+	struct InterpretedModule;
 	struct Object;
 	struct Table;
 	struct Memory;
@@ -57,7 +59,8 @@ namespace WAVM { namespace Runtime {
 	static constexpr Uptr contextNumBytes = 16384;
 	static constexpr Uptr maxThunkArgAndReturnBytes = 256;
 	static constexpr Uptr maxMutableGlobals
-		= (contextNumBytes - maxThunkArgAndReturnBytes - sizeof(Context*))
+		= (contextNumBytes - maxThunkArgAndReturnBytes - sizeof(Context*) - sizeof(U64)
+		   - sizeof(I64) - sizeof(Uptr))
 		  / sizeof(IR::UntaggedValue);
 	static constexpr Uptr contextRuntimeDataAlignment = 16384;
 
@@ -65,10 +68,28 @@ namespace WAVM { namespace Runtime {
 				  "maxThunkArgAndReturnBytes must be large enough to hold IR::maxReturnValues * "
 				  "sizeof(UntaggedValue)");
 
+	// A compartment's contexts' runtime data are only as large as its CompartmentLayout's limit on
+	// mutable globals requires: mutableGlobals is truncated to that many elements, and consecutive
+	// contexts are that many bytes apart.
 	struct ContextRuntimeData
 	{
 		U8 thunkArgAndReturnData[maxThunkArgAndReturnBytes];
 		Context* context;
+
+		// Code compiled with LLVMJIT::CompileOptions::checkEpochDeadline calls the
+		// epochDeadlineReached intrinsic when the compartment's epoch reaches this value.
+		std::atomic<U64> epochDeadline;
+
+		// The context's remaining fuel. Code compiled with LLVMJIT::CompileOptions::meterFuel
+		// caches it in a register while it runs, and writes it back before calls and returns.
+		I64 fuel;
+
+		// Code compiled with LLVMJIT::CompileOptions::checkStackLimit traps with a stack overflow
+		// if the stack pointer is below this address at function entry. The invoke functions set
+		// it to near the bottom of the stack they're called on, and it is 0 while the context
+		// isn't running.
+		Uptr stackLimit;
+
 		IR::UntaggedValue mutableGlobals[maxMutableGlobals];
 	};
 
@@ -84,6 +105,24 @@ namespace WAVM { namespace Runtime {
 
 	constexpr Uptr memoryNumGuardBytes = 65536;
 
+	// 64-bit memories with a maximum size of at most this many bytes are reserved as much address
+	// space as 32-bit memories, so the generated code can clamp their addresses to this constant
+	// instead of loading the memory's end address.
+	constexpr U64 memory64NumClampedBytes = U64(4) * 1024 * 1024 * 1024;
+
+	// Unshared 64-bit memories that may grow past this many bytes initially reserve only this much
+	// address space, or enough for their initial size, instead of their maximum size. Growing one
+	// past its reserved address space moves it to a larger reservation, so the generated code
+	// reloads the memory's base address and end address after growing it.
+	constexpr U64 memory64NumInitialReservedBytes = U64(8) * 1024 * 1024 * 1024;
+
+	inline bool isMovableMemoryType(const IR::MemoryType& type)
+	{
+		return type.indexType == IR::IndexType::i64 && !type.isShared
+			   && type.size.min != type.size.max
+			   && type.size.max > memory64NumInitialReservedBytes / IR::numBytesPerPage;
+	}
+
 	static_assert(sizeof(MemoryRuntimeData) == sizeof(Uptr) * 3,
 				  "MemoryRuntimeData isn't the expected size");
 
@@ -96,23 +135,47 @@ namespace WAVM { namespace Runtime {
 	static_assert(sizeof(TableRuntimeData) == sizeof(Uptr) * 2,
 				  "TableRuntimeData isn't the expected size");
 
+	// On 64-bit hosts, the high bits of each table element hold a tag derived from the type of the
+	// function it references, so call_indirect can check the type without loading it from the
+	// Function. The low bits hold the element's biased address, sign extended from the tag shift.
+	// Tags are only assigned to the first (tableElementMaxTypeTag - 1) function types; elements
+	// that reference other types or non-function objects have tag 0, and call_indirect falls back
+	// to comparing the Function's encodedType for them.
+	static constexpr Uptr tableElementTypeTagShift = 48;
+	static constexpr Uptr tableElementMaxTypeTag = 0xffff;
+	static constexpr bool tableElementsHaveTypeTags = sizeof(Uptr) == sizeof(U64);
+
+	// Returns the tag that call_indirect compares table elements against for a callee type. Types
+	// without a tag map to tableElementMaxTypeTag, which no table element has.
+	inline Uptr getCalleeTableElementTypeTag(IR::FunctionType type)
+	{
+		const Uptr typeId = type.getId();
+		return typeId < tableElementMaxTypeTag - 1 ? typeId + 1 : tableElementMaxTypeTag;
+	}
+
 	static constexpr Uptr maxMemories = 255;
 	static constexpr Uptr compartmentReservedBytes = Uptr(2) * 1024 * 1024 * 1024;
 	static constexpr Uptr compartmentNonContextBytes = Uptr(2) * 1024 * 1024;
 	static constexpr Uptr maxTables = (compartmentNonContextBytes - sizeof(Compartment*)
-									   - maxMemories * sizeof(MemoryRuntimeData))
+									   - sizeof(U64) - maxMemories * sizeof(MemoryRuntimeData))
 									  / sizeof(TableRuntimeData);
 	static constexpr Uptr compartmentRuntimeDataAlignmentLog2 = 31;
 
 	struct CompartmentRuntimeData
 	{
 		Compartment* compartment;
+
+		// The compartment's epoch, which is advanced by Runtime::incrementEpoch.
+		std::atomic<U64> epoch;
+
 		MemoryRuntimeData memories[maxMemories];
 		TableRuntimeData tables[maxTables];
 		ContextRuntimeData contexts[1]; // Actually [maxContexts], but at least MSVC doesn't allow
 										// declaring arrays that large.
 	};
 
+	// The maximum number of contexts with the default limit on mutable globals. Compartments with
+	// a lower limit on mutable globals fit more contexts in the same address space.
 	static constexpr Uptr maxContexts
 		= (compartmentReservedBytes - offsetof(CompartmentRuntimeData, contexts))
 		  / sizeof(ContextRuntimeData);
@@ -129,6 +192,7 @@ namespace WAVM { namespace Runtime {
 		Uptr typeId;
 		ExceptionType* type;
 		U8 isUserException;
+		U8 isPooled;
 		Platform::CallStack callStack;
 		void* userData;
 		void (*finalizeUserData)(void*);
@@ -141,6 +205,7 @@ namespace WAVM { namespace Runtime {
 		: typeId(inTypeId)
 		, type(inType)
 		, isUserException(inIsUserException ? 1 : 0)
+		, isPooled(0)
 		, callStack(std::move(inCallStack))
 		, userData(nullptr)
 		, finalizeUserData(nullptr)
@@ -166,6 +231,18 @@ namespace WAVM { namespace Runtime {
 															   const IR::UntaggedValue* arguments,
 															   IR::UntaggedValue* results);
 
+	// The state of a function definition whose instance tiers up its hot functions. If the
+	// function is compiled with LLVMJIT::CompileOptions::tierUpCallThreshold, it is defined by the
+	// function's object code, which counts the function's calls in it, and forwards them to the
+	// tiered-up code once it is set. If the function is interpreted, the interpreter does the same.
+	struct FunctionTierUpState
+	{
+		std::atomic<Uptr> numCalls{0};
+		std::atomic<const void*> tieredUpCode{nullptr};
+	};
+	static_assert(sizeof(FunctionTierUpState) == sizeof(Uptr) * 2,
+				  "FunctionTierUpState must match the layout of the object code's [2 x iptr]");
+
 	// Metadata about a function, used to hold data that can't be emitted directly in an object
 	// file, or must be mutable.
 	struct FunctionMutableData
@@ -174,12 +251,45 @@ namespace WAVM { namespace Runtime {
 		Runtime::Function* function = nullptr;
 		Uptr numCodeBytes = 0;
 		std::atomic<Uptr> numRootReferences{0};
-		std::map<U32, U32> offsetToOpIndexMap;
+
+		// The range of the JIT module's offset to op index table that maps machine code offsets
+		// in this function to the indices of the WebAssembly operators they were generated from.
+		Uptr offsetToOpIndexTableOffset = 0;
+		Uptr numOffsetToOpIndexTableBytes = 0;
+
 		std::string debugName;
 		std::atomic<InvokeThunkPointer> invokeThunk{nullptr};
 		void* userData{nullptr};
 		void (*finalizeUserData)(void*);
 
+		// If the function was compiled with CompileOptions::instrumentProfile, points to its
+		// execution counts in the layout described by LLVMJIT::ModuleProfile.
+		U64* profileCounters{nullptr};
+		Uptr numProfileCounters{0};
+
+		// If the function is the thunk of an intrinsic with an inline body, the body's LLVM IR.
+		const char* inlineLLVMIR{nullptr};
+
+		// If the function is the thunk of a pure intrinsic, the intrinsic's native function.
+		void* pureNativeFunction{nullptr};
+
+		// If the function was compiled with CompileOptions::countFunctionCalls, points to the
+		// number of calls to the function, followed by the number of cycles spent in them.
+		U64* functionStats{nullptr};
+
+		// If the function is executed by the interpreter instead of compiled code, the
+		// interpreter's state for its instance, and the index of its definition in the module.
+		InterpretedModule* interpretedModule{nullptr};
+		Uptr interpretedFunctionDefIndex{0};
+
+		// If the function is interpreted, the compiled trampoline that its code jumps to.
+		std::atomic<const void*> interpreterTrampoline{nullptr};
+
+		// If the function's instance tiers up its hot functions, the function's tier-up state,
+		// and the instance's state that compiles the hot functions.
+		FunctionTierUpState* tierUpState{nullptr};
+		InstanceTierUp* instanceTierUp{nullptr};
+
 		FunctionMutableData(std::string&& inDebugName)
 		: debugName(inDebugName), userData(nullptr), finalizeUserData(nullptr)
 		{
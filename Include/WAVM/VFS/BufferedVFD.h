@@ -0,0 +1,32 @@
+#pragma once
+
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+
+namespace WAVM { namespace VFS {
+	struct VFD;
+
+	struct BufferedVFDConfig
+	{
+		// The number of bytes that are buffered before they are written to the inner VFD. Writes
+		// that are at least this large are passed directly to the inner VFD.
+		Uptr numBufferBytes = 64 * 1024;
+
+		// If true, the buffered bytes are written to the inner VFD after any write that contains a
+		// newline.
+		bool flushOnNewline = false;
+
+		// The longest time that bytes may stay in the buffer before they are written to the inner
+		// VFD.
+		Time maxFlushDelay = Time{100 * 1000 * 1000};
+	};
+
+	// Creates a VFD that buffers writes to innerVFD and writes them to it in batches: when the
+	// buffer is full, when a newline is written (if config.flushOnNewline is set), when
+	// config.maxFlushDelay has elapsed since the buffer became non-empty, and before the VFD is
+	// synced, seeked, or closed. Errors from writing the buffered bytes are returned by the next
+	// operation on the VFD that writes the buffer. The buffered VFD takes ownership of innerVFD,
+	// and closes it when it is closed.
+	WAVM_API VFD* makeBufferedVFD(VFD* innerVFD,
+								  const BufferedVFDConfig& config = BufferedVFDConfig());
+}}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace WAVM { namespace VFS {
+	struct FileSystem;
+
+	// Creates a read-only file system from the regular files and directories in a tar archive.
+	// The archive is mapped into memory, and reads from its files are copied directly from the
+	// mapping, so the file system may be shared by many instances without reading the files from
+	// disk for each of them. The archive must not be modified while the file system or any of its
+	// open files exist. Returns null if the archive can't be mapped, or isn't a valid archive.
+	WAVM_API std::shared_ptr<FileSystem> makeBundleFS(const std::string& archivePath);
+}}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <memory>
+#include "WAVM/Inline/BasicTypes.h"
+
+namespace WAVM { namespace VFS {
+	struct FileSystem;
+
+	// Creates a writable file system whose files are stored in memory, such as for a guest's
+	// scratch files. Writes that would make the total size of its files exceed maxFileBytes fail
+	// with Result::outOfQuota. The file system may be shared by many processes, or created for
+	// each process or compartment to keep their files separate.
+	WAVM_API std::shared_ptr<FileSystem> makeMemoryFS(U64 maxFileBytes = UINT64_MAX);
+}}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace WAVM { namespace VFS {
+	struct FileSystem;
+
+	struct MountPoint
+	{
+		std::string path;
+		std::shared_ptr<FileSystem> fileSystem;
+	};
+
+	// Creates a file system that passes operations on paths beneath each mount point to the
+	// mounted file system, and operations on other paths to rootFS. If rootFS is null, only the
+	// paths beneath mount points exist. Listing a directory doesn't include the mount points in
+	// it, and files can't be renamed between file systems.
+	WAVM_API std::shared_ptr<FileSystem> makeMountFS(std::shared_ptr<FileSystem> rootFS,
+													 std::vector<MountPoint>&& mountPoints);
+}}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Time.h"
@@ -36,6 +37,25 @@ namespace WAVM { namespace VFS {
 		contentsAndMetadata
 	};
 
+	// How a range of a file is expected to be accessed. Advice doesn't change the behavior of
+	// operations on a file, but may improve their performance.
+	enum class FileAdvice
+	{
+		normal,
+		sequential,
+		random,
+		willNeed,
+		dontNeed,
+		noReuse
+	};
+
+	enum class SocketShutdownType
+	{
+		read,
+		write,
+		readWrite
+	};
+
 	enum class FileType
 	{
 		unknown,
@@ -110,6 +130,16 @@ namespace WAVM { namespace VFS {
 		Uptr numBytes;
 	};
 
+	struct SocketRecvFlags
+	{
+		// If true, the received data is left in the socket's receive queue.
+		bool peek{false};
+
+		// If true, the receive blocks until the buffers are full, unless the connection is closed
+		// or an error occurs.
+		bool waitAll{false};
+	};
+
 	// Error codes
 	// clang-format off
 
@@ -155,6 +185,9 @@ namespace WAVM { namespace VFS {
 		v(isNotDirectory, "Isn't a directory") \
 		v(isNotEmpty, "Directory isn't empty") \
 		v(brokenPipe, "Pipe is broken") \
+		v(notSocket, "Isn't a socket") \
+		v(notConnected, "Socket isn't connected") \
+		v(connectionReset, "Connection reset by peer") \
 		v(missingDevice, "Device is missing") \
 		v(busy, "Device or resource busy") \
 		v(notSupported, "Operation not supported")
@@ -168,6 +201,18 @@ namespace WAVM { namespace VFS {
 
 	// clang-format on
 
+	// A directory entry passed to DirEntStream::readEntries. The name isn't null-terminated, and
+	// is only valid until visitEntry returns. nextOffset is the offset to seek to for the entries
+	// after this one.
+	struct DirEntRef
+	{
+		U64 fileNumber;
+		const char* name;
+		Uptr numNameChars;
+		FileType type;
+		U64 nextOffset;
+	};
+
 	struct DirEntStream
 	{
 		virtual ~DirEntStream() {}
@@ -176,6 +221,19 @@ namespace WAVM { namespace VFS {
 
 		virtual bool getNext(DirEnt& outEntry) = 0;
 
+		// Calls visitEntry for each of the following entries, until it returns false or the end of
+		// the directory is reached. The entry that visitEntry returns false for is still consumed.
+		virtual void readEntries(const std::function<bool(const DirEntRef&)>& visitEntry)
+		{
+			DirEnt dirEnt;
+			while(getNext(dirEnt))
+			{
+				const DirEntRef entry{
+					dirEnt.fileNumber, dirEnt.name.c_str(), dirEnt.name.size(), dirEnt.type, tell()};
+				if(!visitEntry(entry)) { break; }
+			}
+		}
+
 		virtual void restart() = 0;
 		virtual U64 tell() = 0;
 		virtual bool seek(U64 offset) = 0;
@@ -205,6 +263,14 @@ namespace WAVM { namespace VFS {
 		virtual Result getFileInfo(FileInfo& outInfo) = 0;
 		virtual Result setVFDFlags(const VFDFlags& flags) = 0;
 		virtual Result setFileSize(U64 numBytes) = 0;
+
+		// Advises the host how the numBytes starting at offset will be accessed. If numBytes is 0,
+		// the advice applies to the rest of the file.
+		virtual Result advise(U64 offset, U64 numBytes, FileAdvice advice) = 0;
+
+		// Allocates the storage for the numBytes starting at offset, so writing them won't fail
+		// for lack of space. Extends the file if the range extends past its end.
+		virtual Result allocate(U64 offset, U64 numBytes) = 0;
 		virtual Result setFileTimes(bool setLastAccessTime,
 									Time lastAccessTime,
 									bool setLastWriteTime,
@@ -213,6 +279,30 @@ namespace WAVM { namespace VFS {
 
 		virtual Result openDir(DirEntStream*& outStream) = 0;
 
+		// Gets the host file descriptor (or HANDLE on Windows) that Platform::Poller waits on to
+		// find out when the VFD is readable or writable.
+		virtual Result getHostHandle(Uptr& outHandle) = 0;
+
+		// Receives data from a socket directly into the buffers. If the socket is a datagram socket
+		// and the message didn't fit in the buffers, the rest of the message is discarded and
+		// *outIsTruncated is set to true.
+		virtual Result recvv(const IOReadBuffer* buffers,
+							 Uptr numBuffers,
+							 const SocketRecvFlags& flags,
+							 Uptr* outNumBytesReceived = nullptr,
+							 bool* outIsTruncated = nullptr)
+			= 0;
+
+		// Sends data on a socket directly from the buffers. The buffers may be passed to the
+		// network stack without copying them, in which case sendv doesn't return until the stack
+		// is done with them.
+		virtual Result sendv(const IOWriteBuffer* buffers,
+							 Uptr numBuffers,
+							 Uptr* outNumBytesSent = nullptr)
+			= 0;
+
+		virtual Result shutdown(SocketShutdownType type) = 0;
+
 		Result read(void* outData,
 					Uptr numBytes,
 					Uptr* outNumBytesRead = nullptr,
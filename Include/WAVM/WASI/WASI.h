@@ -18,6 +18,21 @@ namespace WAVM { namespace WASI {
 
 	struct Process;
 
+	// Processes may import these WAVM extensions to WASI from the "wavm_wasi" module:
+	//
+	// fd_mmap(fd: fd, address: u32, numBytes: u32, offset: filesize, flags: u32) -> errno
+	//   Maps numBytes of a regular file, starting at offset, into the process's memory at
+	//   address. The host maps the file's pages directly into the memory, so processes that map
+	//   the same file share the host's copy of it. address and offset must be multiples of the
+	//   WebAssembly page size (64KiB), and the range must be inside the memory and the file. The
+	//   rest of the last host page after the range is also mapped. If flags contains 0x1, the
+	//   pages are copied to the memory when they are first written. Otherwise, the pages are
+	//   read-only, and writing them traps.
+	//
+	// munmap(address: u32, numBytes: u32) -> errno
+	//   Replaces the host pages that contain a range of the process's memory with zeroed pages,
+	//   such as to unmap a file mapped by fd_mmap. address must be a multiple of 64KiB.
+
 	WAVM_API std::shared_ptr<Process> createProcess(Runtime::Compartment* compartment,
 													std::vector<std::string>&& inArgs,
 													std::vector<std::string>&& inEnvs,
@@ -28,6 +43,22 @@ namespace WAVM { namespace WASI {
 
 	WAVM_API Runtime::Resolver& getProcessResolver(Process& process);
 
+	// Adds a socket opened by the embedder (e.g. a connection it accepted) to the process, and
+	// returns the WASI fd the process may use to send, receive, and poll on it. The process takes
+	// ownership of the VFD.
+	WAVM_API U32 addProcessSocket(Process& process, VFS::VFD* socket);
+
+	// Sets whether the process reads the realtime and monotonic clocks from the host's coarse
+	// clocks, which have a resolution of a few milliseconds on most hosts, but can be read without
+	// reading the hardware clock.
+	WAVM_API void setProcessUsesCoarseClocks(Process& process, bool useCoarseClocks);
+
+	// Replaces the arguments and environment variables that the process was created with, such as
+	// to run a process that was created before its arguments were known.
+	WAVM_API void setProcessArgs(Process& process,
+								 std::vector<std::string>&& args,
+								 std::vector<std::string>&& envs);
+
 	WAVM_API Process* getProcessFromContextRuntimeData(Runtime::ContextRuntimeData*);
 	WAVM_API Runtime::Memory* getProcessMemory(const Process& process);
 	WAVM_API void setProcessMemory(Process& process, Runtime::Memory* memory);
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Logging/Logging.h"
 
 namespace WAVM { namespace IR {
+	struct FeatureSpec;
 	struct Module;
 }}
 
@@ -16,6 +20,17 @@ namespace WAVM { namespace WASM {
 	// Saves a binary module.
 	WAVM_API std::vector<U8> saveBinaryModule(const IR::Module& module);
 
+	// Called with each chunk of a saved binary module, in order.
+	typedef std::function<void(const U8* bytes, Uptr numBytes)> SaveSink;
+
+	// Saves a binary module to a sink, so the whole serialized module is never in memory at once.
+	WAVM_API void saveBinaryModule(const IR::Module& module, const SaveSink& sink);
+
+	// Appends a custom section to a binary module without decoding or re-encoding the rest of it.
+	WAVM_API void appendCustomSection(std::vector<U8>& wasmBytes,
+									  const std::string& name,
+									  const std::vector<U8>& data);
+
 	// Loads a binary module, returning either an error or a module.
 	// If true is returned, the load succeeded, and outModule contains the loaded module.
 	// If false is returned, the load failed. If outError != nullptr, *outError will contain the
@@ -34,4 +49,48 @@ namespace WAVM { namespace WASM {
 								   Uptr numWASMBytes,
 								   IR::Module& outModule,
 								   LoadError* outError = nullptr);
+
+	// Loads a binary module like above, but the loaded module's data segments reference their
+	// bytes in wasmBytes instead of copying them. wasmBytesOwner must keep wasmBytes alive (e.g. a
+	// file mapping, or the vector that contains them), and is referenced by the data segments
+	// until they are destroyed. If wasmBytesOwner is null, the bytes are copied.
+	WAVM_API bool loadBinaryModule(const U8* wasmBytes,
+								   Uptr numWASMBytes,
+								   const std::shared_ptr<const void>& wasmBytesOwner,
+								   IR::Module& outModule,
+								   LoadError* outError = nullptr);
+
+	// Loads a binary module like above, but doesn't validate its function bodies. Unless the same
+	// bytes are known to have passed validation, the module must only be compiled with
+	// LLVMJIT::CompileOptions::validateFunctionBodies, which validates the function bodies in the
+	// same pass that compiles them.
+	WAVM_API bool loadBinaryModuleWithoutValidatingCode(const U8* wasmBytes,
+														Uptr numWASMBytes,
+														IR::Module& outModule,
+														LoadError* outError = nullptr);
+
+	// Loads a binary module from chunks of bytes as they are received, e.g. from the network.
+	// Each section is decoded and validated as soon as all of its bytes have been received, and
+	// each function body in the code section as soon as its bytes have been received, so loading
+	// the module overlaps with receiving it.
+	struct StreamingModuleLoader;
+
+	// Creates a StreamingModuleLoader for a module that may use the given features.
+	WAVM_API std::shared_ptr<StreamingModuleLoader> createStreamingModuleLoader(
+		const IR::FeatureSpec& featureSpec);
+
+	// Adds the next chunk of the module's bytes to the loader, and decodes as much of the module
+	// as possible. The chunks may be split at any byte. Returns false if the bytes received so
+	// far are malformed or invalid, in which case all later calls for the loader also fail.
+	WAVM_API bool addStreamingModuleBytes(StreamingModuleLoader& loader,
+										  const U8* bytes,
+										  Uptr numBytes,
+										  LoadError* outError = nullptr);
+
+	// Finishes loading a module after all of its bytes have been added to the loader. Returns
+	// false if the module is incomplete, malformed, or invalid. If true is returned, the module
+	// is moved to outModule, and the loader must not be used again.
+	WAVM_API bool finishStreamingModuleLoad(StreamingModuleLoader& loader,
+											IR::Module& outModule,
+											LoadError* outError = nullptr);
 }}
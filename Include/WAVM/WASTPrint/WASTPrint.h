@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include "WAVM/Inline/BasicTypes.h"
 
@@ -10,4 +11,11 @@ namespace WAVM { namespace IR {
 namespace WAVM { namespace WAST {
 	// Prints a module in WAST format.
 	WAVM_API std::string print(const IR::Module& module);
+
+	// Called with each chunk of a module's WAST text, in order.
+	typedef std::function<void(const char* chars, Uptr numChars)> PrintSink;
+
+	// Prints a module in WAST format to a sink as it is printed, so the module's whole text is
+	// never in memory at once. The function bodies are printed on numThreads threads.
+	WAVM_API void print(const IR::Module& module, const PrintSink& sink, Uptr numThreads = 1);
 }}
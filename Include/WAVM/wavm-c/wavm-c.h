@@ -187,6 +187,9 @@ static const uint32_t wasm_limits_max_default = 0xffffffff;
 
 // Value Types
 
+// Value types and function types are interned, and never freed: functions that return an owned
+// wasm_valtype_t or wasm_functype_t return a shared instance, and deleting it is a no-op.
+
 WASM_DECLARE_TYPE(valtype)
 
 typedef uint8_t wasm_valkind_t;
@@ -428,6 +431,22 @@ WASM_C_API own char* wasm_module_print(const wasm_module_t* module, size_t* out_
 
 WASM_C_API bool wasm_module_validate(const char* binary, size_t num_binary_bytes);
 
+// Serializes a module to its WebAssembly binary with its object code attached, so it can be
+// deserialized without compiling it again. The returned buffer must be freed with free().
+WASM_C_API own char* wasm_module_serialize(const wasm_module_t*, size_t* out_num_bytes);
+WASM_C_API own wasm_module_t* wasm_module_deserialize(wasm_engine_t*,
+													  const char* bytes,
+													  size_t num_bytes);
+
+// Deserializes a module like wasm_module_deserialize, but the module references its data
+// segments in the bytes instead of copying them (e.g. from a mapped file). The finalizer is
+// called with owner once the bytes are no longer referenced.
+WASM_C_API own wasm_module_t* wavm_module_deserialize_mapped(wasm_engine_t*,
+															 const char* bytes,
+															 size_t num_bytes,
+															 void* owner,
+															 void (*finalizer)(void*));
+
 WASM_C_API size_t wasm_module_num_imports(const wasm_module_t* module);
 WASM_C_API void wasm_module_import(const wasm_module_t* module,
 								   size_t index,
@@ -437,6 +456,15 @@ WASM_C_API void wasm_module_export(const wasm_module_t* module,
 								   size_t index,
 								   own wasm_export_t* out_export);
 
+// Returns the index of a module's export with the given name, which wasm_instance_export takes to
+// get the export of any instance of the module without looking it up by name again. If type is
+// non-null, the type the module declares for the export must also match it. Returns SIZE_MAX if
+// the module has no matching export.
+WASM_C_API size_t wavm_module_export_index(const wasm_module_t* module,
+										   const char* name,
+										   size_t num_name_bytes,
+										   const wasm_externtype_t* type);
+
 // Function Instances
 
 WASM_DECLARE_SHAREABLE_REF(func)
@@ -466,6 +494,16 @@ WASM_C_API own wasm_trap_t* wasm_func_call(wasm_store_t*,
 										   const wasm_val_t args[],
 										   wasm_val_t results[]);
 
+// Calls a function like wasm_func_call, but with the function type that the caller expects it to
+// have (e.g. from wasm_func_type), so the signature check is a single comparison of uniqued types.
+// It doesn't allocate: args and results are passed to the function in place without checking
+// them, and must have space for as many values as the type has params and results.
+WASM_C_API own wasm_trap_t* wavm_func_call_unchecked(wasm_store_t*,
+													 const wasm_func_t*,
+													 const wasm_functype_t* type,
+													 const wasm_val_t args[],
+													 wasm_val_t results[]);
+
 // Global Instances
 
 WASM_DECLARE_REF(global)
@@ -568,6 +606,18 @@ WASM_C_API own wasm_instance_t* wasm_instance_new(wasm_store_t*,
 WASM_C_API size_t wasm_instance_num_exports(const wasm_instance_t*);
 WASM_C_API wasm_extern_t* wasm_instance_export(const wasm_instance_t*, size_t index);
 
+// Metrics
+
+// Writes the runtime's metrics in the Prometheus text exposition format to buffer, truncating it
+// to num_buffer_bytes (including the null terminator). Returns the number of bytes needed to hold
+// the whole text, including the null terminator.
+WASM_C_API size_t wavm_metrics_get_prometheus_text(char* buffer, size_t num_buffer_bytes);
+
+// Reads the value of a counter or gauge, or the number of values recorded by a histogram. name must
+// include any labels, e.g. "wavm_traps_total{type=\"wavm.outOfBounds\"}". Returns false if there
+// is no metric with that name.
+WASM_C_API bool wavm_metrics_get_counter(const char* name, uint64_t* out_value);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Convenience
 
@@ -85,6 +85,9 @@ static emabi::Result asEmscriptenErrNo(VFS::Result result)
 	case VFS::Result::isNotDirectory: return emabi::enotdir;
 	case VFS::Result::isNotEmpty: return emabi::enotempty;
 	case VFS::Result::brokenPipe: return emabi::epipe;
+	case VFS::Result::notSocket: return emabi::enotsock;
+	case VFS::Result::notConnected: return emabi::enotconn;
+	case VFS::Result::connectionReset: return emabi::econnreset;
 	case VFS::Result::missingDevice: return emabi::enxio;
 	case VFS::Result::busy: return emabi::ebusy;
 	case VFS::Result::notSupported: return emabi::enotsup;
@@ -8,6 +8,7 @@
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/Inline/IntrusiveSharedPtr.h"
 #include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Event.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -51,7 +52,8 @@ namespace WAVM { namespace Emscripten {
 		emabi::pthread_t id = 0;
 		std::atomic<Uptr> numRefs{0};
 
-		Platform::Thread* platformThread = nullptr;
+		// Signaled by the pool's host thread when the thread exits.
+		Platform::Event exitEvent;
 		Runtime::GCPointer<Runtime::Context> context;
 		Runtime::GCPointer<Runtime::Function> threadFunc;
 
@@ -79,6 +81,28 @@ namespace WAVM { namespace Emscripten {
 		}
 	};
 
+	// A host thread in the process's thread pool, which runs threads created by WebAssembly code.
+	struct WorkerThread
+	{
+		Emscripten::Process* process;
+		Platform::Thread* platformThread = nullptr;
+
+		// Signaled when the worker is given a thread to run, or when the pool is being stopped.
+		Platform::Event wakeEvent;
+
+		// The thread that the worker should run next, or null if the worker is idle.
+		IntrusiveSharedPtr<Thread> thread;
+
+		WorkerThread(Emscripten::Process* inProcess) : process(inProcess) {}
+	};
+
+	// The context and the aliased stack of an exited thread, which can be reused by a new thread.
+	struct FreeThreadContext
+	{
+		Runtime::GCPointer<Runtime::Context> context;
+		emabi::Address stackAddress;
+	};
+
 	struct Process : Runtime::Resolver
 	{
 		Runtime::GCPointer<Runtime::Compartment> compartment;
@@ -101,10 +125,25 @@ namespace WAVM { namespace Emscripten {
 		Runtime::GCPointer<Runtime::Function> stackRestore;
 		Runtime::GCPointer<Runtime::Function> errnoLocation;
 
-		// A global list of running threads created by WebAssembly code.
+		// A global list of running threads created by WebAssembly code. Once a thread is
+		// joined or detached, its ID is reused by the next thread to be created.
 		Platform::Mutex threadsMutex;
 		IndexMap<emabi::pthread_t, IntrusiveSharedPtr<Thread>> threads{1, UINT32_MAX};
 
+		// A bounded pool of host threads that run threads created by WebAssembly code, and the
+		// contexts of exited threads, so creating a thread doesn't need to create a host thread or
+		// a context.
+		Platform::Mutex threadPoolMutex;
+		std::vector<WorkerThread*> workerThreads;
+		std::vector<WorkerThread*> idleWorkerThreads;
+		std::vector<FreeThreadContext> freeThreadContexts;
+		Uptr maxWorkerThreads{defaultMaxThreadPoolSize};
+		bool isStoppingWorkerThreads{false};
+		U64 numThreadsCreated{0};
+		U64 numThreadsOnIdleWorkers{0};
+		U64 numRecycledContexts{0};
+		U64 numThreadsRejected{0};
+
 		std::atomic<emabi::pthread_key_t> pthreadSpecificNextKey{0};
 
 		std::atomic<emabi::Address> currentLocale;
@@ -1,7 +1,12 @@
+#include <atomic>
 #include "EmscriptenABI.h"
 #include "EmscriptenPrivate.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/I128.h"
 #include "WAVM/Inline/IntrusiveSharedPtr.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Event.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -35,6 +40,31 @@ static bool validateThreadId(Emscripten::Process* process, emabi::pthread_t thre
 	return threadId != 0 && process->threads.contains(threadId);
 }
 
+// Stops the pool's host threads. The threads created by WebAssembly code must have exited.
+static void stopWorkerThreads(Process& process)
+{
+	std::vector<WorkerThread*> workerThreads;
+	{
+		Platform::Mutex::Lock threadPoolLock(process.threadPoolMutex);
+		process.isStoppingWorkerThreads = true;
+		workerThreads = std::move(process.workerThreads);
+		process.workerThreads.clear();
+		for(WorkerThread* workerThread : process.idleWorkerThreads)
+		{ workerThread->wakeEvent.signal(); }
+		process.idleWorkerThreads.clear();
+	}
+
+	// A worker that was about to return to the pool when it was stopped exits instead.
+	for(WorkerThread* workerThread : workerThreads)
+	{
+		if(workerThread->platformThread) { Platform::joinThread(workerThread->platformThread); }
+		delete workerThread;
+	}
+
+	Platform::Mutex::Lock threadPoolLock(process.threadPoolMutex);
+	process.isStoppingWorkerThreads = false;
+}
+
 void Emscripten::joinAllThreads(Process& process)
 {
 	while(true)
@@ -51,16 +81,34 @@ void Emscripten::joinAllThreads(Process& process)
 
 		threadsLock.unlock();
 
-		Platform::joinThread(thread->platformThread);
-		thread->platformThread = nullptr;
+		WAVM_ERROR_UNLESS(thread->exitEvent.wait(Time::infinity()));
 	};
+
+	stopWorkerThreads(process);
 }
 
-static I64 threadEntry(void* threadVoid)
+void Emscripten::setMaxThreadPoolSize(Process& process, Uptr maxWorkerThreads)
 {
-	IntrusiveSharedPtr<Thread> thread
-		= IntrusiveSharedPtr<Thread>::adopt(std::move((Thread*)threadVoid));
+	Platform::Mutex::Lock threadPoolLock(process.threadPoolMutex);
+	process.maxWorkerThreads = maxWorkerThreads;
+}
 
+ThreadPoolStats Emscripten::getThreadPoolStats(Process& process)
+{
+	Platform::Mutex::Lock threadPoolLock(process.threadPoolMutex);
+	ThreadPoolStats stats;
+	stats.numWorkerThreads = process.workerThreads.size();
+	stats.numBusyWorkerThreads = process.workerThreads.size() - process.idleWorkerThreads.size();
+	stats.maxWorkerThreads = process.maxWorkerThreads;
+	stats.numThreadsCreated = process.numThreadsCreated;
+	stats.numThreadsOnIdleWorkers = process.numThreadsOnIdleWorkers;
+	stats.numRecycledContexts = process.numRecycledContexts;
+	stats.numThreadsRejected = process.numThreadsRejected;
+	return stats;
+}
+
+static void runThread(Thread* thread)
+{
 	catchRuntimeExceptions(
 		[&]() {
 			try
@@ -84,25 +132,258 @@ static I64 threadEntry(void* threadVoid)
 		[](Exception* exception) {
 			Errors::fatalf("Runtime exception: %s", describeException(exception).c_str());
 		});
+}
+
+static I64 workerThreadEntry(void* workerThreadVoid)
+{
+	WorkerThread* workerThread = (WorkerThread*)workerThreadVoid;
+	Process* process = workerThread->process;
+
+	// Run the guest threads on the compartment's NUMA node, if it has one.
+	const Uptr numaNode = getCompartmentLayout(process->compartment).numaNode;
+	if(numaNode != UINTPTR_MAX) { Platform::bindCurrentThreadToNUMANode(numaNode); }
+
+	while(true)
+	{
+		// Wait until the worker is given a thread to run, or the pool is stopped.
+		IntrusiveSharedPtr<Thread> thread;
+		while(true)
+		{
+			{
+				Platform::Mutex::Lock threadPoolLock(process->threadPoolMutex);
+				if(workerThread->thread)
+				{
+					thread = std::move(workerThread->thread);
+					break;
+				}
+				if(process->isStoppingWorkerThreads) { return 0; }
+			}
+			WAVM_ERROR_UNLESS(workerThread->wakeEvent.wait(Time::infinity()));
+		};
+
+		runThread(thread);
+
+		// Take the thread's context and stack for reuse by a later thread, and wake the thread
+		// waiting to join the exited thread.
+		FreeThreadContext freeContext{thread->context, thread->stackAddress};
+		thread->context = nullptr;
+		thread->exitEvent.signal();
+		thread = nullptr;
+
+		Platform::Mutex::Lock threadPoolLock(process->threadPoolMutex);
+		process->freeThreadContexts.push_back(std::move(freeContext));
+		if(process->isStoppingWorkerThreads) { return 0; }
+		process->idleWorkerThreads.push_back(workerThread);
+	};
+}
+
+// Emscripten's pthread_mutex_t and pthread_cond_t use musl's layout, and are all zeros when they
+// are statically initialized. The mutex's lock word holds the ID of the owning thread plus one,
+// with mutexContendedBit set if other threads may be waiting for the mutex, and its count word
+// holds the number of times the owner locked it recursively. The condition variable's sequence
+// word is incremented each time it is signaled, and its waiters word counts the waiting threads.
+// Waiting threads block on the words with the same wait queues as memory.atomic.wait.
+static constexpr U32 mutexLockOffset = 4;
+static constexpr U32 mutexCountOffset = 20;
+static constexpr U32 mutexContendedBit = 0x80000000;
+static constexpr U32 condSequenceOffset = 8;
+static constexpr U32 condNumWaitersOffset = 12;
+
+static std::atomic<U32>& atomicMemoryRef(Memory* memory, U32 address)
+{
+	if(address & 3)
+	{ throwException(ExceptionTypes::misalignedAtomicMemoryAccess, {U64(address)}); }
+	static_assert(sizeof(std::atomic<U32>) == sizeof(U32), "relying on non-standard behavior");
+	return *(std::atomic<U32>*)&memoryRef<U32>(memory, address);
+}
+
+static U32 getMutexOwner(Thread* thread) { return thread->id + 1; }
+
+static bool isMutexOwnedBy(std::atomic<U32>& lockWord, Thread* thread)
+{
+	return (lockWord.load() & ~mutexContendedBit) == getMutexOwner(thread);
+}
+
+static void lockMutex(Memory* memory, Thread* thread, U32 mutexAddress)
+{
+	std::atomic<U32>& lockWord = atomicMemoryRef(memory, mutexAddress + mutexLockOffset);
+	const U32 owner = getMutexOwner(thread);
+
+	U32 lockValue = 0;
+	if(lockWord.compare_exchange_strong(lockValue, owner)) { return; }
+	while(true)
+	{
+		if(lockValue)
+		{
+			// Mark the mutex as contended, so its owner wakes a waiting thread when it unlocks the
+			// mutex, and wait for it to be unlocked.
+			if(!(lockValue & mutexContendedBit)
+			   && !lockWord.compare_exchange_strong(lockValue, lockValue | mutexContendedBit))
+			{ continue; }
+			atomicWait32(memory, mutexAddress + mutexLockOffset, lockValue | mutexContendedBit, -1);
+		}
+
+		// Other threads may still be waiting, so leave the mutex marked as contended.
+		lockValue = 0;
+		if(lockWord.compare_exchange_strong(lockValue, owner | mutexContendedBit)) { return; }
+	};
+}
+
+static void unlockMutex(Memory* memory, U32 mutexAddress)
+{
+	std::atomic<U32>& lockWord = atomicMemoryRef(memory, mutexAddress + mutexLockOffset);
+	if(lockWord.exchange(0) & mutexContendedBit)
+	{ atomicNotify(memory, mutexAddress + mutexLockOffset, 1); }
+}
+
+static emabi::Result waitForCondition(Runtime::ContextRuntimeData* contextRuntimeData,
+									  U32 condAddress,
+									  U32 mutexAddress,
+									  I64 timeoutNanoseconds)
+{
+	Emscripten::Process* process = getProcess(contextRuntimeData);
+	Emscripten::Thread* thread = getEmscriptenThread(contextRuntimeData);
+	Memory* memory = process->memory;
+
+	std::atomic<U32>& sequence = atomicMemoryRef(memory, condAddress + condSequenceOffset);
+	std::atomic<U32>& numWaiters = atomicMemoryRef(memory, condAddress + condNumWaitersOffset);
+	if(!isMutexOwnedBy(atomicMemoryRef(memory, mutexAddress + mutexLockOffset), thread))
+	{ return emabi::eperm; }
+
+	// Read the sequence number before unlocking the mutex: a thread that signals the condition
+	// after the mutex is unlocked changes it, which ends the wait.
+	const U32 waitSequence = sequence.load();
+	++numWaiters;
+
+	// Fully unlock the mutex, and restore its recursion count after locking it again.
+	U32& lockCount = memoryRef<U32>(memory, mutexAddress + mutexCountOffset);
+	const U32 savedLockCount = lockCount;
+	lockCount = 0;
+	unlockMutex(memory, mutexAddress);
+
+	const U32 waitResult
+		= atomicWait32(memory, condAddress + condSequenceOffset, waitSequence, timeoutNanoseconds);
+
+	--numWaiters;
+	lockMutex(memory, thread, mutexAddress);
+	lockCount = savedLockCount;
+
+	return waitResult == 2 ? emabi::etimedout : emabi::esuccess;
+}
+
+static void signalCondition(Memory* memory, U32 condAddress, U32 numToWake)
+{
+	std::atomic<U32>& sequence = atomicMemoryRef(memory, condAddress + condSequenceOffset);
+	std::atomic<U32>& numWaiters = atomicMemoryRef(memory, condAddress + condNumWaitersOffset);
+	++sequence;
+	if(numWaiters.load()) { atomicNotify(memory, condAddress + condSequenceOffset, numToWake); }
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_mutex_lock",
+							   emabi::Result,
+							   emscripten_pthread_mutex_lock,
+							   U32 mutexAddress)
+{
+	Emscripten::Process* process = getProcess(contextRuntimeData);
+	Emscripten::Thread* thread = getEmscriptenThread(contextRuntimeData);
+
+	// Mutexes are always recursive, since the mutex type set by pthread_mutexattr_settype isn't
+	// tracked.
+	if(isMutexOwnedBy(atomicMemoryRef(process->memory, mutexAddress + mutexLockOffset), thread))
+	{ ++memoryRef<U32>(process->memory, mutexAddress + mutexCountOffset); }
+	else
+	{
+		lockMutex(process->memory, thread, mutexAddress);
+	}
+	return emabi::esuccess;
+}
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_mutex_unlock",
+							   emabi::Result,
+							   emscripten_pthread_mutex_unlock,
+							   U32 mutexAddress)
+{
+	Emscripten::Process* process = getProcess(contextRuntimeData);
+	Emscripten::Thread* thread = getEmscriptenThread(contextRuntimeData);
 
-	return 0;
+	if(!isMutexOwnedBy(atomicMemoryRef(process->memory, mutexAddress + mutexLockOffset), thread))
+	{ return emabi::eperm; }
+
+	U32& lockCount = memoryRef<U32>(process->memory, mutexAddress + mutexCountOffset);
+	if(lockCount) { --lockCount; }
+	else
+	{
+		unlockMutex(process->memory, mutexAddress);
+	}
+	return emabi::esuccess;
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_cond_init",
+							   emabi::Result,
+							   emscripten_pthread_cond_init,
+							   U32 condAddress,
+							   U32 condAttrAddress)
+{
+	Emscripten::Process* process = getProcess(contextRuntimeData);
+	atomicMemoryRef(process->memory, condAddress + condSequenceOffset).store(0);
+	atomicMemoryRef(process->memory, condAddress + condNumWaitersOffset).store(0);
+	return emabi::esuccess;
+}
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_cond_destroy",
+							   emabi::Result,
+							   emscripten_pthread_cond_destroy,
+							   U32 condAddress)
+{
+	return emabi::esuccess;
+}
 WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 							   "_pthread_cond_wait",
 							   emabi::Result,
 							   emscripten_pthread_cond_wait,
-							   I32 a,
-							   I32 b)
+							   U32 condAddress,
+							   U32 mutexAddress)
+{
+	return waitForCondition(contextRuntimeData, condAddress, mutexAddress, -1);
+}
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_cond_timedwait",
+							   emabi::Result,
+							   emscripten_pthread_cond_timedwait,
+							   U32 condAddress,
+							   U32 mutexAddress,
+							   U32 absTimeAddress)
+{
+	Emscripten::Process* process = getProcess(contextRuntimeData);
+
+	// The timeout is an absolute time on the real-time clock.
+	const U32 absTimeSeconds = memoryRef<U32>(process->memory, absTimeAddress + 0);
+	const U32 absTimeNanoseconds = memoryRef<U32>(process->memory, absTimeAddress + 4);
+	if(absTimeNanoseconds >= 1000000000) { return emabi::einval; }
+	const I128 timeoutNS = I128(absTimeSeconds) * 1000000000 + absTimeNanoseconds
+						   - Platform::getClockTime(Platform::Clock::realtime).ns;
+	const I64 timeoutNanoseconds = timeoutNS <= 0 ? 0 : timeoutNS >= INT64_MAX ? -1 : I64(timeoutNS);
+
+	return waitForCondition(contextRuntimeData, condAddress, mutexAddress, timeoutNanoseconds);
+}
+WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
+							   "_pthread_cond_signal",
+							   emabi::Result,
+							   emscripten_pthread_cond_signal,
+							   U32 condAddress)
 {
+	signalCondition(getProcess(contextRuntimeData)->memory, condAddress, 1);
 	return emabi::esuccess;
 }
 WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 							   "_pthread_cond_broadcast",
 							   emabi::Result,
 							   emscripten_pthread_cond_broadcast,
-							   I32 a)
+							   U32 condAddress)
 {
+	signalCondition(getProcess(contextRuntimeData)->memory, condAddress, UINT32_MAX);
 	return emabi::esuccess;
 }
 
@@ -129,22 +410,6 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 
 	return emabi::esuccess;
 }
-WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
-							   "_pthread_mutex_lock",
-							   emabi::Result,
-							   emscripten_pthread_mutex_lock,
-							   I32 a)
-{
-	return emabi::esuccess;
-}
-WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
-							   "_pthread_mutex_unlock",
-							   emabi::Result,
-							   emscripten_pthread_mutex_unlock,
-							   I32 a)
-{
-	return emabi::esuccess;
-}
 WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 							   "_pthread_setspecific",
 							   emabi::Result,
@@ -236,29 +501,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 	memoryRef<U32>(process->memory, stackSizeAddress) = thread->numStackBytes;
 	return emabi::esuccess;
 }
-WAVM_DEFINE_UNIMPLEMENTED_INTRINSIC_FUNCTION(envThreads,
-											 "_pthread_cond_destroy",
-											 emabi::Result,
-											 emscripten_pthread_cond_destroy,
-											 U32);
-WAVM_DEFINE_UNIMPLEMENTED_INTRINSIC_FUNCTION(envThreads,
-											 "_pthread_cond_init",
-											 emabi::Result,
-											 emscripten_pthread_cond_init,
-											 U32,
-											 U32);
-WAVM_DEFINE_UNIMPLEMENTED_INTRINSIC_FUNCTION(envThreads,
-											 "_pthread_cond_signal",
-											 emabi::Result,
-											 emscripten_pthread_cond_signal,
-											 U32);
-WAVM_DEFINE_UNIMPLEMENTED_INTRINSIC_FUNCTION(envThreads,
-											 "_pthread_cond_timedwait",
-											 emabi::Result,
-											 emscripten_pthread_cond_timedwait,
-											 U32,
-											 U32,
-											 U32);
+static constexpr emabi::Address threadStackNumBytes = 2 * 1024 * 1024;
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 							   "_pthread_create",
@@ -280,24 +523,69 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 	   || getFunctionType(threadFunc) != FunctionType({ValueType::i32}, {ValueType::i32}))
 	{ throwException(Runtime::ExceptionTypes::indirectCallSignatureMismatch); }
 
+	// Take an idle host thread from the pool, or add a new one if the pool isn't full, and reuse
+	// the context and aliased stack of an exited thread if there is one.
+	WorkerThread* workerThread;
+	FreeThreadContext freeContext;
+	{
+		Platform::Mutex::Lock threadPoolLock(process->threadPoolMutex);
+		if(process->idleWorkerThreads.size())
+		{
+			workerThread = process->idleWorkerThreads.back();
+			process->idleWorkerThreads.pop_back();
+			++process->numThreadsOnIdleWorkers;
+		}
+		else if(process->workerThreads.size() < process->maxWorkerThreads)
+		{
+			workerThread = new WorkerThread(process);
+			process->workerThreads.push_back(workerThread);
+		}
+		else
+		{
+			++process->numThreadsRejected;
+			return emabi::eagain;
+		}
+		++process->numThreadsCreated;
+
+		if(process->freeThreadContexts.size())
+		{
+			freeContext = std::move(process->freeThreadContexts.back());
+			process->freeThreadContexts.pop_back();
+			++process->numRecycledContexts;
+		}
+	}
+
+	if(freeContext.context) { resetContext(freeContext.context); }
+	else
+	{
+		freeContext.context
+			= createContext(getCompartmentFromContextRuntimeData(contextRuntimeData));
+
+		// Allocate the aliased stack for the thread.
+		freeContext.stackAddress = dynamicAlloc(
+			process, getContextFromRuntimeData(contextRuntimeData), threadStackNumBytes);
+	}
+
 	// Create a thread object that will expose its entry and error functions to the garbage
 	// collector as roots.
-	auto newContext = createContext(getCompartmentFromContextRuntimeData(contextRuntimeData));
-	Thread* thread = new Thread(process, newContext, threadFunc, threadFuncArg);
-	setUserData(newContext, thread);
+	Thread* thread = new Thread(process, freeContext.context, threadFunc, threadFuncArg);
+	setUserData(freeContext.context, thread);
+	thread->numStackBytes = threadStackNumBytes;
+	thread->stackAddress = freeContext.stackAddress;
 
 	allocateThreadId(process, thread);
 
-	// Allocate the aliased stack for the thread.
-	thread->numStackBytes = 2 * 1024 * 1024;
-	thread->stackAddress = dynamicAlloc(
-		process, getContextFromRuntimeData(contextRuntimeData), thread->numStackBytes);
-
-	// Increment the Thread's reference count for the pointer passed to the thread's entry function.
-	thread->addRef();
-
-	// Spawn a platform thread that calls threadFunc.
-	thread->platformThread = Platform::createThread(0, threadEntry, thread);
+	// Give the thread to the host thread, starting the host thread if it's new.
+	{
+		Platform::Mutex::Lock threadPoolLock(process->threadPoolMutex);
+		workerThread->thread = thread;
+		if(workerThread->platformThread) { workerThread->wakeEvent.signal(); }
+		else
+		{
+			workerThread->platformThread
+				= Platform::createThread(0, workerThreadEntry, workerThread);
+		}
+	}
 
 	// Write the thread ID to the address provided.
 	unwindSignalsAsExceptions(
@@ -341,8 +629,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(envThreads,
 
 	IntrusiveSharedPtr<Thread> thread;
 	if(!removeThreadById(process, threadId, thread)) { return emabi::esrch; }
-	Platform::joinThread(thread->platformThread);
-	thread->platformThread = nullptr;
+	WAVM_ERROR_UNLESS(thread->exitEvent.wait(Time::infinity()));
 
 	const U32 exitCode = thread->exitCode.load();
 
@@ -0,0 +1,475 @@
+#include "WAVM/IR/LinkModules.h"
+#include <string>
+#include <vector>
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Serialization.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// The indices in the linked module of a group module's definitions and imports.
+struct LinkedIndices
+{
+	Uptr typeOffset = 0;
+	Uptr dataSegmentOffset = 0;
+	Uptr elemSegmentOffset = 0;
+	std::vector<Uptr> functions;
+	std::vector<Uptr> tables;
+	std::vector<Uptr> memories;
+	std::vector<Uptr> globals;
+	std::vector<Uptr> exceptionTypes;
+
+	std::vector<Uptr>& get(ExternKind kind)
+	{
+		switch(kind)
+		{
+		case ExternKind::function: return functions;
+		case ExternKind::table: return tables;
+		case ExternKind::memory: return memories;
+		case ExternKind::global: return globals;
+		case ExternKind::exceptionType: return exceptionTypes;
+
+		case ExternKind::invalid:
+		default: WAVM_UNREACHABLE();
+		};
+	}
+};
+
+// The export of an earlier module in the group that an import is bound to.
+struct ResolvedImport
+{
+	Uptr moduleIndex;
+	Uptr exportIndex;
+};
+
+static constexpr Uptr unresolvedModuleIndex = UINTPTR_MAX;
+
+static const char* getKindName(ExternKind kind)
+{
+	switch(kind)
+	{
+	case ExternKind::function: return "function";
+	case ExternKind::table: return "table";
+	case ExternKind::memory: return "memory";
+	case ExternKind::global: return "global";
+	case ExternKind::exceptionType: return "exception type";
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+static void getImportNames(const Module& module,
+						   KindAndIndex import,
+						   const std::string*& outModuleName,
+						   const std::string*& outExportName)
+{
+	switch(import.kind)
+	{
+#define GET_IMPORT_NAMES(kindName, indexSpace)                                                     \
+	case ExternKind::kindName:                                                                     \
+		outModuleName = &module.indexSpace.imports[import.index].moduleName;                       \
+		outExportName = &module.indexSpace.imports[import.index].exportName;                       \
+		break;
+		GET_IMPORT_NAMES(function, functions)
+		GET_IMPORT_NAMES(table, tables)
+		GET_IMPORT_NAMES(memory, memories)
+		GET_IMPORT_NAMES(global, globals)
+		GET_IMPORT_NAMES(exceptionType, exceptionTypes)
+#undef GET_IMPORT_NAMES
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+// Returns whether an export of one module can be bound to an import of another.
+static bool isExportCompatible(const Module& exportModule,
+							   Uptr exportIndex,
+							   const Module& importModule,
+							   KindAndIndex import)
+{
+	switch(import.kind)
+	{
+	case ExternKind::function:
+		return isSubtype(exportModule.types[exportModule.functions.getType(exportIndex).index],
+						 importModule.types[importModule.functions.getType(import.index).index]);
+	case ExternKind::table:
+		return isSubtype(exportModule.tables.getType(exportIndex),
+						 importModule.tables.getType(import.index));
+	case ExternKind::memory:
+		return isSubtype(exportModule.memories.getType(exportIndex),
+						 importModule.memories.getType(import.index));
+	case ExternKind::global:
+		return isSubtype(exportModule.globals.getType(exportIndex),
+						 importModule.globals.getType(import.index));
+	case ExternKind::exceptionType:
+		return exportModule.exceptionTypes.getType(exportIndex).params
+			   == importModule.exceptionTypes.getType(import.index).params;
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+// Re-encodes a function's code with the indices it uses mapped to the linked module's indices.
+struct CodeRelinker
+{
+	typedef void Result;
+
+	CodeRelinker(const LinkedIndices& inIndices, OperatorEncoderStream& inEncoder)
+	: indices(inIndices), encoder(inEncoder)
+	{
+	}
+
+#define VISIT_OPCODE(_, name, nameString, Imm, ...)                                                \
+	void name(Imm imm)                                                                             \
+	{                                                                                              \
+		relink(imm);                                                                               \
+		encoder.name(imm);                                                                         \
+	}
+	WAVM_ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+
+private:
+	const LinkedIndices& indices;
+	OperatorEncoderStream& encoder;
+
+	template<typename Imm> void relink(Imm&) {}
+
+	void relink(ControlStructureImm& imm)
+	{
+		if(imm.type.format == IndexedBlockType::functionType)
+		{ imm.type.index += indices.typeOffset; }
+	}
+	void relink(FunctionImm& imm) { imm.functionIndex = indices.functions[imm.functionIndex]; }
+	void relink(FunctionRefImm& imm) { imm.functionIndex = indices.functions[imm.functionIndex]; }
+	void relink(CallIndirectImm& imm)
+	{
+		imm.type.index += indices.typeOffset;
+		imm.tableIndex = indices.tables[imm.tableIndex];
+	}
+	void relink(GetOrSetVariableImm<true>& imm)
+	{
+		imm.variableIndex = indices.globals[imm.variableIndex];
+	}
+	void relink(ExceptionTypeImm& imm)
+	{
+		imm.exceptionTypeIndex = indices.exceptionTypes[imm.exceptionTypeIndex];
+	}
+
+	void relink(TableImm& imm) { imm.tableIndex = indices.tables[imm.tableIndex]; }
+	void relink(TableCopyImm& imm)
+	{
+		imm.destTableIndex = indices.tables[imm.destTableIndex];
+		imm.sourceTableIndex = indices.tables[imm.sourceTableIndex];
+	}
+	void relink(ElemSegmentImm& imm) { imm.elemSegmentIndex += indices.elemSegmentOffset; }
+	void relink(ElemSegmentAndTableImm& imm)
+	{
+		imm.elemSegmentIndex += indices.elemSegmentOffset;
+		imm.tableIndex = indices.tables[imm.tableIndex];
+	}
+
+	void relink(MemoryImm& imm) { imm.memoryIndex = indices.memories[imm.memoryIndex]; }
+	void relink(MemoryCopyImm& imm)
+	{
+		imm.destMemoryIndex = indices.memories[imm.destMemoryIndex];
+		imm.sourceMemoryIndex = indices.memories[imm.sourceMemoryIndex];
+	}
+	void relink(DataSegmentImm& imm) { imm.dataSegmentIndex += indices.dataSegmentOffset; }
+	void relink(DataSegmentAndMemImm& imm)
+	{
+		imm.dataSegmentIndex += indices.dataSegmentOffset;
+		imm.memoryIndex = indices.memories[imm.memoryIndex];
+	}
+	template<Uptr naturalAlignmentLog2> void relink(LoadOrStoreImm<naturalAlignmentLog2>& imm)
+	{
+		imm.memoryIndex = indices.memories[imm.memoryIndex];
+	}
+	template<Uptr naturalAlignmentLog2, Uptr numLanes>
+	void relink(LoadOrStoreLaneImm<naturalAlignmentLog2, numLanes>& imm)
+	{
+		imm.memoryIndex = indices.memories[imm.memoryIndex];
+	}
+	template<Uptr naturalAlignmentLog2>
+	void relink(AtomicLoadOrStoreImm<naturalAlignmentLog2>& imm)
+	{
+		imm.memoryIndex = indices.memories[imm.memoryIndex];
+	}
+};
+
+static InitializerExpression relinkInitializer(const LinkedIndices& indices,
+											   InitializerExpression expression)
+{
+	switch(expression.type)
+	{
+	case InitializerExpression::Type::global_get:
+		expression.ref = indices.globals[expression.ref];
+		break;
+	case InitializerExpression::Type::ref_func:
+		expression.ref = indices.functions[expression.ref];
+		break;
+
+	case InitializerExpression::Type::i32_const:
+	case InitializerExpression::Type::i64_const:
+	case InitializerExpression::Type::f32_const:
+	case InitializerExpression::Type::f64_const:
+	case InitializerExpression::Type::v128_const:
+	case InitializerExpression::Type::ref_null:
+	case InitializerExpression::Type::invalid:
+	default: break;
+	};
+	return expression;
+}
+
+bool IR::linkModules(const std::vector<LinkGroupModule>& groupModules,
+					 Module& outModule,
+					 std::string& outError)
+{
+	WAVM_ASSERT(!outModule.types.size() && !outModule.imports.size());
+	WAVM_ASSERT(!outModule.functions.size() && !outModule.tables.size());
+	WAVM_ASSERT(!outModule.memories.size() && !outModule.globals.size());
+	WAVM_ASSERT(!outModule.exceptionTypes.size() && !outModule.exports.size());
+	WAVM_ASSERT(!outModule.dataSegments.size() && !outModule.elemSegments.size());
+
+	// Bind each import whose module name is an earlier module in the group to that module's
+	// export, and count the imports of each kind that aren't bound.
+	HashMap<std::string, Uptr> moduleIndexByName;
+	std::vector<HashMap<std::string, Uptr>> exportIndexByName(groupModules.size());
+	std::vector<std::vector<ResolvedImport>> resolvedImports(groupModules.size());
+	Uptr numUnresolvedImportsByKind[Uptr(ExternKind::exceptionType) + 1] = {0};
+	for(Uptr moduleIndex = 0; moduleIndex < groupModules.size(); ++moduleIndex)
+	{
+		const LinkGroupModule& groupModule = groupModules[moduleIndex];
+		const Module& module = *groupModule.module;
+
+		for(const KindAndIndex& import : module.imports)
+		{
+			const std::string* importModuleName;
+			const std::string* importExportName;
+			getImportNames(module, import, importModuleName, importExportName);
+
+			const Uptr* exportModuleIndex = moduleIndexByName.get(*importModuleName);
+			if(!exportModuleIndex)
+			{
+				resolvedImports[moduleIndex].push_back({unresolvedModuleIndex, 0});
+				++numUnresolvedImportsByKind[Uptr(import.kind)];
+				continue;
+			}
+
+			const Module& exportModule = *groupModules[*exportModuleIndex].module;
+			const Uptr* exportIndex = exportIndexByName[*exportModuleIndex].get(*importExportName);
+			if(!exportIndex)
+			{
+				outError = "module " + groupModule.name + " imports " + *importModuleName + "."
+						   + *importExportName + ", which isn't exported";
+				return false;
+			}
+
+			const Export& export_ = exportModule.exports[*exportIndex];
+			if(export_.kind != import.kind
+			   || !isExportCompatible(exportModule, export_.index, module, import))
+			{
+				outError = "module " + groupModule.name + " imports " + *importModuleName + "."
+						   + *importExportName + " as a " + getKindName(import.kind)
+						   + " with an incompatible type";
+				return false;
+			}
+
+			resolvedImports[moduleIndex].push_back({*exportModuleIndex, *exportIndex});
+		}
+
+		if(!moduleIndexByName.add(groupModule.name, moduleIndex))
+		{
+			outError = "the group contains more than one module named " + groupModule.name;
+			return false;
+		}
+		for(Uptr exportIndex = 0; exportIndex < module.exports.size(); ++exportIndex)
+		{ exportIndexByName[moduleIndex].add(module.exports[exportIndex].name, exportIndex); }
+	}
+
+	// The linked module's definitions of each kind follow all its imports of that kind.
+	Uptr nextDefIndexByKind[Uptr(ExternKind::exceptionType) + 1];
+	for(Uptr kindIndex = 0; kindIndex <= Uptr(ExternKind::exceptionType); ++kindIndex)
+	{ nextDefIndexByKind[kindIndex] = numUnresolvedImportsByKind[kindIndex]; }
+
+	std::vector<LinkedIndices> linkedIndices(groupModules.size());
+	std::vector<Uptr> startFunctionIndices;
+	HashMap<std::string, Uptr> linkedExportIndexByName;
+	for(Uptr moduleIndex = 0; moduleIndex < groupModules.size(); ++moduleIndex)
+	{
+		const LinkGroupModule& groupModule = groupModules[moduleIndex];
+		const Module& module = *groupModule.module;
+		LinkedIndices& indices = linkedIndices[moduleIndex];
+
+		indices.typeOffset = outModule.types.size();
+		indices.dataSegmentOffset = outModule.dataSegments.size();
+		indices.elemSegmentOffset = outModule.elemSegments.size();
+		outModule.types.insert(outModule.types.end(), module.types.begin(), module.types.end());
+
+		// Map the imports to the exports they're bound to, or add them to the linked module's
+		// imports.
+		for(Uptr importIndex = 0; importIndex < module.imports.size(); ++importIndex)
+		{
+			const KindAndIndex& import = module.imports[importIndex];
+			const ResolvedImport& resolvedImport = resolvedImports[moduleIndex][importIndex];
+			std::vector<Uptr>& kindIndices = indices.get(import.kind);
+			WAVM_ASSERT(kindIndices.size() == import.index);
+
+			if(resolvedImport.moduleIndex != unresolvedModuleIndex)
+			{
+				const Module& exportModule = *groupModules[resolvedImport.moduleIndex].module;
+				const Export& export_ = exportModule.exports[resolvedImport.exportIndex];
+				kindIndices.push_back(
+					linkedIndices[resolvedImport.moduleIndex].get(export_.kind)[export_.index]);
+				continue;
+			}
+
+			Uptr linkedImportIndex;
+			switch(import.kind)
+			{
+			case ExternKind::function: {
+				FunctionImport functionImport = module.functions.imports[import.index];
+				functionImport.type.index += indices.typeOffset;
+				linkedImportIndex = outModule.functions.imports.size();
+				outModule.functions.imports.push_back(functionImport);
+				break;
+			}
+#define ADD_IMPORT(kindName, indexSpace)                                                           \
+	case ExternKind::kindName:                                                                     \
+		linkedImportIndex = outModule.indexSpace.imports.size();                                   \
+		outModule.indexSpace.imports.push_back(module.indexSpace.imports[import.index]);           \
+		break;
+				ADD_IMPORT(table, tables)
+				ADD_IMPORT(memory, memories)
+				ADD_IMPORT(global, globals)
+				ADD_IMPORT(exceptionType, exceptionTypes)
+#undef ADD_IMPORT
+
+			case ExternKind::invalid:
+			default: WAVM_UNREACHABLE();
+			};
+			outModule.imports.push_back({import.kind, linkedImportIndex});
+			kindIndices.push_back(linkedImportIndex);
+		}
+
+		// Map the definitions to the linked module's definitions.
+		auto mapDefs = [&](ExternKind kind, Uptr numDefs) {
+			std::vector<Uptr>& kindIndices = indices.get(kind);
+			for(Uptr defIndex = 0; defIndex < numDefs; ++defIndex)
+			{ kindIndices.push_back(nextDefIndexByKind[Uptr(kind)]++); }
+		};
+		mapDefs(ExternKind::function, module.functions.defs.size());
+		mapDefs(ExternKind::table, module.tables.defs.size());
+		mapDefs(ExternKind::memory, module.memories.defs.size());
+		mapDefs(ExternKind::global, module.globals.defs.size());
+		mapDefs(ExternKind::exceptionType, module.exceptionTypes.defs.size());
+
+		for(const FunctionDef& functionDef : module.functions.defs)
+		{
+			FunctionDef linkedFunctionDef;
+			linkedFunctionDef.type.index = functionDef.type.index + indices.typeOffset;
+			linkedFunctionDef.nonParameterLocalTypes = functionDef.nonParameterLocalTypes;
+			linkedFunctionDef.branchTableTargetDepths = functionDef.branchTableTargetDepths;
+
+			Serialization::ArrayOutputStream codeStream;
+			OperatorEncoderStream encoder(codeStream);
+			CodeRelinker relinker(indices, encoder);
+			OperatorDecoderStream decoder(functionDef.code);
+			while(decoder) { decoder.decodeOp(relinker); };
+			linkedFunctionDef.code = codeStream.getBytes();
+
+			outModule.functions.defs.push_back(std::move(linkedFunctionDef));
+		}
+		for(const TableDef& tableDef : module.tables.defs)
+		{ outModule.tables.defs.push_back(tableDef); }
+		for(const MemoryDef& memoryDef : module.memories.defs)
+		{ outModule.memories.defs.push_back(memoryDef); }
+		for(const GlobalDef& globalDef : module.globals.defs)
+		{
+			outModule.globals.defs.push_back(
+				{globalDef.type, relinkInitializer(indices, globalDef.initializer)});
+		}
+		for(const ExceptionTypeDef& exceptionTypeDef : module.exceptionTypes.defs)
+		{ outModule.exceptionTypes.defs.push_back(exceptionTypeDef); }
+
+		for(const DataSegment& dataSegment : module.dataSegments)
+		{
+			DataSegment linkedDataSegment = dataSegment;
+			if(dataSegment.isActive)
+			{
+				linkedDataSegment.memoryIndex = indices.memories[dataSegment.memoryIndex];
+				linkedDataSegment.baseOffset = relinkInitializer(indices, dataSegment.baseOffset);
+			}
+			outModule.dataSegments.push_back(std::move(linkedDataSegment));
+		}
+		for(const ElemSegment& elemSegment : module.elemSegments)
+		{
+			ElemSegment linkedElemSegment = elemSegment;
+			if(elemSegment.type == ElemSegment::Type::active)
+			{
+				linkedElemSegment.tableIndex = indices.tables[elemSegment.tableIndex];
+				linkedElemSegment.baseOffset = relinkInitializer(indices, elemSegment.baseOffset);
+			}
+
+			auto contents = std::make_shared<ElemSegment::Contents>(*elemSegment.contents);
+			for(Uptr& elemIndex : contents->elemIndices)
+			{ elemIndex = indices.get(contents->externKind)[elemIndex]; }
+			for(ElemExpr& elemExpr : contents->elemExprs)
+			{
+				if(elemExpr.type == ElemExpr::Type::ref_func)
+				{ elemExpr.index = indices.functions[elemExpr.index]; }
+			}
+			linkedElemSegment.contents = contents;
+
+			outModule.elemSegments.push_back(std::move(linkedElemSegment));
+		}
+
+		if(groupModule.exportsAreVisible)
+		{
+			for(const Export& export_ : module.exports)
+			{
+				if(!linkedExportIndexByName.add(export_.name, outModule.exports.size()))
+				{
+					outError = "module " + groupModule.name + " exports " + export_.name
+							   + ", which is also exported by an earlier module in the group";
+					return false;
+				}
+				outModule.exports.push_back(
+					{export_.name, export_.kind, indices.get(export_.kind)[export_.index]});
+			}
+		}
+
+		if(module.startFunctionIndex != UINTPTR_MAX)
+		{ startFunctionIndices.push_back(indices.functions[module.startFunctionIndex]); }
+	}
+
+	// If more than one module has a start function, define a start function that calls them in
+	// order.
+	if(startFunctionIndices.size() == 1) { outModule.startFunctionIndex = startFunctionIndices[0]; }
+	else if(startFunctionIndices.size() > 1)
+	{
+		FunctionDef startFunctionDef;
+		startFunctionDef.type.index = outModule.types.size();
+		outModule.types.push_back(FunctionType());
+
+		Serialization::ArrayOutputStream codeStream;
+		OperatorEncoderStream encoder(codeStream);
+		for(Uptr startFunctionIndex : startFunctionIndices)
+		{ encoder.call({startFunctionIndex}); }
+		encoder.end();
+		startFunctionDef.code = codeStream.getBytes();
+
+		outModule.startFunctionIndex = outModule.functions.size();
+		outModule.functions.defs.push_back(std::move(startFunctionDef));
+	}
+
+	return true;
+}
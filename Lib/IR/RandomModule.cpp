@@ -1142,7 +1142,7 @@ void IR::generateValidModule(Module& module, RandomStream& random)
 		if(!module.memories.size() || random.get(1))
 		{
 			module.dataSegments.push_back(
-				{false, UINTPTR_MAX, {}, std::make_shared<std::vector<U8>>(std::move(bytes))});
+				{false, UINTPTR_MAX, {}, std::make_shared<DataSegmentBytes>(std::move(bytes))});
 		}
 		else
 		{
@@ -1152,7 +1152,7 @@ void IR::generateValidModule(Module& module, RandomStream& random)
 				{true,
 				 memoryIndex,
 				 generateInitializerExpression(module, random, asValueType(memoryType.indexType)),
-				 std::make_shared<std::vector<U8>>(std::move(bytes))});
+				 std::make_shared<DataSegmentBytes>(std::move(bytes))});
 		}
 	};
 
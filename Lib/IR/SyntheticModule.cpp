@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/IR/RandomModule.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Validate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Serialization.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// A small PRNG (SplitMix64), so the generated module only depends on the seed.
+struct SyntheticRandom
+{
+	SyntheticRandom(U64 seed) : state(seed) {}
+
+	U64 get64()
+	{
+		U64 result = (state += 0x9e3779b97f4a7c15);
+		result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9;
+		result = (result ^ (result >> 27)) * 0x94d049bb133111eb;
+		return result ^ (result >> 31);
+	}
+
+	// Returns a value between 0 and maxResult, inclusive.
+	Uptr get(Uptr maxResult) { return Uptr(get64() % (U64(maxResult) + 1)); }
+
+	// Returns a value in [0, 1).
+	F64 getUnit() { return F64(get64() >> 11) / F64(U64(1) << 53); }
+
+private:
+	U64 state;
+};
+
+using CodeStream = CodeValidationProxyStream<OperatorEncoderStream>;
+
+// The locals of every generated function: the i32 parameter that accumulates the function's
+// result, and a v128 accumulator for the SIMD operations.
+static constexpr Uptr accumulatorLocalIndex = 0;
+static constexpr Uptr simdAccumulatorLocalIndex = 1;
+
+static Uptr getFunctionLevel(const SyntheticModuleConfig& config, Uptr functionIndex)
+{
+	return functionIndex * config.callGraphDepth / config.numFunctions;
+}
+
+static void generateScalarOp(CodeStream& codeStream, SyntheticRandom& random)
+{
+	codeStream.local_get({accumulatorLocalIndex});
+	codeStream.i32_const({I32(random.get64())});
+	switch(random.get(4))
+	{
+	case 0: codeStream.i32_add(); break;
+	case 1: codeStream.i32_sub(); break;
+	case 2: codeStream.i32_mul(); break;
+	case 3: codeStream.i32_xor_(); break;
+	case 4: codeStream.i32_rotl(); break;
+	default: WAVM_UNREACHABLE();
+	};
+	codeStream.local_set({accumulatorLocalIndex});
+}
+
+static void generateMemoryOp(CodeStream& codeStream, SyntheticRandom& random, U32 addressMask)
+{
+	// Mask the address so the access is always in bounds.
+	codeStream.local_get({accumulatorLocalIndex});
+	codeStream.i32_const({I32(addressMask)});
+	codeStream.i32_and_();
+	if(random.get(1))
+	{
+		codeStream.i32_load({{2, 0, 0}});
+		codeStream.local_get({accumulatorLocalIndex});
+		codeStream.i32_add();
+		codeStream.local_set({accumulatorLocalIndex});
+	}
+	else
+	{
+		codeStream.local_get({accumulatorLocalIndex});
+		codeStream.i32_store({{2, 0, 0}});
+	}
+}
+
+static void generateSIMDOp(CodeStream& codeStream, SyntheticRandom& random)
+{
+	codeStream.local_get({simdAccumulatorLocalIndex});
+	codeStream.local_get({accumulatorLocalIndex});
+	codeStream.i32x4_splat();
+	if(random.get(1)) { codeStream.i32x4_add(); }
+	else
+	{
+		codeStream.i32x4_mul();
+	}
+	codeStream.local_set({simdAccumulatorLocalIndex});
+}
+
+static void generateFunction(const SyntheticModuleConfig& config,
+							 ModuleValidationState& moduleValidationState,
+							 SyntheticRandom& random,
+							 U32 addressMask,
+							 Uptr functionIndex,
+							 FunctionDef& functionDef)
+{
+	// Functions only call functions in the next level of the call graph.
+	const Uptr level = getFunctionLevel(config, functionIndex);
+	Uptr firstCalleeIndex = functionIndex + 1;
+	while(firstCalleeIndex < config.numFunctions
+		  && getFunctionLevel(config, firstCalleeIndex) == level)
+	{ ++firstCalleeIndex; }
+	Uptr endCalleeIndex = firstCalleeIndex;
+	while(endCalleeIndex < config.numFunctions
+		  && getFunctionLevel(config, endCalleeIndex) == level + 1)
+	{ ++endCalleeIndex; }
+	const Uptr numCallees = endCalleeIndex - firstCalleeIndex;
+
+	Serialization::ArrayOutputStream codeByteStream;
+	OperatorEncoderStream opEncoder(codeByteStream);
+	CodeStream codeStream(moduleValidationState, functionDef, opEncoder);
+
+	for(Uptr opIndex = 0; opIndex < config.numOperationsPerFunction; ++opIndex)
+	{
+		F64 choice = random.getUnit();
+		if(numCallees && (choice -= config.callDensity) < 0.0)
+		{
+			codeStream.local_get({accumulatorLocalIndex});
+			codeStream.call({firstCalleeIndex + random.get(numCallees - 1)});
+			codeStream.local_set({accumulatorLocalIndex});
+		}
+		else if(numCallees && (choice -= config.callIndirectDensity) < 0.0)
+		{
+			// The table contains every function at its own index.
+			codeStream.local_get({accumulatorLocalIndex});
+			codeStream.i32_const({I32(firstCalleeIndex + random.get(numCallees - 1))});
+			codeStream.call_indirect({{0}, 0});
+			codeStream.local_set({accumulatorLocalIndex});
+		}
+		else if((choice -= config.memoryAccessDensity) < 0.0)
+		{
+			generateMemoryOp(codeStream, random, addressMask);
+		}
+		else if((choice -= config.simdDensity) < 0.0)
+		{
+			generateSIMDOp(codeStream, random);
+		}
+		else
+		{
+			generateScalarOp(codeStream, random);
+		}
+	}
+
+	// Fold the SIMD accumulator into the result, so it isn't dead code.
+	codeStream.local_get({accumulatorLocalIndex});
+	if(config.simdDensity > 0.0)
+	{
+		codeStream.local_get({simdAccumulatorLocalIndex});
+		codeStream.i32x4_extract_lane({0});
+		codeStream.i32_add();
+	}
+	codeStream.end();
+	codeStream.finishValidation();
+
+	functionDef.code = codeByteStream.getBytes();
+}
+
+void IR::generateSyntheticModule(Module& module, const SyntheticModuleConfig& config)
+{
+	WAVM_ASSERT(config.numFunctions > 0);
+	WAVM_ASSERT(config.callGraphDepth > 0);
+	WAVM_ASSERT(config.simdDensity == 0.0 || module.featureSpec.simd);
+
+	SyntheticRandom random(config.seed);
+
+	// Every function has the type (i32) -> i32.
+	module.types.push_back(FunctionType({ValueType::i32}, {ValueType::i32}));
+
+	// Size the memory to a power of two that fits the data segments, so masking an address with
+	// addressMask keeps it in bounds.
+	U64 numMemoryPages = 1;
+	while(numMemoryPages * IR::numBytesPerPage < config.numDataSegmentBytes)
+	{ numMemoryPages *= 2; }
+	WAVM_ASSERT(numMemoryPages <= IR::maxMemory32Pages / 2);
+	const U32 addressMask = U32(numMemoryPages * IR::numBytesPerPage - 1) & ~U32(3);
+	module.memories.defs.push_back(
+		{MemoryType(false, IndexType::i32, SizeConstraints{numMemoryPages, numMemoryPages})});
+
+	// Split the data into 64KiB active segments.
+	static constexpr Uptr maxDataSegmentBytes = 65536;
+	for(Uptr segmentOffset = 0; segmentOffset < config.numDataSegmentBytes;
+		segmentOffset += maxDataSegmentBytes)
+	{
+		std::vector<U8> bytes(
+			std::min(maxDataSegmentBytes, config.numDataSegmentBytes - segmentOffset));
+		for(U8& byte : bytes) { byte = U8(random.get64()); }
+		module.dataSegments.push_back({true,
+									   0,
+									   InitializerExpression(I32(segmentOffset)),
+									   std::make_shared<DataSegmentBytes>(std::move(bytes))});
+	}
+
+	// Declare the functions, and export the functions at the root of the call graph.
+	for(Uptr functionIndex = 0; functionIndex < config.numFunctions; ++functionIndex)
+	{
+		FunctionDef functionDef;
+		functionDef.type.index = 0;
+		if(config.simdDensity > 0.0)
+		{ functionDef.nonParameterLocalTypes.push_back(ValueType::v128); }
+		module.functions.defs.push_back(std::move(functionDef));
+
+		if(getFunctionLevel(config, functionIndex) == 0)
+		{
+			module.exports.push_back(
+				{"func" + std::to_string(functionIndex), ExternKind::function, functionIndex});
+		}
+	}
+
+	// Create a table that contains every function at its own index, for call_indirect.
+	module.tables.defs.push_back(
+		{TableType(ReferenceType::funcref,
+				   false,
+				   IndexType::i32,
+				   SizeConstraints{config.numFunctions, config.numFunctions})});
+	auto elemContents = std::make_shared<ElemSegment::Contents>();
+	elemContents->encoding = ElemSegment::Encoding::index;
+	elemContents->externKind = ExternKind::function;
+	for(Uptr functionIndex = 0; functionIndex < config.numFunctions; ++functionIndex)
+	{ elemContents->elemIndices.push_back(functionIndex); }
+	module.elemSegments.push_back(
+		{ElemSegment::Type::active, 0, InitializerExpression(I32(0)), std::move(elemContents)});
+
+	std::shared_ptr<ModuleValidationState> moduleValidationState
+		= createModuleValidationState(module);
+	validatePreCodeSections(*moduleValidationState);
+
+	for(Uptr functionIndex = 0; functionIndex < config.numFunctions; ++functionIndex)
+	{
+		generateFunction(config,
+						 *moduleValidationState,
+						 random,
+						 addressMask,
+						 functionIndex,
+						 module.functions.defs[functionIndex]);
+	}
+
+	validatePostCodeSections(*moduleValidationState);
+}
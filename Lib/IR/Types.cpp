@@ -29,7 +29,8 @@ struct FunctionTypeHashPolicy
 {
 	static bool areKeysEqual(FunctionType left, FunctionType right)
 	{
-		return left.params() == right.params() && left.results() == right.results();
+		return left.params() == right.params() && left.results() == right.results()
+			   && left.callingConvention() == right.callingConvention();
 	}
 	static Uptr getKeyHash(FunctionType functionType) { return functionType.getHash(); }
 };
@@ -111,11 +112,21 @@ const TypeTuple::Impl* IR::TypeTuple::getUniqueImpl(Uptr numElems, const ValueTy
 	}
 }
 
+// The IDs of the statically allocated empty function types. The IDs of other function types are
+// allocated after these.
+enum
+{
+	emptyWASMFunctionTypeId,
+	emptyIntrinsicFunctionTypeId,
+	numStaticFunctionTypeIds
+};
+
 struct GlobalUniqueFunctionTypes
 {
 	Platform::Mutex mutex;
 	HashSet<FunctionType, FunctionTypeHashPolicy> set;
 	std::vector<void*> impls;
+	Uptr nextId{numStaticFunctionTypeIds};
 
 	~GlobalUniqueFunctionTypes()
 	{
@@ -133,10 +144,11 @@ private:
 	GlobalUniqueFunctionTypes() {}
 };
 
-IR::FunctionType::Impl::Impl(TypeTuple inResults,
+IR::FunctionType::Impl::Impl(Uptr inId,
+							 TypeTuple inResults,
 							 TypeTuple inParams,
 							 CallingConvention inCallingConvention)
-: results(inResults), params(inParams), callingConvention(inCallingConvention)
+: id(inId), results(inResults), params(inParams), callingConvention(inCallingConvention)
 {
 	hash = Hash<Uptr>()(results.getHash(), params.getHash());
 	hash = Hash<Uptr>()(hash, Uptr(callingConvention));
@@ -148,18 +160,20 @@ const FunctionType::Impl* IR::FunctionType::getUniqueImpl(TypeTuple results,
 {
 	if(results.size() == 0 && params.size() == 0 && callingConvention == CallingConvention::wasm)
 	{
-		static Impl emptyImpl{TypeTuple(), TypeTuple(), CallingConvention::wasm};
+		static Impl emptyImpl{
+			emptyWASMFunctionTypeId, TypeTuple(), TypeTuple(), CallingConvention::wasm};
 		return &emptyImpl;
 	}
 	else if(results.size() == 0 && params.size() == 0
 			&& callingConvention == CallingConvention::intrinsic)
 	{
-		static Impl emptyImpl{TypeTuple(), TypeTuple(), CallingConvention::intrinsic};
+		static Impl emptyImpl{
+			emptyIntrinsicFunctionTypeId, TypeTuple(), TypeTuple(), CallingConvention::intrinsic};
 		return &emptyImpl;
 	}
 	else
 	{
-		Impl localImpl(results, params, callingConvention);
+		Impl localImpl(UINTPTR_MAX, results, params, callingConvention);
 
 		GlobalUniqueFunctionTypes& globalUniqueFunctionTypes = GlobalUniqueFunctionTypes::get();
 		Platform::Mutex::Lock lock(globalUniqueFunctionTypes.mutex);
@@ -170,6 +184,7 @@ const FunctionType::Impl* IR::FunctionType::getUniqueImpl(TypeTuple results,
 		else
 		{
 			Impl* globalImpl = new(malloc(sizeof(Impl))) Impl(localImpl);
+			globalImpl->id = globalUniqueFunctionTypes.nextId++;
 			globalUniqueFunctionTypes.set.addOrFail(FunctionType(globalImpl));
 			globalUniqueFunctionTypes.impls.push_back(globalImpl);
 			return globalImpl;
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 #include "WAVM/IR/FeatureSpec.h"
@@ -17,6 +18,8 @@
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashSet.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
@@ -495,9 +498,11 @@ struct FunctionValidationContext
 
 		// Validate that each target has the same number of parameters as the default target, and
 		// that the parameters for each target match the arguments provided.
-		WAVM_ASSERT(imm.branchTableIndex < functionDef.branchTables.size());
-		const std::vector<Uptr>& targetDepths = functionDef.branchTables[imm.branchTableIndex];
-		for(Uptr targetIndex = 0; targetIndex < targetDepths.size(); ++targetIndex)
+		WAVM_ASSERT(imm.firstTargetDepthIndex + imm.numTargetDepths
+					<= functionDef.branchTableTargetDepths.size());
+		const U32* targetDepths
+			= functionDef.branchTableTargetDepths.data() + imm.firstTargetDepthIndex;
+		for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
 		{
 			const ControlContext& branchTarget = getBranchTargetByDepth(targetDepths[targetIndex]);
 			const TypeTuple targetParams = branchTarget.params;
@@ -672,6 +677,28 @@ struct FunctionValidationContext
 		popAndValidateTypeTuple("call_indirect arguments", calleeType.params());
 		pushOperandTuple(calleeType.results());
 	}
+	void return_call(FunctionImm imm)
+	{
+		VALIDATE_FEATURE("return_call", tailCalls);
+		FunctionType calleeType = validateFunctionIndex(module, imm.functionIndex);
+		popAndValidateTypeTuple("return_call arguments", calleeType.params());
+		validateTailCallResults("return_call", calleeType);
+		enterUnreachable();
+	}
+	void return_call_indirect(CallIndirectImm imm)
+	{
+		VALIDATE_FEATURE("return_call_indirect", tailCalls);
+		VALIDATE_INDEX(imm.tableIndex, module.tables.size());
+		const TableType& tableType = module.tables.getType(imm.tableIndex);
+		VALIDATE_UNLESS("return_call_indirect requires a table element type of funcref: ",
+						tableType.elementType != ReferenceType::funcref);
+		FunctionType calleeType = validateFunctionType(module, imm.type);
+		popAndValidateOperand("return_call_indirect function index",
+							  asValueType(tableType.indexType));
+		popAndValidateTypeTuple("return_call_indirect arguments", calleeType.params());
+		validateTailCallResults("return_call_indirect", calleeType);
+		enterUnreachable();
+	}
 
 	void validateImm(NoImm) {}
 
@@ -992,6 +1019,19 @@ private:
 		}
 	}
 
+	// A tail call returns the callee's results from the calling function, so the callee must have
+	// the same result types as the calling function.
+	void validateTailCallResults(const char* context, FunctionType calleeType)
+	{
+		if(calleeType.results() != functionType.results())
+		{
+			throw ValidationException(std::string(context) + " callee results "
+									  + asString(calleeType.results())
+									  + " don't match the function results "
+									  + asString(functionType.results()));
+		}
+	}
+
 	void pushOperand(ValueType type) { stack.push_back(type); }
 	void pushOperandTuple(TypeTuple typeTuple)
 	{
@@ -1291,15 +1331,106 @@ void IR::validateDataSegments(ModuleValidationState& state)
 	}
 }
 
-void IR::validateCodeSection(ModuleValidationState& state)
+static void validateFunctionDef(ModuleValidationState& state, const FunctionDef& functionDef)
 {
-	const Module& module = state.module;
-	for(const auto& functionDef : module.functions.defs)
+	CodeValidationStream validationStream(state, functionDef);
+	OperatorDecoderStream operatorDecoderStream(functionDef.code);
+	while(operatorDecoderStream) { operatorDecoderStream.decodeOp(validationStream); }
+}
+
+// Each validation thread is given at least this many function definitions, so small modules don't
+// pay for the threads.
+static constexpr Uptr minFunctionDefsPerValidationThread = 256;
+
+// The number of function definitions that a validation thread takes from the shared state at once.
+static constexpr Uptr numFunctionDefsPerValidationBatch = 16;
+
+namespace {
+	struct ParallelValidationState
 	{
-		CodeValidationStream validationStream(state, functionDef);
-		OperatorDecoderStream operatorDecoderStream(functionDef.code);
-		while(operatorDecoderStream) { operatorDecoderStream.decodeOp(validationStream); }
+		ModuleValidationState& moduleState;
+
+		Platform::Mutex mutex;
+		Uptr nextFunctionDefIndex = 0;
+
+		// The lowest index of a function definition that failed validation, and its exception.
+		Uptr failedFunctionDefIndex = UINTPTR_MAX;
+		std::string failureMessage;
+
+		ParallelValidationState(ModuleValidationState& inModuleState) : moduleState(inModuleState)
+		{
+		}
+	};
+}
+
+static I64 parallelValidationThreadMain(void* sharedStateVoid)
+{
+	ParallelValidationState& state = *(ParallelValidationState*)sharedStateVoid;
+	const std::vector<FunctionDef>& functionDefs = state.moduleState.module.functions.defs;
+	while(true)
+	{
+		// Take the next batch of function definitions. Function definitions after one that has
+		// already failed don't need to be validated, since the lowest failing index is reported.
+		Uptr beginIndex;
+		Uptr endIndex;
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			beginIndex = state.nextFunctionDefIndex;
+			endIndex = std::min(beginIndex + numFunctionDefsPerValidationBatch,
+								std::min(functionDefs.size(), state.failedFunctionDefIndex));
+			if(beginIndex >= endIndex) { break; }
+			state.nextFunctionDefIndex = endIndex;
+		}
+
+		for(Uptr functionDefIndex = beginIndex; functionDefIndex < endIndex; ++functionDefIndex)
+		{
+			try
+			{
+				validateFunctionDef(state.moduleState, functionDefs[functionDefIndex]);
+			}
+			catch(ValidationException& exception)
+			{
+				Platform::Mutex::Lock lock(state.mutex);
+				if(functionDefIndex < state.failedFunctionDefIndex)
+				{
+					state.failedFunctionDefIndex = functionDefIndex;
+					state.failureMessage = std::move(exception.message);
+				}
+				break;
+			}
+		}
 	}
+	return 0;
+}
+
+void IR::validateCodeSection(ModuleValidationState& state)
+{
+	const std::vector<FunctionDef>& functionDefs = state.module.functions.defs;
+
+	// Function definitions only depend on the module-level declarations, so they can be validated
+	// in parallel on the calling thread and one additional thread for each hardware thread.
+	const Uptr numThreads
+		= std::max(Uptr(1),
+				   std::min(Platform::getNumberOfHardwareThreads(),
+							functionDefs.size() / minFunctionDefsPerValidationThread));
+	if(numThreads == 1)
+	{
+		for(const FunctionDef& functionDef : functionDefs)
+		{ validateFunctionDef(state, functionDef); }
+		return;
+	}
+
+	ParallelValidationState parallelState(state);
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+	{ threads.push_back(Platform::createThread(0, parallelValidationThreadMain, &parallelState)); }
+	parallelValidationThreadMain(&parallelState);
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+	// Report the error for the lowest failing function definition, so the error doesn't depend on
+	// how the function definitions were divided between the threads.
+	if(parallelState.failedFunctionDefIndex != UINTPTR_MAX)
+	{ throw ValidationException(std::move(parallelState.failureMessage)); }
 }
 
 namespace WAVM { namespace IR {
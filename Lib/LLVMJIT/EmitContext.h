@@ -48,6 +48,10 @@ namespace WAVM { namespace LLVMJIT {
 
 		llvm::Value* contextPointerVariable;
 
+		// The number of times reloadMemoryBases has been called, which invalidates any values
+		// computed from the previously loaded memory base and end addresses.
+		Uptr numMemoryBaseReloads = 0;
+
 		struct MemoryInfo
 		{
 			llvm::Value* basePointerVariable;
@@ -55,9 +59,29 @@ namespace WAVM { namespace LLVMJIT {
 		};
 		std::vector<MemoryInfo> memoryInfos;
 
+		// Whether each memory is used by the code, and so needs its base pointer and end address
+		// reloaded when the context changes. If empty, all memories are used.
+		std::vector<bool> isMemoryUsed;
+
+		// If the code meters fuel, a variable that caches the context's remaining fuel. It is
+		// written back to the context before calls and returns, and reloaded after calls.
+		llvm::Value* fuelVariable = nullptr;
+
+		// If the code caches the stack pointer global in a variable, the variable and the offset
+		// of the global in ContextRuntimeData::globalData. Like the fuel, it is written back to the
+		// context before calls and returns, and reloaded after calls.
+		llvm::AllocaInst* stackPointerVariable = nullptr;
+		llvm::Constant* stackPointerGlobalOffset = nullptr;
+
 		struct TryContext
 		{
 			llvm::BasicBlock* unwindToBlock;
+
+			// The block that dispatches exceptions to the try's catch clauses, and the PHI in it
+			// that receives the exception pointer. Exceptions thrown directly inside the try (and
+			// not by a function it calls) branch to the dispatch block instead of unwinding.
+			llvm::BasicBlock* dispatchBlock;
+			llvm::PHINode* exceptionPointerPHI;
 		};
 		std::vector<TryContext> tryStack;
 
@@ -100,12 +124,14 @@ namespace WAVM { namespace LLVMJIT {
 
 		void reloadMemoryBases()
 		{
+			++numMemoryBaseReloads;
 			llvm::Value* compartmentAddress = getCompartmentAddress();
 
 			// Reload the memory base pointer and num reserved bytes values from the
 			// CompartmentRuntimeData.
 			for(Uptr memoryIndex = 0; memoryIndex < memoryOffsets.size(); ++memoryIndex)
 			{
+				if(isMemoryUsed.size() && !isMemoryUsed[memoryIndex]) { continue; }
 				MemoryInfo& memoryInfo = memoryInfos[memoryIndex];
 
 				llvm::Constant* memoryOffset = memoryOffsets[memoryIndex];
@@ -128,6 +154,45 @@ namespace WAVM { namespace LLVMJIT {
 			}
 		}
 
+		llvm::Value* getFuelPointer()
+		{
+			return irBuilder.CreateInBoundsGEP(
+				irBuilder.CreateLoad(contextPointerVariable),
+				{emitLiteral(llvmContext, Uptr(offsetof(Runtime::ContextRuntimeData, fuel)))});
+		}
+
+		void storeFuel()
+		{
+			storeToUntypedPointer(irBuilder.CreateLoad(fuelVariable), getFuelPointer(), sizeof(I64));
+		}
+
+		void reloadFuel()
+		{
+			irBuilder.CreateStore(
+				loadFromUntypedPointer(getFuelPointer(), llvmContext.i64Type, sizeof(I64)),
+				fuelVariable);
+		}
+
+		llvm::Value* getStackPointerGlobalPointer()
+		{
+			return irBuilder.CreateInBoundsGEP(irBuilder.CreateLoad(contextPointerVariable),
+											   {stackPointerGlobalOffset});
+		}
+
+		void storeStackPointer()
+		{
+			storeToUntypedPointer(irBuilder.CreateLoad(stackPointerVariable),
+								  getStackPointerGlobalPointer());
+		}
+
+		void reloadStackPointer()
+		{
+			irBuilder.CreateStore(
+				loadFromUntypedPointer(getStackPointerGlobalPointer(),
+									   stackPointerVariable->getAllocatedType()),
+				stackPointerVariable);
+		}
+
 		void initContextVariables(llvm::Value* initialContextPointer, llvm::Type* iptrType)
 		{
 			memoryInfos.resize(memoryOffsets.size());
@@ -152,7 +217,7 @@ namespace WAVM { namespace LLVMJIT {
 		// Emits a call to a WAVM intrinsic function.
 		ValueVector emitRuntimeIntrinsic(const char* intrinsicName,
 										 IR::FunctionType intrinsicType,
-										 const std::initializer_list<llvm::Value*>& args)
+										 llvm::ArrayRef<llvm::Value*> args)
 		{
 			WAVM_ASSERT(intrinsicType.callingConvention() == IR::CallingConvention::intrinsic);
 
@@ -172,11 +237,14 @@ namespace WAVM { namespace LLVMJIT {
 				intrinsicFunction, args, intrinsicType, getInnermostUnwindToBlock());
 		}
 
-		// Creates either a call or an invoke if the call occurs inside a try.
+		// Creates either a call or an invoke if the call occurs inside a try. If the callee is
+		// known to return the context it was passed, the caller keeps using its own context
+		// pointer instead of the returned one, and doesn't reload the memory base pointers.
 		ValueVector emitCallOrInvoke(llvm::Value* callee,
 									 llvm::ArrayRef<llvm::Value*> args,
 									 IR::FunctionType calleeType,
-									 llvm::BasicBlock* unwindToBlock = nullptr)
+									 llvm::BasicBlock* unwindToBlock = nullptr,
+									 bool calleeMaySwitchContext = true)
 		{
 			const IR::CallingConvention callingConvention = calleeType.callingConvention();
 
@@ -220,6 +288,16 @@ namespace WAVM { namespace LLVMJIT {
 				{ callArgsAlloca[1 + argIndex] = args[argIndex]; }
 			}
 
+			// Write the fuel back to the context so the callee can use it.
+			const bool callUsesFuel
+				= fuelVariable && callingConvention != IR::CallingConvention::c;
+			if(callUsesFuel) { storeFuel(); }
+
+			// Write the stack pointer back to the context so the callee can use it.
+			const bool callUsesStackPointer
+				= stackPointerVariable && callingConvention != IR::CallingConvention::c;
+			if(callUsesStackPointer) { storeStackPointer(); }
+
 			// Call or invoke the callee.
 			llvm::Value* returnValue;
 			llvm::FunctionType* llvmCalleeType = asLLVMType(llvmContext, calleeType);
@@ -248,42 +326,24 @@ namespace WAVM { namespace LLVMJIT {
 			switch(callingConvention)
 			{
 			case IR::CallingConvention::wasm: {
-				// Update the context variable.
-				auto newContextPointer = irBuilder.CreateExtractValue(returnValue, {0});
-				irBuilder.CreateStore(newContextPointer, contextPointerVariable);
-
-				// Reload the memory/table base pointers.
-				reloadMemoryBases();
-
-				if(areResultsReturnedDirectly(calleeType.results()))
+				// If the callee may switch the context, update the context variable, and reload
+				// the memory/table base pointers. Otherwise, the context pointer that was passed to
+				// the callee is still live after the call, and can stay in a callee-saved register
+				// instead of being reloaded from the returned struct.
+				if(calleeMaySwitchContext)
 				{
-					// If the results are returned directly, extract them from the returned struct.
-					for(Uptr resultIndex = 0; resultIndex < calleeType.results().size();
-						++resultIndex)
-					{
-						results.push_back(
-							irBuilder.CreateExtractValue(returnValue, {U32(1), U32(resultIndex)}));
-					}
+					auto newContextPointer = irBuilder.CreateExtractValue(returnValue, {0});
+					irBuilder.CreateStore(newContextPointer, contextPointerVariable);
+					reloadMemoryBases();
 				}
-				else
+
+				// Extract the results from the returned struct. If there are more results than
+				// the target can return in registers, LLVM returns them through a hidden pointer
+				// to the caller's stack frame.
+				for(Uptr resultIndex = 0; resultIndex < calleeType.results().size(); ++resultIndex)
 				{
-					// Otherwise, load them from the context.
-					Uptr resultOffset = 0;
-					for(IR::ValueType resultType : calleeType.results())
-					{
-						const U8 resultNumBytes = getTypeByteWidth(resultType);
-
-						resultOffset = (resultOffset + resultNumBytes - 1) & -I8(resultNumBytes);
-						WAVM_ASSERT(resultOffset < Runtime::maxThunkArgAndReturnBytes);
-
-						results.push_back(loadFromUntypedPointer(
-							irBuilder.CreateInBoundsGEP(newContextPointer,
-														{emitLiteral(llvmContext, resultOffset)}),
-							asLLVMType(llvmContext, resultType),
-							resultNumBytes));
-
-						resultOffset += resultNumBytes;
-					}
+					results.push_back(
+						irBuilder.CreateExtractValue(returnValue, {U32(1), U32(resultIndex)}));
 				}
 
 				break;
@@ -360,52 +420,65 @@ namespace WAVM { namespace LLVMJIT {
 			default: WAVM_UNREACHABLE();
 			};
 
+			// Reload the fuel that remains after the call.
+			if(callUsesFuel) { reloadFuel(); }
+			if(callUsesStackPointer) { reloadStackPointer(); }
+
 			return results;
 		}
 
 		void emitReturn(IR::TypeTuple resultTypes, const llvm::ArrayRef<llvm::Value*>& results)
 		{
+			if(fuelVariable) { storeFuel(); }
+			if(stackPointerVariable) { storeStackPointer(); }
+
 			llvm::Value* returnStruct = getZeroedLLVMReturnStruct(llvmContext, resultTypes);
 			returnStruct = irBuilder.CreateInsertValue(
 				returnStruct, irBuilder.CreateLoad(contextPointerVariable), {U32(0)});
 
+			// Insert the results into the return struct.
 			WAVM_ASSERT(resultTypes.size() == results.size());
-			if(areResultsReturnedDirectly(resultTypes))
+			for(Uptr resultIndex = 0; resultIndex < results.size(); ++resultIndex)
 			{
-				// If the results are returned directly, insert them into the return struct.
-				for(Uptr resultIndex = 0; resultIndex < results.size(); ++resultIndex)
-				{
-					llvm::Value* result = results[resultIndex];
-					returnStruct = irBuilder.CreateInsertValue(
-						returnStruct, result, {U32(1), U32(resultIndex)});
-				}
-			}
-			else
-			{
-				// Otherwise, store them in the context.
-				Uptr resultOffset = 0;
-				for(Uptr resultIndex = 0; resultIndex < results.size(); ++resultIndex)
-				{
-					const IR::ValueType resultType = resultTypes[resultIndex];
-					const U8 resultNumBytes = IR::getTypeByteWidth(resultType);
-
-					resultOffset = (resultOffset + resultNumBytes - 1) & -I8(resultNumBytes);
-					WAVM_ASSERT(resultOffset < Runtime::maxThunkArgAndReturnBytes);
-
-					irBuilder.CreateStore(results[resultIndex],
-										  irBuilder.CreatePointerCast(
-											  irBuilder.CreateInBoundsGEP(
-												  irBuilder.CreateLoad(contextPointerVariable),
-												  {emitLiteral(llvmContext, resultOffset)}),
-											  asLLVMType(llvmContext, resultType)->getPointerTo()));
-
-					resultOffset += resultNumBytes;
-				}
+				returnStruct = irBuilder.CreateInsertValue(
+					returnStruct, results[resultIndex], {U32(1), U32(resultIndex)});
 			}
 
 			irBuilder.CreateRet(returnStruct);
 		}
 
+		// Emits a tail call to a WebAssembly function that returns the callee's context and results
+		// from the calling function, and terminates the current block. The callee must have the
+		// same results as the calling function.
+		void emitTailCall(llvm::Value* callee,
+						  llvm::ArrayRef<llvm::Value*> args,
+						  IR::FunctionType calleeType)
+		{
+			WAVM_ASSERT(calleeType.callingConvention() == IR::CallingConvention::wasm);
+
+			// Write the fuel and stack pointer back to the context for the callee, which returns
+			// them to this function's caller.
+			if(fuelVariable) { storeFuel(); }
+			if(stackPointerVariable) { storeStackPointer(); }
+
+			ValueVector callArgs;
+			callArgs.push_back(irBuilder.CreateLoad(contextPointerVariable));
+			callArgs.append(args.begin(), args.end());
+
+			// tailcc only guarantees that a call doesn't grow the stack if it is marked as a tail
+			// call, and before LLVM 13, musttail required the callee to have the caller's
+			// signature. Older versions of LLVM don't have tailcc, so the tail call is only a hint.
+			auto call
+				= irBuilder.CreateCall(asLLVMType(llvmContext, calleeType), callee, callArgs);
+			call->setCallingConv(asLLVMCallingConv(IR::CallingConvention::wasm));
+#if LLVM_VERSION_MAJOR >= 13
+			call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+#else
+			call->setTailCallKind(llvm::CallInst::TCK_Tail);
+#endif
+			irBuilder.CreateRet(call);
+		}
+
 		llvm::BasicBlock* getInnermostUnwindToBlock();
 
 	private:
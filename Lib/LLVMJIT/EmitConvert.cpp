@@ -193,33 +193,35 @@ llvm::Value* EmitFunctionContext::emitTruncFloatToInt(ValueType destType,
 													  Float maxBounds,
 													  llvm::Value* operand)
 {
+	auto invalidBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_invalid", function);
 	auto nanBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_nan", function);
-	auto notNaNBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_notNaN", function);
 	auto overflowBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_overflow", function);
-	auto noOverflowBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_noOverflow", function);
+	auto validBlock = llvm::BasicBlock::Create(llvmContext, "FPToInt_valid", function);
 
+	// Check for both NaN and overflow with a single branch: the unordered comparisons are true for
+	// a NaN operand. The cold block then determines which trap to raise.
+	auto isInvalid
+		= irBuilder.CreateOr(irBuilder.CreateFCmpUGE(operand, emitLiteral(llvmContext, maxBounds)),
+							 irBuilder.CreateFCmpULE(operand, emitLiteral(llvmContext, minBounds)));
+	irBuilder.CreateCondBr(
+		isInvalid, invalidBlock, validBlock, moduleContext.likelyFalseBranchWeights);
+
+	irBuilder.SetInsertPoint(invalidBlock);
 	auto isNaN = createFCmpWithWorkaround(irBuilder, llvm::CmpInst::FCMP_UNO, operand, operand);
-	irBuilder.CreateCondBr(isNaN, nanBlock, notNaNBlock, moduleContext.likelyFalseBranchWeights);
+	irBuilder.CreateCondBr(isNaN, nanBlock, overflowBlock);
 
 	irBuilder.SetInsertPoint(nanBlock);
 	emitRuntimeIntrinsic(
 		"invalidFloatOperationTrap", FunctionType({}, {}, IR::CallingConvention::intrinsic), {});
 	irBuilder.CreateUnreachable();
 
-	irBuilder.SetInsertPoint(notNaNBlock);
-	auto isOverflow
-		= irBuilder.CreateOr(irBuilder.CreateFCmpOGE(operand, emitLiteral(llvmContext, maxBounds)),
-							 irBuilder.CreateFCmpOLE(operand, emitLiteral(llvmContext, minBounds)));
-	irBuilder.CreateCondBr(
-		isOverflow, overflowBlock, noOverflowBlock, moduleContext.likelyFalseBranchWeights);
-
 	irBuilder.SetInsertPoint(overflowBlock);
 	emitRuntimeIntrinsic("divideByZeroOrIntegerOverflowTrap",
 						 FunctionType({}, {}, IR::CallingConvention::intrinsic),
 						 {});
 	irBuilder.CreateUnreachable();
 
-	irBuilder.SetInsertPoint(noOverflowBlock);
+	irBuilder.SetInsertPoint(validBlock);
 	return isSigned ? irBuilder.CreateFPToSI(operand, asLLVMType(llvmContext, destType))
 					: irBuilder.CreateFPToUI(operand, asLLVMType(llvmContext, destType));
 }
@@ -266,6 +268,13 @@ llvm::Value* EmitFunctionContext::emitTruncFloatToIntSat(llvm::Type* destType,
 														 Int maxIntBounds,
 														 llvm::Value* operand)
 {
+#if LLVM_VERSION_MAJOR >= 12
+	// LLVM's saturating conversion intrinsics have the same semantics as the trunc_sat operators,
+	// and are lowered to the best sequence for the target.
+	return callLLVMIntrinsic({destType, operand->getType()},
+							 isSigned ? llvm::Intrinsic::fptosi_sat : llvm::Intrinsic::fptoui_sat,
+							 {operand});
+#else
 	llvm::Value* result = isSigned ? irBuilder.CreateFPToSI(operand, destType)
 								   : irBuilder.CreateFPToUI(operand, destType);
 
@@ -283,6 +292,7 @@ llvm::Value* EmitFunctionContext::emitTruncFloatToIntSat(llvm::Type* destType,
 		result);
 
 	return result;
+#endif
 }
 
 EMIT_UNARY_OP(i32_trunc_sat_f32_s,
@@ -360,6 +370,14 @@ llvm::Value* EmitFunctionContext::emitTruncVectorFloatToIntSat(llvm::Type* destT
 															   Int nanResult,
 															   llvm::Value* operand)
 {
+#if LLVM_VERSION_MAJOR >= 12
+	// The saturating conversion intrinsics convert NaN lanes to 0, which is the NaN result of all
+	// the vector trunc_sat operators.
+	WAVM_ASSERT(nanResult == 0);
+	return callLLVMIntrinsic({destType, operand->getType()},
+							 isSigned ? llvm::Intrinsic::fptosi_sat : llvm::Intrinsic::fptoui_sat,
+							 {operand});
+#else
 	auto result = isSigned ? irBuilder.CreateFPToSI(operand, destType)
 						   : irBuilder.CreateFPToUI(operand, destType);
 
@@ -381,6 +399,7 @@ llvm::Value* EmitFunctionContext::emitTruncVectorFloatToIntSat(llvm::Type* destT
 		irBuilder.CreateVectorSplat(numElements, emitLiteral(llvmContext, nanResult)),
 		result);
 	return result;
+#endif
 }
 
 EMIT_UNARY_OP(
@@ -521,6 +540,30 @@ EMIT_SIMD_EXTEND(i64x2_extend_high_i32x4_s, llvmContext.i32x4Type, 2, sext)
 EMIT_SIMD_EXTEND(i64x2_extend_low_i32x4_u, llvmContext.i32x4Type, 0, zext)
 EMIT_SIMD_EXTEND(i64x2_extend_high_i32x4_u, llvmContext.i32x4Type, 2, zext)
 
+llvm::Value* EmitFunctionContext::emitReduceAddToI32(llvm::Value* vector)
+{
+	auto vectorType = llvm::cast<FixedVectorType>(vector->getType());
+	if(moduleContext.targetArch == llvm::Triple::aarch64)
+	{
+		// addv doesn't have a form for 64-bit lanes, but uaddv of v2i64 is lowered to addp.
+		llvm::Type* resultType
+			= vectorType->getScalarSizeInBits() == 64 ? llvmContext.i64Type : llvmContext.i32Type;
+		return irBuilder.CreateZExtOrTrunc(
+			callLLVMIntrinsic(
+				{resultType, vectorType}, llvm::Intrinsic::aarch64_neon_uaddv, {vector}),
+			llvmContext.i32Type);
+	}
+	else
+	{
+		return irBuilder.CreateZExtOrTrunc(
+			callLLVMIntrinsic({vectorType}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {vector}),
+			llvmContext.i32Type);
+	}
+}
+
+// On x86, the bitmask operators are lowered to movmsk instructions, since LLVM versions before 13
+// expand the bitcast of a vector of i1 to a sequence of scalar operations for some lane types. On
+// other targets, each lane's sign is masked to a distinct bit, and the lanes are added together.
 void EmitFunctionContext::i8x16_bitmask(NoImm)
 {
 	auto i8x16Operand = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
@@ -528,10 +571,7 @@ void EmitFunctionContext::i8x16_bitmask(NoImm)
 		i8x16Operand, llvm::ConstantVector::getNullValue(llvmContext.i8x16Type));
 	if(moduleContext.targetArch == llvm::Triple::x86_64
 	   || moduleContext.targetArch == llvm::Triple::x86)
-	{
-		push(irBuilder.CreateZExt(irBuilder.CreateBitCast(i1x16Mask, llvmContext.i16Type),
-								  llvmContext.i32Type));
-	}
+	{ push(callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_pmovmskb_128, {i8x16Operand})); }
 	else
 	{
 		auto i8x16Mask = irBuilder.CreateSExt(i1x16Mask, llvmContext.i8x16Type);
@@ -568,13 +608,9 @@ void EmitFunctionContext::i8x16_bitmask(NoImm)
 			i8x16OrthogonalBitMask,
 			llvm::UndefValue::get(llvmContext.i8x16Type),
 			llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>{8, 9, 10, 11, 12, 13, 14, 15});
-		auto i8CombinedBitMaskA = callLLVMIntrinsic(
-			{llvmContext.i8x8Type}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {i8x8OriginalBitMaskA});
-		auto i8CombinedBitMaskB = callLLVMIntrinsic(
-			{llvmContext.i8x8Type}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {i8x8OriginalBitMaskB});
 		auto i32CombinedBitMask = irBuilder.CreateOr(
-			irBuilder.CreateZExt(i8CombinedBitMaskA, llvmContext.i32Type),
-			irBuilder.CreateShl(irBuilder.CreateZExt(i8CombinedBitMaskB, llvmContext.i32Type),
+			emitReduceAddToI32(i8x8OriginalBitMaskA),
+			irBuilder.CreateShl(emitReduceAddToI32(i8x8OriginalBitMaskB),
 								emitLiteral(llvmContext, U32(8))));
 		push(i32CombinedBitMask);
 	}
@@ -588,8 +624,13 @@ void EmitFunctionContext::i16x8_bitmask(NoImm)
 	if(moduleContext.targetArch == llvm::Triple::x86_64
 	   || moduleContext.targetArch == llvm::Triple::x86)
 	{
-		push(irBuilder.CreateZExt(irBuilder.CreateBitCast(i1x8Mask, llvmContext.i8Type),
-								  llvmContext.i32Type));
+		// Narrow the lanes to bytes with signed saturation, which preserves their signs, then take
+		// the mask of the low 8 bytes.
+		auto i8x16Narrowed = callLLVMIntrinsic(
+			{}, llvm::Intrinsic::x86_sse2_packsswb_128, {i8x16Operand, i8x16Operand});
+		push(irBuilder.CreateAnd(
+			callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_pmovmskb_128, {i8x16Narrowed}),
+			emitLiteral(llvmContext, U32(0xff))));
 	}
 	else
 	{
@@ -611,9 +652,7 @@ void EmitFunctionContext::i16x8_bitmask(NoImm)
 																					 constant32,
 																					 constant64,
 																					 constant128}));
-		auto i16CombinedBitMask = callLLVMIntrinsic(
-			{llvmContext.i16x8Type}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {i16x8OrthogonalBitMask});
-		push(irBuilder.CreateZExt(i16CombinedBitMask, llvmContext.i32Type));
+		push(emitReduceAddToI32(i16x8OrthogonalBitMask));
 	}
 }
 
@@ -625,9 +664,9 @@ void EmitFunctionContext::i32x4_bitmask(NoImm)
 	if(moduleContext.targetArch == llvm::Triple::x86_64
 	   || moduleContext.targetArch == llvm::Triple::x86)
 	{
-		push(irBuilder.CreateZExt(
-			irBuilder.CreateBitCast(i1x4Mask, llvm::IntegerType::get(llvmContext, 4)),
-			llvmContext.i32Type));
+		push(callLLVMIntrinsic({},
+							   llvm::Intrinsic::x86_sse_movmsk_ps,
+							   {irBuilder.CreateBitCast(i32x4Operand, llvmContext.f32x4Type)}));
 	}
 	else
 	{
@@ -643,9 +682,7 @@ void EmitFunctionContext::i32x4_bitmask(NoImm)
 															  constant4,
 															  constant8,
 														  }));
-		auto i32CombinedBitMask = callLLVMIntrinsic(
-			{llvmContext.i32x4Type}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {i32x4OrthogonalBitMask});
-		push(i32CombinedBitMask);
+		push(emitReduceAddToI32(i32x4OrthogonalBitMask));
 	}
 }
 
@@ -657,9 +694,9 @@ void EmitFunctionContext::i64x2_bitmask(NoImm)
 	if(moduleContext.targetArch == llvm::Triple::x86_64
 	   || moduleContext.targetArch == llvm::Triple::x86)
 	{
-		push(irBuilder.CreateZExt(
-			irBuilder.CreateBitCast(i1x2Mask, llvm::IntegerType::get(llvmContext, 2)),
-			llvmContext.i32Type));
+		push(callLLVMIntrinsic({},
+							   llvm::Intrinsic::x86_sse2_movmsk_pd,
+							   {irBuilder.CreateBitCast(i64x2Operand, llvmContext.f64x2Type)}));
 	}
 	else
 	{
@@ -671,9 +708,7 @@ void EmitFunctionContext::i64x2_bitmask(NoImm)
 															  constant1,
 															  constant2,
 														  }));
-		auto i64CombinedBitMask = callLLVMIntrinsic(
-			{llvmContext.i64x2Type}, LLVM_INTRINSIC_VECTOR_REDUCE_ADD, {i64x2OrthogonalBitMask});
-		push(irBuilder.CreateTrunc(i64CombinedBitMask, llvmContext.i32Type));
+		push(emitReduceAddToI32(i64x2OrthogonalBitMask));
 	}
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include "EmitFunctionContext.h"
@@ -31,6 +32,10 @@ using namespace WAVM::IR;
 using namespace WAVM::LLVMJIT;
 using namespace WAVM::Runtime;
 
+// The maximum number of functions that call_indirect compares the loaded function against to call
+// it directly.
+static constexpr Uptr maxCallIndirectCandidates = 4;
+
 void EmitFunctionContext::block(ControlStructureImm imm)
 {
 	FunctionType blockType = resolveBlockType(irModule, imm.type);
@@ -74,6 +79,10 @@ void EmitFunctionContext::loop(ControlStructureImm imm)
 	irBuilder.CreateBr(loopBodyBlock);
 	irBuilder.SetInsertPoint(loopBodyBlock);
 
+	// Check the epoch deadline each time the loop body is entered, which includes every branch
+	// back to the start of the loop.
+	if(checkEpochDeadline) { emitEpochDeadlineCheck(); }
+
 	// Push a control context that ends at the end block/phi.
 	pushControlStack(ControlContext::Type::loop, blockType.results(), endBlock, endPHIs);
 
@@ -95,7 +104,7 @@ void EmitFunctionContext::if_(ControlStructureImm imm)
 
 	// Pop the if condition from the operand stack.
 	auto condition = pop();
-	irBuilder.CreateCondBr(coerceI32ToBool(condition), thenBlock, elseBlock);
+	emitProfiledCondBr(coerceI32ToBool(condition), thenBlock, elseBlock);
 
 	// Pop the arguments from the operand stack.
 	ValueVector args;
@@ -221,7 +230,7 @@ void EmitFunctionContext::br_if(BranchImm imm)
 	auto falseBlock = llvm::BasicBlock::Create(llvmContext, "br_ifElse", function);
 
 	// Emit a conditional branch to either the falseBlock or the target block.
-	irBuilder.CreateCondBr(coerceI32ToBool(condition), target.block, falseBlock);
+	emitProfiledCondBr(coerceI32ToBool(condition), target.block, falseBlock);
 
 	// Resume emitting instructions in the falseBlock.
 	irBuilder.SetInsertPoint(falseBlock);
@@ -268,12 +277,13 @@ void EmitFunctionContext::br_table(BranchTableImm imm)
 	}
 
 	// Create a LLVM switch instruction.
-	WAVM_ASSERT(imm.branchTableIndex < functionDef.branchTables.size());
-	const std::vector<Uptr>& targetDepths = functionDef.branchTables[imm.branchTableIndex];
+	WAVM_ASSERT(imm.firstTargetDepthIndex + imm.numTargetDepths
+				<= functionDef.branchTableTargetDepths.size());
+	const U32* targetDepths = functionDef.branchTableTargetDepths.data() + imm.firstTargetDepthIndex;
 	auto llvmSwitch
-		= irBuilder.CreateSwitch(index, defaultTarget.block, (unsigned int)targetDepths.size());
+		= irBuilder.CreateSwitch(index, defaultTarget.block, (unsigned int)imm.numTargetDepths);
 
-	for(Uptr targetIndex = 0; targetIndex < targetDepths.size(); ++targetIndex)
+	for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
 	{
 		BranchTarget& target = getBranchTargetByDepth(targetDepths[targetIndex]);
 
@@ -323,7 +333,32 @@ void EmitFunctionContext::unreachable(NoImm)
 // Call operators
 //
 
-void EmitFunctionContext::call(FunctionImm imm)
+bool EmitFunctionContext::canEmitTailCall(FunctionType calleeType)
+{
+	// Only WebAssembly functions can be tail called. On Windows, a catch clause is a funclet that
+	// can't return from the function directly, so tail calls from any catch clause are emitted as a
+	// call followed by a return.
+	return calleeType.callingConvention() == IR::CallingConvention::wasm && !catchStack.size();
+}
+
+ValueVector EmitFunctionContext::emitCallOrTailCall(llvm::Value* callee,
+													 llvm::ArrayRef<llvm::Value*> args,
+													 FunctionType calleeType,
+													 bool calleeMaySwitchContext,
+													 bool isTailCall)
+{
+	if(!isTailCall)
+	{
+		return emitCallOrInvoke(
+			callee, args, calleeType, getInnermostUnwindToBlock(), calleeMaySwitchContext);
+	}
+
+	emitFunctionExitHooks();
+	emitTailCall(callee, args, calleeType);
+	return {};
+}
+
+void EmitFunctionContext::emitCall(FunctionImm imm, bool isTailCall)
 {
 	WAVM_ASSERT(imm.functionIndex < moduleContext.functions.size());
 	WAVM_ASSERT(imm.functionIndex < irModule.functions.size());
@@ -340,16 +375,43 @@ void EmitFunctionContext::call(FunctionImm imm)
 	for(Uptr argIndex = 0; argIndex < numArguments; ++argIndex)
 	{ llvmArgs[argIndex] = coerceToCanonicalType(llvmArgs[argIndex]); }
 
+	// If the callee is an import with an inline body, call the body, which is always inlined.
+	if(imm.functionIndex < moduleContext.inlineFunctionImports.size()
+	   && moduleContext.inlineFunctionImports[imm.functionIndex])
+	{
+		llvm::Value* result = irBuilder.CreateCall(
+			moduleContext.inlineFunctionImports[imm.functionIndex],
+			llvm::ArrayRef<llvm::Value*>(llvmArgs, numArguments));
+		WAVM_ASSERT(!isTailCall);
+		if(calleeType.results().size()) { push(result); }
+		return;
+	}
+
+	// If the callee is the thunk of a pure intrinsic, call its native function directly. It
+	// doesn't take the context, and can't throw, so it's never invoked.
+	if(imm.functionIndex < moduleContext.pureNativeFunctionImports.size()
+	   && moduleContext.pureNativeFunctionImports[imm.functionIndex])
+	{
+		ValueVector results = emitCallOrInvoke(
+			moduleContext.pureNativeFunctionImports[imm.functionIndex],
+			llvm::ArrayRef<llvm::Value*>(llvmArgs, numArguments),
+			FunctionType(calleeType.results(), calleeType.params(), IR::CallingConvention::c));
+		WAVM_ASSERT(!isTailCall);
+		for(llvm::Value* result : results) { push(result); }
+		return;
+	}
+
 	// Call the function.
-	ValueVector results = emitCallOrInvoke(callee,
-										   llvm::ArrayRef<llvm::Value*>(llvmArgs, numArguments),
-										   calleeType,
-										   getInnermostUnwindToBlock());
+	ValueVector results = emitCallOrTailCall(callee,
+											 llvm::ArrayRef<llvm::Value*>(llvmArgs, numArguments),
+											 calleeType,
+											 moduleContext.maySwitchContext(imm.functionIndex),
+											 isTailCall);
 
 	// Push the results on the operand stack.
 	for(llvm::Value* result : results) { push(result); }
 }
-void EmitFunctionContext::call_indirect(CallIndirectImm imm)
+void EmitFunctionContext::emitCallIndirect(CallIndirectImm imm, bool isTailCall)
 {
 	WAVM_ASSERT(imm.type.index < irModule.types.size());
 
@@ -366,6 +428,47 @@ void EmitFunctionContext::call_indirect(CallIndirectImm imm)
 	// Coerce the arguments to their canonical type.
 	for(Uptr argIndex = 0; argIndex < numArguments; ++argIndex)
 	{ llvmArgs[argIndex] = coerceToCanonicalType(llvmArgs[argIndex]); }
+	const llvm::ArrayRef<llvm::Value*> llvmArgArray(llvmArgs, numArguments);
+
+	// If the table can't change after instantiation, find the functions of the callee type that
+	// it contains.
+	const std::vector<Uptr>& immutableElements
+		= moduleContext.immutableTableElements[imm.tableIndex];
+	auto isCandidate = [&](Uptr functionIndex) {
+		return functionIndex != UINTPTR_MAX
+			   && irModule.types[irModule.functions.getType(functionIndex).index] == calleeType;
+	};
+
+	// If the element index is constant, and the element is a function of the callee type, call
+	// the function directly.
+	if(llvm::ConstantInt* constantElementIndex = llvm::dyn_cast<llvm::ConstantInt>(elementIndex))
+	{
+		const U64 constantIndex = constantElementIndex->getZExtValue();
+		if(constantIndex < immutableElements.size() && isCandidate(immutableElements[constantIndex]))
+		{
+			const Uptr functionIndex = immutableElements[constantIndex];
+			ValueVector results = emitCallOrTailCall(moduleContext.functions[functionIndex],
+													 llvmArgArray,
+													 calleeType,
+													 moduleContext.maySwitchContext(functionIndex),
+													 isTailCall);
+			for(llvm::Value* result : results) { push(result); }
+			return;
+		}
+	}
+
+	std::vector<Uptr> candidateFunctionIndices;
+	for(Uptr functionIndex : immutableElements)
+	{
+		if(isCandidate(functionIndex)
+		   && std::find(candidateFunctionIndices.begin(),
+						candidateFunctionIndices.end(),
+						functionIndex)
+				  == candidateFunctionIndices.end())
+		{ candidateFunctionIndices.push_back(functionIndex); }
+	}
+	if(candidateFunctionIndices.size() > maxCallIndirectCandidates)
+	{ candidateFunctionIndices.clear(); }
 
 	// Zero extend the function index to the pointer size.
 	elementIndex = zext(elementIndex, moduleContext.iptrType);
@@ -397,9 +500,86 @@ void EmitFunctionContext::call_indirect(CallIndirectImm imm)
 	llvm::LoadInst* biasedValueLoad = irBuilder.CreateLoad(elementPointer);
 	biasedValueLoad->setAtomic(llvm::AtomicOrdering::Acquire);
 	biasedValueLoad->setAlignment(LLVM_ALIGNMENT(sizeof(Uptr)));
-	auto runtimeFunction = irBuilder.CreateIntToPtr(
-		irBuilder.CreateAdd(biasedValueLoad, moduleContext.tableReferenceBias),
-		llvmContext.i8PtrType);
+
+	// Split the element's type tag from its biased address.
+	llvm::Value* biasedAddress = biasedValueLoad;
+	llvm::Value* elementTypeTag = nullptr;
+	if(tableElementsHaveTypeTags)
+	{
+		auto typeTagShift = emitLiteralIptr(tableElementTypeTagShift, moduleContext.iptrType);
+		auto addressShift = emitLiteralIptr(64 - tableElementTypeTagShift, moduleContext.iptrType);
+		elementTypeTag = irBuilder.CreateLShr(biasedValueLoad, typeTagShift);
+		biasedAddress
+			= irBuilder.CreateAShr(irBuilder.CreateShl(biasedValueLoad, addressShift), addressShift);
+	}
+	auto runtimeFunctionAddress
+		= irBuilder.CreateAdd(biasedAddress, moduleContext.tableReferenceBias);
+
+	// Compare the loaded function against each function of the callee type that the table may
+	// contain, and call it directly if it matches. This doesn't need to check the function type,
+	// and allows the callee to be inlined. Each tail call returns from the function, so their
+	// results don't need to be merged.
+	llvm::BasicBlock* endBlock = nullptr;
+	PHIVector endPHIs;
+	if(candidateFunctionIndices.size() && !isTailCall)
+	{
+		endBlock = llvm::BasicBlock::Create(llvmContext, "callIndirectEnd", function);
+		endPHIs = createPHIs(endBlock, calleeType.results());
+	}
+	for(Uptr candidateFunctionIndex : candidateFunctionIndices)
+	{
+		llvm::Function* candidateFunction = moduleContext.functions[candidateFunctionIndex];
+		auto directCallBlock = llvm::BasicBlock::Create(llvmContext, "callIndirectHit", function);
+		auto nextBlock = llvm::BasicBlock::Create(llvmContext, "callIndirectMiss", function);
+		irBuilder.CreateCondBr(
+			irBuilder.CreateICmpEQ(
+				runtimeFunctionAddress,
+				llvm::ConstantExpr::getSub(
+					llvm::ConstantExpr::getPtrToInt(
+						moduleContext.functionReferences[candidateFunctionIndex],
+						moduleContext.iptrType),
+					emitLiteralIptr(offsetof(Runtime::Function, code), moduleContext.iptrType))),
+			directCallBlock,
+			nextBlock);
+
+		irBuilder.SetInsertPoint(directCallBlock);
+		ValueVector results
+			= emitCallOrTailCall(candidateFunction,
+								 llvmArgArray,
+								 calleeType,
+								 moduleContext.maySwitchContext(candidateFunctionIndex),
+								 isTailCall);
+		if(endBlock)
+		{
+			for(Uptr resultIndex = 0; resultIndex < results.size(); ++resultIndex)
+			{
+				endPHIs[resultIndex]->addIncoming(results[resultIndex],
+												  irBuilder.GetInsertBlock());
+			}
+			irBuilder.CreateBr(endBlock);
+		}
+
+		irBuilder.SetInsertPoint(nextBlock);
+	}
+
+	auto runtimeFunction = irBuilder.CreateIntToPtr(runtimeFunctionAddress, llvmContext.i8PtrType);
+
+	// If the element's type tag matches the callee type's, the function type doesn't need to be
+	// loaded from the Function. Otherwise, compare the function's type ID to the callee type's.
+	llvm::BasicBlock* indirectCallBlock = nullptr;
+	if(elementTypeTag)
+	{
+		auto typeCheckBlock
+			= llvm::BasicBlock::Create(llvmContext, "callIndirectTypeCheck", function);
+		indirectCallBlock = llvm::BasicBlock::Create(llvmContext, "callIndirectCall", function);
+		irBuilder.CreateCondBr(
+			irBuilder.CreateICmpEQ(elementTypeTag, moduleContext.typeTags[imm.type.index]),
+			indirectCallBlock,
+			typeCheckBlock,
+			moduleContext.likelyTrueBranchWeights);
+		irBuilder.SetInsertPoint(typeCheckBlock);
+	}
+
 	auto elementTypeId = loadFromUntypedPointer(
 		irBuilder.CreateInBoundsGEP(
 			runtimeFunction,
@@ -422,6 +602,11 @@ void EmitFunctionContext::call_indirect(CallIndirectImm imm)
 		 getTableIdFromOffset(moduleContext.tableOffsets[imm.tableIndex]),
 		 irBuilder.CreatePointerCast(runtimeFunction, llvmContext.externrefType),
 		 calleeTypeId});
+	if(indirectCallBlock)
+	{
+		irBuilder.CreateBr(indirectCallBlock);
+		irBuilder.SetInsertPoint(indirectCallBlock);
+	}
 
 	// Call the function loaded from the table.
 	auto functionPointer = irBuilder.CreatePointerCast(
@@ -429,15 +614,68 @@ void EmitFunctionContext::call_indirect(CallIndirectImm imm)
 			runtimeFunction,
 			emitLiteralIptr(offsetof(Runtime::Function, code), moduleContext.iptrType)),
 		asLLVMType(llvmContext, calleeType)->getPointerTo());
-	ValueVector results = emitCallOrInvoke(functionPointer,
-										   llvm::ArrayRef<llvm::Value*>(llvmArgs, numArguments),
-										   calleeType,
-										   getInnermostUnwindToBlock());
+	ValueVector results
+		= emitCallOrTailCall(functionPointer, llvmArgArray, calleeType, true, isTailCall);
+
+	// If the call was also compared against direct call candidates, merge the results of the
+	// direct and indirect calls.
+	if(endBlock)
+	{
+		for(Uptr resultIndex = 0; resultIndex < results.size(); ++resultIndex)
+		{ endPHIs[resultIndex]->addIncoming(results[resultIndex], irBuilder.GetInsertBlock()); }
+		irBuilder.CreateBr(endBlock);
+
+		irBuilder.SetInsertPoint(endBlock);
+		results.clear();
+		for(llvm::PHINode* endPHI : endPHIs) { results.push_back(endPHI); }
+	}
 
 	// Push the results on the operand stack.
 	for(llvm::Value* result : results) { push(result); }
 }
 
+void EmitFunctionContext::call(FunctionImm imm) { emitCall(imm, false); }
+void EmitFunctionContext::call_indirect(CallIndirectImm imm) { emitCallIndirect(imm, false); }
+
+void EmitFunctionContext::return_call(FunctionImm imm)
+{
+	WAVM_ASSERT(imm.functionIndex < irModule.functions.size());
+	const FunctionType calleeType
+		= irModule.types[irModule.functions.getType(imm.functionIndex).index];
+
+	// Imports with an inline body are inlined into the caller, and pure intrinsics are called
+	// directly, so they are called and returned from like functions that can't be tail called.
+	const bool isInlineImport = imm.functionIndex < moduleContext.inlineFunctionImports.size()
+								&& moduleContext.inlineFunctionImports[imm.functionIndex];
+	const bool isPureNativeImport
+		= imm.functionIndex < moduleContext.pureNativeFunctionImports.size()
+		  && moduleContext.pureNativeFunctionImports[imm.functionIndex];
+	if(isInlineImport || isPureNativeImport || !canEmitTailCall(calleeType))
+	{
+		emitCall(imm, false);
+		return_(NoImm());
+	}
+	else
+	{
+		emitCall(imm, true);
+		enterUnreachable();
+	}
+}
+void EmitFunctionContext::return_call_indirect(CallIndirectImm imm)
+{
+	WAVM_ASSERT(imm.type.index < irModule.types.size());
+	if(!canEmitTailCall(irModule.types[imm.type.index]))
+	{
+		emitCallIndirect(imm, false);
+		return_(NoImm());
+	}
+	else
+	{
+		emitCallIndirect(imm, true);
+		enterUnreachable();
+	}
+}
+
 void EmitFunctionContext::nop(IR::NoImm) {}
 void EmitFunctionContext::drop(IR::NoImm) { stack.pop_back(); }
 void EmitFunctionContext::select(IR::SelectImm)
@@ -160,16 +160,28 @@ void EmitFunctionContext::try_(ControlStructureImm imm)
 		auto exceptionPointer
 			= loadFromUntypedPointer(exceptionPointerAlloca, llvmContext.i8PtrType);
 
+		// Branch to the block that dispatches the exception to the catch clauses.
+		auto unwoundBlock = irBuilder.GetInsertBlock();
+		auto dispatchBlock = llvm::BasicBlock::Create(llvmContext, "dispatch", function);
+		irBuilder.CreateBr(dispatchBlock);
+		irBuilder.SetInsertPoint(dispatchBlock);
+		auto exceptionPointerPHI = irBuilder.CreatePHI(llvmContext.i8PtrType, 1);
+		exceptionPointerPHI->addIncoming(exceptionPointer, unwoundBlock);
+
+		// Reload the fuel that remained and the stack pointer when the exception was thrown.
+		if(fuelVariable) { reloadFuel(); }
+		if(stackPointerVariable) { reloadStackPointer(); }
+
 		// Load the exception type ID.
 		auto exceptionTypeId = loadFromUntypedPointer(
 			irBuilder.CreateInBoundsGEP(
-				exceptionPointer,
+				exceptionPointerPHI,
 				{emitLiteralIptr(offsetof(Exception, typeId), moduleContext.iptrType)}),
 			moduleContext.iptrType);
 
-		tryStack.push_back(TryContext{catchSwitchBlock});
-		catchStack.push_back(
-			CatchContext{catchSwitchInst, nullptr, exceptionPointer, catchBlock, exceptionTypeId});
+		tryStack.push_back(TryContext{catchSwitchBlock, dispatchBlock, exceptionPointerPHI});
+		catchStack.push_back(CatchContext{
+			catchSwitchInst, nullptr, exceptionPointerPHI, dispatchBlock, exceptionTypeId});
 	}
 	else
 	{
@@ -188,16 +200,28 @@ void EmitFunctionContext::try_(ControlStructureImm imm)
 		// Call __cxa_end_catch immediately to free memory used to throw the exception.
 		irBuilder.CreateCall(getCXAEndCatchFunction(moduleContext));
 
+		// Branch to the block that dispatches the exception to the catch clauses.
+		auto unwoundBlock = irBuilder.GetInsertBlock();
+		auto dispatchBlock = llvm::BasicBlock::Create(llvmContext, "dispatch", function);
+		irBuilder.CreateBr(dispatchBlock);
+		irBuilder.SetInsertPoint(dispatchBlock);
+		auto exceptionPointerPHI = irBuilder.CreatePHI(llvmContext.i8PtrType, 1);
+		exceptionPointerPHI->addIncoming(exceptionPointer, unwoundBlock);
+
+		// Reload the fuel that remained and the stack pointer when the exception was thrown.
+		if(fuelVariable) { reloadFuel(); }
+		if(stackPointerVariable) { reloadStackPointer(); }
+
 		// Load the exception type ID.
 		auto exceptionTypeId = loadFromUntypedPointer(
 			irBuilder.CreateInBoundsGEP(
-				exceptionPointer,
+				exceptionPointerPHI,
 				{emitLiteralIptr(offsetof(Exception, typeId), moduleContext.iptrType)}),
 			moduleContext.iptrType);
 
-		tryStack.push_back(TryContext{landingPadBlock});
+		tryStack.push_back(TryContext{landingPadBlock, dispatchBlock, exceptionPointerPHI});
 		catchStack.push_back(CatchContext{
-			nullptr, landingPadInst, exceptionPointer, landingPadBlock, exceptionTypeId});
+			nullptr, landingPadInst, exceptionPointerPHI, dispatchBlock, exceptionTypeId});
 	}
 
 	irBuilder.SetInsertPoint(originalInsertBlock);
@@ -350,13 +374,28 @@ void EmitFunctionContext::throw_(ExceptionTypeImm imm)
 			IR::CallingConvention::intrinsic),
 		{exceptionTypeId, argsPointerAsInt, emitLiteral(llvmContext, I32(1))})[0];
 
-	emitRuntimeIntrinsic(
-		"throwException",
-		FunctionType(
-			TypeTuple{}, TypeTuple{moduleContext.iptrValueType}, IR::CallingConvention::intrinsic),
-		{irBuilder.CreatePtrToInt(exceptionPointer, moduleContext.iptrType)});
+	if(tryStack.size())
+	{
+		// If the throw is inside a try in this function, branch directly to the code that
+		// dispatches the exception to its catch clauses. This avoids unwinding through the host's
+		// unwinder, which has to search for the handler before unwinding to it.
+		TryContext& tryContext = tryStack.back();
+		tryContext.exceptionPointerPHI->addIncoming(
+			irBuilder.CreateIntToPtr(exceptionPointer, llvmContext.i8PtrType),
+			irBuilder.GetInsertBlock());
+		irBuilder.CreateBr(tryContext.dispatchBlock);
+	}
+	else
+	{
+		emitRuntimeIntrinsic(
+			"throwException",
+			FunctionType(TypeTuple{},
+						 TypeTuple{moduleContext.iptrValueType},
+						 IR::CallingConvention::intrinsic),
+			{irBuilder.CreatePtrToInt(exceptionPointer, moduleContext.iptrType)});
+		irBuilder.CreateUnreachable();
+	}
 
-	irBuilder.CreateUnreachable();
 	enterUnreachable();
 }
 void EmitFunctionContext::rethrow(RethrowImm imm)
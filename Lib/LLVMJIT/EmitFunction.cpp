@@ -1,4 +1,6 @@
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <initializer_list>
 #include <memory>
 #include <string>
@@ -10,6 +12,7 @@
 #include "WAVM/IR/OperatorPrinter.h"
 #include "WAVM/IR/Operators.h"
 #include "WAVM/IR/Types.h"
+#include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
@@ -30,6 +33,7 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
@@ -160,19 +164,282 @@ void EmitFunctionContext::emitConditionalTrapIntrinsic(
 	FunctionType intrinsicType,
 	const std::initializer_list<llvm::Value*>& args)
 {
-	auto trueBlock
-		= llvm::BasicBlock::Create(llvmContext, llvm::Twine(intrinsicName) + "Trap", function);
 	auto endBlock
 		= llvm::BasicBlock::Create(llvmContext, llvm::Twine(intrinsicName) + "Skip", function);
 
-	irBuilder.CreateCondBr(
-		booleanCondition, trueBlock, endBlock, moduleContext.likelyFalseBranchWeights);
+	llvm::BasicBlock* conditionBlock = irBuilder.GetInsertBlock();
+	const Uptr conditionNumMemoryBaseReloads = numMemoryBaseReloads;
+
+	// The operators after the trap continue the fuel charge's run of operators.
+	if(fuelChargeBlock == conditionBlock) { fuelChargeBlock = endBlock; }
+
+	llvm::BasicBlock* trapBlock;
+	if(shareTrapBlocks)
+	{
+		// Find or create the function's trap block for the intrinsic and unwind block, and pass
+		// the arguments to it through its PHIs, so each trap site only needs a branch.
+		llvm::BasicBlock* unwindToBlock = getInnermostUnwindToBlock();
+		SharedTrapBlock* sharedTrapBlock = nullptr;
+		for(SharedTrapBlock& existingTrapBlock : sharedTrapBlocks)
+		{
+			if(existingTrapBlock.unwindToBlock == unwindToBlock
+			   && !strcmp(existingTrapBlock.intrinsicName, intrinsicName))
+			{
+				sharedTrapBlock = &existingTrapBlock;
+				break;
+			}
+		}
+		if(!sharedTrapBlock)
+		{
+			sharedTrapBlocks.push_back({intrinsicName, unwindToBlock, nullptr, {}});
+			sharedTrapBlock = &sharedTrapBlocks.back();
+			sharedTrapBlock->block = llvm::BasicBlock::Create(
+				llvmContext, llvm::Twine(intrinsicName) + "Trap", function);
+
+			irBuilder.SetInsertPoint(sharedTrapBlock->block);
+			for(llvm::Value* arg : args)
+			{ sharedTrapBlock->argPHIs.push_back(irBuilder.CreatePHI(arg->getType(), 2)); }
+			llvm::SmallVector<llvm::Value*, 4> argPHIs(sharedTrapBlock->argPHIs.begin(),
+													   sharedTrapBlock->argPHIs.end());
+			emitRuntimeIntrinsic(intrinsicName, intrinsicType, argPHIs);
+			irBuilder.CreateUnreachable();
+			irBuilder.SetInsertPoint(conditionBlock);
+		}
+
+		WAVM_ASSERT(sharedTrapBlock->argPHIs.size() == args.size());
+		Uptr argIndex = 0;
+		for(llvm::Value* arg : args)
+		{ sharedTrapBlock->argPHIs[argIndex++]->addIncoming(arg, conditionBlock); }
+		trapBlock = sharedTrapBlock->block;
+	}
+	else
+	{
+		trapBlock = llvm::BasicBlock::Create(
+			llvmContext, llvm::Twine(intrinsicName) + "Trap", function);
+		irBuilder.SetInsertPoint(trapBlock);
+		emitRuntimeIntrinsic(intrinsicName, intrinsicType, args);
+		irBuilder.CreateUnreachable();
+		irBuilder.SetInsertPoint(conditionBlock);
+	}
 
-	irBuilder.SetInsertPoint(trueBlock);
-	emitRuntimeIntrinsic(intrinsicName, intrinsicType, args);
-	irBuilder.CreateUnreachable();
+	// Mark the trap intrinsic as cold and non-returning, so LLVM treats the trap block as
+	// unlikely and places it after the function's hot code.
+	llvm::Function* intrinsicFunction = function->getParent()->getFunction(intrinsicName);
+	intrinsicFunction->addFnAttr(llvm::Attribute::Cold);
+	intrinsicFunction->addFnAttr(llvm::Attribute::NoReturn);
+
+	irBuilder.CreateCondBr(
+		booleanCondition, trapBlock, endBlock, moduleContext.likelyFalseBranchWeights);
 
 	irBuilder.SetInsertPoint(endBlock);
+
+	// The end block is only reachable from the condition block, and the trap block doesn't return,
+	// so addresses bounded in the condition block may still be reused in the end block. This lets
+	// accesses through the same local share one bounds check even if there is a trapping operator
+	// (e.g. a division or another bounds check) between them.
+	for(BoundedLocalAddress& boundedLocalAddress : boundedLocalAddresses)
+	{
+		if(boundedLocalAddress.block == conditionBlock
+		   && boundedLocalAddress.numMemoryBaseReloads == conditionNumMemoryBaseReloads)
+		{
+			boundedLocalAddress.block = endBlock;
+			boundedLocalAddress.numMemoryBaseReloads = numMemoryBaseReloads;
+		}
+	}
+}
+
+void EmitFunctionContext::emitEpochDeadlineCheck()
+{
+	// The epoch and deadline may be changed by other threads while the function runs, so load them
+	// atomically to keep LLVM from hoisting the loads out of loops.
+	llvm::LoadInst* epoch = loadFromUntypedPointer(
+		irBuilder.CreateInBoundsGEP(
+			getCompartmentAddress(),
+			{emitLiteralIptr(offsetof(Runtime::CompartmentRuntimeData, epoch),
+							 moduleContext.iptrType)}),
+		llvmContext.i64Type,
+		sizeof(U64));
+	epoch->setAtomic(llvm::AtomicOrdering::Monotonic);
+
+	llvm::LoadInst* deadline = loadFromUntypedPointer(
+		irBuilder.CreateInBoundsGEP(
+			irBuilder.CreateLoad(contextPointerVariable),
+			{emitLiteralIptr(offsetof(Runtime::ContextRuntimeData, epochDeadline),
+							 moduleContext.iptrType)}),
+		llvmContext.i64Type,
+		sizeof(U64));
+	deadline->setAtomic(llvm::AtomicOrdering::Monotonic);
+
+	auto reachedBlock = llvm::BasicBlock::Create(llvmContext, "epochDeadlineReached", function);
+	auto continueBlock = llvm::BasicBlock::Create(llvmContext, "epochDeadlineSkip", function);
+	irBuilder.CreateCondBr(irBuilder.CreateICmpUGE(epoch, deadline),
+						   reachedBlock,
+						   continueBlock,
+						   moduleContext.likelyFalseBranchWeights);
+
+	// Unlike a trap, the intrinsic may return to continue running the function.
+	irBuilder.SetInsertPoint(reachedBlock);
+	emitRuntimeIntrinsic("epochDeadlineReached",
+						 FunctionType({}, {}, IR::CallingConvention::intrinsic),
+						 {});
+	irBuilder.CreateBr(continueBlock);
+
+	irBuilder.SetInsertPoint(continueBlock);
+}
+
+void EmitFunctionContext::emitStackLimitCheck()
+{
+	llvm::Value* stackPointer = irBuilder.CreatePtrToInt(
+		callLLVMIntrinsic({}, llvm::Intrinsic::stacksave, {}), moduleContext.iptrType);
+	llvm::Value* stackLimit = loadFromUntypedPointer(
+		irBuilder.CreateInBoundsGEP(
+			irBuilder.CreateLoad(contextPointerVariable),
+			{emitLiteralIptr(offsetof(Runtime::ContextRuntimeData, stackLimit),
+							 moduleContext.iptrType)}),
+		moduleContext.iptrType,
+		sizeof(Uptr));
+	emitConditionalTrapIntrinsic(irBuilder.CreateICmpULT(stackPointer, stackLimit),
+								 "stackOverflowTrap",
+								 FunctionType({}, {}, IR::CallingConvention::intrinsic),
+								 {});
+}
+
+void EmitFunctionContext::emitTierUpCheck()
+{
+	// The acquire load pairs with the release store that publishes the tiered-up code, so the
+	// code is visible to this thread before it is called.
+	llvm::LoadInst* tieredUpCode = loadFromUntypedPointer(
+		irBuilder.CreateInBoundsGEP(
+			tierUpState,
+			{emitLiteralIptr(offsetof(Runtime::FunctionTierUpState, tieredUpCode),
+							 moduleContext.iptrType)}),
+		llvmContext.i8PtrType,
+		sizeof(Uptr));
+	tieredUpCode->setAtomic(llvm::AtomicOrdering::Acquire);
+
+	auto forwardBlock = llvm::BasicBlock::Create(llvmContext, "tierUpForward", function);
+	auto countBlock = llvm::BasicBlock::Create(llvmContext, "tierUpCount", function);
+	irBuilder.CreateCondBr(irBuilder.CreateIsNotNull(tieredUpCode), forwardBlock, countBlock);
+
+	// Tail call the tiered-up code with the function's arguments, so it returns directly to the
+	// function's caller.
+	irBuilder.SetInsertPoint(forwardBlock);
+	ValueVector args;
+	for(auto argIt = function->arg_begin() + 1; argIt != function->arg_end(); ++argIt)
+	{ args.push_back(&*argIt); }
+	emitTailCall(irBuilder.CreatePointerCast(
+					 tieredUpCode, asLLVMType(llvmContext, functionType)->getPointerTo()),
+				 args,
+				 functionType);
+
+	// Count the call, and ask the runtime to tier up the function on the call that reaches the
+	// threshold. Later calls keep running this code until the tiered-up code is published.
+	irBuilder.SetInsertPoint(countBlock);
+	llvm::Value* numCalls = irBuilder.CreateAtomicRMW(
+		llvm::AtomicRMWInst::BinOp::Add,
+		irBuilder.CreatePointerCast(
+			irBuilder.CreateInBoundsGEP(
+				tierUpState,
+				{emitLiteralIptr(offsetof(Runtime::FunctionTierUpState, numCalls),
+								 moduleContext.iptrType)}),
+			moduleContext.iptrType->getPointerTo()),
+		emitLiteralIptr(1, moduleContext.iptrType),
+		llvm::AtomicOrdering::Monotonic);
+
+	auto thresholdBlock = llvm::BasicBlock::Create(llvmContext, "tierUpThreshold", function);
+	auto continueBlock = llvm::BasicBlock::Create(llvmContext, "tierUpSkip", function);
+	irBuilder.CreateCondBr(
+		irBuilder.CreateICmpEQ(numCalls,
+							   emitLiteralIptr(tierUpCallThreshold - 1, moduleContext.iptrType)),
+		thresholdBlock,
+		continueBlock,
+		moduleContext.likelyFalseBranchWeights);
+
+	irBuilder.SetInsertPoint(thresholdBlock);
+	emitRuntimeIntrinsic(
+		"tierUpFunction",
+		FunctionType({}, {ValueType::funcref}, IR::CallingConvention::intrinsic),
+		{llvm::ConstantExpr::getSub(
+			llvm::ConstantExpr::getPtrToInt(function, moduleContext.iptrType),
+			emitLiteralIptr(offsetof(Runtime::Function, code), moduleContext.iptrType))});
+	irBuilder.CreateBr(continueBlock);
+
+	irBuilder.SetInsertPoint(continueBlock);
+}
+
+void EmitFunctionContext::chargeFuelForOperator()
+{
+	if(irBuilder.GetInsertBlock() != fuelChargeBlock)
+	{
+		// Subtract the run's cost from the fuel, and call the fuelExhausted intrinsic if the fuel
+		// goes negative. The subtraction is created with a zero cost, so the IR builder can't fold
+		// it, and the cost is filled in as the run's operators are emitted.
+		fuelCharge = llvm::BinaryOperator::CreateSub(irBuilder.CreateLoad(fuelVariable),
+													 emitLiteral(llvmContext, I64(0)));
+		irBuilder.Insert(fuelCharge);
+		irBuilder.CreateStore(fuelCharge, fuelVariable);
+
+		auto exhaustedBlock = llvm::BasicBlock::Create(llvmContext, "fuelExhausted", function);
+		auto continueBlock = llvm::BasicBlock::Create(llvmContext, "fuelExhaustedSkip", function);
+		irBuilder.CreateCondBr(irBuilder.CreateICmpSLT(fuelCharge, emitLiteral(llvmContext, I64(0))),
+							   exhaustedBlock,
+							   continueBlock,
+							   moduleContext.likelyFalseBranchWeights);
+
+		irBuilder.SetInsertPoint(exhaustedBlock);
+		emitRuntimeIntrinsic(
+			"fuelExhausted", FunctionType({}, {}, IR::CallingConvention::intrinsic), {});
+		irBuilder.CreateBr(continueBlock);
+
+		irBuilder.SetInsertPoint(continueBlock);
+		fuelChargeBlock = continueBlock;
+		fuelChargeCost = 0;
+	}
+
+	fuelCharge->setOperand(1, emitLiteral(llvmContext, I64(++fuelChargeCost)));
+}
+
+// Increments a profile counter. The counters are only used to gather statistics, so the
+// increment doesn't need to be ordered with any other memory accesses.
+static void emitProfileCounterIncrement(EmitFunctionContext& functionContext,
+										llvm::Value* counterIndex)
+{
+	llvm::Value* counterPointer = functionContext.irBuilder.CreateInBoundsGEP(
+		functionContext.profileCounters, {counterIndex});
+	functionContext.irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::BinOp::Add,
+											  counterPointer,
+											  emitLiteral(functionContext.llvmContext, U64(1)),
+											  llvm::AtomicOrdering::Monotonic);
+}
+
+void EmitFunctionContext::emitProfiledCondBr(llvm::Value* booleanCondition,
+											 llvm::BasicBlock* trueBlock,
+											 llvm::BasicBlock* falseBlock)
+{
+	// The counts for each conditional branch follow the function's entry count.
+	const Uptr trueCountIndex = 1 + numConditionalBranches++ * 2;
+
+	if(profileCounters)
+	{
+		emitProfileCounterIncrement(
+			*this,
+			irBuilder.CreateSelect(booleanCondition,
+								   emitLiteralIptr(trueCountIndex, moduleContext.iptrType),
+								   emitLiteralIptr(trueCountIndex + 1, moduleContext.iptrType)));
+	}
+
+	llvm::MDNode* branchWeights = nullptr;
+	if(profileCounts && trueCountIndex + 1 < profileCounts->size())
+	{
+		// LLVM branch weights are 32-bit, so scale down counts that don't fit.
+		U64 trueCount = (*profileCounts)[trueCountIndex];
+		U64 falseCount = (*profileCounts)[trueCountIndex + 1];
+		const U64 scale = std::max(trueCount, falseCount) / UINT32_MAX + 1;
+		branchWeights = llvm::MDBuilder(llvmContext)
+							.createBranchWeights(U32(trueCount / scale), U32(falseCount / scale));
+	}
+
+	irBuilder.CreateCondBr(booleanCondition, trueBlock, falseBlock, branchWeights);
 }
 
 //
@@ -292,33 +559,67 @@ private:
 	Uptr unreachableControlDepth;
 };
 
+// Validates each operator before passing it to another visitor, so a function body can be validated
+// in the same pass that emits it.
+template<typename Visitor> struct ValidatingOpVisitor
+{
+	typedef void Result;
+
+	ValidatingOpVisitor(CodeValidationStream* inValidationStream, Visitor& inVisitor)
+	: validationStream(inValidationStream), visitor(inVisitor)
+	{
+	}
+#define VISIT_OP(opcode, name, nameString, Imm, ...)                                               \
+	void name(Imm imm)                                                                             \
+	{                                                                                              \
+		validationStream->name(imm);                                                               \
+		visitor.name(imm);                                                                         \
+	}
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+private:
+	CodeValidationStream* validationStream;
+	Visitor& visitor;
+};
+
 void EmitFunctionContext::emit()
 {
 	WAVM_ASSERT(functionType.callingConvention() == CallingConvention::wasm);
 
-	// Create debug info for the function.
-	llvm::SmallVector<llvm::Metadata*, 10> diFunctionParameterTypes;
-	for(auto parameterType : functionType.params())
-	{ diFunctionParameterTypes.push_back(moduleContext.diValueTypes[(Uptr)parameterType]); }
-	auto diParamArray = moduleContext.diBuilder.getOrCreateTypeArray(diFunctionParameterTypes);
-	auto diFunctionType = moduleContext.diBuilder.createSubroutineType(diParamArray);
-	diFunction = moduleContext.diBuilder.createFunction(
-		moduleContext.diModuleScope,
-		function->getName(),
-		function->getName(),
-		moduleContext.diModuleScope,
-		0,
-		diFunctionType,
+	// Create debug info for the function. The parameter types are only described by full debug
+	// info.
+	if(moduleContext.debugInfoLevel != DebugInfoLevel::none)
+	{
+		llvm::SmallVector<llvm::Metadata*, 10> diFunctionParameterTypes;
+		if(moduleContext.debugInfoLevel == DebugInfoLevel::full)
+		{
+			for(auto parameterType : functionType.params())
+			{
+				diFunctionParameterTypes.push_back(
+					moduleContext.diValueTypes[(Uptr)parameterType]);
+			}
+		}
+		auto diParamArray = moduleContext.diBuilder.getOrCreateTypeArray(diFunctionParameterTypes);
+		auto diFunctionType = moduleContext.diBuilder.createSubroutineType(diParamArray);
+		diFunction = moduleContext.diBuilder.createFunction(
+			moduleContext.diModuleScope,
+			function->getName(),
+			function->getName(),
+			moduleContext.diModuleScope,
+			0,
+			diFunctionType,
 #if LLVM_VERSION_MAJOR >= 8
-		0,
-		llvm::DINode::FlagZero,
-		llvm::DISubprogram::SPFlagDefinition | llvm::DISubprogram::SPFlagOptimized);
+			0,
+			llvm::DINode::FlagZero,
+			llvm::DISubprogram::SPFlagDefinition | llvm::DISubprogram::SPFlagOptimized);
 #else
-		false,
-		true,
-		0);
+			false,
+			true,
+			0);
 #endif
-	function->setSubprogram(diFunction);
+		function->setSubprogram(diFunction);
+	}
 
 	// Create an initial basic block for the function.
 	auto entryBasicBlock = llvm::BasicBlock::Create(llvmContext, "entry", function);
@@ -336,6 +637,10 @@ void EmitFunctionContext::emit()
 	auto llvmArgIt = function->arg_begin();
 	initContextVariables(&*llvmArgIt++, moduleContext.iptrType);
 
+	// Check whether the function has been tiered up before doing anything else, so the tiered-up
+	// code does the work of the call.
+	if(tierUpState) { emitTierUpCheck(); }
+
 	// Create and initialize allocas for all the locals and parameters.
 	for(Uptr localIndex = 0;
 		localIndex < functionType.params().size() + functionDef.nonParameterLocalTypes.size();
@@ -361,6 +666,52 @@ void EmitFunctionContext::emit()
 		}
 	}
 
+	// Count the function entry if the function is instrumented, and give LLVM the entry count if
+	// there is a profile.
+	if(profileCounters)
+	{ emitProfileCounterIncrement(*this, emitLiteralIptr(0, moduleContext.iptrType)); }
+	if(profileCounts && profileCounts->size())
+	{
+		function->setEntryCount((*profileCounts)[0]);
+
+		// Optimize functions that were never called in the profile for size instead of speed.
+		if((*profileCounts)[0] == 0) { function->addFnAttr(llvm::Attribute::Cold); }
+	}
+
+	// Count the call, and read the cycle counter at entry if the function measures its cycles.
+	if(functionStats)
+	{
+		irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::BinOp::Add,
+								  functionStats,
+								  emitLiteral(llvmContext, U64(1)),
+								  llvm::AtomicOrdering::Monotonic);
+		if(measureCycles)
+		{ entryCycleCount = callLLVMIntrinsic({}, llvm::Intrinsic::readcyclecounter, {}); }
+	}
+
+	// Cache the context's fuel in a local variable while the function runs.
+	if(meterFuel)
+	{
+		fuelVariable = irBuilder.CreateAlloca(llvmContext.i64Type, nullptr, "fuel");
+		reloadFuel();
+	}
+
+	// Cache the stack pointer global in a local variable while the function runs.
+	if(moduleContext.stackPointerGlobalIndex != UINTPTR_MAX)
+	{
+		const Uptr globalIndex = moduleContext.stackPointerGlobalIndex;
+		stackPointerGlobalOffset = llvm::ConstantExpr::getPtrToInt(
+			moduleContext.globals[globalIndex], moduleContext.iptrType);
+		stackPointerVariable = irBuilder.CreateAlloca(
+			asLLVMType(llvmContext, irModule.globals.getType(globalIndex).valueType),
+			nullptr,
+			"stackPointer");
+		reloadStackPointer();
+	}
+
+	if(checkStackLimit) { emitStackLimitCheck(); }
+	if(checkEpochDeadline) { emitEpochDeadlineCheck(); }
+
 	if(EMIT_ENTER_EXIT_HOOKS)
 	{
 		emitRuntimeIntrinsic(
@@ -375,23 +726,62 @@ void EmitFunctionContext::emit()
 	OperatorDecoderStream decoder(functionDef.code);
 	UnreachableOpVisitor unreachableOpVisitor(*this);
 	OperatorPrinter operatorPrinter(irModule, functionDef);
+
+	// If the function is validated while it's emitted, each operator is passed through the
+	// validator before it's decoded by the emitter.
+	std::unique_ptr<CodeValidationStream> validationStream;
+	if(validationState)
+	{ validationStream.reset(new CodeValidationStream(*validationState, functionDef)); }
+	ValidatingOpVisitor<EmitFunctionContext> validatingOpVisitor(validationStream.get(), *this);
+	ValidatingOpVisitor<UnreachableOpVisitor> validatingUnreachableOpVisitor(
+		validationStream.get(), unreachableOpVisitor);
 	Uptr opIndex = 0;
 	const bool enableTracing = Log::isCategoryEnabled(Log::traceCompilation);
+
 	while(decoder && controlStack.size())
 	{
 		if(enableTracing) { traceOperator(decoder.decodeOpWithoutConsume(operatorPrinter)); }
 
-		irBuilder.SetCurrentDebugLocation(
-			llvm::DILocation::get(llvmContext, (unsigned int)opIndex++, 0, diFunction));
+		if(diFunction)
+		{
+			irBuilder.SetCurrentDebugLocation(
+				llvm::DILocation::get(llvmContext, (unsigned int)opIndex++, 0, diFunction));
+		}
+
+		if(meterFuel && controlStack.back().isReachable) { chargeFuelForOperator(); }
 
-		if(controlStack.back().isReachable) { decoder.decodeOp(*this); }
+		if(validationStream)
+		{
+			if(controlStack.back().isReachable) { decoder.decodeOp(validatingOpVisitor); }
+			else
+			{
+				decoder.decodeOp(validatingUnreachableOpVisitor);
+			}
+		}
+		else if(controlStack.back().isReachable)
+		{
+			decoder.decodeOp(*this);
+		}
 		else
 		{
 			decoder.decodeOp(unreachableOpVisitor);
 		}
 	};
+	if(validationStream)
+	{
+		// Any operator after the end of the function is invalid, so let the validator report it.
+		if(decoder) { decoder.decodeOp(*validationStream); }
+		validationStream->finish();
+	}
 	WAVM_ASSERT(irBuilder.GetInsertBlock() == returnBlock);
 
+	// Emit the function return.
+	emitFunctionExitHooks();
+	emitReturn(functionType.results(), stack);
+}
+
+void EmitFunctionContext::emitFunctionExitHooks()
+{
 	if(EMIT_ENTER_EXIT_HOOKS)
 	{
 		emitRuntimeIntrinsic(
@@ -402,6 +792,14 @@ void EmitFunctionContext::emit()
 				emitLiteralIptr(offsetof(Runtime::Function, code), moduleContext.iptrType))});
 	}
 
-	// Emit the function return.
-	emitReturn(functionType.results(), stack);
+	// Add the cycles spent in the call to the function's cycle count.
+	if(entryCycleCount)
+	{
+		llvm::Value* exitCycleCount = callLLVMIntrinsic({}, llvm::Intrinsic::readcyclecounter, {});
+		irBuilder.CreateAtomicRMW(
+			llvm::AtomicRMWInst::BinOp::Add,
+			irBuilder.CreateInBoundsGEP(functionStats, {emitLiteralIptr(1, moduleContext.iptrType)}),
+			irBuilder.CreateSub(exitCycleCount, entryCycleCount),
+			llvm::AtomicOrdering::Monotonic);
+	}
 }
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include "EmitContext.h"
 #include "EmitModuleContext.h"
 #include "LLVMJITPrivate.h"
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Types.h"
+#include "WAVM/IR/Validate.h"
 #include "WAVM/Logging/Logging.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
@@ -24,7 +26,79 @@ namespace WAVM { namespace LLVMJIT {
 
 		std::vector<llvm::Value*> localPointers;
 
-		llvm::DISubprogram* diFunction;
+		llvm::DISubprogram* diFunction = nullptr;
+
+		// If the function is instrumented, a pointer to its array of profile counters.
+		llvm::Value* profileCounters = nullptr;
+
+		// If the function counts its calls, a pointer to its call count followed by its cycle
+		// count, and whether it measures the cycles spent in calls.
+		llvm::Value* functionStats = nullptr;
+		bool measureCycles = false;
+		llvm::Value* entryCycleCount = nullptr;
+
+		// If the function tiers up, a pointer to its Runtime::FunctionTierUpState, and the number
+		// of calls after which it asks the runtime to tier it up.
+		llvm::Value* tierUpState = nullptr;
+		Uptr tierUpCallThreshold = 0;
+
+		// If the function is compiled with a profile, the function's execution counts.
+		const std::vector<U64>* profileCounts = nullptr;
+
+		// If true, the function checks the context's epoch deadline at entry and at the start of
+		// each loop iteration.
+		bool checkEpochDeadline = false;
+
+		// If true, the function meters fuel. Each straight-line run of operators is charged for
+		// when it starts: fuelCharge is the subtraction from the fuel for the run that is being
+		// emitted in fuelChargeBlock, and its cost is updated as operators are added to the run.
+		bool meterFuel = false;
+
+		// If true, the function checks the stack pointer against the context's stack limit at
+		// entry.
+		bool checkStackLimit = false;
+
+		// If true, float operators are emitted without the extra code that makes the NaNs they
+		// produce deterministic. See CompileOptions::relaxedNaN.
+		bool relaxedNaN = false;
+
+		// If true, the conditional traps that call the same intrinsic and unwind to the same block
+		// branch to one shared trap block, which receives the intrinsic's arguments through PHIs.
+		// See CompileOptions::shareTrapBlocks.
+		bool shareTrapBlocks = false;
+
+		struct SharedTrapBlock
+		{
+			const char* intrinsicName;
+			llvm::BasicBlock* unwindToBlock;
+			llvm::BasicBlock* block;
+			std::vector<llvm::PHINode*> argPHIs;
+		};
+		std::vector<SharedTrapBlock> sharedTrapBlocks;
+
+		llvm::BinaryOperator* fuelCharge = nullptr;
+		llvm::BasicBlock* fuelChargeBlock = nullptr;
+		I64 fuelChargeCost = 0;
+
+		// If non-null, each operator is validated before it is emitted, and emit throws an
+		// IR::ValidationException if the function is invalid.
+		IR::ModuleValidationState* validationState = nullptr;
+
+		Uptr numConditionalBranches = 0;
+
+		// An address read from a local variable that has already been clamped to a memory's
+		// bounds. Later accesses to the same memory through the same local in the same basic block
+		// (or a block that continues it past a conditional trap) can reuse the clamped address until
+		// the local is set or the memory bases are reloaded.
+		struct BoundedLocalAddress
+		{
+			Uptr memoryIndex;
+			llvm::Value* localPointer;
+			llvm::BasicBlock* block;
+			Uptr numMemoryBaseReloads;
+			llvm::Value* boundedAddress;
+		};
+		std::vector<BoundedLocalAddress> boundedLocalAddresses;
 
 		// Information about an in-scope control structure.
 		struct ControlContext
@@ -118,6 +192,12 @@ namespace WAVM { namespace LLVMJIT {
 		// the vector width.
 		llvm::Value* coerceToCanonicalType(llvm::Value* value);
 
+		// Emits a conditional branch, counting how many times it goes each way if the function is
+		// instrumented, and weighting it by the profile if there is one.
+		void emitProfiledCondBr(llvm::Value* booleanCondition,
+								llvm::BasicBlock* trueBlock,
+								llvm::BasicBlock* falseBlock);
+
 		// Debug logging.
 		void traceOperator(const std::string& operatorDescription);
 
@@ -133,6 +213,18 @@ namespace WAVM { namespace LLVMJIT {
 			return zext(boolValue, llvmContext.i32Type);
 		}
 
+		// Forgets any bounded addresses computed from the value of a local variable.
+		void invalidateBoundedLocalAddresses(llvm::Value* localPointer)
+		{
+			boundedLocalAddresses.erase(
+				std::remove_if(boundedLocalAddresses.begin(),
+							   boundedLocalAddresses.end(),
+							   [localPointer](const BoundedLocalAddress& boundedLocalAddress) {
+								   return boundedLocalAddress.localPointer == localPointer;
+							   }),
+				boundedLocalAddresses.end());
+		}
+
 		// Converts a bounded memory address to a LLVM pointer.
 		llvm::Value* coerceAddressToPointer(llvm::Value* boundedAddress,
 											llvm::Type* memoryType,
@@ -154,6 +246,22 @@ namespace WAVM { namespace LLVMJIT {
 										arguments);
 		}
 
+		// Calls the epochDeadlineReached intrinsic if the compartment's epoch has reached the
+		// context's epoch deadline.
+		void emitEpochDeadlineCheck();
+
+		// Traps with a stack overflow if the stack pointer is below the context's stack limit.
+		void emitStackLimitCheck();
+
+		// Forwards the call to the function's tiered-up code if it has been compiled, and
+		// otherwise counts the call, and calls the tierUpFunction intrinsic when the count reaches
+		// tierUpCallThreshold.
+		void emitTierUpCheck();
+
+		// Charges the fuel for the next operator, starting a new run if the operator isn't in the
+		// same basic block as the previous one.
+		void chargeFuelForOperator();
+
 		// A helper function to emit a conditional call to a non-returning intrinsic function.
 		void emitConditionalTrapIntrinsic(llvm::Value* booleanCondition,
 										  const char* intrinsicName,
@@ -266,6 +374,13 @@ namespace WAVM { namespace LLVMJIT {
 									  llvm::Value* trueValue,
 									  llvm::Value* falseValue);
 
+		// Returns an i32 that is 1 if all the lanes of a vector are non-zero, or 0 otherwise.
+		llvm::Value* emitAllTrue(llvm::Value* vector, FixedVectorType* vectorType);
+
+		// Returns the sum of the lanes of a vector as an i32, using a native horizontal add where
+		// the target has one.
+		llvm::Value* emitReduceAddToI32(llvm::Value* vector);
+
 		void trapIfMisalignedAtomic(llvm::Value* address, U32 naturalAlignmentLog2);
 
 		struct CatchContext
@@ -284,6 +399,23 @@ namespace WAVM { namespace LLVMJIT {
 
 		std::vector<CatchContext> catchStack;
 
+		// Emits the code that runs when the function returns, before the return or a tail call.
+		void emitFunctionExitHooks();
+
+		// Whether a return_call to a function of the callee type can be emitted as a tail call.
+		bool canEmitTailCall(IR::FunctionType calleeType);
+
+		// Emits a call, or if isTailCall is true, a tail call that returns the callee's results from
+		// the function and terminates the current block.
+		ValueVector emitCallOrTailCall(llvm::Value* callee,
+									   llvm::ArrayRef<llvm::Value*> args,
+									   IR::FunctionType calleeType,
+									   bool calleeMaySwitchContext,
+									   bool isTailCall);
+
+		void emitCall(IR::FunctionImm imm, bool isTailCall);
+		void emitCallIndirect(IR::CallIndirectImm imm, bool isTailCall);
+
 		void endTryWithoutCatch();
 		void endTryCatch();
 		void exitCatch();
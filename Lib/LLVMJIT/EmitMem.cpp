@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "EmitContext.h"
 #include "EmitFunctionContext.h"
 #include "EmitModuleContext.h"
@@ -10,6 +11,7 @@
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/Constant.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
@@ -19,6 +21,7 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 #include <llvm/Support/AtomicOrdering.h>
+#include <llvm/Support/KnownBits.h>
 
 #if LLVM_VERSION_MAJOR >= 10
 #include <llvm/IR/IntrinsicsAArch64.h>
@@ -37,6 +40,11 @@ enum class BoundsCheckOp
 
 static llvm::Value* getMemoryNumPages(EmitFunctionContext& functionContext, Uptr memoryIndex)
 {
+	// A memory whose minimum and maximum sizes are equal can't grow, so its size is a constant.
+	const MemoryType memoryType = functionContext.moduleContext.getMemoryType(memoryIndex);
+	if(memoryType.size.min == memoryType.size.max)
+	{ return emitLiteralIptr(memoryType.size.min, functionContext.moduleContext.iptrType); }
+
 	llvm::Constant* memoryOffset = functionContext.moduleContext.memoryOffsets[memoryIndex];
 
 	// Load the number of memory pages from the compartment runtime data.
@@ -71,8 +79,7 @@ static llvm::Value* getOffsetAndBoundedAddress(EmitFunctionContext& functionCont
 											   U64 offset,
 											   BoundsCheckOp boundsCheckOp)
 {
-	const MemoryType& memoryType
-		= functionContext.moduleContext.irModule.memories.getType(memoryIndex);
+	const MemoryType memoryType = functionContext.moduleContext.getMemoryType(memoryIndex);
 	const bool is32bitMemoryOn64bitHost
 		= memoryType.indexType == IndexType::i32
 		  && functionContext.moduleContext.iptrValueType == ValueType::i64;
@@ -123,7 +130,70 @@ static llvm::Value* getOffsetAndBoundedAddress(EmitFunctionContext& functionCont
 		}
 	}
 
-	if(boundsCheckOp == BoundsCheckOp::trapOnOutOfBounds)
+	// Memories never shrink below their minimum size, so a constant address that is within the
+	// minimum size doesn't need to be bounds checked.
+	const U64 memoryMinNumBytes = memoryType.size.min >= UINT64_MAX / IR::numBytesPerPage
+									  ? UINT64_MAX
+									  : memoryType.size.min * IR::numBytesPerPage;
+	bool isStaticallyInBounds = false;
+	if(llvm::ConstantInt* constantAddress = llvm::dyn_cast<llvm::ConstantInt>(address))
+	{
+		if(llvm::ConstantInt* constantNumBytes = llvm::dyn_cast<llvm::ConstantInt>(numBytes))
+		{
+			const U64 addressValue = constantAddress->getZExtValue();
+			const U64 numBytesValue = constantNumBytes->getZExtValue();
+			isStaticallyInBounds = numBytesValue <= memoryMinNumBytes
+								   && addressValue <= memoryMinNumBytes - numBytesValue;
+		}
+	}
+
+	// If the address was read from a local variable, find the local's alloca so the clamped
+	// address can be reused by later accesses through the same local.
+	llvm::Value* addressLocalPointer = nullptr;
+	if(!isStaticallyInBounds && boundsCheckOp == BoundsCheckOp::clampToGuardRegion
+	   && !is32bitMemoryOn64bitHost && offset < Runtime::memoryNumGuardBytes)
+	{
+		llvm::Value* localValue = address;
+		if(llvm::ZExtInst* zext = llvm::dyn_cast<llvm::ZExtInst>(localValue))
+		{ localValue = zext->getOperand(0); }
+		if(llvm::LoadInst* load = llvm::dyn_cast<llvm::LoadInst>(localValue))
+		{
+			llvm::Value* pointer = load->getPointerOperand();
+			if(std::find(functionContext.localPointers.begin(),
+						 functionContext.localPointers.end(),
+						 pointer)
+			   != functionContext.localPointers.end())
+			{ addressLocalPointer = pointer; }
+		}
+	}
+
+	llvm::BasicBlock* insertBlock = irBuilder.GetInsertBlock();
+	llvm::Value* reusedBoundedAddress = nullptr;
+	if(addressLocalPointer)
+	{
+		for(const auto& boundedLocalAddress : functionContext.boundedLocalAddresses)
+		{
+			if(boundedLocalAddress.memoryIndex == memoryIndex
+			   && boundedLocalAddress.localPointer == addressLocalPointer
+			   && boundedLocalAddress.block == insertBlock
+			   && boundedLocalAddress.numMemoryBaseReloads == functionContext.numMemoryBaseReloads)
+			{
+				reusedBoundedAddress = boundedLocalAddress.boundedAddress;
+				break;
+			}
+		}
+	}
+
+	if(isStaticallyInBounds)
+	{
+		// The address is known to be in bounds, so it doesn't need to be checked or clamped.
+	}
+	else if(reusedBoundedAddress)
+	{
+		// The local's value was already clamped in this basic block.
+		address = reusedBoundedAddress;
+	}
+	else if(boundsCheckOp == BoundsCheckOp::trapOnOutOfBounds)
 	{
 		// If the caller requires a trap, test whether the addressed bytes are within the bounds of
 		// the memory, and if not call a trap intrinsic.
@@ -156,12 +226,52 @@ static llvm::Value* getOffsetAndBoundedAddress(EmitFunctionContext& functionCont
 	{
 		// For all other cases (e.g. 64-bit addresses on 64-bit targets), it's not possible for the
 		// runtime to reserve the full range of addresses, so this function must clamp addresses to
-		// the guard region.
-
-		llvm::Value* endAddress
-			= irBuilder.CreateLoad(functionContext.memoryInfos[memoryIndex].endAddressVariable);
+		// the guard region. The runtime reserves as much address space for 64-bit memories with a
+		// small maximum size as for 32-bit memories, so their addresses can be clamped to a constant
+		// instead of the memory's end address. A memory whose minimum and maximum sizes are equal
+		// has at least its size reserved, so its addresses can be clamped to the size.
+		llvm::Value* endAddress;
+		if(memoryType.size.min == memoryType.size.max
+		   && memoryType.size.min < UINT64_MAX / IR::numBytesPerPage)
+		{
+			endAddress = emitLiteralIptr(memoryType.size.min * IR::numBytesPerPage,
+										 functionContext.moduleContext.iptrType);
+		}
+		else if(memoryType.indexType == IndexType::i64
+		   && memoryType.size.max <= Runtime::memory64NumClampedBytes / IR::numBytesPerPage)
+		{
+			endAddress = emitLiteralIptr(Runtime::memory64NumClampedBytes,
+										 functionContext.moduleContext.iptrType);
+		}
+		else
+		{
+			endAddress = irBuilder.CreateLoad(
+				functionContext.memoryInfos[memoryIndex].endAddressVariable);
+		}
 		address = irBuilder.CreateSelect(
 			irBuilder.CreateICmpULT(address, endAddress), address, endAddress);
+
+		if(addressLocalPointer)
+		{
+			// Drop entries that can no longer be reused before adding the new one.
+			std::vector<EmitFunctionContext::BoundedLocalAddress>& boundedLocalAddresses
+				= functionContext.boundedLocalAddresses;
+			boundedLocalAddresses.erase(
+				std::remove_if(
+					boundedLocalAddresses.begin(),
+					boundedLocalAddresses.end(),
+					[&](const EmitFunctionContext::BoundedLocalAddress& boundedLocalAddress) {
+						return boundedLocalAddress.block != insertBlock
+							   || boundedLocalAddress.numMemoryBaseReloads
+									  != functionContext.numMemoryBaseReloads;
+					}),
+				boundedLocalAddresses.end());
+			boundedLocalAddresses.push_back({memoryIndex,
+											 addressLocalPointer,
+											 insertBlock,
+											 functionContext.numMemoryBaseReloads,
+											 address});
+		}
 	}
 
 	// If the offset is less than the size of the guard region, then add it after bounds checking.
@@ -200,6 +310,23 @@ llvm::Value* EmitFunctionContext::coerceAddressToPointer(llvm::Value* boundedAdd
 void EmitFunctionContext::memory_grow(MemoryImm imm)
 {
 	llvm::Value* deltaNumPages = pop();
+
+	// A memory whose minimum and maximum sizes are equal can't grow, so growing it by zero pages
+	// returns its size, and growing it by any other number of pages fails. This avoids the call,
+	// and reloading the memory bases after it.
+	const MemoryType memoryType = moduleContext.getMemoryType(imm.memoryIndex);
+	if(memoryType.size.min == memoryType.size.max)
+	{
+		llvm::Value* isDeltaZero = irBuilder.CreateICmpEQ(
+			deltaNumPages, llvm::Constant::getNullValue(deltaNumPages->getType()));
+		push(coerceIptrToIndex(
+			memoryType.indexType,
+			irBuilder.CreateSelect(isDeltaZero,
+								   getMemoryNumPages(*this, imm.memoryIndex),
+								   emitLiteralIptr(UINT64_MAX, moduleContext.iptrType))));
+		return;
+	}
+
 	ValueVector resultTuple = emitRuntimeIntrinsic(
 		"memory.grow",
 		FunctionType(TypeTuple(moduleContext.iptrValueType),
@@ -208,12 +335,15 @@ void EmitFunctionContext::memory_grow(MemoryImm imm)
 		{zext(deltaNumPages, moduleContext.iptrType),
 		 getMemoryIdFromOffset(moduleContext.memoryOffsets[imm.memoryIndex])});
 	WAVM_ASSERT(resultTuple.size() == 1);
-	const MemoryType& memoryType = moduleContext.irModule.memories.getType(imm.memoryIndex);
+
+	// Growing a movable memory may move it to a larger reservation of address space.
+	if(Runtime::isMovableMemoryType(memoryType)) { reloadMemoryBases(); }
+
 	push(coerceIptrToIndex(memoryType.indexType, resultTuple[0]));
 }
 void EmitFunctionContext::memory_size(MemoryImm imm)
 {
-	const MemoryType& memoryType = moduleContext.irModule.memories.getType(imm.memoryIndex);
+	const MemoryType memoryType = moduleContext.getMemoryType(imm.memoryIndex);
 	push(coerceIptrToIndex(memoryType.indexType, getMemoryNumPages(*this, imm.memoryIndex)));
 }
 
@@ -253,6 +383,98 @@ void EmitFunctionContext::data_drop(DataSegmentImm imm)
 		{moduleContext.instanceId, emitLiteralIptr(imm.dataSegmentIndex, moduleContext.iptrType)});
 }
 
+// Emits a memory.copy or memory.fill of numBytes bytes whose range has been bounds checked. If
+// numBytes isn't a constant, lengths of up to 16 bytes are handled inline, which avoids calling
+// memmove or memset for the short copies and fills that are common in compiled code: a length in
+// [N, 2N] is accessed as two possibly overlapping N-byte accesses at the start and end of the
+// range, for N = 8, 4, 2, or 1. emitInlineAccesses(type, lastOffset) emits the two accesses of
+// the given type at offsets 0 and lastOffset, and emitCall emits the memmove or memset. Constant
+// lengths are left to emitCall, since LLVM already expands small constant lengths inline.
+template<typename EmitInlineAccesses, typename EmitCall>
+static void emitBulkMemoryOp(EmitFunctionContext& functionContext,
+							 llvm::Value* numBytesUptr,
+							 EmitInlineAccesses&& emitInlineAccesses,
+							 EmitCall&& emitCall)
+{
+	if(llvm::isa<llvm::ConstantInt>(numBytesUptr))
+	{
+		emitCall();
+		return;
+	}
+
+	llvm::IRBuilder<>& irBuilder = functionContext.irBuilder;
+	LLVMContext& llvmContext = functionContext.llvmContext;
+	llvm::Type* iptrType = functionContext.moduleContext.iptrType;
+	auto callBlock
+		= llvm::BasicBlock::Create(llvmContext, "bulkMemory_call", functionContext.function);
+	auto endBlock
+		= llvm::BasicBlock::Create(llvmContext, "bulkMemory_end", functionContext.function);
+
+	auto inlineBlock
+		= llvm::BasicBlock::Create(llvmContext, "bulkMemory_inline", functionContext.function);
+	irBuilder.CreateCondBr(
+		irBuilder.CreateICmpULE(numBytesUptr, emitLiteralIptr(16, iptrType)),
+		inlineBlock,
+		callBlock);
+
+	// Branch to the accesses of the largest size that is at most the length. A zero length
+	// branches directly to the end.
+	irBuilder.SetInsertPoint(inlineBlock);
+	llvm::Type* accessTypes[4] = {
+		llvmContext.i64Type, llvmContext.i32Type, llvmContext.i16Type, llvmContext.i8Type};
+	for(Uptr accessTypeIndex = 0; accessTypeIndex < 4; ++accessTypeIndex)
+	{
+		const U64 numAccessBytes = U64(8) >> accessTypeIndex;
+		auto accessBlock = llvm::BasicBlock::Create(
+			llvmContext, "bulkMemory_inlineAccess", functionContext.function);
+		auto nextBlock = accessTypeIndex == 3
+							 ? endBlock
+							 : llvm::BasicBlock::Create(
+								 llvmContext, "bulkMemory_inline", functionContext.function);
+		irBuilder.CreateCondBr(
+			irBuilder.CreateICmpUGE(numBytesUptr, emitLiteralIptr(numAccessBytes, iptrType)),
+			accessBlock,
+			nextBlock);
+
+		irBuilder.SetInsertPoint(accessBlock);
+		emitInlineAccesses(
+			accessTypes[accessTypeIndex],
+			irBuilder.CreateSub(numBytesUptr, emitLiteralIptr(numAccessBytes, iptrType)));
+		irBuilder.CreateBr(endBlock);
+
+		irBuilder.SetInsertPoint(nextBlock);
+	}
+
+	irBuilder.SetInsertPoint(callBlock);
+	emitCall();
+	irBuilder.CreateBr(endBlock);
+
+	irBuilder.SetInsertPoint(endBlock);
+}
+
+// Emits an unaligned load or store of a value at an offset from a byte pointer.
+static llvm::Value* emitUnalignedLoad(llvm::IRBuilder<>& irBuilder,
+									  llvm::Value* bytePointer,
+									  llvm::Value* offset,
+									  llvm::Type* type)
+{
+	llvm::LoadInst* load = irBuilder.CreateLoad(irBuilder.CreatePointerCast(
+		irBuilder.CreateInBoundsGEP(bytePointer, offset), type->getPointerTo()));
+	load->setAlignment(LLVM_ALIGNMENT(1));
+	return load;
+}
+static void emitUnalignedStore(llvm::IRBuilder<>& irBuilder,
+							   llvm::Value* value,
+							   llvm::Value* bytePointer,
+							   llvm::Value* offset)
+{
+	llvm::StoreInst* store = irBuilder.CreateStore(
+		value,
+		irBuilder.CreatePointerCast(irBuilder.CreateInBoundsGEP(bytePointer, offset),
+									value->getType()->getPointerTo()));
+	store->setAlignment(LLVM_ALIGNMENT(1));
+}
+
 void EmitFunctionContext::memory_copy(MemoryCopyImm imm)
 {
 	llvm::Value* numBytes = pop();
@@ -271,13 +493,32 @@ void EmitFunctionContext::memory_copy(MemoryCopyImm imm)
 
 	llvm::Value* numBytesUptr = irBuilder.CreateZExt(numBytes, moduleContext.iptrType);
 
-	// Use the LLVM memmove instruction to do the copy.
+	// Both ranges were bounds checked above, so the copy can't fault, and it doesn't need to be
+	// volatile. Short copies are done inline, and longer copies use the LLVM memmove instruction,
+	// which calls the host's memmove. The inline copies load both values before storing either, so
+	// they are correct if the ranges overlap.
+	emitBulkMemoryOp(
+		*this,
+		numBytesUptr,
+		[&](llvm::Type* type, llvm::Value* lastOffset) {
+			llvm::Value* firstOffset = emitLiteralIptr(0, moduleContext.iptrType);
+			llvm::Value* firstValue = emitUnalignedLoad(irBuilder, sourcePointer, firstOffset, type);
+			llvm::Value* lastValue = emitUnalignedLoad(irBuilder, sourcePointer, lastOffset, type);
+			emitUnalignedStore(irBuilder, firstValue, destPointer, firstOffset);
+			emitUnalignedStore(irBuilder, lastValue, destPointer, lastOffset);
+		},
+		[&] {
 #if LLVM_VERSION_MAJOR < 7
-	irBuilder.CreateMemMove(destPointer, sourcePointer, numBytesUptr, 1, true);
+			irBuilder.CreateMemMove(destPointer, sourcePointer, numBytesUptr, 1, false);
 #else
-	irBuilder.CreateMemMove(
-		destPointer, LLVM_ALIGNMENT(1), sourcePointer, LLVM_ALIGNMENT(1), numBytesUptr, true);
+			irBuilder.CreateMemMove(destPointer,
+									LLVM_ALIGNMENT(1),
+									sourcePointer,
+									LLVM_ALIGNMENT(1),
+									numBytesUptr,
+									false);
 #endif
+		});
 }
 
 void EmitFunctionContext::memory_fill(MemoryImm imm)
@@ -293,12 +534,46 @@ void EmitFunctionContext::memory_fill(MemoryImm imm)
 
 	llvm::Value* numBytesUptr = irBuilder.CreateZExt(numBytes, moduleContext.iptrType);
 
-	// Use the LLVM memset instruction to do the fill.
-	irBuilder.CreateMemSet(destPointer,
-						   irBuilder.CreateTrunc(value, llvmContext.i8Type),
-						   numBytesUptr,
-						   LLVM_ALIGNMENT(1),
-						   true);
+	// Like memory.copy, the range was bounds checked above, so the fill doesn't need to be
+	// volatile. Short fills are done inline by storing the byte repeated in a wider value, and
+	// longer fills use the LLVM memset instruction.
+	llvm::Value* byteValue = irBuilder.CreateTrunc(value, llvmContext.i8Type);
+	emitBulkMemoryOp(
+		*this,
+		numBytesUptr,
+		[&](llvm::Type* type, llvm::Value* lastOffset) {
+			const U64 numBits = type->getIntegerBitWidth();
+			llvm::Value* repeatedValue = irBuilder.CreateMul(
+				irBuilder.CreateZExt(byteValue, type),
+				llvm::ConstantInt::get(type, U64(0x0101010101010101) >> (64 - numBits)));
+			emitUnalignedStore(irBuilder,
+							   repeatedValue,
+							   destPointer,
+							   emitLiteralIptr(0, moduleContext.iptrType));
+			emitUnalignedStore(irBuilder, repeatedValue, destPointer, lastOffset);
+		},
+		[&] {
+			irBuilder.CreateMemSet(destPointer, byteValue, numBytesUptr, LLVM_ALIGNMENT(1), false);
+		});
+}
+
+//
+// Memory control operators.
+//
+
+void EmitFunctionContext::memory_discard(MemoryImm imm)
+{
+	auto numBytes = pop();
+	auto address = pop();
+	emitRuntimeIntrinsic("memory.discard",
+						 FunctionType({},
+									  TypeTuple({moduleContext.iptrValueType,
+												 moduleContext.iptrValueType,
+												 moduleContext.iptrValueType}),
+									  IR::CallingConvention::intrinsic),
+						 {zext(address, moduleContext.iptrType),
+						  zext(numBytes, moduleContext.iptrType),
+						  getMemoryIdFromOffset(moduleContext.memoryOffsets[imm.memoryIndex])});
 }
 
 //
@@ -508,32 +783,28 @@ static void emitLoadInterleaved(EmitFunctionContext& functionContext,
 	}
 	else
 	{
-		llvm::Value* loads[maxVectors];
+		// Load all the vectors at once as a single vector with numVectors times as many lanes, and
+		// deinterleave it with a strided shuffle for each result. Unlike inserting and extracting
+		// each lane, the shuffles are lowered to the widest registers and best shuffle
+		// instructions that the target CPU supports (e.g. PSHUFB with SSSE3, or VPERMT2B with
+		// AVX-512 VBMI).
+		llvm::Type* wideVectorType = FixedVectorType::get(
+			llvm::cast<FixedVectorType>(llvmValueType)->getElementType(), numVectors * numLanes);
+		auto load = functionContext.irBuilder.CreateLoad(
+			functionContext.irBuilder.CreatePointerCast(pointer, wideVectorType->getPointerTo()));
+		/* Don't trust the alignment hint provided by the WebAssembly code, since the load
+		 * can't trap if it's wrong. */
+		load->setAlignment(LLVM_ALIGNMENT(1));
+		load->setVolatile(true);
 		for(U32 vectorIndex = 0; vectorIndex < numVectors; ++vectorIndex)
 		{
-			auto load
-				= functionContext.irBuilder.CreateLoad(functionContext.irBuilder.CreateInBoundsGEP(
-					pointer, {emitLiteral(functionContext.llvmContext, U32(vectorIndex))}));
-			/* Don't trust the alignment hint provided by the WebAssembly code, since the load
-			 * can't trap if it's wrong. */
-			load->setAlignment(LLVM_ALIGNMENT(1));
-			load->setVolatile(true);
-			loads[vectorIndex] = load;
-		}
-		for(U32 vectorIndex = 0; vectorIndex < numVectors; ++vectorIndex)
-		{
-			llvm::Value* deinterleavedVector = llvm::UndefValue::get(llvmValueType);
+			LLVM_LANE_INDEX_TYPE laneIndices[maxLanes];
 			for(U32 laneIndex = 0; laneIndex < numLanes; ++laneIndex)
-			{
-				const Uptr interleavedElementIndex = laneIndex * numVectors + vectorIndex;
-				deinterleavedVector = functionContext.irBuilder.CreateInsertElement(
-					deinterleavedVector,
-					functionContext.irBuilder.CreateExtractElement(
-						loads[interleavedElementIndex / numLanes],
-						interleavedElementIndex % numLanes),
-					laneIndex);
-			}
-			functionContext.push(deinterleavedVector);
+			{ laneIndices[laneIndex] = LLVM_LANE_INDEX_TYPE(laneIndex * numVectors + vectorIndex); }
+			functionContext.push(functionContext.irBuilder.CreateShuffleVector(
+				load,
+				llvm::UndefValue::get(wideVectorType),
+				llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numLanes)));
 		}
 	}
 }
@@ -579,27 +850,61 @@ static void emitStoreInterleaved(EmitFunctionContext& functionContext,
 	}
 	else
 	{
+		// Concatenate the vectors into a single vector with numVectors times as many lanes, then
+		// interleave it with a single shuffle, and store it at once. Like emitLoadInterleaved, this
+		// lets the shuffle be lowered to the best instructions that the target CPU supports.
+		static constexpr U32 maxLanes = 16;
+		WAVM_ASSERT(numLanes <= maxLanes);
+		LLVM_LANE_INDEX_TYPE laneIndices[maxVectors * maxLanes];
+		for(U32 laneIndex = 0; laneIndex < numLanes * 2; ++laneIndex)
+		{ laneIndices[laneIndex] = LLVM_LANE_INDEX_TYPE(laneIndex); }
+
+		// Concatenate pairs of vectors, padding 3 vectors to 4 with an undefined vector, and then
+		// concatenate the pairs.
+		llvm::Value* concatenatedVector;
+		if(numVectors == 2)
+		{
+			concatenatedVector = functionContext.irBuilder.CreateShuffleVector(
+				values[0],
+				values[1],
+				llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numLanes * 2));
+		}
+		else
+		{
+			llvm::Value* lowPair = functionContext.irBuilder.CreateShuffleVector(
+				values[0],
+				values[1],
+				llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numLanes * 2));
+			llvm::Value* highPair = functionContext.irBuilder.CreateShuffleVector(
+				values[2],
+				numVectors == 4 ? values[3] : llvm::UndefValue::get(llvmValueType),
+				llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numLanes * 2));
+			for(U32 laneIndex = 0; laneIndex < numLanes * 4; ++laneIndex)
+			{ laneIndices[laneIndex] = LLVM_LANE_INDEX_TYPE(laneIndex); }
+			concatenatedVector = functionContext.irBuilder.CreateShuffleVector(
+				lowPair, highPair, llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numLanes * 4));
+		}
+
+		// Interleave the lanes of the concatenated vectors.
 		for(U32 vectorIndex = 0; vectorIndex < numVectors; ++vectorIndex)
 		{
-			llvm::Value* interleavedVector = llvm::UndefValue::get(llvmValueType);
 			for(U32 laneIndex = 0; laneIndex < numLanes; ++laneIndex)
 			{
-				const Uptr interleavedElementIndex = vectorIndex * numLanes + laneIndex;
-				const Uptr deinterleavedVectorIndex = interleavedElementIndex % numVectors;
-				const Uptr deinterleavedLaneIndex = interleavedElementIndex / numVectors;
-				interleavedVector = functionContext.irBuilder.CreateInsertElement(
-					interleavedVector,
-					functionContext.irBuilder.CreateExtractElement(values[deinterleavedVectorIndex],
-																   deinterleavedLaneIndex),
-					laneIndex);
+				laneIndices[laneIndex * numVectors + vectorIndex]
+					= LLVM_LANE_INDEX_TYPE(vectorIndex * numLanes + laneIndex);
 			}
-			auto store = functionContext.irBuilder.CreateStore(
-				interleavedVector,
-				functionContext.irBuilder.CreateInBoundsGEP(
-					pointer, {emitLiteral(functionContext.llvmContext, U32(vectorIndex))}));
-			store->setVolatile(true);
-			store->setAlignment(LLVM_ALIGNMENT(1));
 		}
+		llvm::Value* interleavedVector = functionContext.irBuilder.CreateShuffleVector(
+			concatenatedVector,
+			llvm::UndefValue::get(concatenatedVector->getType()),
+			llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(laneIndices, numVectors * numLanes));
+
+		auto store = functionContext.irBuilder.CreateStore(
+			interleavedVector,
+			functionContext.irBuilder.CreatePointerCast(
+				pointer, interleavedVector->getType()->getPointerTo()));
+		store->setVolatile(true);
+		store->setAlignment(LLVM_ALIGNMENT(1));
 	}
 }
 
@@ -653,9 +958,60 @@ EMIT_STORE_INTERLEAVED_OP(v64x2_store_interleaved_2, llvmContext.i64x2Type, 4, 2
 EMIT_STORE_INTERLEAVED_OP(v64x2_store_interleaved_3, llvmContext.i64x2Type, 4, 3, 2)
 EMIT_STORE_INTERLEAVED_OP(v64x2_store_interleaved_4, llvmContext.i64x2Type, 4, 4, 2)
 
+// Returns the number of low bits of an address that are known to be zero. This looks through the
+// additions and clamping done by getOffsetAndBoundedAddress: a memory's end address is a multiple
+// of the page size, which LLVM's known bits analysis can't know, since it is loaded from the
+// context.
+static U32 getNumKnownZeroLowBits(EmitFunctionContext& functionContext,
+								  llvm::Value* address,
+								  Uptr depth = 0)
+{
+	static constexpr Uptr maxDepth = 6;
+	if(depth < maxDepth)
+	{
+		if(llvm::SelectInst* select = llvm::dyn_cast<llvm::SelectInst>(address))
+		{
+			return std::min(
+				getNumKnownZeroLowBits(functionContext, select->getTrueValue(), depth + 1),
+				getNumKnownZeroLowBits(functionContext, select->getFalseValue(), depth + 1));
+		}
+		else if(llvm::LoadInst* load = llvm::dyn_cast<llvm::LoadInst>(address))
+		{
+			for(const EmitContext::MemoryInfo& memoryInfo : functionContext.memoryInfos)
+			{
+				if(load->getPointerOperand() == memoryInfo.endAddressVariable)
+				{ return U32(IR::numBytesPerPageLog2); }
+			}
+		}
+		else if(llvm::ZExtInst* zext = llvm::dyn_cast<llvm::ZExtInst>(address))
+		{
+			return getNumKnownZeroLowBits(functionContext, zext->getOperand(0), depth + 1);
+		}
+		else if(llvm::BinaryOperator* binaryOp = llvm::dyn_cast<llvm::BinaryOperator>(address))
+		{
+			// The sum or bitwise or of two values has at least as many low zero bits as the
+			// operand with the fewest.
+			if(binaryOp->getOpcode() == llvm::Instruction::Add
+			   || binaryOp->getOpcode() == llvm::Instruction::Or)
+			{
+				return std::min(
+					getNumKnownZeroLowBits(functionContext, binaryOp->getOperand(0), depth + 1),
+					getNumKnownZeroLowBits(functionContext, binaryOp->getOperand(1), depth + 1));
+			}
+		}
+	}
+
+	const llvm::KnownBits knownBits = llvm::computeKnownBits(
+		address, functionContext.moduleContext.llvmModule->getDataLayout());
+	return U32(knownBits.countMinTrailingZeros());
+}
+
 void EmitFunctionContext::trapIfMisalignedAtomic(llvm::Value* address, U32 alignmentLog2)
 {
-	if(alignmentLog2 > 0)
+	// Addresses that are provably aligned, e.g. constants, or multiples of the access size added
+	// to them, don't need to be checked. The LLVM optimizer can't always prove it after the
+	// check is emitted, because the address is clamped to the memory's end address.
+	if(alignmentLog2 > 0 && getNumKnownZeroLowBits(*this, address) < alignmentLog2)
 	{
 		emitConditionalTrapIntrinsic(
 			irBuilder.CreateICmpNE(
@@ -668,6 +1024,17 @@ void EmitFunctionContext::trapIfMisalignedAtomic(llvm::Value* address, U32 align
 	}
 }
 
+// Returns the ordering of the atomic accesses to a memory. Accesses to a shared memory are
+// sequentially consistent. A memory that isn't shared can't be accessed by other threads, so
+// atomic accesses to it only need to be single-copy atomic, and don't need any barriers.
+static llvm::AtomicOrdering getAtomicOrdering(EmitFunctionContext& functionContext,
+											  Uptr memoryIndex)
+{
+	return functionContext.moduleContext.getMemoryType(memoryIndex).isShared
+			   ? llvm::AtomicOrdering::SequentiallyConsistent
+			   : llvm::AtomicOrdering::Monotonic;
+}
+
 void EmitFunctionContext::memory_atomic_notify(AtomicLoadOrStoreImm<2> imm)
 {
 	llvm::Value* numWaiters = pop();
@@ -769,8 +1136,8 @@ void EmitFunctionContext::atomic_fence(AtomicFenceImm imm)
 		auto pointer = coerceAddressToPointer(boundedAddress, llvmMemoryType, imm.memoryIndex);    \
 		auto load = irBuilder.CreateLoad(pointer);                                                 \
 		load->setAlignment(LLVM_ALIGNMENT(U64(1) << imm.alignmentLog2));                           \
-		load->setVolatile(true);                                                                   \
-		load->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);                             \
+		load->setAtomic(getAtomicOrdering(*this, imm.memoryIndex));                                \
+		load->setVolatile(load->getOrdering() == llvm::AtomicOrdering::SequentiallyConsistent);    \
 		push(memToValue(load, asLLVMType(llvmContext, ValueType::valueTypeId)));                   \
 	}
 #define EMIT_ATOMIC_STORE_OP(valueTypeId, name, llvmMemoryType, numBytesLog2, valueToMem)          \
@@ -789,9 +1156,9 @@ void EmitFunctionContext::atomic_fence(AtomicFenceImm imm)
 		auto pointer = coerceAddressToPointer(boundedAddress, llvmMemoryType, imm.memoryIndex);    \
 		auto memoryValue = valueToMem(value, llvmMemoryType);                                      \
 		auto store = irBuilder.CreateStore(memoryValue, pointer);                                  \
-		store->setVolatile(true);                                                                  \
 		store->setAlignment(LLVM_ALIGNMENT(U64(1) << imm.alignmentLog2));                          \
-		store->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);                            \
+		store->setAtomic(getAtomicOrdering(*this, imm.memoryIndex));                               \
+		store->setVolatile(store->getOrdering() == llvm::AtomicOrdering::SequentiallyConsistent);  \
 	}
 EMIT_ATOMIC_LOAD_OP(i32, atomic_load, llvmContext.i32Type, 2, identity)
 EMIT_ATOMIC_LOAD_OP(i64, atomic_load, llvmContext.i64Type, 3, identity)
@@ -827,13 +1194,10 @@ EMIT_ATOMIC_STORE_OP(i64, atomic_store32, llvmContext.i32Type, 2, trunc)
 			BoundsCheckOp::clampToGuardRegion);                                                    \
 		trapIfMisalignedAtomic(boundedAddress, numBytesLog2);                                      \
 		auto pointer = coerceAddressToPointer(boundedAddress, llvmMemoryType, imm.memoryIndex);    \
-		auto atomicCmpXchg                                                                         \
-			= irBuilder.CreateAtomicCmpXchg(pointer,                                               \
-											expectedValue,                                         \
-											replacementValue,                                      \
-											llvm::AtomicOrdering::SequentiallyConsistent,          \
-											llvm::AtomicOrdering::SequentiallyConsistent);         \
-		atomicCmpXchg->setVolatile(true);                                                          \
+		const llvm::AtomicOrdering ordering = getAtomicOrdering(*this, imm.memoryIndex);           \
+		auto atomicCmpXchg = irBuilder.CreateAtomicCmpXchg(                                        \
+			pointer, expectedValue, replacementValue, ordering, ordering);                         \
+		atomicCmpXchg->setVolatile(ordering == llvm::AtomicOrdering::SequentiallyConsistent);      \
 		auto previousValue = irBuilder.CreateExtractValue(atomicCmpXchg, {0});                     \
 		push(memToValue(previousValue, asLLVMType(llvmContext, ValueType::valueTypeId)));          \
 	}
@@ -862,11 +1226,10 @@ EMIT_ATOMIC_CMPXCHG(i64, atomic_rmw_cmpxchg, llvmContext.i64Type, 3, identity, i
 			BoundsCheckOp::clampToGuardRegion);                                                    \
 		trapIfMisalignedAtomic(boundedAddress, numBytesLog2);                                      \
 		auto pointer = coerceAddressToPointer(boundedAddress, llvmMemoryType, imm.memoryIndex);    \
-		auto atomicRMW = irBuilder.CreateAtomicRMW(llvm::AtomicRMWInst::BinOp::rmwOpId,            \
-												   pointer,                                        \
-												   value,                                          \
-												   llvm::AtomicOrdering::SequentiallyConsistent);  \
-		atomicRMW->setVolatile(true);                                                              \
+		const llvm::AtomicOrdering ordering = getAtomicOrdering(*this, imm.memoryIndex);           \
+		auto atomicRMW = irBuilder.CreateAtomicRMW(                                                \
+			llvm::AtomicRMWInst::BinOp::rmwOpId, pointer, value, ordering);                        \
+		atomicRMW->setVolatile(ordering == llvm::AtomicOrdering::SequentiallyConsistent);          \
 		push(memToValue(atomicRMW, asLLVMType(llvmContext, ValueType::valueTypeId)));              \
 	}
 
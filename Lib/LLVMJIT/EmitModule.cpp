@@ -1,15 +1,27 @@
 #include <stdint.h>
+#include <algorithm>
 #include <vector>
 #include "EmitFunctionContext.h"
 #include "EmitModuleContext.h"
 #include "LLVMJITPrivate.h"
 #include "WAVM/IR/Module.h"
+#include "WAVM/IR/Operators.h"
 #include "WAVM/IR/Types.h"
+#include "WAVM/IR/Validate.h"
+#include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/LEB128.h"
+#include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Logging/Trace.h"
+#include "WAVM/WASM/WASM.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/ADT/Twine.h>
+#include <llvm/AsmParser/Parser.h>
 #include <llvm/BinaryFormat/Dwarf.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DIBuilder.h>
@@ -21,6 +33,8 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/SourceMgr.h>
 POP_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 
 namespace llvm {
@@ -35,12 +49,14 @@ using namespace WAVM::Runtime;
 EmitModuleContext::EmitModuleContext(const IR::Module& inIRModule,
 									 LLVMContext& inLLVMContext,
 									 llvm::Module* inLLVMModule,
-									 llvm::TargetMachine* inTargetMachine)
+									 llvm::TargetMachine* inTargetMachine,
+									 DebugInfoLevel inDebugInfoLevel)
 : irModule(inIRModule)
 , llvmContext(inLLVMContext)
 , llvmModule(inLLVMModule)
 , targetMachine(inTargetMachine)
 , defaultTableOffset(nullptr)
+, debugInfoLevel(inDebugInfoLevel)
 , diBuilder(*inLLVMModule)
 {
 	targetArch = targetMachine->getTargetTriple().getArch();
@@ -60,41 +76,52 @@ EmitModuleContext::EmitModuleContext(const IR::Module& inIRModule,
 	default: Errors::fatalf("Unexpected pointer size: %u bytes", numPointerBytes);
 	};
 
-	diModuleScope = diBuilder.createFile("unknown", "unknown");
+	if(debugInfoLevel != DebugInfoLevel::none)
+	{
+		const llvm::DICompileUnit::DebugEmissionKind emissionKind
+			= debugInfoLevel == DebugInfoLevel::full
+				  ? llvm::DICompileUnit::DebugEmissionKind::FullDebug
+				  : llvm::DICompileUnit::DebugEmissionKind::LineTablesOnly;
+		diModuleScope = diBuilder.createFile("unknown", "unknown");
 #if LLVM_VERSION_MAJOR >= 9
-	diCompileUnit
-		= diBuilder.createCompileUnit(0xffff,
-									  diModuleScope,
-									  "WAVM",
-									  true,
-									  "",
-									  0,
-									  llvm::StringRef(),
-									  llvm::DICompileUnit::DebugEmissionKind::LineTablesOnly,
-									  0,
-									  true,
-									  false,
-									  llvm::DICompileUnit::DebugNameTableKind::None,
-									  false);
+		diCompileUnit = diBuilder.createCompileUnit(0xffff,
+													diModuleScope,
+													"WAVM",
+													true,
+													"",
+													0,
+													llvm::StringRef(),
+													emissionKind,
+													0,
+													true,
+													false,
+													llvm::DICompileUnit::DebugNameTableKind::None,
+													false);
 #else
-	diCompileUnit = diBuilder.createCompileUnit(0xffff, diModuleScope, "WAVM", true, "", 0);
+		diCompileUnit = diBuilder.createCompileUnit(
+			0xffff, diModuleScope, "WAVM", true, "", 0, llvm::StringRef(), emissionKind);
 #endif
+	}
 
-	diValueTypes[(Uptr)ValueType::any] = nullptr;
-	diValueTypes[(Uptr)ValueType::i32]
-		= diBuilder.createBasicType("i32", 32, llvm::dwarf::DW_ATE_signed);
-	diValueTypes[(Uptr)ValueType::i64]
-		= diBuilder.createBasicType("i64", 64, llvm::dwarf::DW_ATE_signed);
-	diValueTypes[(Uptr)ValueType::f32]
-		= diBuilder.createBasicType("f32", 32, llvm::dwarf::DW_ATE_float);
-	diValueTypes[(Uptr)ValueType::f64]
-		= diBuilder.createBasicType("f64", 64, llvm::dwarf::DW_ATE_float);
-	diValueTypes[(Uptr)ValueType::v128]
-		= diBuilder.createBasicType("v128", 128, llvm::dwarf::DW_ATE_signed);
-	diValueTypes[(Uptr)ValueType::externref]
-		= diBuilder.createBasicType("externref", 8, llvm::dwarf::DW_ATE_address);
-	diValueTypes[(Uptr)ValueType::funcref]
-		= diBuilder.createBasicType("funcref", 8, llvm::dwarf::DW_ATE_address);
+	// Line tables don't include the types of the functions' parameters, so only create them for
+	// full debug info.
+	if(debugInfoLevel == DebugInfoLevel::full)
+	{
+		diValueTypes[(Uptr)ValueType::i32]
+			= diBuilder.createBasicType("i32", 32, llvm::dwarf::DW_ATE_signed);
+		diValueTypes[(Uptr)ValueType::i64]
+			= diBuilder.createBasicType("i64", 64, llvm::dwarf::DW_ATE_signed);
+		diValueTypes[(Uptr)ValueType::f32]
+			= diBuilder.createBasicType("f32", 32, llvm::dwarf::DW_ATE_float);
+		diValueTypes[(Uptr)ValueType::f64]
+			= diBuilder.createBasicType("f64", 64, llvm::dwarf::DW_ATE_float);
+		diValueTypes[(Uptr)ValueType::v128]
+			= diBuilder.createBasicType("v128", 128, llvm::dwarf::DW_ATE_signed);
+		diValueTypes[(Uptr)ValueType::externref]
+			= diBuilder.createBasicType("externref", 8, llvm::dwarf::DW_ATE_address);
+		diValueTypes[(Uptr)ValueType::funcref]
+			= diBuilder.createBasicType("funcref", 8, llvm::dwarf::DW_ATE_address);
+	}
 
 	auto zeroAsMetadata = llvm::ConstantAsMetadata::get(emitLiteral(llvmContext, I32(0)));
 	auto i32MaxAsMetadata = llvm::ConstantAsMetadata::get(emitLiteral(llvmContext, I32(INT32_MAX)));
@@ -121,13 +148,784 @@ static llvm::Constant* createImportedConstant(llvm::Module& llvmModule, llvm::Tw
 									externalName);
 }
 
+// Statistics about a function's code that determine how it is compiled: the number of operators
+// decides whether it is inlined into its callers, and each conditional branch has a pair of
+// profile counters in an instrumented function.
+struct FunctionCodeStats
+{
+	typedef void Result;
+
+	Uptr numOperators = 0;
+	Uptr numConditionalBranches = 0;
+
+#define VISIT_OP(_1, name, _2, Imm, ...)                                                           \
+	void name(Imm)                                                                                 \
+	{                                                                                              \
+		++numOperators;                                                                            \
+		if(Opcode::name == Opcode::if_ || Opcode::name == Opcode::br_if)                           \
+		{ ++numConditionalBranches; }                                                              \
+	}
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+};
+
+static void validateFunctionDef(ModuleValidationState& state, const FunctionDef& functionDef)
+{
+	CodeValidationStream validationStream(state, functionDef);
+	OperatorDecoderStream decoder(functionDef.code);
+	while(decoder) { decoder.decodeOp(validationStream); }
+	validationStream.finish();
+}
+
+static FunctionCodeStats getFunctionCodeStats(const FunctionDef& functionDef)
+{
+	FunctionCodeStats codeStats;
+	OperatorDecoderStream decoder(functionDef.code);
+	while(decoder) { decoder.decodeOp(codeStats); }
+	return codeStats;
+}
+
+// Reads the "wavm.noinline" custom section: a LEB128 vector of the indices of functions that
+// should not be inlined into their callers. The section is only a hint, so a malformed section is
+// ignored.
+static std::vector<bool> getNoInlineHints(const IR::Module& irModule)
+{
+	std::vector<bool> noInlineHints(irModule.functions.size(), false);
+	for(const CustomSection& customSection : irModule.customSections)
+	{
+		if(customSection.name != "wavm.noinline") { continue; }
+
+		try
+		{
+			Serialization::MemoryInputStream stream(customSection.data.data(),
+													customSection.data.size());
+			std::vector<U32> functionIndices;
+			Serialization::serializeArray(
+				stream,
+				functionIndices,
+				[](Serialization::MemoryInputStream& stream, U32& functionIndex) {
+					serializeVarUInt32(stream, functionIndex);
+				});
+			for(U32 functionIndex : functionIndices)
+			{
+				if(functionIndex < noInlineHints.size()) { noInlineHints[functionIndex] = true; }
+			}
+		}
+		catch(Serialization::FatalSerializationException const&)
+		{
+			Log::printf(Log::debug, "Ignoring malformed wavm.noinline section.\n");
+		}
+	}
+	return noInlineHints;
+}
+
+// Finds the tables that may be changed by the module's code after instantiation.
+struct TableMutationFinder
+{
+	typedef void Result;
+
+	std::vector<bool>& isTableMutable;
+
+	TableMutationFinder(std::vector<bool>& inIsTableMutable) : isTableMutable(inIsTableMutable) {}
+
+#define VISIT_OP(_1, name, _2, Imm, ...)                                                           \
+	void name(Imm imm) { visitOp(Opcode::name, imm); }
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+	// If the code is validated while it's emitted, it hasn't been validated yet, so the table
+	// indices are checked before they're used.
+	template<typename Imm> void visitOp(Opcode, Imm) {}
+	void visitOp(Opcode opcode, TableImm imm)
+	{
+		if(opcode == Opcode::table_set || opcode == Opcode::table_fill)
+		{ setTableMutable(imm.tableIndex); }
+	}
+	void visitOp(Opcode opcode, TableCopyImm imm)
+	{
+		if(opcode == Opcode::table_copy) { setTableMutable(imm.destTableIndex); }
+	}
+	void visitOp(Opcode opcode, ElemSegmentAndTableImm imm)
+	{
+		if(opcode == Opcode::table_init) { setTableMutable(imm.tableIndex); }
+	}
+	void setTableMutable(Uptr tableIndex)
+	{
+		if(tableIndex < isTableMutable.size()) { isTableMutable[tableIndex] = true; }
+	}
+};
+
+// Finds the functions that are called or referenced by a function's code.
+struct FunctionReferenceFinder
+{
+	typedef void Result;
+
+	std::vector<Uptr>& outFunctionIndices;
+
+	FunctionReferenceFinder(std::vector<Uptr>& inOutFunctionIndices)
+	: outFunctionIndices(inOutFunctionIndices)
+	{
+	}
+
+#define VISIT_OP(_1, name, _2, Imm, ...)                                                           \
+	void name(Imm imm) { visitOp(Opcode::name, imm); }
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+	template<typename Imm> void visitOp(Opcode, Imm) {}
+	void visitOp(Opcode, FunctionImm imm) { outFunctionIndices.push_back(imm.functionIndex); }
+	void visitOp(Opcode, FunctionRefImm imm) { outFunctionIndices.push_back(imm.functionIndex); }
+};
+
+// Determines which function definitions can be called. A function definition can be called if it
+// is exported, the start function, referenced by an elem segment or global initializer, or called
+// or referenced by the code of another function definition that can be called. Indirect calls can
+// only reach functions that were written to a table, which requires one of those references.
+static std::vector<bool> findLiveFunctionDefs(const IR::Module& irModule)
+{
+	std::vector<Uptr> pendingFunctionIndices;
+	for(const Export& export_ : irModule.exports)
+	{
+		if(export_.kind == ExternKind::function) { pendingFunctionIndices.push_back(export_.index); }
+	}
+	if(irModule.startFunctionIndex != UINTPTR_MAX)
+	{ pendingFunctionIndices.push_back(irModule.startFunctionIndex); }
+	for(const GlobalDef& globalDef : irModule.globals.defs)
+	{
+		if(globalDef.initializer.type == InitializerExpression::Type::ref_func)
+		{ pendingFunctionIndices.push_back(globalDef.initializer.ref); }
+	}
+	for(const ElemSegment& elemSegment : irModule.elemSegments)
+	{
+		const ElemSegment::Contents& contents = *elemSegment.contents;
+		if(contents.encoding == ElemSegment::Encoding::index)
+		{
+			if(contents.externKind != ExternKind::function) { continue; }
+			for(Uptr functionIndex : contents.elemIndices)
+			{ pendingFunctionIndices.push_back(functionIndex); }
+		}
+		else
+		{
+			for(const ElemExpr& elemExpr : contents.elemExprs)
+			{
+				if(elemExpr.type == ElemExpr::Type::ref_func)
+				{ pendingFunctionIndices.push_back(elemExpr.index); }
+			}
+		}
+	}
+
+	const Uptr numImports = irModule.functions.imports.size();
+	std::vector<bool> isFunctionDefLive(irModule.functions.defs.size(), false);
+	FunctionReferenceFinder functionReferenceFinder(pendingFunctionIndices);
+	while(pendingFunctionIndices.size())
+	{
+		const Uptr functionIndex = pendingFunctionIndices.back();
+		pendingFunctionIndices.pop_back();
+
+		// If the code is validated while it's emitted, an invalid function index may be found
+		// before the code is validated.
+		if(functionIndex < numImports || functionIndex >= irModule.functions.size()
+		   || isFunctionDefLive[functionIndex - numImports])
+		{ continue; }
+
+		isFunctionDefLive[functionIndex - numImports] = true;
+		OperatorDecoderStream decoder(irModule.functions.defs[functionIndex - numImports].code);
+		while(decoder) { decoder.decodeOp(functionReferenceFinder); }
+	}
+
+	return isFunctionDefLive;
+}
+
+// Finds the memories that a function's code uses, the functions it calls directly, and whether it
+// has an operator that may switch the context: a call to an imported function, an indirect call,
+// or growing a memory that may move, which changes the base pointer the context holds for it.
+// Calls to imports that a specialization inlines or calls the pure native function of can't
+// switch the context.
+struct ContextUsageFinder
+{
+	typedef void Result;
+
+	const IR::Module& irModule;
+	const ModuleSpecialization* specialization;
+	const Uptr numImportedFunctions;
+	std::vector<bool>& isMemoryUsed;
+	std::vector<Uptr>& outCalleeIndices;
+	bool maySwitchContext = false;
+
+	ContextUsageFinder(const IR::Module& inIRModule,
+					   const ModuleSpecialization* inSpecialization,
+					   std::vector<bool>& inIsMemoryUsed,
+					   std::vector<Uptr>& inOutCalleeIndices)
+	: irModule(inIRModule)
+	, specialization(inSpecialization)
+	, numImportedFunctions(inIRModule.functions.imports.size())
+	, isMemoryUsed(inIsMemoryUsed)
+	, outCalleeIndices(inOutCalleeIndices)
+	{
+	}
+
+#define VISIT_OP(_1, name, _2, Imm, ...)                                                           \
+	void name(Imm imm) { visitOp(Opcode::name, imm); }
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+	template<typename Imm> void visitOp(Opcode, Imm) {}
+	template<Uptr naturalAlignmentLog2>
+	void visitOp(Opcode, LoadOrStoreImm<naturalAlignmentLog2> imm)
+	{
+		setMemoryUsed(imm.memoryIndex);
+	}
+	template<Uptr naturalAlignmentLog2, Uptr numLanes>
+	void visitOp(Opcode, LoadOrStoreLaneImm<naturalAlignmentLog2, numLanes> imm)
+	{
+		setMemoryUsed(imm.memoryIndex);
+	}
+	template<Uptr naturalAlignmentLog2>
+	void visitOp(Opcode, AtomicLoadOrStoreImm<naturalAlignmentLog2> imm)
+	{
+		setMemoryUsed(imm.memoryIndex);
+	}
+	void visitOp(Opcode opcode, MemoryImm imm)
+	{
+		setMemoryUsed(imm.memoryIndex);
+		if(opcode == Opcode::memory_grow && imm.memoryIndex < irModule.memories.size()
+		   && Runtime::isMovableMemoryType(irModule.memories.getType(imm.memoryIndex)))
+		{ maySwitchContext = true; }
+	}
+	void visitOp(Opcode, MemoryCopyImm imm)
+	{
+		setMemoryUsed(imm.destMemoryIndex);
+		setMemoryUsed(imm.sourceMemoryIndex);
+	}
+	void visitOp(Opcode, DataSegmentAndMemImm imm) { setMemoryUsed(imm.memoryIndex); }
+	void visitOp(Opcode opcode, FunctionImm imm)
+	{
+		if(opcode != Opcode::call && opcode != Opcode::return_call) { return; }
+		if(imm.functionIndex < numImportedFunctions)
+		{
+			if(!isContextFreeImport(imm.functionIndex)) { maySwitchContext = true; }
+		}
+		else
+		{
+			outCalleeIndices.push_back(imm.functionIndex);
+		}
+	}
+	void visitOp(Opcode, CallIndirectImm) { maySwitchContext = true; }
+	bool isContextFreeImport(Uptr importIndex) const
+	{
+		if(!specialization) { return false; }
+		const std::vector<std::string>& inlineLLVMIR = specialization->functionImportInlineLLVMIR;
+		const std::vector<bool>& pureNativeImports = specialization->pureNativeFunctionImports;
+		return (importIndex < inlineLLVMIR.size() && inlineLLVMIR[importIndex].size())
+			   || (importIndex < pureNativeImports.size() && pureNativeImports[importIndex]);
+	}
+	void setMemoryUsed(Uptr memoryIndex)
+	{
+		if(memoryIndex < isMemoryUsed.size()) { isMemoryUsed[memoryIndex] = true; }
+	}
+};
+
+// Determines which memories each function definition uses, and which function definitions may
+// switch the context. Calls to a function that can't switch the context return the caller's
+// context, so the caller doesn't need to reload its memory base pointers after the call, and a
+// function only needs to reload the base pointers of the memories it uses. A function may switch
+// the context if it calls an imported function, makes an indirect call, grows a memory that may
+// move, or calls a function definition that may switch the context.
+static void findContextUsage(const IR::Module& irModule,
+							 const ModuleSpecialization* specialization,
+							 std::vector<std::vector<bool>>& outIsMemoryUsed,
+							 std::vector<bool>& outMaySwitchContext)
+{
+	const Uptr numImports = irModule.functions.imports.size();
+	const Uptr numDefs = irModule.functions.defs.size();
+	outIsMemoryUsed.assign(numDefs, std::vector<bool>(irModule.memories.size(), false));
+	outMaySwitchContext.assign(numDefs, false);
+
+	// Find the direct callers of each function definition, and the function definitions that
+	// may switch the context themselves.
+	std::vector<std::vector<Uptr>> callerDefIndices(numDefs);
+	std::vector<Uptr> pendingDefIndices;
+	std::vector<Uptr> calleeIndices;
+	for(Uptr defIndex = 0; defIndex < numDefs; ++defIndex)
+	{
+		calleeIndices.clear();
+		ContextUsageFinder finder(
+			irModule, specialization, outIsMemoryUsed[defIndex], calleeIndices);
+		OperatorDecoderStream decoder(irModule.functions.defs[defIndex].code);
+		while(decoder) { decoder.decodeOp(finder); }
+
+		// If the code is validated while it's emitted, an invalid function index may be found
+		// before the code is validated.
+		for(Uptr calleeIndex : calleeIndices)
+		{
+			if(calleeIndex < irModule.functions.size())
+			{ callerDefIndices[calleeIndex - numImports].push_back(defIndex); }
+		}
+
+		if(finder.maySwitchContext)
+		{
+			outMaySwitchContext[defIndex] = true;
+			pendingDefIndices.push_back(defIndex);
+		}
+	}
+
+	// Propagate the functions that may switch the context to their callers.
+	while(pendingDefIndices.size())
+	{
+		const Uptr defIndex = pendingDefIndices.back();
+		pendingDefIndices.pop_back();
+		for(Uptr callerDefIndex : callerDefIndices[defIndex])
+		{
+			if(!outMaySwitchContext[callerDefIndex])
+			{
+				outMaySwitchContext[callerDefIndex] = true;
+				pendingDefIndices.push_back(callerDefIndex);
+			}
+		}
+	}
+}
+
+// Returns whether a global may be cached as a stack pointer: a mutable i32 or i64 that isn't
+// exported, so only the module's code and the functions it calls can access it.
+static bool isStackPointerCandidate(const IR::Module& irModule, Uptr globalIndex)
+{
+	if(globalIndex >= irModule.globals.size()) { return false; }
+	const GlobalType globalType = irModule.globals.getType(globalIndex);
+	if(!globalType.isMutable
+	   || (globalType.valueType != ValueType::i32 && globalType.valueType != ValueType::i64))
+	{ return false; }
+	for(const Export& export_ : irModule.exports)
+	{
+		if(export_.kind == ExternKind::global && export_.index == globalIndex) { return false; }
+	}
+	return true;
+}
+
+// Finds a global that is used like the stack pointer of a stack in linear memory: a function
+// prologue that allocates a frame with global.get, a constant, and a subtract.
+struct StackPointerPrologueFinder
+{
+	typedef void Result;
+
+	const IR::Module& irModule;
+	Uptr globalIndex = UINTPTR_MAX;
+	Uptr numPrologueOps = 0;
+	Uptr foundGlobalIndex = UINTPTR_MAX;
+
+	StackPointerPrologueFinder(const IR::Module& inIRModule) : irModule(inIRModule) {}
+
+#define VISIT_OP(_1, name, _2, Imm, ...)                                                           \
+	void name(Imm imm) { visitOp(Opcode::name, imm); }
+	WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+	template<typename Imm> void visitOp(Opcode opcode, Imm) { visitPrologueOp(opcode); }
+	void visitOp(Opcode opcode, GetOrSetVariableImm<true> imm)
+	{
+		visitPrologueOp(opcode);
+		if(opcode == Opcode::global_get)
+		{
+			globalIndex = imm.variableIndex;
+			numPrologueOps = 1;
+		}
+	}
+	void visitPrologueOp(Opcode opcode)
+	{
+		if(numPrologueOps == 1 && (opcode == Opcode::i32_const || opcode == Opcode::i64_const))
+		{ numPrologueOps = 2; }
+		else if(numPrologueOps == 2 && (opcode == Opcode::i32_sub || opcode == Opcode::i64_sub))
+		{
+			if(isStackPointerCandidate(irModule, globalIndex)) { foundGlobalIndex = globalIndex; }
+			numPrologueOps = 0;
+		}
+		else
+		{
+			numPrologueOps = 0;
+		}
+	}
+};
+
+// Finds the global that the module's toolchain uses as the stack pointer, by its name or by the
+// prologues that use it. Returns UINTPTR_MAX if there isn't one.
+static Uptr findStackPointerGlobal(const IR::Module& irModule)
+{
+	DisassemblyNames names;
+	getDisassemblyNames(irModule, names);
+	for(Uptr globalIndex = 0; globalIndex < names.globals.size(); ++globalIndex)
+	{
+		if(names.globals[globalIndex] == "__stack_pointer"
+		   && isStackPointerCandidate(irModule, globalIndex))
+		{ return globalIndex; }
+	}
+
+	StackPointerPrologueFinder finder(irModule);
+	for(const FunctionDef& functionDef : irModule.functions.defs)
+	{
+		OperatorDecoderStream decoder(functionDef.code);
+		while(decoder && finder.foundGlobalIndex == UINTPTR_MAX) { decoder.decodeOp(finder); }
+		if(finder.foundGlobalIndex != UINTPTR_MAX) { break; }
+	}
+	return finder.foundGlobalIndex;
+}
+
+// Determines the function that each element of the module's immutable tables is initialized to.
+// A table is immutable if it is a funcref table defined by the module that isn't shared or
+// exported, and the module's code never writes to it.
+static void findImmutableTableElements(const IR::Module& irModule,
+									   std::vector<std::vector<Uptr>>& outTableElements)
+{
+	std::vector<bool> isTableMutable(irModule.tables.size(), false);
+	for(Uptr tableIndex = 0; tableIndex < irModule.tables.size(); ++tableIndex)
+	{
+		const TableType& tableType = irModule.tables.getType(tableIndex);
+		if(irModule.tables.isImport(tableIndex) || tableType.isShared
+		   || tableType.elementType != ReferenceType::funcref)
+		{ isTableMutable[tableIndex] = true; }
+	}
+	for(const Export& export_ : irModule.exports)
+	{
+		if(export_.kind == ExternKind::table) { isTableMutable[export_.index] = true; }
+	}
+
+	TableMutationFinder tableMutationFinder(isTableMutable);
+	for(const FunctionDef& functionDef : irModule.functions.defs)
+	{
+		OperatorDecoderStream decoder(functionDef.code);
+		while(decoder) { decoder.decodeOp(tableMutationFinder); }
+	}
+
+	// Apply the active elem segments to the immutable tables in the same order as instantiation.
+	outTableElements.resize(irModule.tables.size());
+	for(const ElemSegment& elemSegment : irModule.elemSegments)
+	{
+		if(elemSegment.type != ElemSegment::Type::active
+		   || isTableMutable[elemSegment.tableIndex])
+		{ continue; }
+
+		// If the segment's offset isn't constant, the table's elements can't be known.
+		Uptr baseOffset;
+		if(elemSegment.baseOffset.type == InitializerExpression::Type::i32_const)
+		{ baseOffset = U32(elemSegment.baseOffset.i32); }
+		else if(elemSegment.baseOffset.type == InitializerExpression::Type::i64_const)
+		{
+			baseOffset = Uptr(elemSegment.baseOffset.i64);
+		}
+		else
+		{
+			isTableMutable[elemSegment.tableIndex] = true;
+			continue;
+		}
+
+		const ElemSegment::Contents& contents = *elemSegment.contents;
+		const Uptr numElems = contents.encoding == ElemSegment::Encoding::expr
+								  ? contents.elemExprs.size()
+								  : contents.elemIndices.size();
+		const TableType& tableType = irModule.tables.getType(elemSegment.tableIndex);
+		if(baseOffset > tableType.size.min || numElems > tableType.size.min - baseOffset)
+		{
+			// Segments that are out of bounds cause instantiation to fail.
+			isTableMutable[elemSegment.tableIndex] = true;
+			continue;
+		}
+
+		std::vector<Uptr>& tableElements = outTableElements[elemSegment.tableIndex];
+		if(tableElements.size() < baseOffset + numElems)
+		{ tableElements.resize(baseOffset + numElems, UINTPTR_MAX); }
+		for(Uptr elemIndex = 0; elemIndex < numElems; ++elemIndex)
+		{
+			Uptr functionIndex = UINTPTR_MAX;
+			if(contents.encoding == ElemSegment::Encoding::index)
+			{
+				WAVM_ASSERT(contents.externKind == ExternKind::function);
+				functionIndex = contents.elemIndices[elemIndex];
+			}
+			else if(contents.elemExprs[elemIndex].type == ElemExpr::Type::ref_func)
+			{
+				functionIndex = contents.elemExprs[elemIndex].index;
+			}
+			tableElements[baseOffset + elemIndex] = functionIndex;
+		}
+	}
+
+	for(Uptr tableIndex = 0; tableIndex < irModule.tables.size(); ++tableIndex)
+	{
+		if(isTableMutable[tableIndex]) { outTableElements[tableIndex].clear(); }
+	}
+}
+
+// Creates the array of profile counters for an instrumented function definition. The array is
+// defined by the object, and bound to the function's FunctionMutableData when it is loaded.
+static llvm::Constant* createProfileCounters(EmitModuleContext& moduleContext,
+											 const FunctionCodeStats& codeStats,
+											 Uptr functionDefIndex)
+{
+	LLVMContext& llvmContext = moduleContext.llvmContext;
+	llvm::ArrayType* countersType
+		= llvm::ArrayType::get(llvmContext.i64Type, 1 + codeStats.numConditionalBranches * 2);
+	llvm::GlobalVariable* counters
+		= new llvm::GlobalVariable(*moduleContext.llvmModule,
+								   countersType,
+								   false,
+								   llvm::GlobalVariable::ExternalLinkage,
+								   llvm::ConstantAggregateZero::get(countersType),
+								   getExternalName("profileCounters", functionDefIndex));
+	counters->setAlignment(LLVM_ALIGNMENT(sizeof(U64)));
+	return llvm::ConstantExpr::getPointerCast(counters, llvmContext.i64Type->getPointerTo());
+}
+
+// Creates the call and cycle counts of a function definition that counts its calls. Like the
+// profile counters, they are defined by the object, and bound to the function's
+// FunctionMutableData when it is loaded.
+static llvm::Constant* createFunctionStats(EmitModuleContext& moduleContext, Uptr functionDefIndex)
+{
+	LLVMContext& llvmContext = moduleContext.llvmContext;
+	llvm::ArrayType* statsType = llvm::ArrayType::get(llvmContext.i64Type, 2);
+	llvm::GlobalVariable* stats
+		= new llvm::GlobalVariable(*moduleContext.llvmModule,
+								   statsType,
+								   false,
+								   llvm::GlobalVariable::ExternalLinkage,
+								   llvm::ConstantAggregateZero::get(statsType),
+								   getExternalName("functionStats", functionDefIndex));
+	stats->setAlignment(LLVM_ALIGNMENT(sizeof(U64)));
+	return llvm::ConstantExpr::getPointerCast(stats, llvmContext.i64Type->getPointerTo());
+}
+
+// Creates the tier-up state of a function definition that tiers up. Like the function's stats, it
+// is defined by the object, and bound to the function's FunctionMutableData when it is loaded.
+static llvm::Constant* createTierUpState(EmitModuleContext& moduleContext, Uptr functionDefIndex)
+{
+	LLVMContext& llvmContext = moduleContext.llvmContext;
+	llvm::ArrayType* stateType = llvm::ArrayType::get(moduleContext.iptrType, 2);
+	llvm::GlobalVariable* state
+		= new llvm::GlobalVariable(*moduleContext.llvmModule,
+								   stateType,
+								   false,
+								   llvm::GlobalVariable::ExternalLinkage,
+								   llvm::ConstantAggregateZero::get(stateType),
+								   getExternalName("tierUpState", functionDefIndex));
+	state->setAlignment(LLVM_ALIGNMENT(sizeof(Uptr)));
+	return llvm::ConstantExpr::getPointerCast(state, llvmContext.i8PtrType);
+}
+
+// Parses the LLVM IR of a function import's inline body, and links it into the module. The IR must
+// define a single function with the import's parameter types, returning its result or void, and
+// may only declare LLVM intrinsics.
+static llvm::Function* linkInlineFunctionImport(EmitModuleContext& moduleContext,
+												Uptr importIndex,
+												const std::string& llvmIR)
+{
+	LLVMContext& llvmContext = moduleContext.llvmContext;
+	const FunctionType functionType
+		= moduleContext.irModule.types[moduleContext.irModule.functions.getType(importIndex).index];
+
+	llvm::SMDiagnostic parseError;
+	std::unique_ptr<llvm::Module> inlineModule
+		= llvm::parseAssemblyString(llvmIR, parseError, llvmContext);
+	if(!inlineModule)
+	{
+		Errors::fatalf("Failed to parse the inline LLVM IR of function import %" WAVM_PRIuPTR
+					   ": %s",
+					   importIndex,
+					   parseError.getMessage().str().c_str());
+	}
+
+	llvm::Function* body = nullptr;
+	for(llvm::Function& function : *inlineModule)
+	{
+		if(!function.isDeclaration())
+		{
+			if(body)
+			{
+				Errors::fatalf("The inline LLVM IR of function import %" WAVM_PRIuPTR
+							   " defines more than one function",
+							   importIndex);
+			}
+			body = &function;
+		}
+		else if(!function.isIntrinsic())
+		{
+			Errors::fatalf("The inline LLVM IR of function import %" WAVM_PRIuPTR
+						   " declares a function that isn't an LLVM intrinsic",
+						   importIndex);
+		}
+	}
+	if(!body || !inlineModule->global_empty() || functionType.results().size() > 1)
+	{
+		Errors::fatalf("The inline LLVM IR of function import %" WAVM_PRIuPTR
+					   " must define a single function, and no global variables",
+					   importIndex);
+	}
+
+	llvm::Type** llvmParamTypes
+		= (llvm::Type**)alloca(sizeof(llvm::Type*) * functionType.params().size());
+	for(Uptr paramIndex = 0; paramIndex < functionType.params().size(); ++paramIndex)
+	{ llvmParamTypes[paramIndex] = asLLVMType(llvmContext, functionType.params()[paramIndex]); }
+	llvm::FunctionType* llvmFunctionType = llvm::FunctionType::get(
+		functionType.results().size() ? asLLVMType(llvmContext, functionType.results()[0])
+									  : llvm::Type::getVoidTy(llvmContext),
+		llvm::ArrayRef<llvm::Type*>(llvmParamTypes, functionType.params().size()),
+		false);
+	if(body->getFunctionType() != llvmFunctionType)
+	{
+		Errors::fatalf("The inline LLVM IR of function import %" WAVM_PRIuPTR
+					   " doesn't match the import's type",
+					   importIndex);
+	}
+
+	// Give the body a name that's unique in the module. It's external while linking, since the
+	// linker only links internal definitions that something else in the source module uses.
+	const std::string name = getExternalName("inlineFunctionImport", importIndex);
+	body->setName(name);
+	body->setLinkage(llvm::GlobalValue::ExternalLinkage);
+	body->addFnAttr(llvm::Attribute::AlwaysInline);
+	inlineModule->setDataLayout(moduleContext.llvmModule->getDataLayout());
+	inlineModule->setTargetTriple(moduleContext.llvmModule->getTargetTriple());
+	if(llvm::Linker::linkModules(*moduleContext.llvmModule, std::move(inlineModule)))
+	{
+		Errors::fatalf("Failed to link the inline LLVM IR of function import %" WAVM_PRIuPTR,
+					   importIndex);
+	}
+
+	llvm::Function* linkedBody = moduleContext.llvmModule->getFunction(name);
+	WAVM_ERROR_UNLESS(linkedBody);
+	linkedBody->setLinkage(llvm::GlobalValue::InternalLinkage);
+	return linkedBody;
+}
+
+std::vector<U8> LLVMJIT::getEmitModuleContextKey(const IR::Module& irModule,
+												 const CompileOptions& options)
+{
+	std::vector<U8> key;
+	auto appendBytes = [&key](const void* data, Uptr numBytes) {
+		key.insert(key.end(), (const U8*)data, (const U8*)data + numBytes);
+	};
+	auto appendU64 = [&appendBytes](U64 value) { appendBytes(&value, sizeof(value)); };
+
+	// Serialize the module without its function bodies and the contents of its data segments,
+	// which are copied into memories when the module is instantiated, so they don't affect the
+	// code.
+	{
+		IR::Module contextModule(irModule);
+		for(FunctionDef& functionDef : contextModule.functions.defs)
+		{
+			functionDef.code = std::vector<U8>();
+			functionDef.branchTableTargetDepths = std::vector<U32>();
+		}
+		for(DataSegment& dataSegment : contextModule.dataSegments)
+		{ dataSegment.data = std::make_shared<DataSegmentBytes>(); }
+		const std::vector<U8> contextModuleBytes = WASM::saveBinaryModule(contextModule);
+		appendU64(contextModuleBytes.size());
+		appendBytes(contextModuleBytes.data(), contextModuleBytes.size());
+	}
+
+	// Add what the code emitted for a function definition may depend on in the code of the others.
+	std::vector<std::vector<Uptr>> immutableTableElements;
+	findImmutableTableElements(irModule, immutableTableElements);
+	for(const std::vector<Uptr>& tableElements : immutableTableElements)
+	{
+		appendU64(tableElements.size());
+		for(Uptr elementFunctionIndex : tableElements) { appendU64(elementFunctionIndex); }
+	}
+
+	std::vector<std::vector<bool>> isMemoryUsedByFunctionDef;
+	std::vector<bool> functionDefMaySwitchContext;
+	findContextUsage(irModule,
+					 options.specialization.get(),
+					 isMemoryUsedByFunctionDef,
+					 functionDefMaySwitchContext);
+	for(bool maySwitchContext : functionDefMaySwitchContext) { key.push_back(maySwitchContext); }
+
+	if(options.eliminateDeadFunctions)
+	{
+		for(bool isLive : findLiveFunctionDefs(irModule)) { key.push_back(isLive); }
+	}
+	if(options.cacheStackPointer) { appendU64(findStackPointerGlobal(irModule)); }
+
+	// Add the options that affect the code.
+	appendU64(U64(options.tier));
+	appendU64(options.optimizationLevel);
+	appendU64(options.inlineThreshold);
+	key.push_back(options.instrumentProfile);
+	key.push_back(options.countFunctionCalls);
+	key.push_back(options.measureFunctionCycles);
+	key.push_back(options.checkEpochDeadline);
+	key.push_back(options.meterFuel);
+	key.push_back(options.checkStackLimit);
+	key.push_back(options.relaxedNaN);
+	key.push_back(options.cacheStackPointer);
+	key.push_back(options.shareTrapBlocks);
+	key.push_back(U8(options.debugInfoLevel));
+	key.push_back(options.eliminateDeadFunctions);
+	appendU64(options.tierUpCallThreshold);
+	if(options.profile)
+	{
+		const std::vector<U8> profileBytes = serializeProfile(*options.profile);
+		appendU64(profileBytes.size());
+		appendBytes(profileBytes.data(), profileBytes.size());
+	}
+
+	return key;
+}
+
 void LLVMJIT::emitModule(const IR::Module& irModule,
 						 LLVMContext& llvmContext,
 						 llvm::Module& outLLVMModule,
-						 llvm::TargetMachine* targetMachine)
+						 llvm::TargetMachine* targetMachine,
+						 Uptr beginFunctionDefIndex,
+						 Uptr endFunctionDefIndex,
+						 const CompileOptions& options,
+						 CompileTimeReport* timeReport)
 {
+	WAVM_ASSERT(beginFunctionDefIndex <= endFunctionDefIndex);
+	WAVM_ASSERT(endFunctionDefIndex <= irModule.functions.defs.size());
+	const Uptr numImportedFunctions = irModule.functions.imports.size();
+
+	// Find the function definitions that are defined by the LLVM module: the partition's, or the
+	// function definitions that are tiered up.
+	std::vector<Uptr> emittedFunctionDefIndices;
+	std::vector<bool> isFunctionDefEmitted(irModule.functions.defs.size(), false);
+	if(options.tierUpFunctionDefIndices)
+	{
+		WAVM_ASSERT(beginFunctionDefIndex == 0
+					&& endFunctionDefIndex == irModule.functions.defs.size());
+		emittedFunctionDefIndices = *options.tierUpFunctionDefIndices;
+	}
+	else
+	{
+		for(Uptr functionDefIndex = beginFunctionDefIndex; functionDefIndex < endFunctionDefIndex;
+			++functionDefIndex)
+		{ emittedFunctionDefIndices.push_back(functionDefIndex); }
+	}
+	for(Uptr functionDefIndex : emittedFunctionDefIndices)
+	{
+		WAVM_ERROR_UNLESS(functionDefIndex < irModule.functions.defs.size());
+		isFunctionDefEmitted[functionDefIndex] = true;
+	}
+	if(timeReport && timeReport->functionDefNanoseconds.size() < irModule.functions.defs.size())
+	{ timeReport->functionDefNanoseconds.resize(irModule.functions.defs.size(), 0); }
+
+	Trace::Scope traceScope("llvm", "emit");
 	Timing::Timer emitTimer;
-	EmitModuleContext moduleContext(irModule, llvmContext, &outLLVMModule, targetMachine);
+	EmitModuleContext moduleContext(
+		irModule, llvmContext, &outLLVMModule, targetMachine, options.debugInfoLevel);
+	if(options.specialization)
+	{
+		const ModuleSpecialization& specialization = *options.specialization;
+		WAVM_ERROR_UNLESS(specialization.globalImportValues.empty()
+						  || specialization.globalImportValues.size()
+								 == irModule.globals.imports.size());
+		WAVM_ERROR_UNLESS(specialization.memoryImportTypes.empty()
+						  || specialization.memoryImportTypes.size()
+								 == irModule.memories.imports.size());
+		WAVM_ERROR_UNLESS(specialization.functionImportInlineLLVMIR.empty()
+						  || specialization.functionImportInlineLLVMIR.size()
+								 == irModule.functions.imports.size());
+		WAVM_ERROR_UNLESS(specialization.pureNativeFunctionImports.empty()
+						  || specialization.pureNativeFunctionImports.size()
+								 == irModule.functions.imports.size());
+		moduleContext.specialization = &specialization;
+	}
 
 	// Set the module data layout for the target machine.
 	outLLVMModule.setDataLayout(targetMachine->createDataLayout());
@@ -146,6 +944,9 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 		moduleContext.typeIds.push_back(llvm::ConstantExpr::getPtrToInt(
 			createImportedConstant(outLLVMModule, getExternalName("typeId", typeIndex)),
 			moduleContext.iptrType));
+		moduleContext.typeTags.push_back(llvm::ConstantExpr::getPtrToInt(
+			createImportedConstant(outLLVMModule, getExternalName("typeTag", typeIndex)),
+			moduleContext.iptrType));
 	}
 
 	// Create LLVM external globals corresponding to offsets to table base pointers in
@@ -242,30 +1043,143 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 			llvmContext.i8PtrType);
 	}
 
-	// Create the LLVM functions.
+	// Create the LLVM functions. If the module tiers up some of an instance's function
+	// definitions, the instance's functions are bound like the function imports, and are used for
+	// the function definitions that aren't tiered up, and for references to all of them.
 	moduleContext.functions.resize(irModule.functions.size());
+	moduleContext.functionReferences.resize(irModule.functions.size());
 	for(Uptr functionIndex = 0; functionIndex < irModule.functions.size(); ++functionIndex)
 	{
 		FunctionType functionType = irModule.types[irModule.functions.getType(functionIndex).index];
+		auto createFunction = [&](const std::string& name) {
+			llvm::Function* function = llvm::Function::Create(asLLVMType(llvmContext, functionType),
+															  llvm::Function::ExternalLinkage,
+															  name,
+															  &outLLVMModule);
+			function->setCallingConv(asLLVMCallingConv(functionType.callingConvention()));
+			return function;
+		};
+
+		const bool isDef = functionIndex >= numImportedFunctions;
+		if(!isDef
+		   || (options.tierUpFunctionDefIndices
+			   && !isFunctionDefEmitted[functionIndex - numImportedFunctions]))
+		{
+			moduleContext.functions[functionIndex]
+				= createFunction(getExternalName("functionImport", functionIndex));
+			moduleContext.functionReferences[functionIndex] = moduleContext.functions[functionIndex];
+		}
+		else
+		{
+			moduleContext.functions[functionIndex] = createFunction(
+				getExternalName("functionDef", functionIndex - numImportedFunctions));
+			moduleContext.functionReferences[functionIndex]
+				= options.tierUpFunctionDefIndices
+					  ? createFunction(getExternalName("functionImport", functionIndex))
+					  : moduleContext.functions[functionIndex];
+		}
+	}
+
+	// Link the inline bodies of the function imports the module is specialized for.
+	if(moduleContext.specialization)
+	{
+		const std::vector<std::string>& inlineLLVMIR
+			= moduleContext.specialization->functionImportInlineLLVMIR;
+		moduleContext.inlineFunctionImports.resize(inlineLLVMIR.size(), nullptr);
+		for(Uptr importIndex = 0; importIndex < inlineLLVMIR.size(); ++importIndex)
+		{
+			if(inlineLLVMIR[importIndex].size())
+			{
+				moduleContext.inlineFunctionImports[importIndex] = linkInlineFunctionImport(
+					moduleContext, importIndex, inlineLLVMIR[importIndex]);
+			}
+		}
 
-		llvm::Function* function = llvm::Function::Create(
-			asLLVMType(llvmContext, functionType),
-			llvm::Function::ExternalLinkage,
-			functionIndex >= irModule.functions.imports.size()
-				? getExternalName("functionDef", functionIndex - irModule.functions.imports.size())
-				: getExternalName("functionImport", functionIndex),
-			&outLLVMModule);
-		function->setCallingConv(asLLVMCallingConv(functionType.callingConvention()));
-		moduleContext.functions[functionIndex] = function;
+		// Declare the native functions of the pure intrinsics the module is specialized for. They
+		// don't access memory or throw, so LLVM may combine, hoist, or remove calls to them.
+		const std::vector<bool>& pureNativeImports
+			= moduleContext.specialization->pureNativeFunctionImports;
+		moduleContext.pureNativeFunctionImports.resize(pureNativeImports.size(), nullptr);
+		for(Uptr importIndex = 0; importIndex < pureNativeImports.size(); ++importIndex)
+		{
+			if(pureNativeImports[importIndex])
+			{
+				const FunctionType importType
+					= irModule.types[irModule.functions.getType(importIndex).index];
+				const FunctionType nativeType(
+					importType.results(), importType.params(), CallingConvention::c);
+				llvm::Function* nativeFunction = llvm::Function::Create(
+					asLLVMType(llvmContext, nativeType),
+					llvm::Function::ExternalLinkage,
+					getExternalName("pureNativeFunctionImport", importIndex),
+					&outLLVMModule);
+				nativeFunction->setCallingConv(asLLVMCallingConv(CallingConvention::c));
+				nativeFunction->setDoesNotAccessMemory();
+				nativeFunction->setDoesNotThrow();
+				moduleContext.pureNativeFunctionImports[importIndex] = nativeFunction;
+			}
+		}
 	}
 
-	// Compile each function in the module.
-	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
-		++functionDefIndex)
+	// If the function bodies are validated while they're emitted, create the module validation
+	// state that the function bodies are validated against.
+	std::shared_ptr<ModuleValidationState> validationState;
+	if(options.validateFunctionBodies)
 	{
-		const FunctionDef& functionDef = irModule.functions.defs[functionDefIndex];
+		validationState = createModuleValidationState(irModule);
+		validatePreCodeSections(*validationState);
+	}
+
+	const std::vector<bool> noInlineHints = getNoInlineHints(irModule);
+	findImmutableTableElements(irModule, moduleContext.immutableTableElements);
+	std::vector<std::vector<bool>> isMemoryUsedByFunctionDef;
+	findContextUsage(irModule,
+					 moduleContext.specialization,
+					 isMemoryUsedByFunctionDef,
+					 moduleContext.functionDefMaySwitchContext);
+	if(options.cacheStackPointer)
+	{ moduleContext.stackPointerGlobalIndex = findStackPointerGlobal(irModule); }
+
+	// If dead functions are eliminated, the functions that can't be called are compiled as a stub
+	// that traps. The stubs keep the function indices of the other functions the same, and are
+	// much faster to compile than the dead function's code.
+	std::vector<bool> isFunctionDefLive;
+	std::vector<U8> deadFunctionCode;
+	if(options.eliminateDeadFunctions)
+	{
+		isFunctionDefLive = findLiveFunctionDefs(irModule);
+
+		Serialization::ArrayOutputStream codeStream;
+		OperatorEncoderStream encoder(codeStream);
+		encoder.unreachable();
+		encoder.end();
+		deadFunctionCode = codeStream.getBytes();
+	}
+
+	// Compile each function in the module that is defined by this partition of the module. The
+	// functions defined by other partitions are left as external declarations.
+	const bool tiersUp = options.tierUpCallThreshold && options.tier == CompileTier::baseline
+						 && !options.tierUpFunctionDefIndices;
+	for(Uptr functionDefIndex : emittedFunctionDefIndices)
+	{
+		throwIfCompileCancelled(options);
+
+		Timing::Timer functionTimer;
+		FunctionDef deadFunctionDef;
+		const bool isDead = isFunctionDefLive.size() && !isFunctionDefLive[functionDefIndex];
+		if(isDead)
+		{
+			deadFunctionDef.type = irModule.functions.defs[functionDefIndex].type;
+			deadFunctionDef.code = deadFunctionCode;
+		}
+		const FunctionDef& functionDef
+			= isDead ? deadFunctionDef : irModule.functions.defs[functionDefIndex];
+
+		// A dead function's code isn't emitted, so validate it separately.
+		if(isDead && validationState)
+		{ validateFunctionDef(*validationState, irModule.functions.defs[functionDefIndex]); }
 		llvm::Function* function
-			= moduleContext.functions[irModule.functions.imports.size() + functionDefIndex];
+			= moduleContext.functions[numImportedFunctions + functionDefIndex];
 
 		function->setPersonalityFn(personalityFunction);
 
@@ -282,11 +1196,106 @@ void LLVMJIT::emitModule(const IR::Module& irModule,
 								 moduleContext.typeIds[functionDef.type.index]);
 		setFunctionAttributes(targetMachine, function);
 
-		EmitFunctionContext(llvmContext, moduleContext, irModule, functionDef, function).emit();
+		// Inline small functions into their callers in the same partition, unless the module hints
+		// that the function shouldn't be inlined.
+		const FunctionCodeStats codeStats = getFunctionCodeStats(functionDef);
+		if(noInlineHints[numImportedFunctions + functionDefIndex])
+		{ function->addFnAttr(llvm::Attribute::NoInline); }
+		else if(codeStats.numOperators <= options.inlineThreshold)
+		{
+			function->addFnAttr(llvm::Attribute::AlwaysInline);
+		}
+
+		EmitFunctionContext functionContext(
+			llvmContext, moduleContext, irModule, functionDef, function);
+		if(options.instrumentProfile)
+		{
+			functionContext.profileCounters
+				= createProfileCounters(moduleContext, codeStats, functionDefIndex);
+		}
+		if(options.countFunctionCalls || options.measureFunctionCycles)
+		{
+			functionContext.functionStats = createFunctionStats(moduleContext, functionDefIndex);
+			functionContext.measureCycles = options.measureFunctionCycles;
+		}
+		if(tiersUp && !isDead)
+		{
+			functionContext.tierUpState = createTierUpState(moduleContext, functionDefIndex);
+			functionContext.tierUpCallThreshold = options.tierUpCallThreshold;
+		}
+		if(options.profile && functionDefIndex < options.profile->functionDefCounts.size())
+		{ functionContext.profileCounts = &options.profile->functionDefCounts[functionDefIndex]; }
+		functionContext.checkEpochDeadline = options.checkEpochDeadline;
+		functionContext.meterFuel = options.meterFuel;
+		functionContext.checkStackLimit = options.checkStackLimit;
+		functionContext.relaxedNaN = options.relaxedNaN;
+		functionContext.shareTrapBlocks = options.shareTrapBlocks;
+		functionContext.isMemoryUsed = isMemoryUsedByFunctionDef[functionDefIndex];
+		if(!isDead) { functionContext.validationState = validationState.get(); }
+		functionContext.emit();
+
+		if(timeReport)
+		{
+			timeReport->functionDefNanoseconds[functionDefIndex]
+				+= U64(functionTimer.getNanoseconds());
+		}
+	}
+
+	// If there is a profile, order the partition's function definitions by how often they were
+	// called, so the hot functions are packed together at the start of the object's code section,
+	// and the functions that were never called are at the end.
+	if(options.profile)
+	{
+		auto getEntryCount = [&](Uptr functionDefIndex) -> U64 {
+			if(functionDefIndex >= options.profile->functionDefCounts.size()) { return 0; }
+			const std::vector<U64>& counts = options.profile->functionDefCounts[functionDefIndex];
+			return counts.size() ? counts[0] : 0;
+		};
+
+		std::vector<Uptr> orderedFunctionDefIndices = emittedFunctionDefIndices;
+		std::stable_sort(orderedFunctionDefIndices.begin(),
+						 orderedFunctionDefIndices.end(),
+						 [&](Uptr left, Uptr right) {
+							 return getEntryCount(left) > getEntryCount(right);
+						 });
+
+		for(Uptr functionDefIndex : orderedFunctionDefIndices)
+		{
+			llvm::Function* function
+				= moduleContext.functions[numImportedFunctions + functionDefIndex];
+			function->removeFromParent();
+			outLLVMModule.getFunctionList().push_back(function);
+		}
+	}
+
+	// Emit an invoke thunk for the type of each exported function definition, so invoking the
+	// module's exports doesn't need to compile thunks at runtime. The thunks are only emitted by the
+	// first partition of the module, and not when tiering up an instance that already has them.
+	if(beginFunctionDefIndex == 0 && !options.tierUpFunctionDefIndices)
+	{
+		for(Uptr typeIndex : getModuleInvokeThunkTypeIndices(irModule))
+		{
+			llvm::Constant* invokeThunkMutableData = createImportedConstant(
+				outLLVMModule, getExternalName("invokeThunkMutableDatas", typeIndex));
+			emitInvokeThunk(
+				llvmContext,
+				outLLVMModule,
+				targetMachine,
+				moduleContext.iptrType,
+				irModule.types[typeIndex],
+				getExternalName("invokeThunk", typeIndex),
+				llvm::ConstantExpr::getPtrToInt(invokeThunkMutableData, moduleContext.iptrType),
+				moduleContext.typeIds[typeIndex]);
+		}
 	}
 
 	// Finalize the debug info.
 	moduleContext.diBuilder.finalize();
 
+	static Metrics::Histogram& emitNanoseconds
+		= Metrics::getHistogram("wavm_compile_emit_ir_nanoseconds",
+								"Time spent emitting the LLVM IR of a module or partition");
+	emitNanoseconds.record(U64(emitTimer.getNanoseconds()));
+	if(timeReport) { timeReport->emitIRNanoseconds += U64(emitTimer.getNanoseconds()); }
 	Timing::logRatePerSecond("Emitted LLVM IR", emitTimer, (F64)outLLVMModule.size(), "functions");
 }
@@ -25,14 +25,53 @@ namespace WAVM { namespace LLVMJIT {
 		U32 iptrAlignment;
 
 		std::vector<llvm::Constant*> typeIds;
+		std::vector<llvm::Constant*> typeTags;
 		std::vector<llvm::Function*> functions;
 		std::vector<llvm::Constant*> tableOffsets;
 		std::vector<llvm::Constant*> memoryOffsets;
 		std::vector<llvm::Constant*> globals;
 		std::vector<llvm::Constant*> exceptionTypeIds;
 
+		// The functions that are used as the addresses of the module's Runtime::Function objects.
+		// They are the same as functions, unless the module is compiled to tier up some of an
+		// instance's function definitions: references to those then refer to the instance's
+		// existing functions, rather than to the functions that replace their code.
+		std::vector<llvm::Function*> functionReferences;
+
 		llvm::Constant* defaultTableOffset;
 
+		// If the module is compiled for a specific instance's imports, the values of those imports
+		// that may be used as constants.
+		const ModuleSpecialization* specialization = nullptr;
+
+		// For each function import, the inline body that calls to it are emitted as, or null.
+		std::vector<llvm::Function*> inlineFunctionImports;
+
+		// For each function import, the native pure intrinsic that calls to it call, or null.
+		std::vector<llvm::Function*> pureNativeFunctionImports;
+
+		// For each table that can't be changed after the module is instantiated, the index of the
+		// function each of its elements is initialized to, or UINTPTR_MAX for null elements.
+		// Empty for tables that may be changed.
+		std::vector<std::vector<Uptr>> immutableTableElements;
+
+		// For each function definition, whether calling it may switch the context, or move one of
+		// its memories, and so change the caller's memory base pointers.
+		std::vector<bool> functionDefMaySwitchContext;
+
+		// Returns whether a call to a function may return a different context than it was passed.
+		bool maySwitchContext(Uptr functionIndex) const
+		{
+			const Uptr numImports = irModule.functions.imports.size();
+			return functionIndex < numImports
+				   || functionIndex - numImports >= functionDefMaySwitchContext.size()
+				   || functionDefMaySwitchContext[functionIndex - numImports];
+		}
+
+		// If CompileOptions::cacheStackPointer is set, the index of the global that the code
+		// caches in a variable as the stack pointer, or UINTPTR_MAX if there isn't one.
+		Uptr stackPointerGlobalIndex = UINTPTR_MAX;
+
 		llvm::Constant* instanceId;
 		llvm::Constant* tableReferenceBias;
 
@@ -40,11 +79,13 @@ namespace WAVM { namespace LLVMJIT {
 		llvm::Constant* unoptimizableOne;
 #endif
 
+		DebugInfoLevel debugInfoLevel;
 		llvm::DIBuilder diBuilder;
-		llvm::DICompileUnit* diCompileUnit;
-		llvm::DIFile* diModuleScope;
+		llvm::DICompileUnit* diCompileUnit = nullptr;
+		llvm::DIFile* diModuleScope = nullptr;
 
-		llvm::DIType* diValueTypes[IR::numValueTypes];
+		// Only created if debugInfoLevel is full.
+		llvm::DIType* diValueTypes[IR::numValueTypes] = {};
 
 		llvm::MDNode* likelyFalseBranchWeights;
 		llvm::MDNode* likelyTrueBranchWeights;
@@ -59,7 +100,17 @@ namespace WAVM { namespace LLVMJIT {
 		EmitModuleContext(const IR::Module& inModule,
 						  LLVMContext& inLLVMContext,
 						  llvm::Module* inLLVMModule,
-						  llvm::TargetMachine* inTargetMachine);
+						  llvm::TargetMachine* inTargetMachine,
+						  DebugInfoLevel inDebugInfoLevel);
+
+		// Returns the type of a memory. If the module is compiled with a specialization of its
+		// memory imports, returns the specialized type of an imported memory.
+		IR::MemoryType getMemoryType(Uptr memoryIndex) const
+		{
+			if(specialization && memoryIndex < specialization->memoryImportTypes.size())
+			{ return specialization->memoryImportTypes[memoryIndex]; }
+			return irModule.memories.getType(memoryIndex);
+		}
 
 		inline llvm::Function* getLLVMIntrinsic(llvm::ArrayRef<llvm::Type*> typeArguments,
 												llvm::Intrinsic::ID id)
@@ -257,45 +257,61 @@ EMIT_INT_UNARY_OP(
 // FP operators
 //
 
+// Emits a scalar FP arithmetic operator. By default, it's emitted as a constrained intrinsic, which
+// keeps LLVM from folding or transforming it in ways that change the NaN it produces. With relaxed
+// NaN semantics, it's emitted as a plain LLVM instruction, which LLVM may freely optimize.
+static llvm::Value* emitFPArithmetic(EmitFunctionContext& context,
+									 llvm::Instruction::BinaryOps opcode,
+									 llvm::Intrinsic::ID constrainedIntrinsicID,
+									 llvm::Value* left,
+									 llvm::Value* right)
+{
+	if(context.relaxedNaN) { return context.irBuilder.CreateBinOp(opcode, left, right); }
+	return context.callLLVMIntrinsic({left->getType()},
+									 constrainedIntrinsicID,
+									 {left,
+									  right,
+									  context.moduleContext.fpRoundingModeMetadata,
+									  context.moduleContext.fpExceptionMetadata});
+}
+
 EMIT_FP_BINARY_OP(add,
-				  callLLVMIntrinsic({left->getType()},
-									llvm::Intrinsic::experimental_constrained_fadd,
-									{left,
-									 right,
-									 moduleContext.fpRoundingModeMetadata,
-									 moduleContext.fpExceptionMetadata}))
+				  emitFPArithmetic(*this,
+								   llvm::Instruction::FAdd,
+								   llvm::Intrinsic::experimental_constrained_fadd,
+								   left,
+								   right))
 EMIT_FP_BINARY_OP(sub,
-				  callLLVMIntrinsic({left->getType()},
-									llvm::Intrinsic::experimental_constrained_fsub,
-									{left,
-									 right,
-									 moduleContext.fpRoundingModeMetadata,
-									 moduleContext.fpExceptionMetadata}))
+				  emitFPArithmetic(*this,
+								   llvm::Instruction::FSub,
+								   llvm::Intrinsic::experimental_constrained_fsub,
+								   left,
+								   right))
 EMIT_FP_BINARY_OP(mul,
-				  callLLVMIntrinsic({left->getType()},
-									llvm::Intrinsic::experimental_constrained_fmul,
-									{left,
-									 right,
-									 moduleContext.fpRoundingModeMetadata,
-									 moduleContext.fpExceptionMetadata}))
+				  emitFPArithmetic(*this,
+								   llvm::Instruction::FMul,
+								   llvm::Intrinsic::experimental_constrained_fmul,
+								   left,
+								   right))
 EMIT_FP_BINARY_OP(div,
-				  callLLVMIntrinsic({left->getType()},
-									llvm::Intrinsic::experimental_constrained_fdiv,
-									{left,
-									 right,
-									 moduleContext.fpRoundingModeMetadata,
-									 moduleContext.fpExceptionMetadata}))
+				  emitFPArithmetic(*this,
+								   llvm::Instruction::FDiv,
+								   llvm::Intrinsic::experimental_constrained_fdiv,
+								   left,
+								   right))
 EMIT_FP_BINARY_OP(copysign,
 				  callLLVMIntrinsic({left->getType()}, llvm::Intrinsic::copysign, {left, right}))
 
 EMIT_FP_UNARY_OP(neg, irBuilder.CreateFNeg(operand))
 EMIT_FP_UNARY_OP(abs, callLLVMIntrinsic({operand->getType()}, llvm::Intrinsic::fabs, {operand}))
 EMIT_FP_UNARY_OP(sqrt,
-				 callLLVMIntrinsic({operand->getType()},
-								   llvm::Intrinsic::experimental_constrained_sqrt,
-								   {operand,
-									moduleContext.fpRoundingModeMetadata,
-									moduleContext.fpExceptionMetadata}))
+				 relaxedNaN
+					 ? callLLVMIntrinsic({operand->getType()}, llvm::Intrinsic::sqrt, {operand})
+					 : callLLVMIntrinsic({operand->getType()},
+										 llvm::Intrinsic::experimental_constrained_sqrt,
+										 {operand,
+										  moduleContext.fpRoundingModeMetadata,
+										  moduleContext.fpExceptionMetadata}))
 
 #define EMIT_FP_COMPARE_OP(name, pred, zextOrSext, llvmOperandType, llvmResultType)                \
 	void EmitFunctionContext::name(NoImm)                                                          \
@@ -341,12 +357,35 @@ static llvm::Value* quietNaN(EmitFunctionContext& context,
 #endif
 }
 
+// With relaxed NaN semantics, min and max return a NaN operand without quieting it, and may return
+// either operand if they are zeros with different signs. The comparison and select that choose
+// between the operands are the pattern that x86 lowers to a single minss/minps or maxss/maxps,
+// which return the right operand if either is NaN, so only a left NaN operand needs a separate
+// check.
+static llvm::Value* emitRelaxedFloatMinOrMax(EmitFunctionContext& context,
+											 llvm::CmpInst::Predicate predicate,
+											 llvm::Value* left,
+											 llvm::Value* right)
+{
+	llvm::IRBuilder<>& irBuilder = context.irBuilder;
+	llvm::Value* isLeftNaN
+		= createFCmpWithWorkaround(irBuilder, llvm::CmpInst::FCMP_UNO, left, left);
+	return irBuilder.CreateSelect(
+		isLeftNaN,
+		left,
+		irBuilder.CreateSelect(
+			createFCmpWithWorkaround(irBuilder, predicate, left, right), left, right));
+}
+
 static llvm::Value* emitFloatMin(EmitFunctionContext& context,
 								 llvm::Value* left,
 								 llvm::Value* right,
 								 llvm::Type* intType,
 								 llvm::Value* quietNaNMask)
 {
+	if(context.relaxedNaN)
+	{ return emitRelaxedFloatMinOrMax(context, llvm::CmpInst::FCMP_OLT, left, right); }
+
 	llvm::IRBuilder<>& irBuilder = context.irBuilder;
 	llvm::Type* floatType = left->getType();
 	llvm::Value* isLeftNaN
@@ -385,6 +424,9 @@ static llvm::Value* emitFloatMax(EmitFunctionContext& context,
 								 llvm::Type* intType,
 								 llvm::Value* quietNaNMask)
 {
+	if(context.relaxedNaN)
+	{ return emitRelaxedFloatMinOrMax(context, llvm::CmpInst::FCMP_OGT, left, right); }
+
 	llvm::IRBuilder<>& irBuilder = context.irBuilder;
 	llvm::Type* floatType = left->getType();
 	llvm::Value* isLeftNaN
@@ -532,20 +574,29 @@ static llvm::Value* emitSubUnsignedSaturated(llvm::IRBuilder<>& irBuilder,
 		right);
 }
 
+#if LLVM_VERSION_MAJOR >= 8
+// Use the LLVM saturating arithmetic intrinsics, which are lowered to the target CPU's native
+// saturating instructions (e.g. PADDUSB on X86, or UQADD on AArch64).
 EMIT_SIMD_BINARY_OP(i8x16_add_sat_u,
 					llvmContext.i8x16Type,
-					emitAddUnsignedSaturated(irBuilder, left, right, llvmContext.i8x16Type))
+					callLLVMIntrinsic({llvmContext.i8x16Type},
+									  llvm::Intrinsic::uadd_sat,
+									  {left, right}))
 EMIT_SIMD_BINARY_OP(i8x16_sub_sat_u,
 					llvmContext.i8x16Type,
-					emitSubUnsignedSaturated(irBuilder, left, right, llvmContext.i8x16Type))
+					callLLVMIntrinsic({llvmContext.i8x16Type},
+									  llvm::Intrinsic::usub_sat,
+									  {left, right}))
 EMIT_SIMD_BINARY_OP(i16x8_add_sat_u,
 					llvmContext.i16x8Type,
-					emitAddUnsignedSaturated(irBuilder, left, right, llvmContext.i16x8Type))
+					callLLVMIntrinsic({llvmContext.i16x8Type},
+									  llvm::Intrinsic::uadd_sat,
+									  {left, right}))
 EMIT_SIMD_BINARY_OP(i16x8_sub_sat_u,
 					llvmContext.i16x8Type,
-					emitSubUnsignedSaturated(irBuilder, left, right, llvmContext.i16x8Type))
-
-#if LLVM_VERSION_MAJOR >= 8
+					callLLVMIntrinsic({llvmContext.i16x8Type},
+									  llvm::Intrinsic::usub_sat,
+									  {left, right}))
 EMIT_SIMD_BINARY_OP(i8x16_add_sat_s,
 					llvmContext.i8x16Type,
 					callLLVMIntrinsic({llvmContext.i8x16Type},
@@ -567,6 +618,18 @@ EMIT_SIMD_BINARY_OP(i16x8_sub_sat_s,
 									  llvm::Intrinsic::ssub_sat,
 									  {left, right}))
 #else
+EMIT_SIMD_BINARY_OP(i8x16_add_sat_u,
+					llvmContext.i8x16Type,
+					emitAddUnsignedSaturated(irBuilder, left, right, llvmContext.i8x16Type))
+EMIT_SIMD_BINARY_OP(i8x16_sub_sat_u,
+					llvmContext.i8x16Type,
+					emitSubUnsignedSaturated(irBuilder, left, right, llvmContext.i8x16Type))
+EMIT_SIMD_BINARY_OP(i16x8_add_sat_u,
+					llvmContext.i16x8Type,
+					emitAddUnsignedSaturated(irBuilder, left, right, llvmContext.i16x8Type))
+EMIT_SIMD_BINARY_OP(i16x8_sub_sat_u,
+					llvmContext.i16x8Type,
+					emitSubUnsignedSaturated(irBuilder, left, right, llvmContext.i16x8Type))
 EMIT_SIMD_BINARY_OP(i8x16_add_sat_s,
 					llvmContext.i8x16Type,
 					callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_padds_b, {left, right}))
@@ -732,56 +795,117 @@ EMIT_SIMD_FP_UNARY_OP(abs,
 EMIT_SIMD_FP_UNARY_OP(sqrt,
 					  callLLVMIntrinsic({operand->getType()}, llvm::Intrinsic::sqrt, {operand}))
 
+// LLVM versions before 13 expand the generic lowerings of any_true and all_true to a sequence of
+// scalar compares, so on x86 and AArch64 they are lowered to the instructions that test a whole
+// vector at once: pmovmskb of a lane-wise compare with zero on x86, and umaxv/uminv on AArch64.
 void EmitFunctionContext::v128_any_true(IR::NoImm)
 {
 	llvm::Value* vector = pop();
 
-	vector = irBuilder.CreateBitCast(vector, llvmContext.i64x2Type);
+	llvm::Value* boolResult;
+	if(moduleContext.targetArch == llvm::Triple::x86_64
+	   || moduleContext.targetArch == llvm::Triple::x86)
+	{
+		// The vector has a non-zero byte if the mask of the bytes that equal zero isn't all ones.
+		auto i8x16Vector = irBuilder.CreateBitCast(vector, llvmContext.i8x16Type);
+		auto i8x16ZeroMask = irBuilder.CreateSExt(
+			irBuilder.CreateICmpEQ(i8x16Vector,
+								   llvm::ConstantVector::getNullValue(llvmContext.i8x16Type)),
+			llvmContext.i8x16Type);
+		boolResult = irBuilder.CreateICmpNE(
+			callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_pmovmskb_128, {i8x16ZeroMask}),
+			emitLiteral(llvmContext, U32(0xffff)));
+	}
+	else if(moduleContext.targetArch == llvm::Triple::aarch64)
+	{
+		auto i32x4Vector = irBuilder.CreateBitCast(vector, llvmContext.i32x4Type);
+		boolResult = irBuilder.CreateICmpNE(
+			callLLVMIntrinsic({llvmContext.i32Type, llvmContext.i32x4Type},
+							  llvm::Intrinsic::aarch64_neon_umaxv,
+							  {i32x4Vector}),
+			emitLiteral(llvmContext, U32(0)));
+	}
+	else
+	{
+		vector = irBuilder.CreateBitCast(vector, llvmContext.i64x2Type);
 
-	llvm::Constant* zero = emitLiteral(llvmContext, U64(0));
+		llvm::Constant* zero = emitLiteral(llvmContext, U64(0));
 
-	llvm::Value* boolResult = irBuilder.CreateOr(
-		irBuilder.CreateICmpNE(irBuilder.CreateExtractElement(vector, U64(0)), zero),
-		irBuilder.CreateICmpNE(irBuilder.CreateExtractElement(vector, U64(1)), zero));
-	llvm::Value* i32Result
-		= irBuilder.CreateZExt(boolResult, llvm::Type::getInt32Ty(irBuilder.getContext()));
-	push(i32Result);
+		boolResult = irBuilder.CreateOr(
+			irBuilder.CreateICmpNE(irBuilder.CreateExtractElement(vector, U64(0)), zero),
+			irBuilder.CreateICmpNE(irBuilder.CreateExtractElement(vector, U64(1)), zero));
+	}
+	push(irBuilder.CreateZExt(boolResult, llvmContext.i32Type));
 }
 
-static llvm::Value* emitAllTrue(llvm::IRBuilder<>& irBuilder,
-								llvm::Value* vector,
-								FixedVectorType* vectorType)
+llvm::Value* EmitFunctionContext::emitAllTrue(llvm::Value* vector, FixedVectorType* vectorType)
 {
 	vector = irBuilder.CreateBitCast(vector, vectorType);
 
-	const U32 numScalarBits = vectorType->getScalarSizeInBits();
-	const Uptr numLanes = vectorType->getNumElements();
-	llvm::Constant* zero
-		= llvm::ConstantInt::get(vectorType->getScalarType(), llvm::APInt(numScalarBits, 0));
-
 	llvm::Value* result = nullptr;
-	for(Uptr laneIndex = 0; laneIndex < numLanes; ++laneIndex)
+	if(moduleContext.targetArch == llvm::Triple::x86_64
+	   || moduleContext.targetArch == llvm::Triple::x86)
 	{
-		llvm::Value* scalar = irBuilder.CreateExtractElement(vector, laneIndex);
-		llvm::Value* scalarBool = irBuilder.CreateICmpNE(scalar, zero);
-
-		result = result ? irBuilder.CreateAnd(result, scalarBool) : scalarBool;
+		// All the lanes are non-zero if none of the bytes of the mask of the lanes that equal zero
+		// are set.
+		auto zeroLaneMask = irBuilder.CreateSExt(
+			irBuilder.CreateICmpEQ(vector, llvm::ConstantVector::getNullValue(vectorType)),
+			vectorType);
+		result = irBuilder.CreateICmpEQ(
+			callLLVMIntrinsic({},
+							  llvm::Intrinsic::x86_sse2_pmovmskb_128,
+							  {irBuilder.CreateBitCast(zeroLaneMask, llvmContext.i8x16Type)}),
+			emitLiteral(llvmContext, U32(0)));
 	}
-	return irBuilder.CreateZExt(result, llvm::Type::getInt32Ty(irBuilder.getContext()));
+	else if(moduleContext.targetArch == llvm::Triple::aarch64)
+	{
+		// uminv doesn't have a form for 64-bit lanes, so 64-bit lanes are first converted to a
+		// mask of the lanes that are non-zero, which has no zero 32-bit lanes iff all 64-bit lanes
+		// are non-zero.
+		if(vectorType->getScalarSizeInBits() == 64)
+		{
+			vector = irBuilder.CreateBitCast(
+				irBuilder.CreateSExt(
+					irBuilder.CreateICmpNE(vector, llvm::ConstantVector::getNullValue(vectorType)),
+					vectorType),
+				llvmContext.i32x4Type);
+			vectorType = llvmContext.i32x4Type;
+		}
+		result = irBuilder.CreateICmpNE(
+			callLLVMIntrinsic(
+				{llvmContext.i32Type, vectorType}, llvm::Intrinsic::aarch64_neon_uminv, {vector}),
+			emitLiteral(llvmContext, U32(0)));
+	}
+	else
+	{
+		const U32 numScalarBits = vectorType->getScalarSizeInBits();
+		const Uptr numLanes = vectorType->getNumElements();
+		llvm::Constant* zero
+			= llvm::ConstantInt::get(vectorType->getScalarType(), llvm::APInt(numScalarBits, 0));
+
+		for(Uptr laneIndex = 0; laneIndex < numLanes; ++laneIndex)
+		{
+			llvm::Value* scalar = irBuilder.CreateExtractElement(vector, laneIndex);
+			llvm::Value* scalarBool = irBuilder.CreateICmpNE(scalar, zero);
+
+			result = result ? irBuilder.CreateAnd(result, scalarBool) : scalarBool;
+		}
+	}
+	return irBuilder.CreateZExt(result, llvmContext.i32Type);
 }
 
 EMIT_SIMD_UNARY_OP(i8x16_all_true,
 				   llvmContext.i8x16Type,
-				   emitAllTrue(irBuilder, operand, llvmContext.i8x16Type))
+				   emitAllTrue(operand, llvmContext.i8x16Type))
 EMIT_SIMD_UNARY_OP(i16x8_all_true,
 				   llvmContext.i16x8Type,
-				   emitAllTrue(irBuilder, operand, llvmContext.i16x8Type))
+				   emitAllTrue(operand, llvmContext.i16x8Type))
 EMIT_SIMD_UNARY_OP(i32x4_all_true,
 				   llvmContext.i32x4Type,
-				   emitAllTrue(irBuilder, operand, llvmContext.i32x4Type))
+				   emitAllTrue(operand, llvmContext.i32x4Type))
 EMIT_SIMD_UNARY_OP(i64x2_all_true,
 				   llvmContext.i64x2Type,
-				   emitAllTrue(irBuilder, operand, llvmContext.i64x2Type))
+				   emitAllTrue(operand, llvmContext.i64x2Type))
 
 void EmitFunctionContext::v128_and(IR::NoImm)
 {
@@ -1024,6 +1148,15 @@ void EmitFunctionContext::i32x4_dot_i16x8_s(NoImm)
 	llvm::Value* right = irBuilder.CreateBitCast(pop(), llvmContext.i16x8Type);
 	llvm::Value* left = irBuilder.CreateBitCast(pop(), llvmContext.i16x8Type);
 
+	// X86 PMADDWD computes exactly the dot product, so use it directly rather than relying on the
+	// backend to recognize the generic sequence below.
+	if(moduleContext.targetArch == llvm::Triple::x86_64
+	   || moduleContext.targetArch == llvm::Triple::x86)
+	{
+		push(callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_pmadd_wd, {left, right}));
+		return;
+	}
+
 	left = irBuilder.CreateSExt(left, llvmContext.i32x8Type);
 	right = irBuilder.CreateSExt(right, llvmContext.i32x8Type);
 
@@ -1079,3 +1212,243 @@ void EmitFunctionContext::i16x8_q15mulr_sat_s(NoImm)
 	llvm::Value* result = irBuilder.CreateTrunc(saturate, llvmContext.i16x8Type);
 	push(result);
 }
+
+//
+// Relaxed SIMD: these operators may produce target-dependent results for some inputs, so they are
+// lowered to the target's native instructions instead of emulating the strict operators' results
+// for those inputs. On targets whose native instructions already implement the strict semantics,
+// they are emitted as the strict operators.
+//
+
+static bool isX86(llvm::Triple::ArchType targetArch)
+{
+	return targetArch == llvm::Triple::x86_64 || targetArch == llvm::Triple::x86;
+}
+
+void EmitFunctionContext::i8x16_relaxed_swizzle(NoImm imm)
+{
+	// x86 pshufb writes zero for an index with its MSB set, and uses any other index modulo 16,
+	// which the relaxed swizzle allows for out-of-range indices. The strict swizzle on other
+	// targets is already a single tbl instruction.
+	if(!isX86(moduleContext.targetArch))
+	{
+		i8x16_swizzle(imm);
+		return;
+	}
+
+	auto indexVector = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	auto elementVector = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	push(callLLVMIntrinsic(
+		{}, llvm::Intrinsic::x86_ssse3_pshuf_b_128, {elementVector, indexVector}));
+}
+
+// x86 cvttps2dq and cvttpd2dq return INT32_MIN for NaN and out-of-range lanes, which the relaxed
+// signed truncations allow. x86 doesn't have an unsigned truncation before AVX-512, and aarch64's
+// fcvtzs and fcvtzu saturate like the strict truncations, so the other cases use the strict
+// truncations.
+void EmitFunctionContext::i32x4_relaxed_trunc_f32x4_s(NoImm imm)
+{
+	if(!isX86(moduleContext.targetArch))
+	{
+		i32x4_trunc_sat_f32x4_s(imm);
+		return;
+	}
+
+	auto operand = irBuilder.CreateBitCast(pop(), llvmContext.f32x4Type);
+	push(callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_cvttps2dq, {operand}));
+}
+void EmitFunctionContext::i32x4_relaxed_trunc_f32x4_u(NoImm imm) { i32x4_trunc_sat_f32x4_u(imm); }
+void EmitFunctionContext::i32x4_relaxed_trunc_f64x2_s_zero(NoImm imm)
+{
+	if(!isX86(moduleContext.targetArch))
+	{
+		i32x4_trunc_sat_f64x2_s_zero(imm);
+		return;
+	}
+
+	// cvttpd2dq zeroes the upper two lanes of its result.
+	auto operand = irBuilder.CreateBitCast(pop(), llvmContext.f64x2Type);
+	push(callLLVMIntrinsic({}, llvm::Intrinsic::x86_sse2_cvttpd2dq, {operand}));
+}
+void EmitFunctionContext::i32x4_relaxed_trunc_f64x2_u_zero(NoImm imm)
+{
+	i32x4_trunc_sat_f64x2_u_zero(imm);
+}
+
+// The relaxed multiply-adds may round the product before adding it or not, which llvm.fmuladd
+// allows too: it is a single fused multiply-add on x86 targets with FMA and on aarch64, and a
+// multiply and add on other targets.
+#define EMIT_SIMD_RELAXED_MADD(type, negateProduct)                                                \
+	{                                                                                              \
+		auto addend = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                      \
+		auto right = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                       \
+		llvm::Value* left = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                \
+		if(negateProduct) { left = irBuilder.CreateFNeg(left); }                                   \
+		push(callLLVMIntrinsic(                                                                    \
+			{llvmContext.type##Type}, llvm::Intrinsic::fmuladd, {left, right, addend}));           \
+	}
+
+void EmitFunctionContext::f32x4_relaxed_madd(NoImm) EMIT_SIMD_RELAXED_MADD(f32x4, false)
+void EmitFunctionContext::f32x4_relaxed_nmadd(NoImm) EMIT_SIMD_RELAXED_MADD(f32x4, true)
+void EmitFunctionContext::f64x2_relaxed_madd(NoImm) EMIT_SIMD_RELAXED_MADD(f64x2, false)
+void EmitFunctionContext::f64x2_relaxed_nmadd(NoImm) EMIT_SIMD_RELAXED_MADD(f64x2, true)
+
+#undef EMIT_SIMD_RELAXED_MADD
+
+// A relaxed lane select may select the lanes either by all the bits of the mask lane or just by
+// its MSB, so on x86 it can be a single blend instruction for 8, 32 and 64-bit lanes. There's no
+// 16-bit lane blend, and bitselect is a single bsl instruction on aarch64.
+#define EMIT_SIMD_RELAXED_LANESELECT(type, blendType, x86IntrinsicId)                              \
+	void EmitFunctionContext::type##_relaxed_laneselect(NoImm imm)                                 \
+	{                                                                                              \
+		if(!isX86(moduleContext.targetArch))                                                       \
+		{                                                                                          \
+			v128_bitselect(imm);                                                                   \
+			return;                                                                                \
+		}                                                                                          \
+                                                                                                   \
+		auto mask = irBuilder.CreateBitCast(pop(), llvmContext.blendType##Type);                   \
+		auto falseValue = irBuilder.CreateBitCast(pop(), llvmContext.blendType##Type);             \
+		auto trueValue = irBuilder.CreateBitCast(pop(), llvmContext.blendType##Type);              \
+		push(callLLVMIntrinsic({}, x86IntrinsicId, {falseValue, trueValue, mask}));                \
+	}
+
+EMIT_SIMD_RELAXED_LANESELECT(i8x16, i8x16, llvm::Intrinsic::x86_sse41_pblendvb)
+EMIT_SIMD_RELAXED_LANESELECT(i32x4, f32x4, llvm::Intrinsic::x86_sse41_blendvps)
+EMIT_SIMD_RELAXED_LANESELECT(i64x2, f64x2, llvm::Intrinsic::x86_sse41_blendvpd)
+
+#undef EMIT_SIMD_RELAXED_LANESELECT
+
+void EmitFunctionContext::i16x8_relaxed_laneselect(NoImm imm) { v128_bitselect(imm); }
+
+// The relaxed min and max may return either operand if either is NaN, or if both are zeros with
+// different signs. x86 minps/maxps and minpd/maxpd return the right operand in both cases, and
+// aarch64 fmin and fmax return a NaN if either operand is NaN, and order -0 before +0.
+#define EMIT_SIMD_RELAXED_MIN_OR_MAX(type, minOrMax, x86IntrinsicId, aarch64IntrinsicId)           \
+	void EmitFunctionContext::type##_relaxed_##minOrMax(NoImm imm)                                 \
+	{                                                                                              \
+		if(isX86(moduleContext.targetArch))                                                        \
+		{                                                                                          \
+			auto right = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                   \
+			auto left = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                    \
+			push(callLLVMIntrinsic({}, x86IntrinsicId, {left, right}));                            \
+		}                                                                                          \
+		else if(moduleContext.targetArch == llvm::Triple::aarch64)                                 \
+		{                                                                                          \
+			auto right = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                   \
+			auto left = irBuilder.CreateBitCast(pop(), llvmContext.type##Type);                    \
+			push(callLLVMIntrinsic({llvmContext.type##Type}, aarch64IntrinsicId, {left, right}));  \
+		}                                                                                          \
+		else                                                                                       \
+		{                                                                                          \
+			type##_##minOrMax(imm);                                                                \
+		}                                                                                          \
+	}
+
+EMIT_SIMD_RELAXED_MIN_OR_MAX(f32x4,
+							 min,
+							 llvm::Intrinsic::x86_sse_min_ps,
+							 llvm::Intrinsic::aarch64_neon_fmin)
+EMIT_SIMD_RELAXED_MIN_OR_MAX(f32x4,
+							 max,
+							 llvm::Intrinsic::x86_sse_max_ps,
+							 llvm::Intrinsic::aarch64_neon_fmax)
+EMIT_SIMD_RELAXED_MIN_OR_MAX(f64x2,
+							 min,
+							 llvm::Intrinsic::x86_sse2_min_pd,
+							 llvm::Intrinsic::aarch64_neon_fmin)
+EMIT_SIMD_RELAXED_MIN_OR_MAX(f64x2,
+							 max,
+							 llvm::Intrinsic::x86_sse2_max_pd,
+							 llvm::Intrinsic::aarch64_neon_fmax)
+
+#undef EMIT_SIMD_RELAXED_MIN_OR_MAX
+
+void EmitFunctionContext::i16x8_relaxed_q15mulr_s(NoImm imm)
+{
+	// x86 pmulhrsw only differs from the strict operator for INT16_MIN * INT16_MIN, which it wraps
+	// to INT16_MIN instead of saturating to INT16_MAX, as the relaxed operator allows. aarch64
+	// sqrdmulh implements the strict operator.
+	if(isX86(moduleContext.targetArch) || moduleContext.targetArch == llvm::Triple::aarch64)
+	{
+		auto right = irBuilder.CreateBitCast(pop(), llvmContext.i16x8Type);
+		auto left = irBuilder.CreateBitCast(pop(), llvmContext.i16x8Type);
+		if(isX86(moduleContext.targetArch))
+		{
+			push(callLLVMIntrinsic(
+				{}, llvm::Intrinsic::x86_ssse3_pmul_hr_sw_128, {left, right}));
+		}
+		else
+		{
+			push(callLLVMIntrinsic(
+				{llvmContext.i16x8Type}, llvm::Intrinsic::aarch64_neon_sqrdmulh, {left, right}));
+		}
+	}
+	else
+	{
+		i16x8_q15mulr_sat_s(imm);
+	}
+}
+
+// Adds each pair of adjacent lanes of a vector, returning a vector with half as many lanes.
+static llvm::Value* emitAddAdjacentLanes(llvm::IRBuilder<>& irBuilder, llvm::Value* vector)
+{
+	const U32 numInputLanes = U32(llvm::cast<FixedVectorType>(vector->getType())->getNumElements());
+	const U32 numOutputLanes = numInputLanes / 2;
+	WAVM_ASSERT(numOutputLanes <= 8);
+
+	LLVM_LANE_INDEX_TYPE evenMask[8];
+	LLVM_LANE_INDEX_TYPE oddMask[8];
+	for(U32 laneIndex = 0; laneIndex < numOutputLanes; ++laneIndex)
+	{
+		evenMask[laneIndex] = LLVM_LANE_INDEX_TYPE(laneIndex * 2 + 0);
+		oddMask[laneIndex] = LLVM_LANE_INDEX_TYPE(laneIndex * 2 + 1);
+	}
+	llvm::Constant* undefVector = llvm::UndefValue::get(vector->getType());
+	return irBuilder.CreateAdd(
+		irBuilder.CreateShuffleVector(
+			vector, undefVector, llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(evenMask, numOutputLanes)),
+		irBuilder.CreateShuffleVector(
+			vector, undefVector, llvm::ArrayRef<LLVM_LANE_INDEX_TYPE>(oddMask, numOutputLanes)));
+}
+
+// The relaxed dot products multiply signed 8-bit lanes by lanes that are only required to be
+// 7-bit, so x86 pmaddubsw can compute them with the 7-bit operand as its unsigned operand. Other
+// targets extend the lanes and add the products, which LLVM may select sdot for on aarch64 targets
+// with the dot product extension.
+void EmitFunctionContext::i16x8_relaxed_dot_i8x16_i7x16_s(NoImm)
+{
+	auto right = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	auto left = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	if(isX86(moduleContext.targetArch))
+	{
+		push(callLLVMIntrinsic({}, llvm::Intrinsic::x86_ssse3_pmadd_ub_sw_128, {right, left}));
+		return;
+	}
+
+	auto products = irBuilder.CreateMul(irBuilder.CreateSExt(left, llvmContext.i16x16Type),
+										irBuilder.CreateSExt(right, llvmContext.i16x16Type));
+	push(emitAddAdjacentLanes(irBuilder, products));
+}
+void EmitFunctionContext::i32x4_relaxed_dot_i8x16_i7x16_add_s(NoImm)
+{
+	auto addend = irBuilder.CreateBitCast(pop(), llvmContext.i32x4Type);
+	auto right = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	auto left = irBuilder.CreateBitCast(pop(), llvmContext.i8x16Type);
+	if(isX86(moduleContext.targetArch))
+	{
+		// pmaddwd with a vector of ones adds the adjacent 16-bit sums from pmaddubsw.
+		auto i16x8DotProduct = callLLVMIntrinsic(
+			{}, llvm::Intrinsic::x86_ssse3_pmadd_ub_sw_128, {right, left});
+		auto ones = irBuilder.CreateVectorSplat(8, llvm::ConstantInt::get(llvmContext.i16Type, 1));
+		auto i32x4DotProduct = callLLVMIntrinsic(
+			{}, llvm::Intrinsic::x86_sse2_pmadd_wd, {i16x8DotProduct, ones});
+		push(irBuilder.CreateAdd(i32x4DotProduct, addend));
+		return;
+	}
+
+	auto products = irBuilder.CreateMul(irBuilder.CreateSExt(left, llvmContext.i32x16Type),
+										irBuilder.CreateSExt(right, llvmContext.i32x16Type));
+	push(irBuilder.CreateAdd(
+		emitAddAdjacentLanes(irBuilder, emitAddAdjacentLanes(irBuilder, products)), addend));
+}
@@ -37,7 +37,7 @@ void EmitFunctionContext::ref_is_null(NoImm)
 
 void EmitFunctionContext::ref_func(FunctionRefImm imm)
 {
-	llvm::Value* referencedFunction = moduleContext.functions[imm.functionIndex];
+	llvm::Value* referencedFunction = moduleContext.functionReferences[imm.functionIndex];
 	llvm::Value* codeAddress = irBuilder.CreatePtrToInt(referencedFunction, moduleContext.iptrType);
 	llvm::Value* functionAddress = irBuilder.CreateSub(
 		codeAddress, emitLiteralIptr(offsetof(Runtime::Function, code), moduleContext.iptrType));
@@ -35,6 +35,7 @@ void EmitFunctionContext::local_set(GetOrSetVariableImm<false> imm)
 	auto value = irBuilder.CreateBitCast(
 		pop(), localPointers[imm.variableIndex]->getType()->getPointerElementType());
 	irBuilder.CreateStore(value, localPointers[imm.variableIndex]);
+	invalidateBoundedLocalAddresses(localPointers[imm.variableIndex]);
 }
 void EmitFunctionContext::local_tee(GetOrSetVariableImm<false> imm)
 {
@@ -42,6 +43,7 @@ void EmitFunctionContext::local_tee(GetOrSetVariableImm<false> imm)
 	auto value = irBuilder.CreateBitCast(
 		getValueFromTop(), localPointers[imm.variableIndex]->getType()->getPointerElementType());
 	irBuilder.CreateStore(value, localPointers[imm.variableIndex]);
+	invalidateBoundedLocalAddresses(localPointers[imm.variableIndex]);
 }
 
 //
@@ -52,6 +54,30 @@ static llvm::Value* getImportedImmutableGlobalValue(EmitFunctionContext& functio
 													Uptr importedGlobalIndex,
 													ValueType valueType)
 {
+	// If the module is specialized for the global's value, emit it as a literal.
+	const ModuleSpecialization* specialization = functionContext.moduleContext.specialization;
+	if(specialization && importedGlobalIndex < specialization->globalImportValues.size())
+	{
+		const Value& value = specialization->globalImportValues[importedGlobalIndex];
+		if(value.type == valueType)
+		{
+			switch(valueType)
+			{
+			case ValueType::i32: return emitLiteral(functionContext.llvmContext, value.i32);
+			case ValueType::i64: return emitLiteral(functionContext.llvmContext, value.i64);
+			case ValueType::f32: return emitLiteral(functionContext.llvmContext, value.f32);
+			case ValueType::f64: return emitLiteral(functionContext.llvmContext, value.f64);
+			case ValueType::v128: return emitLiteral(functionContext.llvmContext, value.v128);
+
+			case ValueType::none:
+			case ValueType::any:
+			case ValueType::externref:
+			case ValueType::funcref:
+			default: break;
+			};
+		}
+	}
+
 	// The symbol for an imported global will point to the global's immutable value.
 	return functionContext.loadFromUntypedPointer(
 		functionContext.moduleContext.globals[importedGlobalIndex],
@@ -65,7 +91,11 @@ void EmitFunctionContext::global_get(GetOrSetVariableImm<true> imm)
 	GlobalType globalType = irModule.globals.getType(imm.variableIndex);
 
 	llvm::Value* value = nullptr;
-	if(globalType.isMutable)
+	if(imm.variableIndex == moduleContext.stackPointerGlobalIndex)
+	{
+		value = irBuilder.CreateLoad(stackPointerVariable);
+	}
+	else if(globalType.isMutable)
 	{
 		// If the global is mutable, the symbol will be bound to an offset into the
 		// ContextRuntimeData::globalData that its value is stored at.
@@ -115,7 +145,8 @@ void EmitFunctionContext::global_get(GetOrSetVariableImm<true> imm)
 			value = llvm::Constant::getNullValue(llvmContext.externrefType);
 			break;
 		case InitializerExpression::Type::ref_func: {
-			llvm::Value* referencedFunction = moduleContext.functions[globalDef.initializer.ref];
+			llvm::Value* referencedFunction
+				= moduleContext.functionReferences[globalDef.initializer.ref];
 			llvm::Value* codeAddress
 				= irBuilder.CreatePtrToInt(referencedFunction, moduleContext.iptrType);
 			llvm::Value* functionAddress = irBuilder.CreateSub(
@@ -142,6 +173,11 @@ void EmitFunctionContext::global_set(GetOrSetVariableImm<true> imm)
 	llvm::Type* llvmValueType = asLLVMType(llvmContext, globalType.valueType);
 
 	llvm::Value* value = irBuilder.CreateBitCast(pop(), llvmValueType);
+	if(imm.variableIndex == moduleContext.stackPointerGlobalIndex)
+	{
+		irBuilder.CreateStore(value, stackPointerVariable);
+		return;
+	}
 
 	// If the global is mutable, the symbol will be bound to an offset into the
 	// ContextRuntimeData::globalData that its value is stored at.
@@ -1,4 +1,7 @@
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <system_error>
@@ -6,13 +9,21 @@
 #include <vector>
 #include "LLVMJITPrivate.h"
 #include "WAVM/IR/Module.h"
+#include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Logging/Trace.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm-c/Disassembler.h>
@@ -24,14 +35,28 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
+#if LLVM_VERSION_MAJOR >= 8
+#include <llvm/IR/PassTimingInfo.h>
+#endif
 #include <llvm/IR/Verifier.h>
+#include <llvm/MC/MCSubtargetInfo.h>
 #include <llvm/Object/ObjectFile.h>
 #include <llvm/Object/SymbolSize.h>
 #include <llvm/Pass.h>
+#if LLVM_VERSION_MAJOR >= 12
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Transforms/Scalar/DCE.h>
+#else
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#endif
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/Timer.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/Scalar.h>
 #if LLVM_VERSION_MAJOR >= 7
 #include <llvm/Transforms/InstCombine/InstCombine.h>
@@ -84,34 +109,306 @@ private:
 	std::vector<U8> output;
 };
 
-static void optimizeLLVMModule(llvm::Module& llvmModule, bool shouldLogMetrics)
+// Returns the optimization level that the given options compile code with.
+static Uptr getOptimizationLevel(const CompileOptions& options)
+{
+	if(options.tier == CompileTier::baseline) { return 0; }
+	WAVM_ERROR_UNLESS(options.optimizationLevel <= 3);
+	return options.optimizationLevel;
+}
+
+// Returns the index of the function definition that a LLVM function was emitted for, or
+// UINTPTR_MAX if it isn't a function definition.
+static Uptr getFunctionDefIndex(const llvm::Function& function)
+{
+	llvm::StringRef name = function.getName();
+	Uptr functionDefIndex;
+	if(!name.consume_front("functionDef") || name.getAsInteger(10, functionDefIndex))
+	{ return UINTPTR_MAX; }
+	return functionDefIndex;
+}
+
+static void addPassTime(CompileTimeReport& timeReport, const std::string& name, U64 nanoseconds)
+{
+	for(CompileTimeReport::PassTime& passTime : timeReport.passTimes)
+	{
+		if(passTime.name == name)
+		{
+			passTime.nanoseconds += nanoseconds;
+			return;
+		}
+	}
+	timeReport.passTimes.push_back({name, nanoseconds});
+}
+
+// Runs a legacy function pass manager on each function in a module.
+static void runFunctionPasses(llvm::legacy::FunctionPassManager& fpm,
+							  llvm::Module& llvmModule,
+							  CompileTimeReport* timeReport)
+{
+	for(auto functionIt = llvmModule.begin(); functionIt != llvmModule.end(); ++functionIt)
+	{
+		Timing::Timer functionTimer;
+		fpm.run(*functionIt);
+
+		const Uptr functionDefIndex = getFunctionDefIndex(*functionIt);
+		if(timeReport && functionDefIndex < timeReport->functionDefNanoseconds.size())
+		{
+			timeReport->functionDefNanoseconds[functionDefIndex]
+				+= U64(functionTimer.getNanoseconds());
+		}
+	}
+}
+
+#if LLVM_VERSION_MAJOR >= 12
+// Times the passes run by the new pass manager, adding the time of function passes to the
+// function definition they ran on, and records a trace event for each pass if tracing is enabled.
+struct NewPassManagerTimer
+{
+	NewPassManagerTimer(CompileTimeReport* inTimeReport,
+						llvm::PassInstrumentationCallbacks& callbacks)
+	: timeReport(inTimeReport)
+	{
+		callbacks.registerBeforeNonSkippedPassCallback(
+			[this](llvm::StringRef passName, llvm::Any ir) { beginPass(passName, ir); });
+		callbacks.registerAfterPassCallback(
+			[this](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses&) { endPass(); });
+		callbacks.registerAfterPassInvalidatedCallback(
+			[this](llvm::StringRef, const llvm::PreservedAnalyses&) { endPass(); });
+	}
+
+	~NewPassManagerTimer()
+	{
+		WAVM_ASSERT(!activePasses.size());
+		if(timeReport)
+		{
+			for(const auto& pair : passNanoseconds)
+			{ addPassTime(*timeReport, pair.key, pair.value); }
+		}
+	}
+
+private:
+	struct ActivePass
+	{
+		std::string name;
+		Uptr functionDefIndex;
+		Timing::Timer timer;
+		U64 nestedNanoseconds;
+		U64 traceBeginNanoseconds;
+	};
+
+	CompileTimeReport* timeReport;
+	std::vector<ActivePass> activePasses;
+	HashMap<std::string, U64> passNanoseconds;
+
+	void beginPass(llvm::StringRef passName, llvm::Any ir)
+	{
+		Uptr functionDefIndex = UINTPTR_MAX;
+		if(llvm::any_isa<const llvm::Function*>(ir))
+		{ functionDefIndex = getFunctionDefIndex(*llvm::any_cast<const llvm::Function*>(ir)); }
+		activePasses.push_back({passName.str(),
+								functionDefIndex,
+								Timing::Timer(),
+								0,
+								Trace::isEnabled() ? Trace::getTimestamp() : 0});
+	}
+
+	void endPass()
+	{
+		ActivePass& pass = activePasses.back();
+		if(pass.traceBeginNanoseconds)
+		{
+			Trace::recordEvent(
+				"llvm", pass.name.c_str(), pass.traceBeginNanoseconds, Trace::getTimestamp());
+		}
+
+		const U64 nanoseconds = U64(pass.timer.getNanoseconds());
+		const U64 ownNanoseconds = nanoseconds - std::min(nanoseconds, pass.nestedNanoseconds);
+		if(timeReport)
+		{
+			passNanoseconds.getOrAdd(pass.name, 0) += ownNanoseconds;
+			if(pass.functionDefIndex < timeReport->functionDefNanoseconds.size())
+			{ timeReport->functionDefNanoseconds[pass.functionDefIndex] += ownNanoseconds; }
+		}
+
+		activePasses.pop_back();
+		if(activePasses.size()) { activePasses.back().nestedNanoseconds += nanoseconds; }
+	}
+};
+#endif
+
+#if LLVM_VERSION_MAJOR >= 8
+// Adds the times recorded by LLVM's legacy pass timers to a time report, and resets them.
+static void addLegacyPassTimes(CompileTimeReport& timeReport)
+{
+	std::string json;
+	llvm::raw_string_ostream jsonStream(json);
+	llvm::TimerGroup::printAllJSONValues(jsonStream, "");
+	jsonStream.flush();
+
+	// The wall time of each pass timer is printed as "time.pass.<pass>.wall": <seconds>.
+	static constexpr const char* prefix = "\"time.pass.";
+	static constexpr const char* suffix = ".wall\": ";
+	Uptr offset = 0;
+	while((offset = json.find(prefix, offset)) != std::string::npos)
+	{
+		const Uptr nameBegin = offset + strlen(prefix);
+		const Uptr nameEnd = json.find(suffix, nameBegin);
+		if(nameEnd == std::string::npos) { break; }
+		offset = nameEnd + strlen(suffix);
+		if(json.find('\n', nameBegin) < nameEnd) { continue; }
+
+		const F64 seconds = strtod(json.c_str() + offset, nullptr);
+		addPassTime(
+			timeReport, json.substr(nameBegin, nameEnd - nameBegin), U64(seconds * 1000000000.0));
+	}
+
+	llvm::raw_null_ostream nullStream;
+	llvm::reportAndResetTimings(&nullStream);
+}
+#endif
+
+// Runs LLVM's standard optimization pipeline for optimization level 2 or 3 on the module.
+static void runStandardOptimizationPipeline(llvm::Module& llvmModule,
+											llvm::TargetMachine* targetMachine,
+											Uptr optimizationLevel,
+											CompileTimeReport* timeReport)
+{
+#if LLVM_VERSION_MAJOR >= 12
+	llvm::PassInstrumentationCallbacks passInstrumentationCallbacks;
+	std::unique_ptr<NewPassManagerTimer> passTimer;
+	if(timeReport || Trace::isEnabled())
+	{ passTimer.reset(new NewPassManagerTimer(timeReport, passInstrumentationCallbacks)); }
+
+	// Use the new pass manager's per-module default pipeline.
+#if LLVM_VERSION_MAJOR >= 13
+	llvm::PassBuilder passBuilder(
+		targetMachine, llvm::PipelineTuningOptions(), llvm::None, &passInstrumentationCallbacks);
+#else
+	llvm::PassBuilder passBuilder(false,
+								  targetMachine,
+								  llvm::PipelineTuningOptions(),
+								  llvm::None,
+								  &passInstrumentationCallbacks);
+#endif
+#if LLVM_VERSION_MAJOR >= 14
+	typedef llvm::OptimizationLevel OptimizationLevel;
+#else
+	typedef llvm::PassBuilder::OptimizationLevel OptimizationLevel;
+#endif
+
+	llvm::LoopAnalysisManager loopAnalysisManager;
+	llvm::FunctionAnalysisManager functionAnalysisManager;
+	llvm::CGSCCAnalysisManager cgsccAnalysisManager;
+	llvm::ModuleAnalysisManager moduleAnalysisManager;
+	passBuilder.registerModuleAnalyses(moduleAnalysisManager);
+	passBuilder.registerCGSCCAnalyses(cgsccAnalysisManager);
+	passBuilder.registerFunctionAnalyses(functionAnalysisManager);
+	passBuilder.registerLoopAnalyses(loopAnalysisManager);
+	passBuilder.crossRegisterProxies(loopAnalysisManager,
+									 functionAnalysisManager,
+									 cgsccAnalysisManager,
+									 moduleAnalysisManager);
+
+	llvm::ModulePassManager modulePassManager = passBuilder.buildPerModuleDefaultPipeline(
+		optimizationLevel == 3 ? OptimizationLevel::O3 : OptimizationLevel::O2);
+
+	// Run DCE last to work around the CodeGenPrepare bug described in optimizeLLVMModule.
+	modulePassManager.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::DCEPass()));
+
+	modulePassManager.run(llvmModule, moduleAnalysisManager);
+#else
+	// Older versions of LLVM don't have a stable new pass manager API, so use the legacy
+	// PassManagerBuilder to create the standard pipeline.
+	llvm::PassManagerBuilder passManagerBuilder;
+	passManagerBuilder.OptLevel = unsigned(optimizationLevel);
+	passManagerBuilder.Inliner
+		= llvm::createFunctionInliningPass(unsigned(optimizationLevel), 0, false);
+	passManagerBuilder.LoopVectorize = true;
+	passManagerBuilder.SLPVectorize = true;
+	targetMachine->adjustPassManager(passManagerBuilder);
+
+	llvm::legacy::FunctionPassManager fpm(&llvmModule);
+	llvm::legacy::PassManager mpm;
+	fpm.add(llvm::createTargetTransformInfoWrapperPass(targetMachine->getTargetIRAnalysis()));
+	mpm.add(llvm::createTargetTransformInfoWrapperPass(targetMachine->getTargetIRAnalysis()));
+	passManagerBuilder.populateFunctionPassManager(fpm);
+	passManagerBuilder.populateModulePassManager(mpm);
+
+	// Run DCE last to work around the CodeGenPrepare bug described in optimizeLLVMModule.
+	mpm.add(llvm::createDeadCodeEliminationPass());
+
+	fpm.doInitialization();
+	runFunctionPasses(fpm, llvmModule, timeReport);
+	fpm.doFinalization();
+	mpm.run(llvmModule);
+#endif
+}
+
+static Metrics::Histogram& optimizeNanoseconds
+	= Metrics::getHistogram("wavm_compile_optimize_nanoseconds",
+							"Time spent optimizing the LLVM IR of a module or partition");
+static Metrics::Histogram& codegenNanoseconds
+	= Metrics::getHistogram("wavm_compile_codegen_nanoseconds",
+							"Time spent generating machine code for a module or partition");
+static Metrics::Histogram& compileModuleNanoseconds
+	= Metrics::getHistogram("wavm_compile_module_nanoseconds",
+							"Time spent compiling a module to object code");
+static Metrics::Counter& numObjectCodeBytes
+	= Metrics::getCounter("wavm_compile_object_code_bytes_total",
+						  "Bytes of object code generated by compiling modules");
+
+static void optimizeLLVMModule(llvm::Module& llvmModule,
+							   llvm::TargetMachine* targetMachine,
+							   Uptr optimizationLevel,
+							   bool shouldLogMetrics,
+							   CompileTimeReport* timeReport)
 {
 	// Run some optimization on the module's functions.
+	Trace::Scope traceScope("llvm", "optimize");
 	Timing::Timer optimizationTimer;
 
-	llvm::legacy::FunctionPassManager fpm(&llvmModule);
-	fpm.add(llvm::createPromoteMemoryToRegisterPass());
-	fpm.add(llvm::createInstructionCombiningPass());
-	fpm.add(llvm::createCFGSimplificationPass());
-	fpm.add(llvm::createJumpThreadingPass());
+	if(optimizationLevel >= 2)
+	{ runStandardOptimizationPipeline(llvmModule, targetMachine, optimizationLevel, timeReport); }
+	else
+	{
+		// The standard pipelines inline functions on their own, but the short pass list only
+		// inlines the functions that emitModule marked as always inline.
+		if(optimizationLevel == 1)
+		{
+			llvm::legacy::PassManager passManager;
+			passManager.add(llvm::createAlwaysInlinerLegacyPass());
+			passManager.run(llvmModule);
+		}
+
+		llvm::legacy::FunctionPassManager fpm(&llvmModule);
+		fpm.add(llvm::createPromoteMemoryToRegisterPass());
+		if(optimizationLevel == 1)
+		{
+			fpm.add(llvm::createInstructionCombiningPass());
+			fpm.add(llvm::createCFGSimplificationPass());
+			fpm.add(llvm::createJumpThreadingPass());
 #if LLVM_VERSION_MAJOR >= 12
-	// LLVM 12 removed the constant propagation pass in favor of the instsimplify pass, which is
-	// itself marked as legacy.
-	// TODO: evaluate if this is the best pass configuration in LLVM 12.
-	fpm.add(llvm::createInstSimplifyLegacyPass());
+			// LLVM 12 removed the constant propagation pass in favor of the instsimplify pass,
+			// which is itself marked as legacy.
+			// TODO: evaluate if this is the best pass configuration in LLVM 12.
+			fpm.add(llvm::createInstSimplifyLegacyPass());
 #else
-	fpm.add(llvm::createConstantPropagationPass());
+			fpm.add(llvm::createConstantPropagationPass());
 #endif
+		}
 
-	// This DCE pass is necessary to work around a bug in LLVM's CodeGenPrepare that's triggered
-	// if there's a dead div/rem with limited-range divisor:
-	// https://bugs.llvm.org/show_bug.cgi?id=43514
-	fpm.add(llvm::createDeadCodeEliminationPass());
+		// This DCE pass is necessary to work around a bug in LLVM's CodeGenPrepare that's
+		// triggered if there's a dead div/rem with limited-range divisor:
+		// https://bugs.llvm.org/show_bug.cgi?id=43514
+		fpm.add(llvm::createDeadCodeEliminationPass());
 
-	fpm.doInitialization();
-	for(auto functionIt = llvmModule.begin(); functionIt != llvmModule.end(); ++functionIt)
-	{ fpm.run(*functionIt); }
+		fpm.doInitialization();
+		runFunctionPasses(fpm, llvmModule, timeReport);
+	}
 
+	optimizeNanoseconds.record(U64(optimizationTimer.getNanoseconds()));
+	if(timeReport) { timeReport->optimizeNanoseconds += U64(optimizationTimer.getNanoseconds()); }
 	if(shouldLogMetrics)
 	{
 		Timing::logRatePerSecond(
@@ -122,7 +419,9 @@ static void optimizeLLVMModule(llvm::Module& llvmModule, bool shouldLogMetrics)
 std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 										   llvm::Module&& llvmModule,
 										   bool shouldLogMetrics,
-										   llvm::TargetMachine* targetMachine)
+										   llvm::TargetMachine* targetMachine,
+										   const CompileOptions& options,
+										   CompileTimeReport* timeReport)
 {
 	// Verify the module.
 	if(WAVM_ENABLE_ASSERTS)
@@ -137,12 +436,35 @@ std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 	}
 
 	// Optimize the module;
-	optimizeLLVMModule(llvmModule, shouldLogMetrics);
+	throwIfCompileCancelled(options);
+	const Uptr optimizationLevel = getOptimizationLevel(options);
+	optimizeLLVMModule(llvmModule, targetMachine, optimizationLevel, shouldLogMetrics, timeReport);
+
+	// At optimization level 0, generate machine code with the fast instruction selector, and
+	// without the code generator's optimization passes. The target machine may be reused by later
+	// compiles, so the other levels turn the fast instruction selector back off.
+	switch(optimizationLevel)
+	{
+	case 0:
+		targetMachine->setOptLevel(llvm::CodeGenOpt::None);
+		targetMachine->setFastISel(true);
+		break;
+	case 3:
+		targetMachine->setOptLevel(llvm::CodeGenOpt::Aggressive);
+		targetMachine->setFastISel(false);
+		break;
+	default:
+		targetMachine->setOptLevel(llvm::CodeGenOpt::Default);
+		targetMachine->setFastISel(false);
+		break;
+	};
 
 	// Generate machine code for the module.
+	throwIfCompileCancelled(options);
 	Timing::Timer machineCodeTimer;
 	std::vector<U8> objectBytes;
 	{
+		Trace::Scope traceScope("llvm", "codegen");
 		llvm::legacy::PassManager passManager;
 		llvm::MCContext* mcContext;
 		LLVMArrayOutputStream objectStream;
@@ -150,6 +472,9 @@ std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 		passManager.run(llvmModule);
 		objectBytes = objectStream.getOutput();
 	}
+	codegenNanoseconds.record(U64(machineCodeTimer.getNanoseconds()));
+	numObjectCodeBytes.add(objectBytes.size());
+	if(timeReport) { timeReport->codegenNanoseconds += U64(machineCodeTimer.getNanoseconds()); }
 	if(shouldLogMetrics)
 	{
 		Timing::logRatePerSecond(
@@ -159,12 +484,11 @@ std::vector<U8> LLVMJIT::compileLLVMModule(LLVMContext& llvmContext,
 	return objectBytes;
 }
 
-static std::unique_ptr<llvm::TargetMachine> getAndValidateTargetMachine(
-	const IR::FeatureSpec& featureSpec,
-	const TargetSpec& targetSpec)
+static llvm::TargetMachine* getAndValidateTargetMachine(const IR::FeatureSpec& featureSpec,
+														const TargetSpec& targetSpec)
 {
 	// Get the target machine.
-	std::unique_ptr<llvm::TargetMachine> targetMachine = getTargetMachine(targetSpec);
+	llvm::TargetMachine* targetMachine = getThreadTargetMachine(targetSpec);
 	if(!targetMachine)
 	{
 		Errors::fatalf("Invalid target spec (triple=%s, cpu=%s).",
@@ -173,7 +497,7 @@ static std::unique_ptr<llvm::TargetMachine> getAndValidateTargetMachine(
 	}
 
 	// Validate that the target machine supports the module's FeatureSpec.
-	switch(validateTarget(targetSpec, featureSpec))
+	switch(validateTargetMachine(targetMachine, featureSpec))
 	{
 	case TargetValidationResult::valid: break;
 
@@ -204,55 +528,526 @@ static std::unique_ptr<llvm::TargetMachine> getAndValidateTargetMachine(
 	return targetMachine;
 }
 
-std::vector<U8> LLVMJIT::compileModule(const IR::Module& irModule, const TargetSpec& targetSpec)
+std::vector<U8> LLVMJIT::bundleObjects(const std::vector<std::vector<U8>>& objects)
 {
-	std::unique_ptr<llvm::TargetMachine> targetMachine
-		= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+	const Uptr numHeaderBytes = sizeof(objectBundleMagic) + sizeof(U64) * (objects.size() + 1);
 
-	// Emit LLVM IR for the module.
-	LLVMContext llvmContext;
+	Uptr numBundleBytes = numHeaderBytes;
+	for(const std::vector<U8>& object : objects)
+	{
+		numBundleBytes
+			= (numBundleBytes + objectBundleAlignment - 1) & ~(objectBundleAlignment - 1);
+		numBundleBytes += object.size();
+	}
+
+	std::vector<U8> bundle(numBundleBytes, 0);
+	memcpy(bundle.data(), objectBundleMagic, sizeof(objectBundleMagic));
+	U64 numObjects = U64(objects.size());
+	memcpy(bundle.data() + sizeof(objectBundleMagic), &numObjects, sizeof(U64));
+
+	Uptr nextObjectOffset = numHeaderBytes;
+	for(Uptr objectIndex = 0; objectIndex < objects.size(); ++objectIndex)
+	{
+		const std::vector<U8>& object = objects[objectIndex];
+		const U64 numObjectBytes = U64(object.size());
+		memcpy(bundle.data() + sizeof(objectBundleMagic) + sizeof(U64) * (objectIndex + 1),
+			   &numObjectBytes,
+			   sizeof(U64));
+
+		nextObjectOffset
+			= (nextObjectOffset + objectBundleAlignment - 1) & ~(objectBundleAlignment - 1);
+		if(object.size())
+		{ memcpy(bundle.data() + nextObjectOffset, object.data(), object.size()); }
+		nextObjectOffset += object.size();
+	}
+	WAVM_ASSERT(nextObjectOffset == numBundleBytes);
+
+	return bundle;
+}
+
+std::vector<llvm::StringRef> LLVMJIT::getBundledObjects(const U8* objectBytes,
+														Uptr numObjectBytes)
+{
+	const char* bundleChars = (const char*)objectBytes;
+	if(numObjectBytes < sizeof(objectBundleMagic) + sizeof(U64)
+	   || memcmp(objectBytes, objectBundleMagic, sizeof(objectBundleMagic)))
+	{ return {llvm::StringRef(bundleChars, numObjectBytes)}; }
+
+	U64 numObjects;
+	memcpy(&numObjects, objectBytes + sizeof(objectBundleMagic), sizeof(U64));
+	WAVM_ERROR_UNLESS(numObjects <= (numObjectBytes - sizeof(objectBundleMagic)) / sizeof(U64) - 1);
+
+	std::vector<llvm::StringRef> objects;
+	Uptr nextObjectOffset = sizeof(objectBundleMagic) + sizeof(U64) * Uptr(numObjects + 1);
+	for(Uptr objectIndex = 0; objectIndex < Uptr(numObjects); ++objectIndex)
+	{
+		U64 numBundledObjectBytes;
+		memcpy(&numBundledObjectBytes,
+			   objectBytes + sizeof(objectBundleMagic) + sizeof(U64) * (objectIndex + 1),
+			   sizeof(U64));
+
+		nextObjectOffset
+			= (nextObjectOffset + objectBundleAlignment - 1) & ~(objectBundleAlignment - 1);
+		WAVM_ERROR_UNLESS(nextObjectOffset <= numObjectBytes
+						  && numBundledObjectBytes <= numObjectBytes - nextObjectOffset);
+
+		objects.push_back(
+			llvm::StringRef(bundleChars + nextObjectOffset, Uptr(numBundledObjectBytes)));
+		nextObjectOffset += Uptr(numBundledObjectBytes);
+	}
+
+	return objects;
+}
+
+// When CompileOptions::numPartitions is 0, each partition is given at least this many function
+// definitions, so small modules don't pay for the threads and the redundant per-partition
+// declarations.
+static constexpr Uptr minFunctionDefsPerAutomaticPartition = 256;
+
+static Uptr getNumPartitions(const IR::Module& irModule,
+							 Uptr numTotalCodeBytes,
+							 llvm::TargetMachine* targetMachine,
+							 const CompileOptions& options)
+{
+	// The Windows SEH tables can only be fixed up by LLVMJIT::Module for a single object.
+	if(targetMachine->getTargetTriple().getOS() == llvm::Triple::Win32) { return 1; }
+
+	const Uptr numFunctionDefs = irModule.functions.defs.size();
+	Uptr numPartitions = options.numPartitions;
+	if(numPartitions == 0)
+	{
+		numPartitions = std::min(Platform::getNumberOfHardwareThreads(),
+								 numFunctionDefs / minFunctionDefsPerAutomaticPartition);
+	}
+
+	// Use enough partitions that none of them has more than maxPartitionCodeBytes of code.
+	if(options.maxPartitionCodeBytes)
+	{
+		numPartitions = std::max(numPartitions,
+								 (numTotalCodeBytes + options.maxPartitionCodeBytes - 1)
+									 / options.maxPartitionCodeBytes);
+	}
+	return std::max(Uptr(1), std::min(numPartitions, numFunctionDefs));
+}
+
+// When the partitions are cached, a partition ends after a function definition whose code hash is
+// a multiple of this, or once it contains maxFunctionDefsPerCachedPartition function definitions.
+static constexpr U64 cachedPartitionBoundaryHashModulus = 16;
+static constexpr Uptr maxFunctionDefsPerCachedPartition = 64;
+
+// Identifies the keys of cached partitions, so they can't be mistaken for the WASM bytes of a
+// module that is cached with the same object cache.
+static constexpr U8 partitionKeyMagic[8] = {0, 'p', 'a', 'r', 't', 'i', 't', 'n'};
+
+namespace {
+	struct PartitionedCompileState
+	{
+		const IR::Module& irModule;
+		const TargetSpec& targetSpec;
+		const CompileOptions& options;
+
+		// The function definitions in partition i are [partitionBegins[i], partitionBegins[i+1]).
+		std::vector<Uptr> partitionBegins;
+		std::vector<std::vector<U8>> partitionObjects;
+
+		// If the partitions are cached, a hash of the partitions' context given by
+		// getEmitModuleContextKey, and the number of partitions that weren't in the cache.
+		bool usePartitionObjectCache = false;
+		U64 contextHash[2] = {0, 0};
+		std::atomic<Uptr> numCompiledPartitions{0};
+
+		// If the caller asked for a time report, each partition's times are collected separately
+		// and added to the caller's report once all partitions are compiled.
+		std::vector<CompileTimeReport> partitionTimeReports;
+
+		Platform::Mutex mutex;
+		Uptr nextPartitionIndex = 0;
+
+		// If the function bodies are validated while they're compiled, the lowest index of a
+		// partition that contains an invalid function body, and the validation error.
+		Uptr failedPartitionIndex = UINTPTR_MAX;
+		std::string failureMessage;
+
+		// Whether a partition's compile was cancelled, which stops the threads from starting to
+		// compile any more partitions.
+		bool wasCancelled = false;
+
+		PartitionedCompileState(const IR::Module& inIRModule,
+								const TargetSpec& inTargetSpec,
+								const CompileOptions& inOptions)
+		: irModule(inIRModule), targetSpec(inTargetSpec), options(inOptions)
+		{
+		}
+	};
+}
+
+static std::vector<U8> emitAndCompilePartition(PartitionedCompileState& state, Uptr partitionIndex)
+{
+	// Each thread uses its own LLVM context and target machine, since neither may be used by
+	// multiple threads at once.
+	llvm::TargetMachine* targetMachine = getThreadTargetMachine(state.targetSpec);
+	WAVM_ERROR_UNLESS(targetMachine);
+
+	CompileTimeReport* timeReport = state.partitionTimeReports.size()
+										 ? &state.partitionTimeReports[partitionIndex]
+										 : nullptr;
+
+	ThreadLLVMContext threadLLVMContext;
+	LLVMContext& llvmContext = *threadLLVMContext;
 	llvm::Module llvmModule("", llvmContext);
-	emitModule(irModule, llvmContext, llvmModule, targetMachine.get());
+	emitModule(state.irModule,
+			   llvmContext,
+			   llvmModule,
+			   targetMachine,
+			   state.partitionBegins[partitionIndex],
+			   state.partitionBegins[partitionIndex + 1],
+			   state.options,
+			   timeReport);
+
+	return compileLLVMModule(
+		llvmContext, std::move(llvmModule), false, targetMachine, state.options, timeReport);
+}
+
+void LLVMJIT::appendCompilerCacheKey(std::vector<U8>& key, const TargetSpec& targetSpec)
+{
+	auto appendBytes = [&key](const void* data, Uptr numBytes) {
+		key.insert(key.end(), (const U8*)data, (const U8*)data + numBytes);
+	};
+	auto appendU64 = [&appendBytes](U64 value) { appendBytes(&value, sizeof(value)); };
+
+	const Version version = getVersion();
+	appendU64(version.llvmMajor);
+	appendU64(version.llvmMinor);
+	appendU64(version.llvmPatch);
+	appendU64(version.llvmjitVersion);
+	appendU64(targetSpec.triple.size());
+	appendBytes(targetSpec.triple.data(), targetSpec.triple.size());
+	appendU64(targetSpec.cpu.size());
+	appendBytes(targetSpec.cpu.data(), targetSpec.cpu.size());
+}
+
+// Returns the bytes that a partition's object code is cached by: everything its code depends on.
+static std::vector<U8> getPartitionKey(const PartitionedCompileState& state, Uptr partitionIndex)
+{
+	std::vector<U8> key;
+	auto appendBytes = [&key](const void* data, Uptr numBytes) {
+		key.insert(key.end(), (const U8*)data, (const U8*)data + numBytes);
+	};
+	auto appendU64 = [&appendBytes](U64 value) { appendBytes(&value, sizeof(value)); };
+
+	appendBytes(partitionKeyMagic, sizeof(partitionKeyMagic));
+	appendCompilerCacheKey(key, state.targetSpec);
+	appendBytes(state.contextHash, sizeof(state.contextHash));
+
+	// The first partition also contains the module's invoke thunks, and the index of each function
+	// definition is in its symbol name.
+	const Uptr beginFunctionDefIndex = state.partitionBegins[partitionIndex];
+	const Uptr endFunctionDefIndex = state.partitionBegins[partitionIndex + 1];
+	appendU64(beginFunctionDefIndex);
+	appendU64(endFunctionDefIndex);
+	for(Uptr functionDefIndex = beginFunctionDefIndex; functionDefIndex < endFunctionDefIndex;
+		++functionDefIndex)
+	{
+		const FunctionDef& functionDef = state.irModule.functions.defs[functionDefIndex];
+		appendU64(functionDef.type.index);
+		appendU64(functionDef.nonParameterLocalTypes.size());
+		appendBytes(functionDef.nonParameterLocalTypes.data(),
+					functionDef.nonParameterLocalTypes.size() * sizeof(ValueType));
+		appendU64(functionDef.code.size());
+		appendBytes(functionDef.code.data(), functionDef.code.size());
+		appendU64(functionDef.branchTableTargetDepths.size());
+		appendBytes(functionDef.branchTableTargetDepths.data(),
+					functionDef.branchTableTargetDepths.size() * sizeof(U32));
+	}
+
+	return key;
+}
+
+static void compilePartition(PartitionedCompileState& state, Uptr partitionIndex)
+{
+	if(!state.usePartitionObjectCache)
+	{
+		state.partitionObjects[partitionIndex] = emitAndCompilePartition(state, partitionIndex);
+		return;
+	}
+
+	const std::vector<U8> key = getPartitionKey(state, partitionIndex);
+	std::shared_ptr<const std::vector<U8>> objectCode
+		= state.options.partitionObjectCache->getCachedObject(
+			key.data(), key.size(), [&state, partitionIndex]() {
+				state.numCompiledPartitions.fetch_add(1, std::memory_order_relaxed);
+				return emitAndCompilePartition(state, partitionIndex);
+			});
+	state.partitionObjects[partitionIndex] = *objectCode;
+}
 
-	// Compile the LLVM IR to object code.
-	return compileLLVMModule(llvmContext, std::move(llvmModule), true, targetMachine.get());
+static I64 partitionedCompileThreadMain(void* sharedStateVoid)
+{
+	PartitionedCompileState& state = *(PartitionedCompileState*)sharedStateVoid;
+	while(true)
+	{
+		Uptr partitionIndex;
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			if(state.wasCancelled || state.nextPartitionIndex == state.partitionObjects.size())
+			{ break; }
+			partitionIndex = state.nextPartitionIndex++;
+		}
+		try
+		{
+			compilePartition(state, partitionIndex);
+		}
+		catch(IR::ValidationException& exception)
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			if(partitionIndex < state.failedPartitionIndex)
+			{
+				state.failedPartitionIndex = partitionIndex;
+				state.failureMessage = std::move(exception.message);
+			}
+		}
+		catch(CompileCancelledException&)
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			state.wasCancelled = true;
+		}
+	}
+	return 0;
+}
+
+// Adds the times in one time report to another.
+static void addTimeReport(CompileTimeReport& timeReport, const CompileTimeReport& addend)
+{
+	timeReport.emitIRNanoseconds += addend.emitIRNanoseconds;
+	timeReport.optimizeNanoseconds += addend.optimizeNanoseconds;
+	timeReport.codegenNanoseconds += addend.codegenNanoseconds;
+
+	if(timeReport.functionDefNanoseconds.size() < addend.functionDefNanoseconds.size())
+	{ timeReport.functionDefNanoseconds.resize(addend.functionDefNanoseconds.size(), 0); }
+	for(Uptr functionDefIndex = 0; functionDefIndex < addend.functionDefNanoseconds.size();
+		++functionDefIndex)
+	{
+		timeReport.functionDefNanoseconds[functionDefIndex]
+			+= addend.functionDefNanoseconds[functionDefIndex];
+	}
+
+	for(const CompileTimeReport::PassTime& passTime : addend.passTimes)
+	{ addPassTime(timeReport, passTime.name, passTime.nanoseconds); }
+}
+
+static std::vector<U8> compileModuleImpl(const IR::Module& irModule,
+										 const TargetSpec& targetSpec,
+										 const CompileOptions& options,
+										 CompileTimeReport* timeReport)
+{
+	Timing::Timer compileTimer;
+	llvm::TargetMachine* targetMachine
+		= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
+
+	// The partitions are only cached if the module can be compiled to more than one of them. The
+	// function definitions that tier up an instance are always compiled as a single partition.
+	const std::vector<FunctionDef>& functionDefs = irModule.functions.defs;
+	const bool usePartitionObjectCache
+		= options.partitionObjectCache && !options.specialization
+		  && !options.tierUpFunctionDefIndices && functionDefs.size()
+		  && targetMachine->getTargetTriple().getOS() != llvm::Triple::Win32;
+
+	Uptr numTotalCodeBytes = 0;
+	for(const FunctionDef& functionDef : functionDefs)
+	{ numTotalCodeBytes += functionDef.code.size(); }
+
+	Uptr numPartitions = 1;
+	if(usePartitionObjectCache) { numPartitions = 0; }
+	else if(!options.tierUpFunctionDefIndices)
+	{
+		numPartitions = getNumPartitions(irModule, numTotalCodeBytes, targetMachine, options);
+	}
+	if(numPartitions == 1)
+	{
+		// Emit LLVM IR for the module.
+		ThreadLLVMContext threadLLVMContext;
+		LLVMContext& llvmContext = *threadLLVMContext;
+		llvm::Module llvmModule("", llvmContext);
+		emitModule(irModule,
+				   llvmContext,
+				   llvmModule,
+				   targetMachine,
+				   0,
+				   irModule.functions.defs.size(),
+				   options,
+				   timeReport);
+
+		// Compile the LLVM IR to object code.
+		std::vector<U8> objectBytes = compileLLVMModule(
+			llvmContext, std::move(llvmModule), true, targetMachine, options, timeReport);
+		compileModuleNanoseconds.record(U64(compileTimer.getNanoseconds()));
+		return objectBytes;
+	}
+
+	PartitionedCompileState state(irModule, targetSpec, options);
+	state.partitionBegins.push_back(0);
+	if(usePartitionObjectCache)
+	{
+		// End each partition after a function definition chosen by its code, so the boundaries
+		// between the partitions that contain unchanged functions stay where they were.
+		for(Uptr functionDefIndex = 0; functionDefIndex + 1 < functionDefs.size();
+			++functionDefIndex)
+		{
+			const std::vector<U8>& code = functionDefs[functionDefIndex].code;
+			if(XXH64(code.data(), code.size(), 0) % cachedPartitionBoundaryHashModulus == 0
+			   || functionDefIndex + 1 - state.partitionBegins.back()
+					  == maxFunctionDefsPerCachedPartition)
+			{ state.partitionBegins.push_back(functionDefIndex + 1); }
+		}
+
+		// Hash the context once, instead of adding it to each partition's key.
+		const std::vector<U8> contextKey = getEmitModuleContextKey(irModule, options);
+		state.usePartitionObjectCache = true;
+		state.contextHash[0] = XXH64(contextKey.data(), contextKey.size(), 0);
+		state.contextHash[1] = XXH64(contextKey.data(), contextKey.size(), 1);
+	}
+	else
+	{
+		// Split the function definitions into contiguous partitions with roughly the same number
+		// of bytes of WebAssembly code in each.
+		Uptr functionDefIndex = 0;
+		Uptr numPartitionedCodeBytes = 0;
+		for(Uptr partitionIndex = 0; partitionIndex + 1 < numPartitions; ++partitionIndex)
+		{
+			// Leave at least one function definition for each of the remaining partitions.
+			const Uptr maxEndFunctionDefIndex
+				= functionDefs.size() - (numPartitions - partitionIndex - 1);
+			const Uptr targetCodeBytes = numTotalCodeBytes * (partitionIndex + 1) / numPartitions;
+			do
+			{
+				numPartitionedCodeBytes += functionDefs[functionDefIndex].code.size();
+				++functionDefIndex;
+			} while(functionDefIndex < maxEndFunctionDefIndex
+					&& numPartitionedCodeBytes < targetCodeBytes);
+			state.partitionBegins.push_back(functionDefIndex);
+		}
+	}
+	state.partitionBegins.push_back(functionDefs.size());
+
+	const Uptr numPartitionsToCompile = state.partitionBegins.size() - 1;
+	state.partitionObjects.resize(numPartitionsToCompile);
+	if(timeReport) { state.partitionTimeReports.resize(numPartitionsToCompile); }
+
+	// Compile the partitions on the calling thread and one additional thread for each hardware
+	// thread, up to the number of partitions, or the number of partitions the caller asked for:
+	// the partitions added to limit their size don't add threads. Each thread frees a partition's
+	// LLVM IR before it emits the next one, so only numThreads partitions' IR exists at once.
+	Uptr numThreads = std::min(numPartitionsToCompile, Platform::getNumberOfHardwareThreads());
+	if(options.numPartitions) { numThreads = std::min(numThreads, options.numPartitions); }
+	numThreads = std::max(Uptr(1), numThreads);
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+	{
+		threads.push_back(
+			Platform::createThread(8 * 1024 * 1024, partitionedCompileThreadMain, &state));
+	}
+	partitionedCompileThreadMain(&state);
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+	if(state.wasCancelled) { throw CompileCancelledException(); }
+
+	// Report the validation error for the lowest partition that failed, which contains the lowest
+	// invalid function body, so the error doesn't depend on how the partitions were compiled.
+	if(state.failedPartitionIndex != UINTPTR_MAX)
+	{ throw IR::ValidationException(std::move(state.failureMessage)); }
+
+	for(const CompileTimeReport& partitionTimeReport : state.partitionTimeReports)
+	{ addTimeReport(*timeReport, partitionTimeReport); }
+
+	compileModuleNanoseconds.record(U64(compileTimer.getNanoseconds()));
+	Timing::logRatePerSecond("Compiled partitioned module",
+							 compileTimer,
+							 (F64)functionDefs.size(),
+							 "functions");
+	Log::printf(Log::metrics,
+				"Compiled %" WAVM_PRIuPTR " partitions on %" WAVM_PRIuPTR " threads\n",
+				numPartitionsToCompile,
+				numThreads);
+	if(usePartitionObjectCache)
+	{
+		Log::printf(Log::metrics,
+					"Reused %" WAVM_PRIuPTR " of %" WAVM_PRIuPTR " partitions from the cache\n",
+					numPartitionsToCompile
+						- state.numCompiledPartitions.load(std::memory_order_relaxed),
+					numPartitionsToCompile);
+	}
+
+	return bundleObjects(state.partitionObjects);
+}
+
+std::vector<U8> LLVMJIT::compileModule(const IR::Module& irModule,
+									   const TargetSpec& targetSpec,
+									   const CompileOptions& options,
+									   CompileTimeReport* outTimeReport)
+{
+	if(!outTimeReport) { return compileModuleImpl(irModule, targetSpec, options, nullptr); }
+
+	// Turn on LLVM's timers for the passes run by the legacy pass manager while compiling.
+	Timing::Timer compileTimer;
+	const bool wereLLVMPassTimersEnabled = llvm::TimePassesIsEnabled;
+	llvm::TimePassesIsEnabled = true;
+
+	std::vector<U8> objectBytes
+		= compileModuleImpl(irModule, targetSpec, options, outTimeReport);
+
+#if LLVM_VERSION_MAJOR >= 8
+	addLegacyPassTimes(*outTimeReport);
+#endif
+	llvm::TimePassesIsEnabled = wereLLVMPassTimersEnabled;
+
+	// Sort the passes by descending time.
+	std::sort(outTimeReport->passTimes.begin(),
+			  outTimeReport->passTimes.end(),
+			  [](const CompileTimeReport::PassTime& left, const CompileTimeReport::PassTime& right) {
+				  return left.nanoseconds > right.nanoseconds;
+			  });
+
+	outTimeReport->totalNanoseconds += U64(compileTimer.getNanoseconds());
+	return objectBytes;
 }
 
 std::string LLVMJIT::emitLLVMIR(const IR::Module& irModule,
 								const TargetSpec& targetSpec,
-								bool optimize)
+								bool optimize,
+								const CompileOptions& options)
 {
-	std::unique_ptr<llvm::TargetMachine> targetMachine
+	llvm::TargetMachine* targetMachine
 		= getAndValidateTargetMachine(irModule.featureSpec, targetSpec);
 
 	// Emit LLVM IR for the module.
-	LLVMContext llvmContext;
+	ThreadLLVMContext threadLLVMContext;
+	LLVMContext& llvmContext = *threadLLVMContext;
 	llvm::Module llvmModule("", llvmContext);
-	emitModule(irModule, llvmContext, llvmModule, targetMachine.get());
+	emitModule(irModule,
+			   llvmContext,
+			   llvmModule,
+			   targetMachine,
+			   0,
+			   irModule.functions.defs.size(),
+			   options);
 
 	// Optimize the LLVM IR.
-	if(optimize) { optimizeLLVMModule(llvmModule, true); }
+	if(optimize)
+	{
+		optimizeLLVMModule(llvmModule, targetMachine, getOptimizationLevel(options), true, nullptr);
+	}
 
 	// Print the LLVM IR.
 	return printModule(llvmModule);
 }
 
-std::string LLVMJIT::disassembleObject(const TargetSpec& targetSpec,
-									   const std::vector<U8>& objectBytes)
+static void disassembleObjectFunctions(LLVMDisasmContextRef disasmRef,
+									   const llvm::object::ObjectFile& object,
+									   llvm::StringRef objectBytes,
+									   std::string& result)
 {
-	std::string result;
-
-	LLVMDisasmContextRef disasmRef
-		= LLVMCreateDisasm(targetSpec.triple.c_str(), nullptr, 0, nullptr, nullptr);
-	WAVM_ERROR_UNLESS(LLVMSetDisasmOptions(disasmRef, LLVMDisassembler_Option_PrintLatency));
-
-	std::unique_ptr<llvm::object::ObjectFile> object
-		= cantFail(llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(
-			llvm::StringRef((const char*)objectBytes.data(), objectBytes.size()), "memory")));
-
 	// Iterate over the functions in the loaded object.
 	for(std::pair<llvm::object::SymbolRef, U64> symbolSizePair :
-		llvm::object::computeSymbolSizes(*object))
+		llvm::object::computeSymbolSizes(object))
 	{
 		llvm::object::SymbolRef symbol = symbolSizePair.first;
 
@@ -274,7 +1069,7 @@ std::string LLVMJIT::disassembleObject(const TargetSpec& targetSpec,
 		if(!addressInSection) { continue; }
 
 		// Compute the address the function was loaded at.
-		llvm::StringRef sectionContents((const char*)objectBytes.data(), objectBytes.size());
+		llvm::StringRef sectionContents = objectBytes;
 		if(llvm::Expected<llvm::object::section_iterator> symbolSection = symbol.getSection())
 		{
 #if LLVM_VERSION_MAJOR >= 9
@@ -323,8 +1118,75 @@ std::string LLVMJIT::disassembleObject(const TargetSpec& targetSpec,
 			result += '\n';
 		};
 	}
+}
+
+std::string LLVMJIT::disassembleObject(const TargetSpec& targetSpec,
+									   const std::vector<U8>& objectBytes)
+{
+	std::string result;
+
+	LLVMDisasmContextRef disasmRef
+		= LLVMCreateDisasm(targetSpec.triple.c_str(), nullptr, 0, nullptr, nullptr);
+	WAVM_ERROR_UNLESS(LLVMSetDisasmOptions(disasmRef, LLVMDisassembler_Option_PrintLatency));
+
+	for(llvm::StringRef bundledObject : getBundledObjects(objectBytes.data(), objectBytes.size()))
+	{
+		std::unique_ptr<llvm::object::ObjectFile> object
+			= cantFail(llvm::object::ObjectFile::createObjectFile(
+				llvm::MemoryBufferRef(bundledObject, "memory")));
+		disassembleObjectFunctions(disasmRef, *object, bundledObject, result);
+	}
 
 	LLVMDisasmDispose(disasmRef);
 
 	return result;
 }
+
+Uptr LLVMJIT::findBestHostObjectCode(const std::vector<TargetObjectCode>& objectCodes)
+{
+	const TargetSpec hostTargetSpec = getHostTargetSpec();
+	llvm::TargetMachine* hostTargetMachine = getThreadTargetMachine(hostTargetSpec);
+	WAVM_ERROR_UNLESS(hostTargetMachine);
+	const llvm::Triple::ArchType hostArch = hostTargetMachine->getTargetTriple().getArch();
+	const llvm::FeatureBitset& hostFeatures
+		= hostTargetMachine->getMCSubtargetInfo()->getFeatureBits();
+
+	Uptr bestIndex = UINTPTR_MAX;
+	Uptr bestNumFeatures = 0;
+	for(Uptr index = 0; index < objectCodes.size(); ++index)
+	{
+		const TargetObjectCode& objectCode = objectCodes[index];
+
+		// Skip object code for other architectures. The CPU name alone doesn't identify the
+		// architecture, so check the architecture of the object file.
+		std::vector<llvm::StringRef> objects
+			= getBundledObjects(objectCode.bytes, objectCode.numBytes);
+		if(!objects.size()) { continue; }
+		llvm::Expected<std::unique_ptr<llvm::object::ObjectFile>> object
+			= llvm::object::ObjectFile::createObjectFile(
+				llvm::MemoryBufferRef(objects[0], "memory"));
+		if(!object)
+		{
+			llvm::consumeError(object.takeError());
+			continue;
+		}
+		if((*object)->getArch() != hostArch) { continue; }
+
+		// Skip object code for target CPUs with features that the host CPU doesn't support.
+		llvm::TargetMachine* targetMachine
+			= getThreadTargetMachine(TargetSpec{hostTargetSpec.triple, objectCode.cpu});
+		if(!targetMachine) { continue; }
+		const llvm::FeatureBitset& targetFeatures
+			= targetMachine->getMCSubtargetInfo()->getFeatureBits();
+		if((targetFeatures & hostFeatures) != targetFeatures) { continue; }
+
+		const Uptr numFeatures = Uptr(targetFeatures.count());
+		if(bestIndex == UINTPTR_MAX || numFeatures > bestNumFeatures)
+		{
+			bestIndex = index;
+			bestNumFeatures = numFeatures;
+		}
+	}
+
+	return bestIndex;
+}
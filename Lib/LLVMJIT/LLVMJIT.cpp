@@ -1,5 +1,8 @@
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include <memory>
+#include <tuple>
 #include <utility>
+#include <vector>
 #include "LLVMJITPrivate.h"
 #include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/Inline/Assert.h"
@@ -9,6 +12,7 @@
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/ADT/APInt.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/CodeGen/TargetSubtargetInfo.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
@@ -17,6 +21,7 @@ PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Type.h>
 #include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/Host.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
 POP_DISABLE_WARNINGS_FOR_LLVM_HEADERS
@@ -168,6 +173,22 @@ TargetSpec LLVMJIT::getHostTargetSpec()
 	TargetSpec result;
 	result.triple = llvm::sys::getProcessTriple();
 	result.cpu = std::string(llvm::sys::getHostCPUName());
+
+	// The host CPU name is "generic" for AArch64 CPUs that LLVM doesn't know, so the LSE atomic
+	// instructions that the CPU supports wouldn't be used. If the CPU supports them, but the named
+	// CPU doesn't imply them, add them to the target CPU, so they're distinguished from the code
+	// compiled for CPUs that don't support them.
+	if(llvm::Triple(result.triple).getArch() == llvm::Triple::aarch64)
+	{
+		llvm::StringMap<bool> hostFeatures;
+		if(llvm::sys::getHostCPUFeatures(hostFeatures) && hostFeatures.lookup("lse"))
+		{
+			llvm::TargetMachine* targetMachine = getThreadTargetMachine(result);
+			if(targetMachine && !targetMachine->getMCSubtargetInfo()->checkFeatures("+lse"))
+			{ result.cpu += ",+lse"; }
+		}
+	}
+
 	return result;
 }
 
@@ -178,6 +199,17 @@ std::unique_ptr<llvm::TargetMachine> LLVMJIT::getTargetMachine(const TargetSpec&
 	llvm::Triple triple(targetSpec.triple);
 	llvm::SmallVector<std::string, 1> targetAttributes;
 
+	// The target CPU may be followed by a comma-separated list of features to enable or disable.
+	llvm::StringRef cpu = targetSpec.cpu;
+	llvm::StringRef cpuFeatures;
+	std::tie(cpu, cpuFeatures) = cpu.split(',');
+	while(cpuFeatures.size())
+	{
+		llvm::StringRef feature;
+		std::tie(feature, cpuFeatures) = cpuFeatures.split(',');
+		if(feature.size()) { targetAttributes.push_back(std::string(feature)); }
+	}
+
 #if LLVM_VERSION_MAJOR < 10
 	if(triple.getArch() == llvm::Triple::x86 || triple.getArch() == llvm::Triple::x86_64)
 	{
@@ -188,12 +220,71 @@ std::unique_ptr<llvm::TargetMachine> LLVMJIT::getTargetMachine(const TargetSpec&
 #endif
 
 	return std::unique_ptr<llvm::TargetMachine>(
-		llvm::EngineBuilder().selectTarget(triple, "", targetSpec.cpu, targetAttributes));
+		llvm::EngineBuilder().selectTarget(triple, "", cpu, targetAttributes));
+}
+
+llvm::TargetMachine* LLVMJIT::getThreadTargetMachine(const TargetSpec& targetSpec)
+{
+	// Threads only compile for a few different targets, so search the cache linearly.
+	struct CachedTargetMachine
+	{
+		TargetSpec targetSpec;
+		std::unique_ptr<llvm::TargetMachine> targetMachine;
+	};
+	static thread_local std::vector<CachedTargetMachine> cachedTargetMachines;
+	for(const CachedTargetMachine& cachedTargetMachine : cachedTargetMachines)
+	{
+		if(cachedTargetMachine.targetSpec.triple == targetSpec.triple
+		   && cachedTargetMachine.targetSpec.cpu == targetSpec.cpu)
+		{ return cachedTargetMachine.targetMachine.get(); }
+	};
+
+	cachedTargetMachines.push_back({targetSpec, getTargetMachine(targetSpec)});
+	return cachedTargetMachines.back().targetMachine.get();
+}
+
+// The number of compiles that reuse a thread's LLVMContext before it is replaced. LLVM never frees
+// the constants and types that are created in a context, so replacing it bounds the memory used by
+// the constants of modules that were compiled in it.
+static constexpr Uptr maxThreadLLVMContextUses = 64;
+
+struct ThreadLLVMContextState
+{
+	std::unique_ptr<LLVMContext> context;
+	Uptr numUses = 0;
+	bool isInUse = false;
+};
+
+static thread_local ThreadLLVMContextState threadLLVMContextState;
+
+ThreadLLVMContext::ThreadLLVMContext()
+{
+	ThreadLLVMContextState& state = threadLLVMContextState;
+	if(state.isInUse)
+	{
+		unpooledContext = std::make_unique<LLVMContext>();
+		context = unpooledContext.get();
+		return;
+	}
+
+	if(!state.context || state.numUses >= maxThreadLLVMContextUses)
+	{
+		state.context.reset();
+		state.context = std::make_unique<LLVMContext>();
+		state.numUses = 0;
+	}
+	++state.numUses;
+	state.isInUse = true;
+	context = state.context.get();
+}
+
+ThreadLLVMContext::~ThreadLLVMContext()
+{
+	if(!unpooledContext) { threadLLVMContextState.isInUse = false; }
 }
 
-TargetValidationResult LLVMJIT::validateTargetMachine(
-	const std::unique_ptr<llvm::TargetMachine>& targetMachine,
-	const FeatureSpec& featureSpec)
+TargetValidationResult LLVMJIT::validateTargetMachine(llvm::TargetMachine* targetMachine,
+													  const FeatureSpec& featureSpec)
 {
 	const llvm::Triple::ArchType targetArch = targetMachine->getTargetTriple().getArch();
 	if(targetArch == llvm::Triple::x86_64)
@@ -223,12 +314,12 @@ TargetValidationResult LLVMJIT::validateTargetMachine(
 TargetValidationResult LLVMJIT::validateTarget(const TargetSpec& targetSpec,
 											   const IR::FeatureSpec& featureSpec)
 {
-	std::unique_ptr<llvm::TargetMachine> targetMachine = getTargetMachine(targetSpec);
+	llvm::TargetMachine* targetMachine = getThreadTargetMachine(targetSpec);
 	if(!targetMachine) { return TargetValidationResult::invalidTargetSpec; }
 	return validateTargetMachine(targetMachine, featureSpec);
 }
 
 Version LLVMJIT::getVersion()
 {
-	return Version{LLVM_VERSION_MAJOR, LLVM_VERSION_MINOR, LLVM_VERSION_PATCH, 5};
+	return Version{LLVM_VERSION_MAJOR, LLVM_VERSION_MINOR, LLVM_VERSION_PATCH, 9};
 }
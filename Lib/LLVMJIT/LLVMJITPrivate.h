@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cctype>
+#include <map>
 #include <string>
 #include <vector>
 #include "WAVM/IR/Module.h"
@@ -168,29 +169,14 @@ namespace WAVM { namespace LLVMJIT {
 									 llvm::ArrayRef<llvm::Type*>(llvmTypes, typeTuple.size()));
 	}
 
-	inline bool areResultsReturnedDirectly(IR::TypeTuple results)
-	{
-		// On X64, the calling conventions can return up to 3 i64s and 4 float/vectors.
-		// For simplicity, just allow up to 3 values to be returned, including the implicitly
-		// returned context pointer.
-		static constexpr Uptr maxDirectlyReturnedValues = 3;
-		return results.size() + 1 <= maxDirectlyReturnedValues;
-	}
-
+	// Returns the type of the struct that a function with the wasm calling convention returns: the
+	// context pointer, and a struct of the function's results. Calls between wasm functions return
+	// the results in registers when the target's calling convention has enough of them, and
+	// otherwise LLVM returns them through a hidden pointer to the caller's stack frame.
 	inline llvm::StructType* getLLVMReturnStructType(LLVMContext& llvmContext,
 													 IR::TypeTuple results)
 	{
-		if(areResultsReturnedDirectly(results))
-		{
-			// A limited number of results can be packed into a struct and returned directly.
-			return llvm::StructType::get(llvmContext.i8PtrType, asLLVMType(llvmContext, results));
-		}
-		else
-		{
-			// If there are too many results to be returned directly, they will be returned in the
-			// context arg/return memory block.
-			return llvm::StructType::get(llvmContext.i8PtrType);
-		}
+		return llvm::StructType::get(llvmContext.i8PtrType, asLLVMType(llvmContext, results));
 	}
 
 	inline llvm::Constant* getZeroedLLVMReturnStruct(LLVMContext& llvmContext,
@@ -261,7 +247,14 @@ namespace WAVM { namespace LLVMJIT {
 	{
 		switch(callingConvention)
 		{
-		case IR::CallingConvention::wasm: return llvm::CallingConv::Fast;
+		// WebAssembly functions use tailcc where LLVM supports it, so return_call and
+		// return_call_indirect can reuse the caller's stack frame for any callee signature.
+		case IR::CallingConvention::wasm:
+#if LLVM_VERSION_MAJOR >= 11
+			return llvm::CallingConv::Tail;
+#else
+			return llvm::CallingConv::Fast;
+#endif
 
 		case IR::CallingConvention::intrinsic:
 		case IR::CallingConvention::intrinsicWithContextSwitch:
@@ -370,11 +363,59 @@ namespace WAVM { namespace LLVMJIT {
 #endif
 	}
 
-	// Emits LLVM IR for a module.
+	// Throws a CompileCancelledException if the options' cancelFlag is set.
+	inline void throwIfCompileCancelled(const CompileOptions& options)
+	{
+		if(options.cancelFlag && options.cancelFlag->load(std::memory_order_relaxed))
+		{ throw CompileCancelledException(); }
+	}
+
+	// Emits LLVM IR for a module. Only the function definitions with indices in
+	// [beginFunctionDefIndex, endFunctionDefIndex) are defined by the LLVM module; the others are
+	// declared as external symbols that must be defined by another object in the same bundle.
+	// If timeReport is non-null, the time spent emitting the IR is added to it.
 	void emitModule(const IR::Module& irModule,
 					LLVMContext& llvmContext,
 					llvm::Module& outLLVMModule,
-					llvm::TargetMachine* targetMachine);
+					llvm::TargetMachine* targetMachine,
+					Uptr beginFunctionDefIndex,
+					Uptr endFunctionDefIndex,
+					const CompileOptions& options,
+					CompileTimeReport* timeReport = nullptr);
+
+	// Returns bytes that identify everything besides the code of a partition's function
+	// definitions that emitModule's output for the partition depends on: the module without its
+	// function bodies and data segment contents, what emitModule infers from the code of the
+	// other function definitions, and the options.
+	std::vector<U8> getEmitModuleContextKey(const IR::Module& irModule,
+											const CompileOptions& options);
+
+	// Emits an invoke thunk for a function type into a LLVM module: a function that loads the
+	// arguments for a function of that type from an array of UntaggedValues, calls the function,
+	// and stores its results to another array of UntaggedValues. mutableData and typeId are the
+	// values for the thunk's Runtime::Function prefix.
+	void emitInvokeThunk(LLVMContext& llvmContext,
+						 llvm::Module& llvmModule,
+						 llvm::TargetMachine* targetMachine,
+						 llvm::Type* iptrType,
+						 IR::FunctionType functionType,
+						 const std::string& name,
+						 llvm::Constant* mutableData,
+						 llvm::Constant* typeId);
+
+	// Object code for a module that was compiled in several partitions is stored as a bundle of
+	// objects: objectBundleMagic, followed by a U64 number of objects, a U64 number of bytes for
+	// each object, and then the objects themselves, each starting at a multiple of
+	// objectBundleAlignment bytes from the beginning of the bundle.
+	static constexpr U8 objectBundleMagic[8] = {'W', 'A', 'V', 'M', 'O', 'B', 'J', 'S'};
+	static constexpr Uptr objectBundleAlignment = 16;
+
+	// Creates a bundle from a list of objects.
+	std::vector<U8> bundleObjects(const std::vector<std::vector<U8>>& objects);
+
+	// Returns the objects contained in object code that was produced by compileModule. If the
+	// object code isn't a bundle, it is returned as the only object.
+	std::vector<llvm::StringRef> getBundledObjects(const U8* objectBytes, Uptr numObjectBytes);
 
 	// Used to override LLVM's default behavior of looking up unresolved symbols in DLL exports.
 	llvm::JITEvaluatedSymbol resolveJITImport(llvm::StringRef name);
@@ -390,40 +431,94 @@ namespace WAVM { namespace LLVMJIT {
 		std::string debugName;
 
 #if LAZY_PARSE_DWARF_LINE_INFO
+		// A DWARF context for each object loaded by the module, keyed by the end address of the
+		// image the object was loaded into.
 		Platform::Mutex dwarfContextMutex;
-		std::unique_ptr<llvm::DWARFContext> dwarfContext;
+		std::map<Uptr, std::unique_ptr<llvm::DWARFContext>> dwarfContexts;
+#else
+		// The (machine code offset, op index) pairs of all the module's functions, sorted by
+		// offset within each function, and delta encoded as LEB128. Each function's
+		// FunctionMutableData identifies its range of the table.
+		std::vector<U8> offsetToOpIndexTable;
 #endif
 
-		Module(const std::vector<U8>& inObjectBytes,
+		Module(const U8* objectBytes,
+			   Uptr numObjectBytes,
 			   const HashMap<std::string, Uptr>& importedSymbolMap,
 			   bool shouldLogMetrics,
 			   std::string&& inDebugName);
 		~Module();
 
+		ModuleMemoryUsage getMemoryUsage(bool sampleResidency) const;
+
 	private:
 		ModuleMemoryManager* memoryManager;
+		Uptr numObjects;
 
 		// Module holds a shared pointer to GlobalModuleState to ensure that on exit it is not
 		// destructed until after all Modules have been destructed.
 		std::shared_ptr<GlobalModuleState> globalModuleState;
 
-		// Have to keep copies of these around because until LLVM 8, GDB registration listener uses
-		// their pointers as keys for deregistration.
+		// Whether the module's objects were registered with GDB when it was loaded, so they must be
+		// deregistered when it is unloaded.
+		const bool isRegisteredWithGDB;
+
+		// If the module is registered with GDB, have to keep copies of these around because until
+		// LLVM 8, GDB registration listener uses their pointers as keys for deregistration.
 #if LLVM_VERSION_MAJOR < 8
 		std::vector<U8> objectBytes;
-		std::unique_ptr<llvm::object::ObjectFile> object;
+		std::vector<std::unique_ptr<llvm::object::ObjectFile>> objects;
 #endif
+
+		// Returns a unique key for each object loaded by the module to identify it to the GDB
+		// registration listener.
+		Uptr getGDBRegistrationKey(Uptr objectIndex) const
+		{
+			WAVM_ASSERT(objectIndex < sizeof(Module));
+			return reinterpret_cast<Uptr>(this) + objectIndex;
+		}
 	};
 
 	extern std::unique_ptr<llvm::TargetMachine> getTargetMachine(const TargetSpec& targetSpec);
-	extern TargetValidationResult validateTargetMachine(
-		const std::unique_ptr<llvm::TargetMachine>& targetMachine,
-		const IR::FeatureSpec& featureSpec);
+	extern TargetValidationResult validateTargetMachine(llvm::TargetMachine* targetMachine,
+														const IR::FeatureSpec& featureSpec);
+
+	// Returns a TargetMachine for the target spec that is cached for the calling thread, or null
+	// if the target spec is invalid. The TargetMachine must only be used by the calling thread.
+	// Creating a TargetMachine is a significant part of the time to compile a small module.
+	extern llvm::TargetMachine* getThreadTargetMachine(const TargetSpec& targetSpec);
+
+	// Gives the calling thread's LLVMContext to a compile for the lifetime of the
+	// ThreadLLVMContext, so consecutive compiles on a thread don't each create a context and its
+	// types. Each LLVM module that is created in the context must be destroyed before the
+	// ThreadLLVMContext. If the thread's context is already in use, a new one is created.
+	struct ThreadLLVMContext
+	{
+		ThreadLLVMContext();
+		~ThreadLLVMContext();
+
+		ThreadLLVMContext(const ThreadLLVMContext&) = delete;
+		void operator=(const ThreadLLVMContext&) = delete;
 
+		LLVMContext& operator*() const { return *context; }
+
+	private:
+		LLVMContext* context;
+		std::unique_ptr<LLVMContext> unpooledContext;
+	};
+
+	// Optimizes a LLVM module and generates object code for it. If timeReport is non-null, the
+	// time spent in each phase and LLVM pass is added to it.
 	extern std::vector<U8> compileLLVMModule(LLVMContext& llvmContext,
 											 llvm::Module&& llvmModule,
 											 bool shouldLogMetrics,
-											 llvm::TargetMachine* targetMachine);
+											 llvm::TargetMachine* targetMachine,
+											 const CompileOptions& options,
+											 CompileTimeReport* timeReport = nullptr);
+
+	// Appends the LLVM and LLVMJIT versions and the target spec to the key of an object in an
+	// object cache.
+	void appendCompilerCacheKey(std::vector<U8>& key, const TargetSpec& targetSpec);
 
 	extern void processSEHTables(U8* imageBase,
 								 const llvm::LoadedObjectInfo& loadedObject,
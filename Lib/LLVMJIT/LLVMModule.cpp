@@ -1,6 +1,8 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -15,12 +17,16 @@
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/LEB128.h"
+#include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
-#include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Platform/Signal.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
@@ -59,14 +65,38 @@ namespace WAVM { namespace Runtime {
 using namespace WAVM;
 using namespace WAVM::LLVMJIT;
 
+static std::atomic<bool> gdbRegistrationEnabled{!!WAVM_DEBUG};
+
+static Metrics::Gauge& numCommittedCodeBytes
+	= Metrics::getGauge("wavm_committed_bytes{kind=\"code\"}",
+						"Bytes of virtual memory committed by WAVM");
+
+void LLVMJIT::setGDBRegistrationEnabled(bool enabled) { gdbRegistrationEnabled.store(enabled); }
+bool LLVMJIT::getGDBRegistrationEnabled() { return gdbRegistrationEnabled.load(); }
+
 struct LLVMJIT::GlobalModuleState
 {
+	// The GDB registration listener is only created when the first module is registered with GDB.
 	Platform::Mutex gdbRegistrationListenerMutex;
 	llvm::JITEventListener* gdbRegistrationListener = nullptr;
 
-	// A map from address to loaded JIT symbols.
-	Platform::RWMutex addressToModuleMapMutex;
-	std::map<Uptr, LLVMJIT::Module*> addressToModuleMap;
+	// A sorted array of the address ranges of the loaded JIT images. Lookups happen for every
+	// frame of a call stack that is described, and for every trap, so they don't take a lock:
+	// the array is never modified after it is published, and loading or unloading a module
+	// publishes a new array instead. Replaced arrays are retired until there are no lookups in
+	// progress, so they are not deleted while a lookup is reading them.
+	struct ImageAddressRange
+	{
+		Uptr beginAddress;
+		Uptr endAddress;
+		LLVMJIT::Module* module;
+	};
+	typedef std::vector<ImageAddressRange> ImageAddressIndex;
+
+	Platform::Mutex imageAddressIndexUpdateMutex;
+	std::atomic<const ImageAddressIndex*> imageAddressIndex{new ImageAddressIndex};
+	std::atomic<Uptr> numImageAddressIndexLookups{0};
+	std::vector<const ImageAddressIndex*> retiredImageAddressIndices;
 
 	static const std::shared_ptr<GlobalModuleState>& get()
 	{
@@ -76,66 +106,225 @@ struct LLVMJIT::GlobalModuleState
 
 	// These constructor and destructor should not be called directly, but must be public in order
 	// to be accessible by std::make_shared.
-	GlobalModuleState()
+	GlobalModuleState() {}
+	~GlobalModuleState()
+	{
+		delete gdbRegistrationListener;
+		delete imageAddressIndex.load(std::memory_order_acquire);
+		for(const ImageAddressIndex* retiredIndex : retiredImageAddressIndices)
+		{ delete retiredIndex; }
+	}
+
+	// Publishes a copy of the image address index with the images of a module added or removed.
+	void addImageAddressRanges(const std::vector<ImageAddressRange>& ranges)
+	{
+		updateImageAddressIndex([&ranges](ImageAddressIndex& index) {
+			index.insert(index.end(), ranges.begin(), ranges.end());
+		});
+	}
+	void removeImageAddressRanges(LLVMJIT::Module* module)
+	{
+		updateImageAddressIndex([module](ImageAddressIndex& index) {
+			index.erase(std::remove_if(index.begin(),
+									   index.end(),
+									   [module](const ImageAddressRange& range) {
+										   return range.module == module;
+									   }),
+						index.end());
+		});
+	}
+
+	// Finds the module with an image that contains the given address without taking a lock.
+	LLVMJIT::Module* findModuleByAddress(Uptr address)
+	{
+		// The count of lookups must be incremented before loading the index, and the index must
+		// be published before the count is checked, so these use sequentially consistent order.
+		numImageAddressIndexLookups.fetch_add(1, std::memory_order_seq_cst);
+		const ImageAddressIndex& index = *imageAddressIndex.load(std::memory_order_seq_cst);
+
+		LLVMJIT::Module* module = nullptr;
+		auto rangeIt = std::upper_bound(
+			index.begin(), index.end(), address, [](Uptr address, const ImageAddressRange& range) {
+				return address < range.endAddress;
+			});
+		if(rangeIt != index.end() && address >= rangeIt->beginAddress) { module = rangeIt->module; }
+
+		numImageAddressIndexLookups.fetch_sub(1, std::memory_order_release);
+		return module;
+	}
+
+private:
+	template<typename UpdateFunc> void updateImageAddressIndex(UpdateFunc&& update)
 	{
-		gdbRegistrationListener = llvm::JITEventListener::createGDBRegistrationListener();
+		Platform::Mutex::Lock updateLock(imageAddressIndexUpdateMutex);
+
+		const ImageAddressIndex* oldIndex = imageAddressIndex.load(std::memory_order_acquire);
+		ImageAddressIndex* newIndex = new ImageAddressIndex(*oldIndex);
+		update(*newIndex);
+		std::sort(newIndex->begin(),
+				  newIndex->end(),
+				  [](const ImageAddressRange& left, const ImageAddressRange& right) {
+					  return left.endAddress < right.endAddress;
+				  });
+		imageAddressIndex.store(newIndex, std::memory_order_seq_cst);
+		retiredImageAddressIndices.push_back(oldIndex);
+
+		// Lookups that start after the new index was published can't see the retired indices,
+		// so if there are no lookups in progress, nothing can be reading a retired index.
+		if(numImageAddressIndexLookups.load(std::memory_order_seq_cst) == 0)
+		{
+			for(const ImageAddressIndex* retiredIndex : retiredImageAddressIndices)
+			{ delete retiredIndex; }
+			retiredImageAddressIndices.clear();
+		}
 	}
-	~GlobalModuleState() { delete gdbRegistrationListener; }
 };
 
-// Allocates memory for the LLVM object loader.
-struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
+#if !LAZY_PARSE_DWARF_LINE_INFO
+// Appends a function's (machine code offset, op index) pairs to a module's offset to op index
+// table. Each pair is encoded as the difference from the previous pair, so most pairs only take
+// two bytes.
+static void encodeOffsetToOpIndexPairs(const std::vector<std::pair<U32, U32>>& pairs,
+									   std::vector<U8>& outTable)
+{
+	Serialization::ArrayOutputStream stream;
+	U32 previousOffset = 0;
+	U32 previousOpIndex = 0;
+	for(const std::pair<U32, U32>& pair : pairs)
+	{
+		U32 offsetDelta = pair.first - previousOffset;
+		I32 opIndexDelta = I32(pair.second - previousOpIndex);
+		Serialization::serializeVarUInt32(stream, offsetDelta);
+		Serialization::serializeVarInt32(stream, opIndexDelta);
+		previousOffset = pair.first;
+		previousOpIndex = pair.second;
+	}
+	const std::vector<U8> bytes = stream.getBytes();
+	outTable.insert(outTable.end(), bytes.begin(), bytes.end());
+}
+#endif
+
+// Allocates the pages of small images from large regions of reserved addresses that are shared by
+// all modules, instead of reserving the pages of each image separately. This keeps the images of
+// many small modules and thunks together in a few regions of the address space, and reuses the
+// addresses of unloaded images instead of returning them to the OS. Images are allocated in size
+// classes of power-of-two numbers of pages, and the pages of a freed image are decommitted and
+// kept in a free list for its size class.
+struct ImageArena
 {
-	ModuleMemoryManager()
-	: imageBaseAddress(nullptr)
-	, isFinalized(false)
-	, codeSection({nullptr, 0, 0})
-	, readOnlySection({nullptr, 0, 0})
-	, readWriteSection({nullptr, 0, 0})
-	, hasRegisteredEHFrames(false)
+	static ImageArena& get()
+	{
+		static ImageArena arena;
+		return arena;
+	}
+
+	// Returns the base address of numPages reserved pages, or null if the image is too large for
+	// the arena or the addresses couldn't be reserved.
+	U8* allocate(Uptr numPages)
+	{
+		const Uptr sizeClassLog2 = getSizeClassLog2(numPages);
+		if(sizeClassLog2 > maxSizeClassLog2) { return nullptr; }
+
+		Platform::Mutex::Lock lock(mutex);
+		std::vector<U8*>& freeList = freeLists[sizeClassLog2];
+		if(freeList.size())
+		{
+			U8* baseAddress = freeList.back();
+			freeList.pop_back();
+			return baseAddress;
+		}
+
+		const Uptr numSizeClassPages = Uptr(1) << sizeClassLog2;
+		if(!regionBaseAddress || numRegionPagesUsed + numSizeClassPages > numRegionPages)
+		{
+			regionBaseAddress = Platform::allocateVirtualPages(numRegionPages);
+			numRegionPagesUsed = 0;
+			if(!regionBaseAddress) { return nullptr; }
+		}
+		U8* baseAddress
+			= regionBaseAddress + (numRegionPagesUsed << Platform::getBytesPerPageLog2());
+		numRegionPagesUsed += numSizeClassPages;
+		return baseAddress;
+	}
+
+	// Decommits the pages of an image allocated by allocate, and frees their addresses.
+	void free(U8* baseAddress, Uptr numPages)
+	{
+		Platform::decommitVirtualPages(baseAddress, numPages);
+
+		Platform::Mutex::Lock lock(mutex);
+		freeLists[getSizeClassLog2(numPages)].push_back(baseAddress);
+	}
+
+private:
+	static constexpr Uptr maxSizeClassLog2 = 6;
+	static constexpr Uptr numRegionPages = Uptr(1) << 14;
+
+	Platform::Mutex mutex;
+	U8* regionBaseAddress = nullptr;
+	Uptr numRegionPagesUsed = 0;
+	std::vector<U8*> freeLists[maxSizeClassLog2 + 1];
+
+	static Uptr getSizeClassLog2(Uptr numPages)
 	{
+		WAVM_ASSERT(numPages);
+		return numPages == 1 ? 0 : 64 - countLeadingZeroes(U64(numPages - 1));
 	}
+};
+
+// Allocates memory for the LLVM object loader. Each object loaded by the RuntimeDyld is given its
+// own image: a contiguous range of pages that holds the object's code, read-only data, and
+// read-write data sections.
+struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
+{
+	ModuleMemoryManager() : isFinalized(false) {}
 	virtual ~ModuleMemoryManager() override
 	{
 		// Deregister the exception handling frame info.
 		deregisterEHFrames();
 
-		if(!KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED)
-		{ Platform::freeVirtualPages(imageBaseAddress, numAllocatedImagePages); }
-		else
+		for(const std::unique_ptr<Image>& image : images)
 		{
-			// Decommit the image pages, but leave them reserved to catch any references to them
-			// that might erroneously remain.
-			Platform::decommitVirtualPages(imageBaseAddress, numAllocatedImagePages);
+			if(!image->numPages) { continue; }
+			if(KEEP_UNLOADED_MODULE_ADDRESSES_RESERVED)
+			{
+				// Decommit the image pages, but leave them reserved to catch any references to
+				// them that might erroneously remain.
+				Platform::decommitVirtualPages(image->baseAddress, image->numPages);
+			}
+			else if(image->isArenaAllocation)
+			{
+				ImageArena::get().free(image->baseAddress, image->numPages);
+			}
+			else
+			{
+				Platform::freeAlignedVirtualPages(
+					image->unalignedBaseAddress, image->numPages, image->baseAddressAlignmentLog2);
+			}
+			Platform::deregisterVirtualAllocation(image->numPages
+												  << Platform::getBytesPerPageLog2());
+			numCommittedCodeBytes.subtract(image->numPages << Platform::getBytesPerPageLog2());
 		}
-		Platform::deregisterVirtualAllocation(numAllocatedImagePages
-											  << Platform::getBytesPerPageLog2());
 	}
 
 	void registerEHFrames(U8* addr, U64 loadAddr, uintptr_t numBytes) override
 	{
-		if(!USE_WINDOWS_SEH)
-		{
-			Platform::registerEHFrames(imageBaseAddress, addr, numBytes);
-			hasRegisteredEHFrames = true;
-			ehFramesAddr = addr;
-			ehFramesNumBytes = numBytes;
-		}
+		if(!USE_WINDOWS_SEH) { registerFixedSEHFrames(addr, Uptr(numBytes)); }
 	}
 	void registerFixedSEHFrames(U8* addr, Uptr numBytes)
 	{
+		const U8* imageBaseAddress = getImageBaseAddressContaining(addr);
 		Platform::registerEHFrames(imageBaseAddress, addr, numBytes);
-		hasRegisteredEHFrames = true;
-		ehFramesAddr = addr;
-		ehFramesNumBytes = numBytes;
+		registeredEHFrames.push_back({imageBaseAddress, addr, numBytes});
 	}
 	void deregisterEHFrames() override
 	{
-		if(hasRegisteredEHFrames)
+		for(const RegisteredEHFrames& ehFrames : registeredEHFrames)
 		{
-			hasRegisteredEHFrames = false;
-			Platform::deregisterEHFrames(imageBaseAddress, ehFramesAddr, ehFramesNumBytes);
+			Platform::deregisterEHFrames(
+				ehFrames.imageBaseAddress, ehFrames.addr, ehFrames.numBytes);
 		}
+		registeredEHFrames.clear();
 	}
 
 	virtual bool needsToReserveAllocationSpace() override { return true; }
@@ -146,35 +335,55 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 										uintptr_t numReadWriteBytes,
 										U32 readWriteAlignment) override
 	{
+		WAVM_ASSERT(!isFinalized);
+
 		if(USE_WINDOWS_SEH)
 		{
 			// Pad the code section to allow for the SEH trampoline.
 			numCodeBytes += 32;
 		}
 
+		// RuntimeDyld calls reserveAllocationSpace once for each object it loads, before
+		// allocating any of the object's sections, so start a new image for the object.
+		images.emplace_back(new Image);
+		Image& image = *images.back();
+
 		// Calculate the number of pages to be used by each section.
-		codeSection.numPages = shrAndRoundUp(numCodeBytes, Platform::getBytesPerPageLog2());
-		readOnlySection.numPages = shrAndRoundUp(numReadOnlyBytes, Platform::getBytesPerPageLog2());
-		readWriteSection.numPages
+		image.codeSection.numPages = shrAndRoundUp(numCodeBytes, Platform::getBytesPerPageLog2());
+		image.readOnlySection.numPages
+			= shrAndRoundUp(numReadOnlyBytes, Platform::getBytesPerPageLog2());
+		image.readWriteSection.numPages
 			= shrAndRoundUp(numReadWriteBytes, Platform::getBytesPerPageLog2());
-		numAllocatedImagePages
-			= codeSection.numPages + readOnlySection.numPages + readWriteSection.numPages;
-		if(numAllocatedImagePages)
-		{
-			// Reserve enough contiguous pages for all sections.
-			imageBaseAddress = Platform::allocateVirtualPages(numAllocatedImagePages);
-			if(!imageBaseAddress
-			   || !Platform::commitVirtualPages(imageBaseAddress, numAllocatedImagePages))
+		image.numPages = image.codeSection.numPages + image.readOnlySection.numPages
+						 + image.readWriteSection.numPages;
+		if(image.numPages)
+		{
+			// Reserve enough contiguous pages for all sections. Images that are large enough to
+			// be backed by huge pages, if they are enabled, are aligned for them instead of being
+			// allocated from the shared arena.
+			image.baseAddressAlignmentLog2 = Platform::getHugePageAlignmentLog2(image.numPages);
+			if(image.baseAddressAlignmentLog2 == Platform::getBytesPerPageLog2())
+			{
+				image.baseAddress = ImageArena::get().allocate(image.numPages);
+				image.isArenaAllocation = image.baseAddress != nullptr;
+			}
+			if(!image.baseAddress)
+			{
+				image.baseAddress = Platform::allocateAlignedVirtualPages(
+					image.numPages, image.baseAddressAlignmentLog2, image.unalignedBaseAddress);
+			}
+			if(!image.baseAddress
+			   || !Platform::commitVirtualPages(image.baseAddress, image.numPages))
 			{ Errors::fatal("memory allocation for JIT code failed"); }
-			Platform::registerVirtualAllocation(numAllocatedImagePages
-												<< Platform::getBytesPerPageLog2());
-			codeSection.baseAddress = imageBaseAddress;
-			readOnlySection.baseAddress
-				= codeSection.baseAddress
-				  + (codeSection.numPages << Platform::getBytesPerPageLog2());
-			readWriteSection.baseAddress
-				= readOnlySection.baseAddress
-				  + (readOnlySection.numPages << Platform::getBytesPerPageLog2());
+			Platform::registerVirtualAllocation(image.numPages << Platform::getBytesPerPageLog2());
+			numCommittedCodeBytes.add(image.numPages << Platform::getBytesPerPageLog2());
+			image.codeSection.baseAddress = image.baseAddress;
+			image.readOnlySection.baseAddress
+				= image.codeSection.baseAddress
+				  + (image.codeSection.numPages << Platform::getBytesPerPageLog2());
+			image.readWriteSection.baseAddress
+				= image.readOnlySection.baseAddress
+				  + (image.readOnlySection.numPages << Platform::getBytesPerPageLog2());
 		}
 	}
 	virtual U8* allocateCodeSection(uintptr_t numBytes,
@@ -182,7 +391,9 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 									U32 sectionID,
 									llvm::StringRef sectionName) override
 	{
-		return allocateBytes(sectionName, (Uptr)numBytes, alignment, codeSection);
+		WAVM_ASSERT(images.size());
+		Image& image = *images.back();
+		return allocateBytes(image, sectionName, (Uptr)numBytes, alignment, image.codeSection);
 	}
 	virtual U8* allocateDataSection(uintptr_t numBytes,
 									U32 alignment,
@@ -190,10 +401,13 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 									llvm::StringRef sectionName,
 									bool isReadOnly) override
 	{
-		return allocateBytes(sectionName,
+		WAVM_ASSERT(images.size());
+		Image& image = *images.back();
+		return allocateBytes(image,
+							 sectionName,
 							 (Uptr)numBytes,
 							 alignment,
-							 isReadOnly ? readOnlySection : readWriteSection);
+							 isReadOnly ? image.readOnlySection : image.readWriteSection);
 	}
 	virtual bool finalizeMemory(std::string* ErrMsg = nullptr) override
 	{
@@ -206,23 +420,25 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 	{
 		WAVM_ASSERT(!isFinalized);
 		isFinalized = true;
-		if(codeSection.numPages)
-		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(codeSection.baseAddress,
-															 codeSection.numPages,
-															 Platform::MemoryAccess::readExecute));
-		}
-		if(readOnlySection.numPages)
-		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(readOnlySection.baseAddress,
-															 readOnlySection.numPages,
-															 Platform::MemoryAccess::readOnly));
-		}
-		if(readWriteSection.numPages)
+
+		// The image pages were committed read-write, so only the code and read-only sections need
+		// their access changed.
+		for(const std::unique_ptr<Image>& image : images)
 		{
-			WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(readWriteSection.baseAddress,
-															 readWriteSection.numPages,
-															 Platform::MemoryAccess::readWrite));
+			if(image->codeSection.numPages)
+			{
+				WAVM_ERROR_UNLESS(
+					Platform::setVirtualPageAccess(image->codeSection.baseAddress,
+												   image->codeSection.numPages,
+												   Platform::MemoryAccess::readExecute));
+			}
+			if(image->readOnlySection.numPages)
+			{
+				WAVM_ERROR_UNLESS(
+					Platform::setVirtualPageAccess(image->readOnlySection.baseAddress,
+												   image->readOnlySection.numPages,
+												   Platform::MemoryAccess::readOnly));
+			}
 		}
 
 		// Invalidate the instruction cache.
@@ -230,49 +446,123 @@ struct LLVMJIT::ModuleMemoryManager : llvm::RTDyldMemoryManager
 	}
 	virtual void invalidateInstructionCache()
 	{
-		// Invalidate the instruction cache for the whole image.
-		llvm::sys::Memory::InvalidateInstructionCache(
-			imageBaseAddress, numAllocatedImagePages << Platform::getBytesPerPageLog2());
+		// Invalidate the instruction cache for each image.
+		for(const std::unique_ptr<Image>& image : images)
+		{
+			if(image->numPages)
+			{
+				llvm::sys::Memory::InvalidateInstructionCache(
+					image->baseAddress, image->numPages << Platform::getBytesPerPageLog2());
+			}
+		}
 	}
 
-	U8* getImageBaseAddress() const { return imageBaseAddress; }
-	Uptr getNumImageBytes() const
+	Uptr getNumImages() const { return images.size(); }
+	U8* getImageBaseAddress(Uptr imageIndex) const { return images[imageIndex]->baseAddress; }
+	Uptr getNumImageBytes(Uptr imageIndex) const
 	{
-		return numAllocatedImagePages << Platform::getBytesPerPageLog2();
+		return images[imageIndex]->numPages << Platform::getBytesPerPageLog2();
 	}
 
-	Uptr getNumCodeBytes() const { return codeSection.numCommittedBytes; }
-	Uptr getNumReadOnlyBytes() const { return readOnlySection.numCommittedBytes; }
-	Uptr getNumReadWriteBytes() const { return readWriteSection.numCommittedBytes; }
+	Uptr getNumCodeBytes() const
+	{
+		Uptr numBytes = 0;
+		for(const std::unique_ptr<Image>& image : images)
+		{ numBytes += image->codeSection.numCommittedBytes; }
+		return numBytes;
+	}
+	Uptr getNumReadOnlyBytes() const
+	{
+		Uptr numBytes = 0;
+		for(const std::unique_ptr<Image>& image : images)
+		{ numBytes += image->readOnlySection.numCommittedBytes; }
+		return numBytes;
+	}
+	Uptr getNumReadWriteBytes() const
+	{
+		Uptr numBytes = 0;
+		for(const std::unique_ptr<Image>& image : images)
+		{ numBytes += image->readWriteSection.numCommittedBytes; }
+		return numBytes;
+	}
+
+	ModuleMemoryUsage getMemoryUsage(bool sampleResidency) const
+	{
+		const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+		ModuleMemoryUsage usage;
+		for(const std::unique_ptr<Image>& image : images)
+		{
+			usage.numCodeBytes += image->codeSection.numPages << pageBytesLog2;
+			usage.numReadOnlyBytes += image->readOnlySection.numPages << pageBytesLog2;
+			usage.numReadWriteBytes += image->readWriteSection.numPages << pageBytesLog2;
+			if(sampleResidency && image->numPages)
+			{
+				usage.numResidentBytes
+					+= Platform::getNumResidentVirtualPages(image->baseAddress, image->numPages)
+					   << pageBytesLog2;
+			}
+		}
+		return usage;
+	}
 
-	const llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>>& getSectionNameToContentsMap() const
+	const llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>>& getSectionNameToContentsMap(
+		Uptr imageIndex) const
 	{
-		return sectionNameToContentsMap;
+		return images[imageIndex]->sectionNameToContentsMap;
 	}
 
 private:
 	struct Section
 	{
-		U8* baseAddress;
-		Uptr numPages;
-		Uptr numCommittedBytes;
+		U8* baseAddress = nullptr;
+		Uptr numPages = 0;
+		Uptr numCommittedBytes = 0;
 	};
 
-	U8* imageBaseAddress;
-	Uptr numAllocatedImagePages;
-	bool isFinalized;
+	struct Image
+	{
+		U8* baseAddress = nullptr;
+		U8* unalignedBaseAddress = nullptr;
+		Uptr baseAddressAlignmentLog2 = 0;
+		Uptr numPages = 0;
+		bool isArenaAllocation = false;
+
+		Section codeSection;
+		Section readOnlySection;
+		Section readWriteSection;
+
+		llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> sectionNameToContentsMap;
+	};
+
+	struct RegisteredEHFrames
+	{
+		const U8* imageBaseAddress;
+		const U8* addr;
+		Uptr numBytes;
+	};
 
-	Section codeSection;
-	Section readOnlySection;
-	Section readWriteSection;
+	std::vector<std::unique_ptr<Image>> images;
+	bool isFinalized;
 
-	bool hasRegisteredEHFrames;
-	const U8* ehFramesAddr;
-	Uptr ehFramesNumBytes;
+	std::vector<RegisteredEHFrames> registeredEHFrames;
 
-	llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> sectionNameToContentsMap;
+	const U8* getImageBaseAddressContaining(const U8* address) const
+	{
+		for(const std::unique_ptr<Image>& image : images)
+		{
+			const U8* imageEndAddress
+				= image->baseAddress + (image->numPages << Platform::getBytesPerPageLog2());
+			if(address >= image->baseAddress && address < imageEndAddress)
+			{ return image->baseAddress; }
+		}
+		WAVM_UNREACHABLE();
+	}
 
-	U8* allocateBytes(llvm::StringRef sectionName, Uptr numBytes, Uptr alignment, Section& section)
+	U8* allocateBytes(Image& image,
+					  llvm::StringRef sectionName,
+					  Uptr numBytes,
+					  Uptr alignment,
+					  Section& section)
 	{
 		if(alignment == 0) { alignment = 1; }
 
@@ -299,7 +589,7 @@ private:
 		}
 
 		// Record the address the section was allocated at.
-		sectionNameToContentsMap.insert(std::make_pair(
+		image.sectionNameToContentsMap.insert(std::make_pair(
 			sectionName,
 			llvm::MemoryBuffer::getMemBuffer(
 				llvm::StringRef((const char*)allocationBaseAddress, numBytes), "", false)));
@@ -320,25 +610,46 @@ private:
 	void operator=(const ModuleMemoryManager&) = delete;
 };
 
-Module::Module(const std::vector<U8>& objectBytes,
+Module::Module(const U8* objectBytes,
+			   Uptr numObjectBytes,
 			   const HashMap<std::string, Uptr>& importedSymbolMap,
 			   bool shouldLogMetrics,
 			   std::string&& inDebugName)
 : debugName(std::move(inDebugName))
 , memoryManager(new ModuleMemoryManager())
 , globalModuleState(GlobalModuleState::get())
+, isRegisteredWithGDB(gdbRegistrationEnabled.load())
 #if LLVM_VERSION_MAJOR < 8
-, objectBytes(objectBytes)
+, objectBytes(isRegisteredWithGDB ? std::vector<U8>(objectBytes, objectBytes + numObjectBytes)
+								  : std::vector<U8>())
 #endif
 {
 	Timing::Timer loadObjectTimer;
 
+	// On LLVM 7 and earlier, if the module is registered with GDB, this->objectBytes is a copy of
+	// objectBytes that the loaded objects must reference, since it is kept alive until the objects
+	// are deregistered from GDB.
 #if LLVM_VERSION_MAJOR >= 8
-	std::unique_ptr<llvm::object::ObjectFile> object;
+	const std::vector<llvm::StringRef> bundledObjects
+		= getBundledObjects(objectBytes, numObjectBytes);
+#else
+	const std::vector<llvm::StringRef> bundledObjects
+		= isRegisteredWithGDB
+			  ? getBundledObjects(this->objectBytes.data(), this->objectBytes.size())
+			  : getBundledObjects(objectBytes, numObjectBytes);
 #endif
+	std::vector<std::unique_ptr<llvm::object::ObjectFile>> objects;
+
+	// A bundle of several objects is only produced for targets that don't use Windows SEH, which
+	// requires the manual pdata/xdata fixups below that only handle a single object.
+	WAVM_ERROR_UNLESS(bundledObjects.size() == 1 || !USE_WINDOWS_SEH);
 
-	object = cantFail(llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(
-		llvm::StringRef((const char*)objectBytes.data(), objectBytes.size()), "memory")));
+	for(llvm::StringRef bundledObject : bundledObjects)
+	{
+		objects.push_back(cantFail(llvm::object::ObjectFile::createObjectFile(
+			llvm::MemoryBufferRef(bundledObject, "memory"))));
+	}
+	numObjects = objects.size();
 
 	// Create the LLVM object loader.
 	struct SymbolResolver : llvm::JITSymbolResolver
@@ -421,7 +732,7 @@ Module::Module(const std::vector<U8>& objectBytes,
 	U8* xdataCopy = nullptr;
 	if(USE_WINDOWS_SEH)
 	{
-		for(auto section : object->sections())
+		for(auto section : objects[0]->sections())
 		{
 #if LLVM_VERSION_MAJOR >= 10
 			llvm::Expected<llvm::StringRef> sectionNameOrError = section.getName();
@@ -463,11 +774,16 @@ Module::Module(const std::vector<U8>& objectBytes,
 		}
 	}
 
-	// Use the LLVM object loader to load the object.
-	std::unique_ptr<llvm::RuntimeDyld::LoadedObjectInfo> loadedObject = loader.loadObject(*object);
+	// Use the LLVM object loader to load the objects. All objects are loaded before finalizing
+	// the loader, so references between objects in a bundle are resolved to the symbols they
+	// define.
+	std::vector<std::unique_ptr<llvm::RuntimeDyld::LoadedObjectInfo>> loadedObjects;
+	for(const std::unique_ptr<llvm::object::ObjectFile>& object : objects)
+	{ loadedObjects.push_back(loader.loadObject(*object)); }
 	loader.finalizeWithMemoryManagerLocking();
 	if(loader.hasError())
 	{ Errors::fatalf("RuntimeDyld failed: %s", loader.getErrorString().data()); }
+	WAVM_ASSERT(memoryManager->getNumImages() == numObjects);
 
 	if(USE_WINDOWS_SEH && pdataCopy)
 	{
@@ -484,8 +800,8 @@ Module::Module(const std::vector<U8>& objectBytes,
 		memset(trampolineBytes + 2, 0, 4);
 		memcpy(trampolineBytes + 6, &sehHandlerAddress, sizeof(U64));
 
-		processSEHTables(memoryManager->getImageBaseAddress(),
-						 *loadedObject,
+		processSEHTables(memoryManager->getImageBaseAddress(0),
+						 *loadedObjects[0],
 						 pdataSection,
 						 pdataCopy,
 						 pdataNumBytes,
@@ -494,7 +810,7 @@ Module::Module(const std::vector<U8>& objectBytes,
 						 reinterpret_cast<Uptr>(trampolineBytes));
 
 		memoryManager->registerFixedSEHFrames(
-			reinterpret_cast<U8*>(Uptr(loadedObject->getSectionLoadAddress(pdataSection))),
+			reinterpret_cast<U8*>(Uptr(loadedObjects[0]->getSectionLoadAddress(pdataSection))),
 			pdataNumBytes);
 	}
 
@@ -514,101 +830,263 @@ Module::Module(const std::vector<U8>& objectBytes,
 	// final non-writable memory permissions.
 	memoryManager->reallyFinalizeMemory();
 
-	// Notify GDB of the new object.
+	// The profile counters found in the objects, and the function each one counts.
+	struct ProfileCounterSymbol
 	{
-		Platform::Mutex::Lock lock(globalModuleState->gdbRegistrationListenerMutex);
+		std::string functionName;
+		U64* counters;
+		Uptr numCounters;
+	};
+	std::vector<ProfileCounterSymbol> profileCounterSymbols;
+	const std::string profileCountersPrefix = mangleSymbol("profileCounters");
+	std::vector<std::pair<std::string, U64*>> functionStatsSymbols;
+	const std::string functionStatsPrefix = mangleSymbol("functionStats");
+	std::vector<std::pair<std::string, Runtime::FunctionTierUpState*>> tierUpStateSymbols;
+	const std::string tierUpStatePrefix = mangleSymbol("tierUpState");
+	const std::string functionDefPrefix = mangleSymbol("functionDef");
+
+	std::vector<GlobalModuleState::ImageAddressRange> imageAddressRanges;
+	for(Uptr objectIndex = 0; objectIndex < numObjects; ++objectIndex)
+	{
+		const llvm::object::ObjectFile& object = *objects[objectIndex];
+		const llvm::RuntimeDyld::LoadedObjectInfo& loadedObject = *loadedObjects[objectIndex];
+
+		// Notify GDB of the new object.
+		if(isRegisteredWithGDB)
+		{
+			Platform::Mutex::Lock lock(globalModuleState->gdbRegistrationListenerMutex);
+			if(!globalModuleState->gdbRegistrationListener)
+			{
+				globalModuleState->gdbRegistrationListener
+					= llvm::JITEventListener::createGDBRegistrationListener();
+			}
 #if LLVM_VERSION_MAJOR >= 8
-		globalModuleState->gdbRegistrationListener->notifyObjectLoaded(
-			reinterpret_cast<Uptr>(this), *object, *loadedObject);
+			globalModuleState->gdbRegistrationListener->notifyObjectLoaded(
+				getGDBRegistrationKey(objectIndex), object, loadedObject);
 #else
-		globalModuleState->gdbRegistrationListener->NotifyObjectEmitted(*object, *loadedObject);
+			globalModuleState->gdbRegistrationListener->NotifyObjectEmitted(object, loadedObject);
 #endif
-	}
+		}
+
+		const Uptr imageEndAddress
+			= reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress(objectIndex)
+									 + memoryManager->getNumImageBytes(objectIndex));
 
-	// Create a DWARF context to interpret the debug information in this compilation unit.
+		// Create a DWARF context to interpret the debug information in this compilation unit.
 #if LAZY_PARSE_DWARF_LINE_INFO
-	Platform::Mutex::Lock dwarfContextLock(dwarfContextMutex);
-	dwarfContext
-		= llvm::DWARFContext::create(memoryManager->getSectionNameToContentsMap(), sizeof(Uptr));
+		{
+			Platform::Mutex::Lock dwarfContextLock(dwarfContextMutex);
+			dwarfContexts.emplace(imageEndAddress,
+								  llvm::DWARFContext::create(
+									  memoryManager->getSectionNameToContentsMap(objectIndex),
+									  sizeof(Uptr)));
+		}
 #else
-	auto dwarfContext = llvm::DWARFContext::create(*object, &*loadedObject);
+		auto dwarfContext = llvm::DWARFContext::create(object, &loadedObject);
 #endif
 
-	// Iterate over the functions in the loaded object.
-	for(std::pair<llvm::object::SymbolRef, U64> symbolSizePair :
-		llvm::object::computeSymbolSizes(*object))
-	{
-		llvm::object::SymbolRef symbol = symbolSizePair.first;
+		// Iterate over the functions in the loaded object.
+		for(std::pair<llvm::object::SymbolRef, U64> symbolSizePair :
+			llvm::object::computeSymbolSizes(object))
+		{
+			llvm::object::SymbolRef symbol = symbolSizePair.first;
 
-		// Only process global symbols, which excludes SEH funclets.
+			// Only process global symbols, which excludes SEH funclets. Skip undefined symbols,
+			// which may be functions defined by another object in the bundle.
 #if LLVM_VERSION_MAJOR >= 11
-		auto maybeFlags = symbol.getFlags();
-		if(!(maybeFlags && *maybeFlags & llvm::object::SymbolRef::SF_Global)) { continue; }
+			auto maybeFlags = symbol.getFlags();
+			if(!(maybeFlags && *maybeFlags & llvm::object::SymbolRef::SF_Global)
+			   || (*maybeFlags & llvm::object::SymbolRef::SF_Undefined))
+			{ continue; }
 #else
-		if(!(symbol.getFlags() & llvm::object::SymbolRef::SF_Global)) { continue; }
+			if(!(symbol.getFlags() & llvm::object::SymbolRef::SF_Global)
+			   || (symbol.getFlags() & llvm::object::SymbolRef::SF_Undefined))
+			{ continue; }
 #endif
 
-		// Get the type, name, and address of the symbol. Need to be careful not to get the
-		// Expected<T> for each value unless it will be checked for success before continuing.
-		llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
-		if(!type || *type != llvm::object::SymbolRef::ST_Function) { continue; }
-		llvm::Expected<llvm::StringRef> name = symbol.getName();
-		if(!name) { continue; }
-		llvm::Expected<U64> address = symbol.getAddress();
-		if(!address) { continue; }
-
-		// Compute the address the function was loaded at.
-		WAVM_ASSERT(*address <= UINTPTR_MAX);
-		Uptr loadedAddress = Uptr(*address);
-		if(llvm::Expected<llvm::object::section_iterator> symbolSection = symbol.getSection())
-		{ loadedAddress += (Uptr)loadedObject->getSectionLoadAddress(*symbolSection.get()); }
-
-		std::map<U32, U32> offsetToOpIndexMap;
+			// Get the type, name, and address of the symbol. Need to be careful not to get the
+			// Expected<T> for each value unless it will be checked for success before continuing.
+			llvm::Expected<llvm::object::SymbolRef::Type> type = symbol.getType();
+			if(!type
+			   || (*type != llvm::object::SymbolRef::ST_Function
+				   && *type != llvm::object::SymbolRef::ST_Data))
+			{ continue; }
+			llvm::Expected<llvm::StringRef> name = symbol.getName();
+			if(!name) { continue; }
+			llvm::Expected<U64> address = symbol.getAddress();
+			if(!address) { continue; }
+
+			// Compute the address the symbol was loaded at.
+			WAVM_ASSERT(*address <= UINTPTR_MAX);
+			Uptr loadedAddress = Uptr(*address);
+			if(llvm::Expected<llvm::object::section_iterator> symbolSection = symbol.getSection())
+			{ loadedAddress += (Uptr)loadedObject.getSectionLoadAddress(*symbolSection.get()); }
+
+			// The only data symbols are the profile counters, call counts, and tier-up states of
+			// instrumented functions. They are bound to the function's mutable data after all the
+			// objects' functions are loaded.
+			if(*type == llvm::object::SymbolRef::ST_Data)
+			{
+				if(name->startswith(profileCountersPrefix))
+				{
+					profileCounterSymbols.push_back(
+						{functionDefPrefix + name->substr(profileCountersPrefix.size()).str(),
+						 reinterpret_cast<U64*>(loadedAddress),
+						 Uptr(symbolSizePair.second / sizeof(U64))});
+				}
+				else if(name->startswith(functionStatsPrefix))
+				{
+					functionStatsSymbols.push_back(
+						{functionDefPrefix + name->substr(functionStatsPrefix.size()).str(),
+						 reinterpret_cast<U64*>(loadedAddress)});
+				}
+				else if(name->startswith(tierUpStatePrefix))
+				{
+					WAVM_ASSERT(symbolSizePair.second == sizeof(Runtime::FunctionTierUpState));
+					tierUpStateSymbols.push_back(
+						{functionDefPrefix + name->substr(tierUpStatePrefix.size()).str(),
+						 reinterpret_cast<Runtime::FunctionTierUpState*>(loadedAddress)});
+				}
+				continue;
+			}
+
 #if !LAZY_PARSE_DWARF_LINE_INFO
-		// Get the DWARF line info for this symbol, which maps machine code addresses to
-		// WebAssembly op indices.
+			std::vector<std::pair<U32, U32>> offsetToOpIndexPairs;
+			// Get the DWARF line info for this symbol, which maps machine code addresses to
+			// WebAssembly op indices.
 #if LLVM_VERSION_MAJOR >= 9
-		llvm::Expected<llvm::object::section_iterator> section = symbol.getSection();
-		if(!section) { continue; }
-		llvm::DILineInfoTable lineInfoTable = dwarfContext->getLineInfoForAddressRange(
-			llvm::object::SectionedAddress{loadedAddress, section.get()->getIndex()},
-			symbolSizePair.second);
+			llvm::Expected<llvm::object::section_iterator> section = symbol.getSection();
+			if(!section) { continue; }
+			llvm::DILineInfoTable lineInfoTable = dwarfContext->getLineInfoForAddressRange(
+				llvm::object::SectionedAddress{loadedAddress, section.get()->getIndex()},
+				symbolSizePair.second);
 #else
-		llvm::DILineInfoTable lineInfoTable
-			= dwarfContext->getLineInfoForAddressRange(loadedAddress, symbolSizePair.second);
+			llvm::DILineInfoTable lineInfoTable
+				= dwarfContext->getLineInfoForAddressRange(loadedAddress, symbolSizePair.second);
 #endif
-		for(auto lineInfo : lineInfoTable)
-		{ offsetToOpIndexMap.emplace(U32(lineInfo.first - loadedAddress), lineInfo.second.Line); }
+			for(auto lineInfo : lineInfoTable)
+			{
+				offsetToOpIndexPairs.push_back(
+					{U32(lineInfo.first - loadedAddress), U32(lineInfo.second.Line)});
+			}
+
+			// Sort the offsets so they can be binary searched, and only keep the first op index
+			// for each offset.
+			std::stable_sort(offsetToOpIndexPairs.begin(),
+							 offsetToOpIndexPairs.end(),
+							 [](const std::pair<U32, U32>& left, const std::pair<U32, U32>& right) {
+								 return left.first < right.first;
+							 });
+			offsetToOpIndexPairs.erase(
+				std::unique(offsetToOpIndexPairs.begin(),
+							offsetToOpIndexPairs.end(),
+							[](const std::pair<U32, U32>& left, const std::pair<U32, U32>& right) {
+								return left.first == right.first;
+							}),
+				offsetToOpIndexPairs.end());
+			const Uptr offsetToOpIndexTableOffset = offsetToOpIndexTable.size();
+			encodeOffsetToOpIndexPairs(offsetToOpIndexPairs, offsetToOpIndexTable);
 #endif
 
-		// Add the function to the module's name and address to function maps.
-		WAVM_ASSERT(symbolSizePair.second <= UINTPTR_MAX);
-		Runtime::Function* function
-			= (Runtime::Function*)(loadedAddress - offsetof(Runtime::Function, code));
-		nameToFunctionMap.addOrFail(std::string(*name), function);
-		addressToFunctionMap.emplace(Uptr(loadedAddress + symbolSizePair.second), function);
+			// Add the function to the module's name and address to function maps.
+			WAVM_ASSERT(symbolSizePair.second <= UINTPTR_MAX);
+			Runtime::Function* function
+				= (Runtime::Function*)(loadedAddress - offsetof(Runtime::Function, code));
+			nameToFunctionMap.addOrFail(std::string(*name), function);
+			addressToFunctionMap.emplace(Uptr(loadedAddress + symbolSizePair.second), function);
+
+			// Initialize the function mutable data.
+			WAVM_ASSERT(function->mutableData);
+			function->mutableData->jitModule = this;
+			function->mutableData->function = function;
+			function->mutableData->numCodeBytes = Uptr(symbolSizePair.second);
+#if !LAZY_PARSE_DWARF_LINE_INFO
+			function->mutableData->offsetToOpIndexTableOffset = offsetToOpIndexTableOffset;
+			function->mutableData->numOffsetToOpIndexTableBytes
+				= offsetToOpIndexTable.size() - offsetToOpIndexTableOffset;
+#endif
+		}
 
-		// Initialize the function mutable data.
-		WAVM_ASSERT(function->mutableData);
-		function->mutableData->jitModule = this;
-		function->mutableData->function = function;
-		function->mutableData->numCodeBytes = Uptr(symbolSizePair.second);
-		function->mutableData->offsetToOpIndexMap = std::move(offsetToOpIndexMap);
+		if(memoryManager->getNumImageBytes(objectIndex))
+		{
+			imageAddressRanges.push_back(
+				{reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress(objectIndex)),
+				 imageEndAddress,
+				 this});
+		}
 	}
 
-	const Uptr moduleEndAddress = reinterpret_cast<Uptr>(memoryManager->getImageBaseAddress()
-														 + memoryManager->getNumImageBytes());
+#if !LAZY_PARSE_DWARF_LINE_INFO
+	offsetToOpIndexTable.shrink_to_fit();
+#endif
+
+	// Add the module's images to the global image address index.
+	globalModuleState->addImageAddressRanges(imageAddressRanges);
+
+	// Bind the profile counters of instrumented functions to their FunctionMutableData.
+	for(const ProfileCounterSymbol& profileCounterSymbol : profileCounterSymbols)
+	{
+		Runtime::Function** function = nameToFunctionMap.get(profileCounterSymbol.functionName);
+		WAVM_ERROR_UNLESS(function);
+		(*function)->mutableData->profileCounters = profileCounterSymbol.counters;
+		(*function)->mutableData->numProfileCounters = profileCounterSymbol.numCounters;
+	}
+	for(const auto& functionStatsSymbol : functionStatsSymbols)
 	{
-		Platform::RWMutex::ExclusiveLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		globalModuleState->addressToModuleMap.emplace(moduleEndAddress, this);
+		Runtime::Function** function = nameToFunctionMap.get(functionStatsSymbol.first);
+		WAVM_ERROR_UNLESS(function);
+		(*function)->mutableData->functionStats = functionStatsSymbol.second;
+	}
+	for(const auto& tierUpStateSymbol : tierUpStateSymbols)
+	{
+		Runtime::Function** function = nameToFunctionMap.get(tierUpStateSymbol.first);
+		WAVM_ERROR_UNLESS(function);
+		(*function)->mutableData->tierUpState = tierUpStateSymbol.second;
+	}
+
+	// Describe the module's functions to the Linux perf profiler if a perf map is enabled.
+	if(Platform::getPerfMapFormat() != Platform::PerfMapFormat::none)
+	{
+		for(const auto& nameFunctionPair : nameToFunctionMap)
+		{
+			const Runtime::Function* function = nameFunctionPair.value;
+			const Runtime::FunctionMutableData* mutableData = function->mutableData;
+
+			std::vector<Platform::PerfMapLine> lines;
+#if !LAZY_PARSE_DWARF_LINE_INFO
+			Serialization::MemoryInputStream stream(
+				offsetToOpIndexTable.data() + mutableData->offsetToOpIndexTableOffset,
+				mutableData->numOffsetToOpIndexTableBytes);
+			U32 offset = 0;
+			U32 opIndex = 0;
+			while(stream.capacity())
+			{
+				U32 offsetDelta = 0;
+				I32 opIndexDelta = 0;
+				Serialization::serializeVarUInt32(stream, offsetDelta);
+				Serialization::serializeVarInt32(stream, opIndexDelta);
+				offset += offsetDelta;
+				opIndex += U32(opIndexDelta);
+				lines.push_back({Uptr(offset), opIndex});
+			}
+#endif
+
+			Platform::addPerfMapFunction(mutableData->debugName.size()
+											 ? mutableData->debugName.c_str()
+											 : nameFunctionPair.key.c_str(),
+										 function->code,
+										 mutableData->numCodeBytes,
+										 debugName.c_str(),
+										 lines.data(),
+										 lines.size());
+		}
 	}
 
 	if(shouldLogMetrics)
 	{
 		Timing::logRatePerSecond((std::string("Loaded ") + debugName).c_str(),
 								 loadObjectTimer,
-								 (F64)objectBytes.size() / 1024.0 / 1024.0,
+								 (F64)numObjectBytes / 1024.0 / 1024.0,
 								 "MiB");
 		Log::printf(Log::Category::metrics,
 					"Code: %.1f KiB, read-only data: %.1f KiB, read-write data: %.1f KiB\n",
@@ -616,29 +1094,31 @@ Module::Module(const std::vector<U8>& objectBytes,
 					memoryManager->getNumReadOnlyBytes() / 1024.0,
 					memoryManager->getNumReadWriteBytes() / 1024.0);
 	}
+
+#if LLVM_VERSION_MAJOR < 8
+	if(isRegisteredWithGDB) { this->objects = std::move(objects); }
+#endif
 }
 
 Module::~Module()
 {
-	// Notify GDB that the object is being unloaded.
+	// Notify GDB that the objects are being unloaded.
+	if(isRegisteredWithGDB)
 	{
 		Platform::Mutex::Lock lock(globalModuleState->gdbRegistrationListenerMutex);
+		for(Uptr objectIndex = 0; objectIndex < numObjects; ++objectIndex)
+		{
 #if LLVM_VERSION_MAJOR >= 8
-		globalModuleState->gdbRegistrationListener->notifyFreeingObject(
-			reinterpret_cast<Uptr>(this));
+			globalModuleState->gdbRegistrationListener->notifyFreeingObject(
+				getGDBRegistrationKey(objectIndex));
 #else
-		globalModuleState->gdbRegistrationListener->NotifyFreeingObject(*object);
+			globalModuleState->gdbRegistrationListener->NotifyFreeingObject(*objects[objectIndex]);
 #endif
+		}
 	}
 
-	// Remove the module from the global address to module map.
-	{
-		Platform::RWMutex::ExclusiveLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		globalModuleState->addressToModuleMap.erase(
-			globalModuleState->addressToModuleMap.find(reinterpret_cast<Uptr>(
-				memoryManager->getImageBaseAddress() + memoryManager->getNumImageBytes())));
-	}
+	// Remove the module's images from the global image address index.
+	globalModuleState->removeImageAddressRanges(this);
 
 	// Free the FunctionMutableData objects.
 	for(const auto& pair : addressToFunctionMap) { delete pair.second->mutableData; }
@@ -647,9 +1127,20 @@ Module::~Module()
 	delete memoryManager;
 }
 
+ModuleMemoryUsage Module::getMemoryUsage(bool sampleResidency) const
+{
+	return memoryManager->getMemoryUsage(sampleResidency);
+}
+
+ModuleMemoryUsage LLVMJIT::getModuleMemoryUsage(const Module* module, bool sampleResidency)
+{
+	return module->getMemoryUsage(sampleResidency);
+}
+
 std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
-	const std::vector<U8>& objectFileBytes,
-	HashMap<std::string, FunctionBinding>&& wavmIntrinsicsExportMap,
+	const U8* objectFileBytes,
+	Uptr numObjectFileBytes,
+	const HashMap<std::string, FunctionBinding>& wavmIntrinsicsExportMap,
 	std::vector<IR::FunctionType>&& types,
 	std::vector<FunctionBinding>&& functionImports,
 	std::vector<TableBinding>&& tables,
@@ -659,6 +1150,7 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	InstanceBinding instance,
 	Uptr tableReferenceBias,
 	const std::vector<Runtime::FunctionMutableData*>& functionDefMutableDatas,
+	const std::vector<Runtime::FunctionMutableData*>& invokeThunkMutableDatas,
 	std::string&& debugName)
 {
 	// Bind undefined symbols in the compiled object to values.
@@ -666,17 +1158,19 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 
 	// Bind the wavmIntrinsic function symbols; the compiled module assumes they have the intrinsic
 	// calling convention, so no thunking is necessary.
-	for(auto exportMapPair : wavmIntrinsicsExportMap)
+	for(const auto& exportMapPair : wavmIntrinsicsExportMap)
 	{
 		importedSymbolMap.addOrFail(exportMapPair.key,
 									reinterpret_cast<Uptr>(exportMapPair.value.code));
 	}
 
-	// Bind the type ID symbols.
+	// Bind the type ID and table element type tag symbols.
 	for(Uptr typeIndex = 0; typeIndex < types.size(); ++typeIndex)
 	{
 		importedSymbolMap.addOrFail(getExternalName("typeId", typeIndex),
 									types[typeIndex].getEncoding().impl);
+		importedSymbolMap.addOrFail(getExternalName("typeTag", typeIndex),
+									Runtime::getCalleeTableElementTypeTag(types[typeIndex]));
 	}
 
 	// Bind imported function symbols.
@@ -684,6 +1178,12 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	{
 		importedSymbolMap.addOrFail(getExternalName("functionImport", importIndex),
 									reinterpret_cast<Uptr>(functionImports[importIndex].code));
+		if(functionImports[importIndex].pureNativeCode)
+		{
+			importedSymbolMap.addOrFail(
+				getExternalName("pureNativeFunctionImport", importIndex),
+				reinterpret_cast<Uptr>(functionImports[importIndex].pureNativeCode));
+		}
 	}
 
 	// Bind the table symbols. The compiled module uses the symbol's value as an offset into
@@ -735,14 +1235,31 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 	}
 
 	// Allocate FunctionMutableData objects for each function def, and bind them to the symbols
-	// imported by the compiled module.
+	// imported by the compiled module. Object code that tiers up an instance only has symbols for
+	// the function defs it compiles.
 	for(Uptr functionDefIndex = 0; functionDefIndex < functionDefMutableDatas.size();
 		++functionDefIndex)
 	{
 		Runtime::FunctionMutableData* functionMutableData
 			= functionDefMutableDatas[functionDefIndex];
-		importedSymbolMap.addOrFail(getExternalName("functionDefMutableDatas", functionDefIndex),
-									reinterpret_cast<Uptr>(functionMutableData));
+		if(functionMutableData)
+		{
+			importedSymbolMap.addOrFail(
+				getExternalName("functionDefMutableDatas", functionDefIndex),
+				reinterpret_cast<Uptr>(functionMutableData));
+		}
+	}
+
+	// Bind the FunctionMutableData objects for the module's invoke thunks.
+	WAVM_ASSERT(invokeThunkMutableDatas.size() == types.size());
+	for(Uptr typeIndex = 0; typeIndex < invokeThunkMutableDatas.size(); ++typeIndex)
+	{
+		if(invokeThunkMutableDatas[typeIndex])
+		{
+			importedSymbolMap.addOrFail(
+				getExternalName("invokeThunkMutableDatas", typeIndex),
+				reinterpret_cast<Uptr>(invokeThunkMutableDatas[typeIndex]));
+		}
 	}
 
 	// Bind the instance symbol to point to the Instance.
@@ -776,20 +1293,14 @@ std::shared_ptr<LLVMJIT::Module> LLVMJIT::loadModule(
 #endif
 
 	// Load the module.
-	return std::make_shared<Module>(objectFileBytes, importedSymbolMap, true, std::move(debugName));
+	return std::make_shared<Module>(
+		objectFileBytes, numObjectFileBytes, importedSymbolMap, true, std::move(debugName));
 }
 
 bool LLVMJIT::getInstructionSourceByAddress(Uptr address, InstructionSource& outSource)
 {
-	Module* jitModule;
-	{
-		auto globalModuleState = GlobalModuleState::get();
-		Platform::RWMutex::ShareableLock addressToModuleMapLock(
-			globalModuleState->addressToModuleMapMutex);
-		auto moduleIt = globalModuleState->addressToModuleMap.upper_bound(address);
-		if(moduleIt == globalModuleState->addressToModuleMap.end()) { return false; }
-		jitModule = moduleIt->second;
-	}
+	Module* jitModule = GlobalModuleState::get()->findModuleByAddress(address);
+	if(!jitModule) { return false; }
 
 	auto functionIt = jitModule->addressToFunctionMap.upper_bound(address);
 	if(functionIt == jitModule->addressToFunctionMap.end()) { return false; }
@@ -801,7 +1312,9 @@ bool LLVMJIT::getInstructionSourceByAddress(Uptr address, InstructionSource& out
 
 #if LAZY_PARSE_DWARF_LINE_INFO
 	Platform::Mutex::Lock dwarfContextLock(jitModule->dwarfContextMutex);
-	llvm::DILineInfo lineInfo = jitModule->dwarfContext->getLineInfoForAddress(
+	auto dwarfContextIt = jitModule->dwarfContexts.upper_bound(address);
+	WAVM_ASSERT(dwarfContextIt != jitModule->dwarfContexts.end());
+	llvm::DILineInfo lineInfo = dwarfContextIt->second->getLineInfoForAddress(
 		llvm::object::SectionedAddress{address, llvm::object::SectionedAddress::UndefSection},
 		llvm::DILineInfoSpecifier(
 #if LLVM_VERSION_MAJOR >= 11
@@ -814,19 +1327,27 @@ bool LLVMJIT::getInstructionSourceByAddress(Uptr address, InstructionSource& out
 	outSource.instructionIndex = Uptr(lineInfo.Line);
 	return true;
 #else
-	// Find the highest entry in the offsetToOpIndexMap whose offset is <= the symbol-relative IP.
-	U32 ipOffset = (U32)(address - codeAddress);
-	Iptr opIndex = -1;
-	for(auto offsetMapIt : outSource.function->mutableData->offsetToOpIndexMap)
+	// Decode the function's pairs in the offset to op index table until reaching one whose offset
+	// is > the symbol-relative IP: the op index of the pair before it is the IP's op index.
+	const Runtime::FunctionMutableData* mutableData = outSource.function->mutableData;
+	Serialization::MemoryInputStream stream(
+		jitModule->offsetToOpIndexTable.data() + mutableData->offsetToOpIndexTableOffset,
+		mutableData->numOffsetToOpIndexTableBytes);
+	const U32 ipOffset = (U32)(address - codeAddress);
+	U32 offset = 0;
+	U32 opIndex = 0;
+	outSource.instructionIndex = 0;
+	while(stream.capacity())
 	{
-		if(offsetMapIt.first <= ipOffset) { opIndex = offsetMapIt.second; }
-		else
-		{
-			break;
-		}
+		U32 offsetDelta = 0;
+		I32 opIndexDelta = 0;
+		Serialization::serializeVarUInt32(stream, offsetDelta);
+		Serialization::serializeVarInt32(stream, opIndexDelta);
+		offset += offsetDelta;
+		opIndex += U32(opIndexDelta);
+		if(offset > ipOffset) { break; }
+		outSource.instructionIndex = I32(opIndex) > 0 ? Uptr(opIndex) : 0;
 	}
-
-	outSource.instructionIndex = opIndex > 0 ? Uptr(opIndex) : 0;
 	return true;
 #endif
 }
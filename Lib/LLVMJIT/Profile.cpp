@@ -0,0 +1,50 @@
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/LEB128.h"
+#include "WAVM/Inline/Serialization.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+
+using namespace WAVM;
+using namespace WAVM::LLVMJIT;
+using namespace WAVM::Serialization;
+
+// The profile format starts with a magic number and version, followed by the number of function
+// definitions, and for each function definition, the number of counts and the counts as LEB128s.
+static constexpr U32 profileMagic = 0x50564157; // "WAVP"
+static constexpr U32 profileVersion = 1;
+
+template<typename Stream> static void serializeProfileCounts(Stream& stream, ModuleProfile& profile)
+{
+	serializeConstant(stream, "magic number", profileMagic);
+	serializeConstant(stream, "version", profileVersion);
+	serializeArray(stream, profile.functionDefCounts, [](Stream& stream, std::vector<U64>& counts) {
+		serializeArray(stream, counts, [](Stream& stream, U64& count) {
+			serializeVarUInt64(stream, count);
+		});
+	});
+}
+
+std::vector<U8> LLVMJIT::serializeProfile(const ModuleProfile& profile)
+{
+	ArrayOutputStream stream;
+	serializeProfileCounts(stream, const_cast<ModuleProfile&>(profile));
+	return stream.getBytes();
+}
+
+bool LLVMJIT::deserializeProfile(const std::vector<U8>& bytes, ModuleProfile& outProfile)
+{
+	try
+	{
+		MemoryInputStream stream(bytes.data(), bytes.size());
+		serializeProfileCounts(stream, outProfile);
+		return true;
+	}
+	catch(FatalSerializationException const& exception)
+	{
+		Log::printf(Log::Category::error,
+					"Error deserializing profile: %s\n",
+					exception.message.c_str());
+		return false;
+	}
+}
@@ -1,5 +1,7 @@
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
@@ -14,7 +16,9 @@
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
 PUSH_DISABLE_WARNINGS_FOR_LLVM_HEADERS
@@ -46,6 +50,14 @@ using namespace WAVM::Runtime;
 // A global invoke thunk cache
 struct InvokeThunkCache
 {
+	// Thunks are indexed by function type ID in a table that can be read without locking the
+	// mutex. The table is split into fixed-size blocks that are allocated the first time a thunk
+	// is added to them, and never moved or freed until the cache is destroyed.
+	static constexpr Uptr numThunksPerBlock = 256;
+	static constexpr Uptr maxThunkBlocks = 1024;
+
+	std::atomic<std::atomic<InvokeThunkPointer>*> thunkBlocks[maxThunkBlocks]{};
+
 	Platform::RWMutex mutex;
 
 	HashMap<FunctionType, Runtime::Function*> typeToFunctionMap;
@@ -57,65 +69,80 @@ struct InvokeThunkCache
 		return singleton;
 	}
 
-private:
-	InvokeThunkCache() {}
-};
-
-InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType)
-{
-	InvokeThunkCache& invokeThunkCache = InvokeThunkCache::get();
+	InvokeThunkPointer getIndexedThunk(Uptr typeId)
+	{
+		if(typeId >= numThunksPerBlock * maxThunkBlocks) { return nullptr; }
+		std::atomic<InvokeThunkPointer>* block
+			= thunkBlocks[typeId / numThunksPerBlock].load(std::memory_order_acquire);
+		return block ? block[typeId % numThunksPerBlock].load(std::memory_order_acquire) : nullptr;
+	}
 
-	// First, take a shareable lock on the cache mutex, and check if the thunk is cached.
+	// Must be called with the mutex exclusively locked.
+	void setIndexedThunk(Uptr typeId, InvokeThunkPointer thunk)
 	{
-		Platform::RWMutex::ShareableLock shareableLock(invokeThunkCache.mutex);
-		Runtime::Function** invokeThunkFunction
-			= invokeThunkCache.typeToFunctionMap.get(functionType);
-		if(invokeThunkFunction)
+		if(typeId >= numThunksPerBlock * maxThunkBlocks) { return; }
+		std::atomic<std::atomic<InvokeThunkPointer>*>& blockRef
+			= thunkBlocks[typeId / numThunksPerBlock];
+		std::atomic<InvokeThunkPointer>* block = blockRef.load(std::memory_order_relaxed);
+		if(!block)
 		{
-			return reinterpret_cast<InvokeThunkPointer>(
-				const_cast<U8*>((*invokeThunkFunction)->code));
+			block = new std::atomic<InvokeThunkPointer>[numThunksPerBlock]{};
+			blockRef.store(block, std::memory_order_release);
 		}
+		block[typeId % numThunksPerBlock].store(thunk, std::memory_order_release);
 	}
 
-	// If the thunk is not cached, take an exclusive lock on the cache mutex.
-	Platform::RWMutex::ExclusiveLock invokeThunkLock(invokeThunkCache.mutex);
+private:
+	InvokeThunkCache() {}
+	~InvokeThunkCache()
+	{
+		for(Uptr blockIndex = 0; blockIndex < maxThunkBlocks; ++blockIndex)
+		{ delete[] thunkBlocks[blockIndex].load(std::memory_order_relaxed); }
+	}
+};
 
-	// Since the cache is unlocked briefly while switching from the shareable to the exclusive lock,
-	// check again if the thunk is cached.
-	Runtime::Function*& invokeThunkFunction
-		= invokeThunkCache.typeToFunctionMap.getOrAdd(functionType, nullptr);
-	if(invokeThunkFunction)
-	{ return reinterpret_cast<InvokeThunkPointer>(const_cast<U8*>(invokeThunkFunction->code)); }
+std::vector<Uptr> LLVMJIT::getModuleInvokeThunkTypeIndices(const IR::Module& irModule)
+{
+	std::vector<bool> isThunkType(irModule.types.size(), false);
+	for(const Export& export_ : irModule.exports)
+	{
+		if(export_.kind == ExternKind::function
+		   && export_.index >= irModule.functions.imports.size())
+		{ isThunkType[irModule.functions.getType(export_.index).index] = true; }
+	}
 
-	// Create a FunctionMutableData object for the thunk.
-	FunctionMutableData* functionMutableData
-		= new FunctionMutableData("thnk!C to WASM thunk!" + asString(functionType));
+	std::vector<Uptr> typeIndices;
+	for(Uptr typeIndex = 0; typeIndex < isThunkType.size(); ++typeIndex)
+	{
+		if(isThunkType[typeIndex]) { typeIndices.push_back(typeIndex); }
+	}
+	return typeIndices;
+}
 
-	// Create a LLVM module and a LLVM function for the thunk.
-	LLVMContext llvmContext;
-	llvm::Module llvmModule("", llvmContext);
-	std::unique_ptr<llvm::TargetMachine> targetMachine = getTargetMachine(getHostTargetSpec());
-	llvmModule.setDataLayout(targetMachine->createDataLayout());
+void LLVMJIT::emitInvokeThunk(LLVMContext& llvmContext,
+							  llvm::Module& llvmModule,
+							  llvm::TargetMachine* targetMachine,
+							  llvm::Type* iptrType,
+							  FunctionType functionType,
+							  const std::string& name,
+							  llvm::Constant* mutableData,
+							  llvm::Constant* typeId)
+{
 	auto llvmFunctionType = llvm::FunctionType::get(llvmContext.i8PtrType,
 													{llvmContext.i8PtrType,
 													 llvmContext.i8PtrType,
 													 llvmContext.i8PtrType,
 													 llvmContext.i8PtrType},
 													false);
-#if LLVM_VERSION_MAJOR >= 7
-	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getProgramPointerSize());
-#else
-	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getPointerSize());
-#endif
 	auto function = llvm::Function::Create(
-		llvmFunctionType, llvm::Function::ExternalLinkage, "thunk", &llvmModule);
+		llvmFunctionType, llvm::Function::ExternalLinkage, name, &llvmModule);
 	setRuntimeFunctionPrefix(llvmContext,
 							 iptrType,
 							 function,
-							 emitLiteralIptr(reinterpret_cast<Uptr>(functionMutableData), iptrType),
+							 mutableData,
 							 emitLiteralIptr(UINTPTR_MAX, iptrType),
-							 emitLiteralIptr(functionType.getEncoding().impl, iptrType));
-	setFunctionAttributes(targetMachine.get(), function);
+							 typeId);
+	setFunctionAttributes(targetMachine, function);
 
 	llvm::Value* calleeFunction = &*(function->args().begin() + 0);
 	llvm::Value* contextPointer = &*(function->args().begin() + 1);
@@ -164,16 +191,292 @@ InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType)
 	// Return the new context pointer.
 	emitContext.irBuilder.CreateRet(
 		emitContext.irBuilder.CreateLoad(emitContext.contextPointerVariable));
+}
+
+// Identifies the keys of cached invoke thunks, so they can't be mistaken for the WASM bytes of a
+// module that is cached with the same object cache.
+static constexpr U8 invokeThunkKeyMagic[8] = {0, 't', 'h', 'u', 'n', 'k', 0, 0};
+
+// Compiles an invoke thunk to object code. The thunk's FunctionMutableData and type ID are
+// imported symbols, so the object code doesn't depend on the process that compiled it.
+static std::vector<U8> compileInvokeThunk(FunctionType functionType)
+{
+	ThreadLLVMContext threadLLVMContext;
+	LLVMContext& llvmContext = *threadLLVMContext;
+	llvm::Module llvmModule("", llvmContext);
+	llvm::TargetMachine* targetMachine = getThreadTargetMachine(getHostTargetSpec());
+	llvmModule.setDataLayout(targetMachine->createDataLayout());
+#if LLVM_VERSION_MAJOR >= 7
+	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getProgramPointerSize());
+#else
+	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getPointerSize());
+#endif
+	auto createImportedIptr = [&](const char* name) {
+		return llvm::ConstantExpr::getPtrToInt(
+			new llvm::GlobalVariable(llvmModule,
+									 llvmContext.i8Type,
+									 false,
+									 llvm::GlobalVariable::ExternalLinkage,
+									 nullptr,
+									 name),
+			iptrType);
+	};
+	emitInvokeThunk(llvmContext,
+					llvmModule,
+					targetMachine,
+					iptrType,
+					functionType,
+					"thunk",
+					createImportedIptr("thunkMutableData"),
+					createImportedIptr("thunkTypeId"));
 
-	// Compile the LLVM IR to object code.
-	std::vector<U8> objectBytes
-		= compileLLVMModule(llvmContext, std::move(llvmModule), false, targetMachine.get());
+	return compileLLVMModule(
+		llvmContext, std::move(llvmModule), false, targetMachine, CompileOptions());
+}
+
+// Returns the bytes that the object code of a thunk for a function type is cached by.
+static std::vector<U8> getThunkKey(const U8 (&keyMagic)[8], FunctionType functionType)
+{
+	std::vector<U8> key(keyMagic, keyMagic + sizeof(keyMagic));
+	appendCompilerCacheKey(key, getHostTargetSpec());
+
+	key.push_back(U8(functionType.callingConvention()));
+	key.push_back(U8(functionType.params().size()));
+	key.push_back(U8(functionType.params().size() >> 8));
+	for(ValueType paramType : functionType.params()) { key.push_back(U8(paramType)); }
+	key.push_back(U8(functionType.results().size()));
+	key.push_back(U8(functionType.results().size() >> 8));
+	for(ValueType resultType : functionType.results()) { key.push_back(U8(resultType)); }
+	return key;
+}
+
+InvokeThunkPointer LLVMJIT::getInvokeThunk(FunctionType functionType,
+										   Runtime::ObjectCacheInterface* objectCache)
+{
+	InvokeThunkCache& invokeThunkCache = InvokeThunkCache::get();
+
+	// First, look up the thunk in the cache's table indexed by function type ID. This doesn't
+	// need to lock the cache mutex.
+	InvokeThunkPointer indexedThunk = invokeThunkCache.getIndexedThunk(functionType.getId());
+	if(indexedThunk) { return indexedThunk; }
+
+	// If the function type's ID is beyond the end of the table, take a shareable lock on the cache
+	// mutex, and check if the thunk is cached.
+	{
+		Platform::RWMutex::ShareableLock shareableLock(invokeThunkCache.mutex);
+		Runtime::Function** invokeThunkFunction
+			= invokeThunkCache.typeToFunctionMap.get(functionType);
+		if(invokeThunkFunction)
+		{
+			return reinterpret_cast<InvokeThunkPointer>(
+				const_cast<U8*>((*invokeThunkFunction)->code));
+		}
+	}
+
+	// If the thunk is not cached, take an exclusive lock on the cache mutex.
+	Platform::RWMutex::ExclusiveLock invokeThunkLock(invokeThunkCache.mutex);
+
+	// Since the cache is unlocked briefly while switching from the shareable to the exclusive lock,
+	// check again if the thunk is cached.
+	Runtime::Function*& invokeThunkFunction
+		= invokeThunkCache.typeToFunctionMap.getOrAdd(functionType, nullptr);
+	if(invokeThunkFunction)
+	{ return reinterpret_cast<InvokeThunkPointer>(const_cast<U8*>(invokeThunkFunction->code)); }
+
+	// Create a FunctionMutableData object for the thunk.
+	FunctionMutableData* functionMutableData
+		= new FunctionMutableData("thnk!C to WASM thunk!" + asString(functionType));
+
+	// Compile the thunk, or get its object code from the object cache.
+	std::shared_ptr<const std::vector<U8>> objectBytes;
+	if(!objectCache)
+	{ objectBytes = std::make_shared<const std::vector<U8>>(compileInvokeThunk(functionType)); }
+	else
+	{
+		const std::vector<U8> key = getThunkKey(invokeThunkKeyMagic, functionType);
+		objectBytes = objectCache->getCachedObject(
+			key.data(), key.size(), [functionType]() { return compileInvokeThunk(functionType); });
+	}
 
 	// Load the object code.
-	auto jitModule
-		= new LLVMJIT::Module(objectBytes, {}, false, std::string(functionMutableData->debugName));
+	HashMap<std::string, Uptr> importedSymbolMap;
+	importedSymbolMap.addOrFail("thunkMutableData", reinterpret_cast<Uptr>(functionMutableData));
+	importedSymbolMap.addOrFail("thunkTypeId", functionType.getEncoding().impl);
+	auto jitModule = new LLVMJIT::Module(objectBytes->data(),
+										 objectBytes->size(),
+										 importedSymbolMap,
+										 false,
+										 std::string(functionMutableData->debugName));
 	invokeThunkCache.modules.push_back(std::unique_ptr<LLVMJIT::Module>(jitModule));
 
 	invokeThunkFunction = jitModule->nameToFunctionMap[mangleSymbol("thunk")];
-	return reinterpret_cast<InvokeThunkPointer>(const_cast<U8*>(invokeThunkFunction->code));
+	InvokeThunkPointer invokeThunk
+		= reinterpret_cast<InvokeThunkPointer>(const_cast<U8*>(invokeThunkFunction->code));
+	invokeThunkCache.setIndexedThunk(functionType.getId(), invokeThunk);
+	return invokeThunk;
+}
+
+// A global cache of the trampolines that compiled code calls interpreted functions through.
+struct InterpreterTrampolineCache
+{
+	Platform::Mutex mutex;
+	HashMap<FunctionType, const void*> typeToTrampolineMap;
+	std::vector<std::unique_ptr<LLVMJIT::Module>> modules;
+
+	static InterpreterTrampolineCache& get()
+	{
+		static InterpreterTrampolineCache singleton;
+		return singleton;
+	}
+
+private:
+	InterpreterTrampolineCache() {}
+};
+
+// Identifies the keys of cached interpreter trampolines (see invokeThunkKeyMagic).
+static constexpr U8 interpreterTrampolineKeyMagic[8] = {0, 't', 'r', 'a', 'm', 'p', 0, 0};
+
+// Compiles an interpreter trampoline to object code. The trampoline's FunctionMutableData and
+// type ID, and the function it calls, are imported symbols.
+static std::vector<U8> compileInterpreterTrampoline(FunctionType functionType)
+{
+	ThreadLLVMContext threadLLVMContext;
+	LLVMContext& llvmContext = *threadLLVMContext;
+	llvm::Module llvmModule("", llvmContext);
+	llvm::TargetMachine* targetMachine = getThreadTargetMachine(getHostTargetSpec());
+	llvmModule.setDataLayout(targetMachine->createDataLayout());
+#if LLVM_VERSION_MAJOR >= 7
+	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getProgramPointerSize());
+#else
+	llvm::Type* iptrType = getIptrType(llvmContext, targetMachine->getPointerSize());
+#endif
+	auto createImportedIptr = [&](const char* name) {
+		return llvm::ConstantExpr::getPtrToInt(
+			new llvm::GlobalVariable(llvmModule,
+									 llvmContext.i8Type,
+									 false,
+									 llvm::GlobalVariable::ExternalLinkage,
+									 nullptr,
+									 name),
+			iptrType);
+	};
+
+	// The trampoline has the parameters of a WebAssembly function of the type, preceded by the
+	// nest parameter for the Runtime::Function being called.
+	llvm::FunctionType* wasmFunctionType = asLLVMType(llvmContext, functionType);
+	std::vector<llvm::Type*> llvmParamTypes{llvmContext.i8PtrType};
+	llvmParamTypes.insert(
+		llvmParamTypes.end(), wasmFunctionType->param_begin(), wasmFunctionType->param_end());
+	auto llvmFunctionType
+		= llvm::FunctionType::get(wasmFunctionType->getReturnType(), llvmParamTypes, false);
+	auto function = llvm::Function::Create(
+		llvmFunctionType, llvm::Function::ExternalLinkage, "trampoline", &llvmModule);
+	function->setCallingConv(asLLVMCallingConv(functionType.callingConvention()));
+	function->addParamAttr(0, llvm::Attribute::Nest);
+	setRuntimeFunctionPrefix(llvmContext,
+							 iptrType,
+							 function,
+							 createImportedIptr("trampolineMutableData"),
+							 emitLiteralIptr(UINTPTR_MAX, iptrType),
+							 createImportedIptr("trampolineTypeId"));
+	setFunctionAttributes(targetMachine, function);
+
+	auto interpretFunctionType = llvm::FunctionType::get(llvmContext.i8PtrType,
+														 {llvmContext.i8PtrType,
+														  llvmContext.i8PtrType,
+														  llvmContext.i8PtrType,
+														  llvmContext.i8PtrType},
+														 false);
+	auto interpretFunction = llvm::Function::Create(interpretFunctionType,
+													llvm::Function::ExternalLinkage,
+													"interpretFunction",
+													&llvmModule);
+
+	llvm::Value* calleeFunction = &*(function->args().begin() + 0);
+	llvm::Value* contextPointer = &*(function->args().begin() + 1);
+
+	EmitContext emitContext(llvmContext, {});
+	emitContext.irBuilder.SetInsertPoint(llvm::BasicBlock::Create(llvmContext, "entry", function));
+
+	// Store the arguments to an array that interpretFunction also writes the results to.
+	const Uptr numArrayValues
+		= std::max(std::max(functionType.params().size(), functionType.results().size()), Uptr(1));
+	llvm::AllocaInst* argsAndResultsArray = emitContext.irBuilder.CreateAlloca(
+		llvmContext.i8Type, emitLiteral(llvmContext, Uptr(numArrayValues * sizeof(UntaggedValue))));
+	argsAndResultsArray->setAlignment(LLVM_ALIGNMENT(alignof(UntaggedValue)));
+	for(Uptr argIndex = 0; argIndex < functionType.params().size(); ++argIndex)
+	{
+		llvm::Value* argOffset = emitLiteral(llvmContext, argIndex * sizeof(UntaggedValue));
+		emitContext.storeToUntypedPointer(
+			&*(function->args().begin() + 2 + argIndex),
+			emitContext.irBuilder.CreateInBoundsGEP(argsAndResultsArray, {argOffset}),
+			alignof(UntaggedValue));
+	}
+
+	// Call interpretFunction, which returns the new context pointer.
+	llvm::Value* newContextPointer = emitContext.irBuilder.CreateCall(
+		interpretFunctionType,
+		interpretFunction,
+		{calleeFunction, contextPointer, argsAndResultsArray, argsAndResultsArray});
+	emitContext.initContextVariables(newContextPointer, iptrType);
+
+	// Load the results from the array, and return them with the new context pointer.
+	ValueVector results;
+	for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
+	{
+		llvm::Value* resultOffset = emitLiteral(llvmContext, resultIndex * sizeof(UntaggedValue));
+		results.push_back(emitContext.loadFromUntypedPointer(
+			emitContext.irBuilder.CreateInBoundsGEP(argsAndResultsArray, {resultOffset}),
+			asLLVMType(llvmContext, functionType.results()[resultIndex]),
+			alignof(UntaggedValue)));
+	}
+	emitContext.emitReturn(functionType.results(), results);
+
+	return compileLLVMModule(
+		llvmContext, std::move(llvmModule), false, targetMachine, CompileOptions());
+}
+
+const void* LLVMJIT::getInterpreterTrampoline(FunctionType functionType,
+											  InvokeThunkPointer interpretFunction,
+											  Runtime::ObjectCacheInterface* objectCache)
+{
+	InterpreterTrampolineCache& trampolineCache = InterpreterTrampolineCache::get();
+	Platform::Mutex::Lock trampolineLock(trampolineCache.mutex);
+
+	const void*& trampoline = trampolineCache.typeToTrampolineMap.getOrAdd(functionType, nullptr);
+	if(trampoline) { return trampoline; }
+
+	FunctionMutableData* functionMutableData
+		= new FunctionMutableData("thnk!WASM to interpreter thunk!" + asString(functionType));
+
+	// Compile the trampoline, or get its object code from the object cache.
+	std::shared_ptr<const std::vector<U8>> objectBytes;
+	if(!objectCache)
+	{
+		objectBytes = std::make_shared<const std::vector<U8>>(
+			compileInterpreterTrampoline(functionType));
+	}
+	else
+	{
+		const std::vector<U8> key = getThunkKey(interpreterTrampolineKeyMagic, functionType);
+		objectBytes = objectCache->getCachedObject(key.data(), key.size(), [functionType]() {
+			return compileInterpreterTrampoline(functionType);
+		});
+	}
+
+	// Load the object code.
+	HashMap<std::string, Uptr> importedSymbolMap;
+	importedSymbolMap.addOrFail("trampolineMutableData",
+								reinterpret_cast<Uptr>(functionMutableData));
+	importedSymbolMap.addOrFail("trampolineTypeId", functionType.getEncoding().impl);
+	importedSymbolMap.addOrFail("interpretFunction", reinterpret_cast<Uptr>(interpretFunction));
+	auto jitModule = new LLVMJIT::Module(objectBytes->data(),
+										 objectBytes->size(),
+										 importedSymbolMap,
+										 false,
+										 std::string(functionMutableData->debugName));
+	trampolineCache.modules.push_back(std::unique_ptr<LLVMJIT::Module>(jitModule));
+
+	trampoline = jitModule->nameToFunctionMap[mangleSymbol("trampoline")]->code;
+	return trampoline;
 }
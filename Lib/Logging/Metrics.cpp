@@ -0,0 +1,215 @@
+#include "WAVM/Logging/Metrics.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Platform/Mutex.h"
+
+using namespace WAVM;
+using namespace WAVM::Metrics;
+
+struct Metric
+{
+	std::string name;
+	std::string description;
+	MetricType type;
+	std::unique_ptr<Counter> counter;
+	std::unique_ptr<Gauge> gauge;
+	std::unique_ptr<Histogram> histogram;
+};
+
+struct Registry
+{
+	Platform::Mutex mutex;
+	std::vector<std::unique_ptr<Metric>> metrics;
+	HashMap<std::string, Metric*> nameToMetricMap;
+
+	// The registry is never destroyed, so references to metrics stay valid during static
+	// destruction.
+	static Registry& get()
+	{
+		static Registry* registry = new Registry;
+		return *registry;
+	}
+};
+
+static Metric& getMetric(const char* name, const char* description, MetricType type)
+{
+	Registry& registry = Registry::get();
+	Platform::Mutex::Lock registryLock(registry.mutex);
+
+	Metric*& metric = registry.nameToMetricMap.getOrAdd(name, nullptr);
+	if(!metric)
+	{
+		registry.metrics.emplace_back(
+			new Metric{name, description, type, nullptr, nullptr, nullptr});
+		metric = registry.metrics.back().get();
+		switch(type)
+		{
+		case MetricType::counter: metric->counter.reset(new Counter); break;
+		case MetricType::gauge: metric->gauge.reset(new Gauge); break;
+		case MetricType::histogram: metric->histogram.reset(new Histogram); break;
+		default: WAVM_UNREACHABLE();
+		};
+	}
+	else if(metric->type != type)
+	{
+		Errors::fatalf("Metric '%s' was used as more than one type of metric", name);
+	}
+	return *metric;
+}
+
+Counter& Metrics::getCounter(const char* name, const char* description)
+{
+	return *getMetric(name, description, MetricType::counter).counter;
+}
+
+Gauge& Metrics::getGauge(const char* name, const char* description)
+{
+	return *getMetric(name, description, MetricType::gauge).gauge;
+}
+
+Histogram& Metrics::getHistogram(const char* name, const char* description)
+{
+	return *getMetric(name, description, MetricType::histogram).histogram;
+}
+
+std::vector<MetricValue> Metrics::getMetrics()
+{
+	Registry& registry = Registry::get();
+	Platform::Mutex::Lock registryLock(registry.mutex);
+
+	std::vector<MetricValue> values;
+	for(const std::unique_ptr<Metric>& metric : registry.metrics)
+	{
+		MetricValue value;
+		value.name = metric->name;
+		value.description = metric->description;
+		value.type = metric->type;
+		if(metric->type == MetricType::counter)
+		{
+			value.count = metric->counter->get();
+			value.sum = 0;
+		}
+		else if(metric->type == MetricType::gauge)
+		{
+			value.count = metric->gauge->get();
+			value.sum = 0;
+		}
+		else
+		{
+			value.count = metric->histogram->getCount();
+			value.sum = metric->histogram->getSum();
+			for(Uptr bucketIndex = 0; bucketIndex < Histogram::numBuckets; ++bucketIndex)
+			{ value.bucketCounts.push_back(metric->histogram->getBucketCount(bucketIndex)); }
+		}
+		values.push_back(std::move(value));
+	}
+	return values;
+}
+
+// Splits a metric name into the name and the labels in braces following it.
+static void splitLabels(const std::string& name, std::string& outBaseName, std::string& outLabels)
+{
+	const Uptr labelsBegin = name.find('{');
+	if(labelsBegin == std::string::npos)
+	{
+		outBaseName = name;
+		outLabels.clear();
+	}
+	else
+	{
+		outBaseName = name.substr(0, labelsBegin);
+		outLabels = name.substr(labelsBegin + 1, name.size() - labelsBegin - 2);
+	}
+}
+
+static void appendf(std::string& string, const char* format, ...) WAVM_VALIDATE_AS_PRINTF(2, 3);
+static void appendf(std::string& string, const char* format, ...)
+{
+	char buffer[256];
+	va_list argList;
+	va_start(argList, format);
+	const int numChars = vsnprintf(buffer, sizeof(buffer), format, argList);
+	va_end(argList);
+	WAVM_ERROR_UNLESS(numChars >= 0 && Uptr(numChars) < sizeof(buffer));
+	string.append(buffer, Uptr(numChars));
+}
+
+std::string Metrics::getPrometheusText()
+{
+	// Group the metrics with the same name and different labels together, since they must share a
+	// single HELP and TYPE line.
+	std::vector<MetricValue> values = getMetrics();
+	std::stable_sort(
+		values.begin(), values.end(), [](const MetricValue& left, const MetricValue& right) {
+			return left.name.substr(0, left.name.find('{'))
+				   < right.name.substr(0, right.name.find('{'));
+		});
+
+	std::string result;
+	std::string previousBaseName;
+	for(const MetricValue& value : values)
+	{
+		std::string baseName;
+		std::string labels;
+		splitLabels(value.name, baseName, labels);
+
+		if(baseName != previousBaseName)
+		{
+			result += "# HELP " + baseName + ' ' + value.description + '\n';
+			result += "# TYPE " + baseName;
+			switch(value.type)
+			{
+			case MetricType::counter: result += " counter\n"; break;
+			case MetricType::gauge: result += " gauge\n"; break;
+			case MetricType::histogram: result += " histogram\n"; break;
+			default: WAVM_UNREACHABLE();
+			};
+			previousBaseName = baseName;
+		}
+
+		if(value.type != MetricType::histogram)
+		{
+			appendf(result, "%s %" PRIu64 "\n", value.name.c_str(), value.count);
+			continue;
+		}
+
+		// Write the cumulative count of the values <= the upper bound of each bucket, up to the
+		// last bucket that isn't empty.
+		const std::string labelPrefix = labels.size() ? labels + ',' : std::string();
+		Uptr numBuckets = Histogram::numBuckets;
+		while(numBuckets > 0 && !value.bucketCounts[numBuckets - 1]) { --numBuckets; };
+		U64 cumulativeCount = 0;
+		for(Uptr bucketIndex = 0; bucketIndex < numBuckets && bucketIndex < 64; ++bucketIndex)
+		{
+			cumulativeCount += value.bucketCounts[bucketIndex];
+			const U64 upperBound = bucketIndex == 0 ? 0 : (U64(2) << (bucketIndex - 1)) - 1;
+			appendf(result,
+					"%s_bucket{%sle=\"%" PRIu64 "\"} %" PRIu64 "\n",
+					baseName.c_str(),
+					labelPrefix.c_str(),
+					upperBound,
+					cumulativeCount);
+		}
+		appendf(result,
+				"%s_bucket{%sle=\"+Inf\"} %" PRIu64 "\n",
+				baseName.c_str(),
+				labelPrefix.c_str(),
+				value.count);
+
+		const std::string labelSuffix = labels.size() ? '{' + labels + '}' : std::string();
+		appendf(result, "%s_sum%s %" PRIu64 "\n", baseName.c_str(), labelSuffix.c_str(), value.sum);
+		appendf(
+			result, "%s_count%s %" PRIu64 "\n", baseName.c_str(), labelSuffix.c_str(), value.count);
+	}
+	return result;
+}
@@ -0,0 +1,277 @@
+#include "WAVM/Logging/Trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Mutex.h"
+
+using namespace WAVM;
+using namespace WAVM::Trace;
+
+// A ring buffer of the events recorded by a thread. Only the recording thread writes
+// numWrittenEvents, and only the thread holding the sink mutex writes numReadEvents, so events
+// may be recorded without taking a lock.
+struct ThreadBuffer
+{
+	static constexpr Uptr numEvents = 4096;
+
+	Event events[numEvents];
+	std::atomic<U64> numWrittenEvents{0};
+	std::atomic<U64> numReadEvents{0};
+	const U64 threadIndex;
+
+	ThreadBuffer(U64 inThreadIndex) : threadIndex(inThreadIndex) {}
+};
+
+struct TraceState
+{
+	std::atomic<bool> isEnabled{false};
+	std::atomic<U64> numDroppedEvents{0};
+
+	// If both mutexes are locked, sinkMutex must be locked first.
+	Platform::Mutex sinkMutex;
+	std::shared_ptr<Sink> sink;
+	bool hasRegisteredExitFlush = false;
+
+	Platform::Mutex threadBuffersMutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers;
+	U64 nextThreadIndex = 0;
+
+	// The state is never destroyed, so threads may record events during static destruction.
+	static TraceState& get()
+	{
+		static TraceState* state = create();
+		return *state;
+	}
+
+private:
+	static TraceState* create();
+};
+
+static thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+static void flushAtExit() { setSink(nullptr); }
+
+// Writes the events in a thread's buffer to the sink. The caller must hold the sink mutex.
+static void drainThreadBuffer(TraceState& state, ThreadBuffer& buffer)
+{
+	const U64 numWrittenEvents = buffer.numWrittenEvents.load(std::memory_order_acquire);
+	U64 numReadEvents = buffer.numReadEvents.load(std::memory_order_relaxed);
+	while(state.sink && numReadEvents < numWrittenEvents)
+	{
+		// Write the events up to the end of the buffer, then the events that wrapped around.
+		const Uptr firstEventIndex = Uptr(numReadEvents % ThreadBuffer::numEvents);
+		const Uptr numContiguousEvents
+			= Uptr(std::min(numWrittenEvents - numReadEvents,
+							U64(ThreadBuffer::numEvents - firstEventIndex)));
+		state.sink->write(buffer.events + firstEventIndex, numContiguousEvents);
+		numReadEvents += numContiguousEvents;
+	}
+	buffer.numReadEvents.store(numWrittenEvents, std::memory_order_release);
+}
+
+static void flushLocked(TraceState& state)
+{
+	std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers;
+	{
+		Platform::Mutex::Lock threadBuffersLock(state.threadBuffersMutex);
+		threadBuffers = state.threadBuffers;
+	}
+
+	for(const std::shared_ptr<ThreadBuffer>& buffer : threadBuffers)
+	{ drainThreadBuffer(state, *buffer); }
+
+	// Forget the buffers of threads that have exited, now that their events are written.
+	{
+		Platform::Mutex::Lock threadBuffersLock(state.threadBuffersMutex);
+		threadBuffers.clear();
+		for(Uptr bufferIndex = 0; bufferIndex < state.threadBuffers.size();)
+		{
+			if(state.threadBuffers[bufferIndex].use_count() == 1)
+			{
+				state.threadBuffers[bufferIndex] = state.threadBuffers.back();
+				state.threadBuffers.pop_back();
+			}
+			else
+			{
+				++bufferIndex;
+			}
+		}
+	}
+
+	const U64 numDroppedEvents = state.numDroppedEvents.exchange(0, std::memory_order_relaxed);
+	if(numDroppedEvents)
+	{
+		Log::printf(Log::debug,
+					"Dropped %" PRIu64 " trace events that overflowed a thread's buffer.\n",
+					numDroppedEvents);
+	}
+}
+
+TraceState* TraceState::create()
+{
+	TraceState* state = new TraceState;
+
+	const char* filename = getenv("WAVM_TRACE");
+	if(filename && *filename)
+	{
+		state->sink = createChromeTraceFileSink(filename);
+		if(!state->sink) { Log::printf(Log::error, "Couldn't create trace file %s\n", filename); }
+		else
+		{
+			state->isEnabled.store(true, std::memory_order_relaxed);
+			state->hasRegisteredExitFlush = true;
+			atexit(flushAtExit);
+		}
+	}
+
+	return state;
+}
+
+void Trace::setSink(std::shared_ptr<Sink> sink)
+{
+	TraceState& state = TraceState::get();
+	std::shared_ptr<Sink> oldSink;
+	{
+		Platform::Mutex::Lock sinkLock(state.sinkMutex);
+		flushLocked(state);
+		oldSink = std::move(state.sink);
+		state.sink = std::move(sink);
+		state.isEnabled.store(!!state.sink, std::memory_order_relaxed);
+
+		// Flush the events recorded for the sink when the process exits.
+		if(state.sink && !state.hasRegisteredExitFlush)
+		{
+			state.hasRegisteredExitFlush = true;
+			atexit(flushAtExit);
+		}
+	}
+
+	// Destroy the old sink outside the lock, since it may complete a file.
+	oldSink.reset();
+}
+
+void Trace::flush()
+{
+	TraceState& state = TraceState::get();
+	Platform::Mutex::Lock sinkLock(state.sinkMutex);
+	flushLocked(state);
+}
+
+bool Trace::isEnabled()
+{
+	return TraceState::get().isEnabled.load(std::memory_order_relaxed);
+}
+
+U64 Trace::getTimestamp()
+{
+	return U64(Platform::getClockTime(Platform::Clock::monotonic).ns);
+}
+
+void Trace::recordEvent(const char* category,
+						const char* name,
+						U64 beginNanoseconds,
+						U64 endNanoseconds)
+{
+	TraceState& state = TraceState::get();
+	if(!threadBuffer)
+	{
+		Platform::Mutex::Lock threadBuffersLock(state.threadBuffersMutex);
+		threadBuffer = std::make_shared<ThreadBuffer>(state.nextThreadIndex++);
+		state.threadBuffers.push_back(threadBuffer);
+	}
+
+	// If the buffer is full, drop the event rather than waiting for it to be flushed.
+	const U64 numWrittenEvents = threadBuffer->numWrittenEvents.load(std::memory_order_relaxed);
+	const U64 numReadEvents = threadBuffer->numReadEvents.load(std::memory_order_acquire);
+	if(numWrittenEvents - numReadEvents >= ThreadBuffer::numEvents)
+	{
+		state.numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event& event = threadBuffer->events[numWrittenEvents % ThreadBuffer::numEvents];
+	event.category = category;
+	strncpy(event.name, name, Event::maxNameChars);
+	event.name[Event::maxNameChars] = 0;
+	event.beginNanoseconds = beginNanoseconds;
+	event.endNanoseconds = endNanoseconds;
+	event.threadIndex = threadBuffer->threadIndex;
+	threadBuffer->numWrittenEvents.store(numWrittenEvents + 1, std::memory_order_release);
+
+	// Flush the buffers when this thread's buffer is half full, so it doesn't need to drop events.
+	if(numWrittenEvents + 1 - numReadEvents == ThreadBuffer::numEvents / 2) { flush(); }
+}
+
+struct ChromeTraceFileSink : Sink
+{
+	ChromeTraceFileSink(FILE* inFile) : file(inFile) { fputs("[", file); }
+
+	~ChromeTraceFileSink()
+	{
+		fputs("\n]\n", file);
+		fclose(file);
+	}
+
+	virtual void write(const Event* events, Uptr numEvents) override
+	{
+		for(Uptr eventIndex = 0; eventIndex < numEvents; ++eventIndex)
+		{
+			const Event& event = events[eventIndex];
+			fputs(hasWrittenEvent ? ",\n" : "\n", file);
+			hasWrittenEvent = true;
+
+			fputs("{\"name\":\"", file);
+			writeEscapedString(event.name);
+			fputs("\",\"cat\":\"", file);
+			writeEscapedString(event.category);
+
+			// Chrome trace timestamps are in microseconds.
+			fprintf(file,
+					"\",\"ph\":\"X\",\"ts\":%" PRIu64 ".%03u,\"dur\":%" PRIu64
+					".%03u,\"pid\":1,\"tid\":%" PRIu64 "}",
+					event.beginNanoseconds / 1000,
+					unsigned(event.beginNanoseconds % 1000),
+					(event.endNanoseconds - event.beginNanoseconds) / 1000,
+					unsigned((event.endNanoseconds - event.beginNanoseconds) % 1000),
+					event.threadIndex);
+		}
+		fflush(file);
+	}
+
+private:
+	FILE* file;
+	bool hasWrittenEvent = false;
+
+	void writeEscapedString(const char* string)
+	{
+		for(; *string; ++string)
+		{
+			const char c = *string;
+			if(c == '"' || c == '\\') { fprintf(file, "\\%c", c); }
+			else if(U8(c) < 0x20)
+			{
+				fprintf(file, "\\u%04x", unsigned(U8(c)));
+			}
+			else
+			{
+				fputc(c, file);
+			}
+		}
+	}
+};
+
+std::shared_ptr<Sink> Trace::createChromeTraceFileSink(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if(!file) { return nullptr; }
+	return std::make_shared<ChromeTraceFileSink>(file);
+}
@@ -0,0 +1,184 @@
+#include "LZ4.h"
+#include <string.h>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+
+using namespace WAVM;
+using namespace WAVM::ObjectCache;
+
+// The LZ4 block format is a sequence of literal runs, each followed by a match that copies bytes
+// from up to 64KB before it. The last 5 bytes are always literals, and the last match must start at
+// least 12 bytes before the end.
+static constexpr Uptr minMatchBytes = 4;
+static constexpr Uptr maxMatchOffset = 65535;
+static constexpr Uptr numLastLiteralBytes = 5;
+static constexpr Uptr lastMatchStartMargin = 12;
+static constexpr Uptr hashTableLog2 = 16;
+
+static U32 load32(const U8* bytes)
+{
+	U32 result;
+	memcpy(&result, bytes, sizeof(U32));
+	return result;
+}
+
+static Uptr hash32(U32 value) { return Uptr((value * 2654435761u) >> (32 - hashTableLog2)); }
+
+static void encodeLength(std::vector<U8>& outBytes, Uptr length)
+{
+	while(length >= 255)
+	{
+		outBytes.push_back(255);
+		length -= 255;
+	}
+	outBytes.push_back(U8(length));
+}
+
+static void encodeSequence(std::vector<U8>& outBytes,
+						   const U8* literals,
+						   Uptr numLiterals,
+						   Uptr matchOffset,
+						   Uptr numMatchBytes)
+{
+	const Uptr matchLengthCode = numMatchBytes ? numMatchBytes - minMatchBytes : 0;
+	outBytes.push_back(U8((numLiterals < 15 ? numLiterals : 15) << 4
+						  | (matchLengthCode < 15 ? matchLengthCode : 15)));
+	if(numLiterals >= 15) { encodeLength(outBytes, numLiterals - 15); }
+	outBytes.insert(outBytes.end(), literals, literals + numLiterals);
+
+	if(numMatchBytes)
+	{
+		outBytes.push_back(U8(matchOffset));
+		outBytes.push_back(U8(matchOffset >> 8));
+		if(matchLengthCode >= 15) { encodeLength(outBytes, matchLengthCode - 15); }
+	}
+}
+
+void ObjectCache::compressLZ4(const U8* bytes, Uptr numBytes, std::vector<U8>& outCompressedBytes)
+{
+	outCompressedBytes.clear();
+	outCompressedBytes.reserve(numBytes + numBytes / 255 + 16);
+
+	// Map hashes of 4 byte sequences to the last position they occurred at.
+	std::vector<U32> hashTable(Uptr(1) << hashTableLog2, 0);
+
+	Uptr literalsStart = 0;
+	Uptr position = 0;
+	const Uptr matchStartLimit
+		= numBytes > lastMatchStartMargin ? numBytes - lastMatchStartMargin : 0;
+	while(position < matchStartLimit)
+	{
+		const U32 sequence = load32(bytes + position);
+		const Uptr hash = hash32(sequence);
+		Uptr candidate = hashTable[hash];
+		hashTable[hash] = U32(position);
+
+		if(candidate >= position || position - candidate > maxMatchOffset
+		   || load32(bytes + candidate) != sequence)
+		{
+			// Skip ahead faster through bytes that don't match, since they are likely to be
+			// incompressible.
+			position += 1 + ((position - literalsStart) >> 6);
+			continue;
+		}
+
+		// Extend the match forward and backward.
+		Uptr matchEnd = position + minMatchBytes;
+		const Uptr matchEndLimit = numBytes - numLastLiteralBytes;
+		while(matchEnd < matchEndLimit && bytes[matchEnd] == bytes[candidate + matchEnd - position])
+		{ ++matchEnd; }
+		while(position > literalsStart && candidate > 0
+			  && bytes[position - 1] == bytes[candidate - 1])
+		{
+			--position;
+			--candidate;
+		}
+
+		encodeSequence(outCompressedBytes,
+					   bytes + literalsStart,
+					   position - literalsStart,
+					   position - candidate,
+					   matchEnd - position);
+		position = matchEnd;
+		literalsStart = position;
+	}
+
+	encodeSequence(outCompressedBytes, bytes + literalsStart, numBytes - literalsStart, 0, 0);
+}
+
+static bool decodeLength(const U8* compressedBytes,
+						 Uptr numCompressedBytes,
+						 Uptr& inOutIndex,
+						 Uptr& inOutLength)
+{
+	U8 lengthByte;
+	do
+	{
+		if(inOutIndex >= numCompressedBytes) { return false; }
+		lengthByte = compressedBytes[inOutIndex++];
+		inOutLength += lengthByte;
+	} while(lengthByte == 255);
+	return true;
+}
+
+bool ObjectCache::decompressLZ4(const U8* compressedBytes,
+								Uptr numCompressedBytes,
+								U8* outBytes,
+								Uptr numBytes)
+{
+	Uptr inIndex = 0;
+	Uptr outIndex = 0;
+	while(true)
+	{
+		if(inIndex >= numCompressedBytes) { return false; }
+		const U8 token = compressedBytes[inIndex++];
+
+		// Copy the literals.
+		Uptr numLiterals = token >> 4;
+		if(numLiterals == 15
+		   && !decodeLength(compressedBytes, numCompressedBytes, inIndex, numLiterals))
+		{ return false; }
+		if(numLiterals > numCompressedBytes - inIndex || numLiterals > numBytes - outIndex)
+		{ return false; }
+		memcpy(outBytes + outIndex, compressedBytes + inIndex, numLiterals);
+		inIndex += numLiterals;
+		outIndex += numLiterals;
+
+		// The last sequence only has literals.
+		if(inIndex == numCompressedBytes) { return outIndex == numBytes; }
+
+		// Copy the match.
+		if(numCompressedBytes - inIndex < 2) { return false; }
+		const Uptr matchOffset
+			= Uptr(compressedBytes[inIndex]) | (Uptr(compressedBytes[inIndex + 1]) << 8);
+		inIndex += 2;
+		if(matchOffset == 0 || matchOffset > outIndex) { return false; }
+
+		Uptr numMatchBytes = token & 15;
+		if(numMatchBytes == 15
+		   && !decodeLength(compressedBytes, numCompressedBytes, inIndex, numMatchBytes))
+		{ return false; }
+		numMatchBytes += minMatchBytes;
+		if(numMatchBytes > numBytes - outIndex) { return false; }
+
+		// The match may overlap the bytes it produces, so copy it in chunks no larger than the
+		// offset.
+		const U8* matchBytes = outBytes + outIndex - matchOffset;
+		if(matchOffset >= numMatchBytes) { memcpy(outBytes + outIndex, matchBytes, numMatchBytes); }
+		else if(matchOffset >= 8)
+		{
+			for(Uptr index = 0; index < numMatchBytes; index += 8)
+			{
+				const Uptr numChunkBytes = numMatchBytes - index < 8 ? numMatchBytes - index : 8;
+				memcpy(outBytes + outIndex + index, matchBytes + index, numChunkBytes);
+			}
+		}
+		else
+		{
+			for(Uptr index = 0; index < numMatchBytes; ++index)
+			{ outBytes[outIndex + index] = matchBytes[index]; }
+		}
+		outIndex += numMatchBytes;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+
+namespace WAVM { namespace ObjectCache {
+	// Compresses bytes in the LZ4 block format, which is fast enough to compress object code as it
+	// is added to the cache, and to decompress it on every cache hit.
+	void compressLZ4(const U8* bytes, Uptr numBytes, std::vector<U8>& outCompressedBytes);
+
+	// Decompresses LZ4 compressed bytes into a buffer that is exactly the size of the decompressed
+	// bytes. Returns false if the compressed bytes are malformed.
+	bool decompressLZ4(const U8* compressedBytes,
+					   Uptr numCompressedBytes,
+					   U8* outBytes,
+					   Uptr numBytes);
+}}
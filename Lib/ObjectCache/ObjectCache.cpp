@@ -1,16 +1,30 @@
 #include "WAVM/ObjectCache/ObjectCache.h"
 #include <errno.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <list>
 #include <memory>
+#include <string>
 #include <vector>
+#include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Time.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Logging/Trace.h"
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Runtime.h"
+#include "LZ4.h"
 #include "lmdb.h"
 
 #ifdef _MSC_VER
@@ -24,7 +38,7 @@
 #pragma warning(pop)
 #endif
 
-#define CURRENT_DB_VERSION 1
+#define CURRENT_DB_VERSION 3
 
 using namespace WAVM;
 using namespace WAVM::ObjectCache;
@@ -59,8 +73,30 @@ WAVM_PACKED_STRUCT(struct ModuleKey {
 		memcpy(&result, codeKeyBytes, sizeof(U64));
 		return result;
 	}
+
+	friend bool operator==(const ModuleKey& left, const ModuleKey& right)
+	{
+		return !memcmp(&left, &right, sizeof(ModuleKey));
+	}
+	friend bool operator!=(const ModuleKey& left, const ModuleKey& right)
+	{
+		return !(left == right);
+	}
 });
 
+namespace WAVM {
+	template<> struct Hash<ModuleKey>
+	{
+		Uptr operator()(const ModuleKey& key, Uptr seed = 0) const
+		{
+			Uptr hash = Hash<U64>()(key.getCodeKey(), seed);
+			hash = Hash<U64>()(key.moduleHashU64s[0], hash);
+			hash = Hash<U64>()(key.moduleHashU64s[1], hash);
+			return hash;
+		}
+	};
+}
+
 // A database key that orders Time values in ascending order. LMDB orders the keys lexically as a
 // string of bytes, so the Time's I128 needs to be encoded in big-endian order to place the
 // most-signifigant bits at the beginning of that string.
@@ -87,6 +123,12 @@ WAVM_PACKED_STRUCT(struct TimeKey {
 
 WAVM_PACKED_STRUCT(struct Metadata { TimeKey lastAccessTimeKey; });
 
+// Object code is stored in the object table after a header that says whether it is compressed.
+WAVM_PACKED_STRUCT(struct ObjectHeader {
+	U64 numObjectBytes;
+	U8 isCompressed;
+});
+
 //
 // Helper functions to reinterpret C++ types to and from MDB_vals.
 //
@@ -313,6 +355,22 @@ struct Database
 		ERROR_UNLESS_MDB_SUCCESS(mdb_drop(txn, dbi, 0));
 	}
 
+	// Returns the number of pages used by a table. All errors are fatal.
+	static Uptr getNumTablePages(MDB_txn* txn, MDB_dbi dbi)
+	{
+		MDB_stat stat;
+		ERROR_UNLESS_MDB_SUCCESS(mdb_stat(txn, dbi, &stat));
+		return Uptr(stat.ms_branch_pages + stat.ms_leaf_pages + stat.ms_overflow_pages);
+	}
+
+	// Returns the size of the database's pages. All errors are fatal.
+	Uptr getPageSize()
+	{
+		MDB_stat stat;
+		ERROR_UNLESS_MDB_SUCCESS(mdb_env_stat(env, &stat));
+		return Uptr(stat.ms_psize);
+	}
+
 private:
 	MDB_env* env;
 };
@@ -353,12 +411,208 @@ private:
 	MDB_txn* txn;
 };
 
+static constexpr Uptr defaultMaxMemoryCacheBytes = Uptr(64) * 1024 * 1024;
+
+// A process-wide cache of recently used object code that is checked before the LMDB database. It
+// also tracks the modules that are being looked up in the database or compiled, so concurrent
+// misses on the same module wait for a single compile instead of each compiling the module.
+struct MemoryObjectCache
+{
+	// A module that a thread is looking up in the database or compiling. That thread holds the
+	// mutex until the object code is available, so other threads can wait for it by locking it.
+	struct PendingObject
+	{
+		Platform::Mutex mutex;
+		std::shared_ptr<const std::vector<U8>> objectCode;
+	};
+
+	struct Entry
+	{
+		std::shared_ptr<const std::vector<U8>> objectCode;
+		std::list<ModuleKey>::iterator lruIt;
+	};
+
+	Platform::Mutex mutex;
+	HashMap<ModuleKey, Entry> entries;
+	HashMap<ModuleKey, std::shared_ptr<PendingObject>> pendingObjects;
+
+	// The keys of the cached entries, ordered from most to least recently used.
+	std::list<ModuleKey> lruKeys;
+
+	Uptr numBytes = 0;
+	Uptr maxBytes = defaultMaxMemoryCacheBytes;
+
+	static MemoryObjectCache& get()
+	{
+		static MemoryObjectCache memoryObjectCache;
+		return memoryObjectCache;
+	}
+
+	// Looks up the object code for a module. If no other thread is producing the module's object
+	// code, returns nullptr, and sets outPendingObject to an object that the caller must pass to
+	// finishPendingObject. Otherwise, waits for the other thread to finish. The mutex must not be
+	// locked by the calling thread.
+	std::shared_ptr<const std::vector<U8>> getOrBeginPending(
+		const ModuleKey& moduleKey,
+		std::shared_ptr<PendingObject>& outPendingObject)
+	{
+		while(true)
+		{
+			std::shared_ptr<PendingObject> otherPendingObject;
+			{
+				Platform::Mutex::Lock lock(mutex);
+				if(Entry* entry = entries.get(moduleKey))
+				{
+					// Move the entry to the front of the LRU list.
+					lruKeys.splice(lruKeys.begin(), lruKeys, entry->lruIt);
+					return entry->objectCode;
+				}
+
+				if(std::shared_ptr<PendingObject>* pendingObject = pendingObjects.get(moduleKey))
+				{ otherPendingObject = *pendingObject; }
+				else
+				{
+					// Lock the new pending object's mutex before publishing it.
+					outPendingObject = std::make_shared<PendingObject>();
+					outPendingObject->mutex.lock();
+					pendingObjects.addOrFail(moduleKey, outPendingObject);
+					return nullptr;
+				}
+			}
+
+			// Wait for the other thread to finish producing the object code. If it failed to,
+			// retry, and produce it on this thread.
+			Platform::Mutex::Lock pendingLock(otherPendingObject->mutex);
+			if(otherPendingObject->objectCode) { return otherPendingObject->objectCode; }
+		}
+	}
+
+	// Publishes the object code for a module returned by getOrBeginPending, and wakes any threads
+	// waiting for it. If objectCode is null, the waiting threads retry producing it themselves.
+	void finishPendingObject(const ModuleKey& moduleKey,
+							 const std::shared_ptr<PendingObject>& pendingObject,
+							 const std::shared_ptr<const std::vector<U8>>& objectCode)
+	{
+		{
+			Platform::Mutex::Lock lock(mutex);
+			pendingObjects.removeOrFail(moduleKey);
+			if(objectCode && objectCode->size() <= maxBytes)
+			{
+				lruKeys.push_front(moduleKey);
+				Entry& entry = entries.getOrAdd(moduleKey);
+				WAVM_ASSERT(!entry.objectCode);
+				entry.objectCode = objectCode;
+				entry.lruIt = lruKeys.begin();
+				numBytes += objectCode->size();
+				evictToBudget();
+			}
+		}
+
+		pendingObject->objectCode = objectCode;
+		pendingObject->mutex.unlock();
+	}
+
+	void setMaxBytes(Uptr newMaxBytes)
+	{
+		Platform::Mutex::Lock lock(mutex);
+		maxBytes = newMaxBytes;
+		evictToBudget();
+	}
+
+private:
+	// Evicts the least recently used entries until the cache fits in its budget. Entries that are
+	// still referenced by modules stay alive until those modules release them. The mutex must be
+	// locked by the calling thread.
+	void evictToBudget()
+	{
+		while(numBytes > maxBytes)
+		{
+			WAVM_ASSERT(lruKeys.size());
+			const ModuleKey& lruKey = lruKeys.back();
+			const Entry& entry = entries[lruKey];
+			WAVM_ASSERT(numBytes >= entry.objectCode->size());
+			numBytes -= entry.objectCode->size();
+			entries.removeOrFail(lruKey);
+			lruKeys.pop_back();
+		}
+	}
+};
+
+// How often the maintenance thread writes batched access times and checks whether the database
+// needs to be trimmed.
+static constexpr I128 maintenanceIntervalNS = 250 * 1000 * 1000;
+
+// When the object table uses more than the high water fraction of the database, the maintenance
+// thread evicts least recently used objects until it uses less than the low water fraction. This
+// keeps the database from filling up, so adding an object rarely needs to evict objects inline.
+static constexpr F64 evictionHighWaterFraction = 0.85;
+static constexpr F64 evictionLowWaterFraction = 0.7;
+
+// Modules of at least minTreeHashedModuleBytes are hashed as a tree: each chunk of the module is
+// hashed on its own, the chunks are hashed in parallel, and the module's hash is a keyed hash of
+// the chunks' hashes. The key is the number of bytes in the module, which separates tree hashes
+// from the hashes of smaller modules.
+static constexpr Uptr numBytesPerModuleHashChunk = Uptr(4) * 1024 * 1024;
+static constexpr Uptr minTreeHashedModuleBytes = 4 * numBytesPerModuleHashChunk;
+static constexpr Uptr numBytesPerChunkHash = 32;
+
+struct ModuleHashChunks
+{
+	const U8* wasmBytes;
+	Uptr numWASMBytes;
+	Uptr numChunks;
+	std::vector<U8> chunkHashBytes;
+	std::atomic<Uptr> nextChunkIndex{0};
+};
+
+static I64 hashModuleChunksThreadMain(void* chunksVoid)
+{
+	ModuleHashChunks& chunks = *(ModuleHashChunks*)chunksVoid;
+	while(true)
+	{
+		const Uptr chunkIndex = chunks.nextChunkIndex.fetch_add(1, std::memory_order_relaxed);
+		if(chunkIndex >= chunks.numChunks) { return 0; }
+
+		const Uptr chunkOffset = chunkIndex * numBytesPerModuleHashChunk;
+		const Uptr numChunkBytes
+			= std::min(numBytesPerModuleHashChunk, chunks.numWASMBytes - chunkOffset);
+		if(blake2b(chunks.chunkHashBytes.data() + chunkIndex * numBytesPerChunkHash,
+				   numBytesPerChunkHash,
+				   chunks.wasmBytes + chunkOffset,
+				   numChunkBytes,
+				   nullptr,
+				   0))
+		{ Errors::fatal("blake2b error"); }
+	}
+}
+
 // Encapsulates the global state of the object cache.
 struct LMDBObjectCache : Runtime::ObjectCacheInterface
 {
-	OpenResult init(const char* path, Uptr maxBytes, U64 inCodeKey)
+	LMDBObjectCache() {}
+	~LMDBObjectCache()
+	{
+		if(remotePutThread)
+		{
+			shouldExitRemotePutThread.store(true, std::memory_order_release);
+			remotePutEvent.signal();
+			Platform::joinThread(remotePutThread);
+		}
+		if(maintenanceThread)
+		{
+			shouldExitMaintenanceThread.store(true, std::memory_order_release);
+			maintenanceEvent.signal();
+			Platform::joinThread(maintenanceThread);
+		}
+	}
+
+	LMDBObjectCache(const LMDBObjectCache&) = delete;
+	void operator=(const LMDBObjectCache&) = delete;
+
+	OpenResult init(const char* path, Uptr inMaxBytes, U64 inCodeKey)
 	{
 		codeKey = inCodeKey;
+		maxBytes = inMaxBytes;
 
 		// Open the LMDB database.
 		MDB_env* env = nullptr;
@@ -394,6 +648,7 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			metaTable = database->openTable(txn, "meta", MDB_CREATE);
 			lruTable = database->openTable(txn, "lru", MDB_CREATE);
 			versionTable = database->openTable(txn, "version", MDB_CREATE);
+			validatedTable = database->openTable(txn, "validated", MDB_CREATE);
 
 			// Check the object cache version stored in the database.
 			const char versionString[] = "version";
@@ -414,6 +669,7 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 				Database::dropDB(txn, metaTable);
 				Database::dropDB(txn, lruTable);
 				Database::dropDB(txn, versionTable);
+				Database::dropDB(txn, validatedTable);
 			}
 
 			if(writeVersion)
@@ -426,6 +682,8 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			// Commit the initialization transaction.
 			txn.commit();
 
+			maintenanceThread = Platform::createThread(0, maintenanceThreadMain, this);
+
 			return OpenResult::success;
 		}
 		catch(Database::Exception const& exception)
@@ -445,6 +703,130 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		}
 	}
 
+	static void hashModule(const U8* wasmBytes, Uptr numWASMBytes, U8 outModuleHashBytes[16])
+	{
+		Timing::Timer hashTimer;
+
+		if(numWASMBytes < minTreeHashedModuleBytes)
+		{
+			if(blake2b(outModuleHashBytes, 16, wasmBytes, numWASMBytes, nullptr, 0))
+			{ Errors::fatal("blake2b error"); }
+		}
+		else
+		{
+			ModuleHashChunks chunks;
+			chunks.wasmBytes = wasmBytes;
+			chunks.numWASMBytes = numWASMBytes;
+			chunks.numChunks
+				= (numWASMBytes + numBytesPerModuleHashChunk - 1) / numBytesPerModuleHashChunk;
+			chunks.chunkHashBytes.resize(chunks.numChunks * numBytesPerChunkHash);
+
+			// Hash the chunks on this thread, and on up to one other thread per hardware thread.
+			const Uptr numThreads
+				= std::min(chunks.numChunks, Platform::getNumberOfHardwareThreads());
+			std::vector<Platform::Thread*> threads;
+			for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+			{ threads.push_back(Platform::createThread(0, hashModuleChunksThreadMain, &chunks)); }
+			hashModuleChunksThreadMain(&chunks);
+			for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+			const U64 numWASMBytesKey = numWASMBytes;
+			if(blake2b(outModuleHashBytes,
+					   16,
+					   chunks.chunkHashBytes.data(),
+					   chunks.chunkHashBytes.size(),
+					   &numWASMBytesKey,
+					   sizeof(numWASMBytesKey)))
+			{ Errors::fatal("blake2b error"); }
+		}
+
+		Timing::logRatePerSecond(
+			"Hashed module key", hashTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
+	}
+
+	// Returns whether the database contains object code for a module, without reading the object
+	// code or updating its last-used time.
+	bool containsCachedObject(U8 moduleHash[16])
+	{
+		ScopedTxn txn(database->beginTxn(MDB_RDONLY));
+		MDB_val objectBytesVal;
+		return Database::tryGetKeyValue(
+			txn, objectTable, ModuleKey(codeKey, moduleHash), objectBytesVal);
+	}
+
+	void setCompressObjects(bool inCompressObjects)
+	{
+		compressObjects.store(inCompressObjects, std::memory_order_relaxed);
+	}
+
+	// Encodes object code as it is stored in the object table.
+	void encodeStoredObject(const std::vector<U8>& objectBytes, std::vector<U8>& outStoredBytes)
+	{
+		ObjectHeader header;
+		header.numObjectBytes = objectBytes.size();
+		header.isCompressed = 0;
+		if(compressObjects.load(std::memory_order_relaxed))
+		{
+			Timing::Timer compressTimer;
+
+			// Compress the object code after the header, and store it uncompressed if compressing
+			// it didn't make it smaller.
+			std::vector<U8> compressedBytes;
+			compressLZ4(objectBytes.data(), objectBytes.size(), compressedBytes);
+			if(compressedBytes.size() < objectBytes.size())
+			{
+				header.isCompressed = 1;
+				outStoredBytes.resize(sizeof(ObjectHeader) + compressedBytes.size());
+				memcpy(outStoredBytes.data(), &header, sizeof(ObjectHeader));
+				memcpy(outStoredBytes.data() + sizeof(ObjectHeader),
+					   compressedBytes.data(),
+					   compressedBytes.size());
+			}
+
+			Timing::logRatePerSecond(
+				"Compressed object", compressTimer, objectBytes.size() / 1024.0 / 1024.0, "MiB");
+		}
+
+		if(!header.isCompressed)
+		{
+			outStoredBytes.resize(sizeof(ObjectHeader) + objectBytes.size());
+			memcpy(outStoredBytes.data(), &header, sizeof(ObjectHeader));
+			memcpy(outStoredBytes.data() + sizeof(ObjectHeader),
+				   objectBytes.data(),
+				   objectBytes.size());
+		}
+	}
+
+	// Decodes object code stored in the object table, decompressing it directly from the database
+	// mapping into the output buffer. Returns false if the stored object is malformed.
+	static bool decodeStoredObject(const MDB_val& storedBytesVal, std::vector<U8>& outObjectCode)
+	{
+		const U8* storedBytes = (const U8*)storedBytesVal.mv_data;
+		if(storedBytesVal.mv_size < sizeof(ObjectHeader)) { return false; }
+
+		ObjectHeader header;
+		memcpy(&header, storedBytes, sizeof(ObjectHeader));
+		const U8* payloadBytes = storedBytes + sizeof(ObjectHeader);
+		const Uptr numPayloadBytes = storedBytesVal.mv_size - sizeof(ObjectHeader);
+		if(!header.isCompressed)
+		{
+			if(header.numObjectBytes != numPayloadBytes) { return false; }
+			outObjectCode.assign(payloadBytes, payloadBytes + numPayloadBytes);
+			return true;
+		}
+
+		Timing::Timer decompressTimer;
+		outObjectCode.resize(Uptr(header.numObjectBytes));
+		if(!decompressLZ4(
+			   payloadBytes, numPayloadBytes, outObjectCode.data(), outObjectCode.size()))
+		{ return false; }
+		Timing::logRatePerSecond("Decompressed object",
+								 decompressTimer,
+								 outObjectCode.size() / 1024.0 / 1024.0,
+								 "MiB");
+		return true;
+	}
+
 	bool tryGetCachedObject(U8 moduleHash[16],
 							const U8* wasmBytes,
 							Uptr numWASMBytes,
@@ -452,20 +834,21 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 	{
 		Timing::Timer readTimer;
 
-		ScopedTxn txn(database->beginTxn());
+		ScopedTxn txn(database->beginTxn(MDB_RDONLY));
 
-		// Check for a cached module with this hash key.
+		// Check for a cached module with this hash key. If the stored object is malformed, treat it
+		// as a miss, so the module is compiled and the stored object replaced.
 		bool hadCachedObject = false;
 		ModuleKey moduleKey(codeKey, moduleHash);
-		if(Database::tryGetKeyValue(txn, objectTable, moduleKey, outObjectCode))
+		MDB_val storedBytesVal;
+		if(Database::tryGetKeyValue(txn, objectTable, moduleKey, storedBytesVal)
+		   && decodeStoredObject(storedBytesVal, outObjectCode))
 		{
-			// Update the last-used time for the cached module.
-			Metadata metadata;
-			Database::getKeyValue(txn, metaTable, moduleKey, metadata);
-			Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey);
-			metadata.lastAccessTimeKey = Platform::getClockTime(Platform::Clock::realtime);
-			Database::putKeyValue(txn, metaTable, moduleKey, metadata);
-			Database::putKeyValue(txn, lruTable, metadata.lastAccessTimeKey, moduleKey);
+			// Queue an update of the last-used time for the cached module, so the lookup doesn't
+			// need a write transaction. The maintenance thread writes the queued updates in
+			// batches.
+			Platform::Mutex::Lock pendingAccessTimesLock(pendingAccessTimesMutex);
+			pendingAccessTimes.set(moduleKey, Platform::getClockTime(Platform::Clock::realtime));
 
 			hadCachedObject = true;
 		}
@@ -488,12 +871,16 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		Time now = Platform::getClockTime(Platform::Clock::realtime);
 		ModuleKey moduleKey(codeKey, moduleHash);
 
+		std::vector<U8> storedBytes;
+		encodeStoredObject(objectBytes, storedBytes);
+
 		// Try to add the module to the database.
 		bool firstTry = true;
 		while(true)
 		{
 			// If a previous try failed due to the database being full, try to evict the least
-			// recently used cached object.
+			// recently used cached object. The maintenance thread usually keeps enough free space
+			// in the database that this isn't necessary.
 			if(!firstTry)
 			{
 				if(!evictLRU())
@@ -514,21 +901,94 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 			Metadata metadata;
 			if(Database::tryGetKeyValue(txn, metaTable, moduleKey, metadata))
 			{ Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey); }
-			metadata.lastAccessTimeKey = now;
+			metadata.lastAccessTimeKey = getUnusedLRUTimeKey(txn, now);
 
 			// Add the module to the object, metadata, and LRU tables.
 			if(Database::tryPutKeyValue(txn, metaTable, moduleKey, metadata)
 			   && Database::tryPutKeyValue(txn, lruTable, metadata.lastAccessTimeKey, moduleKey)
-			   && Database::tryPutKeyValue(txn, objectTable, moduleKey, objectBytes))
+			   && Database::tryPutKeyValue(txn, objectTable, moduleKey, storedBytes))
 			{
 				txn.commit();
 				break;
 			}
 		};
 
+		// Let the maintenance thread check whether the database needs to be trimmed.
+		hasAddedObjects.store(true, std::memory_order_release);
+
 		Timing::logTimer("Add object to cache", writeTimer);
 	}
 
+	void setRemoteStore(std::shared_ptr<RemoteObjectStore>&& inRemoteStore)
+	{
+		WAVM_ERROR_UNLESS(!remoteStore);
+		remoteStore = std::move(inRemoteStore);
+		remotePutThread = Platform::createThread(0, remotePutThreadMain, this);
+	}
+
+	// Tries to get a module's object code from the remote store, and adds it to the database if
+	// it's found.
+	bool tryGetRemoteObject(U8 moduleHash[16],
+							const U8* wasmBytes,
+							Uptr numWASMBytes,
+							std::vector<U8>& outObjectCode)
+	{
+		if(!remoteStore) { return false; }
+
+		Timing::Timer getTimer;
+
+		const ModuleKey moduleKey(codeKey, moduleHash);
+		const std::string remoteKey = getRemoteKey(moduleKey);
+		std::vector<U8> remoteBytes;
+		if(!remoteStore->get(remoteKey, remoteBytes)) { return false; }
+
+		// Check the object code against the digest stored in front of it.
+		bool isIntact = remoteBytes.size() >= remoteDigestBytes;
+		if(isIntact)
+		{
+			U8 digest[remoteDigestBytes];
+			digestRemoteObject(moduleKey,
+							   remoteBytes.data() + remoteDigestBytes,
+							   remoteBytes.size() - remoteDigestBytes,
+							   digest);
+			isIntact = !memcmp(digest, remoteBytes.data(), remoteDigestBytes);
+		}
+		if(!isIntact)
+		{
+			Log::printf(Log::error,
+						"Object %s in the remote object store failed the integrity check.\n",
+						remoteKey.c_str());
+			return false;
+		}
+		outObjectCode.assign(remoteBytes.begin() + remoteDigestBytes, remoteBytes.end());
+
+		Timing::logTimer("Got object from remote store", getTimer);
+
+		try
+		{
+			addCachedObject(moduleHash, wasmBytes, numWASMBytes, outObjectCode);
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to add module to object cache: %s\n",
+						Database::Exception::getMessage(exception.type));
+		}
+
+		return true;
+	}
+
+	// Queues a put of a module's object code to the remote store on the remote put thread.
+	void queueRemotePut(U8 moduleHash[16], std::shared_ptr<const std::vector<U8>> objectCode)
+	{
+		if(!remoteStore) { return; }
+		{
+			Platform::Mutex::Lock pendingRemotePutsLock(pendingRemotePutsMutex);
+			pendingRemotePuts.push_back({ModuleKey(codeKey, moduleHash), std::move(objectCode)});
+		}
+		remotePutEvent.signal();
+	}
+
 	void dump()
 	{
 		const Time now = Platform::getClockTime(Platform::Clock::realtime);
@@ -609,42 +1069,147 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 		}
 	}
 
-	virtual std::vector<U8> getCachedObject(
+	// Returns the hash of a module's key, computing it if the caller hasn't already passed it to
+	// another of the cache's methods.
+	static U8* getModuleHash(const U8* wasmBytes,
+							 Uptr numWASMBytes,
+							 Runtime::ObjectCacheKeyHash& keyHash)
+	{
+		if(!keyHash.isComputed)
+		{
+			hashModule(wasmBytes, numWASMBytes, keyHash.bytes);
+			keyHash.isComputed = true;
+		}
+		return keyHash.bytes;
+	}
+
+	virtual std::shared_ptr<const std::vector<U8>> getCachedObject(
 		const U8* wasmBytes,
 		Uptr numWASMBytes,
+		Runtime::ObjectCacheKeyHash& keyHash,
 		std::function<std::vector<U8>()>&& compileThunk) override
 	{
-		// Compute a hash of the serialized WASM module.
-		Timing::Timer hashTimer;
+		Trace::Scope traceScope("cache", "lookup");
+		Timing::Timer lookupTimer;
+
+		// Get the hash of the serialized WASM module.
+		U8* moduleHashBytes = getModuleHash(wasmBytes, numWASMBytes, keyHash);
+
+		// Check the in-memory cache, or wait for another thread that is already producing the
+		// module's object code.
+		MemoryObjectCache& memoryObjectCache = MemoryObjectCache::get();
+		const ModuleKey moduleKey(codeKey, moduleHashBytes);
+		std::shared_ptr<MemoryObjectCache::PendingObject> pendingObject;
+		if(std::shared_ptr<const std::vector<U8>> sharedObjectCode
+		   = memoryObjectCache.getOrBeginPending(moduleKey, pendingObject))
+		{
+			++numMemoryHits;
+			numHitsMetric.add();
+			addLookupTime(totalHitNanoseconds, maxHitNanoseconds, lookupTimer);
+			return sharedObjectCode;
+		}
 
-		U8 moduleHashBytes[16];
-		if(blake2b(moduleHashBytes, sizeof(moduleHashBytes), wasmBytes, numWASMBytes, nullptr, 0))
-		{ Errors::fatal("blake2b error"); }
+		std::shared_ptr<const std::vector<U8>> sharedObjectCode;
+		try
+		{
+			bool wasInDatabase = false;
+			bool wasInRemoteStore = false;
+			sharedObjectCode = getOrCompileObject(moduleHashBytes,
+												  wasmBytes,
+												  numWASMBytes,
+												  std::move(compileThunk),
+												  wasInDatabase,
+												  wasInRemoteStore);
+			if(wasInDatabase || wasInRemoteStore)
+			{
+				++(wasInDatabase ? numDatabaseHits : numRemoteHits);
+				numHitsMetric.add();
+				addLookupTime(totalHitNanoseconds, maxHitNanoseconds, lookupTimer);
+			}
+			else
+			{
+				++numMisses;
+				numMissesMetric.add();
+				addLookupTime(totalMissNanoseconds, maxMissNanoseconds, lookupTimer);
+			}
+		}
+		catch(...)
+		{
+			// Let any waiting threads try to produce the object code themselves.
+			memoryObjectCache.finishPendingObject(moduleKey, pendingObject, nullptr);
+			throw;
+		}
 
-		Timing::logRatePerSecond(
-			"Hashed module key", hashTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
+		memoryObjectCache.finishPendingObject(moduleKey, pendingObject, sharedObjectCode);
+		return sharedObjectCode;
+	}
 
-		// Try to find the module's object code in the cache.
-		std::vector<U8> objectCode;
+	// Returns the key of a module in the validated table. Whether a module is valid depends on the
+	// feature spec and on the version of the validator, which the code key identifies.
+	ModuleKey getValidatedModuleKey(const U8* wasmBytes,
+									Uptr numWASMBytes,
+									Runtime::ObjectCacheKeyHash& keyHash,
+									const IR::FeatureSpec& featureSpec)
+	{
+		U64 validationKey = codeKey;
+#define VISIT_FEATURE(name, ...) validationKey = Hash<U64>()(U64(featureSpec.name), validationKey);
+		WAVM_ENUM_FEATURES(VISIT_FEATURE)
+#undef VISIT_FEATURE
+		validationKey = Hash<U64>()(U64(featureSpec.maxLocals), validationKey);
+		validationKey = Hash<U64>()(U64(featureSpec.maxLabelsPerFunction), validationKey);
+		validationKey = Hash<U64>()(U64(featureSpec.maxDataSegments), validationKey);
+		validationKey = Hash<U64>()(U64(featureSpec.maxSyntaxRecursion), validationKey);
+
+		return ModuleKey(validationKey, getModuleHash(wasmBytes, numWASMBytes, keyHash));
+	}
+
+	virtual bool isValidatedModule(const U8* wasmBytes,
+								   Uptr numWASMBytes,
+								   Runtime::ObjectCacheKeyHash& keyHash,
+								   const IR::FeatureSpec& featureSpec) override
+	{
+		const ModuleKey validatedModuleKey
+			= getValidatedModuleKey(wasmBytes, numWASMBytes, keyHash, featureSpec);
 		try
 		{
-			if(tryGetCachedObject(moduleHashBytes, wasmBytes, numWASMBytes, objectCode))
-			{ return objectCode; }
+			ScopedTxn txn(database->beginTxn(MDB_RDONLY));
+			U8 isValid = 0;
+			const bool wasValidated
+				= Database::tryGetKeyValue(txn, validatedTable, validatedModuleKey, isValid);
+			txn.commit();
+			return wasValidated && isValid;
 		}
 		catch(Database::Exception const& exception)
 		{
 			Log::printf(Log::error,
 						"Failed to lookup module in object cache: %s\n",
 						Database::Exception::getMessage(exception.type));
+			return false;
 		}
+	}
 
-		// If there wasn't a matching cached module+object code, compile the module.
-		objectCode = compileThunk();
-
-		// Add the cached module+object code to the database.
+	virtual void addValidatedModule(const U8* wasmBytes,
+									Uptr numWASMBytes,
+									Runtime::ObjectCacheKeyHash& keyHash,
+									const IR::FeatureSpec& featureSpec) override
+	{
+		const ModuleKey validatedModuleKey
+			= getValidatedModuleKey(wasmBytes, numWASMBytes, keyHash, featureSpec);
 		try
 		{
-			addCachedObject(moduleHashBytes, wasmBytes, numWASMBytes, objectCode);
+			ScopedTxn txn(database->beginTxn());
+
+			// The validated table isn't trimmed with the object table, since its entries are
+			// small. If the database is full, forget the validated modules instead of evicting
+			// objects to make room.
+			const U8 isValid = 1;
+			if(!Database::tryPutKeyValue(txn, validatedTable, validatedModuleKey, isValid))
+			{
+				Database::dropDB(txn, validatedTable);
+				if(!Database::tryPutKeyValue(txn, validatedTable, validatedModuleKey, isValid))
+				{ return; }
+			}
+			txn.commit();
 		}
 		catch(Database::Exception const& exception)
 		{
@@ -652,8 +1217,21 @@ struct LMDBObjectCache : Runtime::ObjectCacheInterface
 						"Failed to add module to object cache: %s\n",
 						Database::Exception::getMessage(exception.type));
 		}
+	}
 
-		return objectCode;
+	virtual Runtime::ObjectCacheStats getStats() override
+	{
+		Runtime::ObjectCacheStats stats;
+		stats.numMemoryHits = numMemoryHits.load(std::memory_order_relaxed);
+		stats.numDatabaseHits = numDatabaseHits.load(std::memory_order_relaxed);
+		stats.numRemoteHits = numRemoteHits.load(std::memory_order_relaxed);
+		stats.numMisses = numMisses.load(std::memory_order_relaxed);
+		stats.numEvictions = numEvictions.load(std::memory_order_relaxed);
+		stats.totalHitNanoseconds = totalHitNanoseconds.load(std::memory_order_relaxed);
+		stats.maxHitNanoseconds = maxHitNanoseconds.load(std::memory_order_relaxed);
+		stats.totalMissNanoseconds = totalMissNanoseconds.load(std::memory_order_relaxed);
+		stats.maxMissNanoseconds = maxMissNanoseconds.load(std::memory_order_relaxed);
+		return stats;
 	}
 
 private:
@@ -662,27 +1240,187 @@ private:
 	MDB_dbi metaTable;
 	MDB_dbi lruTable;
 	MDB_dbi versionTable;
+	MDB_dbi validatedTable;
 	U64 codeKey{0};
+	Uptr maxBytes{0};
+	std::atomic<bool> compressObjects{false};
+
+	// Last-used times of cached objects that were read from the database, but haven't been
+	// written to the metadata and LRU tables yet.
+	Platform::Mutex pendingAccessTimesMutex;
+	HashMap<ModuleKey, Time> pendingAccessTimes;
+
+	// A thread that writes the pending access times to the database, and evicts objects when the
+	// database is nearly full, so lookups and adds don't have to.
+	Platform::Thread* maintenanceThread = nullptr;
+	Platform::Event maintenanceEvent;
+	std::atomic<bool> shouldExitMaintenanceThread{false};
+	std::atomic<bool> hasAddedObjects{true};
+
+	// The remote store, and a thread that puts compiled object code in it, so compiling doesn't
+	// wait for the put.
+	struct PendingRemotePut
+	{
+		ModuleKey moduleKey;
+		std::shared_ptr<const std::vector<U8>> objectCode;
+	};
+	std::shared_ptr<RemoteObjectStore> remoteStore;
+	Platform::Mutex pendingRemotePutsMutex;
+	std::deque<PendingRemotePut> pendingRemotePuts;
+	Platform::Thread* remotePutThread = nullptr;
+	Platform::Event remotePutEvent;
+	std::atomic<bool> shouldExitRemotePutThread{false};
+
+	// Objects in the remote store are preceded by a digest of the object code, which is keyed with
+	// the module key so an object put under a different key also fails the integrity check.
+	static constexpr Uptr remoteDigestBytes = 32;
+
+	static void digestRemoteObject(const ModuleKey& moduleKey,
+								   const U8* objectBytes,
+								   Uptr numObjectBytes,
+								   U8 outDigest[remoteDigestBytes])
+	{
+		if(blake2b(outDigest,
+				   remoteDigestBytes,
+				   objectBytes,
+				   numObjectBytes,
+				   &moduleKey,
+				   sizeof(ModuleKey)))
+		{ Errors::fatal("blake2b error"); }
+	}
 
-	bool evictLRU()
+	static std::string getRemoteKey(const ModuleKey& moduleKey)
 	{
-		ScopedTxn txn(database->beginTxn());
+		char remoteKey[49];
+		snprintf(remoteKey,
+				 sizeof(remoteKey),
+				 "%016" PRIx64 "%016" PRIx64 "%016" PRIx64,
+				 moduleKey.getCodeKey(),
+				 moduleKey.moduleHashU64s[0],
+				 moduleKey.moduleHashU64s[1]);
+		return remoteKey;
+	}
 
+	std::atomic<U64> numMemoryHits{0};
+	std::atomic<U64> numDatabaseHits{0};
+	std::atomic<U64> numRemoteHits{0};
+	std::atomic<U64> numMisses{0};
+	std::atomic<U64> numEvictions{0};
+
+	// The hits and misses of all object caches, for monitoring the hit rate.
+	Metrics::Counter& numHitsMetric
+		= Metrics::getCounter("wavm_object_cache_hits_total", "Object cache hits");
+	Metrics::Counter& numMissesMetric
+		= Metrics::getCounter("wavm_object_cache_misses_total", "Object cache misses");
+
+	std::atomic<U64> totalHitNanoseconds{0};
+	std::atomic<U64> maxHitNanoseconds{0};
+	std::atomic<U64> totalMissNanoseconds{0};
+	std::atomic<U64> maxMissNanoseconds{0};
+
+	static void addLookupTime(std::atomic<U64>& totalNanoseconds,
+							  std::atomic<U64>& maxNanoseconds,
+							  Timing::Timer& timer)
+	{
+		const U64 nanoseconds = U64(timer.getNanoseconds());
+		totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+		U64 previousMax = maxNanoseconds.load(std::memory_order_relaxed);
+		while(previousMax < nanoseconds
+			  && !maxNanoseconds.compare_exchange_weak(
+				  previousMax, nanoseconds, std::memory_order_relaxed))
+		{
+		};
+	}
+
+	std::shared_ptr<const std::vector<U8>> getOrCompileObject(
+		U8 moduleHashBytes[16],
+		const U8* wasmBytes,
+		Uptr numWASMBytes,
+		std::function<std::vector<U8>()>&& compileThunk,
+		bool& outWasInDatabase,
+		bool& outWasInRemoteStore)
+	{
+		// Try to find the module's object code in the database.
+		std::vector<U8> objectCode;
+		try
+		{
+			if(tryGetCachedObject(moduleHashBytes, wasmBytes, numWASMBytes, objectCode))
+			{
+				outWasInDatabase = true;
+				return std::make_shared<const std::vector<U8>>(std::move(objectCode));
+			}
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to lookup module in object cache: %s\n",
+						Database::Exception::getMessage(exception.type));
+		}
+
+		// If the database didn't contain the module's object code, look for it in the remote
+		// store.
+		if(tryGetRemoteObject(moduleHashBytes, wasmBytes, numWASMBytes, objectCode))
+		{
+			outWasInRemoteStore = true;
+			return std::make_shared<const std::vector<U8>>(std::move(objectCode));
+		}
+
+		// If there wasn't a matching cached module+object code, compile the module.
+		objectCode = compileThunk();
+
+		// Add the cached module+object code to the database.
+		try
+		{
+			addCachedObject(moduleHashBytes, wasmBytes, numWASMBytes, objectCode);
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to add module to object cache: %s\n",
+						Database::Exception::getMessage(exception.type));
+		}
+
+		std::shared_ptr<const std::vector<U8>> sharedObjectCode
+			= std::make_shared<const std::vector<U8>>(std::move(objectCode));
+		queueRemotePut(moduleHashBytes, sharedObjectCode);
+		return sharedObjectCode;
+	}
+
+	// Returns a key for the LRU table at or just after the given time that isn't used by another
+	// entry in the table.
+	TimeKey getUnusedLRUTimeKey(MDB_txn* txn, Time time)
+	{
+		ModuleKey existingModuleKey;
+		while(Database::tryGetKeyValue(txn, lruTable, TimeKey(time), existingModuleKey))
+		{ time.ns = time.ns + 1; }
+		return TimeKey(time);
+	}
+
+	// Evicts the least recently used object within a write transaction. Returns false if there are
+	// no objects to evict.
+	bool evictLRU(MDB_txn* txn)
+	{
 		// Try to read the oldest entry in the LRU table.
 		TimeKey lastAccessTimeKey;
 		ModuleKey moduleKey;
 		MDB_cursor* cursor = Database::openCursor(txn, lruTable);
-		if(!Database::tryGetCursor(cursor, lastAccessTimeKey, moduleKey, MDB_FIRST))
-		{ return false; }
+		const bool hasOldestEntry
+			= Database::tryGetCursor(cursor, lastAccessTimeKey, moduleKey, MDB_FIRST);
 		Database::closeCursor(cursor);
+		if(!hasOldestEntry) { return false; }
 
 		// Delete the cached object identified by the oldest entry in the LRU table from all tables.
 		Database::deleteKey(txn, objectTable, moduleKey);
 		Database::deleteKey(txn, metaTable, moduleKey);
 		Database::deleteKey(txn, lruTable, lastAccessTimeKey);
 
-		// Commit the delete.
-		txn.commit();
+		// Drop any pending access time update for the object.
+		{
+			Platform::Mutex::Lock pendingAccessTimesLock(pendingAccessTimesMutex);
+			pendingAccessTimes.remove(moduleKey);
+		}
+
+		++numEvictions;
 
 		Log::printf(Log::debug,
 					"Evicted %16" PRIx64 "%16" PRIx64 " from the object cache.\n",
@@ -691,16 +1429,325 @@ private:
 
 		return true;
 	}
+
+	bool evictLRU()
+	{
+		ScopedTxn txn(database->beginTxn());
+		if(!evictLRU(txn)) { return false; }
+		txn.commit();
+		return true;
+	}
+
+	// Writes the pending access times to the metadata and LRU tables in a single transaction.
+	void writePendingAccessTimes()
+	{
+		HashMap<ModuleKey, Time> accessTimes;
+		{
+			Platform::Mutex::Lock pendingAccessTimesLock(pendingAccessTimesMutex);
+			if(!pendingAccessTimes.size()) { return; }
+			accessTimes = std::move(pendingAccessTimes);
+			pendingAccessTimes.clear();
+		}
+
+		ScopedTxn txn(database->beginTxn());
+		for(const auto& pair : accessTimes)
+		{
+			// The object may have been evicted since it was accessed.
+			Metadata metadata;
+			if(!Database::tryGetKeyValue(txn, metaTable, pair.key, metadata)) { continue; }
+
+			Database::deleteKey(txn, lruTable, metadata.lastAccessTimeKey);
+			metadata.lastAccessTimeKey = getUnusedLRUTimeKey(txn, pair.value);
+			Database::putKeyValue(txn, metaTable, pair.key, metadata);
+			Database::putKeyValue(txn, lruTable, metadata.lastAccessTimeKey, pair.key);
+		}
+		txn.commit();
+	}
+
+	// If the cached objects use more than the high water fraction of the database, evicts the
+	// least recently used objects until they use less than the low water fraction.
+	void trimDatabase()
+	{
+		const Uptr pageSize = database->getPageSize();
+		auto getNumUsedBytes = [&](MDB_txn* txn) {
+			return pageSize
+				   * (Database::getNumTablePages(txn, objectTable)
+					  + Database::getNumTablePages(txn, metaTable)
+					  + Database::getNumTablePages(txn, lruTable));
+		};
+
+		{
+			ScopedTxn readTxn(database->beginTxn(MDB_RDONLY));
+			if(F64(getNumUsedBytes(readTxn)) <= F64(maxBytes) * evictionHighWaterFraction)
+			{ return; }
+		}
+
+		ScopedTxn txn(database->beginTxn());
+		while(F64(getNumUsedBytes(txn)) > F64(maxBytes) * evictionLowWaterFraction)
+		{
+			if(!evictLRU(txn)) { break; }
+		};
+		txn.commit();
+	}
+
+	static I64 remotePutThreadMain(void* cacheVoid)
+	{
+		LMDBObjectCache* cache = (LMDBObjectCache*)cacheVoid;
+		while(true)
+		{
+			std::deque<PendingRemotePut> puts;
+			{
+				Platform::Mutex::Lock pendingRemotePutsLock(cache->pendingRemotePutsMutex);
+				puts = std::move(cache->pendingRemotePuts);
+				cache->pendingRemotePuts.clear();
+			}
+
+			// Finish the queued puts before exiting.
+			if(!puts.size())
+			{
+				if(cache->shouldExitRemotePutThread.load(std::memory_order_acquire)) { return 0; }
+				cache->remotePutEvent.wait(Time::infinity());
+				continue;
+			}
+
+			for(const PendingRemotePut& put : puts)
+			{
+				Timing::Timer putTimer;
+
+				std::vector<U8> remoteBytes(remoteDigestBytes + put.objectCode->size());
+				digestRemoteObject(put.moduleKey,
+								   put.objectCode->data(),
+								   put.objectCode->size(),
+								   remoteBytes.data());
+				memcpy(remoteBytes.data() + remoteDigestBytes,
+					   put.objectCode->data(),
+					   put.objectCode->size());
+				cache->remoteStore->put(getRemoteKey(put.moduleKey), remoteBytes);
+
+				Timing::logTimer("Put object in remote store", putTimer);
+			}
+		}
+	}
+
+	static I64 maintenanceThreadMain(void* cacheVoid)
+	{
+		LMDBObjectCache* cache = (LMDBObjectCache*)cacheVoid;
+		while(true)
+		{
+			const bool shouldExit
+				= cache->shouldExitMaintenanceThread.load(std::memory_order_acquire);
+			if(!shouldExit) { cache->maintenanceEvent.wait(Time{maintenanceIntervalNS}); }
+
+			try
+			{
+				cache->writePendingAccessTimes();
+				if(cache->hasAddedObjects.exchange(false, std::memory_order_acq_rel))
+				{ cache->trimDatabase(); }
+			}
+			catch(Database::Exception const& exception)
+			{
+				Log::printf(Log::error,
+							"Failed to update object cache: %s\n",
+							Database::Exception::getMessage(exception.type));
+			}
+
+			if(shouldExit) { return 0; }
+		}
+	}
 };
 
+void ObjectCache::setMaxMemoryBytes(Uptr maxBytes)
+{
+	MemoryObjectCache::get().setMaxBytes(maxBytes);
+}
+
 OpenResult ObjectCache::open(const char* path,
 							 Uptr maxBytes,
 							 U64 codeKey,
 							 std::shared_ptr<Runtime::ObjectCacheInterface>& outObjectCache)
 {
-	LMDBObjectCache lmdbObjectCache;
-	OpenResult result = lmdbObjectCache.init(path, maxBytes, codeKey);
-	if(result == OpenResult::success)
-	{ outObjectCache = std::make_shared<LMDBObjectCache>(std::move(lmdbObjectCache)); }
+	std::shared_ptr<LMDBObjectCache> lmdbObjectCache = std::make_shared<LMDBObjectCache>();
+	OpenResult result = lmdbObjectCache->init(path, maxBytes, codeKey);
+	if(result == OpenResult::success) { outObjectCache = std::move(lmdbObjectCache); }
 	return result;
 }
+
+void ObjectCache::setCompressObjects(
+	const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+	bool compressObjects)
+{
+	std::static_pointer_cast<LMDBObjectCache>(objectCache)->setCompressObjects(compressObjects);
+}
+
+void ObjectCache::setRemoteObjectStore(
+	const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+	std::shared_ptr<RemoteObjectStore>&& remoteStore)
+{
+	std::static_pointer_cast<LMDBObjectCache>(objectCache)->setRemoteStore(std::move(remoteStore));
+}
+
+struct ObjectCache::PrecompileJob
+{
+	std::shared_ptr<LMDBObjectCache> objectCache;
+	std::vector<PrecompileModule> modules;
+	PrecompileFunction precompileFunction;
+	std::function<void(const PrecompileResult&)> onModuleFinished;
+
+	// The indices of the modules in the order they are compiled: by descending priority, and in
+	// their original order within a priority.
+	std::vector<Uptr> moduleOrder;
+
+	Platform::Mutex mutex;
+	Uptr nextOrderIndex = 0;
+	PrecompileProgress progress;
+
+	Platform::Mutex threadsMutex;
+	std::vector<Platform::Thread*> threads;
+
+	~PrecompileJob() { joinThreads(); }
+
+	void joinThreads()
+	{
+		Platform::Mutex::Lock threadsLock(threadsMutex);
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+		threads.clear();
+	}
+
+	static I64 threadMain(void* jobVoid)
+	{
+		PrecompileJob* job = (PrecompileJob*)jobVoid;
+		while(true)
+		{
+			Uptr moduleIndex;
+			{
+				Platform::Mutex::Lock lock(job->mutex);
+				if(job->nextOrderIndex == job->moduleOrder.size()) { break; }
+				moduleIndex = job->moduleOrder[job->nextOrderIndex++];
+			}
+
+			const PrecompileResult result = job->precompileModule(moduleIndex);
+			{
+				Platform::Mutex::Lock lock(job->mutex);
+				if(result.wasAlreadyCached) { ++job->progress.numAlreadyCached; }
+				else if(result.succeeded)
+				{
+					++job->progress.numCompiled;
+				}
+				else
+				{
+					++job->progress.numFailed;
+				}
+			}
+			if(job->onModuleFinished) { job->onModuleFinished(result); }
+		}
+		return 0;
+	}
+
+	PrecompileResult precompileModule(Uptr moduleIndex)
+	{
+		PrecompileResult result;
+		result.moduleIndex = moduleIndex;
+		result.wasAlreadyCached = false;
+		result.succeeded = false;
+		result.compileMilliseconds = 0.0;
+
+		// Release the module's WASM bytes once it's done.
+		std::vector<U8> wasmBytes = std::move(modules[moduleIndex].wasmBytes);
+
+		U8 moduleHashBytes[16];
+		LMDBObjectCache::hashModule(wasmBytes.data(), wasmBytes.size(), moduleHashBytes);
+		try
+		{
+			if(objectCache->containsCachedObject(moduleHashBytes))
+			{
+				result.wasAlreadyCached = true;
+				result.succeeded = true;
+				return result;
+			}
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to lookup module in object cache: %s\n",
+						Database::Exception::getMessage(exception.type));
+		}
+
+		std::vector<U8> objectCode;
+		if(objectCache->tryGetRemoteObject(
+			   moduleHashBytes, wasmBytes.data(), wasmBytes.size(), objectCode))
+		{
+			result.wasAlreadyCached = true;
+			result.succeeded = true;
+			return result;
+		}
+
+		Timing::Timer compileTimer;
+		result.succeeded = precompileFunction(wasmBytes.data(), wasmBytes.size(), objectCode);
+		result.compileMilliseconds = compileTimer.getMilliseconds();
+		if(!result.succeeded) { return result; }
+
+		try
+		{
+			objectCache->addCachedObject(
+				moduleHashBytes, wasmBytes.data(), wasmBytes.size(), objectCode);
+			objectCache->queueRemotePut(
+				moduleHashBytes, std::make_shared<const std::vector<U8>>(std::move(objectCode)));
+		}
+		catch(Database::Exception const& exception)
+		{
+			Log::printf(Log::error,
+						"Failed to add module to object cache: %s\n",
+						Database::Exception::getMessage(exception.type));
+			result.succeeded = false;
+		}
+
+		return result;
+	}
+};
+
+std::shared_ptr<PrecompileJob> ObjectCache::precompileAsync(
+	const std::shared_ptr<Runtime::ObjectCacheInterface>& objectCache,
+	std::vector<PrecompileModule>&& modules,
+	PrecompileFunction&& precompileFunction,
+	Uptr maxConcurrentCompiles,
+	std::function<void(const PrecompileResult&)>&& onModuleFinished)
+{
+	WAVM_ERROR_UNLESS(maxConcurrentCompiles > 0);
+
+	std::shared_ptr<PrecompileJob> job = std::make_shared<PrecompileJob>();
+	job->objectCache = std::static_pointer_cast<LMDBObjectCache>(objectCache);
+	job->modules = std::move(modules);
+	job->precompileFunction = std::move(precompileFunction);
+	job->onModuleFinished = std::move(onModuleFinished);
+	job->progress.numModules = job->modules.size();
+
+	job->moduleOrder.resize(job->modules.size());
+	for(Uptr moduleIndex = 0; moduleIndex < job->modules.size(); ++moduleIndex)
+	{ job->moduleOrder[moduleIndex] = moduleIndex; }
+	std::stable_sort(job->moduleOrder.begin(), job->moduleOrder.end(), [&job](Uptr a, Uptr b) {
+		return job->modules[a].priority > job->modules[b].priority;
+	});
+
+	// Compiling a module may use a lot of stack, so give the threads large stacks.
+	const Uptr numThreads = std::min(maxConcurrentCompiles, job->modules.size());
+	Platform::Mutex::Lock threadsLock(job->threadsMutex);
+	for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+	{
+		job->threads.push_back(
+			Platform::createThread(8 * 1024 * 1024, PrecompileJob::threadMain, job.get()));
+	}
+
+	return job;
+}
+
+PrecompileProgress ObjectCache::getPrecompileProgress(const std::shared_ptr<PrecompileJob>& job)
+{
+	Platform::Mutex::Lock lock(job->mutex);
+	return job->progress;
+}
+
+PrecompileProgress ObjectCache::waitForPrecompile(const std::shared_ptr<PrecompileJob>& job)
+{
+	job->joinThreads();
+	return getPrecompileProgress(job);
+}
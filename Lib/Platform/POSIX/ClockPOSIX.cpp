@@ -82,6 +82,13 @@ Time Platform::getClockTime(Clock clock)
 		struct rusage ru;
 		WAVM_ERROR_UNLESS(!getrusage(RUSAGE_SELF, &ru));
 		return Time{timevalToNS(ru.ru_stime) + timevalToNS(ru.ru_utime)};
+#endif
+	}
+	case Clock::threadCPUTime: {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+		return Time{getClockAsI128(CLOCK_THREAD_CPUTIME_ID)};
+#else
+		return getClockTime(Clock::processCPUTime);
 #endif
 	}
 	default: WAVM_UNREACHABLE();
@@ -107,8 +114,37 @@ Time Platform::getClockResolution(Clock clock)
 		return Time{getClockResAsI128(CLOCK_PROCESS_CPUTIME_ID)};
 #else
 		return Time{1000};
+#endif
+	}
+	case Clock::threadCPUTime: {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+		return Time{getClockResAsI128(CLOCK_THREAD_CPUTIME_ID)};
+#else
+		return getClockResolution(Clock::processCPUTime);
 #endif
 	}
 	default: WAVM_UNREACHABLE();
 	}
 }
+
+Time Platform::getCoarseClockTime(Clock clock)
+{
+#ifdef CLOCK_REALTIME_COARSE
+	if(clock == Clock::realtime) { return Time{getClockAsI128(CLOCK_REALTIME_COARSE)}; }
+#endif
+#if !defined(__APPLE__) && defined(CLOCK_MONOTONIC_COARSE)
+	if(clock == Clock::monotonic) { return Time{getClockAsI128(CLOCK_MONOTONIC_COARSE)}; }
+#endif
+	return getClockTime(clock);
+}
+
+Time Platform::getCoarseClockResolution(Clock clock)
+{
+#ifdef CLOCK_REALTIME_COARSE
+	if(clock == Clock::realtime) { return Time{getClockResAsI128(CLOCK_REALTIME_COARSE)}; }
+#endif
+#if !defined(__APPLE__) && defined(CLOCK_MONOTONIC_COARSE)
+	if(clock == Clock::monotonic) { return Time{getClockResAsI128(CLOCK_MONOTONIC_COARSE)}; }
+#endif
+	return getClockResolution(clock);
+}
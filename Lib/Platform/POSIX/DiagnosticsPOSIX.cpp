@@ -1,11 +1,21 @@
 #include <cxxabi.h>
 #include <dlfcn.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <atomic>
 #include <string>
 #include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
+#include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Mutex.h"
+
+#if defined(__linux__)
+#include <elf.h>
+#include <sys/syscall.h>
+#endif
 
 #if WAVM_ENABLE_UNWIND
 #define UNW_LOCAL_ONLY
@@ -112,3 +122,233 @@ void Platform::printMemoryProfile()
 void Platform::registerVirtualAllocation(Uptr numBytes) { numCommittedPageBytes += numBytes; }
 
 void Platform::deregisterVirtualAllocation(Uptr numBytes) { numCommittedPageBytes -= numBytes; }
+
+#if defined(__linux__)
+// The jitdump format is described in tools/perf/Documentation/jitdump-specification.txt in the
+// Linux source tree.
+enum : U32
+{
+	jitdumpMagic = 0x4A695444,
+	jitdumpVersion = 1,
+
+	jitdumpCodeLoadRecordId = 0,
+	jitdumpCodeDebugInfoRecordId = 2,
+};
+
+struct JitdumpHeader
+{
+	U32 magic;
+	U32 version;
+	U32 numHeaderBytes;
+	U32 elfMachine;
+	U32 padding;
+	U32 pid;
+	U64 timestamp;
+	U64 flags;
+};
+
+struct JitdumpRecordHeader
+{
+	U32 id;
+	U32 numRecordBytes;
+	U64 timestamp;
+};
+
+struct JitdumpCodeLoadRecord
+{
+	JitdumpRecordHeader header;
+	U32 pid;
+	U32 tid;
+	U64 virtualAddress;
+	U64 codeAddress;
+	U64 numCodeBytes;
+	U64 codeIndex;
+	// Followed by the null-terminated function name, and the code.
+};
+
+struct JitdumpCodeDebugInfoRecord
+{
+	JitdumpRecordHeader header;
+	U64 codeAddress;
+	U64 numEntries;
+	// Followed by the entries.
+};
+
+struct JitdumpDebugEntry
+{
+	U64 codeAddress;
+	U32 line;
+	U32 discriminator;
+	// Followed by the null-terminated source file name.
+};
+
+static U64 getJitdumpTimestamp() { return U64(getClockTime(Clock::monotonic).ns); }
+#endif
+
+struct PerfMap
+{
+	Mutex mutex;
+	FILE* file = nullptr;
+
+	// perf finds the jitdump file through the executable mapping of it in the process.
+	void* jitdumpMapping = nullptr;
+	U64 nextCodeIndex = 0;
+
+	static PerfMap& get()
+	{
+		static PerfMap perfMap;
+		return perfMap;
+	}
+};
+
+static std::atomic<PerfMapFormat> perfMapFormat{PerfMapFormat::none};
+
+bool Platform::enablePerfMap(PerfMapFormat format)
+{
+	PerfMap& perfMap = PerfMap::get();
+	Mutex::Lock perfMapLock(perfMap.mutex);
+	if(format == perfMapFormat.load(std::memory_order_relaxed)) { return true; }
+	WAVM_ERROR_UNLESS(perfMapFormat.load(std::memory_order_relaxed) == PerfMapFormat::none);
+
+	char path[64];
+	switch(format)
+	{
+	case PerfMapFormat::none: return true;
+
+	case PerfMapFormat::map: {
+		snprintf(path, sizeof(path), "/tmp/perf-%u.map", unsigned(getpid()));
+		perfMap.file = fopen(path, "w");
+		if(!perfMap.file) { return false; }
+		break;
+	}
+
+	case PerfMapFormat::jitdump: {
+#if defined(__linux__)
+		snprintf(path, sizeof(path), "/tmp/jit-%u.dump", unsigned(getpid()));
+		perfMap.file = fopen(path, "w+");
+		if(!perfMap.file) { return false; }
+
+		JitdumpHeader header;
+		header.magic = jitdumpMagic;
+		header.version = jitdumpVersion;
+		header.numHeaderBytes = sizeof(JitdumpHeader);
+#if defined(__x86_64__)
+		header.elfMachine = EM_X86_64;
+#elif defined(__aarch64__)
+		header.elfMachine = EM_AARCH64;
+#else
+		header.elfMachine = EM_NONE;
+#endif
+		header.padding = 0;
+		header.pid = U32(getpid());
+		header.timestamp = getJitdumpTimestamp();
+		header.flags = 0;
+		fwrite(&header, sizeof(header), 1, perfMap.file);
+		fflush(perfMap.file);
+
+		perfMap.jitdumpMapping = mmap(nullptr,
+									  sysconf(_SC_PAGESIZE),
+									  PROT_READ | PROT_EXEC,
+									  MAP_PRIVATE,
+									  fileno(perfMap.file),
+									  0);
+		if(perfMap.jitdumpMapping == MAP_FAILED)
+		{
+			perfMap.jitdumpMapping = nullptr;
+			fclose(perfMap.file);
+			perfMap.file = nullptr;
+			unlink(path);
+			return false;
+		}
+		break;
+#else
+		return false;
+#endif
+	}
+
+	default: WAVM_UNREACHABLE();
+	};
+
+	perfMapFormat.store(format, std::memory_order_release);
+	return true;
+}
+
+PerfMapFormat Platform::getPerfMapFormat() { return perfMapFormat.load(std::memory_order_acquire); }
+
+void Platform::addPerfMapFunction(const char* name,
+								  const U8* code,
+								  Uptr numCodeBytes,
+								  const char* sourceFileName,
+								  const PerfMapLine* lines,
+								  Uptr numLines)
+{
+	PerfMap& perfMap = PerfMap::get();
+	Mutex::Lock perfMapLock(perfMap.mutex);
+	switch(perfMapFormat.load(std::memory_order_relaxed))
+	{
+	case PerfMapFormat::none: return;
+
+	case PerfMapFormat::map: {
+		fprintf(perfMap.file,
+				"%" WAVM_PRIxPTR " %" WAVM_PRIxPTR " %s\n",
+				reinterpret_cast<uintptr_t>(code),
+				uintptr_t(numCodeBytes),
+				name);
+		break;
+	}
+
+	case PerfMapFormat::jitdump: {
+#if defined(__linux__)
+		const U64 timestamp = getJitdumpTimestamp();
+		const Uptr numNameBytes = strlen(name) + 1;
+		const Uptr numSourceFileNameBytes = strlen(sourceFileName) + 1;
+
+		// The debug info must precede the code load record it describes.
+		if(numLines)
+		{
+			JitdumpCodeDebugInfoRecord debugInfoRecord;
+			debugInfoRecord.header.id = jitdumpCodeDebugInfoRecordId;
+			debugInfoRecord.header.numRecordBytes
+				= U32(sizeof(JitdumpCodeDebugInfoRecord)
+					  + numLines * (sizeof(JitdumpDebugEntry) + numSourceFileNameBytes));
+			debugInfoRecord.header.timestamp = timestamp;
+			debugInfoRecord.codeAddress = U64(reinterpret_cast<Uptr>(code));
+			debugInfoRecord.numEntries = U64(numLines);
+			fwrite(&debugInfoRecord, sizeof(debugInfoRecord), 1, perfMap.file);
+			for(Uptr lineIndex = 0; lineIndex < numLines; ++lineIndex)
+			{
+				JitdumpDebugEntry entry;
+				entry.codeAddress = U64(reinterpret_cast<Uptr>(code) + lines[lineIndex].codeOffset);
+				entry.line = lines[lineIndex].line;
+				entry.discriminator = 0;
+				fwrite(&entry, sizeof(entry), 1, perfMap.file);
+				fwrite(sourceFileName, numSourceFileNameBytes, 1, perfMap.file);
+			}
+		}
+
+		JitdumpCodeLoadRecord codeLoadRecord;
+		codeLoadRecord.header.id = jitdumpCodeLoadRecordId;
+		codeLoadRecord.header.numRecordBytes
+			= U32(sizeof(JitdumpCodeLoadRecord) + numNameBytes + numCodeBytes);
+		codeLoadRecord.header.timestamp = timestamp;
+		codeLoadRecord.pid = U32(getpid());
+		codeLoadRecord.tid = U32(syscall(SYS_gettid));
+		codeLoadRecord.virtualAddress = U64(reinterpret_cast<Uptr>(code));
+		codeLoadRecord.codeAddress = U64(reinterpret_cast<Uptr>(code));
+		codeLoadRecord.numCodeBytes = U64(numCodeBytes);
+		codeLoadRecord.codeIndex = perfMap.nextCodeIndex++;
+		fwrite(&codeLoadRecord, sizeof(codeLoadRecord), 1, perfMap.file);
+		fwrite(name, numNameBytes, 1, perfMap.file);
+		fwrite(code, numCodeBytes, 1, perfMap.file);
+		break;
+#else
+		WAVM_UNREACHABLE();
+#endif
+	}
+
+	default: WAVM_UNREACHABLE();
+	};
+
+	// Flush the file, so the functions are described even if the process doesn't exit normally.
+	fflush(perfMap.file);
+}
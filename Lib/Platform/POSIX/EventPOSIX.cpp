@@ -12,7 +12,7 @@
 using namespace WAVM;
 using namespace WAVM::Platform;
 
-Platform::Event::Event()
+Platform::Event::Event() : isSignaled(false)
 {
 	static_assert(sizeof(pthreadMutex) == sizeof(pthread_mutex_t), "");
 	static_assert(alignof(PthreadMutex) >= alignof(pthread_mutex_t), "");
@@ -28,7 +28,7 @@ Platform::Event::Event()
 	WAVM_ERROR_UNLESS(!pthread_condattr_setclock(&conditionVariableAttr, CLOCK_MONOTONIC));
 #endif
 
-	WAVM_ERROR_UNLESS(!pthread_cond_init((pthread_cond_t*)&pthreadCond, nullptr));
+	WAVM_ERROR_UNLESS(!pthread_cond_init((pthread_cond_t*)&pthreadCond, &conditionVariableAttr));
 	WAVM_ERROR_UNLESS(!pthread_mutex_init((pthread_mutex_t*)&pthreadMutex, nullptr));
 
 	WAVM_ERROR_UNLESS(!pthread_condattr_destroy(&conditionVariableAttr));
@@ -44,44 +44,59 @@ bool Platform::Event::wait(Time waitDuration)
 {
 	WAVM_ERROR_UNLESS(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
 
-	int result;
-	if(isInfinity(waitDuration))
+	// Wait until the event is signaled, rechecking the signaled flag after each wakeup to handle
+	// spurious wakeups and signals that happened before the wait started.
+	const I128 untilTimeNS = isInfinity(waitDuration)
+								 ? 0
+								 : getClockTime(Clock::monotonic).ns + waitDuration.ns;
+	while(!isSignaled)
 	{
-		result = pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
-	}
-	else
-	{
-		// Use the non-POSIX relative time wait on Mac, and an absolute monotonic clock timeout on
-		// other POSIX systems.
+		int result;
+		if(isInfinity(waitDuration))
+		{
+			result
+				= pthread_cond_wait((pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex);
+		}
+		else
+		{
+			// Use the non-POSIX relative time wait on Mac, and an absolute monotonic clock timeout
+			// on other POSIX systems.
 #ifdef __APPLE__
-		timespec waitTimeSpec;
-		waitTimeSpec.tv_sec = U64(waitDuration.ns / 1000000000);
-		waitTimeSpec.tv_nsec = U64(waitDuration.ns % 1000000000);
+			I128 remainingNS = untilTimeNS - getClockTime(Clock::monotonic).ns;
+			if(remainingNS < 0) { remainingNS = 0; }
+			timespec waitTimeSpec;
+			waitTimeSpec.tv_sec = U64(remainingNS / 1000000000);
+			waitTimeSpec.tv_nsec = U64(remainingNS % 1000000000);
 
-		result = pthread_cond_timedwait_relative_np(
-			(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &waitTimeSpec);
+			result = pthread_cond_timedwait_relative_np(
+				(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &waitTimeSpec);
 #else
-		const I128 untilTimeNS = getClockTime(Clock::monotonic).ns + waitDuration.ns;
-		timespec untilTimeSpec;
-		untilTimeSpec.tv_sec = U64(untilTimeNS / 1000000000);
-		untilTimeSpec.tv_nsec = U64(untilTimeNS % 1000000000);
+			timespec untilTimeSpec;
+			untilTimeSpec.tv_sec = U64(untilTimeNS / 1000000000);
+			untilTimeSpec.tv_nsec = U64(untilTimeNS % 1000000000);
 
-		result = pthread_cond_timedwait(
-			(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
+			result = pthread_cond_timedwait(
+				(pthread_cond_t*)&pthreadCond, (pthread_mutex_t*)&pthreadMutex, &untilTimeSpec);
 #endif
+		}
+
+		if(result == ETIMEDOUT) { break; }
+		WAVM_ERROR_UNLESS(!result);
 	}
 
+	// Reset the event, so it only wakes one wait for each signal.
+	const bool wasSignaled = isSignaled;
+	isSignaled = false;
+
 	WAVM_ERROR_UNLESS(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
 
-	if(result == ETIMEDOUT) { return false; }
-	else
-	{
-		WAVM_ERROR_UNLESS(!result);
-		return true;
-	}
+	return wasSignaled;
 }
 
 void Platform::Event::signal()
 {
+	WAVM_ERROR_UNLESS(!pthread_mutex_lock((pthread_mutex_t*)&pthreadMutex));
+	isSignaled = true;
 	WAVM_ERROR_UNLESS(!pthread_cond_signal((pthread_cond_t*)&pthreadCond));
+	WAVM_ERROR_UNLESS(!pthread_mutex_unlock((pthread_mutex_t*)&pthreadMutex));
 }
@@ -0,0 +1,231 @@
+#if defined(__APPLE__)
+// MacOS only declares the ucontext functions if _XOPEN_SOURCE is defined.
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "POSIXPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Mutex.h"
+
+#ifdef __APPLE__
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+static constexpr Uptr defaultFiberStackNumBytes = 1024 * 1024;
+
+struct Platform::Fiber
+{
+	ucontext_t context;
+	ucontext_t resumerContext;
+
+	void (*entry)(void*);
+	void* entryArgument;
+
+	// The stack memory, which starts with a guard page.
+	U8* stackBase;
+	Uptr stackNumBytes;
+
+	// The fiber that was running when this fiber was switched to.
+	Fiber* resumerFiber = nullptr;
+
+	// While the fiber is running, the resumer's innermost signal context. While the fiber isn't
+	// running, the fiber's own innermost signal context.
+	SignalContext* savedInnermostSignalContext = nullptr;
+
+	bool isRunning = false;
+	bool isFinished = false;
+
+	// Whether the switchToFiber call that is running the fiber allows it to switch back before
+	// its entry function returns.
+	bool isSuspendable = false;
+};
+
+static thread_local Platform::Fiber* currentFiber = nullptr;
+
+struct FiberStackPool
+{
+	Platform::Mutex mutex;
+	std::vector<std::pair<U8*, Uptr>> freeStacks;
+	Uptr maxFreeStacks = defaultMaxPooledFiberStacks;
+};
+
+static FiberStackPool& getFiberStackPool()
+{
+	static FiberStackPool pool;
+	return pool;
+}
+
+// Returns the number of bytes in a stack with at least numStackBytes usable bytes and a guard page.
+static Uptr getFiberStackNumBytes(Uptr numStackBytes)
+{
+	const Uptr numBytesPerPage = getBytesPerPage();
+	const Uptr numUsableStackBytes
+		= ((numStackBytes ? numStackBytes : defaultFiberStackNumBytes) + numBytesPerPage - 1)
+		  & ~(numBytesPerPage - 1);
+	return numUsableStackBytes + numBytesPerPage;
+}
+
+static U8* allocateFiberStack(Uptr stackNumBytes)
+{
+	// Reuse a pooled stack with the same size if there is one.
+	{
+		FiberStackPool& pool = getFiberStackPool();
+		Platform::Mutex::Lock poolLock(pool.mutex);
+		for(auto it = pool.freeStacks.rbegin(); it != pool.freeStacks.rend(); ++it)
+		{
+			if(it->second == stackNumBytes)
+			{
+				U8* stackBase = it->first;
+				pool.freeStacks.erase(std::next(it).base());
+				return stackBase;
+			}
+		};
+	}
+
+	// Allocate the stack with a guard page below it.
+	const Uptr numBytesPerPage = getBytesPerPage();
+	U8* stackBase = (U8*)mmap(
+		nullptr, stackNumBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(stackBase == MAP_FAILED)
+	{
+		Errors::fatalf(
+			"mmap(%" WAVM_PRIuPTR ") for a fiber stack returned %i.\n", stackNumBytes, errno);
+	}
+	if(mprotect(stackBase, numBytesPerPage, PROT_NONE) != 0)
+	{
+		Errors::fatalf("mprotect(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", PROT_NONE) returned %i.\n",
+					   reinterpret_cast<Uptr>(stackBase),
+					   numBytesPerPage,
+					   errno);
+	}
+	return stackBase;
+}
+
+static void freeFiberStack(U8* stackBase, Uptr stackNumBytes)
+{
+	// Keep the stack for reuse if the pool isn't full.
+	{
+		FiberStackPool& pool = getFiberStackPool();
+		Platform::Mutex::Lock poolLock(pool.mutex);
+		if(pool.freeStacks.size() < pool.maxFreeStacks)
+		{
+			pool.freeStacks.emplace_back(stackBase, stackNumBytes);
+			return;
+		}
+	}
+
+	WAVM_ERROR_UNLESS(!munmap(stackBase, stackNumBytes));
+}
+
+static void fiberEntry()
+{
+	Platform::Fiber* fiber = currentFiber;
+	(*fiber->entry)(fiber->entryArgument);
+
+	// Switch back to the resumer for the last time. The fiber's context is never resumed.
+	fiber->isFinished = true;
+	setcontext(&fiber->resumerContext);
+	Errors::fatalf("setcontext failed");
+}
+
+Platform::Fiber* Platform::createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument)
+{
+#ifdef __WAVIX__
+	Errors::unimplemented("Wavix createFiber");
+#else
+	const Uptr numBytesPerPage = getBytesPerPage();
+
+	Fiber* fiber = new Fiber;
+	fiber->entry = entry;
+	fiber->entryArgument = argument;
+	fiber->stackNumBytes = getFiberStackNumBytes(numStackBytes);
+	fiber->stackBase = allocateFiberStack(fiber->stackNumBytes);
+
+	WAVM_ERROR_UNLESS(!getcontext(&fiber->context));
+	fiber->context.uc_stack.ss_sp = fiber->stackBase + numBytesPerPage;
+	fiber->context.uc_stack.ss_size = fiber->stackNumBytes - numBytesPerPage;
+	fiber->context.uc_link = nullptr;
+	makecontext(&fiber->context, fiberEntry, 0);
+
+	return fiber;
+#endif
+}
+
+void Platform::destroyFiber(Fiber* fiber)
+{
+	WAVM_ERROR_UNLESS(!fiber->isRunning);
+	freeFiberStack(fiber->stackBase, fiber->stackNumBytes);
+	delete fiber;
+}
+
+void Platform::reserveFiberStacks(Uptr numStacks, Uptr numStackBytes)
+{
+#ifndef __WAVIX__
+	const Uptr stackNumBytes = getFiberStackNumBytes(numStackBytes);
+	std::vector<U8*> stackBases;
+	for(Uptr stackIndex = 0; stackIndex < numStacks; ++stackIndex)
+	{ stackBases.push_back(allocateFiberStack(stackNumBytes)); }
+
+	// Make room in the pool for the reserved stacks, in addition to the stacks it already holds.
+	FiberStackPool& pool = getFiberStackPool();
+	Platform::Mutex::Lock poolLock(pool.mutex);
+	pool.maxFreeStacks = std::max(pool.maxFreeStacks, pool.freeStacks.size() + numStacks);
+	for(U8* stackBase : stackBases) { pool.freeStacks.emplace_back(stackBase, stackNumBytes); }
+#endif
+}
+
+bool Platform::switchToFiber(Fiber* fiber, bool isSuspendable)
+{
+	WAVM_ERROR_UNLESS(!fiber->isRunning && !fiber->isFinished);
+
+	// Signal contexts are linked through the stack of the code that catches the signals, so each
+	// fiber has its own list of them.
+	initThreadAndGlobalSignals();
+	std::swap(innermostSignalContext, fiber->savedInnermostSignalContext);
+
+	fiber->resumerFiber = currentFiber;
+	fiber->isRunning = true;
+	fiber->isSuspendable = isSuspendable;
+	currentFiber = fiber;
+	WAVM_ERROR_UNLESS(!swapcontext(&fiber->resumerContext, &fiber->context));
+	currentFiber = fiber->resumerFiber;
+	fiber->isRunning = false;
+	fiber->resumerFiber = nullptr;
+
+	std::swap(innermostSignalContext, fiber->savedInnermostSignalContext);
+
+	return fiber->isFinished;
+}
+
+void Platform::switchFromFiber()
+{
+	Fiber* fiber = currentFiber;
+	WAVM_ERROR_UNLESS(fiber);
+	WAVM_ERROR_UNLESS(!swapcontext(&fiber->context, &fiber->resumerContext));
+}
+
+Platform::Fiber* Platform::getCurrentFiber() { return currentFiber; }
+
+bool Platform::isCurrentFiberSuspendable() { return currentFiber && currentFiber->isSuspendable; }
+
+bool Platform::getCurrentFiberStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr)
+{
+	if(!currentFiber) { return false; }
+	outMinGuardAddr = currentFiber->stackBase;
+	outMinAddr = currentFiber->stackBase + getBytesPerPage();
+	outMaxAddr = currentFiber->stackBase + currentFiber->stackNumBytes;
+	return true;
+}
@@ -7,22 +7,48 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/I128.h"
 #include "WAVM/Inline/Time.h"
 #include "WAVM/Platform/File.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/VFS/VFS.h"
 
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#endif
+#endif
+
 #define FILE_OFFSET_IS_64BIT (sizeof(off_t) == 8)
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define WAVM_ENABLE_ZEROCOPY_SEND 1
+#else
+#define WAVM_ENABLE_ZEROCOPY_SEND 0
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 using namespace WAVM;
 using namespace WAVM::Platform;
 using namespace WAVM::VFS;
@@ -41,7 +67,7 @@ static_assert(offsetof(struct iovec, iov_base) == offsetof(IOWriteBuffer, data)
 				  && sizeof(struct iovec) == sizeof(IOWriteBuffer),
 			  "IOWriteBuffer must match iovec");
 
-static Result asVFSResult(int error)
+Result Platform::asVFSResult(int error)
 {
 	switch(error)
 	{
@@ -74,6 +100,11 @@ static Result asVFSResult(int error)
 	case ENOTEMPTY: return Result::isNotEmpty;
 	case EMLINK: return Result::outOfLinksToParentDir;
 	case ENOTSUP: return Result::notSupported;
+	case EPIPE: return Result::brokenPipe;
+	case ENOTSOCK: return Result::notSocket;
+	case ENOTCONN: return Result::notConnected;
+	case ECONNRESET: return Result::connectionReset;
+	case EMSGSIZE: return Result::tooManyBufferBytes;
 
 	case EINVAL:
 		// This probably needs to be handled differently for each API entry point.
@@ -249,11 +280,229 @@ private:
 	U64 maxValidOffset{0};
 };
 
+#if defined(__linux__)
+// Reads a directory with getdents64 into a large buffer instead of through a DIR, so readEntries
+// can pass the names to the caller without copying them, and with a system call per buffer
+// instead of the DIR's smaller one.
+struct LinuxDirEntStream : DirEntStream
+{
+	LinuxDirEntStream(I32 inFD) : fd(inFD) {}
+
+	virtual void close() override
+	{
+		if(::close(fd)) { Errors::fatalf("close failed: %s", strerror(errno)); }
+		delete this;
+	}
+
+	virtual bool getNext(DirEnt& outEntry) override
+	{
+		bool gotEntry = false;
+		readEntries([&](const DirEntRef& entry) {
+			outEntry.fileNumber = entry.fileNumber;
+			outEntry.name.assign(entry.name, entry.numNameChars);
+			outEntry.type = entry.type;
+			gotEntry = true;
+			return false;
+		});
+		return gotEntry;
+	}
+
+	virtual void readEntries(const std::function<bool(const DirEntRef&)>& visitEntry) override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		while(true)
+		{
+			if(nextBufferOffset == numBufferBytes && !readBuffer()) { return; }
+
+			const LinuxDirEnt64* dirent = (const LinuxDirEnt64*)(buffer.data() + nextBufferOffset);
+			nextBufferOffset += dirent->d_reclen;
+			offset = U64(dirent->d_off);
+
+			const DirEntRef entry{U64(dirent->d_ino),
+								  dirent->d_name,
+								  strlen(dirent->d_name),
+								  getFileTypeFromDirEntType(dirent->d_type),
+								  offset};
+			if(!visitEntry(entry)) { return; }
+		}
+	}
+
+	virtual void restart() override { WAVM_ERROR_UNLESS(seek(0)); }
+
+	virtual U64 tell() override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		return offset;
+	}
+
+	virtual bool seek(U64 newOffset) override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		// The offsets are opaque cookies that the file system validates.
+		if(newOffset > U64(INT64_MAX) || lseek(fd, off_t(newOffset), SEEK_SET) < 0)
+		{ return false; }
+		offset = newOffset;
+		nextBufferOffset = numBufferBytes = 0;
+		return true;
+	}
+
+private:
+	static constexpr Uptr maxBufferBytes = 64 * 1024;
+
+	// The layout of the entries that getdents64 writes to the buffer.
+	struct LinuxDirEnt64
+	{
+		U64 d_ino;
+		I64 d_off;
+		U16 d_reclen;
+		U8 d_type;
+		char d_name[1];
+	};
+
+	Platform::Mutex mutex;
+	I32 fd;
+	U64 offset{0};
+
+	std::vector<U8> buffer;
+	Uptr numBufferBytes{0};
+	Uptr nextBufferOffset{0};
+
+	bool readBuffer()
+	{
+		if(!buffer.size()) { buffer.resize(maxBufferBytes); }
+		nextBufferOffset = numBufferBytes = 0;
+
+		const long result = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+		if(result > 0)
+		{
+			numBufferBytes = Uptr(result);
+			return true;
+		}
+		else if(result == 0 || errno == ENOENT)
+		{
+			// Reached the end of the directory, or the directory was deleted.
+			return false;
+		}
+		else
+		{
+			Errors::fatalfWithCallStack("getdents64 returned unexpected error: %s",
+										strerror(errno));
+		}
+	}
+};
+#endif
+
+// Creates a DirEntStream for a directory, which takes ownership of the fd.
+static Result openDirEntStream(I32 fd, DirEntStream*& outStream)
+{
+#if defined(__linux__)
+	outStream = new LinuxDirEntStream(fd);
+#else
+	DIR* dir = fdopendir(fd);
+	if(!dir)
+	{
+		const int error = errno;
+		if(close(fd)) { Errors::fatalf("close failed: %s", strerror(errno)); }
+		return asVFSResult(error);
+	}
+
+	outStream = new POSIXDirEntStream(dir);
+#endif
+	return Result::success;
+}
+
+// Detects sequential reads of a file, and asks the kernel to read ahead of them with a window that
+// doubles each time the reads reach it. The state is only a hint, so concurrent reads of the same
+// file may race to update it without affecting correctness.
+struct ReadAheadState
+{
+	static constexpr U64 unknownOffset = UINT64_MAX;
+	static constexpr U64 minSequentialBytes = 128 * 1024;
+	static constexpr U64 minWindowBytes = 256 * 1024;
+	static constexpr U64 maxWindowBytes = 8 * 1024 * 1024;
+	static constexpr U64 dropBehindBytes = 1024 * 1024;
+
+	// The offset after the last byte read or written at the file's current position, or
+	// unknownOffset if it hasn't been read from the file descriptor yet.
+	std::atomic<U64> nextOffset{unknownOffset};
+
+	std::atomic<U64> numSequentialBytes{0};
+	std::atomic<U64> windowEndOffset{0};
+	std::atomic<U64> numWindowBytes{minWindowBytes};
+	std::atomic<U64> dropBehindOffset{0};
+
+	// If true, reads are assumed to be sequential without waiting for minSequentialBytes.
+	std::atomic<bool> isSequential{false};
+
+	// If true, no read-ahead is done: either the file was advised to be read randomly, or the
+	// kernel doesn't support read-ahead for it.
+	std::atomic<bool> isDisabled{false};
+
+	// If true, the pages behind sequential reads are dropped from the page cache.
+	std::atomic<bool> shouldDropBehind{false};
+
+	// Starts a new sequential run at offset if it doesn't continue from the previous read.
+	void onSeek(U64 offset)
+	{
+		if(offset == nextOffset.load(std::memory_order_relaxed)) { return; }
+
+		numSequentialBytes.store(0, std::memory_order_relaxed);
+		windowEndOffset.store(0, std::memory_order_relaxed);
+		numWindowBytes.store(minWindowBytes, std::memory_order_relaxed);
+		dropBehindOffset.store(offset, std::memory_order_relaxed);
+		nextOffset.store(offset, std::memory_order_relaxed);
+	}
+
+	void onRead(I32 fd, U64 offset, U64 numBytes)
+	{
+		if(isDisabled.load(std::memory_order_relaxed) || !numBytes) { return; }
+
+		onSeek(offset);
+		const U64 endOffset = offset + numBytes;
+		nextOffset.store(endOffset, std::memory_order_relaxed);
+		const U64 runBytes
+			= numSequentialBytes.fetch_add(numBytes, std::memory_order_relaxed) + numBytes;
+		if(runBytes < minSequentialBytes && !isSequential.load(std::memory_order_relaxed))
+		{ return; }
+
+#if defined(__linux__) || defined(__FreeBSD__)
+		// Once the reads are past the first half of the window, ask the kernel to read the next
+		// window.
+		const U64 windowBytes = numWindowBytes.load(std::memory_order_relaxed);
+		const U64 windowEnd = windowEndOffset.load(std::memory_order_relaxed);
+		if(endOffset + windowBytes / 2 >= windowEnd)
+		{
+			const U64 readAheadOffset = std::max(endOffset, windowEnd);
+			if(posix_fadvise(fd, off_t(readAheadOffset), off_t(windowBytes), POSIX_FADV_WILLNEED))
+			{
+				isDisabled.store(true, std::memory_order_relaxed);
+				return;
+			}
+			windowEndOffset.store(readAheadOffset + windowBytes, std::memory_order_relaxed);
+			numWindowBytes.store(std::min(windowBytes * 2, maxWindowBytes),
+								 std::memory_order_relaxed);
+		}
+
+		// Drop the pages that have been read from the page cache in large chunks.
+		const U64 dropOffset = dropBehindOffset.load(std::memory_order_relaxed);
+		if(shouldDropBehind.load(std::memory_order_relaxed)
+		   && endOffset >= dropOffset + dropBehindBytes)
+		{
+			posix_fadvise(fd, off_t(dropOffset), off_t(endOffset - dropOffset), POSIX_FADV_DONTNEED);
+			dropBehindOffset.store(endOffset, std::memory_order_relaxed);
+		}
+#endif
+	}
+};
+
 struct POSIXFD : VFD
 {
 	const I32 fd;
 
-	POSIXFD(I32 inFD) : fd(inFD) {}
+	// If true, reads, writes, and syncs are done through the calling thread's io_uring.
+	const bool useIOURing;
+
+	POSIXFD(I32 inFD, bool inUseIOURing = false) : fd(inFD), useIOURing(inUseIOURing) {}
 
 	virtual Result close() override
 	{
@@ -288,6 +537,7 @@ struct POSIXFD : VFD
 		const I64 result = lseek(fd, off_t(offset), whence);
 		if(result == -1) { return errno == EINVAL ? Result::invalidOffset : asVFSResult(errno); }
 
+		readAhead.onSeek(U64(result));
 		if(outAbsoluteOffset) { *outAbsoluteOffset = U64(result); }
 		return Result::success;
 	}
@@ -304,12 +554,24 @@ struct POSIXFD : VFD
 			return Result::tooManyBuffers;
 		}
 
+		if(useIOURing)
+		{
+			const I64 result
+				= ioURingReadv(fd, (const struct iovec*)buffers, numBuffers, offset);
+			if(result < 0) { return asVFSResult(I32(-result)); }
+
+			onRead(offset, U64(result));
+			if(outNumBytesRead) { *outNumBytesRead = Uptr(result); }
+			return Result::success;
+		}
+
 		if(offset == nullptr)
 		{
 			// Do the read.
 			ssize_t result = ::readv(fd, (const struct iovec*)buffers, numBuffers);
 			if(result == -1) { return asVFSResult(errno); }
 
+			onRead(nullptr, U64(result));
 			if(outNumBytesRead) { *outNumBytesRead = result; }
 			return Result::success;
 		}
@@ -328,6 +590,16 @@ struct POSIXFD : VFD
 			}
 			if(numBufferBytes > UINT32_MAX) { return Result::tooManyBufferBytes; }
 
+#if defined(__linux__) || defined(__FreeBSD__)
+			// Read directly into the buffers.
+			const ssize_t result
+				= preadv(fd, (const struct iovec*)buffers, int(numBuffers), off_t(*offset));
+			if(result < 0) { return asVFSResult(errno); }
+
+			onRead(offset, U64(result));
+			if(outNumBytesRead) { *outNumBytesRead = Uptr(result); }
+			return Result::success;
+#else
 			// Allocate a combined buffer.
 			U8* combinedBuffer = (U8*)malloc(numBufferBytes);
 			if(!combinedBuffer) { return Result::outOfMemory; }
@@ -357,10 +629,13 @@ struct POSIXFD : VFD
 				if(outNumBytesRead) { *outNumBytesRead = numBytesRead; }
 			}
 
+			if(vfsResult == Result::success) { onRead(offset, U64(result)); }
+
 			// Free the combined buffer.
 			free(combinedBuffer);
 
 			return vfsResult;
+#endif
 		}
 	}
 	virtual Result writev(const IOWriteBuffer* buffers,
@@ -376,11 +651,24 @@ struct POSIXFD : VFD
 			return Result::tooManyBuffers;
 		}
 
+		if(useIOURing)
+		{
+			const I64 result
+				= ioURingWritev(fd, (const struct iovec*)buffers, numBuffers, offset);
+			if(result < 0) { return asVFSResult(I32(-result)); }
+
+			if(!offset) { forgetCurrentOffset(); }
+			if(outNumBytesWritten) { *outNumBytesWritten = Uptr(result); }
+			return Result::success;
+		}
+
 		if(offset == nullptr)
 		{
 			ssize_t result = ::writev(fd, (const struct iovec*)buffers, numBuffers);
 			if(result == -1) { return asVFSResult(errno); }
 
+			forgetCurrentOffset();
+
 			if(outNumBytesWritten) { *outNumBytesWritten = result; }
 			return Result::success;
 		}
@@ -399,6 +687,15 @@ struct POSIXFD : VFD
 			}
 			if(numBufferBytes > UINT32_MAX) { return Result::tooManyBufferBytes; }
 
+#if defined(__linux__) || defined(__FreeBSD__)
+			// Write directly from the buffers.
+			const ssize_t result
+				= pwritev(fd, (const struct iovec*)buffers, int(numBuffers), off_t(*offset));
+			if(result < 0) { return asVFSResult(errno); }
+
+			if(outNumBytesWritten) { *outNumBytesWritten = Uptr(result); }
+			return Result::success;
+#else
 			// Allocate a combined buffer.
 			U8* combinedBuffer = (U8*)malloc(numBufferBytes);
 			if(!combinedBuffer) { return Result::outOfMemory; }
@@ -427,10 +724,19 @@ struct POSIXFD : VFD
 			free(combinedBuffer);
 
 			return vfsResult;
+#endif
 		}
 	}
 	virtual Result sync(SyncType syncType) override
 	{
+		if(useIOURing)
+		{
+			const I64 result = ioURingSync(fd, syncType == SyncType::contents);
+			if(result < 0)
+			{ return result == -EINVAL ? Result::notSynchronizable : asVFSResult(I32(-result)); }
+			return Result::success;
+		}
+
 #ifdef __APPLE__
 		I32 result = fsync(fd);
 #else
@@ -452,6 +758,19 @@ struct POSIXFD : VFD
 		if(fstat(fd, &fdStatus) != 0) { return asVFSResult(errno); }
 
 		outInfo.type = getFileTypeFromMode(fdStatus.st_mode);
+		if(S_ISSOCK(fdStatus.st_mode))
+		{
+			int socketType = 0;
+			socklen_t socketTypeNumBytes = sizeof(socketType);
+			if(!getsockopt(fd, SOL_SOCKET, SO_TYPE, &socketType, &socketTypeNumBytes))
+			{
+				if(socketType == SOCK_STREAM) { outInfo.type = FileType::streamSocket; }
+				else if(socketType == SOCK_DGRAM)
+				{
+					outInfo.type = FileType::datagramSocket;
+				}
+			}
+		}
 
 		I32 fdFlags = fcntl(fd, F_GETFL);
 		if(fdFlags < 0) { return asVFSResult(errno); }
@@ -499,6 +818,77 @@ struct POSIXFD : VFD
 		int result = ftruncate(fd, off_t(numBytes));
 		return result == 0 ? Result::success : asVFSResult(errno);
 	}
+	virtual Result advise(U64 offset, U64 numBytes, FileAdvice advice) override
+	{
+		switch(advice)
+		{
+		case FileAdvice::normal:
+			readAhead.isSequential.store(false, std::memory_order_relaxed);
+			readAhead.isDisabled.store(false, std::memory_order_relaxed);
+			readAhead.shouldDropBehind.store(false, std::memory_order_relaxed);
+			break;
+		case FileAdvice::sequential:
+			readAhead.isSequential.store(true, std::memory_order_relaxed);
+			readAhead.isDisabled.store(false, std::memory_order_relaxed);
+			break;
+		case FileAdvice::random: readAhead.isDisabled.store(true, std::memory_order_relaxed); break;
+		case FileAdvice::noReuse:
+			readAhead.shouldDropBehind.store(true, std::memory_order_relaxed);
+			break;
+		case FileAdvice::willNeed:
+		case FileAdvice::dontNeed: break;
+		default: WAVM_UNREACHABLE();
+		};
+
+#if defined(__linux__) || defined(__FreeBSD__)
+		if(!FILE_OFFSET_IS_64BIT && (offset > INT32_MAX || numBytes > INT32_MAX))
+		{ return Result::invalidOffset; }
+
+		int posixAdvice = 0;
+		switch(advice)
+		{
+		case FileAdvice::normal: posixAdvice = POSIX_FADV_NORMAL; break;
+		case FileAdvice::sequential: posixAdvice = POSIX_FADV_SEQUENTIAL; break;
+		case FileAdvice::random: posixAdvice = POSIX_FADV_RANDOM; break;
+		case FileAdvice::willNeed: posixAdvice = POSIX_FADV_WILLNEED; break;
+		case FileAdvice::dontNeed: posixAdvice = POSIX_FADV_DONTNEED; break;
+		case FileAdvice::noReuse: posixAdvice = POSIX_FADV_NOREUSE; break;
+		default: WAVM_UNREACHABLE();
+		};
+
+		// posix_fadvise returns the error code instead of setting errno.
+		const int error = posix_fadvise(fd, off_t(offset), off_t(numBytes), posixAdvice);
+		if(error == EINVAL) { return Result::invalidOffset; }
+		return error ? asVFSResult(error) : Result::success;
+#else
+		// Other hosts don't take advice, but it's safe to ignore.
+		return Result::success;
+#endif
+	}
+	virtual Result allocate(U64 offset, U64 numBytes) override
+	{
+#if defined(__linux__) || defined(__FreeBSD__)
+		if(offset + numBytes < offset
+		   || (!FILE_OFFSET_IS_64BIT && (offset > INT32_MAX || numBytes > INT32_MAX - offset)))
+		{ return Result::exceededFileSizeLimit; }
+
+		// posix_fallocate returns the error code instead of setting errno.
+		const int error = posix_fallocate(fd, off_t(offset), off_t(numBytes));
+		if(error == EINVAL) { return Result::invalidOffset; }
+		else if(error == EBADF)
+		{
+			// The file descriptor wasn't opened for writing.
+			return Result::notAccessible;
+		}
+		else if(error == ENODEV || error == EOPNOTSUPP)
+		{
+			return Result::notSupported;
+		}
+		return error ? asVFSResult(error) : Result::success;
+#else
+		return Result::notSupported;
+#endif
+	}
 	virtual Result setFileTimes(bool setLastAccessTime,
 								Time lastAccessTime,
 								bool setLastWriteTime,
@@ -567,16 +957,212 @@ struct POSIXFD : VFD
 		const I32 duplicateFD = dup(fd);
 		if(duplicateFD < 0) { return asVFSResult(errno); }
 
-		DIR* dir = fdopendir(duplicateFD);
-		if(!dir) { return asVFSResult(errno); }
+		const Result result = openDirEntStream(duplicateFD, outStream);
+		if(result != Result::success) { return result; }
 
-		// Rewind the dir to the beginning to ensure previous seeks on the FD don't affect the
+		// Rewind the stream to the beginning to ensure previous seeks on the FD don't affect the
 		// dirent stream.
-		rewinddir(dir);
+		outStream->restart();
+		return Result::success;
+	}
+
+	virtual Result getHostHandle(Uptr& outHandle) override
+	{
+		outHandle = Uptr(fd);
+		return Result::success;
+	}
+
+	virtual Result recvv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 const SocketRecvFlags& flags,
+						 Uptr* outNumBytesReceived = nullptr,
+						 bool* outIsTruncated = nullptr) override
+	{
+		if(outNumBytesReceived) { *outNumBytesReceived = 0; }
+		if(outIsTruncated) { *outIsTruncated = false; }
+		if(numBuffers > IOV_MAX) { return Result::tooManyBuffers; }
+
+		// Receive directly into the buffers.
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = (struct iovec*)buffers;
+		message.msg_iovlen = numBuffers;
+		const ssize_t result = recvmsg(
+			fd, &message, (flags.peek ? MSG_PEEK : 0) | (flags.waitAll ? MSG_WAITALL : 0));
+		if(result < 0) { return asVFSResult(errno); }
+
+		if(outNumBytesReceived) { *outNumBytesReceived = Uptr(result); }
+		if(outIsTruncated) { *outIsTruncated = message.msg_flags & MSG_TRUNC; }
+		return Result::success;
+	}
+
+	virtual Result sendv(const IOWriteBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesSent = nullptr) override
+	{
+		if(outNumBytesSent) { *outNumBytesSent = 0; }
+		if(numBuffers > IOV_MAX) { return Result::tooManyBuffers; }
+
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = (struct iovec*)buffers;
+		message.msg_iovlen = numBuffers;
+
+#if WAVM_ENABLE_ZEROCOPY_SEND
+		// Large sends are cheaper if the kernel pins the buffers instead of copying them.
+		Uptr numBufferBytes = 0;
+		for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
+		{ numBufferBytes += buffers[bufferIndex].numBytes; }
+		if(numBufferBytes >= minZeroCopySendBytes && !isZeroCopySendDisabled)
+		{
+			Result result;
+			if(trySendZeroCopy(message, outNumBytesSent, result)) { return result; }
+		}
+#endif
+
+		// Send directly from the buffers. Don't raise SIGPIPE if the connection is closed: the
+		// caller gets a brokenPipe error instead.
+		const ssize_t result = sendmsg(fd, &message, MSG_NOSIGNAL);
+		if(result < 0) { return asVFSResult(errno); }
 
-		outStream = new POSIXDirEntStream(dir);
+		if(outNumBytesSent) { *outNumBytesSent = Uptr(result); }
 		return Result::success;
 	}
+
+	virtual Result shutdown(SocketShutdownType type) override
+	{
+		I32 how = 0;
+		switch(type)
+		{
+		case SocketShutdownType::read: how = SHUT_RD; break;
+		case SocketShutdownType::write: how = SHUT_WR; break;
+		case SocketShutdownType::readWrite: how = SHUT_RDWR; break;
+		default: WAVM_UNREACHABLE();
+		};
+
+		if(::shutdown(fd, how)) { return asVFSResult(errno); }
+		return Result::success;
+	}
+
+private:
+	ReadAheadState readAhead;
+
+	// Updates the read-ahead state after reading numBytes at *offset, or at the current offset if
+	// offset is null.
+	void onRead(const U64* offset, U64 numBytes)
+	{
+		if(offset)
+		{
+			readAhead.onRead(fd, *offset, numBytes);
+			return;
+		}
+
+		// If the current offset isn't known, get it from the file descriptor once. If the file
+		// descriptor isn't seekable, it probably can't be read ahead either.
+		if(readAhead.isDisabled.load(std::memory_order_relaxed)) { return; }
+		U64 readOffset = readAhead.nextOffset.load(std::memory_order_relaxed);
+		if(readOffset == ReadAheadState::unknownOffset)
+		{
+			const off_t currentOffset = lseek(fd, 0, SEEK_CUR);
+			if(currentOffset < 0 || U64(currentOffset) < numBytes)
+			{
+				readAhead.isDisabled.store(true, std::memory_order_relaxed);
+				return;
+			}
+			readOffset = U64(currentOffset) - numBytes;
+			readAhead.nextOffset.store(readOffset, std::memory_order_relaxed);
+		}
+		readAhead.onRead(fd, readOffset, numBytes);
+	}
+
+	// Writes at the current offset may append to the file instead, so the current offset has to
+	// be read from the file descriptor before the next read.
+	void forgetCurrentOffset()
+	{
+		readAhead.nextOffset.store(ReadAheadState::unknownOffset, std::memory_order_relaxed);
+	}
+
+#if WAVM_ENABLE_ZEROCOPY_SEND
+	// Below this size, pinning the pages and waiting for the completion notification costs more
+	// than copying the data.
+	static constexpr Uptr minZeroCopySendBytes = 64 * 1024;
+
+	// Held while sending with MSG_ZEROCOPY until the kernel is done with the buffers, so each send
+	// knows which completion notification to wait for.
+	Platform::Mutex zeroCopySendMutex;
+	bool isZeroCopySendEnabled = false;
+	std::atomic<bool> isZeroCopySendDisabled{false};
+	U32 numZeroCopySends = 0;
+	U32 numCompletedZeroCopySends = 0;
+
+	// Tries to send the message with MSG_ZEROCOPY, and waits until the kernel is done with its
+	// buffers, which the caller may overwrite as soon as sendv returns. Returns false if the
+	// message should be sent by copying it instead.
+	bool trySendZeroCopy(const struct msghdr& message, Uptr* outNumBytesSent, Result& outResult)
+	{
+		Platform::Mutex::Lock zeroCopySendLock(zeroCopySendMutex);
+
+		if(!isZeroCopySendEnabled)
+		{
+			const int enable = 1;
+			if(setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)))
+			{
+				isZeroCopySendDisabled = true;
+				return false;
+			}
+			isZeroCopySendEnabled = true;
+		}
+
+		const ssize_t result = sendmsg(fd, &message, MSG_ZEROCOPY | MSG_NOSIGNAL);
+		if(result < 0)
+		{
+			// ENOBUFS means the socket is out of memory for pinning pages.
+			if(errno == ENOBUFS) { return false; }
+			outResult = asVFSResult(errno);
+			return true;
+		}
+		const U32 sendIndex = numZeroCopySends++;
+
+		// Wait for the completion notification for this send on the socket's error queue.
+		while(I32(numCompletedZeroCopySends - sendIndex) <= 0)
+		{
+			struct pollfd pollFD;
+			pollFD.fd = fd;
+			pollFD.events = 0;
+			pollFD.revents = 0;
+			if(poll(&pollFD, 1, -1) < 0 && errno != EINTR) { break; }
+
+			U8 control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_storage))];
+			struct msghdr errorMessage;
+			memset(&errorMessage, 0, sizeof(errorMessage));
+			errorMessage.msg_control = control;
+			errorMessage.msg_controllen = sizeof(control);
+			if(recvmsg(fd, &errorMessage, MSG_ERRQUEUE) < 0)
+			{
+				if(errno == EAGAIN || errno == EINTR) { continue; }
+				break;
+			}
+
+			for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&errorMessage); cmsg;
+				cmsg = CMSG_NXTHDR(&errorMessage, cmsg))
+			{
+				const sock_extended_err* error = (const sock_extended_err*)CMSG_DATA(cmsg);
+				if(error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) { continue; }
+
+				// The notification covers the sends in [ee_info, ee_data].
+				numCompletedZeroCopySends = error->ee_data + 1;
+
+				// If the kernel had to copy the data anyway (e.g. for a loopback connection),
+				// zero-copy sends on this socket are only overhead.
+				if(error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) { isZeroCopySendDisabled = true; }
+			}
+		}
+
+		if(outNumBytesSent) { *outNumBytesSent = Uptr(result); }
+		outResult = Result::success;
+		return true;
+	}
+#endif
 };
 
 struct POSIXStdFD : POSIXFD
@@ -604,6 +1190,8 @@ VFD* Platform::getStdFD(StdDevice device)
 	};
 }
 
+VFD* Platform::openHostHandle(Uptr handle) { return new POSIXFD(I32(handle)); }
+
 struct POSIXFS : HostFS
 {
 	virtual Result open(const std::string& path,
@@ -628,16 +1216,34 @@ struct POSIXFS : HostFS
 
 	static POSIXFS& get()
 	{
-		static POSIXFS posixFS;
+		static POSIXFS posixFS(false);
 		return posixFS;
 	}
 
+	static POSIXFS& getIOURing()
+	{
+		static POSIXFS ioURingPOSIXFS(true);
+		return ioURingPOSIXFS;
+	}
+
 protected:
-	POSIXFS() {}
+	// If true, the files opened by this FS use io_uring for reads, writes, and syncs.
+	const bool useIOURing;
+
+	POSIXFS(bool inUseIOURing) : useIOURing(inUseIOURing) {}
 };
 
 HostFS& Platform::getHostFS() { return POSIXFS::get(); }
 
+HostFS* Platform::getIOURingHostFS()
+{
+	return isIOURingSupported() ? &POSIXFS::getIOURing() : nullptr;
+}
+
+HostFS* Platform::getIOCPHostFS() { return nullptr; }
+
+Uptr Platform::pollIOCP(bool waitForCompletion) { return 0; }
+
 Result POSIXFS::open(const std::string& path,
 					 FileAccessMode accessMode,
 					 FileCreateMode createMode,
@@ -671,7 +1277,7 @@ Result POSIXFS::open(const std::string& path,
 	const I32 fd = ::open(path.c_str(), flags, mode);
 	if(fd == -1) { return asVFSResult(errno); }
 
-	outFD = new POSIXFD(fd);
+	outFD = new POSIXFD(fd, useIOURing);
 	return Result::success;
 }
 
@@ -736,11 +1342,10 @@ Result POSIXFS::setFileTimes(const std::string& path,
 
 Result POSIXFS::openDir(const std::string& path, DirEntStream*& outStream)
 {
-	DIR* dir = opendir(path.c_str());
-	if(!dir) { return asVFSResult(errno); }
+	const I32 fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd < 0) { return asVFSResult(errno); }
 
-	outStream = new POSIXDirEntStream(dir);
-	return Result::success;
+	return openDirEntStream(fd, outStream);
 }
 
 Result POSIXFS::renameFile(const std::string& oldPath, const std::string& newPath)
@@ -763,6 +1368,356 @@ Result POSIXFS::createDir(const std::string& path)
 	return !mkdir(path.c_str(), 0666) ? Result::success : asVFSResult(errno);
 }
 
+// A directory opened by POSIXSandboxFS, which is closed when the last reference to it is released.
+struct POSIXSandboxDir
+{
+	const I32 fd;
+
+	POSIXSandboxDir(I32 inFD) : fd(inFD) {}
+	~POSIXSandboxDir()
+	{
+		if(close(fd)) { Errors::fatalf("close failed: %s", strerror(errno)); }
+	}
+};
+
+// A file system whose paths are resolved relative to an open file descriptor for its root
+// directory. Operations on a path open its parent directory beneath the root, and then operate on
+// the path's last component relative to it. The parent directories are kept open in a small cache,
+// so operations on files in recently used directories only make a single syscall.
+struct POSIXSandboxFS : FileSystem
+{
+	POSIXSandboxFS(I32 rootFD, bool inUseIOURing)
+	: rootDir(std::make_shared<POSIXSandboxDir>(rootFD)), useIOURing(inUseIOURing)
+	{
+	}
+
+	virtual Result open(const std::string& path,
+						FileAccessMode accessMode,
+						FileCreateMode createMode,
+						VFD*& outFD,
+						const VFDFlags& vfsFlags) override
+	{
+		I32 flags = 0;
+		switch(accessMode)
+		{
+		case FileAccessMode::none: flags = O_RDONLY; break;
+		case FileAccessMode::readOnly: flags = O_RDONLY; break;
+		case FileAccessMode::writeOnly: flags = O_WRONLY; break;
+		case FileAccessMode::readWrite: flags = O_RDWR; break;
+		default: WAVM_UNREACHABLE();
+		};
+
+		switch(createMode)
+		{
+		case FileCreateMode::createAlways: flags |= O_CREAT | O_TRUNC; break;
+		case FileCreateMode::createNew: flags |= O_CREAT | O_EXCL; break;
+		case FileCreateMode::openAlways: flags |= O_CREAT; break;
+		case FileCreateMode::openExisting: break;
+		case FileCreateMode::truncateExisting: flags |= O_TRUNC; break;
+		default: WAVM_UNREACHABLE();
+		};
+
+		flags |= translateVFDFlags(vfsFlags);
+
+		I32 fd = -1;
+		const Result result = openBeneathRoot(path, flags, fd);
+		if(result != Result::success) { return result; }
+
+		outFD = new POSIXFD(fd, useIOURing);
+		return Result::success;
+	}
+
+	virtual Result getFileInfo(const std::string& path, FileInfo& outInfo) override
+	{
+		std::shared_ptr<POSIXSandboxDir> parentDir;
+		const char* name;
+		Result result = getParentDir(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		struct stat fileStatus;
+		if(fstatat(parentDir->fd, name, &fileStatus, AT_SYMLINK_NOFOLLOW))
+		{ return asVFSResult(errno); }
+
+		// If the path names a symbolic link, get the status of the file it links to, but only if
+		// it is beneath the root.
+		if(S_ISLNK(fileStatus.st_mode))
+		{
+			I32 fd = -1;
+#ifdef O_PATH
+			result = openBeneathRoot(path, O_PATH | O_CLOEXEC, fd);
+#else
+			result = openBeneathRoot(path, O_RDONLY | O_CLOEXEC, fd);
+#endif
+			if(result != Result::success) { return result; }
+
+			const int fstatResult = fstat(fd, &fileStatus);
+			const int fstatError = errno;
+			if(close(fd)) { Errors::fatalf("close failed: %s", strerror(errno)); }
+			if(fstatResult) { return asVFSResult(fstatError); }
+		}
+
+		getFileInfoFromStatus(fileStatus, outInfo);
+		return Result::success;
+	}
+
+	virtual Result setFileTimes(const std::string& path,
+								bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		// Open the file beneath the root, and set its times through the file descriptor, so the
+		// times of a file linked to from outside the root can't be set.
+		I32 fd = -1;
+		const Result openResult = openBeneathRoot(path, O_RDONLY | O_CLOEXEC, fd);
+		if(openResult != Result::success) { return openResult; }
+
+		POSIXFD* vfd = new POSIXFD(fd);
+		const Result result
+			= vfd->setFileTimes(setLastAccessTime, lastAccessTime, setLastWriteTime, lastWriteTime);
+		vfd->close();
+		return result;
+	}
+
+	virtual Result openDir(const std::string& path, DirEntStream*& outStream) override
+	{
+		I32 fd = -1;
+		const Result result = openBeneathRoot(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, fd);
+		if(result != Result::success) { return result; }
+
+		return openDirEntStream(fd, outStream);
+	}
+
+	virtual Result renameFile(const std::string& oldPath, const std::string& newPath) override
+	{
+		std::shared_ptr<POSIXSandboxDir> oldParentDir;
+		std::shared_ptr<POSIXSandboxDir> newParentDir;
+		const char* oldName;
+		const char* newName;
+		Result result = getParentDir(oldPath, oldParentDir, oldName);
+		if(result != Result::success) { return result; }
+		result = getParentDir(newPath, newParentDir, newName);
+		if(result != Result::success) { return result; }
+
+		if(renameat(oldParentDir->fd, oldName, newParentDir->fd, newName))
+		{ return errno == EXDEV ? Result::notSupported : asVFSResult(errno); }
+
+		// If a directory was renamed or replaced, forget the cached directories beneath it.
+		forgetCachedDirs(oldPath);
+		forgetCachedDirs(newPath);
+		return Result::success;
+	}
+
+	virtual Result unlinkFile(const std::string& path) override
+	{
+		std::shared_ptr<POSIXSandboxDir> parentDir;
+		const char* name;
+		const Result result = getParentDir(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		return !unlinkat(parentDir->fd, name, 0) ? Result::success : asVFSResult(errno);
+	}
+
+	virtual Result removeDir(const std::string& path) override
+	{
+		std::shared_ptr<POSIXSandboxDir> parentDir;
+		const char* name;
+		const Result result = getParentDir(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		if(unlinkat(parentDir->fd, name, AT_REMOVEDIR)) { return asVFSResult(errno); }
+
+		forgetCachedDirs(path);
+		return Result::success;
+	}
+
+	virtual Result createDir(const std::string& path) override
+	{
+		std::shared_ptr<POSIXSandboxDir> parentDir;
+		const char* name;
+		const Result result = getParentDir(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		return !mkdirat(parentDir->fd, name, 0666) ? Result::success : asVFSResult(errno);
+	}
+
+private:
+	static constexpr Uptr maxCachedDirs = 64;
+
+	const std::shared_ptr<POSIXSandboxDir> rootDir;
+	const bool useIOURing;
+
+	Platform::Mutex cachedDirsMutex;
+	HashMap<std::string, std::shared_ptr<POSIXSandboxDir>> cachedDirs;
+
+	// Returns the path relative to the root directory for an absolute path in the file system.
+	static const char* getRelativePath(const std::string& path)
+	{
+		WAVM_ASSERT(path.size() && path[0] == '/');
+		return path.size() > 1 ? path.c_str() + 1 : ".";
+	}
+
+	// Opens a path with openat, ensuring that it doesn't resolve to anything outside the root. On
+	// Linux, this is done with a single openat2(RESOLVE_BENEATH). Elsewhere, the path's parent
+	// directory is opened beneath the root, and the path's last component is opened relative to
+	// it.
+	Result openBeneathRoot(const std::string& path, I32 flags, I32& outFD)
+	{
+		mode_t mode = 0;
+		if(flags & O_CREAT) { mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH; }
+
+#if defined(__linux__) && defined(SYS_openat2) && defined(RESOLVE_BENEATH)
+		static std::atomic<bool> isOpenat2Supported{true};
+		if(isOpenat2Supported.load(std::memory_order_relaxed))
+		{
+			struct open_how how;
+			memset(&how, 0, sizeof(how));
+			how.flags = U64(flags);
+			how.mode = mode;
+			how.resolve = RESOLVE_BENEATH;
+			const long fd
+				= syscall(SYS_openat2, rootDir->fd, getRelativePath(path), &how, sizeof(how));
+			if(fd >= 0)
+			{
+				outFD = I32(fd);
+				return Result::success;
+			}
+			else if(errno == EXDEV)
+			{
+				// openat2 fails with EXDEV if the path resolved to something outside the root.
+				return Result::notAccessible;
+			}
+			else if(errno != ENOSYS)
+			{
+				return asVFSResult(errno);
+			}
+			isOpenat2Supported.store(false, std::memory_order_relaxed);
+		}
+#endif
+
+		std::shared_ptr<POSIXSandboxDir> parentDir;
+		const char* name;
+		const Result result = getParentDir(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		outFD = openat(parentDir->fd, name, flags, mode);
+		return outFD >= 0 ? Result::success : asVFSResult(errno);
+	}
+
+	// Opens the directory that contains the last component of path, and returns the component's
+	// name.
+	Result getParentDir(const std::string& path,
+						std::shared_ptr<POSIXSandboxDir>& outDir,
+						const char*& outName)
+	{
+		WAVM_ASSERT(path.size() && path[0] == '/');
+		const Uptr lastSeparatorOffset = path.find_last_of('/');
+		outName = path.c_str() + lastSeparatorOffset + 1;
+		if(!*outName) { outName = "."; }
+		if(lastSeparatorOffset == 0)
+		{
+			outDir = rootDir;
+			return Result::success;
+		}
+
+		const std::string dirPath = path.substr(0, lastSeparatorOffset);
+		{
+			Platform::Mutex::Lock cachedDirsLock(cachedDirsMutex);
+			if(const std::shared_ptr<POSIXSandboxDir>* cachedDir = cachedDirs.get(dirPath))
+			{
+				outDir = *cachedDir;
+				return Result::success;
+			}
+		}
+
+		I32 fd = -1;
+#ifdef O_PATH
+		const Result result = openBeneathRoot(dirPath, O_PATH | O_DIRECTORY | O_CLOEXEC, fd);
+#else
+		const Result result = openBeneathRoot(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC, fd);
+#endif
+		if(result != Result::success) { return result; }
+		outDir = std::make_shared<POSIXSandboxDir>(fd);
+
+		// Add the directory to the cache. If the cache is full, just clear it: the directories
+		// that are still in use will be reopened and added back to it.
+		Platform::Mutex::Lock cachedDirsLock(cachedDirsMutex);
+		if(cachedDirs.size() >= maxCachedDirs) { cachedDirs.clear(); }
+		cachedDirs.set(dirPath, outDir);
+		return Result::success;
+	}
+
+	// Removes a directory and any directories beneath it from the cache.
+	void forgetCachedDirs(const std::string& dirPath)
+	{
+		Platform::Mutex::Lock cachedDirsLock(cachedDirsMutex);
+		std::vector<std::string> forgottenDirPaths;
+		for(const auto& pair : cachedDirs)
+		{
+			if(!pair.key.compare(0, dirPath.size(), dirPath)
+			   && (pair.key.size() == dirPath.size() || pair.key[dirPath.size()] == '/'))
+			{ forgottenDirPaths.push_back(pair.key); }
+		}
+		for(const std::string& forgottenDirPath : forgottenDirPaths)
+		{ cachedDirs.removeOrFail(forgottenDirPath); }
+	}
+};
+
+std::shared_ptr<FileSystem> Platform::openHostSandboxFS(const std::string& rootPath,
+													   bool useIOURing)
+{
+	if(useIOURing && !isIOURingSupported()) { return nullptr; }
+
+	const I32 rootFD = ::open(rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(rootFD < 0) { return nullptr; }
+
+	return std::make_shared<POSIXSandboxFS>(rootFD, useIOURing);
+}
+
+Result Platform::mapFile(const std::string& path, MappedFile& outMappedFile)
+{
+	const I32 fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0) { return asVFSResult(errno); }
+
+	Result result = Result::success;
+	struct stat fileStatus;
+	if(fstat(fd, &fileStatus)) { result = asVFSResult(errno); }
+	else if(S_ISDIR(fileStatus.st_mode))
+	{
+		result = Result::isDirectory;
+	}
+	else if(U64(fileStatus.st_size) > UINTPTR_MAX)
+	{
+		result = Result::outOfMemory;
+	}
+	else
+	{
+		// mmap can't map an empty file, so represent it as an empty range without a mapping.
+		outMappedFile.bytes = nullptr;
+		outMappedFile.numBytes = Uptr(fileStatus.st_size);
+		if(outMappedFile.numBytes)
+		{
+			void* bytes = mmap(nullptr, outMappedFile.numBytes, PROT_READ, MAP_SHARED, fd, 0);
+			if(bytes == MAP_FAILED) { result = asVFSResult(errno); }
+			else
+			{
+				outMappedFile.bytes = (const U8*)bytes;
+			}
+		}
+	}
+
+	// The mapping stays valid after the file descriptor is closed.
+	if(close(fd)) { Errors::fatalf("close failed: %s", strerror(errno)); }
+
+	return result;
+}
+
+void Platform::unmapFile(const MappedFile& mappedFile)
+{
+	if(mappedFile.numBytes)
+	{ WAVM_ERROR_UNLESS(!munmap(const_cast<U8*>(mappedFile.bytes), mappedFile.numBytes)); }
+}
+
 std::string Platform::getCurrentWorkingDirectory()
 {
 	const Uptr maxPathBytes = pathconf(".", _PC_PATH_MAX);
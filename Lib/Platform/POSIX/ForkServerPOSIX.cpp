@@ -0,0 +1,356 @@
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/ForkServer.h"
+#include "WAVM/Platform/Mutex.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// A job is sent as a U64 number of bytes, along with the client's standard input, output, and
+// error, followed by that many bytes that encode the arguments and environment variables. The
+// job's process replies with its I32 exit code.
+static constexpr Uptr numJobFDs = 3;
+static constexpr U64 maxJobBytes = 16 * 1024 * 1024;
+
+// MacOS doesn't support MSG_NOSIGNAL, so sockets that may be written after the other end closes
+// them set SO_NOSIGPIPE instead.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static bool writeAll(int fd, const void* data, Uptr numBytes)
+{
+	// All the file descriptors that are written are sockets, so use send with MSG_NOSIGNAL to
+	// return an error instead of raising SIGPIPE if the other end has been closed.
+	const U8* bytes = (const U8*)data;
+	while(numBytes)
+	{
+		const ssize_t result = send(fd, bytes, numBytes, MSG_NOSIGNAL);
+		if(result < 0)
+		{
+			if(errno == EINTR) { continue; }
+			return false;
+		}
+		bytes += result;
+		numBytes -= Uptr(result);
+	}
+	return true;
+}
+
+static bool readAll(int fd, void* data, Uptr numBytes)
+{
+	U8* bytes = (U8*)data;
+	while(numBytes)
+	{
+		const ssize_t result = read(fd, bytes, numBytes);
+		if(result < 0)
+		{
+			if(errno == EINTR) { continue; }
+			return false;
+		}
+		if(result == 0) { return false; }
+		bytes += result;
+		numBytes -= Uptr(result);
+	}
+	return true;
+}
+
+static bool initSocketAddress(const std::string& socketPath, sockaddr_un& outAddress)
+{
+	memset(&outAddress, 0, sizeof(outAddress));
+	outAddress.sun_family = AF_UNIX;
+	if(socketPath.size() >= sizeof(outAddress.sun_path)) { return false; }
+	memcpy(outAddress.sun_path, socketPath.c_str(), socketPath.size() + 1);
+	return true;
+}
+
+static void appendStrings(std::vector<U8>& bytes, const std::vector<std::string>& strings)
+{
+	auto appendU32 = [&bytes](U32 value) {
+		bytes.insert(bytes.end(), (const U8*)&value, (const U8*)&value + sizeof(value));
+	};
+	appendU32(U32(strings.size()));
+	for(const std::string& string : strings)
+	{
+		appendU32(U32(string.size()));
+		bytes.insert(bytes.end(), string.begin(), string.end());
+	}
+}
+
+static bool decodeStrings(const std::vector<U8>& bytes,
+						  Uptr& inOutOffset,
+						  std::vector<std::string>& outStrings)
+{
+	auto decodeU32 = [&bytes, &inOutOffset](U32& outValue) {
+		if(bytes.size() - inOutOffset < sizeof(U32)) { return false; }
+		memcpy(&outValue, bytes.data() + inOutOffset, sizeof(U32));
+		inOutOffset += sizeof(U32);
+		return true;
+	};
+
+	U32 numStrings;
+	if(!decodeU32(numStrings)) { return false; }
+	for(U32 stringIndex = 0; stringIndex < numStrings; ++stringIndex)
+	{
+		U32 numChars;
+		if(!decodeU32(numChars) || bytes.size() - inOutOffset < numChars) { return false; }
+		outStrings.emplace_back((const char*)bytes.data() + inOutOffset, numChars);
+		inOutOffset += numChars;
+	}
+	return true;
+}
+
+// Receives a job on a connection, and replaces the calling process's standard input, output,
+// and error with the client's.
+static bool receiveJob(int connectionFD, ForkServerJob& outJob)
+{
+	U64 numJobBytes = 0;
+	iovec numJobBytesIOV;
+	numJobBytesIOV.iov_base = &numJobBytes;
+	numJobBytesIOV.iov_len = sizeof(numJobBytes);
+
+	alignas(cmsghdr) char controlBuffer[CMSG_SPACE(sizeof(int) * numJobFDs)];
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &numJobBytesIOV;
+	message.msg_iovlen = 1;
+	message.msg_control = controlBuffer;
+	message.msg_controllen = sizeof(controlBuffer);
+
+	ssize_t numReceivedBytes;
+	do
+	{
+		numReceivedBytes = recvmsg(connectionFD, &message, 0);
+	} while(numReceivedBytes < 0 && errno == EINTR);
+	if(numReceivedBytes <= 0) { return false; }
+
+	// Take the client's standard devices before checking the rest of the message, so they are
+	// closed if it is invalid.
+	const cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+	if(!controlMessage || controlMessage->cmsg_level != SOL_SOCKET
+	   || controlMessage->cmsg_type != SCM_RIGHTS
+	   || controlMessage->cmsg_len != CMSG_LEN(sizeof(int) * numJobFDs))
+	{ return false; }
+	int jobFDs[numJobFDs];
+	memcpy(jobFDs, CMSG_DATA(controlMessage), sizeof(jobFDs));
+	for(Uptr deviceIndex = 0; deviceIndex < numJobFDs; ++deviceIndex)
+	{
+		if(dup2(jobFDs[deviceIndex], int(deviceIndex)) < 0) { return false; }
+		if(jobFDs[deviceIndex] >= int(numJobFDs)) { close(jobFDs[deviceIndex]); }
+	}
+
+	if(Uptr(numReceivedBytes) != sizeof(numJobBytes)
+	   || (message.msg_flags & MSG_CTRUNC) || numJobBytes > maxJobBytes)
+	{ return false; }
+
+	std::vector<U8> jobBytes(static_cast<Uptr>(numJobBytes));
+	if(!readAll(connectionFD, jobBytes.data(), jobBytes.size())) { return false; }
+
+	Uptr offset = 0;
+	return decodeStrings(jobBytes, offset, outJob.args)
+		   && decodeStrings(jobBytes, offset, outJob.envs) && offset == jobBytes.size();
+}
+
+void Platform::serveForkServerJobs(const std::string& socketPath,
+								   const std::function<I32(ForkServerJob&&)>& runJob)
+{
+	sockaddr_un address;
+	if(!initSocketAddress(socketPath, address)) { return; }
+
+	const int listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listenFD < 0) { return; }
+	unlink(socketPath.c_str());
+	if(bind(listenFD, (const sockaddr*)&address, sizeof(address)) || listen(listenFD, SOMAXCONN))
+	{
+		close(listenFD);
+		return;
+	}
+
+	// Let the child processes be reaped automatically when they exit.
+	signal(SIGCHLD, SIG_IGN);
+
+	while(true)
+	{
+		const int connectionFD = accept(listenFD, nullptr, nullptr);
+		if(connectionFD < 0)
+		{
+			if(errno == EINTR || errno == ECONNABORTED) { continue; }
+			Errors::fatalf("accept failed: %s", strerror(errno));
+		}
+
+		const pid_t pid = fork();
+		if(pid == 0)
+		{
+			// Receive the job in the child process, so a slow client doesn't delay other jobs.
+			close(listenFD);
+			signal(SIGCHLD, SIG_DFL);
+			ForkServerJob job;
+			if(!receiveJob(connectionFD, job)) { _exit(EXIT_FAILURE); }
+
+			const I32 exitCode = runJob(std::move(job));
+			writeAll(connectionFD, &exitCode, sizeof(exitCode));
+			_exit(exitCode);
+		}
+		else if(pid < 0)
+		{
+			Errors::fatalf("fork failed: %s", strerror(errno));
+		}
+
+		close(connectionFD);
+	}
+}
+
+bool Platform::runForkServerJob(const std::string& socketPath,
+								const ForkServerJob& job,
+								I32& outExitCode)
+{
+	sockaddr_un address;
+	if(!initSocketAddress(socketPath, address)) { return false; }
+
+	const int connectionFD = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(connectionFD < 0) { return false; }
+	if(connect(connectionFD, (const sockaddr*)&address, sizeof(address)))
+	{
+		close(connectionFD);
+		return false;
+	}
+
+	std::vector<U8> jobBytes;
+	appendStrings(jobBytes, job.args);
+	appendStrings(jobBytes, job.envs);
+
+	// Send the number of job bytes along with the standard devices, then the job bytes.
+	U64 numJobBytes = jobBytes.size();
+	iovec numJobBytesIOV;
+	numJobBytesIOV.iov_base = &numJobBytes;
+	numJobBytesIOV.iov_len = sizeof(numJobBytes);
+
+	alignas(cmsghdr) char controlBuffer[CMSG_SPACE(sizeof(int) * numJobFDs)];
+	memset(controlBuffer, 0, sizeof(controlBuffer));
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &numJobBytesIOV;
+	message.msg_iovlen = 1;
+	message.msg_control = controlBuffer;
+	message.msg_controllen = sizeof(controlBuffer);
+
+	cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+	controlMessage->cmsg_level = SOL_SOCKET;
+	controlMessage->cmsg_type = SCM_RIGHTS;
+	controlMessage->cmsg_len = CMSG_LEN(sizeof(int) * numJobFDs);
+	const int jobFDs[numJobFDs] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+	memcpy(CMSG_DATA(controlMessage), jobFDs, sizeof(jobFDs));
+
+	ssize_t numSentBytes;
+	do
+	{
+		numSentBytes = sendmsg(connectionFD, &message, 0);
+	} while(numSentBytes < 0 && errno == EINTR);
+
+	const bool succeeded = Uptr(numSentBytes) == sizeof(numJobBytes)
+						   && writeAll(connectionFD, jobBytes.data(), jobBytes.size())
+						   && readAll(connectionFD, &outExitCode, sizeof(outExitCode));
+	close(connectionFD);
+	return succeeded;
+}
+
+// A request or response is sent to or from a helper process as a U64 number of bytes, followed by
+// that many bytes.
+struct Platform::HelperProcess
+{
+	pid_t pid;
+	int connectionFD;
+};
+
+static bool writeMessage(int fd, const std::vector<U8>& bytes)
+{
+	const U64 numBytes = bytes.size();
+	return writeAll(fd, &numBytes, sizeof(numBytes)) && writeAll(fd, bytes.data(), bytes.size());
+}
+
+static bool readMessage(int fd, std::vector<U8>& outBytes)
+{
+	U64 numBytes = 0;
+	if(!readAll(fd, &numBytes, sizeof(numBytes)) || numBytes > UINTPTR_MAX) { return false; }
+	outBytes.resize(Uptr(numBytes));
+	return readAll(fd, outBytes.data(), outBytes.size());
+}
+
+// The parent's ends of the connections to its helper processes. A helper process closes the ends
+// of the connections to the helpers that were forked before it, so they exit when the parent
+// closes them.
+static Platform::Mutex helperConnectionFDsMutex;
+static std::vector<int> helperConnectionFDs;
+
+HelperProcess* Platform::forkHelperProcess(
+	const std::function<std::vector<U8>(std::vector<U8>&&)>& handleRequest)
+{
+	int socketFDs[2];
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, socketFDs)) { return nullptr; }
+#ifdef SO_NOSIGPIPE
+	const int noSigPipe = 1;
+	setsockopt(socketFDs[0], SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+	setsockopt(socketFDs[1], SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+	Platform::Mutex::Lock helperConnectionFDsLock(helperConnectionFDsMutex);
+	const pid_t pid = fork();
+	if(pid == 0)
+	{
+		close(socketFDs[0]);
+		for(int connectionFD : helperConnectionFDs) { close(connectionFD); }
+
+		std::vector<U8> request;
+		while(readMessage(socketFDs[1], request))
+		{
+			if(!writeMessage(socketFDs[1], handleRequest(std::move(request)))) { break; }
+			request.clear();
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(socketFDs[1]);
+	if(pid < 0)
+	{
+		close(socketFDs[0]);
+		return nullptr;
+	}
+	helperConnectionFDs.push_back(socketFDs[0]);
+	return new HelperProcess{pid, socketFDs[0]};
+}
+
+void Platform::destroyHelperProcess(HelperProcess* helperProcess)
+{
+	{
+		Platform::Mutex::Lock helperConnectionFDsLock(helperConnectionFDsMutex);
+		helperConnectionFDs.erase(std::find(helperConnectionFDs.begin(),
+											helperConnectionFDs.end(),
+											helperProcess->connectionFD));
+	}
+
+	// Closing the connection makes the helper process exit once it has finished any request it
+	// was handling. A process that ignores SIGCHLD has its children reaped automatically, in which
+	// case waitpid fails with ECHILD.
+	close(helperProcess->connectionFD);
+	while(waitpid(helperProcess->pid, nullptr, 0) < 0 && errno == EINTR) {};
+	delete helperProcess;
+}
+
+bool Platform::callHelperProcess(HelperProcess* helperProcess,
+								 const std::vector<U8>& request,
+								 std::vector<U8>& outResponse)
+{
+	return writeMessage(helperProcess->connectionFD, request)
+		   && readMessage(helperProcess->connectionFD, outResponse);
+}
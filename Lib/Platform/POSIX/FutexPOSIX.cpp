@@ -0,0 +1,82 @@
+#include <errno.h>
+#include <time.h>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Futex.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+#ifdef __linux__
+bool Platform::isFutexSupported() { return true; }
+
+FutexWaitResult Platform::futexWait(const U32* address, U32 expectedValue, Time waitDuration)
+{
+	WAVM_ASSERT(!(reinterpret_cast<Uptr>(address) & 3));
+
+	// Use FUTEX_WAIT_BITSET with an absolute monotonic clock timeout, so the wait can be restarted
+	// with the same timeout if it is interrupted by a signal.
+	timespec untilTimeSpec;
+	timespec* untilTimeSpecPointer = nullptr;
+	if(!isInfinity(waitDuration))
+	{
+		const I128 untilTimeNS = getClockTime(Clock::monotonic).ns + waitDuration.ns;
+		untilTimeSpec.tv_sec = U64(untilTimeNS / 1000000000);
+		untilTimeSpec.tv_nsec = U64(untilTimeNS % 1000000000);
+		untilTimeSpecPointer = &untilTimeSpec;
+	}
+
+	while(true)
+	{
+		const long result = syscall(SYS_futex,
+									address,
+									FUTEX_WAIT_BITSET_PRIVATE,
+									expectedValue,
+									untilTimeSpecPointer,
+									nullptr,
+									FUTEX_BITSET_MATCH_ANY);
+		if(result == 0) { return FutexWaitResult::woken; }
+		else if(errno == EAGAIN)
+		{
+			return FutexWaitResult::notEqual;
+		}
+		else if(errno == ETIMEDOUT)
+		{
+			return FutexWaitResult::timedOut;
+		}
+		else if(errno != EINTR)
+		{
+			Errors::fatalf("futex(FUTEX_WAIT_BITSET_PRIVATE) failed: errno=%i", errno);
+		}
+	}
+}
+
+Uptr Platform::futexWake(const U32* address, Uptr numToWake)
+{
+	WAVM_ASSERT(!(reinterpret_cast<Uptr>(address) & 3));
+
+	const int clampedNumToWake = numToWake > Uptr(INT32_MAX) ? INT32_MAX : int(numToWake);
+	const long result = syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, clampedNumToWake);
+	if(result < 0) { Errors::fatalf("futex(FUTEX_WAKE_PRIVATE) failed: errno=%i", errno); }
+	return Uptr(result);
+}
+#else
+bool Platform::isFutexSupported() { return false; }
+
+FutexWaitResult Platform::futexWait(const U32* address, U32 expectedValue, Time waitDuration)
+{
+	WAVM_UNREACHABLE();
+}
+
+Uptr Platform::futexWake(const U32* address, Uptr numToWake) { WAVM_UNREACHABLE(); }
+#endif
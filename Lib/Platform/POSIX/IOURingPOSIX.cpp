@@ -0,0 +1,357 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <vector>
+#include "POSIXPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/File.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+// The number of submission queue entries in each thread's ring. The kernel makes the completion
+// queue twice as large.
+static constexpr U32 numRingSQEntries = 64;
+
+// An operation that has been queued on a ring, and hasn't been waited for yet.
+struct IOURingOp
+{
+	I32 result = 0;
+	bool isComplete = false;
+};
+
+struct IOURing
+{
+	IOURing();
+	~IOURing();
+
+	bool isValid() const { return ringFD >= 0; }
+
+	// Queues an operation, and returns the index of its IOURingOp.
+	U32 queueOp(U8 opcode, I32 fd, const void* address, U32 length, U64 offset, U32 flags);
+
+	// Waits for an operation to complete, and returns its result.
+	I32 waitForOp(U32 opIndex);
+
+	// Submits the queued operations to the kernel and handles any completions. If waitForOne is
+	// true and any operations haven't completed, waits for at least one of them to complete.
+	void poll(bool waitForOne);
+
+	Uptr getNumIncompleteOps() const { return numIncompleteOps; }
+
+private:
+	I32 ringFD = -1;
+
+	U8* sqRing = nullptr;
+	Uptr sqRingNumBytes = 0;
+	U8* cqRing = nullptr;
+	Uptr cqRingNumBytes = 0;
+	io_uring_sqe* sqes = nullptr;
+	Uptr sqesNumBytes = 0;
+
+	U32* sqHead;
+	U32* sqTail;
+	U32* sqArray;
+	U32 sqMask;
+	U32 numSQEntries;
+
+	U32* cqHead;
+	U32* cqTail;
+	io_uring_cqe* cqes;
+	U32 cqMask;
+	U32 numCQEntries;
+
+	// The number of SQEs that have been written, but not yet submitted to the kernel.
+	U32 numUnsubmittedSQEs = 0;
+
+	// The operations that have been queued, but not waited for. Each op's index is used as the
+	// user data of its SQE. There are never more incomplete ops than completion queue entries, so
+	// the completion queue can't overflow.
+	std::vector<IOURingOp> ops;
+	std::vector<U32> freeOpIndices;
+	Uptr numIncompleteOps = 0;
+
+	I32 enter(U32 numToSubmit, U32 minComplete, U32 flags);
+	void reapCompletions();
+	void unmap();
+};
+
+IOURing::IOURing()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ringFD = I32(syscall(__NR_io_uring_setup, numRingSQEntries, &params));
+	if(ringFD < 0) { return; }
+
+	numSQEntries = params.sq_entries;
+	numCQEntries = params.cq_entries;
+	sqRingNumBytes = params.sq_off.array + params.sq_entries * sizeof(U32);
+	cqRingNumBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	sqesNumBytes = params.sq_entries * sizeof(io_uring_sqe);
+
+	// Newer kernels map both rings with a single mmap.
+	const bool isSingleMMap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if(isSingleMMap)
+	{
+		sqRingNumBytes = std::max(sqRingNumBytes, cqRingNumBytes);
+		cqRingNumBytes = sqRingNumBytes;
+	}
+
+	void* sqRingMapping = mmap(nullptr,
+							   sqRingNumBytes,
+							   PROT_READ | PROT_WRITE,
+							   MAP_SHARED | MAP_POPULATE,
+							   ringFD,
+							   IORING_OFF_SQ_RING);
+	void* cqRingMapping = isSingleMMap ? sqRingMapping
+									   : mmap(nullptr,
+											  cqRingNumBytes,
+											  PROT_READ | PROT_WRITE,
+											  MAP_SHARED | MAP_POPULATE,
+											  ringFD,
+											  IORING_OFF_CQ_RING);
+	void* sqesMapping = mmap(nullptr,
+							 sqesNumBytes,
+							 PROT_READ | PROT_WRITE,
+							 MAP_SHARED | MAP_POPULATE,
+							 ringFD,
+							 IORING_OFF_SQES);
+	sqRing = sqRingMapping == MAP_FAILED ? nullptr : (U8*)sqRingMapping;
+	cqRing = cqRingMapping == MAP_FAILED ? nullptr : (U8*)cqRingMapping;
+	sqes = sqesMapping == MAP_FAILED ? nullptr : (io_uring_sqe*)sqesMapping;
+	if(!sqRing || !cqRing || !sqes)
+	{
+		unmap();
+		return;
+	}
+
+	sqHead = (U32*)(sqRing + params.sq_off.head);
+	sqTail = (U32*)(sqRing + params.sq_off.tail);
+	sqArray = (U32*)(sqRing + params.sq_off.array);
+	sqMask = *(U32*)(sqRing + params.sq_off.ring_mask);
+
+	cqHead = (U32*)(cqRing + params.cq_off.head);
+	cqTail = (U32*)(cqRing + params.cq_off.tail);
+	cqes = (io_uring_cqe*)(cqRing + params.cq_off.cqes);
+	cqMask = *(U32*)(cqRing + params.cq_off.ring_mask);
+}
+
+IOURing::~IOURing()
+{
+	// Wait for any operations that haven't completed, since the kernel may still access their
+	// buffers. They can only be left if a fiber was destroyed while it waited for one.
+	while(isValid() && numIncompleteOps) { poll(true); }
+	unmap();
+}
+
+void IOURing::unmap()
+{
+	if(sqes) { WAVM_ERROR_UNLESS(!munmap(sqes, sqesNumBytes)); }
+	if(cqRing && cqRing != sqRing) { WAVM_ERROR_UNLESS(!munmap(cqRing, cqRingNumBytes)); }
+	if(sqRing) { WAVM_ERROR_UNLESS(!munmap(sqRing, sqRingNumBytes)); }
+	if(ringFD >= 0) { close(ringFD); }
+	sqes = nullptr;
+	cqRing = nullptr;
+	sqRing = nullptr;
+	ringFD = -1;
+}
+
+I32 IOURing::enter(U32 numToSubmit, U32 minComplete, U32 flags)
+{
+	while(true)
+	{
+		const I32 result = I32(
+			syscall(__NR_io_uring_enter, ringFD, numToSubmit, minComplete, flags, nullptr, 0));
+		if(result >= 0 || errno != EINTR) { return result < 0 ? -errno : result; }
+	}
+}
+
+void IOURing::reapCompletions()
+{
+	U32 head = *cqHead;
+	const U32 tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	while(head != tail)
+	{
+		const io_uring_cqe& cqe = cqes[head & cqMask];
+		WAVM_ASSERT(cqe.user_data < ops.size());
+		IOURingOp& op = ops[Uptr(cqe.user_data)];
+		op.result = cqe.res;
+		op.isComplete = true;
+		--numIncompleteOps;
+		++head;
+	}
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+
+void IOURing::poll(bool waitForOne)
+{
+	const U32 minComplete = waitForOne && numIncompleteOps ? 1 : 0;
+	if(numUnsubmittedSQEs || minComplete)
+	{
+		const I32 result = enter(
+			numUnsubmittedSQEs, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0);
+		if(result < 0 && result != -EBUSY && result != -EAGAIN)
+		{ Errors::fatalf("io_uring_enter failed: %s", strerror(-result)); }
+		if(result > 0)
+		{
+			WAVM_ASSERT(U32(result) <= numUnsubmittedSQEs);
+			numUnsubmittedSQEs -= U32(result);
+		}
+	}
+	reapCompletions();
+}
+
+U32 IOURing::queueOp(U8 opcode, I32 fd, const void* address, U32 length, U64 offset, U32 flags)
+{
+	// If as many ops are incomplete as the completion queue can hold, wait for one to complete.
+	while(numIncompleteOps == numCQEntries) { poll(true); }
+
+	// If the submission queue is full, submit it to the kernel to make room.
+	while(*sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == numSQEntries) { poll(false); }
+
+	// Completed ops keep their slot until they are waited for, so there may be more ops than
+	// completion queue entries.
+	if(!freeOpIndices.size())
+	{
+		freeOpIndices.push_back(U32(ops.size()));
+		ops.emplace_back();
+	}
+	const U32 opIndex = freeOpIndices.back();
+	freeOpIndices.pop_back();
+	ops[opIndex] = IOURingOp();
+	++numIncompleteOps;
+
+	const U32 tail = *sqTail;
+	const U32 sqeIndex = tail & sqMask;
+	io_uring_sqe& sqe = sqes[sqeIndex];
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = opcode;
+	sqe.fd = fd;
+	sqe.addr = U64(reinterpret_cast<Uptr>(address));
+	sqe.len = length;
+	sqe.off = offset;
+	sqe.fsync_flags = flags;
+	sqe.user_data = opIndex;
+	sqArray[sqeIndex] = sqeIndex;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+	++numUnsubmittedSQEs;
+
+	return opIndex;
+}
+
+I32 IOURing::waitForOp(U32 opIndex)
+{
+	if(isCurrentFiberSuspendable())
+	{
+		// On a suspendable fiber, switch back to the code that resumed the fiber until the op
+		// completes. The op is submitted along with any other ops queued by fibers on this thread
+		// the next time one of them is resumed, or the thread calls pollIOURing. Other code waits
+		// for the op on the thread, since its caller doesn't expect it to switch away.
+		while(!ops[opIndex].isComplete)
+		{
+			switchFromFiber();
+			poll(false);
+		}
+	}
+	else
+	{
+		while(true)
+		{
+			poll(false);
+			if(ops[opIndex].isComplete) { break; }
+			poll(true);
+			if(ops[opIndex].isComplete) { break; }
+		}
+	}
+
+	const I32 result = ops[opIndex].result;
+	ops[opIndex].isComplete = false;
+	freeOpIndices.push_back(opIndex);
+	return result;
+}
+
+static IOURing* getThreadIOURing()
+{
+	thread_local IOURing ring;
+	return ring.isValid() ? &ring : nullptr;
+}
+
+bool Platform::isIOURingSupported()
+{
+	static const bool isSupported = getThreadIOURing() != nullptr;
+	return isSupported;
+}
+
+// Queues an operation on the thread's ring, and waits for it to complete.
+static I64 performIOURingOp(U8 opcode,
+							I32 fd,
+							const void* address,
+							U32 length,
+							U64 offset,
+							U32 flags)
+{
+	IOURing* ring = getThreadIOURing();
+	if(!ring) { return -ENOSYS; }
+	return ring->waitForOp(ring->queueOp(opcode, fd, address, length, offset, flags));
+}
+
+I64 Platform::ioURingReadv(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset)
+{
+	WAVM_ASSERT(numIOVs <= UINT32_MAX);
+	return performIOURingOp(
+		IORING_OP_READV, fd, iovs, U32(numIOVs), offset ? *offset : U64(-1), 0);
+}
+
+I64 Platform::ioURingWritev(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset)
+{
+	WAVM_ASSERT(numIOVs <= UINT32_MAX);
+	return performIOURingOp(
+		IORING_OP_WRITEV, fd, iovs, U32(numIOVs), offset ? *offset : U64(-1), 0);
+}
+
+I64 Platform::ioURingSync(I32 fd, bool onlyContents)
+{
+	return performIOURingOp(
+		IORING_OP_FSYNC, fd, nullptr, 0, 0, onlyContents ? IORING_FSYNC_DATASYNC : 0);
+}
+
+Uptr Platform::pollIOURing(bool waitForCompletion)
+{
+	IOURing* ring = getThreadIOURing();
+	if(!ring) { return 0; }
+	ring->poll(waitForCompletion);
+	return ring->getNumIncompleteOps();
+}
+
+#else
+
+bool Platform::isIOURingSupported() { return false; }
+
+I64 Platform::ioURingReadv(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset)
+{
+	return -ENOSYS;
+}
+
+I64 Platform::ioURingWritev(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset)
+{
+	return -ENOSYS;
+}
+
+I64 Platform::ioURingSync(I32 fd, bool onlyContents) { return -ENOSYS; }
+
+Uptr Platform::pollIOURing(bool waitForCompletion) { return 0; }
+
+#endif
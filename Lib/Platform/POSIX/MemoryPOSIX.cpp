@@ -1,8 +1,13 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 #include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
@@ -10,11 +15,26 @@
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 
 #ifdef __APPLE__
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_userfaultfd)
+#include <linux/userfaultfd.h>
+#include <sys/ioctl.h>
+#include <map>
+#define WAVM_HAS_USERFAULTFD 1
+#else
+#define WAVM_HAS_USERFAULTFD 0
+#endif
+
 using namespace WAVM;
 using namespace WAVM::Platform;
 
@@ -31,6 +51,32 @@ Uptr Platform::getBytesPerPageLog2()
 	return preferredVirtualPageSizeLog2;
 }
 
+static Uptr internalGetHugePageSizeLog2()
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// Read the size of a transparent huge page from sysfs. If transparent huge pages aren't
+	// supported by the kernel, the file won't exist.
+	FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+	if(!file) { return 0; }
+	unsigned long long hugePageSize = 0;
+	const int numScanned = fscanf(file, "%llu", &hugePageSize);
+	fclose(file);
+	if(numScanned != 1 || !hugePageSize || (hugePageSize & (hugePageSize - 1))) { return 0; }
+	return floorLogTwo(Uptr(hugePageSize));
+#else
+	return 0;
+#endif
+}
+Uptr Platform::getBytesPerHugePageLog2()
+{
+	static Uptr hugePageSizeLog2 = internalGetHugePageSizeLog2();
+	return hugePageSizeLog2;
+}
+
+static std::atomic<bool> hugePagesEnabled{false};
+void Platform::setHugePagesEnabled(bool enable) { hugePagesEnabled.store(enable); }
+bool Platform::getHugePagesEnabled() { return hugePagesEnabled.load(); }
+
 static U32 memoryAccessAsPOSIXFlag(MemoryAccess access)
 {
 	switch(access)
@@ -121,6 +167,14 @@ bool Platform::commitVirtualPages(U8* baseVirtualAddress, Uptr numPages, MemoryA
 				strerror(errno));
 		dumpErrorCallStack(0);
 	}
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	else if(access != MemoryAccess::none && getHugePagesEnabled() && getBytesPerHugePageLog2())
+	{
+		// Ask the kernel to back the committed pages with transparent huge pages. This is only a
+		// hint, so ignore any failure.
+		madvise(baseVirtualAddress, numPages << getBytesPerPageLog2(), MADV_HUGEPAGE);
+	}
+#endif
 	return result == 0;
 }
 
@@ -157,6 +211,82 @@ void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 	}
 }
 
+void Platform::discardVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	auto numBytes = numPages << getBytesPerPageLog2();
+#ifdef __linux__
+	// Linux frees private anonymous pages discarded by MADV_DONTNEED, and maps them to the zero
+	// page when they are next accessed. Unlike replacing the mapping, this keeps the pages' NUMA
+	// policy and huge page advice.
+	if(madvise(baseVirtualAddress, numBytes, MADV_DONTNEED))
+	{
+		Errors::fatalf("madvise(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", MADV_DONTNEED) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+#else
+	// Other POSIX systems may keep the contents of pages discarded by MADV_DONTNEED, so replace
+	// them with new zeroed pages.
+	if(mmap(baseVirtualAddress,
+			numBytes,
+			PROT_READ | PROT_WRITE,
+			MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+			-1,
+			0)
+	   == MAP_FAILED)
+	{
+		Errors::fatalf("mmap(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR
+					   ", PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) "
+					   "failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+#endif
+}
+
+#if defined(__linux__) && !defined(MREMAP_DONTUNMAP)
+#define MREMAP_DONTUNMAP 4
+#endif
+
+bool Platform::populateVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+#ifdef __linux__
+	// MADV_POPULATE_WRITE was added in Linux 5.14, and older kernels fail with EINVAL.
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+	return !madvise(baseVirtualAddress, numPages << getBytesPerPageLog2(), MADV_POPULATE_WRITE);
+#else
+	return false;
+#endif
+}
+
+bool Platform::moveVirtualPages(U8* destVirtualAddress, U8* sourceVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(destVirtualAddress));
+	WAVM_ERROR_UNLESS(isPageAligned(sourceVirtualAddress));
+#ifdef __linux__
+	// MREMAP_DONTUNMAP leaves the source pages mapped, so no other allocation can take their
+	// addresses before they are freed. It fails on kernels older than 5.7, and if the source pages
+	// span more than one mapping, in which case neither range is changed.
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	void* result = mremap(sourceVirtualAddress,
+						  numBytes,
+						  numBytes,
+						  MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP,
+						  destVirtualAddress);
+	if(result == MAP_FAILED) { return false; }
+	WAVM_ERROR_UNLESS(result == destVirtualAddress);
+	return true;
+#else
+	return false;
+#endif
+}
+
 void Platform::freeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
@@ -181,6 +311,591 @@ void Platform::freeAlignedVirtualPages(U8* unalignedBaseAddress, Uptr numPages,
 	}
 }
 
+struct Platform::PageSnapshot
+{
+	int fd;
+	Uptr numPages;
+};
+
+PageSnapshot* Platform::createPageSnapshot(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+
+	// Create an anonymous file to hold the snapshot, and write the pages' contents to it.
+	int fd = memfd_create("wavm-snapshot", MFD_CLOEXEC);
+	if(fd < 0) { return nullptr; }
+	if(ftruncate(fd, off_t(numBytes)))
+	{
+		close(fd);
+		return nullptr;
+	}
+	Uptr numWrittenBytes = 0;
+	while(numWrittenBytes < numBytes)
+	{
+		const ssize_t result = pwrite(fd,
+									  baseVirtualAddress + numWrittenBytes,
+									  numBytes - numWrittenBytes,
+									  off_t(numWrittenBytes));
+		if(result < 0 && errno == EINTR) { continue; }
+		if(result <= 0)
+		{
+			close(fd);
+			return nullptr;
+		}
+		numWrittenBytes += Uptr(result);
+	}
+
+	PageSnapshot* snapshot = new PageSnapshot{fd, numPages};
+
+	// Replace the pages with a private mapping of the file. Their contents are unchanged, but
+	// from now on they are copied from the file when they are written.
+	if(!mapPageSnapshot(snapshot, baseVirtualAddress))
+	{
+		destroyPageSnapshot(snapshot);
+		return nullptr;
+	}
+	return snapshot;
+#else
+	return nullptr;
+#endif
+}
+
+void Platform::destroyPageSnapshot(PageSnapshot* snapshot)
+{
+	WAVM_ERROR_UNLESS(!close(snapshot->fd));
+	delete snapshot;
+}
+
+Uptr Platform::getPageSnapshotNumPages(const PageSnapshot* snapshot) { return snapshot->numPages; }
+
+bool Platform::mapPageSnapshot(const PageSnapshot* snapshot, U8* baseVirtualAddress)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	const Uptr numBytes = snapshot->numPages << getBytesPerPageLog2();
+	void* result = mmap(baseVirtualAddress,
+						numBytes,
+						PROT_READ | PROT_WRITE,
+						MAP_FIXED | MAP_PRIVATE,
+						snapshot->fd,
+						0);
+	if(result == MAP_FAILED)
+	{
+		fprintf(stderr,
+				"mmap(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR
+				", PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, %d, 0) failed: %s\n",
+				reinterpret_cast<Uptr>(baseVirtualAddress),
+				numBytes,
+				snapshot->fd,
+				strerror(errno));
+		return false;
+	}
+	WAVM_ERROR_UNLESS(result == baseVirtualAddress);
+	return true;
+}
+
+#ifdef __linux__
+// Reads the kernel's page map for the pages mapped to a snapshot, and calls visitRun(pageIndex,
+// numPages) for each run of pages that have been written since they were mapped, until it returns
+// false. Pages that have been written are no longer backed by the snapshot file, so they are
+// either anonymous pages or swapped out. Pages that have never been touched are not present, and
+// still have the snapshot's contents. Returns false if the page map couldn't be read.
+template<typename VisitRun>
+static bool visitWrittenSnapshotPages(const PageSnapshot* snapshot,
+									  U8* baseVirtualAddress,
+									  VisitRun&& visitRun)
+{
+	static constexpr U64 pageMapPresentBit = U64(1) << 63;
+	static constexpr U64 pageMapSwappedBit = U64(1) << 62;
+	static constexpr U64 pageMapFileOrSharedBit = U64(1) << 61;
+
+	int pageMapFD = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if(pageMapFD < 0) { return false; }
+
+	const Uptr firstPageIndex = reinterpret_cast<Uptr>(baseVirtualAddress) >> getBytesPerPageLog2();
+	bool succeeded = true;
+	bool visitMore = true;
+	Uptr runPageIndex = 0;
+	Uptr runNumPages = 0;
+	U64 entries[512];
+	for(Uptr pageIndex = 0; pageIndex < snapshot->numPages && visitMore;)
+	{
+		const Uptr numEntries = std::min(Uptr(512), snapshot->numPages - pageIndex);
+		const ssize_t result = pread(pageMapFD,
+									 entries,
+									 numEntries * sizeof(U64),
+									 off_t((firstPageIndex + pageIndex) * sizeof(U64)));
+		if(result < 0 && errno == EINTR) { continue; }
+		if(result <= 0 || Uptr(result) % sizeof(U64))
+		{
+			succeeded = false;
+			break;
+		}
+
+		const Uptr numReadEntries = Uptr(result) / sizeof(U64);
+		for(Uptr entryIndex = 0; entryIndex < numReadEntries && visitMore; ++entryIndex)
+		{
+			const U64 entry = entries[entryIndex];
+			if((entry & pageMapSwappedBit)
+			   || ((entry & pageMapPresentBit) && !(entry & pageMapFileOrSharedBit)))
+			{
+				if(!runNumPages) { runPageIndex = pageIndex + entryIndex; }
+				++runNumPages;
+			}
+			else if(runNumPages)
+			{
+				visitMore = visitRun(runPageIndex, runNumPages);
+				runNumPages = 0;
+			}
+		}
+		pageIndex += numReadEntries;
+	}
+	if(succeeded && visitMore && runNumPages) { visitRun(runPageIndex, runNumPages); }
+
+	close(pageMapFD);
+	return succeeded;
+}
+#endif
+
+bool Platform::mayPageSnapshotMappingHaveChanged(const PageSnapshot* snapshot,
+												 U8* baseVirtualAddress)
+{
+#ifdef __linux__
+	bool hasChanged = false;
+	auto stopAtFirstRun = [&hasChanged](Uptr, Uptr) {
+		hasChanged = true;
+		return false;
+	};
+	return !visitWrittenSnapshotPages(snapshot, baseVirtualAddress, stopAtFirstRun) || hasChanged;
+#else
+	return true;
+#endif
+}
+
+// Discards the private copies of a range of pages that are mapped to a snapshot, so they read the
+// snapshot's contents again.
+static void discardSnapshotPageCopies(U8* baseVirtualAddress, Uptr numPages)
+{
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	if(madvise(baseVirtualAddress, numBytes, MADV_DONTNEED))
+	{
+		Errors::fatalf("madvise(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", MADV_DONTNEED) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+}
+
+Uptr Platform::resetPageSnapshotMapping(const PageSnapshot* snapshot, U8* baseVirtualAddress)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+#ifdef __linux__
+	// MADV_DONTNEED frees the private copies of written pages in a private file mapping, and the
+	// pages are read from the file again when they are next accessed. Only the written pages
+	// need to be discarded, which also keeps the pages that have only been read mapped.
+	Uptr numResetPages = 0;
+	auto discardRun = [baseVirtualAddress, &numResetPages](Uptr pageIndex, Uptr numPages) {
+		discardSnapshotPageCopies(baseVirtualAddress + (pageIndex << getBytesPerPageLog2()),
+								  numPages);
+		numResetPages += numPages;
+		return true;
+	};
+	if(visitWrittenSnapshotPages(snapshot, baseVirtualAddress, discardRun))
+	{ return numResetPages; }
+#endif
+
+	// If the written pages can't be found, discard all of the pages.
+	discardSnapshotPageCopies(baseVirtualAddress, snapshot->numPages);
+	return snapshot->numPages;
+}
+
+struct Platform::LazyPageMapping
+{
+	U8* baseAddress;
+	Uptr numPages;
+
+	// A read-only mapping of the snapshot file that pages are copied from.
+	const U8* snapshotPages;
+
+	// Guarded by LazyPageFaultHandler::mutex.
+	std::vector<Uptr> copiedPageIndices;
+};
+
+#if WAVM_HAS_USERFAULTFD
+// Copies pages to the process's lazy mappings when they are first accessed. A single userfaultfd
+// is registered for all the lazy mappings, and a thread reads their page faults from it.
+struct LazyPageFaultHandler
+{
+	int fd = -1;
+	Mutex mutex;
+	std::map<Uptr, LazyPageMapping*> mappingsByEndAddress;
+
+	static LazyPageFaultHandler* get()
+	{
+		static LazyPageFaultHandler* handler = create();
+		return handler;
+	}
+
+	// Copies a range of pages from the snapshot to a mapping. The copy stops at the first page
+	// that is already present, so returns the number of pages copied.
+	static Uptr copyPages(LazyPageFaultHandler* handler,
+						  LazyPageMapping* mapping,
+						  Uptr pageIndex,
+						  Uptr numPages)
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(handler->mutex);
+		const Uptr pageBytesLog2 = getBytesPerPageLog2();
+
+		Uptr numCopiedPages = 0;
+		while(numCopiedPages < numPages)
+		{
+			const Uptr offset = (pageIndex + numCopiedPages) << pageBytesLog2;
+			struct uffdio_copy copy;
+			copy.dst = reinterpret_cast<Uptr>(mapping->baseAddress + offset);
+			copy.src = reinterpret_cast<Uptr>(mapping->snapshotPages + offset);
+			copy.len = (numPages - numCopiedPages) << pageBytesLog2;
+			copy.mode = 0;
+			copy.copy = 0;
+			if(!ioctl(handler->fd, UFFDIO_COPY, &copy)) { return numPages; }
+
+			// If the copy was interrupted, continue after the pages that were copied.
+			const int error = errno;
+			if(copy.copy > 0) { numCopiedPages += Uptr(copy.copy) >> pageBytesLog2; }
+			if(error == EEXIST) { break; }
+			if(error != EAGAIN) { Errors::fatalf("ioctl(UFFDIO_COPY) failed: %s", strerror(error)); }
+		}
+		return numCopiedPages;
+	}
+
+private:
+	static LazyPageFaultHandler* create()
+	{
+		// Kernel mode faults must also be handled, since system calls may access the pages, so this
+		// fails if unprivileged userfaultfds are restricted to user mode faults.
+		const int fd = int(syscall(__NR_userfaultfd, O_CLOEXEC));
+		if(fd < 0) { return nullptr; }
+
+		struct uffdio_api api;
+		api.api = UFFD_API;
+		api.features = 0;
+		if(ioctl(fd, UFFDIO_API, &api))
+		{
+			close(fd);
+			return nullptr;
+		}
+
+		LazyPageFaultHandler* handler = new LazyPageFaultHandler;
+		handler->fd = fd;
+		detachThread(createThread(0, threadMain, handler));
+		return handler;
+	}
+
+	static I64 threadMain(void* argument)
+	{
+		LazyPageFaultHandler* handler = (LazyPageFaultHandler*)argument;
+		const Uptr pageBytesLog2 = getBytesPerPageLog2();
+		while(true)
+		{
+			struct uffd_msg message;
+			const ssize_t result = read(handler->fd, &message, sizeof(message));
+			if(result < 0 && (errno == EINTR || errno == EAGAIN)) { continue; }
+			WAVM_ERROR_UNLESS(result == sizeof(message));
+			if(message.event != UFFD_EVENT_PAGEFAULT) { continue; }
+
+			const Uptr address = Uptr(message.arg.pagefault.address);
+			Mutex::Lock lock(handler->mutex);
+			auto it = handler->mappingsByEndAddress.upper_bound(address);
+			WAVM_ERROR_UNLESS(it != handler->mappingsByEndAddress.end());
+			LazyPageMapping* mapping = it->second;
+			const Uptr mappingBaseAddress = reinterpret_cast<Uptr>(mapping->baseAddress);
+			WAVM_ERROR_UNLESS(address >= mappingBaseAddress);
+
+			const Uptr pageIndex = (address - mappingBaseAddress) >> pageBytesLog2;
+			if(copyPages(handler, mapping, pageIndex, 1))
+			{
+				mapping->copiedPageIndices.push_back(pageIndex);
+			}
+			else
+			{
+				// The page was copied for an earlier fault, which woke the threads waiting for it,
+				// but wake them again in case this fault raced with the copy.
+				struct uffdio_range range;
+				range.start = mappingBaseAddress + (pageIndex << pageBytesLog2);
+				range.len = Uptr(1) << pageBytesLog2;
+				WAVM_ERROR_UNLESS(!ioctl(handler->fd, UFFDIO_WAKE, &range));
+			}
+		}
+	}
+};
+#endif
+
+LazyPageMapping* Platform::mapPageSnapshotLazily(const PageSnapshot* snapshot,
+												  U8* baseVirtualAddress,
+												  const std::vector<Uptr>& prefetchPageIndices)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+#if WAVM_HAS_USERFAULTFD
+	LazyPageFaultHandler* handler = LazyPageFaultHandler::get();
+	if(!handler) { return nullptr; }
+
+	const Uptr numBytes = snapshot->numPages << getBytesPerPageLog2();
+	void* snapshotPages = mmap(nullptr, numBytes, PROT_READ, MAP_SHARED, snapshot->fd, 0);
+	if(snapshotPages == MAP_FAILED) { return nullptr; }
+
+	LazyPageMapping* mapping
+		= new LazyPageMapping{baseVirtualAddress, snapshot->numPages, (const U8*)snapshotPages, {}};
+
+	Mutex::Lock lock(handler->mutex);
+
+	struct uffdio_register registration;
+	registration.range.start = reinterpret_cast<Uptr>(baseVirtualAddress);
+	registration.range.len = numBytes;
+	registration.mode = UFFDIO_REGISTER_MODE_MISSING;
+	if(ioctl(handler->fd, UFFDIO_REGISTER, &registration))
+	{
+		lock.unlock();
+		munmap(snapshotPages, numBytes);
+		delete mapping;
+		return nullptr;
+	}
+	handler->mappingsByEndAddress.emplace(reinterpret_cast<Uptr>(baseVirtualAddress) + numBytes,
+										  mapping);
+
+	// Only accesses to pages that aren't present fault, so discard the pages.
+	if(madvise(baseVirtualAddress, numBytes, MADV_DONTNEED))
+	{
+		Errors::fatalf("madvise(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ", MADV_DONTNEED) failed: %s",
+					   reinterpret_cast<Uptr>(baseVirtualAddress),
+					   numBytes,
+					   strerror(errno));
+	}
+
+	// Copy the prefetched pages, coalescing runs of consecutive pages into a single copy.
+	std::vector<Uptr> sortedPrefetchPageIndices = prefetchPageIndices;
+	std::sort(sortedPrefetchPageIndices.begin(), sortedPrefetchPageIndices.end());
+	for(Uptr index = 0; index < sortedPrefetchPageIndices.size();)
+	{
+		const Uptr firstPageIndex = sortedPrefetchPageIndices[index];
+		if(firstPageIndex >= mapping->numPages) { break; }
+
+		Uptr endPageIndex = firstPageIndex + 1;
+		while(index < sortedPrefetchPageIndices.size()
+			  && sortedPrefetchPageIndices[index] <= endPageIndex
+			  && sortedPrefetchPageIndices[index] < mapping->numPages)
+		{
+			endPageIndex = sortedPrefetchPageIndices[index] + 1;
+			++index;
+		}
+
+		// Nothing has accessed the pages yet, so all of them are copied.
+		WAVM_ERROR_UNLESS(LazyPageFaultHandler::copyPages(
+							  handler, mapping, firstPageIndex, endPageIndex - firstPageIndex)
+						  == endPageIndex - firstPageIndex);
+		for(Uptr pageIndex = firstPageIndex; pageIndex < endPageIndex; ++pageIndex)
+		{ mapping->copiedPageIndices.push_back(pageIndex); }
+	}
+
+	return mapping;
+#else
+	return nullptr;
+#endif
+}
+
+void Platform::destroyLazyPageMapping(LazyPageMapping* mapping)
+{
+#if WAVM_HAS_USERFAULTFD
+	LazyPageFaultHandler* handler = LazyPageFaultHandler::get();
+	const Uptr numBytes = mapping->numPages << getBytesPerPageLog2();
+	{
+		Mutex::Lock lock(handler->mutex);
+		handler->mappingsByEndAddress.erase(reinterpret_cast<Uptr>(mapping->baseAddress)
+											+ numBytes);
+
+		// Unregistering fails if the pages have been unmapped, which also unregisters them.
+		struct uffdio_range range;
+		range.start = reinterpret_cast<Uptr>(mapping->baseAddress);
+		range.len = numBytes;
+		ioctl(handler->fd, UFFDIO_UNREGISTER, &range);
+	}
+	WAVM_ERROR_UNLESS(!munmap(const_cast<U8*>(mapping->snapshotPages), numBytes));
+#endif
+	delete mapping;
+}
+
+std::vector<Uptr> Platform::getLazyPageMappingCopiedPages(LazyPageMapping* mapping)
+{
+#if WAVM_HAS_USERFAULTFD
+	Mutex::Lock lock(LazyPageFaultHandler::get()->mutex);
+#endif
+	return mapping->copiedPageIndices;
+}
+
+bool Platform::mapFileVirtualPages(U8* baseVirtualAddress,
+								   Uptr numPages,
+								   Uptr hostHandle,
+								   U64 fileOffset,
+								   bool copyOnWrite)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	WAVM_ERROR_UNLESS(!(fileOffset & (getBytesPerPage() - 1)));
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	void* result = mmap(baseVirtualAddress,
+						numBytes,
+						copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ,
+						MAP_FIXED | MAP_PRIVATE,
+						int(hostHandle),
+						off_t(fileOffset));
+	if(result == MAP_FAILED)
+	{
+		// A failed MAP_FIXED mmap may have unmapped some of the pages, so map zeroed pages over
+		// them to make sure the range is still reserved.
+		if(mmap(baseVirtualAddress,
+				numBytes,
+				PROT_READ | PROT_WRITE,
+				MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+				-1,
+				0)
+		   == MAP_FAILED)
+		{
+			Errors::fatalf("mmap(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR
+						   ", PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, "
+						   "0) failed: %s",
+						   reinterpret_cast<Uptr>(baseVirtualAddress),
+						   numBytes,
+						   strerror(errno));
+		}
+		return false;
+	}
+	WAVM_ERROR_UNLESS(result == baseVirtualAddress);
+	return true;
+}
+
+bool Platform::setNUMAMemoryPolicy(U8* baseAddress, Uptr numBytes, Uptr node)
+{
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_set_mempolicy)
+	// The syscalls are used directly instead of through libnuma, so WAVM doesn't depend on it.
+	// They read maxNode - 1 bits from the node mask.
+	const Uptr numBitsPerWord = sizeof(unsigned long) * 8;
+	std::vector<unsigned long> nodeMask;
+	int mode = MPOL_DEFAULT;
+	if(node != UINTPTR_MAX)
+	{
+		if(node >= getNumNUMANodes()) { return false; }
+		nodeMask.resize(node / numBitsPerWord + 1, 0);
+		nodeMask[node / numBitsPerWord] |= 1ul << (node % numBitsPerWord);
+		mode = MPOL_PREFERRED;
+	}
+	const unsigned long maxNode = nodeMask.size() * numBitsPerWord + 1;
+
+	const long result
+		= baseAddress
+			  ? syscall(SYS_mbind, baseAddress, numBytes, mode, nodeMask.data(), maxNode, 0)
+			  : syscall(SYS_set_mempolicy, mode, nodeMask.data(), maxNode);
+	return result == 0;
+#else
+	return false;
+#endif
+}
+
+bool Platform::setVirtualPagesNUMANode(U8* baseVirtualAddress, Uptr numPages, Uptr node)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	return setNUMAMemoryPolicy(baseVirtualAddress, numPages << getBytesPerPageLog2(), node);
+}
+
+// Protection keys are only supported by Linux on x86-64, where the rights are in the PKRU register.
+#if defined(__linux__) && defined(__x86_64__) && defined(SYS_pkey_alloc)                           \
+	&& defined(SYS_pkey_free) && defined(SYS_pkey_mprotect)
+#define WAVM_HAS_PROTECTION_KEYS 1
+#else
+#define WAVM_HAS_PROTECTION_KEYS 0
+#endif
+
+static std::atomic<bool> hasAllocatedProtectionKey{false};
+
+bool Platform::areProtectionKeysInUse()
+{
+	return hasAllocatedProtectionKey.load(std::memory_order_relaxed);
+}
+
+I32 Platform::allocateMemoryProtectionKey()
+{
+#if WAVM_HAS_PROTECTION_KEYS
+	// pkey_alloc fails if the kernel doesn't support protection keys, or the CPU doesn't support
+	// them or has them disabled.
+	const long result = syscall(SYS_pkey_alloc, 0, 0);
+	if(result < 0) { return -1; }
+	hasAllocatedProtectionKey.store(true, std::memory_order_relaxed);
+	return I32(result);
+#else
+	return -1;
+#endif
+}
+
+void Platform::freeMemoryProtectionKey(I32 key)
+{
+#if WAVM_HAS_PROTECTION_KEYS
+	if(syscall(SYS_pkey_free, key))
+	{ Errors::fatalf("pkey_free(%d) failed: %s", key, strerror(errno)); }
+#else
+	WAVM_UNREACHABLE();
+#endif
+}
+
+bool Platform::setVirtualPagesProtectionKey(U8* baseVirtualAddress,
+											Uptr numPages,
+											MemoryAccess access,
+											I32 key)
+{
+#if WAVM_HAS_PROTECTION_KEYS
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	if(syscall(SYS_pkey_mprotect,
+			   baseVirtualAddress,
+			   numBytes,
+			   memoryAccessAsPOSIXFlag(access),
+			   key))
+	{
+		if(errno != ENOMEM)
+		{
+			Errors::fatalf("pkey_mprotect(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR
+						   ", %u, %d) failed: %s",
+						   reinterpret_cast<Uptr>(baseVirtualAddress),
+						   numBytes,
+						   memoryAccessAsPOSIXFlag(access),
+						   key,
+						   strerror(errno));
+		}
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+// The rdpkru and wrpkru instructions are emitted as bytes, so they don't need assembler support.
+U32 Platform::getProtectionKeyRights()
+{
+#if WAVM_HAS_PROTECTION_KEYS
+	U32 rights;
+	asm volatile(".byte 0x0f, 0x01, 0xee" : "=a"(rights) : "c"(0) : "rdx");
+	return rights;
+#else
+	WAVM_UNREACHABLE();
+#endif
+}
+
+void Platform::setProtectionKeyRights(U32 rights)
+{
+#if WAVM_HAS_PROTECTION_KEYS
+	asm volatile(".byte 0x0f, 0x01, 0xef" : : "a"(rights), "c"(0), "d"(0) : "memory");
+#else
+	WAVM_UNREACHABLE();
+#endif
+}
+
 Uptr Platform::getPeakMemoryUsageBytes()
 {
 	struct rusage ru;
@@ -192,3 +907,33 @@ Uptr Platform::getPeakMemoryUsageBytes()
 	return Uptr(ru.ru_maxrss) * 1024;
 #endif
 }
+
+Uptr Platform::getNumResidentVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+
+	// Query the pages in batches, so a huge reservation doesn't need a huge residency vector.
+	static constexpr Uptr maxPagesPerBatch = 4096;
+#ifdef __APPLE__
+	char residency[maxPagesPerBatch];
+#else
+	unsigned char residency[maxPagesPerBatch];
+#endif
+	Uptr numResidentPages = 0;
+	for(Uptr batchPageIndex = 0; batchPageIndex < numPages; batchPageIndex += maxPagesPerBatch)
+	{
+		const Uptr numBatchPages = std::min(maxPagesPerBatch, numPages - batchPageIndex);
+		if(mincore(baseVirtualAddress + (batchPageIndex << getBytesPerPageLog2()),
+				   numBatchPages << getBytesPerPageLog2(),
+				   residency))
+		{
+			Errors::fatalf("mincore(0x%" WAVM_PRIxPTR ", %" WAVM_PRIuPTR ") failed: %s",
+						   reinterpret_cast<Uptr>(baseVirtualAddress),
+						   numBatchPages << getBytesPerPageLog2(),
+						   strerror(errno));
+		}
+		for(Uptr pageIndex = 0; pageIndex < numBatchPages; ++pageIndex)
+		{ numResidentPages += residency[pageIndex] & 1; }
+	}
+	return numResidentPages;
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <setjmp.h>
+#include <sys/uio.h>
 #include <functional>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Platform/Signal.h"
+#include "WAVM/VFS/VFS.h"
 
 #ifdef __WAVIX__
 // libunwind dynamic frame registration
@@ -28,10 +30,18 @@ namespace WAVM { namespace Platform {
 
 	struct CallStack;
 
+	// Whether any memory protection keys have been allocated, in which case signal handlers reset
+	// the thread's protection key rights, and catching a signal must restore them.
+	bool areProtectionKeysInUse();
+
 	struct SignalContext
 	{
 		SignalContext* outerContext;
-		jmp_buf catchJump;
+
+		// The state to jump back to if a signal is caught. Points to a jmp_buf on the stack of the
+		// innermost catchSignals or catchSignalsInScope call that uses the context.
+		sigjmp_buf* catchJump;
+
 		bool (*filter)(void*, Signal, CallStack&&);
 		void* filterArgument;
 	};
@@ -71,5 +81,25 @@ namespace WAVM { namespace Platform {
 	}
 
 	void dumpErrorCallStack(Uptr numOmittedFramesFromTop);
+
+	// Makes a range of pages, or the calling thread if baseAddress is null, prefer to allocate
+	// memory on a NUMA node, or restores the default NUMA policy if node is UINTPTR_MAX.
+	bool setNUMAMemoryPolicy(U8* baseAddress, Uptr numBytes, Uptr node);
 	void getCurrentThreadStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr);
+
+	// Gets the stack of the fiber that is running on the calling thread. Returns false if the
+	// thread isn't running a fiber.
+	bool getCurrentFiberStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr);
+
+	// Translates an errno value to a VFS::Result.
+	VFS::Result asVFSResult(int error);
+
+	// Reads, writes, or syncs a file through the calling thread's io_uring. If offset is null, the
+	// file's current offset is used and updated. If called on a fiber, switches from the fiber
+	// until the operation completes. Returns the number of bytes read or written (or 0 for sync)
+	// on success, or a negated errno on failure. Returns -ENOSYS if io_uring isn't supported.
+	bool isIOURingSupported();
+	I64 ioURingReadv(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset);
+	I64 ioURingWritev(I32 fd, const struct iovec* iovs, Uptr numIOVs, const U64* offset);
+	I64 ioURingSync(I32 fd, bool onlyContents);
 }}
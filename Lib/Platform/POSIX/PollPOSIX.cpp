@@ -0,0 +1,426 @@
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+#include "POSIXPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Poll.h"
+#include "WAVM/VFS/VFS.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+struct Subscription
+{
+	Uptr userData;
+	PollEventType type;
+
+	// The host FD for read and write subscriptions. On Linux, the timerfd for timer subscriptions.
+	I32 fd;
+};
+
+struct Platform::Poller
+{
+	I32 pollFD = -1;
+	std::vector<Subscription> subscriptions;
+
+	// Events that are ready without waiting: VFDs the host can't wait on, and errors.
+	std::vector<PollEvent> readyEvents;
+};
+
+static void addReadyEvent(Poller* poller,
+						  Uptr userData,
+						  PollEventType type,
+						  VFS::Result result,
+						  U64 numBytesAvailable = 0)
+{
+	poller->readyEvents.push_back(PollEvent{userData, type, result, false, numBytesAvailable});
+}
+
+static U64 getNumBytesAvailable(I32 fd)
+{
+	int numBytes = 0;
+	if(ioctl(fd, FIONREAD, &numBytes) || numBytes < 0) { return 0; }
+	return U64(numBytes);
+}
+
+#if defined(__linux__)
+
+Poller* Platform::createPoller()
+{
+	Poller* poller = new Poller;
+	poller->pollFD = epoll_create1(EPOLL_CLOEXEC);
+	if(poller->pollFD < 0) { Errors::fatalf("epoll_create1 failed: errno=%i", errno); }
+	return poller;
+}
+
+void Platform::destroyPoller(Poller* poller)
+{
+	for(const Subscription& subscription : poller->subscriptions)
+	{
+		if(subscription.type == PollEventType::timer)
+		{ WAVM_ERROR_UNLESS(!close(subscription.fd)); }
+	}
+	WAVM_ERROR_UNLESS(!close(poller->pollFD));
+	delete poller;
+}
+
+static U32 getEPollEvents(PollEventType type)
+{
+	switch(type)
+	{
+	case PollEventType::timer:
+	case PollEventType::read: return EPOLLIN | EPOLLRDHUP;
+	case PollEventType::write: return EPOLLOUT;
+	default: WAVM_UNREACHABLE();
+	}
+}
+
+// Adds a subscription, and registers its FD with epoll for the union of the events of all the
+// subscriptions to the FD, since epoll only allows each FD to be registered once.
+static void addSubscription(Poller* poller, const Subscription& newSubscription)
+{
+	U32 events = 0;
+	for(const Subscription& subscription : poller->subscriptions)
+	{
+		if(subscription.fd == newSubscription.fd) { events |= getEPollEvents(subscription.type); }
+	}
+
+	epoll_event event;
+	event.events = events | getEPollEvents(newSubscription.type);
+	event.data.fd = newSubscription.fd;
+	const I32 op = events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if(epoll_ctl(poller->pollFD, op, newSubscription.fd, &event))
+	{
+		// epoll can't wait on regular files or directories, which are always ready.
+		if(errno == EPERM)
+		{
+			addReadyEvent(poller,
+						  newSubscription.userData,
+						  newSubscription.type,
+						  VFS::Result::success,
+						  newSubscription.type == PollEventType::read
+							  ? getNumBytesAvailable(newSubscription.fd)
+							  : 0);
+		}
+		else
+		{
+			addReadyEvent(
+				poller, newSubscription.userData, newSubscription.type, asVFSResult(errno));
+		}
+		return;
+	}
+
+	poller->subscriptions.push_back(newSubscription);
+}
+
+void Platform::addPollerVFD(Poller* poller, VFS::VFD* vfd, PollEventType type, Uptr userData)
+{
+	WAVM_ASSERT(type != PollEventType::timer);
+
+	Uptr handle = 0;
+	const VFS::Result result = vfd->getHostHandle(handle);
+	if(result != VFS::Result::success)
+	{
+		addReadyEvent(poller, userData, type, result);
+		return;
+	}
+
+	addSubscription(poller, Subscription{userData, type, I32(handle)});
+}
+
+bool Platform::addPollerTimer(Poller* poller, Clock clock, Time deadline, Uptr userData)
+{
+	clockid_t clockId;
+	switch(clock)
+	{
+	case Clock::realtime: clockId = CLOCK_REALTIME; break;
+	case Clock::monotonic: clockId = CLOCK_MONOTONIC; break;
+	case Clock::processCPUTime:
+	case Clock::threadCPUTime: return false;
+	default: WAVM_UNREACHABLE();
+	};
+
+	const I32 timerFD = timerfd_create(clockId, TFD_CLOEXEC);
+	if(timerFD < 0)
+	{
+		addReadyEvent(poller, userData, PollEventType::timer, asVFSResult(errno));
+		return true;
+	}
+
+	// A zero it_value disarms the timer, so round deadlines before the clock's origin up to 1ns.
+	const I128 deadlineNS = deadline.ns > 0 ? deadline.ns : I128(1);
+	itimerspec timerSpec{};
+	timerSpec.it_value.tv_sec = time_t(I64(deadlineNS / 1000000000));
+	timerSpec.it_value.tv_nsec = long(I64(deadlineNS % 1000000000));
+	WAVM_ERROR_UNLESS(!timerfd_settime(timerFD, TFD_TIMER_ABSTIME, &timerSpec, nullptr));
+
+	addSubscription(poller, Subscription{userData, PollEventType::timer, timerFD});
+	return true;
+}
+
+Uptr Platform::waitPoller(Poller* poller, PollEvent* outEvents, Uptr maxEvents)
+{
+	WAVM_ASSERT(poller->subscriptions.size() || poller->readyEvents.size());
+
+	Uptr numEvents = 0;
+	for(const PollEvent& readyEvent : poller->readyEvents)
+	{
+		if(numEvents == maxEvents) { return numEvents; }
+		outEvents[numEvents++] = readyEvent;
+	}
+
+	// If some events are already ready, don't block: just collect any others that are ready.
+	static constexpr Uptr maxEPollEvents = 64;
+	epoll_event epollEvents[maxEPollEvents];
+	I32 numEPollEvents;
+	do
+	{
+		numEPollEvents = epoll_wait(
+			poller->pollFD, epollEvents, I32(maxEPollEvents), numEvents ? 0 : -1);
+	} while(numEPollEvents < 0 && errno == EINTR);
+	if(numEPollEvents < 0) { Errors::fatalf("epoll_wait failed: errno=%i", errno); }
+
+	for(I32 epollEventIndex = 0; epollEventIndex < numEPollEvents; ++epollEventIndex)
+	{
+		const epoll_event& epollEvent = epollEvents[epollEventIndex];
+		const bool hangup = epollEvent.events & (EPOLLHUP | EPOLLRDHUP);
+		for(const Subscription& subscription : poller->subscriptions)
+		{
+			if(subscription.fd != epollEvent.data.fd) { continue; }
+
+			// Errors and hangups make subscriptions ready, so the guest finds out about them from
+			// its next read or write.
+			bool isReady = false;
+			U64 numBytesAvailable = 0;
+			switch(subscription.type)
+			{
+			case PollEventType::timer: isReady = epollEvent.events & EPOLLIN; break;
+			case PollEventType::read:
+				isReady = epollEvent.events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR);
+				if(isReady) { numBytesAvailable = getNumBytesAvailable(subscription.fd); }
+				break;
+			case PollEventType::write:
+				isReady = epollEvent.events & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+				break;
+			default: WAVM_UNREACHABLE();
+			};
+
+			if(isReady && numEvents < maxEvents)
+			{
+				outEvents[numEvents++] = PollEvent{subscription.userData,
+												   subscription.type,
+												   VFS::Result::success,
+												   hangup,
+												   numBytesAvailable};
+			}
+		}
+	}
+
+	return numEvents;
+}
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+
+Poller* Platform::createPoller()
+{
+	Poller* poller = new Poller;
+	poller->pollFD = kqueue();
+	if(poller->pollFD < 0) { Errors::fatalf("kqueue failed: errno=%i", errno); }
+	return poller;
+}
+
+void Platform::destroyPoller(Poller* poller)
+{
+	WAVM_ERROR_UNLESS(!close(poller->pollFD));
+	delete poller;
+}
+
+void Platform::addPollerVFD(Poller* poller, VFS::VFD* vfd, PollEventType type, Uptr userData)
+{
+	WAVM_ASSERT(type != PollEventType::timer);
+
+	Uptr handle = 0;
+	const VFS::Result result = vfd->getHostHandle(handle);
+	if(result != VFS::Result::success)
+	{
+		addReadyEvent(poller, userData, type, result);
+		return;
+	}
+
+	// kqueue identifies each registration by FD and filter, so subscribing to the same event twice
+	// only needs one registration.
+	const I32 fd = I32(handle);
+	for(const Subscription& subscription : poller->subscriptions)
+	{
+		if(subscription.fd == fd && subscription.type == type)
+		{
+			poller->subscriptions.push_back(Subscription{userData, type, fd});
+			return;
+		}
+	}
+
+	struct kevent change;
+	EV_SET(&change,
+		   uintptr_t(fd),
+		   type == PollEventType::read ? EVFILT_READ : EVFILT_WRITE,
+		   EV_ADD,
+		   0,
+		   0,
+		   nullptr);
+	if(kevent(poller->pollFD, &change, 1, nullptr, 0, nullptr))
+	{
+		// Some kinds of files can't be waited on, but are always ready.
+		if(errno == EINVAL || errno == EPERM)
+		{
+			addReadyEvent(poller,
+						  userData,
+						  type,
+						  VFS::Result::success,
+						  type == PollEventType::read ? getNumBytesAvailable(fd) : 0);
+		}
+		else
+		{
+			addReadyEvent(poller, userData, type, asVFSResult(errno));
+		}
+		return;
+	}
+
+	poller->subscriptions.push_back(Subscription{userData, type, fd});
+}
+
+bool Platform::addPollerTimer(Poller* poller, Clock clock, Time deadline, Uptr userData)
+{
+	if(clock == Clock::processCPUTime || clock == Clock::threadCPUTime) { return false; }
+
+	// kqueue timers are relative, so convert the deadline to a duration on the same clock. Timers
+	// are identified by the index of their subscription, which doesn't collide with the FDs since
+	// they use a different filter.
+	I128 durationNS = deadline.ns - getClockTime(clock).ns;
+	if(durationNS < 0) { durationNS = 0; }
+	else if(durationNS > INT64_MAX)
+	{
+		durationNS = INT64_MAX;
+	}
+	const Uptr subscriptionIndex = poller->subscriptions.size();
+	struct kevent change;
+	EV_SET(&change,
+		   uintptr_t(subscriptionIndex),
+		   EVFILT_TIMER,
+		   EV_ADD | EV_ONESHOT,
+		   NOTE_NSECONDS,
+		   intptr_t(I64(durationNS)),
+		   nullptr);
+	if(kevent(poller->pollFD, &change, 1, nullptr, 0, nullptr))
+	{
+		addReadyEvent(poller, userData, PollEventType::timer, asVFSResult(errno));
+		return true;
+	}
+
+	poller->subscriptions.push_back(Subscription{userData, PollEventType::timer, -1});
+	return true;
+}
+
+Uptr Platform::waitPoller(Poller* poller, PollEvent* outEvents, Uptr maxEvents)
+{
+	WAVM_ASSERT(poller->subscriptions.size() || poller->readyEvents.size());
+
+	Uptr numEvents = 0;
+	for(const PollEvent& readyEvent : poller->readyEvents)
+	{
+		if(numEvents == maxEvents) { return numEvents; }
+		outEvents[numEvents++] = readyEvent;
+	}
+
+	// If some events are already ready, don't block: just collect any others that are ready.
+	static constexpr Uptr maxKEvents = 64;
+	struct kevent kevents[maxKEvents];
+	const timespec zeroTimeout{0, 0};
+	I32 numKEvents;
+	do
+	{
+		numKEvents = kevent(poller->pollFD,
+							nullptr,
+							0,
+							kevents,
+							I32(maxKEvents),
+							numEvents ? &zeroTimeout : nullptr);
+	} while(numKEvents < 0 && errno == EINTR);
+	if(numKEvents < 0) { Errors::fatalf("kevent failed: errno=%i", errno); }
+
+	for(I32 keventIndex = 0; keventIndex < numKEvents; ++keventIndex)
+	{
+		const struct kevent& event = kevents[keventIndex];
+		for(Uptr subscriptionIndex = 0; subscriptionIndex < poller->subscriptions.size();
+			++subscriptionIndex)
+		{
+			const Subscription& subscription = poller->subscriptions[subscriptionIndex];
+			bool matches = false;
+			switch(event.filter)
+			{
+			case EVFILT_TIMER:
+				matches = subscription.type == PollEventType::timer
+						  && subscriptionIndex == Uptr(event.ident);
+				break;
+			case EVFILT_READ:
+				matches = subscription.type == PollEventType::read
+						  && subscription.fd == I32(event.ident);
+				break;
+			case EVFILT_WRITE:
+				matches = subscription.type == PollEventType::write
+						  && subscription.fd == I32(event.ident);
+				break;
+			default: break;
+			};
+
+			if(matches && numEvents < maxEvents)
+			{
+				const VFS::Result result = (event.flags & EV_ERROR) ? asVFSResult(I32(event.data))
+																	: VFS::Result::success;
+				outEvents[numEvents++] = PollEvent{
+					subscription.userData,
+					subscription.type,
+					result,
+					(event.flags & EV_EOF) != 0,
+					subscription.type == PollEventType::read && !(event.flags & EV_ERROR)
+						? U64(event.data)
+						: 0};
+			}
+		}
+	}
+
+	return numEvents;
+}
+
+#else
+
+Poller* Platform::createPoller() { Errors::unimplemented("createPoller"); }
+void Platform::destroyPoller(Poller* poller) { Errors::unimplemented("destroyPoller"); }
+void Platform::addPollerVFD(Poller* poller, VFS::VFD* vfd, PollEventType type, Uptr userData)
+{
+	Errors::unimplemented("addPollerVFD");
+}
+bool Platform::addPollerTimer(Poller* poller, Clock clock, Time deadline, Uptr userData)
+{
+	Errors::unimplemented("addPollerTimer");
+}
+Uptr Platform::waitPoller(Poller* poller, PollEvent* outEvents, Uptr maxEvents)
+{
+	Errors::unimplemented("waitPoller");
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Platform/Random.h"
@@ -33,7 +36,7 @@ static void readDevRandom(U8* outRandomBytes, Uptr numBytes)
 
 #if 0 // __linux__
 #include <sys/random.h>
-void Platform::getCryptographicRNG(U8* outRandomBytes, Uptr numBytes)
+static void getOSRandomBytes(U8* outRandomBytes, Uptr numBytes)
 {
 	while(numBytes > 0)
 	{
@@ -55,8 +58,135 @@ void Platform::getCryptographicRNG(U8* outRandomBytes, Uptr numBytes)
 	};
 }
 #else
-void Platform::getCryptographicRNG(U8* outRandomBytes, Uptr numBytes)
+static void getOSRandomBytes(U8* outRandomBytes, Uptr numBytes)
 {
 	readDevRandom(outRandomBytes, numBytes);
 }
 #endif
+
+// Random bytes are generated in userspace from a ChaCha20 keystream keyed by the OS, so most calls
+// don't need a syscall. Each thread has its own generator, which uses fast key erasure: each refill
+// of the thread's buffer also generates the key for the next refill, and bytes are erased from the
+// buffer as they are returned, so the thread's current state doesn't reveal any earlier output.
+static constexpr Uptr chachaKeyWords = 8;
+static constexpr Uptr chachaBlockBytes = 64;
+static constexpr Uptr numBufferBytes = 16 * chachaBlockBytes;
+static constexpr U64 reseedIntervalBytes = 1024 * 1024;
+
+struct ThreadRNG
+{
+	U32 key[chachaKeyWords];
+	U8 buffer[numBufferBytes];
+	Uptr numBufferedBytes = 0;
+	U64 numBytesSinceSeed = 0;
+	U64 seedForkGeneration = 0;
+};
+
+static thread_local ThreadRNG threadRNG;
+
+// Incremented in the child process by fork, so the child's generators are reseeded instead of
+// returning the same bytes as the parent's.
+static std::atomic<U64> forkGeneration{1};
+
+static U32 rotateLeft(U32 value, U32 numBits)
+{
+	return (value << numBits) | (value >> (32 - numBits));
+}
+
+static void chachaQuarterRound(U32* state, Uptr a, Uptr b, Uptr c, Uptr d)
+{
+	state[a] += state[b];
+	state[d] = rotateLeft(state[d] ^ state[a], 16);
+	state[c] += state[d];
+	state[b] = rotateLeft(state[b] ^ state[c], 12);
+	state[a] += state[b];
+	state[d] = rotateLeft(state[d] ^ state[a], 8);
+	state[c] += state[d];
+	state[b] = rotateLeft(state[b] ^ state[c], 7);
+}
+
+// Computes a ChaCha20 (RFC 8439) keystream block with the given key and block counter, and a zero
+// nonce.
+static void computeChachaBlock(const U32* key, U32 counter, U8* outBlock)
+{
+	U32 input[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+	for(Uptr wordIndex = 0; wordIndex < chachaKeyWords; ++wordIndex)
+	{ input[4 + wordIndex] = key[wordIndex]; }
+	input[12] = counter;
+
+	U32 state[16];
+	memcpy(state, input, sizeof(state));
+	for(Uptr doubleRoundIndex = 0; doubleRoundIndex < 10; ++doubleRoundIndex)
+	{
+		chachaQuarterRound(state, 0, 4, 8, 12);
+		chachaQuarterRound(state, 1, 5, 9, 13);
+		chachaQuarterRound(state, 2, 6, 10, 14);
+		chachaQuarterRound(state, 3, 7, 11, 15);
+		chachaQuarterRound(state, 0, 5, 10, 15);
+		chachaQuarterRound(state, 1, 6, 11, 12);
+		chachaQuarterRound(state, 2, 7, 8, 13);
+		chachaQuarterRound(state, 3, 4, 9, 14);
+	};
+
+	for(Uptr wordIndex = 0; wordIndex < 16; ++wordIndex)
+	{
+		const U32 word = state[wordIndex] + input[wordIndex];
+		outBlock[wordIndex * 4 + 0] = U8(word);
+		outBlock[wordIndex * 4 + 1] = U8(word >> 8);
+		outBlock[wordIndex * 4 + 2] = U8(word >> 16);
+		outBlock[wordIndex * 4 + 3] = U8(word >> 24);
+	}
+}
+
+static void refillThreadRNG(ThreadRNG& rng)
+{
+	for(Uptr blockIndex = 0; blockIndex < numBufferBytes / chachaBlockBytes; ++blockIndex)
+	{ computeChachaBlock(rng.key, U32(blockIndex), rng.buffer + blockIndex * chachaBlockBytes); }
+
+	// Use the start of the keystream as the next key, and erase it from the buffer.
+	memcpy(rng.key, rng.buffer, sizeof(rng.key));
+	memset(rng.buffer, 0, sizeof(rng.key));
+	rng.numBufferedBytes = numBufferBytes - sizeof(rng.key);
+}
+
+static void seedThreadRNG(ThreadRNG& rng, U64 currentForkGeneration)
+{
+	getOSRandomBytes((U8*)rng.key, sizeof(rng.key));
+	memset(rng.buffer, 0, sizeof(rng.buffer));
+	rng.numBufferedBytes = 0;
+	rng.numBytesSinceSeed = 0;
+	rng.seedForkGeneration = currentForkGeneration;
+}
+
+void Platform::getCryptographicRNG(U8* outRandomBytes, Uptr numBytes)
+{
+	static const int atForkResult = pthread_atfork(
+		nullptr, nullptr, [] { forkGeneration.fetch_add(1, std::memory_order_relaxed); });
+	WAVM_ERROR_UNLESS(!atForkResult);
+
+	ThreadRNG& rng = threadRNG;
+	const U64 currentForkGeneration = forkGeneration.load(std::memory_order_relaxed);
+	if(rng.seedForkGeneration != currentForkGeneration)
+	{ seedThreadRNG(rng, currentForkGeneration); }
+
+	while(numBytes > 0)
+	{
+		if(!rng.numBufferedBytes)
+		{
+			if(rng.numBytesSinceSeed >= reseedIntervalBytes)
+			{ seedThreadRNG(rng, currentForkGeneration); }
+			refillThreadRNG(rng);
+		}
+
+		// Copy bytes from the end of the buffered keystream, and erase them from the buffer.
+		const Uptr numCopiedBytes = std::min(numBytes, rng.numBufferedBytes);
+		U8* bufferedBytes = rng.buffer + numBufferBytes - rng.numBufferedBytes;
+		memcpy(outRandomBytes, bufferedBytes, numCopiedBytes);
+		memset(bufferedBytes, 0, numCopiedBytes);
+
+		rng.numBufferedBytes -= numCopiedBytes;
+		rng.numBytesSinceSeed += numCopiedBytes;
+		outRandomBytes += numCopiedBytes;
+		numBytes -= numCopiedBytes;
+	};
+}
@@ -1,11 +1,15 @@
+#include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
 #include <unistd.h>
 #include <atomic>
 #include "POSIXPrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Memory.h"
 
 using namespace WAVM;
 using namespace WAVM::Platform;
@@ -68,7 +72,8 @@ static void maskSignals(int how)
 		U8* stackMinGuardAddr;
 		U8* stackMinAddr;
 		U8* stackMaxAddr;
-		sigAltStack.getNonSignalStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr);
+		if(!getCurrentFiberStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr))
+		{ sigAltStack.getNonSignalStack(stackMinGuardAddr, stackMinAddr, stackMaxAddr); }
 		signal.type = signalInfo->si_addr >= stackMinGuardAddr && signalInfo->si_addr < stackMaxAddr
 						  ? Signal::Type::stackOverflow
 						  : Signal::Type::accessViolation;
@@ -86,17 +91,19 @@ static void maskSignals(int how)
 	// the signal trampoline frame is returning from an ordinary call.
 	if(callStack.frames.size()) { callStack.frames[0].ip += 1; }
 
-	// Call the signal handlers, from innermost to outermost, until one returns true.
+	// Call the signal handlers, from innermost to outermost, until one returns true. Skip signal
+	// scopes that aren't in a call to catchSignalsInScope.
 	for(SignalContext* signalContext = innermostSignalContext; signalContext;
 		signalContext = signalContext->outerContext)
 	{
-		if(signalContext->filter(signalContext->filterArgument, signal, std::move(callStack)))
+		if(signalContext->catchJump
+		   && signalContext->filter(signalContext->filterArgument, signal, std::move(callStack)))
 		{
 			// siglongjmp won't unwind the stack, so manually call the CallStack destructor.
 			callStack.~CallStack();
 
 			// Jump back to the execution context that was saved in catchSignals.
-			siglongjmp(signalContext->catchJump, 1);
+			siglongjmp(*signalContext->catchJump, 1);
 		}
 	}
 
@@ -109,6 +116,23 @@ static void maskSignals(int how)
 	};
 }
 
+// Restores the state that the signal handler changed after it jumps back to catchSignals or
+// catchSignalsInScope. Linux runs signal handlers with the default protection key rights, so the
+// rights that the thread had when it called catchSignals are restored.
+static void resetSignalStateAfterHandler(bool restoreProtectionKeyRights, U32 protectionKeyRights)
+{
+	if(restoreProtectionKeyRights) { setProtectionKeyRights(protectionKeyRights); }
+
+#if defined(__APPLE__)
+	// On MacOS, it's necessary to call __sigreturn to restore the sigaltstack state after
+	// exiting the signal handler.
+	__sigreturn(nullptr, UC_RESET_ALT_STACK);
+#endif
+
+	// Unblock the signals that are blocked by the signal handler.
+	maskSignals(SIG_UNBLOCK);
+}
+
 bool Platform::initGlobalSignalsOnce()
 {
 	// Set the signal handler for the signals we want to intercept.
@@ -123,6 +147,73 @@ bool Platform::initGlobalSignalsOnce()
 	return true;
 }
 
+static std::atomic<void (*)(Uptr)> sampleHandler{nullptr};
+static std::atomic<Uptr> numRunningSampleHandlers{0};
+
+static Uptr getSignalContextIP(void* signalContext)
+{
+	const ucontext_t* context = (const ucontext_t*)signalContext;
+#if defined(__APPLE__) && defined(__x86_64__)
+	return Uptr(context->uc_mcontext->__ss.__rip);
+#elif defined(__APPLE__) && defined(__aarch64__)
+	return Uptr(context->uc_mcontext->__ss.__pc);
+#elif defined(__linux__) && defined(__x86_64__)
+	return Uptr(context->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__linux__) && defined(__aarch64__)
+	return Uptr(context->uc_mcontext.pc);
+#else
+	return 0;
+#endif
+}
+
+static void sampleSignalHandler(int, siginfo_t*, void* signalContext)
+{
+	const int savedErrno = errno;
+	numRunningSampleHandlers.fetch_add(1, std::memory_order_seq_cst);
+	void (*handler)(Uptr) = sampleHandler.load(std::memory_order_seq_cst);
+	if(handler) { (*handler)(getSignalContextIP(signalContext)); }
+	numRunningSampleHandlers.fetch_sub(1, std::memory_order_release);
+	errno = savedErrno;
+}
+
+bool Platform::startSampling(U32 samplesPerSecond, void (*inSampleHandler)(Uptr ip))
+{
+	WAVM_ASSERT(samplesPerSecond > 0);
+	void (*expectedSampleHandler)(Uptr) = nullptr;
+	if(!sampleHandler.compare_exchange_strong(expectedSampleHandler, inSampleHandler))
+	{ return false; }
+
+	// Restart interrupted system calls, so sampling doesn't make them fail with EINTR.
+	struct sigaction signalAction;
+	signalAction.sa_sigaction = sampleSignalHandler;
+	signalAction.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&signalAction.sa_mask);
+	WAVM_ERROR_UNLESS(!sigaction(SIGPROF, &signalAction, nullptr));
+
+	// ITIMER_PROF counts the CPU time used by all the process's threads, and sends SIGPROF to a
+	// running thread when it expires.
+	const U64 intervalMicroseconds = samplesPerSecond >= 1000000 ? 1 : 1000000 / samplesPerSecond;
+	struct itimerval timer;
+	timer.it_interval.tv_sec = time_t(intervalMicroseconds / 1000000);
+	timer.it_interval.tv_usec = suseconds_t(intervalMicroseconds % 1000000);
+	timer.it_value = timer.it_interval;
+	WAVM_ERROR_UNLESS(!setitimer(ITIMER_PROF, &timer, nullptr));
+
+	return true;
+}
+
+void Platform::stopSampling()
+{
+	struct itimerval timer = {};
+	WAVM_ERROR_UNLESS(!setitimer(ITIMER_PROF, &timer, nullptr));
+
+	// Leave the signal handler installed to ignore any SIGPROF that is still pending, but clear
+	// the sample handler and wait for any calls to it to return. The handler increments the count
+	// before loading the sample handler, so these use sequentially consistent order.
+	sampleHandler.store(nullptr, std::memory_order_seq_cst);
+	while(numRunningSampleHandlers.load(std::memory_order_seq_cst)) {};
+}
+
 bool Platform::catchSignals(void (*thunk)(void*),
 							bool (*filter)(void*, Signal, CallStack&&),
 							void* argument)
@@ -132,6 +223,8 @@ bool Platform::catchSignals(void (*thunk)(void*),
 	ScopedSignalContext signalContext;
 	signalContext.filter = filter;
 	signalContext.filterArgument = argument;
+	sigjmp_buf catchJump;
+	signalContext.catchJump = &catchJump;
 
 #ifdef __WAVIX__
 	Errors::unimplemented("Wavix catchSignals");
@@ -140,7 +233,9 @@ bool Platform::catchSignals(void (*thunk)(void*),
 	// the signal handler will jump back to here. Tell sigsetjmp not to save the signal mask, since
 	// that's quite expensive (a syscall). Instead, just unblock the signals that our handler blocks
 	// after handling those signals.
-	bool isReturningFromSignalHandler = sigsetjmp(signalContext.catchJump, 0) != 0;
+	const bool restoreProtectionKeyRights = areProtectionKeysInUse();
+	const U32 protectionKeyRights = restoreProtectionKeyRights ? getProtectionKeyRights() : 0;
+	bool isReturningFromSignalHandler = sigsetjmp(catchJump, 0) != 0;
 	if(!isReturningFromSignalHandler)
 	{
 		signalContext.link();
@@ -150,18 +245,86 @@ bool Platform::catchSignals(void (*thunk)(void*),
 	}
 	else
 	{
-#if defined(__APPLE__)
-		// On MacOS, it's necessary to call __sigreturn to restore the sigaltstack state after
-		// exiting the signal handler.
-		__sigreturn(nullptr, UC_RESET_ALT_STACK);
+		resetSignalStateAfterHandler(restoreProtectionKeyRights, protectionKeyRights);
+	}
 #endif
 
-		// Unblock the signals that are blocked by the signal handler.
-		maskSignals(SIG_UNBLOCK);
+	return isReturningFromSignalHandler;
+}
+
+struct Platform::SignalScope : SignalContext
+{
+};
+
+SignalScope* Platform::enterSignalScope(bool (*filter)(void*, Signal, CallStack&&),
+										void* filterArgument)
+{
+	initThreadAndGlobalSignals();
+
+	SignalScope* scope = new SignalScope;
+	scope->filter = filter;
+	scope->filterArgument = filterArgument;
+	scope->catchJump = nullptr;
+	scope->outerContext = innermostSignalContext;
+	innermostSignalContext = scope;
+	return scope;
+}
+
+void Platform::exitSignalScope(SignalScope* scope)
+{
+	WAVM_ERROR_UNLESS(innermostSignalContext == scope);
+	innermostSignalContext = scope->outerContext;
+	delete scope;
+}
+
+bool Platform::catchSignalsInScope(SignalScope* scope, void (*thunk)(void*), void* argument)
+{
+	if(innermostSignalContext != scope)
+	{
+		// If the scope isn't the innermost signal context, catching a signal would jump to the
+		// innermost context instead of this call, so catch signals in a new context.
+		struct FallbackContext
+		{
+			SignalScope* scope;
+			void (*thunk)(void*);
+			void* argument;
+		} fallbackContext{scope, thunk, argument};
+		return catchSignals(
+			[](void* contextVoid) {
+				FallbackContext& context = *(FallbackContext*)contextVoid;
+				(*context.thunk)(context.argument);
+			},
+			[](void* contextVoid, Signal signal, CallStack&& callStack) {
+				SignalScope* scope = ((FallbackContext*)contextVoid)->scope;
+				return (*scope->filter)(scope->filterArgument, signal, std::move(callStack));
+			},
+			&fallbackContext);
 	}
-#endif
 
+#ifdef __WAVIX__
+	Errors::unimplemented("Wavix catchSignalsInScope");
+#else
+	// Point the scope at this call's jmp_buf for the duration of the call, restoring the outer
+	// call's jmp_buf afterward even if the thunk throws a C++ exception.
+	struct ScopedCatchJump
+	{
+		SignalScope* scope;
+		sigjmp_buf* outerCatchJump;
+		~ScopedCatchJump() { scope->catchJump = outerCatchJump; }
+	} scopedCatchJump{scope, scope->catchJump};
+	sigjmp_buf catchJump;
+	scope->catchJump = &catchJump;
+
+	const bool restoreProtectionKeyRights = areProtectionKeysInUse();
+	const U32 protectionKeyRights = restoreProtectionKeyRights ? getProtectionKeyRights() : 0;
+	const bool isReturningFromSignalHandler = sigsetjmp(catchJump, 0) != 0;
+	if(!isReturningFromSignalHandler) { thunk(argument); }
+	else
+	{
+		resetSignalStateAfterHandler(restoreProtectionKeyRights, protectionKeyRights);
+	}
 	return isReturningFromSignalHandler;
+#endif
 }
 
 // The LLVM project libunwind implementation that WAVM uses matches the Apple ABI, which expects
@@ -2,6 +2,7 @@
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
+#include <stdio.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -11,6 +12,7 @@
 #include <cstring>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #if WAVM_ENABLE_ASAN
 #include <sanitizer/asan_interface.h>
@@ -18,6 +20,7 @@
 
 #ifdef __linux__
 #include <gnu/libc-version.h>
+#include <sys/syscall.h>
 #endif
 
 #include "POSIXPrivate.h"
@@ -211,8 +214,13 @@ void SigAltStack::init()
 			// the pages used by the sigaltstack that will catch stack overflows before they
 			// overwrite the sigaltstack.
 			// Touch each stack page from bottom to top to ensure that it has been mapped: Linux and
-			// possibly other OSes lazily grow the stack mapping as a guard page is hit.
-			touchStackPages(stackMinAddr, numBytesPerPage);
+			// possibly other OSes lazily grow the stack mapping as a guard page is hit. On Linux,
+			// only the main thread's stack grows lazily, so other threads skip touching their whole
+			// stack.
+#ifdef __linux__
+			if(getpid() == pid_t(syscall(SYS_gettid)))
+#endif
+			{ touchStackPages(stackMinAddr, numBytesPerPage); }
 
 			// Protect a page in between the sigaltstack and the rest of the stack.
 			U8* signalStackMaxAddr = stackMinAddr + sigAltStackNumBytes;
@@ -242,6 +250,15 @@ void SigAltStack::init()
 	}
 }
 
+void Platform::getCurrentStack(U8*& outMinAddr, U8*& outMaxAddr)
+{
+	U8* minGuardAddr;
+	if(getCurrentFiberStack(minGuardAddr, outMinAddr, outMaxAddr)) { return; }
+
+	initThreadAndGlobalSignals();
+	sigAltStack.getNonSignalStack(minGuardAddr, outMinAddr, outMaxAddr);
+}
+
 void SigAltStack::getNonSignalStack(U8*& outMinGuardAddr, U8*& outMinAddr, U8*& outMaxAddr)
 {
 	if(!base) { getThreadStack(pthread_self(), outMinGuardAddr, outMinAddr, outMaxAddr); }
@@ -305,4 +322,89 @@ I64 Platform::joinThread(Thread* thread)
 
 Uptr Platform::getNumberOfHardwareThreads() { return std::thread::hardware_concurrency(); }
 
+#ifdef __linux__
+// Reads a sysfs list of indices, like "0-3,8-11", into a vector. Returns false if the file
+// couldn't be read.
+static bool readSysfsIndexList(const char* path, std::vector<Uptr>& outIndices)
+{
+	FILE* file = fopen(path, "r");
+	if(!file) { return false; }
+
+	unsigned long first;
+	bool succeeded = false;
+	while(fscanf(file, "%lu", &first) == 1)
+	{
+		unsigned long last = first;
+		int separator = fgetc(file);
+		if(separator == '-')
+		{
+			if(fscanf(file, "%lu", &last) != 1) { break; }
+			separator = fgetc(file);
+		}
+		for(unsigned long index = first; index <= last; ++index) { outIndices.push_back(index); }
+
+		succeeded = true;
+		if(separator != ',') { break; }
+	};
+
+	fclose(file);
+	return succeeded;
+}
+
+static Uptr getNumNUMANodesImpl()
+{
+	std::vector<Uptr> nodes;
+	if(!readSysfsIndexList("/sys/devices/system/node/possible", nodes) || nodes.empty())
+	{ return 1; }
+	return nodes.back() + 1;
+}
+#endif
+
+Uptr Platform::getNumNUMANodes()
+{
+#ifdef __linux__
+	static Uptr cachedNumNUMANodes = getNumNUMANodesImpl();
+	return cachedNumNUMANodes;
+#else
+	return 1;
+#endif
+}
+
+bool Platform::bindCurrentThreadToNUMANode(Uptr node)
+{
+#ifdef __linux__
+	if(node >= getNumNUMANodes()) { return false; }
+
+	char cpuListPath[64];
+	snprintf(cpuListPath,
+			 sizeof(cpuListPath),
+			 "/sys/devices/system/node/node%" WAVM_PRIuPTR "/cpulist",
+			 node);
+	std::vector<Uptr> cpus;
+	if(!readSysfsIndexList(cpuListPath, cpus)) { return false; }
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for(Uptr cpu : cpus)
+	{
+		if(cpu < CPU_SETSIZE) { CPU_SET(cpu, &cpuSet); }
+	}
+	if(sched_setaffinity(0, sizeof(cpuSet), &cpuSet)) { return false; }
+
+	return setNUMAMemoryPolicy(nullptr, 0, node);
+#else
+	return false;
+#endif
+}
+
+void Platform::setCurrentThreadBackgroundPriority()
+{
+#if defined(__linux__)
+	// On Linux, the nice value is per-thread, and setpriority sets it for the thread ID.
+	setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), 10);
+#elif defined(__APPLE__)
+	pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+}
+
 void Platform::yieldToAnotherThread() { WAVM_ERROR_UNLESS(sched_yield() == 0); }
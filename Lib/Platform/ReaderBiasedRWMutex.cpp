@@ -0,0 +1,144 @@
+#include <atomic>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// Each thread that gets slots owns a cache line of them, so shared locks on different threads
+// don't write the same cache line. A thread needs a slot for each reader-biased mutex it holds a
+// shared lock on at once, and uses the underlying RWMutex if all its slots are in use.
+static constexpr Uptr numSlotsPerThread = 64 / sizeof(void*);
+static constexpr Uptr maxThreadsWithSlots = 256;
+
+// After revoking the bias, the mutex stays unbiased for this many times as long as the revocation
+// took, which bounds the time spent revoking to a fraction of the time spent exclusively locked.
+static constexpr U64 inhibitBiasMultiplier = 9;
+
+struct alignas(64) ThreadSlots
+{
+	std::atomic<ReaderBiasedRWMutex*> slots[numSlotsPerThread];
+};
+
+static ThreadSlots threadSlots[maxThreadsWithSlots];
+static std::atomic<U64> allocatedThreadSlotsMask[maxThreadsWithSlots / 64];
+
+// Allocates a thread's slots when it first takes a shared lock, and frees them when it exits.
+struct ThreadSlotsAllocation
+{
+	ThreadSlots* slots = nullptr;
+	Uptr index = 0;
+
+	ThreadSlotsAllocation()
+	{
+		for(Uptr maskIndex = 0; maskIndex < maxThreadsWithSlots / 64 && !slots; ++maskIndex)
+		{
+			U64 mask = allocatedThreadSlotsMask[maskIndex].load(std::memory_order_relaxed);
+			while(~mask)
+			{
+				const Uptr bitIndex = countTrailingZeroes(~mask);
+				if(allocatedThreadSlotsMask[maskIndex].compare_exchange_weak(
+					   mask, mask | (U64(1) << bitIndex), std::memory_order_acquire))
+				{
+					index = maskIndex * 64 + bitIndex;
+					slots = &threadSlots[index];
+					break;
+				}
+			}
+		}
+	}
+
+	~ThreadSlotsAllocation()
+	{
+		if(slots)
+		{
+			allocatedThreadSlotsMask[index / 64].fetch_and(~(U64(1) << (index % 64)),
+														   std::memory_order_release);
+		}
+	}
+};
+
+static thread_local ThreadSlotsAllocation threadSlotsAllocation;
+
+static U64 getMonotonicClockNS() { return U64(getClockTime(Clock::monotonic).ns); }
+
+void Platform::ReaderBiasedRWMutex::lock(LockShareability shareability)
+{
+	if(shareability == exclusive)
+	{
+		mutex.lock(exclusive);
+		if(isReaderBiased.load(std::memory_order_relaxed))
+		{
+			// Revoke the bias, and wait for the shared locks that were taken through slots to be
+			// unlocked. The seq_cst store and loads ensure that a concurrent shared lock either
+			// sees the bias was revoked, or stores its slot before it's checked here.
+			const U64 revokeStartNS = getMonotonicClockNS();
+			isReaderBiased.store(false, std::memory_order_seq_cst);
+			for(Uptr threadIndex = 0; threadIndex < maxThreadsWithSlots; ++threadIndex)
+			{
+				for(std::atomic<ReaderBiasedRWMutex*>& slot : threadSlots[threadIndex].slots)
+				{
+					while(slot.load(std::memory_order_seq_cst) == this) { yieldToAnotherThread(); }
+				}
+			}
+			const U64 revokeEndNS = getMonotonicClockNS();
+			inhibitBiasUntilNS.store(
+				revokeEndNS + (revokeEndNS - revokeStartNS) * inhibitBiasMultiplier,
+				std::memory_order_relaxed);
+		}
+	}
+	else
+	{
+		ThreadSlots* slots = threadSlotsAllocation.slots;
+		if(slots && isReaderBiased.load(std::memory_order_relaxed))
+		{
+			for(std::atomic<ReaderBiasedRWMutex*>& slot : slots->slots)
+			{
+				if(!slot.load(std::memory_order_relaxed))
+				{
+					// If the bias was revoked after storing the slot, the exclusive lock might not
+					// have seen it, so clear it and lock the underlying RWMutex.
+					slot.store(this, std::memory_order_seq_cst);
+					if(isReaderBiased.load(std::memory_order_seq_cst)) { return; }
+					slot.store(nullptr, std::memory_order_release);
+					break;
+				}
+			}
+		}
+
+		mutex.lock(shareable);
+
+		// Holding a shared lock on the underlying RWMutex means no exclusive lock is revoking the
+		// bias, so it's safe to restore it.
+		if(slots && !isReaderBiased.load(std::memory_order_relaxed)
+		   && getMonotonicClockNS() >= inhibitBiasUntilNS.load(std::memory_order_relaxed))
+		{ isReaderBiased.store(true, std::memory_order_relaxed); }
+	}
+}
+
+void Platform::ReaderBiasedRWMutex::unlock(LockShareability shareability)
+{
+	if(shareability == shareable)
+	{
+		// If the shared lock was taken through one of this thread's slots, clear it. The thread's
+		// shared locks on this mutex are interchangeable, so it doesn't matter which is cleared.
+		if(ThreadSlots* slots = threadSlotsAllocation.slots)
+		{
+			for(std::atomic<ReaderBiasedRWMutex*>& slot : slots->slots)
+			{
+				if(slot.load(std::memory_order_relaxed) == this)
+				{
+					slot.store(nullptr, std::memory_order_release);
+					return;
+				}
+			}
+		}
+	}
+
+	mutex.unlock(shareability);
+}
@@ -97,6 +97,16 @@ Time Platform::getClockTime(Clock clock)
 
 		return Time{fileTimeToI128(kernelTime) + fileTimeToI128(userTime)};
 	}
+	case Clock::threadCPUTime: {
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		WAVM_ERROR_UNLESS(
+			GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime));
+
+		return Time{fileTimeToI128(kernelTime) + fileTimeToI128(userTime)};
+	}
 	default: WAVM_UNREACHABLE();
 	};
 }
@@ -112,7 +122,34 @@ Time Platform::getClockResolution(Clock clock)
 		if(result == 0) { result = 1; }
 		return Time{I128(result)};
 	}
-	case Clock::processCPUTime: return Time{100};
+	case Clock::processCPUTime:
+	case Clock::threadCPUTime: return Time{100};
 	default: WAVM_UNREACHABLE();
 	};
 }
+
+Time Platform::getCoarseClockTime(Clock clock)
+{
+	if(clock == Clock::realtime)
+	{
+		FILETIME realtimeClock;
+		GetSystemTimeAsFileTime(&realtimeClock);
+
+		return Time{fileTimeToWAVMRealTime(realtimeClock)};
+	}
+	return getClockTime(clock);
+}
+
+Time Platform::getCoarseClockResolution(Clock clock)
+{
+	if(clock == Clock::realtime)
+	{
+		DWORD timeAdjustment;
+		DWORD timeIncrement;
+		BOOL isTimeAdjustmentDisabled;
+		WAVM_ERROR_UNLESS(
+			GetSystemTimeAdjustment(&timeAdjustment, &timeIncrement, &isTimeAdjustmentDisabled));
+		return Time{I128(U64(timeIncrement)) * 100};
+	}
+	return getClockResolution(clock);
+}
@@ -180,3 +180,15 @@ void Platform::printMemoryProfile()
 void Platform::registerVirtualAllocation(Uptr numBytes) { numCommittedPageBytes += numBytes; }
 
 void Platform::deregisterVirtualAllocation(Uptr numBytes) { numCommittedPageBytes -= numBytes; }
+
+bool Platform::enablePerfMap(PerfMapFormat format) { return format == PerfMapFormat::none; }
+PerfMapFormat Platform::getPerfMapFormat() { return PerfMapFormat::none; }
+
+void Platform::addPerfMapFunction(const char* name,
+								  const U8* code,
+								  Uptr numCodeBytes,
+								  const char* sourceFileName,
+								  const PerfMapLine* lines,
+								  Uptr numLines)
+{
+}
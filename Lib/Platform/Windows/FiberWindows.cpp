@@ -0,0 +1,114 @@
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+
+#define NOMINMAX
+#include <Windows.h>
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+static constexpr Uptr defaultFiberStackNumBytes = 1024 * 1024;
+
+struct Platform::Fiber
+{
+	LPVOID handle = nullptr;
+
+	void (*entry)(void*);
+	void* entryArgument;
+
+	// The fiber that was running when this fiber was switched to, and the Windows fiber handle to
+	// switch back to.
+	Fiber* resumerFiber = nullptr;
+	LPVOID resumerHandle = nullptr;
+
+	bool isRunning = false;
+	bool isFinished = false;
+
+	// Whether the switchToFiber call that is running the fiber allows it to switch back before
+	// its entry function returns.
+	bool isSuspendable = false;
+};
+
+static thread_local Platform::Fiber* currentFiber = nullptr;
+
+// The Windows fiber that the thread was converted to, so it can switch to other fibers.
+static thread_local LPVOID threadFiberHandle = nullptr;
+
+static VOID CALLBACK fiberEntry(LPVOID argument)
+{
+	Platform::Fiber* fiber = (Platform::Fiber*)argument;
+	(*fiber->entry)(fiber->entryArgument);
+
+	// Switch back to the resumer for the last time. The fiber is never switched to again.
+	fiber->isFinished = true;
+	SwitchToFiber(fiber->resumerHandle);
+	WAVM_UNREACHABLE();
+}
+
+Platform::Fiber* Platform::createFiber(Uptr numStackBytes, void (*entry)(void*), void* argument)
+{
+	if(!numStackBytes) { numStackBytes = defaultFiberStackNumBytes; }
+
+	Fiber* fiber = new Fiber;
+	fiber->entry = entry;
+	fiber->entryArgument = argument;
+	fiber->handle = CreateFiberEx(numStackBytes, numStackBytes, 0, fiberEntry, fiber);
+	if(!fiber->handle) { Errors::fatalf("CreateFiberEx failed: GetLastError=%x", GetLastError()); }
+	return fiber;
+}
+
+void Platform::destroyFiber(Fiber* fiber)
+{
+	WAVM_ERROR_UNLESS(!fiber->isRunning);
+	DeleteFiber(fiber->handle);
+	delete fiber;
+}
+
+void Platform::reserveFiberStacks(Uptr numStacks, Uptr numStackBytes)
+{
+	// CreateFiberEx always allocates a new stack, so stacks can't be reused.
+}
+
+bool Platform::switchToFiber(Fiber* fiber, bool isSuspendable)
+{
+	WAVM_ERROR_UNLESS(!fiber->isRunning && !fiber->isFinished);
+
+	if(currentFiber) { fiber->resumerHandle = currentFiber->handle; }
+	else
+	{
+		if(!threadFiberHandle)
+		{
+			threadFiberHandle = ConvertThreadToFiber(nullptr);
+			if(!threadFiberHandle)
+			{
+				Errors::fatalf("ConvertThreadToFiber failed: GetLastError=%x", GetLastError());
+			}
+		}
+		fiber->resumerHandle = threadFiberHandle;
+	}
+
+	fiber->resumerFiber = currentFiber;
+	fiber->isRunning = true;
+	fiber->isSuspendable = isSuspendable;
+	currentFiber = fiber;
+	SwitchToFiber(fiber->handle);
+	currentFiber = fiber->resumerFiber;
+	fiber->isRunning = false;
+	fiber->resumerFiber = nullptr;
+	fiber->resumerHandle = nullptr;
+
+	return fiber->isFinished;
+}
+
+void Platform::switchFromFiber()
+{
+	Fiber* fiber = currentFiber;
+	WAVM_ERROR_UNLESS(fiber);
+	SwitchToFiber(fiber->resumerHandle);
+}
+
+Platform::Fiber* Platform::getCurrentFiber() { return currentFiber; }
+
+bool Platform::isCurrentFiberSuspendable() { return currentFiber && currentFiber->isSuspendable; }
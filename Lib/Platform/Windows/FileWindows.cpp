@@ -265,13 +265,15 @@ struct WindowsFD : VFD
 			  DWORD inShareMode,
 			  DWORD inFlagsAndAttributes,
 			  bool inNonBlocking,
-			  VFDSync inImplicitSync)
+			  VFDSync inImplicitSync,
+			  bool inUseIOCP = false)
 	: handle(inHandle)
 	, desiredAccess(inDesiredAccess)
 	, shareMode(inShareMode)
 	, flagsAndAttributes(inFlagsAndAttributes)
 	, nonBlocking(inNonBlocking)
 	, syncLevel(inImplicitSync)
+	, useIOCP(inUseIOCP)
 	{
 		WAVM_ASSERT(handle != INVALID_HANDLE_VALUE);
 	}
@@ -288,6 +290,8 @@ struct WindowsFD : VFD
 	{
 		RWMutex::ShareableLock lock(mutex);
 
+		if(useIOCP) { return seekOverlapped(offset, origin, outAbsoluteOffset); }
+
 		DWORD windowsOrigin;
 		switch(origin)
 		{
@@ -322,16 +326,6 @@ struct WindowsFD : VFD
 		if(outNumBytesRead) { *outNumBytesRead = 0; }
 		if(numBuffers == 0) { return Result::success; }
 
-		// If there's an offset specified, translate it to an OVERLAPPED struct.
-		OVERLAPPED* overlapped = nullptr;
-		if(offset)
-		{
-			overlapped = (OVERLAPPED*)alloca(sizeof(OVERLAPPED));
-			overlapped->Offset = DWORD(*offset);
-			overlapped->OffsetHigh = DWORD(*offset >> 32);
-			overlapped->hEvent = nullptr;
-		}
-
 		// Count the number of bytes in all the buffers.
 		Uptr numBufferBytes = 0;
 		for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
@@ -346,7 +340,7 @@ struct WindowsFD : VFD
 
 		// If there's a single buffer, just use it directly. Otherwise, allocate a combined buffer.
 		if(numBuffers == 1)
-		{ return readImpl(buffers[0].data, numBufferBytesU32, overlapped, outNumBytesRead); }
+		{ return readImpl(buffers[0].data, numBufferBytesU32, offset, outNumBytesRead); }
 		else
 		{
 			U8* combinedBuffer = (U8*)malloc(numBufferBytes);
@@ -354,7 +348,7 @@ struct WindowsFD : VFD
 
 			Uptr numBytesRead = 0;
 			const Result result
-				= readImpl(combinedBuffer, numBufferBytesU32, overlapped, &numBytesRead);
+				= readImpl(combinedBuffer, numBufferBytesU32, offset, &numBytesRead);
 
 			if(result == Result::success)
 			{
@@ -392,16 +386,6 @@ struct WindowsFD : VFD
 		if(outNumBytesWritten) { *outNumBytesWritten = 0; }
 		if(numBuffers == 0) { return Result::success; }
 
-		// If there's an offset specified, translate it to an OVERLAPPED struct.
-		OVERLAPPED* overlapped = nullptr;
-		if(offset)
-		{
-			overlapped = (OVERLAPPED*)alloca(sizeof(OVERLAPPED));
-			overlapped->Offset = DWORD(*offset);
-			overlapped->OffsetHigh = DWORD(*offset >> 32);
-			overlapped->hEvent = nullptr;
-		}
-
 		// Count the number of bytes in all the buffers.
 		Uptr numBufferBytes = 0;
 		for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
@@ -416,7 +400,7 @@ struct WindowsFD : VFD
 
 		// If there's a single buffer, just use it directly. Otherwise, allocate a combined buffer.
 		if(numBuffers == 1)
-		{ return writeImpl(buffers[0].data, numBufferBytesU32, overlapped, outNumBytesWritten); }
+		{ return writeImpl(buffers[0].data, numBufferBytesU32, offset, outNumBytesWritten); }
 		else
 		{
 			U8* combinedBuffer = (U8*)malloc(numBufferBytes);
@@ -434,7 +418,7 @@ struct WindowsFD : VFD
 
 			// Do the write.
 			const Result result
-				= writeImpl(combinedBuffer, numBufferBytesU32, overlapped, outNumBytesWritten);
+				= writeImpl(combinedBuffer, numBufferBytesU32, offset, outNumBytesWritten);
 
 			// Free the combined buffer.
 			free(combinedBuffer);
@@ -489,6 +473,7 @@ struct WindowsFD : VFD
 				if(!CloseHandle(handle))
 				{ Errors::fatalf("CloseHandle failed: GetLastError()=%u", GetLastError()); }
 				handle = reopenedHandle;
+				completionPort.store(nullptr);
 			}
 			else
 			{
@@ -513,6 +498,23 @@ struct WindowsFD : VFD
 				   ? Result::success
 				   : asVFSResult(GetLastError());
 	}
+	virtual Result advise(U64 offset, U64 numBytes, FileAdvice advice) override
+	{
+		// Windows only takes access pattern hints when a file is opened, so ignore the advice.
+		return Result::success;
+	}
+	virtual Result allocate(U64 offset, U64 numBytes) override
+	{
+		if(offset + numBytes < offset) { return Result::exceededFileSizeLimit; }
+
+		// Extend the file to include the range if necessary. NTFS allocates the storage for
+		// the extended part of the file when its size is set.
+		FileInfo fileInfo;
+		const Result result = getFileInfo(fileInfo);
+		if(result != Result::success) { return result; }
+		if(offset + numBytes <= fileInfo.numBytes) { return Result::success; }
+		return setFileSize(offset + numBytes);
+	}
 	virtual Result setFileTimes(bool setLastAccessTime,
 								Time lastAccessTime,
 								bool setLastWriteTime,
@@ -570,6 +572,29 @@ struct WindowsFD : VFD
 		}
 	}
 
+	virtual Result getHostHandle(Uptr& outHandle) override
+	{
+		outHandle = reinterpret_cast<Uptr>(handle);
+		return Result::success;
+	}
+
+	// WindowsFD only wraps file handles, which are never sockets.
+	virtual Result recvv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 const SocketRecvFlags& flags,
+						 Uptr* outNumBytesReceived = nullptr,
+						 bool* outIsTruncated = nullptr) override
+	{
+		return Result::notSocket;
+	}
+	virtual Result sendv(const IOWriteBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesSent = nullptr) override
+	{
+		return Result::notSocket;
+	}
+	virtual Result shutdown(SocketShutdownType type) override { return Result::notSocket; }
+
 private:
 	Platform::RWMutex mutex;
 	HANDLE handle;
@@ -579,9 +604,40 @@ private:
 	bool nonBlocking;
 	VFDSync syncLevel;
 
+	// If true, the handle was opened for overlapped I/O, and reads and writes go through the
+	// calling thread's I/O completion port. The system doesn't keep track of the file pointer of
+	// overlapped handles, so the FD keeps track of it.
+	const bool useIOCP;
+	std::atomic<HANDLE> completionPort{nullptr};
+	std::atomic<U64> currentOffset{0};
+
+	Result seekOverlapped(I64 offset, SeekOrigin origin, U64* outAbsoluteOffset)
+	{
+		I64 originOffset;
+		switch(origin)
+		{
+		case SeekOrigin::begin: originOffset = 0; break;
+		case SeekOrigin::cur: originOffset = I64(currentOffset.load()); break;
+		case SeekOrigin::end: {
+			LARGE_INTEGER numFileBytes;
+			if(!GetFileSizeEx(handle, &numFileBytes)) { return asVFSResult(GetLastError()); }
+			originOffset = numFileBytes.QuadPart;
+			break;
+		}
+		default: WAVM_UNREACHABLE();
+		}
+
+		if(offset < 0 ? originOffset < -offset : originOffset > INT64_MAX - offset)
+		{ return Result::invalidOffset; }
+		currentOffset.store(U64(originOffset + offset));
+
+		if(outAbsoluteOffset) { *outAbsoluteOffset = U64(originOffset + offset); }
+		return Result::success;
+	}
+
 	Result readImpl(void* buffer,
 					U32 numBufferBytesU32,
-					OVERLAPPED* overlapped,
+					const U64* offset,
 					Uptr* outNumBytesRead)
 	{
 		// If the FD has implicit syncing before reads, do it.
@@ -591,9 +647,36 @@ private:
 			if(!FlushFileBuffers(handle)) { return asVFSResult(GetLastError()); }
 		}
 
+		if(useIOCP)
+		{
+			const U64 readOffset = offset ? *offset : currentOffset.load();
+			U32 numBytesRead = 0;
+			const DWORD error = iocpTransferFile(
+				false, handle, completionPort, buffer, numBufferBytesU32, readOffset, numBytesRead);
+			if(error != ERROR_SUCCESS)
+			{
+				return error == ERROR_NOT_ENOUGH_QUOTA ? Result::outOfMemory
+													   : asVFSResult(error);
+			}
+			if(!offset) { currentOffset.store(readOffset + numBytesRead); }
+
+			if(outNumBytesRead) { *outNumBytesRead = Uptr(numBytesRead); }
+			return Result::success;
+		}
+
+		// If there's an offset specified, translate it to an OVERLAPPED struct.
+		OVERLAPPED overlapped;
+		if(offset)
+		{
+			memset(&overlapped, 0, sizeof(overlapped));
+			overlapped.Offset = DWORD(*offset);
+			overlapped.OffsetHigh = DWORD(*offset >> 32);
+		}
+
 		// Do the read.
 		DWORD numBytesRead = 0;
-		if(!ReadFile(handle, buffer, numBufferBytesU32, &numBytesRead, overlapped))
+		if(!ReadFile(
+			   handle, buffer, numBufferBytesU32, &numBytesRead, offset ? &overlapped : nullptr))
 		{
 			// "The ReadFile function may fail with ERROR_NOT_ENOUGH_QUOTA, which means the calling
 			// process's buffer could not be page-locked."
@@ -609,17 +692,65 @@ private:
 
 	Result writeImpl(const void* buffer,
 					 U32 numBufferBytesU32,
-					 OVERLAPPED* overlapped,
+					 const U64* offset,
 					 Uptr* outNumBytesWritten)
 	{
-		// Do the write.
 		DWORD numBytesWritten = 0;
-		if(!WriteFile(handle, buffer, numBufferBytesU32, &numBytesWritten, overlapped))
+		if(useIOCP)
 		{
-			// "The WriteFile function may fail with ERROR_NOT_ENOUGH_QUOTA, which means the calling
-			// process's buffer could not be page-locked."
-			return GetLastError() == ERROR_NOT_ENOUGH_QUOTA ? Result::outOfMemory
-															: asVFSResult(GetLastError());
+			// Writes to a handle opened for appending go to the end of the file, which an
+			// overlapped write is told with an offset of all ones.
+			const bool isAppend = desiredAccess & FILE_APPEND_DATA;
+			const U64 writeOffset = isAppend ? UINT64_MAX : offset ? *offset : currentOffset.load();
+			U32 numBytesWrittenU32 = 0;
+			const DWORD error = iocpTransferFile(true,
+												 handle,
+												 completionPort,
+												 const_cast<void*>(buffer),
+												 numBufferBytesU32,
+												 writeOffset,
+												 numBytesWrittenU32);
+			if(error != ERROR_SUCCESS)
+			{
+				return error == ERROR_NOT_ENOUGH_QUOTA ? Result::outOfMemory
+													   : asVFSResult(error);
+			}
+			numBytesWritten = DWORD(numBytesWrittenU32);
+
+			if(isAppend)
+			{
+				LARGE_INTEGER numFileBytes;
+				if(!GetFileSizeEx(handle, &numFileBytes)) { return asVFSResult(GetLastError()); }
+				currentOffset.store(U64(numFileBytes.QuadPart));
+			}
+			else if(!offset)
+			{
+				currentOffset.store(writeOffset + numBytesWritten);
+			}
+		}
+		else
+		{
+			// If there's an offset specified, translate it to an OVERLAPPED struct.
+			OVERLAPPED overlapped;
+			if(offset)
+			{
+				memset(&overlapped, 0, sizeof(overlapped));
+				overlapped.Offset = DWORD(*offset);
+				overlapped.OffsetHigh = DWORD(*offset >> 32);
+			}
+
+			// Do the write.
+			if(!WriteFile(handle,
+						  buffer,
+						  numBufferBytesU32,
+						  &numBytesWritten,
+						  offset ? &overlapped : nullptr))
+			{
+				// "The WriteFile function may fail with ERROR_NOT_ENOUGH_QUOTA, which means the
+				// calling process's buffer could not be page-locked."
+				return GetLastError() == ERROR_NOT_ENOUGH_QUOTA ? Result::outOfMemory
+																: asVFSResult(GetLastError());
+			}
 		}
 
 		// If the FD has implicit syncing after writes, do it.
@@ -672,6 +803,16 @@ VFD* Platform::getStdFD(StdDevice device)
 	};
 }
 
+VFD* Platform::openHostHandle(Uptr handle)
+{
+	return new WindowsFD(reinterpret_cast<HANDLE>(handle),
+						 GENERIC_READ | GENERIC_WRITE,
+						 FILE_SHARE_READ | FILE_SHARE_WRITE,
+						 FILE_ATTRIBUTE_NORMAL,
+						 false,
+						 VFDSync::none);
+}
+
 struct WindowsFS : HostFS
 {
 	virtual Result open(const std::string& path,
@@ -696,16 +837,38 @@ struct WindowsFS : HostFS
 
 	static WindowsFS& get()
 	{
-		static WindowsFS windowsFS;
+		static WindowsFS windowsFS(false);
 		return windowsFS;
 	}
 
+	static WindowsFS& getIOCP()
+	{
+		static WindowsFS iocpWindowsFS(true);
+		return iocpWindowsFS;
+	}
+
 protected:
-	WindowsFS() {}
+	// If true, the files opened by this FS are opened for overlapped I/O, and use the calling
+	// thread's I/O completion port for reads and writes.
+	const bool useIOCP;
+
+	WindowsFS(bool inUseIOCP) : useIOCP(inUseIOCP) {}
 };
 
 HostFS& Platform::getHostFS() { return WindowsFS::get(); }
 
+HostFS* Platform::getIOURingHostFS() { return nullptr; }
+
+Uptr Platform::pollIOURing(bool waitForCompletion) { return 0; }
+
+HostFS* Platform::getIOCPHostFS() { return isIOCPSupported() ? &WindowsFS::getIOCP() : nullptr; }
+
+std::shared_ptr<VFS::FileSystem> Platform::openHostSandboxFS(const std::string& rootPath,
+															 bool useIOURing)
+{
+	return nullptr;
+}
+
 Result WindowsFS::open(const std::string& path,
 					   FileAccessMode accessMode,
 					   FileCreateMode createMode,
@@ -731,6 +894,7 @@ Result WindowsFS::open(const std::string& path,
 	// passed to some functions instead of a file handle.For more information, see the Remarks
 	// section.
 	flagsAndAttributes |= FILE_FLAG_BACKUP_SEMANTICS;
+	if(useIOCP) { flagsAndAttributes |= FILE_FLAG_OVERLAPPED; }
 
 	const DWORD writeOrAppend = flags.append ? FILE_APPEND_DATA : GENERIC_WRITE;
 	switch(accessMode)
@@ -762,8 +926,13 @@ Result WindowsFS::open(const std::string& path,
 								nullptr);
 	if(handle == INVALID_HANDLE_VALUE) { return asVFSResult(GetLastError()); }
 
-	outFD = new WindowsFD(
-		handle, desiredAccess, shareMode, flagsAndAttributes, flags.nonBlocking, flags.syncLevel);
+	outFD = new WindowsFD(handle,
+						  desiredAccess,
+						  shareMode,
+						  flagsAndAttributes,
+						  flags.nonBlocking,
+						  flags.syncLevel,
+						  useIOCP);
 	return Result::success;
 }
 
@@ -907,6 +1076,63 @@ Result WindowsFS::openDir(const std::string& path, DirEntStream*& outStream)
 	}
 }
 
+Result Platform::mapFile(const std::string& path, MappedFile& outMappedFile)
+{
+	// Convert the path from a UTF-8 VFS path (with /) to a UTF-16 Windows path (with \).
+	std::wstring windowsPath;
+	if(!getWindowsPath(path, windowsPath)) { return Result::invalidNameCharacter; }
+
+	HANDLE fileHandle = CreateFileW(windowsPath.c_str(),
+									GENERIC_READ,
+									FILE_SHARE_READ,
+									nullptr,
+									OPEN_EXISTING,
+									FILE_ATTRIBUTE_NORMAL,
+									nullptr);
+	if(fileHandle == INVALID_HANDLE_VALUE) { return asVFSResult(GetLastError()); }
+
+	Result result = Result::success;
+	LARGE_INTEGER numFileBytes;
+	if(!GetFileSizeEx(fileHandle, &numFileBytes)) { result = asVFSResult(GetLastError()); }
+	else if(U64(numFileBytes.QuadPart) > UINTPTR_MAX)
+	{
+		result = Result::outOfMemory;
+	}
+	else
+	{
+		// CreateFileMapping can't map an empty file, so represent it as an empty range without a
+		// mapping.
+		outMappedFile.bytes = nullptr;
+		outMappedFile.numBytes = Uptr(numFileBytes.QuadPart);
+		if(outMappedFile.numBytes)
+		{
+			HANDLE mappingHandle
+				= CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if(!mappingHandle) { result = asVFSResult(GetLastError()); }
+			else
+			{
+				outMappedFile.bytes
+					= (const U8*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+				if(!outMappedFile.bytes) { result = asVFSResult(GetLastError()); }
+
+				// The view stays valid after the mapping handle is closed.
+				if(!CloseHandle(mappingHandle))
+				{ Errors::fatalf("CloseHandle failed: GetLastError()=%u", GetLastError()); }
+			}
+		}
+	}
+
+	if(!CloseHandle(fileHandle))
+	{ Errors::fatalf("CloseHandle failed: GetLastError()=%u", GetLastError()); }
+
+	return result;
+}
+
+void Platform::unmapFile(const MappedFile& mappedFile)
+{
+	if(mappedFile.numBytes) { WAVM_ERROR_UNLESS(UnmapViewOfFile(mappedFile.bytes)); }
+}
+
 std::string Platform::getCurrentWorkingDirectory()
 {
 	wchar_t buffer[MAX_PATH];
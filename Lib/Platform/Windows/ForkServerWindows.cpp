@@ -0,0 +1,34 @@
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/ForkServer.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// Windows can't fork a process, so fork servers and helper processes aren't supported.
+void Platform::serveForkServerJobs(const std::string& socketPath,
+								   const std::function<I32(ForkServerJob&&)>& runJob)
+{
+}
+
+bool Platform::runForkServerJob(const std::string& socketPath,
+								const ForkServerJob& job,
+								I32& outExitCode)
+{
+	return false;
+}
+
+HelperProcess* Platform::forkHelperProcess(
+	const std::function<std::vector<U8>(std::vector<U8>&&)>& handleRequest)
+{
+	return nullptr;
+}
+
+void Platform::destroyHelperProcess(HelperProcess* helperProcess) { WAVM_UNREACHABLE(); }
+
+bool Platform::callHelperProcess(HelperProcess* helperProcess,
+								 const std::vector<U8>& request,
+								 std::vector<U8>& outResponse)
+{
+	WAVM_UNREACHABLE();
+}
@@ -0,0 +1,18 @@
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Futex.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// WakeByAddressSingle and WakeByAddressAll don't report how many threads they woke, which
+// memory.atomic.notify must return, so callers use their own wait lists on Windows.
+bool Platform::isFutexSupported() { return false; }
+
+FutexWaitResult Platform::futexWait(const U32* address, U32 expectedValue, Time waitDuration)
+{
+	WAVM_UNREACHABLE();
+}
+
+Uptr Platform::futexWake(const U32* address, Uptr numToWake) { WAVM_UNREACHABLE(); }
@@ -0,0 +1,239 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/File.h"
+#include "WindowsPrivate.h"
+
+#define NOMINMAX
+#include <Windows.h>
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+// The maximum number of completions that are dequeued from a port at once.
+static constexpr ULONG maxDequeuedCompletions = 64;
+
+// An overlapped operation that was started on a thread's completion port, and hasn't been waited
+// for yet.
+struct IOCPOp
+{
+	OVERLAPPED overlapped;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	bool isComplete = false;
+};
+
+struct IOCP
+{
+	IOCP();
+	~IOCP();
+
+	bool isValid() const { return port != nullptr; }
+
+	HANDLE getPort() const { return port; }
+
+	// Allocates an op for an operation on a file at an offset. The op's address doesn't change
+	// until it is freed, since the kernel writes to its OVERLAPPED until the operation completes.
+	IOCPOp& allocateOp(HANDLE file, U64 offset);
+	void freeOp(IOCPOp& op);
+
+	// Records that an op is waiting for a completion.
+	void startOp() { ++numIncompleteOps; }
+
+	// Dequeues any completions from the port. If waitForOne is true and any operations haven't
+	// completed, waits for at least one of them to complete.
+	void poll(bool waitForOne);
+
+	Uptr getNumIncompleteOps() const { return numIncompleteOps; }
+
+private:
+	HANDLE port = nullptr;
+
+	std::vector<std::unique_ptr<IOCPOp>> ops;
+	std::vector<IOCPOp*> freeOps;
+	Uptr numIncompleteOps = 0;
+};
+
+IOCP::IOCP() { port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1); }
+
+IOCP::~IOCP()
+{
+	// Wait for any operations that haven't completed, since the kernel may still write to their
+	// OVERLAPPED. They can only be left if a fiber was destroyed while it waited for one.
+	while(isValid() && numIncompleteOps) { poll(true); }
+	if(port && !CloseHandle(port))
+	{ Errors::fatalf("CloseHandle failed: GetLastError()=%u", GetLastError()); }
+}
+
+IOCPOp& IOCP::allocateOp(HANDLE file, U64 offset)
+{
+	if(!freeOps.size())
+	{
+		ops.emplace_back(new IOCPOp);
+		freeOps.push_back(ops.back().get());
+	}
+	IOCPOp& op = *freeOps.back();
+	freeOps.pop_back();
+
+	memset(&op.overlapped, 0, sizeof(op.overlapped));
+	op.overlapped.Offset = DWORD(offset);
+	op.overlapped.OffsetHigh = DWORD(offset >> 32);
+	op.file = file;
+	op.isComplete = false;
+	return op;
+}
+
+void IOCP::freeOp(IOCPOp& op) { freeOps.push_back(&op); }
+
+void IOCP::poll(bool waitForOne)
+{
+	if(!numIncompleteOps) { return; }
+
+	OVERLAPPED_ENTRY entries[maxDequeuedCompletions];
+	ULONG numEntries = 0;
+	if(!GetQueuedCompletionStatusEx(
+		   port, entries, maxDequeuedCompletions, &numEntries, waitForOne ? INFINITE : 0, FALSE))
+	{
+		if(GetLastError() == WAIT_TIMEOUT) { return; }
+		Errors::fatalf("GetQueuedCompletionStatusEx failed: GetLastError()=%u", GetLastError());
+	}
+
+	for(ULONG entryIndex = 0; entryIndex < numEntries; ++entryIndex)
+	{
+		IOCPOp* op = CONTAINING_RECORD(entries[entryIndex].lpOverlapped, IOCPOp, overlapped);
+		WAVM_ASSERT(!op->isComplete);
+		op->isComplete = true;
+		--numIncompleteOps;
+	}
+}
+
+static IOCP* getThreadIOCP()
+{
+	thread_local IOCP iocp;
+	return iocp.isValid() ? &iocp : nullptr;
+}
+
+bool Platform::isIOCPSupported()
+{
+	static const bool isSupported = getThreadIOCP() != nullptr;
+	return isSupported;
+}
+
+// Returns the result of a completed overlapped operation. Reads at or past the end of the file
+// complete with ERROR_HANDLE_EOF, which is translated to reading 0 bytes.
+static DWORD getOverlappedOpResult(HANDLE file, OVERLAPPED& overlapped, U32& outNumBytes)
+{
+	DWORD numBytes = 0;
+	if(!GetOverlappedResult(file, &overlapped, &numBytes, FALSE))
+	{
+		outNumBytes = 0;
+		return GetLastError() == ERROR_HANDLE_EOF ? ERROR_SUCCESS : GetLastError();
+	}
+	outNumBytes = U32(numBytes);
+	return ERROR_SUCCESS;
+}
+
+static BOOL startOverlappedOp(bool isWrite,
+							  HANDLE file,
+							  void* buffer,
+							  U32 numBytes,
+							  OVERLAPPED& overlapped)
+{
+	return isWrite ? WriteFile(file, buffer, numBytes, nullptr, &overlapped)
+				   : ReadFile(file, buffer, numBytes, nullptr, &overlapped);
+}
+
+// Does an operation without the thread's completion port, by waiting for an event that the
+// operation signals when it completes. The low bit of the event handle is set, so the operation
+// doesn't queue a completion on a port that the file is associated with.
+static DWORD performEventOp(bool isWrite,
+							HANDLE file,
+							void* buffer,
+							U32 numBytes,
+							U64 offset,
+							U32& outNumBytes)
+{
+	thread_local HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if(!event) { return GetLastError(); }
+	WAVM_ERROR_UNLESS(ResetEvent(event));
+
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = DWORD(offset);
+	overlapped.OffsetHigh = DWORD(offset >> 32);
+	overlapped.hEvent = (HANDLE)(reinterpret_cast<Uptr>(event) | 1);
+	if(!startOverlappedOp(isWrite, file, buffer, numBytes, overlapped))
+	{
+		if(GetLastError() != ERROR_IO_PENDING)
+		{
+			outNumBytes = 0;
+			return GetLastError() == ERROR_HANDLE_EOF ? ERROR_SUCCESS : GetLastError();
+		}
+		if(WaitForSingleObject(event, INFINITE) != WAIT_OBJECT_0)
+		{ Errors::fatalf("WaitForSingleObject failed: GetLastError()=%u", GetLastError()); }
+	}
+	return getOverlappedOpResult(file, overlapped, outNumBytes);
+}
+
+DWORD Platform::iocpTransferFile(bool isWrite,
+								 HANDLE file,
+								 std::atomic<HANDLE>& inOutPort,
+								 void* buffer,
+								 U32 numBytes,
+								 U64 offset,
+								 U32& outNumBytes)
+{
+	// A file can only be associated with one completion port, so it is associated with the port
+	// of the first thread that uses it from a fiber. Operations on other threads, or that aren't
+	// on a suspendable fiber, wait for an event instead.
+	IOCP* iocp = isCurrentFiberSuspendable() ? getThreadIOCP() : nullptr;
+	if(iocp && !inOutPort.load(std::memory_order_acquire)
+	   && CreateIoCompletionPort(file, iocp->getPort(), 0, 0))
+	{
+		// Don't queue completions for operations that complete immediately, such as reads that
+		// are satisfied by the cache.
+		WAVM_ERROR_UNLESS(SetFileCompletionNotificationModes(
+			file, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE));
+		inOutPort.store(iocp->getPort(), std::memory_order_release);
+	}
+	if(!iocp || inOutPort.load(std::memory_order_acquire) != iocp->getPort())
+	{ return performEventOp(isWrite, file, buffer, numBytes, offset, outNumBytes); }
+
+	IOCPOp& op = iocp->allocateOp(file, offset);
+	if(!startOverlappedOp(isWrite, file, buffer, numBytes, op.overlapped))
+	{
+		if(GetLastError() != ERROR_IO_PENDING)
+		{
+			const DWORD error = GetLastError();
+			iocp->freeOp(op);
+			outNumBytes = 0;
+			return error == ERROR_HANDLE_EOF ? ERROR_SUCCESS : error;
+		}
+
+		// Switch back to the code that resumed the fiber until the operation completes. The
+		// completion is dequeued the next time one of the thread's fibers is resumed after it,
+		// or the thread calls pollIOCP.
+		iocp->startOp();
+		iocp->poll(false);
+		while(!op.isComplete)
+		{
+			switchFromFiber();
+			iocp->poll(false);
+		}
+	}
+
+	const DWORD error = getOverlappedOpResult(file, op.overlapped, outNumBytes);
+	iocp->freeOp(op);
+	return error;
+}
+
+Uptr Platform::pollIOCP(bool waitForCompletion)
+{
+	IOCP* iocp = getThreadIOCP();
+	if(!iocp) { return 0; }
+	iocp->poll(waitForCompletion);
+	return iocp->getNumIncompleteOps();
+}
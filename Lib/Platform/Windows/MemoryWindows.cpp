@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <atomic>
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
@@ -27,6 +29,17 @@ Uptr Platform::getBytesPerPageLog2()
 	return preferredVirtualPageSizeLog2;
 }
 
+Uptr Platform::getBytesPerHugePageLog2()
+{
+	// Windows large pages must be committed when they are reserved, and can't be paged out, so
+	// they can't back memory that is reserved up front and committed incrementally.
+	return 0;
+}
+
+static std::atomic<bool> hugePagesEnabled{false};
+void Platform::setHugePagesEnabled(bool enable) { hugePagesEnabled.store(enable); }
+bool Platform::getHugePagesEnabled() { return hugePagesEnabled.load(); }
+
 static U32 memoryAccessAsWin32Flag(MemoryAccess access)
 {
 	switch(access)
@@ -133,6 +146,32 @@ void Platform::decommitVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 	if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
 }
 
+void Platform::discardVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+
+	// DiscardVirtualMemory and MEM_RESET don't zero the pages, so decommit and recommit them.
+	const Uptr numBytes = numPages << getBytesPerPageLog2();
+	if(!VirtualFree(baseVirtualAddress, numBytes, MEM_DECOMMIT))
+	{ Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
+	if(VirtualAlloc(baseVirtualAddress, numBytes, MEM_COMMIT, PAGE_READWRITE) != baseVirtualAddress)
+	{ Errors::fatal("VirtualAlloc(MEM_COMMIT) failed"); }
+}
+
+bool Platform::populateVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
+
+	// Windows has no way to populate committed pages without touching them.
+	return false;
+}
+
+bool Platform::moveVirtualPages(U8* destVirtualAddress, U8* sourceVirtualAddress, Uptr numPages)
+{
+	// Windows can't move committed pages to a different address without copying them.
+	return false;
+}
+
 void Platform::freeVirtualPages(U8* baseVirtualAddress, Uptr numPages)
 {
 	WAVM_ERROR_UNLESS(isPageAligned(baseVirtualAddress));
@@ -147,6 +186,86 @@ void Platform::freeAlignedVirtualPages(U8* unalignedBaseAddress, Uptr numPages,
 	if(unalignedBaseAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 }
 
+// Mapping a file copy-on-write into address space reserved by VirtualAlloc requires placeholder
+// reservations, so snapshots aren't supported on Windows, and callers fall back to copying.
+struct Platform::PageSnapshot
+{
+};
+
+PageSnapshot* Platform::createPageSnapshot(U8* baseVirtualAddress, Uptr numPages)
+{
+	return nullptr;
+}
+
+void Platform::destroyPageSnapshot(PageSnapshot* snapshot) { WAVM_UNREACHABLE(); }
+
+Uptr Platform::getPageSnapshotNumPages(const PageSnapshot* snapshot) { WAVM_UNREACHABLE(); }
+
+bool Platform::mapPageSnapshot(const PageSnapshot* snapshot, U8* baseVirtualAddress)
+{
+	WAVM_UNREACHABLE();
+}
+
+bool Platform::mayPageSnapshotMappingHaveChanged(const PageSnapshot* snapshot,
+												 U8* baseVirtualAddress)
+{
+	WAVM_UNREACHABLE();
+}
+
+Uptr Platform::resetPageSnapshotMapping(const PageSnapshot* snapshot, U8* baseVirtualAddress)
+{
+	WAVM_UNREACHABLE();
+}
+
+struct Platform::LazyPageMapping
+{
+};
+
+LazyPageMapping* Platform::mapPageSnapshotLazily(const PageSnapshot* snapshot,
+												  U8* baseVirtualAddress,
+												  const std::vector<Uptr>& prefetchPageIndices)
+{
+	WAVM_UNREACHABLE();
+}
+
+void Platform::destroyLazyPageMapping(LazyPageMapping* mapping) { WAVM_UNREACHABLE(); }
+
+std::vector<Uptr> Platform::getLazyPageMappingCopiedPages(LazyPageMapping* mapping)
+{
+	WAVM_UNREACHABLE();
+}
+
+bool Platform::mapFileVirtualPages(U8* baseVirtualAddress,
+								   Uptr numPages,
+								   Uptr hostHandle,
+								   U64 fileOffset,
+								   bool copyOnWrite)
+{
+	return false;
+}
+
+bool Platform::setVirtualPagesNUMANode(U8* baseVirtualAddress, Uptr numPages, Uptr node)
+{
+	// Windows only lets the NUMA node be chosen when the address space is reserved.
+	return false;
+}
+
+I32 Platform::allocateMemoryProtectionKey() { return -1; }
+
+void Platform::freeMemoryProtectionKey(I32 key) { WAVM_UNREACHABLE(); }
+
+bool Platform::setVirtualPagesProtectionKey(U8* baseVirtualAddress,
+											Uptr numPages,
+											MemoryAccess access,
+											I32 key)
+{
+	return false;
+}
+
+U32 Platform::getProtectionKeyRights() { WAVM_UNREACHABLE(); }
+
+void Platform::setProtectionKeyRights(U32 rights) { WAVM_UNREACHABLE(); }
+
 Uptr Platform::getPeakMemoryUsageBytes()
 {
 	PROCESS_MEMORY_COUNTERS processMemoryCounters;
@@ -154,3 +273,27 @@ Uptr Platform::getPeakMemoryUsageBytes()
 		GetCurrentProcess(), &processMemoryCounters, sizeof(processMemoryCounters)));
 	return processMemoryCounters.PeakWorkingSetSize;
 }
+
+Uptr Platform::getNumResidentVirtualPages(U8* baseVirtualAddress, Uptr numPages)
+{
+	// Query the pages in batches, so a huge reservation doesn't need a huge working set vector.
+	static constexpr Uptr maxPagesPerBatch = 1024;
+	PSAPI_WORKING_SET_EX_INFORMATION workingSetInfos[maxPagesPerBatch];
+	Uptr numResidentPages = 0;
+	for(Uptr batchPageIndex = 0; batchPageIndex < numPages; batchPageIndex += maxPagesPerBatch)
+	{
+		const Uptr numBatchPages = std::min(maxPagesPerBatch, numPages - batchPageIndex);
+		for(Uptr pageIndex = 0; pageIndex < numBatchPages; ++pageIndex)
+		{
+			workingSetInfos[pageIndex].VirtualAddress
+				= baseVirtualAddress + ((batchPageIndex + pageIndex) << getBytesPerPageLog2());
+		}
+		WAVM_ERROR_UNLESS(
+			QueryWorkingSetEx(GetCurrentProcess(),
+							  workingSetInfos,
+							  DWORD(numBatchPages * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))));
+		for(Uptr pageIndex = 0; pageIndex < numBatchPages; ++pageIndex)
+		{ numResidentPages += workingSetInfos[pageIndex].VirtualAttributes.Valid; }
+	}
+	return numResidentPages;
+}
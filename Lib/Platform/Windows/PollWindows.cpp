@@ -0,0 +1,81 @@
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Poll.h"
+#include "WAVM/VFS/VFS.h"
+
+#define NOMINMAX
+#include <Windows.h>
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+struct Timer
+{
+	Clock clock;
+	Time deadline;
+	Uptr userData;
+};
+
+struct Platform::Poller
+{
+	std::vector<PollEvent> readyEvents;
+	std::vector<Timer> timers;
+};
+
+Poller* Platform::createPoller() { return new Poller; }
+void Platform::destroyPoller(Poller* poller) { delete poller; }
+
+void Platform::addPollerVFD(Poller* poller, VFS::VFD* vfd, PollEventType type, Uptr userData)
+{
+	// Windows file, pipe, and console handles can't be waited on for readiness, so treat them as
+	// always ready, like regular files.
+	WAVM_ASSERT(type != PollEventType::timer);
+	poller->readyEvents.push_back(PollEvent{userData, type, VFS::Result::success, false, 0});
+}
+
+bool Platform::addPollerTimer(Poller* poller, Clock clock, Time deadline, Uptr userData)
+{
+	if(clock == Clock::processCPUTime || clock == Clock::threadCPUTime) { return false; }
+	poller->timers.push_back(Timer{clock, deadline, userData});
+	return true;
+}
+
+Uptr Platform::waitPoller(Poller* poller, PollEvent* outEvents, Uptr maxEvents)
+{
+	WAVM_ASSERT(poller->timers.size() || poller->readyEvents.size());
+
+	Uptr numEvents = 0;
+	for(const PollEvent& readyEvent : poller->readyEvents)
+	{
+		if(numEvents == maxEvents) { return numEvents; }
+		outEvents[numEvents++] = readyEvent;
+	}
+
+	while(true)
+	{
+		// Report the timers that have reached their deadline, and find the earliest of the rest.
+		I128 minRemainingNS = I128::max();
+		for(const Timer& timer : poller->timers)
+		{
+			const I128 remainingNS = timer.deadline.ns - getClockTime(timer.clock).ns;
+			if(remainingNS > 0)
+			{
+				if(remainingNS < minRemainingNS) { minRemainingNS = remainingNS; }
+			}
+			else if(numEvents < maxEvents)
+			{
+				outEvents[numEvents++] = PollEvent{
+					timer.userData, PollEventType::timer, VFS::Result::success, false, 0};
+			}
+		}
+		if(numEvents || !poller->timers.size()) { return numEvents; }
+
+		// Sleep until the earliest timer, rounding up to the next millisecond.
+		const I128 sleepMS = (minRemainingNS + 999999) / 1000000;
+		Sleep(sleepMS >= I128(U32(INFINITE)) ? INFINITE - 1 : DWORD(U64(sleepMS)));
+	}
+}
@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <atomic>
 #include <functional>
+#include <map>
+#include <memory>
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/Signal.h"
 #include "WindowsPrivate.h"
 
@@ -13,15 +17,184 @@
 using namespace WAVM;
 using namespace WAVM::Platform;
 
+#ifdef _WIN64
+// The functions that register growable function tables are only declared by the Windows 8 SDK
+// headers, so they are looked up in ntdll. If they aren't available, each image's function table is
+// registered with RtlAddFunctionTable.
+typedef DWORD(NTAPI* RtlAddGrowableFunctionTablePointer)(PVOID* dynamicTable,
+														  PRUNTIME_FUNCTION functionTable,
+														  DWORD entryCount,
+														  DWORD maximumEntryCount,
+														  ULONG_PTR rangeBase,
+														  ULONG_PTR rangeEnd);
+typedef VOID(NTAPI* RtlGrowFunctionTablePointer)(PVOID dynamicTable, DWORD newEntryCount);
+typedef VOID(NTAPI* RtlDeleteGrowableFunctionTablePointer)(PVOID dynamicTable);
+
+// Function tables registered with RtlAddFunctionTable are kept in a list that Windows searches
+// linearly to find the unwind info for an address, which makes unwinding slow once there are many
+// JIT images. Instead, the images' function tables are merged into one sorted growable function
+// table for each 2GB window of the address space, which Windows searches with a binary search.
+// Images allocated from the same arena of addresses share a window, so there are only a few
+// tables no matter how many images are loaded.
+//
+// A growable function table can only grow at the end, so adding an image that isn't after all the
+// other images in its window, or removing an image, registers a new copy of the table before
+// deleting the old one. The entries are relative to the window's base address, and images that
+// aren't entirely within a window are registered with RtlAddFunctionTable.
+static constexpr Uptr functionTableWindowBytesLog2 = 31;
+static constexpr Uptr functionTableWindowBytes = Uptr(1) << functionTableWindowBytesLog2;
+static constexpr U32 minFunctionTableEntries = 256;
+
+struct GrowableFunctionTable
+{
+	PVOID dynamicTable = nullptr;
+	std::unique_ptr<RUNTIME_FUNCTION[]> entries;
+	U32 numEntries = 0;
+	U32 maxEntries = 0;
+};
+
+struct RegisteredFunctionTable
+{
+	Uptr windowBase;
+	DWORD beginAddress;
+	U32 numEntries;
+};
+
+struct FunctionTables
+{
+	Mutex mutex;
+	RtlAddGrowableFunctionTablePointer addGrowableFunctionTable = nullptr;
+	RtlGrowFunctionTablePointer growFunctionTable = nullptr;
+	RtlDeleteGrowableFunctionTablePointer deleteGrowableFunctionTable = nullptr;
+
+	std::map<Uptr, GrowableFunctionTable> windowTables;
+	std::map<const U8*, RegisteredFunctionTable> registeredTables;
+
+	// The function tables are never destroyed, so modules can be unloaded during static
+	// destruction.
+	static FunctionTables& get()
+	{
+		static FunctionTables* functionTables = new FunctionTables;
+		return *functionTables;
+	}
+
+	// Registers a new copy of a window's table with the given entries, and deletes the old copy.
+	void replaceWindowTable(Uptr windowBase,
+							GrowableFunctionTable& table,
+							std::unique_ptr<RUNTIME_FUNCTION[]>&& newEntries,
+							U32 numNewEntries,
+							U32 maxNewEntries)
+	{
+		GrowableFunctionTable newTable;
+		newTable.entries = std::move(newEntries);
+		newTable.numEntries = numNewEntries;
+		newTable.maxEntries = maxNewEntries;
+		if(numNewEntries
+		   && (*addGrowableFunctionTable)(&newTable.dynamicTable,
+										  newTable.entries.get(),
+										  numNewEntries,
+										  maxNewEntries,
+										  ULONG_PTR(windowBase),
+										  ULONG_PTR(windowBase + functionTableWindowBytes)))
+		{ Errors::fatal("RtlAddGrowableFunctionTable failed"); }
+
+		if(table.dynamicTable) { (*deleteGrowableFunctionTable)(table.dynamicTable); }
+		table = std::move(newTable);
+	}
+
+private:
+	FunctionTables()
+	{
+		HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+		if(ntdll)
+		{
+			addGrowableFunctionTable = (RtlAddGrowableFunctionTablePointer)GetProcAddress(
+				ntdll, "RtlAddGrowableFunctionTable");
+			growFunctionTable
+				= (RtlGrowFunctionTablePointer)GetProcAddress(ntdll, "RtlGrowFunctionTable");
+			deleteGrowableFunctionTable = (RtlDeleteGrowableFunctionTablePointer)GetProcAddress(
+				ntdll, "RtlDeleteGrowableFunctionTable");
+		}
+		if(!growFunctionTable || !deleteGrowableFunctionTable)
+		{ addGrowableFunctionTable = nullptr; }
+	}
+};
+#endif
+
 void Platform::registerEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes)
 {
 #ifdef _WIN64
 	const U32 numFunctions = (U32)(numBytes / sizeof(RUNTIME_FUNCTION));
+	const RUNTIME_FUNCTION* functions = (const RUNTIME_FUNCTION*)ehFrames;
+
+	// Find the window that contains the image's base address, and check that the rest of the
+	// image is also within the window.
+	const Uptr windowBase = (Uptr(imageBase) >> functionTableWindowBytesLog2)
+							<< functionTableWindowBytesLog2;
+	const Uptr imageOffset = Uptr(imageBase) - windowBase;
+	DWORD maxAddress = 0;
+	for(U32 functionIndex = 0; functionIndex < numFunctions; ++functionIndex)
+	{
+		maxAddress = std::max(maxAddress, functions[functionIndex].EndAddress);
+		maxAddress = std::max(maxAddress, functions[functionIndex].UnwindData);
+	}
+
+	FunctionTables& functionTables = FunctionTables::get();
+	Mutex::Lock functionTablesLock(functionTables.mutex);
+	if(!functionTables.addGrowableFunctionTable || !numFunctions
+	   || imageOffset + maxAddress > functionTableWindowBytes)
+	{
+		// Register our manually fixed up copy of the function table.
+		if(!RtlAddFunctionTable(
+			   (RUNTIME_FUNCTION*)ehFrames, numFunctions, reinterpret_cast<ULONG_PTR>(imageBase)))
+		{ Errors::fatal("RtlAddFunctionTable failed"); }
+		return;
+	}
+
+	// Find where the image's entries go in the window's sorted table.
+	GrowableFunctionTable& table = functionTables.windowTables[windowBase];
+	const DWORD beginAddress = DWORD(imageOffset + functions[0].BeginAddress);
+	U32 insertIndex = table.numEntries;
+	while(insertIndex > 0 && table.entries[insertIndex - 1].BeginAddress > beginAddress)
+	{ --insertIndex; }
+
+	auto copyRebasedEntries = [&](RUNTIME_FUNCTION* outEntries) {
+		for(U32 functionIndex = 0; functionIndex < numFunctions; ++functionIndex)
+		{
+			outEntries[functionIndex].BeginAddress
+				= DWORD(imageOffset + functions[functionIndex].BeginAddress);
+			outEntries[functionIndex].EndAddress
+				= DWORD(imageOffset + functions[functionIndex].EndAddress);
+			outEntries[functionIndex].UnwindData
+				= DWORD(imageOffset + functions[functionIndex].UnwindData);
+		}
+	};
+
+	const U32 numNewEntries = table.numEntries + numFunctions;
+	if(insertIndex == table.numEntries && table.dynamicTable && numNewEntries <= table.maxEntries)
+	{
+		// The image is after all the other images in the window, so append its entries to the
+		// table in place.
+		copyRebasedEntries(table.entries.get() + table.numEntries);
+		table.numEntries = numNewEntries;
+		(*functionTables.growFunctionTable)(table.dynamicTable, numNewEntries);
+	}
+	else
+	{
+		// Register a larger or reordered copy of the table.
+		const U32 maxNewEntries
+			= std::max(minFunctionTableEntries, std::max(numNewEntries, table.maxEntries * 2));
+		std::unique_ptr<RUNTIME_FUNCTION[]> newEntries(new RUNTIME_FUNCTION[maxNewEntries]);
+		std::copy(table.entries.get(), table.entries.get() + insertIndex, newEntries.get());
+		copyRebasedEntries(newEntries.get() + insertIndex);
+		std::copy(table.entries.get() + insertIndex,
+				  table.entries.get() + table.numEntries,
+				  newEntries.get() + insertIndex + numFunctions);
+		functionTables.replaceWindowTable(
+			windowBase, table, std::move(newEntries), numNewEntries, maxNewEntries);
+	}
 
-	// Register our manually fixed up copy of the function table.
-	if(!RtlAddFunctionTable(
-		   (RUNTIME_FUNCTION*)ehFrames, numFunctions, reinterpret_cast<ULONG_PTR>(imageBase)))
-	{ Errors::fatal("RtlAddFunctionTable failed"); }
+	functionTables.registeredTables[ehFrames] = {windowBase, beginAddress, numFunctions};
 #else
 	Errors::fatal("registerEHFrames isn't implemented on 32-bit Windows");
 #endif
@@ -29,7 +202,41 @@ void Platform::registerEHFrames(const U8* imageBase, const U8* ehFrames, Uptr nu
 void Platform::deregisterEHFrames(const U8* imageBase, const U8* ehFrames, Uptr numBytes)
 {
 #ifdef _WIN64
-	RtlDeleteFunctionTable((RUNTIME_FUNCTION*)ehFrames);
+	FunctionTables& functionTables = FunctionTables::get();
+	Mutex::Lock functionTablesLock(functionTables.mutex);
+	auto registeredIt = functionTables.registeredTables.find(ehFrames);
+	if(registeredIt == functionTables.registeredTables.end())
+	{
+		RtlDeleteFunctionTable((RUNTIME_FUNCTION*)ehFrames);
+		return;
+	}
+	const RegisteredFunctionTable registered = registeredIt->second;
+	functionTables.registeredTables.erase(registeredIt);
+
+	// Register a copy of the window's table without the image's entries, which are contiguous
+	// since images don't overlap.
+	auto windowIt = functionTables.windowTables.find(registered.windowBase);
+	WAVM_ASSERT(windowIt != functionTables.windowTables.end());
+	GrowableFunctionTable& table = windowIt->second;
+	U32 removeIndex = 0;
+	while(removeIndex < table.numEntries
+		  && table.entries[removeIndex].BeginAddress != registered.beginAddress)
+	{ ++removeIndex; }
+	WAVM_ERROR_UNLESS(removeIndex + registered.numEntries <= table.numEntries);
+
+	const U32 numNewEntries = table.numEntries - registered.numEntries;
+	std::unique_ptr<RUNTIME_FUNCTION[]> newEntries;
+	if(numNewEntries)
+	{
+		newEntries.reset(new RUNTIME_FUNCTION[table.maxEntries]);
+		std::copy(table.entries.get(), table.entries.get() + removeIndex, newEntries.get());
+		std::copy(table.entries.get() + removeIndex + registered.numEntries,
+				  table.entries.get() + table.numEntries,
+				  newEntries.get() + removeIndex);
+	}
+	functionTables.replaceWindowTable(
+		registered.windowBase, table, std::move(newEntries), numNewEntries, table.maxEntries);
+	if(!numNewEntries) { functionTables.windowTables.erase(windowIt); }
 #else
 	Errors::fatal("deregisterEHFrames isn't implemented on 32-bit Windows");
 #endif
@@ -92,6 +299,47 @@ static LONG CALLBACK sehSignalFilterFunction(EXCEPTION_POINTERS* exceptionPointe
 	}
 }
 
+// SEH doesn't have any per-call setup cost to avoid, so a signal scope just holds the filter.
+struct Platform::SignalScope
+{
+	bool (*filter)(void*, Signal, CallStack&&);
+	void* filterArgument;
+};
+
+SignalScope* Platform::enterSignalScope(bool (*filter)(void*, Signal, CallStack&&),
+										void* filterArgument)
+{
+	return new SignalScope{filter, filterArgument};
+}
+
+void Platform::exitSignalScope(SignalScope* scope) { delete scope; }
+
+bool Platform::startSampling(U32 samplesPerSecond, void (*sampleHandler)(Uptr ip))
+{
+	return false;
+}
+
+void Platform::stopSampling() {}
+
+bool Platform::catchSignalsInScope(SignalScope* scope, void (*thunk)(void*), void* argument)
+{
+	initThread();
+
+	__try
+	{
+		(*thunk)(argument);
+		return false;
+	}
+	__except(sehSignalFilterFunction(
+		GetExceptionInformation(), scope->filter, scope->filterArgument))
+	{
+		// After a stack overflow, the stack will be left in a damaged state. Let the CRT repair it.
+		WAVM_ERROR_UNLESS(_resetstkoflw());
+
+		return true;
+	}
+}
+
 bool Platform::catchSignals(void (*thunk)(void*),
 							bool (*filter)(void*, Signal, CallStack&&),
 							void* context)
@@ -170,4 +170,36 @@ Uptr Platform::getNumberOfHardwareThreads()
 	return cachedNumberOfHardwareThreads;
 }
 
+void Platform::getCurrentStack(U8*& outMinAddr, U8*& outMaxAddr)
+{
+	// The thread's stack limits in its TEB are switched to the fiber's stack by SwitchToFiber.
+	ULONG_PTR lowLimit = 0;
+	ULONG_PTR highLimit = 0;
+	GetCurrentThreadStackLimits(&lowLimit, &highLimit);
+	outMinAddr = reinterpret_cast<U8*>(lowLimit);
+	outMaxAddr = reinterpret_cast<U8*>(highLimit);
+}
+
+Uptr Platform::getNumNUMANodes()
+{
+	ULONG highestNodeNumber = 0;
+	if(!GetNumaHighestNodeNumber(&highestNodeNumber)) { return 1; }
+	return Uptr(highestNodeNumber) + 1;
+}
+
+bool Platform::bindCurrentThreadToNUMANode(Uptr node)
+{
+	if(node >= getNumNUMANodes()) { return false; }
+
+	GROUP_AFFINITY groupAffinity;
+	if(!GetNumaNodeProcessorMaskEx(USHORT(node), &groupAffinity) || !groupAffinity.Mask)
+	{ return false; }
+	return SetThreadGroupAffinity(GetCurrentThread(), &groupAffinity, nullptr) != 0;
+}
+
+void Platform::setCurrentThreadBackgroundPriority()
+{
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+}
+
 void Platform::yieldToAnotherThread() { SwitchToThread(); }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <intrin.h>
+#include <atomic>
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Time.h"
 #include "WAVM/Platform/Diagnostics.h"
@@ -15,4 +16,18 @@ namespace WAVM { namespace Platform {
 
 	Time fileTimeToWAVMRealTime(FILETIME fileTime);
 	FILETIME wavmRealTimeToFileTime(Time realTime);
+
+	// Reads or writes a file opened with FILE_FLAG_OVERLAPPED at an offset. If called on a fiber,
+	// the operation completes on the calling thread's I/O completion port, and the fiber switches
+	// from itself until it does. inOutPort is the port that the file is associated with, or null
+	// if it isn't associated with one yet. Returns ERROR_SUCCESS or the error code of the
+	// operation.
+	bool isIOCPSupported();
+	DWORD iocpTransferFile(bool isWrite,
+						   HANDLE file,
+						   std::atomic<HANDLE>& inOutPort,
+						   void* buffer,
+						   U32 numBytes,
+						   U64 offset,
+						   U32& outNumBytes);
 }}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+
+namespace WAVM { namespace Runtime {
+	// An index of the non-overlapping address ranges reserved by a kind of object, which maps an
+	// address to the object whose range contains it. Lookups don't lock or allocate, so they are
+	// safe to do in a signal handler, and take O(log n) time. The ranges are kept in a sorted
+	// array that is replaced with an updated copy when a range is added or removed, and the old
+	// array is freed once no lookups are reading it.
+	template<typename Object> struct AddressRangeIndex
+	{
+		~AddressRangeIndex() { delete ranges.load(std::memory_order_acquire); }
+
+		void add(U8* begin, U8* end, Object* object)
+		{
+			Platform::Mutex::Lock updateLock(updateMutex);
+			const std::vector<Range>* oldRanges = ranges.load(std::memory_order_relaxed);
+			std::vector<Range>* newRanges
+				= oldRanges ? new std::vector<Range>(*oldRanges) : new std::vector<Range>;
+
+			auto it = newRanges->begin();
+			while(it != newRanges->end() && it->begin < begin) { ++it; }
+			newRanges->insert(it, Range{begin, end, object});
+
+			publish(oldRanges, newRanges);
+		}
+
+		void remove(Object* object)
+		{
+			Platform::Mutex::Lock updateLock(updateMutex);
+			const std::vector<Range>* oldRanges = ranges.load(std::memory_order_relaxed);
+			if(!oldRanges) { return; }
+
+			std::vector<Range>* newRanges = new std::vector<Range>;
+			newRanges->reserve(oldRanges->size());
+			for(const Range& range : *oldRanges)
+			{
+				if(range.object != object) { newRanges->push_back(range); }
+			}
+
+			publish(oldRanges, newRanges);
+		}
+
+		// Finds the object whose range contains the address, and returns the start of its range.
+		bool find(U8* address, Object*& outObject, U8*& outBegin) const
+		{
+			// The count of active lookups is incremented before loading the ranges, so an update
+			// that replaces the ranges waits for this lookup before freeing them.
+			numActiveLookups.fetch_add(1, std::memory_order_seq_cst);
+			const std::vector<Range>* currentRanges = ranges.load(std::memory_order_seq_cst);
+
+			// Find the last range that begins at or before the address.
+			bool found = false;
+			if(currentRanges && currentRanges->size())
+			{
+				const Range* rangesData = currentRanges->data();
+				Uptr lowIndex = 0;
+				Uptr highIndex = currentRanges->size();
+				while(highIndex - lowIndex > 1)
+				{
+					const Uptr midIndex = lowIndex + (highIndex - lowIndex) / 2;
+					if(rangesData[midIndex].begin <= address) { lowIndex = midIndex; }
+					else
+					{
+						highIndex = midIndex;
+					}
+				}
+
+				const Range& range = rangesData[lowIndex];
+				if(address >= range.begin && address < range.end)
+				{
+					outObject = range.object;
+					outBegin = range.begin;
+					found = true;
+				}
+			}
+
+			numActiveLookups.fetch_sub(1, std::memory_order_release);
+			return found;
+		}
+
+	private:
+		struct Range
+		{
+			U8* begin;
+			U8* end;
+			Object* object;
+		};
+
+		Platform::Mutex updateMutex;
+		std::atomic<const std::vector<Range>*> ranges{nullptr};
+		mutable std::atomic<Uptr> numActiveLookups{0};
+
+		void publish(const std::vector<Range>* oldRanges, const std::vector<Range>* newRanges)
+		{
+			// After the new ranges are stored, lookups that start won't read the old ranges, so
+			// once there are no active lookups, the old ranges can be freed. Lookups are short and
+			// updates are rare, so it's fine to spin.
+			ranges.store(newRanges, std::memory_order_seq_cst);
+			while(numActiveLookups.load(std::memory_order_seq_cst))
+			{ Platform::yieldToAnotherThread(); }
+			delete oldRanges;
+		}
+	};
+}}
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+struct Runtime::CompileJob
+{
+	IR::Module irModule;
+	LLVMJIT::CompileOptions compileOptions;
+	CompilePriority priority;
+	std::function<void(ModuleRef)> onComplete;
+
+	std::shared_ptr<std::atomic<bool>> cancelFlag;
+	std::promise<ModuleRef> promise;
+	std::shared_future<ModuleRef> result;
+
+	// Whether the job is in its priority's queue. Guarded by the compile thread pool's mutex.
+	bool isQueued = false;
+
+	CompileJob(const IR::Module& inIRModule,
+			   const LLVMJIT::CompileOptions& inCompileOptions,
+			   CompilePriority inPriority,
+			   std::function<void(ModuleRef)>&& inOnComplete)
+	: irModule(inIRModule)
+	, compileOptions(inCompileOptions)
+	, priority(inPriority)
+	, onComplete(std::move(inOnComplete))
+	, cancelFlag(std::make_shared<std::atomic<bool>>(false))
+	, result(promise.get_future().share())
+	{
+	}
+};
+
+static constexpr Uptr numCompilePriorities = Uptr(CompilePriority::interactive) + 1;
+
+struct CompileThreadPool
+{
+	Platform::Mutex mutex;
+
+	// Signaled when a job is queued. Each compile thread that takes a job signals it again if there
+	// are more queued jobs, so a signal that only woke one thread doesn't leave jobs waiting.
+	Platform::Event jobQueuedEvent;
+
+	std::deque<CompileHandle> queues[numCompilePriorities];
+	Uptr maxThreads = 0;
+	Uptr numThreads = 0;
+	Uptr numIdleThreads = 0;
+
+	bool hasQueuedJobs() const
+	{
+		for(const std::deque<CompileHandle>& queue : queues)
+		{
+			if(queue.size()) { return true; }
+		}
+		return false;
+	}
+};
+
+// The pool is never destroyed, since its threads may still be waiting for jobs when the process
+// exits.
+static CompileThreadPool& getCompileThreadPool()
+{
+	static CompileThreadPool* pool = new CompileThreadPool;
+	return *pool;
+}
+
+// Calls a job's completion callback, and then sets its result.
+static void completeCompileJob(CompileJob& job, ModuleRef&& module, std::exception_ptr exception)
+{
+	if(job.onComplete) { job.onComplete(module); }
+	if(exception) { job.promise.set_exception(exception); }
+	else
+	{
+		job.promise.set_value(std::move(module));
+	}
+}
+
+static void runCompileJob(CompileJob& job)
+{
+	ModuleRef module;
+	std::exception_ptr exception;
+	if(!job.cancelFlag->load(std::memory_order_relaxed))
+	{
+		try
+		{
+			module = compileModuleWithOptions(job.irModule, job.compileOptions, job.cancelFlag);
+		}
+		catch(LLVMJIT::CompileCancelledException&)
+		{
+		}
+		catch(...)
+		{
+			exception = std::current_exception();
+		}
+	}
+
+	// Release the job's copy of the IR before calling the callback.
+	job.irModule = IR::Module();
+	completeCompileJob(job, std::move(module), exception);
+}
+
+static I64 compileThreadEntry(void*)
+{
+	CompileThreadPool& pool = getCompileThreadPool();
+	while(true)
+	{
+		CompileHandle job;
+		{
+			Platform::Mutex::Lock lock(pool.mutex);
+
+			// Take the oldest job with the highest priority.
+			for(Uptr priorityIndex = numCompilePriorities; !job && priorityIndex > 0;
+				--priorityIndex)
+			{
+				std::deque<CompileHandle>& queue = pool.queues[priorityIndex - 1];
+				if(queue.size())
+				{
+					job = std::move(queue.front());
+					queue.pop_front();
+					job->isQueued = false;
+				}
+			}
+
+			if(!job) { ++pool.numIdleThreads; }
+			else if(pool.hasQueuedJobs())
+			{
+				pool.jobQueuedEvent.signal();
+			}
+		}
+
+		if(job) { runCompileJob(*job); }
+		else
+		{
+			pool.jobQueuedEvent.wait(Time::infinity());
+
+			Platform::Mutex::Lock lock(pool.mutex);
+			--pool.numIdleThreads;
+		}
+	}
+}
+
+CompileHandle Runtime::compileModuleAsync(const IR::Module& irModule,
+										  const LLVMJIT::CompileOptions& compileOptions,
+										  CompilePriority priority,
+										  std::function<void(ModuleRef)>&& onComplete)
+{
+	WAVM_ASSERT(Uptr(priority) < numCompilePriorities);
+	CompileHandle job
+		= std::make_shared<CompileJob>(irModule, compileOptions, priority, std::move(onComplete));
+
+	CompileThreadPool& pool = getCompileThreadPool();
+	bool shouldStartThread = false;
+	{
+		Platform::Mutex::Lock lock(pool.mutex);
+		pool.queues[Uptr(priority)].push_back(job);
+		job->isQueued = true;
+
+		// Start another compile thread if all the threads are busy, and there are fewer than the
+		// maximum number of threads.
+		const Uptr maxThreads = pool.maxThreads
+									? pool.maxThreads
+									: std::max(Uptr(1), Platform::getNumberOfHardwareThreads());
+		if(!pool.numIdleThreads && pool.numThreads < maxThreads)
+		{
+			++pool.numThreads;
+			shouldStartThread = true;
+		}
+	}
+
+	if(shouldStartThread)
+	{
+		Platform::detachThread(
+			Platform::createThread(8 * 1024 * 1024, compileThreadEntry, nullptr));
+	}
+	pool.jobQueuedEvent.signal();
+
+	return job;
+}
+
+void Runtime::cancelCompile(const CompileHandle& job)
+{
+	job->cancelFlag->store(true, std::memory_order_relaxed);
+
+	// If the job hasn't started yet, remove it from its queue and complete it on this thread.
+	CompileThreadPool& pool = getCompileThreadPool();
+	{
+		Platform::Mutex::Lock lock(pool.mutex);
+		if(!job->isQueued) { return; }
+
+		std::deque<CompileHandle>& queue = pool.queues[Uptr(job->priority)];
+		queue.erase(std::find(queue.begin(), queue.end(), job));
+		job->isQueued = false;
+	}
+	job->irModule = IR::Module();
+	completeCompileJob(*job, nullptr, nullptr);
+}
+
+ModuleRef Runtime::waitForCompile(const CompileHandle& job) { return job->result.get(); }
+
+void Runtime::setNumCompileThreads(Uptr numThreads)
+{
+	CompileThreadPool& pool = getCompileThreadPool();
+	Platform::Mutex::Lock lock(pool.mutex);
+	pool.maxThreads = numThreads;
+}
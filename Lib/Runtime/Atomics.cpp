@@ -10,8 +10,13 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Futex.h"
+#include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -38,9 +43,21 @@ struct WaitList
 // An event that is reused within a thread when it waits on a WaitList.
 thread_local std::unique_ptr<Platform::Event> threadWakeEvent = nullptr;
 
-// A map from address to a list of threads waiting on that address.
-static Platform::Mutex addressToWaitListMapMutex;
-static HashMap<Uptr, WaitList*> addressToWaitListMap;
+// A map from address to a list of threads waiting on that address. The map is split into shards
+// by a hash of the address, each with its own mutex, so threads waiting on different addresses
+// rarely contend for the same mutex.
+struct alignas(64) WaitListShard
+{
+	Platform::Mutex mutex;
+	HashMap<Uptr, WaitList*> addressToWaitListMap;
+};
+static constexpr Uptr numWaitListShards = 64;
+static WaitListShard waitListShards[numWaitListShards];
+
+static WaitListShard& getWaitListShard(Uptr address)
+{
+	return waitListShards[Hash<Uptr>()(address) & (numWaitListShards - 1)];
+}
 
 // Opens the wait list for a given address.
 // Increases the wait list's reference count, and returns a pointer to it.
@@ -48,8 +65,9 @@ static HashMap<Uptr, WaitList*> addressToWaitListMap;
 // A call to openWaitList should be followed by a call to closeWaitList to avoid leaks.
 static WaitList* openWaitList(Uptr address)
 {
-	Platform::Mutex::Lock mapLock(addressToWaitListMapMutex);
-	auto waitListPtr = addressToWaitListMap.get(address);
+	WaitListShard& shard = getWaitListShard(address);
+	Platform::Mutex::Lock mapLock(shard.mutex);
+	auto waitListPtr = shard.addressToWaitListMap.get(address);
 	if(waitListPtr)
 	{
 		++(*waitListPtr)->numReferences;
@@ -58,7 +76,7 @@ static WaitList* openWaitList(Uptr address)
 	else
 	{
 		WaitList* waitList = new WaitList();
-		addressToWaitListMap.set(address, waitList);
+		shard.addressToWaitListMap.set(address, waitList);
 		return waitList;
 	}
 }
@@ -68,12 +86,13 @@ static void closeWaitList(Uptr address, WaitList* waitList)
 {
 	if(--waitList->numReferences == 0)
 	{
-		Platform::Mutex::Lock mapLock(addressToWaitListMapMutex);
+		WaitListShard& shard = getWaitListShard(address);
+		Platform::Mutex::Lock mapLock(shard.mutex);
 		if(!waitList->numReferences)
 		{
 			WAVM_ASSERT(!waitList->wakeEvents.size());
 			delete waitList;
-			addressToWaitListMap.remove(address);
+			shard.addressToWaitListMap.remove(address);
 		}
 	}
 }
@@ -162,14 +181,151 @@ static U32 waitOnAddress(Value* valuePointer, Value expectedValue, I64 timeout)
 	return timedOut ? 2 : 0;
 }
 
+// Waits on a 32-bit address directly with the OS futex, if it's supported.
+static U32 waitOnAddress(I32* valuePointer, I32 expectedValue, I64 timeout)
+{
+	if(!Platform::isFutexSupported())
+	{ return waitOnAddress<I32>(valuePointer, expectedValue, timeout); }
+
+	const Time waitDuration = timeout < 0 ? Time::infinity() : Time{I128(timeout)};
+	switch(Platform::futexWait((const U32*)valuePointer, U32(expectedValue), waitDuration))
+	{
+	case Platform::FutexWaitResult::woken: return 0;
+	case Platform::FutexWaitResult::notEqual: return 1;
+	case Platform::FutexWaitResult::timedOut: return 2;
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+// Waits on an address in a memory: first spins checking whether the value changed for up to the
+// compartment's atomic wait spin duration, and then blocks the thread. If the value changes while
+// spinning, the wait returns immediately as if it had started after the change, which avoids
+// blocking and waking the thread when the notifying thread is about to change the value. If the
+// wait is for a context that accounts its times, the time the thread is blocked is accounted to it.
+static Metrics::Counter& numAtomicWaits
+	= Metrics::getCounter("wavm_atomic_waits_total", "Calls to memory.atomic.wait");
+static Metrics::Counter& numAtomicNotifies
+	= Metrics::getCounter("wavm_atomic_notifies_total", "Calls to memory.atomic.notify");
+static Metrics::Counter& contextAtomicWaitNanoseconds
+	= Metrics::getCounter("wavm_context_atomic_wait_nanoseconds_total",
+						  "Time that contexts were blocked in memory.atomic.wait");
+
+template<typename Value>
+static U32 waitOnMemoryAddress(Memory* memory,
+								Value* valuePointer,
+								Value expectedValue,
+								I64 timeout,
+								Context* context = nullptr)
+{
+	numAtomicWaits.add();
+	Compartment* compartment = memory->compartment;
+	I64 spinNanoseconds
+		= I64(compartment->atomicWaitSpinNanoseconds.load(std::memory_order_relaxed));
+	if(timeout >= 0 && timeout < spinNanoseconds) { spinNanoseconds = timeout; }
+
+	// Use unwindSignalsAsExceptions to ensure that an access violation signal produced by the
+	// loads will be thrown as a Runtime::Exception.
+	bool spun = false;
+	bool valueChanged = false;
+	I128 numSpunNanoseconds = 0;
+	Runtime::unwindSignalsAsExceptions([&] {
+		if(atomicLoad(valuePointer) != expectedValue)
+		{
+			valueChanged = true;
+			return;
+		}
+		if(spinNanoseconds <= 0) { return; }
+
+		spun = true;
+		const I128 spinStartTime = Platform::getClockTime(Platform::Clock::monotonic).ns;
+		const I128 deadline = spinStartTime + I128(spinNanoseconds);
+		for(Uptr spinIndex = 1;; ++spinIndex)
+		{
+			spinLoopHint();
+			if(atomicLoad(valuePointer) != expectedValue)
+			{
+				valueChanged = true;
+				return;
+			}
+
+			// Reading the clock is much slower than reading the value, so only check the deadline
+			// every 64 iterations.
+			if(!(spinIndex & 63))
+			{
+				const I128 spinTime = Platform::getClockTime(Platform::Clock::monotonic).ns;
+				if(spinTime >= deadline)
+				{
+					numSpunNanoseconds = spinTime - spinStartTime;
+					return;
+				}
+			}
+		}
+	});
+	if(valueChanged && !spun) { return 1; }
+
+	compartment->numAtomicWaits.fetch_add(1, std::memory_order_relaxed);
+	if(spun)
+	{
+		compartment->numSpinningAtomicWaits.fetch_add(1, std::memory_order_relaxed);
+		if(valueChanged)
+		{
+			compartment->numAtomicWaitsEndedBySpinning.fetch_add(1, std::memory_order_relaxed);
+			return 1;
+		}
+	}
+
+	// Block for the rest of the timeout. The spin may have taken longer than spinNanoseconds if the
+	// thread was preempted, so subtract the time it actually took.
+	if(timeout >= 0)
+	{ timeout = numSpunNanoseconds >= timeout ? 0 : I64(timeout - numSpunNanoseconds); }
+	if(!context || !context->accountsTimes.load(std::memory_order_relaxed))
+	{ return waitOnAddress(valuePointer, expectedValue, timeout); }
+
+	const I128 startTime = Platform::getClockTime(Platform::Clock::monotonic).ns;
+	const U32 result = waitOnAddress(valuePointer, expectedValue, timeout);
+	const U64 numWaitNanoseconds
+		= U64(Platform::getClockTime(Platform::Clock::monotonic).ns - startTime);
+	context->atomicWaitNanoseconds.fetch_add(numWaitNanoseconds, std::memory_order_relaxed);
+	contextAtomicWaitNanoseconds.add(numWaitNanoseconds);
+	return result;
+}
+
+void Runtime::setCompartmentAtomicWaitSpinDuration(Compartment* compartment, U64 nanoseconds)
+{
+	compartment->atomicWaitSpinNanoseconds.store(std::min(nanoseconds, U64(INT64_MAX)),
+												 std::memory_order_relaxed);
+}
+
+AtomicWaitStats Runtime::getCompartmentAtomicWaitStats(const Compartment* compartment)
+{
+	AtomicWaitStats stats;
+	stats.numWaits = compartment->numAtomicWaits.load(std::memory_order_relaxed);
+	stats.numSpinningWaits = compartment->numSpinningAtomicWaits.load(std::memory_order_relaxed);
+	stats.numWaitsEndedBySpinning
+		= compartment->numAtomicWaitsEndedBySpinning.load(std::memory_order_relaxed);
+	return stats;
+}
+
 static U32 wakeAddress(void* pointer, U32 numToWake)
 {
+	numAtomicNotifies.add();
 	if(numToWake == 0) { return 0; }
 
+	// Wake threads that are waiting on the address with the OS futex first, and then wake any
+	// remaining number of threads from the address's wait list. 64-bit waits always use the wait
+	// list, and 32-bit waits use it if the OS doesn't support futexes.
+	Uptr numFutexWoken = 0;
+	if(Platform::isFutexSupported() && !(reinterpret_cast<Uptr>(pointer) & 3))
+	{
+		numFutexWoken = Platform::futexWake(
+			(const U32*)pointer, numToWake == UINT32_MAX ? UINTPTR_MAX : Uptr(numToWake));
+		if(numToWake != UINT32_MAX && numFutexWoken >= numToWake) { return numToWake; }
+	}
+
 	// Open the wait list for this address.
 	const Uptr address = reinterpret_cast<Uptr>(pointer);
 	WaitList* waitList = openWaitList(address);
-	Uptr actualNumToWake = numToWake;
+	Uptr actualNumToWake = numToWake == UINT32_MAX ? UINT32_MAX : numToWake - numFutexWoken;
 	{
 		Platform::Mutex::Lock waitListLock(waitList->mutex);
 
@@ -188,11 +344,30 @@ static U32 wakeAddress(void* pointer, U32 numToWake)
 	}
 	closeWaitList(address, waitList);
 
+	actualNumToWake += numFutexWoken;
 	if(actualNumToWake > UINT32_MAX)
 	{ throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
 	return U32(actualNumToWake);
 }
 
+U32 Runtime::atomicWait32(Memory* memory, Uptr address, U32 expectedValue, I64 timeoutNanoseconds)
+{
+	if(address & 3)
+	{ throwException(ExceptionTypes::misalignedAtomicMemoryAccess, {U64(address)}); }
+
+	// Validate that the address is within the memory's bounds, and convert it to a pointer.
+	I32* valuePointer = &memoryRef<I32>(memory, address);
+
+	return waitOnMemoryAddress(memory, valuePointer, I32(expectedValue), timeoutNanoseconds);
+}
+
+U32 Runtime::atomicNotify(Memory* memory, Uptr address, U32 numToWake)
+{
+	if(address & 3)
+	{ throwException(ExceptionTypes::misalignedAtomicMemoryAccess, {U64(address)}); }
+	return wakeAddress(&memoryRef<I32>(memory, address), numToWake);
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 							   "misalignedAtomicTrap",
 							   void,
@@ -243,7 +418,11 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 	// Validate that the address is within the memory's bounds, and convert it to a pointer.
 	I32* valuePointer = &memoryRef<I32>(memory, address);
 
-	return waitOnAddress(valuePointer, expectedValue, timeout);
+	return waitOnMemoryAddress(memory,
+							   valuePointer,
+							   expectedValue,
+							   timeout,
+							   getContextFromRuntimeData(contextRuntimeData));
 }
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 							   "memory.atomic.wait64",
@@ -265,5 +444,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsAtomics,
 	// Validate that the address is within the memory's bounds, and convert it to a pointer.
 	I64* valuePointer = &memoryRef<I64>(memory, address);
 
-	return waitOnAddress(valuePointer, expectedValue, timeout);
+	return waitOnMemoryAddress(memory,
+							   valuePointer,
+							   expectedValue,
+							   timeout,
+							   getContextFromRuntimeData(contextRuntimeData));
 }
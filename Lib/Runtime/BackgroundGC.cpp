@@ -0,0 +1,147 @@
+#include <atomic>
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashSet.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+struct BackgroundGC
+{
+	Platform::Mutex mutex;
+
+	// Signaled when a compartment reaches its threshold, and when a compartment's background
+	// collection finishes.
+	Platform::Event wakeEvent;
+	Platform::Event collectionFinishedEvent;
+
+	HashSet<Compartment*> compartments;
+	Compartment* collectingCompartment = nullptr;
+	bool hasStartedThread = false;
+};
+
+// The collector is never destroyed, since its thread may still be waiting when the process exits.
+static BackgroundGC& getBackgroundGC()
+{
+	static BackgroundGC* backgroundGC = new BackgroundGC;
+	return *backgroundGC;
+}
+
+static bool isOverThreshold(Compartment* compartment)
+{
+	return compartment->numObjectsSinceGC.load(std::memory_order_relaxed)
+		   >= compartment->backgroundGCObjectThreshold.load(std::memory_order_relaxed);
+}
+
+static I64 backgroundGCThreadEntry(void*)
+{
+	Platform::setCurrentThreadBackgroundPriority();
+
+	BackgroundGC& backgroundGC = getBackgroundGC();
+	while(true)
+	{
+		backgroundGC.wakeEvent.wait(Time::infinity());
+
+		// Collect compartments until none of them are over their threshold.
+		while(true)
+		{
+			Compartment* compartment = nullptr;
+			bool isFullCollection = false;
+			{
+				Platform::Mutex::Lock lock(backgroundGC.mutex);
+				for(Compartment* candidate : backgroundGC.compartments)
+				{
+					if(isOverThreshold(candidate))
+					{
+						compartment = candidate;
+						break;
+					}
+				}
+				if(!compartment) { break; }
+
+				// Add a root reference to the compartment, so a collection on another thread
+				// doesn't delete it while it's collected here.
+				addGCRoot(compartment);
+				backgroundGC.collectingCompartment = compartment;
+
+				if(compartment->numYoungBackgroundCollectionsSinceFull
+				   >= compartment->numYoungBackgroundCollectionsPerFull)
+				{
+					isFullCollection = true;
+					compartment->numYoungBackgroundCollectionsSinceFull = 0;
+				}
+				else
+				{
+					++compartment->numYoungBackgroundCollectionsSinceFull;
+				}
+			}
+
+			// A full collection marks the compartment's objects without holding its lock, so the
+			// threads using the compartment only wait for its short pauses.
+			if(isFullCollection) { collectCompartmentGarbage(compartment); }
+			else
+			{
+				collectYoungCompartmentGarbage(compartment);
+			}
+			removeGCRoot(compartment);
+
+			{
+				Platform::Mutex::Lock lock(backgroundGC.mutex);
+				backgroundGC.collectingCompartment = nullptr;
+			}
+			backgroundGC.collectionFinishedEvent.signal();
+		}
+	}
+}
+
+void Runtime::wakeBackgroundGC() { getBackgroundGC().wakeEvent.signal(); }
+
+void Runtime::enableBackgroundGC(Compartment* compartment, const BackgroundGCConfig& config)
+{
+	WAVM_ASSERT(config.numObjectsPerCollection > 0);
+
+	BackgroundGC& backgroundGC = getBackgroundGC();
+	{
+		Platform::Mutex::Lock lock(backgroundGC.mutex);
+		backgroundGC.compartments.add(compartment);
+		compartment->numYoungBackgroundCollectionsPerFull
+			= config.numYoungCollectionsPerFullCollection;
+		compartment->numYoungBackgroundCollectionsSinceFull = 0;
+		compartment->backgroundGCObjectThreshold.store(config.numObjectsPerCollection,
+													   std::memory_order_relaxed);
+
+		if(!backgroundGC.hasStartedThread)
+		{
+			backgroundGC.hasStartedThread = true;
+			Platform::detachThread(
+				Platform::createThread(1024 * 1024, backgroundGCThreadEntry, nullptr));
+		}
+	}
+
+	// The compartment may already be over the new threshold.
+	if(isOverThreshold(compartment)) { wakeBackgroundGC(); }
+}
+
+void Runtime::disableBackgroundGC(Compartment* compartment)
+{
+	BackgroundGC& backgroundGC = getBackgroundGC();
+	while(true)
+	{
+		{
+			Platform::Mutex::Lock lock(backgroundGC.mutex);
+			backgroundGC.compartments.remove(compartment);
+			compartment->backgroundGCObjectThreshold.store(0, std::memory_order_relaxed);
+			if(backgroundGC.collectingCompartment != compartment) { break; }
+		}
+		backgroundGC.collectionFinishedEvent.wait(Time::infinity());
+	}
+
+	// Pass the signal on to any other thread that is waiting for a collection to finish.
+	backgroundGC.collectionFinishedEvent.signal();
+}
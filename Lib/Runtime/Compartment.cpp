@@ -1,47 +1,136 @@
 #include <stddef.h>
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 #include "RuntimePrivate.h"
+#include "WAVM/IR/Types.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
 using namespace WAVM;
 using namespace WAVM::Runtime;
 
-Runtime::Compartment::Compartment(std::string&& inDebugName)
+// Each context's runtime data only has room for the compartment's maximum number of mutable
+// globals, rounded up to a cache line so contexts running on different threads don't share one.
+// With the default limit, this is sizeof(ContextRuntimeData).
+static Uptr getContextNumBytes(Uptr maxMutableGlobalsInLayout)
+{
+	const Uptr numBytes = offsetof(ContextRuntimeData, mutableGlobals)
+						  + maxMutableGlobalsInLayout * sizeof(IR::UntaggedValue);
+	return (numBytes + 63) & ~Uptr(63);
+}
+
+// The default limit on contexts is as many as fit in the compartment's 2GB reservation.
+static Uptr getDefaultMaxContexts(Uptr maxMutableGlobalsInLayout)
+{
+	return (compartmentReservedBytes - offsetof(CompartmentRuntimeData, contexts))
+		   / getContextNumBytes(maxMutableGlobalsInLayout);
+}
+
+// Replaces the layout's default or excessive limits with the default limits.
+static CompartmentLayout resolveLayout(const CompartmentLayout& layout)
+{
+	CompartmentLayout result;
+	result.maxTables
+		= layout.maxTables && layout.maxTables < maxTables ? layout.maxTables : maxTables;
+	result.maxMutableGlobals
+		= layout.maxMutableGlobals && layout.maxMutableGlobals < maxMutableGlobals
+			  ? layout.maxMutableGlobals
+			  : maxMutableGlobals;
+	const Uptr defaultMaxContexts = getDefaultMaxContexts(result.maxMutableGlobals);
+	result.maxContexts = layout.maxContexts && layout.maxContexts < defaultMaxContexts
+							 ? layout.maxContexts
+							 : defaultMaxContexts;
+	result.numaNode = layout.numaNode;
+	return result;
+}
+
+// A compartment is compact if its limits on tables or contexts are lower than the defaults. The
+// limit on mutable globals only determines the size of each context's runtime data.
+static bool isCompactLayout(const CompartmentLayout& layout)
+{
+	return layout.maxTables != maxTables
+		   || layout.maxContexts != getDefaultMaxContexts(layout.maxMutableGlobals);
+}
+
+// Compact compartments put the contexts' runtime data right after the tables' runtime data.
+// Compiled code only accesses the memories' and tables' runtime data at fixed offsets from the
+// start of the compartment's runtime data, and accesses the contexts' runtime data through the
+// context pointer, so only the tables limit constrains where the contexts can go.
+static Uptr getContextsOffset(const CompartmentLayout& layout)
+{
+	if(!isCompactLayout(layout)) { return offsetof(CompartmentRuntimeData, contexts); }
+
+	const Uptr tablesEndOffset
+		= offsetof(CompartmentRuntimeData, tables) + layout.maxTables * sizeof(TableRuntimeData);
+	return (tablesEndOffset + contextRuntimeDataAlignment - 1) & ~(contextRuntimeDataAlignment - 1);
+}
+
+static Uptr getNumReservedBytes(const CompartmentLayout& layout, Uptr contextsOffset)
+{
+	const Uptr numBytes
+		= contextsOffset + layout.maxContexts * getContextNumBytes(layout.maxMutableGlobals);
+	return (numBytes + Platform::getBytesPerPage() - 1) & ~(Platform::getBytesPerPage() - 1);
+}
+
+Runtime::Compartment::Compartment(std::string&& inDebugName, const CompartmentLayout& inLayout)
 : GCObject(ObjectKind::compartment, this, std::move(inDebugName))
 , unalignedRuntimeData(nullptr)
-, tables(0, maxTables - 1)
+, layout(resolveLayout(inLayout))
+, contextsOffset(getContextsOffset(layout))
+, contextNumBytes(getContextNumBytes(layout.maxMutableGlobals))
+, numReservedBytes(getNumReservedBytes(layout, contextsOffset))
+, isCompact(isCompactLayout(layout))
+, tables(0, layout.maxTables - 1)
 , memories(0, maxMemories - 1)
 // Use UINTPTR_MAX as an invalid ID for globals, exception types, and instances.
 , globals(0, UINTPTR_MAX - 1)
 , exceptionTypes(0, UINTPTR_MAX - 1)
 , instances(0, UINTPTR_MAX - 1)
-, contexts(0, maxContexts - 1)
+, contexts(0, layout.maxContexts - 1)
 , foreigns(0, UINTPTR_MAX - 1)
 {
+	WAVM_ASSERT(numReservedBytes <= compartmentReservedBytes);
+
+	// Align the runtime data to 2GB even if the compartment reserves less than that, so the
+	// compiled code can find it by masking a context's address.
 	runtimeData = (CompartmentRuntimeData*)Platform::allocateAlignedVirtualPages(
-		compartmentReservedBytes >> Platform::getBytesPerPageLog2(),
+		numReservedBytes >> Platform::getBytesPerPageLog2(),
 		compartmentRuntimeDataAlignmentLog2,
 		unalignedRuntimeData);
 
+	// Prefer the compartment's NUMA node for the runtime data. This is only a hint, so ignore any
+	// failure.
+	if(layout.numaNode != UINTPTR_MAX)
+	{
+		Platform::setVirtualPagesNUMANode(
+			(U8*)runtimeData, numReservedBytes >> Platform::getBytesPerPageLog2(), layout.numaNode);
+	}
+
+	// Commit the runtime data for the memories and tables, and the contexts' runtime data if the
+	// compartment is compact.
+	const Uptr numCommittedBytes = isCompact ? numReservedBytes : contextsOffset;
 	WAVM_ERROR_UNLESS(Platform::commitVirtualPages(
-		(U8*)runtimeData,
-		offsetof(CompartmentRuntimeData, contexts) >> Platform::getBytesPerPageLog2()));
-	Platform::registerVirtualAllocation(offsetof(CompartmentRuntimeData, contexts));
+		(U8*)runtimeData, numCommittedBytes >> Platform::getBytesPerPageLog2()));
+	registerCommit(this, CommitKind::compartment, numCommittedBytes);
 
 	runtimeData->compartment = this;
 }
 
 Runtime::Compartment::~Compartment()
 {
-	Platform::RWMutex::ExclusiveLock compartmentLock(mutex);
+	if(backgroundGCObjectThreshold.load(std::memory_order_relaxed))
+	{ disableBackgroundGC(this); }
+
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(mutex);
 
 	WAVM_ASSERT(!memories.size());
 	WAVM_ASSERT(!tables.size());
@@ -51,42 +140,150 @@ Runtime::Compartment::~Compartment()
 	WAVM_ASSERT(!contexts.size());
 	WAVM_ASSERT(!foreigns.size());
 
+	// The pages of the free contexts' runtime data are still committed.
+	if(!isCompact) { deregisterCommit(this, CommitKind::compartment, numCommittedContextBytes); }
+	freeContextIds.clear();
+
 	Platform::freeAlignedVirtualPages(unalignedRuntimeData,
-									  compartmentReservedBytes >> Platform::getBytesPerPageLog2(),
+									  numReservedBytes >> Platform::getBytesPerPageLog2(),
 									  compartmentRuntimeDataAlignmentLog2);
-	Platform::deregisterVirtualAllocation(offsetof(CompartmentRuntimeData, contexts));
+	deregisterCommit(this, CommitKind::compartment, isCompact ? numReservedBytes : contextsOffset);
 	runtimeData = nullptr;
 	unalignedRuntimeData = nullptr;
 }
 
-Compartment* Runtime::createCompartment(std::string&& debugName)
+Compartment* Runtime::createCompartment(std::string&& debugName, const CompartmentLayout& layout)
 {
-	return new Compartment(std::move(debugName));
+	return new Compartment(std::move(debugName), layout);
+}
+
+CompartmentLayout Runtime::getCompartmentLayout(const Compartment* compartment)
+{
+	return compartment->layout;
+}
+
+// Clones are split between fewer threads if each thread would clone fewer than this many bytes of
+// tables and memories, or this many instances, since starting a thread takes longer than cloning a
+// small object.
+static constexpr Uptr minCloneBytesPerThread = Uptr(4) * 1024 * 1024;
+static constexpr Uptr minInstancesPerCloneThread = 16;
+
+namespace {
+	struct ParallelCloneState
+	{
+		Uptr numObjects;
+		const std::function<void(Uptr)>& cloneObject;
+		Uptr numaNode;
+		std::atomic<Uptr> nextObjectIndex{0};
+
+		ParallelCloneState(Uptr inNumObjects,
+						   const std::function<void(Uptr)>& inCloneObject,
+						   Uptr inNUMANode)
+		: numObjects(inNumObjects), cloneObject(inCloneObject), numaNode(inNUMANode)
+		{
+		}
+	};
+}
+
+static I64 parallelCloneThreadMain(void* stateVoid)
+{
+	ParallelCloneState& state = *(ParallelCloneState*)stateVoid;
+	while(true)
+	{
+		const Uptr objectIndex = state.nextObjectIndex.fetch_add(1, std::memory_order_relaxed);
+		if(objectIndex >= state.numObjects) { break; }
+		state.cloneObject(objectIndex);
+	}
+	return 0;
+}
+
+static I64 parallelCloneWorkerThreadMain(void* stateVoid)
+{
+	// Copy the objects on the compartment's NUMA node, if it has one.
+	ParallelCloneState& state = *(ParallelCloneState*)stateVoid;
+	if(state.numaNode != UINTPTR_MAX) { Platform::bindCurrentThreadToNUMANode(state.numaNode); }
+	return parallelCloneThreadMain(stateVoid);
+}
+
+// Calls cloneObject for each index in [0, numObjects) on the calling thread and up to
+// maxThreads - 1 additional threads. cloneObject publishes each object in the new compartment
+// itself, so the new compartment's mutex is only locked to add the objects' ids.
+static void cloneInParallel(Uptr numObjects,
+							Uptr maxThreads,
+							Uptr numaNode,
+							const std::function<void(Uptr)>& cloneObject)
+{
+	const Uptr numThreads
+		= std::max(Uptr(1),
+				   std::min({maxThreads, numObjects, Platform::getNumberOfHardwareThreads()}));
+	ParallelCloneState state(numObjects, cloneObject, numaNode);
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+	{
+		threads.push_back(
+			Platform::createThread(1024 * 1024, parallelCloneWorkerThreadMain, &state));
+	}
+	parallelCloneThreadMain(&state);
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
 }
 
 Compartment* Runtime::cloneCompartment(const Compartment* compartment, std::string&& debugName)
 {
 	Timing::Timer timer;
 
-	Compartment* newCompartment = new Compartment(std::move(debugName));
-	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	Compartment* newCompartment = new Compartment(std::move(debugName), compartment->layout);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
+	const Uptr numaNode = compartment->layout.numaNode;
+
+	// Allocate the clone's memories from the same memory pool as the original compartment. They
+	// may be in a different stripe of the pool.
+	newCompartment->memoryPool = compartment->memoryPool;
+	setCompartmentMemoryPoolStripe(newCompartment);
+	newCompartment->lazyMemoryClones.store(
+		compartment->lazyMemoryClones.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	newCompartment->atomicWaitSpinNanoseconds.store(
+		compartment->atomicWaitSpinNanoseconds.load(std::memory_order_relaxed),
+		std::memory_order_relaxed);
 
-	// Clone tables.
+	// Clone the tables and memories, which don't reference any other objects in the compartment,
+	// in parallel. The number of threads depends on how many bytes they have, since cloning them
+	// is dominated by copying their contents when the memories can't be shared copy-on-write.
+	std::vector<Table*> tables;
+	std::vector<Memory*> memories;
+	Uptr numTableAndMemoryBytes = 0;
 	for(Table* table : compartment->tables)
 	{
-		Table* newTable = cloneTable(table, newCompartment);
-		WAVM_ASSERT(newTable->id == table->id);
+		tables.push_back(table);
+		numTableAndMemoryBytes
+			+= table->numElements.load(std::memory_order_relaxed) * sizeof(Table::Element);
 	}
-
-	// Clone memories.
 	for(Memory* memory : compartment->memories)
 	{
-		Memory* newMemory = cloneMemory(memory, newCompartment);
-		WAVM_ASSERT(newMemory->id == memory->id);
+		memories.push_back(memory);
+		numTableAndMemoryBytes
+			+= memory->numPages.load(std::memory_order_relaxed) * IR::numBytesPerPage;
 	}
+	cloneInParallel(
+		tables.size() + memories.size(),
+		1 + numTableAndMemoryBytes / minCloneBytesPerThread,
+		numaNode,
+		[&tables, &memories, newCompartment](Uptr objectIndex) {
+			if(objectIndex < tables.size())
+			{
+				Table* newTable = cloneTable(tables[objectIndex], newCompartment);
+				WAVM_ASSERT(newTable->id == tables[objectIndex]->id);
+			}
+			else
+			{
+				Memory* memory = memories[objectIndex - tables.size()];
+				Memory* newMemory = cloneMemory(memory, newCompartment);
+				WAVM_ASSERT(newMemory->id == memory->id);
+			}
+		});
 
 	// Clone globals.
 	newCompartment->globalDataAllocationMask = compartment->globalDataAllocationMask;
+	newCompartment->numMutableGlobalSlotsUsed = compartment->numMutableGlobalSlotsUsed;
 	memcpy(newCompartment->initialContextMutableGlobals,
 		   compartment->initialContextMutableGlobals,
 		   sizeof(newCompartment->initialContextMutableGlobals));
@@ -104,12 +301,18 @@ Compartment* Runtime::cloneCompartment(const Compartment* compartment, std::stri
 		WAVM_ASSERT(newExceptionType->id == exceptionType->id);
 	}
 
-	// Clone instances.
-	for(Instance* instance : compartment->instances)
-	{
-		Instance* newInstance = cloneInstance(instance, newCompartment);
-		WAVM_ASSERT(newInstance->id == instance->id);
-	}
+	// Clone the instances in parallel. They reference the objects cloned above, but not each
+	// other.
+	std::vector<Instance*> instances;
+	for(Instance* instance : compartment->instances) { instances.push_back(instance); }
+	cloneInParallel(instances.size(),
+					instances.size() / minInstancesPerCloneThread,
+					numaNode,
+					[&instances, newCompartment](Uptr instanceIndex) {
+						Instance* newInstance
+							= cloneInstance(instances[instanceIndex], newCompartment);
+						WAVM_ASSERT(newInstance->id == instances[instanceIndex]->id);
+					});
 
 	Timing::logTimer("Cloned compartment", timer);
 	return newCompartment;
@@ -120,7 +323,7 @@ Object* Runtime::remapToClonedCompartment(const Object* object, const Compartmen
 	if(!object) { return nullptr; }
 	if(object->kind == ObjectKind::function) { return const_cast<Object*>(object); }
 
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	switch(object->kind)
 	{
 	case ObjectKind::table: return newCompartment->tables[asTable(object)->id];
@@ -147,40 +350,40 @@ Function* Runtime::remapToClonedCompartment(const Function* function,
 Table* Runtime::remapToClonedCompartment(const Table* table, const Compartment* newCompartment)
 {
 	if(!table) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->tables[table->id];
 }
 Memory* Runtime::remapToClonedCompartment(const Memory* memory, const Compartment* newCompartment)
 {
 	if(!memory) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->memories[memory->id];
 }
 Global* Runtime::remapToClonedCompartment(const Global* global, const Compartment* newCompartment)
 {
 	if(!global) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->globals[global->id];
 }
 ExceptionType* Runtime::remapToClonedCompartment(const ExceptionType* exceptionType,
 												 const Compartment* newCompartment)
 {
 	if(!exceptionType) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->exceptionTypes[exceptionType->id];
 }
 Instance* Runtime::remapToClonedCompartment(const Instance* instance,
 											const Compartment* newCompartment)
 {
 	if(!instance) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->instances[instance->id];
 }
 Foreign* Runtime::remapToClonedCompartment(const Foreign* foreign,
 										   const Compartment* newCompartment)
 {
 	if(!foreign) { return nullptr; }
-	Platform::RWMutex::ShareableLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(newCompartment->mutex);
 	return newCompartment->foreigns[foreign->id];
 }
 
@@ -189,17 +392,18 @@ bool Runtime::isInCompartment(const Object* object, const Compartment* compartme
 	if(object->kind == ObjectKind::function)
 	{
 		// The function may be in multiple compartments, but if this compartment maps the function's
-		// instanceId to a Instance with the LLVMJIT LoadedModule that contains this
-		// function, then the function is in this compartment.
+		// instanceId to a Instance with the LLVMJIT LoadedModule (or interpreted module) that
+		// contains this function, then the function is in this compartment.
 		Function* function = (Function*)object;
 
 		// Treat functions with instanceId=UINTPTR_MAX as if they are in all compartments.
 		if(function->instanceId == UINTPTR_MAX) { return true; }
 
-		Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 		if(!compartment->instances.contains(function->instanceId)) { return false; }
 		Instance* instance = compartment->instances[function->instanceId];
-		return instance->jitModule.get() == function->mutableData->jitModule;
+		return instance->jitModule.get() == function->mutableData->jitModule
+			   && instance->interpretedModule.get() == function->mutableData->interpretedModule;
 	}
 	else
 	{
@@ -0,0 +1,248 @@
+#include <string.h>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Validate.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/ForkServer.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// A request to a compile process holds the module's feature spec, the compile options and profile
+// as encoded by getCompileOptionsKey, and the module's WASM bytes. The response is a byte that is 1
+// if the module was compiled, followed by its object code. The compile processes are forked from
+// the same binary, so the feature spec and option fields are sent as their in-memory
+// representations.
+static_assert(std::is_trivially_copyable<FeatureSpec>::value,
+			  "FeatureSpec must be trivially copyable to send it to a compile process");
+
+// Calls visitField for each of the compile options that are sent to a compile process.
+template<typename Options, typename VisitField>
+static void visitCompileOptionFields(Options& options, VisitField&& visitField)
+{
+	visitField(options.tier);
+	visitField(options.optimizationLevel);
+	visitField(options.tierUpCallThreshold);
+	visitField(options.numPartitions);
+	visitField(options.maxPartitionCodeBytes);
+	visitField(options.inlineThreshold);
+	visitField(options.instrumentProfile);
+	visitField(options.countFunctionCalls);
+	visitField(options.measureFunctionCycles);
+	visitField(options.checkEpochDeadline);
+	visitField(options.meterFuel);
+	visitField(options.checkStackLimit);
+	visitField(options.relaxedNaN);
+	visitField(options.cacheStackPointer);
+	visitField(options.shareTrapBlocks);
+	visitField(options.debugInfoLevel);
+	visitField(options.eliminateDeadFunctions);
+	visitField(options.validateFunctionBodies);
+}
+
+static void appendBytes(std::vector<U8>& bytes, const void* data, Uptr numBytes)
+{
+	bytes.insert(bytes.end(), (const U8*)data, (const U8*)data + numBytes);
+}
+
+static bool decodeBytes(const std::vector<U8>& bytes, Uptr& inOutOffset, void* data, Uptr numBytes)
+{
+	if(bytes.size() - inOutOffset < numBytes) { return false; }
+	memcpy(data, bytes.data() + inOutOffset, numBytes);
+	inOutOffset += numBytes;
+	return true;
+}
+
+static bool decodeCompileRequest(const std::vector<U8>& request,
+								 IR::Module& outIRModule,
+								 LLVMJIT::CompileOptions& outCompileOptions)
+{
+	Uptr offset = 0;
+	if(!decodeBytes(request, offset, &outIRModule.featureSpec, sizeof(FeatureSpec)))
+	{ return false; }
+
+	bool decodedOptions = true;
+	visitCompileOptionFields(outCompileOptions, [&](auto& field) {
+		decodedOptions = decodedOptions && decodeBytes(request, offset, &field, sizeof(field));
+	});
+	if(!decodedOptions) { return false; }
+
+	U64 numProfileBytes = 0;
+	if(!decodeBytes(request, offset, &numProfileBytes, sizeof(numProfileBytes))
+	   || request.size() - offset < numProfileBytes)
+	{ return false; }
+	if(numProfileBytes)
+	{
+		std::shared_ptr<LLVMJIT::ModuleProfile> profile
+			= std::make_shared<LLVMJIT::ModuleProfile>();
+		const std::vector<U8> profileBytes(request.begin() + offset,
+										   request.begin() + offset + Uptr(numProfileBytes));
+		if(!LLVMJIT::deserializeProfile(profileBytes, *profile)) { return false; }
+		outCompileOptions.profile = profile;
+		offset += Uptr(numProfileBytes);
+	}
+
+	// A module that is compiled with validateFunctionBodies may have invalid function bodies, which
+	// compileModule checks instead of the loader.
+	const U8* wasmBytes = request.data() + offset;
+	const Uptr numWASMBytes = request.size() - offset;
+	return outCompileOptions.validateFunctionBodies
+			   ? WASM::loadBinaryModuleWithoutValidatingCode(wasmBytes, numWASMBytes, outIRModule)
+			   : WASM::loadBinaryModule(wasmBytes, numWASMBytes, outIRModule);
+}
+
+// Handles a request in a compile process.
+static std::vector<U8> handleCompileRequest(std::vector<U8>&& request)
+{
+	IR::Module irModule;
+	LLVMJIT::CompileOptions compileOptions;
+	std::vector<U8> response{0};
+	if(!decodeCompileRequest(request, irModule, compileOptions)) { return response; }
+	request = std::vector<U8>();
+
+	// If the module is invalid, the calling process compiles it again to throw the exception.
+	try
+	{
+		const std::vector<U8> objectCode
+			= LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec(), compileOptions);
+		response[0] = 1;
+		response.insert(response.end(), objectCode.begin(), objectCode.end());
+	}
+	catch(const ValidationException&)
+	{
+	}
+	return response;
+}
+
+struct CompileProcessPool
+{
+	Platform::Mutex mutex;
+	Platform::Event processReleasedEvent;
+	std::vector<Platform::HelperProcess*> freeProcesses;
+	Uptr numProcesses = 0;
+
+	~CompileProcessPool()
+	{
+		for(Platform::HelperProcess* process : freeProcesses)
+		{ Platform::destroyHelperProcess(process); }
+	}
+
+	// Waits for a free compile process, or returns null if there are no compile processes.
+	Platform::HelperProcess* acquireProcess()
+	{
+		while(true)
+		{
+			{
+				Platform::Mutex::Lock lock(mutex);
+				if(freeProcesses.size())
+				{
+					Platform::HelperProcess* process = freeProcesses.back();
+					freeProcesses.pop_back();
+					return process;
+				}
+				else if(!numProcesses)
+				{
+					// Wake any other thread that is waiting, so it sees there are no processes.
+					lock.unlock();
+					processReleasedEvent.signal();
+					return nullptr;
+				}
+			}
+			processReleasedEvent.wait(Time::infinity());
+		}
+	}
+
+	// Returns a compile process to the pool, or destroys it if it exited.
+	void releaseProcess(Platform::HelperProcess* process, bool hasExited)
+	{
+		{
+			Platform::Mutex::Lock lock(mutex);
+			if(!hasExited) { freeProcesses.push_back(process); }
+			else
+			{
+				--numProcesses;
+			}
+		}
+		if(hasExited) { Platform::destroyHelperProcess(process); }
+		processReleasedEvent.signal();
+	}
+};
+
+static CompileProcessPool compileProcessPool;
+
+static bool isCompiledInCompileProcesses(const LLVMJIT::CompileOptions& compileOptions)
+{
+	// The specialization, partition object cache, and function definitions to tier up can't be
+	// sent to a compile process, and a compile in another process can't be cancelled.
+	return !compileOptions.specialization && !compileOptions.partitionObjectCache
+		   && !compileOptions.tierUpFunctionDefIndices && !compileOptions.cancelFlag;
+}
+
+std::vector<U8> Runtime::getCompileOptionsKey(const LLVMJIT::CompileOptions& compileOptions)
+{
+	std::vector<U8> key;
+	visitCompileOptionFields(compileOptions, [&key](const auto& field) {
+		appendBytes(key, &field, sizeof(field));
+	});
+	std::vector<U8> profileBytes;
+	if(compileOptions.profile) { profileBytes = LLVMJIT::serializeProfile(*compileOptions.profile); }
+	const U64 numProfileBytes = profileBytes.size();
+	appendBytes(key, &numProfileBytes, sizeof(numProfileBytes));
+	appendBytes(key, profileBytes.data(), profileBytes.size());
+	return key;
+}
+
+bool Runtime::startCompileProcesses(Uptr numProcesses)
+{
+	for(Uptr processIndex = 0; processIndex < numProcesses; ++processIndex)
+	{
+		Platform::HelperProcess* process = Platform::forkHelperProcess(handleCompileRequest);
+		if(!process) { break; }
+
+		Platform::Mutex::Lock lock(compileProcessPool.mutex);
+		compileProcessPool.freeProcesses.push_back(process);
+		++compileProcessPool.numProcesses;
+	}
+
+	Platform::Mutex::Lock lock(compileProcessPool.mutex);
+	return compileProcessPool.numProcesses > 0;
+}
+
+std::vector<U8> Runtime::compileHostObjectCode(const IR::Module& irModule,
+											   const LLVMJIT::CompileOptions& compileOptions)
+{
+	Platform::HelperProcess* process = isCompiledInCompileProcesses(compileOptions)
+										   ? compileProcessPool.acquireProcess()
+										   : nullptr;
+	if(process)
+	{
+		std::vector<U8> request;
+		appendBytes(request, &irModule.featureSpec, sizeof(FeatureSpec));
+		const std::vector<U8> optionsKey = getCompileOptionsKey(compileOptions);
+		appendBytes(request, optionsKey.data(), optionsKey.size());
+		WASM::saveBinaryModule(irModule, [&request](const U8* bytes, Uptr numBytes) {
+			appendBytes(request, bytes, numBytes);
+		});
+
+		std::vector<U8> response;
+		const bool hasResponded = Platform::callHelperProcess(process, request, response);
+		compileProcessPool.releaseProcess(process, !hasResponded);
+
+		if(hasResponded && response.size() && response[0])
+		{ return std::vector<U8>(response.begin() + 1, response.end()); }
+	}
+
+	// If there are no compile processes, or the compile process failed to compile the module,
+	// compile it in this process.
+	return LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec(), compileOptions);
+}
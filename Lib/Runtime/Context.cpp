@@ -4,6 +4,8 @@
 #include "RuntimePrivate.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Memory.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -12,34 +14,88 @@
 using namespace WAVM;
 using namespace WAVM::Runtime;
 
+static ContextRuntimeData* getContextRuntimeDataById(Compartment* compartment, Uptr id)
+{
+	return reinterpret_cast<ContextRuntimeData*>(reinterpret_cast<U8*>(compartment->runtimeData)
+												 + compartment->contextsOffset
+												 + id * compartment->contextNumBytes);
+}
+
+// Whether each context's runtime data is a whole number of pages, so it can be committed and
+// decommitted independently of the other contexts.
+static bool areContextsPageAligned(Compartment* compartment)
+{
+	return !(compartment->contextNumBytes & (Platform::getBytesPerPage() - 1));
+}
+
+// Commits the pages of a new context's runtime data in a compartment that isn't compact.
+static void commitContextRuntimeData(Compartment* compartment, Uptr id)
+{
+	const Uptr bytesPerPage = Platform::getBytesPerPage();
+	const Uptr numCommittedBytes = compartment->numCommittedContextBytes;
+	U8* contextsBase
+		= reinterpret_cast<U8*>(compartment->runtimeData) + compartment->contextsOffset;
+
+	Uptr beginOffset = id * compartment->contextNumBytes;
+	Uptr endOffset = beginOffset + compartment->contextNumBytes;
+	if(!areContextsPageAligned(compartment))
+	{
+		// Contexts that share pages are never decommitted, so new IDs are allocated in increasing
+		// order, and only the pages past the ones that are already committed need to be committed.
+		if(endOffset <= numCommittedBytes) { return; }
+		beginOffset = numCommittedBytes;
+		endOffset = (endOffset + bytesPerPage - 1) & ~(bytesPerPage - 1);
+	}
+
+	const Uptr numBytes = endOffset - beginOffset;
+	WAVM_ERROR_UNLESS(Platform::commitVirtualPages(contextsBase + beginOffset,
+												   numBytes >> Platform::getBytesPerPageLog2()));
+	compartment->numCommittedContextBytes += numBytes;
+	registerCommit(compartment, CommitKind::compartment, numBytes);
+}
+
 Context* Runtime::createContext(Compartment* compartment, std::string&& debugName)
 {
 	WAVM_ASSERT(compartment);
 	Context* context = new Context(compartment, std::move(debugName));
 	{
-		Platform::RWMutex::ExclusiveLock lock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock lock(compartment->mutex);
 
-		// Allocate an ID for the context in the compartment.
-		context->id = compartment->contexts.add(UINTPTR_MAX, context);
-		if(context->id == UINTPTR_MAX)
+		if(compartment->freeContextIds.size())
 		{
-			delete context;
-			return nullptr;
+			// Reuse the ID and the already committed runtime data of a destroyed context.
+			context->id = compartment->freeContextIds.back();
+			compartment->freeContextIds.pop_back();
+			compartment->contexts.insertOrFail(context->id, context);
+			context->runtimeData = getContextRuntimeDataById(compartment, context->id);
 		}
-		context->runtimeData = &compartment->runtimeData->contexts[context->id];
+		else
+		{
+			// Allocate an ID for the context in the compartment.
+			context->id = compartment->contexts.add(UINTPTR_MAX, context);
+			if(context->id == UINTPTR_MAX)
+			{
+				delete context;
+				return nullptr;
+			}
+			context->runtimeData = getContextRuntimeDataById(compartment, context->id);
 
-		// Commit the page(s) for the context's runtime data.
-		WAVM_ERROR_UNLESS(Platform::commitVirtualPages(
-			(U8*)context->runtimeData,
-			sizeof(ContextRuntimeData) >> Platform::getBytesPerPageLog2()));
-		Platform::registerVirtualAllocation(sizeof(ContextRuntimeData));
+			// Commit the page(s) for the context's runtime data, unless the compartment is compact
+			// and committed them when it was created.
+			if(!compartment->isCompact) { commitContextRuntimeData(compartment, context->id); }
+		}
+		addYoungObject(context);
 
-		// Initialize the context's global data.
+		// Initialize the context's global data. The mutable globals past the ones that have been
+		// allocated are never written, so they are still zero.
 		memcpy(context->runtimeData->mutableGlobals,
 			   compartment->initialContextMutableGlobals,
-			   maxMutableGlobals * sizeof(IR::UntaggedValue));
+			   compartment->numMutableGlobalSlotsUsed * sizeof(IR::UntaggedValue));
 
 		context->runtimeData->context = context;
+		context->runtimeData->epochDeadline.store(UINT64_MAX, std::memory_order_relaxed);
+		context->runtimeData->fuel = INT64_MAX;
+		context->runtimeData->stackLimit = 0;
 	}
 
 	return context;
@@ -50,19 +106,202 @@ Runtime::Context::~Context()
 	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
 	compartment->contexts.removeOrFail(id);
 
-	Platform::decommitVirtualPages((U8*)runtimeData,
-								   sizeof(ContextRuntimeData) >> Platform::getBytesPerPageLog2());
-	Platform::deregisterVirtualAllocation(sizeof(ContextRuntimeData));
+	// Return the unconsumed fuel to the context's resource quota.
+	if(resourceQuota && runtimeData && runtimeData->fuel > 0)
+	{ resourceQuota->fuel.free(U64(runtimeData->fuel)); }
+
+	// Keep the runtime data committed for reuse by a new context, unless the compartment already
+	// has enough free contexts. A compact compartment's context runtime data is always committed,
+	// and runtime data that shares pages with other contexts can't be decommitted.
+	if(runtimeData
+	   && (compartment->isCompact || !areContextsPageAligned(compartment)
+		   || compartment->freeContextIds.size() < maxFreeContextsPerCompartment))
+	{
+		runtimeData->context = nullptr;
+		compartment->freeContextIds.push_back(id);
+	}
+	else if(runtimeData)
+	{
+		Platform::decommitVirtualPages(
+			(U8*)runtimeData, compartment->contextNumBytes >> Platform::getBytesPerPageLog2());
+		compartment->numCommittedContextBytes -= compartment->contextNumBytes;
+		deregisterCommit(compartment, CommitKind::compartment, compartment->contextNumBytes);
+	}
 }
 
 Compartment* Runtime::getCompartment(const Context* context) { return context->compartment; }
 
+U64 Runtime::incrementEpoch(Compartment* compartment)
+{
+	return compartment->runtimeData->epoch.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+U64 Runtime::getEpoch(const Compartment* compartment)
+{
+	return compartment->runtimeData->epoch.load(std::memory_order_relaxed);
+}
+
+void Runtime::setEpochDeadline(Context* context, U64 deadline)
+{
+	context->runtimeData->epochDeadline.store(deadline, std::memory_order_relaxed);
+}
+
+U64 Runtime::getEpochDeadline(const Context* context)
+{
+	return context->runtimeData->epochDeadline.load(std::memory_order_relaxed);
+}
+
+void Runtime::interruptContext(Context* context) { setEpochDeadline(context, 0); }
+
+void Runtime::setEpochDeadlineCallback(Context* context,
+									   EpochDeadlineCallback callback,
+									   void* userData)
+{
+	context->epochDeadlineCallback = callback;
+	context->epochDeadlineCallbackUserData = userData;
+}
+
+I64 Runtime::getContextFuel(const Context* context) { return context->runtimeData->fuel; }
+
+void Runtime::setContextFuel(Context* context, I64 fuel) { context->runtimeData->fuel = fuel; }
+
+void Runtime::setContextResourceQuota(Context* context, ResourceQuotaRefParam resourceQuota)
+{
+	if(context->resourceQuota && context->runtimeData->fuel > 0)
+	{ context->resourceQuota->fuel.free(U64(context->runtimeData->fuel)); }
+
+	context->resourceQuota = resourceQuota;
+	context->runtimeData->fuel = resourceQuota ? 0 : INT64_MAX;
+}
+
+void Runtime::setFuelExhaustedCallback(Context* context,
+									   FuelExhaustedCallback callback,
+									   void* userData)
+{
+	context->fuelExhaustedCallback = callback;
+	context->fuelExhaustedCallbackUserData = userData;
+}
+
+static Metrics::Counter& contextWallNanoseconds
+	= Metrics::getCounter("wavm_context_invoke_nanoseconds_total{clock=\"wall\"}",
+						  "Wall time accounted to contexts by their invokes");
+static Metrics::Counter& contextCPUNanoseconds
+	= Metrics::getCounter("wavm_context_invoke_nanoseconds_total{clock=\"cpu\"}",
+						  "Thread CPU time accounted to contexts by their invokes");
+static Metrics::Histogram& contextInvokeCPUNanoseconds
+	= Metrics::getHistogram("wavm_context_invoke_cpu_nanoseconds",
+							"Thread CPU time accounted to a context by each of its invokes");
+
+// The context that the calling thread is accounting time to, and the total time that the thread
+// has accounted to contexts, which a ContextTimeScope uses to exclude the time accounted by the
+// scopes nested in it. The context is only compared, so it may be a context that was destroyed
+// after a fiber that was accounting time to it moved to another thread.
+static thread_local Context* timedContext = nullptr;
+static thread_local U64 threadWallNanoseconds = 0;
+static thread_local U64 threadCPUNanoseconds = 0;
+
+Runtime::ContextTimeScope::ContextTimeScope(Context* inContext)
+: context(inContext), outerContext(timedContext)
+{
+	if(context == timedContext || !context->accountsTimes.load(std::memory_order_relaxed))
+	{
+		context = nullptr;
+		return;
+	}
+
+	timedContext = context;
+	startThreadWallNanoseconds = threadWallNanoseconds;
+	startThreadCPUNanoseconds = threadCPUNanoseconds;
+	startWallNanoseconds = U64(Platform::getClockTime(Platform::Clock::monotonic).ns);
+	startCPUNanoseconds = U64(Platform::getClockTime(Platform::Clock::threadCPUTime).ns);
+}
+
+Runtime::ContextTimeScope::~ContextTimeScope()
+{
+	if(!context) { return; }
+
+	const U64 endWallNanoseconds = U64(Platform::getClockTime(Platform::Clock::monotonic).ns);
+	const U64 endCPUNanoseconds = U64(Platform::getClockTime(Platform::Clock::threadCPUTime).ns);
+
+	// Exclude the time accounted by nested scopes. If a fiber moved to another thread while the
+	// scope was open, the thread's CPU time and accounted times aren't comparable to the ones at
+	// the start of the scope, so the difference is clamped to zero.
+	auto getExclusiveNanoseconds = [](U64 start, U64 end, U64 startNested, U64 endNested) {
+		const U64 numNanoseconds = end > start ? end - start : 0;
+		const U64 numNestedNanoseconds = endNested > startNested ? endNested - startNested : 0;
+		return numNanoseconds > numNestedNanoseconds ? numNanoseconds - numNestedNanoseconds : 0;
+	};
+	const U64 wallNanoseconds = getExclusiveNanoseconds(startWallNanoseconds,
+														  endWallNanoseconds,
+														  startThreadWallNanoseconds,
+														  threadWallNanoseconds);
+	const U64 cpuNanoseconds = getExclusiveNanoseconds(startCPUNanoseconds,
+														 endCPUNanoseconds,
+														 startThreadCPUNanoseconds,
+														 threadCPUNanoseconds);
+	threadWallNanoseconds += wallNanoseconds;
+	threadCPUNanoseconds += cpuNanoseconds;
+	timedContext = outerContext;
+
+	context->numTimedInvokes.fetch_add(1, std::memory_order_relaxed);
+	context->wallNanoseconds.fetch_add(wallNanoseconds, std::memory_order_relaxed);
+	context->cpuNanoseconds.fetch_add(cpuNanoseconds, std::memory_order_relaxed);
+	contextWallNanoseconds.add(wallNanoseconds);
+	contextCPUNanoseconds.add(cpuNanoseconds);
+	contextInvokeCPUNanoseconds.record(cpuNanoseconds);
+}
+
+ContextTimes Runtime::getContextTimes(const Context* context)
+{
+	ContextTimes times;
+	times.numInvokes = context->numTimedInvokes.load(std::memory_order_relaxed);
+	times.wallNanoseconds = context->wallNanoseconds.load(std::memory_order_relaxed);
+	times.cpuNanoseconds = context->cpuNanoseconds.load(std::memory_order_relaxed);
+	times.atomicWaitNanoseconds = context->atomicWaitNanoseconds.load(std::memory_order_relaxed);
+	return times;
+}
+
+void Runtime::setContextTimeAccounting(Context* context, bool accountTimes)
+{
+	if(accountTimes && !context->accountsTimes.load(std::memory_order_relaxed))
+	{
+		context->numTimedInvokes.store(0, std::memory_order_relaxed);
+		context->wallNanoseconds.store(0, std::memory_order_relaxed);
+		context->cpuNanoseconds.store(0, std::memory_order_relaxed);
+		context->atomicWaitNanoseconds.store(0, std::memory_order_relaxed);
+	}
+	context->accountsTimes.store(accountTimes, std::memory_order_relaxed);
+}
+
 Context* Runtime::cloneContext(const Context* context, Compartment* newCompartment)
 {
 	// Create a new context and initialize its runtime data with the values from the source context.
 	Context* clonedContext = createContext(newCompartment);
 	memcpy(clonedContext->runtimeData->mutableGlobals,
 		   context->runtimeData->mutableGlobals,
-		   maxMutableGlobals * sizeof(IR::UntaggedValue));
+		   context->compartment->numMutableGlobalSlotsUsed * sizeof(IR::UntaggedValue));
 	return clonedContext;
 }
+
+void Runtime::resetContext(Context* context)
+{
+	Compartment* compartment = context->compartment;
+	Platform::ReaderBiasedRWMutex::ShareableLock lock(compartment->mutex);
+	memcpy(context->runtimeData->mutableGlobals,
+		   compartment->initialContextMutableGlobals,
+		   compartment->numMutableGlobalSlotsUsed * sizeof(IR::UntaggedValue));
+}
+
+void Runtime::resetContexts(Context* const* contexts, Uptr numContexts)
+{
+	if(!numContexts) { return; }
+	Compartment* compartment = contexts[0]->compartment;
+	Platform::ReaderBiasedRWMutex::ShareableLock lock(compartment->mutex);
+	for(Uptr contextIndex = 0; contextIndex < numContexts; ++contextIndex)
+	{
+		WAVM_ASSERT(contexts[contextIndex]->compartment == compartment);
+		memcpy(contexts[contextIndex]->runtimeData->mutableGlobals,
+			   compartment->initialContextMutableGlobals,
+			   compartment->numMutableGlobalSlotsUsed * sizeof(IR::UntaggedValue));
+	}
+}
@@ -11,6 +11,7 @@
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/HashSet.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Diagnostics.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Platform/Signal.h"
@@ -125,13 +126,14 @@ ExceptionType* Runtime::createExceptionType(Compartment* compartment,
 {
 	auto exceptionType = new ExceptionType(compartment, sig, std::move(debugName));
 
-	Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 	exceptionType->id = compartment->exceptionTypes.add(UINTPTR_MAX, exceptionType);
 	if(exceptionType->id == UINTPTR_MAX)
 	{
 		delete exceptionType;
 		return nullptr;
 	}
+	addYoungObject(exceptionType);
 
 	return exceptionType;
 }
@@ -142,8 +144,11 @@ ExceptionType* Runtime::cloneExceptionType(ExceptionType* exceptionType,
 	auto newExceptionType = new ExceptionType(
 		newCompartment, exceptionType->sig, std::string(exceptionType->debugName));
 	newExceptionType->id = exceptionType->id;
+	newExceptionType->capturesCallStack.store(
+		exceptionType->capturesCallStack.load(std::memory_order_relaxed),
+		std::memory_order_relaxed);
 
-	Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 	newCompartment->exceptionTypes.insertOrFail(exceptionType->id, newExceptionType);
 	return newExceptionType;
 }
@@ -168,6 +173,38 @@ IR::TypeTuple Runtime::getExceptionTypeParameters(const ExceptionType* type)
 	return type->sig.params;
 }
 
+void Runtime::setExceptionTypeCapturesCallStack(ExceptionType* type, bool capturesCallStack)
+{
+	type->capturesCallStack.store(capturesCallStack, std::memory_order_relaxed);
+}
+
+// Captures the call stack for an exception of the given type, or returns an empty call stack if
+// exceptions of the type don't capture it. This must be inlined into its caller so the number of
+// omitted frames is the same as for a direct call to Platform::captureCallStack.
+#define CAPTURE_EXCEPTION_CALL_STACK(type, numOmittedFramesFromTop)                                \
+	((type)->capturesCallStack.load(std::memory_order_relaxed)                                     \
+		 ? Platform::captureCallStack(numOmittedFramesFromTop)                                     \
+		 : Platform::CallStack())
+
+// Exceptions with at most this many arguments, which includes those of all the intrinsic exception
+// types, are allocated from a per-thread cache of fixed-size blocks. Once a thread has destroyed an
+// exception, creating and destroying exceptions on it doesn't allocate.
+static constexpr Uptr maxPooledExceptionArguments = 4;
+static constexpr Uptr maxCachedExceptionBlocksPerThread = 16;
+
+struct ExceptionBlockCache
+{
+	void* blocks[maxCachedExceptionBlocksPerThread];
+	Uptr numBlocks = 0;
+
+	~ExceptionBlockCache()
+	{
+		for(Uptr blockIndex = 0; blockIndex < numBlocks; ++blockIndex) { free(blocks[blockIndex]); }
+	}
+};
+
+static thread_local ExceptionBlockCache exceptionBlockCache;
+
 Exception* Runtime::createException(ExceptionType* type,
 									const IR::UntaggedValue* arguments,
 									Uptr numArguments,
@@ -176,18 +213,59 @@ Exception* Runtime::createException(ExceptionType* type,
 	const IR::TypeTuple& params = type->sig.params;
 	WAVM_ASSERT(numArguments == params.size());
 
+	void* exceptionBlock;
+	const bool isPooled = params.size() <= maxPooledExceptionArguments;
+	if(!isPooled) { exceptionBlock = malloc(Exception::calcNumBytes(params.size())); }
+	else if(exceptionBlockCache.numBlocks)
+	{
+		exceptionBlock = exceptionBlockCache.blocks[--exceptionBlockCache.numBlocks];
+	}
+	else
+	{
+		exceptionBlock = malloc(Exception::calcNumBytes(maxPooledExceptionArguments));
+	}
+
+	// Discard the call stack if the exception type doesn't capture it. This is only needed for
+	// call stacks that were captured before the exception type was known, like those of signals.
 	const bool isUserException = type->compartment != nullptr;
-	Exception* exception = new(malloc(Exception::calcNumBytes(params.size())))
-		Exception(type->id, type, isUserException, std::move(callStack));
+	Exception* exception = new(exceptionBlock)
+		Exception(type->id,
+				  type,
+				  isUserException,
+				  type->capturesCallStack.load(std::memory_order_relaxed) ? std::move(callStack)
+																		  : Platform::CallStack());
+	exception->isPooled = isPooled ? 1 : 0;
 	if(params.size())
 	{ memcpy(exception->arguments, arguments, sizeof(IR::UntaggedValue) * params.size()); }
+
+	// Count the traps of each runtime exception type. The counter is looked up the first time an
+	// exception of the type is created, since the lookup formats its name and takes a lock.
+	if(!isUserException)
+	{
+		Metrics::Counter* trapsCounter = type->trapsCounter.load(std::memory_order_acquire);
+		if(!trapsCounter)
+		{
+			trapsCounter = &Metrics::getCounter(
+				("wavm_traps_total{type=\"" + type->debugName + "\"}").c_str(),
+				"Runtime exceptions, by type");
+			type->trapsCounter.store(trapsCounter, std::memory_order_release);
+		}
+		trapsCounter->add();
+	}
+
 	return exception;
 }
 
 void Runtime::destroyException(Exception* exception)
 {
+	const bool isPooled = exception->isPooled;
 	exception->~Exception();
-	free(exception);
+	if(isPooled && exceptionBlockCache.numBlocks < maxCachedExceptionBlocksPerThread)
+	{ exceptionBlockCache.blocks[exceptionBlockCache.numBlocks++] = exception; }
+	else
+	{
+		free(exception);
+	}
 }
 
 ExceptionType* Runtime::getExceptionType(const Exception* exception) { return exception->type; }
@@ -254,6 +332,8 @@ std::string Runtime::describeException(const Exception* exception)
 		}
 		result += ')';
 	}
+	if(!exception->callStack.frames.size()) { return result; }
+
 	std::vector<std::string> callStackDescription = describeCallStack(exception->callStack);
 	result += "\nCall stack:\n";
 	for(auto calledFunction : callStackDescription)
@@ -271,8 +351,8 @@ std::string Runtime::describeException(const Exception* exception)
 										  const std::vector<IR::UntaggedValue>& arguments)
 {
 	WAVM_ASSERT(type->sig.params.size() == arguments.size());
-	throwException(
-		createException(type, arguments.data(), arguments.size(), Platform::captureCallStack(1)));
+	throwException(createException(
+		type, arguments.data(), arguments.size(), CAPTURE_EXCEPTION_CALL_STACK(type, 1)));
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsException,
@@ -286,13 +366,15 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsException,
 	ExceptionType* exceptionType;
 	{
 		Compartment* compartment = getCompartmentRuntimeData(contextRuntimeData)->compartment;
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 		exceptionType = compartment->exceptionTypes[exceptionTypeId];
 	}
 	auto args = reinterpret_cast<const IR::UntaggedValue*>(Uptr(argsBits));
 
-	Exception* exception = createException(
-		exceptionType, args, exceptionType->sig.params.size(), Platform::captureCallStack(1));
+	Exception* exception = createException(exceptionType,
+										   args,
+										   exceptionType->sig.params.size(),
+										   CAPTURE_EXCEPTION_CALL_STACK(exceptionType, 1));
 
 	return reinterpret_cast<Uptr>(exception);
 }
@@ -403,33 +485,99 @@ void Runtime::catchRuntimeExceptions(const std::function<void()>& thunk,
 
 void Runtime::unwindSignalsAsExceptions(const std::function<void()>& thunk)
 {
-	// Catch signals and translate them into runtime exceptions.
-	struct UnwindContext
+	unwindSignalsAsExceptions(
+		[](void* thunkVoid) { (*(const std::function<void()>*)thunkVoid)(); }, (void*)&thunk);
+}
+
+// The signal that was caught by a call to unwindSignalsAsExceptions, saved by the signal filter for
+// translation into a runtime exception after the signal handler jumps back to the call.
+struct CaughtSignal
+{
+	Platform::Signal signal;
+	Platform::CallStack callStack;
+};
+
+static bool filterRuntimeExceptionSignal(void* caughtSignalVoid,
+										 Platform::Signal signal,
+										 Platform::CallStack&& callStack)
+{
+	if(!isRuntimeException(signal)) { return false; }
+	else
 	{
-		const std::function<void()>* thunk;
-		Platform::Signal signal;
-		Platform::CallStack callStack;
-	} context;
-	context.thunk = &thunk;
-	if(Platform::catchSignals(
-		   [](void* contextVoid) {
-			   UnwindContext& context = *(UnwindContext*)contextVoid;
-			   (*context.thunk)();
-		   },
-		   [](void* contextVoid, Platform::Signal signal, Platform::CallStack&& callStack) {
-			   if(!isRuntimeException(signal)) { return false; }
-			   else
-			   {
-				   UnwindContext& context = *(UnwindContext*)contextVoid;
-				   context.signal = signal;
-				   context.callStack = std::move(callStack);
-				   return true;
-			   }
-		   },
-		   &context))
+		CaughtSignal& caughtSignal = *(CaughtSignal*)caughtSignalVoid;
+		caughtSignal.signal = signal;
+		caughtSignal.callStack = std::move(callStack);
+		return true;
+	}
+}
+
+struct Runtime::ExecutionScopeState
+{
+	Platform::SignalScope* signalScope;
+	ExecutionScopeState* outerState;
+	CaughtSignal caughtSignal;
+};
+
+static thread_local ExecutionScopeState* innermostExecutionScopeState = nullptr;
+
+Runtime::ExecutionScope::ExecutionScope() : state(new ExecutionScopeState)
+{
+	state->signalScope
+		= Platform::enterSignalScope(filterRuntimeExceptionSignal, &state->caughtSignal);
+	state->outerState = innermostExecutionScopeState;
+	innermostExecutionScopeState = state;
+}
+
+Runtime::ExecutionScope::~ExecutionScope()
+{
+	WAVM_ERROR_UNLESS(innermostExecutionScopeState == state);
+	innermostExecutionScopeState = state->outerState;
+	Platform::exitSignalScope(state->signalScope);
+	delete state;
+}
+
+void Runtime::unwindSignalsAsExceptions(void (*thunk)(void*), void* argument)
+{
+	// Catch signals and translate them into runtime exceptions, reusing the signal catching state
+	// of the thread's innermost execution scope if there is one.
+	ExecutionScopeState* scopeState = innermostExecutionScopeState;
+	if(scopeState)
+	{
+		if(Platform::catchSignalsInScope(scopeState->signalScope, thunk, argument))
+		{
+			Exception* exception = nullptr;
+			translateSignalToRuntimeException(scopeState->caughtSignal.signal,
+											  std::move(scopeState->caughtSignal.callStack),
+											  exception);
+			throw exception;
+		}
+	}
+	else
 	{
-		Exception* exception = nullptr;
-		translateSignalToRuntimeException(context.signal, std::move(context.callStack), exception);
-		throw exception;
+		struct UnwindContext
+		{
+			void (*thunk)(void*);
+			void* argument;
+			CaughtSignal caughtSignal;
+		} context;
+		context.thunk = thunk;
+		context.argument = argument;
+		if(Platform::catchSignals(
+			   [](void* contextVoid) {
+				   UnwindContext& context = *(UnwindContext*)contextVoid;
+				   (*context.thunk)(context.argument);
+			   },
+			   [](void* contextVoid, Platform::Signal signal, Platform::CallStack&& callStack) {
+				   UnwindContext& context = *(UnwindContext*)contextVoid;
+				   return filterRuntimeExceptionSignal(
+					   &context.caughtSignal, signal, std::move(callStack));
+			   },
+			   &context))
+		{
+			Exception* exception = nullptr;
+			translateSignalToRuntimeException(
+				context.caughtSignal.signal, std::move(context.caughtSignal.callStack), exception);
+			throw exception;
+		}
 	}
 }
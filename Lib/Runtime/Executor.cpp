@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <future>
+#include <string>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+struct ExecutorTask
+{
+	const Function* function;
+	const void* invokeThunk;
+	std::vector<UntaggedValue> arguments;
+	Uptr numResults;
+	std::promise<ExecutorResult> promise;
+};
+
+struct ExecutorWorker
+{
+	Executor* executor;
+	Uptr index;
+	Platform::Thread* platformThread = nullptr;
+
+	// The worker pops tasks from the back of its queue, and other workers steal them from the
+	// front.
+	Platform::Mutex queueMutex;
+	std::deque<ExecutorTask*> queue;
+
+	// Signaled when the worker is removed from the executor's sleeping workers.
+	Platform::Event wakeEvent;
+
+	// Only accessed by the worker's thread.
+	GCPointer<Context> context;
+};
+
+struct Runtime::Executor
+{
+	Compartment* compartment;
+	ExecutorConfig config;
+	std::vector<ExecutorWorker*> workers;
+
+	// The number of tasks in all the workers' queues.
+	std::atomic<Uptr> numQueuedTasks{0};
+	std::atomic<Uptr> nextSubmitWorkerIndex{0};
+
+	// Workers that found no tasks to run, and are waiting for their wakeEvent to be signaled.
+	Platform::Mutex sleepMutex;
+	std::vector<ExecutorWorker*> sleepingWorkers;
+	bool isStopping = false;
+};
+
+static thread_local ExecutorWorker* currentWorker = nullptr;
+
+static ExecutorTask* popTask(ExecutorWorker* worker, bool fromBack)
+{
+	Platform::Mutex::Lock queueLock(worker->queueMutex);
+	if(worker->queue.empty()) { return nullptr; }
+
+	ExecutorTask* task;
+	if(fromBack)
+	{
+		task = worker->queue.back();
+		worker->queue.pop_back();
+	}
+	else
+	{
+		task = worker->queue.front();
+		worker->queue.pop_front();
+	}
+	worker->executor->numQueuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+	return task;
+}
+
+// Returns the next task for a worker to run, or null if the executor is being destroyed and there
+// are no more queued tasks.
+static ExecutorTask* takeTask(ExecutorWorker* worker)
+{
+	Executor* executor = worker->executor;
+	const Uptr numWorkers = executor->workers.size();
+	while(true)
+	{
+		// Run the worker's most recently queued task, which is the most likely to have its
+		// arguments in the worker's cache.
+		if(ExecutorTask* task = popTask(worker, true)) { return task; }
+
+		// Otherwise, steal the oldest task from another worker.
+		for(Uptr offset = 1; offset < numWorkers; ++offset)
+		{
+			ExecutorWorker* victim = executor->workers[(worker->index + offset) % numWorkers];
+			if(ExecutorTask* task = popTask(victim, false)) { return task; }
+		};
+
+		// Sleep until a task is queued, or the executor is destroyed. Submitters wake a sleeping
+		// worker after queuing a task, so checking the number of queued tasks while holding
+		// sleepMutex ensures the worker doesn't sleep through a task.
+		{
+			Platform::Mutex::Lock sleepLock(executor->sleepMutex);
+			if(executor->numQueuedTasks.load(std::memory_order_acquire)) { continue; }
+			if(executor->isStopping) { return nullptr; }
+			executor->sleepingWorkers.push_back(worker);
+		}
+		WAVM_ERROR_UNLESS(worker->wakeEvent.wait(Time::infinity()));
+	};
+}
+
+static void runTask(ExecutorWorker* worker, ExecutorTask* task)
+{
+	ExecutorResult result;
+	result.results.resize(task->numResults);
+	try
+	{
+		catchRuntimeExceptions(
+			[&]() {
+				invokeFunctionWithThunk(worker->context,
+										task->function,
+										task->invokeThunk,
+										task->arguments.data(),
+										result.results.data());
+			},
+			[&](Exception* exception) {
+				result.results.clear();
+				result.exception = exception;
+			});
+		task->promise.set_value(std::move(result));
+	}
+	catch(...)
+	{
+		task->promise.set_exception(std::current_exception());
+	}
+
+	removeGCRoot(task->function);
+	delete task;
+}
+
+static I64 workerThreadEntry(void* workerVoid)
+{
+	ExecutorWorker* worker = (ExecutorWorker*)workerVoid;
+	Executor* executor = worker->executor;
+	currentWorker = worker;
+
+	// Run the tasks on the compartment's NUMA node, if it has one.
+	const Uptr numaNode = getCompartmentLayout(executor->compartment).numaNode;
+	if(numaNode != UINTPTR_MAX) { Platform::bindCurrentThreadToNUMANode(numaNode); }
+
+	worker->context
+		= createContext(executor->compartment, "executor worker " + std::to_string(worker->index));
+
+	// Set up the signal catching state once for all the tasks the worker runs.
+	{
+		ExecutionScope executionScope;
+		while(ExecutorTask* task = takeTask(worker)) { runTask(worker, task); };
+	}
+
+	worker->context = nullptr;
+	currentWorker = nullptr;
+	return 0;
+}
+
+Executor* Runtime::createExecutor(Compartment* compartment, const ExecutorConfig& config)
+{
+	Executor* executor = new Executor;
+	executor->compartment = compartment;
+	executor->config = config;
+
+	const Uptr numWorkerThreads = config.numWorkerThreads
+									  ? config.numWorkerThreads
+									  : std::max(Uptr(1), Platform::getNumberOfHardwareThreads());
+	for(Uptr workerIndex = 0; workerIndex < numWorkerThreads; ++workerIndex)
+	{
+		ExecutorWorker* worker = new ExecutorWorker;
+		worker->executor = executor;
+		worker->index = workerIndex;
+		executor->workers.push_back(worker);
+	}
+
+	// Start the threads after all the workers are created, since they steal from each other.
+	for(ExecutorWorker* worker : executor->workers)
+	{
+		worker->platformThread
+			= Platform::createThread(config.numStackBytes, workerThreadEntry, worker);
+	}
+
+	return executor;
+}
+
+void Runtime::destroyExecutor(Executor* executor)
+{
+	WAVM_ERROR_UNLESS(!currentWorker || currentWorker->executor != executor);
+
+	// Wake the sleeping workers, which exit once there are no more queued tasks.
+	{
+		Platform::Mutex::Lock sleepLock(executor->sleepMutex);
+		executor->isStopping = true;
+		for(ExecutorWorker* worker : executor->sleepingWorkers) { worker->wakeEvent.signal(); }
+		executor->sleepingWorkers.clear();
+	}
+
+	for(ExecutorWorker* worker : executor->workers)
+	{
+		Platform::joinThread(worker->platformThread);
+		WAVM_ASSERT(worker->queue.empty());
+		delete worker;
+	}
+	delete executor;
+}
+
+std::future<ExecutorResult> Runtime::submitToExecutor(Executor* executor,
+													  const Function* function,
+													  FunctionType invokeSig,
+													  const UntaggedValue arguments[])
+{
+	WAVM_ERROR_UNLESS(isInCompartment(asObject(function), executor->compartment));
+
+	const void* invokeThunk = getInvokeThunk(function, invokeSig);
+	if(!invokeThunk) { throwException(ExceptionTypes::invokeSignatureMismatch); }
+
+	ExecutorTask* task = new ExecutorTask;
+	task->function = function;
+	task->invokeThunk = invokeThunk;
+	task->arguments.assign(arguments, arguments + invokeSig.params().size());
+	task->numResults = invokeSig.results().size();
+	std::future<ExecutorResult> future = task->promise.get_future();
+
+	// Keep the function alive until the task has run.
+	addGCRoot(function);
+
+	// Queue tasks submitted by a worker's task on the worker's own queue, so they run while their
+	// arguments are in its cache unless another worker steals them. Distribute the other tasks
+	// over the workers round robin.
+	ExecutorWorker* worker = currentWorker;
+	if(!worker || worker->executor != executor)
+	{
+		const Uptr workerIndex = executor->nextSubmitWorkerIndex.fetch_add(1);
+		worker = executor->workers[workerIndex % executor->workers.size()];
+	}
+	{
+		Platform::Mutex::Lock queueLock(worker->queueMutex);
+		worker->queue.push_back(task);
+		executor->numQueuedTasks.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	// Wake a sleeping worker to run the task, preferring the worker it was queued on.
+	Platform::Mutex::Lock sleepLock(executor->sleepMutex);
+	if(executor->sleepingWorkers.size())
+	{
+		auto wakeIt = std::find(
+			executor->sleepingWorkers.begin(), executor->sleepingWorkers.end(), worker);
+		if(wakeIt == executor->sleepingWorkers.end()) { wakeIt = executor->sleepingWorkers.begin(); }
+		ExecutorWorker* wakeWorker = *wakeIt;
+		executor->sleepingWorkers.erase(wakeIt);
+		wakeWorker->wakeEvent.signal();
+	}
+
+	return future;
+}
+
+Uptr Runtime::getExecutorNumWorkerThreads(const Executor* executor)
+{
+	return executor->workers.size();
+}
@@ -0,0 +1,195 @@
+#include <exception>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+struct Runtime::Fiber
+{
+	Context* context;
+	const Function* function;
+	const void* invokeThunk;
+	std::vector<UntaggedValue> arguments;
+	std::vector<UntaggedValue> results;
+
+	Platform::Fiber* platformFiber = nullptr;
+
+	// The fiber that was running when this fiber was resumed.
+	Fiber* resumerFiber = nullptr;
+
+	// An exception thrown by the invoked function, which is rethrown by resumeFiber.
+	std::exception_ptr exception;
+
+	bool isStarted = false;
+	bool isFinished = false;
+
+	// The context's stack limit for the fiber's stack while the fiber is suspended.
+	Uptr stackLimit = 0;
+
+	// The thread's protection key rights and current memory protection key when the fiber was
+	// suspended, if its compartment uses protection keys.
+	U32 protectionKeyRights = 0;
+	I32 memoryProtectionKey = -1;
+};
+
+static thread_local Runtime::Fiber* currentFiber = nullptr;
+
+static void fiberEntry(void* argument)
+{
+	Runtime::Fiber* fiber = (Runtime::Fiber*)argument;
+
+	// Exceptions can't be unwound past the bottom of the fiber's stack, so catch them here, and
+	// rethrow them on the resumer's stack.
+	try
+	{
+		invokeFunctionWithThunk(fiber->context,
+								fiber->function,
+								fiber->invokeThunk,
+								fiber->arguments.data(),
+								fiber->results.data());
+	}
+	catch(...)
+	{
+		fiber->exception = std::current_exception();
+	}
+}
+
+Runtime::Fiber* Runtime::createFiber(Context* context,
+									 const Function* function,
+									 FunctionType invokeSig,
+									 const UntaggedValue arguments[],
+									 Uptr numStackBytes)
+{
+	const void* invokeThunk = getInvokeThunk(function, invokeSig);
+	if(!invokeThunk) { throwException(ExceptionTypes::invokeSignatureMismatch); }
+
+	Fiber* fiber = new Fiber;
+	fiber->context = context;
+	fiber->function = function;
+	fiber->invokeThunk = invokeThunk;
+	fiber->arguments.assign(arguments, arguments + invokeSig.params().size());
+	fiber->results.resize(invokeSig.results().size());
+	fiber->platformFiber = Platform::createFiber(numStackBytes, fiberEntry, fiber);
+
+	// Keep the context and function alive while the fiber references them.
+	addGCRoot(context);
+	addGCRoot(function);
+
+	return fiber;
+}
+
+void Runtime::destroyFiber(Fiber* fiber)
+{
+	WAVM_ERROR_UNLESS(fiber != currentFiber);
+	Platform::destroyFiber(fiber->platformFiber);
+	removeGCRoot(fiber->context);
+	removeGCRoot(fiber->function);
+	delete fiber;
+}
+
+// Resumes a fiber. If isSuspendable is false, the caller can't handle the fiber being suspended,
+// so the fiber's file I/O blocks the thread instead of suspending it.
+static bool resumeFiberImpl(Runtime::Fiber* fiber, UntaggedValue outResults[], bool isSuspendable)
+{
+	WAVM_ERROR_UNLESS(!fiber->isFinished);
+
+	// Account the time the fiber runs to its context on this thread. The invoke on the fiber's
+	// stack doesn't account it again, since this thread is already accounting time to the context.
+	ContextTimeScope contextTimeScope(fiber->context);
+
+	// The fiber's context may also be running on the resumer's stack, so give it the fiber's stack
+	// limit while the fiber runs.
+	ContextRuntimeData* contextRuntimeData = getContextRuntimeData(fiber->context);
+	const Uptr resumerStackLimit = contextRuntimeData->stackLimit;
+	contextRuntimeData->stackLimit = fiber->stackLimit;
+
+	// The protection key rights are only set by the outermost invoke on a thread, so a fiber that
+	// is suspended by a host function must take the rights the invoke on its stack set with it,
+	// rather than leaving them to the resumer or running with the rights of the thread that
+	// resumes it.
+	const bool usesProtectionKeys = fiber->context->compartment->memoryProtectionKey >= 0;
+	U32 resumerProtectionKeyRights = 0;
+	I32 resumerMemoryProtectionKey = -1;
+	if(usesProtectionKeys)
+	{
+		resumerProtectionKeyRights = Platform::getProtectionKeyRights();
+		resumerMemoryProtectionKey = currentMemoryProtectionKey;
+		if(fiber->isStarted)
+		{
+			Platform::setProtectionKeyRights(fiber->protectionKeyRights);
+			currentMemoryProtectionKey = fiber->memoryProtectionKey;
+		}
+	}
+
+	fiber->isStarted = true;
+	fiber->resumerFiber = currentFiber;
+	currentFiber = fiber;
+	fiber->isFinished = Platform::switchToFiber(fiber->platformFiber, isSuspendable);
+	currentFiber = fiber->resumerFiber;
+	fiber->resumerFiber = nullptr;
+
+	if(usesProtectionKeys)
+	{
+		fiber->protectionKeyRights = Platform::getProtectionKeyRights();
+		fiber->memoryProtectionKey = currentMemoryProtectionKey;
+		Platform::setProtectionKeyRights(resumerProtectionKeyRights);
+		currentMemoryProtectionKey = resumerMemoryProtectionKey;
+	}
+
+	fiber->stackLimit = contextRuntimeData->stackLimit;
+	contextRuntimeData->stackLimit = resumerStackLimit;
+
+	if(!fiber->isFinished) { return false; }
+	if(fiber->exception) { std::rethrow_exception(fiber->exception); }
+
+	for(Uptr resultIndex = 0; resultIndex < fiber->results.size(); ++resultIndex)
+	{ outResults[resultIndex] = fiber->results[resultIndex]; }
+	return true;
+}
+
+bool Runtime::resumeFiber(Fiber* fiber, UntaggedValue outResults[])
+{
+	return resumeFiberImpl(fiber, outResults, true);
+}
+
+void Runtime::suspendFiber()
+{
+	WAVM_ERROR_UNLESS(currentFiber);
+	Platform::switchFromFiber();
+}
+
+Runtime::Fiber* Runtime::getCurrentFiber() { return currentFiber; }
+
+void Runtime::invokeFunctionOnFiberStack(Context* context,
+										 const Function* function,
+										 FunctionType invokeSig,
+										 const UntaggedValue arguments[],
+										 UntaggedValue results[],
+										 Uptr numStackBytes)
+{
+	Fiber* fiber = createFiber(context, function, invokeSig, arguments, numStackBytes);
+
+	bool isFinished;
+	try
+	{
+		isFinished = resumeFiberImpl(fiber, results, false);
+	}
+	catch(...)
+	{
+		destroyFiber(fiber);
+		throw;
+	}
+
+	if(!isFinished) { Errors::fatalf("invokeFunctionOnFiberStack: the fiber was suspended"); }
+	destroyFiber(fiber);
+}
@@ -24,8 +24,10 @@ Global* Runtime::createGlobal(Compartment* compartment,
 	if(type.isMutable)
 	{
 		mutableGlobalIndex = compartment->globalDataAllocationMask.getSmallestNonMember();
-		if(mutableGlobalIndex == maxMutableGlobals) { return nullptr; }
+		if(mutableGlobalIndex >= compartment->layout.maxMutableGlobals) { return nullptr; }
 		compartment->globalDataAllocationMask.add(mutableGlobalIndex);
+		if(mutableGlobalIndex >= compartment->numMutableGlobalSlotsUsed)
+		{ compartment->numMutableGlobalSlotsUsed = mutableGlobalIndex + 1; }
 
 		// Zero-initialize the global's mutable value for all current and future contexts.
 		compartment->initialContextMutableGlobals[mutableGlobalIndex] = IR::UntaggedValue();
@@ -36,13 +38,14 @@ Global* Runtime::createGlobal(Compartment* compartment,
 	// Create the global and add it to the compartment's list of globals.
 	Global* global = new Global(compartment, type, mutableGlobalIndex, std::move(debugName));
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 		global->id = compartment->globals.add(UINTPTR_MAX, global);
 		if(global->id == UINTPTR_MAX)
 		{
 			delete global;
 			return nullptr;
 		}
+		addYoungObject(global);
 	}
 
 	return global;
@@ -89,7 +92,7 @@ Global* Runtime::cloneGlobal(Global* global, Compartment* newCompartment)
 								   initialValue);
 	newGlobal->id = global->id;
 
-	Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 	newCompartment->globals.insertOrFail(global->id, newGlobal);
 	return newGlobal;
 }
@@ -104,7 +107,7 @@ Runtime::Global::~Global()
 
 	if(type.isMutable)
 	{
-		WAVM_ASSERT(mutableGlobalIndex < maxMutableGlobals);
+		WAVM_ASSERT(mutableGlobalIndex < compartment->layout.maxMutableGlobals);
 		WAVM_ASSERT(compartment->globalDataAllocationMask.contains(mutableGlobalIndex));
 		compartment->globalDataAllocationMask.remove(mutableGlobalIndex);
 	}
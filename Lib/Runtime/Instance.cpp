@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include "RuntimePrivate.h"
@@ -7,10 +8,12 @@
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Trace.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -75,6 +78,8 @@ Instance* Runtime::instantiateModule(Compartment* compartment,
 									 std::string&& moduleDebugName,
 									 ResourceQuotaRefParam resourceQuota)
 {
+	Trace::Scope traceScope("runtime", "instantiate");
+
 	// Check the types of the Instance's imports, and build per-kind import arrays.
 	std::vector<FunctionImportBinding> functionImports;
 	std::vector<Table*> tableImports;
@@ -145,6 +150,91 @@ Instance* Runtime::instantiateModule(Compartment* compartment,
 									 resourceQuota);
 }
 
+const HashMap<std::string, LLVMJIT::FunctionBinding>& Runtime::getWAVMIntrinsicsExportMap()
+{
+	static const HashMap<std::string, LLVMJIT::FunctionBinding> wavmIntrinsicsExportMap = [] {
+		HashMap<std::string, LLVMJIT::FunctionBinding> result;
+		for(const HashMapPair<std::string, Intrinsics::Function*>& intrinsicFunctionPair :
+			Intrinsics::getUninstantiatedFunctions(
+				{WAVM_INTRINSIC_MODULE_REF(wavmIntrinsics),
+				 WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsAtomics),
+				 WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsException),
+				 WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsMemory),
+				 WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsTable)}))
+		{
+			LLVMJIT::FunctionBinding functionBinding{
+				intrinsicFunctionPair.value->getNativeFunction()};
+			result.add(intrinsicFunctionPair.key, functionBinding);
+		}
+		return result;
+	}();
+	return wavmIntrinsicsExportMap;
+}
+
+// Returns the specialization of a module for an instance's imported global values, memory sizes,
+// intrinsics with inline bodies, and pure intrinsics.
+static LLVMJIT::ModuleSpecialization getSpecialization(ModuleConstRefParam module,
+													   const std::vector<Function*>& functions,
+													   const std::vector<Memory*>& memories,
+													   const std::vector<Global*>& globals)
+{
+	LLVMJIT::ModuleSpecialization specialization;
+
+	// Imports of WebAssembly functions that are the thunks of intrinsics with inline bodies are
+	// specialized to inline the bodies.
+	bool isAnyFunctionSpecialized = false;
+	for(Uptr importIndex = 0; importIndex < module->ir.functions.imports.size(); ++importIndex)
+	{
+		const Function* function = functions[importIndex];
+		if(function && function->mutableData->inlineLLVMIR)
+		{
+			specialization.functionImportInlineLLVMIR.push_back(
+				function->mutableData->inlineLLVMIR);
+			isAnyFunctionSpecialized = true;
+		}
+		else
+		{
+			specialization.functionImportInlineLLVMIR.emplace_back();
+		}
+	}
+	if(!isAnyFunctionSpecialized) { specialization.functionImportInlineLLVMIR.clear(); }
+
+	// Imports of the thunks of pure intrinsics are specialized to call their native functions.
+	bool isAnyFunctionPureNative = false;
+	for(Uptr importIndex = 0; importIndex < module->ir.functions.imports.size(); ++importIndex)
+	{
+		const Function* function = functions[importIndex];
+		const bool isPureNative = function && function->mutableData->pureNativeFunction;
+		specialization.pureNativeFunctionImports.push_back(isPureNative);
+		isAnyFunctionPureNative |= isPureNative;
+	}
+	if(!isAnyFunctionPureNative) { specialization.pureNativeFunctionImports.clear(); }
+
+	// Reference values are pointers to the objects they refer to, so they aren't specialized: the
+	// object code would only be valid in the compartment that contains them.
+	bool isAnyGlobalSpecialized = false;
+	for(Uptr importIndex = 0; importIndex < module->ir.globals.imports.size(); ++importIndex)
+	{
+		const Global* global = globals[importIndex];
+		Value value;
+		if(!global->type.isMutable && !isReferenceType(global->type.valueType))
+		{
+			value = Value(global->type.valueType, global->initialValue);
+			isAnyGlobalSpecialized = true;
+		}
+		specialization.globalImportValues.push_back(value);
+	}
+	if(!isAnyGlobalSpecialized) { specialization.globalImportValues.clear(); }
+
+	// The imported memories' own types may have larger minimum sizes or smaller maximum sizes than
+	// the module's import types. The current sizes aren't used, so that instances importing a
+	// memory that has grown don't each need a new specialization.
+	for(Uptr importIndex = 0; importIndex < module->ir.memories.imports.size(); ++importIndex)
+	{ specialization.memoryImportTypes.push_back(memories[importIndex]->type); }
+
+	return specialization;
+}
+
 Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 											 ModuleConstRefParam module,
 											 std::vector<FunctionImportBinding>&& functionImports,
@@ -163,20 +253,20 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 
 	Uptr id = UINTPTR_MAX;
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 		id = compartment->instances.add(UINTPTR_MAX, nullptr);
 	}
 	if(id == UINTPTR_MAX) { return nullptr; }
 
-	// Deserialize the disassembly names.
-	DisassemblyNames disassemblyNames;
-	getDisassemblyNames(module->ir, disassemblyNames);
+	// Get the module's debug names and InstanceTemplate, which are only computed once for all its
+	// instances.
+	std::shared_ptr<const ModuleDebugNames> debugNames = module->getDebugNames();
+	std::shared_ptr<const InstanceTemplate> instanceTemplate = module->getInstanceTemplate();
 
 	// Instantiate the module's memory and table definitions.
 	for(Uptr tableDefIndex = 0; tableDefIndex < module->ir.tables.defs.size(); ++tableDefIndex)
 	{
-		std::string debugName
-			= disassemblyNames.tables[module->ir.tables.imports.size() + tableDefIndex];
+		std::string debugName = debugNames->tables[module->ir.tables.imports.size() + tableDefIndex];
 		auto table = createTable(compartment,
 								 module->ir.tables.defs[tableDefIndex].type,
 								 nullptr,
@@ -184,7 +274,7 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 								 resourceQuota);
 		if(!table)
 		{
-			Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+			Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 			compartment->instances.removeOrFail(id);
 			throwException(ExceptionTypes::outOfMemory);
 		}
@@ -193,14 +283,14 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 	for(Uptr memoryDefIndex = 0; memoryDefIndex < module->ir.memories.defs.size(); ++memoryDefIndex)
 	{
 		std::string debugName
-			= disassemblyNames.memories[module->ir.memories.imports.size() + memoryDefIndex];
+			= debugNames->memories[module->ir.memories.imports.size() + memoryDefIndex];
 		auto memory = createMemory(compartment,
 								   module->ir.memories.defs[memoryDefIndex].type,
 								   std::move(debugName),
 								   resourceQuota);
 		if(!memory)
 		{
-			Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+			Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 			compartment->instances.removeOrFail(id);
 			throwException(ExceptionTypes::outOfMemory);
 		}
@@ -211,7 +301,7 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 	for(Uptr globalDefIndex = 0; globalDefIndex < module->ir.globals.defs.size(); ++globalDefIndex)
 	{
 		std::string debugName
-			= disassemblyNames.globals[module->ir.globals.imports.size() + globalDefIndex];
+			= debugNames->globals[module->ir.globals.imports.size() + globalDefIndex];
 		const GlobalDef& globalDef = module->ir.globals.defs[globalDefIndex];
 		Global* global
 			= createGlobal(compartment, globalDef.type, std::move(debugName), resourceQuota);
@@ -235,25 +325,13 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 		const ExceptionTypeDef& exceptionTypeDef
 			= module->ir.exceptionTypes.defs[exceptionTypeDefIndex];
 		std::string debugName
-			= disassemblyNames
-				  .exceptionTypes[module->ir.exceptionTypes.imports.size() + exceptionTypeDefIndex];
+			= debugNames
+				  ->exceptionTypes[module->ir.exceptionTypes.imports.size() + exceptionTypeDefIndex];
 		exceptionTypes.push_back(
 			createExceptionType(compartment, exceptionTypeDef.type, std::move(debugName)));
 	}
 
 	// Set up the values to bind to the symbols in the LLVMJIT object code.
-	HashMap<std::string, LLVMJIT::FunctionBinding> wavmIntrinsicsExportMap;
-	for(const HashMapPair<std::string, Intrinsics::Function*>& intrinsicFunctionPair :
-		Intrinsics::getUninstantiatedFunctions({WAVM_INTRINSIC_MODULE_REF(wavmIntrinsics),
-												WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsAtomics),
-												WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsException),
-												WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsMemory),
-												WAVM_INTRINSIC_MODULE_REF(wavmIntrinsicsTable)}))
-	{
-		LLVMJIT::FunctionBinding functionBinding{intrinsicFunctionPair.value->getNativeFunction()};
-		wavmIntrinsicsExportMap.add(intrinsicFunctionPair.key, functionBinding);
-	}
-
 	std::vector<Function*> functions;
 	std::vector<LLVMJIT::FunctionBinding> jitFunctionImports;
 	for(Uptr importIndex = 0; importIndex < module->ir.functions.imports.size(); ++importIndex)
@@ -262,8 +340,10 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 			= module->ir.types[module->ir.functions.imports[importIndex].type.index];
 		if(functionType.callingConvention() == CallingConvention::wasm)
 		{
-			functions.push_back(functionImports[importIndex].wasmFunction);
-			jitFunctionImports.push_back({functionImports[importIndex].wasmFunction->code});
+			Function* wasmFunction = functionImports[importIndex].wasmFunction;
+			functions.push_back(wasmFunction);
+			jitFunctionImports.push_back(
+				{wasmFunction->code, wasmFunction->mutableData->pureNativeFunction});
 		}
 		else
 		{
@@ -300,42 +380,180 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 	for(Uptr functionDefIndex = 0; functionDefIndex < module->ir.functions.defs.size();
 		++functionDefIndex)
 	{
-		std::string debugName
-			= disassemblyNames.functions[module->ir.functions.imports.size() + functionDefIndex]
-				  .name;
-		if(!debugName.size())
-		{ debugName = "<function #" + std::to_string(functionDefIndex) + ">"; }
-		debugName = "wasm!" + moduleDebugName + '!' + debugName;
+		const std::string& functionName
+			= debugNames->functions[module->ir.functions.imports.size() + functionDefIndex];
+		std::string debugName = "wasm!" + moduleDebugName + '!';
+		if(functionName.size()) { debugName += functionName; }
+		else
+		{
+			debugName += "<function #" + std::to_string(functionDefIndex) + ">";
+		}
 
 		functionDefMutableDatas.push_back(new FunctionMutableData(std::move(debugName)));
 	}
 
-	// Load the compiled module's object code with this instance's imports.
-	std::vector<FunctionType> jitTypes = module->ir.types;
-	std::vector<Runtime::Function*> jitFunctionDefs;
-	jitFunctionDefs.resize(module->ir.functions.defs.size(), nullptr);
-	std::shared_ptr<LLVMJIT::Module> jitModule
-		= LLVMJIT::loadModule(module->objectCode,
-							  std::move(wavmIntrinsicsExportMap),
-							  std::move(jitTypes),
-							  std::move(jitFunctionImports),
-							  std::move(jitTables),
-							  std::move(jitMemories),
-							  std::move(jitGlobals),
-							  std::move(jitExceptionTypes),
-							  {id},
-							  reinterpret_cast<Uptr>(getOutOfBoundsElement()),
-							  functionDefMutableDatas,
-							  std::string(moduleDebugName));
-
-	// LLVMJIT::loadModule filled in the functionDefMutableDatas' function pointers with the
-	// compiled functions. Add those functions to the module.
-	for(FunctionMutableData* functionMutableData : functionDefMutableDatas)
-	{ functions.push_back(functionMutableData->function); }
+	// If the module is interpreted, create the interpreter's state for the instance, which creates
+	// the Runtime::Function objects for the function definitions. Otherwise, load and link the
+	// module's object code.
+	std::shared_ptr<LLVMJIT::Module> jitModule;
+	std::shared_ptr<InterpretedModule> interpretedModule;
+	std::shared_ptr<InstanceTierUp> tierUp;
+	if(std::shared_ptr<const InterpreterModuleCode> interpreterCode = module->getInterpreterCode())
+	{
+		interpretedModule = createInterpretedModule(module,
+													std::move(interpreterCode),
+													id,
+													functions,
+													tables,
+													memories,
+													globals,
+													functionDefMutableDatas);
+		for(FunctionMutableData* functionMutableData : functionDefMutableDatas)
+		{ functions.push_back(functionMutableData->function); }
+
+		// If the instance tiers up its hot functions, the compiled code of its hot functions is
+		// loaded with the bindings that the module's object code would be.
+		if(module->tiersUpInstances())
+		{
+			const auto functionDefsBegin = functions.begin() + module->ir.functions.imports.size();
+			const std::vector<Function*> importedFunctions(functions.begin(), functionDefsBegin);
+			const std::vector<Function*> functionDefs(functionDefsBegin, functions.end());
+			tierUp = createInstanceTierUp(module,
+										  id,
+										  moduleDebugName,
+										  jitFunctionImports,
+										  jitTables,
+										  jitMemories,
+										  jitGlobals,
+										  jitExceptionTypes,
+										  importedFunctions,
+										  functionDefs);
+		}
+	}
+	else
+	{
+		// Compiled code calls imports directly, so bind the trampolines of interpreted imports.
+		for(Uptr importIndex = 0; importIndex < module->ir.functions.imports.size(); ++importIndex)
+		{
+			if(functions[importIndex]) { bindInterpreterTrampoline(functions[importIndex]); }
+		}
+
+		// Create a FunctionMutableData for each of the invoke thunks that LLVMJIT::compileModule
+		// generated for the types of the module's exported function definitions.
+		std::vector<FunctionMutableData*> invokeThunkMutableDatas(module->ir.types.size(), nullptr);
+		for(Uptr typeIndex = 0; typeIndex < module->ir.types.size(); ++typeIndex)
+		{
+			const std::string& invokeThunkDebugName
+				= instanceTemplate->invokeThunkDebugNames[typeIndex];
+			if(invokeThunkDebugName.size())
+			{
+				invokeThunkMutableDatas[typeIndex]
+					= new FunctionMutableData(std::string(invokeThunkDebugName));
+			}
+		}
+
+		// Load the compiled module's object code with this instance's imports.
+		std::vector<FunctionType> jitTypes = module->ir.types;
+		std::vector<Runtime::Function*> jitFunctionDefs;
+		jitFunctionDefs.resize(module->ir.functions.defs.size(), nullptr);
+		LLVMJIT::ModuleSpecialization specialization;
+		if(module->specializesInstances())
+		{ specialization = getSpecialization(module, functions, memories, globals); }
+		const bool isSpecialized
+			= specialization.functionImportInlineLLVMIR.size()
+			  || specialization.pureNativeFunctionImports.size()
+			  || specialization.globalImportValues.size() || specialization.memoryImportTypes.size();
+		std::shared_ptr<const std::vector<U8>> objectCode
+			= isSpecialized ? module->getSpecializedObjectCode(specialization)
+							: module->getObjectCode();
+
+		// If the object code tiers up, keep the bindings it is loaded with to load the code of its
+		// hot functions with. Specialized object code is compiled with the optimized tier.
+		const bool tiersUp = !isSpecialized && module->tiersUpInstances();
+		std::vector<LLVMJIT::FunctionBinding> tierUpFunctionImports;
+		std::vector<LLVMJIT::TableBinding> tierUpTables;
+		std::vector<LLVMJIT::MemoryBinding> tierUpMemories;
+		std::vector<LLVMJIT::GlobalBinding> tierUpGlobals;
+		std::vector<LLVMJIT::ExceptionTypeBinding> tierUpExceptionTypes;
+		if(tiersUp)
+		{
+			tierUpFunctionImports = jitFunctionImports;
+			tierUpTables = jitTables;
+			tierUpMemories = jitMemories;
+			tierUpGlobals = jitGlobals;
+			tierUpExceptionTypes = jitExceptionTypes;
+		}
+		jitModule = LLVMJIT::loadModule(objectCode->data(),
+										objectCode->size(),
+										getWAVMIntrinsicsExportMap(),
+										std::move(jitTypes),
+										std::move(jitFunctionImports),
+										std::move(jitTables),
+										std::move(jitMemories),
+										std::move(jitGlobals),
+										std::move(jitExceptionTypes),
+										{id},
+										reinterpret_cast<Uptr>(getOutOfBoundsElement()),
+										functionDefMutableDatas,
+										invokeThunkMutableDatas,
+										std::string(moduleDebugName));
+
+		// LLVMJIT::loadModule filled in the functionDefMutableDatas' function pointers with the
+		// compiled functions. Add those functions to the module.
+		for(FunctionMutableData* functionMutableData : functionDefMutableDatas)
+		{ functions.push_back(functionMutableData->function); }
+
+		if(tiersUp)
+		{
+			const auto functionDefsBegin = functions.begin() + module->ir.functions.imports.size();
+			const std::vector<Function*> importedFunctions(functions.begin(), functionDefsBegin);
+			const std::vector<Function*> functionDefs(functionDefsBegin, functions.end());
+			tierUp = createInstanceTierUp(module,
+										  id,
+										  moduleDebugName,
+										  tierUpFunctionImports,
+										  tierUpTables,
+										  tierUpMemories,
+										  tierUpGlobals,
+										  tierUpExceptionTypes,
+										  importedFunctions,
+										  functionDefs);
+		}
+
+		// Initialize the invoke thunk cached by each exported function definition to the thunk in
+		// the module's object code, so invoking it doesn't need to compile a thunk. If the object
+		// code doesn't include the thunk, free its FunctionMutableData.
+		for(Uptr typeIndex = 0; typeIndex < invokeThunkMutableDatas.size(); ++typeIndex)
+		{
+			if(invokeThunkMutableDatas[typeIndex] && !invokeThunkMutableDatas[typeIndex]->function)
+			{
+				delete invokeThunkMutableDatas[typeIndex];
+				invokeThunkMutableDatas[typeIndex] = nullptr;
+			}
+		}
+		for(const Export& exportIt : module->ir.exports)
+		{
+			if(exportIt.kind == IR::ExternKind::function
+			   && exportIt.index >= module->ir.functions.imports.size())
+			{
+				const Uptr typeIndex = module->ir.functions.getType(exportIt.index).index;
+				if(invokeThunkMutableDatas[typeIndex])
+				{
+					const Function* invokeThunkFunction
+						= invokeThunkMutableDatas[typeIndex]->function;
+					functions[exportIt.index]->mutableData->invokeThunk.store(
+						reinterpret_cast<InvokeThunkPointer>(
+							const_cast<U8*>(invokeThunkFunction->code)),
+						std::memory_order_relaxed);
+				}
+			}
+		}
+	}
 
 	// Set up the instance's exports.
-	HashMap<std::string, Object*> exportMap;
+	HashMap<std::string, Object*> exportMap(module->ir.exports.size());
 	std::vector<Object*> exports;
+	exports.reserve(module->ir.exports.size());
 	for(const Export& exportIt : module->ir.exports)
 	{
 		Object* exportedObject = nullptr;
@@ -359,16 +577,9 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 		exports.push_back(exportedObject);
 	}
 
-	// Copy the module's data and elem segments into the Instance for later use.
-	DataSegmentVector dataSegments;
-	ElemSegmentVector elemSegments;
-	for(const DataSegment& dataSegment : module->ir.dataSegments)
-	{ dataSegments.push_back(dataSegment.isActive ? nullptr : dataSegment.data); }
-	for(const ElemSegment& elemSegment : module->ir.elemSegments)
-	{
-		elemSegments.push_back(elemSegment.type == ElemSegment::Type::passive ? elemSegment.contents
-																			  : nullptr);
-	}
+	// Copy the module's passive data and elem segments into the Instance for later use.
+	DataSegmentVector dataSegments = instanceTemplate->dataSegments;
+	ElemSegmentVector elemSegments = instanceTemplate->elemSegments;
 
 	// Look up the module's start function.
 	Function* startFunction = nullptr;
@@ -392,11 +603,14 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 									  std::move(dataSegments),
 									  std::move(elemSegments),
 									  std::move(jitModule),
+									  std::move(interpretedModule),
+									  std::move(tierUp),
 									  std::move(moduleDebugName),
 									  resourceQuota);
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 		compartment->instances[id] = instance;
+		addYoungObject(instance);
 	}
 
 	// Initialize the globals with (ref.func ...) initializers that were deferred until after the
@@ -411,7 +625,13 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 		}
 	}
 
-	// Copy the module's data segments into their designated memory instances.
+	// Copy the module's data segments into their designated memory instances. The memories
+	// defined by the instance are zero until a segment is copied into them, so segments that start
+	// after the end of any earlier segment copied into the same memory only copy their non-zero
+	// extents.
+	std::vector<Uptr> memoryZeroedStartAddresses(instance->memories.size(), UINTPTR_MAX);
+	for(Uptr memoryDefIndex = 0; memoryDefIndex < module->ir.memories.defs.size(); ++memoryDefIndex)
+	{ memoryZeroedStartAddresses[module->ir.memories.imports.size() + memoryDefIndex] = 0; }
 	for(Uptr segmentIndex = 0; segmentIndex < module->ir.dataSegments.size(); ++segmentIndex)
 	{
 		const DataSegment& dataSegment = module->ir.dataSegments[segmentIndex];
@@ -424,13 +644,30 @@ Instance* Runtime::instantiateModuleInternal(Compartment* compartment,
 			const MemoryType& memoryType = module->ir.memories.getType(dataSegment.memoryIndex);
 			Uptr baseOffset = getIndexValue(baseOffsetValue, memoryType.indexType);
 
-			initDataSegment(instance,
-							segmentIndex,
-							dataSegment.data.get(),
-							instance->memories[dataSegment.memoryIndex],
-							baseOffset,
-							0,
-							dataSegment.data->size());
+			Uptr& zeroedStartAddress = memoryZeroedStartAddresses[dataSegment.memoryIndex];
+			if(baseOffset >= zeroedStartAddress)
+			{
+				initZeroedDataSegment(instance->memories[dataSegment.memoryIndex],
+									  baseOffset,
+									  dataSegment.data.get(),
+									  instanceTemplate->dataSegmentExtents[segmentIndex]);
+				zeroedStartAddress = baseOffset + dataSegment.data->size();
+			}
+			else
+			{
+				initDataSegment(instance,
+								segmentIndex,
+								dataSegment.data.get(),
+								instance->memories[dataSegment.memoryIndex],
+								baseOffset,
+								0,
+								dataSegment.data->size());
+				if(zeroedStartAddress != UINTPTR_MAX)
+				{
+					zeroedStartAddress
+						= std::max(zeroedStartAddress, baseOffset + dataSegment.data->size());
+				}
+			}
 		}
 	}
 
@@ -517,6 +754,8 @@ Instance* Runtime::cloneInstance(Instance* instance, Compartment* newCompartment
 
 	// Create the new Instance in the cloned compartment, but with the same ID as the old one.
 	std::shared_ptr<LLVMJIT::Module> jitModuleCopy = instance->jitModule;
+	std::shared_ptr<InterpretedModule> interpretedModuleCopy = instance->interpretedModule;
+	std::shared_ptr<InstanceTierUp> tierUpCopy = instance->tierUp;
 	Instance* newInstance = new Instance(newCompartment,
 										 instance->id,
 										 std::move(newExportMap),
@@ -530,16 +769,89 @@ Instance* Runtime::cloneInstance(Instance* instance, Compartment* newCompartment
 										 std::move(newDataSegments),
 										 std::move(newElemSegments),
 										 std::move(jitModuleCopy),
+										 std::move(interpretedModuleCopy),
+										 std::move(tierUpCopy),
 										 std::string(instance->debugName),
 										 instance->resourceQuota);
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 		newCompartment->instances.insertOrFail(instance->id, newInstance);
 	}
 
 	return newInstance;
 }
 
+bool Runtime::captureInstanceResetState(Instance* instance, const Context* context)
+{
+	WAVM_ASSERT(context->compartment == instance->compartment);
+	Trace::Scope traceScope("runtime", "captureInstanceResetState");
+	instance->hasResetState = false;
+
+	for(Memory* memory : instance->memories)
+	{
+		if(!captureMemoryResetState(memory)) { return false; }
+	}
+	for(Table* table : instance->tables) { captureTableResetState(table); }
+
+	// The garbage collector reads the captured values of reference globals with the compartment
+	// locked.
+	{
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(instance->compartment->mutex);
+		for(Global* global : instance->globals)
+		{
+			if(global->type.isMutable)
+			{
+				global->resetValue
+					= context->runtimeData->mutableGlobals[global->mutableGlobalIndex];
+				global->hasResetValue = true;
+			}
+		}
+	}
+
+	{
+		Platform::RWMutex::ShareableLock dataSegmentsLock(instance->dataSegmentsMutex);
+		instance->resetDataSegments = instance->dataSegments;
+	}
+	{
+		Platform::RWMutex::ShareableLock elemSegmentsLock(instance->elemSegmentsMutex);
+		instance->resetElemSegments = instance->elemSegments;
+	}
+
+	instance->hasResetState = true;
+	return true;
+}
+
+void Runtime::resetInstance(Instance* instance, Context* context)
+{
+	WAVM_ERROR_UNLESS(instance->hasResetState);
+	WAVM_ASSERT(context->compartment == instance->compartment);
+	Trace::Scope traceScope("runtime", "resetInstance");
+
+	for(Memory* memory : instance->memories) { resetMemory(memory); }
+	for(Table* table : instance->tables) { resetTable(table); }
+
+	{
+		Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(instance->compartment->mutex);
+		for(Global* global : instance->globals)
+		{
+			if(global->hasResetValue)
+			{
+				context->runtimeData->mutableGlobals[global->mutableGlobalIndex]
+					= global->resetValue;
+			}
+		}
+	}
+
+	{
+		Platform::RWMutex::ExclusiveLock dataSegmentsLock(instance->dataSegmentsMutex);
+		instance->dataSegments = instance->resetDataSegments;
+	}
+	{
+		Platform::RWMutex::ExclusiveLock elemSegmentsLock(instance->elemSegmentsMutex);
+		instance->elemSegments = instance->resetElemSegments;
+	}
+}
+
 Function* Runtime::getStartFunction(const Instance* instance) { return instance->startFunction; }
 
 Memory* Runtime::getDefaultMemory(const Instance* instance)
@@ -631,3 +943,171 @@ const std::vector<Object*>& Runtime::getInstanceExports(const Instance* instance
 {
 	return instance->exports;
 }
+
+// Returns the type that a module declares for one of its exports.
+static ExternType getExportType(const IR::Module& irModule, const Export& export_)
+{
+	switch(export_.kind)
+	{
+	case ExternKind::function:
+		return irModule.types[irModule.functions.getType(export_.index).index];
+	case ExternKind::table: return irModule.tables.getType(export_.index);
+	case ExternKind::memory: return irModule.memories.getType(export_.index);
+	case ExternKind::global: return irModule.globals.getType(export_.index);
+	case ExternKind::exceptionType: return irModule.exceptionTypes.getType(export_.index);
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+// Returns whether an object of an export's type matches a type, with the same rules as isA.
+static bool isExportTypeA(const ExternType& exportType, const ExternType& type)
+{
+	if(exportType.kind != type.kind) { return false; }
+
+	switch(type.kind)
+	{
+	case ExternKind::function: return asFunctionType(exportType) == asFunctionType(type);
+	case ExternKind::global: return isSubtype(asGlobalType(exportType), asGlobalType(type));
+	case ExternKind::table: return isSubtype(asTableType(exportType), asTableType(type));
+	case ExternKind::memory: return isSubtype(asMemoryType(exportType), asMemoryType(type));
+	case ExternKind::exceptionType:
+		return isSubtype(asExceptionType(type).params, asExceptionType(exportType).params);
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	}
+}
+
+ExportIndex<Object> Runtime::getModuleExportIndex(ModuleConstRefParam module,
+												  const std::string& name)
+{
+	ExportIndex<Object> exportIndex;
+	const std::vector<Export>& exports = module->ir.exports;
+	for(Uptr index = 0; index < exports.size(); ++index)
+	{
+		if(exports[index].name == name)
+		{
+			exportIndex.index = index;
+			break;
+		}
+	}
+	return exportIndex;
+}
+
+ExportIndex<Object> Runtime::getTypedModuleExportIndex(ModuleConstRefParam module,
+													   const std::string& name,
+													   const IR::ExternType& type)
+{
+	ExportIndex<Object> exportIndex = getModuleExportIndex(module, name);
+	if(exportIndex.isValid()
+	   && !isExportTypeA(getExportType(module->ir, module->ir.exports[exportIndex.index]), type))
+	{ exportIndex.index = UINTPTR_MAX; }
+	return exportIndex;
+}
+
+ExportIndex<Function> Runtime::getTypedModuleExportIndex(ModuleConstRefParam module,
+														 const std::string& name,
+														 const IR::FunctionType& type)
+{
+	return {getTypedModuleExportIndex(module, name, ExternType(type)).index};
+}
+
+ExportIndex<Table> Runtime::getTypedModuleExportIndex(ModuleConstRefParam module,
+													  const std::string& name,
+													  const IR::TableType& type)
+{
+	return {getTypedModuleExportIndex(module, name, ExternType(type)).index};
+}
+
+ExportIndex<Memory> Runtime::getTypedModuleExportIndex(ModuleConstRefParam module,
+													   const std::string& name,
+													   const IR::MemoryType& type)
+{
+	return {getTypedModuleExportIndex(module, name, ExternType(type)).index};
+}
+
+ExportIndex<Global> Runtime::getTypedModuleExportIndex(ModuleConstRefParam module,
+													   const std::string& name,
+													   const IR::GlobalType& type)
+{
+	return {getTypedModuleExportIndex(module, name, ExternType(type)).index};
+}
+
+ExportIndex<Runtime::ExceptionType> Runtime::getTypedModuleExportIndex(
+	ModuleConstRefParam module,
+	const std::string& name,
+	const IR::ExceptionType& type)
+{
+	return {getTypedModuleExportIndex(module, name, ExternType(type)).index};
+}
+
+Object* Runtime::getInstanceExport(const Instance* instance, ExportIndex<Object> exportIndex)
+{
+	WAVM_ASSERT(instance);
+	if(!exportIndex.isValid()) { return nullptr; }
+	WAVM_ASSERT(exportIndex.index < instance->exports.size());
+	return instance->exports[exportIndex.index];
+}
+
+Function* Runtime::getInstanceExport(const Instance* instance, ExportIndex<Function> exportIndex)
+{
+	return asFunction(getInstanceExport(instance, ExportIndex<Object>{exportIndex.index}));
+}
+
+Table* Runtime::getInstanceExport(const Instance* instance, ExportIndex<Table> exportIndex)
+{
+	return asTable(getInstanceExport(instance, ExportIndex<Object>{exportIndex.index}));
+}
+
+Memory* Runtime::getInstanceExport(const Instance* instance, ExportIndex<Memory> exportIndex)
+{
+	return asMemory(getInstanceExport(instance, ExportIndex<Object>{exportIndex.index}));
+}
+
+Global* Runtime::getInstanceExport(const Instance* instance, ExportIndex<Global> exportIndex)
+{
+	return asGlobal(getInstanceExport(instance, ExportIndex<Object>{exportIndex.index}));
+}
+
+Runtime::ExceptionType* Runtime::getInstanceExport(const Instance* instance,
+												   ExportIndex<Runtime::ExceptionType> exportIndex)
+{
+	return asExceptionType(getInstanceExport(instance, ExportIndex<Object>{exportIndex.index}));
+}
+
+void Runtime::getInstanceProfile(const Instance* instance, LLVMJIT::ModuleProfile& outProfile)
+{
+	// The instance's function definitions are the functions that were loaded by its JIT module,
+	// and follow its function imports.
+	outProfile.functionDefCounts.clear();
+	if(!instance->jitModule) { return; }
+	for(Function* function : instance->functions)
+	{
+		if(!function || function->mutableData->jitModule != instance->jitModule.get())
+		{ continue; }
+
+		const FunctionMutableData* mutableData = function->mutableData;
+		outProfile.functionDefCounts.emplace_back(
+			mutableData->profileCounters,
+			mutableData->profileCounters + mutableData->numProfileCounters);
+	}
+}
+
+void Runtime::getFunctionStats(const Instance* instance, std::vector<FunctionStats>& outStats)
+{
+	outStats.clear();
+	for(Function* function : instance->functions)
+	{
+		if(!function || function->mutableData->jitModule != instance->jitModule.get()
+		   || !function->mutableData->functionStats)
+		{ continue; }
+
+		// The counts are incremented without any ordering, so just read them atomically.
+		const U64* stats = function->mutableData->functionStats;
+		outStats.push_back({function,
+							__atomic_load_n(&stats[0], __ATOMIC_RELAXED),
+							__atomic_load_n(&stats[1], __ATOMIC_RELAXED)});
+	}
+}
@@ -0,0 +1,1390 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/OperatorSignatures.h"
+#include "WAVM/IR/Operators.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/FloatComponents.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// The interpreter executes the code of a function definition in place, without translating it to
+// another form first. The operators don't encode where a branch goes, or how many operands it
+// discards from the stack, so each function has a side table with an entry for each branch in the
+// order they occur in the code, including the implicit branches of if and else. The interpreter
+// keeps the index of the next side table entry as it executes the code, so a branch doesn't need
+// to search for its entry, and each entry holds the side table index at its target.
+namespace {
+	struct SideTableEntry
+	{
+		U32 targetCodeOffset;
+		U32 targetSideTableIndex;
+		U32 numKeptValues;
+		U32 numDiscardedValues;
+	};
+
+	struct InterpretedFunctionCode
+	{
+		std::vector<SideTableEntry> sideTable;
+
+		// The number of locals, including the parameters, and the maximum number of operands on
+		// the stack, which together give the size of the function's frame.
+		Uptr numLocals = 0;
+		Uptr maxStackDepth = 0;
+	};
+
+	struct InterpretedGlobal
+	{
+		bool isMutable;
+		Uptr mutableGlobalIndex;
+		const UntaggedValue* immutableValue;
+	};
+}
+
+struct Runtime::InterpreterModuleCode
+{
+	std::vector<InterpretedFunctionCode> functionDefs;
+};
+
+struct Runtime::InterpretedModule
+{
+	ModuleConstRef module;
+	std::shared_ptr<const InterpreterModuleCode> code;
+
+	// The module's functions, table IDs, memory IDs, and globals, indexed like the module's index
+	// spaces. The elements for imports are bound to the instance's imports.
+	std::vector<Function*> functions;
+	std::vector<Uptr> tableIds;
+	std::vector<Uptr> memoryIds;
+	std::vector<InterpretedGlobal> globals;
+
+	// The executable pages that hold the Runtime::Function objects of the function definitions,
+	// and the code that compiled code calls them through.
+	U8* functionDefPages = nullptr;
+	Uptr numFunctionDefPages = 0;
+
+	~InterpretedModule()
+	{
+		for(Uptr functionIndex = module->ir.functions.imports.size();
+			functionIndex < functions.size();
+			++functionIndex)
+		{ delete functions[functionIndex]->mutableData; }
+		if(functionDefPages) { Platform::freeVirtualPages(functionDefPages, numFunctionDefPages); }
+	}
+};
+
+// Whether the interpreter supports the operators of each feature. The exceptions are listed by
+// isUninterpretedOp.
+namespace InterpretedFeatures {
+	static constexpr bool mvp = true;
+	static constexpr bool signExtension = true;
+	static constexpr bool nonTrappingFloatToInt = true;
+	static constexpr bool referenceTypes = true;
+	static constexpr bool bulkMemoryOperations = true;
+	static constexpr bool simd = false;
+	static constexpr bool atomics = false;
+	static constexpr bool exceptionHandling = false;
+	static constexpr bool interleavedLoadStore = false;
+	static constexpr bool memoryControl = false;
+	static constexpr bool tailCalls = false;
+	static constexpr bool relaxedSIMD = false;
+}
+
+// The operators of interpreted features that the interpreter doesn't support: the segment
+// operators need the instance's segments, which interpreted code doesn't have access to.
+static bool isUninterpretedOp(Opcode opcode)
+{
+	return opcode == Opcode::memory_init || opcode == Opcode::data_drop
+		   || opcode == Opcode::table_init || opcode == Opcode::elem_drop
+		   || opcode == Opcode::table_copy || opcode == Opcode::table_fill;
+}
+
+//
+// Building the side tables
+//
+
+namespace {
+	struct ControlContext
+	{
+		enum class Type : U8
+		{
+			function,
+			block,
+			loop,
+			ifThen,
+			ifElse,
+		};
+
+		Type type;
+		bool isReachable;
+
+		// The stack depth when the control structure was entered, not counting its parameters.
+		Uptr outerStackDepth;
+		Uptr numParams;
+		Uptr numResults;
+
+		// The target of branches to a loop.
+		U32 loopCodeOffset;
+		U32 loopSideTableIndex;
+
+		// The side table entry of the branch from an if to its else or end.
+		Uptr ifSideTableIndex;
+
+		// The side table entries of the branches to the control structure's end.
+		std::vector<Uptr> endBranchSideTableIndices;
+	};
+
+	// Tracks the stack depth and control structures of a function's code to build its side table.
+	// It also determines whether the interpreter supports all the function's operators.
+	struct SideTableBuilder
+	{
+		typedef void Result;
+
+		bool isSupported = true;
+
+		// The offsets in the function's code of the operator being visited, and the operator
+		// that follows it.
+		U32 opCodeOffset = 0;
+		U32 nextCodeOffset = 0;
+
+		SideTableBuilder(const IR::Module& inModule,
+						 const FunctionDef& inFunctionDef,
+						 InterpretedFunctionCode& inFunctionCode)
+		: module(inModule), functionDef(inFunctionDef), functionCode(inFunctionCode)
+		{
+			const FunctionType functionType = module.types[functionDef.type.index];
+			functionCode.numLocals
+				= functionType.params().size() + functionDef.nonParameterLocalTypes.size();
+			pushControl(ControlContext::Type::function, 0, functionType.results().size());
+		}
+
+		void block(ControlStructureImm imm)
+		{
+			const FunctionType type = resolveBlockType(module, imm.type);
+			popValues(type.params().size());
+			pushControl(ControlContext::Type::block, type.params().size(), type.results().size());
+		}
+		void loop(ControlStructureImm imm)
+		{
+			const FunctionType type = resolveBlockType(module, imm.type);
+			popValues(type.params().size());
+			pushControl(ControlContext::Type::loop, type.params().size(), type.results().size());
+			controlStack.back().loopCodeOffset = nextCodeOffset;
+			controlStack.back().loopSideTableIndex = U32(functionCode.sideTable.size());
+		}
+		void if_(ControlStructureImm imm)
+		{
+			const FunctionType type = resolveBlockType(module, imm.type);
+			popValues(type.params().size() + 1);
+			pushControl(ControlContext::Type::ifThen, type.params().size(), type.results().size());
+
+			// If the condition is false, the if branches to its else or end with its parameters.
+			ControlContext& context = controlStack.back();
+			context.ifSideTableIndex = functionCode.sideTable.size();
+			functionCode.sideTable.push_back({0, 0, U32(context.numParams), 0});
+		}
+		void else_(NoImm)
+		{
+			// The end of the then branch branches to the end of the if.
+			emitBranch(0);
+
+			ControlContext& context = controlStack.back();
+			WAVM_ASSERT(context.type == ControlContext::Type::ifThen);
+			SideTableEntry& ifEntry = functionCode.sideTable[context.ifSideTableIndex];
+			ifEntry.targetCodeOffset = nextCodeOffset;
+			ifEntry.targetSideTableIndex = U32(functionCode.sideTable.size());
+
+			context.type = ControlContext::Type::ifElse;
+			context.isReachable = true;
+			stackDepth = context.outerStackDepth + context.numParams;
+		}
+		void end(NoImm)
+		{
+			ControlContext& context = controlStack.back();
+			if(context.type == ControlContext::Type::ifThen)
+			{ context.endBranchSideTableIndices.push_back(context.ifSideTableIndex); }
+
+			// Branches to the function's end go to its final end operator, which returns from the
+			// function. Branches to the end of other control structures skip their end operator.
+			const U32 targetCodeOffset
+				= context.type == ControlContext::Type::function ? opCodeOffset : nextCodeOffset;
+			for(Uptr sideTableIndex : context.endBranchSideTableIndices)
+			{
+				functionCode.sideTable[sideTableIndex].targetCodeOffset = targetCodeOffset;
+				functionCode.sideTable[sideTableIndex].targetSideTableIndex
+					= U32(functionCode.sideTable.size());
+			}
+
+			stackDepth = context.outerStackDepth + context.numResults;
+			controlStack.pop_back();
+		}
+
+		void unreachable(NoImm) { enterUnreachable(); }
+		void br(BranchImm imm)
+		{
+			emitBranch(imm.targetDepth);
+			enterUnreachable();
+		}
+		void br_if(BranchImm imm)
+		{
+			popValues(1);
+			emitBranch(imm.targetDepth);
+		}
+		void br_table(BranchTableImm imm)
+		{
+			popValues(1);
+			for(Uptr index = 0; index < imm.numTargetDepths; ++index)
+			{ emitBranch(functionDef.branchTableTargetDepths[imm.firstTargetDepthIndex + index]); }
+			emitBranch(imm.defaultTargetDepth);
+			enterUnreachable();
+		}
+		void return_(NoImm) { enterUnreachable(); }
+
+		void call(FunctionImm imm)
+		{
+			const FunctionType type
+				= module.types[module.functions.getType(imm.functionIndex).index];
+			popValues(type.params().size());
+			pushValues(type.results().size());
+		}
+		void call_indirect(CallIndirectImm imm)
+		{
+			const FunctionType type = module.types[imm.type.index];
+			popValues(type.params().size() + 1);
+			pushValues(type.results().size());
+		}
+
+		// Tail calls must not grow the stack, which the interpreter's calls would, so functions
+		// that make them are compiled instead.
+		void return_call(FunctionImm) { isSupported = false; }
+		void return_call_indirect(CallIndirectImm) { isSupported = false; }
+
+		void drop(NoImm) { popValues(1); }
+		void select(SelectImm)
+		{
+			popValues(3);
+			pushValues(1);
+		}
+
+		void local_get(GetOrSetVariableImm<false>) { pushValues(1); }
+		void local_set(GetOrSetVariableImm<false>) { popValues(1); }
+		void local_tee(GetOrSetVariableImm<false>) {}
+		void global_get(GetOrSetVariableImm<true>) { pushValues(1); }
+		void global_set(GetOrSetVariableImm<true>) { popValues(1); }
+
+		void table_get(TableImm) {}
+		void table_set(TableImm) { popValues(2); }
+		void table_grow(TableImm) { popValues(1); }
+		void table_fill(TableImm) { isSupported = false; }
+
+		void ref_null(ReferenceTypeImm) { pushValues(1); }
+		void ref_is_null(NoImm) {}
+
+		void throw_(ExceptionTypeImm) { isSupported = false; }
+		void rethrow(RethrowImm) { isSupported = false; }
+		void try_(ControlStructureImm) { isSupported = false; }
+		void catch_(ExceptionTypeImm) { isSupported = false; }
+		void catch_all(NoImm) { isSupported = false; }
+
+#define VISIT_NONPARAMETRIC_OP(_1, name, nameString, Imm, Signature, requiredFeature)              \
+	void name(Imm)                                                                                 \
+	{                                                                                              \
+		if(!InterpretedFeatures::requiredFeature || isUninterpretedOp(Opcode::name))               \
+		{ isSupported = false; }                                                                   \
+		applySignature(IR::OpSignatures::Signature);                                               \
+	}
+		WAVM_ENUM_NONCONTROL_NONPARAMETRIC_OPERATORS(VISIT_NONPARAMETRIC_OP)
+#undef VISIT_NONPARAMETRIC_OP
+
+#define VISIT_INDEX_POLYMORPHIC_OP(_1, name, nameString, Imm, Signature, requiredFeature)          \
+	void name(Imm imm)                                                                             \
+	{                                                                                              \
+		if(!InterpretedFeatures::requiredFeature || isUninterpretedOp(Opcode::name))               \
+		{ isSupported = false; }                                                                   \
+		applySignature(IR::OpSignatures::Signature(module, imm));                                  \
+	}
+		WAVM_ENUM_INDEX_POLYMORPHIC_OPERATORS(VISIT_INDEX_POLYMORPHIC_OP)
+#undef VISIT_INDEX_POLYMORPHIC_OP
+
+	private:
+		const IR::Module& module;
+		const FunctionDef& functionDef;
+		InterpretedFunctionCode& functionCode;
+
+		std::vector<ControlContext> controlStack;
+		Uptr stackDepth = 0;
+
+		// Pushes a control structure whose parameters have already been popped.
+		void pushControl(ControlContext::Type type, Uptr numParams, Uptr numResults)
+		{
+			controlStack.emplace_back();
+			ControlContext& context = controlStack.back();
+			context.type = type;
+			context.isReachable = true;
+			context.outerStackDepth = stackDepth;
+			context.numParams = numParams;
+			context.numResults = numResults;
+			context.loopCodeOffset = 0;
+			context.loopSideTableIndex = 0;
+			context.ifSideTableIndex = 0;
+			pushValues(numParams);
+		}
+
+		void pushValues(Uptr numValues)
+		{
+			stackDepth += numValues;
+			if(stackDepth > functionCode.maxStackDepth) { functionCode.maxStackDepth = stackDepth; }
+		}
+
+		// Unreachable code may pop operands that were never pushed, but doesn't pop the operands
+		// of the enclosing control structures.
+		void popValues(Uptr numValues)
+		{
+			const ControlContext& context = controlStack.back();
+			if(stackDepth < context.outerStackDepth + numValues)
+			{
+				WAVM_ASSERT(!context.isReachable);
+				stackDepth = context.outerStackDepth;
+			}
+			else
+			{
+				stackDepth -= numValues;
+			}
+		}
+
+		void applySignature(const OpSignature& signature)
+		{
+			popValues(signature.params.size());
+			pushValues(signature.results.size());
+		}
+
+		void enterUnreachable()
+		{
+			stackDepth = controlStack.back().outerStackDepth;
+			controlStack.back().isReachable = false;
+		}
+
+		// Adds a side table entry for a branch to the control structure at the given depth.
+		void emitBranch(Uptr depth)
+		{
+			ControlContext& target = controlStack[controlStack.size() - depth - 1];
+			const bool isLoop = target.type == ControlContext::Type::loop;
+
+			SideTableEntry entry;
+			entry.numKeptValues = U32(isLoop ? target.numParams : target.numResults);
+			entry.numDiscardedValues
+				= stackDepth >= target.outerStackDepth + entry.numKeptValues
+					  ? U32(stackDepth - target.outerStackDepth - entry.numKeptValues)
+					  : 0;
+			if(isLoop)
+			{
+				entry.targetCodeOffset = target.loopCodeOffset;
+				entry.targetSideTableIndex = target.loopSideTableIndex;
+			}
+			else
+			{
+				entry.targetCodeOffset = 0;
+				entry.targetSideTableIndex = 0;
+				target.endBranchSideTableIndices.push_back(functionCode.sideTable.size());
+			}
+			functionCode.sideTable.push_back(entry);
+		}
+	};
+}
+
+static bool buildSideTable(const IR::Module& module,
+						   const FunctionDef& functionDef,
+						   InterpretedFunctionCode& outFunctionCode)
+{
+	SideTableBuilder builder(module, functionDef, outFunctionCode);
+
+	const U8* codeBegin = functionDef.code.data();
+	const U8* nextByte = codeBegin;
+	const U8* codeEnd = codeBegin + functionDef.code.size();
+	while(nextByte < codeEnd && builder.isSupported)
+	{
+		Opcode opcode;
+		memcpy(&opcode, nextByte, sizeof(Opcode));
+		builder.opCodeOffset = U32(nextByte - codeBegin);
+		switch(opcode)
+		{
+#define VISIT_OPCODE(_1, name, nameString, Imm, ...)                                               \
+	case Opcode::name: {                                                                           \
+		Imm imm;                                                                                   \
+		ImmEncoding<Imm>::decode(nextByte + sizeof(Opcode), imm);                                  \
+		nextByte += sizeof(Opcode) + ImmEncoding<Imm>::numBytes;                                   \
+		builder.nextCodeOffset = U32(nextByte - codeBegin);                                        \
+		builder.name(imm);                                                                         \
+		break;                                                                                     \
+	}
+			WAVM_ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+		default: WAVM_UNREACHABLE();
+		};
+	}
+	return builder.isSupported;
+}
+
+//
+// Calling interpreted functions from compiled code
+//
+
+// Compiled code calls a function by jumping to its Runtime::Function's code, which is followed by
+// the function's machine code. The code of an interpreted function loads the function's address
+// into the register that LLVM passes nest parameters in, and jumps to the compiled trampoline for
+// its type through FunctionMutableData::interpreterTrampoline (see
+// LLVMJIT::getInterpreterTrampoline). The trampoline is bound when the function is first passed
+// to compiled code, so modules that are only called by the host and other interpreted modules
+// don't compile any trampolines. If the function's instance tiers it up, the trampoline is
+// replaced with the function's optimized code, which takes the same arguments. The code is
+// written for each function when an instance is created, so the interpreter is only used on the
+// hosts it can write the code for.
+#if defined(__x86_64__) || defined(_M_X64)
+static constexpr bool canWriteInterpretedFunctionCode = true;
+#elif defined(__aarch64__) && defined(__linux__)
+static constexpr bool canWriteInterpretedFunctionCode = true;
+#else
+static constexpr bool canWriteInterpretedFunctionCode = false;
+#endif
+
+// The number of bytes for each function definition's Runtime::Function and code.
+static constexpr Uptr numBytesPerInterpretedFunction = 64;
+
+static void writeInterpretedFunctionCode(Function* function)
+{
+	U8* code = const_cast<U8*>(function->code);
+	const U64 functionAddress = reinterpret_cast<Uptr>(function);
+	const U64 trampolineAddress
+		= reinterpret_cast<Uptr>(&function->mutableData->interpreterTrampoline);
+#if defined(__x86_64__) || defined(_M_X64)
+	// mov r10, functionAddress
+	// mov r11, trampolineAddress
+	// jmp [r11]
+	static const U8 instructions[23] = {0x49, 0xba, 0, 0, 0, 0, 0, 0, 0, 0, 0x49, 0xbb,
+										0,    0,    0, 0, 0, 0, 0, 0, 0x41, 0xff, 0x23};
+	memcpy(code, instructions, sizeof(instructions));
+	memcpy(code + 2, &functionAddress, sizeof(U64));
+	memcpy(code + 12, &trampolineAddress, sizeof(U64));
+#elif defined(__aarch64__) && defined(__linux__)
+	// ldr x18, functionAddress
+	// ldr x16, trampolineAddress
+	// ldr x16, [x16]
+	// br x16
+	static const U32 instructions[4] = {0x58000092, 0x580000b0, 0xf9400210, 0xd61f0200};
+	memcpy(code, instructions, sizeof(instructions));
+	memcpy(code + 16, &functionAddress, sizeof(U64));
+	memcpy(code + 24, &trampolineAddress, sizeof(U64));
+#else
+	WAVM_UNREACHABLE();
+#endif
+	WAVM_ASSERT(offsetof(Function, code) + 32 <= numBytesPerInterpretedFunction);
+}
+
+// The trampoline that interpreted functions jump to until bindInterpreterTrampoline binds theirs.
+static void callUnboundInterpretedFunction()
+{
+	Errors::fatal("Compiled code called an interpreted function without a trampoline");
+}
+
+std::shared_ptr<const InterpreterModuleCode> Runtime::prepareInterpreterCode(
+	const IR::Module& irModule)
+{
+	if(!canWriteInterpretedFunctionCode) { return nullptr; }
+
+	// The interpreter calls imports through the Runtime::Function they are bound to, so it can't
+	// call imports with other calling conventions. It also only supports 32-bit memories and
+	// tables.
+	for(const FunctionImport& functionImport : irModule.functions.imports)
+	{
+		if(irModule.types[functionImport.type.index].callingConvention() != CallingConvention::wasm)
+		{ return nullptr; }
+	}
+	for(Uptr memoryIndex = 0; memoryIndex < irModule.memories.size(); ++memoryIndex)
+	{
+		if(irModule.memories.getType(memoryIndex).indexType != IndexType::i32) { return nullptr; }
+	}
+	for(Uptr tableIndex = 0; tableIndex < irModule.tables.size(); ++tableIndex)
+	{
+		if(irModule.tables.getType(tableIndex).indexType != IndexType::i32) { return nullptr; }
+	}
+
+	std::shared_ptr<InterpreterModuleCode> code = std::make_shared<InterpreterModuleCode>();
+	code->functionDefs.resize(irModule.functions.defs.size());
+	for(Uptr functionDefIndex = 0; functionDefIndex < irModule.functions.defs.size();
+		++functionDefIndex)
+	{
+		if(!buildSideTable(irModule,
+						   irModule.functions.defs[functionDefIndex],
+						   code->functionDefs[functionDefIndex]))
+		{ return nullptr; }
+	}
+	return code;
+}
+
+//
+// Executing functions
+//
+
+// The number of bytes of stack that an interpreted call needs besides the locals and operands in
+// its frame.
+static constexpr Uptr numInterpreterCallStackBytes = 1024;
+
+static void interpretFunction(const InterpretedModule& interpretedModule,
+							  Uptr functionDefIndex,
+							  ContextRuntimeData*& contextRuntimeData,
+							  const UntaggedValue* arguments,
+							  UntaggedValue* results);
+
+template<typename Float> static Float floatMin(Float left, Float right)
+{
+	if(left != left || right != right) { return left + right; }
+	if(left == right)
+	{
+		// min(-0, +0) is -0: the bitwise or of the operands.
+		typename FloatComponents<Float>::Bits leftBits, rightBits;
+		memcpy(&leftBits, &left, sizeof(Float));
+		memcpy(&rightBits, &right, sizeof(Float));
+		leftBits |= rightBits;
+		memcpy(&left, &leftBits, sizeof(Float));
+		return left;
+	}
+	return left < right ? left : right;
+}
+
+template<typename Float> static Float floatMax(Float left, Float right)
+{
+	if(left != left || right != right) { return left + right; }
+	if(left == right)
+	{
+		// max(-0, +0) is +0: the bitwise and of the operands.
+		typename FloatComponents<Float>::Bits leftBits, rightBits;
+		memcpy(&leftBits, &left, sizeof(Float));
+		memcpy(&rightBits, &right, sizeof(Float));
+		leftBits &= rightBits;
+		memcpy(&left, &leftBits, sizeof(Float));
+		return left;
+	}
+	return left > right ? left : right;
+}
+
+// Negation, absolute value, and copysign only change the sign bit, even of NaNs.
+template<typename Float> static Float floatWithSign(Float value, bool sign)
+{
+	typename FloatComponents<Float>::Bits bits;
+	memcpy(&bits, &value, sizeof(Float));
+	constexpr Uptr signShift = sizeof(Float) * 8 - 1;
+	using Bits = typename FloatComponents<Float>::Bits;
+	bits = (bits & ~(Bits(1) << signShift)) | (Bits(sign ? 1 : 0) << signShift);
+	memcpy(&value, &bits, sizeof(Float));
+	return value;
+}
+
+template<typename Float> static bool floatSign(Float value)
+{
+	typename FloatComponents<Float>::Bits bits;
+	memcpy(&bits, &value, sizeof(Float));
+	return (bits >> (sizeof(Float) * 8 - 1)) != 0;
+}
+
+// The lower and upper (exclusive) bounds of the floats that truncate to an integer type, which
+// are exactly representable as floats.
+template<typename Int, typename Float> static Float getTruncMin()
+{
+	return std::numeric_limits<Int>::is_signed
+			   ? -Float(U64(1) << (sizeof(Int) * 8 - 1))
+			   : Float(0);
+}
+template<typename Int, typename Float> static Float getTruncMax()
+{
+	return std::numeric_limits<Int>::is_signed ? Float(U64(1) << (sizeof(Int) * 8 - 1))
+											   : Float(U64(1) << (sizeof(Int) * 8 - 1)) * 2;
+}
+
+template<typename Int, typename Float> static Int truncFloat(Float value)
+{
+	if(value != value) { throwException(ExceptionTypes::invalidFloatOperation); }
+	const Float truncatedValue = trunc(value);
+	if(!(truncatedValue >= getTruncMin<Int, Float>() && truncatedValue < getTruncMax<Int, Float>()))
+	{ throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return Int(truncatedValue);
+}
+
+template<typename Int, typename Float> static Int truncFloatSaturated(Float value)
+{
+	if(value != value) { return 0; }
+	const Float truncatedValue = trunc(value);
+	if(truncatedValue < getTruncMin<Int, Float>()) { return std::numeric_limits<Int>::min(); }
+	if(truncatedValue >= getTruncMax<Int, Float>()) { return std::numeric_limits<Int>::max(); }
+	return Int(truncatedValue);
+}
+
+template<typename Int> static Int countBits(Int value)
+{
+	Int count = 0;
+	for(; value; value &= value - 1) { ++count; }
+	return count;
+}
+
+template<typename Int> static Int rotateLeft(Int value, Int count)
+{
+	constexpr Int numBits = sizeof(Int) * 8;
+	count &= numBits - 1;
+	return count ? Int((value << count) | (value >> (numBits - count))) : value;
+}
+
+template<typename Int> static Int rotateRight(Int value, Int count)
+{
+	constexpr Int numBits = sizeof(Int) * 8;
+	count &= numBits - 1;
+	return count ? Int((value >> count) | (value << (numBits - count))) : value;
+}
+
+template<typename Int> static Int divideSigned(Int left, Int right)
+{
+	if(right == 0 || (left == std::numeric_limits<Int>::min() && right == -1))
+	{ throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return left / right;
+}
+
+template<typename Int> static Int remainderSigned(Int left, Int right)
+{
+	if(right == 0) { throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	if(right == -1) { return 0; }
+	return left % right;
+}
+
+template<typename Int> static Int divideUnsigned(Int left, Int right)
+{
+	if(right == 0) { throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return left / right;
+}
+
+template<typename Int> static Int remainderUnsigned(Int left, Int right)
+{
+	if(right == 0) { throwException(ExceptionTypes::integerDivideByZeroOrOverflow); }
+	return left % right;
+}
+
+namespace {
+	// The state of an interpreted call. The operators are implemented by methods with the same
+	// names as the visitor methods of OperatorDecoderStream.
+	struct FunctionInterpreter
+	{
+		const InterpretedModule& interpretedModule;
+		ContextRuntimeData* contextRuntimeData;
+
+		const U8* codeBegin;
+		const U8* codeEnd;
+		const U8* nextByte;
+
+		const SideTableEntry* sideTable;
+		Uptr sideTableIndex = 0;
+
+		UntaggedValue* locals;
+		UntaggedValue* stackTop;
+
+		bool isReturning = false;
+
+		void run()
+		{
+			while(!isReturning)
+			{
+				WAVM_ASSERT(nextByte < codeEnd);
+				Opcode opcode;
+				memcpy(&opcode, nextByte, sizeof(Opcode));
+				switch(opcode)
+				{
+#define INTERPRET_OP(name, Imm)                                                                    \
+	case Opcode::name: {                                                                           \
+		Imm imm;                                                                                   \
+		ImmEncoding<Imm>::decode(nextByte + sizeof(Opcode), imm);                                  \
+		nextByte += sizeof(Opcode) + ImmEncoding<Imm>::numBytes;                                   \
+		name(imm);                                                                                 \
+		break;                                                                                     \
+	}
+#define INTERPRET_mvp(name, Imm) INTERPRET_OP(name, Imm)
+#define INTERPRET_signExtension(name, Imm) INTERPRET_OP(name, Imm)
+#define INTERPRET_nonTrappingFloatToInt(name, Imm) INTERPRET_OP(name, Imm)
+#define INTERPRET_referenceTypes(name, Imm) INTERPRET_OP(name, Imm)
+#define INTERPRET_bulkMemoryOperations(name, Imm) INTERPRET_OP(name, Imm)
+#define INTERPRET_UNSUPPORTED_OP(name, Imm)                                                        \
+	case Opcode::name: WAVM_UNREACHABLE();
+#define INTERPRET_simd(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_atomics(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_exceptionHandling(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_interleavedLoadStore(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_memoryControl(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_tailCalls(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define INTERPRET_relaxedSIMD(name, Imm) INTERPRET_UNSUPPORTED_OP(name, Imm)
+#define VISIT_OPCODE(_1, name, nameString, Imm, Signature, requiredFeature)                        \
+	INTERPRET_##requiredFeature(name, Imm)
+					WAVM_ENUM_OPERATORS(VISIT_OPCODE)
+#undef VISIT_OPCODE
+#undef INTERPRET_mvp
+#undef INTERPRET_signExtension
+#undef INTERPRET_nonTrappingFloatToInt
+#undef INTERPRET_referenceTypes
+#undef INTERPRET_bulkMemoryOperations
+#undef INTERPRET_simd
+#undef INTERPRET_atomics
+#undef INTERPRET_exceptionHandling
+#undef INTERPRET_interleavedLoadStore
+#undef INTERPRET_memoryControl
+#undef INTERPRET_tailCalls
+#undef INTERPRET_relaxedSIMD
+#undef INTERPRET_UNSUPPORTED_OP
+#undef INTERPRET_OP
+				default: WAVM_UNREACHABLE();
+				};
+			}
+		}
+
+		//
+		// Control structures and branches
+		//
+
+		void block(ControlStructureImm) {}
+		void loop(ControlStructureImm) {}
+		void if_(ControlStructureImm)
+		{
+			if((--stackTop)->i32) { ++sideTableIndex; }
+			else
+			{
+				branch(sideTable[sideTableIndex]);
+			}
+		}
+		void else_(NoImm) { branch(sideTable[sideTableIndex]); }
+		void end(NoImm)
+		{
+			if(nextByte == codeEnd) { isReturning = true; }
+		}
+
+		void br(BranchImm) { branch(sideTable[sideTableIndex]); }
+		void br_if(BranchImm)
+		{
+			if((--stackTop)->i32) { branch(sideTable[sideTableIndex]); }
+			else
+			{
+				++sideTableIndex;
+			}
+		}
+		void br_table(BranchTableImm imm)
+		{
+			const U32 index = (--stackTop)->u32;
+			const Uptr targetIndex = index < imm.numTargetDepths ? index : imm.numTargetDepths;
+			branch(sideTable[sideTableIndex + targetIndex]);
+		}
+		void return_(NoImm) { isReturning = true; }
+		void unreachable(NoImm) { throwException(ExceptionTypes::reachedUnreachable); }
+		void nop(NoImm) {}
+
+		// Unsupported control structures are rejected by SideTableBuilder.
+		void try_(ControlStructureImm) { WAVM_UNREACHABLE(); }
+		void catch_(ExceptionTypeImm) { WAVM_UNREACHABLE(); }
+		void catch_all(NoImm) { WAVM_UNREACHABLE(); }
+
+		//
+		// Calls
+		//
+
+		void call(FunctionImm imm) { callFunction(interpretedModule.functions[imm.functionIndex]); }
+		void call_indirect(CallIndirectImm imm)
+		{
+			const U32 elementIndex = (--stackTop)->u32;
+			callFunction(getIndirectCallee(contextRuntimeData,
+										   interpretedModule.tableIds[imm.tableIndex],
+										   elementIndex,
+										   interpretedModule.module->ir.types[imm.type.index]));
+		}
+
+		//
+		// Parametric operators and variables
+		//
+
+		void drop(NoImm) { --stackTop; }
+		void select(SelectImm)
+		{
+			stackTop -= 2;
+			if(!stackTop[1].i32) { stackTop[-1] = stackTop[0]; }
+		}
+
+		void local_get(GetOrSetVariableImm<false> imm) { *stackTop++ = locals[imm.variableIndex]; }
+		void local_set(GetOrSetVariableImm<false> imm) { locals[imm.variableIndex] = *--stackTop; }
+		void local_tee(GetOrSetVariableImm<false> imm) { locals[imm.variableIndex] = stackTop[-1]; }
+
+		void global_get(GetOrSetVariableImm<true> imm)
+		{
+			const InterpretedGlobal& global = interpretedModule.globals[imm.variableIndex];
+			*stackTop++ = global.isMutable
+							  ? contextRuntimeData->mutableGlobals[global.mutableGlobalIndex]
+							  : *global.immutableValue;
+		}
+		void global_set(GetOrSetVariableImm<true> imm)
+		{
+			const InterpretedGlobal& global = interpretedModule.globals[imm.variableIndex];
+			WAVM_ASSERT(global.isMutable);
+			contextRuntimeData->mutableGlobals[global.mutableGlobalIndex] = *--stackTop;
+		}
+
+		//
+		// References and tables
+		//
+
+		void ref_null(ReferenceTypeImm) { *stackTop++ = UntaggedValue(); }
+		void ref_is_null(NoImm) { stackTop[-1].i32 = stackTop[-1].object == nullptr; }
+		void ref_func(FunctionRefImm imm)
+		{
+			*stackTop++ = interpretedModule.functions[imm.functionIndex];
+		}
+
+		void table_get(TableImm imm)
+		{
+			stackTop[-1].object = getTableElement(getTable(imm.tableIndex), stackTop[-1].u32);
+		}
+		void table_set(TableImm imm)
+		{
+			stackTop -= 2;
+			setTableElement(getTable(imm.tableIndex), stackTop[0].u32, stackTop[1].object);
+		}
+		void table_size(TableImm imm)
+		{
+			*stackTop++ = U32(getTableNumElements(getTable(imm.tableIndex)));
+		}
+		void table_grow(TableImm imm)
+		{
+			--stackTop;
+			Uptr oldNumElements = 0;
+			const GrowResult result = growTable(
+				getTable(imm.tableIndex), stackTop[0].u32, &oldNumElements, stackTop[-1].object);
+			stackTop[-1].i32 = result == GrowResult::success ? I32(oldNumElements) : -1;
+		}
+
+		// Unsupported table and segment operators are rejected by SideTableBuilder.
+		void table_fill(TableImm) { WAVM_UNREACHABLE(); }
+		void table_init(ElemSegmentAndTableImm) { WAVM_UNREACHABLE(); }
+		void table_copy(TableCopyImm) { WAVM_UNREACHABLE(); }
+		void elem_drop(ElemSegmentImm) { WAVM_UNREACHABLE(); }
+		void memory_init(DataSegmentAndMemImm) { WAVM_UNREACHABLE(); }
+		void data_drop(DataSegmentImm) { WAVM_UNREACHABLE(); }
+
+		//
+		// Memories
+		//
+
+		// Returns a pointer to the bytes of a memory access, or throws an out-of-bounds exception
+		// if the access isn't within the memory's current size.
+		U8* getMemoryAccessPointer(Uptr memoryIndex, U64 address, U64 numBytes)
+		{
+			const Uptr memoryId = interpretedModule.memoryIds[memoryIndex];
+			const MemoryRuntimeData& memoryRuntimeData
+				= getCompartmentRuntimeData(contextRuntimeData)->memories[memoryId];
+			const U64 numMemoryBytes
+				= U64(memoryRuntimeData.numPages.load(std::memory_order_acquire))
+				  * IR::numBytesPerPage;
+			if(WAVM_UNLIKELY(address > numMemoryBytes || numBytes > numMemoryBytes - address))
+			{
+				throwException(
+					ExceptionTypes::outOfBoundsMemoryAccess,
+					{asObject(getMemoryFromRuntimeData(contextRuntimeData, memoryId)), address});
+			}
+			return static_cast<U8*>(memoryRuntimeData.base) + address;
+		}
+
+		template<typename Value> Value load(const BaseLoadOrStoreImm& imm)
+		{
+			const U64 address = U64(stackTop[-1].u32) + imm.offset;
+			Value value;
+			memcpy(&value,
+				   getMemoryAccessPointer(imm.memoryIndex, address, sizeof(Value)),
+				   sizeof(Value));
+			return value;
+		}
+
+		template<typename Value> void store(const BaseLoadOrStoreImm& imm, Value value)
+		{
+			stackTop -= 2;
+			const U64 address = U64(stackTop[0].u32) + imm.offset;
+			memcpy(getMemoryAccessPointer(imm.memoryIndex, address, sizeof(Value)),
+				   &value,
+				   sizeof(Value));
+		}
+
+		void i32_load(LoadOrStoreImm<2> imm) { stackTop[-1].i32 = load<I32>(imm); }
+		void i64_load(LoadOrStoreImm<3> imm) { stackTop[-1].i64 = load<I64>(imm); }
+		void f32_load(LoadOrStoreImm<2> imm) { stackTop[-1].f32 = load<F32>(imm); }
+		void f64_load(LoadOrStoreImm<3> imm) { stackTop[-1].f64 = load<F64>(imm); }
+		void i32_load8_s(LoadOrStoreImm<0> imm) { stackTop[-1].i32 = load<I8>(imm); }
+		void i32_load8_u(LoadOrStoreImm<0> imm) { stackTop[-1].i32 = load<U8>(imm); }
+		void i32_load16_s(LoadOrStoreImm<1> imm) { stackTop[-1].i32 = load<I16>(imm); }
+		void i32_load16_u(LoadOrStoreImm<1> imm) { stackTop[-1].i32 = load<U16>(imm); }
+		void i64_load8_s(LoadOrStoreImm<0> imm) { stackTop[-1].i64 = load<I8>(imm); }
+		void i64_load8_u(LoadOrStoreImm<0> imm) { stackTop[-1].i64 = load<U8>(imm); }
+		void i64_load16_s(LoadOrStoreImm<1> imm) { stackTop[-1].i64 = load<I16>(imm); }
+		void i64_load16_u(LoadOrStoreImm<1> imm) { stackTop[-1].i64 = load<U16>(imm); }
+		void i64_load32_s(LoadOrStoreImm<2> imm) { stackTop[-1].i64 = load<I32>(imm); }
+		void i64_load32_u(LoadOrStoreImm<2> imm) { stackTop[-1].i64 = load<U32>(imm); }
+
+		void i32_store(LoadOrStoreImm<2> imm) { store<I32>(imm, stackTop[-1].i32); }
+		void i64_store(LoadOrStoreImm<3> imm) { store<I64>(imm, stackTop[-1].i64); }
+		void f32_store(LoadOrStoreImm<2> imm) { store<F32>(imm, stackTop[-1].f32); }
+		void f64_store(LoadOrStoreImm<3> imm) { store<F64>(imm, stackTop[-1].f64); }
+		void i32_store8(LoadOrStoreImm<0> imm) { store<U8>(imm, U8(stackTop[-1].u32)); }
+		void i32_store16(LoadOrStoreImm<1> imm) { store<U16>(imm, U16(stackTop[-1].u32)); }
+		void i64_store8(LoadOrStoreImm<0> imm) { store<U8>(imm, U8(stackTop[-1].u64)); }
+		void i64_store16(LoadOrStoreImm<1> imm) { store<U16>(imm, U16(stackTop[-1].u64)); }
+		void i64_store32(LoadOrStoreImm<2> imm) { store<U32>(imm, U32(stackTop[-1].u64)); }
+
+		void memory_size(MemoryImm imm)
+		{
+			const Uptr memoryId = interpretedModule.memoryIds[imm.memoryIndex];
+			*stackTop++ = U32(getCompartmentRuntimeData(contextRuntimeData)
+								  ->memories[memoryId]
+								  .numPages.load(std::memory_order_acquire));
+		}
+		void memory_grow(MemoryImm imm)
+		{
+			Memory* memory = getMemoryFromRuntimeData(contextRuntimeData,
+													  interpretedModule.memoryIds[imm.memoryIndex]);
+			Uptr oldNumPages = 0;
+			const GrowResult result = growMemory(memory, stackTop[-1].u32, &oldNumPages);
+			stackTop[-1].i32 = result == GrowResult::success ? I32(oldNumPages) : -1;
+		}
+		void memory_copy(MemoryCopyImm imm)
+		{
+			stackTop -= 3;
+			const U32 numBytes = stackTop[2].u32;
+			U8* destPointer
+				= getMemoryAccessPointer(imm.destMemoryIndex, stackTop[0].u32, numBytes);
+			U8* sourcePointer
+				= getMemoryAccessPointer(imm.sourceMemoryIndex, stackTop[1].u32, numBytes);
+			memmove(destPointer, sourcePointer, numBytes);
+		}
+		void memory_fill(MemoryImm imm)
+		{
+			stackTop -= 3;
+			const U32 numBytes = stackTop[2].u32;
+			memset(getMemoryAccessPointer(imm.memoryIndex, stackTop[0].u32, numBytes),
+				   U8(stackTop[1].u32),
+				   numBytes);
+		}
+
+		//
+		// Numeric operators
+		//
+
+		void i32_const(LiteralImm<I32> imm) { *stackTop++ = imm.value; }
+		void i64_const(LiteralImm<I64> imm) { *stackTop++ = imm.value; }
+		void f32_const(LiteralImm<F32> imm) { *stackTop++ = imm.value; }
+		void f64_const(LiteralImm<F64> imm) { *stackTop++ = imm.value; }
+
+#define UNARY_OP(name, operandType, resultType, expression)                                        \
+	void name(NoImm)                                                                               \
+	{                                                                                              \
+		const auto operand = stackTop[-1].operandType;                                             \
+		stackTop[-1].resultType = (expression);                                                    \
+	}
+#define BINARY_OP(name, operandType, resultType, expression)                                       \
+	void name(NoImm)                                                                               \
+	{                                                                                              \
+		const auto left = stackTop[-2].operandType;                                                \
+		const auto right = stackTop[-1].operandType;                                               \
+		--stackTop;                                                                                \
+		stackTop[-1].resultType = (expression);                                                    \
+	}
+
+		UNARY_OP(i32_eqz, i32, i32, operand == 0)
+		BINARY_OP(i32_eq, i32, i32, left == right)
+		BINARY_OP(i32_ne, i32, i32, left != right)
+		BINARY_OP(i32_lt_s, i32, i32, left < right)
+		BINARY_OP(i32_lt_u, u32, i32, left < right)
+		BINARY_OP(i32_gt_s, i32, i32, left > right)
+		BINARY_OP(i32_gt_u, u32, i32, left > right)
+		BINARY_OP(i32_le_s, i32, i32, left <= right)
+		BINARY_OP(i32_le_u, u32, i32, left <= right)
+		BINARY_OP(i32_ge_s, i32, i32, left >= right)
+		BINARY_OP(i32_ge_u, u32, i32, left >= right)
+
+		UNARY_OP(i64_eqz, i64, i32, operand == 0)
+		BINARY_OP(i64_eq, i64, i32, left == right)
+		BINARY_OP(i64_ne, i64, i32, left != right)
+		BINARY_OP(i64_lt_s, i64, i32, left < right)
+		BINARY_OP(i64_lt_u, u64, i32, left < right)
+		BINARY_OP(i64_gt_s, i64, i32, left > right)
+		BINARY_OP(i64_gt_u, u64, i32, left > right)
+		BINARY_OP(i64_le_s, i64, i32, left <= right)
+		BINARY_OP(i64_le_u, u64, i32, left <= right)
+		BINARY_OP(i64_ge_s, i64, i32, left >= right)
+		BINARY_OP(i64_ge_u, u64, i32, left >= right)
+
+		BINARY_OP(f32_eq, f32, i32, left == right)
+		BINARY_OP(f32_ne, f32, i32, left != right)
+		BINARY_OP(f32_lt, f32, i32, left < right)
+		BINARY_OP(f32_gt, f32, i32, left > right)
+		BINARY_OP(f32_le, f32, i32, left <= right)
+		BINARY_OP(f32_ge, f32, i32, left >= right)
+		BINARY_OP(f64_eq, f64, i32, left == right)
+		BINARY_OP(f64_ne, f64, i32, left != right)
+		BINARY_OP(f64_lt, f64, i32, left < right)
+		BINARY_OP(f64_gt, f64, i32, left > right)
+		BINARY_OP(f64_le, f64, i32, left <= right)
+		BINARY_OP(f64_ge, f64, i32, left >= right)
+
+		UNARY_OP(i32_clz, u32, u32, countLeadingZeroes(operand))
+		UNARY_OP(i32_ctz, u32, u32, countTrailingZeroes(operand))
+		UNARY_OP(i32_popcnt, u32, u32, countBits(operand))
+		BINARY_OP(i32_add, u32, u32, left + right)
+		BINARY_OP(i32_sub, u32, u32, left - right)
+		BINARY_OP(i32_mul, u32, u32, left * right)
+		BINARY_OP(i32_div_s, i32, i32, divideSigned(left, right))
+		BINARY_OP(i32_div_u, u32, u32, divideUnsigned(left, right))
+		BINARY_OP(i32_rem_s, i32, i32, remainderSigned(left, right))
+		BINARY_OP(i32_rem_u, u32, u32, remainderUnsigned(left, right))
+		BINARY_OP(i32_and_, u32, u32, left & right)
+		BINARY_OP(i32_or_, u32, u32, left | right)
+		BINARY_OP(i32_xor_, u32, u32, left ^ right)
+		BINARY_OP(i32_shl, u32, u32, left << (right & 31))
+		BINARY_OP(i32_shr_s, i32, i32, left >> (right & 31))
+		BINARY_OP(i32_shr_u, u32, u32, left >> (right & 31))
+		BINARY_OP(i32_rotl, u32, u32, rotateLeft(left, right))
+		BINARY_OP(i32_rotr, u32, u32, rotateRight(left, right))
+
+		UNARY_OP(i64_clz, u64, u64, countLeadingZeroes(operand))
+		UNARY_OP(i64_ctz, u64, u64, countTrailingZeroes(operand))
+		UNARY_OP(i64_popcnt, u64, u64, countBits(operand))
+		BINARY_OP(i64_add, u64, u64, left + right)
+		BINARY_OP(i64_sub, u64, u64, left - right)
+		BINARY_OP(i64_mul, u64, u64, left * right)
+		BINARY_OP(i64_div_s, i64, i64, divideSigned(left, right))
+		BINARY_OP(i64_div_u, u64, u64, divideUnsigned(left, right))
+		BINARY_OP(i64_rem_s, i64, i64, remainderSigned(left, right))
+		BINARY_OP(i64_rem_u, u64, u64, remainderUnsigned(left, right))
+		BINARY_OP(i64_and_, u64, u64, left & right)
+		BINARY_OP(i64_or_, u64, u64, left | right)
+		BINARY_OP(i64_xor_, u64, u64, left ^ right)
+		BINARY_OP(i64_shl, u64, u64, left << (right & 63))
+		BINARY_OP(i64_shr_s, i64, i64, left >> (right & 63))
+		BINARY_OP(i64_shr_u, u64, u64, left >> (right & 63))
+		BINARY_OP(i64_rotl, u64, u64, rotateLeft(left, right))
+		BINARY_OP(i64_rotr, u64, u64, rotateRight(left, right))
+
+		UNARY_OP(f32_abs, f32, f32, floatWithSign(operand, false))
+		UNARY_OP(f32_neg, f32, f32, floatWithSign(operand, !floatSign(operand)))
+		UNARY_OP(f32_ceil, f32, f32, ceilf(operand))
+		UNARY_OP(f32_floor, f32, f32, floorf(operand))
+		UNARY_OP(f32_trunc, f32, f32, truncf(operand))
+		UNARY_OP(f32_nearest, f32, f32, nearbyintf(operand))
+		UNARY_OP(f32_sqrt, f32, f32, sqrtf(operand))
+		BINARY_OP(f32_add, f32, f32, left + right)
+		BINARY_OP(f32_sub, f32, f32, left - right)
+		BINARY_OP(f32_mul, f32, f32, left * right)
+		BINARY_OP(f32_div, f32, f32, left / right)
+		BINARY_OP(f32_min, f32, f32, floatMin(left, right))
+		BINARY_OP(f32_max, f32, f32, floatMax(left, right))
+		BINARY_OP(f32_copysign, f32, f32, floatWithSign(left, floatSign(right)))
+
+		UNARY_OP(f64_abs, f64, f64, floatWithSign(operand, false))
+		UNARY_OP(f64_neg, f64, f64, floatWithSign(operand, !floatSign(operand)))
+		UNARY_OP(f64_ceil, f64, f64, ceil(operand))
+		UNARY_OP(f64_floor, f64, f64, floor(operand))
+		UNARY_OP(f64_trunc, f64, f64, trunc(operand))
+		UNARY_OP(f64_nearest, f64, f64, nearbyint(operand))
+		UNARY_OP(f64_sqrt, f64, f64, sqrt(operand))
+		BINARY_OP(f64_add, f64, f64, left + right)
+		BINARY_OP(f64_sub, f64, f64, left - right)
+		BINARY_OP(f64_mul, f64, f64, left * right)
+		BINARY_OP(f64_div, f64, f64, left / right)
+		BINARY_OP(f64_min, f64, f64, floatMin(left, right))
+		BINARY_OP(f64_max, f64, f64, floatMax(left, right))
+		BINARY_OP(f64_copysign, f64, f64, floatWithSign(left, floatSign(right)))
+
+		UNARY_OP(i32_wrap_i64, u64, u32, U32(operand))
+		UNARY_OP(i32_trunc_f32_s, f32, i32, (truncFloat<I32, F32>(operand)))
+		UNARY_OP(i32_trunc_f32_u, f32, u32, (truncFloat<U32, F32>(operand)))
+		UNARY_OP(i32_trunc_f64_s, f64, i32, (truncFloat<I32, F64>(operand)))
+		UNARY_OP(i32_trunc_f64_u, f64, u32, (truncFloat<U32, F64>(operand)))
+		UNARY_OP(i64_extend_i32_s, i32, i64, I64(operand))
+		UNARY_OP(i64_extend_i32_u, u32, u64, U64(operand))
+		UNARY_OP(i64_trunc_f32_s, f32, i64, (truncFloat<I64, F32>(operand)))
+		UNARY_OP(i64_trunc_f32_u, f32, u64, (truncFloat<U64, F32>(operand)))
+		UNARY_OP(i64_trunc_f64_s, f64, i64, (truncFloat<I64, F64>(operand)))
+		UNARY_OP(i64_trunc_f64_u, f64, u64, (truncFloat<U64, F64>(operand)))
+		UNARY_OP(f32_convert_i32_s, i32, f32, F32(operand))
+		UNARY_OP(f32_convert_i32_u, u32, f32, F32(operand))
+		UNARY_OP(f32_convert_i64_s, i64, f32, F32(operand))
+		UNARY_OP(f32_convert_i64_u, u64, f32, F32(operand))
+		UNARY_OP(f32_demote_f64, f64, f32, F32(operand))
+		UNARY_OP(f64_convert_i32_s, i32, f64, F64(operand))
+		UNARY_OP(f64_convert_i32_u, u32, f64, F64(operand))
+		UNARY_OP(f64_convert_i64_s, i64, f64, F64(operand))
+		UNARY_OP(f64_convert_i64_u, u64, f64, F64(operand))
+		UNARY_OP(f64_promote_f32, f32, f64, F64(operand))
+
+		// The operands are untagged, so reinterpreting them doesn't change them.
+		void i32_reinterpret_f32(NoImm) {}
+		void i64_reinterpret_f64(NoImm) {}
+		void f32_reinterpret_i32(NoImm) {}
+		void f64_reinterpret_i64(NoImm) {}
+
+		UNARY_OP(i32_extend8_s, i32, i32, I32(I8(operand)))
+		UNARY_OP(i32_extend16_s, i32, i32, I32(I16(operand)))
+		UNARY_OP(i64_extend8_s, i64, i64, I64(I8(operand)))
+		UNARY_OP(i64_extend16_s, i64, i64, I64(I16(operand)))
+		UNARY_OP(i64_extend32_s, i64, i64, I64(I32(operand)))
+
+		UNARY_OP(i32_trunc_sat_f32_s, f32, i32, (truncFloatSaturated<I32, F32>(operand)))
+		UNARY_OP(i32_trunc_sat_f32_u, f32, u32, (truncFloatSaturated<U32, F32>(operand)))
+		UNARY_OP(i32_trunc_sat_f64_s, f64, i32, (truncFloatSaturated<I32, F64>(operand)))
+		UNARY_OP(i32_trunc_sat_f64_u, f64, u32, (truncFloatSaturated<U32, F64>(operand)))
+		UNARY_OP(i64_trunc_sat_f32_s, f32, i64, (truncFloatSaturated<I64, F32>(operand)))
+		UNARY_OP(i64_trunc_sat_f32_u, f32, u64, (truncFloatSaturated<U64, F32>(operand)))
+		UNARY_OP(i64_trunc_sat_f64_s, f64, i64, (truncFloatSaturated<I64, F64>(operand)))
+		UNARY_OP(i64_trunc_sat_f64_u, f64, u64, (truncFloatSaturated<U64, F64>(operand)))
+
+#undef UNARY_OP
+#undef BINARY_OP
+
+	private:
+		// Moves the operands kept by a branch to the target's stack depth, and continues at the
+		// target.
+		void branch(const SideTableEntry& entry)
+		{
+			if(entry.numDiscardedValues)
+			{
+				UntaggedValue* keptValues = stackTop - entry.numKeptValues;
+				memmove(keptValues - entry.numDiscardedValues,
+						keptValues,
+						entry.numKeptValues * sizeof(UntaggedValue));
+				stackTop -= entry.numDiscardedValues;
+			}
+			nextByte = codeBegin + entry.targetCodeOffset;
+			sideTableIndex = entry.targetSideTableIndex;
+		}
+
+		// Calls a function with the arguments on top of the stack, and replaces them with its
+		// results. Interpreted functions are called directly, and compiled functions through an
+		// invoke thunk.
+		void callFunction(Function* callee)
+		{
+			const FunctionType calleeType{callee->encodedType};
+			UntaggedValue* arguments = stackTop - calleeType.params().size();
+			if(const InterpretedModule* calleeModule = callee->mutableData->interpretedModule)
+			{
+				interpretFunction(*calleeModule,
+								  callee->mutableData->interpretedFunctionDefIndex,
+								  contextRuntimeData,
+								  arguments,
+								  arguments);
+			}
+			else
+			{
+				InvokeThunkPointer invokeThunk = reinterpret_cast<InvokeThunkPointer>(
+					const_cast<void*>(getInvokeThunk(callee, calleeType)));
+				contextRuntimeData
+					= (*invokeThunk)(callee, contextRuntimeData, arguments, arguments);
+			}
+			stackTop = arguments + calleeType.results().size();
+		}
+
+		Table* getTable(Uptr tableIndex)
+		{
+			return getTableFromRuntimeData(contextRuntimeData,
+										   interpretedModule.tableIds[tableIndex]);
+		}
+	};
+}
+
+WAVM_FORCENOINLINE static void interpretFunction(const InterpretedModule& interpretedModule,
+												 Uptr functionDefIndex,
+												 ContextRuntimeData*& contextRuntimeData,
+												 const UntaggedValue* arguments,
+												 UntaggedValue* results)
+{
+	// If the instance tiers up its hot functions, count the call, and once the function has been
+	// tiered up, call its optimized code instead.
+	const Function* function
+		= interpretedModule.functions[interpretedModule.module->ir.functions.imports.size()
+									  + functionDefIndex];
+	if(WAVM_UNLIKELY(function->mutableData->tierUpState != nullptr))
+	{
+		if(const Function* tieredUpFunction = countInterpretedTierUpCall(function))
+		{
+			InvokeThunkPointer invokeThunk = reinterpret_cast<InvokeThunkPointer>(const_cast<void*>(
+				getInvokeThunk(tieredUpFunction, FunctionType(tieredUpFunction->encodedType))));
+			contextRuntimeData
+				= (*invokeThunk)(tieredUpFunction, contextRuntimeData, arguments, results);
+			return;
+		}
+	}
+
+	const InterpretedFunctionCode& functionCode
+		= interpretedModule.code->functionDefs[functionDefIndex];
+	const FunctionDef& functionDef = interpretedModule.module->ir.functions.defs[functionDefIndex];
+	const FunctionType functionType = interpretedModule.module->ir.types[functionDef.type.index];
+	const Uptr numParams = functionType.params().size();
+	const Uptr numResults = functionType.results().size();
+
+	// The interpreter doesn't make calls on a separate stack, so check that the frame fits in the
+	// native stack above the limit that the invoke functions set.
+	const Uptr numFrameBytes
+		= (functionCode.numLocals + functionCode.maxStackDepth) * sizeof(UntaggedValue);
+	U8 stackMarker;
+	if(reinterpret_cast<Uptr>(&stackMarker)
+	   < contextRuntimeData->stackLimit + numFrameBytes + numInterpreterCallStackBytes)
+	{ throwException(ExceptionTypes::stackOverflow); }
+
+	// Allocate the frame on the native stack, and initialize the locals to the arguments followed
+	// by zeros.
+	UntaggedValue* frame
+		= static_cast<UntaggedValue*>(alloca(numFrameBytes + sizeof(UntaggedValue)));
+	memcpy(frame, arguments, numParams * sizeof(UntaggedValue));
+	for(Uptr localIndex = numParams; localIndex < functionCode.numLocals; ++localIndex)
+	{ frame[localIndex] = UntaggedValue(); }
+
+	FunctionInterpreter interpreter{interpretedModule,
+									contextRuntimeData,
+									functionDef.code.data(),
+									functionDef.code.data() + functionDef.code.size(),
+									functionDef.code.data(),
+									functionCode.sideTable.data()};
+	interpreter.locals = frame;
+	interpreter.stackTop = frame + functionCode.numLocals;
+	interpreter.run();
+
+	// The function's results are on top of the stack when it returns.
+	memcpy(results, interpreter.stackTop - numResults, numResults * sizeof(UntaggedValue));
+	contextRuntimeData = interpreter.contextRuntimeData;
+}
+
+// The invoke thunk of interpreted functions, which is called by Runtime::invokeFunction.
+static ContextRuntimeData* invokeInterpretedFunction(const Function* function,
+													 ContextRuntimeData* contextRuntimeData,
+													 const UntaggedValue* arguments,
+													 UntaggedValue* results)
+{
+	const FunctionMutableData* mutableData = function->mutableData;
+	WAVM_ASSERT(mutableData->interpretedModule);
+	interpretFunction(*mutableData->interpretedModule,
+					  mutableData->interpretedFunctionDefIndex,
+					  contextRuntimeData,
+					  arguments,
+					  results);
+	return contextRuntimeData;
+}
+
+std::shared_ptr<InterpretedModule> Runtime::createInterpretedModule(
+	ModuleConstRefParam module,
+	std::shared_ptr<const InterpreterModuleCode>&& code,
+	Uptr instanceId,
+	const std::vector<Function*>& functionImports,
+	const std::vector<Table*>& tables,
+	const std::vector<Memory*>& memories,
+	const std::vector<Global*>& globals,
+	const std::vector<FunctionMutableData*>& functionDefMutableDatas)
+{
+	WAVM_ASSERT(functionImports.size() == module->ir.functions.imports.size());
+	WAVM_ASSERT(functionDefMutableDatas.size() == module->ir.functions.defs.size());
+
+	std::shared_ptr<InterpretedModule> interpretedModule = std::make_shared<InterpretedModule>();
+	interpretedModule->module = module;
+	interpretedModule->code = std::move(code);
+	interpretedModule->functions = functionImports;
+	for(Table* table : tables) { interpretedModule->tableIds.push_back(table->id); }
+	for(Memory* memory : memories) { interpretedModule->memoryIds.push_back(memory->id); }
+	for(Global* global : globals)
+	{
+		InterpretedGlobal interpretedGlobal;
+		interpretedGlobal.isMutable = global->type.isMutable;
+		interpretedGlobal.mutableGlobalIndex = global->mutableGlobalIndex;
+		interpretedGlobal.immutableValue = &global->initialValue;
+		interpretedModule->globals.push_back(interpretedGlobal);
+	}
+
+	// Allocate the Runtime::Function objects for the function definitions in pages that are made
+	// executable after their code is written.
+	const Uptr numFunctionDefs = functionDefMutableDatas.size();
+	if(numFunctionDefs)
+	{
+		const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+		interpretedModule->numFunctionDefPages
+			= (numFunctionDefs * numBytesPerInterpretedFunction + (Uptr(1) << pageBytesLog2) - 1)
+			  >> pageBytesLog2;
+		interpretedModule->functionDefPages
+			= Platform::allocateVirtualPages(interpretedModule->numFunctionDefPages);
+		if(!interpretedModule->functionDefPages
+		   || !Platform::commitVirtualPages(interpretedModule->functionDefPages,
+											interpretedModule->numFunctionDefPages))
+		{ Errors::fatal("Failed to allocate the interpreted functions of an instance"); }
+	}
+
+	for(Uptr functionDefIndex = 0; functionDefIndex < numFunctionDefs; ++functionDefIndex)
+	{
+		const FunctionDef& functionDef = module->ir.functions.defs[functionDefIndex];
+		FunctionMutableData* mutableData = functionDefMutableDatas[functionDefIndex];
+		const FunctionType functionType = module->ir.types[functionDef.type.index];
+		Function* function = new(interpretedModule->functionDefPages
+								 + functionDefIndex * numBytesPerInterpretedFunction)
+			Function(mutableData, instanceId, functionType.getEncoding());
+		mutableData->function = function;
+		mutableData->interpretedModule = interpretedModule.get();
+		mutableData->interpretedFunctionDefIndex = functionDefIndex;
+		mutableData->invokeThunk.store(&invokeInterpretedFunction, std::memory_order_relaxed);
+		mutableData->interpreterTrampoline.store(
+			reinterpret_cast<const void*>(&callUnboundInterpretedFunction),
+			std::memory_order_relaxed);
+		writeInterpretedFunctionCode(function);
+		interpretedModule->functions.push_back(function);
+	}
+
+	if(numFunctionDefs)
+	{
+		WAVM_ERROR_UNLESS(Platform::setVirtualPageAccess(interpretedModule->functionDefPages,
+														 interpretedModule->numFunctionDefPages,
+														 Platform::MemoryAccess::readExecute));
+#if defined(__aarch64__)
+		__builtin___clear_cache(
+			reinterpret_cast<char*>(interpretedModule->functionDefPages),
+			reinterpret_cast<char*>(interpretedModule->functionDefPages
+									+ numFunctionDefs * numBytesPerInterpretedFunction));
+#endif
+	}
+
+	return interpretedModule;
+}
+
+void Runtime::bindInterpreterTrampoline(Function* function)
+{
+	FunctionMutableData* mutableData = function->mutableData;
+	const void* unboundTrampoline = reinterpret_cast<const void*>(&callUnboundInterpretedFunction);
+	if(!mutableData->interpretedModule
+	   || mutableData->interpreterTrampoline.load(std::memory_order_acquire) != unboundTrampoline)
+	{ return; }
+
+	// Only replace the unbound trampoline, so the function's optimized code isn't replaced if it
+	// was tiered up since the load above. LLVMJIT::getInterpreterTrampoline returns the same
+	// trampoline for every call with the same type, so racing with another thread binding the
+	// function stores the same value.
+	const void* trampoline = LLVMJIT::getInterpreterTrampoline(FunctionType(function->encodedType),
+															   &invokeInterpretedFunction,
+															   getGlobalObjectCache().get());
+	mutableData->interpreterTrampoline.compare_exchange_strong(
+		unboundTrampoline, trampoline, std::memory_order_release, std::memory_order_relaxed);
+}
@@ -14,8 +14,10 @@
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Serialization.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
 
 namespace WAVM { namespace Intrinsics {
 	struct ModuleImpl
@@ -44,8 +46,9 @@ static void initializeModule(Intrinsics::Module* moduleRef)
 Intrinsics::Function::Function(Intrinsics::Module* moduleRef,
 							   const char* inName,
 							   void* inNativeFunction,
-							   FunctionType inType)
-: name(inName), type(inType), nativeFunction(inNativeFunction)
+							   FunctionType inType,
+							   const char* inInlineLLVMIR)
+: name(inName), type(inType), nativeFunction(inNativeFunction), inlineLLVMIR(inInlineLLVMIR)
 {
 	initializeModule(moduleRef);
 
@@ -89,6 +92,35 @@ Intrinsics::Memory::Memory(Intrinsics::Module* moduleRef,
 	moduleRef->impl->memoryMap.set(name, this);
 }
 
+// The number of compiled intrinsic modules that are kept to be instantiated again. The native
+// functions an intrinsic module calls are bound when it is instantiated, so most programs only
+// compile a few distinct intrinsic modules.
+static constexpr Uptr maxCachedIntrinsicModules = 1024;
+
+// Returns a compiled intrinsic module, reusing the module compiled for an earlier instantiation
+// with the same IR and compile options, so instantiating it again only loads its object code.
+static ModuleRef getCompiledIntrinsicModule(const IR::Module& irModule)
+{
+	static Platform::Mutex cacheMutex;
+	static HashMap<std::vector<U8>, ModuleRef> cachedModules;
+
+	std::vector<U8> key = WASM::saveBinaryModule(irModule);
+	const std::vector<U8> optionsKey = getCompileOptionsKey(getGlobalCompileOptions());
+	key.insert(key.end(), optionsKey.begin(), optionsKey.end());
+	{
+		Platform::Mutex::Lock cacheLock(cacheMutex);
+		if(const ModuleRef* cachedModule = cachedModules.get(key)) { return *cachedModule; }
+	}
+
+	// Compile the module without holding the lock. If another thread compiled the same module in
+	// the meantime, keep the module it added.
+	ModuleRef module = compileModule(irModule);
+	Platform::Mutex::Lock cacheLock(cacheMutex);
+	if(const ModuleRef* cachedModule = cachedModules.get(key)) { return *cachedModule; }
+	if(cachedModules.size() < maxCachedIntrinsicModules) { cachedModules.add(key, module); }
+	return module;
+}
+
 Instance* Intrinsics::instantiateModule(
 	Compartment* compartment,
 	const std::initializer_list<const Intrinsics::Module*>& moduleRefs,
@@ -101,6 +133,7 @@ Instance* Intrinsics::instantiateModule(
 	DisassemblyNames names;
 
 	std::vector<FunctionImportBinding> functionImportBindings;
+	std::vector<const Intrinsics::Function*> intrinsicFunctions;
 	for(const Intrinsics::Module* moduleRef : moduleRefs)
 	{
 		if(moduleRef->impl)
@@ -108,6 +141,7 @@ Instance* Intrinsics::instantiateModule(
 			for(const auto& pair : moduleRef->impl->functionMap)
 			{
 				functionImportBindings.push_back({pair.value->getNativeFunction()});
+				intrinsicFunctions.push_back(pair.value);
 				const Uptr typeIndex = irModule.types.size();
 				const Uptr functionIndex = irModule.functions.size();
 				irModule.types.push_back(pair.value->getType());
@@ -224,7 +258,7 @@ Instance* Intrinsics::instantiateModule(
 		}
 	}
 
-	ModuleRef module = compileModule(irModule);
+	ModuleRef module = getCompiledIntrinsicModule(irModule);
 	Instance* instance = instantiateModuleInternal(compartment,
 												   module,
 												   std::move(functionImportBindings),
@@ -234,6 +268,20 @@ Instance* Intrinsics::instantiateModule(
 												   {},
 												   std::move(debugName));
 
+	// Record the inline bodies and the native functions of pure intrinsics on the thunks that are
+	// exported for them.
+	if(instance)
+	{
+		for(Uptr importIndex = 0; importIndex < intrinsicFunctions.size(); ++importIndex)
+		{
+			const Intrinsics::Function* intrinsicFunction = intrinsicFunctions[importIndex];
+			Runtime::Function* thunk = instance->functions[intrinsicFunctions.size() + importIndex];
+			thunk->mutableData->inlineLLVMIR = intrinsicFunction->getInlineLLVMIR();
+			if(intrinsicFunction->isPure())
+			{ thunk->mutableData->pureNativeFunction = intrinsicFunction->getNativeFunction(); }
+		}
+	}
+
 	Timing::logTimer("Instantiated intrinsic module", timer);
 	return instance;
 }
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include "RuntimePrivate.h"
@@ -8,6 +9,9 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Trace.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
 
@@ -15,11 +19,74 @@ using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
-void Runtime::invokeFunction(Context* context,
-							 const Function* function,
-							 FunctionType invokeSig,
-							 const UntaggedValue arguments[],
-							 UntaggedValue outResults[])
+// The number of bytes at the bottom of the stack below the stack limit, which are left for the
+// stack overflow trap to throw its exception with.
+static constexpr Uptr numStackLimitReservedBytes = 128 * 1024;
+
+// Sets the context's stack limit for the stack that the calling thread is running on, unless an
+// invoke further up the same stack already set it, and clears it when the outermost invoke returns.
+struct StackLimitScope
+{
+	StackLimitScope(ContextRuntimeData* inContextRuntimeData)
+	: contextRuntimeData(inContextRuntimeData), isOutermost(!contextRuntimeData->stackLimit)
+	{
+		if(isOutermost)
+		{
+			U8* stackMinAddr;
+			U8* stackMaxAddr;
+			Platform::getCurrentStack(stackMinAddr, stackMaxAddr);
+			const Uptr numReservedBytes
+				= std::min(numStackLimitReservedBytes, Uptr(stackMaxAddr - stackMinAddr) / 4);
+			contextRuntimeData->stackLimit = reinterpret_cast<Uptr>(stackMinAddr) + numReservedBytes;
+		}
+	}
+
+	~StackLimitScope()
+	{
+		if(isOutermost) { contextRuntimeData->stackLimit = 0; }
+	}
+
+private:
+	ContextRuntimeData* contextRuntimeData;
+	bool isOutermost;
+};
+
+thread_local I32 Runtime::currentMemoryProtectionKey = -1;
+
+// If the context's compartment allocates its memories from a pool that uses protection keys, denies
+// the calling thread access to the memories in other stripes of the pool while it runs code in the
+// compartment, and restores the thread's previous rights afterward.
+struct ProtectionKeyScope
+{
+	ProtectionKeyScope(Compartment* compartment) : protectionKey(compartment->memoryProtectionKey)
+	{
+		if(protectionKey >= 0)
+		{
+			outerRights = Platform::getProtectionKeyRights();
+			const U32 deniedRights = outerRights | compartment->memoryProtectionKeyRightsMask;
+			Platform::setProtectionKeyRights(deniedRights & ~(U32(3) << (protectionKey * 2)));
+
+			outerProtectionKey = currentMemoryProtectionKey;
+			currentMemoryProtectionKey = protectionKey;
+		}
+	}
+
+	~ProtectionKeyScope()
+	{
+		if(protectionKey >= 0)
+		{
+			Platform::setProtectionKeyRights(outerRights);
+			currentMemoryProtectionKey = outerProtectionKey;
+		}
+	}
+
+private:
+	I32 protectionKey;
+	U32 outerRights{0};
+	I32 outerProtectionKey{-1};
+};
+
+const void* Runtime::getInvokeThunk(const Function* function, FunctionType invokeSig)
 {
 	FunctionType functionType{function->encodedType};
 
@@ -34,30 +101,18 @@ void Runtime::invokeFunction(Context* context,
 				asString(invokeSig).c_str(),
 				asString(getFunctionType(function)).c_str());
 		}
-		throwException(ExceptionTypes::invokeSignatureMismatch);
-	}
-
-	// Assert that the function, the context, and any reference arguments are all in the same
-	// compartment.
-	if(WAVM_ENABLE_ASSERTS)
-	{
-		WAVM_ASSERT(isInCompartment(asObject(function), context->compartment));
-		for(Uptr argumentIndex = 0; argumentIndex < invokeSig.params().size(); ++argumentIndex)
-		{
-			const ValueType argType = invokeSig.params()[argumentIndex];
-			const UntaggedValue& arg = arguments[argumentIndex];
-			WAVM_ASSERT(!isReferenceType(argType) || !arg.object
-						|| isInCompartment(arg.object, context->compartment));
-		}
+		return nullptr;
 	}
 
 	// Get the invoke thunk for this function type. Cache it in the function's FunctionMutableData
-	// to avoid the global lock implied by LLVMJIT::getInvokeThunk.
+	// to avoid the global lock implied by LLVMJIT::getInvokeThunk. If there's a global object
+	// cache, LLVMJIT::getInvokeThunk looks up the thunk's object code in it, so processes that
+	// use the same cache don't each compile the thunk.
 	InvokeThunkPointer invokeThunk
 		= function->mutableData->invokeThunk.load(std::memory_order_acquire);
 	if(WAVM_UNLIKELY(!invokeThunk))
 	{
-		invokeThunk = LLVMJIT::getInvokeThunk(functionType);
+		invokeThunk = LLVMJIT::getInvokeThunk(functionType, getGlobalObjectCache().get());
 
 		// Replace the cached thunk pointer, but since LLVMJIT::getInvokeThunk is guaranteed to
 		// return the same thunk when called with the same FunctionType, we can assume that any
@@ -65,10 +120,35 @@ void Runtime::invokeFunction(Context* context,
 		function->mutableData->invokeThunk.store(invokeThunk, std::memory_order_release);
 	}
 	WAVM_ASSERT(invokeThunk);
+	return reinterpret_cast<const void*>(invokeThunk);
+}
+
+void Runtime::invokeFunctionWithThunk(Context* context,
+									  const Function* function,
+									  const void* invokeThunk,
+									  const UntaggedValue arguments[],
+									  UntaggedValue outResults[])
+{
+	WAVM_ASSERT(invokeThunk);
+	Trace::Scope traceScope("invoke", function->mutableData->debugName.c_str());
 
-	// MacOS std::function is a little more pessimistic about heap allocating captures, and without
-	// wrapping these captured variables into a single reference, does a heap allocation for the
-	// thunk passed to unwindSignalsAsExceptions below.
+	// Assert that the function, the context, and any reference arguments are all in the same
+	// compartment.
+	if(WAVM_ENABLE_ASSERTS)
+	{
+		WAVM_ASSERT(isInCompartment(asObject(function), context->compartment));
+		FunctionType functionType{function->encodedType};
+		for(Uptr argumentIndex = 0; argumentIndex < functionType.params().size(); ++argumentIndex)
+		{
+			const ValueType argType = functionType.params()[argumentIndex];
+			const UntaggedValue& arg = arguments[argumentIndex];
+			WAVM_ASSERT(!isReferenceType(argType) || !arg.object
+						|| isInCompartment(arg.object, context->compartment));
+		}
+	}
+
+	// Pass the captured variables to unwindSignalsAsExceptions as a single pointer, so calling it
+	// doesn't need a std::function that might heap allocate the captures.
 	struct InvokeContext
 	{
 		Context* context;
@@ -82,17 +162,114 @@ void Runtime::invokeFunction(Context* context,
 	invokeContext.function = function;
 	invokeContext.arguments = arguments;
 	invokeContext.outResults = outResults;
-	invokeContext.invokeThunk = invokeThunk;
+	invokeContext.invokeThunk
+		= reinterpret_cast<InvokeThunkPointer>(const_cast<void*>(invokeThunk));
+
+	ContextTimeScope contextTimeScope(context);
+	StackLimitScope stackLimitScope(getContextRuntimeData(context));
+	ProtectionKeyScope protectionKeyScope(context->compartment);
 
 	// Use unwindSignalsAsExceptions to ensure that any signal that occurs in WebAssembly code calls
 	// C++ destructors on the stack between here and where it is caught.
-	unwindSignalsAsExceptions([&invokeContext] {
-		ContextRuntimeData* contextRuntimeData = getContextRuntimeData(invokeContext.context);
-
-		// Call the invoke thunk.
-		(*invokeContext.invokeThunk)(invokeContext.function,
-									 contextRuntimeData,
-									 invokeContext.arguments,
-									 invokeContext.outResults);
-	});
+	unwindSignalsAsExceptions(
+		[](void* invokeContextVoid) {
+			const InvokeContext& invokeContext = *(const InvokeContext*)invokeContextVoid;
+			ContextRuntimeData* contextRuntimeData = getContextRuntimeData(invokeContext.context);
+
+			// Call the invoke thunk.
+			(*invokeContext.invokeThunk)(invokeContext.function,
+										 contextRuntimeData,
+										 invokeContext.arguments,
+										 invokeContext.outResults);
+		},
+		&invokeContext);
+}
+
+void Runtime::invokeFunction(Context* context,
+							 const Function* function,
+							 FunctionType invokeSig,
+							 const UntaggedValue arguments[],
+							 UntaggedValue outResults[])
+{
+	const void* invokeThunk = getInvokeThunk(function, invokeSig);
+	if(!invokeThunk) { throwException(ExceptionTypes::invokeSignatureMismatch); }
+
+	invokeFunctionWithThunk(context, function, invokeThunk, arguments, outResults);
+}
+
+Uptr Runtime::invokeFunctionBatch(Context* context,
+								  const Function* function,
+								  FunctionType invokeSig,
+								  Uptr numInvokes,
+								  const UntaggedValue arguments[],
+								  UntaggedValue outResults[],
+								  Exception** outException)
+{
+	if(outException) { *outException = nullptr; }
+
+	const void* invokeThunk = getInvokeThunk(function, invokeSig);
+	if(!invokeThunk) { throwException(ExceptionTypes::invokeSignatureMismatch); }
+	WAVM_ASSERT(isInCompartment(asObject(function), context->compartment));
+
+	// Pass the captured variables to unwindSignalsAsExceptions as a single pointer (see
+	// invokeFunctionWithThunk).
+	struct BatchContext
+	{
+		Context* context;
+		const Function* function;
+		InvokeThunkPointer invokeThunk;
+		const UntaggedValue* arguments;
+		UntaggedValue* outResults;
+		Uptr numParams;
+		Uptr numResults;
+		Uptr numInvokes;
+		Uptr numCompletedInvokes;
+	};
+	BatchContext batchContext;
+	batchContext.context = context;
+	batchContext.function = function;
+	batchContext.invokeThunk
+		= reinterpret_cast<InvokeThunkPointer>(const_cast<void*>(invokeThunk));
+	batchContext.arguments = arguments;
+	batchContext.outResults = outResults;
+	batchContext.numParams = invokeSig.params().size();
+	batchContext.numResults = invokeSig.results().size();
+	batchContext.numInvokes = numInvokes;
+	batchContext.numCompletedInvokes = 0;
+
+	ContextTimeScope contextTimeScope(context);
+	StackLimitScope stackLimitScope(getContextRuntimeData(context));
+	ProtectionKeyScope protectionKeyScope(context->compartment);
+
+	// Catch runtime exceptions and signals once for the whole batch, rather than for each call.
+	try
+	{
+		unwindSignalsAsExceptions(
+			[](void* batchContextVoid) {
+				BatchContext& batchContext = *(BatchContext*)batchContextVoid;
+				ContextRuntimeData* contextRuntimeData
+					= getContextRuntimeData(batchContext.context);
+				while(batchContext.numCompletedInvokes < batchContext.numInvokes)
+				{
+					const Uptr invokeIndex = batchContext.numCompletedInvokes;
+					(*batchContext.invokeThunk)(
+						batchContext.function,
+						contextRuntimeData,
+						batchContext.arguments + invokeIndex * batchContext.numParams,
+						batchContext.outResults + invokeIndex * batchContext.numResults);
+					++batchContext.numCompletedInvokes;
+				}
+			},
+			&batchContext);
+	}
+	catch(Exception* exception)
+	{
+		if(outException) { *outException = exception; }
+		else
+		{
+			destroyException(exception);
+		}
+	}
+
+	return batchContext.numCompletedInvokes;
 }
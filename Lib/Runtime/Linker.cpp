@@ -3,7 +3,9 @@
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Runtime.h"
 
 using namespace WAVM;
@@ -39,6 +41,104 @@ bool Runtime::StubResolver::resolve(const std::string& moduleName,
 		moduleName, exportName, type, outObject, compartment, functionBehavior, resourceQuota);
 }
 
+namespace {
+	struct StubModuleKey
+	{
+		FunctionType type;
+		StubFunctionBehavior functionBehavior;
+
+		friend bool operator==(const StubModuleKey& left, const StubModuleKey& right)
+		{
+			return left.type == right.type && left.functionBehavior == right.functionBehavior;
+		}
+	};
+}
+
+namespace WAVM {
+	template<> struct Hash<StubModuleKey>
+	{
+		Uptr operator()(const StubModuleKey& key, Uptr seed = 0) const
+		{
+			Uptr hash = Hash<FunctionType>()(key.type, seed);
+			return Hash<Uptr>()(Uptr(key.functionBehavior), hash);
+		}
+	};
+}
+
+// Returns the compiled module for a stub function with the given type and behavior. The modules
+// don't depend on the compartment or the import being stubbed, so they are compiled once per
+// process and cached, and generating a stub function just instantiates the cached module.
+static ModuleConstRef getStubModule(FunctionType type, StubFunctionBehavior functionBehavior)
+{
+	static Platform::Mutex stubModulesMutex;
+	static HashMap<StubModuleKey, ModuleConstRef> stubModules;
+
+	Platform::Mutex::Lock stubModulesLock(stubModulesMutex);
+	const StubModuleKey key{type, functionBehavior};
+	if(const ModuleConstRef* cachedStubModule = stubModules.get(key)) { return *cachedStubModule; }
+
+	Serialization::ArrayOutputStream codeStream;
+	OperatorEncoderStream encoder(codeStream);
+	if(functionBehavior == StubFunctionBehavior::trap)
+	{
+		// Generate a function body that just uses the unreachable op to fault if called.
+		encoder.unreachable();
+	}
+	else
+	{
+		// Generate a function body that just returns some reasonable zero value.
+		for(IR::ValueType result : type.results())
+		{
+			switch(result)
+			{
+			case IR::ValueType::i32: encoder.i32_const({0}); break;
+			case IR::ValueType::i64: encoder.i64_const({0}); break;
+			case IR::ValueType::f32: encoder.f32_const({0.0f}); break;
+			case IR::ValueType::f64: encoder.f64_const({0.0}); break;
+			case IR::ValueType::v128: encoder.v128_const({V128{{0, 0}}}); break;
+			case IR::ValueType::externref:
+				encoder.ref_null({IR::ReferenceType::externref});
+				break;
+			case IR::ValueType::funcref: encoder.ref_null({IR::ReferenceType::funcref}); break;
+
+			case IR::ValueType::none:
+			case IR::ValueType::any:
+			default: WAVM_UNREACHABLE();
+			};
+		}
+	}
+	encoder.end();
+
+	// Generate a module for the stub function.
+	IR::Module stubIRModule(FeatureLevel::wavm);
+	DisassemblyNames stubModuleNames;
+	stubIRModule.types.push_back(type);
+	stubIRModule.functions.defs.push_back({{0}, {}, std::move(codeStream.getBytes()), {}});
+	stubIRModule.exports.push_back({"importStub", IR::ExternKind::function, 0});
+	stubModuleNames.functions.push_back({"importStub (" + asString(type) + ")"});
+	IR::setDisassemblyNames(stubIRModule, stubModuleNames);
+
+	if(WAVM_ENABLE_ASSERTS)
+	{
+		try
+		{
+			std::shared_ptr<IR::ModuleValidationState> moduleValidationState
+				= IR::createModuleValidationState(stubIRModule);
+			IR::validatePreCodeSections(*moduleValidationState);
+			IR::validateCodeSection(*moduleValidationState);
+			IR::validatePostCodeSections(*moduleValidationState);
+		}
+		catch(const ValidationException& exception)
+		{
+			Errors::fatalf("Stub module failed validation: %s", exception.message.c_str());
+		}
+	}
+
+	ModuleConstRef stubModule = compileModule(stubIRModule);
+	stubModules.add(key, stubModule);
+	return stubModule;
+}
+
 bool Runtime::generateStub(const std::string& moduleName,
 						   const std::string& exportName,
 						   IR::ExternType type,
@@ -51,68 +151,10 @@ bool Runtime::generateStub(const std::string& moduleName,
 	switch(type.kind)
 	{
 	case IR::ExternKind::function: {
-		Serialization::ArrayOutputStream codeStream;
-		OperatorEncoderStream encoder(codeStream);
-		if(functionBehavior == StubFunctionBehavior::trap)
-		{
-			// Generate a function body that just uses the unreachable op to fault if called.
-			encoder.unreachable();
-		}
-		else
-		{
-			// Generate a function body that just returns some reasonable zero value.
-			for(IR::ValueType result : asFunctionType(type).results())
-			{
-				switch(result)
-				{
-				case IR::ValueType::i32: encoder.i32_const({0}); break;
-				case IR::ValueType::i64: encoder.i64_const({0}); break;
-				case IR::ValueType::f32: encoder.f32_const({0.0f}); break;
-				case IR::ValueType::f64: encoder.f64_const({0.0}); break;
-				case IR::ValueType::v128: encoder.v128_const({V128{{0, 0}}}); break;
-				case IR::ValueType::externref:
-					encoder.ref_null({IR::ReferenceType::externref});
-					break;
-				case IR::ValueType::funcref: encoder.ref_null({IR::ReferenceType::funcref}); break;
-
-				case IR::ValueType::none:
-				case IR::ValueType::any:
-				default: WAVM_UNREACHABLE();
-				};
-			}
-		}
-		encoder.end();
-
-		// Generate a module for the stub function.
-		IR::Module stubIRModule(FeatureLevel::wavm);
-		DisassemblyNames stubModuleNames;
-		stubIRModule.types.push_back(asFunctionType(type));
-		stubIRModule.functions.defs.push_back({{0}, {}, std::move(codeStream.getBytes()), {}});
-		stubIRModule.exports.push_back({"importStub", IR::ExternKind::function, 0});
-		stubModuleNames.functions.push_back(
-			{"importStub: " + exportName + " (" + asString(asFunctionType(type)) + ")"});
-		IR::setDisassemblyNames(stubIRModule, stubModuleNames);
-
-		if(WAVM_ENABLE_ASSERTS)
-		{
-			try
-			{
-				std::shared_ptr<IR::ModuleValidationState> moduleValidationState
-					= IR::createModuleValidationState(stubIRModule);
-				IR::validatePreCodeSections(*moduleValidationState);
-				IR::validateCodeSection(*moduleValidationState);
-				IR::validatePostCodeSections(*moduleValidationState);
-			}
-			catch(const ValidationException& exception)
-			{
-				Errors::fatalf("Stub module failed validation: %s", exception.message.c_str());
-			}
-		}
-
-		// Instantiate the module and return the stub function instance.
-		auto stubModule = compileModule(stubIRModule);
-		auto stubInstance
-			= instantiateModule(compartment, stubModule, {}, "importStub", resourceQuota);
+		// Instantiate the compiled stub module and return the stub function instance.
+		ModuleConstRef stubModule = getStubModule(asFunctionType(type), functionBehavior);
+		auto stubInstance = instantiateModule(
+			compartment, stubModule, {}, "importStub: " + exportName, resourceQuota);
 		if(!stubInstance) { return false; }
 		outObject = getInstanceExport(stubInstance, "importStub");
 		WAVM_ASSERT(outObject);
@@ -216,3 +258,28 @@ LinkResult Runtime::linkModule(const IR::Module& module, Resolver& resolver)
 	linkResult.success = linkResult.missingImports.size() == 0;
 	return linkResult;
 }
+
+LinkResult Runtime::linkModule(const IR::Module& module, Resolver& resolver, LinkPlan& plan)
+{
+	if(plan.resolver == &resolver && plan.resolverLinkPlanEpoch == resolver.getLinkPlanEpoch())
+	{
+		WAVM_ASSERT(plan.resolvedImports.size() == module.imports.size());
+
+		LinkResult linkResult;
+		linkResult.resolvedImports.reserve(plan.resolvedImports.size());
+		for(const GCPointer<Object>& object : plan.resolvedImports)
+		{ linkResult.resolvedImports.push_back(object); }
+		linkResult.success = true;
+		return linkResult;
+	}
+
+	LinkResult linkResult = linkModule(module, resolver);
+	if(linkResult.success)
+	{
+		plan.resolver = &resolver;
+		plan.resolverLinkPlanEpoch = resolver.getLinkPlanEpoch();
+		plan.resolvedImports.assign(linkResult.resolvedImports.begin(),
+									linkResult.resolvedImports.end());
+	}
+	return linkResult;
+}
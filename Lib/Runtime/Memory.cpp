@@ -4,12 +4,16 @@
 #include <atomic>
 #include <memory>
 #include <vector>
+#include "AddressRangeIndex.h"
 #include "RuntimePrivate.h"
 #include "WAVM/IR/IR.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/Assert.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Logging/Trace.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
@@ -22,9 +26,9 @@ namespace WAVM { namespace Runtime {
 	WAVM_DEFINE_INTRINSIC_MODULE(wavmIntrinsicsMemory)
 }}
 
-// Global lists of memories; used to query whether an address is reserved by one of them.
-static Platform::RWMutex memoriesMutex;
-static std::vector<Memory*> memories;
+// Global index of the memories' reserved address spaces, including their guard pages; used to query
+// whether an address is reserved by one of them.
+static AddressRangeIndex<Memory> memoryAddressRanges;
 
 static constexpr U64 maxMemory64WASMPages =
 #if WAVM_ENABLE_TSAN
@@ -39,13 +43,36 @@ static Uptr getPlatformPagesPerWebAssemblyPageLog2()
 	return IR::numBytesPerPageLog2 - Platform::getBytesPerPageLog2();
 }
 
+// Returns the maximum number of pages of a memory allocated from a pool. If the pool uses
+// protection keys, a memory can't grow past the start of the next slot.
+static Uptr getPooledMemoryMaxPages(const MemoryPool& memoryPool)
+{
+	return std::min(Uptr(IR::maxMemory32Pages),
+					memoryPool.numBytesPerSlot >> IR::numBytesPerPageLog2);
+}
+
+// Tags a range of a pooled memory's pages with its protection key again after decommitting or
+// remapping them, which resets them to the default key that all code may access.
+static void restoreMemoryProtectionKey(Memory* memory,
+									   U8* baseAddress,
+									   Uptr numPlatformPages,
+									   Platform::MemoryAccess access)
+{
+	if(memory->protectionKey >= 0
+	   && !Platform::setVirtualPagesProtectionKey(
+		   baseAddress, numPlatformPages, access, memory->protectionKey))
+	{ Errors::fatalf("Failed to set the protection key of pooled memory pages"); }
+}
+
 static Memory* createMemoryImpl(Compartment* compartment,
 								IR::MemoryType type,
 								Uptr numPages,
 								std::string&& debugName,
-								ResourceQuotaRefParam resourceQuota)
+								ResourceQuotaRefParam resourceQuota,
+								bool prefault)
 {
 	Memory* memory = new Memory(compartment, type, std::move(debugName), resourceQuota);
+	memory->prefault = prefault;
 
 	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
 
@@ -57,19 +84,62 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		// For 32-bit memories on a 64-bit runtime, allocate 8GB of address space for the memory.
 		// This allows eliding bounds checks on memory accesses, since a 32-bit index + 32-bit
 		// offset will always be within the reserved address-space.
-		memoryMaxPages = (Uptr(8) * 1024 * 1024 * 1024) >> pageBytesLog2;
+		memoryMaxPages = memory32NumReservedBytes >> pageBytesLog2;
+	}
+	else if(type.size.max <= memory64NumClampedBytes / IR::numBytesPerPage)
+	{
+		// Reserve the same address space for 64-bit memories with a small maximum size, so the
+		// addresses the generated code clamps to memory64NumClampedBytes, plus an offset that is
+		// smaller than the guard region, are always within the reserved address space.
+		static_assert(memory64NumClampedBytes + memoryNumGuardBytes <= memory32NumReservedBytes,
+					  "clamped memory64 addresses must be within the reserved address space");
+		memoryMaxPages = memory32NumReservedBytes >> pageBytesLog2;
 	}
 	else
 	{
 		// Clamp the maximum size of 64-bit memories to maxMemory64Bytes.
 		memoryMaxPages = std::min(type.size.max, maxMemory64WASMPages);
 
+		// Memories that can move only reserve enough address space for their initial size, or
+		// memory64NumInitialReservedBytes, and are moved to a larger reservation if they grow past
+		// it. Otherwise, an unbounded memory would reserve 1TB of address space up front.
+		if(isMovableMemoryType(type))
+		{
+			const Uptr initialReservedPages
+				= Uptr(memory64NumInitialReservedBytes / IR::numBytesPerPage);
+			memoryMaxPages = std::min(memoryMaxPages, std::max(numPages, initialReservedPages));
+		}
+
 		// Convert maxMemoryPages from fixed size WASM pages (64KB) to platform-specific pages.
 		memoryMaxPages <<= getPlatformPagesPerWebAssemblyPageLog2();
 	}
 
-	const Uptr numGuardPages = memoryNumGuardBytes >> pageBytesLog2;
-	memory->baseAddress = Platform::allocateVirtualPages(memoryMaxPages + numGuardPages);
+	// If the compartment has a memory pool, try to use one of its slots for a 32-bit memory.
+	if(type.indexType == IR::IndexType::i32)
+	{
+		Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
+		if(compartment->memoryPool && numPages <= getPooledMemoryMaxPages(*compartment->memoryPool))
+		{
+			memory->baseAddress = compartment->memoryPool->allocateSlot(
+				compartment->memoryPoolStripeIndex, memory->memoryPoolSlotIndex);
+			if(memory->baseAddress)
+			{
+				memory->memoryPool = compartment->memoryPool;
+				memory->protectionKey = compartment->memoryProtectionKey;
+			}
+		}
+	}
+
+	if(!memory->baseAddress)
+	{
+		// Align the memory's address space so it can be backed by huge pages if they are enabled.
+		const Uptr numGuardPages = memoryNumGuardBytes >> pageBytesLog2;
+		memory->baseAddressAlignmentLog2 = Platform::getHugePageAlignmentLog2(memoryMaxPages);
+		memory->baseAddress = Platform::allocateAlignedVirtualPages(
+			memoryMaxPages + numGuardPages,
+			memory->baseAddressAlignmentLog2,
+			memory->unalignedBaseAddress);
+	}
 	memory->numReservedBytes = memoryMaxPages << pageBytesLog2;
 	if(!memory->baseAddress)
 	{
@@ -77,6 +147,20 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
+	// Prefer the compartment's NUMA node for the memory's pages. A pool slot may still have the
+	// policy of the memory that used it before, so reset it even if the compartment has no node.
+	// The reserved address space of a memory in a pool that uses protection keys overlaps other
+	// slots, so only the pages in its own slot are changed.
+	if(compartment->layout.numaNode != UINTPTR_MAX || memory->memoryPool)
+	{
+		const Uptr numNUMAPages
+			= memory->memoryPool
+				  ? std::min(memoryMaxPages, memory->memoryPool->numBytesPerSlot >> pageBytesLog2)
+				  : memoryMaxPages;
+		Platform::setVirtualPagesNUMANode(
+			memory->baseAddress, numNUMAPages, compartment->layout.numaNode);
+	}
+
 	// Grow the memory to the type's minimum size.
 	if(growMemory(memory, numPages) != GrowResult::success)
 	{
@@ -84,11 +168,15 @@ static Memory* createMemoryImpl(Compartment* compartment,
 		return nullptr;
 	}
 
-	// Add the memory to the global array.
-	{
-		Platform::RWMutex::ExclusiveLock memoriesLock(memoriesMutex);
-		memories.push_back(memory);
-	}
+	// Add the memory to the global index. The reserved address space of a memory in a pool that
+	// uses protection keys overlaps the slots of other stripes, so only its own slot is added, and
+	// faults in the rest of its reservation are attributed to it by isAddressOwnedByMemory.
+	const bool isStriped = memory->memoryPool && memory->memoryPool->numStripes > 1;
+	memoryAddressRanges.add(memory->baseAddress,
+							memory->baseAddress
+								+ (isStriped ? memory->memoryPool->numBytesPerSlot
+											 : memory->numReservedBytes + memoryNumGuardBytes),
+							memory);
 
 	return memory;
 }
@@ -99,13 +187,15 @@ Memory* Runtime::createMemory(Compartment* compartment,
 							  ResourceQuotaRefParam resourceQuota)
 {
 	WAVM_ASSERT(type.size.min <= UINTPTR_MAX);
+	const bool prefault
+		= resourceQuota && resourceQuota->prefaultMemories.load(std::memory_order_relaxed);
 	Memory* memory = createMemoryImpl(
-		compartment, type, Uptr(type.size.min), std::move(debugName), resourceQuota);
+		compartment, type, Uptr(type.size.min), std::move(debugName), resourceQuota, prefault);
 	if(!memory) { return nullptr; }
 
 	// Add the memory to the compartment's memories IndexMap.
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 
 		memory->id = compartment->memories.add(UINTPTR_MAX, memory);
 		if(memory->id == UINTPTR_MAX)
@@ -113,6 +203,7 @@ Memory* Runtime::createMemory(Compartment* compartment,
 			delete memory;
 			return nullptr;
 		}
+		addYoungObject(memory);
 		MemoryRuntimeData& runtimeData = compartment->runtimeData->memories[memory->id];
 		runtimeData.base = memory->baseAddress;
 		runtimeData.endAddress = memory->numReservedBytes;
@@ -123,24 +214,94 @@ Memory* Runtime::createMemory(Compartment* compartment,
 	return memory;
 }
 
+// Makes memory->snapshot a snapshot of the first numPages of a memory that the pages are mapped
+// copy-on-write to. Returns false if the platform doesn't support it.
+static bool snapshotMemoryPages(Memory* memory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+
+	// Other threads might write a shared memory while its pages are being remapped to the
+	// snapshot, so only unshared memories are snapshotted.
+	if(memory->type.isShared) { return false; }
+
+	// Snapshots must be created from read-write pages, and remapping the memory's pages to one
+	// would also stop them from sharing the page cache with the files mapped into them.
+	if(memory->hasMappedFiles) { return false; }
+
+	// Reuse the memory's snapshot if it covers the same pages, and the memory hasn't written
+	// any of them since they were mapped to it. Otherwise, take a new snapshot of the memory.
+	const Uptr numPlatformPages = numPages << getPlatformPagesPerWebAssemblyPageLog2();
+	if(!memory->snapshot
+	   || Platform::getPageSnapshotNumPages(memory->snapshot.get()) != numPlatformPages
+	   || Platform::mayPageSnapshotMappingHaveChanged(memory->snapshot.get(), memory->baseAddress))
+	{
+		memory->snapshot.reset();
+		Platform::PageSnapshot* snapshot
+			= Platform::createPageSnapshot(memory->baseAddress, numPlatformPages);
+		if(!snapshot) { return false; }
+		memory->snapshot
+			= std::shared_ptr<Platform::PageSnapshot>(snapshot, &Platform::destroyPageSnapshot);
+		memory->hasMappedSnapshots = true;
+		restoreMemoryProtectionKey(
+			memory, memory->baseAddress, numPlatformPages, Platform::MemoryAccess::readWrite);
+	}
+	return true;
+}
+
+// Maps the first numPages of a memory copy-on-write into another memory, so the pages are only
+// copied when one of the memories writes them, or when the new memory first accesses them if the
+// compartment has lazy memory clones. Returns false if the platform doesn't support it.
+static bool shareMemoryPagesCopyOnWrite(Memory* memory, Memory* newMemory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+	if(!snapshotMemoryPages(memory, numPages)) { return false; }
+
+	const Uptr numPlatformPages = numPages << getPlatformPagesPerWebAssemblyPageLog2();
+	if(memory->compartment->lazyMemoryClones.load(std::memory_order_relaxed))
+	{
+		newMemory->lazyPageMapping = Platform::mapPageSnapshotLazily(
+			memory->snapshot.get(), newMemory->baseAddress, memory->clonePrefetchPageIndices);
+	}
+	if(!newMemory->lazyPageMapping
+	   && !Platform::mapPageSnapshot(memory->snapshot.get(), newMemory->baseAddress))
+	{
+		// The pages may have been remapped before the failure, and are copied instead.
+		restoreMemoryProtectionKey(
+			newMemory, newMemory->baseAddress, numPlatformPages, Platform::MemoryAccess::readWrite);
+		return false;
+	}
+	restoreMemoryProtectionKey(
+		newMemory, newMemory->baseAddress, numPlatformPages, Platform::MemoryAccess::readWrite);
+	newMemory->snapshot = memory->snapshot;
+	newMemory->hasMappedSnapshots = true;
+	return true;
+}
+
 Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 {
 	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
 	const Uptr numPages = memory->numPages.load(std::memory_order_acquire);
 	std::string debugName = memory->debugName;
 	Memory* newMemory = createMemoryImpl(
-		newCompartment, memory->type, numPages, std::move(debugName), memory->resourceQuota);
+		newCompartment, memory->type, numPages, std::move(debugName), memory->resourceQuota, false);
 	if(!newMemory) { return nullptr; }
+	newMemory->clonePrefetchPageIndices = memory->clonePrefetchPageIndices;
 
-	// Copy the memory contents to the new memory.
-	memcpy(newMemory->baseAddress, memory->baseAddress, numPages * IR::numBytesPerPage);
+	// The clone's initial pages are shared with or copied from the original memory, so only the
+	// pages it grows by later are prefaulted.
+	newMemory->prefault = memory->prefault;
+
+	// Share the memory contents with the new memory copy-on-write if possible, and otherwise copy
+	// them to the new memory.
+	if(numPages && !shareMemoryPagesCopyOnWrite(memory, newMemory, numPages))
+	{ memcpy(newMemory->baseAddress, memory->baseAddress, numPages * IR::numBytesPerPage); }
 
 	resizingLock.unlock();
 
 	// Insert the memory in the new compartment's memories array with the same index as it had in
 	// the original compartment's memories IndexMap.
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 
 		newMemory->id = memory->id;
 		newCompartment->memories.insertOrFail(newMemory->id, newMemory);
@@ -156,6 +317,9 @@ Memory* Runtime::cloneMemory(Memory* memory, Compartment* newCompartment)
 
 Runtime::Memory::~Memory()
 {
+	if(hasBackgroundPrefaults.load(std::memory_order_acquire))
+	{ cancelBackgroundMemoryPrefaults(this); }
+
 	if(id != UINTPTR_MAX)
 	{
 		WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
@@ -170,28 +334,21 @@ Runtime::Memory::~Memory()
 		runtimeData.endAddress = 0;
 	}
 
-	// Remove the memory from the global array.
-	{
-		Platform::RWMutex::ExclusiveLock memoriesLock(memoriesMutex);
-		for(Uptr memoryIndex = 0; memoryIndex < memories.size(); ++memoryIndex)
-		{
-			if(memories[memoryIndex] == this)
-			{
-				memories.erase(memories.begin() + memoryIndex);
-				break;
-			}
-		}
-	}
+	// Remove the memory from the global index.
+	memoryAddressRanges.remove(this);
+
+	if(lazyPageMapping) { Platform::destroyLazyPageMapping(lazyPageMapping); }
 
-	// Free the virtual address space.
+	// Free the virtual address space, or return it to the pool it was allocated from.
 	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
-	if(numReservedBytes > 0)
+	if(memoryPool) { memoryPool->freeSlot(memoryPoolSlotIndex, numPages * IR::numBytesPerPage); }
+	else if(numReservedBytes > 0)
 	{
-		Platform::freeVirtualPages(baseAddress,
-								   (numReservedBytes + memoryNumGuardBytes) >> pageBytesLog2);
-
-		Platform::deregisterVirtualAllocation(numPages >> pageBytesLog2);
+		Platform::freeAlignedVirtualPages(unalignedBaseAddress,
+										  (numReservedBytes + memoryNumGuardBytes) >> pageBytesLog2,
+										  baseAddressAlignmentLog2);
 	}
+	deregisterCommit(compartment, CommitKind::memory, numCommittedBytes);
 
 	// Free the allocated quota.
 	if(resourceQuota) { resourceQuota->memoryPages.free(numPages); }
@@ -199,21 +356,53 @@ Runtime::Memory::~Memory()
 
 bool Runtime::isAddressOwnedByMemory(U8* address, Memory*& outMemory, Uptr& outMemoryAddress)
 {
-	// Iterate over all memories and check if the address is within the reserved address space for
-	// each.
-	Platform::RWMutex::ShareableLock memoriesLock(memoriesMutex);
-	for(auto memory : memories)
+	// This is called by the signal handler, so it must not lock or allocate.
+	U8* startAddress = nullptr;
+	const bool isInSlot = memoryAddressRanges.find(address, outMemory, startAddress);
+	if(isInSlot && outMemory->protectionKey == currentMemoryProtectionKey)
 	{
-		U8* startAddress = memory->baseAddress;
-		U8* endAddress = memory->baseAddress + memory->numReservedBytes + memoryNumGuardBytes;
-		if(address >= startAddress && address < endAddress)
+		outMemoryAddress = address - startAddress;
+		return true;
+	}
+
+	// In a pool that uses protection keys, the address may be in the reservation of a memory in
+	// one of the (numStripes - 1) slots before the slot it is in. An access from code running in
+	// a compartment faults in the reservation of the compartment's memory, which is the one in
+	// the stripe the thread is running code for.
+	MemoryPool* memoryPool = nullptr;
+	if(findStripedMemoryPool(address, memoryPool))
+	{
+		const Uptr addressSlotIndex
+			= Uptr(address - memoryPool->baseAddress) / memoryPool->numBytesPerSlot;
+		for(Uptr slotOffset = 0;
+			slotOffset < memoryPool->numStripes && slotOffset <= addressSlotIndex;
+			++slotOffset)
 		{
-			outMemory = memory;
-			outMemoryAddress = address - startAddress;
-			return true;
+			const Uptr slotIndex = addressSlotIndex - slotOffset;
+			if(currentMemoryProtectionKey >= 0
+			   && memoryPool->getStripeProtectionKey(slotIndex % memoryPool->numStripes)
+					  != currentMemoryProtectionKey)
+			{ continue; }
+
+			Memory* slotMemory = nullptr;
+			U8* slotAddress = memoryPool->baseAddress + slotIndex * memoryPool->numBytesPerSlot;
+			U8* slotMemoryStartAddress = nullptr;
+			if(slotIndex < memoryPool->numSlots
+			   && memoryAddressRanges.find(slotAddress, slotMemory, slotMemoryStartAddress)
+			   && address < slotMemoryStartAddress + slotMemory->numReservedBytes
+								+ memoryNumGuardBytes)
+			{
+				outMemory = slotMemory;
+				outMemoryAddress = address - slotMemoryStartAddress;
+				return true;
+			}
 		}
 	}
-	return false;
+
+	// Otherwise, attribute the address to the memory whose slot it is in.
+	if(!isInSlot) { return false; }
+	outMemoryAddress = address - startAddress;
+	return true;
 }
 
 Uptr Runtime::getMemoryNumPages(const Memory* memory)
@@ -222,16 +411,106 @@ Uptr Runtime::getMemoryNumPages(const Memory* memory)
 }
 IR::MemoryType Runtime::getMemoryType(const Memory* memory) { return memory->type; }
 
+static Metrics::Counter& numMemoryGrows
+	= Metrics::getCounter("wavm_memory_grows_total", "Calls to memory.grow that add pages");
+static Metrics::Counter& numMemoryGrowPages
+	= Metrics::getCounter("wavm_memory_grow_pages_total", "Pages added to memories by memory.grow");
+
+static Metrics::Counter& numMemoryMoves
+	= Metrics::getCounter("wavm_memory_moves_total",
+						  "Memories moved to a larger reservation by memory.grow");
+
+// Moves a memory to a new reservation of address space that is large enough for numPages, and
+// updates the base address the generated code loads. Returns false if the memory has pages that
+// can't be moved, or the new reservation couldn't be allocated, in which case the memory is
+// unchanged.
+static bool moveMemory(Memory* memory, Uptr numPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+	WAVM_ASSERT(isMovableMemoryType(memory->type) && !memory->memoryPool);
+
+	// Pages that are mapped to a file, copied lazily from a snapshot, or unmapped by
+	// unmapMemoryPages can't be moved or copied to the new reservation.
+	const Uptr oldNumPages = memory->numPages.load(std::memory_order_acquire);
+	const Uptr oldNumBytes = oldNumPages * IR::numBytesPerPage;
+	if(memory->hasMappedFiles || memory->lazyPageMapping
+	   || memory->numCommittedBytes.load(std::memory_order_relaxed) != oldNumBytes)
+	{ return false; }
+
+	// Reserve at least twice the address space the memory had, so a memory that grows repeatedly
+	// is only moved a logarithmic number of times.
+	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+	const U64 maxNumPages = std::min(memory->type.size.max, maxMemory64WASMPages);
+	const U64 oldNumReservedPages = memory->numReservedBytes / IR::numBytesPerPage;
+	const U64 numReservedPages
+		= std::min(maxNumPages, std::max(U64(numPages), oldNumReservedPages * 2));
+	const Uptr numReservedPlatformPages = Uptr(numReservedPages)
+										  << getPlatformPagesPerWebAssemblyPageLog2();
+	const Uptr numGuardPages = memoryNumGuardBytes >> pageBytesLog2;
+
+	U8* unalignedBaseAddress = nullptr;
+	const Uptr baseAddressAlignmentLog2
+		= Platform::getHugePageAlignmentLog2(numReservedPlatformPages);
+	U8* baseAddress = Platform::allocateAlignedVirtualPages(
+		numReservedPlatformPages + numGuardPages, baseAddressAlignmentLog2, unalignedBaseAddress);
+	if(!baseAddress) { return false; }
+	if(memory->compartment->layout.numaNode != UINTPTR_MAX)
+	{
+		Platform::setVirtualPagesNUMANode(
+			baseAddress, numReservedPlatformPages, memory->compartment->layout.numaNode);
+	}
+
+	// Move the memory's pages to the new reservation if the platform can, and otherwise copy them.
+	const Uptr numPlatformPages = oldNumPages << getPlatformPagesPerWebAssemblyPageLog2();
+	if(numPlatformPages
+	   && !Platform::moveVirtualPages(baseAddress, memory->baseAddress, numPlatformPages))
+	{
+		if(!Platform::commitVirtualPages(baseAddress, numPlatformPages))
+		{
+			Platform::freeAlignedVirtualPages(unalignedBaseAddress,
+											  numReservedPlatformPages + numGuardPages,
+											  baseAddressAlignmentLog2);
+			return false;
+		}
+		memcpy(baseAddress, memory->baseAddress, oldNumBytes);
+	}
+
+	// The pages aren't mapped to the memory's snapshot at its old address anymore.
+	memory->snapshot.reset();
+
+	// Free the old reservation, and replace it in the global index.
+	memoryAddressRanges.remove(memory);
+	Platform::freeAlignedVirtualPages(memory->unalignedBaseAddress,
+									  (memory->numReservedBytes + memoryNumGuardBytes)
+										  >> pageBytesLog2,
+									  memory->baseAddressAlignmentLog2);
+	memory->baseAddress = baseAddress;
+	memory->unalignedBaseAddress = unalignedBaseAddress;
+	memory->baseAddressAlignmentLog2 = baseAddressAlignmentLog2;
+	memory->numReservedBytes = numReservedPlatformPages << pageBytesLog2;
+	memoryAddressRanges.add(memory->baseAddress,
+							memory->baseAddress + memory->numReservedBytes + memoryNumGuardBytes,
+							memory);
+
+	if(memory->id != UINTPTR_MAX)
+	{
+		MemoryRuntimeData& runtimeData = memory->compartment->runtimeData->memories[memory->id];
+		runtimeData.base = memory->baseAddress;
+		runtimeData.endAddress = memory->numReservedBytes;
+	}
+
+	numMemoryMoves.add();
+	return true;
+}
+
 GrowResult Runtime::growMemory(Memory* memory, Uptr numPagesToGrow, Uptr* outOldNumPages)
 {
+	Trace::Scope traceScope("runtime", "memory.grow");
+
 	Uptr oldNumPages;
 	if(numPagesToGrow == 0) { oldNumPages = memory->numPages.load(std::memory_order_seq_cst); }
 	else
 	{
-		// Check the memory page quota.
-		if(memory->resourceQuota && !memory->resourceQuota->memoryPages.allocate(numPagesToGrow))
-		{ return GrowResult::outOfQuota; }
-
 		Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
 		oldNumPages = memory->numPages.load(std::memory_order_acquire);
 
@@ -243,9 +522,29 @@ GrowResult Runtime::growMemory(Memory* memory, Uptr numPagesToGrow, Uptr* outOld
 		if(numPagesToGrow > memory->type.size.max
 		   || oldNumPages > memory->type.size.max - numPagesToGrow
 		   || numPagesToGrow > maxMemoryPages || oldNumPages > maxMemoryPages - numPagesToGrow)
+		{ return GrowResult::outOfMaxSize; }
+
+		// Memories in pools that use protection keys can't grow past the end of their slot.
+		if(memory->memoryPool)
+		{
+			const Uptr pooledMaxPages = getPooledMemoryMaxPages(*memory->memoryPool);
+			if(numPagesToGrow > pooledMaxPages || oldNumPages > pooledMaxPages - numPagesToGrow)
+			{ return GrowResult::outOfMemory; }
+		}
+
+		// Check the memory page quota. It's only charged once the size has been checked, so
+		// growing past the memory's maximum size doesn't need to return the quota.
+		if(memory->resourceQuota && !memory->resourceQuota->memoryPages.allocate(numPagesToGrow))
+		{ return GrowResult::outOfQuota; }
+
+		// If the memory's reserved address space is too small for the new pages, move it to a
+		// larger reservation.
+		const Uptr newNumPages = oldNumPages + numPagesToGrow;
+		if(newNumPages * IR::numBytesPerPage > memory->numReservedBytes
+		   && !moveMemory(memory, newNumPages))
 		{
 			if(memory->resourceQuota) { memory->resourceQuota->memoryPages.free(numPagesToGrow); }
-			return GrowResult::outOfMaxSize;
+			return GrowResult::outOfMemory;
 		}
 
 		// Try to commit the new pages, and return GrowResult::outOfMemory if the commit fails.
@@ -256,16 +555,36 @@ GrowResult Runtime::growMemory(Memory* memory, Uptr numPagesToGrow, Uptr* outOld
 			if(memory->resourceQuota) { memory->resourceQuota->memoryPages.free(numPagesToGrow); }
 			return GrowResult::outOfMemory;
 		}
-		Platform::registerVirtualAllocation(numPagesToGrow
-											<< getPlatformPagesPerWebAssemblyPageLog2());
+		memory->numCommittedBytes.fetch_add(numPagesToGrow * IR::numBytesPerPage,
+											std::memory_order_relaxed);
+		registerCommit(
+			memory->compartment, CommitKind::memory, numPagesToGrow * IR::numBytesPerPage);
+
+		// Populate the new pages if the memory is prefaulted. Small grows are populated before the
+		// pages are visible to the guest, and large grows on the background thread. Failing to
+		// populate the pages only means they will fault when they are first accessed.
+		if(memory->prefault)
+		{
+			const Uptr offset = oldNumPages * IR::numBytesPerPage;
+			const Uptr numBytes = numPagesToGrow * IR::numBytesPerPage;
+			if(numBytes >= memoryBackgroundPrefaultBytes)
+			{ prefaultMemoryInBackground(memory, offset, numBytes); }
+			else
+			{
+				Platform::populateVirtualPages(memory->baseAddress + offset,
+											   numBytes >> Platform::getBytesPerPageLog2());
+			}
+		}
 
-		const Uptr newNumPages = oldNumPages + numPagesToGrow;
 		memory->numPages.store(newNumPages, std::memory_order_release);
 		if(memory->id != UINTPTR_MAX)
 		{
 			memory->compartment->runtimeData->memories[memory->id].numPages.store(
 				newNumPages, std::memory_order_release);
 		}
+
+		numMemoryGrows.add();
+		numMemoryGrowPages.add(numPagesToGrow);
 	}
 
 	if(outOldNumPages) { *outOldNumPages = oldNumPages; }
@@ -277,11 +596,265 @@ void Runtime::unmapMemoryPages(Memory* memory, Uptr pageIndex, Uptr numPages)
 	WAVM_ASSERT(pageIndex + numPages > pageIndex);
 	WAVM_ASSERT((pageIndex + numPages) * IR::numBytesPerPage <= memory->numReservedBytes);
 
-	// Decommit the pages.
-	Platform::decommitVirtualPages(memory->baseAddress + pageIndex * IR::numBytesPerPage,
-								   numPages << getPlatformPagesPerWebAssemblyPageLog2());
+	// Decommitted pages aren't mapped to the memory's snapshot anymore.
+	{
+		Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+		memory->snapshot.reset();
+	}
+
+	// Decommit the pages, which resets their NUMA policy and protection key.
+	U8* baseAddress = memory->baseAddress + pageIndex * IR::numBytesPerPage;
+	const Uptr numPlatformPages = numPages << getPlatformPagesPerWebAssemblyPageLog2();
+	Platform::decommitVirtualPages(baseAddress, numPlatformPages);
+	restoreMemoryProtectionKey(memory, baseAddress, numPlatformPages, Platform::MemoryAccess::none);
+	if(memory->compartment->layout.numaNode != UINTPTR_MAX)
+	{
+		Platform::setVirtualPagesNUMANode(
+			baseAddress, numPlatformPages, memory->compartment->layout.numaNode);
+	}
+
+	memory->numCommittedBytes.fetch_sub(numPages * IR::numBytesPerPage, std::memory_order_relaxed);
+	deregisterCommit(memory->compartment, CommitKind::memory, numPages * IR::numBytesPerPage);
+}
+
+// Validates that a range of a memory starts on a platform page and is inside the memory's current
+// size, and returns the number of platform pages that contain it.
+static bool getMemoryPlatformPageRange(Memory* memory,
+									   Uptr offset,
+									   Uptr numBytes,
+									   Uptr& outNumPlatformPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+
+	const Uptr numPlatformPageBytes = Platform::getBytesPerPage();
+	const Uptr numMemoryBytes
+		= memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage;
+	if(!numBytes || offset & (numPlatformPageBytes - 1) || offset > numMemoryBytes
+	   || numBytes > numMemoryBytes - offset)
+	{ return false; }
+
+	outNumPlatformPages = (numBytes + numPlatformPageBytes - 1) >> Platform::getBytesPerPageLog2();
+	return true;
+}
+
+bool Runtime::mapFileToMemory(Memory* memory,
+							  Uptr offset,
+							  Uptr numBytes,
+							  Uptr hostHandle,
+							  U64 fileOffset,
+							  bool copyOnWrite)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	Uptr numPlatformPages = 0;
+	if(!getMemoryPlatformPageRange(memory, offset, numBytes, numPlatformPages)) { return false; }
+	if(fileOffset & (Platform::getBytesPerPage() - 1)) { return false; }
+
+	// The mapped pages aren't mapped to the memory's snapshot anymore.
+	memory->snapshot.reset();
+	memory->hasMappedFiles = true;
+
+	// If mapping the file fails, the pages are replaced with zeroed read-write pages.
+	const bool result = Platform::mapFileVirtualPages(
+		memory->baseAddress + offset, numPlatformPages, hostHandle, fileOffset, copyOnWrite);
+	restoreMemoryProtectionKey(memory,
+							   memory->baseAddress + offset,
+							   numPlatformPages,
+							   result && !copyOnWrite ? Platform::MemoryAccess::readOnly
+													  : Platform::MemoryAccess::readWrite);
+	return result;
+}
+
+// Replaces a range of a memory's platform pages with zeroed read-write pages, releasing the
+// physical memory that was committed to them. The pages stay counted as committed.
+static void resetMemoryPlatformPages(Memory* memory, Uptr offset, Uptr numPlatformPages)
+{
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(memory->resizingMutex);
+
+	U8* baseAddress = memory->baseAddress + offset;
+	if(!memory->hasMappedFiles && !memory->hasMappedSnapshots)
+	{
+		// All the memory's pages are private anonymous pages, so they can be discarded in place.
+		Platform::discardVirtualPages(baseAddress, numPlatformPages);
+		return;
+	}
+
+	memory->snapshot.reset();
+
+	// Decommitting the pages replaces any mapping with zeroed pages, which are then made
+	// accessible again. Decommitting also resets their NUMA policy and protection key.
+	Platform::decommitVirtualPages(baseAddress, numPlatformPages);
+	if(!Platform::commitVirtualPages(baseAddress, numPlatformPages))
+	{ Errors::fatalf("Failed to recommit reset memory pages"); }
+	restoreMemoryProtectionKey(
+		memory, baseAddress, numPlatformPages, Platform::MemoryAccess::readWrite);
+	if(memory->compartment->layout.numaNode != UINTPTR_MAX)
+	{
+		Platform::setVirtualPagesNUMANode(
+			baseAddress, numPlatformPages, memory->compartment->layout.numaNode);
+	}
+}
+
+bool Runtime::resetMemoryPages(Memory* memory, Uptr offset, Uptr numBytes)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	Uptr numPlatformPages = 0;
+	if(!getMemoryPlatformPageRange(memory, offset, numBytes, numPlatformPages)) { return false; }
+
+	resetMemoryPlatformPages(memory, offset, numPlatformPages);
+	return true;
+}
+
+static Metrics::Counter& numMemoryResetBytes
+	= Metrics::getCounter("wavm_memory_reset_bytes_total",
+						  "Bytes of memory pages restored by resetInstance");
+
+bool Runtime::captureMemoryResetState(Memory* memory)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	const Uptr numPages = memory->numPages.load(std::memory_order_acquire);
+	const Uptr numBytes = numPages * IR::numBytesPerPage;
+
+	// Decommitted pages can't be read, and pages mapped to files can't be restored by writing
+	// them.
+	if(memory->hasMappedFiles
+	   || memory->numCommittedBytes.load(std::memory_order_relaxed) != numBytes)
+	{ return false; }
+
+	// Map the memory's pages copy-on-write to a snapshot, so resetting the memory only needs to
+	// discard the pages that were written since. If that isn't possible, copy the pages.
+	memory->resetNumPages = numPages;
+	memory->resetSnapshot.reset();
+	memory->resetBytes.clear();
+	if(numPages && snapshotMemoryPages(memory, numPages))
+	{ memory->resetSnapshot = memory->snapshot; }
+	else
+	{
+		memory->resetBytes.assign(memory->baseAddress, memory->baseAddress + numBytes);
+	}
+	return true;
+}
+
+void Runtime::resetMemory(Memory* memory)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	if(memory->resetNumPages == UINTPTR_MAX) { return; }
+
+	// Decommit the pages the memory grew by since its state was captured.
+	const Uptr numPages = memory->numPages.load(std::memory_order_acquire);
+	const Uptr numResetPages = memory->resetNumPages;
+	WAVM_ASSERT(numPages >= numResetPages);
+	if(numPages > numResetPages)
+	{
+		U8* baseAddress = memory->baseAddress + numResetPages * IR::numBytesPerPage;
+		const Uptr numPlatformPages = (numPages - numResetPages)
+									  << getPlatformPagesPerWebAssemblyPageLog2();
+		Platform::decommitVirtualPages(baseAddress, numPlatformPages);
+		restoreMemoryProtectionKey(
+			memory, baseAddress, numPlatformPages, Platform::MemoryAccess::none);
+		if(memory->compartment->layout.numaNode != UINTPTR_MAX)
+		{
+			Platform::setVirtualPagesNUMANode(
+				baseAddress, numPlatformPages, memory->compartment->layout.numaNode);
+		}
+
+		memory->numPages.store(numResetPages, std::memory_order_release);
+		if(memory->id != UINTPTR_MAX)
+		{
+			memory->compartment->runtimeData->memories[memory->id].numPages.store(
+				numResetPages, std::memory_order_release);
+		}
+		if(memory->resourceQuota)
+		{ memory->resourceQuota->memoryPages.free(numPages - numResetPages); }
+	}
+
+	// Restore the contents of the memory's remaining pages.
+	const Uptr numResetBytes = numResetPages * IR::numBytesPerPage;
+	const Uptr numResetPlatformPages = numResetPages << getPlatformPagesPerWebAssemblyPageLog2();
+	const bool pagesWereRemapped = memory->hasMappedFiles
+								   || memory->numCommittedBytes.load(std::memory_order_relaxed)
+										  != numPages * IR::numBytesPerPage;
+	if(memory->resetSnapshot && memory->snapshot == memory->resetSnapshot)
+	{
+		// The pages are still mapped to the snapshot, so only the pages that were written since
+		// need to be restored.
+		const Uptr numDiscardedPlatformPages
+			= Platform::resetPageSnapshotMapping(memory->resetSnapshot.get(), memory->baseAddress);
+		numMemoryResetBytes.add(numDiscardedPlatformPages << Platform::getBytesPerPageLog2());
+	}
+	else if(memory->resetSnapshot)
+	{
+		// The pages were remapped since the state was captured, so map all of them to the
+		// snapshot again.
+		if(!Platform::mapPageSnapshot(memory->resetSnapshot.get(), memory->baseAddress))
+		{ Errors::fatalf("Failed to map the snapshot of a reset memory"); }
+		restoreMemoryProtectionKey(
+			memory, memory->baseAddress, numResetPlatformPages, Platform::MemoryAccess::readWrite);
+		memory->snapshot = memory->resetSnapshot;
+		memory->hasMappedFiles = false;
+		numMemoryResetBytes.add(numResetBytes);
+	}
+	else if(numResetPages)
+	{
+		// Replace pages that were decommitted or mapped to files with zeroed read-write pages,
+		// and copy the captured contents to the pages.
+		if(pagesWereRemapped)
+		{
+			memory->snapshot.reset();
+			Platform::decommitVirtualPages(memory->baseAddress, numResetPlatformPages);
+			if(!Platform::commitVirtualPages(memory->baseAddress, numResetPlatformPages))
+			{ Errors::fatalf("Failed to recommit reset memory pages"); }
+			restoreMemoryProtectionKey(memory,
+									   memory->baseAddress,
+									   numResetPlatformPages,
+									   Platform::MemoryAccess::readWrite);
+			if(memory->compartment->layout.numaNode != UINTPTR_MAX)
+			{
+				Platform::setVirtualPagesNUMANode(memory->baseAddress,
+												  numResetPlatformPages,
+												  memory->compartment->layout.numaNode);
+			}
+			memory->hasMappedFiles = false;
+		}
+		memcpy(memory->baseAddress, memory->resetBytes.data(), numResetBytes);
+		numMemoryResetBytes.add(numResetBytes);
+	}
+
+	// All of the remaining pages are committed again.
+	const Uptr numCommittedBytes = memory->numCommittedBytes.load(std::memory_order_relaxed);
+	if(numCommittedBytes > numResetBytes)
+	{
+		deregisterCommit(
+			memory->compartment, CommitKind::memory, numCommittedBytes - numResetBytes);
+	}
+	else if(numCommittedBytes < numResetBytes)
+	{
+		registerCommit(memory->compartment, CommitKind::memory, numResetBytes - numCommittedBytes);
+	}
+	memory->numCommittedBytes.store(numResetBytes, std::memory_order_relaxed);
+}
 
-	Platform::deregisterVirtualAllocation(numPages << getPlatformPagesPerWebAssemblyPageLog2());
+void Runtime::setCompartmentLazyMemoryClones(Compartment* compartment, bool lazyMemoryClones)
+{
+	compartment->lazyMemoryClones.store(lazyMemoryClones, std::memory_order_relaxed);
+}
+
+void Runtime::setMemoryPrefault(Memory* memory, bool prefault)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	memory->prefault = prefault;
+}
+
+void Runtime::setMemoryClonePrefetchPages(Memory* memory, std::vector<Uptr>&& pageIndices)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	memory->clonePrefetchPageIndices = std::move(pageIndices);
+}
+
+std::vector<Uptr> Runtime::getMemoryCopiedClonePages(const Memory* memory)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	if(!memory->lazyPageMapping) { return {}; }
+	return Platform::getLazyPageMappingCopiedPages(memory->lazyPageMapping);
 }
 
 U8* Runtime::getMemoryBaseAddress(Memory* memory) { return memory->baseAddress; }
@@ -327,31 +900,107 @@ U8* Runtime::getValidatedMemoryOffsetRange(Memory* memory, Uptr address, Uptr nu
 		numBytes);
 }
 
+U64 Runtime::getMemoryIOVSpans(Memory* memory,
+							   const MemoryIOV* iovs,
+							   Uptr numIOVs,
+							   MemorySpan<U8>* outSpans)
+{
+	WAVM_ASSERT(memory);
+
+	// Load the memory's size once for all the buffers: it can only grow, so buffers that are in
+	// bounds of the loaded size stay in bounds.
+	const Uptr memoryNumBytes
+		= memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage;
+	U64 totalNumBytes = 0;
+	for(Uptr iovIndex = 0; iovIndex < numIOVs; ++iovIndex)
+	{
+		const MemoryIOV& iov = iovs[iovIndex];
+		outSpans[iovIndex] = MemorySpan<U8>(
+			::getValidatedMemoryOffsetRangeImpl(
+				memory, memory->baseAddress, memoryNumBytes, iov.offset, iov.numBytes),
+			iov.numBytes);
+		totalNumBytes += iov.numBytes;
+	}
+	return totalNumBytes;
+}
+
+Uptr Runtime::gatherFromMemorySpans(const MemorySpan<U8>* spans,
+									Uptr numSpans,
+									U8* outData,
+									Uptr numBytes)
+{
+	Uptr numCopiedBytes = 0;
+	unwindSignalsAsExceptions([&] {
+		for(Uptr spanIndex = 0; spanIndex < numSpans && numCopiedBytes < numBytes; ++spanIndex)
+		{
+			const Uptr numSpanBytes
+				= std::min(spans[spanIndex].numBytes(), numBytes - numCopiedBytes);
+			bytewiseMemCopy(outData + numCopiedBytes, spans[spanIndex].data(), numSpanBytes);
+			numCopiedBytes += numSpanBytes;
+		}
+	});
+	return numCopiedBytes;
+}
+
+Uptr Runtime::scatterToMemorySpans(const MemorySpan<U8>* spans,
+								   Uptr numSpans,
+								   const U8* data,
+								   Uptr numBytes)
+{
+	Uptr numCopiedBytes = 0;
+	unwindSignalsAsExceptions([&] {
+		for(Uptr spanIndex = 0; spanIndex < numSpans && numCopiedBytes < numBytes; ++spanIndex)
+		{
+			const Uptr numSpanBytes
+				= std::min(spans[spanIndex].numBytes(), numBytes - numCopiedBytes);
+			bytewiseMemCopy(spans[spanIndex].data(), data + numCopiedBytes, numSpanBytes);
+			numCopiedBytes += numSpanBytes;
+		}
+	});
+	return numCopiedBytes;
+}
+
 void Runtime::initDataSegment(Instance* instance,
 							  Uptr dataSegmentIndex,
-							  const std::vector<U8>* dataVector,
+							  const IR::DataSegmentBytes* dataBytes,
 							  Memory* memory,
 							  Uptr destAddress,
 							  Uptr sourceOffset,
 							  Uptr numBytes)
 {
 	U8* destPointer = getValidatedMemoryOffsetRange(memory, destAddress, numBytes);
-	if(sourceOffset + numBytes > dataVector->size() || sourceOffset + numBytes < sourceOffset)
+	if(sourceOffset + numBytes > dataBytes->size() || sourceOffset + numBytes < sourceOffset)
 	{
 		throwException(
 			ExceptionTypes::outOfBoundsDataSegmentAccess,
 			{asObject(instance),
 			 U64(dataSegmentIndex),
-			 U64(sourceOffset > dataVector->size() ? sourceOffset : dataVector->size())});
+			 U64(sourceOffset > dataBytes->size() ? sourceOffset : dataBytes->size())});
 	}
 	else
 	{
-		Runtime::unwindSignalsAsExceptions([destPointer, sourceOffset, numBytes, dataVector] {
-			bytewiseMemCopy(destPointer, dataVector->data() + sourceOffset, numBytes);
+		Runtime::unwindSignalsAsExceptions([destPointer, sourceOffset, numBytes, dataBytes] {
+			bytewiseMemCopy(destPointer, dataBytes->data() + sourceOffset, numBytes);
 		});
 	}
 }
 
+void Runtime::initZeroedDataSegment(Memory* memory,
+									Uptr destAddress,
+									const IR::DataSegmentBytes* dataBytes,
+									const std::vector<DataSegmentExtent>& extents)
+{
+	// Check the bounds of the whole segment, but only write the extents that aren't zero.
+	U8* destPointer = getValidatedMemoryOffsetRange(memory, destAddress, dataBytes->size());
+	Runtime::unwindSignalsAsExceptions([destPointer, dataBytes, &extents] {
+		for(const DataSegmentExtent& extent : extents)
+		{
+			bytewiseMemCopy(
+				destPointer + extent.offset, dataBytes->data() + extent.offset, extent.numBytes);
+		}
+	});
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsMemory,
 							   "memory.grow",
 							   Iptr,
@@ -392,12 +1041,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsMemory,
 	else
 	{
 		// Make a copy of the shared_ptr to the data and unlock the data segments mutex.
-		std::shared_ptr<std::vector<U8>> dataVector = instance->dataSegments[dataSegmentIndex];
+		std::shared_ptr<IR::DataSegmentBytes> dataBytes = instance->dataSegments[dataSegmentIndex];
 		dataSegmentsLock.unlock();
 
 		initDataSegment(instance,
 						dataSegmentIndex,
-						dataVector.get(),
+						dataBytes.get(),
 						memory,
 						destAddress,
 						sourceOffset,
@@ -419,6 +1068,34 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsMemory,
 	{ instance->dataSegments[dataSegmentIndex].reset(); }
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsMemory,
+							   "memory.discard",
+							   void,
+							   memory_discard,
+							   Uptr address,
+							   Uptr numBytes,
+							   Uptr memoryId)
+{
+	Memory* memory = getMemoryFromRuntimeData(contextRuntimeData, memoryId);
+
+	// The range must be whole WebAssembly pages, which are always whole platform pages.
+	if((address | numBytes) & (IR::numBytesPerPage - 1))
+	{ throwException(ExceptionTypes::invalidArgument); }
+
+	Platform::RWMutex::ExclusiveLock resizingLock(memory->resizingMutex);
+	const Uptr memoryNumBytes
+		= memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage;
+	if(address > memoryNumBytes || numBytes > memoryNumBytes - address)
+	{
+		resizingLock.unlock();
+		throwException(ExceptionTypes::outOfBoundsMemoryAccess,
+					   {memory, U64(address > memoryNumBytes ? address : memoryNumBytes)});
+	}
+
+	if(numBytes)
+	{ resetMemoryPlatformPages(memory, address, numBytes >> Platform::getBytesPerPageLog2()); }
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
 							   "memoryOutOfBoundsTrap",
 							   void,
@@ -429,7 +1106,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
 							   Uptr memoryId)
 {
 	Compartment* compartment = getCompartmentFromContextRuntimeData(contextRuntimeData);
-	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 	Memory* memory = compartment->memories[memoryId];
 	compartmentLock.unlock();
 
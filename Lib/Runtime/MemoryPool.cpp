@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "AddressRangeIndex.h"
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+// Global index of the reserved address space of the memory pools that use protection keys, whose
+// memories' reservations overlap the slots of other stripes.
+static AddressRangeIndex<MemoryPool> stripedMemoryPoolAddressRanges;
+
+Runtime::MemoryPool::MemoryPool(Uptr inNumSlots, bool useProtectionKeys) : numSlots(inNumSlots)
+{
+	// Allocate the protection keys to color the slots with. Striping the slots only saves address
+	// space if there are at least two keys.
+	if(useProtectionKeys)
+	{
+		while(protectionKeys.size() < maxMemoryPoolProtectionKeys)
+		{
+			const I32 protectionKey = Platform::allocateMemoryProtectionKey();
+			if(protectionKey < 0) { break; }
+			protectionKeys.push_back(protectionKey);
+		}
+		if(protectionKeys.size() < 2)
+		{
+			for(I32 protectionKey : protectionKeys)
+			{ Platform::freeMemoryProtectionKey(protectionKey); }
+			protectionKeys.clear();
+		}
+	}
+	numStripes = protectionKeys.size() ? protectionKeys.size() : 1;
+	for(I32 protectionKey : protectionKeys)
+	{ protectionKeyRightsMask |= U32(3) << (protectionKey * 2); }
+
+	// Each memory's reserved address space and guard region spans numStripes slots, rounded up so
+	// that each slot is aligned for huge pages if they are enabled. The pool reserves enough
+	// address space after the last slot for the memory in it.
+	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+	const Uptr numBytesPerMemory = memory32NumReservedBytes + memoryNumGuardBytes;
+	baseAddressAlignmentLog2
+		= Platform::getHugePageAlignmentLog2((numBytesPerMemory / numStripes) >> pageBytesLog2);
+	const Uptr slotAlignmentBytes = Uptr(1) << baseAddressAlignmentLog2;
+	numBytesPerSlot = ((numBytesPerMemory + numStripes - 1) / numStripes + slotAlignmentBytes - 1)
+					  & ~(slotAlignmentBytes - 1);
+	const Uptr numTailBytes
+		= numBytesPerMemory > numBytesPerSlot ? numBytesPerMemory - numBytesPerSlot : 0;
+
+	if(numSlots && numSlots <= (UINTPTR_MAX - numTailBytes) / numBytesPerSlot)
+	{
+		numReservedBytes = numSlots * numBytesPerSlot + numTailBytes;
+		baseAddress = Platform::allocateAlignedVirtualPages(
+			numReservedBytes >> pageBytesLog2, baseAddressAlignmentLog2, unalignedBaseAddress);
+	}
+
+	// Tag each slot with its stripe's protection key.
+	for(Uptr slotIndex = 0; baseAddress && protectionKeys.size() && slotIndex < numSlots;
+		++slotIndex)
+	{
+		if(!Platform::setVirtualPagesProtectionKey(baseAddress + slotIndex * numBytesPerSlot,
+												   numBytesPerSlot >> pageBytesLog2,
+												   Platform::MemoryAccess::none,
+												   protectionKeys[slotIndex % numStripes]))
+		{
+			Platform::freeAlignedVirtualPages(
+				unalignedBaseAddress, numReservedBytes >> pageBytesLog2, baseAddressAlignmentLog2);
+			baseAddress = nullptr;
+		}
+	}
+
+	if(baseAddress)
+	{
+		// Allocate the lowest slots in each stripe first.
+		stripeFreeSlotIndices.resize(numStripes);
+		for(Uptr slotIndex = numSlots; slotIndex > 0; --slotIndex)
+		{ stripeFreeSlotIndices[(slotIndex - 1) % numStripes].push_back(slotIndex - 1); }
+
+		if(numStripes > 1)
+		{
+			stripedMemoryPoolAddressRanges.add(
+				baseAddress, baseAddress + numReservedBytes, this);
+		}
+	}
+}
+
+Runtime::MemoryPool::~MemoryPool()
+{
+	// Memories hold a reference to the pool they were allocated from, so all slots must be free.
+	WAVM_ASSERT(!baseAddress || getNumFreeSlots() == numSlots);
+
+	if(baseAddress)
+	{
+		if(numStripes > 1) { stripedMemoryPoolAddressRanges.remove(this); }
+		Platform::freeAlignedVirtualPages(unalignedBaseAddress,
+										  numReservedBytes >> Platform::getBytesPerPageLog2(),
+										  baseAddressAlignmentLog2);
+	}
+
+	for(I32 protectionKey : protectionKeys) { Platform::freeMemoryProtectionKey(protectionKey); }
+}
+
+U8* Runtime::MemoryPool::allocateSlot(Uptr stripeIndex, Uptr& outSlotIndex)
+{
+	WAVM_ASSERT(stripeIndex < numStripes);
+
+	Platform::Mutex::Lock lock(mutex);
+	std::vector<Uptr>& freeSlotIndices = stripeFreeSlotIndices[stripeIndex];
+	if(freeSlotIndices.empty()) { return nullptr; }
+
+	outSlotIndex = freeSlotIndices.back();
+	freeSlotIndices.pop_back();
+	return baseAddress + outSlotIndex * numBytesPerSlot;
+}
+
+void Runtime::MemoryPool::freeSlot(Uptr slotIndex, Uptr numCommittedBytes)
+{
+	WAVM_ASSERT(slotIndex < numSlots);
+	WAVM_ASSERT(numCommittedBytes <= std::min(numBytesPerSlot, memory32NumReservedBytes));
+
+	// Decommit the pages the memory used, which resets them to zero and makes them inaccessible,
+	// but leave the slot's address space reserved. Decommitting also resets their protection key.
+	if(numCommittedBytes)
+	{
+		U8* slotBaseAddress = baseAddress + slotIndex * numBytesPerSlot;
+		const Uptr numCommittedPages = numCommittedBytes >> Platform::getBytesPerPageLog2();
+		Platform::decommitVirtualPages(slotBaseAddress, numCommittedPages);
+		if(protectionKeys.size()
+		   && !Platform::setVirtualPagesProtectionKey(slotBaseAddress,
+													  numCommittedPages,
+													  Platform::MemoryAccess::none,
+													  protectionKeys[slotIndex % numStripes]))
+		{ Errors::fatalf("Failed to set the protection key of a memory pool slot"); }
+	}
+
+	Platform::Mutex::Lock lock(mutex);
+	stripeFreeSlotIndices[slotIndex % numStripes].push_back(slotIndex);
+}
+
+Uptr Runtime::MemoryPool::getNumFreeSlots() const
+{
+	Platform::Mutex::Lock lock(mutex);
+	Uptr numFreeSlots = 0;
+	for(const std::vector<Uptr>& freeSlotIndices : stripeFreeSlotIndices)
+	{ numFreeSlots += freeSlotIndices.size(); }
+	return numFreeSlots;
+}
+
+MemoryPoolRef Runtime::createMemoryPool(Uptr numSlots, bool useProtectionKeys)
+{
+	MemoryPoolRef memoryPool = std::make_shared<MemoryPool>(numSlots, useProtectionKeys);
+	if(!memoryPool->baseAddress) { return nullptr; }
+	return memoryPool;
+}
+
+Uptr Runtime::getMemoryPoolNumSlots(MemoryPoolRefParam memoryPool) { return memoryPool->numSlots; }
+
+Uptr Runtime::getMemoryPoolNumFreeSlots(MemoryPoolRefParam memoryPool)
+{
+	return memoryPool->getNumFreeSlots();
+}
+
+bool Runtime::findStripedMemoryPool(U8* address, MemoryPool*& outMemoryPool)
+{
+	U8* baseAddress = nullptr;
+	return stripedMemoryPoolAddressRanges.find(address, outMemoryPool, baseAddress);
+}
+
+void Runtime::setCompartmentMemoryPoolStripe(Compartment* compartment)
+{
+	const MemoryPoolRef& memoryPool = compartment->memoryPool;
+	compartment->memoryPoolStripeIndex = memoryPool ? memoryPool->allocateStripe() : 0;
+	compartment->memoryProtectionKey
+		= memoryPool ? memoryPool->getStripeProtectionKey(compartment->memoryPoolStripeIndex) : -1;
+	compartment->memoryProtectionKeyRightsMask
+		= memoryPool ? memoryPool->protectionKeyRightsMask : 0;
+}
+
+void Runtime::setCompartmentMemoryPool(Compartment* compartment, MemoryPoolRefParam memoryPool)
+{
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+
+	// Code running in the compartment is only given access to the protection key of its stripe of
+	// the pool, so the pool can't be changed after memories might have been allocated from it.
+	const bool usesProtectionKeys
+		= (compartment->memoryPool && compartment->memoryPool->protectionKeys.size())
+		  || (memoryPool && memoryPool->protectionKeys.size());
+	WAVM_ERROR_UNLESS(!usesProtectionKeys || !compartment->memories.size());
+
+	compartment->memoryPool = memoryPool;
+	setCompartmentMemoryPoolStripe(compartment);
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+// The number of bytes the prefault thread populates at a time. It holds the memory's resizing
+// lock while it populates them, so this bounds how long it may delay growing the memory.
+static constexpr Uptr numBytesPerPrefaultChunk = Uptr(4) * 1024 * 1024;
+
+static Metrics::Counter& numBackgroundPrefaultBytes
+	= Metrics::getCounter("wavm_memory_background_prefault_bytes_total",
+						  "Bytes of memory populated by the background prefault thread");
+
+struct MemoryPrefault
+{
+	Memory* memory;
+	Uptr offset;
+	Uptr numBytes;
+};
+
+struct MemoryPrefaulter
+{
+	Platform::Mutex mutex;
+
+	// Signaled when a prefault is queued, and when the thread finishes prefaulting a memory.
+	Platform::Event wakeEvent;
+	Platform::Event prefaultFinishedEvent;
+
+	std::deque<MemoryPrefault> prefaults;
+	Memory* prefaultingMemory = nullptr;
+	bool hasStartedThread = false;
+};
+
+// The prefaulter is never destroyed, since its thread may still be waiting when the process exits.
+static MemoryPrefaulter& getMemoryPrefaulter()
+{
+	static MemoryPrefaulter* prefaulter = new MemoryPrefaulter;
+	return *prefaulter;
+}
+
+static void prefaultMemoryPages(const MemoryPrefault& prefault)
+{
+	Memory* memory = prefault.memory;
+	const Uptr endOffset = prefault.offset + prefault.numBytes;
+	for(Uptr offset = prefault.offset; offset < endOffset; offset += numBytesPerPrefaultChunk)
+	{
+		Platform::RWMutex::ShareableLock resizingLock(memory->resizingMutex);
+
+		// Stop if prefaulting was disabled, the pages may have been replaced by a file or
+		// snapshot mapping, or the memory was shrunk by resetInstance. The memory may have been
+		// moved, so the pages' address is recomputed from its current base address.
+		const Uptr numMemoryBytes
+			= memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage;
+		if(!memory->prefault || memory->hasMappedFiles || memory->hasMappedSnapshots
+		   || memory->lazyPageMapping || offset >= numMemoryBytes)
+		{ return; }
+
+		const Uptr numChunkBytes
+			= std::min(numBytesPerPrefaultChunk, std::min(endOffset, numMemoryBytes) - offset);
+		if(!Platform::populateVirtualPages(memory->baseAddress + offset,
+										   numChunkBytes >> Platform::getBytesPerPageLog2()))
+		{ return; }
+		numBackgroundPrefaultBytes.add(numChunkBytes);
+	}
+}
+
+static I64 memoryPrefaultThreadEntry(void*)
+{
+	Platform::setCurrentThreadBackgroundPriority();
+
+	MemoryPrefaulter& prefaulter = getMemoryPrefaulter();
+	while(true)
+	{
+		prefaulter.wakeEvent.wait(Time::infinity());
+
+		while(true)
+		{
+			MemoryPrefault prefault;
+			{
+				Platform::Mutex::Lock lock(prefaulter.mutex);
+				if(prefaulter.prefaults.empty()) { break; }
+				prefault = prefaulter.prefaults.front();
+				prefaulter.prefaults.pop_front();
+				prefaulter.prefaultingMemory = prefault.memory;
+			}
+
+			prefaultMemoryPages(prefault);
+
+			{
+				Platform::Mutex::Lock lock(prefaulter.mutex);
+				prefaulter.prefaultingMemory = nullptr;
+			}
+			prefaulter.prefaultFinishedEvent.signal();
+		}
+	}
+}
+
+void Runtime::prefaultMemoryInBackground(Memory* memory, Uptr offset, Uptr numBytes)
+{
+	MemoryPrefaulter& prefaulter = getMemoryPrefaulter();
+	{
+		Platform::Mutex::Lock lock(prefaulter.mutex);
+		prefaulter.prefaults.push_back({memory, offset, numBytes});
+		memory->hasBackgroundPrefaults.store(true, std::memory_order_release);
+
+		if(!prefaulter.hasStartedThread)
+		{
+			prefaulter.hasStartedThread = true;
+			Platform::detachThread(
+				Platform::createThread(1024 * 1024, memoryPrefaultThreadEntry, nullptr));
+		}
+	}
+	prefaulter.wakeEvent.signal();
+}
+
+void Runtime::cancelBackgroundMemoryPrefaults(Memory* memory)
+{
+	MemoryPrefaulter& prefaulter = getMemoryPrefaulter();
+	while(true)
+	{
+		{
+			Platform::Mutex::Lock lock(prefaulter.mutex);
+			prefaulter.prefaults.erase(
+				std::remove_if(prefaulter.prefaults.begin(),
+							   prefaulter.prefaults.end(),
+							   [memory](const MemoryPrefault& prefault) {
+								   return prefault.memory == memory;
+							   }),
+				prefaulter.prefaults.end());
+			if(prefaulter.prefaultingMemory != memory) { break; }
+		}
+		prefaulter.prefaultFinishedEvent.wait(Time::infinity());
+	}
+
+	// Pass the signal on to any other thread that is waiting for a prefault to finish.
+	prefaulter.prefaultFinishedEvent.signal();
+}
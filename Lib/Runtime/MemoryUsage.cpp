@@ -0,0 +1,140 @@
+#include <atomic>
+#include <memory>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+static Metrics::Gauge& getCommittedBytesGauge(CommitKind kind)
+{
+	static Metrics::Gauge& compartmentGauge = Metrics::getGauge(
+		"wavm_committed_bytes{kind=\"compartment\"}", "Bytes of virtual memory committed by WAVM");
+	static Metrics::Gauge& memoryGauge = Metrics::getGauge(
+		"wavm_committed_bytes{kind=\"memory\"}", "Bytes of virtual memory committed by WAVM");
+	static Metrics::Gauge& tableGauge = Metrics::getGauge(
+		"wavm_committed_bytes{kind=\"table\"}", "Bytes of virtual memory committed by WAVM");
+	switch(kind)
+	{
+	case CommitKind::compartment: return compartmentGauge;
+	case CommitKind::memory: return memoryGauge;
+	case CommitKind::table: return tableGauge;
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+void Runtime::registerCommit(Compartment* compartment, CommitKind kind, Uptr numBytes)
+{
+	compartment->numCommittedBytes.fetch_add(numBytes, std::memory_order_relaxed);
+	getCommittedBytesGauge(kind).add(numBytes);
+	Platform::registerVirtualAllocation(numBytes);
+}
+
+void Runtime::deregisterCommit(Compartment* compartment, CommitKind kind, Uptr numBytes)
+{
+	compartment->numCommittedBytes.fetch_sub(numBytes, std::memory_order_relaxed);
+	getCommittedBytesGauge(kind).subtract(numBytes);
+	Platform::deregisterVirtualAllocation(numBytes);
+}
+
+static Uptr getNumResidentBytes(const void* baseAddress, Uptr numBytes)
+{
+	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+	const Uptr numPages = (numBytes + (Uptr(1) << pageBytesLog2) - 1) >> pageBytesLog2;
+	if(!baseAddress || !numPages) { return 0; }
+	return Platform::getNumResidentVirtualPages((U8*)baseAddress, numPages) << pageBytesLog2;
+}
+
+static MemoryUsage getMemoryMemoryUsage(const Memory* memory, bool sampleResidency)
+{
+	MemoryUsage usage;
+	usage.numCommittedBytes = memory->numCommittedBytes.load(std::memory_order_relaxed);
+	if(sampleResidency)
+	{
+		usage.numResidentBytes = getNumResidentBytes(
+			memory->baseAddress,
+			memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage);
+	}
+	return usage;
+}
+
+static MemoryUsage getTableMemoryUsage(const Table* table, bool sampleResidency)
+{
+	MemoryUsage usage;
+	usage.numCommittedBytes = table->numCommittedBytes.load(std::memory_order_relaxed);
+	if(sampleResidency)
+	{ usage.numResidentBytes = getNumResidentBytes(table->elements, usage.numCommittedBytes); }
+	return usage;
+}
+
+static MemoryUsage getInstanceMemoryUsage(const Instance* instance, bool sampleResidency)
+{
+	MemoryUsage usage;
+	if(instance->jitModule)
+	{
+		const LLVMJIT::ModuleMemoryUsage moduleUsage
+			= LLVMJIT::getModuleMemoryUsage(instance->jitModule.get(), sampleResidency);
+		usage.numCommittedBytes = moduleUsage.numCodeBytes + moduleUsage.numReadOnlyBytes
+								  + moduleUsage.numReadWriteBytes;
+		usage.numResidentBytes = moduleUsage.numResidentBytes;
+	}
+	return usage;
+}
+
+static MemoryUsage getCompartmentMemoryUsage(const Compartment* compartment,
+											 bool sampleResidency)
+{
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
+
+	// The compartment's committed bytes already include its memories and tables.
+	MemoryUsage usage;
+	usage.numCommittedBytes = compartment->numCommittedBytes.load(std::memory_order_relaxed);
+	if(sampleResidency)
+	{
+		usage.numResidentBytes
+			= getNumResidentBytes(compartment->runtimeData, compartment->numReservedBytes);
+		for(Memory* memory : compartment->memories)
+		{ usage.numResidentBytes += getMemoryMemoryUsage(memory, true).numResidentBytes; }
+		for(Table* table : compartment->tables)
+		{ usage.numResidentBytes += getTableMemoryUsage(table, true).numResidentBytes; }
+	}
+
+	for(Instance* instance : compartment->instances)
+	{
+		const MemoryUsage instanceUsage = getInstanceMemoryUsage(instance, sampleResidency);
+		usage.numCommittedBytes += instanceUsage.numCommittedBytes;
+		usage.numResidentBytes += instanceUsage.numResidentBytes;
+	}
+
+	return usage;
+}
+
+MemoryUsage Runtime::getObjectMemoryUsage(const Object* object, bool sampleResidency)
+{
+	switch(object->kind)
+	{
+	case ObjectKind::memory: return getMemoryMemoryUsage(asMemory(object), sampleResidency);
+	case ObjectKind::table: return getTableMemoryUsage(asTable(object), sampleResidency);
+	case ObjectKind::instance: return getInstanceMemoryUsage(asInstance(object), sampleResidency);
+	case ObjectKind::compartment:
+		return getCompartmentMemoryUsage(asCompartment(object), sampleResidency);
+
+	case ObjectKind::function:
+	case ObjectKind::global:
+	case ObjectKind::exceptionType:
+	case ObjectKind::context:
+	case ObjectKind::foreign: return MemoryUsage();
+
+	case ObjectKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
@@ -1,12 +1,15 @@
 #include "WAVM/IR/Module.h"
+#include <string.h>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "RuntimePrivate.h"
 #include "WAVM/IR/IR.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/WASM/WASM.h"
@@ -24,38 +27,457 @@ void Runtime::setGlobalObjectCache(std::shared_ptr<ObjectCacheInterface>&& objec
 	globalObjectCache = std::move(objectCache);
 }
 
-static std::shared_ptr<ObjectCacheInterface> getGlobalObjectCache()
+std::shared_ptr<ObjectCacheInterface> Runtime::getGlobalObjectCache()
 {
 	Platform::RWMutex::ShareableLock globalObjectCacheLock(globalObjectCacheMutex);
 	return globalObjectCache;
 }
 
-ModuleRef Runtime::compileModule(const IR::Module& irModule)
+Platform::RWMutex globalCompileOptionsMutex;
+LLVMJIT::CompileOptions globalCompileOptions;
+
+void Runtime::setGlobalCompileOptions(const LLVMJIT::CompileOptions& compileOptions)
 {
-	// Get a pointer to the global object cache, if there is one.
-	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalCompileOptions = compileOptions;
+}
+
+LLVMJIT::CompileOptions Runtime::getGlobalCompileOptions()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalCompileOptions;
+}
+
+bool globalLazyCompilation = false;
+
+void Runtime::setGlobalLazyCompilation(bool lazyCompilation)
+{
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalLazyCompilation = lazyCompilation;
+}
+
+static bool getGlobalLazyCompilation()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalLazyCompilation;
+}
+
+bool globalReleaseFunctionBodies = false;
+
+void Runtime::setGlobalReleaseFunctionBodies(bool releaseFunctionBodies)
+{
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalReleaseFunctionBodies = releaseFunctionBodies;
+}
 
-	std::vector<U8> objectCode;
+static bool getGlobalReleaseFunctionBodies()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalReleaseFunctionBodies;
+}
+
+bool globalSpecializeInstances = false;
+
+void Runtime::setGlobalSpecializeInstances(bool specializeInstances)
+{
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalSpecializeInstances = specializeInstances;
+}
+
+static bool getGlobalSpecializeInstances()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalSpecializeInstances;
+}
+
+bool globalInterpretModules = false;
+
+void Runtime::setGlobalInterpretModules(bool interpretModules)
+{
+	Platform::RWMutex::ExclusiveLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	globalInterpretModules = interpretModules;
+}
+
+static bool getGlobalInterpretModules()
+{
+	Platform::RWMutex::ShareableLock globalCompileOptionsLock(globalCompileOptionsMutex);
+	return globalInterpretModules;
+}
+
+// Releases the parts of a module's IR that are only needed to compile it: the code and branch
+// tables of its function definitions. The function types and local types are kept, since
+// instantiating the module and decoding its debug names use them.
+static void releaseFunctionBodies(IR::Module& irModule)
+{
+	for(FunctionDef& functionDef : irModule.functions.defs)
+	{
+		functionDef.code = std::vector<U8>();
+		functionDef.branchTableTargetDepths = std::vector<U32>();
+	}
+}
+
+// Compiles a module to object code. If an object cache is provided, the object code is looked up
+// in the cache using wasmBytes and their hash, which is computed if it wasn't already, before
+// compiling the module.
+static std::shared_ptr<const std::vector<U8>> compileObjectCode(
+	const IR::Module& irModule,
+	const std::vector<U8>& wasmBytes,
+	ObjectCacheKeyHash& wasmBytesHash,
+	ObjectCacheInterface* objectCache,
+	const LLVMJIT::CompileOptions& compileOptions)
+{
 	if(!objectCache)
 	{
-		// If there's no global object cache, just compile the module.
-		objectCode = LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
+		// If there's no object cache, just compile the module.
+		return std::make_shared<const std::vector<U8>>(
+			compileHostObjectCode(irModule, compileOptions));
 	}
 	else
 	{
-		// Serialize the IR module to WASM.
+		// Check for cached object code for the module before compiling it.
+		return objectCache->getCachedObject(
+			wasmBytes.data(), wasmBytes.size(), wasmBytesHash, [&irModule, &compileOptions]() {
+				return compileHostObjectCode(irModule, compileOptions);
+			});
+	}
+}
+
+// Serializes a specialization to bytes that identify it in the module's specialized object code
+// and, appended to the module's WASM bytes, in the object cache.
+static std::vector<U8> getSpecializationKey(const LLVMJIT::ModuleSpecialization& specialization)
+{
+	std::vector<U8> key;
+	auto appendBytes = [&key](const void* data, Uptr numBytes) {
+		key.insert(key.end(), (const U8*)data, (const U8*)data + numBytes);
+	};
+
+	for(const Value& value : specialization.globalImportValues)
+	{
+		key.push_back(U8(value.type));
+		if(value.type != ValueType::none) { appendBytes(value.bytes, sizeof(value.bytes)); }
+	}
+	for(const MemoryType& memoryType : specialization.memoryImportTypes)
+	{
+		key.push_back(U8(memoryType.isShared));
+		key.push_back(U8(memoryType.indexType));
+		appendBytes(&memoryType.size.min, sizeof(memoryType.size.min));
+		appendBytes(&memoryType.size.max, sizeof(memoryType.size.max));
+	}
+	for(const std::string& inlineLLVMIR : specialization.functionImportInlineLLVMIR)
+	{
+		const U64 numChars = inlineLLVMIR.size();
+		appendBytes(&numChars, sizeof(numChars));
+		appendBytes(inlineLLVMIR.data(), inlineLLVMIR.size());
+	}
+	const U64 numPureNativeFunctionImports = specialization.pureNativeFunctionImports.size();
+	appendBytes(&numPureNativeFunctionImports, sizeof(numPureNativeFunctionImports));
+	for(bool isPureNative : specialization.pureNativeFunctionImports)
+	{ key.push_back(isPureNative); }
+	return key;
+}
+
+Runtime::Module::Module(IR::Module&& inIR, std::vector<U8>&& inObjectCode)
+: ir(std::move(inIR))
+, objectCode(std::make_shared<const std::vector<U8>>(std::move(inObjectCode)))
+, interpretInstances(false)
+, releaseFunctionBodiesAfterCompile(getGlobalReleaseFunctionBodies())
+, specializeInstances(false)
+{
+	if(releaseFunctionBodiesAfterCompile) { releaseFunctionBodies(ir); }
+}
+
+Runtime::Module::Module(IR::Module&& inIR,
+						std::vector<U8>&& inWASMBytes,
+						std::shared_ptr<ObjectCacheInterface>&& inObjectCache,
+						const LLVMJIT::CompileOptions& inCompileOptions,
+						const ObjectCacheKeyHash& inWASMBytesHash)
+: ir(std::move(inIR))
+, wasmBytes(std::move(inWASMBytes))
+, wasmBytesHash(inWASMBytesHash)
+, objectCache(std::move(inObjectCache))
+, compileOptions(inCompileOptions)
+, interpretInstances(getGlobalInterpretModules())
+, releaseFunctionBodiesAfterCompile(getGlobalReleaseFunctionBodies())
+, specializeInstances(getGlobalSpecializeInstances())
+{
+}
+
+Runtime::Module::~Module() {}
+
+std::shared_ptr<const std::vector<U8>> Runtime::Module::getObjectCode(
+	const std::shared_ptr<const std::atomic<bool>>& cancelFlag) const
+{
+	Platform::Mutex::Lock objectCodeLock(objectCodeMutex);
+	if(!objectCode)
+	{
+		// Only this compile may be cancelled, not the compiles of the module's specializations.
+		LLVMJIT::CompileOptions cancellableCompileOptions = compileOptions;
+		cancellableCompileOptions.cancelFlag = cancelFlag;
+
+		// Only the optimized object code is stored in the object cache.
+		objectCode = compileObjectCode(
+			ir,
+			wasmBytes,
+			wasmBytesHash,
+			compileOptions.tier == LLVMJIT::CompileTier::baseline ? nullptr : objectCache.get(),
+			cancellableCompileOptions);
+		releaseCompileState();
+	}
+	return objectCode;
+}
+
+std::shared_ptr<const std::vector<U8>> Runtime::Module::getTierUpObjectCode(
+	const std::vector<Uptr>& functionDefIndices,
+	const std::shared_ptr<const std::atomic<bool>>& cancelFlag) const
+{
+	WAVM_ASSERT(tiersUpInstances());
+	std::vector<U8> key(functionDefIndices.size() * sizeof(Uptr));
+	if(key.size()) { memcpy(key.data(), functionDefIndices.data(), key.size()); }
+
+	// Instances of the module that get hot in the same functions share the object code. Unlike
+	// specializations, it is compiled without holding the mutex, so a compile for an instance that
+	// is being destroyed doesn't hold up the compiles of the other instances.
+	{
+		Platform::Mutex::Lock tierUpObjectCodesLock(tierUpObjectCodesMutex);
+		if(const std::shared_ptr<const std::vector<U8>>* tierUpObjectCode
+		   = tierUpObjectCodes.get(key))
+		{ return *tierUpObjectCode; }
+	}
+
+	LLVMJIT::CompileOptions tierUpCompileOptions = compileOptions;
+	tierUpCompileOptions.tier = LLVMJIT::CompileTier::optimized;
+	tierUpCompileOptions.tierUpCallThreshold = 0;
+	tierUpCompileOptions.tierUpFunctionDefIndices
+		= std::make_shared<const std::vector<Uptr>>(functionDefIndices);
+	tierUpCompileOptions.cancelFlag = cancelFlag;
+
+	Timing::Timer tierUpTimer;
+	std::shared_ptr<const std::vector<U8>> tierUpObjectCode
+		= std::make_shared<const std::vector<U8>>(compileHostObjectCode(ir, tierUpCompileOptions));
+	Timing::logRatePerSecond(
+		"Tiered up hot functions", tierUpTimer, F64(functionDefIndices.size()), "functions");
+
+	// If another instance compiled the same functions first, use its object code.
+	Platform::Mutex::Lock tierUpObjectCodesLock(tierUpObjectCodesMutex);
+	return tierUpObjectCodes.getOrAdd(std::move(key), std::move(tierUpObjectCode));
+}
+
+std::shared_ptr<const std::vector<U8>> Runtime::Module::getSpecializedObjectCode(
+	const LLVMJIT::ModuleSpecialization& specialization) const
+{
+	WAVM_ASSERT(specializeInstances);
+	std::vector<U8> specializationKey = getSpecializationKey(specialization);
+
+	// Instances with the same specialization share its object code. Concurrent instantiations
+	// with a new specialization compile it once while holding the mutex.
+	Platform::Mutex::Lock specializedObjectCodesLock(specializedObjectCodesMutex);
+	if(const std::shared_ptr<const std::vector<U8>>* specializedObjectCode
+	   = specializedObjectCodes.get(specializationKey))
+	{ return *specializedObjectCode; }
+
+	// Compile the specialization with the optimized tier: it only benefits instances with the
+	// same imports, so there's no point in compiling it twice. If there's an object cache, the
+	// object code is cached by the WASM bytes followed by the specialization key.
+	LLVMJIT::CompileOptions specializedCompileOptions = compileOptions;
+	specializedCompileOptions.tier = LLVMJIT::CompileTier::optimized;
+	specializedCompileOptions.tierUpCallThreshold = 0;
+	specializedCompileOptions.specialization
+		= std::make_shared<LLVMJIT::ModuleSpecialization>(specialization);
+	std::vector<U8> cacheKey;
+	if(objectCache)
+	{
+		cacheKey.reserve(wasmBytes.size() + specializationKey.size());
+		cacheKey.insert(cacheKey.end(), wasmBytes.begin(), wasmBytes.end());
+		cacheKey.insert(cacheKey.end(), specializationKey.begin(), specializationKey.end());
+	}
+
+	Timing::Timer specializeTimer;
+	ObjectCacheKeyHash cacheKeyHash;
+	std::shared_ptr<const std::vector<U8>> specializedObjectCode = compileObjectCode(
+		ir, cacheKey, cacheKeyHash, objectCache.get(), specializedCompileOptions);
+	Timing::logTimer("Compiled module specialized for an instance's imports", specializeTimer);
+
+	specializedObjectCodes.addOrFail(std::move(specializationKey), specializedObjectCode);
+	return specializedObjectCode;
+}
+
+void Runtime::Module::releaseCompileState() const
+{
+	WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(objectCodeMutex);
+	if(specializeInstances) { return; }
+
+	wasmBytes = std::vector<U8>();
+	wasmBytesHash = ObjectCacheKeyHash();
+	objectCache.reset();
+	if(releaseFunctionBodiesAfterCompile && !interpretInstances && !tiersUpInstances())
+	{ releaseFunctionBodies(ir); }
+}
+
+std::shared_ptr<const InterpreterModuleCode> Runtime::Module::getInterpreterCode() const
+{
+	if(!interpretInstances) { return nullptr; }
+
+	Platform::Mutex::Lock interpreterCodeLock(interpreterCodeMutex);
+	if(!hasPreparedInterpreterCode)
+	{
+		Timing::Timer prepareTimer;
+		interpreterCode = prepareInterpreterCode(ir);
+		hasPreparedInterpreterCode = true;
+		Timing::logTimer("Prepared module for the interpreter", prepareTimer);
+	}
+	return interpreterCode;
+}
+
+std::shared_ptr<const ModuleDebugNames> Runtime::Module::getDebugNames() const
+{
+	Platform::Mutex::Lock debugNamesLock(debugNamesMutex);
+	if(!debugNames)
+	{
+		DisassemblyNames disassemblyNames;
+		getDisassemblyNames(ir, disassemblyNames);
+
+		// Only keep the names of the module's definitions: the local and label names aren't used
+		// by the runtime.
+		std::shared_ptr<ModuleDebugNames> newDebugNames = std::make_shared<ModuleDebugNames>();
+		newDebugNames->functions.reserve(disassemblyNames.functions.size());
+		for(DisassemblyNames::Function& function : disassemblyNames.functions)
+		{ newDebugNames->functions.push_back(std::move(function.name)); }
+		newDebugNames->tables = std::move(disassemblyNames.tables);
+		newDebugNames->memories = std::move(disassemblyNames.memories);
+		newDebugNames->globals = std::move(disassemblyNames.globals);
+		newDebugNames->exceptionTypes = std::move(disassemblyNames.exceptionTypes);
+		debugNames = std::move(newDebugNames);
+	}
+	return debugNames;
+}
+
+// Splits a data segment's bytes into the extents between runs of at least this many zeros. Shorter
+// runs of zeros are copied along with the bytes around them.
+static constexpr Uptr minDataSegmentZeroRunBytes = 64;
+
+static std::vector<DataSegmentExtent> getDataSegmentExtents(const IR::DataSegmentBytes& dataBytes)
+{
+	const U8* bytes = dataBytes.data();
+	const Uptr numBytes = dataBytes.size();
+
+	std::vector<DataSegmentExtent> extents;
+	Uptr offset = 0;
+	while(offset < numBytes)
+	{
+		// Skip the zeros before the next extent.
+		while(offset < numBytes && !bytes[offset]) { ++offset; }
+		if(offset == numBytes) { break; }
+
+		// The extent ends at the next run of zeros that is long enough to skip.
+		const Uptr extentOffset = offset;
+		Uptr extentEnd = offset;
+		while(offset < numBytes && offset - extentEnd < minDataSegmentZeroRunBytes)
+		{
+			if(bytes[offset++]) { extentEnd = offset; }
+		}
+		extents.push_back({extentOffset, extentEnd - extentOffset});
+	}
+	return extents;
+}
+
+std::shared_ptr<const InstanceTemplate> Runtime::Module::getInstanceTemplate() const
+{
+	Platform::Mutex::Lock instanceTemplateLock(instanceTemplateMutex);
+	if(!instanceTemplate)
+	{
+		std::shared_ptr<InstanceTemplate> newTemplate = std::make_shared<InstanceTemplate>();
+
+		newTemplate->invokeThunkDebugNames.resize(ir.types.size());
+		for(Uptr typeIndex : LLVMJIT::getModuleInvokeThunkTypeIndices(ir))
+		{
+			newTemplate->invokeThunkDebugNames[typeIndex]
+				= "thnk!C to WASM thunk!" + asString(ir.types[typeIndex]);
+		}
+
+		for(const DataSegment& dataSegment : ir.dataSegments)
+		{
+			newTemplate->dataSegments.push_back(dataSegment.isActive ? nullptr : dataSegment.data);
+			newTemplate->dataSegmentExtents.push_back(
+				dataSegment.isActive ? getDataSegmentExtents(*dataSegment.data)
+									 : std::vector<DataSegmentExtent>());
+		}
+		for(const ElemSegment& elemSegment : ir.elemSegments)
+		{
+			newTemplate->elemSegments.push_back(
+				elemSegment.type == ElemSegment::Type::passive ? elemSegment.contents : nullptr);
+		}
+
+		instanceTemplate = std::move(newTemplate);
+	}
+	return instanceTemplate;
+}
+
+// Creates a module that is compiled with the global object cache and compile options. Unless lazy
+// compilation is enabled or the module is interpreted, the module is compiled before returning.
+static ModuleRef createModule(IR::Module&& irModule,
+							  std::vector<U8>&& wasmBytes,
+							  std::shared_ptr<ObjectCacheInterface>&& objectCache,
+							  const ObjectCacheKeyHash& wasmBytesHash = ObjectCacheKeyHash())
+{
+	ModuleRef module = std::make_shared<Runtime::Module>(std::move(irModule),
+														 std::move(wasmBytes),
+														 std::move(objectCache),
+														 getGlobalCompileOptions(),
+														 wasmBytesHash);
+	if(!getGlobalLazyCompilation() && !module->getInterpreterCode()) { module->getObjectCode(); }
+	return module;
+}
+
+ModuleRef Runtime::compileModule(const IR::Module& irModule)
+{
+	// Get a pointer to the global object cache, if there is one.
+	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
+
+	// If there's an object cache, serialize the IR module to WASM to use as the cache key.
+	std::vector<U8> wasmBytes;
+	if(objectCache)
+	{
 		Timing::Timer keyTimer;
-		std::vector<U8> wasmBytes = WASM::saveBinaryModule(irModule);
+		wasmBytes = WASM::saveBinaryModule(irModule);
 		Timing::logTimer("Created object cache key from IR module", keyTimer);
+	}
 
-		// Check for cached object code for the module before compiling it.
-		objectCode
-			= objectCache->getCachedObject(wasmBytes.data(), wasmBytes.size(), [&irModule]() {
-				  return LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
-			  });
+	return createModule(IR::Module(irModule), std::move(wasmBytes), std::move(objectCache));
+}
+
+ModuleRef Runtime::compileModuleWithOptions(
+	const IR::Module& irModule,
+	const LLVMJIT::CompileOptions& compileOptions,
+	const std::shared_ptr<const std::atomic<bool>>& cancelFlag)
+{
+	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
+
+	// If there's an object cache, serialize the IR module to WASM to use as the cache key. If the
+	// options would generate different code than the global compile options, they are appended to
+	// the key, since the object cache only distinguishes object code compiled with the global
+	// compile options.
+	std::vector<U8> wasmBytes;
+	if(objectCache)
+	{
+		wasmBytes = WASM::saveBinaryModule(irModule);
+
+		const LLVMJIT::CompileOptions globalCompileOptions = getGlobalCompileOptions();
+		std::vector<U8> optionsKey = getCompileOptionsKey(compileOptions);
+		if(compileOptions.specialization)
+		{
+			const std::vector<U8> specializationKey
+				= getSpecializationKey(*compileOptions.specialization);
+			optionsKey.insert(optionsKey.end(), specializationKey.begin(), specializationKey.end());
+		}
+		if(compileOptions.specialization || globalCompileOptions.specialization
+		   || optionsKey != getCompileOptionsKey(globalCompileOptions))
+		{ wasmBytes.insert(wasmBytes.end(), optionsKey.begin(), optionsKey.end()); }
 	}
 
-	return std::make_shared<Runtime::Module>(IR::Module(irModule), std::move(objectCode));
+	ModuleRef module = std::make_shared<Runtime::Module>(
+		IR::Module(irModule), std::move(wasmBytes), std::move(objectCache), compileOptions);
+	if(!module->getInterpreterCode()) { module->getObjectCode(cancelFlag); }
+	return module;
 }
 
 bool Runtime::loadBinaryModule(const U8* wasmBytes,
@@ -64,28 +486,36 @@ bool Runtime::loadBinaryModule(const U8* wasmBytes,
 							   const IR::FeatureSpec& featureSpec,
 							   WASM::LoadError* outError)
 {
-	// Load the module IR.
-	IR::Module irModule(std::move(featureSpec));
-	if(!WASM::loadBinaryModule(wasmBytes, numWASMBytes, irModule, outError)) { return false; }
-
 	// Get a pointer to the global object cache, if there is one.
 	std::shared_ptr<ObjectCacheInterface> objectCache = getGlobalObjectCache();
 
-	std::vector<U8> objectCode;
-	if(!objectCache)
+	// Load the module IR. If the object cache recorded that the module passed validation with the
+	// same feature spec, skip validating its code, which is most of the time spent loading a large
+	// module. Otherwise, record that it passed validation for the next time it's loaded. The
+	// object cache hashes the WASM bytes for the first of these lookups, and the module reuses the
+	// hash to look up its object code.
+	IR::Module irModule(featureSpec);
+	ObjectCacheKeyHash wasmBytesHash;
+	if(objectCache
+	   && objectCache->isValidatedModule(wasmBytes, numWASMBytes, wasmBytesHash, featureSpec))
 	{
-		// If there's no global object cache, just compile the module.
-		objectCode = LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
+		if(!WASM::loadBinaryModuleWithoutValidatingCode(
+			   wasmBytes, numWASMBytes, irModule, outError))
+		{ return false; }
 	}
 	else
 	{
-		// Check for cached object code for the module before compiling it.
-		objectCode = objectCache->getCachedObject(wasmBytes, numWASMBytes, [&irModule]() {
-			return LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec());
-		});
+		if(!WASM::loadBinaryModule(wasmBytes, numWASMBytes, irModule, outError)) { return false; }
+		if(objectCache)
+		{ objectCache->addValidatedModule(wasmBytes, numWASMBytes, wasmBytesHash, featureSpec); }
 	}
 
-	outModule = std::make_shared<Runtime::Module>(std::move(irModule), std::move(objectCode));
+	// If there's an object cache, copy the WASM bytes to use as the cache key.
+	std::vector<U8> wasmBytesCopy;
+	if(objectCache) { wasmBytesCopy.assign(wasmBytes, wasmBytes + numWASMBytes); }
+
+	outModule = createModule(
+		std::move(irModule), std::move(wasmBytesCopy), std::move(objectCache), wasmBytesHash);
 	return true;
 }
 
@@ -95,5 +525,13 @@ ModuleRef Runtime::loadPrecompiledModule(const IR::Module& irModule,
 	return std::make_shared<Module>(IR::Module(irModule), std::vector<U8>(objectCode));
 }
 
+ModuleRef Runtime::loadPrecompiledModule(IR::Module&& irModule, std::vector<U8>&& objectCode)
+{
+	return std::make_shared<Module>(std::move(irModule), std::move(objectCode));
+}
+
 const IR::Module& Runtime::getModuleIR(ModuleConstRefParam module) { return module->ir; }
-std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module) { return module->objectCode; }
+std::vector<U8> Runtime::getObjectCode(ModuleConstRefParam module)
+{
+	return *module->getObjectCode();
+}
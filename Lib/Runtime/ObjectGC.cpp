@@ -6,9 +6,13 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Errors.h"
 #include "WAVM/Inline/Hash.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/HashSet.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
+#include "WAVM/Logging/Trace.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
 
@@ -71,12 +75,26 @@ void Runtime::removeGCRoot(const Object* object) noexcept
 	}
 }
 
+// The garbage collector marks objects concurrently with other threads using the compartment, and
+// only holds the compartment's lock exclusively while it takes a snapshot of the compartment's
+// objects and roots, and while it finishes marking and deletes the unreferenced objects.
+//
+// It marks every object that was reachable when the snapshot was taken: objects created after the
+// snapshot are never deleted by the collection, and references that are overwritten in tables
+// while marking are recorded by setTableElementNonNull so they are still marked. The values of
+// mutable reference globals are captured in the snapshot, since they are written by JIT code
+// that doesn't record the values it overwrites.
 struct GCState
 {
 	Compartment* compartment;
 	HashSet<GCObject*> unreferencedObjects;
 	std::vector<GCObject*> pendingScanObjects;
 
+	// The instances in the compartment when the snapshot was taken, and the values of the mutable
+	// reference globals in each context.
+	HashMap<Uptr, Instance*> instancesById;
+	HashMap<Global*, std::vector<Object*>> mutableGlobalValues;
+
 	GCState(Compartment* inCompartment) : compartment(inCompartment) {}
 
 	void visitReference(Object* object)
@@ -85,12 +103,13 @@ struct GCState
 		{
 			if(object->kind == ObjectKind::function)
 			{
+				// Functions of instances created after the snapshot aren't in instancesById, but
+				// won't be deleted by this collection anyway.
 				Function* function = asFunction(object);
 				if(function->instanceId != UINTPTR_MAX)
 				{
-					WAVM_ASSERT(compartment->instances.contains(function->instanceId));
-					Instance* instance = compartment->instances[function->instanceId];
-					visitReference(instance);
+					Instance** instance = instancesById.get(function->instanceId);
+					if(instance) { visitReference(*instance); }
 				}
 			}
 			else if(unreferencedObjects.remove((GCObject*)object))
@@ -129,6 +148,7 @@ struct GCState
 			const Uptr numElements = getTableNumElements(table);
 			for(Uptr elementIndex = 0; elementIndex < numElements; ++elementIndex)
 			{ visitReference(getTableElement(table, elementIndex)); }
+			for(Object* element : table->resetElements) { visitReference(element); }
 			break;
 		}
 		case ObjectKind::global: {
@@ -137,14 +157,10 @@ struct GCState
 			{
 				if(global->type.isMutable)
 				{
-					visitReference(
-						compartment->initialContextMutableGlobals[global->mutableGlobalIndex]
-							.object);
-					for(Context* context : compartment->contexts)
+					const std::vector<Object*>* values = mutableGlobalValues.get(global);
+					if(values)
 					{
-						visitReference(
-							context->runtimeData->mutableGlobals[global->mutableGlobalIndex]
-								.object);
+						for(Object* value : *values) { visitReference(value); }
 					}
 				}
 				visitReference(global->initialValue.object);
@@ -175,74 +191,201 @@ struct GCState
 		default: WAVM_UNREACHABLE();
 		};
 	}
+
+	// Scans objects until there are no more pending objects to scan.
+	void scanPendingObjects()
+	{
+		while(pendingScanObjects.size())
+		{
+			GCObject* object = pendingScanObjects.back();
+			pendingScanObjects.pop_back();
+			scanObject(object);
+		};
+	}
+
+	// Visits the references that were overwritten in tables since the last call. If stopMarking
+	// is true, also stops recording overwritten references.
+	bool visitOverwrittenReferences(bool stopMarking)
+	{
+		std::vector<Object*> overwrittenReferences;
+		{
+			Platform::Mutex::Lock overwrittenReferencesLock(
+				compartment->gcOverwrittenReferencesMutex);
+			if(stopMarking) { compartment->isGCMarking.store(false, std::memory_order_seq_cst); }
+			overwrittenReferences = std::move(compartment->gcOverwrittenReferences);
+			compartment->gcOverwrittenReferences.clear();
+		}
+		for(Object* object : overwrittenReferences) { visitReference(object); }
+		return overwrittenReferences.size() > 0;
+	}
 };
 
+// Returns true if the instance has a function that is referenced by a root.
+static bool hasRootFunction(const Instance* instance)
+{
+	for(Function* function : instance->functions)
+	{
+		if(function && function->mutableData->numRootReferences
+		   && function->instanceId == instance->id)
+		{ return true; }
+	}
+	return false;
+}
+
+// Captures the values of a mutable reference global in the initial context state and in each
+// context.
+static void captureMutableGlobalValues(GCState& state, Global* global)
+{
+	Compartment* compartment = state.compartment;
+	std::vector<Object*>& values = state.mutableGlobalValues.getOrAdd(global);
+	values.push_back(compartment->initialContextMutableGlobals[global->mutableGlobalIndex].object);
+	for(Context* context : compartment->contexts)
+	{ values.push_back(context->runtimeData->mutableGlobals[global->mutableGlobalIndex].object); }
+	if(global->hasResetValue) { values.push_back(global->resetValue.object); }
+}
+
+// Makes all the compartment's objects old, and forgets which tables were written.
+static void clearYoungObjects(Compartment* compartment)
+{
+	for(GCObject* object : compartment->youngObjects) { object->isYoung = false; }
+	compartment->youngObjects.clear();
+	compartment->numObjectsSinceGC.store(0, std::memory_order_relaxed);
+
+	Platform::Mutex::Lock rememberedTablesLock(compartment->rememberedTablesMutex);
+	for(Table* table : compartment->rememberedTables)
+	{ table->isRemembered.store(false, std::memory_order_relaxed); }
+	compartment->rememberedTables.clear();
+}
+
+void Runtime::addYoungObject(GCObject* object)
+{
+	Compartment* compartment = object->compartment;
+	WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
+	WAVM_ASSERT(!object->isYoung);
+	object->isYoung = true;
+	compartment->youngObjects.addOrFail(object);
+
+	// Wake the background collector when the number of instances, memories and tables created
+	// since the last collection reaches the compartment's threshold.
+	if(object->kind == ObjectKind::instance || object->kind == ObjectKind::memory
+	   || object->kind == ObjectKind::table)
+	{
+		const Uptr threshold
+			= compartment->backgroundGCObjectThreshold.load(std::memory_order_relaxed);
+		if(compartment->numObjectsSinceGC.fetch_add(1, std::memory_order_relaxed) + 1 == threshold)
+		{ wakeBackgroundGC(); }
+	}
+}
+
+void Runtime::rememberTableWrite(Table* table)
+{
+	Compartment* compartment = table->compartment;
+	Platform::Mutex::Lock rememberedTablesLock(compartment->rememberedTablesMutex);
+	if(!table->isRemembered.load(std::memory_order_relaxed))
+	{
+		table->isRemembered.store(true, std::memory_order_relaxed);
+		compartment->rememberedTables.addOrFail(table);
+	}
+}
+
+static Metrics::Histogram& gcNanoseconds = Metrics::getHistogram(
+	"wavm_gc_nanoseconds",
+	"Time spent collecting a compartment's garbage, including concurrent marking");
+static Metrics::Histogram& gcPauseNanoseconds = Metrics::getHistogram(
+	"wavm_gc_pause_nanoseconds",
+	"Time that a garbage collection held the compartment lock for, for each pause");
+
 static bool collectGarbageImpl(Compartment* compartment)
 {
-	Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+	Platform::Mutex::Lock gcLock(compartment->gcMutex);
+	Trace::Scope traceScope("runtime", "gc");
 	Timing::Timer timer;
 
 	GCState state(compartment);
-
-	// Initialize the GC state from the compartment's various sets of objects.
-	state.initGCObject(compartment);
-	for(Instance* instance : compartment->instances)
+	Uptr numInitialObjects;
+	Uptr numRoots;
+	F64 pauseMilliseconds;
 	{
-		if(instance)
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Timing::Timer pauseTimer;
+
+		// Initialize the GC state from the compartment's various sets of objects.
+		state.initGCObject(compartment);
+		for(Instance* instance : compartment->instances)
 		{
-			// Transfer root markings from functions to their instance.
-			bool hasRootFunction = false;
-			for(Function* function : instance->functions)
+			if(instance)
 			{
-				if(function && function->mutableData->numRootReferences
-				   && function->instanceId == instance->id)
-				{
-					hasRootFunction = true;
-					break;
-				}
+				state.instancesById.add(instance->id, instance);
+
+				// Transfer root markings from functions to their instance.
+				state.initGCObject(instance, hasRootFunction(instance));
 			}
+		}
+		for(Memory* memory : compartment->memories) { state.initGCObject(memory); }
+		for(Table* table : compartment->tables) { state.initGCObject(table); }
+		for(ExceptionType* exceptionType : compartment->exceptionTypes)
+		{ state.initGCObject(exceptionType); }
+		for(Global* global : compartment->globals)
+		{
+			state.initGCObject(global);
 
-			state.initGCObject(instance, hasRootFunction);
+			if(global->type.isMutable && isReferenceType(global->type.valueType))
+			{ captureMutableGlobalValues(state, global); }
 		}
+		for(Context* context : compartment->contexts) { state.initGCObject(context); }
+
+		numInitialObjects = state.pendingScanObjects.size() + state.unreferencedObjects.size();
+		numRoots = state.pendingScanObjects.size();
+
+		// All the objects in the snapshot are old after this collection.
+		clearYoungObjects(compartment);
+
+		compartment->isGCMarking.store(true, std::memory_order_seq_cst);
+		pauseMilliseconds = pauseTimer.getMilliseconds();
+		gcPauseNanoseconds.record(U64(pauseTimer.getNanoseconds()));
 	}
-	for(Memory* memory : compartment->memories) { state.initGCObject(memory); }
-	for(Table* table : compartment->tables) { state.initGCObject(table); }
-	for(ExceptionType* exceptionType : compartment->exceptionTypes)
-	{ state.initGCObject(exceptionType); }
-	for(Global* global : compartment->globals) { state.initGCObject(global); }
-	for(Context* context : compartment->contexts) { state.initGCObject(context); }
 
 	// Scan the objects added to the referenced set so far: gather their child references and
-	// recurse.
-	const Uptr numInitialObjects
-		= state.pendingScanObjects.size() + state.unreferencedObjects.size();
-	const Uptr numRoots = state.pendingScanObjects.size();
-	while(state.pendingScanObjects.size())
+	// recurse. This is done without holding the compartment lock, so other threads can keep
+	// creating objects in the compartment and writing to its tables in the meantime.
+	do
 	{
-		GCObject* object = state.pendingScanObjects.back();
-		state.pendingScanObjects.pop_back();
-		state.scanObject(object);
-	};
+		state.scanPendingObjects();
+	} while(state.visitOverwrittenReferences(false));
 
-	// Delete each unreferenced object that isn't the compartment.
 	bool wasCompartmentUnreferenced = false;
-	for(GCObject* object : state.unreferencedObjects)
 	{
-		if(object == compartment) { wasCompartmentUnreferenced = true; }
-		else
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Timing::Timer pauseTimer;
+
+		// Finish scanning the references that were overwritten since the last check.
+		state.visitOverwrittenReferences(true);
+		state.scanPendingObjects();
+
+		// Delete each unreferenced object that isn't the compartment.
+		for(GCObject* object : state.unreferencedObjects)
 		{
-			delete object;
+			if(object == compartment) { wasCompartmentUnreferenced = true; }
+			else
+			{
+				delete object;
+			}
 		}
+
+		pauseMilliseconds += pauseTimer.getMilliseconds();
+		gcPauseNanoseconds.record(U64(pauseTimer.getNanoseconds()));
 	}
 
 	// Delete the compartment last, if it wasn't referenced.
-	compartmentLock.unlock();
+	gcLock.unlock();
 	if(wasCompartmentUnreferenced) { delete compartment; }
 
+	gcNanoseconds.record(U64(timer.getNanoseconds()));
 	Log::printf(Log::metrics,
-				"Collected garbage in %.2fms: %" WAVM_PRIuPTR " roots, %" WAVM_PRIuPTR
-				" objects, %" WAVM_PRIuPTR " garbage\n",
+				"Collected garbage in %.2fms (%.2fms paused): %" WAVM_PRIuPTR
+				" roots, %" WAVM_PRIuPTR " objects, %" WAVM_PRIuPTR " garbage\n",
 				timer.getMilliseconds(),
+				pauseMilliseconds,
 				numRoots,
 				numInitialObjects,
 				Uptr(state.unreferencedObjects.size()));
@@ -255,9 +398,97 @@ void Runtime::collectCompartmentGarbage(Compartment* compartment)
 	collectGarbageImpl(compartment);
 }
 
+void Runtime::collectYoungCompartmentGarbage(Compartment* compartment)
+{
+	Platform::Mutex::Lock gcLock(compartment->gcMutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+	Trace::Scope traceScope("runtime", "young gc");
+	Timing::Timer timer;
+
+	GCState state(compartment);
+
+	// Only the young objects are candidates for collection: old objects are assumed to be alive.
+	for(GCObject* object : compartment->youngObjects)
+	{
+		switch(object->kind)
+		{
+		case ObjectKind::instance: {
+			Instance* instance = asInstance(object);
+			state.instancesById.add(instance->id, instance);
+			state.initGCObject(instance, hasRootFunction(instance));
+			break;
+		}
+		case ObjectKind::global: {
+			Global* global = asGlobal(object);
+			state.initGCObject(global);
+			if(global->type.isMutable && isReferenceType(global->type.valueType))
+			{ captureMutableGlobalValues(state, global); }
+			break;
+		}
+
+		case ObjectKind::table:
+		case ObjectKind::memory:
+		case ObjectKind::exceptionType:
+		case ObjectKind::context: state.initGCObject(object); break;
+
+		case ObjectKind::function:
+		case ObjectKind::compartment:
+		case ObjectKind::foreign:
+		case ObjectKind::invalid:
+		default: WAVM_UNREACHABLE();
+		};
+	}
+	const Uptr numYoungObjects
+		= state.pendingScanObjects.size() + state.unreferencedObjects.size();
+
+	// References from old objects to young objects are also roots. Old instances can't reference
+	// younger objects, so the only such references are in tables that were written since the
+	// last collection, and in reference globals.
+	{
+		Platform::Mutex::Lock rememberedTablesLock(compartment->rememberedTablesMutex);
+		for(Table* table : compartment->rememberedTables)
+		{
+			if(!table->isYoung) { state.scanObject(table); }
+		}
+	}
+	for(Global* global : compartment->globals)
+	{
+		if(!global->isYoung && isReferenceType(global->type.valueType))
+		{
+			state.visitReference(global->initialValue.object);
+			if(global->type.isMutable)
+			{
+				state.visitReference(
+					compartment->initialContextMutableGlobals[global->mutableGlobalIndex].object);
+				for(Context* context : compartment->contexts)
+				{
+					state.visitReference(
+						context->runtimeData->mutableGlobals[global->mutableGlobalIndex].object);
+				}
+				if(global->hasResetValue) { state.visitReference(global->resetValue.object); }
+			}
+		}
+	}
+
+	// Scan the young objects that are referenced, and delete the rest.
+	state.scanPendingObjects();
+	for(GCObject* object : state.unreferencedObjects) { delete object; }
+
+	// The young objects that survived the collection are now old.
+	clearYoungObjects(compartment);
+
+	Log::printf(Log::metrics,
+				"Collected young garbage in %.2fms: %" WAVM_PRIuPTR " young objects, %" WAVM_PRIuPTR
+				" garbage\n",
+				timer.getMilliseconds(),
+				numYoungObjects,
+				Uptr(state.unreferencedObjects.size()));
+}
+
 bool Runtime::tryCollectCompartment(GCPointer<Compartment>&& compartmentRootRef)
 {
 	Compartment* compartment = &*compartmentRootRef;
+	disableBackgroundGC(compartment);
 	compartmentRootRef = nullptr;
 	return collectGarbageImpl(compartment);
 }
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Signal.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+struct Runtime::Profiler
+{
+	// The instruction addresses of the samples. The signal handler that records a sample can't
+	// allocate memory or take locks, so the array is allocated up front, and the samples are only
+	// attributed to functions when the profiler is stopped.
+	std::vector<Uptr> sampleIPs;
+	std::atomic<Uptr> numSamples{0};
+
+	Profiler(Uptr maxSamples) : sampleIPs(maxSamples) {}
+};
+
+static std::atomic<Profiler*> runningProfiler{nullptr};
+
+static void recordSample(Uptr ip)
+{
+	Profiler* profiler = runningProfiler.load(std::memory_order_acquire);
+	if(!profiler) { return; }
+
+	const Uptr sampleIndex = profiler->numSamples.fetch_add(1, std::memory_order_relaxed);
+	if(sampleIndex < profiler->sampleIPs.size()) { profiler->sampleIPs[sampleIndex] = ip; }
+}
+
+Profiler* Runtime::startProfiler(U32 samplesPerSecond, Uptr maxSamples)
+{
+	WAVM_ERROR_UNLESS(samplesPerSecond > 0);
+
+	Profiler* profiler = new Profiler(maxSamples);
+	Profiler* expectedProfiler = nullptr;
+	if(!runningProfiler.compare_exchange_strong(expectedProfiler, profiler))
+	{
+		delete profiler;
+		return nullptr;
+	}
+
+	if(!Platform::startSampling(samplesPerSecond, recordSample))
+	{
+		runningProfiler.store(nullptr, std::memory_order_release);
+		delete profiler;
+		return nullptr;
+	}
+
+	return profiler;
+}
+
+std::string Runtime::stopProfiler(Profiler* profiler)
+{
+	WAVM_ASSERT(runningProfiler.load(std::memory_order_acquire) == profiler);
+
+	// Stop sampling, which waits for any samples that are being recorded.
+	Platform::stopSampling();
+	runningProfiler.store(nullptr, std::memory_order_release);
+
+	const Uptr numSamples = profiler->numSamples.load(std::memory_order_acquire);
+	const Uptr numRecordedSamples = std::min(numSamples, profiler->sampleIPs.size());
+
+	// Count the samples in each function and operator. Use an ordered map so the output is
+	// deterministic.
+	std::map<std::string, Uptr> stackCounts;
+	for(Uptr sampleIndex = 0; sampleIndex < numRecordedSamples; ++sampleIndex)
+	{
+		InstructionSource source;
+		std::string stack;
+		if(!getInstructionSourceByAddress(profiler->sampleIPs[sampleIndex], source))
+		{ stack = "<unknown>"; }
+		else if(source.type == InstructionSource::Type::wasm)
+		{
+			stack = source.wasm.function->mutableData->debugName + ";op "
+					+ std::to_string(source.wasm.instructionIndex);
+		}
+		else
+		{
+			// Attribute samples in host code to the function, not the instruction.
+			stack = "host!" + source.native.module;
+			if(source.native.function.size()) { stack += ";" + source.native.function; }
+		}
+		++stackCounts[stack];
+	}
+	if(numSamples > numRecordedSamples)
+	{ stackCounts["<dropped>"] = numSamples - numRecordedSamples; }
+
+	delete profiler;
+
+	std::string result;
+	for(const auto& stackCount : stackCounts)
+	{
+		result += stackCount.first;
+		result += ' ';
+		result += std::to_string(stackCount.second);
+		result += '\n';
+	}
+	return result;
+}
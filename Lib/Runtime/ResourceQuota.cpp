@@ -1,3 +1,4 @@
+#include <atomic>
 #include <memory>
 #include "RuntimePrivate.h"
 #include "WAVM/Platform/Mutex.h"
@@ -8,6 +9,15 @@ using namespace WAVM::Runtime;
 
 ResourceQuotaRef Runtime::createResourceQuota() { return std::make_shared<ResourceQuota>(); }
 
+Uptr Runtime::getResourceQuotaReservationSlotIndex()
+{
+	// Assign each thread a slot the first time it uses one, round-robin.
+	static std::atomic<Uptr> nextSlotIndex{0};
+	thread_local Uptr slotIndex
+		= nextSlotIndex.fetch_add(1, std::memory_order_relaxed) % ResourceQuota::numReservationSlots;
+	return slotIndex;
+}
+
 Uptr Runtime::getResourceQuotaMaxTableElems(ResourceQuotaConstRefParam resourceQuota)
 {
 	return resourceQuota->tableElems.getMax();
@@ -23,6 +33,12 @@ void Runtime::setResourceQuotaMaxTableElems(ResourceQuotaRefParam resourceQuota,
 	resourceQuota->tableElems.setMax(maxTableElems);
 }
 
+void Runtime::setResourceQuotaTableElemsReservationChunk(ResourceQuotaRefParam resourceQuota,
+														 Uptr numTableElems)
+{
+	resourceQuota->tableElems.setReservationChunk(numTableElems);
+}
+
 Uptr Runtime::getResourceQuotaMaxMemoryPages(ResourceQuotaConstRefParam resourceQuota)
 {
 	return resourceQuota->memoryPages.getMax();
@@ -38,3 +54,41 @@ void Runtime::setResourceQuotaMaxMemoryPages(ResourceQuotaRefParam resourceQuota
 {
 	resourceQuota->memoryPages.setMax(maxMemoryPages);
 }
+
+void Runtime::setResourceQuotaMemoryPagesReservationChunk(ResourceQuotaRefParam resourceQuota,
+														  Uptr numMemoryPages)
+{
+	resourceQuota->memoryPages.setReservationChunk(numMemoryPages);
+}
+
+U64 Runtime::getResourceQuotaMaxFuel(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->fuel.getMax();
+}
+
+U64 Runtime::getResourceQuotaCurrentFuel(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->fuel.getCurrent();
+}
+
+void Runtime::setResourceQuotaMaxFuel(ResourceQuotaRefParam resourceQuota, U64 maxFuel)
+{
+	resourceQuota->fuel.setMax(maxFuel);
+}
+
+void Runtime::setResourceQuotaFuelRefillAmount(ResourceQuotaRefParam resourceQuota,
+											   U64 fuelRefillAmount)
+{
+	resourceQuota->fuelRefillAmount.store(fuelRefillAmount, std::memory_order_relaxed);
+}
+
+bool Runtime::getResourceQuotaPrefaultMemories(ResourceQuotaConstRefParam resourceQuota)
+{
+	return resourceQuota->prefaultMemories.load(std::memory_order_relaxed);
+}
+
+void Runtime::setResourceQuotaPrefaultMemories(ResourceQuotaRefParam resourceQuota,
+											   bool prefaultMemories)
+{
+	resourceQuota->prefaultMemories.store(prefaultMemories, std::memory_order_relaxed);
+}
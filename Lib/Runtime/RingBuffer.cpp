@@ -0,0 +1,269 @@
+#include "WAVM/Runtime/RingBuffer.h"
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "RuntimePrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Runtime/GuestRingBuffer.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::Runtime;
+
+static_assert(sizeof(wavm_ring_buffer_header) == WAVM_RING_BUFFER_HEADER_BYTES,
+			  "wavm_ring_buffer_header isn't the expected size");
+
+static constexpr Uptr writeIndexOffset = offsetof(wavm_ring_buffer_header, write_index);
+static constexpr Uptr consumerWaitingOffset = offsetof(wavm_ring_buffer_header, consumer_waiting);
+static constexpr Uptr readIndexOffset = offsetof(wavm_ring_buffer_header, read_index);
+static constexpr Uptr producerWaitingOffset = offsetof(wavm_ring_buffer_header, producer_waiting);
+
+// The header fields are shared with the guest, so they are accessed atomically through the
+// pointers into the memory. The indices are always multiples of 4, so a record's size can be read
+// at any index without crossing the end of the data. If the guest corrupts the indices, the ring
+// buffer is reported as an out-of-bounds access.
+static std::atomic<U32>& getHeaderField(U8* header, Uptr offset)
+{
+	static_assert(sizeof(std::atomic<U32>) == sizeof(U32), "relying on non-standard behavior");
+	return *(std::atomic<U32>*)(header + offset);
+}
+
+[[noreturn]] static void throwCorruptRingBuffer(Memory* memory, Uptr address)
+{
+	throwException(ExceptionTypes::outOfBoundsMemoryAccess, {asObject(memory), U64(address)});
+}
+
+static bool isValidNumDataBytes(U32 numDataBytes)
+{
+	return numDataBytes >= WAVM_RING_BUFFER_MIN_DATA_BYTES
+		   && numDataBytes <= WAVM_RING_BUFFER_MAX_DATA_BYTES
+		   && !(numDataBytes & (numDataBytes - 1));
+}
+
+void MemoryRingBuffer::init(Memory* memory, Uptr address, U32 numDataBytes)
+{
+	if(address & (WAVM_RING_BUFFER_ALIGNMENT - 1) || !isValidNumDataBytes(numDataBytes))
+	{ throwCorruptRingBuffer(memory, address); }
+
+	U8* header = getValidatedMemoryOffsetRange(
+		memory, address, WAVM_RING_BUFFER_HEADER_BYTES + Uptr(numDataBytes));
+	unwindSignalsAsExceptions([header, numDataBytes] {
+		bytewiseMemSet(header, 0, WAVM_RING_BUFFER_HEADER_BYTES);
+		getHeaderField(header, offsetof(wavm_ring_buffer_header, num_data_bytes))
+			.store(numDataBytes);
+	});
+}
+
+MemoryRingBuffer::MemoryRingBuffer(Memory* inMemory, Uptr inAddress)
+: memory(inMemory), address(inAddress)
+{
+	if(address & (WAVM_RING_BUFFER_ALIGNMENT - 1)) { throwCorruptRingBuffer(memory, address); }
+
+	// Read the size of the data once, so the guest can't change it afterward.
+	U8* header = getValidatedMemoryOffsetRange(memory, address, WAVM_RING_BUFFER_HEADER_BYTES);
+	unwindSignalsAsExceptions([this, header] {
+		numDataBytes
+			= getHeaderField(header, offsetof(wavm_ring_buffer_header, num_data_bytes)).load();
+	});
+	if(!isValidNumDataBytes(numDataBytes)) { throwCorruptRingBuffer(memory, address); }
+
+	getHeader();
+}
+
+U8* MemoryRingBuffer::getHeader() const
+{
+	return getValidatedMemoryOffsetRange(
+		memory, address, WAVM_RING_BUFFER_HEADER_BYTES + Uptr(numDataBytes));
+}
+
+Uptr MemoryRingBuffer::tryWrite(const RingBufferMessage* messages, Uptr numMessages)
+{
+	Uptr numWrittenMessages = 0;
+	bool isCorrupt = false;
+	U8* header = getHeader();
+	U8* data = header + WAVM_RING_BUFFER_HEADER_BYTES;
+	unwindSignalsAsExceptions([&] {
+		const U32 readIndex = getHeaderField(header, readIndexOffset).load();
+		const U32 originalWriteIndex = getHeaderField(header, writeIndexOffset).load();
+		if((originalWriteIndex | readIndex) & 3 || originalWriteIndex - readIndex > numDataBytes)
+		{
+			isCorrupt = true;
+			return;
+		}
+
+		U32 writeIndex = originalWriteIndex;
+		for(; numWrittenMessages < numMessages; ++numWrittenMessages)
+		{
+			const RingBufferMessage& message = messages[numWrittenMessages];
+			if(message.numBytes > getMaxMessageBytes()) { break; }
+
+			U32 position = writeIndex & (numDataBytes - 1);
+			const U32 numContiguousBytes = numDataBytes - position;
+			const U32 numRecordBytes = wavm_ring_buffer_record_bytes(message.numBytes);
+			const U32 numNeededBytes = numRecordBytes <= numContiguousBytes
+										   ? numRecordBytes
+										   : numContiguousBytes + numRecordBytes;
+			if(numDataBytes - (writeIndex - readIndex) < numNeededBytes) { break; }
+
+			if(numRecordBytes > numContiguousBytes)
+			{
+				const U32 skipMarker = WAVM_RING_BUFFER_SKIP_MARKER;
+				memcpy(data + position, &skipMarker, sizeof(U32));
+				writeIndex += numContiguousBytes;
+				position = 0;
+			}
+			memcpy(data + position, &message.numBytes, sizeof(U32));
+			bytewiseMemCopy(
+				data + position + sizeof(U32), (const U8*)message.data, message.numBytes);
+			writeIndex += numRecordBytes;
+		}
+
+		// Publish the messages, and wake the consumer if it's waiting for them.
+		if(writeIndex != originalWriteIndex)
+		{
+			getHeaderField(header, writeIndexOffset).store(writeIndex);
+			if(getHeaderField(header, consumerWaitingOffset).load())
+			{
+				getHeaderField(header, consumerWaitingOffset).store(0);
+				atomicNotify(memory, address + writeIndexOffset, UINT32_MAX);
+			}
+		}
+	});
+	if(isCorrupt) { throwCorruptRingBuffer(memory, address); }
+	return numWrittenMessages;
+}
+
+Uptr MemoryRingBuffer::write(const RingBufferMessage* messages,
+							 Uptr numMessages,
+							 I64 timeoutNanoseconds)
+{
+	Uptr numWrittenMessages = 0;
+	while(true)
+	{
+		numWrittenMessages
+			+= tryWrite(messages + numWrittenMessages, numMessages - numWrittenMessages);
+		if(numWrittenMessages == numMessages
+		   || messages[numWrittenMessages].numBytes > getMaxMessageBytes())
+		{ break; }
+
+		// Tell the consumer that the producer is waiting for it to read some messages, then check
+		// whether it read any before it could see that.
+		U32 readIndex = 0;
+		bool isFull = false;
+		U8* header = getHeader();
+		unwindSignalsAsExceptions([&] {
+			readIndex = getHeaderField(header, readIndexOffset).load();
+			getHeaderField(header, producerWaitingOffset).store(1);
+			isFull = getHeaderField(header, readIndexOffset).load() == readIndex;
+		});
+		if(isFull
+		   && atomicWait32(memory, address + readIndexOffset, readIndex, timeoutNanoseconds) == 2)
+		{
+			// The wait timed out, so write what fits before returning.
+			numWrittenMessages
+				+= tryWrite(messages + numWrittenMessages, numMessages - numWrittenMessages);
+			break;
+		}
+	}
+	return numWrittenMessages;
+}
+
+Uptr MemoryRingBuffer::read(const std::function<void(const U8* data, U32 numBytes)>& visitMessage,
+							Uptr maxMessages)
+{
+	Uptr numReadMessages = 0;
+	bool isCorrupt = false;
+	U8* header = getHeader();
+	U8* data = header + WAVM_RING_BUFFER_HEADER_BYTES;
+	unwindSignalsAsExceptions([&] {
+		const U32 writeIndex = getHeaderField(header, writeIndexOffset).load();
+		const U32 originalReadIndex = getHeaderField(header, readIndexOffset).load();
+		if((writeIndex | originalReadIndex) & 3 || writeIndex - originalReadIndex > numDataBytes)
+		{
+			isCorrupt = true;
+			return;
+		}
+
+		U32 readIndex = originalReadIndex;
+		while(readIndex != writeIndex && numReadMessages < maxMessages)
+		{
+			const U32 position = readIndex & (numDataBytes - 1);
+			const U32 numContiguousBytes = numDataBytes - position;
+			U32 numMessageBytes;
+			memcpy(&numMessageBytes, data + position, sizeof(U32));
+			if(numMessageBytes == WAVM_RING_BUFFER_SKIP_MARKER)
+			{
+				if(numContiguousBytes > writeIndex - readIndex)
+				{
+					isCorrupt = true;
+					break;
+				}
+				readIndex += numContiguousBytes;
+				continue;
+			}
+
+			// Check that the message is within the written part of the data, so a message size
+			// written by the guest can't make visitMessage read outside the ring buffer.
+			if(numMessageBytes > getMaxMessageBytes())
+			{
+				isCorrupt = true;
+				break;
+			}
+			const U32 numRecordBytes = wavm_ring_buffer_record_bytes(numMessageBytes);
+			if(numRecordBytes > numContiguousBytes || numRecordBytes > writeIndex - readIndex)
+			{
+				isCorrupt = true;
+				break;
+			}
+
+			visitMessage(data + position + sizeof(U32), numMessageBytes);
+			readIndex += numRecordBytes;
+			++numReadMessages;
+
+			// visitMessage may have grown the memory, which may have moved it.
+			header = getHeader();
+			data = header + WAVM_RING_BUFFER_HEADER_BYTES;
+		}
+
+		// Free the messages' space, and wake the producer if it's waiting for it.
+		if(readIndex != originalReadIndex)
+		{
+			getHeaderField(header, readIndexOffset).store(readIndex);
+			if(getHeaderField(header, producerWaitingOffset).load())
+			{
+				getHeaderField(header, producerWaitingOffset).store(0);
+				atomicNotify(memory, address + readIndexOffset, UINT32_MAX);
+			}
+		}
+	});
+	if(isCorrupt) { throwCorruptRingBuffer(memory, address); }
+	return numReadMessages;
+}
+
+bool MemoryRingBuffer::waitForMessages(I64 timeoutNanoseconds)
+{
+	U32 readIndex = 0;
+	U32 writeIndex = 0;
+	U8* header = getHeader();
+	unwindSignalsAsExceptions([&] {
+		readIndex = getHeaderField(header, readIndexOffset).load();
+		writeIndex = getHeaderField(header, writeIndexOffset).load();
+		if(writeIndex == readIndex)
+		{
+			// Tell the producer that the consumer is waiting for messages, then check whether it
+			// wrote any before it could see that.
+			getHeaderField(header, consumerWaitingOffset).store(1);
+			writeIndex = getHeaderField(header, writeIndexOffset).load();
+		}
+	});
+	if(writeIndex != readIndex) { return true; }
+
+	atomicWait32(memory, address + writeIndexOffset, writeIndex, timeoutNanoseconds);
+
+	header = getHeader();
+	unwindSignalsAsExceptions(
+		[&] { writeIndex = getHeaderField(header, writeIndexOffset).load(); });
+	return writeIndex != readIndex;
+}
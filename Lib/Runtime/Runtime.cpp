@@ -101,6 +101,11 @@ const std::string& Runtime::getDebugName(const Runtime::Object* object)
 Runtime::GCObject::~GCObject()
 {
 	WAVM_ASSERT(numRootReferences.load(std::memory_order_acquire) == 0);
+	if(isYoung)
+	{
+		WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(compartment->mutex);
+		compartment->youngObjects.removeOrFail(this);
+	}
 	if(finalizeUserData) { (*finalizeUserData)(userData); }
 }
 
@@ -165,7 +170,7 @@ Instance* Runtime::getInstanceFromRuntimeData(ContextRuntimeData* contextRuntime
 											  Uptr instanceId)
 {
 	Compartment* compartment = getCompartmentRuntimeData(contextRuntimeData)->compartment;
-	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 	WAVM_ASSERT(compartment->instances.contains(instanceId));
 	return compartment->instances[instanceId];
 }
@@ -173,7 +178,7 @@ Instance* Runtime::getInstanceFromRuntimeData(ContextRuntimeData* contextRuntime
 Table* Runtime::getTableFromRuntimeData(ContextRuntimeData* contextRuntimeData, Uptr tableId)
 {
 	Compartment* compartment = getCompartmentRuntimeData(contextRuntimeData)->compartment;
-	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 	WAVM_ASSERT(compartment->tables.contains(tableId));
 	return compartment->tables[tableId];
 }
@@ -181,7 +186,7 @@ Table* Runtime::getTableFromRuntimeData(ContextRuntimeData* contextRuntimeData,
 Memory* Runtime::getMemoryFromRuntimeData(ContextRuntimeData* contextRuntimeData, Uptr memoryId)
 {
 	Compartment* compartment = getCompartmentRuntimeData(contextRuntimeData)->compartment;
-	Platform::RWMutex::ShareableLock compartmentLock(compartment->mutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 	return compartment->memories[memoryId];
 }
 
@@ -194,7 +199,7 @@ Foreign* Runtime::createForeign(Compartment* compartment,
 	setUserData(foreign, userData, finalizer);
 
 	{
-		Platform::RWMutex::ExclusiveLock lock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock lock(compartment->mutex);
 		foreign->id = compartment->foreigns.add(UINTPTR_MAX, foreign);
 		if(foreign->id == UINTPTR_MAX)
 		{
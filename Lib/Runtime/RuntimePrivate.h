@@ -3,6 +3,7 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <vector>
 #include "WAVM/IR/Module.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/DenseStaticIntSet.h"
@@ -10,8 +11,13 @@
 #include "WAVM/Inline/HashSet.h"
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
@@ -22,11 +28,16 @@ namespace WAVM { namespace Intrinsics {
 
 namespace WAVM { namespace Runtime {
 
+	struct InterpreterModuleCode;
+
 	// A private base class for all runtime objects that are garbage collected.
 	struct GCObject : Object
 	{
 		Compartment* const compartment;
 		mutable std::atomic<Uptr> numRootReferences{0};
+
+		// True if the object was added to the compartment since its last garbage collection.
+		bool isYoung{false};
 		void* userData{nullptr};
 		void (*finalizeUserData)(void*);
 		std::string debugName;
@@ -47,12 +58,27 @@ namespace WAVM { namespace Runtime {
 		const IR::TableType type;
 
 		Element* elements = nullptr;
+
+		// True if the table's elements were written since the compartment's last garbage
+		// collection, and it is in the compartment's rememberedTables.
+		std::atomic<bool> isRemembered{false};
 		Uptr numReservedBytes = 0;
 		Uptr numReservedElements = 0;
 
+		// The number of bytes at the start of the elements array that are committed. Growing the
+		// table commits pages ahead of its size, so most grows don't need to commit any pages.
+		// Written with resizingMutex exclusively locked.
+		std::atomic<Uptr> numCommittedBytes{0};
+
 		mutable Platform::RWMutex resizingMutex;
 		std::atomic<Uptr> numElements{0};
 
+		// If the table's state was captured by captureInstanceResetState, the elements that
+		// resetInstance restores it to, with null for uninitialized elements. Guarded by
+		// resizingMutex.
+		bool hasResetElements = false;
+		std::vector<Object*> resetElements;
+
 		ResourceQuotaRef resourceQuota;
 
 		Table(Compartment* inCompartment,
@@ -81,9 +107,58 @@ namespace WAVM { namespace Runtime {
 		U8* baseAddress = nullptr;
 		Uptr numReservedBytes = 0;
 
+		// The unaligned base address and alignment that were passed to
+		// Platform::allocateAlignedVirtualPages to reserve the memory's address space.
+		U8* unalignedBaseAddress = nullptr;
+		Uptr baseAddressAlignmentLog2 = 0;
+
+		// If the memory was allocated from a pool, the pool and the index of its slot, and the
+		// protection key its pages are tagged with, or -1 if the pool doesn't use protection keys.
+		MemoryPoolRef memoryPool;
+		Uptr memoryPoolSlotIndex = UINTPTR_MAX;
+		I32 protectionKey = -1;
+
+		// If non-null, a snapshot that the memory's pages were mapped copy-on-write to when it or
+		// the memory it was cloned from was cloned. Guarded by resizingMutex.
+		std::shared_ptr<Platform::PageSnapshot> snapshot;
+
+		// True if a file has been mapped into the memory by mapFileToMemory, so its pages may not
+		// all be writable. Guarded by resizingMutex.
+		bool hasMappedFiles = false;
+
+		// True if any of the memory's pages have been mapped to a snapshot, so they may not all be
+		// private anonymous pages. Guarded by resizingMutex.
+		bool hasMappedSnapshots = false;
+
+		// If the memory is a lazy clone, the mapping that copies its pages from the snapshot, and
+		// the pages that its own lazy clones prefetch. Guarded by resizingMutex.
+		Platform::LazyPageMapping* lazyPageMapping = nullptr;
+		std::vector<Uptr> clonePrefetchPageIndices;
+
+		// If the memory's state was captured by captureInstanceResetState, the number of pages
+		// resetInstance shrinks it to, and either the snapshot that the pages' contents are
+		// restored from, or a copy of their contents if the memory couldn't be snapshotted. The
+		// memory's pages are still mapped to the snapshot if memory->snapshot is the same.
+		// Guarded by resizingMutex.
+		Uptr resetNumPages = UINTPTR_MAX;
+		std::shared_ptr<Platform::PageSnapshot> resetSnapshot;
+		std::vector<U8> resetBytes;
+
+		// Whether the pages that growMemory commits are populated with physical memory when they
+		// are committed. Guarded by resizingMutex.
+		bool prefault = false;
+
+		// True if the memory has been queued to be prefaulted on the background thread, so it
+		// must be removed from the queue before it is freed.
+		std::atomic<bool> hasBackgroundPrefaults{false};
+
 		mutable Platform::RWMutex resizingMutex;
 		std::atomic<Uptr> numPages{0};
 
+		// The number of bytes of the memory's pages that are committed, which may be less than
+		// its size if pages were unmapped by unmapMemoryPages.
+		std::atomic<Uptr> numCommittedBytes{0};
+
 		ResourceQuotaRef resourceQuota;
 
 		Memory(Compartment* inCompartment,
@@ -108,6 +183,11 @@ namespace WAVM { namespace Runtime {
 		IR::UntaggedValue initialValue;
 		bool hasBeenInitialized;
 
+		// If the global is mutable and its value was captured by captureInstanceResetState, the
+		// value that resetInstance restores it to.
+		bool hasResetValue = false;
+		IR::UntaggedValue resetValue;
+
 		Global(Compartment* inCompartment,
 			   IR::GlobalType inType,
 			   U32 inMutableGlobalId,
@@ -130,6 +210,13 @@ namespace WAVM { namespace Runtime {
 
 		IR::ExceptionType sig;
 
+		// Whether exceptions of this type capture the call stack they were thrown from.
+		std::atomic<bool> capturesCallStack{true};
+
+		// For intrinsic exception types, the counter of traps of this type, or null if it hasn't
+		// been looked up yet.
+		std::atomic<Metrics::Counter*> trapsCounter{nullptr};
+
 		ExceptionType(Compartment* inCompartment,
 					  IR::ExceptionType inSig,
 					  std::string&& inDebugName)
@@ -140,19 +227,157 @@ namespace WAVM { namespace Runtime {
 		~ExceptionType() override;
 	};
 
-	typedef std::vector<std::shared_ptr<std::vector<U8>>> DataSegmentVector;
+	typedef std::vector<std::shared_ptr<IR::DataSegmentBytes>> DataSegmentVector;
 	typedef std::vector<std::shared_ptr<IR::ElemSegment::Contents>> ElemSegmentVector;
 
+	// A range of an active data segment's bytes that isn't a long run of zeros.
+	struct DataSegmentExtent
+	{
+		Uptr offset;
+		Uptr numBytes;
+	};
+
+	// The debug names of a module's functions, tables, memories, globals, and exception types,
+	// decoded from its "name" section.
+	struct ModuleDebugNames
+	{
+		std::vector<std::string> functions;
+		std::vector<std::string> tables;
+		std::vector<std::string> memories;
+		std::vector<std::string> globals;
+		std::vector<std::string> exceptionTypes;
+	};
+
+	// The parts of instantiating a module that don't depend on the instance, computed once for
+	// each module.
+	struct InstanceTemplate
+	{
+		// The FunctionMutableData debug names of the invoke thunks in the module's object code,
+		// indexed by type index. Types without an invoke thunk have an empty name.
+		std::vector<std::string> invokeThunkDebugNames;
+
+		// The instance's initial passive data and elem segments. Active segments are null.
+		DataSegmentVector dataSegments;
+		ElemSegmentVector elemSegments;
+
+		// The extents of each active data segment's bytes that aren't long runs of zeros, so
+		// initializing a segment in a memory that is still zero doesn't write or commit the pages
+		// that would stay zero. Passive segments have no extents.
+		std::vector<std::vector<DataSegmentExtent>> dataSegmentExtents;
+	};
+
 	// A compiled WebAssembly module.
 	struct Module
 	{
-		IR::Module ir;
-		std::vector<U8> objectCode;
-
-		Module(IR::Module&& inIR, std::vector<U8>&& inObjectCode)
-		: ir(inIR), objectCode(std::move(inObjectCode))
+		// The module's IR. If the module releases its function bodies after it is compiled, they
+		// are released by getObjectCode, which is why this is mutable.
+		mutable IR::Module ir;
+
+		// Creates a module from object code that was already compiled.
+		Module(IR::Module&& inIR, std::vector<U8>&& inObjectCode);
+
+		// Creates a module that is compiled with the given options when its object code is first
+		// requested. If an object cache is provided, the object code is looked up in the cache
+		// using inWASMBytes, and inWASMBytesHash if the cache already computed it for them.
+		Module(IR::Module&& inIR,
+			   std::vector<U8>&& inWASMBytes,
+			   std::shared_ptr<ObjectCacheInterface>&& inObjectCache,
+			   const LLVMJIT::CompileOptions& inCompileOptions,
+			   const ObjectCacheKeyHash& inWASMBytesHash = ObjectCacheKeyHash());
+
+		~Module();
+
+		// Returns the module's object code, compiling the module if it hasn't been compiled yet.
+		// If cancelFlag is non-null, compiling the module throws an
+		// LLVMJIT::CompileCancelledException once it is set, and leaves the module uncompiled.
+		std::shared_ptr<const std::vector<U8>> getObjectCode(
+			const std::shared_ptr<const std::atomic<bool>>& cancelFlag = nullptr) const;
+
+		// Whether the module's instances count the calls to their function definitions, and tier
+		// up their hot functions: either the module's object code is compiled with the baseline
+		// tier and counts them, or the instances are interpreted and the interpreter counts them.
+		bool tiersUpInstances() const
 		{
+			return compileOptions.tierUpCallThreshold
+				   && (compileOptions.tier == LLVMJIT::CompileTier::baseline || interpretInstances);
 		}
+		Uptr getTierUpCallThreshold() const { return compileOptions.tierUpCallThreshold; }
+
+		// Returns object code that replaces the code of some of the function definitions of an
+		// instance of the module with code compiled by the optimized tier, compiling it if it
+		// wasn't compiled for another instance. If cancelFlag is set, the compile throws an
+		// LLVMJIT::CompileCancelledException.
+		std::shared_ptr<const std::vector<U8>> getTierUpObjectCode(
+			const std::vector<Uptr>& functionDefIndices,
+			const std::shared_ptr<const std::atomic<bool>>& cancelFlag) const;
+
+		// Whether instances of the module use object code that is specialized for their imports.
+		bool specializesInstances() const { return specializeInstances; }
+
+		// Returns the module's function definitions prepared for the interpreter, preparing them
+		// the first time it is requested. Returns null if the module is compiled instead: if
+		// setGlobalInterpretModules wasn't enabled when the module was created, or the module
+		// uses a feature that the interpreter doesn't support.
+		std::shared_ptr<const InterpreterModuleCode> getInterpreterCode() const;
+
+		// Returns the module's object code specialized for an instance's imports, compiling it if
+		// no instance with the same specialization was created before.
+		std::shared_ptr<const std::vector<U8>> getSpecializedObjectCode(
+			const LLVMJIT::ModuleSpecialization& specialization) const;
+
+		// Returns the module's debug names, decoding them the first time they are requested, so
+		// they are shared by all instances of the module.
+		std::shared_ptr<const ModuleDebugNames> getDebugNames() const;
+
+		// Returns the module's InstanceTemplate, computing it the first time it is requested.
+		std::shared_ptr<const InstanceTemplate> getInstanceTemplate() const;
+
+	private:
+		mutable Platform::Mutex instanceTemplateMutex;
+		mutable std::shared_ptr<const InstanceTemplate> instanceTemplate;
+
+		mutable Platform::Mutex debugNamesMutex;
+		mutable std::shared_ptr<const ModuleDebugNames> debugNames;
+
+		mutable Platform::Mutex objectCodeMutex;
+		mutable std::shared_ptr<const std::vector<U8>> objectCode;
+
+		// The state needed to compile the module after it was created. It is released once the
+		// module's final object code has been compiled.
+		mutable std::vector<U8> wasmBytes;
+		mutable ObjectCacheKeyHash wasmBytesHash;
+		mutable std::shared_ptr<ObjectCacheInterface> objectCache;
+		const LLVMJIT::CompileOptions compileOptions;
+
+		// Whether the module's instances are interpreted if the module can be. Such modules keep
+		// their function bodies, regardless of setGlobalReleaseFunctionBodies.
+		const bool interpretInstances;
+		mutable Platform::Mutex interpreterCodeMutex;
+		mutable bool hasPreparedInterpreterCode = false;
+		mutable std::shared_ptr<const InterpreterModuleCode> interpreterCode;
+
+		// Whether the function bodies in the module's IR are released once its object code has
+		// been compiled. Modules that tier up their instances keep them to compile the hot
+		// functions.
+		const bool releaseFunctionBodiesAfterCompile;
+
+		// If the module specializes its instances, the specialized object code, keyed by the
+		// serialized specialization. The module's compile state is kept to compile new
+		// specializations.
+		const bool specializeInstances;
+		mutable Platform::Mutex specializedObjectCodesMutex;
+		mutable HashMap<std::vector<U8>, std::shared_ptr<const std::vector<U8>>>
+			specializedObjectCodes;
+
+		// The object code that tiers up function definitions of the module's instances, keyed by
+		// the serialized function definition indices.
+		mutable Platform::Mutex tierUpObjectCodesMutex;
+		mutable HashMap<std::vector<U8>, std::shared_ptr<const std::vector<U8>>>
+			tierUpObjectCodes;
+
+		// Releases the state that is only needed to compile the module, unless the module
+		// specializes its instances. objectCodeMutex must be locked by the caller.
+		void releaseCompileState() const;
 	};
 
 	// An instance of a WebAssembly module.
@@ -177,10 +402,25 @@ namespace WAVM { namespace Runtime {
 		mutable Platform::RWMutex elemSegmentsMutex;
 		ElemSegmentVector elemSegments;
 
+		// If the instance's state was captured by captureInstanceResetState, the passive data and
+		// elem segments that resetInstance restores, which are null for segments that had been
+		// dropped. Guarded by dataSegmentsMutex and elemSegmentsMutex.
+		bool hasResetState = false;
+		DataSegmentVector resetDataSegments;
+		ElemSegmentVector resetElemSegments;
+
+		// The instance's function definitions are either loaded from object code by the JIT
+		// module, or executed by the interpreted module.
 		const std::shared_ptr<LLVMJIT::Module> jitModule;
+		const std::shared_ptr<InterpretedModule> interpretedModule;
 
 		ResourceQuotaRef resourceQuota;
 
+		// If the instance tiers up its hot functions, the state that compiles them. It is shared
+		// with the instance's clones, which use the same functions, and is declared last so it is
+		// destroyed before the functions it tiers up.
+		const std::shared_ptr<InstanceTierUp> tierUp;
+
 		Instance(Compartment* inCompartment,
 				 Uptr inID,
 				 HashMap<std::string, Object*>&& inExportMap,
@@ -194,6 +434,8 @@ namespace WAVM { namespace Runtime {
 				 DataSegmentVector&& inPassiveDataSegments,
 				 ElemSegmentVector&& inPassiveElemSegments,
 				 std::shared_ptr<LLVMJIT::Module>&& inJITModule,
+				 std::shared_ptr<InterpretedModule>&& inInterpretedModule,
+				 std::shared_ptr<InstanceTierUp>&& inTierUp,
 				 std::string&& inDebugName,
 				 ResourceQuotaRefParam inResourceQuota)
 		: GCObject(ObjectKind::instance, inCompartment, std::move(inDebugName))
@@ -209,7 +451,9 @@ namespace WAVM { namespace Runtime {
 		, dataSegments(std::move(inPassiveDataSegments))
 		, elemSegments(std::move(inPassiveElemSegments))
 		, jitModule(std::move(inJITModule))
+		, interpretedModule(std::move(inInterpretedModule))
 		, resourceQuota(inResourceQuota)
+		, tierUp(std::move(inTierUp))
 		{
 		}
 
@@ -221,6 +465,21 @@ namespace WAVM { namespace Runtime {
 		Uptr id = UINTPTR_MAX;
 		struct ContextRuntimeData* runtimeData = nullptr;
 
+		EpochDeadlineCallback epochDeadlineCallback = nullptr;
+		void* epochDeadlineCallbackUserData = nullptr;
+
+		ResourceQuotaRef resourceQuota;
+		FuelExhaustedCallback fuelExhaustedCallback = nullptr;
+		void* fuelExhaustedCallbackUserData = nullptr;
+
+		// Whether the context's invokes account their times, and the times they accounted. See
+		// getContextTimes.
+		std::atomic<bool> accountsTimes{false};
+		std::atomic<U64> numTimedInvokes{0};
+		std::atomic<U64> wallNanoseconds{0};
+		std::atomic<U64> cpuNanoseconds{0};
+		std::atomic<U64> atomicWaitNanoseconds{0};
+
 		Context(Compartment* inCompartment, std::string&& inDebugName)
 		: GCObject(ObjectKind::context, inCompartment, std::move(inDebugName))
 		{
@@ -228,13 +487,36 @@ namespace WAVM { namespace Runtime {
 		~Context();
 	};
 
+	// The maximum number of destroyed contexts whose runtime data a compartment keeps committed for
+	// reuse.
+	static constexpr Uptr maxFreeContextsPerCompartment = 64;
+
 	struct Compartment : GCObject
 	{
-		mutable Platform::RWMutex mutex;
+		mutable Platform::ReaderBiasedRWMutex mutex;
 
 		struct CompartmentRuntimeData* runtimeData;
 		U8* unalignedRuntimeData;
 
+		// The compartment's limits on tables, contexts and mutable globals, the offset of the
+		// contexts' runtime data from the start of the compartment's runtime data, the number of
+		// bytes between consecutive contexts' runtime data, and the number of bytes reserved for
+		// it. If the compartment is compact, all of its runtime data is committed up front.
+		const CompartmentLayout layout;
+		const Uptr contextsOffset;
+		const Uptr contextNumBytes;
+		const Uptr numReservedBytes;
+		const bool isCompact;
+
+		// The number of bytes of contexts' runtime data that have been committed, if the
+		// compartment isn't compact. If contextNumBytes isn't a whole number of pages, contexts
+		// share pages, so the pages are committed as the highest context ID grows, and are never
+		// decommitted while the compartment is alive.
+		Uptr numCommittedContextBytes{0};
+
+		// The compartment's objects, indexed by their IDs. The ID of an object that is freed is
+		// reused by the next object of the same kind that is added to the compartment, so the IDs
+		// bound into generated code and runtime data are only valid while the object is alive.
 		IndexMap<Uptr, Table*> tables;
 		IndexMap<Uptr, Memory*> memories;
 		IndexMap<Uptr, Global*> globals;
@@ -246,7 +528,62 @@ namespace WAVM { namespace Runtime {
 		DenseStaticIntSet<U32, maxMutableGlobals> globalDataAllocationMask;
 		IR::UntaggedValue initialContextMutableGlobals[maxMutableGlobals];
 
-		Compartment(std::string&& inDebugName);
+		// One more than the highest mutable global index that has been allocated. Contexts are
+		// initialized by copying only this many initial mutable global values.
+		Uptr numMutableGlobalSlotsUsed{0};
+
+		// The IDs of destroyed contexts whose ContextRuntimeData pages are still committed, which
+		// are reused by new contexts before allocating a new ID.
+		std::vector<Uptr> freeContextIds;
+
+		// The compartment's memory pool, and the stripe of it that the compartment's memories are
+		// allocated from. If the pool uses protection keys, invoking functions in the compartment
+		// denies access to all of the pool's keys in memoryProtectionKeyRightsMask, other than
+		// the stripe's key.
+		MemoryPoolRef memoryPool;
+		Uptr memoryPoolStripeIndex{0};
+		I32 memoryProtectionKey{-1};
+		U32 memoryProtectionKeyRightsMask{0};
+		std::atomic<bool> lazyMemoryClones{false};
+
+		// How long atomic waits spin before blocking, and counts of how often spinning avoided
+		// blocking.
+		std::atomic<U64> atomicWaitSpinNanoseconds{defaultAtomicWaitSpinNanoseconds};
+		std::atomic<U64> numAtomicWaits{0};
+		std::atomic<U64> numSpinningAtomicWaits{0};
+		std::atomic<U64> numAtomicWaitsEndedBySpinning{0};
+
+		// Serializes garbage collections of the compartment.
+		Platform::Mutex gcMutex;
+
+		// While the garbage collector is marking the compartment's objects concurrently with other
+		// threads, isGCMarking is true, and table elements that are overwritten are added to
+		// gcOverwrittenReferences so the collector can mark them.
+		std::atomic<bool> isGCMarking{false};
+		Platform::Mutex gcOverwrittenReferencesMutex;
+		std::vector<Object*> gcOverwrittenReferences;
+
+		// The objects added to the compartment since its last garbage collection, which are
+		// accessed with the compartment's mutex exclusively locked, and the tables written since
+		// the last garbage collection, which may contain references from older objects to the
+		// young objects.
+		HashSet<GCObject*> youngObjects;
+		Platform::Mutex rememberedTablesMutex;
+		HashSet<Table*> rememberedTables;
+
+		// If the compartment is collected in the background, the number of instances, memories
+		// and tables created since its last collection that wakes the background collector, and
+		// the number of those objects created since the last collection. The background
+		// collector's mutex guards the schedule of its full collections.
+		std::atomic<Uptr> backgroundGCObjectThreshold{0};
+		std::atomic<Uptr> numObjectsSinceGC{0};
+		Uptr numYoungBackgroundCollectionsPerFull{0};
+		Uptr numYoungBackgroundCollectionsSinceFull{0};
+
+		// The number of bytes committed for the compartment's runtime data, memories, and tables.
+		std::atomic<Uptr> numCommittedBytes{0};
+
+		Compartment(std::string&& inDebugName, const CompartmentLayout& inLayout);
 		~Compartment();
 	};
 
@@ -260,58 +597,224 @@ namespace WAVM { namespace Runtime {
 		}
 	};
 
+	// Returns the index of the calling thread's ResourceQuota reservation slot.
+	Uptr getResourceQuotaReservationSlotIndex();
+
 	struct ResourceQuota
 	{
+		static constexpr Uptr numReservationSlots = 16;
+
+		// The current and max values are atomic, so allocating and freeing quota doesn't need a
+		// lock. The quota isn't used to order any other memory accesses, so the atomic operations
+		// are all relaxed.
+		//
+		// If reservationChunk is non-zero, each thread allocates quota in chunks, and keeps what
+		// it doesn't use yet in its reservation slot. Most allocations and frees then only touch
+		// the slot, instead of the current value that every thread that uses the quota shares.
+		// Reserved quota counts towards the max, but not towards getCurrent. If an allocation
+		// would exceed the max, the reservations are returned and the allocation is retried.
 		template<typename Value> struct CurrentAndMax
 		{
-			CurrentAndMax(Value inMax) : current{0}, max(inMax) {}
+			CurrentAndMax(Value inMax) : current{0}, max{inMax}, reservationChunk{0} {}
 
 			bool allocate(Value delta)
 			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-
-				// Make sure the delta doesn't make current overflow.
-				if(current + delta < current) { return false; }
-
-				if(current + delta > max) { return false; }
-
-				current += delta;
-				return true;
+				const Value chunk = reservationChunk.load(std::memory_order_relaxed);
+				if(!chunk) { return allocateShared(delta); }
+
+				// Try to take the delta from the thread's reservation.
+				std::atomic<Value>& reservation = getReservation();
+				Value oldReservation = reservation.load(std::memory_order_relaxed);
+				while(oldReservation >= delta)
+				{
+					if(reservation.compare_exchange_weak(
+						   oldReservation, oldReservation - delta, std::memory_order_relaxed))
+					{ return true; }
+				}
+
+				// Allocate another chunk for the reservation along with the delta.
+				if(delta + chunk > delta && allocateShared(delta + chunk))
+				{
+					reservation.fetch_add(chunk, std::memory_order_relaxed);
+					return true;
+				}
+
+				// If that fails, allocate just the delta, giving back all the reservations if
+				// they are what is keeping the quota from satisfying it.
+				if(allocateShared(delta)) { return true; }
+				releaseReservations();
+				return allocateShared(delta);
 			}
 
 			void free(Value delta)
 			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-				WAVM_ASSERT(current - delta <= current);
-				current -= delta;
+				const Value chunk = reservationChunk.load(std::memory_order_relaxed);
+				if(!chunk)
+				{
+					freeShared(delta);
+					return;
+				}
+
+				// Return the freed quota to the thread's reservation, but return anything more than
+				// a chunk in the reservation to the shared quota.
+				std::atomic<Value>& reservation = getReservation();
+				Value newReservation = reservation.fetch_add(delta, std::memory_order_relaxed)
+									   + delta;
+				while(newReservation > chunk)
+				{
+					if(reservation.compare_exchange_weak(
+						   newReservation, chunk, std::memory_order_relaxed))
+					{
+						freeShared(newReservation - chunk);
+						break;
+					}
+				}
 			}
 
 			Value getCurrent() const
 			{
-				Platform::RWMutex::ShareableLock lock(mutex);
-				return current;
+				// Read the current value before the reservations. A chunk that another thread takes
+				// from the shared quota after the current value is read may be counted in the
+				// reservations but not in the current value, so they may add up to more than it.
+				const Value currentAndReserved = current.load(std::memory_order_acquire);
+				Value numReserved = 0;
+				for(const ReservationSlot& slot : reservationSlots)
+				{ numReserved += slot.reservation.load(std::memory_order_acquire); }
+				return currentAndReserved > numReserved ? currentAndReserved - numReserved : 0;
 			}
-			Value getMax() const
+			Value getMax() const { return max.load(std::memory_order_relaxed); }
+			void setMax(Value newMax) { max.store(newMax, std::memory_order_relaxed); }
+
+			void setReservationChunk(Value newReservationChunk)
 			{
-				Platform::RWMutex::ShareableLock lock(mutex);
-				return max;
+				reservationChunk.store(newReservationChunk, std::memory_order_relaxed);
+				if(!newReservationChunk) { releaseReservations(); }
 			}
-			void setMax(Value newMax)
+
+		private:
+			struct ReservationSlot
 			{
-				Platform::RWMutex::ExclusiveLock lock(mutex);
-				max = newMax;
+				alignas(numCacheLineBytes) std::atomic<Value> reservation{0};
+			};
+
+			std::atomic<Value> current;
+			std::atomic<Value> max;
+			std::atomic<Value> reservationChunk;
+			ReservationSlot reservationSlots[numReservationSlots];
+
+			std::atomic<Value>& getReservation()
+			{
+				const Uptr slotIndex = getResourceQuotaReservationSlotIndex();
+				WAVM_ASSERT(slotIndex < numReservationSlots);
+				return reservationSlots[slotIndex].reservation;
 			}
 
-		private:
-			mutable Platform::RWMutex mutex;
-			Value current;
-			Value max;
+			bool allocateShared(Value delta)
+			{
+				Value oldCurrent = current.load(std::memory_order_relaxed);
+				do
+				{
+					// Make sure the delta doesn't make current overflow.
+					if(oldCurrent + delta < oldCurrent) { return false; }
+
+					if(oldCurrent + delta > max.load(std::memory_order_relaxed)) { return false; }
+				} while(!current.compare_exchange_weak(
+					oldCurrent, oldCurrent + delta, std::memory_order_relaxed));
+				return true;
+			}
+
+			void freeShared(Value delta)
+			{
+				const Value oldCurrent = current.fetch_sub(delta, std::memory_order_relaxed);
+				WAVM_ASSERT(oldCurrent - delta <= oldCurrent);
+				WAVM_SUPPRESS_UNUSED(oldCurrent);
+			}
+
+			void releaseReservations()
+			{
+				for(ReservationSlot& slot : reservationSlots)
+				{
+					const Value numReserved
+						= slot.reservation.exchange(0, std::memory_order_relaxed);
+					if(numReserved) { freeShared(numReserved); }
+				}
+			}
 		};
 
 		CurrentAndMax<Uptr> memoryPages{UINTPTR_MAX};
 		CurrentAndMax<Uptr> tableElems{UINTPTR_MAX};
+		CurrentAndMax<U64> fuel{UINT64_MAX};
+		std::atomic<U64> fuelRefillAmount{1024 * 1024};
+		std::atomic<bool> prefaultMemories{false};
+	};
+
+	// The number of bytes of address space reserved for each 32-bit memory, not including its
+	// guard region. Any 32-bit index + 32-bit offset is within the reserved address space.
+	static constexpr Uptr memory32NumReservedBytes = Uptr(8) * 1024 * 1024 * 1024;
+
+	// The maximum number of protection keys a memory pool allocates to color its slots with. x86
+	// has 16 keys, and key 0 is the default key for all pages.
+	static constexpr Uptr maxMemoryPoolProtectionKeys = 15;
+
+	struct MemoryPool
+	{
+		U8* baseAddress = nullptr;
+		U8* unalignedBaseAddress = nullptr;
+		Uptr baseAddressAlignmentLog2 = 0;
+		Uptr numSlots = 0;
+		Uptr numBytesPerSlot = 0;
+		Uptr numReservedBytes = 0;
+
+		// If the pool uses protection keys, the slots are divided into stripes that are each
+		// tagged with a different key: slot i is in stripe i % numStripes. A memory's reserved
+		// address space then overlaps the next (numStripes - 1) slots, which are in other stripes,
+		// so memories can only grow to the size of a slot, but code running in a compartment
+		// faults if it accesses a memory from another stripe.
+		Uptr numStripes = 1;
+		std::vector<I32> protectionKeys;
+
+		// The protection key rights bits that deny access to all of the pool's keys.
+		U32 protectionKeyRightsMask = 0;
+
+		MemoryPool(Uptr inNumSlots, bool useProtectionKeys);
+		~MemoryPool();
+
+		// Chooses the stripe for a new compartment's memories, distributing compartments evenly
+		// between the stripes.
+		Uptr allocateStripe() { return nextStripeIndex++ % numStripes; }
+
+		// Returns the protection key of a stripe, or -1 if the pool doesn't use protection keys.
+		I32 getStripeProtectionKey(Uptr stripeIndex) const
+		{
+			return protectionKeys.size() ? protectionKeys[stripeIndex] : -1;
+		}
+
+		// Allocates a free slot in a stripe, and returns its base address, or null if there are no
+		// free slots in the stripe.
+		U8* allocateSlot(Uptr stripeIndex, Uptr& outSlotIndex);
+
+		// Decommits the given number of bytes at the start of a slot, and returns it to the pool.
+		void freeSlot(Uptr slotIndex, Uptr numCommittedBytes);
+
+		Uptr getNumFreeSlots() const;
+
+	private:
+		mutable Platform::Mutex mutex;
+		std::vector<std::vector<Uptr>> stripeFreeSlotIndices;
+		std::atomic<Uptr> nextStripeIndex{0};
 	};
 
+	// Chooses the stripe of the compartment's memory pool that its memories are allocated from.
+	void setCompartmentMemoryPoolStripe(Compartment* compartment);
+
+	// Finds the memory pool that uses protection keys whose reserved address space contains an
+	// address. This is called by the signal handler, so it must not lock or allocate.
+	bool findStripedMemoryPool(U8* address, MemoryPool*& outMemoryPool);
+
+	// The protection key of the memory pool stripe that the calling thread is running code for,
+	// or -1 if it isn't running code in a compartment whose memory pool uses protection keys.
+	extern thread_local I32 currentMemoryProtectionKey;
+
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsics);
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsicsAtomics);
 	WAVM_DECLARE_INTRINSIC_MODULE(wavmIntrinsicsException);
@@ -331,19 +834,114 @@ namespace WAVM { namespace Runtime {
 	// Clone a global with same ID and mutable data offset (if mutable) in a new compartment.
 	Global* cloneGlobal(Global* global, Compartment* newCompartment);
 
+	// Captures the state of a memory or table for resetInstance, and restores it. Capturing a
+	// memory fails if it has pages that can't be captured: decommitted pages, or mapped files.
+	bool captureMemoryResetState(Memory* memory);
+	void captureTableResetState(Table* table);
+	void resetMemory(Memory* memory);
+	void resetTable(Table* table);
+
+	// Accounts the wall time and the calling thread's CPU time from its construction to its
+	// destruction to a context, if the context accounts its times, and the thread isn't already
+	// accounting time to the context. The time accounted to scopes for other contexts that are
+	// nested in it is excluded.
+	struct ContextTimeScope
+	{
+		ContextTimeScope(Context* inContext);
+		~ContextTimeScope();
+
+	private:
+		Context* context;
+		Context* outerContext;
+		U64 startWallNanoseconds;
+		U64 startCPUNanoseconds;
+		U64 startThreadWallNanoseconds;
+		U64 startThreadCPUNanoseconds;
+	};
+
+	// Adds an object that was just added to its compartment to the compartment's young objects.
+	// The compartment's mutex must be exclusively locked.
+	void addYoungObject(GCObject* object);
+
+	// Wakes the background garbage collector to collect a compartment whose count of objects
+	// created since its last collection reached its threshold.
+	void wakeBackgroundGC();
+
+	// Populates the bytes [offset, offset + numBytes) of a memory with physical memory on a
+	// background thread, and removes a memory's pending prefaults before it is freed, waiting for
+	// the background thread if it is prefaulting the memory.
+	void prefaultMemoryInBackground(Memory* memory, Uptr offset, Uptr numBytes);
+	void cancelBackgroundMemoryPrefaults(Memory* memory);
+
+	// The kinds of objects whose committed bytes are counted separately by the
+	// wavm_committed_bytes gauge.
+	enum class CommitKind
+	{
+		compartment,
+		memory,
+		table,
+	};
+
+	// Counts bytes of virtual memory that were committed or decommitted for a compartment or one of
+	// its objects, in the compartment's committed bytes, the wavm_committed_bytes gauge, and
+	// Platform::registerVirtualAllocation.
+	void registerCommit(Compartment* compartment, CommitKind kind, Uptr numBytes);
+	void deregisterCommit(Compartment* compartment, CommitKind kind, Uptr numBytes);
+
+	// Records that a table's elements were written, so collectYoungCompartmentGarbage scans the
+	// table for references to young objects.
+	void rememberTableWrite(Table* table);
+
+	// Returns the object cache set by setGlobalObjectCache, or null if there isn't one.
+	std::shared_ptr<ObjectCacheInterface> getGlobalObjectCache();
+
+	// Compiles a module to object code for the host, in one of the processes started by
+	// startCompileProcesses if possible.
+	std::vector<U8> compileHostObjectCode(const IR::Module& irModule,
+										  const LLVMJIT::CompileOptions& compileOptions);
+
+	// Returns bytes that identify the compile options that a compile process is sent, besides the
+	// feature spec.
+	std::vector<U8> getCompileOptionsKey(const LLVMJIT::CompileOptions& compileOptions);
+
+	// Returns the options set by setGlobalCompileOptions.
+	LLVMJIT::CompileOptions getGlobalCompileOptions();
+
+	// Creates a module that is compiled with the given options and the global object cache, and
+	// compiles it unless it is interpreted. Throws an LLVMJIT::CompileCancelledException if
+	// cancelFlag is set while the module is compiled.
+	ModuleRef compileModuleWithOptions(const IR::Module& irModule,
+									   const LLVMJIT::CompileOptions& compileOptions,
+									   const std::shared_ptr<const std::atomic<bool>>& cancelFlag);
+
 	Instance* getInstanceFromRuntimeData(ContextRuntimeData* contextRuntimeData, Uptr instanceId);
 	Table* getTableFromRuntimeData(ContextRuntimeData* contextRuntimeData, Uptr tableId);
 	Memory* getMemoryFromRuntimeData(ContextRuntimeData* contextRuntimeData, Uptr memoryId);
 
+	// Returns the function that call_indirect calls for an element of a table, reading the table
+	// without locking it like compiled code does. Throws the same exceptions as compiled code if
+	// the element is out of bounds, uninitialized, or a function of a different type.
+	Function* getIndirectCallee(ContextRuntimeData* contextRuntimeData,
+								Uptr tableId,
+								Uptr elementIndex,
+								IR::FunctionType expectedType);
+
 	// Initialize a data segment (equivalent to executing a memory.init instruction).
 	void initDataSegment(Instance* instance,
 						 Uptr dataSegmentIndex,
-						 const std::vector<U8>* dataVector,
+						 const IR::DataSegmentBytes* dataBytes,
 						 Memory* memory,
 						 Uptr destAddress,
 						 Uptr sourceOffset,
 						 Uptr numBytes);
 
+	// Initialize an active data segment at an address in a memory that is still zero from the
+	// address on, by only copying the segment's non-zero extents.
+	void initZeroedDataSegment(Memory* memory,
+							   Uptr destAddress,
+							   const IR::DataSegmentBytes* dataBytes,
+							   const std::vector<DataSegmentExtent>& extents);
+
 	// Initialize a table segment (equivalent to executing a table.init instruction).
 	void initElemSegment(Instance* instance,
 						 Uptr elemSegmentIndex,
@@ -378,6 +976,53 @@ namespace WAVM { namespace Runtime {
 										std::vector<ExceptionType*>&& exceptionTypeImports,
 										std::string&& debugName,
 										ResourceQuotaRefParam resourceQuota = ResourceQuotaRef());
+
+	// Decodes the function definitions of a module for the interpreter. Returns null if the module
+	// uses a feature that the interpreter doesn't support.
+	std::shared_ptr<const InterpreterModuleCode> prepareInterpreterCode(const IR::Module& irModule);
+
+	// Creates the interpreted functions of an instance of a module, and sets the function of each
+	// of functionDefMutableDatas to them like LLVMJIT::loadModule does. functionImports holds the
+	// Runtime::Function that each of the module's function imports is bound to.
+	std::shared_ptr<InterpretedModule> createInterpretedModule(
+		ModuleConstRefParam module,
+		std::shared_ptr<const InterpreterModuleCode>&& code,
+		Uptr instanceId,
+		const std::vector<Function*>& functionImports,
+		const std::vector<Table*>& tables,
+		const std::vector<Memory*>& memories,
+		const std::vector<Global*>& globals,
+		const std::vector<FunctionMutableData*>& functionDefMutableDatas);
+
+	// If the function is interpreted, binds the compiled trampoline that its code jumps to, so
+	// compiled code may call it. Must be called before the function is passed to compiled code.
+	void bindInterpreterTrampoline(Function* function);
+
+	// Returns the values to bind to the WAVM intrinsic function symbols in the LLVMJIT object code.
+	// They are the same for all instances, so they are only looked up once.
+	const HashMap<std::string, LLVMJIT::FunctionBinding>& getWAVMIntrinsicsExportMap();
+
+	// Creates the state that tiers up the hot function definitions of an instance that is
+	// interpreted, or whose object code was compiled with CompileOptions::tierUpCallThreshold and
+	// was loaded with the given bindings. importedFunctions holds the instance's functions for the
+	// module's function imports, which are null for native imports, and functionDefs its
+	// functions for the module's function definitions, which are bound to the state.
+	std::shared_ptr<InstanceTierUp> createInstanceTierUp(
+		ModuleConstRefParam module,
+		Uptr instanceId,
+		const std::string& debugName,
+		const std::vector<LLVMJIT::FunctionBinding>& functionImports,
+		const std::vector<LLVMJIT::TableBinding>& tables,
+		const std::vector<LLVMJIT::MemoryBinding>& memories,
+		const std::vector<LLVMJIT::GlobalBinding>& globals,
+		const std::vector<LLVMJIT::ExceptionTypeBinding>& exceptionTypes,
+		const std::vector<Function*>& importedFunctions,
+		const std::vector<Function*>& functionDefs);
+
+	// Called by the interpreter when an interpreted function whose instance tiers up its hot
+	// functions is called. If the function has been tiered up, returns the Runtime::Function of
+	// its optimized code. Otherwise, counts the call, and returns null.
+	const Function* countInterpretedTierUpCall(const Function* function);
 }}
 
 namespace WAVM { namespace Intrinsics {
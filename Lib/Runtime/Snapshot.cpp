@@ -0,0 +1,264 @@
+#include <memory>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/IR.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Runtime/Runtime.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// Runs of zero bytes shorter than this are included in the surrounding data segment instead of
+// splitting it, since each segment has a few bytes of overhead in the binary format.
+static constexpr Uptr minZeroBytesBetweenDataSegments = 64;
+
+// Creates an initializer expression for a reference to a runtime object.
+static bool getReferenceInitializer(const HashMap<const Object*, Uptr>& functionIndexMap,
+									ReferenceType type,
+									const Object* object,
+									InitializerExpression& outInitializer)
+{
+	if(!object)
+	{
+		outInitializer = InitializerExpression(type);
+		return true;
+	}
+
+	const Uptr* functionIndex = functionIndexMap.get(object);
+	if(!functionIndex) { return false; }
+	outInitializer = InitializerExpression(InitializerExpression::Type::ref_func, *functionIndex);
+	return true;
+}
+
+// Adds active data segments to a module for the non-zero bytes of a memory.
+static void addMemoryDataSegments(IR::Module& module, Uptr memoryIndex, const Memory* memory)
+{
+	const bool is64bit = module.memories.getType(memoryIndex).indexType == IndexType::i64;
+	const U8* bytes = memory->baseAddress;
+	const Uptr numBytes = memory->numPages.load(std::memory_order_acquire) * IR::numBytesPerPage;
+
+	Uptr address = 0;
+	while(address < numBytes)
+	{
+		// Find the next non-zero byte.
+		while(address < numBytes && !bytes[address]) { ++address; }
+		if(address == numBytes) { break; }
+
+		// Find the end of the segment: the next run of zero bytes that is long enough to split
+		// the segment, or the end of the memory.
+		const Uptr beginAddress = address;
+		Uptr endAddress = address;
+		while(address < numBytes)
+		{
+			if(bytes[address]) { endAddress = ++address; }
+			else if(address - endAddress >= minZeroBytesBetweenDataSegments)
+			{
+				break;
+			}
+			else
+			{
+				++address;
+			}
+		}
+
+		DataSegment dataSegment;
+		dataSegment.isActive = true;
+		dataSegment.memoryIndex = memoryIndex;
+		dataSegment.baseOffset = is64bit ? InitializerExpression(I64(beginAddress))
+										 : InitializerExpression(I32(U32(beginAddress)));
+		dataSegment.data = std::make_shared<DataSegmentBytes>(
+			std::vector<U8>(bytes + beginAddress, bytes + endAddress));
+		module.dataSegments.push_back(std::move(dataSegment));
+	}
+}
+
+bool Runtime::snapshotInstance(const Instance* instance,
+							   const Context* context,
+							   const IR::Module& irModule,
+							   IR::Module& outIRModule)
+{
+	WAVM_ASSERT(instance->functions.size() == irModule.functions.size());
+	WAVM_ASSERT(instance->memories.size() == irModule.memories.size());
+	WAVM_ASSERT(instance->tables.size() == irModule.tables.size());
+	WAVM_ASSERT(instance->globals.size() == irModule.globals.size());
+
+	// The state of imported memories, tables, and mutable globals isn't owned by the instance, so
+	// it can't be captured in the snapshot.
+	if(irModule.memories.imports.size() || irModule.tables.imports.size())
+	{
+		Log::printf(Log::error, "Can't snapshot an instance that imports memories or tables.\n");
+		return false;
+	}
+	for(const GlobalImport& globalImport : irModule.globals.imports)
+	{
+		if(globalImport.type.isMutable)
+		{
+			Log::printf(Log::error, "Can't snapshot an instance that imports mutable globals.\n");
+			return false;
+		}
+	}
+
+	// Map the instance's functions to their index in the module, to translate references
+	// stored in tables and globals to ref.func initializers.
+	HashMap<const Object*, Uptr> functionIndexMap;
+	for(Uptr functionIndex = 0; functionIndex < instance->functions.size(); ++functionIndex)
+	{ functionIndexMap.set(asObject(instance->functions[functionIndex]), functionIndex); }
+
+	outIRModule = irModule;
+
+	// The snapshot has already run the start function.
+	outIRModule.startFunctionIndex = UINTPTR_MAX;
+
+	// Replace the initializers of mutable globals with their current values.
+	for(Uptr globalDefIndex = 0; globalDefIndex < irModule.globals.defs.size(); ++globalDefIndex)
+	{
+		GlobalDef& globalDef = outIRModule.globals.defs[globalDefIndex];
+		if(!globalDef.type.isMutable) { continue; }
+
+		const Global* global = instance->globals[irModule.globals.imports.size() + globalDefIndex];
+		const Value value = getGlobalValue(context, global);
+		switch(value.type)
+		{
+		case ValueType::i32: globalDef.initializer = InitializerExpression(value.i32); break;
+		case ValueType::i64: globalDef.initializer = InitializerExpression(value.i64); break;
+		case ValueType::f32: globalDef.initializer = InitializerExpression(value.f32); break;
+		case ValueType::f64: globalDef.initializer = InitializerExpression(value.f64); break;
+		case ValueType::v128: globalDef.initializer = InitializerExpression(value.v128); break;
+		case ValueType::externref:
+		case ValueType::funcref:
+			if(!getReferenceInitializer(functionIndexMap,
+										value.type == ValueType::funcref
+											? ReferenceType::funcref
+											: ReferenceType::externref,
+										value.object,
+										globalDef.initializer))
+			{
+				Log::printf(Log::error,
+							"Can't snapshot global %" WAVM_PRIuPTR
+							": it references an object that isn't a function of the instance.\n",
+							irModule.globals.imports.size() + globalDefIndex);
+				return false;
+			}
+			break;
+
+		case ValueType::none:
+		case ValueType::any:
+		default: WAVM_UNREACHABLE();
+		};
+	}
+
+	// The original active segments have already been copied to the memories and tables, and are
+	// dropped. Keep them as dropped segments so the indices of the other segments don't change:
+	// empty passive data segments, and declared elem segments, which also keep declaring the
+	// functions they reference for ref.func.
+	{
+		Platform::RWMutex::ShareableLock dataSegmentsLock(instance->dataSegmentsMutex);
+		for(Uptr segmentIndex = 0; segmentIndex < irModule.dataSegments.size(); ++segmentIndex)
+		{
+			DataSegment& dataSegment = outIRModule.dataSegments[segmentIndex];
+			dataSegment.isActive = false;
+			dataSegment.data = instance->dataSegments[segmentIndex]
+								   ? instance->dataSegments[segmentIndex]
+								   : std::make_shared<DataSegmentBytes>();
+		}
+	}
+	{
+		Platform::RWMutex::ShareableLock elemSegmentsLock(instance->elemSegmentsMutex);
+		for(Uptr segmentIndex = 0; segmentIndex < irModule.elemSegments.size(); ++segmentIndex)
+		{
+			ElemSegment& elemSegment = outIRModule.elemSegments[segmentIndex];
+			if(elemSegment.type == ElemSegment::Type::active)
+			{ elemSegment.type = ElemSegment::Type::declared; }
+			else if(elemSegment.type == ElemSegment::Type::passive)
+			{
+				if(instance->elemSegments[segmentIndex])
+				{ elemSegment.contents = instance->elemSegments[segmentIndex]; }
+				else
+				{
+					auto emptyContents = std::make_shared<ElemSegment::Contents>();
+					emptyContents->encoding = elemSegment.contents->encoding;
+					emptyContents->elemType = elemSegment.contents->elemType;
+					emptyContents->externKind = elemSegment.contents->externKind;
+					elemSegment.contents = emptyContents;
+				}
+			}
+		}
+	}
+
+	// Resize the memories to their current size, and add data segments for their contents.
+	for(Uptr memoryIndex = 0; memoryIndex < irModule.memories.size(); ++memoryIndex)
+	{
+		const Memory* memory = instance->memories[memoryIndex];
+		outIRModule.memories.defs[memoryIndex].type.size.min = getMemoryNumPages(memory);
+		addMemoryDataSegments(outIRModule, memoryIndex, memory);
+	}
+
+	// Resize the tables to their current size, and add elem segments for their elements.
+	for(Uptr tableIndex = 0; tableIndex < irModule.tables.size(); ++tableIndex)
+	{
+		const Table* table = instance->tables[tableIndex];
+		TableType& tableType = outIRModule.tables.defs[tableIndex].type;
+		const Uptr numElements = getTableNumElements(table);
+		tableType.size.min = numElements;
+
+		auto contents = std::make_shared<ElemSegment::Contents>();
+		contents->encoding = ElemSegment::Encoding::expr;
+		contents->elemType = tableType.elementType;
+		Uptr numTrailingNullElements = 0;
+		for(Uptr elementIndex = 0; elementIndex < numElements; ++elementIndex)
+		{
+			const Object* element = getTableElement(table, elementIndex);
+			InitializerExpression initializer;
+			if(!getReferenceInitializer(
+				   functionIndexMap, tableType.elementType, element, initializer))
+			{
+				Log::printf(Log::error,
+							"Can't snapshot table %" WAVM_PRIuPTR ": element %" WAVM_PRIuPTR
+							" references an object that isn't a function of the instance.\n",
+							tableIndex,
+							elementIndex);
+				return false;
+			}
+
+			if(initializer.type == InitializerExpression::Type::ref_func)
+			{
+				contents->elemExprs.push_back(
+					ElemExpr(ElemExpr::Type::ref_func, Uptr(initializer.ref)));
+				numTrailingNullElements = 0;
+			}
+			else
+			{
+				contents->elemExprs.push_back(ElemExpr(tableType.elementType));
+				++numTrailingNullElements;
+			}
+		}
+
+		// Null elements at the end of the table don't need to be initialized.
+		contents->elemExprs.resize(contents->elemExprs.size() - numTrailingNullElements);
+		if(!contents->elemExprs.size()) { continue; }
+
+		ElemSegment elemSegment;
+		elemSegment.type = ElemSegment::Type::active;
+		elemSegment.tableIndex = tableIndex;
+		elemSegment.baseOffset = tableType.indexType == IndexType::i64
+									 ? InitializerExpression(I64(0))
+									 : InitializerExpression(I32(0));
+		elemSegment.contents = contents;
+		outIRModule.elemSegments.push_back(std::move(elemSegment));
+	}
+
+	// Passive data segments and declared elem segments need the bulk memory and reference types
+	// features.
+	outIRModule.featureSpec.bulkMemoryOperations = true;
+	outIRModule.featureSpec.referenceTypes = true;
+
+	return true;
+}
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <vector>
+#include "AddressRangeIndex.h"
 #include "RuntimePrivate.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/Assert.h"
@@ -9,6 +10,7 @@
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
@@ -20,9 +22,9 @@ namespace WAVM { namespace Runtime {
 	WAVM_DEFINE_INTRINSIC_MODULE(wavmIntrinsicsTable)
 }}
 
-// Global lists of tables; used to query whether an address is reserved by one of them.
-static Platform::RWMutex tablesMutex;
-static std::vector<Table*> tables;
+// Global index of the tables' reserved address spaces; used to query whether an address is reserved
+// by one of them.
+static AddressRangeIndex<Table> tableAddressRanges;
 
 static constexpr Uptr numGuardPages = 1;
 static constexpr U64 maxTable32Elems = U64(UINT32_MAX) + 1;
@@ -54,14 +56,44 @@ static Object* getUninitializedElement()
 	return asObject(function);
 }
 
+static Uptr getTableElementTypeTag(Object* object)
+{
+	if(object->kind != ObjectKind::function) { return 0; }
+	const Function* function = asFunction(object);
+	if(!function->encodedType.impl) { return 0; }
+	const Uptr tag = getCalleeTableElementTypeTag(IR::FunctionType(function->encodedType));
+	return tag == tableElementMaxTypeTag ? 0 : tag;
+}
+
 static Uptr objectToBiasedTableElementValue(Object* object)
 {
-	return reinterpret_cast<Uptr>(object) - reinterpret_cast<Uptr>(getOutOfBoundsElement());
+	// Compiled code may call the functions in any table, including interpreted functions.
+	if(object->kind == ObjectKind::function) { bindInterpreterTrampoline(asFunction(object)); }
+
+	const Uptr biasedAddress
+		= reinterpret_cast<Uptr>(object) - reinterpret_cast<Uptr>(getOutOfBoundsElement());
+	if(!tableElementsHaveTypeTags) { return biasedAddress; }
+
+	// The biased address must survive being sign extended from the tag shift.
+	const U64 addressMask = (U64(1) << tableElementTypeTagShift) - 1;
+	WAVM_ERROR_UNLESS(
+		U64(I64(U64(biasedAddress) << (64 - tableElementTypeTagShift))
+			>> (64 - tableElementTypeTagShift))
+		== U64(biasedAddress));
+	return Uptr((U64(biasedAddress) & addressMask)
+				| (U64(getTableElementTypeTag(object)) << tableElementTypeTagShift));
 }
 
 static Object* biasedTableElementValueToObject(Uptr biasedValue)
 {
-	return reinterpret_cast<Object*>(biasedValue + reinterpret_cast<Uptr>(getOutOfBoundsElement()));
+	Uptr biasedAddress = biasedValue;
+	if(tableElementsHaveTypeTags)
+	{
+		biasedAddress = Uptr(I64(U64(biasedValue) << (64 - tableElementTypeTagShift))
+							 >> (64 - tableElementTypeTagShift));
+	}
+	return reinterpret_cast<Object*>(biasedAddress
+									 + reinterpret_cast<Uptr>(getOutOfBoundsElement()));
 }
 
 static Table* createTableImpl(Compartment* compartment,
@@ -72,10 +104,11 @@ static Table* createTableImpl(Compartment* compartment,
 	Table* table = new Table(compartment, type, std::move(debugName), resourceQuota);
 
 	// In 64-bit, allocate enough address-space to safely access 32-bit table indices without bounds
-	// checking, or 16MB (4M elements) if the host is 32-bit.
+	// checking, or 16MB (4M elements) if the host is 32-bit. 64-bit tables reserve the same address
+	// space, rather than the 1TB that maxTable64Elems would need, and can't grow past it: moving a
+	// table to a larger reservation would race with other threads' calls through it.
 	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
-	const U64 tableMaxElements = std::min(
-		type.size.max, type.indexType == IR::IndexType::i32 ? maxTable32Elems : maxTable64Elems);
+	const U64 tableMaxElements = std::min(type.size.max, maxTable32Elems);
 	const U64 tableMaxBytes = sizeof(Table::Element) * tableMaxElements;
 	const U64 tableMaxPages = tableMaxBytes >> pageBytesLog2;
 
@@ -89,11 +122,9 @@ static Table* createTableImpl(Compartment* compartment,
 		return nullptr;
 	}
 
-	// Add the table to the global array.
-	{
-		Platform::RWMutex::ExclusiveLock tablesLock(tablesMutex);
-		tables.push_back(table);
-	}
+	// Add the table to the global index.
+	tableAddressRanges.add(
+		(U8*)table->elements, ((U8*)table->elements) + table->numReservedBytes, table);
 	return table;
 }
 
@@ -128,29 +159,48 @@ static GrowResult growTableImpl(Table* table,
 			return GrowResult::outOfMaxSize;
 		}
 
-		// Try to commit pages for the new elements, and return GrowResult::outOfMemory if the
-		// commit fails.
+		// 64-bit tables can't grow past their reserved address space.
 		const Uptr newNumElements = oldNumElements + numElementsToGrow;
-		const Uptr previousNumPlatformPages
-			= getNumPlatformPages(oldNumElements * sizeof(Table::Element));
-		const Uptr newNumPlatformPages
-			= getNumPlatformPages(newNumElements * sizeof(Table::Element));
-		if(newNumPlatformPages != previousNumPlatformPages
-		   && !Platform::commitVirtualPages(
-			   (U8*)table->elements + (previousNumPlatformPages << Platform::getBytesPerPageLog2()),
-			   newNumPlatformPages - previousNumPlatformPages))
+		if(newNumElements > table->numReservedElements)
 		{
 			if(table->resourceQuota) { table->resourceQuota->tableElems.free(numElementsToGrow); }
 			return GrowResult::outOfMemory;
 		}
-		Platform::registerVirtualAllocation((newNumPlatformPages - previousNumPlatformPages)
-											<< Platform::getBytesPerPageLog2());
+
+		// If the new elements extend past the committed pages, try to commit more pages, and return
+		// GrowResult::outOfMemory if the commit fails. To avoid committing pages on every grow of a
+		// table that grows incrementally, commit at least as many pages as are already committed.
+		const Uptr newNumBytes = newNumElements * sizeof(Table::Element);
+		if(newNumBytes > table->numCommittedBytes)
+		{
+			const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+			const Uptr previousNumPlatformPages = table->numCommittedBytes >> pageBytesLog2;
+			const Uptr maxNumPlatformPages = getNumPlatformPages(table->numReservedBytes);
+			const Uptr newNumPlatformPages
+				= std::max(getNumPlatformPages(newNumBytes),
+						   std::min(previousNumPlatformPages * 2, maxNumPlatformPages));
+			if(!Platform::commitVirtualPages(
+				   (U8*)table->elements + (previousNumPlatformPages << pageBytesLog2),
+				   newNumPlatformPages - previousNumPlatformPages))
+			{
+				if(table->resourceQuota)
+				{ table->resourceQuota->tableElems.free(numElementsToGrow); }
+				return GrowResult::outOfMemory;
+			}
+			registerCommit(table->compartment,
+						   CommitKind::table,
+						   (newNumPlatformPages - previousNumPlatformPages) << pageBytesLog2);
+			table->numCommittedBytes = newNumPlatformPages << pageBytesLog2;
+		}
 
 		if(initializeNewElements)
 		{
 			// Write the uninitialized sentinel value to the new elements.
 			const Uptr biasedTableInitElement
 				= objectToBiasedTableElementValue(initializeToElement);
+			if(initializeToElement != getUninitializedElement()
+			   && !table->isRemembered.load(std::memory_order_relaxed))
+			{ rememberTableWrite(table); }
 			for(Uptr elementIndex = oldNumElements; elementIndex < newNumElements; ++elementIndex)
 			{
 				table->elements[elementIndex].biasedValue.store(biasedTableInitElement,
@@ -191,7 +241,7 @@ Table* Runtime::createTable(Compartment* compartment,
 
 	// Add the table to the compartment's tables IndexMap.
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(compartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(compartment->mutex);
 
 		table->id = compartment->tables.add(UINTPTR_MAX, table);
 		if(table->id == UINTPTR_MAX)
@@ -199,6 +249,7 @@ Table* Runtime::createTable(Compartment* compartment,
 			delete table;
 			return nullptr;
 		}
+		addYoungObject(table);
 		compartment->runtimeData->tables[table->id].base = table->elements;
 		compartment->runtimeData->tables[table->id].endIndex = table->numReservedElements;
 	}
@@ -238,7 +289,7 @@ Table* Runtime::cloneTable(Table* table, Compartment* newCompartment)
 	// Insert the table in the new compartment's tables array with the same index as it had in the
 	// original compartment's tables IndexMap.
 	{
-		Platform::RWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
+		Platform::ReaderBiasedRWMutex::ExclusiveLock compartmentLock(newCompartment->mutex);
 
 		newTable->id = table->id;
 		newCompartment->tables.insertOrFail(newTable->id, newTable);
@@ -263,19 +314,15 @@ Table::~Table()
 		compartment->runtimeData->tables[id].endIndex = 0;
 	}
 
-	// Remove the table from the global array.
+	if(isRemembered)
 	{
-		Platform::RWMutex::ExclusiveLock tablesLock(tablesMutex);
-		for(Uptr tableIndex = 0; tableIndex < tables.size(); ++tableIndex)
-		{
-			if(tables[tableIndex] == this)
-			{
-				tables.erase(tables.begin() + tableIndex);
-				break;
-			}
-		}
+		Platform::Mutex::Lock rememberedTablesLock(compartment->rememberedTablesMutex);
+		compartment->rememberedTables.removeOrFail(this);
 	}
 
+	// Remove the table from the global index.
+	tableAddressRanges.remove(this);
+
 	// Free the virtual address space.
 	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
 	if(numReservedBytes > 0)
@@ -283,9 +330,7 @@ Table::~Table()
 		Platform::freeVirtualPages((U8*)elements,
 								   (numReservedBytes >> pageBytesLog2) + numGuardPages);
 
-		Platform::deregisterVirtualAllocation(
-			getNumPlatformPages(numElements * sizeof(Table::Element))
-			<< Platform::getBytesPerPageLog2());
+		deregisterCommit(compartment, CommitKind::table, numCommittedBytes);
 	}
 
 	// Free the allocated quota.
@@ -294,21 +339,11 @@ Table::~Table()
 
 bool Runtime::isAddressOwnedByTable(U8* address, Table*& outTable, Uptr& outTableIndex)
 {
-	// Iterate over all tables and check if the address is within the reserved address space for
-	// each.
-	Platform::RWMutex::ShareableLock tablesLock(tablesMutex);
-	for(auto table : tables)
-	{
-		U8* startAddress = (U8*)table->elements;
-		U8* endAddress = ((U8*)table->elements) + table->numReservedBytes;
-		if(address >= startAddress && address < endAddress)
-		{
-			outTable = table;
-			outTableIndex = (address - startAddress) / sizeof(Table::Element);
-			return true;
-		}
-	}
-	return false;
+	// This is called by the signal handler, so it must not lock or allocate.
+	U8* startAddress = nullptr;
+	if(!tableAddressRanges.find(address, outTable, startAddress)) { return false; }
+	outTableIndex = (address - startAddress) / sizeof(Table::Element);
+	return true;
 }
 
 static Object* setTableElementNonNull(Table* table, Uptr index, Object* object)
@@ -338,36 +373,88 @@ static Object* setTableElementNonNull(Table* table, Uptr index, Object* object)
 		{ break; }
 	};
 
-	return biasedTableElementValueToObject(oldBiasedValue);
-}
+	if(!table->isRemembered.load(std::memory_order_relaxed)) { rememberTableWrite(table); }
 
-static Object* getTableElementNonNull(const Table* table, Uptr index)
-{
-	// Verify the index is within the table's bounds.
-	if(index >= table->numReservedElements)
+	// If the garbage collector is marking the compartment's objects, tell it about the reference
+	// that was overwritten, since it might not have marked it yet.
+	Object* oldObject = biasedTableElementValueToObject(oldBiasedValue);
+	Compartment* compartment = table->compartment;
+	if(compartment->isGCMarking.load(std::memory_order_seq_cst)
+	   && oldObject != getUninitializedElement())
 	{
-		throwException(ExceptionTypes::outOfBoundsTableAccess,
-					   {const_cast<Table*>(table), U64(index)});
+		Platform::Mutex::Lock overwrittenReferencesLock(compartment->gcOverwrittenReferencesMutex);
+		if(compartment->isGCMarking.load(std::memory_order_relaxed))
+		{ compartment->gcOverwrittenReferences.push_back(oldObject); }
 	}
 
-	// Use a saturated index to access the table data to ensure that it's harmless for the CPU to
-	// speculate past the above bounds check.
-	const Uptr saturatedIndex = branchlessMin(index, U64(table->numReservedElements) - 1);
+	return oldObject;
+}
 
-	// Read the table element.
-	const Uptr biasedValue
-		= table->elements[saturatedIndex].biasedValue.load(std::memory_order_acquire);
-	Object* object = biasedTableElementValueToObject(biasedValue);
+// Writes numElements contiguous elements of a table, starting at destIndex, to the biased values
+// returned by getBiasedValue(elementOffset). The caller must have already checked that the range is
+// within the table's current size, so unlike setTableElementNonNull this doesn't need to check each
+// element for the out-of-bounds sentinel. If descending is true, the elements are written from
+// highest to lowest index, so a copy to higher indices within a table reads each source element
+// before overwriting it.
+template<typename GetBiasedValue>
+static void setTableElementRange(Table* table,
+								 Uptr destIndex,
+								 Uptr numElements,
+								 bool descending,
+								 GetBiasedValue&& getBiasedValue)
+{
+	if(!numElements) { return; }
+	WAVM_ASSERT(destIndex + numElements >= destIndex);
+	WAVM_ASSERT(destIndex + numElements <= table->numElements.load(std::memory_order_acquire));
+
+	if(!table->isRemembered.load(std::memory_order_relaxed)) { rememberTableWrite(table); }
+
+	// The garbage collector only starts or stops marking while the compartment is exclusively
+	// locked, so holding it shareable keeps isGCMarking constant for the duration of the writes.
+	Compartment* compartment = table->compartment;
+	Platform::ReaderBiasedRWMutex::ShareableLock compartmentLock(compartment->mutex);
 
-	// If the element was an out-of-bounds sentinel value, throw an out-of-bounds exception.
-	if(object == getOutOfBoundsElement())
+	Table::Element* elements = table->elements + destIndex;
+	auto forEachElement = [numElements, descending](auto&& visitElement) {
+		if(descending)
+		{
+			for(Uptr offset = numElements; offset > 0; --offset) { visitElement(offset - 1); }
+		}
+		else
+		{
+			for(Uptr offset = 0; offset < numElements; ++offset) { visitElement(offset); }
+		}
+	};
+
+	if(!compartment->isGCMarking.load(std::memory_order_relaxed))
 	{
-		throwException(ExceptionTypes::outOfBoundsTableAccess,
-					   {const_cast<Table*>(table), U64(index)});
+		// If the garbage collector isn't marking, the overwritten elements don't need to be read,
+		// and the elements can be written with plain stores ordered by a single fence.
+		std::atomic_thread_fence(std::memory_order_release);
+		forEachElement([elements, &getBiasedValue](Uptr offset) {
+			elements[offset].biasedValue.store(getBiasedValue(offset), std::memory_order_relaxed);
+		});
+	}
+	else
+	{
+		// Otherwise, gather the references that were overwritten and pass them to the garbage
+		// collector in a single batch.
+		const Uptr biasedUninitializedValue
+			= objectToBiasedTableElementValue(getUninitializedElement());
+		std::vector<Object*> overwrittenObjects;
+		forEachElement([elements, biasedUninitializedValue, &getBiasedValue, &overwrittenObjects](
+						   Uptr offset) {
+			const Uptr oldBiasedValue = elements[offset].biasedValue.exchange(
+				getBiasedValue(offset), std::memory_order_acq_rel);
+			if(oldBiasedValue != biasedUninitializedValue)
+			{ overwrittenObjects.push_back(biasedTableElementValueToObject(oldBiasedValue)); }
+		});
+
+		Platform::Mutex::Lock overwrittenReferencesLock(compartment->gcOverwrittenReferencesMutex);
+		compartment->gcOverwrittenReferences.insert(compartment->gcOverwrittenReferences.end(),
+													overwrittenObjects.begin(),
+													overwrittenObjects.end());
 	}
-
-	WAVM_ASSERT(object);
-	return object;
 }
 
 Object* Runtime::setTableElement(Table* table, Uptr index, Object* newValue)
@@ -389,14 +476,61 @@ Object* Runtime::setTableElement(Table* table, Uptr index, Object* newValue)
 
 Object* Runtime::getTableElement(const Table* table, Uptr index)
 {
-	Object* object = nullptr;
-	Runtime::unwindSignalsAsExceptions(
-		[table, index, &object] { object = getTableElementNonNull(table, index); });
+	// Elements within the table's current size are always committed, so checking the index against
+	// the size instead of the reserved size allows reading the element without catching signals.
+	const Uptr numElements = table->numElements.load(std::memory_order_acquire);
+	if(index >= numElements)
+	{
+		throwException(ExceptionTypes::outOfBoundsTableAccess,
+					   {const_cast<Table*>(table), U64(index)});
+	}
 
-	// If the old table element was the uninitialized sentinel value, return null.
+	// Use a saturated index to access the table data to ensure that it's harmless for the CPU to
+	// speculate past the above bounds check.
+	const Uptr saturatedIndex = branchlessMin(index, numElements - 1);
+
+	// Read the table element.
+	const Uptr biasedValue
+		= table->elements[saturatedIndex].biasedValue.load(std::memory_order_acquire);
+	Object* object = biasedTableElementValueToObject(biasedValue);
+	WAVM_ASSERT(object && object != getOutOfBoundsElement());
+
+	// If the table element was the uninitialized sentinel value, return null.
 	return object == getUninitializedElement() ? nullptr : object;
 }
 
+Function* Runtime::getIndirectCallee(ContextRuntimeData* contextRuntimeData,
+									Uptr tableId,
+									Uptr elementIndex,
+									IR::FunctionType expectedType)
+{
+	// Clamp the index to the table's end index like compiled code does, so out-of-bounds indices
+	// read the out-of-bounds sentinel, or fault on the table's guard pages.
+	const TableRuntimeData& tableRuntimeData
+		= getCompartmentRuntimeData(contextRuntimeData)->tables[tableId];
+	const Table::Element* elements = static_cast<const Table::Element*>(tableRuntimeData.base);
+	const Uptr clampedIndex = branchlessMin(U64(elementIndex), U64(tableRuntimeData.endIndex));
+	const Uptr biasedValue = elements[clampedIndex].biasedValue.load(std::memory_order_acquire);
+	Function* function = reinterpret_cast<Function*>(biasedTableElementValueToObject(biasedValue));
+	if(WAVM_UNLIKELY(function->encodedType.impl != expectedType.getEncoding().impl))
+	{
+		Table* table = getTableFromRuntimeData(contextRuntimeData, tableId);
+		if(asObject(function) == getOutOfBoundsElement())
+		{ throwException(ExceptionTypes::outOfBoundsTableAccess, {table, U64(elementIndex)}); }
+		else if(asObject(function) == getUninitializedElement())
+		{
+			throwException(ExceptionTypes::uninitializedTableElement,
+						   {table, U64(elementIndex)});
+		}
+		else
+		{
+			throwException(ExceptionTypes::indirectCallSignatureMismatch,
+						   {function, U64(expectedType.getEncoding().impl)});
+		}
+	}
+	return function;
+}
+
 Uptr Runtime::getTableNumElements(const Table* table)
 {
 	return table->numElements.load(std::memory_order_acquire);
@@ -415,6 +549,113 @@ GrowResult Runtime::growTable(Table* table,
 	return growTableImpl(table, numElementsToGrow, outOldNumElements, true, initialElement);
 }
 
+void Runtime::captureTableResetState(Table* table)
+{
+	Platform::RWMutex::ExclusiveLock resizingLock(table->resizingMutex);
+	const Uptr numElements = table->numElements.load(std::memory_order_acquire);
+	table->resetElements.resize(numElements);
+	for(Uptr elementIndex = 0; elementIndex < numElements; ++elementIndex)
+	{
+		Object* object = biasedTableElementValueToObject(
+			table->elements[elementIndex].biasedValue.load(std::memory_order_acquire));
+		table->resetElements[elementIndex] = object == getUninitializedElement() ? nullptr : object;
+	}
+	table->hasResetElements = true;
+}
+
+void Runtime::resetTable(Table* table)
+{
+	// Read the elements to restore with the table's resizing mutex locked, but write them without
+	// it: setTableElementRange locks the compartment, which the garbage collector may hold while
+	// it waits to scan the table.
+	std::vector<Uptr> resetBiasedValues;
+	Uptr numElements;
+	{
+		Platform::RWMutex::ShareableLock resizingLock(table->resizingMutex);
+		if(!table->hasResetElements) { return; }
+		numElements = table->numElements.load(std::memory_order_acquire);
+		resetBiasedValues.reserve(numElements);
+		for(Object* object : table->resetElements)
+		{
+			resetBiasedValues.push_back(
+				objectToBiasedTableElementValue(object ? object : getUninitializedElement()));
+		}
+	}
+
+	// Restore the captured elements, and clear the elements the table grew by since, so the
+	// garbage collector is told about any references they overwrite.
+	const Uptr numResetElements = resetBiasedValues.size();
+	WAVM_ASSERT(numElements >= numResetElements);
+	const Uptr biasedUninitializedValue = objectToBiasedTableElementValue(getUninitializedElement());
+	setTableElementRange(table, 0, numElements, false, [&](Uptr offset) {
+		return offset < numResetElements ? resetBiasedValues[offset] : biasedUninitializedValue;
+	});
+
+	// Shrink the table back to its captured size.
+	if(numElements > numResetElements)
+	{
+		Platform::RWMutex::ExclusiveLock resizingLock(table->resizingMutex);
+		WAVM_ASSERT(table->numElements.load(std::memory_order_acquire) == numElements);
+		table->numElements.store(numResetElements, std::memory_order_release);
+		const Uptr biasedOutOfBoundsValue
+			= objectToBiasedTableElementValue(getOutOfBoundsElement());
+		for(Uptr elementIndex = numResetElements; elementIndex < numElements; ++elementIndex)
+		{
+			table->elements[elementIndex].biasedValue.store(biasedOutOfBoundsValue,
+															 std::memory_order_release);
+		}
+		if(table->resourceQuota)
+		{ table->resourceQuota->tableElems.free(numElements - numResetElements); }
+	}
+}
+
+// Decodes an element of an elem segment to the object it references.
+static Object* getElemSegmentElement(Instance* instance,
+									 const IR::ElemSegment::Contents* contents,
+									 Uptr sourceIndex)
+{
+	Object* elemObject = nullptr;
+	switch(contents->encoding)
+	{
+	case IR::ElemSegment::Encoding::expr: {
+		const IR::ElemExpr& elemExpr = contents->elemExprs[sourceIndex];
+		switch(elemExpr.type)
+		{
+		case IR::ElemExpr::Type::ref_null: elemObject = nullptr; break;
+		case IR::ElemExpr::Type::ref_func:
+			elemObject = asObject(instance->functions[elemExpr.index]);
+			break;
+
+		case IR::ElemExpr::Type::invalid:
+		default: WAVM_UNREACHABLE();
+		}
+		break;
+	}
+	case IR::ElemSegment::Encoding::index: {
+		const Uptr externIndex = contents->elemIndices[sourceIndex];
+		switch(contents->externKind)
+		{
+		case IR::ExternKind::function:
+			elemObject = asObject(instance->functions[externIndex]);
+			break;
+		case IR::ExternKind::table: elemObject = asObject(instance->tables[externIndex]); break;
+		case IR::ExternKind::memory: elemObject = asObject(instance->memories[externIndex]); break;
+		case IR::ExternKind::global: elemObject = asObject(instance->globals[externIndex]); break;
+		case IR::ExternKind::exceptionType:
+			elemObject = asObject(instance->exceptionTypes[externIndex]);
+			break;
+
+		case IR::ExternKind::invalid:
+		default: WAVM_UNREACHABLE();
+		}
+		break;
+	}
+	default: WAVM_UNREACHABLE();
+	};
+
+	return elemObject;
+}
+
 void Runtime::initElemSegment(Instance* instance,
 							  Uptr elemSegmentIndex,
 							  const IR::ElemSegment::Contents* contents,
@@ -461,64 +702,17 @@ void Runtime::initElemSegment(Instance* instance,
 	default: WAVM_UNREACHABLE();
 	};
 
-	for(Uptr index = 0; index < numElems; ++index)
-	{
-		Uptr sourceIndex = sourceOffset + index;
-		const Uptr destIndex = destOffset + index;
+	if(!numElems) { return; }
 
-		if(sourceIndex >= numSourceElems || sourceIndex < sourceOffset)
-		{
-			throwException(ExceptionTypes::outOfBoundsElemSegmentAccess,
-						   {asObject(instance), U64(elemSegmentIndex), sourceIndex});
-		}
-		sourceIndex = branchlessMin(sourceIndex, numSourceElems);
-
-		// Decode the element value.
-		Object* elemObject = nullptr;
-		switch(contents->encoding)
-		{
-		case IR::ElemSegment::Encoding::expr: {
-			const IR::ElemExpr& elemExpr = contents->elemExprs[sourceIndex];
-			switch(elemExpr.type)
-			{
-			case IR::ElemExpr::Type::ref_null: elemObject = nullptr; break;
-			case IR::ElemExpr::Type::ref_func:
-				elemObject = asObject(instance->functions[elemExpr.index]);
-				break;
-
-			case IR::ElemExpr::Type::invalid:
-			default: WAVM_UNREACHABLE();
-			}
-			break;
-		}
-		case IR::ElemSegment::Encoding::index: {
-			const Uptr externIndex = contents->elemIndices[sourceIndex];
-			switch(contents->externKind)
-			{
-			case IR::ExternKind::function:
-				elemObject = asObject(instance->functions[externIndex]);
-				break;
-			case IR::ExternKind::table: elemObject = asObject(instance->tables[externIndex]); break;
-			case IR::ExternKind::memory:
-				elemObject = asObject(instance->memories[externIndex]);
-				break;
-			case IR::ExternKind::global:
-				elemObject = asObject(instance->globals[externIndex]);
-				break;
-			case IR::ExternKind::exceptionType:
-				elemObject = asObject(instance->exceptionTypes[externIndex]);
-				break;
-
-			case IR::ExternKind::invalid:
-			default: WAVM_UNREACHABLE();
-			}
-			break;
-		}
-		default: WAVM_UNREACHABLE();
-		};
-
-		setTableElement(table, destIndex, elemObject);
-	}
+	// Decode the segment's elements and write them to the table in a single pass. The range was
+	// bounds checked above, but clamp the source index to ensure that it's harmless for the CPU to
+	// speculate past the bounds check.
+	const Uptr biasedUninitializedValue = objectToBiasedTableElementValue(getUninitializedElement());
+	setTableElementRange(table, destOffset, numElems, false, [&](Uptr offset) {
+		const Uptr sourceIndex = branchlessMin(sourceOffset + offset, numSourceElems - 1);
+		Object* elemObject = getElemSegmentElement(instance, contents, sourceIndex);
+		return elemObject ? objectToBiasedTableElementValue(elemObject) : biasedUninitializedValue;
+	});
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsTable,
@@ -658,29 +852,19 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsTable,
 						   {destTable, outOfBoundsDestOffset});
 		}
 
-		if(sourceOffset < destOffset)
-		{
-			// When copying to higher indices, copy the elements in descending order to ensure that
-			// source elements may only be overwritten after they have been copied.
-			for(Uptr index = 0; index < numElements; ++index)
-			{
-				setTableElementNonNull(
-					destTable,
-					U64(destOffset) + U64(numElements - index - 1),
-					getTableElementNonNull(sourceTable,
-										   U64(sourceOffset) + U64(numElements - index - 1)));
-			}
-		}
-		else
-		{
-			for(Uptr index = 0; index < numElements; ++index)
-			{
-				setTableElementNonNull(
-					destTable,
-					U64(destOffset) + U64(index),
-					getTableElementNonNull(sourceTable, U64(sourceOffset) + U64(index)));
-			}
-		}
+		// When copying to higher indices, copy the elements in descending order to ensure that
+		// source elements may only be overwritten after they have been copied. The source range was
+		// bounds checked above, and table elements within the table's size are never the
+		// out-of-bounds sentinel, so the source elements can be read directly.
+		const Table::Element* sourceElements = sourceTable->elements + sourceOffsetUptr;
+		setTableElementRange(destTable,
+							 destOffsetUptr,
+							 numElementsUptr,
+							 sourceOffsetUptr < destOffsetUptr,
+							 [sourceElements](Uptr offset) {
+								 return sourceElements[offset].biasedValue.load(
+									 std::memory_order_acquire);
+							 });
 	});
 }
 
@@ -712,8 +896,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsicsTable,
 						   {destTable, outOfBoundsDestOffset});
 		}
 
-		for(Uptr index = 0; index < numElements; ++index)
-		{ setTableElementNonNull(destTable, U64(destOffset) + U64(index), value); }
+		const Uptr biasedValue = objectToBiasedTableElementValue(value);
+		setTableElementRange(destTable,
+							 destOffsetUptr,
+							 numElementsUptr,
+							 false,
+							 [biasedValue](Uptr) { return biasedValue; });
 	});
 }
 
@@ -0,0 +1,302 @@
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RuntimePrivate.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Intrinsics.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+// An instance's function definitions are tiered up by a thread that is started when a function
+// reaches the tier-up call threshold, and exits once there are no more functions to tier up. Each
+// batch of the functions that reached the threshold while the previous batch compiled is loaded as
+// a new LLVMJIT::Module, linked to the instance like its baseline object code. A tiered-up
+// function is published by storing its code in the FunctionTierUpState of the instance's function,
+// whose baseline code, or the interpreter, forwards its calls to it. The instance's Function
+// objects stay the same, so tables, references, and exports that point to them don't need to be
+// updated.
+struct Runtime::InstanceTierUp
+{
+	const ModuleConstRef module;
+	const Uptr instanceId;
+	const std::string debugName;
+
+	// The bindings the instance's object code was loaded with, which the object code that tiers up
+	// its function definitions is loaded with too.
+	const std::vector<LLVMJIT::FunctionBinding> functionImports;
+	const std::vector<LLVMJIT::TableBinding> tables;
+	const std::vector<LLVMJIT::MemoryBinding> memories;
+	const std::vector<LLVMJIT::GlobalBinding> globals;
+	const std::vector<LLVMJIT::ExceptionTypeBinding> exceptionTypes;
+
+	// The instance's functions for the module's function imports, which are null for imports of
+	// native functions, and for its function definitions, and the indices of the definitions.
+	const std::vector<Function*> importedFunctions;
+	const std::vector<Function*> functionDefs;
+	HashMap<const Function*, Uptr> functionDefIndexMap;
+
+	// If the instance is interpreted, the tier-up states of its function definitions, in which
+	// the interpreter counts their calls.
+	std::unique_ptr<FunctionTierUpState[]> interpretedTierUpStates;
+
+	// Set when the instance is destroyed, to cancel the compile that is in progress.
+	const std::shared_ptr<std::atomic<bool>> cancelFlag;
+
+	Platform::Mutex mutex;
+	std::vector<bool> isFunctionDefRequested;
+	std::vector<Uptr> pendingFunctionDefIndices;
+	Platform::Thread* compileThread = nullptr;
+	bool isCompiling = false;
+	std::vector<std::shared_ptr<LLVMJIT::Module>> jitModules;
+
+	// Serializes the threads that wait for the compile thread to exit.
+	Platform::Mutex joinMutex;
+
+	InstanceTierUp(ModuleConstRefParam inModule,
+				   Uptr inInstanceId,
+				   const std::string& inDebugName,
+				   const std::vector<LLVMJIT::FunctionBinding>& inFunctionImports,
+				   const std::vector<LLVMJIT::TableBinding>& inTables,
+				   const std::vector<LLVMJIT::MemoryBinding>& inMemories,
+				   const std::vector<LLVMJIT::GlobalBinding>& inGlobals,
+				   const std::vector<LLVMJIT::ExceptionTypeBinding>& inExceptionTypes,
+				   const std::vector<Function*>& inImportedFunctions,
+				   const std::vector<Function*>& inFunctionDefs)
+	: module(inModule)
+	, instanceId(inInstanceId)
+	, debugName(inDebugName)
+	, functionImports(inFunctionImports)
+	, tables(inTables)
+	, memories(inMemories)
+	, globals(inGlobals)
+	, exceptionTypes(inExceptionTypes)
+	, importedFunctions(inImportedFunctions)
+	, functionDefs(inFunctionDefs)
+	, functionDefIndexMap(inFunctionDefs.size())
+	, cancelFlag(std::make_shared<std::atomic<bool>>(false))
+	, isFunctionDefRequested(inFunctionDefs.size(), false)
+	{
+		for(Uptr functionDefIndex = 0; functionDefIndex < functionDefs.size(); ++functionDefIndex)
+		{ functionDefIndexMap.addOrFail(functionDefs[functionDefIndex], functionDefIndex); }
+	}
+
+	~InstanceTierUp()
+	{
+		// Cancel the compile in progress rather than waiting for it to finish, and wait for the
+		// compile thread to exit before the state it uses is destroyed.
+		cancelFlag->store(true, std::memory_order_relaxed);
+		joinCompileThread();
+	}
+
+	void requestTierUp(const Function* function)
+	{
+		const Uptr functionDefIndex = functionDefIndexMap[function];
+
+		Platform::Mutex::Lock lock(mutex);
+		if(isFunctionDefRequested[functionDefIndex]) { return; }
+		isFunctionDefRequested[functionDefIndex] = true;
+		pendingFunctionDefIndices.push_back(functionDefIndex);
+
+		// If the compile thread has exited, or is about to, start a new one.
+		if(!isCompiling)
+		{
+			if(compileThread) { Platform::joinThread(compileThread); }
+			compileThread = Platform::createThread(8 * 1024 * 1024, compileThreadEntry, this);
+			isCompiling = true;
+		}
+	}
+
+	void joinCompileThread()
+	{
+		Platform::Mutex::Lock joinLock(joinMutex);
+
+		Platform::Mutex::Lock lock(mutex);
+		Platform::Thread* thread = compileThread;
+		compileThread = nullptr;
+		lock.unlock();
+
+		if(thread) { Platform::joinThread(thread); }
+	}
+
+	// Compiles a batch of function definitions with the optimized tier, loads the object code, and
+	// forwards the baseline code's calls to it.
+	void tierUp(std::vector<Uptr>&& functionDefIndices)
+	{
+		std::sort(functionDefIndices.begin(), functionDefIndices.end());
+		std::shared_ptr<const std::vector<U8>> objectCode
+			= module->getTierUpObjectCode(functionDefIndices, cancelFlag);
+
+		// The object code calls the instance's functions directly, so bind the trampolines of the
+		// interpreted functions it may call.
+		for(Function* importedFunction : importedFunctions)
+		{
+			if(importedFunction) { bindInterpreterTrampoline(importedFunction); }
+		}
+		for(Function* functionDef : functionDefs) { bindInterpreterTrampoline(functionDef); }
+
+		// The object code refers to the instance's functions after the module's function imports.
+		std::vector<LLVMJIT::FunctionBinding> functionBindings = functionImports;
+		for(Function* functionDef : functionDefs)
+		{ functionBindings.push_back({functionDef->code}); }
+
+		std::vector<FunctionMutableData*> functionDefMutableDatas(functionDefs.size(), nullptr);
+		for(Uptr functionDefIndex : functionDefIndices)
+		{
+			functionDefMutableDatas[functionDefIndex] = new FunctionMutableData(
+				std::string(functionDefs[functionDefIndex]->mutableData->debugName));
+		}
+		std::vector<FunctionMutableData*> invokeThunkMutableDatas(module->ir.types.size(),
+																  nullptr);
+
+		std::shared_ptr<LLVMJIT::Module> jitModule
+			= LLVMJIT::loadModule(objectCode->data(),
+								  objectCode->size(),
+								  getWAVMIntrinsicsExportMap(),
+								  std::vector<FunctionType>(module->ir.types),
+								  std::move(functionBindings),
+								  std::vector<LLVMJIT::TableBinding>(tables),
+								  std::vector<LLVMJIT::MemoryBinding>(memories),
+								  std::vector<LLVMJIT::GlobalBinding>(globals),
+								  std::vector<LLVMJIT::ExceptionTypeBinding>(exceptionTypes),
+								  {instanceId},
+								  reinterpret_cast<Uptr>(getOutOfBoundsElement()),
+								  functionDefMutableDatas,
+								  invokeThunkMutableDatas,
+								  std::string(debugName));
+
+		// The release stores pair with the acquire loads in the baseline code and the interpreter,
+		// so the code that calls the optimized code sees it loaded. The code of an interpreted
+		// function jumps to the optimized code instead of its trampoline, which takes the same
+		// arguments.
+		Platform::Mutex::Lock lock(mutex);
+		jitModules.push_back(std::move(jitModule));
+		for(Uptr functionDefIndex : functionDefIndices)
+		{
+			const Function* tieredUpFunction = functionDefMutableDatas[functionDefIndex]->function;
+			FunctionMutableData* mutableData = functionDefs[functionDefIndex]->mutableData;
+			WAVM_ASSERT(tieredUpFunction && mutableData->tierUpState);
+			mutableData->tierUpState->tieredUpCode.store(tieredUpFunction->code,
+														 std::memory_order_release);
+			if(mutableData->interpretedModule)
+			{
+				mutableData->interpreterTrampoline.store(tieredUpFunction->code,
+														 std::memory_order_release);
+			}
+		}
+	}
+
+	static I64 compileThreadEntry(void* tierUpVoid)
+	{
+		InstanceTierUp* tierUp = (InstanceTierUp*)tierUpVoid;
+		while(true)
+		{
+			// Take the functions that were requested since the last batch.
+			std::vector<Uptr> functionDefIndices;
+			{
+				Platform::Mutex::Lock lock(tierUp->mutex);
+				if(!tierUp->pendingFunctionDefIndices.size()
+				   || tierUp->cancelFlag->load(std::memory_order_relaxed))
+				{
+					tierUp->isCompiling = false;
+					return 0;
+				}
+				functionDefIndices = std::move(tierUp->pendingFunctionDefIndices);
+				tierUp->pendingFunctionDefIndices.clear();
+			}
+
+			try
+			{
+				tierUp->tierUp(std::move(functionDefIndices));
+			}
+			catch(LLVMJIT::CompileCancelledException)
+			{
+				Platform::Mutex::Lock lock(tierUp->mutex);
+				tierUp->isCompiling = false;
+				return 0;
+			}
+		}
+	}
+};
+
+std::shared_ptr<InstanceTierUp> Runtime::createInstanceTierUp(
+	ModuleConstRefParam module,
+	Uptr instanceId,
+	const std::string& debugName,
+	const std::vector<LLVMJIT::FunctionBinding>& functionImports,
+	const std::vector<LLVMJIT::TableBinding>& tables,
+	const std::vector<LLVMJIT::MemoryBinding>& memories,
+	const std::vector<LLVMJIT::GlobalBinding>& globals,
+	const std::vector<LLVMJIT::ExceptionTypeBinding>& exceptionTypes,
+	const std::vector<Function*>& importedFunctions,
+	const std::vector<Function*>& functionDefs)
+{
+	std::shared_ptr<InstanceTierUp> tierUp = std::make_shared<InstanceTierUp>(module,
+																			  instanceId,
+																			  debugName,
+																			  functionImports,
+																			  tables,
+																			  memories,
+																			  globals,
+																			  exceptionTypes,
+																			  importedFunctions,
+																			  functionDefs);
+	const bool isInterpreted
+		= functionDefs.size() && functionDefs[0]->mutableData->interpretedModule;
+	if(isInterpreted)
+	{ tierUp->interpretedTierUpStates.reset(new FunctionTierUpState[functionDefs.size()]); }
+	for(Uptr functionDefIndex = 0; functionDefIndex < functionDefs.size(); ++functionDefIndex)
+	{
+		FunctionMutableData* mutableData = functionDefs[functionDefIndex]->mutableData;
+		mutableData->instanceTierUp = tierUp.get();
+		if(isInterpreted)
+		{ mutableData->tierUpState = &tierUp->interpretedTierUpStates[functionDefIndex]; }
+	}
+	return tierUp;
+}
+
+const Function* Runtime::countInterpretedTierUpCall(const Function* function)
+{
+	FunctionMutableData* mutableData = function->mutableData;
+	FunctionTierUpState* tierUpState = mutableData->tierUpState;
+	if(const void* tieredUpCode = tierUpState->tieredUpCode.load(std::memory_order_acquire))
+	{
+		return reinterpret_cast<const Function*>(static_cast<const U8*>(tieredUpCode)
+												 - offsetof(Function, code));
+	}
+
+	InstanceTierUp* tierUp = mutableData->instanceTierUp;
+	if(tierUpState->numCalls.fetch_add(1, std::memory_order_relaxed) + 1
+	   == tierUp->module->getTierUpCallThreshold())
+	{ tierUp->requestTierUp(function); }
+	return nullptr;
+}
+
+void Runtime::waitForInstanceTierUp(const Instance* instance)
+{
+	if(instance->tierUp) { instance->tierUp->joinCompileThread(); }
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
+							   "tierUpFunction",
+							   void,
+							   tierUpFunction,
+							   const Function* function)
+{
+	if(InstanceTierUp* tierUp = function->mutableData->instanceTierUp)
+	{ tierUp->requestTierUp(function); }
+}
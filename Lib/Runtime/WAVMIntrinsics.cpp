@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <vector>
@@ -34,6 +35,11 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics, "unreachableTrap", void, unreacha
 	throwException(ExceptionTypes::reachedUnreachable);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics, "stackOverflowTrap", void, stackOverflowTrap)
+{
+	throwException(ExceptionTypes::stackOverflow);
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
 							   "invalidFloatOperationTrap",
 							   void,
@@ -42,6 +48,44 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
 	throwException(ExceptionTypes::invalidFloatOperation);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics, "epochDeadlineReached", void, epochDeadlineReached)
+{
+	// Let the context's callback decide whether to keep running, or throw an interrupted
+	// exception.
+	Context* context = getContextFromRuntimeData(contextRuntimeData);
+	if(!context->epochDeadlineCallback
+	   || !context->epochDeadlineCallback(context, context->epochDeadlineCallbackUserData))
+	{ throwException(ExceptionTypes::interrupted); }
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics, "fuelExhausted", void, fuelExhausted)
+{
+	Context* context = getContextFromRuntimeData(contextRuntimeData);
+	WAVM_ASSERT(contextRuntimeData->fuel < 0);
+
+	// Take more fuel from the context's resource quota, including the fuel that was charged past
+	// zero.
+	if(context->resourceQuota)
+	{
+		const U64 overdraft = U64(0) - U64(contextRuntimeData->fuel);
+		const U64 refillAmount = std::min(
+			context->resourceQuota->fuelRefillAmount.load(std::memory_order_relaxed),
+			U64(INT64_MAX));
+		if(context->resourceQuota->fuel.allocate(overdraft + refillAmount))
+		{
+			contextRuntimeData->fuel = I64(refillAmount);
+			return;
+		}
+	}
+
+	if(!context->fuelExhaustedCallback
+	   || !context->fuelExhaustedCallback(context, context->fuelExhaustedCallbackUserData))
+	{
+		contextRuntimeData->fuel = 0;
+		throwException(ExceptionTypes::outOfFuel);
+	}
+}
+
 static thread_local Uptr indentLevel = 0;
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wavmIntrinsics,
@@ -96,6 +96,10 @@ static I64 threadEntry(void* threadVoid)
 		thread->removeRef();
 	}
 
+	// Run the thread on its compartment's NUMA node, if it has one.
+	const Uptr numaNode = getCompartmentLayout(getCompartment(currentThread->context)).numaNode;
+	if(numaNode != UINTPTR_MAX) { Platform::bindCurrentThreadToNUMANode(numaNode); }
+
 	catchRuntimeExceptions(
 		[]() {
 			I64 result;
@@ -0,0 +1,287 @@
+#include "WAVM/VFS/BufferedVFD.h"
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Event.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/VFS/VFS.h"
+
+using namespace WAVM;
+using namespace WAVM::VFS;
+
+struct BufferedVFD : VFD
+{
+	BufferedVFD(VFD* inInnerVFD, const BufferedVFDConfig& inConfig)
+	: innerVFD(inInnerVFD), config(inConfig)
+	{
+		buffer.reserve(config.numBufferBytes);
+		flushBuffer.reserve(config.numBufferBytes);
+		flushThread = Platform::createThread(0, flushThreadMain, this);
+	}
+
+	virtual Result close() override
+	{
+		// Stop the flush thread, and write the buffered bytes before closing the inner VFD.
+		shouldExitFlushThread.store(true, std::memory_order_release);
+		flushEvent.signal();
+		Platform::joinThread(flushThread);
+
+		Result result = flush();
+		const Result closeResult = innerVFD->close();
+		if(result == Result::success) { result = closeResult; }
+
+		delete this;
+		return result;
+	}
+
+	virtual Result seek(I64 offset, SeekOrigin origin, U64* outAbsoluteOffset) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->seek(offset, origin, outAbsoluteOffset);
+	}
+
+	virtual Result readv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesRead,
+						 const U64* offset) override
+	{
+		return innerVFD->readv(buffers, numBuffers, outNumBytesRead, offset);
+	}
+
+	virtual Result writev(const IOWriteBuffer* buffers,
+						  Uptr numBuffers,
+						  Uptr* outNumBytesWritten,
+						  const U64* offset) override
+	{
+		Uptr numBytes = 0;
+		for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
+		{ numBytes += buffers[bufferIndex].numBytes; }
+
+		// Write positioned writes, and writes that are too large to buffer, directly to the inner
+		// VFD after the buffered bytes.
+		if(offset || numBytes >= config.numBufferBytes)
+		{
+			Platform::Mutex::Lock flushLock(flushMutex);
+			const Result flushResult = flushWithLock();
+			if(flushResult != Result::success) { return flushResult; }
+			return innerVFD->writev(buffers, numBuffers, outNumBytesWritten, offset);
+		}
+
+		bool wasBufferEmpty = false;
+		bool containsNewline = false;
+		while(true)
+		{
+			{
+				// The buffer mutex is only held while copying into the buffer, so writers don't
+				// wait for the buffered bytes to be written to the inner VFD unless the buffer is
+				// full.
+				Platform::Mutex::Lock bufferLock(bufferMutex);
+				if(buffer.size() + numBytes <= config.numBufferBytes)
+				{
+					wasBufferEmpty = buffer.empty();
+					for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
+					{
+						const U8* data = (const U8*)buffers[bufferIndex].data;
+						const Uptr numBufferBytes = buffers[bufferIndex].numBytes;
+						buffer.insert(buffer.end(), data, data + numBufferBytes);
+						if(config.flushOnNewline && !containsNewline
+						   && memchr(data, '\n', numBufferBytes))
+						{ containsNewline = true; }
+					}
+					break;
+				}
+			}
+
+			// If the buffer didn't have room for the write, write the buffered bytes to the inner
+			// VFD and try again.
+			const Result flushResult = flush();
+			if(flushResult != Result::success) { return flushResult; }
+		};
+
+		if(outNumBytesWritten) { *outNumBytesWritten = numBytes; }
+
+		if(containsNewline) { return flush(); }
+		else if(wasBufferEmpty)
+		{
+			// Wake the flush thread so it writes the buffer after the maximum flush delay.
+			flushEvent.signal();
+		}
+
+		return Result::success;
+	}
+
+	virtual Result sync(SyncType type) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->sync(type);
+	}
+
+	virtual Result getVFDInfo(VFDInfo& outInfo) override { return innerVFD->getVFDInfo(outInfo); }
+
+	virtual Result getFileInfo(FileInfo& outInfo) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->getFileInfo(outInfo);
+	}
+
+	virtual Result setVFDFlags(const VFDFlags& flags) override
+	{
+		return innerVFD->setVFDFlags(flags);
+	}
+
+	virtual Result setFileSize(U64 numBytes) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->setFileSize(numBytes);
+	}
+
+	virtual Result advise(U64 offset, U64 numBytes, FileAdvice advice) override
+	{
+		return innerVFD->advise(offset, numBytes, advice);
+	}
+
+	virtual Result allocate(U64 offset, U64 numBytes) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->allocate(offset, numBytes);
+	}
+
+	virtual Result setFileTimes(bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		return innerVFD->setFileTimes(
+			setLastAccessTime, lastAccessTime, setLastWriteTime, lastWriteTime);
+	}
+
+	virtual Result openDir(DirEntStream*& outStream) override
+	{
+		return innerVFD->openDir(outStream);
+	}
+
+	virtual Result getHostHandle(Uptr& outHandle) override
+	{
+		return innerVFD->getHostHandle(outHandle);
+	}
+
+	virtual Result recvv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 const SocketRecvFlags& flags,
+						 Uptr* outNumBytesReceived,
+						 bool* outIsTruncated) override
+	{
+		return innerVFD->recvv(buffers, numBuffers, flags, outNumBytesReceived, outIsTruncated);
+	}
+
+	virtual Result sendv(const IOWriteBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesSent) override
+	{
+		Platform::Mutex::Lock flushLock(flushMutex);
+		const Result flushResult = flushWithLock();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->sendv(buffers, numBuffers, outNumBytesSent);
+	}
+
+	virtual Result shutdown(SocketShutdownType type) override
+	{
+		const Result flushResult = flush();
+		if(flushResult != Result::success) { return flushResult; }
+		return innerVFD->shutdown(type);
+	}
+
+private:
+	VFD* innerVFD;
+	const BufferedVFDConfig config;
+
+	// Serializes writes to the inner VFD, so the buffered bytes are written in order. To avoid
+	// deadlocks, flushMutex must be locked before bufferMutex.
+	Platform::Mutex flushMutex;
+	std::vector<U8> flushBuffer;
+	Result deferredFlushResult = Result::success;
+
+	Platform::Mutex bufferMutex;
+	std::vector<U8> buffer;
+
+	Platform::Thread* flushThread = nullptr;
+	Platform::Event flushEvent;
+	std::atomic<bool> shouldExitFlushThread{false};
+
+	Result flush()
+	{
+		Platform::Mutex::Lock flushLock(flushMutex);
+		return flushWithLock();
+	}
+
+	// Writes the buffered bytes to the inner VFD. Also returns any error from a write by the flush
+	// thread since the last call. flushMutex must be locked by the caller.
+	Result flushWithLock()
+	{
+		WAVM_ASSERT_MUTEX_IS_LOCKED_BY_CURRENT_THREAD(flushMutex);
+
+		// Swap the buffer with the empty flush buffer, so writers can keep adding to the buffer
+		// while the buffered bytes are written to the inner VFD.
+		WAVM_ASSERT(flushBuffer.empty());
+		{
+			Platform::Mutex::Lock bufferLock(bufferMutex);
+			buffer.swap(flushBuffer);
+		}
+
+		Result result = Result::success;
+		const U8* data = flushBuffer.data();
+		Uptr numBytes = flushBuffer.size();
+		while(numBytes > 0)
+		{
+			Uptr numBytesWritten = 0;
+			result = innerVFD->write(data, numBytes, &numBytesWritten);
+			if(result != Result::success) { break; }
+			else if(!numBytesWritten)
+			{
+				result = Result::ioDeviceError;
+				break;
+			}
+
+			data += numBytesWritten;
+			numBytes -= numBytesWritten;
+		};
+		flushBuffer.clear();
+
+		if(result == Result::success) { result = deferredFlushResult; }
+		deferredFlushResult = Result::success;
+		return result;
+	}
+
+	static I64 flushThreadMain(void* vfdVoid)
+	{
+		BufferedVFD* vfd = (BufferedVFD*)vfdVoid;
+		while(!vfd->shouldExitFlushThread.load(std::memory_order_acquire))
+		{
+			// Wait for a write to the empty buffer, and then for the maximum flush delay, before
+			// writing the buffered bytes to the inner VFD.
+			vfd->flushEvent.wait(Time::infinity());
+			if(vfd->shouldExitFlushThread.load(std::memory_order_acquire)) { break; }
+			vfd->flushEvent.wait(vfd->config.maxFlushDelay);
+
+			// If the write fails, save the error to return from the next operation that flushes.
+			Platform::Mutex::Lock flushLock(vfd->flushMutex);
+			const Result result = vfd->flushWithLock();
+			if(result != Result::success) { vfd->deferredFlushResult = result; }
+		};
+		return 0;
+	}
+};
+
+VFD* VFS::makeBufferedVFD(VFD* innerVFD, const BufferedVFDConfig& config)
+{
+	WAVM_ASSERT(config.numBufferBytes > 0);
+	return new BufferedVFD(innerVFD, config);
+}
@@ -0,0 +1,486 @@
+#include "WAVM/VFS/BundleFS.h"
+#include <string.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "VFSPrivate.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/VFS/VFS.h"
+
+using namespace WAVM;
+using namespace WAVM::VFS;
+
+// A file or directory in a bundle. A file's bytes point into the mapped archive.
+struct BundleNode
+{
+	FileType type;
+	U64 fileNumber;
+	Time lastWriteTime;
+	const U8* bytes = nullptr;
+	U64 numBytes = 0;
+	HashMap<std::string, std::unique_ptr<BundleNode>> children;
+
+	BundleNode(FileType inType, U64 inFileNumber, Time inLastWriteTime)
+	: type(inType), fileNumber(inFileNumber), lastWriteTime(inLastWriteTime)
+	{
+	}
+};
+
+// The mapped archive, and the tree of nodes that point into it. It isn't modified after it's
+// loaded, so it may be read by many threads without locking.
+struct BundleState
+{
+	const U64 deviceNumber;
+	Platform::MappedFile mappedFile;
+	BundleNode rootDir;
+	U64 nextFileNumber{2};
+
+	BundleState(const Platform::MappedFile& inMappedFile)
+	: deviceNumber(allocateVirtualDeviceNumber())
+	, mappedFile(inMappedFile)
+	, rootDir(FileType::directory, 1, Time{0})
+	{
+	}
+	~BundleState() { Platform::unmapFile(mappedFile); }
+
+	const BundleNode* lookup(const std::string& path, Result& outResult) const
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components))
+		{
+			outResult = Result::notAccessible;
+			return nullptr;
+		}
+
+		const BundleNode* node = &rootDir;
+		for(const std::string& component : components)
+		{
+			if(node->type != FileType::directory)
+			{
+				outResult = Result::isNotDirectory;
+				return nullptr;
+			}
+			const std::unique_ptr<BundleNode>* child = node->children.get(component);
+			if(!child)
+			{
+				outResult = Result::doesNotExist;
+				return nullptr;
+			}
+			node = child->get();
+		}
+		outResult = Result::success;
+		return node;
+	}
+
+	// Adds a node to the tree for an archive member, and any of its parent directories that
+	// weren't archive members. Returns null if the path conflicts with an existing node.
+	BundleNode* addNode(const std::string& path, FileType type, Time lastWriteTime)
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components) || !components.size()) { return nullptr; }
+
+		BundleNode* node = &rootDir;
+		for(Uptr componentIndex = 0; componentIndex < components.size(); ++componentIndex)
+		{
+			if(node->type != FileType::directory) { return nullptr; }
+
+			const bool isLastComponent = componentIndex + 1 == components.size();
+			std::unique_ptr<BundleNode>& child
+				= node->children.getOrAdd(components[componentIndex]);
+			if(!child)
+			{
+				child.reset(new BundleNode(isLastComponent ? type : FileType::directory,
+										   nextFileNumber++,
+										   lastWriteTime));
+			}
+			else if(isLastComponent && (type != FileType::directory || child->type != type))
+			{
+				return nullptr;
+			}
+			node = child.get();
+		}
+		return node;
+	}
+
+	void getFileInfo(const BundleNode& node, FileInfo& outInfo) const
+	{
+		outInfo.deviceNumber = deviceNumber;
+		outInfo.fileNumber = node.fileNumber;
+		outInfo.type = node.type;
+		outInfo.numLinks = 1;
+		outInfo.numBytes = node.numBytes;
+		outInfo.lastAccessTime = node.lastWriteTime;
+		outInfo.lastWriteTime = node.lastWriteTime;
+		outInfo.creationTime = node.lastWriteTime;
+	}
+};
+
+//
+// Archive parsing: the archive is in the POSIX ustar format, optionally with the GNU long name
+// and pax path extensions that tar uses for paths that don't fit in a ustar header.
+//
+
+static constexpr Uptr tarBlockBytes = 512;
+
+static bool parseTarNumber(const U8* field, Uptr numFieldBytes, U64& outValue)
+{
+	outValue = 0;
+	Uptr charIndex = 0;
+	while(charIndex < numFieldBytes && field[charIndex] == ' ') { ++charIndex; }
+	for(; charIndex < numFieldBytes && field[charIndex] >= '0' && field[charIndex] <= '7';
+		++charIndex)
+	{
+		if(outValue >> 61) { return false; }
+		outValue = outValue * 8 + (field[charIndex] - '0');
+	}
+	return charIndex == numFieldBytes || field[charIndex] == ' ' || field[charIndex] == 0;
+}
+
+static std::string getTarString(const U8* field, Uptr numFieldBytes)
+{
+	const U8* end = (const U8*)memchr(field, 0, numFieldBytes);
+	return std::string((const char*)field, end ? Uptr(end - field) : numFieldBytes);
+}
+
+static bool isValidTarHeaderChecksum(const U8* header)
+{
+	U64 expectedChecksum = 0;
+	if(!parseTarNumber(header + 148, 8, expectedChecksum)) { return false; }
+
+	// The checksum is the sum of the header's bytes, with the checksum field treated as spaces.
+	U64 checksum = 0;
+	for(Uptr byteIndex = 0; byteIndex < tarBlockBytes; ++byteIndex)
+	{ checksum += (byteIndex >= 148 && byteIndex < 156) ? U8(' ') : header[byteIndex]; }
+	return checksum == expectedChecksum;
+}
+
+// Finds the path record in a pax extended header's records, which are "<length> <key>=<value>\n".
+static bool getPaxPath(const U8* records, U64 numRecordBytes, std::string& outPath)
+{
+	U64 offset = 0;
+	while(offset < numRecordBytes)
+	{
+		U64 numBytes = 0;
+		U64 lengthEnd = offset;
+		while(lengthEnd < numRecordBytes && records[lengthEnd] >= '0' && records[lengthEnd] <= '9'
+			  && numBytes <= numRecordBytes)
+		{ numBytes = numBytes * 10 + (records[lengthEnd++] - '0'); }
+		if(lengthEnd == offset || lengthEnd >= numRecordBytes || records[lengthEnd] != ' '
+		   || numBytes > numRecordBytes - offset || offset + numBytes <= lengthEnd + 1
+		   || records[offset + numBytes - 1] != '\n')
+		{ return false; }
+
+		const char* record = (const char*)records + lengthEnd + 1;
+		const Uptr numRecordChars = Uptr(offset + numBytes - 1 - (lengthEnd + 1));
+		if(numRecordChars >= 5 && !memcmp(record, "path=", 5))
+		{ outPath.assign(record + 5, numRecordChars - 5); }
+
+		offset += numBytes;
+	}
+	return true;
+}
+
+static bool loadTarArchive(BundleState& bundle)
+{
+	const U8* bytes = bundle.mappedFile.bytes;
+	const Uptr numBytes = bundle.mappedFile.numBytes;
+
+	std::string nextPath;
+	Uptr offset = 0;
+	while(numBytes - offset >= tarBlockBytes)
+	{
+		const U8* header = bytes + offset;
+		offset += tarBlockBytes;
+
+		// The archive ends with an empty block.
+		if(header[0] == 0) { break; }
+		if(!isValidTarHeaderChecksum(header)) { return false; }
+
+		U64 numMemberBytes = 0;
+		U64 lastWriteSeconds = 0;
+		if(!parseTarNumber(header + 124, 12, numMemberBytes)
+		   || !parseTarNumber(header + 136, 12, lastWriteSeconds)
+		   || numMemberBytes > numBytes - offset)
+		{ return false; }
+		const U8* memberBytes = bytes + offset;
+		offset += Uptr((numMemberBytes + tarBlockBytes - 1) & ~U64(tarBlockBytes - 1));
+		if(offset > numBytes) { offset = numBytes; }
+
+		// GNU long name and pax extended headers set the path of the following member.
+		const U8 typeFlag = header[156];
+		if(typeFlag == 'L')
+		{
+			nextPath = getTarString(memberBytes, Uptr(numMemberBytes));
+			continue;
+		}
+		else if(typeFlag == 'x')
+		{
+			if(!getPaxPath(memberBytes, numMemberBytes, nextPath)) { return false; }
+			continue;
+		}
+
+		std::string path;
+		if(nextPath.size()) { path = std::move(nextPath); }
+		else
+		{
+			path = getTarString(header, 100);
+			if(!memcmp(header + 257, "ustar", 5) && header[345])
+			{ path = getTarString(header + 345, 155) + '/' + path; }
+		}
+		nextPath.clear();
+
+		const Time lastWriteTime{I128(lastWriteSeconds) * 1000000000};
+		if(typeFlag == '0' || typeFlag == 0 || typeFlag == '7')
+		{
+			BundleNode* file = bundle.addNode(path, FileType::file, lastWriteTime);
+			if(!file) { return false; }
+			file->bytes = memberBytes;
+			file->numBytes = numMemberBytes;
+		}
+		else if(typeFlag == '5')
+		{
+			if(!bundle.addNode(path, FileType::directory, lastWriteTime)) { return false; }
+		}
+
+		// Other members, such as links and global pax headers, are skipped.
+	}
+	return true;
+}
+
+struct BundleVFD : VirtualFileVFD
+{
+	BundleVFD(const std::shared_ptr<const BundleState>& inBundle,
+			  const BundleNode* inNode,
+			  const VFDFlags& inFlags)
+	: bundle(inBundle), node(inNode), flags(inFlags)
+	{
+	}
+
+	virtual Result close() override
+	{
+		delete this;
+		return Result::success;
+	}
+
+	virtual Result seek(I64 seekOffset, SeekOrigin origin, U64* outAbsoluteOffset) override
+	{
+		if(node->type == FileType::directory) { return Result::notSeekable; }
+
+		Platform::Mutex::Lock lock(mutex);
+		const Result result = getSeekOffset(seekOffset, origin, offset, node->numBytes, offset);
+		if(result == Result::success && outAbsoluteOffset) { *outAbsoluteOffset = offset; }
+		return result;
+	}
+
+	virtual Result readv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesRead,
+						 const U64* readOffset) override
+	{
+		if(outNumBytesRead) { *outNumBytesRead = 0; }
+		if(node->type == FileType::directory) { return Result::isDirectory; }
+
+		// Reads copy directly from the mapped archive.
+		Uptr numBytesRead = 0;
+		if(readOffset)
+		{
+			numBytesRead
+				= readFromBytes(node->bytes, node->numBytes, *readOffset, buffers, numBuffers);
+		}
+		else
+		{
+			Platform::Mutex::Lock lock(mutex);
+			numBytesRead = readFromBytes(node->bytes, node->numBytes, offset, buffers, numBuffers);
+			offset += numBytesRead;
+		}
+
+		if(outNumBytesRead) { *outNumBytesRead = numBytesRead; }
+		return Result::success;
+	}
+
+	virtual Result writev(const IOWriteBuffer* buffers,
+						  Uptr numBuffers,
+						  Uptr* outNumBytesWritten,
+						  const U64* writeOffset) override
+	{
+		if(outNumBytesWritten) { *outNumBytesWritten = 0; }
+		return node->type == FileType::directory ? Result::isDirectory : Result::notAccessible;
+	}
+
+	virtual Result sync(SyncType type) override { return Result::success; }
+
+	virtual Result getVFDInfo(VFDInfo& outInfo) override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		outInfo.type = node->type;
+		outInfo.flags = flags;
+		return Result::success;
+	}
+
+	virtual Result getFileInfo(FileInfo& outInfo) override
+	{
+		bundle->getFileInfo(*node, outInfo);
+		return Result::success;
+	}
+
+	virtual Result setVFDFlags(const VFDFlags& newFlags) override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		flags = newFlags;
+		return Result::success;
+	}
+
+	virtual Result setFileSize(U64 numBytes) override { return Result::notPermitted; }
+
+	virtual Result advise(U64 adviceOffset, U64 numBytes, FileAdvice advice) override
+	{
+		return Result::success;
+	}
+
+	virtual Result allocate(U64 allocateOffset, U64 numBytes) override
+	{
+		return Result::notPermitted;
+	}
+
+	virtual Result setFileTimes(bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		return Result::notPermitted;
+	}
+
+	virtual Result openDir(DirEntStream*& outStream) override
+	{
+		if(node->type != FileType::directory) { return Result::isNotDirectory; }
+		outStream = openBundleDir(*node);
+		return Result::success;
+	}
+
+	static DirEntStream* openBundleDir(const BundleNode& dir)
+	{
+		std::vector<DirEnt> entries;
+		for(const auto& pair : dir.children)
+		{ entries.push_back(DirEnt{pair.value->fileNumber, pair.key, pair.value->type}); }
+		return new SnapshotDirEntStream(std::move(entries));
+	}
+
+private:
+	const std::shared_ptr<const BundleState> bundle;
+	const BundleNode* const node;
+
+	Platform::Mutex mutex;
+	VFDFlags flags;
+	U64 offset = 0;
+};
+
+struct BundleFS : FileSystem
+{
+	BundleFS(std::shared_ptr<const BundleState>&& inBundle) : bundle(std::move(inBundle)) {}
+
+	virtual Result open(const std::string& path,
+						FileAccessMode accessMode,
+						FileCreateMode createMode,
+						VFD*& outFD,
+						const VFDFlags& flags) override
+	{
+		Result result;
+		const BundleNode* node = bundle->lookup(path, result);
+		if(!node)
+		{
+			const bool shouldCreate = createMode == FileCreateMode::createAlways
+									  || createMode == FileCreateMode::createNew
+									  || createMode == FileCreateMode::openAlways;
+			return result == Result::doesNotExist && shouldCreate ? Result::notPermitted : result;
+		}
+
+		switch(createMode)
+		{
+		case FileCreateMode::createNew: return Result::alreadyExists;
+		case FileCreateMode::createAlways:
+		case FileCreateMode::truncateExisting: return Result::notPermitted;
+		case FileCreateMode::openAlways:
+		case FileCreateMode::openExisting: break;
+		default: WAVM_UNREACHABLE();
+		};
+
+		if(accessMode == FileAccessMode::writeOnly || accessMode == FileAccessMode::readWrite)
+		{ return node->type == FileType::directory ? Result::isDirectory : Result::notPermitted; }
+
+		outFD = new BundleVFD(bundle, node, flags);
+		return Result::success;
+	}
+
+	virtual Result getFileInfo(const std::string& path, FileInfo& outInfo) override
+	{
+		Result result;
+		const BundleNode* node = bundle->lookup(path, result);
+		if(node) { bundle->getFileInfo(*node, outInfo); }
+		return result;
+	}
+
+	virtual Result setFileTimes(const std::string& path,
+								bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		Result result;
+		return bundle->lookup(path, result) ? Result::notPermitted : result;
+	}
+
+	virtual Result openDir(const std::string& path, DirEntStream*& outStream) override
+	{
+		Result result;
+		const BundleNode* node = bundle->lookup(path, result);
+		if(!node) { return result; }
+		if(node->type != FileType::directory) { return Result::isNotDirectory; }
+
+		outStream = BundleVFD::openBundleDir(*node);
+		return Result::success;
+	}
+
+	virtual Result renameFile(const std::string& oldPath, const std::string& newPath) override
+	{
+		Result result;
+		return bundle->lookup(oldPath, result) ? Result::notPermitted : result;
+	}
+
+	virtual Result unlinkFile(const std::string& path) override
+	{
+		Result result;
+		return bundle->lookup(path, result) ? Result::notPermitted : result;
+	}
+
+	virtual Result removeDir(const std::string& path) override
+	{
+		Result result;
+		return bundle->lookup(path, result) ? Result::notPermitted : result;
+	}
+
+	virtual Result createDir(const std::string& path) override
+	{
+		Result result;
+		return bundle->lookup(path, result) ? Result::alreadyExists : Result::notPermitted;
+	}
+
+private:
+	const std::shared_ptr<const BundleState> bundle;
+};
+
+std::shared_ptr<FileSystem> VFS::makeBundleFS(const std::string& archivePath)
+{
+	Platform::MappedFile mappedFile;
+	if(Platform::mapFile(archivePath, mappedFile) != Result::success) { return nullptr; }
+
+	std::shared_ptr<BundleState> bundle = std::make_shared<BundleState>(mappedFile);
+	if(!loadTarArchive(*bundle)) { return nullptr; }
+
+	return std::make_shared<BundleFS>(std::move(bundle));
+}
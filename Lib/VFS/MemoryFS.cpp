@@ -0,0 +1,550 @@
+#include "WAVM/VFS/MemoryFS.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "VFSPrivate.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/VFS/VFS.h"
+
+using namespace WAVM;
+using namespace WAVM::VFS;
+
+struct MemoryFSState;
+
+// A file or directory in a MemoryFS. All of a node's mutable state is guarded by its file
+// system's mutex.
+struct MemoryNode
+{
+	MemoryFSState* const fs;
+	const FileType type;
+	const U64 fileNumber;
+
+	Time lastAccessTime;
+	Time lastWriteTime;
+	Time creationTime;
+
+	// A file's contents, or a directory's entries.
+	std::vector<U8> bytes;
+	HashMap<std::string, std::shared_ptr<MemoryNode>> children;
+
+	MemoryNode(MemoryFSState* inFS, FileType inType, U64 inFileNumber)
+	: fs(inFS), type(inType), fileNumber(inFileNumber)
+	{
+		lastAccessTime = lastWriteTime = creationTime
+			= Platform::getClockTime(Platform::Clock::realtime);
+	}
+	~MemoryNode();
+};
+
+struct MemoryFSState
+{
+	const U64 deviceNumber;
+	const U64 maxFileBytes;
+
+	Platform::Mutex mutex;
+	U64 nextFileNumber{1};
+
+	// The total size of the files, including files that were unlinked but are still open. It's
+	// decreased without locking the mutex when a node is deleted.
+	std::atomic<U64> numFileBytes{0};
+
+	// The root directory is destroyed before the other members.
+	std::shared_ptr<MemoryNode> rootDir;
+
+	MemoryFSState(U64 inMaxFileBytes)
+	: deviceNumber(allocateVirtualDeviceNumber()), maxFileBytes(inMaxFileBytes)
+	{
+		rootDir = createNode(FileType::directory);
+	}
+
+	// The mutex must be locked to call any of the following methods.
+
+	std::shared_ptr<MemoryNode> createNode(FileType type)
+	{
+		return std::make_shared<MemoryNode>(this, type, nextFileNumber++);
+	}
+
+	// Resizes a file, without exceeding the file system's quota.
+	Result resizeFile(MemoryNode& file, U64 numBytes)
+	{
+		WAVM_ASSERT(file.type == FileType::file);
+		if(numBytes > file.bytes.size())
+		{
+			if(numBytes > U64(INT64_MAX) || numBytes > UINTPTR_MAX)
+			{ return Result::exceededFileSizeLimit; }
+
+			const U64 numAddedBytes = numBytes - file.bytes.size();
+			if(numAddedBytes > maxFileBytes - numFileBytes.load(std::memory_order_relaxed))
+			{ return Result::outOfQuota; }
+			numFileBytes += numAddedBytes;
+		}
+		else
+		{
+			numFileBytes -= file.bytes.size() - numBytes;
+		}
+		file.bytes.resize(Uptr(numBytes));
+		file.lastWriteTime = Platform::getClockTime(Platform::Clock::realtime);
+		return Result::success;
+	}
+
+	// Finds the node for a path.
+	Result lookup(const std::string& path, std::shared_ptr<MemoryNode>& outNode)
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components)) { return Result::notAccessible; }
+
+		outNode = rootDir;
+		for(const std::string& component : components)
+		{
+			if(outNode->type != FileType::directory) { return Result::isNotDirectory; }
+			const std::shared_ptr<MemoryNode>* child = outNode->children.get(component);
+			if(!child) { return Result::doesNotExist; }
+			outNode = *child;
+		}
+		return Result::success;
+	}
+
+	// Finds the directory that contains a path, and the path's name in it. The root directory
+	// isn't contained by any directory.
+	Result lookupParent(const std::string& path,
+						std::shared_ptr<MemoryNode>& outParentDir,
+						std::string& outName)
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components)) { return Result::notAccessible; }
+		if(!components.size()) { return Result::busy; }
+
+		outName = std::move(components.back());
+		components.pop_back();
+
+		outParentDir = rootDir;
+		for(const std::string& component : components)
+		{
+			const std::shared_ptr<MemoryNode>* child = outParentDir->children.get(component);
+			if(!child) { return Result::doesNotExist; }
+			outParentDir = *child;
+			if(outParentDir->type != FileType::directory) { return Result::isNotDirectory; }
+		}
+		return Result::success;
+	}
+
+	void getFileInfo(const MemoryNode& node, FileInfo& outInfo)
+	{
+		outInfo.deviceNumber = deviceNumber;
+		outInfo.fileNumber = node.fileNumber;
+		outInfo.type = node.type;
+		outInfo.numLinks = 1;
+		outInfo.numBytes = node.bytes.size();
+		outInfo.lastAccessTime = node.lastAccessTime;
+		outInfo.lastWriteTime = node.lastWriteTime;
+		outInfo.creationTime = node.creationTime;
+	}
+};
+
+MemoryNode::~MemoryNode() { fs->numFileBytes -= bytes.size(); }
+
+static void setNodeTimes(MemoryNode& node,
+						 bool setLastAccessTime,
+						 Time lastAccessTime,
+						 bool setLastWriteTime,
+						 Time lastWriteTime)
+{
+	if(setLastAccessTime) { node.lastAccessTime = lastAccessTime; }
+	if(setLastWriteTime) { node.lastWriteTime = lastWriteTime; }
+}
+
+static DirEntStream* openNodeDir(const MemoryNode& dir)
+{
+	std::vector<DirEnt> entries;
+	for(const auto& pair : dir.children)
+	{ entries.push_back(DirEnt{pair.value->fileNumber, pair.key, pair.value->type}); }
+	return new SnapshotDirEntStream(std::move(entries));
+}
+
+struct MemoryVFD : VirtualFileVFD
+{
+	MemoryVFD(const std::shared_ptr<MemoryFSState>& inFS,
+			  std::shared_ptr<MemoryNode>&& inNode,
+			  FileAccessMode inAccessMode,
+			  const VFDFlags& inFlags)
+	: fs(inFS), node(std::move(inNode)), accessMode(inAccessMode), flags(inFlags)
+	{
+	}
+
+	virtual Result close() override
+	{
+		delete this;
+		return Result::success;
+	}
+
+	virtual Result seek(I64 seekOffset, SeekOrigin origin, U64* outAbsoluteOffset) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type == FileType::directory) { return Result::notSeekable; }
+
+		const Result result = getSeekOffset(seekOffset, origin, offset, node->bytes.size(), offset);
+		if(result == Result::success && outAbsoluteOffset) { *outAbsoluteOffset = offset; }
+		return result;
+	}
+
+	virtual Result readv(const IOReadBuffer* buffers,
+						 Uptr numBuffers,
+						 Uptr* outNumBytesRead,
+						 const U64* readOffset) override
+	{
+		if(outNumBytesRead) { *outNumBytesRead = 0; }
+
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type == FileType::directory) { return Result::isDirectory; }
+		if(accessMode != FileAccessMode::readOnly && accessMode != FileAccessMode::readWrite)
+		{ return Result::notAccessible; }
+
+		const U64 startOffset = readOffset ? *readOffset : offset;
+		const Uptr numBytesRead = readFromBytes(
+			node->bytes.data(), node->bytes.size(), startOffset, buffers, numBuffers);
+		if(!readOffset) { offset += numBytesRead; }
+		node->lastAccessTime = Platform::getClockTime(Platform::Clock::realtime);
+
+		if(outNumBytesRead) { *outNumBytesRead = numBytesRead; }
+		return Result::success;
+	}
+
+	virtual Result writev(const IOWriteBuffer* buffers,
+						  Uptr numBuffers,
+						  Uptr* outNumBytesWritten,
+						  const U64* writeOffset) override
+	{
+		if(outNumBytesWritten) { *outNumBytesWritten = 0; }
+
+		U64 numBytes = 0;
+		if(!getTotalBufferBytes(buffers, numBuffers, numBytes))
+		{ return Result::tooManyBufferBytes; }
+
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type == FileType::directory) { return Result::isDirectory; }
+		if(accessMode != FileAccessMode::writeOnly && accessMode != FileAccessMode::readWrite)
+		{ return Result::notAccessible; }
+
+		U64 startOffset = writeOffset ? *writeOffset : offset;
+		if(!writeOffset && flags.append) { startOffset = node->bytes.size(); }
+		if(startOffset > U64(INT64_MAX) - numBytes) { return Result::exceededFileSizeLimit; }
+
+		// Extend the file if the write ends past its end.
+		const U64 endOffset = startOffset + numBytes;
+		if(endOffset > node->bytes.size())
+		{
+			const Result result = fs->resizeFile(*node, endOffset);
+			if(result != Result::success) { return result; }
+		}
+
+		U8* destBytes = node->bytes.data() + startOffset;
+		for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
+		{
+			memcpy(destBytes, buffers[bufferIndex].data, buffers[bufferIndex].numBytes);
+			destBytes += buffers[bufferIndex].numBytes;
+		}
+		if(!writeOffset) { offset = endOffset; }
+		node->lastWriteTime = Platform::getClockTime(Platform::Clock::realtime);
+
+		if(outNumBytesWritten) { *outNumBytesWritten = Uptr(numBytes); }
+		return Result::success;
+	}
+
+	virtual Result sync(SyncType type) override { return Result::success; }
+
+	virtual Result getVFDInfo(VFDInfo& outInfo) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		outInfo.type = node->type;
+		outInfo.flags = flags;
+		return Result::success;
+	}
+
+	virtual Result getFileInfo(FileInfo& outInfo) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		fs->getFileInfo(*node, outInfo);
+		return Result::success;
+	}
+
+	virtual Result setVFDFlags(const VFDFlags& newFlags) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		flags = newFlags;
+		return Result::success;
+	}
+
+	virtual Result setFileSize(U64 numBytes) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type == FileType::directory) { return Result::isDirectory; }
+		if(accessMode != FileAccessMode::writeOnly && accessMode != FileAccessMode::readWrite)
+		{ return Result::notAccessible; }
+		return fs->resizeFile(*node, numBytes);
+	}
+
+	virtual Result advise(U64 adviceOffset, U64 numBytes, FileAdvice advice) override
+	{
+		return Result::success;
+	}
+
+	virtual Result allocate(U64 allocateOffset, U64 numBytes) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type == FileType::directory) { return Result::isDirectory; }
+		if(accessMode != FileAccessMode::writeOnly && accessMode != FileAccessMode::readWrite)
+		{ return Result::notAccessible; }
+		if(allocateOffset > U64(INT64_MAX) - numBytes) { return Result::exceededFileSizeLimit; }
+
+		const U64 endOffset = allocateOffset + numBytes;
+		if(endOffset <= node->bytes.size()) { return Result::success; }
+		return fs->resizeFile(*node, endOffset);
+	}
+
+	virtual Result setFileTimes(bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		setNodeTimes(*node, setLastAccessTime, lastAccessTime, setLastWriteTime, lastWriteTime);
+		return Result::success;
+	}
+
+	virtual Result openDir(DirEntStream*& outStream) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		if(node->type != FileType::directory) { return Result::isNotDirectory; }
+		outStream = openNodeDir(*node);
+		return Result::success;
+	}
+
+private:
+	// The VFD's reference to the file system state is released after its reference to the node.
+	const std::shared_ptr<MemoryFSState> fs;
+	const std::shared_ptr<MemoryNode> node;
+	const FileAccessMode accessMode;
+
+	// The VFD's flags and offset are guarded by the file system's mutex.
+	VFDFlags flags;
+	U64 offset = 0;
+};
+
+struct MemoryFS : FileSystem
+{
+	MemoryFS(U64 maxFileBytes) : fs(std::make_shared<MemoryFSState>(maxFileBytes)) {}
+
+	virtual Result open(const std::string& path,
+						FileAccessMode accessMode,
+						FileCreateMode createMode,
+						VFD*& outFD,
+						const VFDFlags& flags) override
+	{
+		const bool isWritable
+			= accessMode == FileAccessMode::writeOnly || accessMode == FileAccessMode::readWrite;
+		const bool shouldTruncate = createMode == FileCreateMode::createAlways
+									|| createMode == FileCreateMode::truncateExisting;
+		const bool shouldCreate = createMode == FileCreateMode::createAlways
+								  || createMode == FileCreateMode::createNew
+								  || createMode == FileCreateMode::openAlways;
+
+		Platform::Mutex::Lock lock(fs->mutex);
+
+		std::shared_ptr<MemoryNode> node;
+		Result result = fs->lookup(path, node);
+		if(result == Result::doesNotExist && shouldCreate)
+		{
+			std::shared_ptr<MemoryNode> parentDir;
+			std::string name;
+			result = fs->lookupParent(path, parentDir, name);
+			if(result != Result::success) { return result; }
+
+			node = fs->createNode(FileType::file);
+			parentDir->children.addOrFail(name, node);
+			parentDir->lastWriteTime = node->creationTime;
+		}
+		else if(result != Result::success)
+		{
+			return result;
+		}
+		else if(createMode == FileCreateMode::createNew)
+		{
+			return Result::alreadyExists;
+		}
+		else if(node->type == FileType::directory && (isWritable || shouldTruncate))
+		{
+			return Result::isDirectory;
+		}
+		else if(shouldTruncate)
+		{
+			if(!isWritable) { return Result::notAccessible; }
+			result = fs->resizeFile(*node, 0);
+			if(result != Result::success) { return result; }
+		}
+
+		outFD = new MemoryVFD(fs, std::move(node), accessMode, flags);
+		return Result::success;
+	}
+
+	virtual Result getFileInfo(const std::string& path, FileInfo& outInfo) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> node;
+		const Result result = fs->lookup(path, node);
+		if(result != Result::success) { return result; }
+
+		fs->getFileInfo(*node, outInfo);
+		return Result::success;
+	}
+
+	virtual Result setFileTimes(const std::string& path,
+								bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> node;
+		const Result result = fs->lookup(path, node);
+		if(result != Result::success) { return result; }
+
+		setNodeTimes(*node, setLastAccessTime, lastAccessTime, setLastWriteTime, lastWriteTime);
+		return Result::success;
+	}
+
+	virtual Result openDir(const std::string& path, DirEntStream*& outStream) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> node;
+		const Result result = fs->lookup(path, node);
+		if(result != Result::success) { return result; }
+		if(node->type != FileType::directory) { return Result::isNotDirectory; }
+
+		outStream = openNodeDir(*node);
+		return Result::success;
+	}
+
+	virtual Result renameFile(const std::string& oldPath, const std::string& newPath) override
+	{
+		std::vector<std::string> oldComponents;
+		std::vector<std::string> newComponents;
+		if(!splitPath(oldPath, oldComponents) || !splitPath(newPath, newComponents))
+		{ return Result::notAccessible; }
+
+		// Don't allow moving a directory beneath itself.
+		if(newComponents.size() > oldComponents.size()
+		   && std::equal(oldComponents.begin(), oldComponents.end(), newComponents.begin()))
+		{ return Result::notPermitted; }
+
+		Platform::Mutex::Lock lock(fs->mutex);
+
+		std::shared_ptr<MemoryNode> oldParentDir;
+		std::shared_ptr<MemoryNode> newParentDir;
+		std::string oldName;
+		std::string newName;
+		Result result = fs->lookupParent(oldPath, oldParentDir, oldName);
+		if(result != Result::success) { return result; }
+		result = fs->lookupParent(newPath, newParentDir, newName);
+		if(result != Result::success) { return result; }
+
+		const std::shared_ptr<MemoryNode>* node = oldParentDir->children.get(oldName);
+		if(!node) { return Result::doesNotExist; }
+
+		// If the new path exists, it must be the same type as the old path, and if it's a
+		// directory, it must be empty.
+		const std::shared_ptr<MemoryNode>* replacedNode = newParentDir->children.get(newName);
+		if(replacedNode)
+		{
+			if(*replacedNode == *node) { return Result::success; }
+			else if((*node)->type == FileType::directory)
+			{
+				if((*replacedNode)->type != FileType::directory) { return Result::isNotDirectory; }
+				else if((*replacedNode)->children.size())
+				{
+					return Result::isNotEmpty;
+				}
+			}
+			else if((*replacedNode)->type == FileType::directory)
+			{
+				return Result::isDirectory;
+			}
+		}
+
+		std::shared_ptr<MemoryNode> movedNode = *node;
+		oldParentDir->children.removeOrFail(oldName);
+		newParentDir->children.set(newName, std::move(movedNode));
+
+		const Time now = Platform::getClockTime(Platform::Clock::realtime);
+		oldParentDir->lastWriteTime = newParentDir->lastWriteTime = now;
+		return Result::success;
+	}
+
+	virtual Result unlinkFile(const std::string& path) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> parentDir;
+		std::string name;
+		const Result result = fs->lookupParent(path, parentDir, name);
+		if(result != Result::success)
+		{ return result == Result::busy ? Result::isDirectory : result; }
+
+		const std::shared_ptr<MemoryNode>* node = parentDir->children.get(name);
+		if(!node) { return Result::doesNotExist; }
+		if((*node)->type == FileType::directory) { return Result::isDirectory; }
+
+		parentDir->children.removeOrFail(name);
+		parentDir->lastWriteTime = Platform::getClockTime(Platform::Clock::realtime);
+		return Result::success;
+	}
+
+	virtual Result removeDir(const std::string& path) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> parentDir;
+		std::string name;
+		const Result result = fs->lookupParent(path, parentDir, name);
+		if(result != Result::success) { return result; }
+
+		const std::shared_ptr<MemoryNode>* node = parentDir->children.get(name);
+		if(!node) { return Result::doesNotExist; }
+		if((*node)->type != FileType::directory) { return Result::isNotDirectory; }
+		if((*node)->children.size()) { return Result::isNotEmpty; }
+
+		parentDir->children.removeOrFail(name);
+		parentDir->lastWriteTime = Platform::getClockTime(Platform::Clock::realtime);
+		return Result::success;
+	}
+
+	virtual Result createDir(const std::string& path) override
+	{
+		Platform::Mutex::Lock lock(fs->mutex);
+		std::shared_ptr<MemoryNode> parentDir;
+		std::string name;
+		const Result result = fs->lookupParent(path, parentDir, name);
+		if(result != Result::success)
+		{ return result == Result::busy ? Result::alreadyExists : result; }
+		if(parentDir->children.contains(name)) { return Result::alreadyExists; }
+
+		std::shared_ptr<MemoryNode> dir = fs->createNode(FileType::directory);
+		parentDir->lastWriteTime = dir->creationTime;
+		parentDir->children.addOrFail(name, std::move(dir));
+		return Result::success;
+	}
+
+private:
+	const std::shared_ptr<MemoryFSState> fs;
+};
+
+std::shared_ptr<FileSystem> VFS::makeMemoryFS(U64 maxFileBytes)
+{
+	return std::make_shared<MemoryFS>(maxFileBytes);
+}
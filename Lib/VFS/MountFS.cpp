@@ -0,0 +1,194 @@
+#include "WAVM/VFS/MountFS.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "VFSPrivate.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Time.h"
+#include "WAVM/VFS/VFS.h"
+
+using namespace WAVM;
+using namespace WAVM::VFS;
+
+struct MountFS : FileSystem
+{
+	MountFS(std::shared_ptr<FileSystem>&& inRootFS, std::vector<MountPoint>&& inMountPoints)
+	: rootFS(std::move(inRootFS))
+	{
+		for(MountPoint& mountPoint : inMountPoints)
+		{
+			Mount mount;
+			WAVM_ERROR_UNLESS(splitPath(mountPoint.path, mount.pathComponents));
+			mount.fileSystem = std::move(mountPoint.fileSystem);
+			mounts.push_back(std::move(mount));
+		}
+
+		// Match the deepest mount point first, so mount points may be nested.
+		std::stable_sort(mounts.begin(), mounts.end(), [](const Mount& a, const Mount& b) {
+			return a.pathComponents.size() > b.pathComponents.size();
+		});
+	}
+
+	virtual Result open(const std::string& path,
+						FileAccessMode accessMode,
+						FileCreateMode createMode,
+						VFD*& outFD,
+						const VFDFlags& flags) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+
+		return fileSystem->open(innerPath, accessMode, createMode, outFD, flags);
+	}
+
+	virtual Result getFileInfo(const std::string& path, FileInfo& outInfo) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+
+		return fileSystem->getFileInfo(innerPath, outInfo);
+	}
+
+	virtual Result setFileTimes(const std::string& path,
+								bool setLastAccessTime,
+								Time lastAccessTime,
+								bool setLastWriteTime,
+								Time lastWriteTime) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+
+		return fileSystem->setFileTimes(
+			innerPath, setLastAccessTime, lastAccessTime, setLastWriteTime, lastWriteTime);
+	}
+
+	virtual Result openDir(const std::string& path, DirEntStream*& outStream) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+
+		return fileSystem->openDir(innerPath, outStream);
+	}
+
+	virtual Result renameFile(const std::string& oldPath, const std::string& newPath) override
+	{
+		FileSystem* oldFileSystem = nullptr;
+		FileSystem* newFileSystem = nullptr;
+		std::string oldInnerPath;
+		std::string newInnerPath;
+		Result result = resolve(oldPath, oldFileSystem, oldInnerPath);
+		if(result != Result::success) { return result; }
+		result = resolve(newPath, newFileSystem, newInnerPath);
+		if(result != Result::success) { return result; }
+
+		// Mount points can't be renamed, and files can't be renamed between file systems.
+		if(isMountPoint(oldPath) || isMountPoint(newPath)) { return Result::busy; }
+		if(oldFileSystem != newFileSystem) { return Result::notSupported; }
+
+		return oldFileSystem->renameFile(oldInnerPath, newInnerPath);
+	}
+
+	virtual Result unlinkFile(const std::string& path) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+		if(isMountPoint(path)) { return Result::isDirectory; }
+
+		return fileSystem->unlinkFile(innerPath);
+	}
+
+	virtual Result removeDir(const std::string& path) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+		if(isMountPoint(path)) { return Result::busy; }
+
+		return fileSystem->removeDir(innerPath);
+	}
+
+	virtual Result createDir(const std::string& path) override
+	{
+		FileSystem* fileSystem = nullptr;
+		std::string innerPath;
+		const Result result = resolve(path, fileSystem, innerPath);
+		if(result != Result::success) { return result; }
+		if(isMountPoint(path)) { return Result::alreadyExists; }
+
+		return fileSystem->createDir(innerPath);
+	}
+
+private:
+	struct Mount
+	{
+		std::vector<std::string> pathComponents;
+		std::shared_ptr<FileSystem> fileSystem;
+	};
+
+	const std::shared_ptr<FileSystem> rootFS;
+	std::vector<Mount> mounts;
+
+	// Finds the file system that a path is in, and the path relative to its root.
+	Result resolve(const std::string& path, FileSystem*& outFileSystem, std::string& outInnerPath)
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components)) { return Result::notAccessible; }
+
+		Uptr numMountComponents = 0;
+		outFileSystem = rootFS.get();
+		for(const Mount& mount : mounts)
+		{
+			if(mount.pathComponents.size() <= components.size()
+			   && std::equal(mount.pathComponents.begin(),
+							 mount.pathComponents.end(),
+							 components.begin()))
+			{
+				numMountComponents = mount.pathComponents.size();
+				outFileSystem = mount.fileSystem.get();
+				break;
+			}
+		}
+		if(!outFileSystem) { return Result::doesNotExist; }
+
+		outInnerPath.clear();
+		for(Uptr componentIndex = numMountComponents; componentIndex < components.size();
+			++componentIndex)
+		{
+			outInnerPath += '/';
+			outInnerPath += components[componentIndex];
+		}
+		if(!outInnerPath.size()) { outInnerPath = "/"; }
+		return Result::success;
+	}
+
+	bool isMountPoint(const std::string& path)
+	{
+		std::vector<std::string> components;
+		if(!splitPath(path, components)) { return false; }
+		for(const Mount& mount : mounts)
+		{
+			if(mount.pathComponents == components) { return true; }
+		}
+		return false;
+	}
+};
+
+std::shared_ptr<FileSystem> VFS::makeMountFS(std::shared_ptr<FileSystem> rootFS,
+											 std::vector<MountPoint>&& mountPoints)
+{
+	return std::make_shared<MountFS>(std::move(rootFS), std::move(mountPoints));
+}
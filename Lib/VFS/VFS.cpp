@@ -1,4 +1,10 @@
 #include "WAVM/VFS/VFS.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "VFSPrivate.h"
 #include "WAVM/Inline/Errors.h"
 
 using namespace WAVM;
@@ -17,3 +23,86 @@ WAVM_ENUM_VFS_RESULTS(V)
 	default: WAVM_UNREACHABLE();
 	};
 }
+
+bool VFS::splitPath(const std::string& path, std::vector<std::string>& outComponents)
+{
+	outComponents.clear();
+	Uptr componentStart = 0;
+	while(componentStart < path.size())
+	{
+		Uptr componentEnd = path.find_first_of("/\\", componentStart);
+		if(componentEnd == std::string::npos) { componentEnd = path.size(); }
+
+		const Uptr numComponentChars = componentEnd - componentStart;
+		if(numComponentChars == 2 && !path.compare(componentStart, 2, ".."))
+		{
+			if(!outComponents.size()) { return false; }
+			outComponents.pop_back();
+		}
+		else if(numComponentChars
+				&& !(numComponentChars == 1 && path[componentStart] == '.'))
+		{
+			outComponents.push_back(path.substr(componentStart, numComponentChars));
+		}
+
+		componentStart = componentEnd + 1;
+	}
+	return true;
+}
+
+U64 VFS::allocateVirtualDeviceNumber()
+{
+	// Start the virtual device numbers well above the device numbers of host devices.
+	static std::atomic<U64> nextDeviceNumber{U64(1) << 62};
+	return nextDeviceNumber++;
+}
+
+Uptr VFS::readFromBytes(const U8* fileBytes,
+						U64 numFileBytes,
+						U64 offset,
+						const IOReadBuffer* buffers,
+						Uptr numBuffers)
+{
+	Uptr numBytesRead = 0;
+	for(Uptr bufferIndex = 0; bufferIndex < numBuffers && offset < numFileBytes; ++bufferIndex)
+	{
+		const U64 numBufferBytes = buffers[bufferIndex].numBytes;
+		const Uptr numCopiedBytes = Uptr(std::min(numBufferBytes, numFileBytes - offset));
+		memcpy(buffers[bufferIndex].data, fileBytes + offset, numCopiedBytes);
+		offset += numCopiedBytes;
+		numBytesRead += numCopiedBytes;
+	}
+	return numBytesRead;
+}
+
+bool VFS::getTotalBufferBytes(const IOWriteBuffer* buffers, Uptr numBuffers, U64& outNumBytes)
+{
+	outNumBytes = 0;
+	for(Uptr bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex)
+	{
+		if(buffers[bufferIndex].numBytes > UINTPTR_MAX - outNumBytes) { return false; }
+		outNumBytes += buffers[bufferIndex].numBytes;
+	}
+	return true;
+}
+
+Result VFS::getSeekOffset(I64 offset,
+						  SeekOrigin origin,
+						  U64 currentOffset,
+						  U64 numFileBytes,
+						  U64& outNewOffset)
+{
+	U64 baseOffset = 0;
+	switch(origin)
+	{
+	case SeekOrigin::begin: baseOffset = 0; break;
+	case SeekOrigin::cur: baseOffset = currentOffset; break;
+	case SeekOrigin::end: baseOffset = numFileBytes; break;
+	default: WAVM_UNREACHABLE();
+	};
+
+	if(offset < 0 ? U64(-(offset + 1)) >= baseOffset : U64(offset) > U64(INT64_MAX) - baseOffset)
+	{ return Result::invalidOffset; }
+	outNewOffset = baseOffset + U64(offset);
+	return Result::success;
+}
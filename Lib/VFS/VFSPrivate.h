@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/VFS/VFS.h"
+
+namespace WAVM { namespace VFS {
+
+	// Splits a path in a file system into its components, skipping empty and "." components.
+	// Returns false if a ".." component would resolve to the parent of the root directory.
+	bool splitPath(const std::string& path, std::vector<std::string>& outComponents);
+
+	// Returns a unique device number for a file system that isn't backed by a host device.
+	U64 allocateVirtualDeviceNumber();
+
+	// Copies the bytes starting at offset in a file with numFileBytes to the buffers, and returns
+	// the number of bytes copied.
+	Uptr readFromBytes(const U8* fileBytes,
+					   U64 numFileBytes,
+					   U64 offset,
+					   const IOReadBuffer* buffers,
+					   Uptr numBuffers);
+
+	// Returns the total number of bytes in the buffers, or false if it overflows.
+	bool getTotalBufferBytes(const IOWriteBuffer* buffers, Uptr numBuffers, U64& outNumBytes);
+
+	// Computes the new offset of a seek from a VFD's current offset, for a file with numFileBytes.
+	Result getSeekOffset(I64 offset,
+						 SeekOrigin origin,
+						 U64 currentOffset,
+						 U64 numFileBytes,
+						 U64& outNewOffset);
+
+	// A directory stream over a copy of a directory's entries. Its offsets are entry indices.
+	struct SnapshotDirEntStream : DirEntStream
+	{
+		SnapshotDirEntStream(std::vector<DirEnt>&& inEntries) : entries(std::move(inEntries)) {}
+
+		virtual void close() override { delete this; }
+
+		virtual bool getNext(DirEnt& outEntry) override
+		{
+			if(nextEntryIndex >= entries.size()) { return false; }
+			outEntry = entries[nextEntryIndex++];
+			return true;
+		}
+
+		virtual void restart() override { nextEntryIndex = 0; }
+		virtual U64 tell() override { return U64(nextEntryIndex); }
+		virtual bool seek(U64 offset) override
+		{
+			if(offset > entries.size()) { return false; }
+			nextEntryIndex = Uptr(offset);
+			return true;
+		}
+
+	private:
+		std::vector<DirEnt> entries;
+		Uptr nextEntryIndex = 0;
+	};
+
+	// A base for the VFDs of files that aren't sockets, and don't have a host handle.
+	struct VirtualFileVFD : VFD
+	{
+		virtual Result getHostHandle(Uptr& outHandle) override { return Result::notSupported; }
+
+		virtual Result recvv(const IOReadBuffer* buffers,
+							 Uptr numBuffers,
+							 const SocketRecvFlags& flags,
+							 Uptr* outNumBytesReceived = nullptr,
+							 bool* outIsTruncated = nullptr) override
+		{
+			return Result::notSocket;
+		}
+		virtual Result sendv(const IOWriteBuffer* buffers,
+							 Uptr numBuffers,
+							 Uptr* outNumBytesSent = nullptr) override
+		{
+			return Result::notSocket;
+		}
+		virtual Result shutdown(SocketShutdownType type) override { return Result::notSocket; }
+	};
+}}
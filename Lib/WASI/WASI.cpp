@@ -1,7 +1,10 @@
+#include <string.h>
+#include <vector>
 #include "WAVM/WASI/WASI.h"
 #include "./WASIPrivate.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/I128.h"
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/Platform/Clock.h"
@@ -9,6 +12,7 @@
 #include "WAVM/Platform/Diagnostics.h"
 #include "WAVM/Platform/File.h"
 #include "WAVM/Platform/Intrinsic.h"
+#include "WAVM/Platform/Poll.h"
 #include "WAVM/Platform/Random.h"
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -64,13 +68,130 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 							   WASIAddress numSubscriptions,
 							   WASIAddress outNumEventsAddress)
 {
-	UNIMPLEMENTED_SYSCALL("poll_oneoff",
-						  "(" WASIADDRESS_FORMAT ", " WASIADDRESS_FORMAT ", %u, " WASIADDRESS_FORMAT
-						  ")",
-						  inAddress,
-						  outAddress,
-						  numSubscriptions,
-						  outNumEventsAddress);
+	TRACE_SYSCALL("poll_oneoff",
+				  "(" WASIADDRESS_FORMAT ", " WASIADDRESS_FORMAT ", %u, " WASIADDRESS_FORMAT ")",
+				  inAddress,
+				  outAddress,
+				  numSubscriptions,
+				  outNumEventsAddress);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	// Waiting for no subscriptions would block forever.
+	if(!numSubscriptions) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	// Copy the subscriptions out of the process's memory.
+	std::vector<__wasi_subscription_t> subscriptions;
+	__wasi_errno_t result = __WASI_ESUCCESS;
+	Runtime::catchRuntimeExceptions(
+		[&] {
+			const __wasi_subscription_t* subscriptionsInMemory
+				= memoryArrayPtr<__wasi_subscription_t>(
+					process->memory, inAddress, numSubscriptions);
+			subscriptions.assign(subscriptionsInMemory, subscriptionsInMemory + numSubscriptions);
+		},
+		[&](Runtime::Exception* exception) {
+			WAVM_ASSERT(getExceptionType(exception) == ExceptionTypes::outOfBoundsMemoryAccess);
+			result = __WASI_EFAULT;
+		});
+	if(result != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(result); }
+
+	std::vector<__wasi_event_t> events;
+	auto addEvent = [&events](const __wasi_subscription_t& subscription,
+							  __wasi_errno_t error,
+							  __wasi_filesize_t numBytes = 0,
+							  __wasi_eventrwflags_t flags = 0) {
+		__wasi_event_t event;
+		memset(&event, 0, sizeof(event));
+		event.userdata = subscription.userdata;
+		event.error = error;
+		event.type = subscription.type;
+		event.u.fd_readwrite.nbytes = numBytes;
+		event.u.fd_readwrite.flags = flags;
+		events.push_back(event);
+	};
+
+	// Add the subscriptions to a poller. Subscriptions that can't be waited on are reported as
+	// events with an error, and the other subscriptions are only reported if they are already
+	// ready.
+	Platform::Poller* poller = Platform::createPoller();
+	for(Uptr subscriptionIndex = 0; subscriptionIndex < numSubscriptions; ++subscriptionIndex)
+	{
+		const __wasi_subscription_t& subscription = subscriptions[subscriptionIndex];
+		switch(subscription.type)
+		{
+		case __WASI_EVENTTYPE_CLOCK: {
+			Platform::Clock platformClock;
+			if(!getPlatformClock(subscription.u.clock.clock_id, platformClock))
+			{
+				addEvent(subscription, __WASI_EINVAL);
+				break;
+			}
+
+			Time deadline{I128(U64(subscription.u.clock.timeout))};
+			if(!(subscription.u.clock.flags & __WASI_SUBSCRIPTION_CLOCK_ABSTIME))
+			{ deadline.ns = deadline.ns + Platform::getClockTime(platformClock).ns; }
+
+			if(!Platform::addPollerTimer(poller, platformClock, deadline, subscriptionIndex))
+			{ addEvent(subscription, __WASI_ENOTSUP); }
+			break;
+		}
+		case __WASI_EVENTTYPE_FD_READ:
+		case __WASI_EVENTTYPE_FD_WRITE: {
+			const LockedFDE lockedFDE = getLockedFDE(
+				process, subscription.u.fd_readwrite.fd, __WASI_RIGHT_POLL_FD_READWRITE, 0);
+			if(lockedFDE.error != __WASI_ESUCCESS)
+			{
+				addEvent(subscription, lockedFDE.error);
+				break;
+			}
+
+			Platform::addPollerVFD(poller,
+								   lockedFDE.fde->vfd,
+								   subscription.type == __WASI_EVENTTYPE_FD_READ
+									   ? Platform::PollEventType::read
+									   : Platform::PollEventType::write,
+								   subscriptionIndex);
+			break;
+		}
+		default: addEvent(subscription, __WASI_EINVAL); break;
+		};
+	}
+
+	// If none of the subscriptions failed, block until at least one of them is ready.
+	if(!events.size())
+	{
+		std::vector<Platform::PollEvent> pollEvents(numSubscriptions);
+		const Uptr numPollEvents
+			= Platform::waitPoller(poller, pollEvents.data(), pollEvents.size());
+		for(Uptr eventIndex = 0; eventIndex < numPollEvents; ++eventIndex)
+		{
+			const Platform::PollEvent& pollEvent = pollEvents[eventIndex];
+			addEvent(subscriptions[pollEvent.userData],
+					 asWASIErrNo(pollEvent.result),
+					 pollEvent.numBytesAvailable,
+					 pollEvent.hangup ? __WASI_EVENT_FD_READWRITE_HANGUP : 0);
+		}
+	}
+	Platform::destroyPoller(poller);
+
+	// Copy the events to the process's memory.
+	Runtime::catchRuntimeExceptions(
+		[&] {
+			__wasi_event_t* eventsInMemory
+				= memoryArrayPtr<__wasi_event_t>(process->memory, outAddress, events.size());
+			for(Uptr eventIndex = 0; eventIndex < events.size(); ++eventIndex)
+			{ eventsInMemory[eventIndex] = events[eventIndex]; }
+			memoryRef<WASIAddress>(process->memory, outNumEventsAddress)
+				= WASIAddress(events.size());
+		},
+		[&](Runtime::Exception* exception) {
+			WAVM_ASSERT(getExceptionType(exception) == ExceptionTypes::outOfBoundsMemoryAccess);
+			result = __WASI_EFAULT;
+		});
+	if(result != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(result); }
+
+	return TRACE_SYSCALL_RETURN(__WASI_ESUCCESS, "(%" WAVM_PRIuPTR ")", Uptr(events.size()));
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi, "proc_exit", void, wasi_proc_exit, __wasi_exitcode_t exitCode)
@@ -114,57 +235,6 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 	return TRACE_SYSCALL_RETURN(result);
 }
 
-WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
-							   "sock_recv",
-							   __wasi_errno_return_t,
-							   wasi_sock_recv,
-							   __wasi_fd_t sock,
-							   WASIAddress ri_data,
-							   WASIAddress ri_data_len,
-							   __wasi_riflags_t ri_flags,
-							   WASIAddress ro_datalen,
-							   WASIAddress ro_flags)
-{
-	UNIMPLEMENTED_SYSCALL("sock_recv",
-						  "(%u, " WASIADDRESS_FORMAT ", %u, 0x%04x, " WASIADDRESS_FORMAT
-						  ", " WASIADDRESS_FORMAT ")",
-						  sock,
-						  ri_data,
-						  ri_data_len,
-						  ri_flags,
-						  ro_datalen,
-						  ro_flags);
-}
-
-WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
-							   "sock_send",
-							   __wasi_errno_return_t,
-							   wasi_sock_send,
-							   __wasi_fd_t sock,
-							   WASIAddress si_data,
-							   WASIAddress si_data_len,
-							   __wasi_siflags_t si_flags,
-							   WASIAddress so_datalen)
-{
-	UNIMPLEMENTED_SYSCALL("sock_send",
-						  "(%u, " WASIADDRESS_FORMAT ", %u, 0x%04x, " WASIADDRESS_FORMAT ")",
-						  sock,
-						  si_data,
-						  si_data_len,
-						  si_flags,
-						  so_datalen);
-}
-
-WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
-							   "sock_shutdown",
-							   __wasi_errno_return_t,
-							   wasi_sock_shutdown,
-							   __wasi_fd_t sock,
-							   __wasi_sdflags_t how)
-{
-	UNIMPLEMENTED_SYSCALL("sock_shutdown", "(%u, 0x%02x)", sock, how);
-}
-
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasi, "sched_yield", __wasi_errno_return_t, wasi_sched_yield)
 {
 	TRACE_SYSCALL("sched_yield", "()");
@@ -213,6 +283,12 @@ std::shared_ptr<Process> WASI::createProcess(Runtime::Compartment* compartment,
 	process->resolver.moduleNameToInstanceMap.set("wasi_unstable", wasi_snapshot_preview1);
 	process->resolver.moduleNameToInstanceMap.set("wasi_snapshot_preview1", wasi_snapshot_preview1);
 
+	// WAVM's extensions to WASI are imported from a separate module, so they can't collide with
+	// future WASI functions.
+	Instance* wavm_wasi = Intrinsics::instantiateModule(
+		compartment, {WAVM_INTRINSIC_MODULE_REF(wasiMemoryMap)}, "wavm_wasi");
+	process->resolver.moduleNameToInstanceMap.set("wavm_wasi", wavm_wasi);
+
 	__wasi_rights_t stdioRights = __WASI_RIGHT_FD_READ | __WASI_RIGHT_FD_FDSTAT_SET_FLAGS
 								  | __WASI_RIGHT_FD_WRITE | __WASI_RIGHT_FD_FILESTAT_GET
 								  | __WASI_RIGHT_POLL_FD_READWRITE;
@@ -255,6 +331,34 @@ std::shared_ptr<Process> WASI::createProcess(Runtime::Compartment* compartment,
 
 Resolver& WASI::getProcessResolver(Process& process) { return process.resolver; }
 
+U32 WASI::addProcessSocket(Process& process, VFS::VFD* socket)
+{
+	const __wasi_rights_t socketRights = __WASI_RIGHT_FD_READ | __WASI_RIGHT_FD_WRITE
+										 | __WASI_RIGHT_FD_FDSTAT_SET_FLAGS
+										 | __WASI_RIGHT_FD_FILESTAT_GET
+										 | __WASI_RIGHT_POLL_FD_READWRITE
+										 | __WASI_RIGHT_SOCK_SHUTDOWN;
+
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fdsLock(process.fdMapMutex);
+	const __wasi_fd_t fd = process.fdMap.add(
+		UINT32_MAX, std::make_shared<FDE>(socket, socketRights, 0, "<socket>"));
+	WAVM_ERROR_UNLESS(fd != UINT32_MAX);
+	return fd;
+}
+
+void WASI::setProcessUsesCoarseClocks(Process& process, bool useCoarseClocks)
+{
+	process.useCoarseClocks = useCoarseClocks;
+}
+
+void WASI::setProcessArgs(Process& process,
+						  std::vector<std::string>&& args,
+						  std::vector<std::string>&& envs)
+{
+	process.args = std::move(args);
+	process.envs = std::move(envs);
+}
+
 Process* WASI::getProcessFromContextRuntimeData(Runtime::ContextRuntimeData* contextRuntimeData)
 {
 	return (Process*)Runtime::getUserData(
@@ -15,7 +15,7 @@ namespace WAVM { namespace WASI {
 	WAVM_DEFINE_INTRINSIC_MODULE(wasiClocks)
 }}
 
-static bool getPlatformClock(__wasi_clockid_t clock, Platform::Clock& outPlatformClock)
+bool WASI::getPlatformClock(__wasi_clockid_t clock, Platform::Clock& outPlatformClock)
 {
 	switch(clock)
 	{
@@ -41,10 +41,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiClocks,
 	Platform::Clock platformClock;
 	if(!getPlatformClock(clockId, platformClock)) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
 
-	const Time clockResolution = Platform::getClockResolution(platformClock);
-
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 
+	const Time clockResolution = process->useCoarseClocks
+									 ? Platform::getCoarseClockResolution(platformClock)
+									 : Platform::getClockResolution(platformClock);
+
 	__wasi_timestamp_t wasiClockResolution = __wasi_timestamp_t(clockResolution.ns);
 	memoryRef<__wasi_timestamp_t>(process->memory, resolutionAddress) = wasiClockResolution;
 
@@ -70,7 +72,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiClocks,
 	Platform::Clock platformClock;
 	if(!getPlatformClock(clockId, platformClock)) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
 
-	Time clockTime = Platform::getClockTime(platformClock);
+	Time clockTime = process->useCoarseClocks ? Platform::getCoarseClockTime(platformClock)
+											  : Platform::getClockTime(platformClock);
 
 	if(platformClock == Platform::Clock::processCPUTime)
 	{ clockTime.ns -= process->processClockOrigin.ns; }
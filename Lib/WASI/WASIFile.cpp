@@ -17,7 +17,7 @@ namespace WAVM { namespace WASI {
 	WAVM_DEFINE_INTRINSIC_MODULE(wasiFile)
 }}
 
-static __wasi_errno_t asWASIErrNo(VFS::Result result)
+__wasi_errno_t WASI::asWASIErrNo(VFS::Result result)
 {
 	switch(result)
 	{
@@ -53,6 +53,9 @@ static __wasi_errno_t asWASIErrNo(VFS::Result result)
 	case Result::isNotDirectory: return __WASI_ENOTDIR;
 	case Result::isNotEmpty: return __WASI_ENOTEMPTY;
 	case Result::brokenPipe: return __WASI_EPIPE;
+	case Result::notSocket: return __WASI_ENOTSOCK;
+	case Result::notConnected: return __WASI_ENOTCONN;
+	case Result::connectionReset: return __WASI_ECONNRESET;
 	case Result::missingDevice: return __WASI_ENXIO;
 	case Result::busy: return __WASI_EBUSY;
 	case Result::notSupported: return __WASI_ENOTSUP;
@@ -61,31 +64,14 @@ static __wasi_errno_t asWASIErrNo(VFS::Result result)
 	};
 }
 
-struct LockedFDE
-{
-	__wasi_errno_t error;
-
-	// Only set if result==_WASI_ESUCCESS:
-	Platform::RWMutex::Lock fdeLock;
-	std::shared_ptr<FDE> fde;
-
-	LockedFDE(__wasi_errno_t inError) : error(inError) {}
-	LockedFDE(const std::shared_ptr<FDE>& inFDE,
-			  Platform::RWMutex::LockShareability lockShareability)
-	: error(__WASI_ESUCCESS), fdeLock(inFDE->mutex, lockShareability), fde(inFDE)
-	{
-	}
-};
-
-static LockedFDE getLockedFDE(Process* process,
-							  __wasi_fd_t fd,
-							  __wasi_rights_t requiredRights,
-							  __wasi_rights_t requiredInheritingRights,
-							  Platform::RWMutex::LockShareability lockShareability
-							  = Platform::RWMutex::shareable)
+LockedFDE WASI::getLockedFDE(Process* process,
+							 __wasi_fd_t fd,
+							 __wasi_rights_t requiredRights,
+							 __wasi_rights_t requiredInheritingRights,
+							 Platform::RWMutex::LockShareability lockShareability)
 {
 	// Shareably lock the fdMap mutex.
-	Platform::RWMutex::ShareableLock fdsLock(process->fdMapMutex);
+	Platform::ReaderBiasedRWMutex::ShareableLock fdsLock(process->fdMapMutex);
 
 	// Check that the fdMap contains a FDE for the given FD.
 	if(fd < process->fdMap.getMinIndex() || fd > process->fdMap.getMaxIndex())
@@ -101,7 +87,7 @@ static LockedFDE getLockedFDE(Process* process,
 	TRACE_SYSCALL_FLOW("Locked FDE: %s", (*fde)->originalPath.c_str());
 
 	// Lock the FDE and return a reference to it.
-	return LockedFDE(*fde, lockShareability);
+	return LockedFDE(fde->get(), lockShareability);
 }
 
 static __wasi_filetype_t asWASIFileType(FileType type)
@@ -336,7 +322,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 
 	// Exclusively lock the fds mutex, and look up the FDE corresponding to the FD.
-	Platform::RWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
 	if(fd < process->fdMap.getMinIndex() || fd > process->fdMap.getMaxIndex())
 	{ return TRACE_SYSCALL_RETURN(__WASI_EBADF); }
 	std::shared_ptr<FDE>* fdePointer = process->fdMap.get(fd);
@@ -344,7 +330,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	std::shared_ptr<FDE> fde = *fdePointer;
 
 	// Exclusively lock the FDE.
-	Platform::RWMutex::ExclusiveLock fdeLock(fde->mutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fdeLock(fde->mutex);
 
 	// Remove this FDE from the FD table, and unlock the fds mutex.
 	process->fdMap.removeOrFail(fd);
@@ -376,30 +362,37 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	return TRACE_SYSCALL_RETURN(asWASIErrNo(lockedFDE.fde->vfd->sync(SyncType::contents)));
 }
 
-static __wasi_errno_t readImpl(Process* process,
-							   __wasi_fd_t fd,
-							   WASIAddress iovsAddress,
-							   I32 numIOVs,
-							   const __wasi_filesize_t* offset,
-							   Uptr& outNumBytesRead)
+// The number of IOVs that fd_read and fd_write translate to VFS buffers on the stack.
+static constexpr I32 maxStackIOVs = 16;
+
+// Translates the IOVs to IOReadBuffers, and calls readBuffers(vfd, buffers, numBuffers) to read
+// into them.
+template<typename ReadBuffers>
+static __wasi_errno_t readBuffersImpl(Process* process,
+									  __wasi_fd_t fd,
+									  __wasi_rights_t requiredRights,
+									  WASIAddress iovsAddress,
+									  I32 numIOVs,
+									  ReadBuffers&& readBuffers)
 {
-	const __wasi_rights_t requiredRights
-		= __WASI_RIGHT_FD_READ | (offset ? __WASI_RIGHT_FD_SEEK : 0);
 	LockedFDE lockedFDE = getLockedFDE(process, fd, requiredRights, 0);
 	if(lockedFDE.error != __WASI_ESUCCESS) { return lockedFDE.error; }
 
 	if(numIOVs < 0 || numIOVs > __WASI_IOV_MAX) { return __WASI_EINVAL; }
 
-	// Allocate memory for the IOReadBuffers.
-	IOReadBuffer* vfsReadBuffers = (IOReadBuffer*)malloc(numIOVs * sizeof(IOReadBuffer));
+	// Allocate memory for the IOReadBuffers. Most calls only pass a few IOVs, so they fit in a
+	// buffer on the stack.
+	IOReadBuffer stackReadBuffers[maxStackIOVs];
+	IOReadBuffer* vfsReadBuffers
+		= numIOVs <= maxStackIOVs ? stackReadBuffers
+								  : (IOReadBuffer*)malloc(numIOVs * sizeof(IOReadBuffer));
 
 	// Catch any out-of-bounds memory access exceptions that are thrown.
 	__wasi_errno_t result = __WASI_ESUCCESS;
 	Runtime::catchRuntimeExceptions(
 		[&] {
 			// Translate the IOVs to IOReadBuffers.
-			const __wasi_iovec_t* iovs
-				= memoryArrayPtr<__wasi_iovec_t>(process->memory, iovsAddress, numIOVs);
+			const MemorySpan<const __wasi_iovec_t> iovs(process->memory, iovsAddress, numIOVs);
 			U64 numBufferBytes = 0;
 			for(I32 iovIndex = 0; iovIndex < numIOVs; ++iovIndex)
 			{
@@ -409,7 +402,7 @@ static __wasi_errno_t readImpl(Process* process,
 								   iov.buf,
 								   iov.buf_len);
 				vfsReadBuffers[iovIndex].data
-					= memoryArrayPtr<U8>(process->memory, iov.buf, iov.buf_len);
+					= MemorySpan<U8>(process->memory, iov.buf, iov.buf_len).data();
 				vfsReadBuffers[iovIndex].numBytes = iov.buf_len;
 				numBufferBytes += iov.buf_len;
 			}
@@ -417,8 +410,7 @@ static __wasi_errno_t readImpl(Process* process,
 			else
 			{
 				// Do the read.
-				result = asWASIErrNo(
-					lockedFDE.fde->vfd->readv(vfsReadBuffers, numIOVs, &outNumBytesRead, offset));
+				result = asWASIErrNo(readBuffers(lockedFDE.fde->vfd, vfsReadBuffers, Uptr(numIOVs)));
 			}
 		},
 		[&](Exception* exception) {
@@ -433,35 +425,58 @@ static __wasi_errno_t readImpl(Process* process,
 		});
 
 	// Free the VFS read buffers.
-	free(vfsReadBuffers);
+	if(vfsReadBuffers != stackReadBuffers) { free(vfsReadBuffers); }
 
 	return result;
 }
 
-static __wasi_errno_t writeImpl(Process* process,
-								__wasi_fd_t fd,
-								WASIAddress iovsAddress,
-								I32 numIOVs,
-								const __wasi_filesize_t* offset,
-								Uptr& outNumBytesWritten)
+static __wasi_errno_t readImpl(Process* process,
+							   __wasi_fd_t fd,
+							   WASIAddress iovsAddress,
+							   I32 numIOVs,
+							   const __wasi_filesize_t* offset,
+							   Uptr& outNumBytesRead)
 {
 	const __wasi_rights_t requiredRights
-		= __WASI_RIGHT_FD_WRITE | (offset ? __WASI_RIGHT_FD_SEEK : 0);
+		= __WASI_RIGHT_FD_READ | (offset ? __WASI_RIGHT_FD_SEEK : 0);
+	return readBuffersImpl(
+		process,
+		fd,
+		requiredRights,
+		iovsAddress,
+		numIOVs,
+		[&](VFD* vfd, const IOReadBuffer* buffers, Uptr numBuffers) {
+			return vfd->readv(buffers, numBuffers, &outNumBytesRead, offset);
+		});
+}
+
+// Translates the IOVs to IOWriteBuffers, and calls writeBuffers(vfd, buffers, numBuffers) to write
+// from them.
+template<typename WriteBuffers>
+static __wasi_errno_t writeBuffersImpl(Process* process,
+									   __wasi_fd_t fd,
+									   __wasi_rights_t requiredRights,
+									   WASIAddress iovsAddress,
+									   I32 numIOVs,
+									   WriteBuffers&& writeBuffers)
+{
 	LockedFDE lockedFDE = getLockedFDE(process, fd, requiredRights, 0);
 	if(lockedFDE.error != __WASI_ESUCCESS) { return lockedFDE.error; }
 
 	if(numIOVs < 0 || numIOVs > __WASI_IOV_MAX) { return __WASI_EINVAL; }
 
-	// Allocate memory for the IOWriteBuffers.
-	IOWriteBuffer* vfsWriteBuffers = (IOWriteBuffer*)malloc(numIOVs * sizeof(IOWriteBuffer));
+	// Allocate memory for the IOWriteBuffers, on the stack if there are only a few IOVs.
+	IOWriteBuffer stackWriteBuffers[maxStackIOVs];
+	IOWriteBuffer* vfsWriteBuffers
+		= numIOVs <= maxStackIOVs ? stackWriteBuffers
+								  : (IOWriteBuffer*)malloc(numIOVs * sizeof(IOWriteBuffer));
 
 	// Catch any out-of-bounds memory access exceptions that are thrown.
 	__wasi_errno_t result = __WASI_ESUCCESS;
 	Runtime::catchRuntimeExceptions(
 		[&] {
 			// Translate the IOVs to IOWriteBuffers
-			const __wasi_ciovec_t* iovs
-				= memoryArrayPtr<__wasi_ciovec_t>(process->memory, iovsAddress, numIOVs);
+			const MemorySpan<const __wasi_ciovec_t> iovs(process->memory, iovsAddress, numIOVs);
 			U64 numBufferBytes = 0;
 			for(I32 iovIndex = 0; iovIndex < numIOVs; ++iovIndex)
 			{
@@ -471,7 +486,7 @@ static __wasi_errno_t writeImpl(Process* process,
 								   iov.buf,
 								   iov.buf_len);
 				vfsWriteBuffers[iovIndex].data
-					= memoryArrayPtr<const U8>(process->memory, iov.buf, iov.buf_len);
+					= MemorySpan<const U8>(process->memory, iov.buf, iov.buf_len).data();
 				vfsWriteBuffers[iovIndex].numBytes = iov.buf_len;
 				numBufferBytes += iov.buf_len;
 			}
@@ -479,8 +494,8 @@ static __wasi_errno_t writeImpl(Process* process,
 			else
 			{
 				// Do the writes.
-				result = asWASIErrNo(lockedFDE.fde->vfd->writev(
-					vfsWriteBuffers, numIOVs, &outNumBytesWritten, offset));
+				result = asWASIErrNo(
+					writeBuffers(lockedFDE.fde->vfd, vfsWriteBuffers, Uptr(numIOVs)));
 			}
 		},
 		[&](Exception* exception) {
@@ -495,11 +510,31 @@ static __wasi_errno_t writeImpl(Process* process,
 		});
 
 	// Free the VFS write buffers.
-	free(vfsWriteBuffers);
+	if(vfsWriteBuffers != stackWriteBuffers) { free(vfsWriteBuffers); }
 
 	return result;
 }
 
+static __wasi_errno_t writeImpl(Process* process,
+								__wasi_fd_t fd,
+								WASIAddress iovsAddress,
+								I32 numIOVs,
+								const __wasi_filesize_t* offset,
+								Uptr& outNumBytesWritten)
+{
+	const __wasi_rights_t requiredRights
+		= __WASI_RIGHT_FD_WRITE | (offset ? __WASI_RIGHT_FD_SEEK : 0);
+	return writeBuffersImpl(
+		process,
+		fd,
+		requiredRights,
+		iovsAddress,
+		numIOVs,
+		[&](VFD* vfd, const IOWriteBuffer* buffers, Uptr numBuffers) {
+			return vfd->writev(buffers, numBuffers, &outNumBytesWritten, offset);
+		});
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 							   "fd_pread",
 							   __wasi_errno_return_t,
@@ -632,7 +667,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
 
 	// Exclusively lock the fds mutex.
-	Platform::RWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
 
 	// Look up the FDE for the source FD.
 	if(fromFD < process->fdMap.getMinIndex() || fromFD > process->fdMap.getMaxIndex())
@@ -651,8 +686,13 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	// Don't allow renumbering preopened files.
 	if(fromFDE->isPreopened || toFDE->isPreopened) { return TRACE_SYSCALL_RETURN(__WASI_ENOTSUP); }
 
-	// Exclusively lock the FDE being replaced at the destination FD.
-	Platform::RWMutex::ExclusiveLock fromFDELock(fromFDE->mutex);
+	// Renumbering a FD to itself doesn't change anything.
+	if(fromFD == toFD) { return TRACE_SYSCALL_RETURN(__WASI_ESUCCESS); }
+
+	// Exclusively lock both FDEs, so there aren't any LockedFDEs referencing them when the
+	// FDE being replaced is freed.
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fromFDELock(fromFDE->mutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock toFDELock(toFDE->mutex);
 
 	// Close the FDE being replaced. This can return an error code, but closes the VFD+DirEntStream
 	// even if there was an error.
@@ -864,19 +904,20 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	LockedFDE lockedFDE = getLockedFDE(process, fd, __WASI_RIGHT_FD_ADVISE, 0);
 	if(lockedFDE.error != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(lockedFDE.error); }
 
+	FileAdvice fileAdvice;
 	switch(advice)
 	{
-	case __WASI_ADVICE_DONTNEED:
-	case __WASI_ADVICE_NOREUSE:
-	case __WASI_ADVICE_NORMAL:
-	case __WASI_ADVICE_RANDOM:
-	case __WASI_ADVICE_SEQUENTIAL:
-	case __WASI_ADVICE_WILLNEED:
-		// It's safe to ignore the advice, so just return success for now.
-		// TODO: do something with the advice!
-		return TRACE_SYSCALL_RETURN(__WASI_ESUCCESS);
+	case __WASI_ADVICE_DONTNEED: fileAdvice = FileAdvice::dontNeed; break;
+	case __WASI_ADVICE_NOREUSE: fileAdvice = FileAdvice::noReuse; break;
+	case __WASI_ADVICE_NORMAL: fileAdvice = FileAdvice::normal; break;
+	case __WASI_ADVICE_RANDOM: fileAdvice = FileAdvice::random; break;
+	case __WASI_ADVICE_SEQUENTIAL: fileAdvice = FileAdvice::sequential; break;
+	case __WASI_ADVICE_WILLNEED: fileAdvice = FileAdvice::willNeed; break;
 	default: return TRACE_SYSCALL_RETURN(__WASI_EINVAL);
 	}
+
+	const Result result = lockedFDE.fde->vfd->advise(offset, numBytes, fileAdvice);
+	return TRACE_SYSCALL_RETURN(asWASIErrNo(result));
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
@@ -887,7 +928,15 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 							   __wasi_filesize_t offset,
 							   __wasi_filesize_t numBytes)
 {
-	UNIMPLEMENTED_SYSCALL("fd_allocate", "(%u, %" PRIu64 ", %" PRIu64 ")", fd, offset, numBytes);
+	TRACE_SYSCALL("fd_allocate", "(%u, %" PRIu64 ", %" PRIu64 ")", fd, offset, numBytes);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	LockedFDE lockedFDE = getLockedFDE(process, fd, __WASI_RIGHT_FD_ALLOCATE, 0);
+	if(lockedFDE.error != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(lockedFDE.error); }
+
+	const Result result = lockedFDE.fde->vfd->allocate(offset, numBytes);
+	return TRACE_SYSCALL_RETURN(asWASIErrNo(result));
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
@@ -996,7 +1045,7 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 		= process->fileSystem->open(canonicalPath, accessMode, createMode, openedVFD, vfsVFDFlags);
 	if(result != VFS::Result::success) { return TRACE_SYSCALL_RETURN(asWASIErrNo(result)); }
 
-	Platform::RWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
+	Platform::ReaderBiasedRWMutex::ExclusiveLock fdsLock(process->fdMapMutex);
 	__wasi_fd_t fd = process->fdMap.add(
 		UINT32_MAX,
 		std::make_shared<FDE>(
@@ -1067,29 +1116,32 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	U8* buffer = memoryArrayPtr<U8>(process->memory, bufferAddress, numBufferBytes);
 	Uptr numBufferBytesUsed = 0;
 
-	while(numBufferBytesUsed < numBufferBytes)
+	// Serialize the entries straight from the stream's buffer into the guest's buffer. If the last
+	// entry doesn't fit, it's truncated, and the guest reads it again from its d_next cookie.
+	if(numBufferBytes > 0)
 	{
-		DirEnt dirEnt;
-		if(!lockedFDE.fde->dirEntStream->getNext(dirEnt)) { break; }
-
-		WAVM_ERROR_UNLESS(dirEnt.name.size() <= UINT32_MAX);
-
-		__wasi_dirent_t wasiDirEnt;
-		wasiDirEnt.d_next = lockedFDE.fde->dirEntStream->tell();
-		wasiDirEnt.d_ino = dirEnt.fileNumber;
-		wasiDirEnt.d_namlen = U32(dirEnt.name.size());
-		wasiDirEnt.d_type = asWASIFileType(dirEnt.type);
-
-		numBufferBytesUsed += truncatingMemcpy(buffer + numBufferBytesUsed,
-											   &wasiDirEnt,
-											   sizeof(wasiDirEnt),
-											   numBufferBytes - numBufferBytesUsed);
-
-		numBufferBytesUsed += truncatingMemcpy(buffer + numBufferBytesUsed,
-											   dirEnt.name.c_str(),
-											   dirEnt.name.size(),
-											   numBufferBytes - numBufferBytesUsed);
-	};
+		lockedFDE.fde->dirEntStream->readEntries([&](const DirEntRef& dirEnt) {
+			WAVM_ERROR_UNLESS(dirEnt.numNameChars <= UINT32_MAX);
+
+			__wasi_dirent_t wasiDirEnt;
+			wasiDirEnt.d_next = dirEnt.nextOffset;
+			wasiDirEnt.d_ino = dirEnt.fileNumber;
+			wasiDirEnt.d_namlen = U32(dirEnt.numNameChars);
+			wasiDirEnt.d_type = asWASIFileType(dirEnt.type);
+
+			numBufferBytesUsed += truncatingMemcpy(buffer + numBufferBytesUsed,
+												   &wasiDirEnt,
+												   sizeof(wasiDirEnt),
+												   numBufferBytes - numBufferBytesUsed);
+
+			numBufferBytesUsed += truncatingMemcpy(buffer + numBufferBytesUsed,
+												   dirEnt.name,
+												   dirEnt.numNameChars,
+												   numBufferBytes - numBufferBytesUsed);
+
+			return numBufferBytesUsed < numBufferBytes;
+		});
+	}
 
 	WAVM_ASSERT(numBufferBytesUsed <= numBufferBytes);
 	memoryRef<WASIAddress>(process->memory, outNumBufferBytesUsedAddress)
@@ -1527,3 +1579,124 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
 	const VFS::Result result = process->fileSystem->createDir(canonicalPath);
 	return TRACE_SYSCALL_RETURN(asWASIErrNo(result));
 }
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
+							   "sock_recv",
+							   __wasi_errno_return_t,
+							   wasi_sock_recv,
+							   __wasi_fd_t sock,
+							   WASIAddress ri_data,
+							   WASIAddress ri_data_len,
+							   __wasi_riflags_t ri_flags,
+							   WASIAddress ro_datalen,
+							   WASIAddress ro_flags)
+{
+	TRACE_SYSCALL("sock_recv",
+				  "(%u, " WASIADDRESS_FORMAT ", %u, 0x%04x, " WASIADDRESS_FORMAT
+				  ", " WASIADDRESS_FORMAT ")",
+				  sock,
+				  ri_data,
+				  ri_data_len,
+				  ri_flags,
+				  ro_datalen,
+				  ro_flags);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	if(ri_flags & ~(__WASI_SOCK_RECV_PEEK | __WASI_SOCK_RECV_WAITALL))
+	{ return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	SocketRecvFlags recvFlags;
+	recvFlags.peek = ri_flags & __WASI_SOCK_RECV_PEEK;
+	recvFlags.waitAll = ri_flags & __WASI_SOCK_RECV_WAITALL;
+
+	// Receive directly into the process's memory.
+	Uptr numBytesReceived = 0;
+	bool isTruncated = false;
+	const __wasi_errno_t result = readBuffersImpl(
+		process,
+		sock,
+		__WASI_RIGHT_FD_READ,
+		ri_data,
+		I32(ri_data_len),
+		[&](VFD* vfd, const IOReadBuffer* buffers, Uptr numBuffers) {
+			return vfd->recvv(buffers, numBuffers, recvFlags, &numBytesReceived, &isTruncated);
+		});
+
+	// Write the number of bytes received and the output flags to memory.
+	WAVM_ASSERT(numBytesReceived <= WASIADDRESS_MAX);
+	memoryRef<WASIAddress>(process->memory, ro_datalen) = WASIAddress(numBytesReceived);
+	memoryRef<__wasi_roflags_t>(process->memory, ro_flags)
+		= isTruncated ? __WASI_SOCK_RECV_DATA_TRUNCATED : 0;
+
+	return TRACE_SYSCALL_RETURN(
+		result, "(numBytesReceived=%" WAVM_PRIuPTR ")", numBytesReceived);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
+							   "sock_send",
+							   __wasi_errno_return_t,
+							   wasi_sock_send,
+							   __wasi_fd_t sock,
+							   WASIAddress si_data,
+							   WASIAddress si_data_len,
+							   __wasi_siflags_t si_flags,
+							   WASIAddress so_datalen)
+{
+	TRACE_SYSCALL("sock_send",
+				  "(%u, " WASIADDRESS_FORMAT ", %u, 0x%04x, " WASIADDRESS_FORMAT ")",
+				  sock,
+				  si_data,
+				  si_data_len,
+				  si_flags,
+				  so_datalen);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	// No send flags are defined.
+	if(si_flags) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	// Send directly from the process's memory.
+	Uptr numBytesSent = 0;
+	const __wasi_errno_t result = writeBuffersImpl(
+		process,
+		sock,
+		__WASI_RIGHT_FD_WRITE,
+		si_data,
+		I32(si_data_len),
+		[&](VFD* vfd, const IOWriteBuffer* buffers, Uptr numBuffers) {
+			return vfd->sendv(buffers, numBuffers, &numBytesSent);
+		});
+
+	// Write the number of bytes sent to memory.
+	WAVM_ASSERT(numBytesSent <= WASIADDRESS_MAX);
+	memoryRef<WASIAddress>(process->memory, so_datalen) = WASIAddress(numBytesSent);
+
+	return TRACE_SYSCALL_RETURN(result, "(numBytesSent=%" WAVM_PRIuPTR ")", numBytesSent);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasiFile,
+							   "sock_shutdown",
+							   __wasi_errno_return_t,
+							   wasi_sock_shutdown,
+							   __wasi_fd_t sock,
+							   __wasi_sdflags_t how)
+{
+	TRACE_SYSCALL("sock_shutdown", "(%u, 0x%02x)", sock, how);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	SocketShutdownType shutdownType;
+	switch(how)
+	{
+	case __WASI_SHUT_RD: shutdownType = SocketShutdownType::read; break;
+	case __WASI_SHUT_WR: shutdownType = SocketShutdownType::write; break;
+	case __WASI_SHUT_RD | __WASI_SHUT_WR: shutdownType = SocketShutdownType::readWrite; break;
+	default: return TRACE_SYSCALL_RETURN(__WASI_EINVAL);
+	};
+
+	LockedFDE lockedFDE = getLockedFDE(process, sock, __WASI_RIGHT_SOCK_SHUTDOWN, 0);
+	if(lockedFDE.error != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(lockedFDE.error); }
+
+	return TRACE_SYSCALL_RETURN(asWASIErrNo(lockedFDE.fde->vfd->shutdown(shutdownType)));
+}
@@ -0,0 +1,112 @@
+#include <inttypes.h>
+#include "./WASIPrivate.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Runtime/Intrinsics.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/VFS/VFS.h"
+#include "WAVM/WASI/WASIABI.h"
+
+using namespace WAVM;
+using namespace WAVM::WASI;
+using namespace WAVM::Runtime;
+using namespace WAVM::VFS;
+
+namespace WAVM { namespace WASI {
+	WAVM_DEFINE_INTRINSIC_MODULE(wasiMemoryMap)
+}}
+
+// Flags for fd_mmap.
+#define WAVM_WASI_MMAP_COPY_ON_WRITE (UINT32_C(0x1))
+
+// Checks that a range of the process's memory starts on a WebAssembly page, and is inside the
+// memory.
+static __wasi_errno_t validateMappedRange(Process* process,
+										  WASIAddress address,
+										  WASIAddress numBytes)
+{
+	// The mapped ranges must be aligned to a WebAssembly page, which is at least as large as the
+	// platform page size on most hosts.
+	if(Platform::getBytesPerPage() > IR::numBytesPerPage) { return __WASI_ENOTSUP; }
+	if(!numBytes || address & (IR::numBytesPerPage - 1)) { return __WASI_EINVAL; }
+
+	const U64 numMemoryBytes = U64(getMemoryNumPages(process->memory)) * IR::numBytesPerPage;
+	if(address > numMemoryBytes || numBytes > numMemoryBytes - address) { return __WASI_EFAULT; }
+
+	return __WASI_ESUCCESS;
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasiMemoryMap,
+							   "fd_mmap",
+							   __wasi_errno_return_t,
+							   wasi_fd_mmap,
+							   __wasi_fd_t fd,
+							   WASIAddress address,
+							   WASIAddress numBytes,
+							   __wasi_filesize_t offset,
+							   U32 flags)
+{
+	TRACE_SYSCALL("fd_mmap",
+				  "(%u, " WASIADDRESS_FORMAT ", %u, %" PRIu64 ", 0x%08x)",
+				  fd,
+				  address,
+				  numBytes,
+				  offset,
+				  flags);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	if(flags & ~WAVM_WASI_MMAP_COPY_ON_WRITE) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+	if(offset & (IR::numBytesPerPage - 1)) { return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	const __wasi_errno_t rangeError = validateMappedRange(process, address, numBytes);
+	if(rangeError != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(rangeError); }
+
+	LockedFDE lockedFDE = getLockedFDE(process, fd, __WASI_RIGHT_FD_READ, 0);
+	if(lockedFDE.error != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(lockedFDE.error); }
+
+	// Only the bytes of regular files can be mapped, and only up to the end of the file: accessing
+	// a page past the end of the file would trap.
+	FileInfo fileInfo;
+	Result result = lockedFDE.fde->vfd->getFileInfo(fileInfo);
+	if(result != Result::success) { return TRACE_SYSCALL_RETURN(asWASIErrNo(result)); }
+	if(fileInfo.type != FileType::file) { return TRACE_SYSCALL_RETURN(__WASI_ENODEV); }
+	if(offset > fileInfo.numBytes || numBytes > fileInfo.numBytes - offset)
+	{ return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	Uptr hostHandle = 0;
+	result = lockedFDE.fde->vfd->getHostHandle(hostHandle);
+	if(result != Result::success) { return TRACE_SYSCALL_RETURN(__WASI_ENODEV); }
+
+	if(!mapFileToMemory(process->memory,
+						address,
+						numBytes,
+						hostHandle,
+						offset,
+						flags & WAVM_WASI_MMAP_COPY_ON_WRITE))
+	{ return TRACE_SYSCALL_RETURN(__WASI_ENOMEM); }
+
+	return TRACE_SYSCALL_RETURN(__WASI_ESUCCESS);
+}
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(wasiMemoryMap,
+							   "munmap",
+							   __wasi_errno_return_t,
+							   wasi_munmap,
+							   WASIAddress address,
+							   WASIAddress numBytes)
+{
+	TRACE_SYSCALL("munmap", "(" WASIADDRESS_FORMAT ", %u)", address, numBytes);
+
+	Process* process = getProcessFromContextRuntimeData(contextRuntimeData);
+
+	const __wasi_errno_t rangeError = validateMappedRange(process, address, numBytes);
+	if(rangeError != __WASI_ESUCCESS) { return TRACE_SYSCALL_RETURN(rangeError); }
+
+	if(!resetMemoryPages(process->memory, address, numBytes))
+	{ return TRACE_SYSCALL_RETURN(__WASI_EINVAL); }
+
+	return TRACE_SYSCALL_RETURN(__WASI_ESUCCESS);
+}
@@ -4,6 +4,7 @@
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/IndexMap.h"
 #include "WAVM/Inline/Time.h"
+#include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Mutex.h"
 #include "WAVM/Platform/RWMutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
@@ -56,9 +57,11 @@ namespace WAVM { namespace VFS {
 }}
 
 namespace WAVM { namespace WASI {
+	// An open file in a process's fd table. The FDE is only removed from the table while it's
+	// exclusively locked, so a LockedFDE doesn't need a reference to keep it alive.
 	struct FDE
 	{
-		mutable Platform::RWMutex mutex;
+		mutable Platform::ReaderBiasedRWMutex mutex;
 
 		VFS::VFD* vfd;
 		__wasi_rights_t rights;
@@ -108,7 +111,10 @@ namespace WAVM { namespace WASI {
 		std::vector<std::string> args;
 		std::vector<std::string> envs;
 
-		Platform::RWMutex fdMapMutex;
+		// The fd table is read by every file syscall, but only written when a file is opened,
+		// closed, or renumbered, so it's reader-biased. The most recently closed fd is the first to
+		// be reused when a file is opened.
+		Platform::ReaderBiasedRWMutex fdMapMutex;
 		IndexMap<__wasi_fd_t, std::shared_ptr<WASI::FDE>> fdMap{0, INT32_MAX};
 
 		VFS::FileSystem* fileSystem = nullptr;
@@ -117,6 +123,10 @@ namespace WAVM { namespace WASI {
 
 		Time processClockOrigin;
 
+		// If true, the realtime and monotonic clocks are read from the platform's coarse versions
+		// of them.
+		bool useCoarseClocks = false;
+
 		~Process();
 	};
 
@@ -142,8 +152,35 @@ namespace WAVM { namespace WASI {
 									   const char* format,
 									   ...);
 
+	struct LockedFDE
+	{
+		__wasi_errno_t error;
+
+		// Only set if result==_WASI_ESUCCESS:
+		Platform::ReaderBiasedRWMutex::Lock fdeLock;
+		FDE* fde{nullptr};
+
+		LockedFDE(__wasi_errno_t inError) : error(inError) {}
+		LockedFDE(FDE* inFDE, Platform::RWMutex::LockShareability lockShareability)
+		: error(__WASI_ESUCCESS), fdeLock(inFDE->mutex, lockShareability), fde(inFDE)
+		{
+		}
+	};
+
+	// Looks up the FDE for a WASI fd, checks that it has the required rights, and locks it.
+	LockedFDE getLockedFDE(Process* process,
+						   __wasi_fd_t fd,
+						   __wasi_rights_t requiredRights,
+						   __wasi_rights_t requiredInheritingRights,
+						   Platform::RWMutex::LockShareability lockShareability
+						   = Platform::RWMutex::shareable);
+
+	__wasi_errno_t asWASIErrNo(VFS::Result result);
+	bool getPlatformClock(__wasi_clockid_t clock, Platform::Clock& outPlatformClock);
+
 	WAVM_DECLARE_INTRINSIC_MODULE(wasi);
 	WAVM_DECLARE_INTRINSIC_MODULE(wasiArgsEnvs);
 	WAVM_DECLARE_INTRINSIC_MODULE(wasiClocks);
 	WAVM_DECLARE_INTRINSIC_MODULE(wasiFile);
+	WAVM_DECLARE_INTRINSIC_MODULE(wasiMemoryMap);
 }}
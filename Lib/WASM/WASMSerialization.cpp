@@ -1,4 +1,8 @@
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -15,7 +19,10 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Inline/Unicode.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Trace.h"
 #include "WAVM/Platform/Defines.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/WASM/WASM.h"
 
 using namespace WAVM;
@@ -38,6 +45,17 @@ WAVM_FORCEINLINE void serializeOpcode(InputStream& stream, Opcode& opcode)
 	{
 		U32 opcodeVarUInt;
 		serializeVarUInt32(stream, opcodeVarUInt);
+		if(opcodeU8 == 0xfd && opcodeVarUInt >= 0x100 && opcodeVarUInt <= 0x1ff)
+		{
+			opcodeU8 = relaxedSIMDOpcodePrefix;
+			opcodeVarUInt -= 0x100;
+		}
+		else if(opcodeU8 == relaxedSIMDOpcodePrefix || opcodeVarUInt > 0xff)
+		{
+			throw FatalSerializationException(std::string("unknown opcode (")
+											  + std::to_string(opcodeU8) + " "
+											  + std::to_string(opcodeVarUInt) + ")");
+		}
 		opcode = Opcode((U32(opcodeU8) << 8) | opcodeVarUInt);
 	}
 }
@@ -52,6 +70,11 @@ WAVM_FORCEINLINE void serializeOpcode(OutputStream& stream, Opcode opcode)
 	{
 		U8 opcodePrefix = U8(U16(opcode) >> 8);
 		U32 opcodeVarUInt = U32(opcode) & 0xff;
+		if(opcodePrefix == relaxedSIMDOpcodePrefix)
+		{
+			opcodePrefix = 0xfd;
+			opcodeVarUInt += 0x100;
+		}
 		serializeNativeValue(stream, opcodePrefix);
 		serializeVarUInt32(stream, opcodeVarUInt);
 	}
@@ -401,17 +424,46 @@ namespace WAVM { namespace IR {
 		case ElemSegment::Encoding::index: {
 			// Serialize the extern kind referenced by the segment elements.
 			if(flags & 3) { serialize(stream, elemSegment.contents->externKind); }
-			serializeArray(
-				stream, elemSegment.contents->elemIndices, [](Stream& stream, Uptr& externIndex) {
-					serializeVarUInt32(stream, externIndex);
-				});
+			serializeVarUInt32Array(stream, elemSegment.contents->elemIndices);
 			break;
 		}
 		default: WAVM_UNREACHABLE();
 		};
 	}
 
-	template<typename Stream> void serialize(Stream& stream, DataSegment& dataSegment)
+	// Deserializes the bytes of a data segment. If inputBytesOwner is non-null, it keeps the input
+	// stream's buffer alive, and the data segment references the buffer instead of copying it.
+	static void serializeDataSegmentBytes(InputStream& stream,
+										  std::shared_ptr<DataSegmentBytes>& data,
+										  const std::shared_ptr<const void>& inputBytesOwner)
+	{
+		Uptr numBytes = 0;
+		serializeVarUInt32(stream, numBytes);
+
+		// Advance the stream before allocating the bytes: try to get a serialization exception
+		// before making a huge allocation for malformed input.
+		const U8* bytes = stream.advance(numBytes);
+		if(inputBytesOwner)
+		{ data = std::make_shared<DataSegmentBytes>(bytes, numBytes, inputBytesOwner); }
+		else
+		{
+			data = std::make_shared<DataSegmentBytes>(std::vector<U8>(bytes, bytes + numBytes));
+		}
+	}
+
+	static void serializeDataSegmentBytes(OutputStream& stream,
+										  std::shared_ptr<DataSegmentBytes>& data,
+										  const std::shared_ptr<const void>&)
+	{
+		Uptr numBytes = data->size();
+		serializeVarUInt32(stream, numBytes);
+		serializeBytes(stream, data->data(), numBytes);
+	}
+
+	template<typename Stream>
+	void serialize(Stream& stream,
+				   DataSegment& dataSegment,
+				   const std::shared_ptr<const void>& inputBytesOwner = nullptr)
 	{
 		if(Stream::isInput)
 		{
@@ -437,7 +489,6 @@ namespace WAVM { namespace IR {
 				break;
 			default: throw FatalSerializationException("invalid data segment flags");
 			};
-			dataSegment.data = std::make_shared<std::vector<U8>>();
 		}
 		else
 		{
@@ -453,7 +504,7 @@ namespace WAVM { namespace IR {
 				serialize(stream, dataSegment.baseOffset);
 			}
 		}
-		serialize(stream, *dataSegment.data);
+		serializeDataSegmentBytes(stream, dataSegment.data, inputBytesOwner);
 	}
 }}
 
@@ -494,6 +545,18 @@ struct ModuleSerializationState
 	std::shared_ptr<ModuleValidationState> validationState;
 	const Module& module;
 
+	// Only used when deserializing.
+	OrderedSectionID lastKnownOrderedSectionID = OrderedSectionID::moduleBeginning;
+	bool hadFunctionDefinitions = false;
+	bool hadDataSection = false;
+
+	// If non-null, keeps the buffer that the module is loaded from alive, so the loaded data
+	// segments can reference it instead of copying it.
+	std::shared_ptr<const void> inputBytesOwner;
+
+	// If false, function bodies are decoded without validating them.
+	bool validateFunctionBodies = true;
+
 	ModuleSerializationState(const Module& inModule) : module(inModule) {}
 };
 
@@ -565,12 +628,16 @@ static void serialize(InputStream& stream,
 					  FunctionDef& functionDef,
 					  const ModuleSerializationState&)
 {
-	std::vector<Uptr> branchTable;
-	serializeArray(stream, branchTable, [](InputStream& stream, Uptr& targetDepth) {
-		serializeVarUInt32(stream, targetDepth);
-	});
-	imm.branchTableIndex = functionDef.branchTables.size();
-	functionDef.branchTables.push_back(std::move(branchTable));
+	// Decode the target depths directly into the function's array of them. Each takes at least a
+	// byte, so check that there are enough bytes left before growing the array.
+	serializeVarUInt32(stream, imm.numTargetDepths);
+	if(imm.numTargetDepths > stream.capacity())
+	{ throw FatalSerializationException("expected data but found end of stream"); }
+	std::vector<U32>& targetDepths = functionDef.branchTableTargetDepths;
+	imm.firstTargetDepthIndex = targetDepths.size();
+	targetDepths.resize(imm.firstTargetDepthIndex + imm.numTargetDepths);
+	for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
+	{ serializeVarUInt32(stream, targetDepths[imm.firstTargetDepthIndex + targetIndex]); }
 	serializeVarUInt32(stream, imm.defaultTargetDepth);
 }
 static void serialize(OutputStream& stream,
@@ -578,11 +645,14 @@ static void serialize(OutputStream& stream,
 					  FunctionDef& functionDef,
 					  const ModuleSerializationState&)
 {
-	WAVM_ASSERT(imm.branchTableIndex < functionDef.branchTables.size());
-	std::vector<Uptr>& branchTable = functionDef.branchTables[imm.branchTableIndex];
-	serializeArray(stream, branchTable, [](OutputStream& stream, Uptr& targetDepth) {
-		serializeVarUInt32(stream, targetDepth);
-	});
+	WAVM_ASSERT(imm.firstTargetDepthIndex + imm.numTargetDepths
+				<= functionDef.branchTableTargetDepths.size());
+	serializeVarUInt32(stream, imm.numTargetDepths);
+	for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
+	{
+		serializeVarUInt32(
+			stream, functionDef.branchTableTargetDepths[imm.firstTargetDepthIndex + targetIndex]);
+	}
 	serializeVarUInt32(stream, imm.defaultTargetDepth);
 }
 
@@ -896,7 +966,9 @@ static void serialize(OutputStream& stream, CustomSection& customSection)
 	serialize(sectionStream, customSection.name);
 	serializeBytes(sectionStream, customSection.data.data(), customSection.data.size());
 	std::vector<U8> sectionBytes = sectionStream.getBytes();
-	serialize(stream, sectionBytes);
+	Uptr sectionNumBytes = sectionBytes.size();
+	serializeVarUInt32(stream, sectionNumBytes);
+	serializeBytes(stream, sectionBytes.data(), sectionBytes.size());
 }
 
 static void serialize(InputStream& stream, CustomSection& customSection)
@@ -969,12 +1041,11 @@ private:
 	const ModuleSerializationState& moduleState;
 };
 
-static void serializeFunctionBody(OutputStream& sectionStream,
-								  Module& module,
-								  FunctionDef& functionDef,
-								  const ModuleSerializationState& moduleState)
+// Encodes a function body, not including its size. Reuses bodyStream's buffer for each body.
+static std::vector<U8> encodeFunctionBody(FunctionDef& functionDef,
+										  const ModuleSerializationState& moduleState,
+										  ArrayOutputStream& bodyStream)
 {
-	ArrayOutputStream bodyStream;
 
 	// Convert the function's local types into LocalSets: runs of locals of the same type.
 	LocalSet* localSets
@@ -1007,19 +1078,27 @@ static void serializeFunctionBody(OutputStream& sectionStream,
 	OperatorSerializerStream wasmOpEncoderStream(bodyStream, functionDef, moduleState);
 	while(irDecoderStream) { irDecoderStream.decodeOp(wasmOpEncoderStream); };
 
-	std::vector<U8> bodyBytes = bodyStream.getBytes();
-	serialize(sectionStream, bodyBytes);
+	return bodyStream.copyBytesAndReset();
 }
 
-static void serializeFunctionBody(InputStream& sectionStream,
-								  Module& module,
-								  FunctionDef& functionDef,
-								  const ModuleSerializationState& moduleState)
+static void serializeFunctionBodyBytes(OutputStream& sectionStream,
+									   const std::vector<U8>& bodyBytes)
 {
-	Uptr numBodyBytes = 0;
+	Uptr numBodyBytes = bodyBytes.size();
 	serializeVarUInt32(sectionStream, numBodyBytes);
+	serializeBytes(sectionStream, bodyBytes.data(), bodyBytes.size());
+}
 
-	MemoryInputStream bodyStream(sectionStream.advance(numBodyBytes), numBodyBytes);
+// irCodeByteStream is a scratch buffer that is reused for each function body decoded by a thread,
+// so encoding a function body's IR only allocates the exactly-sized array it is copied to.
+static void deserializeFunctionBody(const U8* bodyBytes,
+									Uptr numBodyBytes,
+									Module& module,
+									FunctionDef& functionDef,
+									const ModuleSerializationState& moduleState,
+									ArrayOutputStream& irCodeByteStream)
+{
+	MemoryInputStream bodyStream(bodyBytes, numBodyBytes);
 
 	// Deserialize local sets and unpack them into a linear array of local types.
 	Uptr numLocalSets = 0;
@@ -1030,14 +1109,14 @@ static void serializeFunctionBody(InputStream& sectionStream,
 		serialize(bodyStream, localSet);
 		if(functionDef.nonParameterLocalTypes.size() + localSet.num >= module.featureSpec.maxLocals)
 		{ throw FatalSerializationException("too many locals"); }
-		for(Uptr index = 0; index < localSet.num; ++index)
-		{ functionDef.nonParameterLocalTypes.push_back(localSet.type); }
+		functionDef.nonParameterLocalTypes.insert(
+			functionDef.nonParameterLocalTypes.end(), localSet.num, localSet.type);
 	}
 
 	// Deserialize the function code, validate it, and re-encode it in the IR format.
-	ArrayOutputStream irCodeByteStream;
 	OperatorEncoderStream irEncoderStream(irCodeByteStream);
 	CodeValidationStream codeValidationStream(*moduleState.validationState, functionDef);
+	const bool validate = moduleState.validateFunctionBodies;
 	while(bodyStream.capacity())
 	{
 		Opcode opcode;
@@ -1048,7 +1127,7 @@ static void serializeFunctionBody(InputStream& sectionStream,
 	case Uptr(Opcode::name): {                                                                     \
 		Imm imm;                                                                                   \
 		serialize(bodyStream, imm, functionDef, moduleState);                                      \
-		codeValidationStream.name(imm);                                                            \
+		if(validate) { codeValidationStream.name(imm); }                                           \
 		irEncoderStream.name(imm);                                                                 \
 		break;                                                                                     \
 	}
@@ -1058,7 +1137,7 @@ static void serializeFunctionBody(InputStream& sectionStream,
 		case 0x1b: {
 			SelectImm imm{ValueType::any};
 
-			codeValidationStream.select(imm);
+			if(validate) { codeValidationStream.select(imm); }
 			irEncoderStream.select(imm);
 			break;
 		}
@@ -1066,7 +1145,7 @@ static void serializeFunctionBody(InputStream& sectionStream,
 			SelectImm imm;
 			serialize(bodyStream, imm, functionDef, moduleState);
 
-			codeValidationStream.select(imm);
+			if(validate) { codeValidationStream.select(imm); }
 			irEncoderStream.select(imm);
 			break;
 		}
@@ -1075,9 +1154,22 @@ static void serializeFunctionBody(InputStream& sectionStream,
 											  + std::to_string(Uptr(opcode)) + ")");
 		};
 	};
-	codeValidationStream.finish();
+	if(validate) { codeValidationStream.finish(); }
+
+	functionDef.code = irCodeByteStream.copyBytesAndReset();
+}
 
-	functionDef.code = std::move(irCodeByteStream.getBytes());
+static void serializeFunctionBody(InputStream& sectionStream,
+								  Module& module,
+								  FunctionDef& functionDef,
+								  const ModuleSerializationState& moduleState,
+								  ArrayOutputStream& irCodeByteStream)
+{
+	Uptr numBodyBytes = 0;
+	serializeVarUInt32(sectionStream, numBodyBytes);
+	const U8* bodyBytes = sectionStream.advance(numBodyBytes);
+	deserializeFunctionBody(
+		bodyBytes, numBodyBytes, module, functionDef, moduleState, irCodeByteStream);
 }
 
 static void serializeCallingConvention(InputStream& stream, CallingConvention& callingConvention)
@@ -1376,6 +1468,125 @@ template<typename Stream> void serializeElementSection(Stream& moduleStream, Mod
 	});
 }
 
+// Each thread that decodes or encodes function bodies is given at least this many of them, so small
+// modules don't pay for the threads.
+static constexpr Uptr minFunctionBodiesPerDecodeThread = 256;
+
+// The number of function bodies that a decode or encode thread takes from the shared state at once.
+static constexpr Uptr numFunctionBodiesPerDecodeBatch = 16;
+
+namespace {
+	struct FunctionBodyBytes
+	{
+		const U8* bytes;
+		Uptr numBytes;
+	};
+
+	struct ParallelCodeSectionState
+	{
+		Module& module;
+		const ModuleSerializationState& moduleState;
+		const std::vector<FunctionBodyBytes>& functionBodies;
+
+		Platform::Mutex mutex;
+		Uptr nextFunctionBodyIndex = 0;
+
+		// The lowest index of a function body that failed to decode, and its exception.
+		Uptr failedFunctionBodyIndex = UINTPTR_MAX;
+		std::exception_ptr failureException;
+
+		ParallelCodeSectionState(Module& inModule,
+								 const ModuleSerializationState& inModuleState,
+								 const std::vector<FunctionBodyBytes>& inFunctionBodies)
+		: module(inModule), moduleState(inModuleState), functionBodies(inFunctionBodies)
+		{
+		}
+	};
+}
+
+static I64 parallelCodeSectionThreadMain(void* sharedStateVoid)
+{
+	ParallelCodeSectionState& state = *(ParallelCodeSectionState*)sharedStateVoid;
+	ArrayOutputStream irCodeByteStream;
+	while(true)
+	{
+		// Take the next batch of function bodies. Function bodies after one that has already
+		// failed don't need to be decoded, since the lowest failing index is reported.
+		Uptr beginIndex;
+		Uptr endIndex;
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			beginIndex = state.nextFunctionBodyIndex;
+			endIndex = std::min(
+				beginIndex + numFunctionBodiesPerDecodeBatch,
+				std::min(state.functionBodies.size(), state.failedFunctionBodyIndex));
+			if(beginIndex >= endIndex) { break; }
+			state.nextFunctionBodyIndex = endIndex;
+		}
+
+		for(Uptr bodyIndex = beginIndex; bodyIndex < endIndex; ++bodyIndex)
+		{
+			try
+			{
+				deserializeFunctionBody(state.functionBodies[bodyIndex].bytes,
+										state.functionBodies[bodyIndex].numBytes,
+										state.module,
+										state.module.functions.defs[bodyIndex],
+										state.moduleState,
+										irCodeByteStream);
+			}
+			catch(...)
+			{
+				Platform::Mutex::Lock lock(state.mutex);
+				if(bodyIndex < state.failedFunctionBodyIndex)
+				{
+					state.failedFunctionBodyIndex = bodyIndex;
+					state.failureException = std::current_exception();
+				}
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+// Decodes the function bodies in a code section in parallel on the calling thread and numThreads-1
+// additional threads. Throws the same exception as decoding the bodies serially would.
+static void deserializeFunctionBodiesInParallel(InputStream& sectionStream,
+											   Module& module,
+											   const ModuleSerializationState& moduleState,
+											   Uptr numThreads)
+{
+	// Find the bytes of each function body. If the size of a function body is malformed, the
+	// bodies before it are still decoded, so an error in one of them takes precedence.
+	std::vector<FunctionBodyBytes> functionBodies;
+	std::exception_ptr sizeException;
+	try
+	{
+		while(functionBodies.size() < module.functions.defs.size())
+		{
+			FunctionBodyBytes functionBody;
+			serializeVarUInt32(sectionStream, functionBody.numBytes);
+			functionBody.bytes = sectionStream.advance(functionBody.numBytes);
+			functionBodies.push_back(functionBody);
+		}
+	}
+	catch(Serialization::FatalSerializationException const&)
+	{
+		sizeException = std::current_exception();
+	}
+
+	ParallelCodeSectionState parallelState(module, moduleState, functionBodies);
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+	{ threads.push_back(Platform::createThread(0, parallelCodeSectionThreadMain, &parallelState)); }
+	parallelCodeSectionThreadMain(&parallelState);
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+	if(parallelState.failureException) { std::rethrow_exception(parallelState.failureException); }
+	if(sizeException) { std::rethrow_exception(sizeException); }
+}
+
 static void serializeCodeSection(InputStream& moduleStream,
 								 Module& module,
 								 const ModuleSerializationState& moduleState)
@@ -1389,11 +1600,121 @@ static void serializeCodeSection(InputStream& moduleStream,
 				throw FatalSerializationException(
 					"function and code sections have mismatched function counts");
 			}
-			for(FunctionDef& functionDef : module.functions.defs)
-			{ serializeFunctionBody(sectionStream, module, functionDef, moduleState); }
+
+			// Function bodies only depend on the module-level declarations, so large code
+			// sections are decoded in parallel.
+			const Uptr numThreads
+				= std::max(Uptr(1),
+						   std::min(Platform::getNumberOfHardwareThreads(),
+									numFunctionBodies / minFunctionBodiesPerDecodeThread));
+			if(numThreads > 1)
+			{
+				deserializeFunctionBodiesInParallel(sectionStream, module, moduleState, numThreads);
+			}
+			else
+			{
+				ArrayOutputStream irCodeByteStream;
+				for(FunctionDef& functionDef : module.functions.defs)
+				{
+					serializeFunctionBody(
+						sectionStream, module, functionDef, moduleState, irCodeByteStream);
+				}
+			}
 		});
 }
 
+namespace {
+	struct ParallelEncodeState
+	{
+		Module& module;
+		const ModuleSerializationState& moduleState;
+
+		// The function bodies in the current window, and their encoded bytes.
+		Uptr windowBeginIndex = 0;
+		std::vector<std::vector<U8>> bodyBytes;
+		std::atomic<Uptr> nextFunctionDefIndex{0};
+
+		// The lowest index of a function body that failed to encode, and its exception.
+		Platform::Mutex mutex;
+		Uptr failedFunctionDefIndex = UINTPTR_MAX;
+		std::exception_ptr failureException;
+
+		ParallelEncodeState(Module& inModule, const ModuleSerializationState& inModuleState)
+		: module(inModule), moduleState(inModuleState)
+		{
+		}
+	};
+}
+
+static I64 parallelEncodeThreadMain(void* sharedStateVoid)
+{
+	ParallelEncodeState& state = *(ParallelEncodeState*)sharedStateVoid;
+	const Uptr windowEndIndex = state.windowBeginIndex + state.bodyBytes.size();
+	ArrayOutputStream bodyStream;
+	while(true)
+	{
+		const Uptr beginIndex = state.nextFunctionDefIndex.fetch_add(
+			numFunctionBodiesPerDecodeBatch, std::memory_order_relaxed);
+		if(beginIndex >= windowEndIndex) { break; }
+		const Uptr endIndex = std::min(beginIndex + numFunctionBodiesPerDecodeBatch, windowEndIndex);
+
+		for(Uptr functionDefIndex = beginIndex; functionDefIndex < endIndex; ++functionDefIndex)
+		{
+			try
+			{
+				state.bodyBytes[functionDefIndex - state.windowBeginIndex] = encodeFunctionBody(
+					state.module.functions.defs[functionDefIndex], state.moduleState, bodyStream);
+			}
+			catch(...)
+			{
+				bodyStream.reset();
+
+				Platform::Mutex::Lock lock(state.mutex);
+				if(functionDefIndex < state.failedFunctionDefIndex)
+				{
+					state.failedFunctionDefIndex = functionDefIndex;
+					state.failureException = std::current_exception();
+				}
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+// Encodes the function bodies in a code section in parallel on the calling thread and
+// numThreads-1 additional threads, and writes them to the section in order. The bodies are encoded
+// in windows, so only a window of encoded bodies is buffered at once.
+static void serializeFunctionBodiesInParallel(OutputStream& sectionStream,
+											 Module& module,
+											 const ModuleSerializationState& moduleState,
+											 Uptr numThreads)
+{
+	const Uptr numFunctionDefs = module.functions.defs.size();
+	const Uptr numFunctionDefsPerWindow = numThreads * minFunctionBodiesPerDecodeThread;
+	ParallelEncodeState state(module, moduleState);
+	for(Uptr windowBeginIndex = 0; windowBeginIndex < numFunctionDefs;
+		windowBeginIndex += numFunctionDefsPerWindow)
+	{
+		state.windowBeginIndex = windowBeginIndex;
+		state.bodyBytes.clear();
+		state.bodyBytes.resize(
+			std::min(numFunctionDefsPerWindow, numFunctionDefs - windowBeginIndex));
+		state.nextFunctionDefIndex.store(windowBeginIndex, std::memory_order_relaxed);
+
+		std::vector<Platform::Thread*> threads;
+		for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+		{ threads.push_back(Platform::createThread(0, parallelEncodeThreadMain, &state)); }
+		parallelEncodeThreadMain(&state);
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+		if(state.failureException) { std::rethrow_exception(state.failureException); }
+
+		for(const std::vector<U8>& bodyBytes : state.bodyBytes)
+		{ serializeFunctionBodyBytes(sectionStream, bodyBytes); }
+	}
+}
+
 void serializeCodeSection(OutputStream& moduleStream,
 						  Module& module,
 						  const ModuleSerializationState& moduleState)
@@ -1402,8 +1723,25 @@ void serializeCodeSection(OutputStream& moduleStream,
 		moduleStream, SectionID::code, [&module, &moduleState](OutputStream& sectionStream) {
 			Uptr numFunctionBodies = module.functions.defs.size();
 			serializeVarUInt32(sectionStream, numFunctionBodies);
-			for(FunctionDef& functionDef : module.functions.defs)
-			{ serializeFunctionBody(sectionStream, module, functionDef, moduleState); }
+
+			// Like decoding, large code sections are encoded in parallel.
+			const Uptr numThreads
+				= std::max(Uptr(1),
+						   std::min(Platform::getNumberOfHardwareThreads(),
+									numFunctionBodies / minFunctionBodiesPerDecodeThread));
+			if(numThreads > 1)
+			{
+				serializeFunctionBodiesInParallel(sectionStream, module, moduleState, numThreads);
+			}
+			else
+			{
+				ArrayOutputStream bodyStream;
+				for(FunctionDef& functionDef : module.functions.defs)
+				{
+					serializeFunctionBodyBytes(
+						sectionStream, encodeFunctionBody(functionDef, moduleState, bodyStream));
+				}
+			}
 		});
 }
 
@@ -1424,13 +1762,15 @@ template<typename Stream> void serializeDataCountSection(Stream& moduleStream, M
 	});
 }
 
-void serializeDataSection(InputStream& moduleStream, Module& module, bool hadDataCountSection)
+void serializeDataSection(InputStream& moduleStream,
+						  Module& module,
+						  const ModuleSerializationState& moduleState)
 {
 	serializeSection(
-		moduleStream, SectionID::data, [&module, hadDataCountSection](InputStream& sectionStream) {
+		moduleStream, SectionID::data, [&module, &moduleState](InputStream& sectionStream) {
 			Uptr numDataSegments = 0;
 			serializeVarUInt32(sectionStream, numDataSegments);
-			if(!hadDataCountSection)
+			if(!moduleState.hadDataCountSection)
 			{
 				// To make fuzzing more effective, fail gracefully instead of
 				// through OOM if the DataCount section specifies a large number of
@@ -1445,7 +1785,11 @@ void serializeDataSection(InputStream& moduleStream, Module& module, bool hadDat
 					"DataCount and Data sections have mismatched segment counts");
 			}
 			for(Uptr segmentIndex = 0; segmentIndex < module.dataSegments.size(); ++segmentIndex)
-			{ serialize(sectionStream, module.dataSegments[segmentIndex]); }
+			{
+				serialize(sectionStream,
+						  module.dataSegments[segmentIndex],
+						  moduleState.inputBytesOwner);
+			}
 		});
 }
 
@@ -1507,138 +1851,233 @@ static void serializeModule(OutputStream& moduleStream, Module& module)
 	serializeCustomSectionsAfterKnownSection(moduleStream, module, OrderedSectionID::data);
 }
 
-static void serializeModule(InputStream& moduleStream, Module& module)
+// Checks that a known section is in the correct order relative to the previous known sections.
+static void checkSectionOrder(SectionID sectionID, ModuleSerializationState& moduleState)
+{
+	if(sectionID == SectionID::custom) { return; }
+
+	OrderedSectionID orderedSectionID;
+	switch(sectionID)
+	{
+	case SectionID::type: orderedSectionID = OrderedSectionID::type; break;
+	case SectionID::import: orderedSectionID = OrderedSectionID::import; break;
+	case SectionID::function: orderedSectionID = OrderedSectionID::function; break;
+	case SectionID::table: orderedSectionID = OrderedSectionID::table; break;
+	case SectionID::memory: orderedSectionID = OrderedSectionID::memory; break;
+	case SectionID::global: orderedSectionID = OrderedSectionID::global; break;
+	case SectionID::export_: orderedSectionID = OrderedSectionID::export_; break;
+	case SectionID::start: orderedSectionID = OrderedSectionID::start; break;
+	case SectionID::elem: orderedSectionID = OrderedSectionID::elem; break;
+	case SectionID::code: orderedSectionID = OrderedSectionID::code; break;
+	case SectionID::data: orderedSectionID = OrderedSectionID::data; break;
+	case SectionID::dataCount: orderedSectionID = OrderedSectionID::dataCount; break;
+	case SectionID::exceptionType: orderedSectionID = OrderedSectionID::exceptionType; break;
+
+	case SectionID::custom: WAVM_UNREACHABLE();
+	default:
+		throw FatalSerializationException("unknown section ID (" + std::to_string(U8(sectionID)));
+	};
+
+	if(orderedSectionID > moduleState.lastKnownOrderedSectionID)
+	{ moduleState.lastKnownOrderedSectionID = orderedSectionID; }
+	else
+	{
+		throw FatalSerializationException("incorrect order for known section");
+	}
+}
+
+// Deserializes and validates the section following a section ID that has already been read from
+// the stream.
+static void deserializeSection(InputStream& moduleStream,
+							   SectionID sectionID,
+							   Module& module,
+							   ModuleSerializationState& moduleState)
+{
+	switch(sectionID)
+	{
+	case SectionID::type:
+		serializeTypeSection(moduleStream, module);
+		IR::validateTypes(*moduleState.validationState);
+		break;
+	case SectionID::import:
+		serializeImportSection(moduleStream, module);
+		IR::validateImports(*moduleState.validationState);
+		break;
+	case SectionID::function:
+		serializeFunctionSection(moduleStream, module);
+		IR::validateFunctionDeclarations(*moduleState.validationState);
+		break;
+	case SectionID::table:
+		serializeTableSection(moduleStream, module);
+		IR::validateTableDefs(*moduleState.validationState);
+		break;
+	case SectionID::memory:
+		serializeMemorySection(moduleStream, module);
+		IR::validateMemoryDefs(*moduleState.validationState);
+		break;
+	case SectionID::global:
+		serializeGlobalSection(moduleStream, module);
+		IR::validateGlobalDefs(*moduleState.validationState);
+		break;
+	case SectionID::exceptionType:
+		serializeExceptionTypeSection(moduleStream, module);
+		IR::validateExceptionTypeDefs(*moduleState.validationState);
+		break;
+	case SectionID::export_:
+		serializeExportSection(moduleStream, module);
+		IR::validateExports(*moduleState.validationState);
+		break;
+	case SectionID::start:
+		serializeStartSection(moduleStream, module);
+		IR::validateStartFunction(*moduleState.validationState);
+		break;
+	case SectionID::elem:
+		serializeElementSection(moduleStream, module);
+		IR::validateElemSegments(*moduleState.validationState);
+		break;
+	case SectionID::dataCount:
+		serializeDataCountSection(moduleStream, module);
+		moduleState.hadDataCountSection = true;
+		break;
+	case SectionID::code:
+		serializeCodeSection(moduleStream, module, moduleState);
+		moduleState.hadFunctionDefinitions = true;
+		break;
+	case SectionID::data:
+		serializeDataSection(moduleStream, module, moduleState);
+		moduleState.hadDataSection = true;
+		IR::validateDataSegments(*moduleState.validationState);
+		break;
+	case SectionID::custom: {
+		CustomSection& customSection
+			= *module.customSections.insert(module.customSections.end(), CustomSection());
+		customSection.afterSection
+			= getMaxPresentSection(module, moduleState.lastKnownOrderedSectionID);
+		serialize(moduleStream, customSection);
+		break;
+	}
+	default: throw FatalSerializationException("unknown section ID");
+	};
+}
+
+// Checks that the sections that were deserialized form a complete module.
+static void checkModuleSections(const Module& module, const ModuleSerializationState& moduleState)
+{
+	if(module.functions.defs.size() && !moduleState.hadFunctionDefinitions)
+	{
+		throw FatalSerializationException(
+			"module contained function declarations, but no corresponding "
+			"function definition section");
+	}
+
+	if(module.dataSegments.size() && !moduleState.hadDataSection)
+	{
+		throw FatalSerializationException(
+			"module contained DataCount section with non-zero segment count, but no corresponding "
+			"Data section");
+	}
+}
+
+static void serializeModule(InputStream& moduleStream,
+							Module& module,
+							const std::shared_ptr<const void>& inputBytesOwner,
+							bool validateFunctionBodies = true)
 {
 	serializeConstant(moduleStream, "magic number", U32(magicNumber));
 	serializeConstant(moduleStream, "version", U32(currentVersion));
 
 	ModuleSerializationState moduleState(module);
 	moduleState.validationState = IR::createModuleValidationState(module);
+	moduleState.inputBytesOwner = inputBytesOwner;
+	moduleState.validateFunctionBodies = validateFunctionBodies;
 
-	OrderedSectionID lastKnownOrderedSectionID = OrderedSectionID::moduleBeginning;
-	bool hadFunctionDefinitions = false;
-	bool hadDataSection = false;
 	while(moduleStream.capacity())
 	{
 		SectionID sectionID;
 		serialize(moduleStream, sectionID);
+		checkSectionOrder(sectionID, moduleState);
+		deserializeSection(moduleStream, sectionID, module, moduleState);
+	};
 
-		if(sectionID != SectionID::custom)
+	checkModuleSections(module, moduleState);
+}
+
+namespace {
+	// An output stream that writes to a sink through a fixed size buffer.
+	struct SinkOutputStream : OutputStream
+	{
+		SinkOutputStream(const WASM::SaveSink& inSink) : sink(inSink), buffer(bufferNumBytes)
 		{
-			OrderedSectionID orderedSectionID;
-			switch(sectionID)
-			{
-			case SectionID::type: orderedSectionID = OrderedSectionID::type; break;
-			case SectionID::import: orderedSectionID = OrderedSectionID::import; break;
-			case SectionID::function: orderedSectionID = OrderedSectionID::function; break;
-			case SectionID::table: orderedSectionID = OrderedSectionID::table; break;
-			case SectionID::memory: orderedSectionID = OrderedSectionID::memory; break;
-			case SectionID::global: orderedSectionID = OrderedSectionID::global; break;
-			case SectionID::export_: orderedSectionID = OrderedSectionID::export_; break;
-			case SectionID::start: orderedSectionID = OrderedSectionID::start; break;
-			case SectionID::elem: orderedSectionID = OrderedSectionID::elem; break;
-			case SectionID::code: orderedSectionID = OrderedSectionID::code; break;
-			case SectionID::data: orderedSectionID = OrderedSectionID::data; break;
-			case SectionID::dataCount: orderedSectionID = OrderedSectionID::dataCount; break;
-			case SectionID::exceptionType:
-				orderedSectionID = OrderedSectionID::exceptionType;
-				break;
+			next = buffer.data();
+			end = buffer.data() + buffer.size();
+		}
 
-			case SectionID::custom: WAVM_UNREACHABLE();
-			default:
-				throw FatalSerializationException("unknown section ID ("
-												  + std::to_string(U8(sectionID)));
-			};
+		// Writes the buffered bytes to the sink.
+		void flush()
+		{
+			if(next != buffer.data()) { sink(buffer.data(), Uptr(next - buffer.data())); }
+			next = buffer.data();
+		}
 
-			if(orderedSectionID > lastKnownOrderedSectionID)
-			{ lastKnownOrderedSectionID = orderedSectionID; }
-			else
-			{
-				throw FatalSerializationException("incorrect order for known section");
-			}
+		virtual void writeBytes(const U8* bytes, Uptr numBytes) override
+		{
+			flush();
+			sink(bytes, numBytes);
 		}
 
-		switch(sectionID)
+	private:
+		static constexpr Uptr bufferNumBytes = 1024 * 1024;
+
+		const WASM::SaveSink& sink;
+		std::vector<U8> buffer;
+
+		virtual void extendBuffer(Uptr numBytes) override
 		{
-		case SectionID::type:
-			serializeTypeSection(moduleStream, module);
-			IR::validateTypes(*moduleState.validationState);
-			break;
-		case SectionID::import:
-			serializeImportSection(moduleStream, module);
-			IR::validateImports(*moduleState.validationState);
-			break;
-		case SectionID::function:
-			serializeFunctionSection(moduleStream, module);
-			IR::validateFunctionDeclarations(*moduleState.validationState);
-			break;
-		case SectionID::table:
-			serializeTableSection(moduleStream, module);
-			IR::validateTableDefs(*moduleState.validationState);
-			break;
-		case SectionID::memory:
-			serializeMemorySection(moduleStream, module);
-			IR::validateMemoryDefs(*moduleState.validationState);
-			break;
-		case SectionID::global:
-			serializeGlobalSection(moduleStream, module);
-			IR::validateGlobalDefs(*moduleState.validationState);
-			break;
-		case SectionID::exceptionType:
-			serializeExceptionTypeSection(moduleStream, module);
-			IR::validateExceptionTypeDefs(*moduleState.validationState);
-			break;
-		case SectionID::export_:
-			serializeExportSection(moduleStream, module);
-			IR::validateExports(*moduleState.validationState);
-			break;
-		case SectionID::start:
-			serializeStartSection(moduleStream, module);
-			IR::validateStartFunction(*moduleState.validationState);
-			break;
-		case SectionID::elem:
-			serializeElementSection(moduleStream, module);
-			IR::validateElemSegments(*moduleState.validationState);
-			break;
-		case SectionID::dataCount:
-			serializeDataCountSection(moduleStream, module);
-			moduleState.hadDataCountSection = true;
-			break;
-		case SectionID::code:
-			serializeCodeSection(moduleStream, module, moduleState);
-			hadFunctionDefinitions = true;
-			break;
-		case SectionID::data:
-			serializeDataSection(moduleStream, module, moduleState.hadDataCountSection);
-			hadDataSection = true;
-			IR::validateDataSegments(*moduleState.validationState);
-			break;
-		case SectionID::custom: {
-			CustomSection& customSection
-				= *module.customSections.insert(module.customSections.end(), CustomSection());
-			customSection.afterSection = getMaxPresentSection(module, lastKnownOrderedSectionID);
-			serialize(moduleStream, customSection);
-			break;
+			flush();
+			if(numBytes > buffer.size()) { buffer.resize(numBytes); }
+			next = buffer.data();
+			end = buffer.data() + buffer.size();
 		}
-		default: throw FatalSerializationException("unknown section ID");
-		};
 	};
+}
 
-	if(module.functions.defs.size() && !hadFunctionDefinitions)
+void WASM::saveBinaryModule(const Module& module, const SaveSink& sink)
+{
+	try
 	{
-		throw FatalSerializationException(
-			"module contained function declarations, but no corresponding "
-			"function definition section");
+		SinkOutputStream stream(sink);
+		serializeModule(stream, const_cast<Module&>(module));
+		stream.flush();
 	}
-
-	if(module.dataSegments.size() && !hadDataSection)
+	catch(Serialization::FatalSerializationException const& exception)
 	{
-		throw FatalSerializationException(
-			"module contained DataCount section with non-zero segment count, but no corresponding "
-			"Data section");
+		Errors::fatalf("Failed to save WASM module: %s", exception.message.c_str());
 	}
 }
 
+void WASM::appendCustomSection(std::vector<U8>& wasmBytes,
+							   const std::string& name,
+							   const std::vector<U8>& data)
+{
+	// Custom sections may occur anywhere in a module, so appending one doesn't change the meaning
+	// of the rest of the module.
+	std::string nameCopy = name;
+	ArrayOutputStream nameStream;
+	serialize(nameStream, nameCopy);
+	const std::vector<U8> nameBytes = nameStream.getBytes();
+
+	ArrayOutputStream headerStream;
+	serialize(headerStream, SectionID::custom);
+	Uptr sectionNumBytes = nameBytes.size() + data.size();
+	serializeVarUInt32(headerStream, sectionNumBytes);
+	const std::vector<U8> headerBytes = headerStream.getBytes();
+
+	wasmBytes.reserve(wasmBytes.size() + headerBytes.size() + nameBytes.size() + data.size());
+	wasmBytes.insert(wasmBytes.end(), headerBytes.begin(), headerBytes.end());
+	wasmBytes.insert(wasmBytes.end(), nameBytes.begin(), nameBytes.end());
+	wasmBytes.insert(wasmBytes.end(), data.begin(), data.end());
+}
+
 std::vector<U8> WASM::saveBinaryModule(const Module& module)
 {
 	try
@@ -1653,27 +2092,20 @@ std::vector<U8> WASM::saveBinaryModule(const Module& module)
 	}
 }
 
-bool WASM::loadBinaryModule(const U8* wasmBytes,
-							Uptr numWASMBytes,
-							IR::Module& outModule,
-							LoadError* outError)
+// Calls a thunk that loads a module, and translates the exceptions thrown for a malformed or
+// invalid module to a LoadError.
+template<typename Thunk> static bool catchLoadErrors(WASM::LoadError* outError, Thunk&& thunk)
 {
-	// Load the module from a binary WebAssembly file.
 	try
 	{
-		Timing::Timer loadTimer;
-		MemoryInputStream stream(wasmBytes, numWASMBytes);
-
-		serializeModule(stream, outModule);
-
-		Timing::logRatePerSecond("Loaded WASM", loadTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
+		thunk();
 		return true;
 	}
 	catch(Serialization::FatalSerializationException const& exception)
 	{
 		if(outError)
 		{
-			outError->type = LoadError::Type::malformed;
+			outError->type = WASM::LoadError::Type::malformed;
 			outError->message = "Module was malformed: " + exception.message;
 		}
 		return false;
@@ -1682,7 +2114,7 @@ bool WASM::loadBinaryModule(const U8* wasmBytes,
 	{
 		if(outError)
 		{
-			outError->type = LoadError::Type::invalid;
+			outError->type = WASM::LoadError::Type::invalid;
 			outError->message = "Module was invalid: " + exception.message;
 		}
 		return false;
@@ -1691,9 +2123,265 @@ bool WASM::loadBinaryModule(const U8* wasmBytes,
 	{
 		if(outError)
 		{
-			outError->type = LoadError::Type::malformed;
+			outError->type = WASM::LoadError::Type::malformed;
 			outError->message = "Memory allocation failed: input is likely malformed";
 		}
 		return false;
 	}
 }
+
+bool WASM::loadBinaryModule(const U8* wasmBytes,
+							Uptr numWASMBytes,
+							IR::Module& outModule,
+							LoadError* outError)
+{
+	return loadBinaryModule(wasmBytes, numWASMBytes, nullptr, outModule, outError);
+}
+
+bool WASM::loadBinaryModule(const U8* wasmBytes,
+							Uptr numWASMBytes,
+							const std::shared_ptr<const void>& wasmBytesOwner,
+							IR::Module& outModule,
+							LoadError* outError)
+{
+	// Load the module from a binary WebAssembly file.
+	return catchLoadErrors(outError, [&] {
+		Trace::Scope traceScope("wasm", "load and validate");
+		Timing::Timer loadTimer;
+		MemoryInputStream stream(wasmBytes, numWASMBytes);
+
+		serializeModule(stream, outModule, wasmBytesOwner);
+
+		Timing::logRatePerSecond("Loaded WASM", loadTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
+	});
+}
+
+bool WASM::loadBinaryModuleWithoutValidatingCode(const U8* wasmBytes,
+												 Uptr numWASMBytes,
+												 IR::Module& outModule,
+												 LoadError* outError)
+{
+	return catchLoadErrors(outError, [&] {
+		Trace::Scope traceScope("wasm", "load");
+		Timing::Timer loadTimer;
+		MemoryInputStream stream(wasmBytes, numWASMBytes);
+
+		serializeModule(stream, outModule, nullptr, false);
+
+		Timing::logRatePerSecond("Loaded WASM", loadTimer, numWASMBytes / 1024.0 / 1024.0, "MiB");
+	});
+}
+
+struct WASM::StreamingModuleLoader
+{
+	IR::Module module;
+	ModuleSerializationState moduleState;
+
+	// The bytes that have been received, but not decoded yet.
+	std::vector<U8> bufferedBytes;
+
+	bool hasHeader = false;
+
+	// The state of a code section that has been partially received: its function bodies are
+	// decoded as they are received instead of when the whole section has been received.
+	bool isInCodeSection = false;
+	Uptr numRemainingCodeSectionBytes = 0;
+	Uptr numDecodedFunctionBodies = 0;
+	ArrayOutputStream irCodeByteStream;
+
+	bool hasFailed = false;
+	WASM::LoadError error;
+
+	StreamingModuleLoader(const FeatureSpec& featureSpec)
+	: module(featureSpec), moduleState(module)
+	{
+		moduleState.validationState = IR::createModuleValidationState(module);
+	}
+};
+
+// The maximum number of bytes in a LEB128 encoding of a U32.
+static constexpr Uptr maxVarUInt32Bytes = 5;
+
+// Returns true if the bytes contain a complete LEB128 encoded U32, or enough bytes to determine
+// that they don't start with a valid encoding.
+static bool hasVarUInt32(const U8* bytes, Uptr numBytes)
+{
+	for(Uptr byteIndex = 0; byteIndex < numBytes && byteIndex < maxVarUInt32Bytes; ++byteIndex)
+	{
+		if(!(bytes[byteIndex] & 0x80)) { return true; }
+	}
+	return numBytes >= maxVarUInt32Bytes;
+}
+
+// Decodes as many function bodies of a partially received code section as have been received.
+// Returns the number of bytes that were decoded.
+static Uptr decodeStreamingFunctionBodies(WASM::StreamingModuleLoader& loader,
+										  const U8* bytes,
+										  Uptr numBytes)
+{
+	Uptr numDecodedBytes = 0;
+	while(loader.numDecodedFunctionBodies < loader.module.functions.defs.size())
+	{
+		// Wait until the whole function body has been received.
+		const U8* bodyBytes = bytes + numDecodedBytes;
+		const Uptr numBufferedBodyBytes
+			= std::min(numBytes - numDecodedBytes, loader.numRemainingCodeSectionBytes);
+		if(!hasVarUInt32(bodyBytes, numBufferedBodyBytes))
+		{
+			if(numBufferedBodyBytes == loader.numRemainingCodeSectionBytes)
+			{ throw FatalSerializationException("expected data but found end of stream"); }
+			break;
+		}
+		MemoryInputStream sizeStream(bodyBytes, numBufferedBodyBytes);
+		Uptr numBodyBytes = 0;
+		serializeVarUInt32(sizeStream, numBodyBytes);
+		const Uptr numBodyAndSizeBytes = numBodyBytes + numBufferedBodyBytes - sizeStream.capacity();
+		if(numBodyAndSizeBytes > loader.numRemainingCodeSectionBytes)
+		{ throw FatalSerializationException("expected data but found end of stream"); }
+		if(numBodyAndSizeBytes > numBufferedBodyBytes) { break; }
+
+		MemoryInputStream bodyStream(bodyBytes, numBodyAndSizeBytes);
+		serializeFunctionBody(bodyStream,
+							  loader.module,
+							  loader.module.functions.defs[loader.numDecodedFunctionBodies],
+							  loader.moduleState,
+							  loader.irCodeByteStream);
+		++loader.numDecodedFunctionBodies;
+		numDecodedBytes += numBodyAndSizeBytes;
+		loader.numRemainingCodeSectionBytes -= numBodyAndSizeBytes;
+	}
+
+	if(loader.numDecodedFunctionBodies == loader.module.functions.defs.size())
+	{
+		if(loader.numRemainingCodeSectionBytes)
+		{ throw FatalSerializationException("section contained more data than expected"); }
+		loader.isInCodeSection = false;
+		loader.moduleState.hadFunctionDefinitions = true;
+	}
+
+	return numDecodedBytes;
+}
+
+// Decodes as much of the buffered bytes as possible, and removes the decoded bytes from the buffer.
+static void decodeStreamingModuleBytes(WASM::StreamingModuleLoader& loader)
+{
+	const U8* bytes = loader.bufferedBytes.data();
+	const Uptr numBytes = loader.bufferedBytes.size();
+	Uptr numDecodedBytes = 0;
+
+	if(!loader.hasHeader)
+	{
+		if(numBytes < 8) { return; }
+		MemoryInputStream headerStream(bytes, 8);
+		serializeConstant(headerStream, "magic number", U32(magicNumber));
+		serializeConstant(headerStream, "version", U32(currentVersion));
+		loader.hasHeader = true;
+		numDecodedBytes = 8;
+	}
+
+	while(true)
+	{
+		if(loader.isInCodeSection)
+		{
+			numDecodedBytes += decodeStreamingFunctionBodies(
+				loader, bytes + numDecodedBytes, numBytes - numDecodedBytes);
+			if(loader.isInCodeSection) { break; }
+		}
+		if(numDecodedBytes == numBytes) { break; }
+
+		// Wait until the section ID and size have been received.
+		const U8* sectionBytes = bytes + numDecodedBytes;
+		const Uptr numBufferedSectionBytes = numBytes - numDecodedBytes;
+		if(!hasVarUInt32(sectionBytes + 1, numBufferedSectionBytes - 1)) { break; }
+		MemoryInputStream headerStream(sectionBytes, numBufferedSectionBytes);
+		SectionID sectionID;
+		serialize(headerStream, sectionID);
+		Uptr numSectionBytes = 0;
+		serializeVarUInt32(headerStream, numSectionBytes);
+		const Uptr numHeaderBytes = numBufferedSectionBytes - headerStream.capacity();
+
+		if(sectionID == SectionID::code)
+		{
+			// Wait until the number of function bodies has been received, and then decode the
+			// function bodies as they are received.
+			const Uptr numBufferedCountBytes
+				= std::min(numBufferedSectionBytes - numHeaderBytes, numSectionBytes);
+			if(!hasVarUInt32(sectionBytes + numHeaderBytes, numBufferedCountBytes))
+			{
+				if(numBufferedCountBytes == numSectionBytes)
+				{ throw FatalSerializationException("expected data but found end of stream"); }
+				break;
+			}
+			checkSectionOrder(sectionID, loader.moduleState);
+			MemoryInputStream countStream(sectionBytes + numHeaderBytes, numBufferedCountBytes);
+			Uptr numFunctionBodies = 0;
+			serializeVarUInt32(countStream, numFunctionBodies);
+			if(numFunctionBodies != loader.module.functions.defs.size())
+			{
+				throw FatalSerializationException(
+					"function and code sections have mismatched function counts");
+			}
+			const Uptr numCountBytes = numBufferedCountBytes - countStream.capacity();
+
+			loader.isInCodeSection = true;
+			loader.numRemainingCodeSectionBytes = numSectionBytes - numCountBytes;
+			numDecodedBytes += numHeaderBytes + numCountBytes;
+			continue;
+		}
+
+		// Wait until the whole section has been received, and then decode it.
+		if(numHeaderBytes + numSectionBytes > numBufferedSectionBytes) { break; }
+		MemoryInputStream sectionStream(sectionBytes + 1, numHeaderBytes - 1 + numSectionBytes);
+		checkSectionOrder(sectionID, loader.moduleState);
+		deserializeSection(sectionStream, sectionID, loader.module, loader.moduleState);
+		numDecodedBytes += numHeaderBytes + numSectionBytes;
+	}
+
+	loader.bufferedBytes.erase(loader.bufferedBytes.begin(),
+							   loader.bufferedBytes.begin() + numDecodedBytes);
+}
+
+std::shared_ptr<WASM::StreamingModuleLoader> WASM::createStreamingModuleLoader(
+	const FeatureSpec& featureSpec)
+{
+	return std::make_shared<StreamingModuleLoader>(featureSpec);
+}
+
+bool WASM::addStreamingModuleBytes(StreamingModuleLoader& loader,
+								   const U8* bytes,
+								   Uptr numBytes,
+								   LoadError* outError)
+{
+	if(!loader.hasFailed)
+	{
+		loader.bufferedBytes.insert(loader.bufferedBytes.end(), bytes, bytes + numBytes);
+		loader.hasFailed
+			= !catchLoadErrors(&loader.error, [&loader] { decodeStreamingModuleBytes(loader); });
+	}
+
+	if(loader.hasFailed && outError) { *outError = loader.error; }
+	return !loader.hasFailed;
+}
+
+bool WASM::finishStreamingModuleLoad(StreamingModuleLoader& loader,
+									 IR::Module& outModule,
+									 LoadError* outError)
+{
+	if(!loader.hasFailed)
+	{
+		loader.hasFailed = !catchLoadErrors(&loader.error, [&loader] {
+			if(!loader.hasHeader || loader.isInCodeSection || loader.bufferedBytes.size())
+			{ throw FatalSerializationException("expected data but found end of stream"); }
+			checkModuleSections(loader.module, loader.moduleState);
+		});
+	}
+
+	if(loader.hasFailed)
+	{
+		if(outError) { *outError = loader.error; }
+		return false;
+	}
+
+	outModule = std::move(loader.module);
+	return true;
+}
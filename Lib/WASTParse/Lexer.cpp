@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -12,9 +13,17 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/NFA/NFA.h"
+#include "WAVM/Platform/Intrinsic.h"
 #include "WAVM/RegExp/RegExp.h"
 #include "WAVM/WASTParse/WASTParse.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WAVM_LEXER_USE_SSE2 1
+#else
+#define WAVM_LEXER_USE_SSE2 0
+#endif
+
 #define DUMP_NFA_GRAPH 0
 #define DUMP_DFA_GRAPH 0
 
@@ -264,6 +273,65 @@ inline bool isRecoveryPointChar(char c)
 	};
 }
 
+// The characters that may follow a token without being part of it. Must match the characters in
+// createTokenSeparatorPeekState.
+inline bool isTokenSeparatorChar(char c)
+{
+	switch(c)
+	{
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+	case '=':
+	case '(':
+	case ')':
+	case ';':
+	case 0: return true;
+	default: return false;
+	};
+}
+
+// Returns a pointer to the first character in [nextChar, end) that isn't a space or tab, or end.
+static const char* skipSpacesAndTabs(const char* nextChar, const char* end)
+{
+#if WAVM_LEXER_USE_SSE2
+	const __m128i spaces = _mm_set1_epi8(' ');
+	const __m128i tabs = _mm_set1_epi8('\t');
+	while(end - nextChar >= 16)
+	{
+		const __m128i chars = _mm_loadu_si128((const __m128i*)nextChar);
+		const U32 blankMask = U32(_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(chars, spaces), _mm_cmpeq_epi8(chars, tabs))));
+		if(blankMask != 0xffff) { return nextChar + countTrailingZeroes(~blankMask); }
+		nextChar += 16;
+	};
+#endif
+	while(nextChar < end && (*nextChar == ' ' || *nextChar == '\t')) { ++nextChar; };
+	return nextChar;
+}
+
+// Returns a pointer to the first character in [nextChar, end) that is a, b, or c, or end.
+static const char* findFirstOf(const char* nextChar, const char* end, char a, char b, char c)
+{
+#if WAVM_LEXER_USE_SSE2
+	const __m128i as = _mm_set1_epi8(a);
+	const __m128i bs = _mm_set1_epi8(b);
+	const __m128i cs = _mm_set1_epi8(c);
+	while(end - nextChar >= 16)
+	{
+		const __m128i chars = _mm_loadu_si128((const __m128i*)nextChar);
+		const U32 matchMask = U32(_mm_movemask_epi8(
+			_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, as), _mm_cmpeq_epi8(chars, bs)),
+						 _mm_cmpeq_epi8(chars, cs))));
+		if(matchMask) { return nextChar + countTrailingZeroes(matchMask); }
+		nextChar += 16;
+	};
+#endif
+	while(nextChar < end && *nextChar != a && *nextChar != b && *nextChar != c) { ++nextChar; };
+	return nextChar;
+}
+
 Token* WAST::lex(const char* string,
 				 Uptr stringLength,
 				 LineInfo*& outLineInfo,
@@ -288,6 +356,7 @@ Token* WAST::lex(const char* string,
 	U32* nextLineStart = lineStarts;
 	*nextLineStart++ = 0;
 
+	const char* stringEnd = string + stringLength - 1;
 	const char* nextChar = string;
 	while(true)
 	{
@@ -301,18 +370,15 @@ Token* WAST::lex(const char* string,
 				if(nextChar[1] != ';') { goto doneSkippingWhitespace; }
 				else
 				{
-					nextChar += 2;
-					while(*nextChar)
+					const char* newline
+						= (const char*)memchr(nextChar + 2, '\n', stringEnd - (nextChar + 2));
+					if(!newline) { nextChar = stringEnd; }
+					else
 					{
-						if(*nextChar == '\n')
-						{
-							// Emit a line start for the newline.
-							*nextLineStart++ = U32(nextChar - string + 1);
-							++nextChar;
-							break;
-						}
-						++nextChar;
-					};
+						// Emit a line start for the newline.
+						*nextLineStart++ = U32(newline - string + 1);
+						nextChar = newline + 1;
+					}
 				}
 				break;
 			// Delimited (possibly multi-line) comments.
@@ -325,6 +391,8 @@ Token* WAST::lex(const char* string,
 					U32 commentDepth = 1;
 					while(commentDepth)
 					{
+						// Skip to the next character that might end or nest the comment.
+						nextChar = findFirstOf(nextChar, stringEnd, ';', '(', '\n');
 						if(nextChar[0] == ';' && nextChar[1] == ')')
 						{
 							--commentDepth;
@@ -335,7 +403,7 @@ Token* WAST::lex(const char* string,
 							++commentDepth;
 							nextChar += 2;
 						}
-						else if(nextChar == string + stringLength - 1)
+						else if(nextChar == stringEnd)
 						{
 							// Emit an unterminated comment token.
 							nextToken->type = t_unterminatedComment;
@@ -361,7 +429,7 @@ Token* WAST::lex(const char* string,
 				++nextChar;
 				break;
 			case ' ':
-			case '\t':
+			case '\t': nextChar = skipSpacesAndTabs(nextChar + 1, stringEnd); break;
 			case '\r':
 			case '\f': ++nextChar; break;
 			default: goto doneSkippingWhitespace;
@@ -369,9 +437,25 @@ Token* WAST::lex(const char* string,
 		}
 	doneSkippingWhitespace:
 
+		nextToken->begin = U32(nextChar - string);
+
+		// Scan strings without escape sequences without the DFA. The DFA is faster than a scalar
+		// scan for strings with dense escape sequences (e.g. binary data segments), so those, and
+		// strings that aren't followed by a token separator, fall through to the DFA.
+		if(*nextChar == '"')
+		{
+			const char* closingQuote = findFirstOf(nextChar + 1, stringEnd, '"', '\\', '\n');
+			if(*closingQuote == '"' && isTokenSeparatorChar(closingQuote[1]))
+			{
+				nextToken->type = t_string;
+				++nextToken;
+				nextChar = closingQuote + 1;
+				continue;
+			}
+		}
+
 		// Once we reach a non-whitespace, non-comment character, feed characters into the NFA
 		// until it reaches a terminal state.
-		nextToken->begin = U32(nextChar - string);
 		NFA::StateIndex terminalState = staticData.nfaMachine.feed(nextChar);
 		if(terminalState != NFA::unmatchedCharacterTerminal)
 		{
@@ -388,7 +472,6 @@ Token* WAST::lex(const char* string,
 				++nextToken;
 
 				// Advance until a recovery point or the end of the string.
-				const char* stringEnd = string + stringLength - 1;
 				while(nextChar < stringEnd && !isRecoveryPointChar(*nextChar)) { ++nextChar; }
 			}
 			else
@@ -22,6 +22,12 @@ namespace WAVM { namespace WAST {
 	{
 	};
 
+	// Thrown while parsing function bodies in parallel by a function body that needs to add a new
+	// type to the module. The function body is parsed again after the parallel parse.
+	struct DeferFunctionBodyException
+	{
+	};
+
 	// Like WAST::Error, but only has an offset in the input string instead of a full
 	// TextFileLocus.
 	struct UnresolvedError
@@ -158,8 +164,14 @@ namespace WAVM { namespace WAST {
 		// Thunks that are called after parsing all declarations.
 		std::vector<std::function<void(ModuleState*)>> postDeclarationCallbacks;
 
-		// Thunks that are called to parse function bodies.
-		std::vector<std::function<void(ModuleState*)>> functionBodyCallbacks;
+		// Thunks that are called to parse function bodies. Each body is parsed with its own
+		// ParseState, so the bodies may be parsed in parallel.
+		std::vector<std::function<void(ModuleState*, ParseState*)>> functionBodyCallbacks;
+
+		// True while function bodies are being parsed in parallel. The module must not be changed
+		// while this is true, so getUniqueFunctionTypeIndex throws DeferFunctionBodyException
+		// instead of adding a new type.
+		bool isParsingFunctionBodiesInParallel{false};
 
 		ModuleState(ParseState* inParseState, IR::Module& inModule)
 		: parseState(inParseState)
@@ -215,6 +227,7 @@ namespace WAVM { namespace WAST {
 		NameToIndexMap& outLocalNameToIndexMap,
 		std::vector<std::string>& outLocalDisassemblyNames);
 	IR::IndexedFunctionType resolveFunctionType(ModuleState* moduleState,
+												ParseState* parseState,
 												const UnresolvedFunctionType& unresolvedType);
 	IR::IndexedFunctionType getUniqueFunctionTypeIndex(ModuleState* moduleState,
 													   IR::FunctionType functionType);
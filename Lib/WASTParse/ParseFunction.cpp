@@ -28,11 +28,12 @@ namespace WAVM { namespace WAST {
 		const Token* validationErrorToken{nullptr};
 
 		ResumableCodeValidationProxyStream(ModuleState* moduleState,
+										   ParseState* inParseState,
 										   const FunctionDef& function,
 										   InnerStream& inInnerStream)
 		: codeValidationStream(*moduleState->validationState, function)
 		, innerStream(inInnerStream)
-		, parseState(moduleState->parseState)
+		, parseState(inParseState)
 		{
 		}
 
@@ -100,14 +101,15 @@ namespace WAVM { namespace WAST {
 
 		FunctionState(const std::shared_ptr<NameToIndexMap>& inLocalNameToIndexMap,
 					  FunctionDef& inFunctionDef,
-					  ModuleState* moduleState)
+					  ModuleState* moduleState,
+					  ParseState* parseState)
 		: functionDef(inFunctionDef)
 		, localNameToIndexMap(inLocalNameToIndexMap)
 		, numLocals(inFunctionDef.nonParameterLocalTypes.size()
 					+ moduleState->module.types[inFunctionDef.type.index].params().size())
 		, branchTargetDepth(0)
 		, operationEncoder(codeByteStream)
-		, validatingCodeStream(moduleState, inFunctionDef, operationEncoder)
+		, validatingCodeStream(moduleState, parseState, inFunctionDef, operationEncoder)
 		{
 		}
 	};
@@ -340,8 +342,12 @@ static void parseImm(CursorState* cursor, BranchTableImm& outImm)
 	{
 		outImm.defaultTargetDepth = targetDepths.back();
 		targetDepths.pop_back();
-		outImm.branchTableIndex = cursor->functionState->functionDef.branchTables.size();
-		cursor->functionState->functionDef.branchTables.push_back(std::move(targetDepths));
+		std::vector<U32>& branchTableTargetDepths
+			= cursor->functionState->functionDef.branchTableTargetDepths;
+		outImm.firstTargetDepthIndex = branchTableTargetDepths.size();
+		outImm.numTargetDepths = targetDepths.size();
+		branchTableTargetDepths.insert(
+			branchTableTargetDepths.end(), targetDepths.begin(), targetDepths.end());
 	}
 }
 
@@ -396,7 +402,9 @@ static void parseImm(CursorState* cursor, CallIndirectImm& outImm)
 	NameToIndexMap paramNameToIndexMap;
 	const UnresolvedFunctionType unresolvedFunctionType
 		= parseFunctionTypeRefAndOrDecl(cursor, paramNameToIndexMap, paramDisassemblyNames);
-	outImm.type.index = resolveFunctionType(cursor->moduleState, unresolvedFunctionType).index;
+	outImm.type.index
+		= resolveFunctionType(cursor->moduleState, cursor->parseState, unresolvedFunctionType)
+			  .index;
 
 	// Disallow named parameters.
 	if(paramNameToIndexMap.size())
@@ -699,7 +707,9 @@ static void parseControlImm(CursorState* cursor,
 			// If there was a type reference, resolve it. This also verifies that if there were also
 			// params and/or results declared inline that they match the resolved type reference.
 			const Uptr referencedFunctionTypeIndex
-				= resolveFunctionType(cursor->moduleState, unresolvedFunctionType).index;
+				= resolveFunctionType(
+					  cursor->moduleState, cursor->parseState, unresolvedFunctionType)
+					  .index;
 			if(referencedFunctionTypeIndex != UINTPTR_MAX)
 			{
 				WAVM_ASSERT(referencedFunctionTypeIndex < cursor->moduleState->module.types.size());
@@ -1052,7 +1062,7 @@ FunctionDef WAST::parseFunctionDef(CursorState* cursor, const Token* funcToken)
 														 ModuleState* moduleState) {
 		// Resolve the function type and set it on the FunctionDef.
 		const IndexedFunctionType functionTypeIndex
-			= resolveFunctionType(moduleState, unresolvedFunctionType);
+			= resolveFunctionType(moduleState, moduleState->parseState, unresolvedFunctionType);
 		moduleState->module.functions.defs[functionDefIndex].type = functionTypeIndex;
 
 		// Defer parsing the body of the function until all function types have been resolved.
@@ -1061,24 +1071,32 @@ FunctionDef WAST::parseFunctionDef(CursorState* cursor, const Token* funcToken)
 													  firstBodyToken,
 													  localNameToIndexMap,
 													  localDisassemblyNames,
-													  functionTypeIndex](ModuleState* moduleState) {
+													  functionTypeIndex](ModuleState* moduleState,
+																		 ParseState* parseState) {
 			FunctionDef& functionDef = moduleState->module.functions.defs[functionDefIndex];
 			FunctionType functionType = functionTypeIndex.index == UINTPTR_MAX
 											? FunctionType()
 											: moduleState->module.types[functionTypeIndex.index];
 
+			// The body may be parsed again if it was deferred from a parallel parse, so start from
+			// the parameters' names each time.
+			std::shared_ptr<NameToIndexMap> bodyLocalNameToIndexMap
+				= std::make_shared<NameToIndexMap>(*localNameToIndexMap);
+			std::vector<std::string> bodyLocalDisassemblyNames = *localDisassemblyNames;
+			functionDef.nonParameterLocalTypes.clear();
+
 			// Parse the function's local variables.
-			CursorState functionCursorState(firstBodyToken, moduleState->parseState, moduleState);
+			CursorState functionCursorState(firstBodyToken, parseState, moduleState);
 			while(tryParseParenthesizedTagged(&functionCursorState, t_local, [&] {
 				Name localName;
 				if(tryParseName(&functionCursorState, localName))
 				{
 					bindName(
-						moduleState->parseState,
-						*localNameToIndexMap,
+						parseState,
+						*bodyLocalNameToIndexMap,
 						localName,
 						functionType.params().size() + functionDef.nonParameterLocalTypes.size());
-					localDisassemblyNames->push_back(localName.getString());
+					bodyLocalDisassemblyNames.push_back(localName.getString());
 					functionDef.nonParameterLocalTypes.push_back(
 						parseValueType(&functionCursorState));
 				}
@@ -1086,7 +1104,7 @@ FunctionDef WAST::parseFunctionDef(CursorState* cursor, const Token* funcToken)
 				{
 					while(functionCursorState.nextToken->type != t_rightParenthesis)
 					{
-						localDisassemblyNames->push_back(std::string());
+						bodyLocalDisassemblyNames.push_back(std::string());
 						functionDef.nonParameterLocalTypes.push_back(
 							parseValueType(&functionCursorState));
 					};
@@ -1095,18 +1113,19 @@ FunctionDef WAST::parseFunctionDef(CursorState* cursor, const Token* funcToken)
 			{};
 
 			moduleState->disassemblyNames.functions[functionIndex].locals
-				= std::move(*localDisassemblyNames);
+				= std::move(bodyLocalDisassemblyNames);
 
 			// Parse the function's code.
 			const Token* validationErrorToken = firstBodyToken;
 			try
 			{
-				FunctionState functionState(localNameToIndexMap, functionDef, moduleState);
+				FunctionState functionState(
+					bodyLocalNameToIndexMap, functionDef, moduleState, parseState);
 				functionCursorState.functionState = &functionState;
 				try
 				{
 					parseInstrSequence(&functionCursorState, 0);
-					if(!moduleState->parseState->unresolvedErrors.size())
+					if(!parseState->unresolvedErrors.size())
 					{
 						validationErrorToken = functionCursorState.nextToken;
 						functionState.validatingCodeStream.end();
@@ -1125,7 +1144,7 @@ FunctionDef WAST::parseFunctionDef(CursorState* cursor, const Token* funcToken)
 			}
 			catch(ValidationException const& exception)
 			{
-				parseErrorf(moduleState->parseState,
+				parseErrorf(parseState,
 							validationErrorToken,
 							"validation error: %s",
 							exception.message.c_str());
@@ -1,5 +1,7 @@
 #include <inttypes.h>
 #include <stdint.h>
+#include <algorithm>
+#include <exception>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -19,6 +21,8 @@
 #include "WAVM/Inline/HashMap.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/WASTParse/WASTParse.h"
 
 using namespace WAVM;
@@ -329,8 +333,8 @@ static void parseImport(CursorState* cursor)
 			// Resolve the function import type after all type declarations have been parsed.
 			cursor->moduleState->postTypeCallbacks.push_back(
 				[unresolvedFunctionType, importIndex](ModuleState* moduleState) {
-					moduleState->module.functions.imports[importIndex].type
-						= resolveFunctionType(moduleState, unresolvedFunctionType);
+					moduleState->module.functions.imports[importIndex].type = resolveFunctionType(
+						moduleState, moduleState->parseState, unresolvedFunctionType);
 				});
 			break;
 		}
@@ -534,7 +538,7 @@ static void parseData(CursorState* cursor)
 		{isActive,
 		 UINTPTR_MAX,
 		 InitializerExpression(),
-		 std::make_shared<std::vector<U8>>(std::move(dataVector))});
+		 std::make_shared<DataSegmentBytes>(std::move(dataVector))});
 
 	if(segmentName)
 	{
@@ -933,8 +937,8 @@ static void parseFunc(CursorState* cursor)
 			const Uptr importIndex = cursor->moduleState->module.functions.imports.size();
 			cursor->moduleState->postTypeCallbacks.push_back(
 				[unresolvedFunctionType, importIndex](ModuleState* moduleState) {
-					moduleState->module.functions.imports[importIndex].type
-						= resolveFunctionType(moduleState, unresolvedFunctionType);
+					moduleState->module.functions.imports[importIndex].type = resolveFunctionType(
+						moduleState, moduleState->parseState, unresolvedFunctionType);
 				});
 			return IndexedFunctionType{UINTPTR_MAX};
 		},
@@ -1054,7 +1058,7 @@ static void parseMemory(CursorState* cursor)
 					 cursor->moduleState->module.memories.size(),
 					 indexType == IndexType::i32 ? InitializerExpression(I32(0))
 												 : InitializerExpression(I64(0)),
-					 std::make_shared<std::vector<U8>>(std::move(dataVector))});
+					 std::make_shared<DataSegmentBytes>(std::move(dataVector))});
 				cursor->moduleState->disassemblyNames.dataSegments.push_back(std::string());
 			}
 
@@ -1339,6 +1343,144 @@ template<typename Map> void dumpHashMapSpaceAnalysis(const Map& map, const char*
 	}
 }
 
+// Each function body parsing thread is given at least this many function bodies, so small modules
+// don't pay for the threads.
+static constexpr Uptr minFunctionBodiesPerParseThread = 256;
+
+// The number of function bodies that a parsing thread takes from the shared state at once.
+static constexpr Uptr numFunctionBodiesPerParseBatch = 16;
+
+namespace {
+	// The result of parsing a function body.
+	struct FunctionBodyParse
+	{
+		ParseState parseState;
+		std::exception_ptr exception;
+
+		// True if the body still needs to be parsed after the parallel parse.
+		bool isDeferred{true};
+
+		FunctionBodyParse(const ParseState* moduleParseState)
+		: parseState(moduleParseState->string, moduleParseState->lineInfo)
+		{
+		}
+	};
+
+	struct ParallelFunctionBodyParseState
+	{
+		ModuleState& moduleState;
+		std::vector<FunctionBodyParse>& bodyParses;
+
+		Platform::Mutex mutex;
+		Uptr nextBodyIndex = 0;
+
+		ParallelFunctionBodyParseState(ModuleState& inModuleState,
+									   std::vector<FunctionBodyParse>& inBodyParses)
+		: moduleState(inModuleState), bodyParses(inBodyParses)
+		{
+		}
+	};
+}
+
+static void parseFunctionBody(ModuleState& moduleState,
+							  Uptr bodyIndex,
+							  FunctionBodyParse& bodyParse)
+{
+	bodyParse.isDeferred = false;
+	try
+	{
+		moduleState.functionBodyCallbacks[bodyIndex](&moduleState, &bodyParse.parseState);
+	}
+	catch(DeferFunctionBodyException const&)
+	{
+		bodyParse.isDeferred = true;
+	}
+	catch(...)
+	{
+		bodyParse.exception = std::current_exception();
+	}
+}
+
+static I64 parallelFunctionBodyParseThreadMain(void* sharedStateVoid)
+{
+	ParallelFunctionBodyParseState& state = *(ParallelFunctionBodyParseState*)sharedStateVoid;
+	while(true)
+	{
+		// Take the next batch of function bodies.
+		Uptr beginIndex;
+		Uptr endIndex;
+		{
+			Platform::Mutex::Lock lock(state.mutex);
+			beginIndex = state.nextBodyIndex;
+			endIndex
+				= std::min(beginIndex + numFunctionBodiesPerParseBatch, state.bodyParses.size());
+			if(beginIndex >= endIndex) { break; }
+			state.nextBodyIndex = endIndex;
+		}
+
+		for(Uptr bodyIndex = beginIndex; bodyIndex < endIndex; ++bodyIndex)
+		{ parseFunctionBody(state.moduleState, bodyIndex, state.bodyParses[bodyIndex]); }
+	}
+	return 0;
+}
+
+// Parses the function bodies, each with its own ParseState. If there are enough bodies, they are
+// parsed in parallel on the calling thread and one additional thread for each hardware thread. The
+// errors are added to parseState in the order of the bodies, so they don't depend on how the bodies
+// were divided between the threads.
+static void parseFunctionBodies(ModuleState& moduleState, ParseState* parseState)
+{
+	const Uptr numBodies = moduleState.functionBodyCallbacks.size();
+	std::vector<FunctionBodyParse> bodyParses;
+	bodyParses.reserve(numBodies);
+	for(Uptr bodyIndex = 0; bodyIndex < numBodies; ++bodyIndex)
+	{ bodyParses.emplace_back(parseState); }
+
+	const Uptr numThreads
+		= std::max(Uptr(1),
+				   std::min(Platform::getNumberOfHardwareThreads(),
+							numBodies / minFunctionBodiesPerParseThread));
+	if(numThreads > 1)
+	{
+		moduleState.isParsingFunctionBodiesInParallel = true;
+		ParallelFunctionBodyParseState parallelState(moduleState, bodyParses);
+		std::vector<Platform::Thread*> threads;
+		for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+		{
+			// Parsing recurses for each nested instruction, so give the threads enough stack for
+			// the maximum syntax recursion depth.
+			threads.push_back(Platform::createThread(
+				8 * 1024 * 1024, parallelFunctionBodyParseThreadMain, &parallelState));
+		}
+		parallelFunctionBodyParseThreadMain(&parallelState);
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+		moduleState.isParsingFunctionBodiesInParallel = false;
+	}
+
+	// Parse the bodies that weren't parsed in parallel in order, so any types they add to the
+	// module are added in the same order as a serial parse would add them.
+	for(Uptr bodyIndex = 0; bodyIndex < numBodies; ++bodyIndex)
+	{
+		if(bodyParses[bodyIndex].isDeferred)
+		{
+			bodyParses[bodyIndex] = FunctionBodyParse(parseState);
+			parseFunctionBody(moduleState, bodyIndex, bodyParses[bodyIndex]);
+			WAVM_ASSERT(!bodyParses[bodyIndex].isDeferred);
+		}
+	}
+
+	// Merge the errors and quoted name strings from each body into parseState. If parsing a body
+	// threw an exception, rethrow it after merging the errors from the bodies before it.
+	for(FunctionBodyParse& bodyParse : bodyParses)
+	{
+		for(UnresolvedError& error : bodyParse.parseState.unresolvedErrors)
+		{ parseState->unresolvedErrors.push_back(std::move(error)); }
+		for(std::unique_ptr<std::string>& quotedNameString : bodyParse.parseState.quotedNameStrings)
+		{ parseState->quotedNameStrings.push_back(std::move(quotedNameString)); }
+		if(bodyParse.exception) { std::rethrow_exception(bodyParse.exception); }
+	}
+}
+
 void WAST::parseModuleBody(CursorState* cursor, IR::Module& outModule)
 {
 	try
@@ -1384,10 +1526,7 @@ void WAST::parseModuleBody(CursorState* cursor, IR::Module& outModule)
 
 		// Process the function body parsing callbacks.
 		if(!cursor->parseState->unresolvedErrors.size())
-		{
-			for(const auto& callback : cursor->moduleState->functionBodyCallbacks)
-			{ callback(&moduleState); }
-		}
+		{ parseFunctionBodies(moduleState, cursor->parseState); }
 
 		// After function bodies have been parsed, validate the parts of the module that correspond
 		// to post-code sections in binary modules.
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <memory>
 #include <string>
 #include <utility>
@@ -17,6 +19,8 @@
 #include "WAVM/Inline/IsNameChar.h"
 #include "WAVM/Inline/LEB128.h"
 #include "WAVM/Inline/Serialization.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/WASTPrint/WASTPrint.h"
 
 using namespace WAVM;
@@ -101,44 +105,47 @@ static bool hasNonNameChars(const std::string& name)
 	return false;
 }
 
-static std::string expandIndentation(std::string&& inString, U8 spacesPerIndentLevel = 2)
+// Replaces INDENT_STRING and DEDENT_STRING with a proportional number of spaces following each
+// newline. The indentation depth is kept between calls, so the text can be expanded in chunks.
+struct IndentationExpander
 {
-	std::string paddedInput = std::move(inString);
-	paddedInput += '\0';
+	Uptr indentDepth;
 
-	std::string result;
-	result.reserve(paddedInput.size() * 2);
-	const char* next = paddedInput.data();
-	const char* end = paddedInput.data() + paddedInput.size() - 1;
-	Uptr indentDepth = 0;
-	while(next < end)
-	{
-		// Absorb INDENT_STRING and DEDENT_STRING, but keep track of the indentation depth, and
-		// insert a proportional number of spaces following newlines.
-		if(next[0] == INDENT_STRING[0] && next[1] == INDENT_STRING[1])
-		{
-			++indentDepth;
-			next += 2;
-		}
-		else if(next[0] == DEDENT_STRING[0] && next[1] == DEDENT_STRING[1])
-		{
-			WAVM_ERROR_UNLESS(indentDepth > 0);
-			--indentDepth;
-			next += 2;
-		}
-		else if(*next == '\n')
-		{
-			result += '\n';
-			result.insert(result.end(), indentDepth * spacesPerIndentLevel, ' ');
-			++next;
-		}
-		else
+	IndentationExpander(Uptr inIndentDepth = 0) : indentDepth(inIndentDepth) {}
+
+	void expand(const std::string& string, std::string& outString, U8 spacesPerIndentLevel = 2)
+	{
+		outString.reserve(outString.size() + string.size() * 2);
+		const char* next = string.data();
+		const char* end = string.data() + string.size();
+		while(next < end)
 		{
-			result += *next++;
+			// Absorb INDENT_STRING and DEDENT_STRING, but keep track of the indentation depth, and
+			// insert a proportional number of spaces following newlines.
+			if(next + 1 < end && next[0] == INDENT_STRING[0] && next[1] == INDENT_STRING[1])
+			{
+				++indentDepth;
+				next += 2;
+			}
+			else if(next + 1 < end && next[0] == DEDENT_STRING[0] && next[1] == DEDENT_STRING[1])
+			{
+				WAVM_ERROR_UNLESS(indentDepth > 0);
+				--indentDepth;
+				next += 2;
+			}
+			else if(*next == '\n')
+			{
+				outString += '\n';
+				outString.insert(outString.end(), indentDepth * spacesPerIndentLevel, ' ');
+				++next;
+			}
+			else
+			{
+				outString += *next++;
+			}
 		}
 	}
-	return result;
-}
+};
 
 struct ScopedTagPrinter
 {
@@ -325,15 +332,27 @@ private:
 	HashMap<std::string, Uptr> nameToUniqueIndexMap;
 };
 
+static constexpr Uptr flushThresholdChars = 1024 * 1024;
+
+// When printing functions in parallel, each thread prints this many functions in a batch before
+// the batch's text is written to the sink.
+static constexpr Uptr numFunctionsPerThreadPerBatch = 64;
+
 struct ModulePrintContext
 {
 	const Module& module;
-	std::string& string;
+	const WAST::PrintSink& sink;
+	const Uptr numThreads;
+
+	// The text that has been printed, but not yet expanded and written to the sink.
+	std::string string;
+	IndentationExpander indentationExpander;
+	std::string expandedString;
 
 	DisassemblyNames names;
 
-	ModulePrintContext(const Module& inModule, std::string& inString)
-	: module(inModule), string(inString)
+	ModulePrintContext(const Module& inModule, const WAST::PrintSink& inSink, Uptr inNumThreads)
+	: module(inModule), sink(inSink), numThreads(inNumThreads)
 	{
 		// Start with the names from the module's user name section, but make sure they are unique,
 		// and add the "$" sigil.
@@ -360,10 +379,29 @@ struct ModulePrintContext
 
 	void printModule();
 
+	void printFunction(Uptr functionDefIndex, std::string& functionString);
+	void printFunctions();
+
 	void printCustomSectionsAfterKnownSection(OrderedSectionID sectionID);
 
 	void printLinkingSection(const IR::CustomSection& linkingSection);
 
+	// Expands the printed text and writes it to the sink.
+	void flush()
+	{
+		expandedString.clear();
+		indentationExpander.expand(string, expandedString);
+		string.clear();
+		if(expandedString.size()) { sink(expandedString.data(), expandedString.size()); }
+	}
+
+	// Writes the printed text to the sink if it's large enough to be worth the call, which bounds
+	// the size of the text that is kept in memory.
+	void flushIfLarge()
+	{
+		if(string.size() >= flushThresholdChars) { flush(); }
+	}
+
 	void printInitializerExpression(const InitializerExpression& expression)
 	{
 		switch(expression.type)
@@ -416,12 +454,14 @@ struct FunctionPrintContext
 	NameScope labelNameScope;
 	Uptr labelIndex;
 
-	FunctionPrintContext(ModulePrintContext& inModuleContext, Uptr functionDefIndex)
+	FunctionPrintContext(ModulePrintContext& inModuleContext,
+						 Uptr functionDefIndex,
+						 std::string& inString)
 	: moduleContext(inModuleContext)
 	, module(inModuleContext.module)
 	, functionDef(inModuleContext.module.functions.defs[functionDefIndex])
 	, functionType(inModuleContext.module.types[functionDef.type.index])
-	, string(inModuleContext.string)
+	, string(inString)
 	, labelNames(inModuleContext.names.functions[module.functions.imports.size() + functionDefIndex]
 					 .labels)
 	, localNames(inModuleContext.names.functions[module.functions.imports.size() + functionDefIndex]
@@ -486,9 +526,11 @@ struct FunctionPrintContext
 	{
 		string += "\nbr_table" INDENT_STRING;
 		static constexpr Uptr numTargetsPerLine = 16;
-		WAVM_ASSERT(imm.branchTableIndex < functionDef.branchTables.size());
-		const std::vector<Uptr>& targetDepths = functionDef.branchTables[imm.branchTableIndex];
-		for(Uptr targetIndex = 0; targetIndex < targetDepths.size(); ++targetIndex)
+		WAVM_ASSERT(imm.firstTargetDepthIndex + imm.numTargetDepths
+					<= functionDef.branchTableTargetDepths.size());
+		const U32* targetDepths
+			= functionDef.branchTableTargetDepths.data() + imm.firstTargetDepthIndex;
+		for(Uptr targetIndex = 0; targetIndex < imm.numTargetDepths; ++targetIndex)
 		{
 			if(targetIndex % numTargetsPerLine == 0) { string += '\n'; }
 			else
@@ -592,6 +634,17 @@ struct FunctionPrintContext
 		string += "\ncall_indirect " + moduleContext.names.tables[imm.tableIndex];
 		string += " (type " + moduleContext.names.types[imm.type.index] + ')';
 	}
+	void return_call(FunctionImm imm)
+	{
+		string += "\nreturn_call " + moduleContext.names.functions[imm.functionIndex].name;
+		enterUnreachable();
+	}
+	void return_call_indirect(CallIndirectImm imm)
+	{
+		string += "\nreturn_call_indirect " + moduleContext.names.tables[imm.tableIndex];
+		string += " (type " + moduleContext.names.types[imm.type.index] + ')';
+		enterUnreachable();
+	}
 
 	void printControlSignature(IndexedBlockType indexedSignature)
 	{
@@ -1147,66 +1200,7 @@ void ModulePrintContext::printModule()
 	printCustomSectionsAfterKnownSection(OrderedSectionID::dataCount);
 
 	// Print the function definitions.
-	for(Uptr functionDefIndex = 0; functionDefIndex < module.functions.defs.size();
-		++functionDefIndex)
-	{
-		const Uptr functionIndex = module.functions.imports.size() + functionDefIndex;
-		const FunctionDef& functionDef = module.functions.defs[functionDefIndex];
-		FunctionType functionType = module.types[functionDef.type.index];
-		FunctionPrintContext functionContext(*this, functionDefIndex);
-
-		string += "\n\n";
-		ScopedTagPrinter funcTag(string, "func");
-
-		string += ' ';
-		string += names.functions[functionIndex].name;
-
-		// Print the function's type.
-		string += " (type ";
-		string += names.types[functionDef.type.index];
-		string += ')';
-
-		// Print the function parameters.
-		if(functionType.params().size())
-		{
-			for(Uptr parameterIndex = 0; parameterIndex < functionType.params().size();
-				++parameterIndex)
-			{
-				string += '\n';
-				ScopedTagPrinter paramTag(string, "param");
-				string += ' ';
-				string += functionContext.localNames[parameterIndex];
-				string += ' ';
-				print(string, functionType.params()[parameterIndex]);
-			}
-		}
-
-		// Print the function return type.
-		if(functionType.results().size())
-		{
-			string += '\n';
-			ScopedTagPrinter resultTag(string, "result");
-			for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
-			{
-				string += ' ';
-				print(string, functionType.results()[resultIndex]);
-			}
-		}
-
-		// Print the function's locals.
-		for(Uptr localIndex = 0; localIndex < functionDef.nonParameterLocalTypes.size();
-			++localIndex)
-		{
-			string += '\n';
-			ScopedTagPrinter localTag(string, "local");
-			string += ' ';
-			string += functionContext.localNames[functionType.params().size() + localIndex];
-			string += ' ';
-			print(string, functionDef.nonParameterLocalTypes[localIndex]);
-		}
-
-		functionContext.printFunctionBody();
-	}
+	printFunctions();
 
 	printCustomSectionsAfterKnownSection(OrderedSectionID::code);
 
@@ -1239,10 +1233,172 @@ void ModulePrintContext::printModule()
 				std::min(Uptr(dataSegment.data->size()) - offset, Uptr(numBytesPerLine)));
 			string += "\"";
 		}
+		flushIfLarge();
 	}
 	printCustomSectionsAfterKnownSection(OrderedSectionID::data);
 }
 
+void ModulePrintContext::printFunction(Uptr functionDefIndex, std::string& functionString)
+{
+	const Uptr functionIndex = module.functions.imports.size() + functionDefIndex;
+	const FunctionDef& functionDef = module.functions.defs[functionDefIndex];
+	FunctionType functionType = module.types[functionDef.type.index];
+	FunctionPrintContext functionContext(*this, functionDefIndex, functionString);
+
+	functionString += "\n\n";
+	ScopedTagPrinter funcTag(functionString, "func");
+
+	functionString += ' ';
+	functionString += names.functions[functionIndex].name;
+
+	// Print the function's type.
+	functionString += " (type ";
+	functionString += names.types[functionDef.type.index];
+	functionString += ')';
+
+	// Print the function parameters.
+	if(functionType.params().size())
+	{
+		for(Uptr parameterIndex = 0; parameterIndex < functionType.params().size();
+			++parameterIndex)
+		{
+			functionString += '\n';
+			ScopedTagPrinter paramTag(functionString, "param");
+			functionString += ' ';
+			functionString += functionContext.localNames[parameterIndex];
+			functionString += ' ';
+			print(functionString, functionType.params()[parameterIndex]);
+		}
+	}
+
+	// Print the function return type.
+	if(functionType.results().size())
+	{
+		functionString += '\n';
+		ScopedTagPrinter resultTag(functionString, "result");
+		for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
+		{
+			functionString += ' ';
+			print(functionString, functionType.results()[resultIndex]);
+		}
+	}
+
+	// Print the function's locals.
+	for(Uptr localIndex = 0; localIndex < functionDef.nonParameterLocalTypes.size();
+		++localIndex)
+	{
+		functionString += '\n';
+		ScopedTagPrinter localTag(functionString, "local");
+		functionString += ' ';
+		functionString += functionContext.localNames[functionType.params().size() + localIndex];
+		functionString += ' ';
+		print(functionString, functionDef.nonParameterLocalTypes[localIndex]);
+	}
+
+	functionContext.printFunctionBody();
+}
+
+namespace {
+	struct ParallelFunctionPrintState
+	{
+		ModulePrintContext& moduleContext;
+		Uptr indentDepth;
+
+		// The functions in the current batch, and the expanded text of each.
+		Uptr batchBeginIndex = 0;
+		std::vector<std::string> functionStrings;
+		std::atomic<Uptr> nextFunctionDefIndex{0};
+
+		// The lowest index of a function that failed to print, and its exception.
+		Platform::Mutex failureMutex;
+		Uptr failedFunctionDefIndex = UINTPTR_MAX;
+		std::exception_ptr failureException;
+
+		ParallelFunctionPrintState(ModulePrintContext& inModuleContext, Uptr inIndentDepth)
+		: moduleContext(inModuleContext), indentDepth(inIndentDepth)
+		{
+		}
+	};
+}
+
+static I64 parallelFunctionPrintThreadMain(void* sharedStateVoid)
+{
+	ParallelFunctionPrintState& state = *(ParallelFunctionPrintState*)sharedStateVoid;
+	const Uptr batchEndIndex = state.batchBeginIndex + state.functionStrings.size();
+	std::string functionString;
+	while(true)
+	{
+		const Uptr functionDefIndex
+			= state.nextFunctionDefIndex.fetch_add(1, std::memory_order_relaxed);
+		if(functionDefIndex >= batchEndIndex) { break; }
+
+		try
+		{
+			functionString.clear();
+			state.moduleContext.printFunction(functionDefIndex, functionString);
+
+			IndentationExpander indentationExpander(state.indentDepth);
+			indentationExpander.expand(
+				functionString, state.functionStrings[functionDefIndex - state.batchBeginIndex]);
+			WAVM_ASSERT(indentationExpander.indentDepth == state.indentDepth);
+		}
+		catch(...)
+		{
+			Platform::Mutex::Lock lock(state.failureMutex);
+			if(functionDefIndex < state.failedFunctionDefIndex)
+			{
+				state.failedFunctionDefIndex = functionDefIndex;
+				state.failureException = std::current_exception();
+			}
+		}
+	}
+	return 0;
+}
+
+void ModulePrintContext::printFunctions()
+{
+	const Uptr numFunctionDefs = module.functions.defs.size();
+	if(numThreads <= 1 || numFunctionDefs < numFunctionsPerThreadPerBatch)
+	{
+		for(Uptr functionDefIndex = 0; functionDefIndex < numFunctionDefs; ++functionDefIndex)
+		{
+			printFunction(functionDefIndex, string);
+			flushIfLarge();
+		}
+		return;
+	}
+
+	// Print batches of functions in parallel, and write each batch's text to the sink in order
+	// once the whole batch is printed. Each function is printed at the indentation depth of the
+	// text before it.
+	flush();
+	ParallelFunctionPrintState state(*this, indentationExpander.indentDepth);
+	const Uptr numFunctionsPerBatch = numThreads * numFunctionsPerThreadPerBatch;
+	for(Uptr batchBeginIndex = 0; batchBeginIndex < numFunctionDefs;
+		batchBeginIndex += numFunctionsPerBatch)
+	{
+		state.batchBeginIndex = batchBeginIndex;
+		state.functionStrings.clear();
+		state.functionStrings.resize(
+			std::min(numFunctionsPerBatch, numFunctionDefs - batchBeginIndex));
+		state.nextFunctionDefIndex.store(batchBeginIndex, std::memory_order_relaxed);
+
+		std::vector<Platform::Thread*> threads;
+		for(Uptr threadIndex = 1; threadIndex < numThreads; ++threadIndex)
+		{
+			threads.push_back(
+				Platform::createThread(0, parallelFunctionPrintThreadMain, &state));
+		}
+		parallelFunctionPrintThreadMain(&state);
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+		if(state.failureException) { std::rethrow_exception(state.failureException); }
+
+		for(const std::string& functionString : state.functionStrings)
+		{ sink(functionString.data(), functionString.size()); }
+	}
+}
+
 void ModulePrintContext::printCustomSectionsAfterKnownSection(OrderedSectionID afterSection)
 {
 	// Print custom sections (other than the name section) that are tagged as occurring after the
@@ -1286,6 +1442,7 @@ void ModulePrintContext::printCustomSectionsAfterKnownSection(OrderedSectionID a
 				string += ')';
 				if(module.featureSpec.customSectionsInTextFormat) { string += DEDENT_STRING; }
 				string += "\n\n";
+				flushIfLarge();
 			}
 		}
 	}
@@ -1646,10 +1803,17 @@ void FunctionPrintContext::printFunctionBody()
 	string += INDENT_STRING "\n";
 }
 
+void WAST::print(const Module& module, const PrintSink& sink, Uptr numThreads)
+{
+	ModulePrintContext context(module, sink, numThreads);
+	context.printModule();
+	context.flush();
+	WAVM_ASSERT(context.indentationExpander.indentDepth == 0);
+}
+
 std::string WAST::print(const Module& module)
 {
 	std::string string;
-	ModulePrintContext context(module, string);
-	context.printModule();
-	return expandIndentation(std::move(string));
+	print(module, [&string](const char* chars, Uptr numChars) { string.append(chars, numChars); });
+	return string;
 }
@@ -1,11 +1,15 @@
 #include <string.h>
+#include <algorithm>
 #include <string>
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/HashMap.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Logging/Metrics.h"
 #include "WAVM/Platform/Diagnostics.h"
+#include "WAVM/Platform/Mutex.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
@@ -118,6 +122,34 @@ struct wasm_module_t
 	wasm_module_t(ModuleRef inModule) : module(inModule) {}
 };
 
+// Value types and function types are interned: there is a single immutable wasm_valtype_t or
+// wasm_functype_t for each type, which is never freed. Functions that return an owned type return
+// the interned type, and deleting it does nothing, so getting an object's type doesn't allocate.
+static wasm_valtype_t* get_interned_valtype(ValueType type)
+{
+	static wasm_valtype_t internedValtypes[numValueTypes] = {{ValueType::none},
+															  {ValueType::any},
+															  {ValueType::i32},
+															  {ValueType::i64},
+															  {ValueType::f32},
+															  {ValueType::f64},
+															  {ValueType::v128},
+															  {ValueType::externref},
+															  {ValueType::funcref}};
+	WAVM_ASSERT(U8(type) < numValueTypes);
+	return &internedValtypes[U8(type)];
+}
+static wasm_functype_t* get_interned_functype(FunctionType type)
+{
+	static Platform::Mutex internedFunctypesMutex;
+	static HashMap<FunctionType, wasm_functype_t*> internedFunctypes;
+
+	Platform::Mutex::Lock internedFunctypesLock(internedFunctypesMutex);
+	wasm_functype_t*& functype = internedFunctypes.getOrAdd(type, nullptr);
+	if(!functype) { functype = new wasm_functype_t(type); }
+	return functype;
+}
+
 static wasm_index_t as_index(IndexType indexType)
 {
 	switch(indexType)
@@ -133,11 +165,11 @@ static wasm_limits_t as_limits(const SizeConstraints& size)
 	WAVM_ERROR_UNLESS(size.max == UINT64_MAX || size.max <= UINT32_MAX);
 	return {U32(size.min), size.max == UINT64_MAX ? UINT32_MAX : U32(size.max)};
 }
-static wasm_functype_t* as_externtype(FunctionType type) { return new wasm_functype_t(type); }
+static wasm_functype_t* as_externtype(FunctionType type) { return get_interned_functype(type); }
 static wasm_tabletype_t* as_externtype(TableType type)
 {
 	return new wasm_tabletype_t(
-		type, new wasm_valtype_t{ValueType(type.elementType)}, as_limits(type.size));
+		type, get_interned_valtype(ValueType(type.elementType)), as_limits(type.size));
 }
 static wasm_memorytype_t* as_externtype(MemoryType type)
 {
@@ -145,7 +177,7 @@ static wasm_memorytype_t* as_externtype(MemoryType type)
 }
 static wasm_globaltype_t* as_externtype(GlobalType type)
 {
-	return new wasm_globaltype_t(type, new wasm_valtype_t{ValueType(type.valueType)});
+	return new wasm_globaltype_t(type, get_interned_valtype(type.valueType));
 }
 static wasm_externtype_t* as_externtype(ExternType type)
 {
@@ -306,12 +338,11 @@ wasm_store_t* wasm_store_new(wasm_compartment_t* compartment, const char* debug_
 }
 
 // wasm_valtype_t
-void wasm_valtype_delete(wasm_valtype_t* type) { delete type; }
-wasm_valtype_t* wasm_valtype_copy(wasm_valtype_t* type) { return new wasm_valtype_t{type->type}; }
+void wasm_valtype_delete(wasm_valtype_t* type) {}
+wasm_valtype_t* wasm_valtype_copy(wasm_valtype_t* type) { return type; }
 wasm_valtype_t* wasm_valtype_new(wasm_valkind_t kind)
 {
-	ValueType type = asValueType(kind);
-	return new wasm_valtype_t{type};
+	return get_interned_valtype(asValueType(kind));
 }
 wasm_valkind_t wasm_valtype_kind(const wasm_valtype_t* type)
 {
@@ -332,11 +363,8 @@ wasm_valkind_t wasm_valtype_kind(const wasm_valtype_t* type)
 }
 
 // wasm_functype_t
-void wasm_functype_delete(wasm_functype_t* type) { delete type; }
-wasm_functype_t* wasm_functype_copy(wasm_functype_t* type)
-{
-	return new wasm_functype_t(type->type);
-}
+void wasm_functype_delete(wasm_functype_t* type) {}
+wasm_functype_t* wasm_functype_copy(wasm_functype_t* type) { return type; }
 wasm_functype_t* wasm_functype_new(wasm_valtype_t** params,
 								   uintptr_t numParams,
 								   wasm_valtype_t** results,
@@ -355,13 +383,13 @@ wasm_functype_t* wasm_functype_new(wasm_valtype_t** params,
 		wasm_valtype_delete(results[resultIndex]);
 	}
 
-	return new wasm_functype_t(
+	return get_interned_functype(
 		FunctionType(TypeTuple(resultsTemp, numResults), TypeTuple(paramsTemp, numParams)));
 }
 size_t wasm_functype_num_params(const wasm_functype_t* type) { return type->type.params().size(); }
 wasm_valtype_t* wasm_functype_param(const wasm_functype_t* type, size_t index)
 {
-	return new wasm_valtype_t{type->type.params()[index]};
+	return get_interned_valtype(type->type.params()[index]);
 }
 size_t wasm_functype_num_results(const wasm_functype_t* type)
 {
@@ -369,7 +397,7 @@ size_t wasm_functype_num_results(const wasm_functype_t* type)
 }
 wasm_valtype_t* wasm_functype_result(const wasm_functype_t* type, size_t index)
 {
-	return new wasm_valtype_t{type->type.results()[index]};
+	return get_interned_valtype(type->type.results()[index]);
 }
 
 // wasm_globaltype_t
@@ -777,6 +805,90 @@ char* wasm_module_print(const wasm_module_t* module, size_t* out_num_chars)
 	return returnBuffer;
 }
 
+// Serialized modules are the module's WebAssembly binary with its object code in a
+// wavm.precompiled_object.<cpu> custom section, the same format wavm compile produces.
+static constexpr const char* serializedObjectSectionPrefix = "wavm.precompiled_object.";
+
+char* wasm_module_serialize(const wasm_module_t* module, size_t* out_num_bytes)
+{
+	IR::Module irModule = getModuleIR(module->module);
+	irModule.customSections.push_back(
+		CustomSection{OrderedSectionID::moduleBeginning,
+					  serializedObjectSectionPrefix + LLVMJIT::getHostTargetSpec().cpu,
+					  getObjectCode(module->module)});
+	const std::vector<U8> wasmBytes = WASM::saveBinaryModule(irModule);
+
+	char* returnBuffer = (char*)malloc(wasmBytes.size());
+	memcpy(returnBuffer, wasmBytes.data(), wasmBytes.size());
+
+	*out_num_bytes = wasmBytes.size();
+	return returnBuffer;
+}
+
+static wasm_module_t* deserializeModule(wasm_engine_t* engine,
+										const char* bytes,
+										size_t numBytes,
+										const std::shared_ptr<const void>& bytesOwner)
+{
+	IR::Module irModule(engine->config.featureSpec);
+	WASM::LoadError loadError;
+	if(!WASM::loadBinaryModule((const U8*)bytes, numBytes, bytesOwner, irModule, &loadError))
+	{
+		Log::printf(Log::debug, "%s\n", loadError.message.c_str());
+		return nullptr;
+	}
+
+	// Find the object code sections, and choose the one compiled for a CPU the host supports.
+	const Uptr prefixLength = strlen(serializedObjectSectionPrefix);
+	std::vector<Uptr> objectSectionIndices;
+	std::vector<LLVMJIT::TargetObjectCode> targetObjectCodes;
+	for(Uptr sectionIndex = 0; sectionIndex < irModule.customSections.size(); ++sectionIndex)
+	{
+		const CustomSection& customSection = irModule.customSections[sectionIndex];
+		if(!customSection.name.compare(0, prefixLength, serializedObjectSectionPrefix))
+		{
+			objectSectionIndices.push_back(sectionIndex);
+			targetObjectCodes.push_back({customSection.name.substr(prefixLength),
+										 customSection.data.data(),
+										 customSection.data.size()});
+		}
+	}
+	const Uptr objectCodeIndex = targetObjectCodes.size()
+									 ? LLVMJIT::findBestHostObjectCode(targetObjectCodes)
+									 : UINTPTR_MAX;
+	if(objectCodeIndex == UINTPTR_MAX)
+	{
+		Log::printf(Log::debug, "Serialized module doesn't contain object code for the host.\n");
+		return nullptr;
+	}
+
+	std::vector<U8> objectCode
+		= std::move(irModule.customSections[objectSectionIndices[objectCodeIndex]].data);
+	for(Uptr index = objectSectionIndices.size(); index > 0; --index)
+	{
+		irModule.customSections.erase(irModule.customSections.begin()
+									  + objectSectionIndices[index - 1]);
+	}
+	return new wasm_module_t{loadPrecompiledModule(std::move(irModule), std::move(objectCode))};
+}
+
+wasm_module_t* wasm_module_deserialize(wasm_engine_t* engine, const char* bytes, size_t num_bytes)
+{
+	return deserializeModule(engine, bytes, num_bytes, nullptr);
+}
+
+wasm_module_t* wavm_module_deserialize_mapped(wasm_engine_t* engine,
+											  const char* bytes,
+											  size_t num_bytes,
+											  void* owner,
+											  void (*finalizer)(void*))
+{
+	std::shared_ptr<const void> bytesOwner(bytes, [owner, finalizer](const void*) {
+		if(finalizer) { finalizer(owner); }
+	});
+	return deserializeModule(engine, bytes, num_bytes, bytesOwner);
+}
+
 bool wasm_module_validate(const char* binary, size_t numBinaryBytes)
 {
 	IR::Module irModule;
@@ -877,6 +989,39 @@ void wasm_module_export(const wasm_module_t* module, size_t index, wasm_export_t
 	};
 }
 
+size_t wavm_module_export_index(const wasm_module_t* module,
+								const char* name,
+								size_t num_name_bytes,
+								const wasm_externtype_t* type)
+{
+	const std::string nameString(name, num_name_bytes);
+	if(!type) { return getModuleExportIndex(module->module, nameString).index; }
+
+	switch(type->kind)
+	{
+	case ExternKind::function:
+		return getTypedModuleExportIndex(
+				   module->module, nameString, ((const wasm_functype_t*)type)->type)
+			.index;
+	case ExternKind::table:
+		return getTypedModuleExportIndex(
+				   module->module, nameString, ((const wasm_tabletype_t*)type)->type)
+			.index;
+	case ExternKind::memory:
+		return getTypedModuleExportIndex(
+				   module->module, nameString, ((const wasm_memorytype_t*)type)->type)
+			.index;
+	case ExternKind::global:
+		return getTypedModuleExportIndex(
+				   module->module, nameString, ((const wasm_globaltype_t*)type)->type)
+			.index;
+	case ExternKind::exceptionType: Errors::unimplemented("exception types in C API");
+
+	case ExternKind::invalid:
+	default: WAVM_UNREACHABLE();
+	};
+}
+
 // wasm_func_t
 
 IMPLEMENT_SHAREABLE_REF(func, Function)
@@ -886,13 +1031,16 @@ wasm_func_t* wasm_func_new(wasm_compartment_t* compartment,
 						   wasm_func_callback_t callback,
 						   const char* debug_name)
 {
+	// The intrinsic has the same name for every callback, so the module that calls it is only
+	// compiled once for each function type, and the callback is bound when it's instantiated.
 	FunctionType callbackType(
 		type->type.results(), type->type.params(), CallingConvention::cAPICallback);
 	Intrinsics::Module intrinsicModule;
 	Intrinsics::Function intrinsicFunction(
-		&intrinsicModule, debug_name, (void*)callback, callbackType);
+		&intrinsicModule, "callback", (void*)callback, callbackType);
 	Instance* instance = Intrinsics::instantiateModule(compartment, {&intrinsicModule}, debug_name);
-	Function* function = getTypedInstanceExport(instance, debug_name, type->type);
+	Function* function = getTypedInstanceExport(instance, "callback", type->type);
+	function->mutableData->debugName = debug_name;
 	addGCRoot(function);
 	return function;
 }
@@ -907,7 +1055,7 @@ wasm_func_t* wasm_func_new_with_env(wasm_compartment_t*,
 }
 wasm_functype_t* wasm_func_type(const wasm_func_t* function)
 {
-	return new wasm_functype_t(getFunctionType(function));
+	return get_interned_functype(getFunctionType(function));
 }
 size_t wasm_func_param_arity(const wasm_func_t* function)
 {
@@ -918,33 +1066,48 @@ size_t wasm_func_result_arity(const wasm_func_t* function)
 	return getFunctionType(function).results().size();
 }
 
+static wasm_trap_t* call_func(wasm_store_t* store,
+							   const wasm_func_t* function,
+							   FunctionType invokeSig,
+							   const wasm_val_t args[],
+							   wasm_val_t outResults[])
+{
+	// wasm_val_t has the same layout as UntaggedValue, so the arguments and results are passed to
+	// the invoke thunk in place. Exceptions are caught directly instead of through
+	// catchRuntimeExceptions to avoid constructing std::function thunks for each call.
+	try
+	{
+		const void* invokeThunk = getInvokeThunk(function, invokeSig);
+		if(!invokeThunk) { throwException(ExceptionTypes::invokeSignatureMismatch); }
+
+		invokeFunctionWithThunk(store,
+								function,
+								invokeThunk,
+								reinterpret_cast<const UntaggedValue*>(args),
+								reinterpret_cast<UntaggedValue*>(outResults));
+		return nullptr;
+	}
+	catch(Exception* exception)
+	{
+		return exception;
+	}
+}
+
 wasm_trap_t* wasm_func_call(wasm_store_t* store,
 							const wasm_func_t* function,
 							const wasm_val_t args[],
 							wasm_val_t outResults[])
 {
-	Exception* exception = nullptr;
-	catchRuntimeExceptions(
-		[store, function, &args, &outResults]() {
-			FunctionType functionType = getFunctionType((Function*)function);
-			auto wavmArgs
-				= (UntaggedValue*)alloca(functionType.params().size() * sizeof(UntaggedValue));
-			for(Uptr argIndex = 0; argIndex < functionType.params().size(); ++argIndex)
-			{ memcpy(&wavmArgs[argIndex].bytes, &args[argIndex], sizeof(wasm_val_t)); }
-
-			auto wavmResults
-				= (UntaggedValue*)alloca(functionType.results().size() * sizeof(UntaggedValue));
-			invokeFunction(store, function, functionType, wavmArgs, wavmResults);
-
-			for(Uptr resultIndex = 0; resultIndex < functionType.results().size(); ++resultIndex)
-			{
-				memcpy(
-					&outResults[resultIndex], &wavmResults[resultIndex].bytes, sizeof(wasm_val_t));
-			}
-		},
-		[&exception](Exception* caughtException) { exception = caughtException; });
+	return call_func(store, function, getFunctionType(function), args, outResults);
+}
 
-	return exception;
+wasm_trap_t* wavm_func_call_unchecked(wasm_store_t* store,
+									  const wasm_func_t* function,
+									  const wasm_functype_t* type,
+									  const wasm_val_t args[],
+									  wasm_val_t outResults[])
+{
+	return call_func(store, function, type->type, args, outResults);
 }
 
 // wasm_global_t
@@ -1161,4 +1324,30 @@ wasm_extern_t* wasm_instance_export(const wasm_instance_t* instance, size_t inde
 {
 	return getInstanceExports(instance)[index];
 }
+
+// Metrics
+size_t wavm_metrics_get_prometheus_text(char* buffer, size_t num_buffer_bytes)
+{
+	const std::string text = Metrics::getPrometheusText();
+	if(num_buffer_bytes)
+	{
+		const size_t numCopiedBytes = std::min(text.size(), num_buffer_bytes - 1);
+		memcpy(buffer, text.c_str(), numCopiedBytes);
+		buffer[numCopiedBytes] = 0;
+	}
+	return text.size() + 1;
+}
+
+bool wavm_metrics_get_counter(const char* name, uint64_t* out_value)
+{
+	for(const Metrics::MetricValue& value : Metrics::getMetrics())
+	{
+		if(value.name == name)
+		{
+			*out_value = value.count;
+			return true;
+		}
+	}
+	return false;
+}
 }
@@ -1,30 +1,186 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "../wavm.h"
+#include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Operators.h"
+#include "WAVM/IR/RandomModule.h"
 #include "WAVM/IR/Types.h"
 #include "WAVM/IR/Validate.h"
 #include "WAVM/IR/Value.h"
 #include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
 #include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/RandomStream.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Inline/Unicode.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/ObjectCache/ObjectCache.h"
+#include "WAVM/Platform/Clock.h"
 #include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Intrinsics.h"
 #include "WAVM/Runtime/Runtime.h"
 #include "WAVM/RuntimeABI/RuntimeABI.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/TestScript.h"
 #include "WAVM/WASTParse/WASTParse.h"
 
 using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
+// The results of running a benchmark: the time per operation for each repeat, sorted.
+struct BenchmarkResult
+{
+	std::string name;
+	Uptr numThreads;
+	Uptr numOpsPerRepeat;
+	std::vector<F64> nsPerOp;
+
+	// Returns the nanoseconds per operation at a percentile of the repeats, using the nearest rank.
+	F64 getPercentile(F64 percentile) const
+	{
+		Uptr rank = Uptr(percentile / 100.0 * F64(nsPerOp.size()) + 0.999999);
+		if(rank > 0) { --rank; }
+		return nsPerOp[std::min(rank, nsPerOp.size() - 1)];
+	}
+
+	F64 getMean() const
+	{
+		F64 sum = 0.0;
+		for(F64 ns : nsPerOp) { sum += ns; }
+		return sum / F64(nsPerOp.size());
+	}
+};
+
+struct BenchmarkSuite
+{
+	// Only benchmarks with names that contain the filter are run.
+	std::string filter;
+
+	// The number of timed repeats of each benchmark, after an untimed repeat to warm up caches.
+	Uptr numRepeats = 20;
+
+	// If non-null, the object cache benchmarks create a cache in this directory.
+	const char* objectCacheDir = nullptr;
+
+	std::vector<const char*> wastFilenames;
+	std::vector<const char*> compileCorpusFilenames;
+	std::vector<BenchmarkResult> results;
+
+	bool isEnabled(const std::string& name) const
+	{
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+
+	// Runs a benchmark if it matches the filter. runRepeat is called for each repeat, and must
+	// perform numOpsPerRepeat operations on each of numThreads threads, returning the average
+	// nanoseconds each thread took.
+	void run(std::string&& name,
+			 Uptr numThreads,
+			 Uptr numOpsPerRepeat,
+			 const std::function<F64()>& runRepeat)
+	{
+		if(!isEnabled(name)) { return; }
+
+		runRepeat();
+
+		BenchmarkResult result;
+		result.name = std::move(name);
+		result.numThreads = numThreads;
+		result.numOpsPerRepeat = numOpsPerRepeat;
+		for(Uptr repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+		{ result.nsPerOp.push_back(runRepeat() / F64(numOpsPerRepeat)); }
+		std::sort(result.nsPerOp.begin(), result.nsPerOp.end());
+
+		Log::printf(Log::debug,
+					"%s: %.2fns/op median (%" WAVM_PRIuPTR " threads)\n",
+					result.name.c_str(),
+					result.getPercentile(50.0),
+					numThreads);
+
+		results.push_back(std::move(result));
+	}
+};
+
+static std::string formatResultsAsJSON(const BenchmarkSuite& suite)
+{
+	const auto targetSpec = LLVMJIT::getHostTargetSpec();
+
+	char buffer[512];
+	std::string json = "{\n  \"host\": {\"triple\": ";
+	appendJSONString(json, targetSpec.triple);
+	json += ", \"cpu\": ";
+	appendJSONString(json, targetSpec.cpu);
+	snprintf(buffer,
+			 sizeof(buffer),
+			 ", \"hardwareThreads\": %" WAVM_PRIuPTR "},\n  \"repeats\": %" WAVM_PRIuPTR
+			 ",\n  \"benchmarks\": [",
+			 Platform::getNumberOfHardwareThreads(),
+			 suite.numRepeats);
+	json += buffer;
+
+	for(Uptr resultIndex = 0; resultIndex < suite.results.size(); ++resultIndex)
+	{
+		const BenchmarkResult& result = suite.results[resultIndex];
+		json += resultIndex ? ",\n    {\"name\": " : "\n    {\"name\": ";
+		appendJSONString(json, result.name);
+		snprintf(buffer,
+				 sizeof(buffer),
+				 ", \"threads\": %" WAVM_PRIuPTR ", \"opsPerRepeat\": %" WAVM_PRIuPTR
+				 ", \"repeats\": %" WAVM_PRIuPTR
+				 ", \"opsPerSecond\": %.1f"
+				 ", \"nsPerOp\": {\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+				 "\"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f}}",
+				 result.numThreads,
+				 result.numOpsPerRepeat,
+				 result.nsPerOp.size(),
+				 1000000000.0 / result.getPercentile(50.0),
+				 result.nsPerOp.front(),
+				 result.getPercentile(50.0),
+				 result.getPercentile(90.0),
+				 result.getPercentile(99.0),
+				 result.nsPerOp.back(),
+				 result.getMean());
+		json += buffer;
+	}
+
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+static ModuleRef compileWAST(const char* wast, const char* description)
+{
+	IR::Module irModule(FeatureLevel::proposed);
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(wast, strlen(wast) + 1, irModule, parseErrors))
+	{
+		WAST::reportParseErrors(description, wast, parseErrors);
+		Errors::fatalf("Failed to parse %s WAST", description);
+	}
+	return compileModule(irModule);
+}
+
+static I32 invokeI32(Context* context, Function* function, I32 arg)
+{
+	UntaggedValue args[1]{arg};
+	UntaggedValue results[1];
+	invokeFunction(
+		context, function, FunctionType({ValueType::i32}, {ValueType::i32}), args, results);
+	return results[0].i32;
+}
+
 template<typename Result> struct ContextAndResult
 {
 	ContextRuntimeData* contextRuntimeData;
@@ -37,15 +193,17 @@ struct ThreadArgs
 {
 	Context* context = nullptr;
 	Function* function = nullptr;
+	Uptr numOps = 0;
 	F64 elapsedNanoseconds = 0;
 	Platform::Thread* thread = nullptr;
 };
 
-void runBenchmark(Compartment* compartment,
-				  Function* function,
-				  Uptr numThreads,
-				  const char* description,
-				  I64 (*threadFunc)(void*))
+// Runs threadFunc on numThreads threads, and returns the average nanoseconds they took.
+static F64 runThreads(Compartment* compartment,
+					  Function* function,
+					  Uptr numThreads,
+					  Uptr numOpsPerThread,
+					  I64 (*threadFunc)(void*))
 {
 	// Create a thread for each hardware thread.
 	std::vector<ThreadArgs*> threads;
@@ -54,6 +212,7 @@ void runBenchmark(Compartment* compartment,
 		ThreadArgs* threadArgs = new ThreadArgs;
 		threadArgs->context = createContext(compartment);
 		threadArgs->function = function;
+		threadArgs->numOps = numOpsPerThread;
 		threadArgs->thread = Platform::createThread(512 * 1024, threadFunc, threadArgs);
 		threads.push_back(threadArgs);
 	}
@@ -67,35 +226,34 @@ void runBenchmark(Compartment* compartment,
 		delete threadArgs;
 	}
 
-	// Print the results.
-	const F64 averageNanoseconds = totalElapsedNanoseconds / F64(numThreads);
-
-	Log::printf(Log::output,
-				"ns/%s in %" WAVM_PRIuPTR " threads: %.2f\n",
-				description,
-				numThreads,
-				averageNanoseconds);
+	return totalElapsedNanoseconds / F64(numThreads);
 }
 
-void runBenchmarkSingleAndMultiThreaded(Compartment* compartment,
-										Function* function,
-										const char* description,
-										I64 (*threadFunc)(void*))
+static void runSingleAndMultiThreaded(BenchmarkSuite& suite,
+									  Compartment* compartment,
+									  Function* function,
+									  const char* name,
+									  Uptr numOpsPerThread,
+									  I64 (*threadFunc)(void*))
 {
-	const Uptr numHardwareThreads = Platform::getNumberOfHardwareThreads() / 2;
-	runBenchmark(compartment, function, 1, description, threadFunc);
-	runBenchmark(compartment, function, numHardwareThreads, description, threadFunc);
+	const Uptr numHardwareThreads = std::max(Uptr(1), Platform::getNumberOfHardwareThreads() / 2);
+	for(Uptr numThreads : {Uptr(1), numHardwareThreads})
+	{
+		suite.run(std::string(name) + "/threads=" + std::to_string(numThreads),
+				  numThreads,
+				  numOpsPerThread,
+				  [&]() {
+					  return runThreads(
+						  compartment, function, numThreads, numOpsPerThread, threadFunc);
+				  });
+		if(numHardwareThreads == 1) { break; }
+	}
 }
 
-void showBenchmarkHelp(WAVM::Log::Category outputCategory)
+static void runInvokeBench(BenchmarkSuite& suite)
 {
-	Log::printf(outputCategory, "Usage: wavm test bench\n");
-}
+	static constexpr Uptr numInvokesPerThread = 1000000;
 
-static constexpr Uptr numInvokesPerThread = 100000000;
-
-void runInvokeBench()
-{
 	// Generate a nop function.
 	Serialization::ArrayOutputStream codeStream;
 	OperatorEncoderStream encoder(codeStream);
@@ -121,42 +279,36 @@ void runInvokeBench()
 	auto instance = instantiateModule(compartment, module, {}, "nopModule");
 	auto function = asFunction(getInstanceExport(instance, "nopFunction"));
 
-	// Call the nop function once to ensure the time to create the invoke thunk isn't benchmarked.
-	{
-		IR::Value args[1]{I32(0)};
-		IR::Value results[1];
-		invokeFunction(createContext(compartment),
-					   function,
-					   FunctionType({ValueType::i32}, {ValueType::i32}),
-					   args,
-					   results);
-	}
-
 	// Benchmark calling the function directly.
-	runBenchmarkSingleAndMultiThreaded(
-		compartment, function, "direct call", [](void* argument) -> I64 {
+	runSingleAndMultiThreaded(
+		suite, compartment, function, "call/direct", numInvokesPerThread, [](void* argument) -> I64 {
 			ThreadArgs* threadArgs = (ThreadArgs*)argument;
 			ContextRuntimeData* contextRuntimeData = getContextRuntimeData(threadArgs->context);
 
 			Timing::Timer timer;
-			for(Uptr repeatIndex = 0; repeatIndex < numInvokesPerThread; ++repeatIndex)
+			for(Uptr repeatIndex = 0; repeatIndex < threadArgs->numOps; ++repeatIndex)
 			{ (*(NopFunctionPointer)&threadArgs->function->code[0])(contextRuntimeData); }
 			timer.stop();
 
-			threadArgs->elapsedNanoseconds = timer.getNanoseconds() / F64(numInvokesPerThread);
+			threadArgs->elapsedNanoseconds = timer.getNanoseconds();
 
 			return 0;
 		});
 
 	// Benchmark invokeFunction.
-	runBenchmarkSingleAndMultiThreaded(
-		compartment, function, "invokeFunction", [](void* argument) -> I64 {
+	runSingleAndMultiThreaded(
+		suite,
+		compartment,
+		function,
+		"call/invokeFunction",
+		numInvokesPerThread,
+		[](void* argument) -> I64 {
 			ThreadArgs* threadArgs = (ThreadArgs*)argument;
 
 			FunctionType invokeSig({ValueType::i32}, {ValueType::i32});
 
 			Timing::Timer timer;
-			for(Uptr repeatIndex = 0; repeatIndex < numInvokesPerThread; ++repeatIndex)
+			for(Uptr repeatIndex = 0; repeatIndex < threadArgs->numOps; ++repeatIndex)
 			{
 				UntaggedValue args[1]{I32(0)};
 				UntaggedValue results[1];
@@ -164,11 +316,96 @@ void runInvokeBench()
 			}
 			timer.stop();
 
-			threadArgs->elapsedNanoseconds = timer.getNanoseconds() / F64(numInvokesPerThread);
+			threadArgs->elapsedNanoseconds = timer.getNanoseconds();
+
+			return 0;
+		});
+
+	// Benchmark invokeFunctionBatch.
+	runSingleAndMultiThreaded(
+		suite,
+		compartment,
+		function,
+		"call/invokeFunctionBatch",
+		numInvokesPerThread,
+		[](void* argument) -> I64 {
+			ThreadArgs* threadArgs = (ThreadArgs*)argument;
+
+			FunctionType invokeSig({ValueType::i32}, {ValueType::i32});
+
+			static constexpr Uptr numInvokesPerBatch = 1000;
+			std::vector<UntaggedValue> args(numInvokesPerBatch, I32(0));
+			std::vector<UntaggedValue> results(numInvokesPerBatch);
+
+			Timing::Timer timer;
+			for(Uptr repeatIndex = 0; repeatIndex < threadArgs->numOps;
+				repeatIndex += numInvokesPerBatch)
+			{
+				WAVM_ERROR_UNLESS(invokeFunctionBatch(threadArgs->context,
+													  threadArgs->function,
+													  invokeSig,
+													  numInvokesPerBatch,
+													  args.data(),
+													  results.data())
+								  == numInvokesPerBatch);
+			}
+			timer.stop();
+
+			threadArgs->elapsedNanoseconds = timer.getNanoseconds();
+
+			return 0;
+		});
+
+	// Benchmark calling the function through a TypedFunction.
+	runSingleAndMultiThreaded(
+		suite,
+		compartment,
+		function,
+		"call/TypedFunction",
+		numInvokesPerThread,
+		[](void* argument) -> I64 {
+			ThreadArgs* threadArgs = (ThreadArgs*)argument;
+
+			TypedFunction<I32(I32)> typedFunction;
+			WAVM_ERROR_UNLESS(typedFunction.bind(threadArgs->function));
+
+			Timing::Timer timer;
+			for(Uptr repeatIndex = 0; repeatIndex < threadArgs->numOps; ++repeatIndex)
+			{ typedFunction(threadArgs->context, I32(0)); }
+			timer.stop();
+
+			threadArgs->elapsedNanoseconds = timer.getNanoseconds();
 
 			return 0;
 		});
 
+	// Benchmark submitting the calls to an Executor, and waiting for their results.
+	{
+		static constexpr Uptr numTasksPerWorker = 100000;
+		Executor* executor = createExecutor(compartment);
+		const Uptr numWorkerThreads = getExecutorNumWorkerThreads(executor);
+		suite.run("call/Executor/threads=" + std::to_string(numWorkerThreads),
+				  numWorkerThreads,
+				  numTasksPerWorker,
+				  [&]() {
+					  FunctionType invokeSig({ValueType::i32}, {ValueType::i32});
+					  UntaggedValue args[1]{I32(0)};
+					  std::vector<std::future<ExecutorResult>> futures;
+					  futures.reserve(numTasksPerWorker * numWorkerThreads);
+
+					  Timing::Timer timer;
+					  for(Uptr taskIndex = 0; taskIndex < numTasksPerWorker * numWorkerThreads;
+						  ++taskIndex)
+					  { futures.push_back(submitToExecutor(executor, function, invokeSig, args)); }
+					  for(std::future<ExecutorResult>& future : futures)
+					  { WAVM_ERROR_UNLESS(!future.get().exception); }
+					  timer.stop();
+
+					  return timer.getNanoseconds();
+				  });
+		destroyExecutor(executor);
+	}
+
 	// Free the compartment.
 	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
 }
@@ -180,7 +417,26 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(benchmarkIntrinsics, "identity", I32, intrinsicId
 	return x;
 }
 
-static constexpr Uptr numIntrinsicCallsPerThread = 1000000000;
+WAVM_DEFINE_INTRINSIC_FUNCTION_WITH_INLINE_IR(benchmarkIntrinsics,
+											  "inlineIdentity",
+											  "define i32 @inlineIdentity(i32 %x) {\n"
+											  "  ret i32 %x\n"
+											  "}\n",
+											  I32,
+											  intrinsicInlineIdentity,
+											  I32 x)
+{
+	return x;
+}
+
+WAVM_DEFINE_PURE_INTRINSIC_FUNCTION(benchmarkIntrinsics,
+									"pureIdentity",
+									I32,
+									intrinsicPureIdentity,
+									I32 x)
+{
+	return x;
+}
 
 static constexpr const char* intrinsicBenchModuleWAST
 	= "(module\n"
@@ -198,58 +454,45 @@ static constexpr const char* intrinsicBenchModuleWAST
 	  "  )\n"
 	  ")";
 
-void runIntrinsicBench()
+// Benchmarks calls to an intrinsic. If specializeInstances is true, the WASM module is compiled for
+// its instance's imports, so calls to an intrinsic with an inline body are inlined, and calls to a
+// pure intrinsic call its native function directly.
+static void runIntrinsicBench(BenchmarkSuite& suite,
+							  const char* benchmarkName,
+							  const char* intrinsicName,
+							  bool specializeInstances)
 {
-	// Parse the intrinsic benchmark module.
-	std::vector<WAST::Error> parseErrors;
-	IR::Module irModule;
-	if(!WAST::parseModule(
-		   intrinsicBenchModuleWAST, strlen(intrinsicBenchModuleWAST) + 1, irModule, parseErrors))
-	{
-		WAST::reportParseErrors(
-			"intrinsic benchmark module", intrinsicBenchModuleWAST, parseErrors);
-		Errors::fatal("Failed to parse intrinsic benchmark module WAST");
-	}
+	static constexpr Uptr numIntrinsicCallsPerThread = 10000000;
 
 	// Instantiate the intrinsic module
 	GCPointer<Compartment> compartment = Runtime::createCompartment();
 	auto intrinsicInstance = Intrinsics::instantiateModule(
 		compartment, {WAVM_INTRINSIC_MODULE_REF(benchmarkIntrinsics)}, "benchmarkIntrinsics");
-	auto intrinsicIdentityFunction = getInstanceExport(intrinsicInstance, "identity");
+	auto intrinsicFunction = getInstanceExport(intrinsicInstance, intrinsicName);
 
 	// Instantiate the WASM module.
-	auto module = compileModule(irModule);
+	setGlobalSpecializeInstances(specializeInstances);
+	auto module = compileWAST(intrinsicBenchModuleWAST, "intrinsic benchmark module");
+	setGlobalSpecializeInstances(false);
 	auto instance = instantiateModule(
-		compartment, module, {intrinsicIdentityFunction}, "benchmarkIntrinsicModule");
+		compartment, module, {intrinsicFunction}, "benchmarkIntrinsicModule");
 	auto function = asFunction(getInstanceExport(instance, "benchmarkIntrinsicFunc"));
 
-	// Call the benchmark function once to ensure the time to create the invoke thunk isn't
-	// benchmarked.
-	{
-		IR::Value args[1]{I32(1)};
-		IR::Value results[1];
-		invokeFunction(createContext(compartment),
-					   function,
-					   FunctionType({ValueType::i32}, {ValueType::i32}),
-					   args,
-					   results);
-	}
-
 	// Run the benchmark.
-	runBenchmarkSingleAndMultiThreaded(
-		compartment, function, "intrinsic call", [](void* argument) -> I64 {
+	runSingleAndMultiThreaded(
+		suite,
+		compartment,
+		function,
+		benchmarkName,
+		numIntrinsicCallsPerThread,
+		[](void* argument) -> I64 {
 			ThreadArgs* threadArgs = (ThreadArgs*)argument;
 
-			FunctionType invokeSig({ValueType::i32}, {ValueType::i32});
-
 			Timing::Timer timer;
-			UntaggedValue args[1]{I32(numIntrinsicCallsPerThread)};
-			UntaggedValue results[1];
-			invokeFunction(threadArgs->context, threadArgs->function, invokeSig, args, results);
+			invokeI32(threadArgs->context, threadArgs->function, I32(threadArgs->numOps));
 			timer.stop();
 
-			threadArgs->elapsedNanoseconds
-				= timer.getNanoseconds() / F64(numIntrinsicCallsPerThread);
+			threadArgs->elapsedNanoseconds = timer.getNanoseconds();
 
 			return 0;
 		});
@@ -258,22 +501,701 @@ void runIntrinsicBench()
 	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
 }
 
+static constexpr const char* callIndirectBenchModuleWAST
+	= "(module\n"
+	  "  (type $i32_to_i32 (func (param i32) (result i32)))\n"
+	  "  (table (export \"table\") funcref (elem $a $b $c $d))\n"
+	  "  (func $a (param i32) (result i32) (i32.add (local.get 0) (i32.const 1)))\n"
+	  "  (func $b (param i32) (result i32) (i32.add (local.get 0) (i32.const 2)))\n"
+	  "  (func $c (param i32) (result i32) (i32.add (local.get 0) (i32.const 3)))\n"
+	  "  (func $d (param i32) (result i32) (i32.add (local.get 0) (i32.const 4)))\n"
+	  "  (func (export \"callIndirect\") (param $numIterations i32) (result i32)\n"
+	  "    (local $i i32)\n"
+	  "    (local $acc i32)\n"
+	  "    loop $loop\n"
+	  "      (local.set $acc (call_indirect (type $i32_to_i32)\n"
+	  "                        (local.get $acc)\n"
+	  "                        (i32.and (local.get $i) (i32.const 3))))\n"
+	  "      (local.set $i (i32.add (local.get $i) (i32.const 1)))\n"
+	  "      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))\n"
+	  "    end\n"
+	  "    (local.get $acc)\n"
+	  "  )\n"
+	  ")";
+
+// Two interpreters for a bytecode program that counts down from its argument, with a handler
+// function for each opcode: inc (0), dec (1), jnz (2) and halt (3). The trampolined interpreter
+// calls the handler for each instruction from a dispatch loop, and each handler returns the
+// interpreter's state to the loop. Each handler of the threaded interpreter tail calls the handler
+// for the next instruction, passing it the interpreter's state.
+static constexpr const char* dispatchBenchModuleWAST
+	= "(module\n"
+	  "  (type $trampolined (func (param i32 i32 i32) (result i32 i32 i32)))\n"
+	  "  (type $threaded (func (param i32 i32 i32) (result i32)))\n"
+	  "  (memory 1)\n"
+	  "  (data (i32.const 0) \"\\00\\01\\02\\00\\03\")\n"
+	  "  (table funcref (elem $inc $dec $jnz $halt $tinc $tdec $tjnz $thalt))\n"
+	  "  (func $inc (type $trampolined) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32 i32 i32)\n"
+	  "    (i32.add (local.get $pc) (i32.const 1))\n"
+	  "    (i32.add (local.get $acc) (i32.const 1))\n"
+	  "    (local.get $n))\n"
+	  "  (func $dec (type $trampolined) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32 i32 i32)\n"
+	  "    (i32.add (local.get $pc) (i32.const 1))\n"
+	  "    (local.get $acc)\n"
+	  "    (i32.sub (local.get $n) (i32.const 1)))\n"
+	  "  (func $jnz (type $trampolined) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32 i32 i32)\n"
+	  "    (select (i32.load8_u offset=1 (local.get $pc))\n"
+	  "            (i32.add (local.get $pc) (i32.const 2))\n"
+	  "            (local.get $n))\n"
+	  "    (local.get $acc)\n"
+	  "    (local.get $n))\n"
+	  "  (func $halt (type $trampolined) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32 i32 i32)\n"
+	  "    (i32.const -1) (local.get $acc) (local.get $n))\n"
+	  "  (func (export \"trampolined\") (param $n i32) (result i32)\n"
+	  "    (local $pc i32)\n"
+	  "    (local $acc i32)\n"
+	  "    loop $loop\n"
+	  "      (call_indirect (type $trampolined)\n"
+	  "        (local.get $pc) (local.get $acc) (local.get $n)\n"
+	  "        (i32.load8_u (local.get $pc)))\n"
+	  "      (local.set $n)\n"
+	  "      (local.set $acc)\n"
+	  "      (local.set $pc)\n"
+	  "      (br_if $loop (i32.ge_s (local.get $pc) (i32.const 0)))\n"
+	  "    end\n"
+	  "    (local.get $acc))\n"
+	  "  (func $tinc (type $threaded) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32)\n"
+	  "    (local.set $pc (i32.add (local.get $pc) (i32.const 1)))\n"
+	  "    (return_call_indirect (type $threaded)\n"
+	  "      (local.get $pc) (i32.add (local.get $acc) (i32.const 1)) (local.get $n)\n"
+	  "      (i32.add (i32.load8_u (local.get $pc)) (i32.const 4))))\n"
+	  "  (func $tdec (type $threaded) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32)\n"
+	  "    (local.set $pc (i32.add (local.get $pc) (i32.const 1)))\n"
+	  "    (return_call_indirect (type $threaded)\n"
+	  "      (local.get $pc) (local.get $acc) (i32.sub (local.get $n) (i32.const 1))\n"
+	  "      (i32.add (i32.load8_u (local.get $pc)) (i32.const 4))))\n"
+	  "  (func $tjnz (type $threaded) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32)\n"
+	  "    (local.set $pc (select (i32.load8_u offset=1 (local.get $pc))\n"
+	  "                           (i32.add (local.get $pc) (i32.const 2))\n"
+	  "                           (local.get $n)))\n"
+	  "    (return_call_indirect (type $threaded)\n"
+	  "      (local.get $pc) (local.get $acc) (local.get $n)\n"
+	  "      (i32.add (i32.load8_u (local.get $pc)) (i32.const 4))))\n"
+	  "  (func $thalt (type $threaded) (param $pc i32) (param $acc i32) (param $n i32)\n"
+	  "    (result i32)\n"
+	  "    (local.get $acc))\n"
+	  "  (func (export \"threaded\") (param $n i32) (result i32)\n"
+	  "    (call_indirect (type $threaded)\n"
+	  "      (i32.const 0) (i32.const 0) (local.get $n)\n"
+	  "      (i32.add (i32.load8_u (i32.const 0)) (i32.const 4))))\n"
+	  ")";
+
+static constexpr const char* trapBenchModuleWAST
+	= "(module\n"
+	  "  (func (export \"trap\") (param i32) (result i32) unreachable)\n"
+	  ")";
+
+static constexpr const char* memoryGrowBenchModuleWAST
+	= "(module\n"
+	  "  (memory 0 65536)\n"
+	  "  (func (export \"grow\") (param $numPages i32) (result i32)\n"
+	  "    (local $i i32)\n"
+	  "    loop $loop\n"
+	  "      (drop (memory.grow (i32.const 1)))\n"
+	  "      (local.set $i (i32.add (local.get $i) (i32.const 1)))\n"
+	  "      (br_if $loop (i32.lt_u (local.get $i) (local.get $numPages)))\n"
+	  "    end\n"
+	  "    (memory.size)\n"
+	  "  )\n"
+	  ")";
+
+// Two functions that take turns flipping a shared flag between 0 and 1, waking the other with
+// memory.atomic.notify and sleeping in memory.atomic.wait32 until it is their turn again.
+static constexpr const char* pingPongBenchModuleWAST
+	= "(module\n"
+	  "  (memory 1 1 shared)\n"
+	  "  (func $waitWhile (param $value i32)\n"
+	  "    loop $wait\n"
+	  "      (if (i32.eq (i32.atomic.load (i32.const 0)) (local.get $value))\n"
+	  "        (then\n"
+	  "          (drop (memory.atomic.wait32 (i32.const 0) (local.get $value) (i64.const -1)))\n"
+	  "          (br $wait)))\n"
+	  "    end\n"
+	  "  )\n"
+	  "  (func $run (param $numRoundTrips i32) (param $turn i32) (result i32)\n"
+	  "    (local $i i32)\n"
+	  "    loop $loop\n"
+	  "      (call $waitWhile (i32.xor (local.get $turn) (i32.const 1)))\n"
+	  "      (i32.atomic.store (i32.const 0) (i32.xor (local.get $turn) (i32.const 1)))\n"
+	  "      (drop (memory.atomic.notify (i32.const 0) (i32.const 1)))\n"
+	  "      (local.set $i (i32.add (local.get $i) (i32.const 1)))\n"
+	  "      (br_if $loop (i32.lt_u (local.get $i) (local.get $numRoundTrips)))\n"
+	  "    end\n"
+	  "    (local.get $i)\n"
+	  "  )\n"
+	  "  (func (export \"ping\") (param i32) (result i32) (call $run (local.get 0) (i32.const 0)))\n"
+	  "  (func (export \"pong\") (param i32) (result i32) (call $run (local.get 0) (i32.const 1)))\n"
+	  ")";
+
+static constexpr const char* instantiateBenchModuleWAST
+	= "(module\n"
+	  "  (memory 1)\n"
+	  "  (table 4 funcref)\n"
+	  "  (global $global (mut i32) (i32.const 0))\n"
+	  "  (func $getGlobal (result i32) (global.get $global))\n"
+	  "  (elem (i32.const 0) $getGlobal $getGlobal $getGlobal $getGlobal)\n"
+	  "  (data (i32.const 0) \"WAVM benchmark\")\n"
+	  "  (export \"getGlobal\" (func $getGlobal))\n"
+	  ")";
+
+static I64 pongThreadEntry(void* argument)
+{
+	ThreadArgs* threadArgs = (ThreadArgs*)argument;
+	invokeI32(threadArgs->context, threadArgs->function, I32(threadArgs->numOps));
+	return 0;
+}
+
+static void runRuntimeBench(BenchmarkSuite& suite)
+{
+	GCPointer<Compartment> compartment = Runtime::createCompartment();
+	GCPointer<Context> context = createContext(compartment);
+
+	// Benchmark instantiating a small module with a memory, a table, and segments.
+	ModuleRef instantiateModuleRef
+		= compileWAST(instantiateBenchModuleWAST, "instantiate benchmark module");
+	static constexpr Uptr numInstancesPerRepeat = 100;
+	suite.run("runtime/instantiateModule", 1, numInstancesPerRepeat, [&]() {
+		Timing::Timer timer;
+		for(Uptr instanceIndex = 0; instanceIndex < numInstancesPerRepeat; ++instanceIndex)
+		{ instantiateModule(compartment, instantiateModuleRef, {}, "instantiateBenchmark"); }
+		timer.stop();
+
+		collectCompartmentGarbage(compartment);
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark creating a context.
+	static constexpr Uptr numContextsPerRepeat = 1000;
+	suite.run("runtime/createContext", 1, numContextsPerRepeat, [&]() {
+		Timing::Timer timer;
+		for(Uptr contextIndex = 0; contextIndex < numContextsPerRepeat; ++contextIndex)
+		{ createContext(compartment); }
+		timer.stop();
+
+		collectCompartmentGarbage(compartment);
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark growing a memory one page at a time.
+	ModuleRef memoryGrowModule
+		= compileWAST(memoryGrowBenchModuleWAST, "memory.grow benchmark module");
+	static constexpr Uptr numGrowsPerRepeat = 1000;
+	suite.run("runtime/memory.grow", 1, numGrowsPerRepeat, [&]() {
+		Instance* instance
+			= instantiateModule(compartment, memoryGrowModule, {}, "memoryGrowBenchmark");
+		Function* function = asFunction(getInstanceExport(instance, "grow"));
+
+		Timing::Timer timer;
+		WAVM_ERROR_UNLESS(invokeI32(context, function, I32(numGrowsPerRepeat))
+						  == I32(numGrowsPerRepeat));
+		timer.stop();
+
+		collectCompartmentGarbage(compartment);
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark call_indirect through a table of functions with the same signature.
+	ModuleRef callIndirectModule
+		= compileWAST(callIndirectBenchModuleWAST, "call_indirect benchmark module");
+	GCPointer<Instance> callIndirectInstance
+		= instantiateModule(compartment, callIndirectModule, {}, "callIndirectBenchmark");
+	Function* callIndirectFunction
+		= asFunction(getInstanceExport(callIndirectInstance, "callIndirect"));
+	static constexpr Uptr numCallIndirectsPerRepeat = 10000000;
+	suite.run("call/call_indirect", 1, numCallIndirectsPerRepeat, [&]() {
+		Timing::Timer timer;
+		invokeI32(context, callIndirectFunction, I32(numCallIndirectsPerRepeat));
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark interpreter dispatch loops that call a handler for each instruction from a loop,
+	// and that tail call from each handler to the next.
+	ModuleRef dispatchModule = compileWAST(dispatchBenchModuleWAST, "dispatch benchmark module");
+	GCPointer<Instance> dispatchInstance
+		= instantiateModule(compartment, dispatchModule, {}, "dispatchBenchmark");
+	static constexpr Uptr numDispatchIterationsPerRepeat = 1000000;
+	for(const char* exportName : {"trampolined", "threaded"})
+	{
+		Function* dispatchFunction = asFunction(getInstanceExport(dispatchInstance, exportName));
+		suite.run(std::string("call/dispatch ") + exportName,
+				  1,
+				  numDispatchIterationsPerRepeat * 3,
+				  [&]() {
+					  Timing::Timer timer;
+					  WAVM_ERROR_UNLESS(
+						  invokeI32(context, dispatchFunction, I32(numDispatchIterationsPerRepeat))
+						  == I32(numDispatchIterationsPerRepeat));
+					  return timer.getNanoseconds();
+				  });
+	}
+
+	// Benchmark trapping in WebAssembly code and catching the trap in the host.
+	ModuleRef trapModule = compileWAST(trapBenchModuleWAST, "trap benchmark module");
+	GCPointer<Instance> trapInstance
+		= instantiateModule(compartment, trapModule, {}, "trapBenchmark");
+	Function* trapFunction = asFunction(getInstanceExport(trapInstance, "trap"));
+	static constexpr Uptr numTrapsPerRepeat = 1000;
+	suite.run("runtime/trap and catch", 1, numTrapsPerRepeat, [&]() {
+		Timing::Timer timer;
+		for(Uptr trapIndex = 0; trapIndex < numTrapsPerRepeat; ++trapIndex)
+		{
+			catchRuntimeExceptions([&]() { invokeI32(context, trapFunction, 0); },
+								   [](Exception* exception) { destroyException(exception); });
+		}
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark a pair of threads waking each other with memory.atomic.notify.
+	ModuleRef pingPongModule = compileWAST(pingPongBenchModuleWAST, "ping-pong benchmark module");
+	GCPointer<Instance> pingPongInstance
+		= instantiateModule(compartment, pingPongModule, {}, "pingPongBenchmark");
+	Function* pingFunction = asFunction(getInstanceExport(pingPongInstance, "ping"));
+	Function* pongFunction = asFunction(getInstanceExport(pingPongInstance, "pong"));
+	static constexpr Uptr numRoundTripsPerRepeat = 10000;
+	suite.run("atomics/wait-notify ping-pong", 2, numRoundTripsPerRepeat, [&]() {
+		ThreadArgs pongThreadArgs;
+		pongThreadArgs.context = createContext(compartment);
+		pongThreadArgs.function = pongFunction;
+		pongThreadArgs.numOps = numRoundTripsPerRepeat;
+
+		Timing::Timer timer;
+		pongThreadArgs.thread = Platform::createThread(512 * 1024, pongThreadEntry, &pongThreadArgs);
+		invokeI32(context, pingFunction, I32(numRoundTripsPerRepeat));
+		Platform::joinThread(pongThreadArgs.thread);
+		return timer.getNanoseconds();
+	});
+
+	// Benchmark a full garbage collection of a compartment with some live objects and some
+	// unreferenced objects.
+	static constexpr Uptr numGCInstances = 1000;
+	suite.run("gc/collectCompartmentGarbage", 1, 1, [&]() {
+		std::vector<GCPointer<Instance>> liveInstances;
+		for(Uptr instanceIndex = 0; instanceIndex < numGCInstances; ++instanceIndex)
+		{
+			Instance* instance
+				= instantiateModule(compartment, instantiateModuleRef, {}, "gcBenchmark");
+			if(instanceIndex & 1) { liveInstances.push_back(instance); }
+		}
+
+		Timing::Timer timer;
+		collectCompartmentGarbage(compartment);
+		timer.stop();
+
+		liveInstances.clear();
+		collectCompartmentGarbage(compartment);
+		return timer.getNanoseconds();
+	});
+
+	context = nullptr;
+	callIndirectInstance = nullptr;
+	trapInstance = nullptr;
+	pingPongInstance = nullptr;
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+}
+
+static void runObjectCacheBench(BenchmarkSuite& suite)
+{
+	if(!suite.objectCacheDir) { return; }
+
+	std::shared_ptr<ObjectCacheInterface> objectCache;
+	if(ObjectCache::open(suite.objectCacheDir, 64 * 1024 * 1024, 0, objectCache)
+	   != ObjectCache::OpenResult::success)
+	{
+		Log::printf(Log::error, "Couldn't open object cache in '%s'.\n", suite.objectCacheDir);
+		return;
+	}
+
+	// Use stand-in WASM bytes and object code, so the benchmarks measure only the cache. The WASM
+	// bytes start with the time, so they are unique to this run even if the cache already
+	// existed.
+	const std::vector<U8> objectCode(16 * 1024, 0xcc);
+	U64 wasmBytes[2] = {U64(Platform::getClockTime(Platform::Clock::realtime).ns), 0};
+	auto compileThunk = [&objectCode]() { return objectCode; };
+
+	static constexpr Uptr numLookupsPerRepeat = 1000;
+	suite.run("objectCache/miss", 1, numLookupsPerRepeat, [&]() {
+		Timing::Timer timer;
+		for(Uptr lookupIndex = 0; lookupIndex < numLookupsPerRepeat; ++lookupIndex)
+		{
+			++wasmBytes[1];
+			objectCache->getCachedObject((const U8*)wasmBytes, sizeof(wasmBytes), compileThunk);
+		}
+		return timer.getNanoseconds();
+	});
+
+	suite.run("objectCache/hit", 1, numLookupsPerRepeat, [&]() {
+		Timing::Timer timer;
+		for(Uptr lookupIndex = 0; lookupIndex < numLookupsPerRepeat; ++lookupIndex)
+		{ objectCache->getCachedObject((const U8*)wasmBytes, sizeof(wasmBytes), compileThunk); }
+		return timer.getNanoseconds();
+	});
+}
+
+// Times validating UTF-8 names like the ones in import, export, and name sections, with each byte
+// counted as an operation.
+static void runUnicodeBench(BenchmarkSuite& suite)
+{
+	static constexpr Uptr numNames = 1000;
+	std::string asciiNames;
+	std::string nonASCIINames;
+	for(Uptr nameIndex = 0; nameIndex < numNames; ++nameIndex)
+	{
+		asciiNames += "wasi_snapshot_preview1.fd_write_" + std::to_string(nameIndex);
+		nonASCIINames
+			+= "\xce\xbb_funci\xc3\xb3n_\xe5\x87\xbd\xe6\x95\xb0_" + std::to_string(nameIndex);
+	}
+
+	auto runValidateBench = [&suite](const char* name, const std::string& names) {
+		const U8* begin = (const U8*)names.data();
+		const U8* end = begin + names.size();
+		suite.run(name, 1, names.size(), [begin, end]() {
+			Timing::Timer timer;
+			WAVM_ERROR_UNLESS(Unicode::validateUTF8String(begin, end) == end);
+			return timer.getNanoseconds();
+		});
+	};
+	runValidateBench("unicode/validateUTF8/ascii", asciiNames);
+	runValidateBench("unicode/validateUTF8/non-ascii", nonASCIINames);
+}
+
+// Times loading a synthetic module from the binary format without validating its code, which is
+// dominated by decoding the code section. Each function definition is counted as an operation.
+static void runLoadBench(BenchmarkSuite& suite)
+{
+	if(!suite.isEnabled("load/synthetic")) { return; }
+
+	IR::Module syntheticModule(FeatureLevel::mature);
+	generateSyntheticModule(syntheticModule, SyntheticModuleConfig());
+	const std::vector<U8> wasmBytes = WASM::saveBinaryModule(syntheticModule);
+
+	suite.run("load/synthetic", 1, syntheticModule.functions.defs.size(), [&]() {
+		Timing::Timer timer;
+		IR::Module irModule(FeatureLevel::mature);
+		const bool loaded = WASM::loadBinaryModuleWithoutValidatingCode(
+			wasmBytes.data(), wasmBytes.size(), irModule);
+		timer.stop();
+
+		WAVM_ERROR_UNLESS(loaded);
+		return timer.getNanoseconds();
+	});
+}
+
+// Times compiling a module to object code for the host, with each function definition counted as
+// an operation.
+static void runCompileBench(BenchmarkSuite& suite, const char* name, const IR::Module& irModule)
+{
+	const LLVMJIT::TargetSpec targetSpec = LLVMJIT::getHostTargetSpec();
+	const Uptr numFunctionDefs = std::max(Uptr(1), irModule.functions.defs.size());
+	suite.run(std::string("compile/") + name, 1, numFunctionDefs, [&]() {
+		Timing::Timer timer;
+		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
+		WAVM_ERROR_UNLESS(objectCode.size());
+		return timer.getNanoseconds();
+	});
+}
+
+// Times compiling each module in the corpus given by --compile, and modules generated from fixed
+// seeds so there's something to compare across runs without any corpus files.
+static bool runCompileCorpusBench(BenchmarkSuite& suite)
+{
+	if(suite.isEnabled("compile/generated"))
+	{
+		// Generate the module from a fixed pseudo-random byte stream, so it's the same each run.
+		std::vector<U8> randomBytes(256 * 1024);
+		U32 state = 0x9e3779b9;
+		for(U8& randomByte : randomBytes)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			randomByte = U8(state);
+		}
+		RandomStream randomStream(randomBytes.data(), randomBytes.size());
+
+		IR::Module irModule(FeatureLevel::mature);
+		generateValidModule(irModule, randomStream);
+		runCompileBench(suite, "generated", irModule);
+	}
+
+	// Time compiling a module with a single small function, which is dominated by the fixed cost of
+	// each compile rather than by code generation. Each compile is an operation.
+	if(suite.isEnabled("compile/small"))
+	{
+		static const char smallWAST[]
+			= "(module\n"
+			  "  (func (export \"add\") (param i32 i32) (result i32)\n"
+			  "    (i32.add (local.get 0) (local.get 1))\n"
+			  "  )\n"
+			  ")\n";
+		IR::Module irModule(FeatureLevel::mature);
+		std::vector<WAST::Error> parseErrors;
+		if(!WAST::parseModule(smallWAST, sizeof(smallWAST), irModule, parseErrors))
+		{
+			WAST::reportParseErrors("small module", smallWAST, parseErrors);
+			Errors::fatalf("Failed to parse small module WAST");
+		}
+
+		const LLVMJIT::TargetSpec targetSpec = LLVMJIT::getHostTargetSpec();
+		static constexpr Uptr numCompilesPerRepeat = 100;
+		suite.run("compile/small", 1, numCompilesPerRepeat, [&]() {
+			Timing::Timer timer;
+			for(Uptr compileIndex = 0; compileIndex < numCompilesPerRepeat; ++compileIndex)
+			{
+				std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
+				WAVM_ERROR_UNLESS(objectCode.size());
+			}
+			return timer.getNanoseconds();
+		});
+	}
+
+	// Time compiling and instantiating a synthetic module with many functions and a large data
+	// segment.
+	if(suite.isEnabled("compile/synthetic") || suite.isEnabled("runtime/instantiateSynthetic"))
+	{
+		SyntheticModuleConfig config;
+		config.numDataSegmentBytes = 16 * 1024 * 1024;
+		IR::Module irModule(FeatureLevel::mature);
+		generateSyntheticModule(irModule, config);
+		runCompileBench(suite, "synthetic", irModule);
+
+		if(suite.isEnabled("runtime/instantiateSynthetic"))
+		{
+			GCPointer<Compartment> compartment = Runtime::createCompartment();
+			ModuleRef module = compileModule(irModule);
+			suite.run("runtime/instantiateSynthetic", 1, 1, [&]() {
+				Timing::Timer timer;
+				instantiateModule(compartment, module, {}, "synthetic");
+				timer.stop();
+
+				collectCompartmentGarbage(compartment);
+				return timer.getNanoseconds();
+			});
+			WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+		}
+	}
+
+	for(const char* filename : suite.compileCorpusFilenames)
+	{
+		// Name the benchmarks by the module's filename without its directory or extension.
+		std::string moduleName = filename;
+		moduleName = moduleName.substr(moduleName.find_last_of("/\\") + 1);
+		moduleName = moduleName.substr(0, moduleName.find_last_of('.'));
+		if(!suite.isEnabled("compile/" + moduleName)) { continue; }
+
+		IR::Module irModule(FeatureLevel::proposed);
+		if(!loadTextOrBinaryModule(filename, irModule)) { return false; }
+		runCompileBench(suite, moduleName.c_str(), irModule);
+	}
+
+	return true;
+}
+
+// Runs the benchmark commands in a WAST script, like those in Test/benchmark. Each benchmark
+// invokes an exported function once per operation.
+static bool runWASTBench(BenchmarkSuite& suite, const char* filename)
+{
+	std::vector<U8> wastBytes;
+	if(!loadFile(filename, wastBytes)) { return false; }
+	wastBytes.push_back(0);
+
+	std::vector<std::unique_ptr<WAST::Command>> commands;
+	std::vector<WAST::Error> parseErrors;
+	WAST::parseTestCommands((const char*)wastBytes.data(),
+							wastBytes.size(),
+							FeatureSpec(FeatureLevel::wavm),
+							commands,
+							parseErrors);
+	if(parseErrors.size())
+	{
+		WAST::reportParseErrors(filename, (const char*)wastBytes.data(), parseErrors);
+		return false;
+	}
+
+	// Name the benchmarks by the script's filename without its directory or extension.
+	std::string scriptName = filename;
+	scriptName = scriptName.substr(scriptName.find_last_of("/\\") + 1);
+	scriptName = scriptName.substr(0, scriptName.find_last_of('.'));
+
+	GCPointer<Compartment> compartment = Runtime::createCompartment();
+	Context* context = createContext(compartment);
+	HashMap<std::string, Instance*> namedInstances;
+	Instance* lastInstance = nullptr;
+	for(const std::unique_ptr<WAST::Command>& command : commands)
+	{
+		if(command->type == WAST::Command::action)
+		{
+			auto actionCommand = (WAST::ActionCommand*)command.get();
+			if(actionCommand->action->type != WAST::ActionType::_module) { continue; }
+
+			auto moduleAction = (WAST::ModuleAction*)actionCommand->action.get();
+			lastInstance = instantiateModule(
+				compartment, compileModule(*moduleAction->module), {}, std::string(filename));
+			if(moduleAction->internalModuleName.size())
+			{ namedInstances.set(moduleAction->internalModuleName, lastInstance); }
+		}
+		else if(command->type == WAST::Command::benchmark)
+		{
+			auto benchmarkCommand = (WAST::BenchmarkCommand*)command.get();
+			const WAST::InvokeAction* invokeAction = benchmarkCommand->invokeAction.get();
+
+			Instance* instance = lastInstance;
+			if(invokeAction->internalModuleName.size())
+			{
+				Instance** namedInstance = namedInstances.get(invokeAction->internalModuleName);
+				instance = namedInstance ? *namedInstance : nullptr;
+			}
+			Function* function = nullptr;
+			if(instance)
+			{ function = asFunctionNullable(getInstanceExport(instance, invokeAction->exportName)); }
+			if(!function)
+			{
+				Log::printf(Log::error,
+							"%s(%s): couldn't find exported function '%s'\n",
+							filename,
+							benchmarkCommand->locus.describe().c_str(),
+							invokeAction->exportName.c_str());
+				return false;
+			}
+
+			std::vector<UntaggedValue> args;
+			for(const Value& arg : invokeAction->arguments) { args.push_back(arg); }
+
+			// Trim the padding that some scripts use to align the benchmark names.
+			std::string name = benchmarkCommand->name;
+			name.erase(name.find_last_not_of(' ') + 1);
+
+			const FunctionType functionType = getFunctionType(function);
+			std::vector<UntaggedValue> results(functionType.results().size());
+			suite.run(scriptName + "/" + name, 1, 1, [&]() {
+				Timing::Timer timer;
+				invokeFunction(context, function, functionType, args.data(), results.data());
+				return timer.getNanoseconds();
+			});
+		}
+	}
+
+	context = nullptr;
+	lastInstance = nullptr;
+	namedInstances.clear();
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	return true;
+}
+
+void showBenchmarkHelp(WAVM::Log::Category outputCategory)
+{
+	Log::printf(outputCategory,
+				"Usage: wavm test bench [options] [WAST benchmark scripts...]\n"
+				"  --filter <string>           Only run benchmarks with names that contain the\n"
+				"                              string\n"
+				"  --repeats <n>               Time each benchmark n times (default: 20)\n"
+				"  --object-cache-dir <dir>    Run the object cache benchmarks with a cache in\n"
+				"                              the directory\n"
+				"  --compile <file>            Add a WebAssembly module to the corpus timed by\n"
+				"                              the compile/ benchmarks. May be repeated.\n"
+				"  --json                      Print the results as JSON\n"
+				"\n"
+				"Reports the time per operation for the minimum, median, 90th, and 99th\n"
+				"percentile, and maximum of the repeats. The benchmark commands in the\n"
+				"WAST scripts (e.g. Test/benchmark/*.wast) are run as additional benchmarks.\n"
+				"The compile/ benchmarks count each function definition as an operation.\n");
+}
+
 int execBenchmark(int argc, char** argv)
 {
-	if(argc != 0)
+	BenchmarkSuite suite;
+	bool printJSON = false;
+	for(int argIndex = 0; argIndex < argc; ++argIndex)
 	{
-		showBenchmarkHelp(Log::Category::error);
-		return EXIT_FAILURE;
+		if(!strcmp(argv[argIndex], "--filter") && argIndex + 1 < argc)
+		{ suite.filter = argv[++argIndex]; }
+		else if(!strcmp(argv[argIndex], "--repeats") && argIndex + 1 < argc)
+		{
+			const int numRepeats = atoi(argv[++argIndex]);
+			if(numRepeats <= 0)
+			{
+				Log::printf(Log::error, "--repeats must be followed by a positive integer.\n");
+				return EXIT_FAILURE;
+			}
+			suite.numRepeats = Uptr(numRepeats);
+		}
+		else if(!strcmp(argv[argIndex], "--object-cache-dir") && argIndex + 1 < argc)
+		{
+			suite.objectCacheDir = argv[++argIndex];
+		}
+		else if(!strcmp(argv[argIndex], "--compile") && argIndex + 1 < argc)
+		{
+			suite.compileCorpusFilenames.push_back(argv[++argIndex]);
+		}
+		else if(!strcmp(argv[argIndex], "--json"))
+		{
+			printJSON = true;
+		}
+		else if(argv[argIndex][0] != '-')
+		{
+			suite.wastFilenames.push_back(argv[argIndex]);
+		}
+		else
+		{
+			showBenchmarkHelp(Log::Category::error);
+			return EXIT_FAILURE;
+		}
 	}
 
-	const auto targetSpec = LLVMJIT::getHostTargetSpec();
-	Log::printf(Log::output,
-				"Host triple: %s\nHost CPU: %s\n",
-				targetSpec.triple.c_str(),
-				targetSpec.cpu.c_str());
+	runInvokeBench(suite);
+	runIntrinsicBench(suite, "call/intrinsic", "identity", false);
+	runIntrinsicBench(suite, "call/inline-intrinsic", "inlineIdentity", true);
+	runIntrinsicBench(suite, "call/pure-intrinsic", "pureIdentity", true);
+	runRuntimeBench(suite);
+	runObjectCacheBench(suite);
+	runUnicodeBench(suite);
+	runLoadBench(suite);
+	if(!runCompileCorpusBench(suite)) { return EXIT_FAILURE; }
+	for(const char* filename : suite.wastFilenames)
+	{
+		if(!runWASTBench(suite, filename)) { return EXIT_FAILURE; }
+	}
 
-	runInvokeBench();
-	runIntrinsicBench();
+	if(printJSON) { Log::printf(Log::output, "%s", formatResultsAsJSON(suite).c_str()); }
+	else
+	{
+		const auto targetSpec = LLVMJIT::getHostTargetSpec();
+		Log::printf(Log::output,
+					"Host triple: %s\nHost CPU: %s\n\n%-48s %10s %10s %10s %10s\n",
+					targetSpec.triple.c_str(),
+					targetSpec.cpu.c_str(),
+					"ns/op",
+					"min",
+					"p50",
+					"p90",
+					"p99");
+		for(const BenchmarkResult& result : suite.results)
+		{
+			Log::printf(Log::output,
+						"%-48s %10.2f %10.2f %10.2f %10.2f\n",
+						result.name.c_str(),
+						result.nsPerOp.front(),
+						result.getPercentile(50.0),
+						result.getPercentile(90.0),
+						result.getPercentile(99.0));
+		}
+	}
 
 	return 0;
 }
@@ -0,0 +1,136 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/RandomModule.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/WASM/WASM.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+static void showSyntheticModuleHelp(Log::Category outputCategory)
+{
+	SyntheticModuleConfig defaultConfig;
+	Log::printf(outputCategory,
+				"Usage: wavm test synthetic-module [options] <output .wasm>\n"
+				"  --seed <n>                   The seed (default: %" PRIu64 ")\n"
+				"  --functions <n>              Number of functions (default: %" WAVM_PRIuPTR ")\n"
+				"  --ops-per-function <n>       Operations in each function\n"
+				"                               (default: %" WAVM_PRIuPTR ")\n"
+				"  --call-depth <n>             Call graph depth (default: %" WAVM_PRIuPTR ")\n"
+				"  --call-density <f>           Fraction of operations that are calls\n"
+				"                               (default: %.2f)\n"
+				"  --call-indirect-density <f>  Fraction of operations that are call_indirects\n"
+				"                               (default: %.2f)\n"
+				"  --memory-density <f>         Fraction of operations that are loads or stores\n"
+				"                               (default: %.2f)\n"
+				"  --simd-density <f>           Fraction of operations that are SIMD arithmetic\n"
+				"                               (default: %.2f)\n"
+				"  --data-bytes <n>             Bytes in the active data segments\n"
+				"                               (default: %" WAVM_PRIuPTR ")\n",
+				defaultConfig.seed,
+				defaultConfig.numFunctions,
+				defaultConfig.numOperationsPerFunction,
+				defaultConfig.callGraphDepth,
+				defaultConfig.callDensity,
+				defaultConfig.callIndirectDensity,
+				defaultConfig.memoryAccessDensity,
+				defaultConfig.simdDensity,
+				defaultConfig.numDataSegmentBytes);
+}
+
+int execGenerateSyntheticModule(int argc, char** argv)
+{
+	SyntheticModuleConfig config;
+	const char* outputFilename = nullptr;
+	for(int argIndex = 0; argIndex < argc; ++argIndex)
+	{
+		const char* arg = argv[argIndex];
+		const char* value = argIndex + 1 < argc ? argv[argIndex + 1] : nullptr;
+		if(arg[0] != '-')
+		{
+			if(outputFilename)
+			{
+				showSyntheticModuleHelp(Log::error);
+				return EXIT_FAILURE;
+			}
+			outputFilename = arg;
+			continue;
+		}
+		else if(!value)
+		{
+			Log::printf(Log::error, "Expected a value following '%s'.\n", arg);
+			return EXIT_FAILURE;
+		}
+
+		++argIndex;
+		if(!strcmp(arg, "--seed")) { config.seed = strtoull(value, nullptr, 0); }
+		else if(!strcmp(arg, "--functions"))
+		{
+			config.numFunctions = Uptr(strtoull(value, nullptr, 0));
+		}
+		else if(!strcmp(arg, "--ops-per-function"))
+		{
+			config.numOperationsPerFunction = Uptr(strtoull(value, nullptr, 0));
+		}
+		else if(!strcmp(arg, "--call-depth"))
+		{
+			config.callGraphDepth = Uptr(strtoull(value, nullptr, 0));
+		}
+		else if(!strcmp(arg, "--call-density"))
+		{
+			config.callDensity = atof(value);
+		}
+		else if(!strcmp(arg, "--call-indirect-density"))
+		{
+			config.callIndirectDensity = atof(value);
+		}
+		else if(!strcmp(arg, "--memory-density"))
+		{
+			config.memoryAccessDensity = atof(value);
+		}
+		else if(!strcmp(arg, "--simd-density"))
+		{
+			config.simdDensity = atof(value);
+		}
+		else if(!strcmp(arg, "--data-bytes"))
+		{
+			config.numDataSegmentBytes = Uptr(strtoull(value, nullptr, 0));
+		}
+		else
+		{
+			Log::printf(Log::error, "Unrecognized argument: %s\n", arg);
+			showSyntheticModuleHelp(Log::error);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!outputFilename)
+	{
+		showSyntheticModuleHelp(Log::error);
+		return EXIT_FAILURE;
+	}
+	if(!config.numFunctions || !config.callGraphDepth)
+	{
+		Log::printf(Log::error, "--functions and --call-depth must be at least 1.\n");
+		return EXIT_FAILURE;
+	}
+	if(config.numDataSegmentBytes > Uptr(1) << 31)
+	{
+		Log::printf(Log::error, "--data-bytes must be at most 2GiB.\n");
+		return EXIT_FAILURE;
+	}
+
+	IR::Module irModule(FeatureLevel::mature);
+	generateSyntheticModule(irModule, config);
+
+	std::vector<U8> wasmBytes = WASM::saveBinaryModule(irModule);
+	return saveFile(outputFilename, wasmBytes.data(), wasmBytes.size()) ? EXIT_SUCCESS
+																		: EXIT_FAILURE;
+}
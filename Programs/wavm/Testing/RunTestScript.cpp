@@ -46,12 +46,27 @@ struct Config
 	bool strictAssertInvalid{false};
 	bool strictAssertMalformed{false};
 	bool testCloning{false};
+	bool lazyMemoryClones{false};
 	bool traceTests{false};
 	bool traceLLVMIR{false};
 	bool traceAssembly{false};
+	bool asyncCompile{false};
+	bool backgroundGC{false};
 	FeatureSpec featureSpec{FeatureLevel::standard};
+	MemoryPoolRef memoryPool;
+	LLVMJIT::CompileOptions compileOptions;
 };
 
+// Collects a test compartment in the background after every few objects, so the collections run
+// while the script is using the compartment.
+static void enableTestBackgroundGC(Compartment* compartment)
+{
+	Runtime::BackgroundGCConfig backgroundGCConfig;
+	backgroundGCConfig.numObjectsPerCollection = 4;
+	backgroundGCConfig.numYoungCollectionsPerFullCollection = 1;
+	Runtime::enableBackgroundGC(compartment, backgroundGCConfig);
+}
+
 struct TestScriptState
 {
 	const char* scriptFilename;
@@ -74,6 +89,10 @@ struct TestScriptState
 	, compartment(Runtime::createCompartment())
 	, context(Runtime::createContext(compartment))
 	{
+		if(config.memoryPool) { Runtime::setCompartmentMemoryPool(compartment, config.memoryPool); }
+		if(config.lazyMemoryClones) { Runtime::setCompartmentLazyMemoryClones(compartment, true); }
+		if(config.backgroundGC) { enableTestBackgroundGC(compartment); }
+
 		moduleNameToInstanceMap.set(
 			"spectest",
 			Intrinsics::instantiateModule(
@@ -88,6 +107,7 @@ struct TestScriptState
 	{
 		compartment = Runtime::cloneCompartment(copyee.compartment);
 		context = Runtime::cloneContext(copyee.context, compartment);
+		if(config.backgroundGC) { enableTestBackgroundGC(compartment); }
 
 		lastInstance = Runtime::remapToClonedCompartment(copyee.lastInstance, compartment);
 
@@ -284,6 +304,14 @@ static void traceAssembly(const char* moduleName, ModuleConstRefParam compiledMo
 		Log::output, "%s object code disassembly:\n%s\n", moduleName, disassemblyString.c_str());
 }
 
+// Compiles a test module, on a compile thread if the script is run with --async-compile.
+static ModuleRef compileTestModule(TestScriptState& state, const IR::Module& irModule)
+{
+	if(!state.config.asyncCompile) { return compileModule(irModule); }
+	return waitForCompile(
+		compileModuleAsync(irModule, state.config.compileOptions, CompilePriority::interactive));
+}
+
 static bool processAction(TestScriptState& state, Action* action, std::vector<Value>& outResults)
 {
 	outResults.clear();
@@ -293,8 +321,10 @@ static bool processAction(TestScriptState& state, Action* action, std::vector<Va
 	case ActionType::_module: {
 		auto moduleAction = (ModuleAction*)action;
 
-		// Clear the previous module.
+		// Clear the previous module. Collect the young objects first, so the young collection is
+		// exercised by every test script before the full collection also checks the old objects.
 		state.lastInstance = nullptr;
+		collectYoungCompartmentGarbage(state.compartment);
 		collectCompartmentGarbage(state.compartment);
 
 		// Link and instantiate the module.
@@ -308,7 +338,7 @@ static bool processAction(TestScriptState& state, Action* action, std::vector<Va
 			if(state.config.traceLLVMIR)
 			{ traceLLVMIR(moduleDebugName.c_str(), *moduleAction->module); }
 
-			ModuleRef compiledModule = compileModule(*moduleAction->module);
+			ModuleRef compiledModule = compileTestModule(state, *moduleAction->module);
 
 			if(state.config.traceAssembly)
 			{ traceAssembly(moduleDebugName.c_str(), compiledModule); }
@@ -985,11 +1015,11 @@ static void processCommand(TestScriptState& state, const Command* command)
 				LinkResult linkResult = linkModule(*assertCommand->moduleAction->module, resolver);
 				if(linkResult.success)
 				{
-					auto instance
-						= instantiateModule(state.compartment,
-											compileModule(*assertCommand->moduleAction->module),
-											std::move(linkResult.resolvedImports),
-											"test module");
+					auto instance = instantiateModule(
+						state.compartment,
+						compileTestModule(state, *assertCommand->moduleAction->module),
+						std::move(linkResult.resolvedImports),
+						"test module");
 
 					// Call the module start function, if it has one.
 					Function* startFunction = getStartFunction(instance);
@@ -1417,6 +1447,24 @@ static void showHelp()
 		"                             module was invalid\n"
 		"  --test-cloning             Run each test command in the original compartment\n"
 		"                             and a clone of it, and compare the resulting state\n"
+		"  --lazy-memory-clones       Copy the pages of cloned memories when first accessed\n"
+		"  --lazy-compile             Defer compiling each module until it is instantiated\n"
+		"  --interpret                Execute modules with the interpreter where possible\n"
+		"  --compile-processes <N>    Compile modules in N helper processes\n"
+		"  --async-compile            Compile modules on WAVM's compile threads\n"
+		"  --background-gc            Collect garbage on WAVM's background GC thread\n"
+		"  --memory-pool <N>          Allocate 32-bit memories from a pool of N slots\n"
+		"  --memory-pool-protection-keys <N>\n"
+		"                             Allocate 32-bit memories from a pool of N slots\n"
+		"                             that are striped with memory protection keys\n"
+		"  --check-epoch-deadline     Compile modules with epoch deadline checks\n"
+		"  --meter-fuel               Compile modules with fuel metering\n"
+		"  --check-stack-limit        Compile modules with stack pointer checks at function entry\n"
+		"  --relaxed-nan              Compile modules with nondeterministic float NaNs\n"
+		"  --cache-stack-pointer      Compile modules with the stack pointer global cached\n"
+		"  --share-trap-blocks        Compile modules with shared trap blocks\n"
+		"  --eliminate-dead-functions Compile functions that can't be called as trapping stubs\n"
+		"  --specialize-instances     Recompile modules for each instance's imports\n"
 		"  --trace                    Prints instructions to stdout as they are compiled.\n"
 		"  --trace-tests              Prints test commands to stdout as they are executed.\n"
 		"  --trace-llvmir             Prints the LLVM IR for modules as they are compiled.\n"
@@ -1430,6 +1478,7 @@ int execRunTestScript(int argc, char** argv)
 	Uptr numLoops = 1;
 	std::vector<const char*> filenames;
 	Config config;
+	LLVMJIT::CompileOptions compileOptions;
 	for(int argIndex = 0; argIndex < argc; ++argIndex)
 	{
 		if(!strcmp(argv[argIndex], "--help") || !strcmp(argv[argIndex], "-h"))
@@ -1465,6 +1514,112 @@ int execRunTestScript(int argc, char** argv)
 		{
 			config.testCloning = true;
 		}
+		else if(!strcmp(argv[argIndex], "--lazy-memory-clones"))
+		{
+			config.lazyMemoryClones = true;
+		}
+		else if(!strcmp(argv[argIndex], "--lazy-compile"))
+		{
+			Runtime::setGlobalLazyCompilation(true);
+		}
+		else if(!strcmp(argv[argIndex], "--interpret"))
+		{
+			Runtime::setGlobalInterpretModules(true);
+		}
+		else if(!strcmp(argv[argIndex], "--specialize-instances"))
+		{
+			Runtime::setGlobalSpecializeInstances(true);
+		}
+		else if(!strcmp(argv[argIndex], "--check-epoch-deadline"))
+		{
+			compileOptions.checkEpochDeadline = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--meter-fuel"))
+		{
+			compileOptions.meterFuel = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--check-stack-limit"))
+		{
+			compileOptions.checkStackLimit = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--relaxed-nan"))
+		{
+			compileOptions.relaxedNaN = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--cache-stack-pointer"))
+		{
+			compileOptions.cacheStackPointer = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--share-trap-blocks"))
+		{
+			compileOptions.shareTrapBlocks = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--eliminate-dead-functions"))
+		{
+			compileOptions.eliminateDeadFunctions = true;
+			Runtime::setGlobalCompileOptions(compileOptions);
+		}
+		else if(!strcmp(argv[argIndex], "--compile-processes"))
+		{
+			if(argIndex + 1 >= argc)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			++argIndex;
+			long int numProcessesLongInt = strtol(argv[argIndex], nullptr, 10);
+			if(numProcessesLongInt <= 0)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			if(!Runtime::startCompileProcesses(Uptr(numProcessesLongInt)))
+			{
+				Log::printf(Log::debug,
+							"Compile processes aren't supported, so modules are compiled in this "
+							"process.\n");
+			}
+		}
+		else if(!strcmp(argv[argIndex], "--async-compile"))
+		{
+			config.asyncCompile = true;
+		}
+		else if(!strcmp(argv[argIndex], "--background-gc"))
+		{
+			config.backgroundGC = true;
+		}
+		else if(!strcmp(argv[argIndex], "--memory-pool")
+				|| !strcmp(argv[argIndex], "--memory-pool-protection-keys"))
+		{
+			const bool useProtectionKeys
+				= !strcmp(argv[argIndex], "--memory-pool-protection-keys");
+			if(argIndex + 1 >= argc)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			++argIndex;
+			long int numSlotsLongInt = strtol(argv[argIndex], nullptr, 10);
+			if(numSlotsLongInt <= 0)
+			{
+				showHelp();
+				return EXIT_FAILURE;
+			}
+			config.memoryPool
+				= Runtime::createMemoryPool(Uptr(numSlotsLongInt), useProtectionKeys);
+			if(!config.memoryPool)
+			{
+				Log::printf(
+					Log::error, "Couldn't reserve a pool of %s memories.\n", argv[argIndex]);
+				return EXIT_FAILURE;
+			}
+		}
 		else if(!strcmp(argv[argIndex], "--trace"))
 		{
 			Log::setCategoryEnabled(Log::traceValidation, true);
@@ -1515,6 +1670,7 @@ int execRunTestScript(int argc, char** argv)
 		showHelp();
 		return EXIT_FAILURE;
 	}
+	config.compileOptions = compileOptions;
 
 	Uptr loopIndex = 0;
 	while(true)
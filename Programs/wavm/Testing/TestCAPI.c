@@ -1,4 +1,6 @@
 #include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include "WAVM/wavm-c/wavm-c.h"
 #include "wavm-test.h"
@@ -30,7 +32,16 @@ int execCAPITest(int argc, char** argv)
 		   0x00, 0x01, 0x84, 0x80, 0x80, 0x80, 0x00, 0x00, 0x10, 0x00, 0x0b};
 
 	// Compile.
-	own wasm_module_t* module = wasm_module_new(engine, hello_wasm, sizeof(hello_wasm));
+	own wasm_module_t* compiled_module = wasm_module_new(engine, hello_wasm, sizeof(hello_wasm));
+	if(!compiled_module) { return 1; }
+
+	// Round trip the module through the serialized format, and use the deserialized module.
+	size_t num_serialized_bytes = 0;
+	own char* serialized_bytes = wasm_module_serialize(compiled_module, &num_serialized_bytes);
+	wasm_module_delete(compiled_module);
+	own wasm_module_t* module
+		= wasm_module_deserialize(engine, serialized_bytes, num_serialized_bytes);
+	free(serialized_bytes);
 	if(!module) { return 1; }
 
 	// Create external print functions.
@@ -48,8 +59,20 @@ int execCAPITest(int argc, char** argv)
 
 	wasm_func_delete(hello_func);
 
-	// Extract export.
-	wasm_extern_t* run_extern = wasm_instance_export(instance, 0);
+	// Resolve the index of the export from the module, with and without its type, and use it
+	// to extract the export.
+	size_t run_index = wavm_module_export_index(module, "run", 3, NULL);
+	if(run_index != 0) { return 1; }
+	own wasm_functype_t* run_expected_type = wasm_functype_new_0_0();
+	const wasm_externtype_t* run_expected_externtype
+		= wasm_functype_as_externtype_const(run_expected_type);
+	if(wavm_module_export_index(module, "run", 3, run_expected_externtype) != run_index)
+	{ return 1; }
+	if(wavm_module_export_index(module, "hello", 5, run_expected_externtype) != SIZE_MAX)
+	{ return 1; }
+	wasm_functype_delete(run_expected_type);
+
+	wasm_extern_t* run_extern = wasm_instance_export(instance, run_index);
 	if(run_extern == NULL) { return 1; }
 	const wasm_func_t* run_func = wasm_extern_as_func(run_extern);
 	if(run_func == NULL) { return 1; }
@@ -60,13 +83,20 @@ int execCAPITest(int argc, char** argv)
 	// Call.
 	if(wasm_func_call(store, run_func, NULL, NULL)) { return 1; }
 
+	// Call again without checking the arguments. Function types are interned, so getting the type
+	// again returns the same type.
+	own wasm_functype_t* run_type = wasm_func_type(run_func);
+	if(run_type != wasm_func_type(run_func)) { return 1; }
+	if(wavm_func_call_unchecked(store, run_func, run_type, NULL, NULL)) { return 1; }
+	wasm_functype_delete(run_type);
+
 	// Shut down.
 	wasm_store_delete(store);
 	wasm_compartment_delete(compartment);
 	wasm_engine_delete(engine);
 
-	// Assert that the callback was called exactly once.
-	if(numCallbacks != 1) { return 1; }
+	// Assert that the callback was called exactly once by each call.
+	if(numCallbacks != 2) { return 1; }
 
 	return 0;
 }
@@ -0,0 +1,110 @@
+#include <vector>
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char contextTimesTestWAST[]
+	= "(module\n"
+	  "  (memory 1 1 shared)\n"
+	  "  (func (export \"spin\") (param $n i32)\n"
+	  "    (loop $loop\n"
+	  "      (local.set $n (i32.sub (local.get $n) (i32.const 1)))\n"
+	  "      (br_if $loop (local.get $n))))\n"
+	  "  (func (export \"wait\") (param $timeout i64) (result i32)\n"
+	  "    (memory.atomic.wait32 (i32.const 0) (i32.const 0) (local.get $timeout)))\n"
+	  ")";
+
+// The timeout of the wait, in nanoseconds.
+static constexpr U64 waitNanoseconds = 20000000;
+
+I32 execContextTimesTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule(FeatureLevel::proposed);
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(
+		   contextTimesTestWAST, sizeof(contextTimesTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("context times test", contextTimesTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+	ModuleRef module = compileModule(irModule);
+
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		GCPointer<Context> context = createContext(compartment);
+		GCPointer<Instance> instance
+			= instantiateModule(compartment, module, {}, "contextTimesTest");
+		Function* spinFunction
+			= getTypedInstanceExport(instance, "spin", FunctionType({}, {ValueType::i32}));
+		Function* waitFunction = getTypedInstanceExport(
+			instance, "wait", FunctionType({ValueType::i32}, {ValueType::i64}));
+		WAVM_ERROR_UNLESS(spinFunction && waitFunction);
+
+		auto spin = [&]() {
+			UntaggedValue arguments[1] = {I32(10000000)};
+			invokeFunction(context, spinFunction, getFunctionType(spinFunction), arguments);
+		};
+		auto wait = [&]() {
+			UntaggedValue arguments[1] = {waitNanoseconds};
+			UntaggedValue results[1];
+			invokeFunction(
+				context, waitFunction, getFunctionType(waitFunction), arguments, results);
+
+			// The wait should have timed out.
+			WAVM_ERROR_UNLESS(results[0].i32 == 2);
+		};
+
+		// A context doesn't account its times until it's enabled.
+		spin();
+		ContextTimes times = getContextTimes(context);
+		WAVM_ERROR_UNLESS(!times.numInvokes && !times.wallNanoseconds && !times.cpuNanoseconds
+						  && !times.atomicWaitNanoseconds);
+
+		// Each invoke is accounted once, and a busy loop uses CPU time.
+		setContextTimeAccounting(context, true);
+		spin();
+		times = getContextTimes(context);
+		WAVM_ERROR_UNLESS(times.numInvokes == 1);
+		WAVM_ERROR_UNLESS(times.wallNanoseconds > 0 && times.cpuNanoseconds > 0);
+		WAVM_ERROR_UNLESS(!times.atomicWaitNanoseconds);
+
+		// Time spent blocked in an atomic wait is accounted as wall and wait time.
+		wait();
+		const ContextTimes waitTimes = getContextTimes(context);
+		WAVM_ERROR_UNLESS(waitTimes.numInvokes == 2);
+		WAVM_ERROR_UNLESS(waitTimes.atomicWaitNanoseconds >= waitNanoseconds);
+		WAVM_ERROR_UNLESS(waitTimes.wallNanoseconds - times.wallNanoseconds >= waitNanoseconds);
+
+		// Disabling accounting leaves the times as they were.
+		setContextTimeAccounting(context, false);
+		spin();
+		times = getContextTimes(context);
+		WAVM_ERROR_UNLESS(times.numInvokes == waitTimes.numInvokes);
+		WAVM_ERROR_UNLESS(times.cpuNanoseconds == waitTimes.cpuNanoseconds);
+
+		// Enabling it again resets the times.
+		setContextTimeAccounting(context, true);
+		times = getContextTimes(context);
+		WAVM_ERROR_UNLESS(!times.numInvokes && !times.wallNanoseconds && !times.cpuNanoseconds
+						  && !times.atomicWaitNanoseconds);
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran context times tests", timer);
+	return 0;
+}
@@ -0,0 +1,246 @@
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Fiber.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Runtime/Intrinsics.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/VFS/VFS.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+WAVM_DEFINE_INTRINSIC_MODULE(fiberTest)
+
+// The values passed to suspend by each fiber, in the order they were passed.
+static std::vector<std::pair<Runtime::Fiber*, I32>> suspendedValues;
+
+// If the fibers' compartment uses protection keys, the thread's rights outside of invokes.
+static bool checkProtectionKeyRights = false;
+static U32 hostProtectionKeyRights = 0;
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(fiberTest, "suspend", I32, fiberTest_suspend, I32 value)
+{
+	suspendedValues.push_back({getCurrentFiber(), value});
+
+	// The fiber's code runs with the compartment's restricted rights, and keeps them when it is
+	// resumed from outside of an invoke.
+	U32 fiberProtectionKeyRights = 0;
+	if(checkProtectionKeyRights)
+	{
+		fiberProtectionKeyRights = Platform::getProtectionKeyRights();
+		WAVM_ERROR_UNLESS(fiberProtectionKeyRights != hostProtectionKeyRights);
+	}
+	suspendFiber();
+	if(checkProtectionKeyRights)
+	{ WAVM_ERROR_UNLESS(Platform::getProtectionKeyRights() == fiberProtectionKeyRights); }
+
+	return value;
+}
+
+// Whether the fiber that calls readFile is expected to be suspendable, and the file it reads.
+static bool expectSuspendable = false;
+static VFS::VFD* ioURingFile = nullptr;
+
+WAVM_DEFINE_INTRINSIC_FUNCTION(fiberTest, "readFile", I32, fiberTest_readFile)
+{
+	WAVM_ERROR_UNLESS(Platform::isCurrentFiberSuspendable() == expectSuspendable);
+	if(!ioURingFile) { return 0; }
+
+	// The read switches from the fiber until it completes only if the fiber is suspendable.
+	U8 buffer[4];
+	VFS::IOReadBuffer readBuffer{buffer, sizeof(buffer)};
+	Uptr numBytesRead = 0;
+	const U64 offset = 0;
+	WAVM_ERROR_UNLESS(ioURingFile->readv(&readBuffer, 1, &numBytesRead, &offset)
+					  == VFS::Result::success);
+	return I32(numBytesRead);
+}
+
+static const char fiberTestWAST[]
+	= "(module\n"
+	  "  (import \"fiberTest\" \"suspend\" (func $suspend (param i32) (result i32)))\n"
+	  "  (import \"fiberTest\" \"readFile\" (func $readFile (result i32)))\n"
+	  "  (memory 1)\n"
+	  "  (func (export \"sum\") (param $n i32) (result i32)\n"
+	  "    (local $sum i32)\n"
+	  "    (block $done\n"
+	  "      (loop $loop\n"
+	  "        (br_if $done (i32.eqz (local.get $n)))\n"
+	  "        (local.set $sum (i32.add (local.get $sum) (call $suspend (local.get $n))))\n"
+	  "        (local.set $n (i32.sub (local.get $n) (i32.const 1)))\n"
+	  "        (br $loop)))\n"
+	  "    (local.get $sum))\n"
+	  "  (func (export \"trapAfterSuspend\")\n"
+	  "    (drop (call $suspend (i32.const 0)))\n"
+	  "    unreachable)\n"
+	  "  (func $recurse (export \"recurse\") (call $recurse))\n"
+	  "  (func (export \"readFile\") (result i32) (call $readFile))\n"
+	  ")";
+
+I32 execFiberTest(int argc, char** argv)
+{
+	// With --memory-pool-protection-keys, the fibers' compartment allocates its memories from a
+	// pool that uses protection keys.
+	bool useProtectionKeys = false;
+	if(argc == 1 && !strcmp(argv[0], "--memory-pool-protection-keys")) { useProtectionKeys = true; }
+	else if(argc)
+	{
+		Log::printf(Log::error, "Usage: wavm test fiber [--memory-pool-protection-keys]\n");
+		return EXIT_FAILURE;
+	}
+
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(fiberTestWAST, sizeof(fiberTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("fiber test", fiberTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+	ModuleRef module = compileModule(irModule);
+
+	GCPointer<Compartment> compartment = createCompartment();
+	if(useProtectionKeys)
+	{
+		const I32 protectionKey = Platform::allocateMemoryProtectionKey();
+		if(protectionKey < 0)
+		{
+			Log::printf(Log::output,
+						"Not checking protection key rights: the platform doesn't support them.\n");
+		}
+		else
+		{
+			Platform::freeMemoryProtectionKey(protectionKey);
+			checkProtectionKeyRights = true;
+			hostProtectionKeyRights = Platform::getProtectionKeyRights();
+		}
+
+		MemoryPoolRef memoryPool = createMemoryPool(4, true);
+		WAVM_ERROR_UNLESS(memoryPool);
+		setCompartmentMemoryPool(compartment, memoryPool);
+	}
+	{
+		GCPointer<Context> context = createContext(compartment);
+		Instance* intrinsicsInstance = Intrinsics::instantiateModule(
+			compartment, {WAVM_INTRINSIC_MODULE_REF(fiberTest)}, "fiberTest");
+		Function* suspendFunction = getTypedInstanceExport(
+			intrinsicsInstance, "suspend", FunctionType({ValueType::i32}, {ValueType::i32}));
+		Function* readFileFunction = getTypedInstanceExport(
+			intrinsicsInstance, "readFile", FunctionType({ValueType::i32}, {}));
+		GCPointer<Instance> instance
+			= instantiateModule(compartment,
+								module,
+								{asObject(suspendFunction), asObject(readFileFunction)},
+								"fiberTest");
+
+		// Run two fibers interleaved on this thread, and check that each resumes where it was
+		// suspended.
+		const FunctionType i32_to_i32({ValueType::i32}, {ValueType::i32});
+		Function* sumFunction = getTypedInstanceExport(instance, "sum", i32_to_i32);
+		WAVM_ERROR_UNLESS(sumFunction);
+		UntaggedValue fiberArgs[2] = {I32(3), I32(5)};
+		Runtime::Fiber* fibers[2] = {createFiber(context, sumFunction, i32_to_i32, &fiberArgs[0]),
+									 createFiber(context, sumFunction, i32_to_i32, &fiberArgs[1])};
+		UntaggedValue results[2];
+		bool isFinished[2] = {false, false};
+		Uptr numResumes = 0;
+		while(!isFinished[0] || !isFinished[1])
+		{
+			for(Uptr fiberIndex = 0; fiberIndex < 2; ++fiberIndex)
+			{
+				if(isFinished[fiberIndex]) { continue; }
+				isFinished[fiberIndex] = resumeFiber(fibers[fiberIndex], &results[fiberIndex]);
+				WAVM_ERROR_UNLESS(!getCurrentFiber());
+				WAVM_ERROR_UNLESS(!checkProtectionKeyRights
+								  || Platform::getProtectionKeyRights() == hostProtectionKeyRights);
+				++numResumes;
+			}
+		}
+		WAVM_ERROR_UNLESS(results[0].i32 == 3 + 2 + 1);
+		WAVM_ERROR_UNLESS(results[1].i32 == 5 + 4 + 3 + 2 + 1);
+		WAVM_ERROR_UNLESS(numResumes == 4 + 6);
+		WAVM_ERROR_UNLESS(suspendedValues.size() == 3 + 5);
+		WAVM_ERROR_UNLESS(suspendedValues[0].first == fibers[0] && suspendedValues[0].second == 3);
+		WAVM_ERROR_UNLESS(suspendedValues[1].first == fibers[1] && suspendedValues[1].second == 5);
+		WAVM_ERROR_UNLESS(suspendedValues[6].first == fibers[1] && suspendedValues[6].second == 2);
+		destroyFiber(fibers[0]);
+		destroyFiber(fibers[1]);
+
+		// A suspended fiber may be destroyed without resuming it.
+		Runtime::Fiber* abandonedFiber
+			= createFiber(context, sumFunction, i32_to_i32, &fiberArgs[0]);
+		WAVM_ERROR_UNLESS(!resumeFiber(abandonedFiber, &results[0]));
+		destroyFiber(abandonedFiber);
+
+		// Runtime exceptions thrown on a fiber are rethrown by resumeFiber.
+		auto expectException = [&](const char* exportName, Runtime::ExceptionType* expectedType) {
+			Function* function = getTypedInstanceExport(instance, exportName, FunctionType());
+			WAVM_ERROR_UNLESS(function);
+			Runtime::Fiber* fiber = createFiber(context, function);
+			Runtime::ExceptionType* caughtType = nullptr;
+			catchRuntimeExceptions(
+				[&]() {
+					while(!resumeFiber(fiber)) {}
+				},
+				[&](Exception* exception) {
+					caughtType = getExceptionType(exception);
+					destroyException(exception);
+				});
+			WAVM_ERROR_UNLESS(caughtType == expectedType);
+			destroyFiber(fiber);
+		};
+		expectException("trapAfterSuspend", ExceptionTypes::reachedUnreachable);
+		expectException("recurse", ExceptionTypes::stackOverflow);
+
+		// File I/O through io_uring only suspends fibers that are run by resumeFiber: a function
+		// invoked on a fiber stack by invokeFunctionOnFiberStack blocks the thread instead.
+		Platform::HostFS* ioURingFS = Platform::getIOURingHostFS();
+		if(ioURingFS)
+		{
+			WAVM_ERROR_UNLESS(ioURingFS->open("/proc/self/exe",
+											  VFS::FileAccessMode::readOnly,
+											  VFS::FileCreateMode::openExisting,
+											  ioURingFile)
+							  == VFS::Result::success);
+		}
+		const I32 expectedNumBytesRead = ioURingFile ? 4 : 0;
+		const FunctionType none_to_i32({ValueType::i32}, {});
+		Function* readFunction = getTypedInstanceExport(instance, "readFile", none_to_i32);
+		WAVM_ERROR_UNLESS(readFunction);
+
+		expectSuspendable = false;
+		invokeFunctionOnFiberStack(context, readFunction, none_to_i32, nullptr, &results[0]);
+		WAVM_ERROR_UNLESS(results[0].i32 == expectedNumBytesRead);
+
+		expectSuspendable = true;
+		Runtime::Fiber* readFiber = createFiber(context, readFunction, none_to_i32);
+		while(!resumeFiber(readFiber, &results[0])) { Platform::pollIOURing(true); }
+		WAVM_ERROR_UNLESS(results[0].i32 == expectedNumBytesRead);
+		destroyFiber(readFiber);
+
+		if(ioURingFile)
+		{
+			WAVM_ERROR_UNLESS(ioURingFile->close() == VFS::Result::success);
+			ioURingFile = nullptr;
+		}
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran Fiber tests", timer);
+
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <initializer_list>
 #include <memory>
 #include <string>
@@ -8,11 +9,17 @@
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/Hash.h"
 #include "WAVM/Inline/HashMap.h"
+#include "WAVM/Inline/HashTable.h"
 #include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
 #include "wavm-test.h"
 
 using namespace WAVM;
 
+// The tests are run with each hash table implementation.
+template<typename Key, typename Value, typename TableImplPolicy>
+using TestMap = HashMap<Key, Value, DefaultHashPolicy<Key>, TableImplPolicy>;
+
 static std::string generateRandomString()
 {
 	static constexpr Uptr maxChars = 16;
@@ -25,11 +32,11 @@ static std::string generateRandomString()
 	return std::string(buffer);
 }
 
-static void testStringMap()
+template<typename TableImplPolicy> static void testStringMap()
 {
 	static constexpr Uptr numStrings = 1000;
 
-	HashMap<std::string, U32> map;
+	TestMap<std::string, U32, TableImplPolicy> map;
 	std::vector<HashMapPair<std::string, U32>> pairs;
 
 	srand(0);
@@ -91,9 +98,9 @@ static void testStringMap()
 	}
 }
 
-static void testU32Map()
+template<typename TableImplPolicy> static void testU32Map()
 {
-	HashMap<U32, U32> map;
+	TestMap<U32, U32, TableImplPolicy> map;
 
 	static constexpr Uptr maxI = 1024 * 1024;
 
@@ -125,14 +132,14 @@ static void testU32Map()
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wself-assign"
 #endif
-static void testMapCopy()
+template<typename TableImplPolicy> static void testMapCopy()
 {
 	// Add 1000..1999 to a HashMap.
-	HashMap<Uptr, Uptr> a;
+	TestMap<Uptr, Uptr, TableImplPolicy> a;
 	for(Uptr i = 0; i < 1000; ++i) { a.add(i + 1000, i); }
 
 	// Copy the map to a new HashMap.
-	HashMap<Uptr, Uptr> b{a};
+	TestMap<Uptr, Uptr, TableImplPolicy> b{a};
 
 	// Test that both the new and old HashMap contain the expected numbers.
 	for(Uptr i = 0; i < 1000; ++i)
@@ -170,14 +177,14 @@ static void testMapCopy()
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wself-move"
 #endif
-static void testMapMove()
+template<typename TableImplPolicy> static void testMapMove()
 {
 	// Add 1000..1999 to a HashMap.
-	HashMap<Uptr, Uptr> a;
+	TestMap<Uptr, Uptr, TableImplPolicy> a;
 	for(Uptr i = 0; i < 1000; ++i) { a.add(i + 1000, i); }
 
 	// Move the map to a new HashMap.
-	HashMap<Uptr, Uptr> b{std::move(a)};
+	TestMap<Uptr, Uptr, TableImplPolicy> b{std::move(a)};
 
 	// Test that the new HashMap contains the expected numbers.
 	for(Uptr i = 0; i < 1000; ++i)
@@ -202,9 +209,10 @@ static void testMapMove()
 #pragma clang diagnostic pop
 #endif
 
-static void testMapInitializerList()
+template<typename TableImplPolicy> static void testMapInitializerList()
 {
-	HashMap<Uptr, Uptr> map{{1, 1}, {3, 2}, {5, 3}, {7, 4}, {11, 5}, {13, 6}, {17, 7}};
+	TestMap<Uptr, Uptr, TableImplPolicy> map{
+		{1, 1}, {3, 2}, {5, 3}, {7, 4}, {11, 5}, {13, 6}, {17, 7}};
 	WAVM_ERROR_UNLESS(!map.get(0));
 	WAVM_ERROR_UNLESS(map[1] == 1);
 	WAVM_ERROR_UNLESS(!map.get(2));
@@ -225,10 +233,10 @@ static void testMapInitializerList()
 	WAVM_ERROR_UNLESS(map[17] == 7);
 }
 
-static void testMapIterator()
+template<typename TableImplPolicy> static void testMapIterator()
 {
 	// Add 1..9 to a HashMap.
-	HashMap<Uptr, Uptr> a;
+	TestMap<Uptr, Uptr, TableImplPolicy> a;
 	for(Uptr i = 1; i < 10; ++i) { a.add(i, i * 2); }
 
 	// 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9 = 45
@@ -261,9 +269,9 @@ static void testMapIterator()
 	}
 }
 
-static void testMapGetOrAdd()
+template<typename TableImplPolicy> static void testMapGetOrAdd()
 {
-	HashMap<Uptr, Uptr> map;
+	TestMap<Uptr, Uptr, TableImplPolicy> map;
 
 	WAVM_ERROR_UNLESS(!map.get(0));
 	WAVM_ERROR_UNLESS(map.getOrAdd(0, 1) == 1);
@@ -274,9 +282,9 @@ static void testMapGetOrAdd()
 	WAVM_ERROR_UNLESS(map[0] == 8);
 }
 
-static void testMapSet()
+template<typename TableImplPolicy> static void testMapSet()
 {
-	HashMap<Uptr, Uptr> map;
+	TestMap<Uptr, Uptr, TableImplPolicy> map;
 
 	WAVM_ERROR_UNLESS(!map.get(0));
 	WAVM_ERROR_UNLESS(map.set(0, 1) == 1);
@@ -293,9 +301,9 @@ struct EmplacedValue
 	EmplacedValue(const std::string& inA, const std::string& inB) : a(inA), b(inB) {}
 };
 
-static void testMapEmplace()
+template<typename TableImplPolicy> static void testMapEmplace()
 {
-	HashMap<Uptr, EmplacedValue> map;
+	TestMap<Uptr, EmplacedValue, TableImplPolicy> map;
 
 	EmplacedValue& a = map.getOrAdd(0, "a", "b");
 	WAVM_ERROR_UNLESS(a.a == "a");
@@ -315,9 +323,10 @@ static void testMapEmplace()
 	WAVM_ERROR_UNLESS(d.b == "f");
 }
 
-static void testMapBracketOperator()
+template<typename TableImplPolicy> static void testMapBracketOperator()
 {
-	HashMap<Uptr, Uptr> map{{1, 1}, {3, 2}, {5, 3}, {7, 4}, {11, 5}, {13, 6}, {17, 7}};
+	TestMap<Uptr, Uptr, TableImplPolicy> map{
+		{1, 1}, {3, 2}, {5, 3}, {7, 4}, {11, 5}, {13, 6}, {17, 7}};
 	WAVM_ERROR_UNLESS(map[1] == 1);
 	WAVM_ERROR_UNLESS(map[3] == 2);
 	WAVM_ERROR_UNLESS(map[5] == 3);
@@ -327,19 +336,157 @@ static void testMapBracketOperator()
 	WAVM_ERROR_UNLESS(map[17] == 7);
 }
 
+template<typename TableImplPolicy> static void testMapChurn()
+{
+	// Repeatedly add and remove random keys from a small range, so the table reuses the buckets
+	// of removed keys, and compare the map to a bit vector of the keys it should contain.
+	static constexpr Uptr numKeys = 4096;
+	TestMap<Uptr, Uptr, TableImplPolicy> map;
+	std::vector<bool> expectedKeys(numKeys, false);
+	Uptr expectedSize = 0;
+
+	srand(0);
+	for(Uptr i = 0; i < 200000; ++i)
+	{
+		const Uptr key = Uptr(rand()) % numKeys;
+		if(expectedKeys[key])
+		{
+			WAVM_ERROR_UNLESS(map.remove(key));
+			--expectedSize;
+		}
+		else
+		{
+			WAVM_ERROR_UNLESS(map.add(key, key * 3));
+			++expectedSize;
+		}
+		expectedKeys[key] = !expectedKeys[key];
+		WAVM_ERROR_UNLESS(map.size() == expectedSize);
+	}
+
+	Uptr numIteratedPairs = 0;
+	for(const auto& pair : map)
+	{
+		WAVM_ERROR_UNLESS(expectedKeys[pair.key] && pair.value == pair.key * 3);
+		++numIteratedPairs;
+	}
+	WAVM_ERROR_UNLESS(numIteratedPairs == expectedSize);
+	for(Uptr key = 0; key < numKeys; ++key)
+	{ WAVM_ERROR_UNLESS(map.contains(key) == expectedKeys[key]); }
+}
+
+template<typename TableImplPolicy> static void testMaps()
+{
+	testStringMap<TableImplPolicy>();
+	testU32Map<TableImplPolicy>();
+	testMapCopy<TableImplPolicy>();
+	testMapMove<TableImplPolicy>();
+	testMapInitializerList<TableImplPolicy>();
+	testMapIterator<TableImplPolicy>();
+	testMapGetOrAdd<TableImplPolicy>();
+	testMapSet<TableImplPolicy>();
+	testMapEmplace<TableImplPolicy>();
+	testMapBracketOperator<TableImplPolicy>();
+	testMapChurn<TableImplPolicy>();
+}
+
+// An allocation policy that lets the benchmark tables reach 15/16 occupancy before they grow.
+struct HighLoadHashTableAllocPolicy
+{
+	static Uptr getMaxDesiredBuckets(Uptr numDesiredElements)
+	{
+		return DefaultHashTableAllocPolicy::getMaxDesiredBuckets(numDesiredElements);
+	}
+
+	static Uptr getMinDesiredBuckets(Uptr numDesiredElements)
+	{
+		if(numDesiredElements == 0) { return 0; }
+		else
+		{
+			const Uptr minDesiredBuckets
+				= Uptr(1) << ceilLogTwo((numDesiredElements * 16 + 14) / 15 + 1);
+			return minDesiredBuckets < DefaultHashTableAllocPolicy::minBuckets
+					   ? DefaultHashTableAllocPolicy::minBuckets
+					   : minDesiredBuckets;
+		}
+	}
+};
+
+// Measures the insert and lookup throughput of a map with the given number of buckets, filled to
+// the given occupancy with random keys.
+template<typename TableImplPolicy>
+static void benchmarkMap(const char* implName, Uptr numBuckets, F64 occupancy)
+{
+	const Uptr numElements = Uptr(F64(numBuckets) * occupancy);
+	std::vector<U64> keys;
+	std::vector<U64> missingKeys;
+	U64 state = 0x9e3779b97f4a7c15;
+	for(Uptr index = 0; index < numElements * 2; ++index)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		(index & 1 ? missingKeys : keys).push_back(state ^ (state >> 29));
+	}
+
+	TestMap<U64, U64, TableImplPolicy> map;
+	Timing::Timer insertTimer;
+	for(U64 key : keys) { map.add(key, key); }
+	const F64 insertNanoseconds = insertTimer.getNanoseconds();
+
+	Uptr totalMemoryBytes = 0;
+	Uptr maxProbeCount = 0;
+	F32 actualOccupancy = 0.0f;
+	F32 averageProbeCount = 0.0f;
+	map.analyzeSpaceUsage(totalMemoryBytes, maxProbeCount, actualOccupancy, averageProbeCount);
+
+	U64 sum = 0;
+	Timing::Timer hitTimer;
+	for(U64 key : keys) { sum += *map.get(key); }
+	const F64 hitNanoseconds = hitTimer.getNanoseconds();
+
+	Uptr numMisses = 0;
+	Timing::Timer missTimer;
+	for(U64 key : missingKeys) { numMisses += !map.contains(key); }
+	const F64 missNanoseconds = missTimer.getNanoseconds();
+	WAVM_ERROR_UNLESS(sum != 0 || !numElements);
+
+	Log::printf(Log::output,
+				"%-10s occupancy %.3f: insert %6.2fns, hit %6.2fns, miss %6.2fns"
+				" (%" WAVM_PRIuPTR " misses, %.1f MiB, max probe %" WAVM_PRIuPTR ")\n",
+				implName,
+				actualOccupancy,
+				insertNanoseconds / F64(numElements),
+				hitNanoseconds / F64(numElements),
+				missNanoseconds / F64(numElements),
+				numMisses,
+				F64(totalMemoryBytes) / (1024.0 * 1024.0),
+				maxProbeCount);
+}
+
+static void benchmarkMaps()
+{
+	static constexpr Uptr numBuckets = Uptr(1) << 20;
+	for(F64 occupancy : {0.5, 0.75, 0.875, 0.93})
+	{
+		benchmarkMap<RobinHoodHashTableImplPolicy<HighLoadHashTableAllocPolicy>>(
+			"RobinHood", numBuckets, occupancy);
+		benchmarkMap<SwissHashTableImplPolicy<HighLoadHashTableAllocPolicy>>(
+			"Swiss", numBuckets, occupancy);
+	}
+}
+
 I32 execHashMapTest(int argc, char** argv)
 {
 	Timing::Timer timer;
-	testStringMap();
-	testU32Map();
-	testMapCopy();
-	testMapMove();
-	testMapInitializerList();
-	testMapIterator();
-	testMapGetOrAdd();
-	testMapSet();
-	testMapEmplace();
-	testMapBracketOperator();
+	testMaps<RobinHoodHashTableImplPolicy<>>();
+	testMaps<SwissHashTableImplPolicy<>>();
 	Timing::logTimer("HashMapTest", timer);
+
+	// Benchmark the hash table implementations if requested.
+	if(argc == 1 && !strcmp(argv[0], "--benchmark")) { benchmarkMaps(); }
+	else if(argc)
+	{
+		Log::printf(Log::error, "Usage: wavm test hashmap [--benchmark]\n");
+		return EXIT_FAILURE;
+	}
+
 	return 0;
 }
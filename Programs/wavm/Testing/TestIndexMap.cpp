@@ -0,0 +1,141 @@
+#include <memory>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/IndexMap.h"
+#include "WAVM/Inline/Timing.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+
+static void testAddRemove()
+{
+	static constexpr Uptr numElements = 1000;
+
+	IndexMap<Uptr, Uptr> map(1, UINTPTR_MAX);
+
+	// Indices are allocated sequentially from minIndex while none have been freed.
+	for(Uptr i = 0; i < numElements; ++i)
+	{
+		WAVM_ERROR_UNLESS(map.add(0, i * 2) == i + 1);
+		WAVM_ERROR_UNLESS(map.size() == i + 1);
+	}
+
+	// Remove the odd indices.
+	for(Uptr index = 1; index <= numElements; index += 2) { map.removeOrFail(index); }
+	WAVM_ERROR_UNLESS(map.size() == numElements / 2);
+	for(Uptr index = 1; index <= numElements; ++index)
+	{
+		WAVM_ERROR_UNLESS(map.contains(index) == !(index & 1));
+		if(map.contains(index)) { WAVM_ERROR_UNLESS(map[index] == (index - 1) * 2); }
+		else
+		{
+			WAVM_ERROR_UNLESS(!map.get(index));
+		}
+	}
+
+	// The freed indices are reused before any new indices are allocated.
+	std::vector<bool> reusedIndices(numElements + 1, false);
+	for(Uptr i = 0; i < numElements / 2; ++i)
+	{
+		const Uptr index = map.add(0, Uptr(0));
+		WAVM_ERROR_UNLESS(index <= numElements && (index & 1) && !reusedIndices[index]);
+		reusedIndices[index] = true;
+	}
+	WAVM_ERROR_UNLESS(map.add(0, Uptr(0)) == numElements + 1);
+}
+
+static void testFull()
+{
+	IndexMap<U32, U32> map(10, 13);
+	for(U32 i = 0; i < 4; ++i) { WAVM_ERROR_UNLESS(map.add(0, i) == 10 + i); }
+	WAVM_ERROR_UNLESS(map.add(0, U32(4)) == 0);
+
+	map.removeOrFail(12);
+	WAVM_ERROR_UNLESS(map.add(0, U32(5)) == 12);
+	WAVM_ERROR_UNLESS(map[12] == 5);
+	WAVM_ERROR_UNLESS(map.add(0, U32(6)) == 0);
+}
+
+static void testReuseOrder()
+{
+	IndexMap<U32, U32> map(1, 100);
+	for(U32 i = 1; i <= 5; ++i) { WAVM_ERROR_UNLESS(map.add(0, i) == i); }
+
+	// Freed indices are reused immediately, most recently freed first, and then new indices are
+	// allocated after the highest allocated index.
+	map.removeOrFail(2);
+	map.removeOrFail(4);
+	WAVM_ERROR_UNLESS(map.add(0, U32(40)) == 4);
+	WAVM_ERROR_UNLESS(map.add(0, U32(20)) == 2);
+	WAVM_ERROR_UNLESS(map.add(0, U32(6)) == 6);
+
+	// An index that is freed and reused refers to the new element.
+	map.removeOrFail(3);
+	WAVM_ERROR_UNLESS(!map.contains(3));
+	WAVM_ERROR_UNLESS(map.add(0, U32(30)) == 3);
+	WAVM_ERROR_UNLESS(map[3] == 30);
+	WAVM_ERROR_UNLESS(map[2] == 20 && map[4] == 40);
+}
+
+static void testInsert()
+{
+	IndexMap<U32, std::shared_ptr<U32>> map(0, UINT32_MAX);
+
+	// Insert the element at index 5, leaving 0..4 free.
+	map.insertOrFail(5, std::make_shared<U32>(5));
+	WAVM_ERROR_UNLESS(map.size() == 1);
+	WAVM_ERROR_UNLESS(*map[5] == 5);
+
+	// Insert an element into one of the free indices, and allocate the others.
+	map.insertOrFail(2, std::make_shared<U32>(2));
+	std::vector<bool> allocatedIndices(6, false);
+	for(U32 i = 0; i < 4; ++i)
+	{
+		const U32 index = map.add(UINT32_MAX, std::make_shared<U32>(0));
+		WAVM_ERROR_UNLESS(index < 5 && index != 2 && !allocatedIndices[index]);
+		allocatedIndices[index] = true;
+	}
+	WAVM_ERROR_UNLESS(map.add(UINT32_MAX, std::make_shared<U32>(6)) == 6);
+	WAVM_ERROR_UNLESS(map.size() == 7);
+
+	// Removing an element releases it.
+	std::weak_ptr<U32> weakElement = map[5];
+	map.removeOrFail(5);
+	WAVM_ERROR_UNLESS(weakElement.expired());
+}
+
+static void testIterator()
+{
+	IndexMap<Uptr, Uptr> map(0, 100);
+	for(Uptr i = 0; i <= 100; ++i) { map.add(UINTPTR_MAX, i * 3); }
+	for(Uptr index = 0; index <= 100; ++index)
+	{
+		if(index % 3) { map.removeOrFail(index); }
+	}
+
+	// The iterator visits the allocated indices in order.
+	Uptr expectedIndex = 0;
+	for(auto it = map.begin(); it != map.end(); ++it)
+	{
+		WAVM_ERROR_UNLESS(it.getIndex() == expectedIndex);
+		WAVM_ERROR_UNLESS(*it == expectedIndex * 3);
+		expectedIndex += 3;
+	}
+	WAVM_ERROR_UNLESS(expectedIndex == 102);
+
+	IndexMap<Uptr, Uptr> emptyMap(0, 100);
+	WAVM_ERROR_UNLESS(!(emptyMap.begin() != emptyMap.end()));
+}
+
+I32 execIndexMapTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+	testAddRemove();
+	testFull();
+	testReuseOrder();
+	testInsert();
+	testIterator();
+	Timing::logTimer("IndexMapTest", timer);
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <string.h>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char instanceResetTestWAST[]
+	= "(module\n"
+	  "  (memory (export \"memory\") 1)\n"
+	  "  (data (i32.const 0) \"hello\")\n"
+	  "  (data $passive \"world\")\n"
+	  "  (table (export \"table\") 2 funcref)\n"
+	  "  (elem (i32.const 0) $f)\n"
+	  "  (global (export \"counter\") (mut i32) (i32.const 0))\n"
+	  "  (func $f)\n"
+	  "  (func (export \"init\")\n"
+	  "    (i32.store (i32.const 100) (i32.const 42))\n"
+	  "    (global.set 0 (i32.const 10)))\n"
+	  "  (func (export \"mutate\")\n"
+	  "    (i32.store8 (i32.const 0) (i32.const 0x48))\n"
+	  "    (drop (memory.grow (i32.const 2)))\n"
+	  "    (i32.store (i32.const 100000) (i32.const 5))\n"
+	  "    (memory.init $passive (i32.const 200) (i32.const 0) (i32.const 5))\n"
+	  "    (data.drop $passive)\n"
+	  "    (table.set (i32.const 1) (ref.func $f))\n"
+	  "    (drop (table.grow (ref.null func) (i32.const 3)))\n"
+	  "    (global.set 0 (i32.add (global.get 0) (i32.const 1))))\n"
+	  "  (func (export \"initPassive\")\n"
+	  "    (memory.init $passive (i32.const 300) (i32.const 0) (i32.const 5)))\n"
+	  ")";
+
+I32 execInstanceResetTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(
+		   instanceResetTestWAST, sizeof(instanceResetTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("instance reset test", instanceResetTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+	ModuleRef module = compileModule(irModule);
+
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		GCPointer<Context> context = createContext(compartment);
+		GCPointer<Instance> instance
+			= instantiateModule(compartment, module, {}, "instanceResetTest");
+		Memory* memory = asMemory(getInstanceExport(instance, "memory"));
+		Table* table = asTable(getInstanceExport(instance, "table"));
+		Global* counter = asGlobal(getInstanceExport(instance, "counter"));
+		auto invoke = [&](const char* exportName) {
+			Function* function = getTypedInstanceExport(instance, exportName, FunctionType());
+			WAVM_ERROR_UNLESS(function);
+			invokeFunction(context, function);
+		};
+
+		// Capture the instance's state after it has been initialized.
+		invoke("init");
+		WAVM_ERROR_UNLESS(captureInstanceResetState(instance, context));
+
+		for(Uptr iteration = 0; iteration < 3; ++iteration)
+		{
+			invoke("mutate");
+			const U8* bytes = getMemoryBaseAddress(memory);
+			WAVM_ERROR_UNLESS(bytes[0] == 'H' && !memcmp(bytes + 200, "world", 5));
+			WAVM_ERROR_UNLESS(getMemoryNumPages(memory) == 3);
+			WAVM_ERROR_UNLESS(getTableNumElements(table) == 5);
+			WAVM_ERROR_UNLESS(getGlobalValue(context, counter).i32 == 11);
+
+			// Unmapped pages are restored too.
+			if(iteration == 1) { unmapMemoryPages(memory, 0, 1); }
+
+			resetInstance(instance, context);
+			bytes = getMemoryBaseAddress(memory);
+			WAVM_ERROR_UNLESS(!memcmp(bytes, "hello", 5));
+			WAVM_ERROR_UNLESS(bytes[100] == 42 && bytes[200] == 0);
+			WAVM_ERROR_UNLESS(getMemoryNumPages(memory) == 1);
+			WAVM_ERROR_UNLESS(getTableNumElements(table) == 2);
+			WAVM_ERROR_UNLESS(getTableElement(table, 0));
+			WAVM_ERROR_UNLESS(!getTableElement(table, 1));
+			WAVM_ERROR_UNLESS(getGlobalValue(context, counter).i32 == 10);
+
+			// The dropped passive segment is restored.
+			invoke("initPassive");
+			WAVM_ERROR_UNLESS(!memcmp(bytes + 300, "world", 5));
+			resetInstance(instance, context);
+			WAVM_ERROR_UNLESS(bytes[300] == 0);
+		}
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran instance reset tests", timer);
+	return 0;
+}
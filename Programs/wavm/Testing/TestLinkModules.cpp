@@ -0,0 +1,149 @@
+#include <string>
+#include <vector>
+#include "WAVM/IR/LinkModules.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+static const char libraryWAST[]
+	= "(module\n"
+	  "  (import \"env\" \"log\" (func $log (param i32)))\n"
+	  "  (memory (export \"memory\") 1)\n"
+	  "  (global $g (export \"g\") i32 (i32.const 7))\n"
+	  "  (func $helper (export \"helper\") (param i32) (result i32)\n"
+	  "    (i32.add (local.get 0) (global.get $g)))\n"
+	  "  (func $start (call $log (i32.const 1)))\n"
+	  "  (start $start)\n"
+	  "  (data (i32.const 0) \"a\")\n"
+	  ")";
+
+static const char mainWAST[]
+	= "(module\n"
+	  "  (type $t (func (param i32) (result i32)))\n"
+	  "  (import \"env\" \"log\" (func $log (param i32)))\n"
+	  "  (import \"library\" \"helper\" (func $helper (type $t)))\n"
+	  "  (import \"library\" \"memory\" (memory 1))\n"
+	  "  (import \"library\" \"g\" (global $g i32))\n"
+	  "  (table 1 funcref)\n"
+	  "  (elem (i32.const 0) $helper)\n"
+	  "  (func (export \"run\") (param i32) (result i32)\n"
+	  "    (call_indirect (type $t) (call $helper (i32.load (local.get 0))) (i32.const 0)))\n"
+	  "  (func $start (call $log (global.get $g)))\n"
+	  "  (start $start)\n"
+	  "  (data (i32.const 1) \"b\")\n"
+	  ")";
+
+static void parseTestModule(const char* wast, Uptr numChars, Module& outModule)
+{
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(wast, numChars, outModule, wastErrors))
+	{
+		WAST::reportParseErrors("link modules test", wast, wastErrors);
+		Errors::fatal("Failed to parse link modules test module");
+	}
+}
+
+static void testLinkedModule()
+{
+	Module libraryModule;
+	Module mainModule;
+	parseTestModule(libraryWAST, sizeof(libraryWAST), libraryModule);
+	parseTestModule(mainWAST, sizeof(mainWAST), mainModule);
+
+	Module linkedModule;
+	std::string linkError;
+	WAVM_ERROR_UNLESS(linkModules(
+		{{"library", &libraryModule, false}, {"main", &mainModule}}, linkedModule, linkError));
+
+	// The imports from env remain imports, and the imports from the library are bound to its
+	// definitions.
+	WAVM_ERROR_UNLESS(linkedModule.imports.size() == 2);
+	WAVM_ERROR_UNLESS(linkedModule.functions.imports.size() == 2);
+	WAVM_ERROR_UNLESS(linkedModule.memories.imports.size() == 0);
+	WAVM_ERROR_UNLESS(linkedModule.globals.imports.size() == 0);
+	WAVM_ERROR_UNLESS(linkedModule.memories.defs.size() == 1);
+	WAVM_ERROR_UNLESS(linkedModule.globals.defs.size() == 1);
+	WAVM_ERROR_UNLESS(linkedModule.dataSegments.size() == 2);
+
+	// The elem segment refers to the library's helper function.
+	WAVM_ERROR_UNLESS(linkedModule.elemSegments.size() == 1);
+	WAVM_ERROR_UNLESS(linkedModule.elemSegments[0].contents->elemIndices.size() == 1);
+	WAVM_ERROR_UNLESS(linkedModule.elemSegments[0].contents->elemIndices[0] == 2);
+
+	// Only the main module's exports are visible.
+	WAVM_ERROR_UNLESS(linkedModule.exports.size() == 1);
+	WAVM_ERROR_UNLESS(linkedModule.exports[0].name == "run");
+	WAVM_ERROR_UNLESS(linkedModule.exports[0].index == 4);
+
+	// The linked module has a start function that calls both modules' start functions.
+	WAVM_ERROR_UNLESS(linkedModule.functions.defs.size() == 5);
+	WAVM_ERROR_UNLESS(linkedModule.startFunctionIndex == 6);
+
+	// Round trip the linked module through the binary format to validate it.
+	std::vector<U8> wasmBytes = WASM::saveBinaryModule(linkedModule);
+	Module loadedModule;
+	WASM::LoadError loadError;
+	if(!WASM::loadBinaryModule(wasmBytes.data(), wasmBytes.size(), loadedModule, &loadError))
+	{ Errors::fatalf("Linked module is invalid: %s", loadError.message.c_str()); }
+}
+
+static void testLinkErrors()
+{
+	Module libraryModule;
+	Module mainModule;
+	parseTestModule(libraryWAST, sizeof(libraryWAST), libraryModule);
+	parseTestModule(mainWAST, sizeof(mainWAST), mainModule);
+
+	// An import of a missing export.
+	{
+		static const char wast[] = "(module (import \"library\" \"missing\" (func)))";
+		Module importModule;
+		parseTestModule(wast, sizeof(wast), importModule);
+
+		Module linkedModule;
+		std::string linkError;
+		WAVM_ERROR_UNLESS(!linkModules(
+			{{"library", &libraryModule}, {"import", &importModule}}, linkedModule, linkError));
+		WAVM_ERROR_UNLESS(linkError.size());
+	}
+
+	// An import with a type that doesn't match the export.
+	{
+		static const char wast[] = "(module (import \"library\" \"helper\" (func (param i64))))";
+		Module importModule;
+		parseTestModule(wast, sizeof(wast), importModule);
+
+		Module linkedModule;
+		std::string linkError;
+		WAVM_ERROR_UNLESS(!linkModules(
+			{{"library", &libraryModule}, {"import", &importModule}}, linkedModule, linkError));
+		WAVM_ERROR_UNLESS(linkError.size());
+	}
+
+	// Two visible modules that export the same name.
+	{
+		Module linkedModule;
+		std::string linkError;
+		WAVM_ERROR_UNLESS(!linkModules(
+			{{"library", &libraryModule}, {"library2", &libraryModule}}, linkedModule, linkError));
+		WAVM_ERROR_UNLESS(linkError.size());
+	}
+}
+
+I32 execLinkModulesTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+	testLinkedModule();
+	testLinkErrors();
+	Timing::logTimer("LinkModulesTest", timer);
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char memoryPoolTestWAST[]
+	= "(module\n"
+	  "  (memory (export \"memory\") 1)\n"
+	  "  (func (export \"load\") (param $address i32) (result i32)\n"
+	  "    (i32.load (local.get $address)))\n"
+	  ")";
+
+// The number of compartments to allocate memories for, which is more than the number of stripes a
+// pool that uses protection keys has, so every slot near a memory is used by another compartment.
+static constexpr Uptr numCompartments = 16;
+
+// Checks that an out-of-bounds load from the memory of a compartment traps with the compartment's
+// memory and the loaded address, even if the address is in another compartment's slot.
+static void expectOutOfBoundsLoad(Context* context, Instance* instance, U32 address)
+{
+	Function* loadFunction = getTypedInstanceExport(
+		instance, "load", FunctionType({ValueType::i32}, {ValueType::i32}));
+	Memory* memory = getTypedInstanceExport(
+		instance, "memory", MemoryType(false, IndexType::i32, SizeConstraints{1, UINT64_MAX}));
+	WAVM_ERROR_UNLESS(loadFunction && memory);
+
+	bool trapped = false;
+	catchRuntimeExceptions(
+		[&]() {
+			UntaggedValue arguments[1] = {address};
+			UntaggedValue results[1];
+			invokeFunction(
+				context, loadFunction, getFunctionType(loadFunction), arguments, results);
+		},
+		[&](Exception* exception) {
+			WAVM_ERROR_UNLESS(getExceptionType(exception)
+							  == ExceptionTypes::outOfBoundsMemoryAccess);
+			WAVM_ERROR_UNLESS(getExceptionArgument(exception, 0).object == asObject(memory));
+			WAVM_ERROR_UNLESS(getExceptionArgument(exception, 1).u64 == address);
+			destroyException(exception);
+			trapped = true;
+		});
+	WAVM_ERROR_UNLESS(trapped);
+}
+
+static void testMemoryPool(bool useProtectionKeys)
+{
+	MemoryPoolRef memoryPool = createMemoryPool(numCompartments, useProtectionKeys);
+	WAVM_ERROR_UNLESS(memoryPool);
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(memoryPoolTestWAST, sizeof(memoryPoolTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("memory pool test", memoryPoolTestWAST, wastErrors);
+		Errors::fatal("Failed to parse the memory pool test module");
+	}
+	ModuleRef module = compileModule(irModule);
+
+	std::vector<GCPointer<Compartment>> compartments;
+	{
+		std::vector<GCPointer<Context>> contexts;
+		std::vector<GCPointer<Instance>> instances;
+		for(Uptr compartmentIndex = 0; compartmentIndex < numCompartments; ++compartmentIndex)
+		{
+			compartments.push_back(createCompartment());
+			setCompartmentMemoryPool(compartments.back(), memoryPool);
+			contexts.push_back(createContext(compartments.back()));
+			instances.push_back(
+				instantiateModule(compartments.back(), module, {}, "memoryPoolTest"));
+		}
+		WAVM_ERROR_UNLESS(getMemoryPoolNumFreeSlots(memoryPool) == 0);
+
+		// Each compartment's out-of-bounds loads are attributed to its own memory: just past its
+		// only page, in the middle of its reservation, and at the end of it. If the pool uses
+		// protection keys, the last two are in the slots of other compartments' memories.
+		for(Uptr compartmentIndex = 0; compartmentIndex < numCompartments; ++compartmentIndex)
+		{
+			for(U32 address : {U32(numBytesPerPage), U32(0x80000000), U32(0xfffffffc)})
+			{
+				expectOutOfBoundsLoad(
+					contexts[compartmentIndex], instances[compartmentIndex], address);
+			}
+		}
+	}
+	for(GCPointer<Compartment>& compartment : compartments)
+	{ WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment))); }
+}
+
+I32 execMemoryPoolTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	testMemoryPool(false);
+	testMemoryPool(true);
+
+	Timing::logTimer("Ran memory pool tests", timer);
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/I128.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Clock.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static Uptr getNumResidentBytes(Memory* memory, Uptr offset, Uptr numBytes)
+{
+	const Uptr pageBytesLog2 = Platform::getBytesPerPageLog2();
+	return Platform::getNumResidentVirtualPages(getMemoryBaseAddress(memory) + offset,
+												numBytes >> pageBytesLog2)
+		   << pageBytesLog2;
+}
+
+// Waits for the background thread to populate the bytes of a memory, and returns false if it
+// doesn't within a few seconds.
+static bool waitForResidentBytes(Memory* memory, Uptr offset, Uptr numBytes)
+{
+	const I128 deadline = Platform::getClockTime(Platform::Clock::monotonic).ns + 10000000000;
+	while(getNumResidentBytes(memory, offset, numBytes) != numBytes)
+	{
+		if(Platform::getClockTime(Platform::Clock::monotonic).ns > deadline) { return false; }
+		Platform::yieldToAnotherThread();
+	}
+	return true;
+}
+
+I32 execMemoryPrefaultTest(int argc, char** argv)
+{
+	// Check whether the platform can populate pages.
+	U8* testPage = Platform::allocateVirtualPages(1);
+	WAVM_ERROR_UNLESS(testPage && Platform::commitVirtualPages(testPage, 1));
+	const bool canPopulatePages = Platform::populateVirtualPages(testPage, 1);
+	Platform::freeVirtualPages(testPage, 1);
+	if(!canPopulatePages)
+	{
+		Log::printf(Log::output,
+					"Skipping memory prefault tests: the platform can't populate pages.\n");
+		return 0;
+	}
+
+	Timing::Timer timer;
+
+	const Uptr numBackgroundPages = memoryBackgroundPrefaultBytes / numBytesPerPage;
+	const MemoryType memoryType(false, IndexType::i32, SizeConstraints{16, UINT64_MAX});
+
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		// A memory that isn't prefaulted has no resident pages until they are accessed.
+		GCPointer<Memory> memory = createMemory(compartment, memoryType, "unprefaulted");
+		WAVM_ERROR_UNLESS(memory);
+		WAVM_ERROR_UNLESS(getNumResidentBytes(memory, 0, 16 * numBytesPerPage) == 0);
+
+		// Memories created with a quota that prefaults memories populate their initial pages, and
+		// the pages of small grows before growMemory returns.
+		ResourceQuotaRef resourceQuota = createResourceQuota();
+		setResourceQuotaPrefaultMemories(resourceQuota, true);
+		GCPointer<Memory> prefaultedMemory
+			= createMemory(compartment, memoryType, "prefaulted", resourceQuota);
+		WAVM_ERROR_UNLESS(prefaultedMemory);
+		const Uptr numInitialBytes = 16 * numBytesPerPage;
+		WAVM_ERROR_UNLESS(getNumResidentBytes(prefaultedMemory, 0, numInitialBytes)
+						  == numInitialBytes);
+		WAVM_ERROR_UNLESS(growMemory(prefaultedMemory, 4) == GrowResult::success);
+		WAVM_ERROR_UNLESS(
+			getNumResidentBytes(prefaultedMemory, numInitialBytes, 4 * numBytesPerPage)
+			== 4 * numBytesPerPage);
+
+		// Large grows are populated by the background thread.
+		setMemoryPrefault(memory, true);
+		WAVM_ERROR_UNLESS(growMemory(memory, numBackgroundPages) == GrowResult::success);
+		WAVM_ERROR_UNLESS(
+			waitForResidentBytes(memory, 16 * numBytesPerPage, memoryBackgroundPrefaultBytes));
+
+		// Disabling prefaulting stops populating the pages of grows.
+		setMemoryPrefault(memory, false);
+		const Uptr oldNumBytes = getMemoryNumPages(memory) * numBytesPerPage;
+		WAVM_ERROR_UNLESS(growMemory(memory, 4) == GrowResult::success);
+		WAVM_ERROR_UNLESS(getNumResidentBytes(memory, oldNumBytes, 4 * numBytesPerPage) == 0);
+
+		// A memory may be freed while the background thread is still populating it.
+		WAVM_ERROR_UNLESS(growMemory(prefaultedMemory, numBackgroundPages) == GrowResult::success);
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran memory prefault tests", timer);
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <string.h>
+#include <functional>
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static constexpr Uptr spanOffset = 1000;
+static const char spanContents[] = "memory span contents";
+static constexpr Uptr spanNumBytes = sizeof(spanContents);
+
+// Returns whether a thunk throws an outOfBoundsMemoryAccess exception.
+static bool throwsOutOfBoundsAccess(const std::function<void()>& thunk)
+{
+	bool threwOutOfBoundsAccess = false;
+	catchRuntimeExceptions(thunk, [&](Exception* exception) {
+		threwOutOfBoundsAccess
+			= getExceptionType(exception) == ExceptionTypes::outOfBoundsMemoryAccess;
+		destroyException(exception);
+	});
+	return threwOutOfBoundsAccess;
+}
+
+static void testBounds(Memory* memory)
+{
+	// A span that ends at the end of the memory is in bounds, but one that extends past it, or
+	// whose size overflows, isn't.
+	MemorySpan<U32> lastSpan(memory, numBytesPerPage - 8, 2);
+	WAVM_ERROR_UNLESS(lastSpan.size() == 2 && lastSpan.numBytes() == 8);
+	WAVM_ERROR_UNLESS(
+		throwsOutOfBoundsAccess([&] { MemorySpan<U32>(memory, numBytesPerPage - 8, 3); }));
+	WAVM_ERROR_UNLESS(
+		throwsOutOfBoundsAccess([&] { MemorySpan<U32>(memory, 0, UINTPTR_MAX / 2); }));
+
+	// Scatter a string to a list of buffers, and gather it back.
+	const MemoryIOV iovs[3] = {{100, 5}, {200, 0}, {300, 16}};
+	MemorySpan<U8> spans[3];
+	WAVM_ERROR_UNLESS(getMemoryIOVSpans(memory, iovs, 3, spans) == 21);
+	WAVM_ERROR_UNLESS(scatterToMemorySpans(spans, 3, (const U8*)spanContents, spanNumBytes)
+					  == spanNumBytes);
+	WAVM_ERROR_UNLESS(!memcmp(getMemoryBaseAddress(memory) + 100, spanContents, 5));
+	WAVM_ERROR_UNLESS(!memcmp(getMemoryBaseAddress(memory) + 300, spanContents + 5, 16));
+	char gatheredBytes[spanNumBytes];
+	WAVM_ERROR_UNLESS(gatherFromMemorySpans(spans, 3, (U8*)gatheredBytes, spanNumBytes)
+					  == spanNumBytes);
+	WAVM_ERROR_UNLESS(!memcmp(gatheredBytes, spanContents, spanNumBytes));
+
+	// Any buffer that is out of bounds fails the whole list.
+	const MemoryIOV outOfBoundsIOVs[2] = {{0, 1}, {numBytesPerPage, 1}};
+	WAVM_ERROR_UNLESS(
+		throwsOutOfBoundsAccess([&] { getMemoryIOVSpans(memory, outOfBoundsIOVs, 2, spans); }));
+}
+
+static void testGrowWhileHoldingSpan(Compartment* compartment)
+{
+	// An unshared 64-bit memory with no maximum size only reserves part of its address space, and
+	// is moved when it grows past it.
+	const MemoryType memoryType(false, IndexType::i64, SizeConstraints{1, UINT64_MAX});
+	GCPointer<Memory> memory = createMemory(compartment, memoryType, "memorySpanMovedTest");
+	WAVM_ERROR_UNLESS(memory);
+
+	MemorySpan<char> span(memory, spanOffset, spanNumBytes);
+	memcpy(span.data(), spanContents, spanNumBytes);
+
+	const Uptr numGrowPages = Uptr(memory64NumInitialReservedBytes / numBytesPerPage);
+	if(growMemory(memory, numGrowPages) != GrowResult::success)
+	{
+		Log::printf(Log::output,
+					"Not testing moved memories: the memory couldn't grow past its reservation.\n");
+		return;
+	}
+
+	// The span held across the grow still points to the memory's old address, so it must not be
+	// used. A span created after the grow sees the contents written through the old one.
+	MemorySpan<char> newSpan(memory, spanOffset, spanNumBytes);
+	WAVM_ERROR_UNLESS(newSpan.data() == (char*)getMemoryBaseAddress(memory) + spanOffset);
+	WAVM_ERROR_UNLESS(newSpan.data() != span.data());
+	WAVM_ERROR_UNLESS(!memcmp(newSpan.data(), spanContents, spanNumBytes));
+
+	// The grown pages are in bounds of new spans.
+	MemorySpan<U8> lastSpan(memory, (numGrowPages + 1) * numBytesPerPage - 1, 1);
+	WAVM_ERROR_UNLESS(lastSpan[0] == 0);
+}
+
+I32 execMemorySpanTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		const MemoryType memoryType(false, IndexType::i32, SizeConstraints{1, 1});
+		GCPointer<Memory> memory = createMemory(compartment, memoryType, "memorySpanTest");
+		WAVM_ERROR_UNLESS(memory);
+		testBounds(memory);
+	}
+	testGrowWhileHoldingSpan(compartment);
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran MemorySpan tests", timer);
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char objectIdReuseTestWAST[]
+	= "(module\n"
+	  "  (import \"env\" \"memory\" (memory 1))\n"
+	  "  (import \"env\" \"table\" (table 1 funcref))\n"
+	  "  (global $g (mut i32) (i32.const 0))\n"
+	  "  (func (export \"load\") (param $address i32) (result i32)\n"
+	  "    (i32.load8_u (local.get $address)))\n"
+	  "  (func (export \"memorySize\") (result i32) (memory.size))\n"
+	  "  (func (export \"tableSize\") (result i32) (table.size))\n"
+	  "  (func (export \"incrementGlobal\") (result i32)\n"
+	  "    (global.set $g (i32.add (global.get $g) (i32.const 1)))\n"
+	  "    (global.get $g))\n"
+	  ")";
+
+static I32 invokeI32(Context* context, Instance* instance, const char* name, I32 argument = -1)
+{
+	const bool hasArgument = argument >= 0;
+	Function* function = getTypedInstanceExport(
+		instance,
+		name,
+		FunctionType({ValueType::i32},
+					 hasArgument ? TypeTuple{ValueType::i32} : TypeTuple{}));
+	WAVM_ERROR_UNLESS(function);
+	UntaggedValue arguments[1] = {argument};
+	UntaggedValue results[1];
+	invokeFunction(context, function, getFunctionType(function), arguments, results);
+	return results[0].i32;
+}
+
+// Instantiates the test module with a new memory and table of the given sizes, and checks that
+// the instance's code uses them, rather than the objects that previously had their IDs.
+static void testObjects(Compartment* compartment,
+						ModuleConstRefParam module,
+						U64 numMemoryPages,
+						U64 numTableElems,
+						U8 storedByte)
+{
+	GCPointer<Memory> memory = createMemory(
+		compartment, MemoryType(false, IndexType::i32, {numMemoryPages, UINT64_MAX}), "memory");
+	GCPointer<Table> table = createTable(
+		compartment,
+		TableType(ReferenceType::funcref, false, IndexType::i32, {numTableElems, UINT64_MAX}),
+		nullptr,
+		"table");
+	WAVM_ERROR_UNLESS(memory && table);
+	GCPointer<Context> context = createContext(compartment);
+	GCPointer<Instance> instance = instantiateModule(
+		compartment, module, {asObject(memory), asObject(table)}, "objectIdReuseTest");
+
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "memorySize") == I32(numMemoryPages));
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "tableSize") == I32(numTableElems));
+
+	// The memory starts zeroed, even if a freed memory with the same ID was written to.
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "load", 100) == 0);
+	getMemoryBaseAddress(memory)[100] = storedByte;
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "load", 100) == storedByte);
+
+	// The context's mutable global starts at its initial value.
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "incrementGlobal") == 1);
+	WAVM_ERROR_UNLESS(invokeI32(context, instance, "incrementGlobal") == 2);
+}
+
+I32 execObjectIdReuseTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(
+		   objectIdReuseTestWAST, sizeof(objectIdReuseTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("object ID reuse test", objectIdReuseTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+	ModuleRef module = compileModule(irModule);
+
+	// Each round frees the previous round's memory, table, context and instance before creating
+	// new ones, which reuse their IDs.
+	GCPointer<Compartment> compartment = createCompartment();
+	for(Uptr round = 0; round < 4; ++round)
+	{
+		testObjects(compartment, module, 1 + round * 2, 1 + round * 3, U8(0x80 + round));
+		collectCompartmentGarbage(compartment);
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran object ID reuse tests", timer);
+	return 0;
+}
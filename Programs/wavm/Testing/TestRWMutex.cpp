@@ -0,0 +1,103 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Platform/RWMutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::Platform;
+
+static void testNestedSharedLocks()
+{
+	// Take more nested shared locks than a thread has slots, so some of them are taken on the
+	// underlying RWMutex, and unlock them in a different order than they were locked.
+	static constexpr Uptr numMutexes = 20;
+	std::unique_ptr<ReaderBiasedRWMutex> mutexes[numMutexes];
+	for(Uptr index = 0; index < numMutexes; ++index)
+	{ mutexes[index] = std::make_unique<ReaderBiasedRWMutex>(); }
+
+	for(Uptr index = 0; index < numMutexes; ++index)
+	{
+		mutexes[index]->lock(ReaderBiasedRWMutex::shareable);
+		mutexes[index]->lock(ReaderBiasedRWMutex::shareable);
+	}
+	for(Uptr index = 0; index < numMutexes; ++index)
+	{
+		mutexes[index]->unlock(ReaderBiasedRWMutex::shareable);
+		mutexes[numMutexes - index - 1]->unlock(ReaderBiasedRWMutex::shareable);
+	}
+
+	// All the shared locks were released, so the mutexes can be locked exclusively.
+	for(Uptr index = 0; index < numMutexes; ++index)
+	{
+		ReaderBiasedRWMutex::ExclusiveLock exclusiveLock(*mutexes[index]);
+		WAVM_ASSERT_RWMUTEX_IS_EXCLUSIVELY_LOCKED_BY_CURRENT_THREAD(*mutexes[index]);
+	}
+}
+
+struct ContendedState
+{
+	ReaderBiasedRWMutex mutex;
+	std::atomic<bool> isWriting{false};
+	Uptr a = 0;
+	Uptr b = 0;
+	std::atomic<Uptr> numInconsistentReads{0};
+};
+
+static constexpr Uptr numReaderThreads = 4;
+static constexpr Uptr numReadsPerThread = 200000;
+static constexpr Uptr numWrites = 2000;
+
+static I64 readerThreadMain(void* argument)
+{
+	ContendedState& state = *(ContendedState*)argument;
+	for(Uptr readIndex = 0; readIndex < numReadsPerThread; ++readIndex)
+	{
+		ReaderBiasedRWMutex::ShareableLock lock(state.mutex);
+		if(state.isWriting.load(std::memory_order_relaxed) || state.a != state.b)
+		{ state.numInconsistentReads.fetch_add(1, std::memory_order_relaxed); }
+	}
+	return 0;
+}
+
+static I64 writerThreadMain(void* argument)
+{
+	ContendedState& state = *(ContendedState*)argument;
+	for(Uptr writeIndex = 0; writeIndex < numWrites; ++writeIndex)
+	{
+		ReaderBiasedRWMutex::ExclusiveLock lock(state.mutex);
+		state.isWriting.store(true, std::memory_order_relaxed);
+		++state.a;
+		yieldToAnotherThread();
+		++state.b;
+		state.isWriting.store(false, std::memory_order_relaxed);
+	}
+	return 0;
+}
+
+static void testContendedLocks()
+{
+	ContendedState state;
+
+	std::vector<Thread*> threads;
+	for(Uptr threadIndex = 0; threadIndex < numReaderThreads; ++threadIndex)
+	{ threads.push_back(createThread(0, readerThreadMain, &state)); }
+	threads.push_back(createThread(0, writerThreadMain, &state));
+	for(Thread* thread : threads) { joinThread(thread); }
+
+	WAVM_ERROR_UNLESS(!state.numInconsistentReads.load());
+	WAVM_ERROR_UNLESS(state.a == numWrites && state.b == numWrites);
+}
+
+I32 execRWMutexTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+	testNestedSharedLocks();
+	testContendedLocks();
+	Timing::logTimer("RWMutexTest", timer);
+	return 0;
+}
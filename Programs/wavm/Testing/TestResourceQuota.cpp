@@ -0,0 +1,133 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char resourceQuotaTestWAST[]
+	= "(module\n"
+	  "  (table (export \"table\") 0 funcref)\n"
+	  ")";
+
+static constexpr Uptr numThreads = 8;
+static constexpr Uptr numGrowsPerThread = 20000;
+static constexpr Uptr numElemsPerGrow = 3;
+static constexpr Uptr reservationChunk = 16;
+static constexpr Uptr maxTableElems = 512;
+
+// An instance in its own compartment, with a table that is charged to the shared quota. The table
+// is grown and then shrunk back to its initial size by resetting the instance.
+struct QuotaUser
+{
+	GCPointer<Compartment> compartment;
+	GCPointer<Context> context;
+	GCPointer<Instance> instance;
+	Table* table = nullptr;
+
+	QuotaUser(ModuleConstRefParam module, ResourceQuotaRefParam resourceQuota)
+	{
+		compartment = createCompartment();
+		context = createContext(compartment);
+		instance = instantiateModule(compartment, module, {}, "resourceQuotaTest", resourceQuota);
+		table = asTable(getInstanceExport(instance, "table"));
+		WAVM_ERROR_UNLESS(captureInstanceResetState(instance, context));
+	}
+
+	~QuotaUser()
+	{
+		table = nullptr;
+		instance = nullptr;
+		context = nullptr;
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	}
+};
+
+struct ThreadArgs
+{
+	QuotaUser* user;
+	std::atomic<Uptr>* numRunningThreads;
+};
+
+static I64 growThreadMain(void* argument)
+{
+	ThreadArgs& args = *(ThreadArgs*)argument;
+	for(Uptr growIndex = 0; growIndex < numGrowsPerThread; ++growIndex)
+	{
+		WAVM_ERROR_UNLESS(growTable(args.user->table, numElemsPerGrow) == GrowResult::success);
+		resetInstance(args.user->instance, args.user->context);
+	}
+	args.numRunningThreads->fetch_sub(1, std::memory_order_release);
+	return 0;
+}
+
+I32 execResourceQuotaTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(
+		   resourceQuotaTestWAST, sizeof(resourceQuotaTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("resource quota test", resourceQuotaTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+	ModuleRef module = compileModule(irModule);
+
+	ResourceQuotaRef resourceQuota = createResourceQuota();
+	setResourceQuotaMaxTableElems(resourceQuota, maxTableElems);
+	setResourceQuotaTableElemsReservationChunk(resourceQuota, reservationChunk);
+
+	{
+		std::vector<std::unique_ptr<QuotaUser>> users;
+		for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+		{ users.push_back(std::make_unique<QuotaUser>(module, resourceQuota)); }
+
+		// Grow and shrink a table on each thread, while this thread reads the current quota.
+		std::atomic<Uptr> numRunningThreads{numThreads};
+		std::vector<ThreadArgs> threadArgs;
+		for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+		{ threadArgs.push_back({users[threadIndex].get(), &numRunningThreads}); }
+		std::vector<Platform::Thread*> threads;
+		for(ThreadArgs& args : threadArgs)
+		{ threads.push_back(Platform::createThread(0, growThreadMain, &args)); }
+
+		Uptr numReads = 0;
+		while(numRunningThreads.load(std::memory_order_acquire))
+		{
+			WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) <= maxTableElems);
+			++numReads;
+		}
+		for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+		Log::printf(Log::debug, "Read the current quota %" WAVM_PRIuPTR " times.\n", numReads);
+
+		// Every table was shrunk back to its initial size, so none of the quota is in use, even
+		// though the threads' reservations still hold some of it.
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) == 0);
+
+		// A single table can still use the whole quota: the reservations the other threads hold
+		// are given back when they would keep it from growing.
+		QuotaUser user(module, resourceQuota);
+		WAVM_ERROR_UNLESS(growTable(user.table, maxTableElems) == GrowResult::success);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) == maxTableElems);
+		WAVM_ERROR_UNLESS(growTable(user.table, 1) == GrowResult::outOfQuota);
+		resetInstance(user.instance, user.context);
+		WAVM_ERROR_UNLESS(getResourceQuotaCurrentTableElems(resourceQuota) == 0);
+	}
+
+	Timing::logTimer("Ran resource quota tests", timer);
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include <stddef.h>
+#include <string.h>
+#include "WAVM/IR/Types.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/RingBuffer.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static constexpr Uptr ringBufferAddress = 64;
+static constexpr U32 ringBufferNumDataBytes = 256;
+static constexpr U32 numThreadMessages = 100000;
+
+// Messages are their index, followed by index % 7 bytes of padding, so they have different sizes
+// and some of them skip to the start of the data.
+static U32 makeMessage(U32 messageIndex, U8* outBytes)
+{
+	const U32 numBytes = sizeof(U32) + messageIndex % 7;
+	memcpy(outBytes, &messageIndex, sizeof(U32));
+	memset(outBytes + sizeof(U32), U8(messageIndex), numBytes - sizeof(U32));
+	return numBytes;
+}
+
+static void checkMessage(U32 expectedMessageIndex, const U8* bytes, U32 numBytes)
+{
+	U8 expectedBytes[16];
+	const U32 expectedNumBytes = makeMessage(expectedMessageIndex, expectedBytes);
+	WAVM_ERROR_UNLESS(numBytes == expectedNumBytes);
+	WAVM_ERROR_UNLESS(!memcmp(bytes, expectedBytes, numBytes));
+}
+
+static void testFullAndEmpty(Memory* memory)
+{
+	MemoryRingBuffer::init(memory, ringBufferAddress, ringBufferNumDataBytes);
+	MemoryRingBuffer ringBuffer(memory, ringBufferAddress);
+	WAVM_ERROR_UNLESS(ringBuffer.getMaxMessageBytes() == ringBufferNumDataBytes / 2 - 4);
+
+	// An empty ring buffer has no messages, and a wait for them times out.
+	WAVM_ERROR_UNLESS(ringBuffer.read([](const U8*, U32) { WAVM_UNREACHABLE(); }) == 0);
+	WAVM_ERROR_UNLESS(!ringBuffer.waitForMessages(1000));
+
+	// Write messages until the ring buffer is full, then read them all back in one batch.
+	U8 messageBytes[64][16];
+	RingBufferMessage messages[64];
+	for(U32 messageIndex = 0; messageIndex < 64; ++messageIndex)
+	{
+		messages[messageIndex].data = messageBytes[messageIndex];
+		messages[messageIndex].numBytes = makeMessage(messageIndex, messageBytes[messageIndex]);
+	}
+	const Uptr numWrittenMessages = ringBuffer.tryWrite(messages, 64);
+	WAVM_ERROR_UNLESS(numWrittenMessages > 0 && numWrittenMessages < 64);
+	WAVM_ERROR_UNLESS(ringBuffer.tryWrite(messages + numWrittenMessages, 1) == 0);
+	WAVM_ERROR_UNLESS(ringBuffer.waitForMessages(0));
+
+	U32 numReadMessages = 0;
+	WAVM_ERROR_UNLESS(ringBuffer.read([&](const U8* bytes, U32 numBytes) {
+		checkMessage(numReadMessages++, bytes, numBytes);
+	}) == numWrittenMessages);
+
+	// Messages larger than the maximum size aren't written.
+	const RingBufferMessage tooLargeMessage = {messageBytes, ringBufferNumDataBytes};
+	WAVM_ERROR_UNLESS(ringBuffer.tryWrite(&tooLargeMessage, 1) == 0);
+}
+
+static void testCorruptIndices(Memory* memory)
+{
+	MemoryRingBuffer::init(memory, ringBufferAddress, ringBufferNumDataBytes);
+	MemoryRingBuffer ringBuffer(memory, ringBufferAddress);
+
+	// A write index that the guest moved past the end of the written data is reported as an
+	// out-of-bounds access.
+	memoryRef<U32>(memory, ringBufferAddress + offsetof(wavm_ring_buffer_header, write_index))
+		= ringBufferNumDataBytes * 2;
+	Runtime::ExceptionType* caughtType = nullptr;
+	catchRuntimeExceptions([&] { ringBuffer.read([](const U8*, U32) {}); },
+						   [&](Exception* exception) {
+							   caughtType = getExceptionType(exception);
+							   destroyException(exception);
+						   });
+	WAVM_ERROR_UNLESS(caughtType == ExceptionTypes::outOfBoundsMemoryAccess);
+}
+
+struct ProducerState
+{
+	Memory* memory;
+};
+
+static I64 producerThreadMain(void* argument)
+{
+	ProducerState& state = *(ProducerState*)argument;
+	MemoryRingBuffer ringBuffer(state.memory, ringBufferAddress);
+
+	// Write the messages in small batches, blocking while the ring buffer is full.
+	U8 messageBytes[4][16];
+	RingBufferMessage messages[4];
+	for(U32 messageIndex = 0; messageIndex < numThreadMessages; messageIndex += 4)
+	{
+		for(U32 batchIndex = 0; batchIndex < 4; ++batchIndex)
+		{
+			messages[batchIndex].data = messageBytes[batchIndex];
+			messages[batchIndex].numBytes
+				= makeMessage(messageIndex + batchIndex, messageBytes[batchIndex]);
+		}
+		WAVM_ERROR_UNLESS(ringBuffer.write(messages, 4) == 4);
+	}
+	return 0;
+}
+
+static void testProducerThread(Memory* memory)
+{
+	MemoryRingBuffer::init(memory, ringBufferAddress, ringBufferNumDataBytes);
+	MemoryRingBuffer ringBuffer(memory, ringBufferAddress);
+
+	// Read the messages that another thread writes, blocking while the ring buffer is empty.
+	ProducerState state{memory};
+	Platform::Thread* producerThread = Platform::createThread(0, producerThreadMain, &state);
+	U32 numReadMessages = 0;
+	while(numReadMessages < numThreadMessages)
+	{
+		WAVM_ERROR_UNLESS(ringBuffer.waitForMessages());
+		ringBuffer.read([&](const U8* bytes, U32 numBytes) {
+			checkMessage(numReadMessages++, bytes, numBytes);
+		});
+	}
+	WAVM_ERROR_UNLESS(Platform::joinThread(producerThread) == 0);
+}
+
+static void testMovedMemory(Compartment* compartment)
+{
+	// An unshared 64-bit memory with no maximum size only reserves part of its address space, and
+	// is moved when it grows past it.
+	const MemoryType memoryType(false, IndexType::i64, SizeConstraints{1, UINT64_MAX});
+	GCPointer<Memory> memory = createMemory(compartment, memoryType, "ringBufferMovedTest");
+	WAVM_ERROR_UNLESS(memory);
+
+	MemoryRingBuffer::init(memory, ringBufferAddress, ringBufferNumDataBytes);
+	MemoryRingBuffer ringBuffer(memory, ringBufferAddress);
+
+	U8 messageBytes[2][16];
+	RingBufferMessage messages[2];
+	for(U32 messageIndex = 0; messageIndex < 2; ++messageIndex)
+	{
+		messages[messageIndex].data = messageBytes[messageIndex];
+		messages[messageIndex].numBytes = makeMessage(messageIndex, messageBytes[messageIndex]);
+	}
+	WAVM_ERROR_UNLESS(ringBuffer.tryWrite(messages, 1) == 1);
+
+	const U8* oldBaseAddress = getMemoryBaseAddress(memory);
+	const Uptr numGrowPages = Uptr(memory64NumInitialReservedBytes / numBytesPerPage);
+	if(growMemory(memory, numGrowPages) != GrowResult::success)
+	{
+		Log::printf(Log::output,
+					"Not testing moved memories: the memory couldn't grow past its reservation.\n");
+		return;
+	}
+	WAVM_ERROR_UNLESS(getMemoryBaseAddress(memory) != oldBaseAddress);
+
+	// The ring buffer follows the memory to its new address.
+	WAVM_ERROR_UNLESS(ringBuffer.tryWrite(messages + 1, 1) == 1);
+	U32 numReadMessages = 0;
+	WAVM_ERROR_UNLESS(ringBuffer.read([&](const U8* bytes, U32 numBytes) {
+		checkMessage(numReadMessages++, bytes, numBytes);
+	}) == 2);
+}
+
+I32 execRingBufferTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		const MemoryType memoryType(true, IndexType::i32, SizeConstraints{1, 1});
+		GCPointer<Memory> memory = createMemory(compartment, memoryType, "ringBufferTest");
+		WAVM_ERROR_UNLESS(memory);
+
+		testFullAndEmpty(memory);
+		testCorruptIndices(memory);
+		testProducerThread(memory);
+	}
+	testMovedMemory(compartment);
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran RingBuffer tests", timer);
+
+	return 0;
+}
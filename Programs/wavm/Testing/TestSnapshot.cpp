@@ -0,0 +1,200 @@
+#include <string.h>
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/WASM/WASM.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static const char snapshotTestWAST[]
+	= "(module\n"
+	  "  (type $i32 (func (result i32)))\n"
+	  "  (memory (export \"memory\") 1 4)\n"
+	  "  (data (i32.const 16) \"hello\")\n"
+	  "  (data $passive \"passive\")\n"
+	  "  (data $dropped \"dropped\")\n"
+	  "  (table (export \"table\") 2 10 funcref)\n"
+	  "  (elem (i32.const 0) $one)\n"
+	  "  (elem $passiveElem func $two)\n"
+	  "  (elem declare func $three)\n"
+	  "  (global $numStarts (export \"numStarts\") (mut i32) (i32.const 0))\n"
+	  "  (global $i64 (export \"i64\") (mut i64) (i64.const 0))\n"
+	  "  (global $f64 (export \"f64\") (mut f64) (f64.const 0))\n"
+	  "  (global $ref (export \"ref\") (mut funcref) (ref.null func))\n"
+	  "  (global (export \"immutable\") i32 (i32.const 7))\n"
+	  "  (func $one (type $i32) (i32.const 1))\n"
+	  "  (func $two (type $i32) (i32.const 2))\n"
+	  "  (func $three (export \"three\") (type $i32) (i32.const 3))\n"
+	  "  (func $start\n"
+	  "    (global.set $numStarts (i32.add (global.get $numStarts) (i32.const 1))))\n"
+	  "  (start $start)\n"
+	  "  (func (export \"init\")\n"
+	  "    (drop (memory.grow (i32.const 1)))\n"
+	  "    (i32.store (i32.const 70000) (i32.const 0x12345678))\n"
+	  "    (data.drop $dropped)\n"
+	  "    (drop (table.grow (ref.func $three) (i32.const 2)))\n"
+	  "    (global.set $i64 (i64.const 0x123456789))\n"
+	  "    (global.set $f64 (f64.const 1.5))\n"
+	  "    (global.set $ref (ref.func $three)))\n"
+	  "  (func (export \"callTable\") (param i32) (result i32)\n"
+	  "    (call_indirect (type $i32) (local.get 0)))\n"
+	  "  (func (export \"initPassive\")\n"
+	  "    (memory.init $passive (i32.const 300) (i32.const 0) (i32.const 7)))\n"
+	  "  (func (export \"initDropped\")\n"
+	  "    (memory.init $dropped (i32.const 400) (i32.const 0) (i32.const 7)))\n"
+	  "  (func (export \"initPassiveElem\")\n"
+	  "    (table.init $passiveElem (i32.const 1) (i32.const 0) (i32.const 1)))\n"
+	  ")";
+
+static Function* getFunctionExport(Instance* instance, const char* name, FunctionType type)
+{
+	Function* function = getTypedInstanceExport(instance, name, type);
+	WAVM_ERROR_UNLESS(function);
+	return function;
+}
+
+static void invoke(Context* context, Instance* instance, const char* name)
+{
+	Function* function = getFunctionExport(instance, name, FunctionType());
+	invokeFunction(context, function, getFunctionType(function));
+}
+
+static I32 callTable(Context* context, Instance* instance, U32 elementIndex)
+{
+	Function* function = getFunctionExport(
+		instance, "callTable", FunctionType({ValueType::i32}, {ValueType::i32}));
+	UntaggedValue arguments[1] = {elementIndex};
+	UntaggedValue results[1];
+	invokeFunction(context, function, getFunctionType(function), arguments, results);
+	return results[0].i32;
+}
+
+// Returns the type of the exception that a thunk throws, or null if it doesn't throw.
+static Runtime::ExceptionType* getThrownExceptionType(const std::function<void()>& thunk)
+{
+	Runtime::ExceptionType* exceptionType = nullptr;
+	catchRuntimeExceptions(thunk, [&](Exception* exception) {
+		exceptionType = getExceptionType(exception);
+		destroyException(exception);
+	});
+	return exceptionType;
+}
+
+static Value getGlobalExport(Context* context, Instance* instance, const char* name)
+{
+	Global* global = asGlobalNullable(getInstanceExport(instance, name));
+	WAVM_ERROR_UNLESS(global);
+	return getGlobalValue(context, global);
+}
+
+// Checks that an instance is in the state that the init function leaves the test module in.
+static void checkInitializedState(Context* context, Instance* instance)
+{
+	// The start function ran once.
+	WAVM_ERROR_UNLESS(getGlobalExport(context, instance, "numStarts").i32 == 1);
+
+	// The mutable globals have the values that init wrote to them.
+	WAVM_ERROR_UNLESS(getGlobalExport(context, instance, "i64").i64 == 0x123456789);
+	WAVM_ERROR_UNLESS(getGlobalExport(context, instance, "f64").f64 == 1.5);
+	WAVM_ERROR_UNLESS(getGlobalExport(context, instance, "ref").object
+					  == asObject(getInstanceExport(instance, "three")));
+	WAVM_ERROR_UNLESS(getGlobalExport(context, instance, "immutable").i32 == 7);
+
+	// The memory grew, and holds the active data segment and the value init stored.
+	Memory* memory = asMemoryNullable(getInstanceExport(instance, "memory"));
+	WAVM_ERROR_UNLESS(memory && getMemoryNumPages(memory) == 2);
+	const U8* bytes = getMemoryBaseAddress(memory);
+	WAVM_ERROR_UNLESS(!memcmp(bytes + 16, "hello", 5));
+	U32 storedValue;
+	memcpy(&storedValue, bytes + 70000, sizeof(storedValue));
+	WAVM_ERROR_UNLESS(storedValue == 0x12345678);
+	Uptr numNonZeroBytes = 0;
+	for(Uptr address = 0; address < 2 * IR::numBytesPerPage; ++address)
+	{
+		if(bytes[address]) { ++numNonZeroBytes; }
+	}
+	WAVM_ERROR_UNLESS(numNonZeroBytes == 5 + 4);
+
+	// The table grew, and holds the active elem segment and the elements init added to it.
+	Table* table = asTableNullable(getInstanceExport(instance, "table"));
+	WAVM_ERROR_UNLESS(table && getTableNumElements(table) == 4);
+	WAVM_ERROR_UNLESS(callTable(context, instance, 0) == 1);
+	WAVM_ERROR_UNLESS(
+		getThrownExceptionType([&] { callTable(context, instance, 1); })
+		== ExceptionTypes::uninitializedTableElement);
+	WAVM_ERROR_UNLESS(callTable(context, instance, 2) == 3);
+	WAVM_ERROR_UNLESS(callTable(context, instance, 3) == 3);
+}
+
+I32 execSnapshotTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(snapshotTestWAST, sizeof(snapshotTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("snapshot test", snapshotTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+
+	// Initialize an instance of the module, and snapshot it.
+	IR::Module snapshotIRModule;
+	{
+		GCPointer<Compartment> compartment = createCompartment();
+		{
+			GCPointer<Context> context = createContext(compartment);
+			GCPointer<Instance> instance
+				= instantiateModule(compartment, compileModule(irModule), {}, "snapshotTest");
+			invoke(context, instance, "init");
+			checkInitializedState(context, instance);
+
+			IR::Module snapshotModule;
+			WAVM_ERROR_UNLESS(snapshotInstance(instance, context, irModule, snapshotModule));
+
+			// Round-trip the snapshot through the binary format, which validates it.
+			const std::vector<U8> snapshotBytes = WASM::saveBinaryModule(snapshotModule);
+			WASM::LoadError loadError;
+			if(!WASM::loadBinaryModule(
+				   snapshotBytes.data(), snapshotBytes.size(), snapshotIRModule, &loadError))
+			{ Errors::fatalf("Failed to load the snapshot: %s", loadError.message.c_str()); }
+		}
+		WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+	}
+
+	// An instance of the snapshot starts in the initialized state, without running the start
+	// function again.
+	WAVM_ERROR_UNLESS(snapshotIRModule.startFunctionIndex == UINTPTR_MAX);
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		GCPointer<Context> context = createContext(compartment);
+		GCPointer<Instance> instance = instantiateModule(
+			compartment, compileModule(snapshotIRModule), {}, "snapshotTestSnapshot");
+		checkInitializedState(context, instance);
+
+		// Passive segments keep their contents, and dropped segments stay dropped.
+		invoke(context, instance, "initPassive");
+		const U8* bytes
+			= getMemoryBaseAddress(asMemoryNullable(getInstanceExport(instance, "memory")));
+		WAVM_ERROR_UNLESS(!memcmp(bytes + 300, "passive", 7));
+		WAVM_ERROR_UNLESS(getThrownExceptionType([&] { invoke(context, instance, "initDropped"); })
+						  == ExceptionTypes::outOfBoundsDataSegmentAccess);
+		invoke(context, instance, "initPassiveElem");
+		WAVM_ERROR_UNLESS(callTable(context, instance, 1) == 2);
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+
+	Timing::logTimer("Ran snapshot tests", timer);
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/WASM/WASM.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// Loads a module by passing it to a StreamingModuleLoader in chunks of chunkNumBytes.
+static bool loadInChunks(const std::vector<U8>& wasmBytes,
+						 Uptr chunkNumBytes,
+						 IR::Module& outModule,
+						 WASM::LoadError& outError)
+{
+	std::shared_ptr<WASM::StreamingModuleLoader> loader
+		= WASM::createStreamingModuleLoader(outModule.featureSpec);
+	for(Uptr offset = 0; offset < wasmBytes.size(); offset += chunkNumBytes)
+	{
+		const Uptr numBytes = std::min(chunkNumBytes, wasmBytes.size() - offset);
+		if(!WASM::addStreamingModuleBytes(*loader, wasmBytes.data() + offset, numBytes, &outError))
+		{ return false; }
+	}
+	return WASM::finishStreamingModuleLoad(*loader, outModule, &outError);
+}
+
+// Checks that loading a module in chunks gives the same result as loading it all at once.
+static void testStreamingLoad(const std::vector<U8>& wasmBytes)
+{
+	IR::Module expectedModule;
+	WASM::LoadError expectedError;
+	const bool expectedSuccess = WASM::loadBinaryModule(
+		wasmBytes.data(), wasmBytes.size(), expectedModule, &expectedError);
+
+	static const Uptr chunkNumBytes[] = {1, 7, 4096, 1024 * 1024};
+	for(Uptr chunkSize : chunkNumBytes)
+	{
+		IR::Module module;
+		WASM::LoadError error;
+		const bool success = loadInChunks(wasmBytes, chunkSize, module, error);
+		WAVM_ERROR_UNLESS(success == expectedSuccess);
+		if(success)
+		{
+			WAVM_ERROR_UNLESS(WASM::saveBinaryModule(module)
+							  == WASM::saveBinaryModule(expectedModule));
+		}
+		else
+		{
+			WAVM_ERROR_UNLESS(error.type == expectedError.type);
+		}
+	}
+}
+
+I32 execStreamingLoadTest(int argc, char** argv)
+{
+	if(argc != 1)
+	{
+		Log::printf(Log::error, "Usage: wavm test streaming-load in.wasm\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<U8> wasmBytes;
+	if(!loadFile(argv[0], wasmBytes)) { return EXIT_FAILURE; }
+
+	Timing::Timer timer;
+
+	// Test loading the module, and truncated copies of it.
+	testStreamingLoad(wasmBytes);
+	for(Uptr numBytes : {Uptr(0), Uptr(4), Uptr(9), wasmBytes.size() / 2, wasmBytes.size() - 1})
+	{
+		WAVM_ERROR_UNLESS(numBytes < wasmBytes.size());
+		testStreamingLoad(std::vector<U8>(wasmBytes.begin(), wasmBytes.begin() + numBytes));
+	}
+
+	Timing::logTimer("Ran streaming load tests", timer);
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include <vector>
+#include "WAVM/IR/Module.h"
+#include "WAVM/IR/Types.h"
+#include "WAVM/IR/Value.h"
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/RuntimeABI/RuntimeABI.h"
+#include "WAVM/WASTParse/WASTParse.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+using namespace WAVM::Runtime;
+
+static constexpr Uptr tierUpCallThreshold = 10;
+
+static const char tierUpTestWAST[]
+	= "(module\n"
+	  "  (type $binary (func (param i32 i32) (result i32)))\n"
+	  "  (table (export \"table\") funcref (elem $add))\n"
+	  "  (func $add (export \"add\") (type $binary)\n"
+	  "    (i32.add (local.get 0) (local.get 1)))\n"
+	  "  (func (export \"callAdd\") (type $binary)\n"
+	  "    (call $add (local.get 0) (local.get 1)))\n"
+	  "  (func (export \"callIndirectAdd\") (type $binary)\n"
+	  "    (call_indirect (type $binary) (local.get 0) (local.get 1) (i32.const 0)))\n"
+	  "  (func (export \"cold\") (result i32) (i32.const 7))\n"
+	  ")";
+
+static I32 invokeBinary(Context* context, Instance* instance, const char* name, I32 a, I32 b)
+{
+	Function* function = getTypedInstanceExport(
+		instance, name, FunctionType({ValueType::i32}, {ValueType::i32, ValueType::i32}));
+	WAVM_ERROR_UNLESS(function);
+	UntaggedValue arguments[2] = {a, b};
+	UntaggedValue results[1];
+	invokeFunction(context, function, getFunctionType(function), arguments, results);
+	return results[0].i32;
+}
+
+// Returns whether calls to an exported function are forwarded to tiered-up code.
+static bool isTieredUp(Instance* instance, const char* name)
+{
+	Function* function = asFunctionNullable(getInstanceExport(instance, name));
+	WAVM_ERROR_UNLESS(function && function->mutableData->tierUpState);
+	return function->mutableData->tierUpState->tieredUpCode.load(std::memory_order_acquire)
+		   != nullptr;
+}
+
+static void testTierUp(ModuleConstRefParam module)
+{
+	GCPointer<Compartment> compartment = createCompartment();
+	{
+		GCPointer<Context> context = createContext(compartment);
+		GCPointer<Instance> instance = instantiateModule(compartment, module, {}, "tierUpTest");
+		WAVM_ERROR_UNLESS(instance);
+		Function* add = asFunctionNullable(getInstanceExport(instance, "add"));
+		Table* table = asTableNullable(getInstanceExport(instance, "table"));
+		WAVM_ERROR_UNLESS(add && table);
+
+		// Calling add directly, through a call from another function, and through the table all
+		// count towards its threshold, and the callers reach theirs too.
+		for(Uptr callIndex = 0; callIndex < tierUpCallThreshold; ++callIndex)
+		{
+			WAVM_ERROR_UNLESS(invokeBinary(context, instance, "callAdd", I32(callIndex), 1)
+							  == I32(callIndex) + 1);
+			WAVM_ERROR_UNLESS(invokeBinary(context, instance, "callIndirectAdd", I32(callIndex), 2)
+							  == I32(callIndex) + 2);
+		}
+		waitForInstanceTierUp(instance);
+
+		// Only the functions that reached the threshold are tiered up.
+		WAVM_ERROR_UNLESS(isTieredUp(instance, "add"));
+		WAVM_ERROR_UNLESS(isTieredUp(instance, "callAdd"));
+		WAVM_ERROR_UNLESS(isTieredUp(instance, "callIndirectAdd"));
+		WAVM_ERROR_UNLESS(!isTieredUp(instance, "cold"));
+
+		// The tiered-up functions return the same results, and the table still holds the same
+		// function, which call_indirect in the tiered-up code matches against its type.
+		WAVM_ERROR_UNLESS(invokeBinary(context, instance, "add", 20, 22) == 42);
+		WAVM_ERROR_UNLESS(invokeBinary(context, instance, "callAdd", 20, 23) == 43);
+		WAVM_ERROR_UNLESS(invokeBinary(context, instance, "callIndirectAdd", 20, 24) == 44);
+		WAVM_ERROR_UNLESS(getTableElement(table, 0) == asObject(add));
+	}
+
+	// Destroying an instance while its functions are tiering up cancels the compile.
+	{
+		GCPointer<Context> context = createContext(compartment);
+		GCPointer<Instance> instance = instantiateModule(compartment, module, {}, "tierUpTest");
+		WAVM_ERROR_UNLESS(instance);
+		for(Uptr callIndex = 0; callIndex < tierUpCallThreshold; ++callIndex)
+		{ WAVM_ERROR_UNLESS(invokeBinary(context, instance, "add", 1, 2) == 3); }
+	}
+	WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+}
+
+I32 execTierUpTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	IR::Module irModule;
+	std::vector<WAST::Error> wastErrors;
+	if(!WAST::parseModule(tierUpTestWAST, sizeof(tierUpTestWAST), irModule, wastErrors))
+	{
+		WAST::reportParseErrors("tier-up test", tierUpTestWAST, wastErrors);
+		return EXIT_FAILURE;
+	}
+
+	LLVMJIT::CompileOptions compileOptions;
+	compileOptions.tier = LLVMJIT::CompileTier::baseline;
+	compileOptions.tierUpCallThreshold = tierUpCallThreshold;
+	setGlobalCompileOptions(compileOptions);
+
+	// Test tiering up functions compiled with the baseline tier, and interpreted functions. On
+	// hosts that the interpreter doesn't support, the interpreted module is compiled instead.
+	testTierUp(compileModule(irModule));
+	setGlobalInterpretModules(true);
+	testTierUp(compileModule(irModule));
+	setGlobalInterpretModules(false);
+	setGlobalCompileOptions(LLVMJIT::CompileOptions());
+
+	Timing::logTimer("Ran tier-up tests", timer);
+	return 0;
+}
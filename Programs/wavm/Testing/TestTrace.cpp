@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Logging/Trace.h"
+#include "WAVM/Platform/Mutex.h"
+#include "WAVM/Platform/Thread.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::Trace;
+
+struct TestSink : Sink
+{
+	Platform::Mutex mutex;
+	std::vector<Event> events;
+
+	virtual void write(const Event* newEvents, Uptr numEvents) override
+	{
+		Platform::Mutex::Lock lock(mutex);
+		events.insert(events.end(), newEvents, newEvents + numEvents);
+	}
+
+	Uptr countEvents(const char* name)
+	{
+		Platform::Mutex::Lock lock(mutex);
+		Uptr numEvents = 0;
+		for(const Event& event : events)
+		{
+			if(!strcmp(event.name, name)) { ++numEvents; }
+		}
+		return numEvents;
+	}
+};
+
+static constexpr Uptr numEventsPerThread = 10000;
+
+static I64 recordThreadEvents(void*)
+{
+	for(Uptr eventIndex = 0; eventIndex < numEventsPerThread; ++eventIndex)
+	{ Scope scope("test", "thread"); }
+	return 0;
+}
+
+static void testScopes()
+{
+	std::shared_ptr<TestSink> sink = std::make_shared<TestSink>();
+	setSink(sink);
+	WAVM_ERROR_UNLESS(isEnabled());
+
+	// Scopes record an event with the time they were alive, and long names are truncated.
+	const std::string longName(100, 'x');
+	{
+		Scope outerScope("test", "outer");
+		Scope innerScope("test", longName.c_str());
+	}
+	flush();
+	WAVM_ERROR_UNLESS(sink->events.size() == 2);
+	const Event& innerEvent = sink->events[0];
+	const Event& outerEvent = sink->events[1];
+	WAVM_ERROR_UNLESS(!strcmp(innerEvent.category, "test"));
+	WAVM_ERROR_UNLESS(std::string(innerEvent.name) == std::string(Event::maxNameChars, 'x'));
+	WAVM_ERROR_UNLESS(!strcmp(outerEvent.name, "outer"));
+	WAVM_ERROR_UNLESS(outerEvent.beginNanoseconds <= innerEvent.beginNanoseconds);
+	WAVM_ERROR_UNLESS(innerEvent.endNanoseconds <= outerEvent.endNanoseconds);
+
+	// Threads that record more events than fit in their buffers flush them instead of dropping
+	// them, and the events of exited threads are still written.
+	std::vector<Platform::Thread*> threads;
+	for(Uptr threadIndex = 0; threadIndex < 4; ++threadIndex)
+	{ threads.push_back(Platform::createThread(0, recordThreadEvents, nullptr)); }
+	for(Platform::Thread* thread : threads) { WAVM_ERROR_UNLESS(!Platform::joinThread(thread)); }
+	flush();
+	WAVM_ERROR_UNLESS(sink->countEvents("thread") == numEventsPerThread * threads.size());
+
+	// Setting a null sink disables tracing.
+	setSink(nullptr);
+	WAVM_ERROR_UNLESS(!isEnabled());
+	{
+		Scope scope("test", "disabled");
+	}
+	setSink(sink);
+	flush();
+	WAVM_ERROR_UNLESS(!sink->countEvents("disabled"));
+	setSink(nullptr);
+}
+
+static void testChromeTraceFileSink(const std::string& tracePath)
+{
+	std::shared_ptr<Sink> sink = createChromeTraceFileSink(tracePath.c_str());
+	WAVM_ERROR_UNLESS(sink);
+	Event events[2] = {{"test", "first", 1000, 2500, 0}, {"test", "\"quoted\"", 3000, 3001, 1}};
+	sink->write(events, 2);
+	sink.reset();
+
+	FILE* file = fopen(tracePath.c_str(), "r");
+	WAVM_ERROR_UNLESS(file);
+	std::string json;
+	char buffer[256];
+	Uptr numBytesRead;
+	while((numBytesRead = fread(buffer, 1, sizeof(buffer), file)))
+	{ json.append(buffer, numBytesRead); }
+	fclose(file);
+	remove(tracePath.c_str());
+
+	WAVM_ERROR_UNLESS(json
+					  == "[\n"
+						 "{\"name\":\"first\",\"cat\":\"test\",\"ph\":\"X\",\"ts\":1.000,"
+						 "\"dur\":1.500,\"pid\":1,\"tid\":0},\n"
+						 "{\"name\":\"\\\"quoted\\\"\",\"cat\":\"test\",\"ph\":\"X\",\"ts\":3.000,"
+						 "\"dur\":0.001,\"pid\":1,\"tid\":1}\n"
+						 "]\n");
+}
+
+I32 execTraceTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	testScopes();
+	testChromeTraceFileSink("wavm-trace-test.json");
+
+	Timing::logTimer("Ran trace tests", timer);
+	return 0;
+}
@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WAVM/Inline/Assert.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/VFS/BundleFS.h"
+#include "WAVM/VFS/MemoryFS.h"
+#include "WAVM/VFS/MountFS.h"
+#include "WAVM/VFS/VFS.h"
+#include "wavm-test.h"
+
+using namespace WAVM;
+using namespace WAVM::VFS;
+
+static void writeFile(FileSystem& fs, const std::string& path, const std::string& contents)
+{
+	VFD* vfd = nullptr;
+	WAVM_ERROR_UNLESS(
+		fs.open(path, FileAccessMode::writeOnly, FileCreateMode::createAlways, vfd)
+		== Result::success);
+	Uptr numBytesWritten = 0;
+	WAVM_ERROR_UNLESS(vfd->write(contents.data(), contents.size(), &numBytesWritten)
+					  == Result::success);
+	WAVM_ERROR_UNLESS(numBytesWritten == contents.size());
+	WAVM_ERROR_UNLESS(vfd->close() == Result::success);
+}
+
+static std::string readFile(FileSystem& fs, const std::string& path)
+{
+	VFD* vfd = nullptr;
+	WAVM_ERROR_UNLESS(
+		fs.open(path, FileAccessMode::readOnly, FileCreateMode::openExisting, vfd)
+		== Result::success);
+	std::string contents;
+	char buffer[7];
+	while(true)
+	{
+		Uptr numBytesRead = 0;
+		WAVM_ERROR_UNLESS(vfd->read(buffer, sizeof(buffer), &numBytesRead) == Result::success);
+		if(!numBytesRead) { break; }
+		contents.append(buffer, numBytesRead);
+	}
+	WAVM_ERROR_UNLESS(vfd->close() == Result::success);
+	return contents;
+}
+
+static std::vector<std::string> listDir(FileSystem& fs, const std::string& path)
+{
+	DirEntStream* stream = nullptr;
+	WAVM_ERROR_UNLESS(fs.openDir(path, stream) == Result::success);
+	std::vector<std::string> names;
+	DirEnt dirEnt;
+	while(stream->getNext(dirEnt)) { names.push_back(dirEnt.name); }
+	stream->close();
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+static void testMemoryFS()
+{
+	std::shared_ptr<FileSystem> fs = makeMemoryFS(64);
+
+	// Files can be created, written, and read back in directories.
+	WAVM_ERROR_UNLESS(fs->createDir("/dir") == Result::success);
+	WAVM_ERROR_UNLESS(fs->createDir("/dir") == Result::alreadyExists);
+	writeFile(*fs, "/dir/a", "hello, world");
+	WAVM_ERROR_UNLESS(readFile(*fs, "dir/./a") == "hello, world");
+	WAVM_ERROR_UNLESS(listDir(*fs, "/") == std::vector<std::string>{"dir"});
+
+	FileInfo fileInfo;
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/dir/a", fileInfo) == Result::success);
+	WAVM_ERROR_UNLESS(fileInfo.type == FileType::file && fileInfo.numBytes == 12);
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/dir/b", fileInfo) == Result::doesNotExist);
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/dir/a/b", fileInfo) == Result::isNotDirectory);
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/../a", fileInfo) == Result::notAccessible);
+
+	// Writes at offsets past the end of a file extend it with zeros.
+	VFD* vfd = nullptr;
+	WAVM_ERROR_UNLESS(
+		fs->open("/dir/b", FileAccessMode::readWrite, FileCreateMode::createNew, vfd)
+		== Result::success);
+	U64 offset = 4;
+	WAVM_ERROR_UNLESS(vfd->write("xy", 2, nullptr, &offset) == Result::success);
+	char bytes[8];
+	Uptr numBytesRead = 0;
+	WAVM_ERROR_UNLESS(vfd->read(bytes, sizeof(bytes), &numBytesRead) == Result::success);
+	WAVM_ERROR_UNLESS(numBytesRead == 6 && !memcmp(bytes, "\0\0\0\0xy", 6));
+
+	// Writes that exceed the quota fail, and unlinking a file frees its bytes once it's closed.
+	WAVM_ERROR_UNLESS(vfd->setFileSize(60) == Result::outOfQuota);
+	WAVM_ERROR_UNLESS(fs->unlinkFile("/dir/a") == Result::success);
+	WAVM_ERROR_UNLESS(vfd->setFileSize(58) == Result::success);
+	WAVM_ERROR_UNLESS(fs->unlinkFile("/dir/b") == Result::success);
+	WAVM_ERROR_UNLESS(vfd->setFileSize(64) == Result::success);
+	WAVM_ERROR_UNLESS(vfd->close() == Result::success);
+	writeFile(*fs, "/dir/c", std::string(64, 'c'));
+
+	// Files and directories can be renamed, but a directory can't be moved beneath itself.
+	WAVM_ERROR_UNLESS(fs->renameFile("/dir/c", "/d") == Result::success);
+	WAVM_ERROR_UNLESS(readFile(*fs, "/d") == std::string(64, 'c'));
+	WAVM_ERROR_UNLESS(fs->renameFile("/dir", "/dir/e") == Result::notPermitted);
+	WAVM_ERROR_UNLESS(fs->renameFile("/dir", "/d") == Result::isNotDirectory);
+	WAVM_ERROR_UNLESS(fs->renameFile("/dir", "/e") == Result::success);
+	WAVM_ERROR_UNLESS(fs->removeDir("/e/") == Result::success);
+	WAVM_ERROR_UNLESS(fs->removeDir("/d") == Result::isNotDirectory);
+	WAVM_ERROR_UNLESS(fs->unlinkFile("/d") == Result::success);
+	WAVM_ERROR_UNLESS(listDir(*fs, "/").empty());
+}
+
+// Appends a ustar header for a member to a tar archive.
+static void appendTarHeader(std::string& archive, const char* name, U64 numBytes, char typeFlag)
+{
+	char header[512];
+	memset(header, 0, sizeof(header));
+	snprintf(header, 100, "%s", name);
+	snprintf(header + 100, 8, "%07o", 0644);
+	snprintf(header + 124, 12, "%011llo", (unsigned long long)numBytes);
+	snprintf(header + 136, 12, "%011o", 1000000000);
+	header[156] = typeFlag;
+	memcpy(header + 257, "ustar", 6);
+	memcpy(header + 263, "00", 2);
+
+	U32 checksum = 0;
+	memset(header + 148, ' ', 8);
+	for(char c : header) { checksum += U8(c); }
+	snprintf(header + 148, 8, "%06o", checksum);
+	archive.append(header, sizeof(header));
+}
+
+static void appendTarFile(std::string& archive, const char* name, const std::string& contents)
+{
+	appendTarHeader(archive, name, contents.size(), '0');
+	archive += contents;
+	archive.append((512 - contents.size() % 512) % 512, '\0');
+}
+
+static std::shared_ptr<FileSystem> makeTestBundleFS(const std::string& archivePath)
+{
+	std::string archive;
+	appendTarHeader(archive, "assets/", 0, '5');
+	appendTarFile(archive, "assets/a.txt", "asset a");
+	appendTarFile(archive, "assets/sub/b.txt", std::string(1000, 'b'));
+	archive.append(1024, '\0');
+
+	writeFile(Platform::getHostFS(), archivePath, archive);
+	return makeBundleFS(archivePath);
+}
+
+static void testBundleFS(const std::string& archivePath)
+{
+	std::shared_ptr<FileSystem> fs = makeTestBundleFS(archivePath);
+	WAVM_ERROR_UNLESS(fs);
+
+	WAVM_ERROR_UNLESS(listDir(*fs, "/assets") == (std::vector<std::string>{"a.txt", "sub"}));
+	WAVM_ERROR_UNLESS(readFile(*fs, "/assets/a.txt") == "asset a");
+	WAVM_ERROR_UNLESS(readFile(*fs, "/assets/sub/b.txt") == std::string(1000, 'b'));
+
+	FileInfo fileInfo;
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/assets/sub", fileInfo) == Result::success);
+	WAVM_ERROR_UNLESS(fileInfo.type == FileType::directory);
+	WAVM_ERROR_UNLESS(fs->getFileInfo("/assets/a.txt", fileInfo) == Result::success);
+	WAVM_ERROR_UNLESS(fileInfo.numBytes == 7);
+	WAVM_ERROR_UNLESS(fileInfo.lastWriteTime.ns == I128(1000000000) * I128(1000000000));
+
+	// The bundle is read-only.
+	VFD* vfd = nullptr;
+	WAVM_ERROR_UNLESS(
+		fs->open("/assets/a.txt", FileAccessMode::readWrite, FileCreateMode::openExisting, vfd)
+		== Result::notPermitted);
+	WAVM_ERROR_UNLESS(
+		fs->open("/assets/c.txt", FileAccessMode::writeOnly, FileCreateMode::createNew, vfd)
+		== Result::notPermitted);
+	WAVM_ERROR_UNLESS(fs->unlinkFile("/assets/a.txt") == Result::notPermitted);
+	WAVM_ERROR_UNLESS(fs->createDir("/assets/new") == Result::notPermitted);
+
+	// A file that isn't a tar archive isn't a bundle.
+	fs.reset();
+	writeFile(Platform::getHostFS(), archivePath, std::string(512, 'x'));
+	WAVM_ERROR_UNLESS(!makeBundleFS(archivePath));
+}
+
+static void testMountFS(const std::string& archivePath)
+{
+	std::shared_ptr<FileSystem> rootFS = makeMemoryFS();
+	std::shared_ptr<FileSystem> tmpFS = makeMemoryFS();
+	std::shared_ptr<FileSystem> bundleFS = makeTestBundleFS(archivePath);
+	WAVM_ERROR_UNLESS(bundleFS);
+	std::shared_ptr<FileSystem> fs
+		= makeMountFS(rootFS, {{"/tmp", tmpFS}, {"/data/bundle", bundleFS}});
+
+	// Paths beneath the mount points are passed to the mounted file systems.
+	writeFile(*fs, "/tmp/a", "scratch");
+	WAVM_ERROR_UNLESS(readFile(*tmpFS, "/a") == "scratch");
+	WAVM_ERROR_UNLESS(readFile(*fs, "/data/bundle/assets/a.txt") == "asset a");
+	writeFile(*fs, "/b", "root");
+	WAVM_ERROR_UNLESS(readFile(*rootFS, "/b") == "root");
+
+	// Files can't be renamed between file systems, and mount points can't be removed.
+	WAVM_ERROR_UNLESS(fs->renameFile("/tmp/a", "/c") == Result::notSupported);
+	WAVM_ERROR_UNLESS(fs->renameFile("/tmp/a", "/tmp/c") == Result::success);
+	WAVM_ERROR_UNLESS(fs->removeDir("/tmp") == Result::busy);
+	WAVM_ERROR_UNLESS(listDir(*fs, "/tmp") == std::vector<std::string>{"c"});
+}
+
+// Writes and reads a host file at explicit offsets with batches of buffers, which are passed to
+// pwritev and preadv in a single call.
+static void testHostFilePositionalIO(const std::string& path)
+{
+	FileSystem& hostFS = Platform::getHostFS();
+	VFD* vfd = nullptr;
+	WAVM_ERROR_UNLESS(
+		hostFS.open(path, FileAccessMode::readWrite, FileCreateMode::createAlways, vfd)
+		== Result::success);
+
+	// Write 20 buffers of 3 bytes each, starting at offset 4, leaving a hole at the start.
+	static constexpr Uptr numBuffers = 20;
+	std::string contents;
+	for(Uptr index = 0; index < numBuffers; ++index)
+	{
+		contents += char('a' + index);
+		contents += char('A' + index);
+		contents += char('0' + index % 10);
+	}
+	IOWriteBuffer writeBuffers[numBuffers];
+	for(Uptr index = 0; index < numBuffers; ++index)
+	{ writeBuffers[index] = {contents.data() + index * 3, 3}; }
+	U64 offset = 4;
+	Uptr numBytesWritten = 0;
+	WAVM_ERROR_UNLESS(vfd->writev(writeBuffers, numBuffers, &numBytesWritten, &offset)
+					  == Result::success);
+	WAVM_ERROR_UNLESS(numBytesWritten == contents.size());
+
+	// Overwrite some of the bytes in the middle with a batch that doesn't start on a buffer
+	// boundary.
+	IOWriteBuffer overwriteBuffers[2] = {{"xy", 2}, {"z", 1}};
+	offset = 9;
+	WAVM_ERROR_UNLESS(vfd->writev(overwriteBuffers, 2, &numBytesWritten, &offset)
+					  == Result::success);
+	WAVM_ERROR_UNLESS(numBytesWritten == 3);
+	const std::string expectedContents = std::string(4, '\0') + contents.substr(0, 5) + "xyz"
+										 + contents.substr(8);
+
+	// Read the whole file back into buffers of 7 bytes, which are more than the file holds: the
+	// read stops at the end of the file, part way through a buffer.
+	char readBytes[numBuffers * 7];
+	memset(readBytes, 0xff, sizeof(readBytes));
+	IOReadBuffer readBuffers[numBuffers];
+	for(Uptr index = 0; index < numBuffers; ++index)
+	{ readBuffers[index] = {readBytes + index * 7, 7}; }
+	offset = 0;
+	Uptr numBytesRead = 0;
+	WAVM_ERROR_UNLESS(vfd->readv(readBuffers, numBuffers, &numBytesRead, &offset)
+					  == Result::success);
+	WAVM_ERROR_UNLESS(numBytesRead == expectedContents.size());
+	WAVM_ERROR_UNLESS(std::string(readBytes, numBytesRead) == expectedContents);
+	WAVM_ERROR_UNLESS(U8(readBytes[numBytesRead]) == 0xff);
+
+	// A short read that starts near the end of the file only reads the bytes before the end.
+	offset = expectedContents.size() - 5;
+	WAVM_ERROR_UNLESS(vfd->readv(readBuffers, 2, &numBytesRead, &offset) == Result::success);
+	WAVM_ERROR_UNLESS(numBytesRead == 5);
+	WAVM_ERROR_UNLESS(std::string(readBytes, 5) == expectedContents.substr(offset));
+
+	// A read at or past the end of the file reads nothing.
+	for(U64 endOffset : {U64(expectedContents.size()), U64(expectedContents.size() + 100)})
+	{
+		WAVM_ERROR_UNLESS(vfd->readv(readBuffers, numBuffers, &numBytesRead, &endOffset)
+						  == Result::success);
+		WAVM_ERROR_UNLESS(numBytesRead == 0);
+	}
+
+	// Positional reads and writes don't move the file's current offset.
+	WAVM_ERROR_UNLESS(vfd->read(readBytes, 4, &numBytesRead) == Result::success);
+	WAVM_ERROR_UNLESS(numBytesRead == 4);
+	WAVM_ERROR_UNLESS(std::string(readBytes, 4) == std::string(4, '\0'));
+
+	WAVM_ERROR_UNLESS(vfd->close() == Result::success);
+	WAVM_ERROR_UNLESS(readFile(hostFS, path) == expectedContents);
+	WAVM_ERROR_UNLESS(hostFS.unlinkFile(path) == Result::success);
+}
+
+I32 execVFSTest(int argc, char** argv)
+{
+	Timing::Timer timer;
+
+	const std::string archivePath
+		= Platform::getCurrentWorkingDirectory() + "/wavm-vfs-test-bundle.tar";
+	testMemoryFS();
+	testBundleFS(archivePath);
+	testMountFS(archivePath);
+	WAVM_ERROR_UNLESS(Platform::getHostFS().unlinkFile(archivePath) == Result::success);
+	testHostFilePositionalIO(Platform::getCurrentWorkingDirectory()
+							 + "/wavm-vfs-test-positional-io.bin");
+
+	Timing::logTimer("Ran VFS tests", timer);
+	return 0;
+}
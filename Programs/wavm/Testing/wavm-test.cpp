@@ -13,9 +13,27 @@ enum class TestCommand
 	hashMap,
 	hashSet,
 	i128,
+	indexMap,
+	linkModules,
+	rwMutex,
+	streamingLoad,
+	syntheticModule,
+	trace,
+	vfs,
 
 #if WAVM_ENABLE_RUNTIME
 	cAPI,
+	contextTimes,
+	fiber,
+	instanceReset,
+	memoryPool,
+	memoryPrefault,
+	memorySpan,
+	objectIdReuse,
+	resourceQuota,
+	ringBuffer,
+	snapshot,
+	tierUp,
 	benchmark,
 	script,
 #endif
@@ -26,13 +44,39 @@ static const char* getTestCommandListHelpText()
 	return "TestCommands:\n"
 #if WAVM_ENABLE_RUNTIME
 		   "  c-api         Test the C API\n"
+		   "  context-times Test Runtime::getContextTimes\n"
 #endif
 		   "  dumpmodules   Dump WAST/WASM modules from WAST test scripts\n"
-		   "  hashmap       Test HashMap\n"
+#if WAVM_ENABLE_RUNTIME
+		   "  fiber         Test Runtime::Fiber\n"
+#endif
+		   "  hashmap       Test HashMap (--benchmark: benchmark its implementations)\n"
 		   "  hashset       Test HashSet\n"
 		   "  i128          Test I128\n"
+		   "  indexmap      Test IndexMap\n"
+#if WAVM_ENABLE_RUNTIME
+		   "  instance-reset Test Runtime::resetInstance\n"
+		   "  memory-pool   Test Runtime::MemoryPool\n"
+		   "  memory-prefault Test Runtime::setMemoryPrefault\n"
+		   "  memory-span   Test Runtime::MemorySpan\n"
+		   "  object-id-reuse Test reusing the IDs of freed compartment objects\n"
+#endif
+		   "  linkmodules   Test IR::linkModules\n"
+#if WAVM_ENABLE_RUNTIME
+		   "  resource-quota Test Runtime::ResourceQuota reservations on many threads\n"
+		   "  ringbuffer    Test Runtime::MemoryRingBuffer\n"
+#endif
+		   "  rwmutex       Test Platform::ReaderBiasedRWMutex\n"
 #if WAVM_ENABLE_RUNTIME
-		   "  benchmark     Benchmark WAVM\n"
+		   "  snapshot      Test Runtime::snapshotInstance\n"
+		   "  tier-up       Test tiering up hot functions\n"
+#endif
+		   "  streaming-load Test loading a WASM module in chunks\n"
+		   "  synthetic-module Generate a large module for performance testing\n"
+		   "  trace         Test trace event recording\n"
+		   "  vfs           Test the in-memory, bundle, and mount file systems\n"
+#if WAVM_ENABLE_RUNTIME
+		   "  benchmark     Benchmark WAVM (alias: bench)\n"
 		   "  script        Run WAST test scripts\n"
 #endif
 		;
@@ -62,12 +106,84 @@ static TestCommand parseTestCommand(const char* string)
 	{
 		return TestCommand::i128;
 	}
+	else if(!strcmp(string, "indexmap"))
+	{
+		return TestCommand::indexMap;
+	}
+	else if(!strcmp(string, "linkmodules"))
+	{
+		return TestCommand::linkModules;
+	}
+	else if(!strcmp(string, "rwmutex"))
+	{
+		return TestCommand::rwMutex;
+	}
+	else if(!strcmp(string, "streaming-load"))
+	{
+		return TestCommand::streamingLoad;
+	}
+	else if(!strcmp(string, "synthetic-module"))
+	{
+		return TestCommand::syntheticModule;
+	}
+	else if(!strcmp(string, "trace"))
+	{
+		return TestCommand::trace;
+	}
+	else if(!strcmp(string, "vfs"))
+	{
+		return TestCommand::vfs;
+	}
 #if WAVM_ENABLE_RUNTIME
 	else if(!strcmp(string, "c-api"))
 	{
 		return TestCommand::cAPI;
 	}
-	else if(!strcmp(string, "benchmark"))
+	else if(!strcmp(string, "context-times"))
+	{
+		return TestCommand::contextTimes;
+	}
+	else if(!strcmp(string, "fiber"))
+	{
+		return TestCommand::fiber;
+	}
+	else if(!strcmp(string, "instance-reset"))
+	{
+		return TestCommand::instanceReset;
+	}
+	else if(!strcmp(string, "memory-pool"))
+	{
+		return TestCommand::memoryPool;
+	}
+	else if(!strcmp(string, "memory-prefault"))
+	{
+		return TestCommand::memoryPrefault;
+	}
+	else if(!strcmp(string, "memory-span"))
+	{
+		return TestCommand::memorySpan;
+	}
+	else if(!strcmp(string, "object-id-reuse"))
+	{
+		return TestCommand::objectIdReuse;
+	}
+	else if(!strcmp(string, "resource-quota"))
+	{
+		return TestCommand::resourceQuota;
+	}
+	else if(!strcmp(string, "ringbuffer"))
+	{
+		return TestCommand::ringBuffer;
+	}
+	else if(!strcmp(string, "snapshot"))
+	{
+		return TestCommand::snapshot;
+	}
+	else if(!strcmp(string, "tier-up"))
+	{
+		return TestCommand::tierUp;
+	}
+	else if(!strcmp(string, "benchmark") || !strcmp(string, "bench"))
 	{
 		return TestCommand::benchmark;
 	}
@@ -98,8 +214,26 @@ int execTestCommand(int argc, char** argv)
 		case TestCommand::hashMap: return execHashMapTest(argc - 1, argv + 1);
 		case TestCommand::hashSet: return execHashSetTest(argc - 1, argv + 1);
 		case TestCommand::i128: return execI128Test(argc - 1, argv + 1);
+		case TestCommand::indexMap: return execIndexMapTest(argc - 1, argv + 1);
+		case TestCommand::linkModules: return execLinkModulesTest(argc - 1, argv + 1);
+		case TestCommand::rwMutex: return execRWMutexTest(argc - 1, argv + 1);
+		case TestCommand::streamingLoad: return execStreamingLoadTest(argc - 1, argv + 1);
+		case TestCommand::syntheticModule: return execGenerateSyntheticModule(argc - 1, argv + 1);
+		case TestCommand::trace: return execTraceTest(argc - 1, argv + 1);
+		case TestCommand::vfs: return execVFSTest(argc - 1, argv + 1);
 #if WAVM_ENABLE_RUNTIME
 		case TestCommand::cAPI: return execCAPITest(argc - 1, argv + 1);
+		case TestCommand::contextTimes: return execContextTimesTest(argc - 1, argv + 1);
+		case TestCommand::fiber: return execFiberTest(argc - 1, argv + 1);
+		case TestCommand::instanceReset: return execInstanceResetTest(argc - 1, argv + 1);
+		case TestCommand::memoryPool: return execMemoryPoolTest(argc - 1, argv + 1);
+		case TestCommand::memoryPrefault: return execMemoryPrefaultTest(argc - 1, argv + 1);
+		case TestCommand::memorySpan: return execMemorySpanTest(argc - 1, argv + 1);
+		case TestCommand::objectIdReuse: return execObjectIdReuseTest(argc - 1, argv + 1);
+		case TestCommand::resourceQuota: return execResourceQuotaTest(argc - 1, argv + 1);
+		case TestCommand::ringBuffer: return execRingBufferTest(argc - 1, argv + 1);
+		case TestCommand::snapshot: return execSnapshotTest(argc - 1, argv + 1);
+		case TestCommand::tierUp: return execTierUpTest(argc - 1, argv + 1);
 		case TestCommand::benchmark: return execBenchmark(argc - 1, argv + 1);
 		case TestCommand::script: return execRunTestScript(argc - 1, argv + 1);
 #endif
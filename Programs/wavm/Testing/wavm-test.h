@@ -3,12 +3,30 @@
 #include "WAVM/Inline/Config.h"
 
 int execDumpTestModules(int argc, char** argv);
+int execGenerateSyntheticModule(int argc, char** argv);
 int execHashMapTest(int argc, char** argv);
 int execHashSetTest(int argc, char** argv);
+int execIndexMapTest(int argc, char** argv);
+int execLinkModulesTest(int argc, char** argv);
 int execI128Test(int argc, char** argv);
+int execRWMutexTest(int argc, char** argv);
+int execStreamingLoadTest(int argc, char** argv);
+int execTraceTest(int argc, char** argv);
+int execVFSTest(int argc, char** argv);
 
 #if WAVM_ENABLE_RUNTIME
 int execBenchmark(int argc, char** argv);
+int execContextTimesTest(int argc, char** argv);
+int execFiberTest(int argc, char** argv);
+int execInstanceResetTest(int argc, char** argv);
+int execMemoryPoolTest(int argc, char** argv);
+int execMemoryPrefaultTest(int argc, char** argv);
+int execMemorySpanTest(int argc, char** argv);
+int execObjectIdReuseTest(int argc, char** argv);
+int execResourceQuotaTest(int argc, char** argv);
+int execRingBufferTest(int argc, char** argv);
+int execSnapshotTest(int argc, char** argv);
+int execTierUpTest(int argc, char** argv);
 int execRunTestScript(int argc, char** argv);
 
 #ifdef __cplusplus
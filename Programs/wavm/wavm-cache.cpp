@@ -0,0 +1,350 @@
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/CLI.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/ObjectCache/ObjectCache.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/VFS/VFS.h"
+#include "WAVM/WASM/WASM.h"
+#include "wavm.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+static void showCacheWarmHelp(Log::Category outputCategory)
+{
+	Log::printf(outputCategory,
+				"Usage: wavm cache warm [options] <dir|manifest>\n"
+				"  <dir|manifest>        A directory containing .wasm files to compile, or a file\n"
+				"                        that lists the .wasm files to compile, one per line. A\n"
+				"                        line may end with an integer priority: files with a\n"
+				"                        higher priority are compiled first.\n"
+				"\n"
+				"Compiles WebAssembly modules into the object cache given by the\n"
+				"WAVM_OBJECT_CACHE_DIR environment variable, so the first wavm run of each\n"
+				"module doesn't need to compile it. Modules that are already in the cache are\n"
+				"skipped. The options must match the options passed to wavm run.\n"
+				"\n"
+				"Options:\n"
+				"  -O0, -O1, -O2, -O3    Set the optimization level (default: -O1)\n"
+				"  --debug-info=<level>  Emit none, line-tables, or full debug info (default:\n"
+				"                        line-tables)\n"
+				"  --no-source-info      Same as --debug-info=none\n"
+				"  --eliminate-dead-functions\n"
+				"                        Compile functions that can't be called as stubs that\n"
+				"                        trap\n"
+				"  --relaxed-nan         Allow float operators to produce nondeterministic NaNs\n"
+				"  --cache-stack-pointer Keep the module's stack pointer global in a register\n"
+				"                        between calls\n"
+				"  --share-trap-blocks   Share one trap call between a function's trap sites\n"
+				"  --enable <feature>    Enable the specified feature. See the list of supported\n"
+				"                        features below.\n"
+				"  --threads=<n>         Compile at most <n> modules at once (default: the number\n"
+				"                        of hardware threads)\n"
+				"\n"
+				"Features:\n"
+				"%s"
+				"\n",
+				getFeatureListHelpText().c_str());
+}
+
+void showCacheHelp(Log::Category outputCategory)
+{
+	Log::printf(outputCategory,
+				"Usage: wavm cache <command> [command arguments]\n"
+				"\n"
+				"Commands:\n"
+				"  warm          Compile modules into the object cache\n");
+}
+
+template<Uptr numPrefixChars>
+static bool stringStartsWith(const char* string, const char (&prefix)[numPrefixChars])
+{
+	return !strncmp(string, prefix, numPrefixChars - 1);
+}
+
+static bool stringEndsWith(const std::string& string, const char* suffix)
+{
+	const Uptr numSuffixChars = strlen(suffix);
+	return string.size() >= numSuffixChars
+		   && !string.compare(string.size() - numSuffixChars, numSuffixChars, suffix);
+}
+
+// Adds a PrecompileModule for each .wasm file in a directory.
+static bool addDirectoryModules(const std::string& dirPath,
+								std::vector<ObjectCache::PrecompileModule>& outModules)
+{
+	VFS::DirEntStream* dirEntStream = nullptr;
+	const VFS::Result result = Platform::getHostFS().openDir(dirPath, dirEntStream);
+	if(result != VFS::Result::success)
+	{
+		Log::printf(
+			Log::error, "Error opening '%s': %s\n", dirPath.c_str(), VFS::describeResult(result));
+		return false;
+	}
+
+	bool succeeded = true;
+	VFS::DirEnt dirEnt;
+	while(succeeded && dirEntStream->getNext(dirEnt))
+	{
+		if(dirEnt.type != VFS::FileType::file || !stringEndsWith(dirEnt.name, ".wasm"))
+		{ continue; }
+
+		ObjectCache::PrecompileModule module;
+		module.name = dirPath + "/" + dirEnt.name;
+		succeeded = loadFile(module.name.c_str(), module.wasmBytes);
+		outModules.push_back(std::move(module));
+	}
+	dirEntStream->close();
+
+	return succeeded;
+}
+
+// Adds a PrecompileModule for each file listed in a manifest.
+static bool addManifestModules(const char* manifestPath,
+							   std::vector<ObjectCache::PrecompileModule>& outModules)
+{
+	std::vector<U8> manifestBytes;
+	if(!loadFile(manifestPath, manifestBytes)) { return false; }
+
+	const std::string manifest(manifestBytes.begin(), manifestBytes.end());
+	Uptr lineStart = 0;
+	while(lineStart < manifest.size())
+	{
+		Uptr lineEnd = manifest.find('\n', lineStart);
+		if(lineEnd == std::string::npos) { lineEnd = manifest.size(); }
+		std::string line = manifest.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+
+		while(line.size() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+		{ line.pop_back(); }
+		if(!line.size() || line[0] == '#') { continue; }
+
+		// If the line ends with an integer, it's the module's priority.
+		ObjectCache::PrecompileModule module;
+		const Uptr lastSpace = line.find_last_of(" \t");
+		if(lastSpace != std::string::npos)
+		{
+			const std::string priorityString = line.substr(lastSpace + 1);
+			char* priorityEnd = nullptr;
+			const long priority = strtol(priorityString.c_str(), &priorityEnd, 10);
+			if(!*priorityEnd)
+			{
+				module.priority = I32(priority);
+				line.resize(lastSpace);
+				while(line.size() && (line.back() == ' ' || line.back() == '\t'))
+				{ line.pop_back(); }
+			}
+		}
+
+		module.name = std::move(line);
+		if(!loadFile(module.name.c_str(), module.wasmBytes)) { return false; }
+		outModules.push_back(std::move(module));
+	}
+
+	return true;
+}
+
+static bool compileBinaryModule(const U8* wasmBytes,
+								Uptr numWASMBytes,
+								const IR::FeatureSpec& featureSpec,
+								const LLVMJIT::CompileOptions& compileOptions,
+								std::vector<U8>& outObjectCode)
+{
+	IR::Module irModule(featureSpec);
+	WASM::LoadError loadError;
+	if(!WASM::loadBinaryModule(wasmBytes, numWASMBytes, irModule, &loadError))
+	{
+		Log::printf(Log::error, "%s\n", loadError.message.c_str());
+		return false;
+	}
+
+	outObjectCode = LLVMJIT::compileModule(irModule, LLVMJIT::getHostTargetSpec(), compileOptions);
+	return true;
+}
+
+static int execCacheWarmCommand(int argc, char** argv)
+{
+	const char* inputPath = nullptr;
+	IR::FeatureSpec featureSpec;
+	LLVMJIT::CompileOptions compileOptions;
+	Uptr numThreads = Platform::getNumberOfHardwareThreads();
+	for(int argIndex = 0; argIndex < argc; ++argIndex)
+	{
+		if(!strcmp(argv[argIndex], "--enable"))
+		{
+			++argIndex;
+			if(argIndex == argc)
+			{
+				Log::printf(Log::error, "Expected feature name following '--enable'.\n");
+				return EXIT_FAILURE;
+			}
+
+			if(!parseAndSetFeature(argv[argIndex], featureSpec, true))
+			{
+				Log::printf(Log::error,
+							"Unknown feature '%s'. Supported features:\n"
+							"%s"
+							"\n",
+							argv[argIndex],
+							getFeatureListHelpText().c_str());
+				return EXIT_FAILURE;
+			}
+		}
+		else if(!strcmp(argv[argIndex], "-O0") || !strcmp(argv[argIndex], "-O1")
+				|| !strcmp(argv[argIndex], "-O2") || !strcmp(argv[argIndex], "-O3"))
+		{
+			compileOptions.optimizationLevel = Uptr(argv[argIndex][2] - '0');
+		}
+		else if(stringStartsWith(argv[argIndex], "--debug-info="))
+		{
+			if(!parseDebugInfoLevel(argv[argIndex] + strlen("--debug-info="), compileOptions))
+			{ return EXIT_FAILURE; }
+		}
+		else if(!strcmp(argv[argIndex], "--no-source-info"))
+		{
+			compileOptions.debugInfoLevel = LLVMJIT::DebugInfoLevel::none;
+		}
+		else if(!strcmp(argv[argIndex], "--eliminate-dead-functions"))
+		{
+			compileOptions.eliminateDeadFunctions = true;
+		}
+		else if(!strcmp(argv[argIndex], "--relaxed-nan"))
+		{
+			compileOptions.relaxedNaN = true;
+		}
+		else if(!strcmp(argv[argIndex], "--cache-stack-pointer"))
+		{
+			compileOptions.cacheStackPointer = true;
+		}
+		else if(!strcmp(argv[argIndex], "--share-trap-blocks"))
+		{
+			compileOptions.shareTrapBlocks = true;
+		}
+		else if(stringStartsWith(argv[argIndex], "--threads="))
+		{
+			const char* numThreadsString = argv[argIndex] + strlen("--threads=");
+			const int numThreadsInt = atoi(numThreadsString);
+			if(numThreadsInt <= 0)
+			{
+				Log::printf(Log::error,
+							"Invalid thread count '%s'. Expected an integer greater than 0.\n",
+							numThreadsString);
+				return EXIT_FAILURE;
+			}
+			numThreads = Uptr(numThreadsInt);
+		}
+		else if(!inputPath && argv[argIndex][0] != '-')
+		{
+			inputPath = argv[argIndex];
+		}
+		else
+		{
+			showCacheWarmHelp(Log::error);
+			return EXIT_FAILURE;
+		}
+	}
+	if(!inputPath)
+	{
+		showCacheWarmHelp(Log::error);
+		return EXIT_FAILURE;
+	}
+	if(!numThreads) { numThreads = 1; }
+
+	std::shared_ptr<Runtime::ObjectCacheInterface> objectCache;
+	if(!openObjectCache(compileOptions, objectCache)) { return EXIT_FAILURE; }
+	if(!objectCache)
+	{
+		Log::printf(Log::error, "WAVM_OBJECT_CACHE_DIR must be set to the object cache path.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Load the modules from the directory or manifest.
+	std::vector<ObjectCache::PrecompileModule> modules;
+	VFS::FileInfo inputFileInfo;
+	const VFS::Result result = Platform::getHostFS().getFileInfo(inputPath, inputFileInfo);
+	if(result != VFS::Result::success)
+	{
+		Log::printf(Log::error, "Error opening '%s': %s\n", inputPath, VFS::describeResult(result));
+		return EXIT_FAILURE;
+	}
+	if(inputFileInfo.type == VFS::FileType::directory)
+	{
+		if(!addDirectoryModules(inputPath, modules)) { return EXIT_FAILURE; }
+	}
+	else if(!addManifestModules(inputPath, modules))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> moduleNames;
+	for(const ObjectCache::PrecompileModule& module : modules)
+	{ moduleNames.push_back(module.name); }
+
+	// Compile the modules the same way wavm run compiles modules that aren't in the cache.
+	Timing::Timer warmTimer;
+	std::shared_ptr<ObjectCache::PrecompileJob> job = ObjectCache::precompileAsync(
+		objectCache,
+		std::move(modules),
+		[featureSpec, compileOptions](
+			const U8* wasmBytes, Uptr numWASMBytes, std::vector<U8>& outObject) {
+			return compileBinaryModule(
+				wasmBytes, numWASMBytes, featureSpec, compileOptions, outObject);
+		},
+		numThreads,
+		[&moduleNames](const ObjectCache::PrecompileResult& result) {
+			const char* moduleName = moduleNames[result.moduleIndex].c_str();
+			if(result.wasAlreadyCached)
+			{ Log::printf(Log::debug, "%s is already in the cache.\n", moduleName); }
+			else if(result.succeeded)
+			{
+				Log::printf(
+					Log::output, "Compiled %s in %.2fms\n", moduleName, result.compileMilliseconds);
+			}
+			else
+			{
+				Log::printf(Log::error, "Failed to compile %s\n", moduleName);
+			}
+		});
+	const ObjectCache::PrecompileProgress progress = ObjectCache::waitForPrecompile(job);
+
+	Log::printf(Log::output,
+				"Compiled %" WAVM_PRIuPTR " of %" WAVM_PRIuPTR " modules in %.2fms (%" WAVM_PRIuPTR
+				" already cached, %" WAVM_PRIuPTR " failed)\n",
+				progress.numCompiled,
+				progress.numModules,
+				warmTimer.getMilliseconds(),
+				progress.numAlreadyCached,
+				progress.numFailed);
+
+	return progress.numFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int execCacheCommand(int argc, char** argv)
+{
+	if(argc < 1)
+	{
+		showCacheHelp(Log::Category::error);
+		return EXIT_FAILURE;
+	}
+	else if(!strcmp(argv[0], "warm"))
+	{
+		return execCacheWarmCommand(argc - 1, argv + 1);
+	}
+	else
+	{
+		Log::printf(Log::error, "Invalid command: %s\n\n", argv[0]);
+		showCacheHelp(Log::Category::error);
+		return EXIT_FAILURE;
+	}
+}
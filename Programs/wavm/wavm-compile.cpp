@@ -1,7 +1,13 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include "WAVM/IR/FeatureSpec.h"
 #include "WAVM/IR/Module.h"
+#include "WAVM/IR/Validate.h"
 #include "WAVM/Inline/BasicTypes.h"
 #include "WAVM/Inline/CLI.h"
 #include "WAVM/Inline/Config.h"
@@ -9,6 +15,11 @@
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/Runtime/Runtime.h"
+#include "WAVM/VFS/VFS.h"
 #include "WAVM/WASM/WASM.h"
 #include "WAVM/WASTParse/WASTParse.h"
 #include "wavm.h"
@@ -17,7 +28,10 @@ using namespace WAVM;
 using namespace WAVM::IR;
 using namespace WAVM::Runtime;
 
-bool loadTextOrBinaryModule(const char* filename, IR::Module& outModule)
+bool loadTextOrBinaryModule(const char* filename,
+							IR::Module& outModule,
+							bool validateFunctionBodies,
+							std::vector<U8>* outWASMBytes)
 {
 	// Read the specified file into an array.
 	std::vector<U8> fileBytes;
@@ -28,8 +42,14 @@ bool loadTextOrBinaryModule(const char* filename, IR::Module& outModule)
 	   && !memcmp(fileBytes.data(), WASM::magicNumber, sizeof(WASM::magicNumber)))
 	{
 		WASM::LoadError loadError;
-		if(WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), outModule, &loadError))
-		{ return true; }
+		if(validateFunctionBodies
+			   ? WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), outModule, &loadError)
+			   : WASM::loadBinaryModuleWithoutValidatingCode(
+				   fileBytes.data(), fileBytes.size(), outModule, &loadError))
+		{
+			if(outWASMBytes) { *outWASMBytes = std::move(fileBytes); }
+			return true;
+		}
 		else
 		{
 			Log::printf(Log::error, "%s\n", loadError.message.c_str());
@@ -62,7 +82,9 @@ static const char* getOutputFormatHelpText()
 		   "  object                      The target platform's native object file format.\n"
 		   "  assembly                    The target platform's native assembly format.\n"
 		   "  precompiled-wasm (default)  The original WebAssembly module with object code\n"
-		   "                              embedded in the wavm.precompiled_object section.\n";
+		   "                              embedded in the wavm.precompiled_object section, or\n"
+		   "                              with several target CPUs, object code for each CPU\n"
+		   "                              in a wavm.precompiled_object.<cpu> section.\n";
 }
 
 void showCompileHelp(Log::Category outputCategory)
@@ -71,12 +93,50 @@ void showCompileHelp(Log::Category outputCategory)
 
 	Log::printf(outputCategory,
 				"Usage: wavm compile [options] <in.wast|wasm> <output file>\n"
+				"       wavm compile [options] --batch <manifest>\n"
 				"  --target-triple <triple>  Set the target triple (default: %s)\n"
-				"  --target-cpu <cpu>        Set the target CPU (default: %s)\n"
+				"  --target-cpu <cpu>[,...]  Set the target CPU (default: %s). The\n"
+				"                            precompiled-wasm format accepts a comma separated\n"
+				"                            list of CPUs, and wavm run uses the best of them\n"
+				"                            that the host supports.\n"
 				"  --enable <feature>        Enable the specified feature. See the list of\n"
 				"                            supported features below.\n"
 				"  --format=<format>         Specifies the format of the output file. See the\n"
 				"                            list of supported output formats below.\n"
+				"  -O0, -O1, -O2, -O3        Set the optimization level (default: -O1)\n"
+				"  --debug-info=<level>      Emit none, line-tables, or full debug info. Traps\n"
+				"                            are only mapped back to WebAssembly instructions\n"
+				"                            with line-tables or full (default: line-tables)\n"
+				"  --compile-partitions=<n>  Compile the module in <n> partitions on parallel\n"
+				"                            threads (default: chosen from the module size)\n"
+				"  --profile-in=<file>       Optimize the module for the execution counts in a\n"
+				"                            profile written by wavm run --profile-out\n"
+				"  --eliminate-dead-functions\n"
+				"                            Compile functions that can't be called as stubs\n"
+				"                            that trap\n"
+				"  --relaxed-nan             Allow float operators to produce nondeterministic\n"
+				"                            NaNs, so they compile to faster code\n"
+				"  --cache-stack-pointer     Keep the module's stack pointer global in a\n"
+				"                            register between calls\n"
+				"  --share-trap-blocks       Share one trap call between a function's trap\n"
+				"                            sites\n"
+				"  --validate-while-compiling\n"
+				"                            Validate the function bodies of a binary module\n"
+				"                            while compiling them, instead of while loading it\n"
+				"  --time-passes             Log a JSON report of the time spent in each compile\n"
+				"                            phase, LLVM pass, and the slowest functions\n"
+				"  --time-passes-functions=<n>\n"
+				"                            Include the <n> slowest functions in the\n"
+				"                            --time-passes report (default: 20)\n"
+				"  --batch <manifest>        Compile each module listed in <manifest>, one\n"
+				"                            '<in.wast|wasm> <output file>' per line, in one\n"
+				"                            process, and log a JSON report of each module's\n"
+				"                            compile time and the process's peak memory usage\n"
+				"                            when it finished. Outputs are written atomically,\n"
+				"                            and object code is shared with the object cache\n"
+				"                            in WAVM_OBJECT_CACHE_DIR for the host target\n"
+				"  --batch-threads=<n>       Compile <n> batch modules in parallel (default: the\n"
+				"                            number of hardware threads)\n"
 				"\n"
 				"Output formats:\n"
 				"%s"
@@ -90,12 +150,168 @@ void showCompileHelp(Log::Category outputCategory)
 				getFeatureListHelpText().c_str());
 }
 
+bool parseDebugInfoLevel(const char* levelString, LLVMJIT::CompileOptions& compileOptions)
+{
+	if(!strcmp(levelString, "none"))
+	{
+		compileOptions.debugInfoLevel = LLVMJIT::DebugInfoLevel::none;
+	}
+	else if(!strcmp(levelString, "line-tables"))
+	{
+		compileOptions.debugInfoLevel = LLVMJIT::DebugInfoLevel::lineTables;
+	}
+	else if(!strcmp(levelString, "full"))
+	{
+		compileOptions.debugInfoLevel = LLVMJIT::DebugInfoLevel::full;
+	}
+	else
+	{
+		Log::printf(Log::error,
+					"Invalid debug info level '%s': expected none, line-tables, or full.\n",
+					levelString);
+		return false;
+	}
+	return true;
+}
+
+bool loadProfile(const char* filename, std::shared_ptr<const LLVMJIT::ModuleProfile>& outProfile)
+{
+	std::vector<U8> fileBytes;
+	if(!loadFile(filename, fileBytes)) { return false; }
+
+	std::shared_ptr<LLVMJIT::ModuleProfile> profile = std::make_shared<LLVMJIT::ModuleProfile>();
+	if(!LLVMJIT::deserializeProfile(fileBytes, *profile))
+	{
+		Log::printf(Log::error, "'%s' is not a valid profile.\n", filename);
+		return false;
+	}
+
+	outProfile = std::move(profile);
+	return true;
+}
+
 template<Uptr numPrefixChars>
 static bool stringStartsWith(const char* string, const char (&prefix)[numPrefixChars])
 {
 	return !strncmp(string, prefix, numPrefixChars - 1);
 }
 
+static bool validateTargetSpec(const LLVMJIT::TargetSpec& targetSpec,
+							   const IR::FeatureSpec& featureSpec)
+{
+	switch(LLVMJIT::validateTarget(targetSpec, featureSpec))
+	{
+	case LLVMJIT::TargetValidationResult::valid: return true;
+
+	case LLVMJIT::TargetValidationResult::invalidTargetSpec:
+		Log::printf(Log::error,
+					"Target triple (%s) or CPU (%s) is invalid.\n",
+					targetSpec.triple.c_str(),
+					targetSpec.cpu.c_str());
+		return false;
+	case LLVMJIT::TargetValidationResult::unsupportedArchitecture:
+		Log::printf(Log::error, "WAVM doesn't support the target architecture.\n");
+		return false;
+	case LLVMJIT::TargetValidationResult::x86CPUDoesNotSupportSSE41:
+		Log::printf(Log::error,
+					"Target X86 CPU (%s) does not support SSE 4.1, which"
+					" WAVM requires for WebAssembly SIMD code.\n",
+					targetSpec.cpu.c_str());
+		return false;
+	case LLVMJIT::TargetValidationResult::wavmDoesNotSupportSIMDOnArch:
+		Log::printf(Log::error, "WAVM does not support SIMD on the target CPU architecture.\n");
+		return false;
+	case LLVMJIT::TargetValidationResult::memory64Requires64bitTarget:
+		Log::printf(Log::error,
+					"Target CPU (%s) does not support 64-bit memories.\n",
+					targetSpec.cpu.c_str());
+		return false;
+	case LLVMJIT::TargetValidationResult::table64Requires64bitTarget:
+		Log::printf(Log::error,
+					"Target CPU (%s) does not support 64-bit tables.\n",
+					targetSpec.cpu.c_str());
+		return false;
+
+	default: WAVM_UNREACHABLE();
+	};
+}
+
+// Logs the time spent loading and compiling a module as JSON.
+static void logCompileTimeReport(const char* filename,
+								 const IR::Module& irModule,
+								 U64 loadNanoseconds,
+								 const LLVMJIT::CompileTimeReport& timeReport,
+								 Uptr numSlowestFunctions)
+{
+	const Uptr numFunctionDefs = irModule.functions.defs.size();
+	const F64 functionDefsPerSecond
+		= timeReport.totalNanoseconds
+			  ? F64(numFunctionDefs) * 1000000000.0 / F64(timeReport.totalNanoseconds)
+			  : 0.0;
+
+	char buffer[512];
+	std::string json = "{\n  \"module\": ";
+	appendJSONString(json, filename);
+	snprintf(buffer,
+			 sizeof(buffer),
+			 ",\n  \"functionDefs\": %" WAVM_PRIuPTR ",\n  \"functionDefsPerSecond\": %.1f"
+			 ",\n  \"phaseNanoseconds\": {\"load\": %" PRIu64 ", \"emitIR\": %" PRIu64
+			 ", \"optimize\": %" PRIu64 ", \"codegen\": %" PRIu64 ", \"total\": %" PRIu64 "}"
+			 ",\n  \"passes\": [",
+			 numFunctionDefs,
+			 functionDefsPerSecond,
+			 loadNanoseconds,
+			 timeReport.emitIRNanoseconds,
+			 timeReport.optimizeNanoseconds,
+			 timeReport.codegenNanoseconds,
+			 timeReport.totalNanoseconds);
+	json += buffer;
+
+	for(Uptr passIndex = 0; passIndex < timeReport.passTimes.size(); ++passIndex)
+	{
+		const LLVMJIT::CompileTimeReport::PassTime& passTime = timeReport.passTimes[passIndex];
+		json += passIndex ? ",\n    {\"name\": " : "\n    {\"name\": ";
+		appendJSONString(json, passTime.name);
+		snprintf(buffer, sizeof(buffer), ", \"nanoseconds\": %" PRIu64 "}", passTime.nanoseconds);
+		json += buffer;
+	}
+	json += "\n  ],\n  \"slowestFunctions\": [";
+
+	// Sort the function definitions by descending compile time.
+	std::vector<Uptr> functionDefIndices;
+	for(Uptr functionDefIndex = 0; functionDefIndex < timeReport.functionDefNanoseconds.size();
+		++functionDefIndex)
+	{ functionDefIndices.push_back(functionDefIndex); }
+	std::stable_sort(functionDefIndices.begin(), functionDefIndices.end(), [&](Uptr a, Uptr b) {
+		return timeReport.functionDefNanoseconds[a] > timeReport.functionDefNanoseconds[b];
+	});
+	if(functionDefIndices.size() > numSlowestFunctions)
+	{ functionDefIndices.resize(numSlowestFunctions); }
+
+	IR::DisassemblyNames disassemblyNames;
+	IR::getDisassemblyNames(irModule, disassemblyNames);
+	for(Uptr index = 0; index < functionDefIndices.size(); ++index)
+	{
+		const Uptr functionDefIndex = functionDefIndices[index];
+		const Uptr functionIndex = irModule.functions.imports.size() + functionDefIndex;
+		snprintf(buffer,
+				 sizeof(buffer),
+				 "%s\n    {\"functionDefIndex\": %" WAVM_PRIuPTR ", \"name\": ",
+				 index ? "," : "",
+				 functionDefIndex);
+		json += buffer;
+		appendJSONString(json, disassemblyNames.functions[functionIndex].name);
+		snprintf(buffer,
+				 sizeof(buffer),
+				 ", \"nanoseconds\": %" PRIu64 "}",
+				 timeReport.functionDefNanoseconds[functionDefIndex]);
+		json += buffer;
+	}
+	json += "\n  ]\n}\n";
+
+	Log::printf(Log::output, "%s", json.c_str());
+}
+
 enum class OutputFormat
 {
 	unspecified,
@@ -106,14 +322,401 @@ enum class OutputFormat
 	assembly,
 };
 
+// Serializes a module to a binary file, writing the bytes to the file as they are serialized
+// instead of serializing the whole module to memory first.
+static bool saveBinaryModuleToFile(const char* filename, const IR::Module& irModule)
+{
+	VFS::VFD* vfd = nullptr;
+	VFS::Result result = Platform::getHostFS().open(
+		filename, VFS::FileAccessMode::writeOnly, VFS::FileCreateMode::createAlways, vfd);
+	if(result != VFS::Result::success)
+	{
+		Log::printf(Log::error, "Error saving '%s': %s\n", filename, VFS::describeResult(result));
+		return false;
+	}
+
+	Timing::Timer saveTimer;
+	Uptr numBytes = 0;
+	WASM::saveBinaryModule(irModule, [&](const U8* bytes, Uptr numSinkBytes) {
+		numBytes += numSinkBytes;
+		if(result == VFS::Result::success) { result = vfd->write(bytes, numSinkBytes); }
+	});
+	Timing::logRatePerSecond("Serialized WASM", saveTimer, numBytes / 1024.0 / 1024.0, "MiB");
+
+	const VFS::Result closeResult = vfd->close();
+	if(result == VFS::Result::success) { result = closeResult; }
+	if(result != VFS::Result::success)
+	{
+		Log::printf(Log::error, "Error saving '%s': %s\n", filename, VFS::describeResult(result));
+		return false;
+	}
+	return true;
+}
+
+// The options that every module compiled by a wavm compile command is compiled with.
+struct CompileSettings
+{
+	LLVMJIT::TargetSpec targetSpec;
+	std::vector<std::string> targetCPUs;
+	IR::FeatureSpec featureSpec;
+	OutputFormat outputFormat = OutputFormat::unspecified;
+	LLVMJIT::CompileOptions compileOptions;
+	bool timePasses = false;
+	Uptr numSlowestFunctions = 20;
+
+	// If non-null, the object cache that the object code for precompiled-wasm outputs is looked up
+	// in. It's only used when compiling binary modules for the host target.
+	std::shared_ptr<Runtime::ObjectCacheInterface> objectCache;
+};
+
+// Compiles a module file to an output file in the settings' output format, logging any errors.
+static bool compileModuleFile(const CompileSettings& settings,
+							  const char* inputFilename,
+							  const char* outputFilename)
+{
+	const OutputFormat outputFormat = settings.outputFormat;
+	const std::vector<std::string>& targetCPUs = settings.targetCPUs;
+	const LLVMJIT::TargetSpec& targetSpec = settings.targetSpec;
+	LLVMJIT::CompileOptions compileOptions = settings.compileOptions;
+
+	// Load the module IR. Decoding and validation are interleaved, so they're timed together.
+	// If the input is a binary module, keep its bytes, so the precompiled object code can be
+	// appended to them without re-encoding the module.
+	IR::Module irModule(settings.featureSpec);
+	std::vector<U8> inputWASMBytes;
+	Timing::Timer loadTimer;
+	if(!loadTextOrBinaryModule(inputFilename,
+							   irModule,
+							   !compileOptions.validateFunctionBodies,
+							   outputFormat == OutputFormat::precompiledModule ? &inputWASMBytes
+																			   : nullptr))
+	{ return false; }
+	const U64 loadNanoseconds = U64(loadTimer.getNanoseconds());
+
+	LLVMJIT::CompileTimeReport timeReport;
+	LLVMJIT::CompileTimeReport* timeReportPointer = settings.timePasses ? &timeReport : nullptr;
+
+	// If the function bodies weren't validated when loading the module, compiling it may throw a
+	// validation exception.
+	try
+	{
+		switch(outputFormat)
+		{
+		case OutputFormat::precompiledModule: {
+			// Compile the module to object code for each target CPU, and add the object code to the
+			// module as a user section. If there are multiple target CPUs, the CPU is appended to
+			// the section name. If the input was a binary module, the sections are appended to its
+			// bytes. Otherwise, they're added to the IR module, which is serialized below.
+			for(const std::string& targetCPU : targetCPUs)
+			{
+				auto compileThunk = [&]() {
+					return LLVMJIT::compileModule(irModule,
+												  LLVMJIT::TargetSpec{targetSpec.triple, targetCPU},
+												  compileOptions,
+												  timeReportPointer);
+				};
+				std::vector<U8> objectCode;
+				if(settings.objectCache && inputWASMBytes.size())
+				{
+					objectCode = *settings.objectCache->getCachedObject(
+						inputWASMBytes.data(), inputWASMBytes.size(), compileThunk);
+				}
+				else
+				{
+					objectCode = compileThunk();
+				}
+
+				std::string sectionName = "wavm.precompiled_object";
+				if(targetCPUs.size() > 1) { sectionName += "." + targetCPU; }
+				if(inputWASMBytes.size())
+				{ WASM::appendCustomSection(inputWASMBytes, sectionName, objectCode); }
+				else
+				{
+					irModule.customSections.push_back(
+						CustomSection{OrderedSectionID::moduleBeginning,
+									  std::move(sectionName),
+									  std::move(objectCode)});
+				}
+			}
+
+			if(settings.timePasses)
+			{
+				logCompileTimeReport(inputFilename,
+									 irModule,
+									 loadNanoseconds,
+									 timeReport,
+									 settings.numSlowestFunctions);
+			}
+
+			if(inputWASMBytes.size())
+			{ return saveFile(outputFilename, inputWASMBytes.data(), inputWASMBytes.size()); }
+
+			// Serialize the WASM module, writing it to the output file as it is serialized.
+			return saveBinaryModuleToFile(outputFilename, irModule);
+		}
+		case OutputFormat::object: {
+			// Compile the module to a single object, since a bundle of partitioned objects isn't a
+			// valid native object file.
+			compileOptions.numPartitions = 1;
+			compileOptions.maxPartitionCodeBytes = 0;
+			std::vector<U8> objectCode
+				= LLVMJIT::compileModule(irModule, targetSpec, compileOptions, timeReportPointer);
+			if(settings.timePasses)
+			{
+				logCompileTimeReport(inputFilename,
+									 irModule,
+									 loadNanoseconds,
+									 timeReport,
+									 settings.numSlowestFunctions);
+			}
+
+			// Write the object code to the output file.
+			return saveFile(outputFilename, objectCode.data(), objectCode.size());
+		}
+		case OutputFormat::assembly: {
+			// Compile the module to object code.
+			std::vector<U8> objectCode
+				= LLVMJIT::compileModule(irModule, targetSpec, compileOptions, timeReportPointer);
+			if(settings.timePasses)
+			{
+				logCompileTimeReport(inputFilename,
+									 irModule,
+									 loadNanoseconds,
+									 timeReport,
+									 settings.numSlowestFunctions);
+			}
+
+			// Disassemble the object code.
+			std::string disassembly = LLVMJIT::disassembleObject(targetSpec, objectCode);
+
+			// Write the disassembly to the output file.
+			return saveFile(outputFilename, disassembly.data(), disassembly.size());
+		}
+		case OutputFormat::optimizedLLVMIR:
+		case OutputFormat::unoptimizedLLVMIR: {
+			// Compile the module to LLVM IR.
+			std::string llvmIR = LLVMJIT::emitLLVMIR(irModule,
+													 targetSpec,
+													 outputFormat == OutputFormat::optimizedLLVMIR,
+													 compileOptions);
+
+			// Write the LLVM IR to the output file.
+			return saveFile(outputFilename, llvmIR.data(), llvmIR.size());
+		}
+
+		case OutputFormat::unspecified:
+		default: WAVM_UNREACHABLE();
+		};
+	}
+	catch(const IR::ValidationException& exception)
+	{
+		Log::printf(Log::error,
+					"Error validating WebAssembly module %s: %s\n",
+					inputFilename,
+					exception.message.c_str());
+		return false;
+	}
+}
+
+// A module listed in a --batch manifest, and the result of compiling it.
+struct BatchModule
+{
+	std::string inputFilename;
+	std::string outputFilename;
+
+	bool succeeded = false;
+	U64 nanoseconds = 0;
+	Uptr peakProcessMemoryBytes = 0;
+};
+
+// Reads a --batch manifest: each line that isn't empty or a # comment is an input file and an
+// output file, separated by whitespace. The input file may contain spaces, but the output file
+// may not.
+static bool loadBatchManifest(const char* manifestPath, std::vector<BatchModule>& outModules)
+{
+	std::vector<U8> manifestBytes;
+	if(!loadFile(manifestPath, manifestBytes)) { return false; }
+
+	const std::string manifest(manifestBytes.begin(), manifestBytes.end());
+	Uptr lineStart = 0;
+	Uptr lineNumber = 0;
+	while(lineStart < manifest.size())
+	{
+		Uptr lineEnd = manifest.find('\n', lineStart);
+		if(lineEnd == std::string::npos) { lineEnd = manifest.size(); }
+		std::string line = manifest.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		++lineNumber;
+
+		while(line.size() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+		{ line.pop_back(); }
+		if(!line.size() || line[0] == '#') { continue; }
+
+		BatchModule module;
+		const Uptr lastSpace = line.find_last_of(" \t");
+		if(lastSpace != std::string::npos)
+		{
+			module.outputFilename = line.substr(lastSpace + 1);
+			line.resize(lastSpace);
+			while(line.size() && (line.back() == ' ' || line.back() == '\t')) { line.pop_back(); }
+			module.inputFilename = std::move(line);
+		}
+		if(!module.inputFilename.size())
+		{
+			Log::printf(Log::error,
+						"%s:%" WAVM_PRIuPTR ": expected an input file and an output file.\n",
+						manifestPath,
+						lineNumber);
+			return false;
+		}
+		outModules.push_back(std::move(module));
+	}
+
+	return true;
+}
+
+struct BatchState
+{
+	const CompileSettings& settings;
+	std::vector<BatchModule>& modules;
+	std::atomic<Uptr> nextModuleIndex{0};
+
+	BatchState(const CompileSettings& inSettings, std::vector<BatchModule>& inModules)
+	: settings(inSettings), modules(inModules)
+	{
+	}
+};
+
+// Compiles a batch module to a temporary file next to its output file, and then renames it to the
+// output file, so a partially written output file is never left behind.
+static bool compileBatchModule(const CompileSettings& settings, const BatchModule& module)
+{
+	const std::string tempFilename = module.outputFilename + ".tmp";
+	if(!compileModuleFile(settings, module.inputFilename.c_str(), tempFilename.c_str()))
+	{
+		Platform::getHostFS().unlinkFile(tempFilename);
+		return false;
+	}
+
+	const VFS::Result result = Platform::getHostFS().renameFile(tempFilename, module.outputFilename);
+	if(result != VFS::Result::success)
+	{
+		Log::printf(Log::error,
+					"Error renaming '%s' to '%s': %s\n",
+					tempFilename.c_str(),
+					module.outputFilename.c_str(),
+					VFS::describeResult(result));
+		Platform::getHostFS().unlinkFile(tempFilename);
+		return false;
+	}
+	return true;
+}
+
+static I64 batchThreadMain(void* stateVoid)
+{
+	BatchState* state = (BatchState*)stateVoid;
+	while(true)
+	{
+		const Uptr moduleIndex = state->nextModuleIndex.fetch_add(1, std::memory_order_relaxed);
+		if(moduleIndex >= state->modules.size()) { break; }
+
+		BatchModule& module = state->modules[moduleIndex];
+		Timing::Timer timer;
+		module.succeeded = compileBatchModule(state->settings, module);
+		module.nanoseconds = U64(timer.getNanoseconds());
+		module.peakProcessMemoryBytes = Platform::getPeakMemoryUsageBytes();
+	}
+	return 0;
+}
+
+// Logs the result of compiling each batch module as JSON.
+static void logBatchReport(const std::vector<BatchModule>& modules, U64 nanoseconds)
+{
+	char buffer[256];
+	Uptr numFailed = 0;
+	std::string json = "{\n  \"modules\": [";
+	for(Uptr moduleIndex = 0; moduleIndex < modules.size(); ++moduleIndex)
+	{
+		const BatchModule& module = modules[moduleIndex];
+		if(!module.succeeded) { ++numFailed; }
+
+		json += moduleIndex ? ",\n    {\"input\": " : "\n    {\"input\": ";
+		appendJSONString(json, module.inputFilename);
+		json += ", \"output\": ";
+		appendJSONString(json, module.outputFilename);
+		snprintf(buffer,
+				 sizeof(buffer),
+				 ", \"succeeded\": %s, \"nanoseconds\": %" PRIu64
+				 ", \"peakProcessMemoryBytes\": %" WAVM_PRIuPTR "}",
+				 module.succeeded ? "true" : "false",
+				 module.nanoseconds,
+				 module.peakProcessMemoryBytes);
+		json += buffer;
+	}
+	snprintf(buffer,
+			 sizeof(buffer),
+			 "\n  ],\n  \"numFailed\": %" WAVM_PRIuPTR ",\n  \"nanoseconds\": %" PRIu64 "\n}\n",
+			 numFailed,
+			 nanoseconds);
+	json += buffer;
+
+	Log::printf(Log::output, "%s", json.c_str());
+}
+
+// Compiles the modules listed in a manifest on a pool of threads. Each thread keeps the LLVM
+// target machines it creates, so they are shared by all the modules it compiles.
+static int compileBatch(CompileSettings& settings,
+						const char* manifestPath,
+						Uptr numThreads,
+						bool isHostTarget)
+{
+	std::vector<BatchModule> modules;
+	if(!loadBatchManifest(manifestPath, modules)) { return EXIT_FAILURE; }
+
+	// The modules are compiled in parallel, so compile each one on the thread that picked it,
+	// unless a number of partitions was requested.
+	if(!settings.compileOptions.numPartitions) { settings.compileOptions.numPartitions = 1; }
+
+	// The object cache identifies object code by the compile options, but not the target, so it's
+	// only used for the host target.
+	if(settings.outputFormat == OutputFormat::precompiledModule && settings.targetCPUs.size() == 1
+	   && isHostTarget)
+	{
+		if(!openObjectCache(settings.compileOptions, settings.objectCache)) { return EXIT_FAILURE; }
+	}
+
+	Timing::Timer timer;
+	BatchState state(settings, modules);
+	std::vector<Platform::Thread*> threads;
+	numThreads = std::max(Uptr(1), std::min(numThreads, modules.size()));
+	for(Uptr threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+	{ threads.push_back(Platform::createThread(8 * 1024 * 1024, batchThreadMain, &state)); }
+	for(Platform::Thread* thread : threads) { Platform::joinThread(thread); }
+
+	logBatchReport(modules, U64(timer.getNanoseconds()));
+
+	for(const BatchModule& module : modules)
+	{
+		if(!module.succeeded) { return EXIT_FAILURE; }
+	}
+	return EXIT_SUCCESS;
+}
+
 int execCompileCommand(int argc, char** argv)
 {
 	const char* inputFilename = nullptr;
 	const char* outputFilename = nullptr;
+	const char* batchManifestPath = nullptr;
+	Uptr numBatchThreads = Platform::getNumberOfHardwareThreads();
 	bool useHostTargetSpec = true;
-	LLVMJIT::TargetSpec targetSpec;
-	IR::FeatureSpec featureSpec;
-	OutputFormat outputFormat = OutputFormat::unspecified;
+	CompileSettings settings;
+	LLVMJIT::TargetSpec& targetSpec = settings.targetSpec;
+	std::vector<std::string>& targetCPUs = settings.targetCPUs;
+	IR::FeatureSpec& featureSpec = settings.featureSpec;
+	OutputFormat& outputFormat = settings.outputFormat;
+	LLVMJIT::CompileOptions& compileOptions = settings.compileOptions;
+	bool& timePasses = settings.timePasses;
+	Uptr& numSlowestFunctions = settings.numSlowestFunctions;
 	for(int argIndex = 0; argIndex < argc; ++argIndex)
 	{
 		if(!strcmp(argv[argIndex], "--target-triple"))
@@ -135,7 +738,16 @@ int execCompileCommand(int argc, char** argv)
 				return EXIT_FAILURE;
 			}
 			++argIndex;
-			targetSpec.cpu = argv[argIndex];
+			std::string targetCPUList = argv[argIndex];
+			Uptr cpuBegin = 0;
+			while(true)
+			{
+				const Uptr cpuEnd = targetCPUList.find(',', cpuBegin);
+				targetCPUs.push_back(targetCPUList.substr(
+					cpuBegin, cpuEnd == std::string::npos ? std::string::npos : cpuEnd - cpuBegin));
+				if(cpuEnd == std::string::npos) { break; }
+				cpuBegin = cpuEnd + 1;
+			};
 			useHostTargetSpec = false;
 		}
 		else if(!strcmp(argv[argIndex], "--enable"))
@@ -191,6 +803,92 @@ int execCompileCommand(int argc, char** argv)
 				return EXIT_FAILURE;
 			}
 		}
+		else if(!strcmp(argv[argIndex], "-O0") || !strcmp(argv[argIndex], "-O1")
+				|| !strcmp(argv[argIndex], "-O2") || !strcmp(argv[argIndex], "-O3"))
+		{
+			compileOptions.optimizationLevel = Uptr(argv[argIndex][2] - '0');
+		}
+		else if(stringStartsWith(argv[argIndex], "--debug-info="))
+		{
+			if(!parseDebugInfoLevel(argv[argIndex] + strlen("--debug-info="), compileOptions))
+			{ return EXIT_FAILURE; }
+		}
+		else if(stringStartsWith(argv[argIndex], "--compile-partitions="))
+		{
+			const char* numPartitionsString = argv[argIndex] + strlen("--compile-partitions=");
+			const int numPartitions = atoi(numPartitionsString);
+			if(numPartitions <= 0)
+			{
+				Log::printf(Log::error,
+							"Invalid number of compile partitions '%s'.\n",
+							numPartitionsString);
+				return EXIT_FAILURE;
+			}
+			compileOptions.numPartitions = Uptr(numPartitions);
+		}
+		else if(stringStartsWith(argv[argIndex], "--profile-in="))
+		{
+			if(!loadProfile(argv[argIndex] + strlen("--profile-in="), compileOptions.profile))
+			{ return EXIT_FAILURE; }
+		}
+		else if(!strcmp(argv[argIndex], "--eliminate-dead-functions"))
+		{
+			compileOptions.eliminateDeadFunctions = true;
+		}
+		else if(!strcmp(argv[argIndex], "--relaxed-nan"))
+		{
+			compileOptions.relaxedNaN = true;
+		}
+		else if(!strcmp(argv[argIndex], "--cache-stack-pointer"))
+		{
+			compileOptions.cacheStackPointer = true;
+		}
+		else if(!strcmp(argv[argIndex], "--share-trap-blocks"))
+		{
+			compileOptions.shareTrapBlocks = true;
+		}
+		else if(!strcmp(argv[argIndex], "--validate-while-compiling"))
+		{
+			compileOptions.validateFunctionBodies = true;
+		}
+		else if(!strcmp(argv[argIndex], "--time-passes"))
+		{
+			timePasses = true;
+		}
+		else if(stringStartsWith(argv[argIndex], "--time-passes-functions="))
+		{
+			const char* numFunctionsString = argv[argIndex] + strlen("--time-passes-functions=");
+			const int numFunctions = atoi(numFunctionsString);
+			if(numFunctions < 0 || (numFunctions == 0 && strcmp(numFunctionsString, "0")))
+			{
+				Log::printf(
+					Log::error, "Invalid number of functions '%s'.\n", numFunctionsString);
+				return EXIT_FAILURE;
+			}
+			numSlowestFunctions = Uptr(numFunctions);
+		}
+		else if(!strcmp(argv[argIndex], "--batch"))
+		{
+			if(argIndex + 1 == argc)
+			{
+				Log::printf(Log::error, "Expected manifest file following '--batch'.\n");
+				return EXIT_FAILURE;
+			}
+			++argIndex;
+			batchManifestPath = argv[argIndex];
+		}
+		else if(stringStartsWith(argv[argIndex], "--batch-threads="))
+		{
+			const char* numThreadsString = argv[argIndex] + strlen("--batch-threads=");
+			const int numThreads = atoi(numThreadsString);
+			if(numThreads <= 0)
+			{
+				Log::printf(
+					Log::error, "Invalid number of batch threads '%s'.\n", numThreadsString);
+				return EXIT_FAILURE;
+			}
+			numBatchThreads = Uptr(numThreads);
+		}
 		else if(!inputFilename)
 		{
 			inputFilename = argv[argIndex];
@@ -207,109 +905,40 @@ int execCompileCommand(int argc, char** argv)
 		}
 	}
 
-	if(!inputFilename || !outputFilename)
+	if(batchManifestPath ? inputFilename != nullptr : !inputFilename || !outputFilename)
 	{
 		showCompileHelp(Log::error);
 		return EXIT_FAILURE;
 	}
 
 	if(useHostTargetSpec) { targetSpec = LLVMJIT::getHostTargetSpec(); }
+	if(!targetCPUs.size()) { targetCPUs.push_back(targetSpec.cpu); }
+	targetSpec.cpu = targetCPUs[0];
 
-	// Validate the target.
-	switch(LLVMJIT::validateTarget(targetSpec, featureSpec))
+	// Validate the targets.
+	for(const std::string& targetCPU : targetCPUs)
 	{
-	case LLVMJIT::TargetValidationResult::valid: break;
-
-	case LLVMJIT::TargetValidationResult::invalidTargetSpec:
-		Log::printf(Log::error,
-					"Target triple (%s) or CPU (%s) is invalid.\n",
-					targetSpec.triple.c_str(),
-					targetSpec.cpu.c_str());
-		return EXIT_FAILURE;
-	case LLVMJIT::TargetValidationResult::unsupportedArchitecture:
-		Log::printf(Log::error, "WAVM doesn't support the target architecture.\n");
-		return EXIT_FAILURE;
-	case LLVMJIT::TargetValidationResult::x86CPUDoesNotSupportSSE41:
-		Log::printf(Log::error,
-					"Target X86 CPU (%s) does not support SSE 4.1, which"
-					" WAVM requires for WebAssembly SIMD code.\n",
-					targetSpec.cpu.c_str());
-		return EXIT_FAILURE;
-	case LLVMJIT::TargetValidationResult::wavmDoesNotSupportSIMDOnArch:
-		Log::printf(Log::error, "WAVM does not support SIMD on the target CPU architecture.\n");
-		return EXIT_FAILURE;
-	case LLVMJIT::TargetValidationResult::memory64Requires64bitTarget:
-		Log::printf(Log::error,
-					"Target CPU (%s) does not support 64-bit memories.\n",
-					targetSpec.cpu.c_str());
-		return EXIT_FAILURE;
-	case LLVMJIT::TargetValidationResult::table64Requires64bitTarget:
-		Log::printf(Log::error,
-					"Target CPU (%s) does not support 64-bit tables.\n",
-					targetSpec.cpu.c_str());
-		return EXIT_FAILURE;
-
-	default: WAVM_UNREACHABLE();
-	};
+		if(!validateTargetSpec(LLVMJIT::TargetSpec{targetSpec.triple, targetCPU}, featureSpec))
+		{ return EXIT_FAILURE; }
+	}
 
 	if(outputFormat == OutputFormat::unspecified)
 	{ outputFormat = OutputFormat::precompiledModule; }
-
-	// Load the module IR.
-	IR::Module irModule(featureSpec);
-	if(!loadTextOrBinaryModule(inputFilename, irModule)) { return EXIT_FAILURE; }
-
-	switch(outputFormat)
+	if(targetCPUs.size() > 1 && outputFormat != OutputFormat::precompiledModule)
 	{
-	case OutputFormat::precompiledModule: {
-		// Compile the module to object code.
-		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
-
-		// Extract the compiled object code and add it to the IR module as a user section.
-		irModule.customSections.push_back(CustomSection{
-			OrderedSectionID::moduleBeginning, "wavm.precompiled_object", std::move(objectCode)});
-
-		// Serialize the WASM module.
-		Timing::Timer saveTimer;
-		std::vector<U8> wasmBytes = WASM::saveBinaryModule(irModule);
-
-		Timing::logRatePerSecond(
-			"Serialized WASM", saveTimer, wasmBytes.size() / 1024.0 / 1024.0, "MiB");
-
-		// Write the serialized data to the output file.
-		return saveFile(outputFilename, wasmBytes.data(), wasmBytes.size()) ? EXIT_SUCCESS
-																			: EXIT_FAILURE;
+		Log::printf(Log::error, "Only the precompiled-wasm format supports multiple target CPUs.\n");
+		return EXIT_FAILURE;
 	}
-	case OutputFormat::object: {
-		// Compile the module to object code.
-		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
-
-		// Write the object code to the output file.
-		return saveFile(outputFilename, objectCode.data(), objectCode.size()) ? EXIT_SUCCESS
-																			  : EXIT_FAILURE;
+	if(timePasses
+	   && (outputFormat == OutputFormat::unoptimizedLLVMIR
+		   || outputFormat == OutputFormat::optimizedLLVMIR))
+	{
+		Log::printf(Log::error, "'--time-passes' requires an object code output format.\n");
+		return EXIT_FAILURE;
 	}
-	case OutputFormat::assembly: {
-		// Compile the module to object code.
-		std::vector<U8> objectCode = LLVMJIT::compileModule(irModule, targetSpec);
-
-		// Disassemble the object code.
-		std::string disassembly = LLVMJIT::disassembleObject(targetSpec, objectCode);
 
-		// Write the disassembly to the output file.
-		return saveFile(outputFilename, disassembly.data(), disassembly.size()) ? EXIT_SUCCESS
-																				: EXIT_FAILURE;
-	}
-	case OutputFormat::optimizedLLVMIR:
-	case OutputFormat::unoptimizedLLVMIR: {
-		// Compile the module to LLVM IR.
-		std::string llvmIR = LLVMJIT::emitLLVMIR(
-			irModule, targetSpec, outputFormat == OutputFormat::optimizedLLVMIR);
-
-		// Write the LLVM IR to the output file.
-		return saveFile(outputFilename, llvmIR.data(), llvmIR.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
-	}
+	if(batchManifestPath)
+	{ return compileBatch(settings, batchManifestPath, numBatchThreads, useHostTargetSpec); }
 
-	case OutputFormat::unspecified:
-	default: WAVM_UNREACHABLE();
-	};
+	return compileModuleFile(settings, inputFilename, outputFilename) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
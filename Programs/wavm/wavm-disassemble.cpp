@@ -6,6 +6,9 @@
 #include "WAVM/Inline/CLI.h"
 #include "WAVM/Inline/Timing.h"
 #include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/File.h"
+#include "WAVM/Platform/Thread.h"
+#include "WAVM/VFS/VFS.h"
 #include "WAVM/WASM/WASM.h"
 #include "WAVM/WASTPrint/WASTPrint.h"
 #include "wavm.h"
@@ -95,17 +98,55 @@ int execDisassembleCommand(int argc, char** argv)
 	IR::Module module(featureSpec);
 	if(!loadBinaryModuleFromFile(inputFilename, module)) { return EXIT_FAILURE; }
 
-	// Print the module to WAST.
+	// Open the output file.
+	VFS::VFD* outputVFD = nullptr;
+	VFS::Result result = VFS::Result::success;
+	if(outputFilename)
+	{
+		result = Platform::getHostFS().open(outputFilename,
+											VFS::FileAccessMode::writeOnly,
+											VFS::FileCreateMode::createAlways,
+											outputVFD);
+		if(result != VFS::Result::success)
+		{
+			Log::printf(Log::error,
+						"Error saving '%s': %s\n",
+						outputFilename,
+						VFS::describeResult(result));
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Print the module to WAST, writing the text to the output as it is printed, and printing the
+	// function bodies in parallel.
 	Timing::Timer printTimer;
-	const std::string wastString = WAST::print(module);
+	Uptr numPrintedChars = 0;
+	WAST::print(
+		module,
+		[&](const char* chars, Uptr numChars) {
+			numPrintedChars += numChars;
+			if(!outputVFD) { Log::printf(Log::output, "%.*s", int(numChars), chars); }
+			else if(result == VFS::Result::success)
+			{
+				result = outputVFD->write(chars, numChars);
+			}
+		},
+		Platform::getNumberOfHardwareThreads());
 	Timing::logRatePerSecond(
-		"Printed WAST", printTimer, F64(wastString.size()) / 1024.0 / 1024.0, "MiB");
+		"Printed WAST", printTimer, F64(numPrintedChars) / 1024.0 / 1024.0, "MiB");
 
-	if(!outputFilename) { Log::printf(Log::output, "%s", wastString.c_str()); }
-	else
+	if(outputVFD)
 	{
-		// Write the serialized data to the output file.
-		if(!saveFile(outputFilename, wastString.data(), wastString.size())) { return EXIT_FAILURE; }
+		const VFS::Result closeResult = outputVFD->close();
+		if(result == VFS::Result::success) { result = closeResult; }
+		if(result != VFS::Result::success)
+		{
+			Log::printf(Log::error,
+						"Error saving '%s': %s\n",
+						outputFilename,
+						VFS::describeResult(result));
+			return EXIT_FAILURE;
+		}
 	}
 
 	return EXIT_SUCCESS;
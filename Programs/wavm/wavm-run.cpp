@@ -1,6 +1,7 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -23,10 +24,17 @@
 #include "WAVM/LLVMJIT/LLVMJIT.h"
 #include "WAVM/Logging/Logging.h"
 #include "WAVM/ObjectCache/ObjectCache.h"
+#include "WAVM/Platform/Diagnostics.h"
 #include "WAVM/Platform/File.h"
+#include "WAVM/Platform/ForkServer.h"
 #include "WAVM/Platform/Memory.h"
+#include "WAVM/Platform/Thread.h"
 #include "WAVM/Runtime/Linker.h"
 #include "WAVM/Runtime/Runtime.h"
+#include "WAVM/VFS/BufferedVFD.h"
+#include "WAVM/VFS/BundleFS.h"
+#include "WAVM/VFS/MemoryFS.h"
+#include "WAVM/VFS/MountFS.h"
 #include "WAVM/VFS/SandboxFS.h"
 #include "WAVM/WASI/WASI.h"
 #include "WAVM/WASM/WASM.h"
@@ -68,6 +76,89 @@ private:
 	GCPointer<Compartment> compartment;
 };
 
+bool openObjectCache(const LLVMJIT::CompileOptions& compileOptions,
+					 std::shared_ptr<Runtime::ObjectCacheInterface>& outObjectCache)
+{
+	const char* objectCachePath
+		= WAVM_SCOPED_DISABLE_SECURE_CRT_WARNINGS(getenv("WAVM_OBJECT_CACHE_DIR"));
+	if(!objectCachePath || !*objectCachePath) { return true; }
+
+	Uptr maxBytes = 1024 * 1024 * 1024;
+
+	const char* maxMegabytesEnv
+		= WAVM_SCOPED_DISABLE_SECURE_CRT_WARNINGS(getenv("WAVM_OBJECT_CACHE_MAX_MB"));
+	if(maxMegabytesEnv && *maxMegabytesEnv)
+	{
+		int maxMegabytes = atoi(maxMegabytesEnv);
+		if(maxMegabytes <= 0)
+		{
+			Log::printf(Log::error,
+						"Invalid object cache size \"%s\". Expected an integer greater than 1.",
+						maxMegabytesEnv);
+			return false;
+		}
+		maxBytes = Uptr(maxMegabytes) * 1000000;
+	}
+
+	// Calculate a "code key" that identifies the code involved in compiling WebAssembly to object
+	// code in the cache. If recompiling the module would produce different object code, the code
+	// key should be different, and if recompiling the module would produce the same object code,
+	// the code key should be the same.
+	LLVMJIT::Version llvmjitVersion = LLVMJIT::getVersion();
+	U64 codeKey = 0;
+	codeKey = Hash<U64>()(llvmjitVersion.llvmMajor, codeKey);
+	codeKey = Hash<U64>()(llvmjitVersion.llvmMinor, codeKey);
+	codeKey = Hash<U64>()(llvmjitVersion.llvmPatch, codeKey);
+	codeKey = Hash<U64>()(llvmjitVersion.llvmjitVersion, codeKey);
+	codeKey = Hash<U64>()(WAVM_VERSION_MAJOR, codeKey);
+	codeKey = Hash<U64>()(WAVM_VERSION_MINOR, codeKey);
+	codeKey = Hash<U64>()(WAVM_VERSION_PATCH, codeKey);
+	codeKey = Hash<U64>()(compileOptions.optimizationLevel, codeKey);
+	codeKey = Hash<U64>()(compileOptions.inlineThreshold, codeKey);
+	codeKey = Hash<U64>()(compileOptions.instrumentProfile, codeKey);
+	codeKey = Hash<U64>()(compileOptions.countFunctionCalls, codeKey);
+	codeKey = Hash<U64>()(compileOptions.measureFunctionCycles, codeKey);
+	codeKey = Hash<U64>()(U64(compileOptions.debugInfoLevel), codeKey);
+	codeKey = Hash<U64>()(compileOptions.eliminateDeadFunctions, codeKey);
+	codeKey = Hash<U64>()(compileOptions.relaxedNaN, codeKey);
+	codeKey = Hash<U64>()(compileOptions.cacheStackPointer, codeKey);
+	codeKey = Hash<U64>()(compileOptions.shareTrapBlocks, codeKey);
+	if(compileOptions.profile)
+	{
+		codeKey
+			= Hash<std::vector<U8>>()(LLVMJIT::serializeProfile(*compileOptions.profile), codeKey);
+	}
+
+	// Initialize the object cache.
+	ObjectCache::OpenResult openResult
+		= ObjectCache::open(objectCachePath, maxBytes, codeKey, outObjectCache);
+	switch(openResult)
+	{
+	case ObjectCache::OpenResult::doesNotExist:
+		Log::printf(Log::error, "Object cache directory \"%s\" does not exist.\n", objectCachePath);
+		return false;
+	case ObjectCache::OpenResult::notDirectory:
+		Log::printf(Log::error,
+					"Object cache path \"%s\" does not refer to a directory.\n",
+					objectCachePath);
+		return false;
+	case ObjectCache::OpenResult::notAccessible:
+		Log::printf(Log::error, "Object cache path \"%s\" is not accessible.\n", objectCachePath);
+		return false;
+	case ObjectCache::OpenResult::invalidDatabase:
+		Log::printf(Log::error, "Object cache database in \"%s\" is not valid.\n", objectCachePath);
+		return false;
+	case ObjectCache::OpenResult::tooManyReaders:
+		Log::printf(Log::error,
+					"Object cache database in \"%s\" has too many concurrent readers.\n",
+					objectCachePath);
+		return false;
+
+	case ObjectCache::OpenResult::success: return true;
+	default: WAVM_UNREACHABLE();
+	};
+}
+
 static bool loadTextOrBinaryModule(const char* filename,
 								   std::vector<U8>&& fileBytes,
 								   const IR::FeatureSpec& featureSpec,
@@ -112,42 +203,95 @@ static bool loadTextOrBinaryModule(const char* filename,
 	}
 }
 
-static bool loadPrecompiledModule(std::vector<U8>&& fileBytes,
+static bool loadPrecompiledModule(const char* filename,
 								  const IR::FeatureSpec& featureSpec,
 								  ModuleRef& outModule)
 {
-	IR::Module irModule(featureSpec);
+	// Map the file instead of reading it, so its pages are shared through the page cache with
+	// other processes that load it, and only the parts of it that are used are read.
+	Platform::MappedFile mappedFile;
+	const VFS::Result mapResult = Platform::mapFile(filename, mappedFile);
+	if(mapResult != VFS::Result::success)
+	{
+		Log::printf(
+			Log::error, "Error loading '%s': %s\n", filename, VFS::describeResult(mapResult));
+		return false;
+	}
+	std::shared_ptr<const void> mappedFileOwner(
+		mappedFile.bytes, [mappedFile](const void*) { Platform::unmapFile(mappedFile); });
 
-	// Deserialize the module IR from the binary format.
+	// Deserialize the module IR from the binary format. The module's data segments reference the
+	// mapped file instead of copying it.
+	IR::Module irModule(featureSpec);
 	WASM::LoadError loadError;
-	if(!WASM::loadBinaryModule(fileBytes.data(), fileBytes.size(), irModule, &loadError))
+	if(!WASM::loadBinaryModule(
+		   mappedFile.bytes, mappedFile.numBytes, mappedFileOwner, irModule, &loadError))
 	{
 		Log::printf(
 			Log::error, "Error loading WebAssembly binary file: %s\n", loadError.message.c_str());
 		return false;
 	}
 
-	// Check for a precompiled object section.
-	const CustomSection* precompiledObjectSection = nullptr;
-	for(const CustomSection& customSection : irModule.customSections)
+	// Find the precompiled object sections: either a single wavm.precompiled_object section, or a
+	// wavm.precompiled_object.<cpu> section for each CPU the module was compiled for.
+	static constexpr const char* precompiledObjectSectionName = "wavm.precompiled_object";
+	const std::string precompiledObjectSectionPrefix
+		= std::string(precompiledObjectSectionName) + '.';
+	std::vector<Uptr> precompiledObjectSectionIndices;
+	std::vector<LLVMJIT::TargetObjectCode> targetObjectCodes;
+	for(Uptr sectionIndex = 0; sectionIndex < irModule.customSections.size(); ++sectionIndex)
 	{
-		if(customSection.name == "wavm.precompiled_object")
+		const CustomSection& customSection = irModule.customSections[sectionIndex];
+		if(customSection.name == precompiledObjectSectionName
+		   || !customSection.name.compare(
+			   0, precompiledObjectSectionPrefix.size(), precompiledObjectSectionPrefix))
 		{
-			precompiledObjectSection = &customSection;
-			break;
+			precompiledObjectSectionIndices.push_back(sectionIndex);
+			targetObjectCodes.push_back(
+				{customSection.name == precompiledObjectSectionName
+					 ? LLVMJIT::getHostTargetSpec().cpu
+					 : customSection.name.substr(precompiledObjectSectionPrefix.size()),
+				 customSection.data.data(),
+				 customSection.data.size()});
 		}
 	}
-	if(!precompiledObjectSection)
+	if(!precompiledObjectSectionIndices.size())
 	{
 		Log::printf(Log::error, "Input file did not contain 'wavm.precompiled_object' section.\n");
 		return false;
 	}
-	else
+
+	// If there is object code for several CPUs, choose the object code for the CPU with the most
+	// features the host supports. A single wavm.precompiled_object section is used regardless of
+	// the CPU it was compiled for.
+	Uptr objectCodeIndex = 0;
+	if(targetObjectCodes.size() > 1)
 	{
-		// Load the IR + precompiled object code as a runtime module.
-		outModule = Runtime::loadPrecompiledModule(irModule, precompiledObjectSection->data);
-		return true;
+		objectCodeIndex = LLVMJIT::findBestHostObjectCode(targetObjectCodes);
+		if(objectCodeIndex == UINTPTR_MAX)
+		{
+			Log::printf(Log::error,
+						"None of the precompiled object sections can run on the host CPU (%s).\n",
+						LLVMJIT::getHostTargetSpec().cpu.c_str());
+			return false;
+		}
+		Log::printf(Log::debug,
+					"Using object code precompiled for %s.\n",
+					targetObjectCodes[objectCodeIndex].cpu.c_str());
 	}
+
+	// Move the chosen object code out of the IR, and remove all the precompiled object sections.
+	// Then load the IR + precompiled object code as a runtime module without copying either of
+	// them.
+	std::vector<U8> objectCode
+		= std::move(irModule.customSections[precompiledObjectSectionIndices[objectCodeIndex]].data);
+	for(Uptr index = precompiledObjectSectionIndices.size(); index > 0; --index)
+	{
+		irModule.customSections.erase(irModule.customSections.begin()
+									  + precompiledObjectSectionIndices[index - 1]);
+	};
+	outModule = Runtime::loadPrecompiledModule(std::move(irModule), std::move(objectCode));
+	return true;
 }
 
 static void reportLinkErrors(const LinkResult& linkResult)
@@ -181,15 +325,107 @@ void showRunHelp(Log::Category outputCategory)
 				"  --function=<name>     Specify function name to run in module (default:main)\n"
 				"  --precompiled         Use precompiled object code in program file\n"
 				"  --nocache             Don't use the WAVM object cache\n"
+				"  --cache-partitions    Also cache the object code of each partition of the\n"
+				"                        module's functions, so a module that only changed in\n"
+				"                        a few functions only recompiles the partitions that\n"
+				"                        contain them\n"
+				"  -O0, -O1, -O2, -O3    Set the optimization level (default: -O1)\n"
+				"  --tier=<tier>         Execute the module with the given tier (default:\n"
+				"                        optimized):\n"
+				"                          interp     Interpret the module's code instead of\n"
+				"                                     compiling it, if it only uses interpreted\n"
+				"                                     features\n"
+				"                          baseline   Compile quickly with minimal optimization\n"
+				"                          optimized  Compile with full optimization\n"
+				"  --tier-up             With --tier=interp or --tier=baseline, recompile each\n"
+				"                        function with full optimization in the background once\n"
+				"                        it has been called 1000 times\n"
+				"  --compile-partitions=<n>\n"
+				"                        Compile the module in <n> partitions on parallel\n"
+				"                        threads (default: chosen from the module size)\n"
+				"  --compile-processes=<n>\n"
+				"                        Compile modules in <n> helper processes, so compiling\n"
+				"                        doesn't grow this process's memory usage\n"
+				"  --profile-out=<file>  Count how often each function and branch executes, and\n"
+				"                        write the counts to <file> when the program exits\n"
+				"  --function-stats      Count the calls to each function and the cycles spent in\n"
+				"                        them, and print the functions with the most cycles\n"
+				"                        when the program exits\n"
+				"  --profile=<file>      Sample the running code, and write the time spent in each\n"
+				"                        function and operator to <file> in the folded stack\n"
+				"                        format used by flame graph tools\n"
+				"  --profile-frequency=<n>\n"
+				"                        Take <n> samples per second for --profile (default:\n"
+				"                        1000)\n"
+				"  --profile-in=<file>   Optimize the module for the execution counts in a\n"
+				"                        profile written by --profile-out\n"
+				"  --snapshot-out=<file> After running the module's start function and the\n"
+				"                        function given by --function, write a module that\n"
+				"                        starts in the resulting state to <file>\n"
+				"  --debug-info=<level>  Emit none, line-tables, or full debug info. Traps are\n"
+				"                        only mapped back to WebAssembly instructions with\n"
+				"                        line-tables or full, and none makes compilation\n"
+				"                        faster and uses less memory (default: line-tables)\n"
+				"  --no-source-info      Same as --debug-info=none\n"
+				"  --eliminate-dead-functions\n"
+				"                        Compile functions that can't be called as stubs that\n"
+				"                        trap, which makes compilation faster\n"
+				"  --relaxed-nan         Allow float operators to produce nondeterministic NaNs,\n"
+				"                        so they compile to faster code\n"
+				"  --cache-stack-pointer Keep the module's stack pointer global in a register\n"
+				"                        between calls\n"
+				"  --share-trap-blocks   Share one trap call between a function's trap sites\n"
+				"  --specialize-instances\n"
+				"                        Recompile modules for the values of their immutable\n"
+				"                        global imports and the sizes of their memory imports\n"
+				"  --huge-pages          Back linear memories and JIT code with huge pages when\n"
+				"                        the OS supports it\n"
+				"  --gdb-jit             Register JIT code with GDB, so it can show WebAssembly\n"
+				"                        functions (the default in debug builds)\n"
+				"  --perf-map=<format>   Describe JIT code to the Linux perf profiler in\n"
+				"                        /tmp/perf-<pid>.map (map), or in the jitdump format\n"
+				"                        in /tmp/jit-<pid>.dump (jitdump)\n"
+				"  --atomic-wait-spin=<ns>\n"
+				"                        Spin for up to <ns> nanoseconds checking the value\n"
+				"                        before blocking in memory.atomic.wait (default: 4000)\n"
+				"  --numa-node=<n>       Allocate the module's memories on NUMA node <n>, and run\n"
+				"                        its threads on the node's CPUs\n"
 				"  --enable <feature>    Enable the specified feature. See the list of supported\n"
 				"                        features below.\n"
 				"  --abi=<abi>           Specifies the ABI used by the WASM module. See the list\n"
 				"                        of supported ABIs below. The default is to detect the\n"
 				"                        ABI based on the module imports/exports.\n"
 				"  --mount-root <dir>    Mounts <dir> as the WASI root directory\n"
+				"  --mount-memory <path> Mounts an empty in-memory directory at <path> in the\n"
+				"                        WASI file system, e.g. for scratch files\n"
+				"  --memory-fs-quota=<bytes>\n"
+				"                        Limits the total size of the files in the in-memory\n"
+				"                        directories (default: unlimited)\n"
+				"  --mount-bundle <path> <archive>\n"
+				"                        Mounts the files in the tar <archive> as a read-only\n"
+				"                        directory at <path> in the WASI file system\n"
+				"  --io-uring            Read and write the files in the WASI root directory\n"
+				"                        through io_uring (Linux only)\n"
+				"  --iocp                Read and write the files in the WASI root directory\n"
+				"                        with overlapped I/O (Windows only)\n"
+				"  --socket-fd=<fd>      Passes the inherited host socket <fd> (e.g. from inetd\n"
+				"                        or systemd socket activation) to the WASI process\n"
+				"  --buffered-stdio      Buffers the WASI process's writes to stdout and stderr,\n"
+				"                        and writes them in batches\n"
+				"  --wasi-coarse-clocks  Reads the WASI realtime and monotonic clocks from the\n"
+				"                        host's coarse clocks, which are cheaper to read but\n"
+				"                        have a resolution of a few milliseconds\n"
 				"  --wasi-trace=<level>  Sets the level of WASI tracing:\n"
 				"                        - syscalls\n"
 				"                        - syscalls-with-callstacks\n"
+				"  --serve=<socket>      Load and instantiate the WASI module, then listen on the\n"
+				"                        local socket <socket> for programs to run with\n"
+				"                        --connect, and run each in a forked copy of this\n"
+				"                        process (POSIX only)\n"
+				"  --connect=<socket>    Run the program in the server started by --serve on\n"
+				"                        <socket>, with this process's stdio, and exit with its\n"
+				"                        exit code. The server's options are used instead of\n"
+				"                        this process's\n"
 				"\n"
 				"ABIs:\n"
 				"%s"
@@ -234,10 +470,27 @@ struct State
 	const char* filename = nullptr;
 	const char* functionName = nullptr;
 	const char* rootMountPath = nullptr;
+	std::vector<std::pair<const char*, const char*>> memoryAndBundleMounts;
+	U64 memoryFSQuota = UINT64_MAX;
+	bool useIOURing = false;
+	bool useIOCP = false;
+	bool useCoarseWASIClocks = false;
+	bool useBufferedStdio = false;
+	const char* serveSocketPath = nullptr;
+	const char* connectSocketPath = nullptr;
+	std::vector<I32> socketFDs;
 	std::vector<std::string> runArgs;
 	ABI abi = ABI::detect;
 	bool precompiled = false;
 	bool allowCaching = true;
+	bool cachePartitions = false;
+	LLVMJIT::CompileOptions compileOptions;
+	const char* profileOutFilename = nullptr;
+	const char* sampleProfileFilename = nullptr;
+	U32 sampleProfileFrequency = 1000;
+	const char* snapshotOutFilename = nullptr;
+	U64 atomicWaitSpinNanoseconds = defaultAtomicWaitSpinNanoseconds;
+	Uptr numaNode = UINTPTR_MAX;
 	WASI::SyscallTraceLevel wasiTraceLavel = WASI::SyscallTraceLevel::none;
 
 	// Objects that need to be cleaned up before exiting.
@@ -327,6 +580,192 @@ struct State
 			{
 				allowCaching = false;
 			}
+			else if(!strcmp(*nextArg, "--cache-partitions"))
+			{
+				cachePartitions = true;
+			}
+			else if(!strcmp(*nextArg, "-O0") || !strcmp(*nextArg, "-O1")
+					|| !strcmp(*nextArg, "-O2") || !strcmp(*nextArg, "-O3"))
+			{
+				compileOptions.optimizationLevel = Uptr((*nextArg)[2] - '0');
+			}
+			else if(stringStartsWith(*nextArg, "--tier="))
+			{
+				// Modules that the interpreter can't execute are compiled with the optimized tier.
+				const char* tierString = *nextArg + strlen("--tier=");
+				if(!strcmp(tierString, "interp"))
+				{
+					compileOptions.tier = LLVMJIT::CompileTier::optimized;
+					Runtime::setGlobalInterpretModules(true);
+				}
+				else if(!strcmp(tierString, "baseline"))
+				{
+					compileOptions.tier = LLVMJIT::CompileTier::baseline;
+					Runtime::setGlobalInterpretModules(false);
+				}
+				else if(!strcmp(tierString, "optimized"))
+				{
+					compileOptions.tier = LLVMJIT::CompileTier::optimized;
+					Runtime::setGlobalInterpretModules(false);
+				}
+				else
+				{
+					Log::printf(Log::error,
+								"Invalid tier '%s': expected interp, baseline, or optimized.\n",
+								tierString);
+					return false;
+				}
+			}
+			else if(!strcmp(*nextArg, "--tier-up"))
+			{
+				compileOptions.tierUpCallThreshold = 1000;
+			}
+			else if(stringStartsWith(*nextArg, "--compile-partitions="))
+			{
+				const char* numPartitionsString = *nextArg + strlen("--compile-partitions=");
+				const int numPartitions = atoi(numPartitionsString);
+				if(numPartitions <= 0)
+				{
+					Log::printf(Log::error,
+								"Invalid number of compile partitions '%s'.\n",
+								numPartitionsString);
+					return false;
+				}
+				compileOptions.numPartitions = Uptr(numPartitions);
+			}
+			else if(stringStartsWith(*nextArg, "--compile-processes="))
+			{
+				const char* numProcessesString = *nextArg + strlen("--compile-processes=");
+				const int numProcesses = atoi(numProcessesString);
+				if(numProcesses <= 0)
+				{
+					Log::printf(Log::error,
+								"Invalid number of compile processes '%s'.\n",
+								numProcessesString);
+					return false;
+				}
+				if(!Runtime::startCompileProcesses(Uptr(numProcesses)))
+				{
+					Log::printf(Log::error,
+								"Compile processes aren't supported on this host, so modules "
+								"will be compiled in this process.\n");
+				}
+			}
+			else if(stringStartsWith(*nextArg, "--profile-out="))
+			{
+				profileOutFilename = *nextArg + strlen("--profile-out=");
+				compileOptions.instrumentProfile = true;
+			}
+			else if(!strcmp(*nextArg, "--function-stats"))
+			{
+				compileOptions.countFunctionCalls = true;
+				compileOptions.measureFunctionCycles = true;
+			}
+			else if(stringStartsWith(*nextArg, "--profile="))
+			{
+				sampleProfileFilename = *nextArg + strlen("--profile=");
+			}
+			else if(stringStartsWith(*nextArg, "--profile-frequency="))
+			{
+				const char* frequencyString = *nextArg + strlen("--profile-frequency=");
+				const int frequency = atoi(frequencyString);
+				if(frequency <= 0)
+				{
+					Log::printf(Log::error, "Invalid profile frequency '%s'.\n", frequencyString);
+					return false;
+				}
+				sampleProfileFrequency = U32(frequency);
+			}
+			else if(stringStartsWith(*nextArg, "--profile-in="))
+			{
+				if(!loadProfile(*nextArg + strlen("--profile-in="), compileOptions.profile))
+				{ return false; }
+			}
+			else if(stringStartsWith(*nextArg, "--snapshot-out="))
+			{
+				snapshotOutFilename = *nextArg + strlen("--snapshot-out=");
+			}
+			else if(stringStartsWith(*nextArg, "--debug-info="))
+			{
+				if(!parseDebugInfoLevel(*nextArg + strlen("--debug-info="), compileOptions))
+				{ return false; }
+			}
+			else if(!strcmp(*nextArg, "--no-source-info"))
+			{
+				compileOptions.debugInfoLevel = LLVMJIT::DebugInfoLevel::none;
+			}
+			else if(!strcmp(*nextArg, "--eliminate-dead-functions"))
+			{
+				compileOptions.eliminateDeadFunctions = true;
+			}
+			else if(!strcmp(*nextArg, "--relaxed-nan"))
+			{
+				compileOptions.relaxedNaN = true;
+			}
+			else if(!strcmp(*nextArg, "--cache-stack-pointer"))
+			{
+				compileOptions.cacheStackPointer = true;
+			}
+			else if(!strcmp(*nextArg, "--share-trap-blocks"))
+			{
+				compileOptions.shareTrapBlocks = true;
+			}
+			else if(!strcmp(*nextArg, "--specialize-instances"))
+			{
+				Runtime::setGlobalSpecializeInstances(true);
+			}
+			else if(!strcmp(*nextArg, "--huge-pages"))
+			{
+				Platform::setHugePagesEnabled(true);
+			}
+			else if(!strcmp(*nextArg, "--gdb-jit"))
+			{
+				LLVMJIT::setGDBRegistrationEnabled(true);
+			}
+			else if(stringStartsWith(*nextArg, "--perf-map="))
+			{
+				const char* formatString = *nextArg + strlen("--perf-map=");
+				Platform::PerfMapFormat format;
+				if(!strcmp(formatString, "map")) { format = Platform::PerfMapFormat::map; }
+				else if(!strcmp(formatString, "jitdump"))
+				{
+					format = Platform::PerfMapFormat::jitdump;
+				}
+				else
+				{
+					Log::printf(Log::error, "Unknown perf map format '%s'.\n", formatString);
+					return false;
+				}
+				if(!Platform::enablePerfMap(format))
+				{
+					Log::printf(Log::error, "Couldn't create the '%s' perf map.\n", formatString);
+					return false;
+				}
+			}
+			else if(stringStartsWith(*nextArg, "--atomic-wait-spin="))
+			{
+				const char* spinString = *nextArg + strlen("--atomic-wait-spin=");
+				char* spinStringEnd = nullptr;
+				const U64 spinNanoseconds = strtoull(spinString, &spinStringEnd, 10);
+				if(!*spinString || *spinStringEnd)
+				{
+					Log::printf(Log::error, "Invalid atomic wait spin time '%s'.\n", spinString);
+					return false;
+				}
+				atomicWaitSpinNanoseconds = spinNanoseconds;
+			}
+			else if(stringStartsWith(*nextArg, "--numa-node="))
+			{
+				const char* nodeString = *nextArg + strlen("--numa-node=");
+				char* nodeStringEnd = nullptr;
+				const U64 node = strtoull(nodeString, &nodeStringEnd, 10);
+				if(!*nodeString || *nodeStringEnd || node >= Platform::getNumNUMANodes())
+				{
+					Log::printf(Log::error, "Invalid NUMA node '%s'.\n", nodeString);
+					return false;
+				}
+				numaNode = Uptr(node);
+			}
 			else if(!strcmp(*nextArg, "--mount-root"))
 			{
 				if(rootMountPath)
@@ -345,6 +784,76 @@ struct State
 
 				rootMountPath = *nextArg;
 			}
+			else if(!strcmp(*nextArg, "--mount-memory"))
+			{
+				++nextArg;
+				if(!*nextArg)
+				{
+					Log::printf(Log::error, "Expected path following '--mount-memory'.\n");
+					return false;
+				}
+				memoryAndBundleMounts.push_back({*nextArg, nullptr});
+			}
+			else if(stringStartsWith(*nextArg, "--memory-fs-quota="))
+			{
+				const char* quotaString = *nextArg + strlen("--memory-fs-quota=");
+				char* quotaStringEnd = nullptr;
+				const unsigned long long quota = strtoull(quotaString, &quotaStringEnd, 10);
+				if(!*quotaString || *quotaStringEnd)
+				{
+					Log::printf(
+						Log::error, "Invalid in-memory file system quota '%s'.\n", quotaString);
+					return false;
+				}
+				memoryFSQuota = U64(quota);
+			}
+			else if(!strcmp(*nextArg, "--mount-bundle"))
+			{
+				if(!nextArg[1] || !nextArg[2])
+				{
+					Log::printf(Log::error,
+								"Expected path and archive following '--mount-bundle'.\n");
+					return false;
+				}
+				memoryAndBundleMounts.push_back({nextArg[1], nextArg[2]});
+				nextArg += 2;
+			}
+			else if(!strcmp(*nextArg, "--io-uring"))
+			{
+				useIOURing = true;
+			}
+			else if(!strcmp(*nextArg, "--iocp"))
+			{
+				useIOCP = true;
+			}
+			else if(stringStartsWith(*nextArg, "--socket-fd="))
+			{
+				const char* fdString = *nextArg + strlen("--socket-fd=");
+				char* fdStringEnd = nullptr;
+				const long fd = strtol(fdString, &fdStringEnd, 10);
+				if(!*fdString || *fdStringEnd || fd < 0 || fd > INT32_MAX)
+				{
+					Log::printf(Log::error, "Invalid socket file descriptor '%s'.\n", fdString);
+					return false;
+				}
+				socketFDs.push_back(I32(fd));
+			}
+			else if(!strcmp(*nextArg, "--buffered-stdio"))
+			{
+				useBufferedStdio = true;
+			}
+			else if(stringStartsWith(*nextArg, "--serve="))
+			{
+				serveSocketPath = *nextArg + strlen("--serve=");
+			}
+			else if(stringStartsWith(*nextArg, "--connect="))
+			{
+				connectSocketPath = *nextArg + strlen("--connect=");
+			}
+			else if(!strcmp(*nextArg, "--wasi-coarse-clocks"))
+			{
+				useCoarseWASIClocks = true;
+			}
 			else if(stringStartsWith(*nextArg, "--wasi-trace="))
 			{
 				if(wasiTraceLavel != WASI::SyscallTraceLevel::none)
@@ -392,6 +901,41 @@ struct State
 
 		while(*nextArg) { runArgs.push_back(*nextArg++); };
 
+		// A client of a fork server doesn't load the module, so it doesn't need the rest of the
+		// initialization.
+		if(connectSocketPath) { return true; }
+
+		// The child processes of a fork server only have the thread that forked them, so the
+		// options that need other threads, or that write files when the program exits, can't be
+		// used with --serve.
+		if(serveSocketPath
+		   && (compileOptions.tierUpCallThreshold || useBufferedStdio
+			   || useIOURing || profileOutFilename || sampleProfileFilename || snapshotOutFilename
+			   || compileOptions.countFunctionCalls))
+		{
+			Log::printf(Log::error,
+						"--serve may not be used with --tier-up, --buffered-stdio, --io-uring,"
+						" --profile-out, --profile, --snapshot-out, or --function-stats.\n");
+			return false;
+		}
+
+		// Recreate the compartment on the requested NUMA node, and run the main thread there.
+		if(numaNode != UINTPTR_MAX)
+		{
+			WAVM_ERROR_UNLESS(tryCollectCompartment(std::move(compartment)));
+			CompartmentLayout compartmentLayout;
+			compartmentLayout.numaNode = numaNode;
+			compartment = createCompartment("", compartmentLayout);
+
+			if(!Platform::bindCurrentThreadToNUMANode(numaNode))
+			{
+				Log::printf(Log::error,
+							"Couldn't bind the main thread to NUMA node %" WAVM_PRIuPTR ".\n",
+							numaNode);
+			}
+		}
+		setCompartmentAtomicWaitSpinDuration(compartment, atomicWaitSpinNanoseconds);
+
 		// Check that the requested features are supported by the host CPU.
 		switch(LLVMJIT::validateTarget(LLVMJIT::getHostTargetSpec(), featureSpec))
 		{
@@ -419,78 +963,19 @@ struct State
 		default: WAVM_UNREACHABLE();
 		};
 
-		const char* objectCachePath
-			= WAVM_SCOPED_DISABLE_SECURE_CRT_WARNINGS(getenv("WAVM_OBJECT_CACHE_DIR"));
-		if(allowCaching && objectCachePath && *objectCachePath)
+		if(allowCaching)
 		{
-			Uptr maxBytes = 1024 * 1024 * 1024;
-
-			const char* maxMegabytesEnv
-				= WAVM_SCOPED_DISABLE_SECURE_CRT_WARNINGS(getenv("WAVM_OBJECT_CACHE_MAX_MB"));
-			if(maxMegabytesEnv && *maxMegabytesEnv)
-			{
-				int maxMegabytes = atoi(maxMegabytesEnv);
-				if(maxMegabytes <= 0)
-				{
-					Log::printf(
-						Log::error,
-						"Invalid object cache size \"%s\". Expected an integer greater than 1.",
-						maxMegabytesEnv);
-					return false;
-				}
-				maxBytes = Uptr(maxMegabytes) * 1000000;
-			}
-
-			// Calculate a "code key" that identifies the code involved in compiling WebAssembly to
-			// object code in the cache. If recompiling the module would produce different object
-			// code, the code key should be different, and if recompiling the module would produce
-			// the same object code, the code key should be the same.
-			LLVMJIT::Version llvmjitVersion = LLVMJIT::getVersion();
-			U64 codeKey = 0;
-			codeKey = Hash<U64>()(llvmjitVersion.llvmMajor, codeKey);
-			codeKey = Hash<U64>()(llvmjitVersion.llvmMinor, codeKey);
-			codeKey = Hash<U64>()(llvmjitVersion.llvmPatch, codeKey);
-			codeKey = Hash<U64>()(llvmjitVersion.llvmjitVersion, codeKey);
-			codeKey = Hash<U64>()(WAVM_VERSION_MAJOR, codeKey);
-			codeKey = Hash<U64>()(WAVM_VERSION_MINOR, codeKey);
-			codeKey = Hash<U64>()(WAVM_VERSION_PATCH, codeKey);
-
-			// Initialize the object cache.
 			std::shared_ptr<Runtime::ObjectCacheInterface> objectCache;
-			ObjectCache::OpenResult openResult
-				= ObjectCache::open(objectCachePath, maxBytes, codeKey, objectCache);
-			switch(openResult)
+			if(!openObjectCache(compileOptions, objectCache)) { return false; }
+			if(objectCache)
 			{
-			case ObjectCache::OpenResult::doesNotExist:
-				Log::printf(
-					Log::error, "Object cache directory \"%s\" does not exist.\n", objectCachePath);
-				return false;
-			case ObjectCache::OpenResult::notDirectory:
-				Log::printf(Log::error,
-							"Object cache path \"%s\" does not refer to a directory.\n",
-							objectCachePath);
-				return false;
-			case ObjectCache::OpenResult::notAccessible:
-				Log::printf(
-					Log::error, "Object cache path \"%s\" is not accessible.\n", objectCachePath);
-				return false;
-			case ObjectCache::OpenResult::invalidDatabase:
-				Log::printf(
-					Log::error, "Object cache database in \"%s\" is not valid.\n", objectCachePath);
-				return false;
-			case ObjectCache::OpenResult::tooManyReaders:
-				Log::printf(Log::error,
-							"Object cache database in \"%s\" has too many concurrent readers.\n",
-							objectCachePath);
-				return false;
-
-			case ObjectCache::OpenResult::success:
+				if(cachePartitions) { compileOptions.partitionObjectCache = objectCache; }
 				Runtime::setGlobalObjectCache(std::move(objectCache));
-				break;
-			default: WAVM_UNREACHABLE();
-			};
+			}
 		}
 
+		Runtime::setGlobalCompileOptions(compileOptions);
+
 		return true;
 	}
 
@@ -573,7 +1058,66 @@ struct State
 				absoluteRootMountPath
 					= Platform::getCurrentWorkingDirectory() + '/' + rootMountPath;
 			}
-			sandboxFS = VFS::makeSandboxFS(&Platform::getHostFS(), absoluteRootMountPath);
+
+			VFS::FileSystem* hostFS = &Platform::getHostFS();
+			if(useIOURing)
+			{
+				hostFS = Platform::getIOURingHostFS();
+				if(!hostFS)
+				{
+					Log::printf(Log::error, "io_uring isn't supported by this host.\n");
+					return false;
+				}
+			}
+			else if(useIOCP)
+			{
+				hostFS = Platform::getIOCPHostFS();
+				if(!hostFS)
+				{
+					Log::printf(Log::error, "Overlapped I/O isn't supported by this host.\n");
+					return false;
+				}
+			}
+
+			// Prefer a sandbox that resolves paths beneath an open handle for the root directory,
+			// and fall back to one that prefixes the paths passed to the host file system.
+			if(!useIOCP)
+			{ sandboxFS = Platform::openHostSandboxFS(absoluteRootMountPath, useIOURing); }
+			if(!sandboxFS) { sandboxFS = VFS::makeSandboxFS(hostFS, absoluteRootMountPath); }
+		}
+
+		// Mount the in-memory and bundle directories passed on the command-line over the root
+		// directory. If no root directory was mounted, they are mounted in an empty root.
+		if(memoryAndBundleMounts.size())
+		{
+			if(abi != ABI::wasi)
+			{
+				Log::printf(Log::error,
+							"--mount-memory and --mount-bundle may only be used with the WASI "
+							"ABI.\n");
+				return false;
+			}
+
+			std::vector<VFS::MountPoint> mountPoints;
+			for(const auto& mount : memoryAndBundleMounts)
+			{
+				std::shared_ptr<VFS::FileSystem> mountedFS;
+				if(!mount.second) { mountedFS = VFS::makeMemoryFS(memoryFSQuota); }
+				else
+				{
+					mountedFS = VFS::makeBundleFS(mount.second);
+					if(!mountedFS)
+					{
+						Log::printf(
+							Log::error, "Couldn't load bundle archive '%s'.\n", mount.second);
+						return false;
+					}
+				}
+				mountPoints.push_back({mount.first, std::move(mountedFS)});
+			}
+
+			if(!sandboxFS) { sandboxFS = VFS::makeMemoryFS(0); }
+			sandboxFS = VFS::makeMountFS(std::move(sandboxFS), std::move(mountPoints));
 		}
 
 		if(abi == ABI::emscripten)
@@ -595,14 +1139,34 @@ struct State
 			std::vector<std::string> args = runArgs;
 			args.insert(args.begin(), getFilenameAndExtension(filename));
 
+			// If --buffered-stdio was passed, wrap stdout and stderr in buffered VFDs. The WASI
+			// process closes them when it is destroyed, which writes any buffered output.
+			VFS::VFD* stdOut = Platform::getStdFD(Platform::StdDevice::out);
+			VFS::VFD* stdErr = Platform::getStdFD(Platform::StdDevice::err);
+			if(useBufferedStdio)
+			{
+				stdOut = VFS::makeBufferedVFD(stdOut);
+				stdErr = VFS::makeBufferedVFD(stdErr);
+			}
+
 			// Create the WASI process.
 			wasiProcess = WASI::createProcess(compartment,
 											  std::move(args),
 											  {},
 											  sandboxFS.get(),
 											  Platform::getStdFD(Platform::StdDevice::in),
-											  Platform::getStdFD(Platform::StdDevice::out),
-											  Platform::getStdFD(Platform::StdDevice::err));
+											  stdOut,
+											  stdErr);
+
+			WASI::setProcessUsesCoarseClocks(*wasiProcess, useCoarseWASIClocks);
+
+			for(I32 socketFD : socketFDs)
+			{
+				const U32 wasiFD = WASI::addProcessSocket(
+					*wasiProcess, Platform::openHostHandle(Uptr(socketFD)));
+				Log::printf(
+					Log::debug, "Passed socket %i to the process as fd %u.\n", socketFD, wasiFD);
+			}
 		}
 		else if(abi == ABI::bare)
 		{
@@ -617,6 +1181,24 @@ struct State
 			}
 		}
 
+		if(socketFDs.size() && abi != ABI::wasi)
+		{
+			Log::printf(Log::error, "--socket-fd may only be used with the WASI ABI.\n");
+			return false;
+		}
+
+		if(useBufferedStdio && abi != ABI::wasi)
+		{
+			Log::printf(Log::error, "--buffered-stdio may only be used with the WASI ABI.\n");
+			return false;
+		}
+
+		if(useCoarseWASIClocks && abi != ABI::wasi)
+		{
+			Log::printf(Log::error, "--wasi-coarse-clocks may only be used with the WASI ABI.\n");
+			return false;
+		}
+
 		if(wasiTraceLavel != WASI::SyscallTraceLevel::none)
 		{
 			if(abi != ABI::wasi)
@@ -631,15 +1213,9 @@ struct State
 		return true;
 	}
 
-	I32 execute(const IR::Module& irModule, Instance* instance)
+	// Runs the program in an instance whose start function was already called.
+	I32 execute(const IR::Module& irModule, Instance* instance, Context* context)
 	{
-		// Create a WASM execution context.
-		Context* context = Runtime::createContext(compartment);
-
-		// Call the module start function, if it has one.
-		Function* startFunction = getStartFunction(instance);
-		if(startFunction) { invokeFunction(context, startFunction); }
-
 		if(emscriptenProcess)
 		{
 			// Initialize the Emscripten instance.
@@ -730,6 +1306,17 @@ struct State
 		invokeFunction(
 			context, function, invokeSig, untaggedInvokeArgs.data(), untaggedInvokeResults.data());
 
+		// Write a snapshot of the instance's state after running the function.
+		if(snapshotOutFilename)
+		{
+			IR::Module snapshotModule;
+			if(!snapshotInstance(instance, context, irModule, snapshotModule))
+			{ return EXIT_FAILURE; }
+			std::vector<U8> snapshotBytes = WASM::saveBinaryModule(snapshotModule);
+			if(!saveFile(snapshotOutFilename, snapshotBytes.data(), snapshotBytes.size()))
+			{ return EXIT_FAILURE; }
+		}
+
 		if(untaggedInvokeResults.size() == 1 && invokeSig.results()[0] == ValueType::i32)
 		{ return untaggedInvokeResults[0].i32; }
 		else
@@ -753,25 +1340,83 @@ struct State
 		}
 	}
 
+	// Runs each job sent by wavm run --connect in a forked copy of this process, which starts with
+	// the module instantiated and its start function called.
+	int serve(const IR::Module& irModule, Instance* instance, Context* context)
+	{
+		if(abi != ABI::wasi)
+		{
+			Log::printf(Log::error, "--serve may only be used with the WASI ABI.\n");
+			return EXIT_FAILURE;
+		}
+
+		if(Function* startFunction = getStartFunction(instance))
+		{
+			const I32 startResult = WASI::catchExit([&] {
+				invokeFunction(context, startFunction);
+				return EXIT_SUCCESS;
+			});
+			if(startResult != EXIT_SUCCESS) { return startResult; }
+		}
+
+		// The object cache may have a thread, and the databases it opened can't be used by a
+		// forked process, so close it before forking.
+		Runtime::setGlobalObjectCache(nullptr);
+
+		Log::printf(Log::debug, "Serving jobs on '%s'.\n", serveSocketPath);
+		Platform::serveForkServerJobs(serveSocketPath, [&](Platform::ForkServerJob&& job) {
+			WASI::setProcessArgs(*wasiProcess, std::move(job.args), std::move(job.envs));
+			const I32 result
+				= WASI::catchExit([&] { return execute(irModule, instance, context); });
+
+			// Close the process's stdio before the job's process exits.
+			wasiProcess.reset();
+			return result;
+		});
+
+		Log::printf(Log::error, "Couldn't serve jobs on '%s'.\n", serveSocketPath);
+		return EXIT_FAILURE;
+	}
+
+	// Runs the program in a fork server started by wavm run --serve, and returns its exit code.
+	int runInForkServer()
+	{
+		// Like a program run directly by wavm run, the program gets the filename and the program
+		// arguments, but not the environment variables.
+		Platform::ForkServerJob job;
+		job.args = runArgs;
+		job.args.insert(job.args.begin(), getFilenameAndExtension(filename));
+
+		I32 exitCode = EXIT_FAILURE;
+		if(!Platform::runForkServerJob(connectSocketPath, job, exitCode))
+		{
+			Log::printf(Log::error,
+						"Couldn't run the program in the server on '%s'.\n",
+						connectSocketPath);
+			return EXIT_FAILURE;
+		}
+		return exitCode;
+	}
+
 	int run(char** argv)
 	{
 		// Parse the command line.
 		if(!parseCommandLineAndEnvironment(argv)) { return EXIT_FAILURE; }
+		if(connectSocketPath) { return runInForkServer(); }
 
-		// Read the specified file into a byte array.
-		std::vector<U8> fileBytes;
-		if(!loadFile(filename, fileBytes)) { return EXIT_FAILURE; }
-
-		// Load the module from the byte array
+		// Load the module from the specified file.
 		Runtime::ModuleRef module = nullptr;
 		if(precompiled)
 		{
-			if(!loadPrecompiledModule(std::move(fileBytes), featureSpec, module))
-			{ return EXIT_FAILURE; }
+			if(!loadPrecompiledModule(filename, featureSpec, module)) { return EXIT_FAILURE; }
 		}
-		else if(!loadTextOrBinaryModule(filename, std::move(fileBytes), featureSpec, module))
+		else
 		{
-			return EXIT_FAILURE;
+			// Read the specified file into a byte array.
+			std::vector<U8> fileBytes;
+			if(!loadFile(filename, fileBytes)
+			   || !loadTextOrBinaryModule(filename, std::move(fileBytes), featureSpec, module))
+			{ return EXIT_FAILURE; }
 		}
 		const IR::Module& irModule = Runtime::getModuleIR(module);
 
@@ -823,9 +1468,31 @@ struct State
 			WASI::setProcessMemory(*wasiProcess, memory);
 		}
 
-		// Execute the program.
+		// Start sampling the program.
+		Profiler* sampleProfiler = nullptr;
+		if(sampleProfileFilename)
+		{
+			sampleProfiler = startProfiler(sampleProfileFrequency);
+			if(!sampleProfiler)
+			{
+				Log::printf(Log::error, "Sampling profiles aren't supported on this host.\n");
+				return EXIT_FAILURE;
+			}
+		}
+
+		// Create a WASM execution context.
+		Context* context = Runtime::createContext(compartment);
+
+		// If --serve was passed, call the start function, and run the program in forked processes.
+		if(serveSocketPath) { return serve(irModule, instance, context); }
+
+		// Execute the program, starting with the module start function, if it has one.
 		Timing::Timer executionTimer;
-		auto executeThunk = [&] { return execute(irModule, instance); };
+		auto executeThunk = [&] {
+			if(Function* startFunction = getStartFunction(instance))
+			{ invokeFunction(context, startFunction); }
+			return execute(irModule, instance, context);
+		};
 		int result;
 		if(emscriptenProcess) { result = Emscripten::catchExit(std::move(executeThunk)); }
 		else if(wasiProcess)
@@ -838,6 +1505,79 @@ struct State
 		}
 		Timing::logTimer("Executed program", executionTimer);
 
+		// Write the sampled profile while the instance's code is still loaded.
+		if(sampleProfiler)
+		{
+			const std::string foldedStacks = stopProfiler(sampleProfiler);
+			if(!saveFile(sampleProfileFilename, foldedStacks.data(), foldedStacks.size()))
+			{ return EXIT_FAILURE; }
+		}
+
+		// Write the execution counts of the instrumented module to the profile file.
+		if(profileOutFilename)
+		{
+			LLVMJIT::ModuleProfile profile;
+			getInstanceProfile(instance, profile);
+			std::vector<U8> profileBytes = LLVMJIT::serializeProfile(profile);
+			if(!saveFile(profileOutFilename, profileBytes.data(), profileBytes.size()))
+			{ return EXIT_FAILURE; }
+		}
+
+		// Print the functions that spent the most cycles in calls.
+		if(compileOptions.countFunctionCalls)
+		{
+			std::vector<FunctionStats> functionStats;
+			getFunctionStats(instance, functionStats);
+			std::sort(functionStats.begin(),
+					  functionStats.end(),
+					  [](const FunctionStats& left, const FunctionStats& right) {
+						  return left.numCycles > right.numCycles;
+					  });
+			static constexpr Uptr maxPrintedFunctions = 20;
+			Log::printf(Log::output, "%20s %20s  Function\n", "Calls", "Cycles");
+			for(Uptr index = 0; index < functionStats.size() && index < maxPrintedFunctions;
+				++index)
+			{
+				Log::printf(Log::output,
+							"%20" PRIu64 " %20" PRIu64 "  %s\n",
+							functionStats[index].numCalls,
+							functionStats[index].numCycles,
+							getDebugName(asObject(functionStats[index].function)).c_str());
+			}
+		}
+
+		// Log how often spinning avoided blocking in memory.atomic.wait.
+		const AtomicWaitStats atomicWaitStats = getCompartmentAtomicWaitStats(compartment);
+		if(atomicWaitStats.numWaits)
+		{
+			Log::printf(Log::metrics,
+						"Atomic waits: %" PRIu64 ", %" PRIu64 " spun, %" PRIu64
+						" ended by spinning\n",
+						atomicWaitStats.numWaits,
+						atomicWaitStats.numSpinningWaits,
+						atomicWaitStats.numWaitsEndedBySpinning);
+		}
+
+		// Log how often Emscripten threads reused a host thread and context from the thread pool.
+		if(emscriptenProcess)
+		{
+			const Emscripten::ThreadPoolStats threadPoolStats
+				= Emscripten::getThreadPoolStats(*emscriptenProcess);
+			if(threadPoolStats.numThreadsCreated)
+			{
+				Log::printf(Log::metrics,
+							"Emscripten threads: %" PRIu64 ", %" PRIu64
+							" on idle host threads, %" PRIu64 " with recycled contexts, %" PRIu64
+							" rejected, %" WAVM_PRIuPTR " host threads (%" WAVM_PRIuPTR " busy)\n",
+							threadPoolStats.numThreadsCreated,
+							threadPoolStats.numThreadsOnIdleWorkers,
+							threadPoolStats.numRecycledContexts,
+							threadPoolStats.numThreadsRejected,
+							threadPoolStats.numWorkerThreads,
+							threadPoolStats.numBusyWorkerThreads);
+			}
+		}
+
 		// Log the peak memory usage.
 		Uptr peakMemoryUsage = Platform::getPeakMemoryUsageBytes();
 		Log::printf(
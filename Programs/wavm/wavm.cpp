@@ -1,4 +1,5 @@
 #include "wavm.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "WAVM/IR/FeatureSpec.h"
@@ -21,6 +22,7 @@ enum class Command
 	version,
 
 #if WAVM_ENABLE_RUNTIME
+	cache,
 	compile,
 	run,
 #endif
@@ -46,6 +48,10 @@ static Command parseCommand(const char* string)
 		return Command::version;
 	}
 #if WAVM_ENABLE_RUNTIME
+	else if(!strcmp(string, "cache"))
+	{
+		return Command::cache;
+	}
 	else if(!strcmp(string, "compile"))
 	{
 		return Command::compile;
@@ -67,6 +73,7 @@ static const char* getCommandListHelpText()
 		   "  assemble     Assemble WAST/WAT to WASM\n"
 		   "  disassemble  Disassemble WASM to WAST/WAT\n"
 #if WAVM_ENABLE_RUNTIME
+		   "  cache        Manage the object cache\n"
 		   "  compile      Compile a WebAssembly module\n"
 #endif
 		   "  help         Display help about command-line usage of WAVM\n"
@@ -152,6 +159,30 @@ bool parseAndSetFeature(const char* featureName, IR::FeatureSpec& featureSpec, b
 	return false;
 }
 
+void appendJSONString(std::string& json, const std::string& string)
+{
+	json += '"';
+	for(char c : string)
+	{
+		if(c == '"' || c == '\\')
+		{
+			json += '\\';
+			json += c;
+		}
+		else if(U8(c) < 0x20)
+		{
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", U8(c));
+			json += escape;
+		}
+		else
+		{
+			json += c;
+		}
+	}
+	json += '"';
+}
+
 static void showTopLevelHelp(Log::Category outputCategory)
 {
 	Log::printf(outputCategory,
@@ -186,6 +217,7 @@ static int execHelpCommand(int argc, char** argv)
 		case Command::test: showTestHelp(Log::output); return EXIT_SUCCESS;
 		case Command::version: showVersionHelp(Log::output); return EXIT_SUCCESS;
 #if WAVM_ENABLE_RUNTIME
+		case Command::cache: showCacheHelp(Log::output); return EXIT_SUCCESS;
 		case Command::compile: showCompileHelp(Log::output); return EXIT_SUCCESS;
 		case Command::run: showRunHelp(Log::output); return EXIT_SUCCESS;
 #endif
@@ -255,6 +287,7 @@ int main(int argc, char** argv)
 		case Command::test: return execTestCommand(argc - 2, argv + 2);
 		case Command::version: return execVersionCommand(argc - 2, argv + 2);
 #if WAVM_ENABLE_RUNTIME
+		case Command::cache: return execCacheCommand(argc - 2, argv + 2);
 		case Command::compile: return execCompileCommand(argc - 2, argv + 2);
 		case Command::run: return execRunCommand(argc - 2, argv + 2);
 #endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include "WAVM/Logging/Logging.h"
 
@@ -7,6 +8,13 @@ namespace WAVM { namespace IR {
 	struct Module;
 	struct FeatureSpec;
 }};
+namespace WAVM { namespace LLVMJIT {
+	struct CompileOptions;
+	struct ModuleProfile;
+}};
+namespace WAVM { namespace Runtime {
+	struct ObjectCacheInterface;
+}};
 
 int execAssembleCommand(int argc, char** argv);
 int execDisassembleCommand(int argc, char** argv);
@@ -19,12 +27,39 @@ void showTestHelp(WAVM::Log::Category outputCategory);
 void showVersionHelp(WAVM::Log::Category outputCategory);
 
 #if WAVM_ENABLE_RUNTIME
+int execCacheCommand(int argc, char** argv);
 int execCompileCommand(int argc, char** argv);
 int execRunCommand(int argc, char** argv);
 
+void showCacheHelp(WAVM::Log::Category outputCategory);
 void showCompileHelp(WAVM::Log::Category outputCategory);
 void showRunHelp(WAVM::Log::Category outputCategory);
+
+// Parses the <level> of a --debug-info=<level> option, logging an error if it's invalid.
+bool parseDebugInfoLevel(const char* levelString, WAVM::LLVMJIT::CompileOptions& compileOptions);
+
+// Loads a profile written by wavm run --profile-out.
+bool loadProfile(const char* filename,
+				 std::shared_ptr<const WAVM::LLVMJIT::ModuleProfile>& outProfile);
+
+// Loads a module from a WebAssembly binary or text file, logging any errors. If
+// validateFunctionBodies is false, the function bodies in a binary file aren't validated, and must
+// be validated by compiling the module with CompileOptions::validateFunctionBodies. If the file is
+// a binary module and outWASMBytes isn't null, the file's bytes are moved to it.
+bool loadTextOrBinaryModule(const char* filename,
+							WAVM::IR::Module& outModule,
+							bool validateFunctionBodies = true,
+							std::vector<WAVM::U8>* outWASMBytes = nullptr);
+
+// Opens the object cache in the directory given by the WAVM_OBJECT_CACHE_DIR environment variable,
+// identifying the object code it contains by the compile options. If the environment variable
+// isn't set, returns true without opening a cache.
+bool openObjectCache(const WAVM::LLVMJIT::CompileOptions& compileOptions,
+					 std::shared_ptr<WAVM::Runtime::ObjectCacheInterface>& outObjectCache);
 #endif
 
 std::string getFeatureListHelpText();
 bool parseAndSetFeature(const char* featureName, WAVM::IR::FeatureSpec& featureSpec, bool enable);
+
+// Appends a string to a JSON document as a quoted string literal.
+void appendJSONString(std::string& json, const std::string& string);
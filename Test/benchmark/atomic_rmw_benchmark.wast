@@ -0,0 +1,117 @@
+;; Measures the throughput of atomic read-modify-write operations on a shared memory when 4
+;; threads run them at once: on a single counter that all the threads contend for, and on a
+;; counter per thread in separate cache lines.
+
+(module
+  (import "threadTest" "createThread" (func $createThread (param funcref i32) (result i64)))
+  (import "threadTest" "joinThread" (func $joinThread (param i64) (result i64)))
+
+  (memory 1 1 shared)
+
+  (type $threadFunction (func (param i32) (result i64)))
+  (table $threadFunctions funcref (elem $addThread $cmpxchgThread))
+
+  ;; The number of iterations each thread runs is stored at address 0, and the counters start at
+  ;; address 64.
+  (global $numIterationsAddress i32 (i32.const 0))
+  (global $counterBaseAddress i32 (i32.const 64))
+
+  (func $addThread (param $counterAddress i32) (result i64)
+    (local $numIterations i32)
+    (local $iteration i32)
+    (local.set $numIterations (i32.atomic.load (global.get $numIterationsAddress)))
+    loop $loop
+      (drop (i64.atomic.rmw.add (local.get $counterAddress) (i64.const 1)))
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i64.const 0)
+  )
+
+  ;; Increments the counter with a compare-and-exchange loop, like the lock-free updates that
+  ;; can't be expressed as a single read-modify-write operation.
+  (func $cmpxchgThread (param $counterAddress i32) (result i64)
+    (local $numIterations i32)
+    (local $iteration i32)
+    (local $value i64)
+    (local $previousValue i64)
+    (local.set $numIterations (i32.atomic.load (global.get $numIterationsAddress)))
+    loop $loop
+      (local.set $value (i64.atomic.load (local.get $counterAddress)))
+      loop $retry
+        (local.set $previousValue
+          (i64.atomic.rmw.cmpxchg (local.get $counterAddress)
+            (local.get $value)
+            (i64.add (local.get $value) (i64.const 1))))
+        (if (i64.ne (local.get $previousValue) (local.get $value))
+          (then
+            (local.set $value (local.get $previousValue))
+            (br $retry)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i64.const 0)
+  )
+
+  ;; Runs the thread function on 3 new threads and the calling thread, with counters that are
+  ;; $counterStride bytes apart, and returns the sum of the counters.
+  (func $run
+    (param $threadFunctionIndex i32)
+    (param $numIterations i32)
+    (param $counterStride i32)
+    (result i64)
+    (local $threadFunction funcref)
+    (local $counter1 i32)
+    (local $counter2 i32)
+    (local $counter3 i32)
+    (local $thread1 i64)
+    (local $thread2 i64)
+    (local $thread3 i64)
+    (local.set $threadFunction (table.get $threadFunctions (local.get $threadFunctionIndex)))
+    (local.set $counter1 (i32.add (global.get $counterBaseAddress) (local.get $counterStride)))
+    (local.set $counter2 (i32.add (local.get $counter1) (local.get $counterStride)))
+    (local.set $counter3 (i32.add (local.get $counter2) (local.get $counterStride)))
+    (i32.atomic.store (global.get $numIterationsAddress) (local.get $numIterations))
+    (memory.fill (global.get $counterBaseAddress) (i32.const 0) (i32.const 256))
+
+    (local.set $thread1 (call $createThread (local.get $threadFunction) (local.get $counter1)))
+    (local.set $thread2 (call $createThread (local.get $threadFunction) (local.get $counter2)))
+    (local.set $thread3 (call $createThread (local.get $threadFunction) (local.get $counter3)))
+    (drop (call_indirect $threadFunctions (type $threadFunction)
+      (global.get $counterBaseAddress) (local.get $threadFunctionIndex)))
+    (drop (call $joinThread (local.get $thread1)))
+    (drop (call $joinThread (local.get $thread2)))
+    (drop (call $joinThread (local.get $thread3)))
+
+    (if (i32.eqz (local.get $counterStride))
+      (then (return (i64.atomic.load (global.get $counterBaseAddress)))))
+    (i64.add
+      (i64.add (i64.atomic.load (global.get $counterBaseAddress))
+        (i64.atomic.load (local.get $counter1)))
+      (i64.add (i64.atomic.load (local.get $counter2)) (i64.atomic.load (local.get $counter3))))
+  )
+
+  (func (export "rmw.add.contended") (param $numIterations i32) (result i64)
+    (call $run (i32.const 0) (local.get $numIterations) (i32.const 0))
+  )
+  (func (export "rmw.add.uncontended") (param $numIterations i32) (result i64)
+    (call $run (i32.const 0) (local.get $numIterations) (i32.const 64))
+  )
+  (func (export "rmw.cmpxchg.contended") (param $numIterations i32) (result i64)
+    (call $run (i32.const 1) (local.get $numIterations) (i32.const 0))
+  )
+  (func (export "rmw.cmpxchg.uncontended") (param $numIterations i32) (result i64)
+    (call $run (i32.const 1) (local.get $numIterations) (i32.const 64))
+  )
+)
+
+(assert_return (invoke "rmw.add.contended" (i32.const 1000)) (i64.const 4000))
+(assert_return (invoke "rmw.add.uncontended" (i32.const 1000)) (i64.const 4000))
+(assert_return (invoke "rmw.cmpxchg.contended" (i32.const 1000)) (i64.const 4000))
+(assert_return (invoke "rmw.cmpxchg.uncontended" (i32.const 1000)) (i64.const 4000))
+
+(benchmark "rmw.add.contended" (invoke "rmw.add.contended" (i32.const 100000)))
+(benchmark "rmw.add.uncontended" (invoke "rmw.add.uncontended" (i32.const 100000)))
+(benchmark "rmw.cmpxchg.contended" (invoke "rmw.cmpxchg.contended" (i32.const 100000)))
+(benchmark "rmw.cmpxchg.uncontended" (invoke "rmw.cmpxchg.uncontended" (i32.const 100000)))
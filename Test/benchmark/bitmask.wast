@@ -48,6 +48,102 @@
     (local.get $result)
   )
 
+  (func (export "i64x2.bitmask")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.xor
+        (local.get $result)
+        (i64x2.bitmask (v128.load (i32.const 0)))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "v128.any_true")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add
+        (local.get $result)
+        (v128.any_true (v128.load (i32.and (local.get $i) (i32.const 0xfff))))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i8x16.all_true")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add
+        (local.get $result)
+        (i8x16.all_true (v128.load (i32.and (local.get $i) (i32.const 0xfff))))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i16x8.all_true")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add
+        (local.get $result)
+        (i16x8.all_true (v128.load (i32.and (local.get $i) (i32.const 0xfff))))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i32x4.all_true")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add
+        (local.get $result)
+        (i32x4.all_true (v128.load (i32.and (local.get $i) (i32.const 0xfff))))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i64x2.all_true")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add
+        (local.get $result)
+        (i64x2.all_true (v128.load (i32.and (local.get $i) (i32.const 0xfff))))
+      ))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
   (func (export "emulated i8x16.bitmask")
     (param $numIterations i32)
     (result i32)
@@ -86,3 +182,10 @@
 
 (benchmark "i16x8.bitmask" (invoke "i16x8.bitmask" (i32.const 1000000)))
 (benchmark "i32x4.bitmask" (invoke "i32x4.bitmask" (i32.const 1000000)))
+(benchmark "i64x2.bitmask" (invoke "i64x2.bitmask" (i32.const 1000000)))
+
+(benchmark "v128.any_true" (invoke "v128.any_true" (i32.const 1000000)))
+(benchmark "i8x16.all_true" (invoke "i8x16.all_true" (i32.const 1000000)))
+(benchmark "i16x8.all_true" (invoke "i16x8.all_true" (i32.const 1000000)))
+(benchmark "i32x4.all_true" (invoke "i32x4.all_true" (i32.const 1000000)))
+(benchmark "i64x2.all_true" (invoke "i64x2.all_true" (i32.const 1000000)))
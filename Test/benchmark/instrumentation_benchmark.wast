@@ -0,0 +1,80 @@
+;; Measures the overhead of the code that can be added to interrupt or meter guests: the epoch
+;; deadline checks at loop iterations and function entries, and fuel metering. The
+;; benchmark/epoch-check/ and benchmark/fuel/ tests run this with --check-epoch-deadline and
+;; --meter-fuel to compare against the benchmark/ tests, which run it without them.
+
+(module
+  (memory 1)
+
+  (func (export "counting loop")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (local.set $result (i32.add (local.get $result) (i32.mul (local.get $i) (local.get $i))))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "nested loops")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $j i32)
+    (local $result i32)
+    loop $outer
+      (local.set $j (i32.const 0))
+      loop $inner
+        (local.set $result (i32.xor (local.get $result) (i32.add (local.get $i) (local.get $j))))
+        (local.set $j (i32.add (local.get $j) (i32.const 1)))
+        (br_if $inner (i32.lt_u (local.get $j) (i32.const 16)))
+      end
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "memory loop")
+    (param $numIterations i32)
+    (result i32)
+    (local $i i32)
+    (local $result i32)
+    loop $loop
+      (i32.store (i32.and (i32.shl (local.get $i) (i32.const 2)) (i32.const 0xfffc))
+        (local.get $i))
+      (local.set $result (i32.add (local.get $result)
+        (i32.load (i32.and (i32.shl (local.get $i) (i32.const 1)) (i32.const 0xfffc)))))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func $fib (param $n i32) (result i32)
+    (if (result i32) (i32.lt_u (local.get $n) (i32.const 2))
+      (then (local.get $n))
+      (else
+        (i32.add
+          (call $fib (i32.sub (local.get $n) (i32.const 1)))
+          (call $fib (i32.sub (local.get $n) (i32.const 2)))
+        )
+      )
+    )
+  )
+
+  (func (export "recursive calls") (param $n i32) (result i32)
+    (call $fib (local.get $n))
+  )
+)
+
+(assert_return (invoke "counting loop" (i32.const 4)) (i32.const 14))
+(assert_return (invoke "recursive calls" (i32.const 10)) (i32.const 55))
+
+(benchmark "counting loop" (invoke "counting loop" (i32.const 10000000)))
+(benchmark "nested loops" (invoke "nested loops" (i32.const 1000000)))
+(benchmark "memory loop" (invoke "memory loop" (i32.const 10000000)))
+(benchmark "recursive calls" (invoke "recursive calls" (i32.const 27)))
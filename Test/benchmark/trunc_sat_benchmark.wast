@@ -0,0 +1,177 @@
+;; Measures float to int conversions in loops over an array of floats, like the conversions in
+;; image and audio kernels. The floats include NaNs and values out of range of the integer types,
+;; so the saturating conversions hit all their cases.
+
+(module
+  (memory 1)
+
+  ;; Fills the first 16KB of memory with 4096 f32s, and the next 32KB with 4096 f64s.
+  (func $init
+    (local $i i32)
+    (local $f f32)
+    loop $loop
+      (local.set $f (f32.mul (f32.convert_i32_s (i32.sub (local.get $i) (i32.const 2048)))
+        (f32.const 1.0e7)))
+      (if (i32.eqz (i32.and (local.get $i) (i32.const 63)))
+        (then (local.set $f (f32.const nan))))
+      (f32.store (i32.shl (local.get $i) (i32.const 2)) (local.get $f))
+      (f64.store (i32.add (i32.const 16384) (i32.shl (local.get $i) (i32.const 3)))
+        (f64.promote_f32 (local.get $f)))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $loop (i32.lt_u (local.get $i) (i32.const 4096)))
+    end
+  )
+  (start $init)
+
+  (func (export "i32.trunc_sat_f32_s")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result i32)
+    loop $outer
+      (local.set $address (i32.const 0))
+      loop $inner
+        (local.set $result (i32.add (local.get $result)
+          (i32.trunc_sat_f32_s (f32.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 4)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 16384)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i32.trunc_sat_f32_u")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result i32)
+    loop $outer
+      (local.set $address (i32.const 0))
+      loop $inner
+        (local.set $result (i32.add (local.get $result)
+          (i32.trunc_sat_f32_u (f32.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 4)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 16384)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+
+  (func (export "i64.trunc_sat_f64_s")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result i64)
+    loop $outer
+      (local.set $address (i32.const 16384))
+      loop $inner
+        (local.set $result (i64.add (local.get $result)
+          (i64.trunc_sat_f64_s (f64.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 8)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 49152)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i32.wrap_i64 (local.get $result))
+  )
+
+  (func (export "i64.trunc_sat_f64_u")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result i64)
+    loop $outer
+      (local.set $address (i32.const 16384))
+      loop $inner
+        (local.set $result (i64.add (local.get $result)
+          (i64.trunc_sat_f64_u (f64.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 8)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 49152)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i32.wrap_i64 (local.get $result))
+  )
+
+  (func (export "i32x4.trunc_sat_f32x4_s")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result v128)
+    loop $outer
+      (local.set $address (i32.const 0))
+      loop $inner
+        (local.set $result (i32x4.add (local.get $result)
+          (i32x4.trunc_sat_f32x4_s (v128.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 16)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 16384)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i32x4.extract_lane 0 (local.get $result))
+  )
+
+  (func (export "i32x4.trunc_sat_f32x4_u")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result v128)
+    loop $outer
+      (local.set $address (i32.const 0))
+      loop $inner
+        (local.set $result (i32x4.add (local.get $result)
+          (i32x4.trunc_sat_f32x4_u (v128.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 16)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 16384)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (i32x4.extract_lane 0 (local.get $result))
+  )
+
+  ;; The trapping conversion, on the in-range floats in the middle of the f32 array.
+  (func (export "i32.trunc_f32_s")
+    (param $numIterations i32)
+    (result i32)
+    (local $iteration i32)
+    (local $address i32)
+    (local $result i32)
+    loop $outer
+      (local.set $address (i32.const 7940))
+      loop $inner
+        (local.set $result (i32.add (local.get $result)
+          (i32.trunc_f32_s (f32.load (local.get $address)))))
+        (local.set $address (i32.add (local.get $address) (i32.const 4)))
+        (br_if $inner (i32.lt_u (local.get $address) (i32.const 8192)))
+      end
+      (local.set $iteration (i32.add (local.get $iteration) (i32.const 1)))
+      (br_if $outer (i32.lt_u (local.get $iteration) (local.get $numIterations)))
+    end
+    (local.get $result)
+  )
+)
+
+;; The sum of k * -1.0e7 for k from 1 to 63, wrapped to 32 bits.
+(assert_return (invoke "i32.trunc_f32_s" (i32.const 1)) (i32.const 1314836480))
+
+(benchmark "i32.trunc_sat_f32_s" (invoke "i32.trunc_sat_f32_s" (i32.const 10000)))
+(benchmark "i32.trunc_sat_f32_u" (invoke "i32.trunc_sat_f32_u" (i32.const 10000)))
+(benchmark "i64.trunc_sat_f64_s" (invoke "i64.trunc_sat_f64_s" (i32.const 10000)))
+(benchmark "i64.trunc_sat_f64_u" (invoke "i64.trunc_sat_f64_u" (i32.const 10000)))
+(benchmark "i32x4.trunc_sat_f32x4_s" (invoke "i32x4.trunc_sat_f32x4_s" (i32.const 10000)))
+(benchmark "i32x4.trunc_sat_f32x4_u" (invoke "i32x4.trunc_sat_f32x4_u" (i32.const 10000)))
+(benchmark "i32.trunc_f32_s" (invoke "i32.trunc_f32_s" (i32.const 100000)))
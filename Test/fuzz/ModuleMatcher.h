@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include "WAVM/IR/Module.h"
 #include "WAVM/IR/Operators.h"
 #include "WAVM/Inline/Assert.h"
@@ -151,9 +152,12 @@ namespace WAVM {
 
 		void verifyMatches(BranchTableImm a, BranchTableImm b)
 		{
-			if(a.defaultTargetDepth != b.defaultTargetDepth
-			   || aFunction->branchTables[a.branchTableIndex]
-					  != bFunction->branchTables[b.branchTableIndex])
+			if(a.defaultTargetDepth != b.defaultTargetDepth || a.numTargetDepths != b.numTargetDepths
+			   || !std::equal(
+				   aFunction->branchTableTargetDepths.begin() + a.firstTargetDepthIndex,
+				   aFunction->branchTableTargetDepths.begin() + a.firstTargetDepthIndex
+					   + a.numTargetDepths,
+				   bFunction->branchTableTargetDepths.begin() + b.firstTargetDepthIndex))
 			{ failVerification(); }
 		}
 
@@ -276,15 +280,15 @@ namespace WAVM {
 				{
 #define VISIT_OPCODE(opcode, name, nameString, Imm, ...)                                           \
 	case Opcode::name: {                                                                           \
-		WAVM_ASSERT(aNextByte + sizeof(OpcodeAndImm<Imm>) <= aEnd);                                \
-		WAVM_ASSERT(bNextByte + sizeof(OpcodeAndImm<Imm>) <= bEnd);                                \
-		OpcodeAndImm<Imm> aEncodedOperator;                                                        \
-		OpcodeAndImm<Imm> bEncodedOperator;                                                        \
-		memcpy(&aEncodedOperator, aNextByte, sizeof(OpcodeAndImm<Imm>));                           \
-		memcpy(&bEncodedOperator, bNextByte, sizeof(OpcodeAndImm<Imm>));                           \
-		aNextByte += sizeof(OpcodeAndImm<Imm>);                                                    \
-		bNextByte += sizeof(OpcodeAndImm<Imm>);                                                    \
-		verifyMatches(aEncodedOperator.imm, bEncodedOperator.imm);                                 \
+		WAVM_ASSERT(aNextByte + sizeof(Opcode) + ImmEncoding<Imm>::numBytes <= aEnd);              \
+		WAVM_ASSERT(bNextByte + sizeof(Opcode) + ImmEncoding<Imm>::numBytes <= bEnd);              \
+		Imm aImm;                                                                                  \
+		Imm bImm;                                                                                  \
+		ImmEncoding<Imm>::decode(aNextByte + sizeof(Opcode), aImm);                                \
+		ImmEncoding<Imm>::decode(bNextByte + sizeof(Opcode), bImm);                                \
+		aNextByte += sizeof(Opcode) + ImmEncoding<Imm>::numBytes;                                  \
+		bNextByte += sizeof(Opcode) + ImmEncoding<Imm>::numBytes;                                  \
+		verifyMatches(aImm, bImm);                                                                 \
 		break;                                                                                     \
 	}
 					WAVM_ENUM_OPERATORS(VISIT_OPCODE)
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "FuzzTargetCommonMain.h"
+#include "WAVM/IR/FeatureSpec.h"
+#include "WAVM/IR/Module.h"
+#include "WAVM/Inline/BasicTypes.h"
+#include "WAVM/Inline/Config.h"
+#include "WAVM/Inline/Errors.h"
+#include "WAVM/Inline/Timing.h"
+#include "WAVM/LLVMJIT/LLVMJIT.h"
+#include "WAVM/Logging/Logging.h"
+#include "WAVM/Platform/Memory.h"
+#include "WAVM/WASM/WASM.h"
+
+using namespace WAVM;
+using namespace WAVM::IR;
+
+// Compiles each input module, and reports it as a finding if the time or memory used to compile
+// it exceeds a budget that grows linearly with the size of the input. Inputs that exceed it are
+// likely to hit a part of the compiler that is superlinear in some property of the module: huge
+// br_tables, deeply nested control structures, giant functions, etc.
+//
+// The budget is a fixed base plus an amount per KiB of input, and may be overridden by these
+// environment variables:
+//   WAVM_FUZZ_COMPILE_BASE_MS         (default 2000)
+//   WAVM_FUZZ_COMPILE_MS_PER_KIB      (default 500)
+//   WAVM_FUZZ_COMPILE_BASE_MIB        (default 512)
+//   WAVM_FUZZ_COMPILE_MIB_PER_KIB     (default 32)
+// The compile runs on the calling thread, so the time isn't affected by how many threads the
+// compiler would otherwise use.
+
+static U64 getBudgetParameter(const char* name, U64 defaultValue)
+{
+	const char* string = getenv(name);
+	if(!string || !*string) { return defaultValue; }
+
+	char* end = nullptr;
+	const U64 value = strtoull(string, &end, 10);
+	if(*end) { Errors::fatalf("%s must be an unsigned integer, but is '%s'.", name, string); }
+	return value;
+}
+
+struct CompileBudget
+{
+	F64 baseMilliseconds;
+	F64 millisecondsPerKiB;
+	U64 baseBytes;
+	U64 bytesPerKiB;
+
+	CompileBudget()
+	: baseMilliseconds(F64(getBudgetParameter("WAVM_FUZZ_COMPILE_BASE_MS", 2000)))
+	, millisecondsPerKiB(F64(getBudgetParameter("WAVM_FUZZ_COMPILE_MS_PER_KIB", 500)))
+	, baseBytes(getBudgetParameter("WAVM_FUZZ_COMPILE_BASE_MIB", 512) * 1024 * 1024)
+	, bytesPerKiB(getBudgetParameter("WAVM_FUZZ_COMPILE_MIB_PER_KIB", 32) * 1024 * 1024)
+	{
+	}
+
+	F64 getMilliseconds(Uptr numInputBytes) const
+	{
+		return baseMilliseconds + millisecondsPerKiB * F64(numInputBytes) / 1024.0;
+	}
+
+	U64 getBytes(Uptr numInputBytes) const
+	{
+		return baseBytes + bytesPerKiB * U64(numInputBytes) / 1024;
+	}
+};
+
+// Logs the passes that took the most time to compile the module, to point at the part of the
+// compiler that was superlinear.
+static void logSlowestPasses(LLVMJIT::CompileTimeReport& timeReport)
+{
+	Log::printf(Log::error,
+				"  emit IR: %.1fms, optimize: %.1fms, codegen: %.1fms\n",
+				F64(timeReport.emitIRNanoseconds) / 1000000.0,
+				F64(timeReport.optimizeNanoseconds) / 1000000.0,
+				F64(timeReport.codegenNanoseconds) / 1000000.0);
+
+	std::sort(timeReport.passTimes.begin(),
+			  timeReport.passTimes.end(),
+			  [](const LLVMJIT::CompileTimeReport::PassTime& a,
+				 const LLVMJIT::CompileTimeReport::PassTime& b) {
+				  return a.nanoseconds > b.nanoseconds;
+			  });
+	const Uptr numLoggedPasses = std::min(timeReport.passTimes.size(), Uptr(5));
+	for(Uptr passIndex = 0; passIndex < numLoggedPasses; ++passIndex)
+	{
+		const LLVMJIT::CompileTimeReport::PassTime& passTime = timeReport.passTimes[passIndex];
+		Log::printf(Log::error,
+					"  %s: %.1fms\n",
+					passTime.name.c_str(),
+					F64(passTime.nanoseconds) / 1000000.0);
+	}
+}
+
+extern "C" I32 LLVMFuzzerTestOneInput(const U8* data, Uptr numBytes)
+{
+	static const CompileBudget budget;
+	static const LLVMJIT::TargetSpec targetSpec = LLVMJIT::getHostTargetSpec();
+
+	IR::Module module(FeatureLevel::wavm);
+	module.featureSpec.maxLabelsPerFunction = 65536;
+	module.featureSpec.maxLocals = 1024;
+	module.featureSpec.maxDataSegments = 65536;
+	if(!WASM::loadBinaryModule(data, numBytes, module)) { return 0; }
+	if(LLVMJIT::validateTarget(targetSpec, module.featureSpec)
+	   != LLVMJIT::TargetValidationResult::valid)
+	{ return 0; }
+
+	LLVMJIT::CompileOptions compileOptions;
+	compileOptions.numPartitions = 1;
+
+	// The process's peak memory usage only increases, so only an input that raises it can be
+	// blamed for it: the memory it used is compared to the peak before the first input.
+	static const Uptr baselinePeakMemoryBytes = Platform::getPeakMemoryUsageBytes();
+	const Uptr peakMemoryBytesBefore = Platform::getPeakMemoryUsageBytes();
+
+	LLVMJIT::CompileTimeReport timeReport;
+	Timing::Timer timer;
+	std::vector<U8> objectCode
+		= LLVMJIT::compileModule(module, targetSpec, compileOptions, &timeReport);
+	timer.stop();
+
+	const Uptr peakMemoryBytesAfter = Platform::getPeakMemoryUsageBytes();
+	const U64 numMemoryBytes = peakMemoryBytesAfter - baselinePeakMemoryBytes;
+
+	const F64 milliseconds = timer.getMilliseconds();
+	const F64 budgetMilliseconds = budget.getMilliseconds(numBytes);
+	if(milliseconds > budgetMilliseconds)
+	{
+		Log::printf(Log::error,
+					"Compiling a %" WAVM_PRIuPTR " byte module took %.1fms, more than its budget"
+					" of %.1fms.\n",
+					numBytes,
+					milliseconds,
+					budgetMilliseconds);
+		logSlowestPasses(timeReport);
+		Errors::fatalf("Compile time exceeded the budget.");
+	}
+
+	const U64 budgetBytes = budget.getBytes(numBytes);
+	if(peakMemoryBytesAfter > peakMemoryBytesBefore && numMemoryBytes > budgetBytes)
+	{
+		Log::printf(Log::error,
+					"Compiling a %" WAVM_PRIuPTR " byte module used %" PRIu64
+					" MiB of memory, more than its budget of %" PRIu64 " MiB.\n",
+					numBytes,
+					numMemoryBytes / (1024 * 1024),
+					budgetBytes / (1024 * 1024));
+		logSlowestPasses(timeReport);
+		Errors::fatalf("Compile memory usage exceeded the budget.");
+	}
+
+	return 0;
+}
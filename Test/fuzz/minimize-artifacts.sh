@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# Usage:
+#  minimize-artifacts <fuzzer>
+#
+# Shrinks each crash found by a fuzzer to a smaller input that still crashes, and writes it next
+# to the original with a "minimized-" prefix.
+
+set -e
+
+BUILD_DIR=$(pwd)
+FUZZER=$1
+SECONDS_PER_ARTIFACT=600 # 10 minutes
+
+cd $BUILD_DIR
+
+for ARTIFACT in artifacts/${FUZZER}/crash-*; do
+	[ -f "$ARTIFACT" ] || continue
+	bin/fuzz-${FUZZER} \
+		"$ARTIFACT" \
+		-minimize_crash=1 \
+		-max_total_time=$SECONDS_PER_ARTIFACT \
+		-exact_artifact_path="artifacts/${FUZZER}/minimized-$(basename $ARTIFACT)" \
+		|| true
+done
@@ -35,3 +35,6 @@ bin/translate-compile-model-corpus \
 
 # Run the instantiate fuzzer.
 $SCRIPT_DIR/run-fuzz-instantiate.sh
+
+# Run the compile time fuzzer.
+$SCRIPT_DIR/run-fuzz-compile-time.sh
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+set -e
+
+BUILD_DIR=$(pwd)
+WAVM_DIR=$(cd `dirname $0`/../.. && pwd)
+SCRIPT_DIR=$WAVM_DIR/Test/fuzz
+
+SECONDS_PER_JOB=43200 # 12 hours
+
+mkdir -p wasm-seed-corpus
+mkdir -p translated-compile-model-corpus-wasm
+
+# Inputs that exceed the compile budget in fuzz-compile-time.cpp are reported as crashes, and a
+# compile that runs for much longer than any budget is reported as a timeout.
+$SCRIPT_DIR/run-fuzzer-and-reduce-corpus.sh compile-time \
+	wasm-seed-corpus \
+	translated-compile-model-corpus-wasm \
+	-max_total_time=$SECONDS_PER_JOB \
+	-max_len=20000 \
+	-timeout=120 \
+	-rss_limit_mb=8192
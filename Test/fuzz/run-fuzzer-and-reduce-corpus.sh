@@ -8,6 +8,12 @@ SCRIPT_DIR=$(cd `dirname $0` && pwd)
 $SCRIPT_DIR/run-fuzzer.sh ${@:1} || true
 $SCRIPT_DIR/reduce-corpus.sh ${@:1} || true
 
+# The compile-time fuzzer's findings are the inputs that are slow to compile, so shrink them to the
+# smallest input that is still over budget to make the superlinear part easier to see.
+if [ "$1" == "compile-time" ]; then
+	$SCRIPT_DIR/minimize-artifacts.sh $1 || true
+fi
+
 cd corpora
 git add *
 git commit --amend -m "Reinitialize" -q || true
@@ -663,3 +663,120 @@
 
 (assert_trap   (invoke "table.copy" (i32.const 0xffffffff) (i32.const 0) (i32.const 1)) "undefined element")
 (assert_trap   (invoke "table.copy" (i32.const 0) (i32.const 0xffffffff) (i32.const 1)) "undefined element")
+
+;; Active data segments with long runs of zeros
+
+(module
+	(memory (export "memory") 1)
+	(data (i32.const 0) "\01\02"
+		"\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00"
+		"\03")
+	(data (i32.const 200) "\04")
+	(data (i32.const 1) "\00\05"
+		"\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00"
+		"\06")
+
+	(func (export "load8_u") (param $address i32) (result i32)
+		(i32.load8_u (local.get $address))
+	)
+)
+
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 1)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 2)) (i32.const 5))
+(assert_return (invoke "load8_u" (i32.const 99)) (i32.const 6))
+(assert_return (invoke "load8_u" (i32.const 130)) (i32.const 3))
+(assert_return (invoke "load8_u" (i32.const 200)) (i32.const 4))
+
+(register "zeroSegments")
+
+(module
+	(import "zeroSegments" "memory" (memory 1))
+	(data (i32.const 0) "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00")
+
+	(func (export "load8_u") (param $address i32) (result i32)
+		(i32.load8_u (local.get $address))
+	)
+)
+
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 99)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 130)) (i32.const 3))
+
+(assert_trap
+	(module
+		(memory 1)
+		(data (i32.const 65500) "\01" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00" "\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00\00")
+	)
+	"out of bounds memory access"
+)
+
+;; memory.copy and memory.fill with short lengths that aren't constants, and copies and fills that
+;; are partly out of bounds, which must trap without writing anything.
+
+(module
+	(memory 1)
+	(data (i32.const 0) "\01\02\03\04\05\06\07\08\09\0a\0b\0c\0d\0e\0f\10\11\12\13\14")
+
+	(func (export "memory.copy") (param $dest i32) (param $source i32) (param $numBytes i32)
+		(memory.copy (local.get $dest) (local.get $source) (local.get $numBytes))
+	)
+	(func (export "memory.fill") (param $dest i32) (param $value i32) (param $numBytes i32)
+		(memory.fill (local.get $dest) (local.get $value) (local.get $numBytes))
+	)
+	(func (export "load8_u") (param $address i32) (result i32)
+		(i32.load8_u (local.get $address))
+	)
+	(func (export "load64") (param $address i32) (result i64)
+		(i64.load (local.get $address))
+	)
+)
+
+(invoke "memory.copy" (i32.const 100) (i32.const 0) (i32.const 11))
+(assert_return (invoke "load64" (i32.const 100)) (i64.const 0x0807060504030201))
+(assert_return (invoke "load64" (i32.const 103)) (i64.const 0x0b0a090807060504))
+(assert_return (invoke "load8_u" (i32.const 111)) (i32.const 0))
+
+(invoke "memory.copy" (i32.const 200) (i32.const 0) (i32.const 1))
+(invoke "memory.copy" (i32.const 201) (i32.const 0) (i32.const 0))
+(assert_return (invoke "load64" (i32.const 200)) (i64.const 0x01))
+
+;; Overlapping copies in both directions.
+(invoke "memory.copy" (i32.const 300) (i32.const 0) (i32.const 20))
+(invoke "memory.copy" (i32.const 302) (i32.const 300) (i32.const 16))
+(assert_return (invoke "load64" (i32.const 300)) (i64.const 0x0605040302010201))
+(assert_return (invoke "load64" (i32.const 308)) (i64.const 0x0e0d0c0b0a090807))
+(assert_return (invoke "load64" (i32.const 312)) (i64.const 0x1413100f0e0d0c0b))
+
+(invoke "memory.copy" (i32.const 400) (i32.const 0) (i32.const 20))
+(invoke "memory.copy" (i32.const 400) (i32.const 403) (i32.const 5))
+(assert_return (invoke "load64" (i32.const 400)) (i64.const 0x0807060807060504))
+
+(invoke "memory.fill" (i32.const 500) (i32.const 0xab) (i32.const 7))
+(assert_return (invoke "load64" (i32.const 500)) (i64.const 0x00ababababababab))
+(invoke "memory.fill" (i32.const 510) (i32.const 0x1cd) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 510)) (i32.const 0xcd))
+(assert_return (invoke "load8_u" (i32.const 511)) (i32.const 0xcd))
+(assert_return (invoke "load8_u" (i32.const 512)) (i32.const 0))
+
+;; Zero-length copies and fills at the end of memory don't trap.
+(invoke "memory.copy" (i32.const 65536) (i32.const 0) (i32.const 0))
+(invoke "memory.copy" (i32.const 0) (i32.const 65536) (i32.const 0))
+(invoke "memory.fill" (i32.const 65536) (i32.const 0xff) (i32.const 0))
+
+;; Copies and fills that overlap the end of memory trap, and leave the in-bounds bytes unchanged.
+(assert_trap (invoke "memory.copy" (i32.const 65528) (i32.const 0) (i32.const 9)) "out of bounds memory access")
+(assert_trap (invoke "memory.copy" (i32.const 65530) (i32.const 0) (i32.const 10)) "out of bounds memory access")
+(assert_trap (invoke "memory.copy" (i32.const 65000) (i32.const 0) (i32.const 4096)) "out of bounds memory access")
+(assert_return (invoke "load64" (i32.const 65528)) (i64.const 0))
+(assert_return (invoke "load8_u" (i32.const 65000)) (i32.const 0))
+
+(assert_trap (invoke "memory.copy" (i32.const 600) (i32.const 65530) (i32.const 10)) "out of bounds memory access")
+(assert_trap (invoke "memory.copy" (i32.const 600) (i32.const 65535) (i32.const 2)) "out of bounds memory access")
+(assert_return (invoke "load64" (i32.const 600)) (i64.const 0))
+
+(assert_trap (invoke "memory.fill" (i32.const 65535) (i32.const 0xff) (i32.const 2)) "out of bounds memory access")
+(assert_trap (invoke "memory.fill" (i32.const 65530) (i32.const 0xff) (i32.const 16)) "out of bounds memory access")
+(assert_trap (invoke "memory.fill" (i32.const 65000) (i32.const 0xff) (i32.const 4096)) "out of bounds memory access")
+(assert_return (invoke "load64" (i32.const 65528)) (i64.const 0))
+(assert_return (invoke "load8_u" (i32.const 65000)) (i32.const 0))
@@ -0,0 +1,62 @@
+;; Tests modules with a stack pointer global, which --cache-stack-pointer keeps in a variable while
+;; each function runs.
+
+;; A stack pointer identified by its name.
+(module
+  (global $__stack_pointer (mut i32) (i32.const 1024))
+  (memory 1)
+
+  (func (export "getStackPointer") (result i32) (global.get $__stack_pointer))
+
+  ;; Pushes n frames that each store their depth, and returns the sum of the stored depths, read
+  ;; back after the frames above them have been popped.
+  (func $sumFrames (export "sumFrames") (param $n i32) (result i32)
+    (local $frame i32)
+    (local $sum i32)
+    (global.set $__stack_pointer
+      (local.tee $frame (i32.sub (global.get $__stack_pointer) (i32.const 16))))
+    (i32.store (local.get $frame) (local.get $n))
+    (if (i32.gt_u (local.get $n) (i32.const 0))
+      (then (local.set $sum (call $sumFrames (i32.sub (local.get $n) (i32.const 1))))))
+    (if (i32.ne (global.get $__stack_pointer) (local.get $frame)) (then unreachable))
+    (local.set $sum (i32.add (local.get $sum) (i32.load (local.get $frame))))
+    (global.set $__stack_pointer (i32.add (local.get $frame) (i32.const 16)))
+    (local.get $sum)
+  )
+
+  ;; Traps with the stack pointer decremented by a call to unreachable, which writes it back.
+  (func (export "trapWithFrame")
+    (global.set $__stack_pointer (i32.sub (global.get $__stack_pointer) (i32.const 16)))
+    unreachable
+  )
+)
+
+(assert_return (invoke "getStackPointer") (i32.const 1024))
+(assert_return (invoke "sumFrames" (i32.const 10)) (i32.const 55))
+(assert_return (invoke "getStackPointer") (i32.const 1024))
+(assert_trap (invoke "trapWithFrame") "unreachable")
+(assert_return (invoke "getStackPointer") (i32.const 1008))
+
+;; A stack pointer identified by the prologue that allocates a frame from it.
+(module
+  (global (mut i64) (i64.const 4096))
+  (memory 1)
+
+  (func (export "getStackPointer") (result i64) (global.get 0))
+
+  (func $allocate (export "allocate") (param $numBytes i64) (result i64)
+    (global.set 0 (i64.sub (global.get 0) (local.get $numBytes)))
+    (global.get 0)
+  )
+
+  (func (export "allocateFrames") (result i64)
+    (local $frame i64)
+    (global.set 0 (local.tee $frame (i64.sub (global.get 0) (i64.const 32))))
+    (drop (call $allocate (i64.const 64)))
+    (drop (call $allocate (i64.const 64)))
+    (i64.sub (local.get $frame) (global.get 0))
+  )
+)
+
+(assert_return (invoke "allocateFrames") (i64.const 128))
+(assert_return (invoke "getStackPointer") (i64.const 3936))
@@ -0,0 +1,146 @@
+;; call_indirect through tables that can't change after instantiation
+
+(module
+	(type $i32_to_i32 (func (param i32) (result i32)))
+	(type $i32_to_i64 (func (param i32) (result i64)))
+	(type $i32_to_i32_i32 (func (param i32) (result i32 i32)))
+
+	(table $t 8 funcref)
+	(elem (table $t) (i32.const 0) func $inc $dec $wide $pair)
+	(elem (table $t) (i32.const 5) func $double)
+	(elem (table $t) (i32.const 1) func $negate)
+
+	(func $inc (type $i32_to_i32) (i32.add (local.get 0) (i32.const 1)))
+	(func $dec (type $i32_to_i32) (i32.sub (local.get 0) (i32.const 1)))
+	(func $negate (type $i32_to_i32) (i32.sub (i32.const 0) (local.get 0)))
+	(func $double (type $i32_to_i32) (i32.mul (local.get 0) (i32.const 2)))
+	(func $wide (type $i32_to_i64) (i64.extend_i32_s (local.get 0)))
+	(func $pair (type $i32_to_i32_i32) (local.get 0) (i32.add (local.get 0) (i32.const 1)))
+
+	(func (export "call_const_0") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 0)))
+	(func (export "call_const_1") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 1)))
+	(func (export "call_const_wrong_type") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 2)))
+	(func (export "call_const_null") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 4)))
+	(func (export "call_const_out_of_bounds") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 8)))
+
+	(func (export "call") (param i32 i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (local.get 1)))
+	(func (export "call_pair") (param i32 i32) (result i32 i32)
+		(call_indirect $t (type $i32_to_i32_i32) (local.get 0) (local.get 1)))
+)
+
+(assert_return (invoke "call_const_0" (i32.const 5)) (i32.const 6))
+(assert_return (invoke "call_const_1" (i32.const 5)) (i32.const -5))
+(assert_trap (invoke "call_const_wrong_type" (i32.const 5)) "indirect call type mismatch")
+(assert_trap (invoke "call_const_null" (i32.const 5)) "uninitialized element")
+(assert_trap (invoke "call_const_out_of_bounds" (i32.const 5)) "undefined element")
+
+(assert_return (invoke "call" (i32.const 5) (i32.const 0)) (i32.const 6))
+(assert_return (invoke "call" (i32.const 5) (i32.const 1)) (i32.const -5))
+(assert_return (invoke "call" (i32.const 5) (i32.const 5)) (i32.const 10))
+(assert_trap (invoke "call" (i32.const 5) (i32.const 2)) "indirect call type mismatch")
+(assert_trap (invoke "call" (i32.const 5) (i32.const 3)) "indirect call type mismatch")
+(assert_trap (invoke "call" (i32.const 5) (i32.const 4)) "uninitialized element")
+(assert_trap (invoke "call" (i32.const 5) (i32.const 8)) "undefined element")
+(assert_return (invoke "call_pair" (i32.const 5) (i32.const 3)) (i32.const 5) (i32.const 6))
+(assert_trap (invoke "call_pair" (i32.const 5) (i32.const 0)) "indirect call type mismatch")
+
+;; A table that is changed by the module's code can't be devirtualized.
+
+(module
+	(type $i32_to_i32 (func (param i32) (result i32)))
+
+	(table $t 2 funcref)
+	(elem (table $t) (i32.const 0) func $inc)
+	(elem declare func $dec)
+
+	(func $inc (type $i32_to_i32) (i32.add (local.get 0) (i32.const 1)))
+	(func $dec (type $i32_to_i32) (i32.sub (local.get 0) (i32.const 1)))
+
+	(func (export "set_dec") (table.set $t (i32.const 0) (ref.func $dec)))
+	(func (export "call_const_0") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 0)))
+	(func (export "call") (param i32 i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (local.get 1)))
+)
+
+(assert_return (invoke "call_const_0" (i32.const 5)) (i32.const 6))
+(assert_return (invoke "call" (i32.const 5) (i32.const 0)) (i32.const 6))
+(invoke "set_dec")
+(assert_return (invoke "call_const_0" (i32.const 5)) (i32.const 4))
+(assert_return (invoke "call" (i32.const 5) (i32.const 0)) (i32.const 4))
+
+;; An exported table may be changed by other modules.
+
+(module $exporter
+	(type $i32_to_i32 (func (param i32) (result i32)))
+
+	(table $t (export "table") 2 funcref)
+	(elem (table $t) (i32.const 0) func $inc)
+
+	(func $inc (type $i32_to_i32) (i32.add (local.get 0) (i32.const 1)))
+
+	(func (export "call_const_0") (param i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (i32.const 0)))
+)
+(register "exporter" $exporter)
+
+(module
+	(type $i32_to_i32 (func (param i32) (result i32)))
+	(import "exporter" "table" (table $t 2 funcref))
+	(elem (table $t) (i32.const 0) func $dec)
+	(func $dec (type $i32_to_i32) (i32.sub (local.get 0) (i32.const 1)))
+)
+
+(assert_return (invoke $exporter "call_const_0" (i32.const 5)) (i32.const 4))
+
+;; Table elements hold a tag derived from the function's type, so call_indirect can check the type
+;; without loading it from the function. Equivalent types declared by different modules have the
+;; same tag, and elements copied between tables keep their tags.
+
+(module $tagExporter
+	(type $i32_to_i32 (func (param i32) (result i32)))
+	(type $i64_to_i64 (func (param i64) (result i64)))
+
+	(table $t (export "table") 4 funcref)
+	(elem (table $t) (i32.const 0) func $inc $inc64)
+
+	(func $inc (type $i32_to_i32) (i32.add (local.get 0) (i32.const 1)))
+	(func $inc64 (type $i64_to_i64) (i64.add (local.get 0) (i64.const 1)))
+)
+(register "tagExporter" $tagExporter)
+
+(module
+	(type $i64_to_i64 (func (param i64) (result i64)))
+	(type $i32_to_i32 (func (param i32) (result i32)))
+	(import "tagExporter" "table" (table $t 4 funcref))
+	(table $u 4 funcref)
+
+	(func (export "copy") (table.copy $u $t (i32.const 0) (i32.const 0) (i32.const 4)))
+	(func (export "get_set") (table.set $t (i32.const 2) (table.get $t (i32.const 0))))
+	(func (export "call") (param i32 i32) (result i32)
+		(call_indirect $t (type $i32_to_i32) (local.get 0) (local.get 1)))
+	(func (export "call64") (param i64 i32) (result i64)
+		(call_indirect $t (type $i64_to_i64) (local.get 0) (local.get 1)))
+	(func (export "call_copy") (param i32 i32) (result i32)
+		(call_indirect $u (type $i32_to_i32) (local.get 0) (local.get 1)))
+)
+
+(assert_return (invoke "call" (i32.const 5) (i32.const 0)) (i32.const 6))
+(assert_return (invoke "call64" (i64.const 5) (i32.const 1)) (i64.const 6))
+(assert_trap (invoke "call" (i32.const 5) (i32.const 1)) "indirect call type mismatch")
+(assert_trap (invoke "call64" (i64.const 5) (i32.const 0)) "indirect call type mismatch")
+(assert_trap (invoke "call" (i32.const 5) (i32.const 2)) "uninitialized element")
+(assert_trap (invoke "call" (i32.const 5) (i32.const 4)) "undefined element")
+(invoke "get_set")
+(assert_return (invoke "call" (i32.const 7) (i32.const 2)) (i32.const 8))
+(invoke "copy")
+(assert_return (invoke "call_copy" (i32.const 7) (i32.const 0)) (i32.const 8))
+(assert_return (invoke "call_copy" (i32.const 7) (i32.const 2)) (i32.const 8))
+(assert_trap (invoke "call_copy" (i32.const 7) (i32.const 1)) "indirect call type mismatch")
+(assert_trap (invoke "call_copy" (i32.const 7) (i32.const 3)) "uninitialized element")
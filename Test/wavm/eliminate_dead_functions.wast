@@ -0,0 +1,70 @@
+;; Tests that --eliminate-dead-functions only replaces the functions that can't be called: those
+;; that are reachable only through an export, the start function, an elem segment, or a ref.func
+;; in a global initializer or in the code of another reachable function must still run.
+
+(module
+  (type $i32 (func (result i32)))
+  (table $t 5 funcref)
+  (global $startResult (mut i32) (i32.const 0))
+  (global $fromGlobal funcref (ref.func $fromGlobalInit))
+  (elem (i32.const 0) $fromActiveElem)
+  (elem (i32.const 4) funcref (ref.func $fromElemExpr))
+  (elem $passive func $fromPassiveElem)
+  (elem declare func $fromRefFunc)
+
+  (func $start (global.set $startResult (call $calledByStart)))
+  (func $calledByStart (result i32) (i32.const 1))
+  (start $start)
+
+  (func $fromActiveElem (type $i32) (i32.const 2))
+  (func $fromElemExpr (type $i32) (i32.const 3))
+  (func $fromPassiveElem (type $i32) (i32.const 4))
+  (func $fromRefFunc (type $i32) (i32.const 5))
+  (func $fromGlobalInit (type $i32) (i32.const 6))
+  (func $calledByExport (result i32) (call $calledTransitively))
+  (func $calledTransitively (result i32) (i32.const 7))
+
+  ;; Nothing can call these, so they are compiled as stubs.
+  (func $dead (result i32) (call $calledByDead))
+  (func $calledByDead (result i32) (i32.const 8))
+
+  (func (export "getStartResult") (result i32) (global.get $startResult))
+  (func (export "callActiveElem") (result i32) (call_indirect $t (type $i32) (i32.const 0)))
+  (func (export "callElemExpr") (result i32) (call_indirect $t (type $i32) (i32.const 4)))
+  (func (export "callPassiveElem") (result i32)
+    (table.init $t $passive (i32.const 1) (i32.const 0) (i32.const 1))
+    (call_indirect $t (type $i32) (i32.const 1)))
+  (func (export "callRefFunc") (result i32)
+    (table.set $t (i32.const 2) (ref.func $fromRefFunc))
+    (call_indirect $t (type $i32) (i32.const 2)))
+  (func (export "callGlobalInit") (result i32)
+    (table.set $t (i32.const 3) (global.get $fromGlobal))
+    (call_indirect $t (type $i32) (i32.const 3)))
+  (func (export "callDirect") (result i32) (call $calledByExport))
+  (func (export "exported") (result i32) (i32.const 9))
+)
+
+(assert_return (invoke "getStartResult") (i32.const 1))
+(assert_return (invoke "callActiveElem") (i32.const 2))
+(assert_return (invoke "callElemExpr") (i32.const 3))
+(assert_return (invoke "callPassiveElem") (i32.const 4))
+(assert_return (invoke "callRefFunc") (i32.const 5))
+(assert_return (invoke "callGlobalInit") (i32.const 6))
+(assert_return (invoke "callDirect") (i32.const 7))
+(assert_return (invoke "exported") (i32.const 9))
+
+;; A function that is only referenced by an exported table's elem segment can be called by another
+;; module that imports the table.
+(module
+  (table (export "table") 1 funcref)
+  (elem (i32.const 0) $onlyInTable)
+  (func $onlyInTable (result i32) (i32.const 10))
+)
+(register "tableExporter")
+
+(module
+  (type $i32 (func (result i32)))
+  (import "tableExporter" "table" (table $t 1 funcref))
+  (func (export "callImportedTable") (result i32) (call_indirect $t (type $i32) (i32.const 0)))
+)
+(assert_return (invoke "callImportedTable") (i32.const 10))
@@ -0,0 +1,310 @@
+;; Tests for the interpreter, which are also run with compiled code.
+
+;; Branches that discard operands below the values they keep
+
+(module
+	(func (export "br_discard") (param i32) (result i32)
+		(i32.const 100)
+		(block (result i32)
+			(i32.const 1)
+			(i32.const 2)
+			(block (result i32)
+				(i32.const 3)
+				(i32.const 4)
+				(br_if 1 (local.get 0) (i32.const 10) (local.get 0))
+				(drop)
+				(drop)
+				(drop)
+			)
+			(drop)
+			(drop)
+		)
+		(i32.add)
+	)
+
+	(func (export "br_table") (param i32) (result i32)
+		(block (result i32)
+			(block (result i32)
+				(block (result i32)
+					(i32.const 7)
+					(i32.const 10)
+					(local.get 0)
+					(br_table 0 1 2)
+				)
+				(i32.const 1)
+				(i32.add)
+			)
+			(i32.const 2)
+			(i32.add)
+		)
+	)
+
+	(func (export "br_function") (param i32) (result i32 i32)
+		(i32.const 1)
+		(i32.const 2)
+		(i32.const 3)
+		(br_if 0 (local.get 0) (i32.const 4) (local.get 0))
+		(drop)
+		(drop)
+		(drop)
+		(drop)
+		(i32.const 5)
+	)
+
+	(func (export "if_else") (param i32) (result i32)
+		(i32.const 10)
+		(if (param i32) (result i32) (local.get 0)
+			(then (i32.const 1) (i32.add))
+			(else (i32.const 2) (i32.mul))
+		)
+	)
+
+	(func (export "if_without_else") (param i32) (result i32)
+		(local i32)
+		(if (local.get 0) (then (local.set 1 (i32.const 5))))
+		(local.get 1)
+	)
+
+	(func (export "unreachable_code") (param i32) (result i32)
+		(block (result i32)
+			(br 0 (local.get 0))
+			(i32.add)
+			(br_table 0 0)
+		)
+	)
+)
+
+(assert_return (invoke "br_discard" (i32.const 1)) (i32.const 110))
+(assert_return (invoke "br_discard" (i32.const 0)) (i32.const 101))
+(assert_return (invoke "br_table" (i32.const 0)) (i32.const 13))
+(assert_return (invoke "br_table" (i32.const 1)) (i32.const 12))
+(assert_return (invoke "br_table" (i32.const 2)) (i32.const 10))
+(assert_return (invoke "br_table" (i32.const 100)) (i32.const 10))
+(assert_return (invoke "br_function" (i32.const 1)) (i32.const 1) (i32.const 4))
+(assert_return (invoke "br_function" (i32.const 0)) (i32.const 1) (i32.const 5))
+(assert_return (invoke "if_else" (i32.const 1)) (i32.const 11))
+(assert_return (invoke "if_else" (i32.const 0)) (i32.const 20))
+(assert_return (invoke "if_without_else" (i32.const 1)) (i32.const 5))
+(assert_return (invoke "if_without_else" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "unreachable_code" (i32.const 3)) (i32.const 3))
+
+;; Loops, locals, and calls
+
+(module
+	(func $sum (export "sum") (param i32) (result i64)
+		(local i64)
+		(block
+			(loop
+				(br_if 1 (i32.eqz (local.get 0)))
+				(local.set 1 (i64.add (local.get 1) (i64.extend_i32_u (local.get 0))))
+				(local.set 0 (i32.sub (local.get 0) (i32.const 1)))
+				(br 0)
+			)
+		)
+		(local.get 1)
+	)
+
+	(func (export "loop_params") (param i32) (result i32)
+		(i32.const 0)
+		(local.get 0)
+		(loop (param i32 i32) (result i32)
+			(local.set 0)
+			(i32.add (local.get 0))
+			(local.tee 0 (i32.sub (local.get 0) (i32.const 1)))
+			(br_if 0 (local.get 0))
+			(drop)
+		)
+	)
+
+	(func $fib (export "fib") (param i32) (result i32)
+		(if (result i32) (i32.lt_u (local.get 0) (i32.const 2))
+			(then (local.get 0))
+			(else
+				(i32.add
+					(call $fib (i32.sub (local.get 0) (i32.const 1)))
+					(call $fib (i32.sub (local.get 0) (i32.const 2)))
+				)
+			)
+		)
+	)
+
+	(func $swap (param i32 i32) (result i32 i32) (local.get 1) (local.get 0))
+	(func (export "call_multi_value") (result i32)
+		(call $swap (i32.const 3) (i32.const 10))
+		(i32.sub)
+	)
+
+	(func $recurse (export "recurse") (param i64) (result i64)
+		(i64.add (call $recurse (i64.add (local.get 0) (i64.const 1))) (i64.const 1))
+	)
+)
+
+(assert_return (invoke "sum" (i32.const 100000)) (i64.const 5000050000))
+(assert_return (invoke "loop_params" (i32.const 10)) (i32.const 55))
+(assert_return (invoke "fib" (i32.const 20)) (i32.const 6765))
+(assert_return (invoke "call_multi_value") (i32.const 7))
+(assert_exhaustion (invoke "recurse" (i64.const 0)) "call stack exhausted")
+
+;; Traps
+
+(module
+	(func (export "unreachable") (unreachable))
+	(func (export "div_s") (param i32 i32) (result i32) (i32.div_s (local.get 0) (local.get 1)))
+	(func (export "rem_s") (param i64 i64) (result i64) (i64.rem_s (local.get 0) (local.get 1)))
+	(func (export "trunc_f32_s") (param f32) (result i32) (i32.trunc_f32_s (local.get 0)))
+	(func (export "trunc_f64_u") (param f64) (result i64) (i64.trunc_f64_u (local.get 0)))
+	(func (export "trunc_sat_f64_s") (param f64) (result i32) (i32.trunc_sat_f64_s (local.get 0)))
+)
+
+(assert_trap (invoke "unreachable") "unreachable")
+(assert_trap (invoke "div_s" (i32.const 1) (i32.const 0)) "integer divide by zero")
+(assert_trap (invoke "div_s" (i32.const 0x80000000) (i32.const -1)) "integer overflow")
+(assert_return (invoke "rem_s" (i64.const 0x8000000000000000) (i64.const -1)) (i64.const 0))
+(assert_return (invoke "rem_s" (i64.const -7) (i64.const 2)) (i64.const -1))
+(assert_return (invoke "trunc_f32_s" (f32.const -2147483648.0)) (i32.const -2147483648))
+(assert_trap (invoke "trunc_f32_s" (f32.const 2147483648.0)) "integer overflow")
+(assert_trap (invoke "trunc_f32_s" (f32.const nan)) "invalid conversion to integer")
+(assert_return (invoke "trunc_f64_u" (f64.const -0.9)) (i64.const 0))
+(assert_return (invoke "trunc_f64_u" (f64.const 18446744073709549568.0))
+	(i64.const -2048))
+(assert_trap (invoke "trunc_f64_u" (f64.const 18446744073709551616.0)) "integer overflow")
+(assert_return (invoke "trunc_sat_f64_s" (f64.const 1e10)) (i32.const 2147483647))
+(assert_return (invoke "trunc_sat_f64_s" (f64.const -1e10)) (i32.const -2147483648))
+(assert_return (invoke "trunc_sat_f64_s" (f64.const nan)) (i32.const 0))
+
+;; Float operators that depend on the sign and NaN bits
+
+(module
+	(func (export "f32_min") (param f32 f32) (result f32) (f32.min (local.get 0) (local.get 1)))
+	(func (export "f64_max") (param f64 f64) (result f64) (f64.max (local.get 0) (local.get 1)))
+	(func (export "f32_neg") (param f32) (result f32) (f32.neg (local.get 0)))
+	(func (export "f64_copysign") (param f64 f64) (result f64)
+		(f64.copysign (local.get 0) (local.get 1))
+	)
+	(func (export "f32_nearest") (param f32) (result f32) (f32.nearest (local.get 0)))
+)
+
+(assert_return (invoke "f32_min" (f32.const 0.0) (f32.const -0.0)) (f32.const -0.0))
+(assert_return (invoke "f32_min" (f32.const nan) (f32.const 1.0)) (f32.const nan:arithmetic))
+(assert_return (invoke "f64_max" (f64.const -0.0) (f64.const 0.0)) (f64.const 0.0))
+(assert_return (invoke "f64_max" (f64.const -1.0) (f64.const 2.0)) (f64.const 2.0))
+(assert_return (invoke "f32_neg" (f32.const nan:0x200000)) (f32.const -nan:0x200000))
+(assert_return (invoke "f64_copysign" (f64.const 1.5) (f64.const -0.0)) (f64.const -1.5))
+(assert_return (invoke "f32_nearest" (f32.const 2.5)) (f32.const 2.0))
+(assert_return (invoke "f32_nearest" (f32.const -3.5)) (f32.const -4.0))
+
+;; Memories, globals, and tables
+
+(module
+	(memory 1 2)
+	(global $counter (mut i32) (i32.const 0))
+	(global $step i32 (i32.const 3))
+	(table $t 2 funcref)
+	(elem (table $t) (i32.const 0) func $three)
+
+	(type $none_to_i32 (func (result i32)))
+	(func $three (type $none_to_i32) (i32.const 3))
+
+	(func (export "store_load") (param i32 i64) (result i64)
+		(i64.store offset=4 (local.get 0) (local.get 1))
+		(i64.load32_s offset=4 (local.get 0))
+	)
+	(func (export "load8_u") (param i32) (result i32) (i32.load8_u (local.get 0)))
+	(func (export "grow") (param i32) (result i32) (memory.grow (local.get 0)))
+	(func (export "size") (result i32) (memory.size))
+	(func (export "fill_copy") (result i32)
+		(memory.fill (i32.const 16) (i32.const 0xab) (i32.const 4))
+		(memory.copy (i32.const 18) (i32.const 16) (i32.const 4))
+		(i32.load (i32.const 18))
+	)
+
+	(func (export "count") (result i32)
+		(global.set $counter (i32.add (global.get $counter) (global.get $step)))
+		(global.get $counter)
+	)
+
+	(func (export "call_indirect") (param i32) (result i32)
+		(call_indirect $t (type $none_to_i32) (local.get 0))
+	)
+	(func (export "table_grow") (result i32)
+		(table.grow $t (ref.func $three) (i32.const 1))
+	)
+	(func (export "table_get_is_null") (param i32) (result i32)
+		(ref.is_null (table.get $t (local.get 0)))
+	)
+	(func (export "select") (param i32) (result i32)
+		(select (i32.const 1) (i32.const 2) (local.get 0))
+	)
+)
+
+(assert_return (invoke "store_load" (i32.const 0) (i64.const -2)) (i64.const -2))
+(assert_return (invoke "load8_u" (i32.const 4)) (i32.const 0xfe))
+(assert_return (invoke "store_load" (i32.const 65524) (i64.const 1)) (i64.const 1))
+(assert_trap (invoke "store_load" (i32.const 65525) (i64.const 1)) "out of bounds memory access")
+(assert_trap (invoke "load8_u" (i32.const 65536)) "out of bounds memory access")
+(assert_trap (invoke "load8_u" (i32.const -1)) "out of bounds memory access")
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 65536)) (i32.const 0))
+(assert_return (invoke "grow" (i32.const 1)) (i32.const -1))
+(assert_return (invoke "size") (i32.const 2))
+(assert_return (invoke "fill_copy") (i32.const 0xabababab))
+(assert_return (invoke "count") (i32.const 3))
+(assert_return (invoke "count") (i32.const 6))
+(assert_return (invoke "call_indirect" (i32.const 0)) (i32.const 3))
+(assert_trap (invoke "call_indirect" (i32.const 1)) "uninitialized element")
+(assert_trap (invoke "call_indirect" (i32.const 2)) "undefined element")
+(assert_return (invoke "table_get_is_null" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "table_grow") (i32.const 2))
+(assert_return (invoke "call_indirect" (i32.const 2)) (i32.const 3))
+(assert_return (invoke "select" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "select" (i32.const 0)) (i32.const 2))
+
+;; Calls between interpreted code and the compiled code of modules that use other features
+
+(module $compiled
+	(func (export "splat_sum") (param i32) (result i32)
+		(i32x4.extract_lane 3 (i32x4.add (i32x4.splat (local.get 0)) (i32x4.splat (i32.const 1))))
+	)
+)
+(register "compiled" $compiled)
+
+(module
+	(import "compiled" "splat_sum" (func $splat_sum (param i32) (result i32)))
+	(func (export "call_compiled") (param i32) (result i32)
+		(i32.mul (call $splat_sum (local.get 0)) (i32.const 2))
+	)
+)
+
+(assert_return (invoke "call_compiled" (i32.const 20)) (i32.const 42))
+
+;; Compiled code calls interpreted functions that it imports, or that are in tables it shares.
+
+(module $interpreted
+	(table (export "table") 2 funcref)
+	(elem (i32.const 0) $add)
+	(func $add (export "add") (param i32 i32) (result i32) (i32.add (local.get 0) (local.get 1)))
+	(func (export "set_mul") (table.set (i32.const 1) (ref.func $mul)))
+	(func $mul (param i32 i32) (result i32) (i32.mul (local.get 0) (local.get 1)))
+	(elem declare func $mul)
+)
+(register "interpreted" $interpreted)
+
+(module
+	(import "interpreted" "add" (func $add (param i32 i32) (result i32)))
+	(import "interpreted" "table" (table 2 funcref))
+	(type $binary (func (param i32 i32) (result i32)))
+	(func (export "call_interpreted") (param i32) (result i32)
+		(i32x4.extract_lane 0 (i32x4.splat (call $add (local.get 0) (i32.const 1))))
+	)
+	(func (export "call_indirect_interpreted") (param i32 i32) (result i32)
+		(i32x4.extract_lane 0 (i32x4.splat
+			(call_indirect (type $binary) (local.get 1) (i32.const 6) (local.get 0))))
+	)
+)
+
+(assert_return (invoke "call_interpreted" (i32.const 41)) (i32.const 42))
+(assert_return (invoke "call_indirect_interpreted" (i32.const 0) (i32.const 36)) (i32.const 42))
+(assert_trap (invoke "call_indirect_interpreted" (i32.const 1) (i32.const 7))
+	"uninitialized element")
+(invoke $interpreted "set_mul")
+(assert_return (invoke "call_indirect_interpreted" (i32.const 1) (i32.const 7)) (i32.const 42))
@@ -0,0 +1,111 @@
+;; Bounds checks that are eliminated or reused for memory64 loads and stores
+
+(module
+	(memory i64 1)
+
+	(func (export "const_in_bounds") (result i32)
+		(i32.store (i64.const 65532) (i32.const 7))
+		(i32.load (i64.const 65532)))
+	(func (export "const_out_of_bounds") (result i32)
+		(i32.load (i64.const 65533)))
+	(func (export "const_offset_out_of_bounds") (result i32)
+		(i32.load offset=65532 (i64.const 1)))
+
+	(func (export "reuse_local") (param $a i64) (result i32)
+		(i32.store (local.get $a) (i32.const 1))
+		(i32.store offset=4 (local.get $a) (i32.const 2))
+		(i32.add (i32.load (local.get $a)) (i32.load offset=4 (local.get $a))))
+
+	(func (export "reuse_local_across_trap") (param $a i64) (param $b i32) (result i32)
+		(i32.store (local.get $a) (i32.const 12))
+		(i32.store offset=4 (local.get $a) (i32.div_u (i32.load (local.get $a)) (local.get $b)))
+		(i32.load offset=4 (local.get $a)))
+
+	(func (export "set_local_between") (param $a i64) (param $b i64) (result i32)
+		(i32.store (local.get $a) (i32.const 1))
+		(local.set $a (local.get $b))
+		(i32.load (local.get $a)))
+
+	(func (export "grow_between") (param $a i64) (result i32)
+		(i32.store (i64.const 0) (i32.load8_u (i64.sub (local.get $a) (i64.const 65536))))
+		(drop (memory.grow (i64.const 1)))
+		(i32.store (local.get $a) (i32.const 3))
+		(i32.load (local.get $a)))
+)
+
+(assert_return (invoke "const_in_bounds") (i32.const 7))
+(assert_trap (invoke "const_out_of_bounds") "out of bounds memory access")
+(assert_trap (invoke "const_offset_out_of_bounds") "out of bounds memory access")
+
+(assert_return (invoke "reuse_local" (i64.const 0)) (i32.const 3))
+(assert_trap (invoke "reuse_local" (i64.const 65533)) "out of bounds memory access")
+
+(assert_return (invoke "reuse_local_across_trap" (i64.const 0) (i32.const 3)) (i32.const 4))
+(assert_trap (invoke "reuse_local_across_trap" (i64.const 0) (i32.const 0)) "integer divide by zero")
+(assert_trap (invoke "reuse_local_across_trap" (i64.const 65529) (i32.const 3)) "out of bounds memory access")
+
+(assert_return (invoke "set_local_between" (i64.const 0) (i64.const 65532)) (i32.const 7))
+(assert_trap (invoke "set_local_between" (i64.const 0) (i64.const 65536)) "out of bounds memory access")
+
+(assert_return (invoke "grow_between" (i64.const 65536)) (i32.const 3))
+(assert_return (invoke "grow_between" (i64.const 131072)) (i32.const 3))
+(assert_trap (invoke "grow_between" (i64.const 262144)) "out of bounds memory access")
+
+;; Addresses of memory64 memories with a small maximum size are clamped to a constant
+
+(module $small
+	(memory (export "memory") i64 1 2)
+
+	(func (export "load") (param $a i64) (result i32) (i32.load (local.get $a)))
+	(func (export "load_offset") (param $a i64) (result i32) (i32.load offset=65535 (local.get $a)))
+	(func (export "grow") (result i64) (memory.grow (i64.const 1)))
+)
+
+(assert_return (invoke "load" (i64.const 65532)) (i32.const 0))
+(assert_trap (invoke "load" (i64.const 65533)) "out of bounds memory access")
+(assert_trap (invoke "load" (i64.const 0x100000000)) "out of bounds memory access")
+(assert_trap (invoke "load" (i64.const 0x100010000)) "out of bounds memory access")
+(assert_trap (invoke "load" (i64.const -1)) "out of bounds memory access")
+(assert_trap (invoke "load_offset" (i64.const 0xFFFFFFFF)) "out of bounds memory access")
+(assert_trap (invoke "load_offset" (i64.const -1)) "out of bounds memory access")
+(assert_return (invoke "grow") (i64.const 1))
+(assert_return (invoke "load" (i64.const 131068)) (i32.const 0))
+(assert_trap (invoke "load" (i64.const 131069)) "out of bounds memory access")
+
+(register "small" $small)
+
+(module
+	(import "small" "memory" (memory i64 1 65536))
+
+	(func (export "load") (param $a i64) (result i32) (i32.load (local.get $a)))
+)
+
+(assert_return (invoke "load" (i64.const 131068)) (i32.const 0))
+(assert_trap (invoke "load" (i64.const 131069)) "out of bounds memory access")
+(assert_trap (invoke "load" (i64.const 0x100000000)) "out of bounds memory access")
+
+;; Memories whose minimum and maximum sizes are equal have constant bounds, and can't grow
+
+(module
+	(memory $fixed64 i64 2 2)
+	(memory $fixed32 1 1)
+
+	(func (export "load64") (param $a i64) (result i32) (i32.load $fixed64 (local.get $a)))
+	(func (export "load32") (param $a i32) (result i32) (i32.load $fixed32 (local.get $a)))
+	(func (export "size64") (result i64) (memory.size $fixed64))
+	(func (export "grow64") (param $delta i64) (result i64)
+		(memory.grow $fixed64 (local.get $delta)))
+	(func (export "grow32") (param $delta i32) (result i32)
+		(memory.grow $fixed32 (local.get $delta)))
+)
+
+(assert_return (invoke "load64" (i64.const 131068)) (i32.const 0))
+(assert_trap (invoke "load64" (i64.const 131069)) "out of bounds memory access")
+(assert_trap (invoke "load64" (i64.const -1)) "out of bounds memory access")
+(assert_return (invoke "load32" (i32.const 65532)) (i32.const 0))
+(assert_trap (invoke "load32" (i32.const 65533)) "out of bounds memory access")
+(assert_return (invoke "size64") (i64.const 2))
+(assert_return (invoke "grow64" (i64.const 0)) (i64.const 2))
+(assert_return (invoke "grow64" (i64.const 1)) (i64.const -1))
+(assert_return (invoke "grow32" (i32.const 0)) (i32.const 1))
+(assert_return (invoke "grow32" (i32.const 1)) (i32.const -1))
@@ -0,0 +1,62 @@
+;; memory.discard
+
+(module
+	(memory 3)
+
+	(func (export "store") (param $address i32) (param $value i32)
+		(i32.store (local.get $address) (local.get $value)))
+	(func (export "load") (param $address i32) (result i32)
+		(i32.load (local.get $address)))
+	(func (export "discard") (param $address i32) (param $numBytes i32)
+		(memory.discard (local.get $address) (local.get $numBytes)))
+	(func (export "grow") (param $numPages i32) (result i32)
+		(memory.grow (local.get $numPages)))
+)
+
+(invoke "store" (i32.const 0) (i32.const 1))
+(invoke "store" (i32.const 65536) (i32.const 2))
+(invoke "store" (i32.const 131068) (i32.const 3))
+(invoke "store" (i32.const 131072) (i32.const 4))
+
+;; Discarding pages zeroes them, and leaves the other pages alone.
+(assert_return (invoke "discard" (i32.const 65536) (i32.const 65536)))
+(assert_return (invoke "load" (i32.const 0)) (i32.const 1))
+(assert_return (invoke "load" (i32.const 65536)) (i32.const 0))
+(assert_return (invoke "load" (i32.const 131068)) (i32.const 0))
+(assert_return (invoke "load" (i32.const 131072)) (i32.const 4))
+
+;; Discarded pages can be written again.
+(invoke "store" (i32.const 65540) (i32.const 5))
+(assert_return (invoke "load" (i32.const 65540)) (i32.const 5))
+
+;; Discarding no pages does nothing, even at the end of the memory.
+(assert_return (invoke "discard" (i32.const 196608) (i32.const 0)))
+(assert_return (invoke "load" (i32.const 131072)) (i32.const 4))
+
+;; The range must be whole pages inside the memory.
+(assert_trap (invoke "discard" (i32.const 1) (i32.const 65536)) "invalid argument")
+(assert_trap (invoke "discard" (i32.const 0) (i32.const 4096)) "invalid argument")
+(assert_trap (invoke "discard" (i32.const 131072) (i32.const 131072)) "out of bounds memory access")
+(assert_trap (invoke "discard" (i32.const 262144) (i32.const 0)) "out of bounds memory access")
+(assert_return (invoke "load" (i32.const 131072)) (i32.const 4))
+
+;; Pages added by memory.grow can be discarded.
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 3))
+(invoke "store" (i32.const 196608) (i32.const 6))
+(assert_return (invoke "discard" (i32.const 131072) (i32.const 131072)))
+(assert_return (invoke "load" (i32.const 131072)) (i32.const 0))
+(assert_return (invoke "load" (i32.const 196608)) (i32.const 0))
+(assert_return (invoke "load" (i32.const 0)) (i32.const 1))
+
+(module
+	(memory i64 1)
+	(func (export "discard") (param $address i64) (param $numBytes i64)
+		(memory.discard (local.get $address) (local.get $numBytes)))
+)
+
+(assert_return (invoke "discard" (i64.const 0) (i64.const 65536)))
+(assert_trap (invoke "discard" (i64.const 0x100000000) (i64.const 65536)) "out of bounds memory access")
+
+(assert_invalid
+	(module (func (memory.discard (i32.const 0) (i32.const 0))))
+	"unknown memory")
@@ -0,0 +1,72 @@
+;; Float operators compiled with --relaxed-nan. NaN results may have any payload, and min and max
+;; of zeros with different signs may return either zero, so only the results that are the same as
+;; with the default NaN semantics are tested.
+
+(module
+	(func (export "f32.add") (param f32 f32) (result f32) (f32.add (local.get 0) (local.get 1)))
+	(func (export "f32.sub") (param f32 f32) (result f32) (f32.sub (local.get 0) (local.get 1)))
+	(func (export "f32.mul") (param f32 f32) (result f32) (f32.mul (local.get 0) (local.get 1)))
+	(func (export "f32.div") (param f32 f32) (result f32) (f32.div (local.get 0) (local.get 1)))
+	(func (export "f32.sqrt") (param f32) (result f32) (f32.sqrt (local.get 0)))
+	(func (export "f32.min") (param f32 f32) (result f32) (f32.min (local.get 0) (local.get 1)))
+	(func (export "f32.max") (param f32 f32) (result f32) (f32.max (local.get 0) (local.get 1)))
+
+	(func (export "f64.add") (param f64 f64) (result f64) (f64.add (local.get 0) (local.get 1)))
+	(func (export "f64.div") (param f64 f64) (result f64) (f64.div (local.get 0) (local.get 1)))
+	(func (export "f64.min") (param f64 f64) (result f64) (f64.min (local.get 0) (local.get 1)))
+	(func (export "f64.max") (param f64 f64) (result f64) (f64.max (local.get 0) (local.get 1)))
+
+	(func (export "f32x4.min") (param v128 v128) (result v128)
+		(f32x4.min (local.get 0) (local.get 1)))
+	(func (export "f32x4.max") (param v128 v128) (result v128)
+		(f32x4.max (local.get 0) (local.get 1)))
+	(func (export "f64x2.min") (param v128 v128) (result v128)
+		(f64x2.min (local.get 0) (local.get 1)))
+	(func (export "f64x2.max") (param v128 v128) (result v128)
+		(f64x2.max (local.get 0) (local.get 1)))
+)
+
+(assert_return (invoke "f32.add" (f32.const 1.5) (f32.const 2.25)) (f32.const 3.75))
+(assert_return (invoke "f32.add" (f32.const nan) (f32.const 1)) (f32.const nan:arithmetic))
+(assert_return (invoke "f32.sub" (f32.const 1.5) (f32.const 2.25)) (f32.const -0.75))
+(assert_return (invoke "f32.mul" (f32.const 1.5) (f32.const -2)) (f32.const -3))
+(assert_return (invoke "f32.div" (f32.const 1) (f32.const 4)) (f32.const 0.25))
+(assert_return (invoke "f32.div" (f32.const 0) (f32.const 0)) (f32.const nan:arithmetic))
+(assert_return (invoke "f32.sqrt" (f32.const 16)) (f32.const 4))
+(assert_return (invoke "f32.sqrt" (f32.const -1)) (f32.const nan:arithmetic))
+
+(assert_return (invoke "f32.min" (f32.const 1) (f32.const 2)) (f32.const 1))
+(assert_return (invoke "f32.min" (f32.const 2) (f32.const 1)) (f32.const 1))
+(assert_return (invoke "f32.min" (f32.const -inf) (f32.const 0)) (f32.const -inf))
+(assert_return (invoke "f32.min" (f32.const nan) (f32.const 1)) (f32.const nan:arithmetic))
+(assert_return (invoke "f32.min" (f32.const 1) (f32.const nan)) (f32.const nan:arithmetic))
+(assert_return (invoke "f32.max" (f32.const 1) (f32.const 2)) (f32.const 2))
+(assert_return (invoke "f32.max" (f32.const 2) (f32.const 1)) (f32.const 2))
+(assert_return (invoke "f32.max" (f32.const inf) (f32.const 0)) (f32.const inf))
+(assert_return (invoke "f32.max" (f32.const nan) (f32.const 1)) (f32.const nan:arithmetic))
+(assert_return (invoke "f32.max" (f32.const 1) (f32.const nan)) (f32.const nan:arithmetic))
+
+(assert_return (invoke "f64.add" (f64.const 1.5) (f64.const 2.25)) (f64.const 3.75))
+(assert_return (invoke "f64.div" (f64.const 0) (f64.const 0)) (f64.const nan:arithmetic))
+(assert_return (invoke "f64.min" (f64.const -1) (f64.const 2)) (f64.const -1))
+(assert_return (invoke "f64.min" (f64.const nan) (f64.const 1)) (f64.const nan:arithmetic))
+(assert_return (invoke "f64.min" (f64.const 1) (f64.const nan)) (f64.const nan:arithmetic))
+(assert_return (invoke "f64.max" (f64.const -1) (f64.const 2)) (f64.const 2))
+(assert_return (invoke "f64.max" (f64.const nan) (f64.const 1)) (f64.const nan:arithmetic))
+(assert_return (invoke "f64.max" (f64.const 1) (f64.const nan)) (f64.const nan:arithmetic))
+
+(assert_return
+	(invoke "f32x4.min" (v128.const f32x4 1 4 nan 5) (v128.const f32x4 2 3 6 nan))
+	(v128.const f32x4 1 3 nan:arithmetic nan:arithmetic))
+(assert_return
+	(invoke "f32x4.max" (v128.const f32x4 1 4 nan 5) (v128.const f32x4 2 3 6 nan))
+	(v128.const f32x4 2 4 nan:arithmetic nan:arithmetic))
+(assert_return
+	(invoke "f64x2.min" (v128.const f64x2 nan 5) (v128.const f64x2 6 nan))
+	(v128.const f64x2 nan:arithmetic nan:arithmetic))
+(assert_return
+	(invoke "f64x2.min" (v128.const f64x2 1 4) (v128.const f64x2 2 3))
+	(v128.const f64x2 1 3))
+(assert_return
+	(invoke "f64x2.max" (v128.const f64x2 1 4) (v128.const f64x2 2 3))
+	(v128.const f64x2 2 4))
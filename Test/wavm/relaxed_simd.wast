@@ -0,0 +1,152 @@
+;; Relaxed SIMD operators, with inputs for which every permitted result is the same.
+
+(module
+	(func (export "i8x16.relaxed_swizzle") (param v128 v128) (result v128)
+		(i8x16.relaxed_swizzle (local.get 0) (local.get 1)))
+
+	(func (export "i32x4.relaxed_trunc_f32x4_s") (param v128) (result v128)
+		(i32x4.relaxed_trunc_f32x4_s (local.get 0)))
+	(func (export "i32x4.relaxed_trunc_f32x4_u") (param v128) (result v128)
+		(i32x4.relaxed_trunc_f32x4_u (local.get 0)))
+	(func (export "i32x4.relaxed_trunc_f64x2_s_zero") (param v128) (result v128)
+		(i32x4.relaxed_trunc_f64x2_s_zero (local.get 0)))
+	(func (export "i32x4.relaxed_trunc_f64x2_u_zero") (param v128) (result v128)
+		(i32x4.relaxed_trunc_f64x2_u_zero (local.get 0)))
+
+	(func (export "f32x4.relaxed_madd") (param v128 v128 v128) (result v128)
+		(f32x4.relaxed_madd (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "f32x4.relaxed_nmadd") (param v128 v128 v128) (result v128)
+		(f32x4.relaxed_nmadd (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "f64x2.relaxed_madd") (param v128 v128 v128) (result v128)
+		(f64x2.relaxed_madd (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "f64x2.relaxed_nmadd") (param v128 v128 v128) (result v128)
+		(f64x2.relaxed_nmadd (local.get 0) (local.get 1) (local.get 2)))
+
+	(func (export "i8x16.relaxed_laneselect") (param v128 v128 v128) (result v128)
+		(i8x16.relaxed_laneselect (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "i16x8.relaxed_laneselect") (param v128 v128 v128) (result v128)
+		(i16x8.relaxed_laneselect (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "i32x4.relaxed_laneselect") (param v128 v128 v128) (result v128)
+		(i32x4.relaxed_laneselect (local.get 0) (local.get 1) (local.get 2)))
+	(func (export "i64x2.relaxed_laneselect") (param v128 v128 v128) (result v128)
+		(i64x2.relaxed_laneselect (local.get 0) (local.get 1) (local.get 2)))
+
+	(func (export "f32x4.relaxed_min") (param v128 v128) (result v128)
+		(f32x4.relaxed_min (local.get 0) (local.get 1)))
+	(func (export "f32x4.relaxed_max") (param v128 v128) (result v128)
+		(f32x4.relaxed_max (local.get 0) (local.get 1)))
+	(func (export "f64x2.relaxed_min") (param v128 v128) (result v128)
+		(f64x2.relaxed_min (local.get 0) (local.get 1)))
+	(func (export "f64x2.relaxed_max") (param v128 v128) (result v128)
+		(f64x2.relaxed_max (local.get 0) (local.get 1)))
+
+	(func (export "i16x8.relaxed_q15mulr_s") (param v128 v128) (result v128)
+		(i16x8.relaxed_q15mulr_s (local.get 0) (local.get 1)))
+	(func (export "i16x8.relaxed_dot_i8x16_i7x16_s") (param v128 v128) (result v128)
+		(i16x8.relaxed_dot_i8x16_i7x16_s (local.get 0) (local.get 1)))
+	(func (export "i32x4.relaxed_dot_i8x16_i7x16_add_s") (param v128 v128 v128) (result v128)
+		(i32x4.relaxed_dot_i8x16_i7x16_add_s (local.get 0) (local.get 1) (local.get 2)))
+)
+
+;; Swizzle indices that are in range select the same lane on every target.
+(assert_return (invoke "i8x16.relaxed_swizzle"
+	(v128.const i8x16 0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15)
+	(v128.const i8x16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 0))
+	(v128.const i8x16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 0))
+
+;; Truncation of values that fit in the result type.
+(assert_return (invoke "i32x4.relaxed_trunc_f32x4_s" (v128.const f32x4 1.5 -1.5 100.9 -0.5))
+	(v128.const i32x4 1 -1 100 0))
+(assert_return (invoke "i32x4.relaxed_trunc_f32x4_u" (v128.const f32x4 1.5 0.5 100.9 3e9))
+	(v128.const i32x4 1 0 100 3000000000))
+(assert_return (invoke "i32x4.relaxed_trunc_f64x2_s_zero" (v128.const f64x2 -2.5 7.9))
+	(v128.const i32x4 -2 7 0 0))
+(assert_return (invoke "i32x4.relaxed_trunc_f64x2_u_zero" (v128.const f64x2 2.5 4e9))
+	(v128.const i32x4 2 4000000000 0 0))
+
+;; Multiply-adds whose products are exact, so fusing them doesn't change the result.
+(assert_return (invoke "f32x4.relaxed_madd"
+	(v128.const f32x4 1 2 3 4) (v128.const f32x4 5 6 7 8) (v128.const f32x4 1 1 1 1))
+	(v128.const f32x4 6 13 22 33))
+(assert_return (invoke "f32x4.relaxed_nmadd"
+	(v128.const f32x4 1 2 3 4) (v128.const f32x4 5 6 7 8) (v128.const f32x4 1 1 1 1))
+	(v128.const f32x4 -4 -11 -20 -31))
+(assert_return (invoke "f64x2.relaxed_madd"
+	(v128.const f64x2 1.5 -2) (v128.const f64x2 4 3) (v128.const f64x2 0.5 10))
+	(v128.const f64x2 6.5 4))
+(assert_return (invoke "f64x2.relaxed_nmadd"
+	(v128.const f64x2 1.5 -2) (v128.const f64x2 4 3) (v128.const f64x2 0.5 10))
+	(v128.const f64x2 -5.5 16))
+
+;; Masks whose lanes are all ones or all zeros select whole lanes on every target.
+(assert_return (invoke "i8x16.relaxed_laneselect"
+	(v128.const i8x16 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16)
+	(v128.const i8x16 -1 -2 -3 -4 -5 -6 -7 -8 -9 -10 -11 -12 -13 -14 -15 -16)
+	(v128.const i8x16 -1 0 -1 0 -1 0 -1 0 0 -1 0 -1 0 -1 0 -1))
+	(v128.const i8x16 1 -2 3 -4 5 -6 7 -8 -9 10 -11 12 -13 14 -15 16))
+(assert_return (invoke "i16x8.relaxed_laneselect"
+	(v128.const i16x8 1 2 3 4 5 6 7 8)
+	(v128.const i16x8 -1 -2 -3 -4 -5 -6 -7 -8)
+	(v128.const i16x8 -1 0 0 -1 -1 0 0 -1))
+	(v128.const i16x8 1 -2 -3 4 5 -6 -7 8))
+(assert_return (invoke "i32x4.relaxed_laneselect"
+	(v128.const i32x4 1 2 3 4)
+	(v128.const i32x4 -1 -2 -3 -4)
+	(v128.const i32x4 0 -1 -1 0))
+	(v128.const i32x4 -1 2 3 -4))
+(assert_return (invoke "i64x2.relaxed_laneselect"
+	(v128.const i64x2 1 2)
+	(v128.const i64x2 -1 -2)
+	(v128.const i64x2 -1 0))
+	(v128.const i64x2 1 -2))
+
+;; Min and max of ordered, distinct values.
+(assert_return (invoke "f32x4.relaxed_min"
+	(v128.const f32x4 1 -2 3 -4) (v128.const f32x4 -1 2 -3 4))
+	(v128.const f32x4 -1 -2 -3 -4))
+(assert_return (invoke "f32x4.relaxed_max"
+	(v128.const f32x4 1 -2 3 -4) (v128.const f32x4 -1 2 -3 4))
+	(v128.const f32x4 1 2 3 4))
+(assert_return (invoke "f64x2.relaxed_min" (v128.const f64x2 1.5 -2) (v128.const f64x2 2.5 -3))
+	(v128.const f64x2 1.5 -3))
+(assert_return (invoke "f64x2.relaxed_max" (v128.const f64x2 1.5 -2) (v128.const f64x2 2.5 -3))
+	(v128.const f64x2 2.5 -2))
+
+;; Q15 multiplication of inputs other than -0x8000 * -0x8000.
+(assert_return (invoke "i16x8.relaxed_q15mulr_s"
+	(v128.const i16x8 0x4000 0x4000 -0x4000 0x7fff 0 1 0x2000 -0x8000)
+	(v128.const i16x8 0x4000 -0x4000 -0x4000 0x7fff 0x7fff 0x4000 0x2000 0x4000))
+	(v128.const i16x8 0x2000 -0x2000 0x2000 0x7ffe 0 1 0x800 -0x4000))
+
+;; Dot products whose second operand has no lanes with the high bit set.
+(assert_return (invoke "i16x8.relaxed_dot_i8x16_i7x16_s"
+	(v128.const i8x16 1 2 3 4 -5 6 -128 -128 127 127 0 1 -1 -1 10 20)
+	(v128.const i8x16 1 1 2 2 3 3 127 127 127 127 5 6 1 2 3 4))
+	(v128.const i16x8 3 14 3 -32512 32258 6 -3 110))
+(assert_return (invoke "i32x4.relaxed_dot_i8x16_i7x16_add_s"
+	(v128.const i8x16 1 2 3 4 -5 6 7 8 -128 -128 -128 -128 0 0 0 1)
+	(v128.const i8x16 1 1 1 1 2 2 2 2 127 127 127 127 0 0 0 1)
+	(v128.const i32x4 0 100 1 -1))
+	(v128.const i32x4 10 132 -65023 0))
+
+;; Relaxed SIMD operators are encoded with the 0xfd prefix and an index above 0xff.
+(module binary
+	"\00asm" "\01\00\00\00"
+	"\01\07\01\60\02\7b\7b\01\7b"          ;; type section: (func (param v128 v128) (result v128))
+	"\03\02\01\00"                         ;; function section
+	"\07\0b\01\07\73\77\69\7a\7a\6c\65\00\00" ;; export section: "swizzle"
+	"\0a\0b\01\09\00\20\00\20\01\fd\80\02\0b" ;; code section: i8x16.relaxed_swizzle
+)
+(assert_return (invoke "swizzle"
+	(v128.const i8x16 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25)
+	(v128.const i8x16 0 0 1 1 2 2 3 3 4 4 5 5 6 6 7 7))
+	(v128.const i8x16 10 10 11 11 12 12 13 13 14 14 15 15 16 16 17 17))
+
+(assert_malformed
+	(module binary
+		"\00asm" "\01\00\00\00"
+		"\01\07\01\60\02\7b\7b\01\7b"
+		"\03\02\01\00"
+		"\0a\0b\01\09\00\20\00\20\01\fd\80\04\0b" ;; 0xfd 0x200 is not an opcode
+	)
+	"unknown opcode")
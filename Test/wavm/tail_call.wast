@@ -0,0 +1,121 @@
+;; return_call and return_call_indirect
+
+(module
+	(type $i64_to_i64 (func (param i64) (result i64)))
+	(type $many_to_i64 (func (param i64 i64 i64 i64 i64 i64 i64 i64 i64 i64) (result i64)))
+
+	(table funcref (elem $even $odd $sum_many))
+
+	(func $even (export "even") (param $n i64) (result i64)
+		(if (result i64) (i64.eqz (local.get $n))
+			(then (i64.const 1))
+			(else (return_call $odd (i64.sub (local.get $n) (i64.const 1))))))
+	(func $odd (export "odd") (param $n i64) (result i64)
+		(if (result i64) (i64.eqz (local.get $n))
+			(then (i64.const 0))
+			(else (return_call_indirect (type $i64_to_i64)
+				(i64.sub (local.get $n) (i64.const 1))
+				(i32.const 0)))))
+
+	;; Tail calls between functions with different numbers of parameters, more than fit in
+	;; registers, so the callee's arguments are passed on the stack in the caller's frame.
+	(func $count_many (export "count_many") (param $n i64) (result i64)
+		(if (result i64) (i64.eqz (local.get $n))
+			(then (i64.const 0))
+			(else (return_call $sum_many
+				(local.get $n) (i64.const 1) (i64.const 2) (i64.const 3) (i64.const 4)
+				(i64.const 5) (i64.const 6) (i64.const 7) (i64.const 8) (i64.const 9)))))
+	(func $sum_many (type $many_to_i64)
+		(param $n i64) (param i64 i64 i64 i64 i64 i64 i64 i64 i64) (result i64)
+		(if (i64.ne
+				(i64.add (i64.add (i64.add (local.get 1) (local.get 2))
+								  (i64.add (local.get 3) (local.get 4)))
+						 (i64.add (i64.add (i64.add (local.get 5) (local.get 6))
+										   (i64.add (local.get 7) (local.get 8)))
+								  (local.get 9)))
+				(i64.const 45))
+			(then (unreachable)))
+		(return_call $count_many (i64.sub (local.get $n) (i64.const 1))))
+	(func (export "count_many_indirect") (param $n i64) (result i64)
+		(return_call_indirect (type $many_to_i64)
+			(local.get $n) (i64.const 1) (i64.const 2) (i64.const 3) (i64.const 4)
+			(i64.const 5) (i64.const 6) (i64.const 7) (i64.const 8) (i64.const 9)
+			(i32.const 2)))
+
+	;; A tail call to a function of a different type than the table element traps.
+	(func (export "call_wrong_type") (result i64)
+		(return_call_indirect (type $many_to_i64)
+			(i64.const 0) (i64.const 0) (i64.const 0) (i64.const 0) (i64.const 0)
+			(i64.const 0) (i64.const 0) (i64.const 0) (i64.const 0) (i64.const 0)
+			(i32.const 0)))
+	(func (export "call_out_of_bounds") (result i64)
+		(return_call_indirect (type $i64_to_i64) (i64.const 0) (i32.const 3)))
+)
+
+;; Enough tail calls to overflow the stack if they didn't reuse the caller's frame.
+(assert_return (invoke "even" (i64.const 0)) (i64.const 1))
+(assert_return (invoke "even" (i64.const 1)) (i64.const 0))
+(assert_return (invoke "even" (i64.const 10000000)) (i64.const 1))
+(assert_return (invoke "odd" (i64.const 10000001)) (i64.const 1))
+(assert_return (invoke "count_many" (i64.const 10000000)) (i64.const 0))
+(assert_return (invoke "count_many_indirect" (i64.const 10000000)) (i64.const 0))
+
+(assert_trap (invoke "call_wrong_type") "indirect call type mismatch")
+(assert_trap (invoke "call_out_of_bounds") "undefined element")
+
+;; Tail calls to imported functions.
+
+(module
+	(func $print (import "spectest" "print_i32") (param i32))
+	(func (export "print") (param i32)
+		(return_call $print (local.get 0)))
+)
+
+(assert_return (invoke "print" (i32.const 1)))
+
+;; A tail call in a catch clause is a call followed by a return.
+
+(module
+	(exception_type $e i32)
+	(func $identity (param i32) (result i32) (local.get 0))
+	(func (export "catch_and_call") (param i32) (result i32)
+		try (result i32)
+			(throw $e (local.get 0))
+		catch $e
+			(return_call $identity)
+		end)
+)
+
+(assert_return (invoke "catch_and_call" (i32.const 7)) (i32.const 7))
+
+;; Tail calls must return the caller's results.
+
+(assert_invalid
+	(module
+		(func $f (result i64) (i64.const 0))
+		(func (result i32) (return_call $f)))
+	"type mismatch")
+
+(assert_invalid
+	(module
+		(type $t (func (result i32)))
+		(table 1 funcref)
+		(func (result i64) (return_call_indirect (type $t) (i32.const 0))))
+	"type mismatch")
+
+(assert_invalid
+	(module
+		(func $f (param i32))
+		(func (return_call $f (i64.const 0))))
+	"type mismatch")
+
+;; The operand stack is polymorphic after a tail call.
+(module
+	(func $f (result i32) (i32.const 1))
+	(func (export "polymorphic") (result i32)
+		(return_call $f)
+		(i64.const 0)
+		(drop))
+)
+
+(assert_return (invoke "polymorphic") (i32.const 1))
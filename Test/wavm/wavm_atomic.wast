@@ -465,6 +465,24 @@
 (module (memory 1 1) (func (drop (i64.atomic.rmw16.cmpxchg_u (i32.const 7) (i64.const 0) (i64.const 0)))))
 (module (memory 1 1) (func (drop (i64.atomic.rmw32.cmpxchg_u (i32.const 7) (i64.const 0) (i64.const 0)))))
 
+;; alignment checks of addresses that are known at compile time
+
+(module
+  (memory 1 1)
+  (func (export "aligned") (param $i i32) (result i64)
+    (i64.atomic.store (i32.const 8) (i64.const 1))
+    (i32.atomic.store offset=16 (i32.shl (local.get $i) (i32.const 3)) (i32.const 2))
+    (i64.add (i64.atomic.load (i32.const 8))
+             (i64.extend_i32_u (i32.atomic.load (i32.add (i32.mul (local.get $i) (i32.const 8)) (i32.const 16))))))
+  (func (export "misaligned-constant") (result i32) (i32.atomic.load (i32.const 6)))
+  (func (export "misaligned-offset") (param $i i32) (result i32)
+    (i32.atomic.load offset=2 (i32.shl (local.get $i) (i32.const 2))))
+)
+
+(assert_return (invoke "aligned" (i32.const 1)) (i64.const 3))
+(assert_trap (invoke "misaligned-constant") "unaligned atomic")
+(assert_trap (invoke "misaligned-offset" (i32.const 1)) "unaligned atomic")
+
 ;; wait/wake operators
 
 (module